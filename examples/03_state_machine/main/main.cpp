@@ -3,6 +3,7 @@
  * @brief State Machine example demonstrating INTERNAL and EXTERNAL transitions
  */
 
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <nvs_flash.h>
@@ -290,11 +291,13 @@ extern "C" void app_main(void)
     sm.update();
 
     LOPCORE_LOGI(TAG, "\n=== Complete ===");
-    auto history = sm.getHistory();
+    const auto &history = sm.history();
+    int64_t now = esp_timer_get_time();
     LOPCORE_LOGI(TAG, "State History (%zu):", history.size());
     for (size_t i = 0; i < history.size(); i++)
     {
-        LOPCORE_LOGI(TAG, "  %zu. %s", i + 1, stateToString(history[i]));
+        LOPCORE_LOGI(TAG, "  %zu. %s for %lld ms", i + 1, stateToString(history[i].state),
+                     static_cast<long long>(history.timeInStateUs(i, now) / 1000));
     }
     LOPCORE_LOGI(TAG, "\nINTERNAL: INIT->RUNNING, ERROR->RUNNING");
     LOPCORE_LOGI(TAG, "EXTERNAL: All others");
@@ -0,0 +1,429 @@
+/**
+ * @file main.cpp
+ * @brief MQTT client benchmark
+ *
+ * Drives EspMqttClient and CoreMqttClient through the same workload against
+ * one broker so their costs can be compared on real hardware:
+ * - Each client subscribes to its own topic, so every publish loops back
+ *   through the broker and is timed end to end
+ * - Payload sizes and QoS levels are swept
+ * - Reports messages/s, round-trip p50/p99, PUBACK p50, heap high-water
+ *   mark and heap allocations per message
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include <stdio.h>
+
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lopcore/logging/console_sink.hpp"
+#include "lopcore/logging/logger.hpp"
+#include "lopcore/mqtt/coremqtt_client.hpp"
+#include "lopcore/mqtt/esp_mqtt_client.hpp"
+#include "lopcore/mqtt/mqtt_metrics.hpp"
+#include "lopcore/tls/mbedtls_transport.hpp"
+
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_spiffs.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "protocol_examples_common.h"
+
+static const char *TAG = "mqtt_benchmark";
+
+using lopcore::mqtt::MqttQos;
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+const char *brokerHost = CONFIG_BENCH_BROKER_HOST;
+const uint16_t brokerPort = CONFIG_BENCH_BROKER_PORT;
+const char *certPath = "/spiffs/root_ca.crt";
+
+const size_t payloadSizes[] = {16, 256, 2048};
+const MqttQos qosLevels[] = {MqttQos::AT_MOST_ONCE, MqttQos::AT_LEAST_ONCE};
+
+// Time allowed for the last messages to come back
+const int64_t drainTimeoutUs = 5 * 1000 * 1000;
+
+// ============================================================================
+// Broker Certificate
+// ============================================================================
+
+// ISRG Root X1 (Let's Encrypt root CA)
+const char *brokerRootCA = R"(-----BEGIN CERTIFICATE-----
+MIIFazCCA1OgAwIBAgIRAIIQz7DSQONZRGPgu2OCiwAwDQYJKoZIhvcNAQELBQAw
+TzELMAkGA1UEBhMCVVMxKTAnBgNVBAoTIEludGVybmV0IFNlY3VyaXR5IFJlc2Vh
+cmNoIEdyb3VwMRUwEwYDVQQDEwxJU1JHIFJvb3QgWDEwHhcNMTUwNjA0MTEwNDM4
+WhcNMzUwNjA0MTEwNDM4WjBPMQswCQYDVQQGEwJVUzEpMCcGA1UEChMgSW50ZXJu
+ZXQgU2VjdXJpdHkgUmVzZWFyY2ggR3JvdXAxFTATBgNVBAMTDElTUkcgUm9vdCBY
+MTCCAiIwDQYJKoZIhvcNAQEBBQADggIPADCCAgoCggIBAK3oJHP0FDfzm54rVygc
+h77ct984kIxuPOZXoHj3dcKi/vVqbvYATyjb3miGbESTtrFj/RQSa78f0uoxmyF+
+0TM8ukj13Xnfs7j/EvEhmkvBioZxaUpmZmyPfjxwv60pIgbz5MDmgK7iS4+3mX6U
+A5/TR5d8mUgjU+g4rk8Kb4Mu0UlXjIB0ttov0DiNewNwIRt18jA8+o+u3dpjq+sW
+T8KOEUt+zwvo/7V3LvSye0rgTBIlDHCNAymg4VMk7BPZ7hm/ELNKjD+Jo2FR3qyH
+B5T0Y3HsLuJvW5iB4YlcNHlsdu87kGJ55tukmi8mxdAQ4Q7e2RCOFvu396j3x+UC
+B5iPNgiV5+I3lg02dZ77DnKxHZu8A/lJBdiB3QW0KtZB6awBdpUKD9jf1b0SHzUv
+KBds0pjBqAlkd25HN7rOrFleaJ1/ctaJxQZBKT5ZPt0m9STJEadao0xAH0ahmbWn
+OlFuhjuefXKnEgV4We0+UXgVCwOPjdAvBbI+e0ocS3MFEvzG6uBQE3xDk3SzynTn
+jh8BCNAw1FtxNrQHusEwMFxIt4I7mKZ9YIqioymCzLq9gwQbooMDQaHWBfEbwrbw
+qHyGO0aoSCqI3Haadr8faqU9GY/rOPNk3sgrDQoo//fb4hVC1CLQJ13hef4Y53CI
+rU7m2Ys6xt0nUW7/vGT1M0NPAgMBAAGjQjBAMA4GA1UdDwEB/wQEAwIBBjAPBgNV
+HRMBAf8EBTADAQH/MB0GA1UdDgQWBBR5tFnme7bl5AFzgAiIyBpY9umbbjANBgkq
+hkiG9w0BAQsFAAOCAgEAVR9YqbyyqFDQDLHYGmkgJykIrGF1XIpu+ILlaS/V9lZL
+ubhzEFnTIZd+50xx+7LSYK05qAvqFyFWhfFQDlnrzuBZ6brJFe+GnY+EgPbk6ZGQ
+3BebYhtF8GaV0nxvwuo77x/Py9auJ/GpsMiu/X1+mvoiBOv/2X/qkSsisRcOj/KK
+NFtY2PwByVS5uCbMiogziUwthDyC3+6WVwW6LLv3xLfHTjuCvjHIInNzktHCgKQ5
+ORAzI4JMPJ+GslWYHb4phowim57iaztXOoJwTdwJx4nLCgdNbOhdjsnvzqvHu7Ur
+TkXWStAmzOVyyghqpZXjFaH3pO3JLF+l+/+sKAIuvtd7u+Nxe5AW0wdeRlN8NwdC
+jNPElpzVmbUq4JUagEiuTDkHzsxHpFKVK7q4+63SM1N95R1NbdWhscdCb+ZAJzVc
+oyi3B43njTOQ5yOf+1CceWxG1bQVs5ZufpsMljq4Ui0/1lvh+wjChP4kqKOJ2qxq
+4RgqsahDYVvTH9w7jXbyLeiNdd8XM2w9U/t7y0Ff/9yi0GE44Za4rF2LN9d11TPA
+mRGunUHBcnWEvgJBQl9nJEiU0Zsnvgc/ubhPgXRR4Xq37Z0j4r7g1SgEEzwxA57d
+emyPxgcYxn/eR44/KJ4EBs+lVDR3veyJm+kXQ99b21/+jh5Xos1AnX5iItreGCc=
+-----END CERTIFICATE-----)";
+
+// ============================================================================
+// Allocation Counting
+// ============================================================================
+
+// Called by the heap on every allocation (CONFIG_HEAP_USE_HOOKS)
+static std::atomic<uint32_t> g_allocations{0};
+
+extern "C" IRAM_ATTR void esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps)
+{
+    (void) ptr;
+    (void) size;
+    (void) caps;
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+extern "C" IRAM_ATTR void esp_heap_trace_free_hook(void *ptr)
+{
+    (void) ptr;
+}
+
+// ============================================================================
+// Clock compatibility layer (stub for linking)
+// ============================================================================
+
+extern "C" void Clock_SleepMs(uint32_t sleepTimeMs)
+{
+    vTaskDelay(pdMS_TO_TICKS(sleepTimeMs));
+}
+
+// ============================================================================
+// Loopback Tracking
+// ============================================================================
+
+/**
+ * Every payload starts with the esp_timer time it was published at, so the
+ * receive callback can time the round trip without a lookup table.
+ */
+struct LoopbackState
+{
+    std::atomic<uint32_t> received{0};
+    lopcore::mqtt::MqttLatencyHistogram roundTrip;
+
+    void reset()
+    {
+        received.store(0);
+        roundTrip.reset();
+    }
+};
+
+static LoopbackState g_loopback;
+
+void onLoopback(const lopcore::mqtt::MqttMessageView &message)
+{
+    int64_t sentUs = 0;
+    if (message.payloadLength < sizeof(sentUs))
+    {
+        return;
+    }
+    std::memcpy(&sentUs, message.payload, sizeof(sentUs));
+    g_loopback.roundTrip.record(static_cast<uint32_t>(esp_timer_get_time() - sentUs));
+    g_loopback.received.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ============================================================================
+// Benchmark
+// ============================================================================
+
+struct CaseResult
+{
+    uint32_t sent = 0;
+    uint32_t received = 0;
+    float messagesPerSecond = 0.0f;
+    uint32_t roundTripP50Us = 0;
+    uint32_t roundTripP99Us = 0;
+    uint32_t ackP50Us = 0;
+    size_t peakHeapBytes = 0;
+    float allocationsPerMessage = 0.0f;
+};
+
+/**
+ * Publish CONFIG_BENCH_MESSAGES messages of one size and QoS, keeping at most
+ * CONFIG_BENCH_WINDOW of them in flight, and wait for them to loop back.
+ *
+ * Both clients expose the same non-virtual API, so one template covers them.
+ */
+template<typename Client>
+CaseResult runCase(Client &client, const std::string &topic, size_t payloadSize, MqttQos qos)
+{
+    CaseResult result;
+    std::vector<uint8_t> payload(payloadSize, 0xA5);
+
+    client.resetStatistics();
+    g_loopback.reset();
+
+    size_t freeBefore = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    heap_caps_monitor_local_minimum_free_size_start();
+    g_allocations.store(0);
+
+    int64_t startUs = esp_timer_get_time();
+    int64_t lastProgressUs = startUs;
+    while (result.sent < CONFIG_BENCH_MESSAGES)
+    {
+        if (result.sent - g_loopback.received.load() >= CONFIG_BENCH_WINDOW)
+        {
+            if (esp_timer_get_time() - lastProgressUs > drainTimeoutUs)
+            {
+                break; // Lost messages (QoS 0) would otherwise stall the window
+            }
+            vTaskDelay(1);
+            continue;
+        }
+
+        int64_t nowUs = esp_timer_get_time();
+        std::memcpy(payload.data(), &nowUs, sizeof(nowUs));
+        if (client.publish(topic, payload, qos, false) == ESP_OK)
+        {
+            result.sent++;
+            lastProgressUs = nowUs;
+        }
+        else
+        {
+            vTaskDelay(1);
+        }
+    }
+
+    while (g_loopback.received.load() < result.sent && esp_timer_get_time() - lastProgressUs < drainTimeoutUs)
+    {
+        vTaskDelay(1);
+    }
+    int64_t elapsedUs = esp_timer_get_time() - startUs;
+
+    uint32_t allocations = g_allocations.load();
+    size_t freeMinimum = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    heap_caps_monitor_local_minimum_free_size_stop();
+
+    lopcore::mqtt::MqttHistogramSnapshot roundTrip = g_loopback.roundTrip.snapshot();
+    lopcore::mqtt::MqttMetricsSnapshot metrics = client.getMetrics();
+
+    result.received = g_loopback.received.load();
+    result.messagesPerSecond = elapsedUs > 0 ? result.received * 1e6f / elapsedUs : 0.0f;
+    result.roundTripP50Us = roundTrip.percentileUs(50);
+    result.roundTripP99Us = roundTrip.percentileUs(99);
+    result.ackP50Us = metrics.publishAckLatency.percentileUs(50);
+    result.peakHeapBytes = freeBefore > freeMinimum ? freeBefore - freeMinimum : 0;
+    result.allocationsPerMessage = result.sent > 0 ? static_cast<float>(allocations) / result.sent : 0.0f;
+    return result;
+}
+
+template<typename Client>
+void runSweep(Client &client, const char *name, const std::string &topic)
+{
+    if (client.subscribeView(topic, onLoopback, MqttQos::AT_LEAST_ONCE) != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "%s: subscribe to %s failed", name, topic.c_str());
+        return;
+    }
+    vTaskDelay(pdMS_TO_TICKS(1000)); // SUBACK
+
+    for (MqttQos qos : qosLevels)
+    {
+        for (size_t payloadSize : payloadSizes)
+        {
+            CaseResult r = runCase(client, topic, payloadSize, qos);
+            printf("%-8s %3d %7u %5lu/%-5lu %9.1f %8lu %8lu %8lu %9u %7.2f\n", name, static_cast<int>(qos),
+                   static_cast<unsigned>(payloadSize), static_cast<unsigned long>(r.received),
+                   static_cast<unsigned long>(r.sent), r.messagesPerSecond,
+                   static_cast<unsigned long>(r.roundTripP50Us), static_cast<unsigned long>(r.roundTripP99Us),
+                   static_cast<unsigned long>(r.ackP50Us), static_cast<unsigned>(r.peakHeapBytes),
+                   r.allocationsPerMessage);
+        }
+    }
+
+    client.unsubscribe(topic);
+}
+
+template<typename Client>
+bool waitForConnection(Client &client, uint32_t timeoutMs = 10000)
+{
+    TickType_t start = xTaskGetTickCount();
+    while ((xTaskGetTickCount() - start) < pdMS_TO_TICKS(timeoutMs))
+    {
+        if (client.isConnected())
+        {
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    return false;
+}
+
+// CoreMqttClient's transport always authenticates with PKCS#11 credentials
+lopcore::tls::TlsConfig coreTlsConfig()
+{
+    return lopcore::tls::TlsConfigBuilder()
+        .hostname(brokerHost)
+        .port(brokerPort)
+        .caCertificate(certPath)
+        .clientCertificate(CONFIG_BENCH_CLIENT_CERT_LABEL)
+        .privateKey(CONFIG_BENCH_CLIENT_KEY_LABEL)
+        .verifyPeer(true)
+        .build();
+}
+
+// ESP-MQTT verifies the server against the CA only
+lopcore::tls::TlsConfig espTlsConfig()
+{
+    return lopcore::tls::TlsConfigBuilder()
+        .hostname(brokerHost)
+        .port(brokerPort)
+        .caCertificate(certPath)
+        .verifyPeer(false)
+        .build();
+}
+
+lopcore::mqtt::MqttConfigBuilder benchConfig(const char *clientId, const lopcore::tls::TlsConfig &tls)
+{
+    lopcore::mqtt::BudgetConfig noBudget;
+    noBudget.enabled = false; // Measure the client, not the rate limiter
+
+    auto builder = lopcore::mqtt::MqttConfig::builder();
+    builder.clientId(clientId)
+        .port(brokerPort)
+        .keepAlive(std::chrono::seconds(60))
+        .cleanSession(true)
+        .budgetConfig(noBudget)
+        .tlsConfig(tls);
+    return builder;
+}
+
+void benchEspMqtt()
+{
+    std::string uri = std::string("mqtts://") + brokerHost;
+    auto config = benchConfig("lopcore_bench_esp", espTlsConfig()).broker(uri).build();
+
+    lopcore::mqtt::EspMqttClient client(config);
+    if (client.connect() != ESP_OK || !waitForConnection(client))
+    {
+        LOPCORE_LOGE(TAG, "EspMqttClient: connection failed");
+        return;
+    }
+
+    runSweep(client, "esp-mqtt", "lopcore/bench/lopcore_bench_esp");
+    client.disconnect();
+}
+
+void benchCoreMqtt()
+{
+    auto tls = coreTlsConfig();
+    auto transport = std::make_shared<lopcore::tls::MbedtlsTransport>();
+    if (transport->connect(tls) != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "CoreMqttClient: TLS connection failed");
+        return;
+    }
+
+    auto config =
+        benchConfig("lopcore_bench_core", tls).broker(brokerHost).autoStartProcessLoop(true).build();
+
+    lopcore::mqtt::CoreMqttClient client(config, transport);
+    if (client.connect() != ESP_OK || !waitForConnection(client))
+    {
+        LOPCORE_LOGE(TAG, "CoreMqttClient: connection failed");
+        return;
+    }
+
+    runSweep(client, "coremqtt", "lopcore/bench/lopcore_bench_core");
+    client.disconnect();
+}
+
+// ============================================================================
+// SPIFFS Initialization and Certificate Setup
+// ============================================================================
+
+esp_err_t writeBrokerCertificate()
+{
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = "/spiffs", .partition_label = NULL, .max_files = 5, .format_if_mount_failed = true};
+    esp_err_t ret = esp_vfs_spiffs_register(&conf);
+    if (ret != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "Failed to mount SPIFFS (%s)", esp_err_to_name(ret));
+        return ret;
+    }
+
+    FILE *f = fopen(certPath, "w");
+    if (f == NULL)
+    {
+        LOPCORE_LOGE(TAG, "Failed to open %s for writing", certPath);
+        return ESP_FAIL;
+    }
+    size_t written = fwrite(brokerRootCA, 1, strlen(brokerRootCA), f);
+    fclose(f);
+    return written == strlen(brokerRootCA) ? ESP_OK : ESP_FAIL;
+}
+
+// ============================================================================
+// Main Application
+// ============================================================================
+
+extern "C" void app_main(void)
+{
+    // Initialize NVS
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+
+    ESP_ERROR_CHECK(writeBrokerCertificate());
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    ESP_ERROR_CHECK(example_connect()); // Wi-Fi or Ethernet from menuconfig
+
+    auto &logger = lopcore::Logger::getInstance();
+    logger.addSink(std::make_unique<lopcore::ConsoleSink>());
+    logger.setGlobalLevel(lopcore::LogLevel::WARN);
+
+    printf("\nMQTT benchmark: %s:%u, %d messages per case, window %d\n\n", brokerHost,
+           static_cast<unsigned>(brokerPort), CONFIG_BENCH_MESSAGES, CONFIG_BENCH_WINDOW);
+    printf("%-8s %3s %7s %11s %9s %8s %8s %8s %9s %7s\n", "client", "qos", "bytes", "rx/tx", "msg/s",
+           "rtt p50", "rtt p99", "ack p50", "heap", "allocs");
+
+#if CONFIG_BENCH_ESP_MQTT
+    benchEspMqtt();
+#endif
+#if CONFIG_BENCH_COREMQTT
+    benchCoreMqtt();
+#endif
+
+    printf("\nLatencies in microseconds, heap is peak bytes in use during the case,\n"
+           "allocs is heap allocations per published message.\n");
+}
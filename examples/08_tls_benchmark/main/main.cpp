@@ -0,0 +1,312 @@
+/**
+ * @file main.cpp
+ * @brief TLS cipher suite benchmark
+ *
+ * Connects MbedtlsTransport to one server with each cipher suite and key
+ * exchange group choice in turn, so TlsConfig::cipherSuites can be picked
+ * from measurements on the target chip:
+ * - Full handshakes (session resumption off), median handshake and
+ *   private key signing time from getStatistics()
+ * - With an echo server, bulk throughput of data sent and read back
+ * - The suite the server actually picked, from cipherSuite()
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lopcore/logging/console_sink.hpp"
+#include "lopcore/logging/logger.hpp"
+#include "lopcore/tls/mbedtls_transport.hpp"
+
+#include "esp_log.h"
+#include "esp_spiffs.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "protocol_examples_common.h"
+
+static const char *TAG = "tls_benchmark";
+
+namespace suite = lopcore::tls::cipher_suite;
+namespace group = lopcore::tls::tls_group;
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+const char *serverHost = CONFIG_BENCH_SERVER_HOST;
+const uint16_t serverPort = CONFIG_BENCH_SERVER_PORT;
+const char *certPath = "/spiffs/root_ca.crt";
+
+const size_t bulkChunkSize = 1024;
+
+/**
+ * One configuration under test. Suites are listed in their TLS 1.3, ECDSA
+ * and RSA forms where they exist, so a case works whatever the server's key.
+ */
+struct BenchCase
+{
+    const char *name;
+    std::vector<uint16_t> cipherSuites; ///< Empty: MbedTLS defaults
+    std::vector<uint16_t> groups;       ///< Empty: MbedTLS defaults
+};
+
+const std::vector<uint16_t> aes128Gcm = {suite::TLS13_AES_128_GCM_SHA256,
+                                         suite::ECDHE_ECDSA_AES_128_GCM_SHA256,
+                                         suite::ECDHE_RSA_AES_128_GCM_SHA256};
+const std::vector<uint16_t> aes256Gcm = {suite::TLS13_AES_256_GCM_SHA384,
+                                         suite::ECDHE_ECDSA_AES_256_GCM_SHA384,
+                                         suite::ECDHE_RSA_AES_256_GCM_SHA384};
+const std::vector<uint16_t> chacha20 = {suite::TLS13_CHACHA20_POLY1305_SHA256,
+                                        suite::ECDHE_ECDSA_CHACHA20_POLY1305_SHA256,
+                                        suite::ECDHE_RSA_CHACHA20_POLY1305_SHA256};
+
+const lopcore::tls::TlsConfig hardwarePreferred = lopcore::tls::TlsConfigBuilder().preferHardwareCrypto().build();
+
+const BenchCase cases[] = {
+    {"hw-preferred", hardwarePreferred.cipherSuites, hardwarePreferred.keyExchangeGroups},
+    {"aes128-gcm/p256", aes128Gcm, {group::SECP256R1}},
+    {"aes256-gcm/p256", aes256Gcm, {group::SECP256R1}},
+    {"aes128-cbc/p256", {suite::ECDHE_RSA_AES_128_CBC_SHA256}, {group::SECP256R1}},
+    {"chacha20/p256", chacha20, {group::SECP256R1}},
+    {"aes128-gcm/p384", aes128Gcm, {group::SECP384R1}},
+    {"aes128-gcm/x25519", aes128Gcm, {group::X25519}},
+    {"mbedtls-default", {}, {}},
+};
+
+// ============================================================================
+// Server Certificate
+// ============================================================================
+
+// ISRG Root X1 (Let's Encrypt root CA)
+const char *serverRootCA = R"(-----BEGIN CERTIFICATE-----
+MIIFazCCA1OgAwIBAgIRAIIQz7DSQONZRGPgu2OCiwAwDQYJKoZIhvcNAQELBQAw
+TzELMAkGA1UEBhMCVVMxKTAnBgNVBAoTIEludGVybmV0IFNlY3VyaXR5IFJlc2Vh
+cmNoIEdyb3VwMRUwEwYDVQQDEwxJU1JHIFJvb3QgWDEwHhcNMTUwNjA0MTEwNDM4
+WhcNMzUwNjA0MTEwNDM4WjBPMQswCQYDVQQGEwJVUzEpMCcGA1UEChMgSW50ZXJu
+ZXQgU2VjdXJpdHkgUmVzZWFyY2ggR3JvdXAxFTATBgNVBAMTDElTUkcgUm9vdCBY
+MTCCAiIwDQYJKoZIhvcNAQEBBQADggIPADCCAgoCggIBAK3oJHP0FDfzm54rVygc
+h77ct984kIxuPOZXoHj3dcKi/vVqbvYATyjb3miGbESTtrFj/RQSa78f0uoxmyF+
+0TM8ukj13Xnfs7j/EvEhmkvBioZxaUpmZmyPfjxwv60pIgbz5MDmgK7iS4+3mX6U
+A5/TR5d8mUgjU+g4rk8Kb4Mu0UlXjIB0ttov0DiNewNwIRt18jA8+o+u3dpjq+sW
+T8KOEUt+zwvo/7V3LvSye0rgTBIlDHCNAymg4VMk7BPZ7hm/ELNKjD+Jo2FR3qyH
+B5T0Y3HsLuJvW5iB4YlcNHlsdu87kGJ55tukmi8mxdAQ4Q7e2RCOFvu396j3x+UC
+B5iPNgiV5+I3lg02dZ77DnKxHZu8A/lJBdiB3QW0KtZB6awBdpUKD9jf1b0SHzUv
+KBds0pjBqAlkd25HN7rOrFleaJ1/ctaJxQZBKT5ZPt0m9STJEadao0xAH0ahmbWn
+OlFuhjuefXKnEgV4We0+UXgVCwOPjdAvBbI+e0ocS3MFEvzG6uBQE3xDk3SzynTn
+jh8BCNAw1FtxNrQHusEwMFxIt4I7mKZ9YIqioymCzLq9gwQbooMDQaHWBfEbwrbw
+qHyGO0aoSCqI3Haadr8faqU9GY/rOPNk3sgrDQoo//fb4hVC1CLQJ13hef4Y53CI
+rU7m2Ys6xt0nUW7/vGT1M0NPAgMBAAGjQjBAMA4GA1UdDwEB/wQEAwIBBjAPBgNV
+HRMBAf8EBTADAQH/MB0GA1UdDgQWBBR5tFnme7bl5AFzgAiIyBpY9umbbjANBgkq
+hkiG9w0BAQsFAAOCAgEAVR9YqbyyqFDQDLHYGmkgJykIrGF1XIpu+ILlaS/V9lZL
+ubhzEFnTIZd+50xx+7LSYK05qAvqFyFWhfFQDlnrzuBZ6brJFe+GnY+EgPbk6ZGQ
+3BebYhtF8GaV0nxvwuo77x/Py9auJ/GpsMiu/X1+mvoiBOv/2X/qkSsisRcOj/KK
+NFtY2PwByVS5uCbMiogziUwthDyC3+6WVwW6LLv3xLfHTjuCvjHIInNzktHCgKQ5
+ORAzI4JMPJ+GslWYHb4phowim57iaztXOoJwTdwJx4nLCgdNbOhdjsnvzqvHu7Ur
+TkXWStAmzOVyyghqpZXjFaH3pO3JLF+l+/+sKAIuvtd7u+Nxe5AW0wdeRlN8NwdC
+jNPElpzVmbUq4JUagEiuTDkHzsxHpFKVK7q4+63SM1N95R1NbdWhscdCb+ZAJzVc
+oyi3B43njTOQ5yOf+1CceWxG1bQVs5ZufpsMljq4Ui0/1lvh+wjChP4kqKOJ2qxq
+4RgqsahDYVvTH9w7jXbyLeiNdd8XM2w9U/t7y0Ff/9yi0GE44Za4rF2LN9d11TPA
+mRGunUHBcnWEvgJBQl9nJEiU0Zsnvgc/ubhPgXRR4Xq37Z0j4r7g1SgEEzwxA57d
+emyPxgcYxn/eR44/KJ4EBs+lVDR3veyJm+kXQ99b21/+jh5Xos1AnX5iItreGCc=
+-----END CERTIFICATE-----)";
+
+// ============================================================================
+// Clock compatibility layer (stub for linking)
+// ============================================================================
+
+extern "C" void Clock_SleepMs(uint32_t sleepTimeMs)
+{
+    vTaskDelay(pdMS_TO_TICKS(sleepTimeMs));
+}
+
+// ============================================================================
+// Benchmark
+// ============================================================================
+
+struct CaseResult
+{
+    uint32_t handshakes = 0;
+    uint32_t handshakeP50Us = 0;
+    uint32_t signP50Us = 0;
+    float bulkKBps = 0.0f; ///< 0 without an echo server
+    std::string negotiated;
+};
+
+uint32_t median(std::vector<uint32_t> &values)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+lopcore::tls::TlsConfig caseConfig(const BenchCase &benchCase)
+{
+    auto builder = lopcore::tls::TlsConfigBuilder();
+    builder.hostname(serverHost)
+        .port(serverPort)
+        .caCertificate(certPath)
+        .clientCertificate(CONFIG_BENCH_CLIENT_CERT_LABEL)
+        .privateKey(CONFIG_BENCH_CLIENT_KEY_LABEL)
+        .sessionResumption(false) // Every handshake a full one
+        .maxRetries(1)
+        .cipherSuites(benchCase.cipherSuites)
+        .keyExchangeGroups(benchCase.groups);
+    return builder.build();
+}
+
+/**
+ * Send CONFIG_BENCH_BULK_KB in bulkChunkSize writes, reading each chunk
+ * back before the next so neither direction's socket buffer fills.
+ *
+ * @return KB/s of data echoed, 0 if the server did not echo
+ */
+float runBulk(lopcore::tls::MbedtlsTransport &transport)
+{
+#if CONFIG_BENCH_ECHO
+    std::vector<uint8_t> out(bulkChunkSize, 0x5A);
+    std::vector<uint8_t> in(bulkChunkSize);
+    size_t chunks = static_cast<size_t>(CONFIG_BENCH_BULK_KB) * 1024 / bulkChunkSize;
+
+    int64_t startUs = esp_timer_get_time();
+    for (size_t i = 0; i < chunks; i++)
+    {
+        size_t sent = 0;
+        if (transport.send(out.data(), out.size(), &sent) != ESP_OK || sent != out.size())
+        {
+            return 0.0f;
+        }
+
+        size_t echoed = 0;
+        while (echoed < in.size())
+        {
+            size_t received = 0;
+            if (transport.recv(in.data() + echoed, in.size() - echoed, &received) != ESP_OK || received == 0)
+            {
+                return 0.0f;
+            }
+            echoed += received;
+        }
+    }
+    int64_t elapsedUs = esp_timer_get_time() - startUs;
+
+    return elapsedUs > 0 ? CONFIG_BENCH_BULK_KB * 1e6f / elapsedUs : 0.0f;
+#else
+    (void) transport;
+    return 0.0f;
+#endif
+}
+
+CaseResult runCase(const BenchCase &benchCase)
+{
+    CaseResult result;
+    lopcore::tls::TlsConfig config = caseConfig(benchCase);
+    std::vector<uint32_t> handshakeUs;
+    std::vector<uint32_t> signUs;
+
+    for (int i = 0; i < CONFIG_BENCH_HANDSHAKES; i++)
+    {
+        lopcore::tls::MbedtlsTransport transport;
+        if (transport.connect(config) != ESP_OK)
+        {
+            continue;
+        }
+
+        lopcore::tls::TlsStatistics stats = transport.getStatistics();
+        handshakeUs.push_back(static_cast<uint32_t>(stats.handshakeTime.count()));
+        signUs.push_back(static_cast<uint32_t>(stats.signTime.count()));
+        result.negotiated = transport.cipherSuite();
+
+        // One bulk run per case is enough: record crypto cost does not change per connection
+        if (i == 0)
+        {
+            result.bulkKBps = runBulk(transport);
+        }
+        transport.disconnect();
+    }
+
+    result.handshakes = static_cast<uint32_t>(handshakeUs.size());
+    result.handshakeP50Us = median(handshakeUs);
+    result.signP50Us = median(signUs);
+    return result;
+}
+
+// ============================================================================
+// SPIFFS Initialization and Certificate Setup
+// ============================================================================
+
+esp_err_t writeServerCertificate()
+{
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = "/spiffs", .partition_label = NULL, .max_files = 5, .format_if_mount_failed = true};
+    esp_err_t ret = esp_vfs_spiffs_register(&conf);
+    if (ret != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "Failed to mount SPIFFS (%s)", esp_err_to_name(ret));
+        return ret;
+    }
+
+    FILE *f = fopen(certPath, "w");
+    if (f == NULL)
+    {
+        LOPCORE_LOGE(TAG, "Failed to open %s for writing", certPath);
+        return ESP_FAIL;
+    }
+    size_t written = fwrite(serverRootCA, 1, strlen(serverRootCA), f);
+    fclose(f);
+    return written == strlen(serverRootCA) ? ESP_OK : ESP_FAIL;
+}
+
+// ============================================================================
+// Main Application
+// ============================================================================
+
+extern "C" void app_main(void)
+{
+    // Initialize NVS
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+
+    ESP_ERROR_CHECK(writeServerCertificate());
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    ESP_ERROR_CHECK(example_connect()); // Wi-Fi or Ethernet from menuconfig
+
+    auto &logger = lopcore::Logger::getInstance();
+    logger.addSink(std::make_unique<lopcore::ConsoleSink>());
+    logger.setGlobalLevel(lopcore::LogLevel::WARN);
+
+    printf("\nTLS benchmark: %s:%u, %d full handshakes per case\n\n", serverHost,
+           static_cast<unsigned>(serverPort), CONFIG_BENCH_HANDSHAKES);
+    printf("%-18s %5s %10s %9s %9s  %s\n", "case", "ok", "hs p50", "sign p50", "KB/s", "negotiated");
+
+    for (const BenchCase &benchCase : cases)
+    {
+        CaseResult r = runCase(benchCase);
+        printf("%-18s %2lu/%-2d %10lu %9lu %9.1f  %s\n", benchCase.name,
+               static_cast<unsigned long>(r.handshakes), CONFIG_BENCH_HANDSHAKES,
+               static_cast<unsigned long>(r.handshakeP50Us),
+               static_cast<unsigned long>(r.signP50Us), r.bulkKBps,
+               r.negotiated.empty() ? "-" : r.negotiated.c_str());
+    }
+
+    printf("\nTimes in microseconds. KB/s is data echoed per second, 0 without an echo server.\n"
+           "Cases the server or MbedTLS build does not support fail their handshakes.\n");
+}
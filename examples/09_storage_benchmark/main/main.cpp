@@ -0,0 +1,200 @@
+/**
+ * @file main.cpp
+ * @brief Storage backend benchmark
+ *
+ * Runs the sweep of test/benchmark/storage_bench.hpp against each storage
+ * backend on its real partition or card, so a backend and value layout can
+ * be picked from measurements on the target chip:
+ * - write, read, listKeys and remove of 16 B to 1 MB values, 10 and 100
+ *   files per case: ops/s, MB/s and p99 latency
+ * - Heap use change across each phase
+ * - Bytes written to flash, from the SPI flash counters, and the write
+ *   amplification over the payload; sectors erased per backend
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <string>
+
+#include "lopcore/storage/nvs_storage.hpp"
+#include "lopcore/storage/spiffs_storage.hpp"
+#include "storage_bench.hpp"
+
+#if CONFIG_BENCH_LITTLEFS
+#include "lopcore/storage/littlefs_storage.hpp"
+#endif
+#if CONFIG_BENCH_SDCARD
+#include "lopcore/storage/sdcard_storage.hpp"
+#endif
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+#include "esp_spi_flash_counters.h"
+#endif
+
+static const char *TAG = "storage_benchmark";
+
+using namespace lopcore;
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+const size_t valueSizes[] = {16, 256, 4096, 64 * 1024, 1024 * 1024};
+const size_t nvsMaxValueSize = 4096;
+const size_t nvsMaxCaseBytes = 32 * 1024; // Fits the 64 KB NVS partition with room to spare
+
+// ============================================================================
+// Platform hooks
+// ============================================================================
+
+static uint64_t nowUs()
+{
+    return static_cast<uint64_t>(esp_timer_get_time());
+}
+
+static size_t heapUsed()
+{
+    return heap_caps_get_total_size(MALLOC_CAP_8BIT) - heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+static uint64_t flashBytesWritten()
+{
+    return esp_flash_get_counters()->write.bytes;
+}
+
+static uint64_t flashBytesErased()
+{
+    return esp_flash_get_counters()->erase.bytes;
+}
+#endif
+
+static bench::Platform flashPlatform()
+{
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+    return {nowUs, heapUsed, flashBytesWritten};
+#else
+    return {nowUs, heapUsed, {}};
+#endif
+}
+
+/**
+ * @brief Sweep sized so no case fills more than half the free space
+ */
+static bench::Sweep sweepFor(size_t freeBytes, size_t maxValueSize, size_t maxCaseBytes)
+{
+    bench::Sweep sweep;
+    sweep.valueSizes.assign(std::begin(valueSizes), std::end(valueSizes));
+    sweep.fileCounts = {CONFIG_BENCH_FILE_COUNT_SMALL, CONFIG_BENCH_FILE_COUNT_LARGE};
+    sweep.maxValueSize = std::min(maxValueSize, freeBytes / 2);
+    sweep.maxCaseBytes = std::min(maxCaseBytes, freeBytes / 2);
+    return sweep;
+}
+
+template <typename Storage>
+static size_t runBackend(const char *name, Storage &storage, const bench::Sweep &sweep,
+                         const bench::Platform &platform)
+{
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+    uint64_t erasedBefore = flashBytesErased();
+#endif
+    size_t failures = bench::runSweep(name, storage, sweep, platform);
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+    if (platform.bytesWritten)
+    {
+        printf("%-9s erased %llu sectors\n", name,
+               static_cast<unsigned long long>((flashBytesErased() - erasedBefore) / 4096));
+    }
+#endif
+    return failures;
+}
+
+extern "C" void app_main(void)
+{
+    // Initialize NVS
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+
+    const size_t maxCaseBytes = CONFIG_BENCH_MAX_CASE_KB * 1024;
+    const bench::Platform flash = flashPlatform();
+    size_t failures = 0;
+
+    printf("\nStorage benchmark: %d and %d files per case, at most %d KB per case\n\n",
+           CONFIG_BENCH_FILE_COUNT_SMALL, CONFIG_BENCH_FILE_COUNT_LARGE, CONFIG_BENCH_MAX_CASE_KB);
+    bench::printHeader();
+
+    {
+        NvsStorage nvs(storage::NvsConfig().setNamespace("bench"));
+        if (nvs.initialize())
+        {
+            failures += runBackend("nvs", nvs, sweepFor(nvs.getFreeSize(), nvsMaxValueSize, nvsMaxCaseBytes), flash);
+        }
+        else
+        {
+            ESP_LOGE(TAG, "NVS did not initialize, skipped");
+        }
+    }
+
+    {
+        SpiffsStorage spiffs(storage::SpiffsConfig().setBasePath("/spiffs").setFormatIfFailed(true));
+        if (spiffs.initialize())
+        {
+            failures += runBackend("spiffs", spiffs, sweepFor(spiffs.getFreeSize(), SIZE_MAX, maxCaseBytes), flash);
+        }
+        else
+        {
+            ESP_LOGE(TAG, "SPIFFS did not mount, skipped");
+        }
+    }
+
+#if CONFIG_BENCH_LITTLEFS
+    {
+        LittleFsStorage littlefs(storage::LittleFsConfig().setBasePath("/littlefs").setFormatIfFailed(true));
+        if (littlefs.initialize())
+        {
+            failures +=
+                runBackend("littlefs", littlefs, sweepFor(littlefs.getFreeSize(), SIZE_MAX, maxCaseBytes), flash);
+        }
+        else
+        {
+            ESP_LOGE(TAG, "LittleFS did not mount, skipped");
+        }
+    }
+#endif
+
+#if CONFIG_BENCH_SDCARD
+    {
+        SdCardStorage sdcard(storage::SdCardConfig().setMountPoint("/sdcard").setSpiPins(
+            CONFIG_BENCH_SD_MOSI, CONFIG_BENCH_SD_MISO, CONFIG_BENCH_SD_CLK, CONFIG_BENCH_SD_CS));
+        if (sdcard.initialize())
+        {
+            bench::Platform card{nowUs, heapUsed, {}}; // The card's own flash is out of sight
+            failures += runBackend("sdcard", sdcard, sweepFor(sdcard.getFreeSize(), SIZE_MAX, maxCaseBytes), card);
+        }
+        else
+        {
+            ESP_LOGE(TAG, "SD card did not mount, skipped");
+        }
+    }
+#endif
+
+    bench::printLegend();
+#if !CONFIG_SPI_FLASH_ENABLE_COUNTERS
+    printf("Enable CONFIG_SPI_FLASH_ENABLE_COUNTERS to measure bytes written to flash.\n");
+#endif
+    printf("%u operations failed\n", static_cast<unsigned>(failures));
+}
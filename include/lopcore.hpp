@@ -13,6 +13,27 @@
 
 #pragma once
 
+// ============================================================================
+// Memory
+// ============================================================================
+#include "lopcore/memory/memory_resource.hpp"
+
+// ============================================================================
+// Metrics
+// ============================================================================
+#include "lopcore/metrics/metrics_exporter.hpp"
+#include "lopcore/metrics/metrics_registry.hpp"
+
+// ============================================================================
+// Tasks
+// ============================================================================
+#include "lopcore/task/task_profile.hpp"
+
+// ============================================================================
+// Boot
+// ============================================================================
+#include "lopcore/boot/bootstrap.hpp"
+
 // ============================================================================
 // Logging Subsystem
 // ============================================================================
@@ -42,9 +63,23 @@
 #include "lopcore/mqtt/mqtt_traits.hpp"
 #include "lopcore/mqtt/mqtt_types.hpp"
 #if LOPCORE_COREMQTT_ENABLED
+#include "lopcore/mqtt/coremqtt_agent_client.hpp"
 #include "lopcore/mqtt/coremqtt_client.hpp"
 #endif
 
+// ============================================================================
+// Commands
+// ============================================================================
+#include "lopcore/commands/command_router.hpp"
+
+// ============================================================================
+// Provisioning
+// ============================================================================
+#include "lopcore/provisioning/provisioning_manager.hpp"
+#if LOPCORE_COREMQTT_ENABLED
+#include "lopcore/provisioning/pkcs11_keys.hpp"
+#endif
+
 // ============================================================================
 // TLS Subsystem
 // ============================================================================
@@ -61,6 +96,4 @@
 #include "lopcore/tls/tls_transport.hpp"
 
 // Future subsystems:
-// - Provisioning
 // - State Machine
-// - Commands
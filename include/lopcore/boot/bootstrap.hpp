@@ -0,0 +1,283 @@
+/**
+ * @file bootstrap.hpp
+ * @brief Dependency-ordered, parallel subsystem start-up
+ *
+ * Boot is a set of named steps (mount a filesystem, init NVS, open
+ * PKCS#11, parse the CA chain, connect). Each step names the steps it
+ * needs; run() starts every step whose dependencies are done, several at
+ * once, so slow independent work (Wi-Fi association, a flash mount)
+ * overlaps instead of queueing on the main task:
+ *
+ * @code
+ * lopcore::boot::Bootstrap boot;
+ * boot.add("wifi", connectWifi);                      // Application's own step
+ * boot.add("nvs", [] { return nvsStorage.initialize() ? ESP_OK : ESP_FAIL; });
+ * boot.add("spiffs", [] { return spiffs.initialize() ? ESP_OK : ESP_FAIL; });
+ * boot.add("pkcs11", [] { return Pkcs11Provider::instance().initialize(); }).after({"spiffs"});
+ * boot.add("ca", [] { return CertificateCache::instance().caChain(CA_PATH) ? ESP_OK : ESP_FAIL; })
+ *     .after({"spiffs"});
+ * boot.add("mqtt", [] { return mqttClient->connect(); }).after({"wifi", "ca", "pkcs11"}).stackSize(8192);
+ * boot.add("sdcard", mountSdCard).lazy();             // Only if something asks for it
+ * boot.run();                                         // Logs a timing line per step
+ *
+ * // Later, in the code that first needs the SD card
+ * if (boot.ensure("sdcard") == ESP_OK) { ... }
+ * @endcode
+ *
+ * Lazy steps are skipped by run() unless an eager step depends on them;
+ * ensure() runs one (and its dependencies) on first use from the calling
+ * task and returns the stored result afterwards. Steps run on tasks of
+ * role task::TaskRole::BOOT_STEP; give a step that needs more than the
+ * profile's stack (a TLS handshake) its own with stackSize().
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <esp_err.h>
+#include <esp_timer.h>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#else
+#include <condition_variable>
+#include <thread>
+#endif
+
+namespace lopcore
+{
+namespace boot
+{
+
+/**
+ * @brief Where a step is in its life
+ */
+enum class StepState : uint8_t
+{
+    PENDING,  ///< Waiting for run() or for its dependencies
+    DEFERRED, ///< Lazy and not asked for yet
+    RUNNING,  ///< Executing
+    DONE,     ///< Returned ESP_OK
+    FAILED,   ///< Returned an error
+    SKIPPED   ///< A required dependency failed
+};
+
+const char *stateName(StepState state);
+
+/**
+ * @brief Timing and outcome of one step
+ */
+struct BootPhase
+{
+    std::string name;
+    StepState state{StepState::PENDING};
+    esp_err_t result{ESP_OK}; ///< What the step returned (DONE/FAILED)
+    int64_t startUs{0};       ///< Start, on the bootstrap's clock (time since boot on ESP32)
+    int64_t durationUs{0};    ///< Time the step took
+};
+
+/**
+ * @brief Bootstrap configuration
+ */
+struct BootstrapConfig
+{
+    uint32_t maxParallel{3}; ///< Steps running at once (0 = every step inline on the run() task)
+    bool logReport{true};    ///< Log the per-step timings when run() finishes
+};
+
+/**
+ * @brief Runs start-up steps in dependency order, independent ones in parallel
+ *
+ * Add every step before run(). ensure() is thread-safe and may be called
+ * while run() is in progress: a step already running is waited for, never
+ * run twice.
+ */
+class Bootstrap
+{
+public:
+    /**
+     * @brief A step's work; ESP_OK marks it done
+     */
+    using StepFunction = std::function<esp_err_t()>;
+
+    /**
+     * @brief Monotonic time source in microseconds
+     */
+    using TimeSource = int64_t (*)();
+
+    /**
+     * @brief One registered step, configured by chaining
+     */
+    class Step
+    {
+    public:
+        /**
+         * @brief Steps that must be done first
+         */
+        Step &after(std::initializer_list<const char *> names)
+        {
+            after_.insert(after_.end(), names.begin(), names.end());
+            return *this;
+        }
+
+        /**
+         * @brief Run only through ensure() or as a dependency of an eager step
+         */
+        Step &lazy()
+        {
+            lazy_ = true;
+            return *this;
+        }
+
+        /**
+         * @brief A failure does not fail run() or skip dependent steps
+         */
+        Step &optional()
+        {
+            optional_ = true;
+            return *this;
+        }
+
+        /**
+         * @brief Stack of the task the step runs on (default: task profile)
+         */
+        Step &stackSize(uint32_t bytes)
+        {
+            stackSize_ = bytes;
+            return *this;
+        }
+
+    private:
+        friend class Bootstrap;
+
+        std::string name_;
+        StepFunction function_;
+        std::vector<std::string> after_;
+        bool lazy_{false};
+        bool optional_{false};
+        uint32_t stackSize_{0};
+
+        size_t index_{0};                  ///< Position in Bootstrap::steps_
+        std::vector<Step *> dependencies_; ///< Resolved from after_
+        std::mutex runMutex_;              ///< Held while the step executes
+        BootPhase phase_;                  ///< Guarded by Bootstrap::mutex_
+    };
+
+    explicit Bootstrap(const BootstrapConfig &config = BootstrapConfig(), TimeSource timeSource = esp_timer_get_time);
+
+    ~Bootstrap();
+
+    Bootstrap(const Bootstrap &) = delete;
+    Bootstrap &operator=(const Bootstrap &) = delete;
+
+    /**
+     * @brief Register a step
+     *
+     * @return The step, to chain after()/lazy()/optional()/stackSize()
+     */
+    Step &add(const std::string &name, StepFunction function);
+
+    /**
+     * @brief Run every eager step and the lazy steps they depend on
+     *
+     * Returns when all of them have finished.
+     *
+     * @return ESP_OK if every non-optional step succeeded, ESP_FAIL if one
+     *         failed or was skipped, ESP_ERR_INVALID_ARG for an unknown
+     *         dependency, a duplicate name or a cycle (nothing is run)
+     */
+    esp_err_t run();
+
+    /**
+     * @brief Run a step and its dependencies now if they have not run
+     *
+     * @return The step's result, ESP_ERR_NOT_FOUND for an unknown name,
+     *         ESP_ERR_INVALID_STATE if a required dependency failed
+     */
+    esp_err_t ensure(const std::string &name);
+
+    /**
+     * @brief Phase of every step, in the order they were added
+     */
+    std::vector<BootPhase> report() const;
+
+    /**
+     * @brief Wall time of the last run()
+     */
+    int64_t totalUs() const;
+
+    /**
+     * @brief Log report() sorted by start time
+     */
+    void logReport() const;
+
+private:
+    /**
+     * @brief A step started on a task of its own
+     */
+    struct Launch
+    {
+        Bootstrap *owner;
+        Step *step;
+    };
+
+    /**
+     * @brief Resolve dependencies and check for cycles (once)
+     */
+    esp_err_t prepare();
+
+    /**
+     * @brief Run a step unless it already ran; serialised by its runMutex_
+     */
+    void execute(Step &step);
+
+    esp_err_t ensureStep(Step &step);
+
+    /**
+     * @brief Whether a finished dependency lets dependents proceed
+     */
+    static bool satisfied(const Step &dependency);
+
+    /**
+     * @brief Whether a finished dependency blocks dependents
+     */
+    static bool blocks(const Step &dependency);
+
+    bool launch(Step &step);
+    void finished();
+
+    static void taskEntry(void *arg);
+
+    const BootstrapConfig config_;
+    const TimeSource timeSource_;
+
+    std::vector<std::unique_ptr<Step>> steps_; ///< In add() order
+    bool prepared_{false};                     ///< prepare() succeeded
+    esp_err_t prepareResult_{ESP_OK};          ///< Result of the first prepare()
+
+    mutable std::mutex mutex_; ///< Guards phases, running_ and the fields below
+    uint32_t running_{0};      ///< Steps executing on their own task
+    int64_t totalUs_{0};       ///< Duration of the last run()
+
+#ifdef ESP_PLATFORM
+    SemaphoreHandle_t progress_; ///< Given when a launched step finishes
+#else
+    std::condition_variable progress_; ///< Notified when a launched step finishes
+    std::vector<std::thread> threads_; ///< Host step threads, joined by run()
+#endif
+};
+
+} // namespace boot
+} // namespace lopcore
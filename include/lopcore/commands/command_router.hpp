@@ -0,0 +1,324 @@
+/**
+ * @file command_router.hpp
+ * @brief Cloud-to-device command routing over one wildcard subscription
+ *
+ * A subscription and a callback per command costs a SUBSCRIBE, a slot in
+ * the client's subscription table and a topic match per message for
+ * every command the device understands. CommandRouter subscribes once to
+ * "<prefix>/+", takes the command ID from the last topic level, looks it
+ * up in a table sorted when the router starts, and hands the handler its
+ * arguments parsed in place from the payload:
+ *
+ * @code
+ * CommandRouterConfig config;
+ * config.topicPrefix = "devices/sensor-42/cmd";
+ * CommandRouter router(client, config);
+ * router.on("reboot", [](const Command &) { esp_restart(); return ESP_OK; });
+ * router.on("set_led", [](const Command &command) {
+ *     auto on = command.args.getBool("on");
+ *     if (!on) { return ESP_ERR_INVALID_ARG; }
+ *     setLed(*on, command.args.getInt("brightness").value_or(255));
+ *     return ESP_OK;
+ * });
+ * router.start(); // Subscribes to devices/sensor-42/cmd/+
+ * @endcode
+ *
+ * Payloads are a JSON object or a CBOR map (told apart by the first byte)
+ * of named arguments; an empty payload has none. Handlers run on the
+ * router's own MqttDispatcher workers, so a slow command never holds up
+ * the client's receive task: a known command is copied into a slot of a
+ * bounded queue, an unknown one is counted and dropped without a copy.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <esp_err.h>
+
+#include "lopcore/mqtt/imqtt_client.hpp"
+#include "lopcore/mqtt/mqtt_config.hpp"
+#include "lopcore/mqtt/mqtt_dispatcher.hpp"
+
+namespace lopcore
+{
+namespace commands
+{
+
+/**
+ * @brief Type of one parsed argument
+ */
+enum class ArgType : uint8_t
+{
+    INTEGER,    ///< Whole number that fits int64_t
+    NUMBER,     ///< Any other number
+    STRING,     ///< Text (JSON string contents or CBOR text string)
+    BOOL,       ///< true or false
+    NULL_VALUE, ///< null (CBOR undefined too)
+    RAW         ///< Nested object/array or CBOR byte string, kept encoded
+};
+
+/**
+ * @brief One named argument; views point into the message payload
+ */
+struct CommandArg
+{
+    std::string_view key;       ///< Name as written (JSON escapes not decoded)
+    std::string_view text;      ///< STRING contents or RAW encoding
+    ArgType type{ArgType::RAW}; ///< What the value is
+    int64_t integer{0};         ///< Value of an INTEGER
+    double number{0.0};         ///< Value of an INTEGER or NUMBER
+    bool boolean{false};        ///< Value of a BOOL
+    bool escaped{false};        ///< JSON STRING text still contains backslash escapes
+};
+
+/**
+ * @brief Arguments of one command, parsed in place without allocating
+ *
+ * Only the top level is split into arguments; nested objects and arrays
+ * are RAW. Every view is valid as long as the payload it was parsed from.
+ */
+class CommandArgs
+{
+public:
+    /// Most arguments one command may carry
+    static constexpr size_t MAX_ARGS = 16;
+
+    /// Deepest nesting a RAW value may have
+    static constexpr size_t MAX_DEPTH = 8;
+
+    /**
+     * @brief Parse a JSON object, a CBOR map or an empty payload
+     * @return false if the payload is malformed or has more than MAX_ARGS arguments
+     */
+    bool parse(const uint8_t *data, size_t length);
+
+    bool parse(std::string_view text)
+    {
+        return parse(reinterpret_cast<const uint8_t *>(text.data()), text.size());
+    }
+
+    size_t size() const
+    {
+        return count_;
+    }
+
+    bool empty() const
+    {
+        return count_ == 0;
+    }
+
+    /**
+     * @brief Whether the payload was CBOR
+     */
+    bool isCbor() const
+    {
+        return cbor_;
+    }
+
+    const CommandArg &operator[](size_t index) const
+    {
+        return args_[index];
+    }
+
+    /**
+     * @brief First argument with this key, nullptr if absent
+     */
+    const CommandArg *find(std::string_view key) const;
+
+    bool has(std::string_view key) const
+    {
+        return find(key) != nullptr;
+    }
+
+    std::optional<int64_t> getInt(std::string_view key) const;
+
+    /**
+     * @brief A NUMBER, or an INTEGER converted
+     */
+    std::optional<double> getDouble(std::string_view key) const;
+
+    std::optional<bool> getBool(std::string_view key) const;
+
+    /**
+     * @brief Contents of a STRING, in place (check CommandArg::escaped for JSON escapes)
+     */
+    std::optional<std::string_view> getString(std::string_view key) const;
+
+private:
+    bool parseJson(std::string_view json);
+    bool parseCbor(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Next free slot, nullptr once MAX_ARGS are used
+     */
+    CommandArg *next(std::string_view key);
+
+    std::array<CommandArg, MAX_ARGS> args_{}; ///< Parsed arguments
+    size_t count_{0};                         ///< Used entries of args_
+    bool cbor_{false};                        ///< Payload was CBOR
+};
+
+/**
+ * @brief One received command
+ */
+struct Command
+{
+    std::string_view id;                  ///< Command ID (last topic level)
+    const CommandArgs &args;              ///< Arguments parsed from the payload
+    const mqtt::MqttMessageView &message; ///< The message, payload included
+};
+
+/**
+ * @brief Runs one command
+ * @return ESP_OK if it succeeded; other codes are counted as failures
+ */
+using CommandHandler = std::function<esp_err_t(const Command &command)>;
+
+/**
+ * @brief Router configuration
+ */
+struct CommandRouterConfig
+{
+    std::string topicPrefix;                         ///< Commands arrive on <topicPrefix>/<command ID>
+    mqtt::MqttQos qos{mqtt::MqttQos::AT_LEAST_ONCE}; ///< QoS of the wildcard subscription
+    uint32_t maxPayload{4096};                       ///< Larger commands are rejected before queuing
+    mqtt::DispatchConfig dispatch{1, 8};             ///< Handler workers (0 = run on the receive task)
+
+    /**
+     * @brief Validate router configuration
+     * @return ESP_OK if valid, error code otherwise
+     */
+    esp_err_t validate() const
+    {
+        if (topicPrefix.empty() || topicPrefix.back() == '/' ||
+            topicPrefix.find_first_of("+#") != std::string::npos || maxPayload == 0)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        return dispatch.validate();
+    }
+};
+
+/**
+ * @brief Router counters
+ */
+struct CommandRouterStats
+{
+    uint32_t received{0};  ///< Messages on the command topic
+    uint32_t executed{0};  ///< Handlers that returned ESP_OK
+    uint32_t failed{0};    ///< Handlers that returned an error
+    uint32_t unknown{0};   ///< Commands with no handler
+    uint32_t malformed{0}; ///< Payloads that did not parse or were too large
+    uint32_t dropped{0};   ///< Commands dropped because the worker queue stayed full
+};
+
+/**
+ * @brief Dispatches commands by ID from one wildcard subscription
+ *
+ * Register every command before start(); the table is sorted then and
+ * read without a lock afterwards. Commands with the same ID run in the
+ * order they arrived.
+ */
+class CommandRouter
+{
+public:
+    /**
+     * @param client Client that carries the command topic
+     * @param config Topic and worker settings
+     */
+    CommandRouter(std::shared_ptr<mqtt::IMqttClient> client, const CommandRouterConfig &config);
+
+    /**
+     * @brief Unsubscribes and stops the workers; queued commands are discarded
+     */
+    ~CommandRouter();
+
+    CommandRouter(const CommandRouter &) = delete;
+    CommandRouter &operator=(const CommandRouter &) = delete;
+
+    /**
+     * @brief Register the handler of a command ID
+     * @return ESP_OK, ESP_ERR_INVALID_ARG for an empty ID, one containing '/',
+     *         '+' or '#', or one already registered, ESP_ERR_INVALID_STATE after start()
+     */
+    esp_err_t on(const std::string &id, CommandHandler handler);
+
+    /**
+     * @brief Start the workers and subscribe to <topicPrefix>/+
+     * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the configuration is
+     *         invalid, ESP_ERR_INVALID_STATE if already started, otherwise the
+     *         dispatcher's or client's error
+     */
+    esp_err_t start();
+
+    /**
+     * @brief Unsubscribe and stop the workers
+     *
+     * Must not be called from a handler.
+     */
+    void stop();
+
+    bool isStarted() const
+    {
+        return started_;
+    }
+
+    /**
+     * @brief Topic filter the router subscribes to
+     */
+    const std::string &topicFilter() const
+    {
+        return filter_;
+    }
+
+    size_t commandCount() const;
+
+    CommandRouterStats getStats() const;
+
+private:
+    /**
+     * @brief One command ID and its handler
+     */
+    struct Entry
+    {
+        std::string id;                          ///< Command ID
+        CommandHandler handler;                  ///< Application handler
+        std::vector<mqtt::MqttHandlerPtr> route; ///< Single dispatcher handler calling execute()
+    };
+
+    /**
+     * @brief Entry of a command ID by binary search, nullptr if none
+     */
+    const Entry *lookup(std::string_view id) const;
+
+    void onMessage(const mqtt::MqttMessageView &view);
+    void execute(const Entry &entry, const mqtt::MqttMessageView &view);
+
+    std::shared_ptr<mqtt::IMqttClient> client_; ///< Client that carries the commands
+    const CommandRouterConfig config_;          ///< Configuration
+    const std::string filter_;                  ///< <topicPrefix>/+
+    mqtt::MqttDispatcher dispatcher_;           ///< Handler workers
+
+    std::vector<std::unique_ptr<Entry>> entries_; ///< Sorted by ID at start(), then read-only
+    bool started_;                                ///< start() succeeded
+
+    mutable std::mutex mutex_; ///< Guards stats_
+    CommandRouterStats stats_; ///< Counters
+};
+
+} // namespace commands
+} // namespace lopcore
@@ -0,0 +1,236 @@
+/**
+ * @file lzss.hpp
+ * @brief LZSS token codec shared by the log, MQTT payload and storage compressors
+ *
+ * Small LZSS-style codec for text on flash and over the air: 4 KB window,
+ * single-probe hash match finder and fixed working memory. The token
+ * stream is groups of one flag byte followed by up to eight tokens, least
+ * significant flag bit first.
+ * - flag bit 0: literal byte
+ * - flag bit 1: match, 2 bytes: `offset-1` (12 bits, low byte first) and
+ *   `length-3` (upper 4 bits of the second byte), i.e. offsets 1..4096 and
+ *   lengths 3..18
+ *
+ * The stream carries no header or end marker; each user frames it:
+ * - compressLogFile(): "LCZ1" magic, stream runs to end of file
+ * - MqttPayloadCodec: uncompressed length as a LEB128 varint
+ * - CompressedStorage: "LCZS" and the uncompressed size as u32
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace lopcore
+{
+namespace lzss
+{
+
+constexpr size_t WINDOW_SIZE = 4096;
+constexpr size_t MIN_MATCH = 3;
+constexpr size_t MAX_MATCH = 18;
+
+/**
+ * @brief Match finder and token writer over a contiguous buffer
+ *
+ * Keeps the hash table (4 KB) and the flag group being filled between
+ * calls, so a buffer can be encoded in pieces as it grows.
+ */
+class Encoder
+{
+public:
+    Encoder();
+
+    Encoder(const Encoder &) = delete;
+    Encoder &operator=(const Encoder &) = delete;
+
+    /**
+     * @brief Forget all history, to start an unrelated stream
+     */
+    void reset();
+
+    /**
+     * @brief Encode buf from pos, appending tokens to out
+     *
+     * buf[0, pos) is history that matches may refer to; it must be the
+     * same bytes as on the previous call, less anything dropped by shift().
+     *
+     * @param buf Buffer of length bytes
+     * @param pos First byte to encode
+     * @param lookahead Stop while fewer bytes remain, so a later call can
+     *                  still find full-length matches; 1 encodes everything
+     * @param outputLimit Stop once out holds this many bytes
+     * @return Position of the next byte to encode
+     */
+    size_t encode(const uint8_t *buf,
+                  size_t pos,
+                  size_t length,
+                  size_t lookahead,
+                  std::vector<uint8_t> &out,
+                  size_t outputLimit = std::numeric_limits<size_t>::max());
+
+    /**
+     * @brief Account for the caller dropping the first count bytes of its buffer
+     */
+    void shift(size_t count);
+
+    /**
+     * @brief Append the last, partly filled flag group
+     */
+    void finish(std::vector<uint8_t> &out);
+
+private:
+    void writeGroup(std::vector<uint8_t> &out);
+
+    std::unique_ptr<int32_t[]> head_; ///< Latest position of each 3-byte hash
+    uint8_t group_[1 + 8 * 2];        ///< Flag byte and the tokens it covers
+    size_t used_ = 1;
+    unsigned count_ = 0;
+};
+
+/**
+ * @brief Encoder fed in pieces, never holding more than 8 KB of input
+ */
+class StreamEncoder
+{
+public:
+    StreamEncoder();
+
+    /**
+     * @brief Encode data, appending tokens to out
+     *
+     * The last MAX_MATCH bytes are held back until more input or finish().
+     */
+    void write(const uint8_t *data, size_t length, std::vector<uint8_t> &out);
+
+    /**
+     * @brief Encode the held-back input and the last flag group
+     */
+    void finish(std::vector<uint8_t> &out);
+
+private:
+    Encoder encoder_;
+    std::unique_ptr<uint8_t[]> buffer_; ///< Window plus up to 4 KB of new input
+    size_t length_ = 0;                 ///< Bytes in buffer_
+    size_t pos_ = 0;                    ///< Next byte to encode
+};
+
+/**
+ * @brief Token decoder that can stop anywhere, even inside a match
+ *
+ * Input comes from a callable returning the next byte, or -1 once there
+ * is no more.
+ */
+class Decoder
+{
+public:
+    enum class Status
+    {
+        OK,     ///< Output filled
+        END,    ///< Input ended between tokens
+        CORRUPT ///< Input ended inside a match, or a match reaches before the start
+    };
+
+    Decoder() : window_(new uint8_t[WINDOW_SIZE]())
+    {
+    }
+
+    /**
+     * @brief Decode up to length bytes into out
+     *
+     * @param next Byte source: int next()
+     * @param status OK if length bytes were produced, otherwise why not
+     * @return Bytes produced
+     */
+    template <typename Next>
+    size_t decode(Next &&next, uint8_t *out, size_t length, Status &status)
+    {
+        status = Status::OK;
+        uint8_t *start = out;
+        uint8_t *end = out + length;
+        while (out < end)
+        {
+            if (matchRemaining_ > 0)
+            {
+                emit(window_[(windowPos_ - matchOffset_) & (WINDOW_SIZE - 1)], out);
+                --matchRemaining_;
+                continue;
+            }
+
+            if (bit_ == 8)
+            {
+                flags_ = next();
+                if (flags_ < 0)
+                {
+                    status = Status::END;
+                    break;
+                }
+                bit_ = 0;
+            }
+
+            if ((flags_ & (1 << bit_++)) == 0)
+            {
+                int value = next();
+                if (value < 0)
+                {
+                    // A final group may hold fewer than eight tokens
+                    status = Status::END;
+                    break;
+                }
+                emit(static_cast<uint8_t>(value), out);
+                continue;
+            }
+
+            int low = next();
+            int high = next();
+            if (low < 0 || high < 0)
+            {
+                status = Status::CORRUPT;
+                break;
+            }
+            matchOffset_ = (static_cast<size_t>(low) | ((static_cast<size_t>(high) & 0x0F) << 8)) + 1;
+            matchRemaining_ = (static_cast<size_t>(high) >> 4) + MIN_MATCH;
+            if (matchOffset_ > total_)
+            {
+                status = Status::CORRUPT;
+                break;
+            }
+        }
+        return static_cast<size_t>(out - start);
+    }
+
+    /**
+     * @brief Whether output stopped between tokens rather than inside a match
+     */
+    bool atTokenBoundary() const
+    {
+        return matchRemaining_ == 0;
+    }
+
+private:
+    void emit(uint8_t value, uint8_t *&out)
+    {
+        window_[windowPos_] = value;
+        windowPos_ = (windowPos_ + 1) & (WINDOW_SIZE - 1);
+        ++total_;
+        *out++ = value;
+    }
+
+    std::unique_ptr<uint8_t[]> window_;
+    size_t windowPos_ = 0;
+    size_t total_ = 0;         ///< Bytes produced
+    int flags_ = 0;            ///< Current flag byte
+    unsigned bit_ = 8;         ///< Next flag bit; 8 = read a flag byte first
+    size_t matchOffset_ = 0;
+    size_t matchRemaining_ = 0; ///< Bytes of the current match still to produce
+};
+
+} // namespace lzss
+} // namespace lopcore
@@ -0,0 +1,181 @@
+/**
+ * @file async_log.hpp
+ * @brief Configuration and record types for the asynchronous logger backend
+ *
+ * In async mode producers format into a fixed-size LogRecord that is pushed
+ * into a lock-free ring; a dedicated drain task writes records to the sinks.
+ * With deferred formatting the producer only captures the format pointer and
+ * raw argument bytes (see log_args.hpp); text is produced by the consumer.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "lopcore/task/task_profile.hpp"
+
+#include "log_level.hpp"
+
+namespace lopcore
+{
+
+/// Maximum formatted message length (including terminator) carried by a log record
+static constexpr size_t LOG_RECORD_MESSAGE_SIZE = 256;
+
+/**
+ * @brief What a producer does when the async ring is full
+ */
+enum class LogOverflowPolicy : uint8_t
+{
+    DROP_NEWEST, ///< Discard the record being logged (never blocks, default)
+    DROP_OLDEST, ///< Discard the oldest queued record to make room
+    BLOCK        ///< Wait for the drain task, up to blockTimeoutMs, then drop
+};
+
+/**
+ * @brief Fixed-size record queued by the async logger
+ *
+ * A record is either preformatted (format == nullptr, message holds text) or
+ * deferred (format points at the caller's format string and message holds
+ * the encoded argument bytes).
+ *
+ * @note Tag and format are stored by pointer, so both must have static storage
+ *       duration (string literals or `static const char *TAG`), as with ESP_LOG.
+ */
+struct LogRecord
+{
+    LogLevel level;                        ///< Severity level
+    uint32_t timestamp_ms;                 ///< Milliseconds since boot, captured by the producer
+    const char *tag;                       ///< Component tag (static storage)
+    const char *format;                    ///< Format string for deferred records, nullptr if preformatted
+    uint16_t length;                       ///< Text length (excluding terminator) or encoded argument bytes
+    char message[LOG_RECORD_MESSAGE_SIZE]; ///< Formatted NUL-terminated text, or encoded arguments
+
+    /**
+     * @brief Check if the record still needs formatting
+     */
+    bool isDeferred() const
+    {
+        return format != nullptr;
+    }
+};
+
+/**
+ * @brief Async logger configuration
+ *
+ * @code
+ * AsyncLogConfig config;
+ * config.setQueueDepth(128)
+ *       .setOverflowPolicy(LogOverflowPolicy::DROP_OLDEST)
+ *       .setDrainTaskPriority(2);
+ *
+ * Logger::getInstance().enableAsync(config);
+ * @endcode
+ */
+struct AsyncLogConfig
+{
+    size_t queueDepth = 64;                                            ///< Ring slots (power of two)
+    LogOverflowPolicy overflowPolicy = LogOverflowPolicy::DROP_NEWEST; ///< Full-ring behavior
+    uint32_t blockTimeoutMs = 100;                                     ///< Max producer wait for BLOCK policy
+    uint32_t drainIntervalMs = 20;                                     ///< Drain task idle poll period
+    bool deferredFormatting = false;                                   ///< Capture raw args, format later
+    /// Drain task stack in bytes (default from the task profile)
+    uint32_t drainTaskStackSize = task::getSettings(task::TaskRole::LOG_DRAIN).stackSize;
+    /// Drain task priority, keep low (default from the task profile)
+    uint32_t drainTaskPriority = task::getSettings(task::TaskRole::LOG_DRAIN).priority;
+
+    /**
+     * @brief Set number of queued records
+     *
+     * @param depth Slot count (rounded up to power of two)
+     * @return Reference to this config for chaining
+     */
+    AsyncLogConfig &setQueueDepth(size_t depth)
+    {
+        queueDepth = depth;
+        return *this;
+    }
+
+    /**
+     * @brief Set overflow policy
+     *
+     * @param policy Behavior when the ring is full
+     * @return Reference to this config for chaining
+     */
+    AsyncLogConfig &setOverflowPolicy(LogOverflowPolicy policy)
+    {
+        overflowPolicy = policy;
+        return *this;
+    }
+
+    /**
+     * @brief Set maximum wait for the BLOCK policy
+     *
+     * @param timeoutMs Milliseconds a producer waits before dropping
+     * @return Reference to this config for chaining
+     */
+    AsyncLogConfig &setBlockTimeout(uint32_t timeoutMs)
+    {
+        blockTimeoutMs = timeoutMs;
+        return *this;
+    }
+
+    /**
+     * @brief Set drain task idle poll period
+     *
+     * @param intervalMs Milliseconds between drain passes when idle
+     * @return Reference to this config for chaining
+     */
+    AsyncLogConfig &setDrainInterval(uint32_t intervalMs)
+    {
+        drainIntervalMs = intervalMs;
+        return *this;
+    }
+
+    /**
+     * @brief Set drain task stack size
+     *
+     * @param stackSize Stack size in bytes
+     * @return Reference to this config for chaining
+     */
+    AsyncLogConfig &setDrainTaskStackSize(uint32_t stackSize)
+    {
+        drainTaskStackSize = stackSize;
+        return *this;
+    }
+
+    /**
+     * @brief Set drain task priority
+     *
+     * @param priority FreeRTOS priority
+     * @return Reference to this config for chaining
+     */
+    AsyncLogConfig &setDrainTaskPriority(uint32_t priority)
+    {
+        drainTaskPriority = priority;
+        return *this;
+    }
+
+    /**
+     * @brief Enable deferred (binary) formatting
+     *
+     * Producers skip vsnprintf and copy the format pointer plus raw argument
+     * bytes into the record. Text sinks get the message formatted on the
+     * drain task; sinks that support deferred records (e.g. a binary
+     * FileSink) store them as-is for offline decoding.
+     *
+     * @param deferred True to defer formatting to the consumer
+     * @return Reference to this config for chaining
+     */
+    AsyncLogConfig &setDeferredFormatting(bool deferred)
+    {
+        deferredFormatting = deferred;
+        return *this;
+    }
+};
+
+} // namespace lopcore
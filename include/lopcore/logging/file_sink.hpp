@@ -10,9 +10,17 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <string>
 
+#ifndef ESP_PLATFORM
+#include <thread>
+#endif
+
+#include "lopcore/memory/memory_resource.hpp"
+#include "lopcore/task/task_profile.hpp"
+
 #include "log_sink.hpp"
 
 namespace lopcore
@@ -27,21 +35,51 @@ struct FileSinkConfig
     std::string filename = "lopcore.log"; ///< Log filename
     size_t max_file_size = 100 * 1024;    ///< Max file size (100KB default)
     bool auto_rotate = true;              ///< Enable automatic rotation
-    size_t buffer_size = 512;             ///< Write buffer size
+    size_t buffer_size = 512;             ///< Flush threshold of the write buffer
+    bool binary = false;                  ///< Write binary frames (see FileSink), decode offline
+    size_t max_generations = 0;           ///< Rotated files kept as <file>.1..N (0 = delete on rotate)
+    bool compress_rotated = false;        ///< Compress rotated files to <file>.N.lz in the background
+    /// Compression task priority (ESP32, default from the task profile)
+    uint32_t compress_task_priority = task::getSettings(task::TaskRole::LOG_COMPRESS).priority;
+    /// Compression task stack size (ESP32, default from the task profile)
+    uint32_t compress_task_stack = task::getSettings(task::TaskRole::LOG_COMPRESS).stackSize;
 };
 
 /**
  * @brief Log sink that writes to SPIFFS file
  *
  * Features:
- * - Ring buffer rotation (overwrites oldest logs)
+ * - Size-based rotation, optionally keeping numbered generations
  * - Configurable size limit
- * - Buffered writes for efficiency
+ * - Buffered writes for efficiency (fixed buffer, no heap use per record)
  * - Thread-safe operation
  * - Survives reboots
  *
  * @note Requires SPIFFS to be mounted before use
  *
+ * With max_generations = N, rotation renames lopcore.log -> lopcore.log.1,
+ * lopcore.log.1 -> lopcore.log.2 and so on, deleting generation N. With
+ * compress_rotated, a low-priority task then compresses lopcore.log.1 into
+ * lopcore.log.1.lz (see log_compress.hpp) and removes the plain copy. A
+ * rotation that arrives while the previous compression is still running
+ * waits for it to finish.
+ *
+ * Binary mode (FileSinkConfig::binary) stores each record as a compact frame
+ * instead of a text line. Combined with deferred async formatting only the
+ * format/tag addresses and raw arguments reach flash; the host tool
+ * tools/lopcore_log_decode.py resolves them against the firmware ELF.
+ *
+ * Frame layout (little-endian):
+ * | Offset | Size | Field                                               |
+ * |--------|------|-----------------------------------------------------|
+ * | 0      | 1    | 0xA5 deferred record, 0xA6 text record              |
+ * | 1      | 1    | LogLevel                                            |
+ * | 2      | 2    | Payload length                                      |
+ * | 4      | 4    | Timestamp (ms)                                      |
+ * | 8      | 4    | Tag address (deferred) or 0                         |
+ * | 12     | 4    | Format address (deferred) or 0                      |
+ * | 16     | n    | Encoded arguments, or "tag\0message" for text       |
+ *
  * @code
  * FileSinkConfig config;
  * config.max_file_size = 50 * 1024;  // 50KB
@@ -67,6 +105,22 @@ public:
     void flush() override;
     const char *getName() const override;
 
+    bool supportsDeferred() const override
+    {
+        return config_.binary;
+    }
+
+    void writeDeferred(const LogRecord &record) override;
+
+    /// Frame marker for deferred (address + arguments) records
+    static constexpr uint8_t FRAME_DEFERRED = 0xA5;
+    /// Frame marker for preformatted text records
+    static constexpr uint8_t FRAME_TEXT = 0xA6;
+    /// Size of the fixed frame header
+    static constexpr size_t FRAME_HEADER_SIZE = 16;
+    /// Largest single record (text line or frame); longer records are truncated
+    static constexpr size_t MAX_RECORD_SIZE = 512;
+
     /**
      * @brief Get current log file size
      * @return File size in bytes, or 0 if file not open
@@ -100,6 +154,19 @@ public:
      */
     std::string getFilePath() const;
 
+    /**
+     * @brief Get path of a rotated generation
+     * @param generation Generation number (1 = most recent)
+     * @param compressed Path of the compressed (.lz) variant
+     * @return File path
+     */
+    std::string getGenerationPath(size_t generation, bool compressed = false) const;
+
+    /**
+     * @brief Block until background compression (if any) has finished
+     */
+    void waitForCompression();
+
 private:
     /**
      * @brief Open log file for appending
@@ -117,18 +184,58 @@ private:
      */
     void checkRotation();
 
+    /**
+     * @brief Shift numbered generations up by one and move the live file to .1
+     */
+    void shiftGenerations();
+
+    /**
+     * @brief Start background compression of generation 1
+     */
+    void startCompression();
+
+    /**
+     * @brief Compression task body
+     */
+    static void compressTaskEntry(void *arg);
+
     /**
      * @brief Format log message for file output
      * @param msg Log message to format
-     * @return Formatted string
+     * @param out Destination (at least MAX_RECORD_SIZE bytes)
+     * @param capacity Size of out in bytes
+     * @return Number of bytes written (line always ends in '\n')
      */
-    std::string formatMessage(const LogMessage &msg) const;
+    size_t formatMessage(const LogMessage &msg, char *out, size_t capacity) const;
+
+    /**
+     * @brief Flush first if less than one record of space is left
+     */
+    void reserveRecord();
+
+    /**
+     * @brief Append a binary frame to the write buffer
+     */
+    void appendFrame(uint8_t marker, LogLevel level, uint32_t timestampMs, uint32_t tagAddress,
+                     uint32_t formatAddress, const char *first, size_t firstLength, const char *second,
+                     size_t secondLength);
+
+    char *buffer()
+    {
+        return reinterpret_cast<char *>(buffer_.data());
+    }
 
-    FileSinkConfig config_; ///< Configuration
-    void *file_handle_;     ///< FILE* handle (void* for portability)
-    std::string buffer_;    ///< Write buffer
-    size_t bytes_written_;  ///< Bytes written since last rotation
-    bool file_open_;        ///< File state flag
+    FileSinkConfig config_;         ///< Configuration
+    void *file_handle_;             ///< FILE* handle (void* for portability)
+    size_t buffer_capacity_;        ///< buffer_size plus room for one record
+    memory::Buffer buffer_;         ///< Write buffer, allocated once (MemoryRole::BULK)
+    size_t buffer_used_;            ///< Bytes pending in buffer_
+    size_t bytes_written_;          ///< Bytes written since last rotation
+    bool file_open_;                ///< File state flag
+    std::atomic<bool> compressing_; ///< Background compression in progress
+#ifndef ESP_PLATFORM
+    std::thread compress_thread_; ///< Host compression thread
+#endif
 };
 
 } // namespace lopcore
@@ -0,0 +1,58 @@
+/**
+ * @file log_args.hpp
+ * @brief Binary capture of printf-style arguments for deferred log formatting
+ *
+ * Instead of running vsnprintf on the logging task, the producer walks the
+ * format string once and copies the raw argument values into a small byte
+ * buffer. The text is rebuilt later, by the drain task, a text sink, or the
+ * offline decoder (tools/lopcore_log_decode.py) that resolves the format
+ * pointer against the firmware ELF.
+ *
+ * Encoding (native byte order, no padding), one entry per conversion:
+ * - `*` width/precision and %d %i %u %x %X %o %c without l/ll/j/z/t: int32
+ * - integer conversions with l, ll, j, z or t: int64
+ * - %f %F %e %E %g %G %a %A: double
+ * - %p: uint64
+ * - %s: uint8 length followed by that many bytes (truncated to fit)
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <stdarg.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace lopcore
+{
+
+/**
+ * @brief Capture the arguments of a printf-style call
+ *
+ * @param format Format string (must have static storage duration)
+ * @param args Argument list (consumed; pass a va_copy to keep the original)
+ * @param out Destination buffer
+ * @param capacity Size of out in bytes
+ * @param written Receives number of bytes written
+ * @return true on success; false if a numeric argument does not fit or the
+ *         format uses an unsupported conversion (%n), in which case the
+ *         caller should format eagerly instead
+ */
+bool encodeLogArgs(const char *format, va_list args, uint8_t *out, size_t capacity, size_t &written);
+
+/**
+ * @brief Rebuild the text of a deferred record
+ *
+ * @param format Format string captured by encodeLogArgs
+ * @param args Encoded argument bytes
+ * @param argsLength Number of encoded bytes
+ * @param out Destination text buffer (always NUL-terminated when capacity > 0)
+ * @param capacity Size of out in bytes
+ * @return Number of characters written (excluding terminator)
+ */
+size_t formatLogArgs(const char *format, const uint8_t *args, size_t argsLength, char *out, size_t capacity);
+
+} // namespace lopcore
@@ -0,0 +1,44 @@
+/**
+ * @file log_compress.hpp
+ * @brief Streaming LZ compression for rotated log files
+ *
+ * Runs the shared LZSS codec (compression/lzss.hpp) over a file in
+ * chunks: 4 KB window, single-probe hash match finder and fixed ~12 KB
+ * working memory, so it can run in a low-priority task without holding
+ * whole files in RAM.
+ *
+ * Stream format (after the 4-byte magic "LCZ1"): groups of one flag byte
+ * followed by up to eight tokens, least significant flag bit first.
+ * - flag bit 0: literal byte
+ * - flag bit 1: match, 2 bytes: `offset-1` (12 bits, low byte first) and
+ *   `length-3` (upper 4 bits of the second byte), i.e. offsets 1..4096 and
+ *   lengths 3..18
+ *
+ * tools/lopcore_log_decode.py reads this format directly.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+namespace lopcore
+{
+
+/**
+ * @brief Compress a file
+ * @param sourcePath File to read
+ * @param destPath File to create (overwritten)
+ * @return true on success; on failure destPath may hold partial output
+ */
+bool compressLogFile(const char *sourcePath, const char *destPath);
+
+/**
+ * @brief Decompress a file produced by compressLogFile()
+ * @param sourcePath Compressed file
+ * @param destPath File to create (overwritten)
+ * @return true on success, false on I/O error or corrupt input
+ */
+bool decompressLogFile(const char *sourcePath, const char *destPath);
+
+} // namespace lopcore
@@ -9,6 +9,27 @@
 
 #include <cstdint>
 
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+/**
+ * @brief Highest log level compiled into the binary (numeric LogLevel value)
+ *
+ * LOPCORE_LOGx calls above this level expand to a discarded statement, so
+ * neither the call, its arguments, nor its format string end up in flash.
+ * Derived from CONFIG_LOPCORE_LOG_DEFAULT_LEVEL (0 = ERROR .. 4 = VERBOSE,
+ * hence the +1) and can be overridden per translation unit or project by
+ * defining it before including any logging header.
+ */
+#ifndef LOPCORE_LOG_MAX_LEVEL
+#ifdef CONFIG_LOPCORE_LOG_DEFAULT_LEVEL
+#define LOPCORE_LOG_MAX_LEVEL (CONFIG_LOPCORE_LOG_DEFAULT_LEVEL + 1)
+#else
+#define LOPCORE_LOG_MAX_LEVEL 5
+#endif
+#endif
+
 namespace lopcore
 {
 
@@ -80,4 +101,14 @@ inline char logLevelToChar(LogLevel level)
     }
 }
 
+/**
+ * @brief Check whether a level survives compile-time elimination
+ * @param level Log level to check
+ * @return true if LOPCORE_LOGx calls at this level are compiled in
+ */
+constexpr bool isLogLevelCompiled(LogLevel level)
+{
+    return static_cast<uint8_t>(level) <= LOPCORE_LOG_MAX_LEVEL;
+}
+
 } // namespace lopcore
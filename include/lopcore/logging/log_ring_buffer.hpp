@@ -0,0 +1,200 @@
+/**
+ * @file log_ring_buffer.hpp
+ * @brief Bounded lock-free multi-producer ring buffer for log records
+ *
+ * Fixed-capacity queue used by the asynchronous logger backend. Producers
+ * claim slots with a single compare-and-swap and never take a lock, so a
+ * task that logs is never blocked behind a slow sink.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace lopcore
+{
+
+/**
+ * @brief Bounded lock-free ring buffer (sequence-slot design)
+ *
+ * Each slot carries a sequence number that tells producers and consumers
+ * whether it is free, being written, or ready to read. Multiple producers
+ * are always safe; concurrent consumers are also safe, which the
+ * DROP_OLDEST overflow policy relies on to discard from the producer side.
+ *
+ * Storage is allocated once at construction; push and pop never allocate.
+ * Capacity is rounded up to the next power of two.
+ *
+ * @tparam T Trivially copyable record type
+ *
+ * @code
+ * LogRingBuffer<LogRecord> ring(64);
+ * ring.tryPush([&](LogRecord &rec) { rec.level = LogLevel::INFO; });
+ * ring.tryPop([&](const LogRecord &rec) { write(rec); });
+ * @endcode
+ */
+template<typename T>
+class LogRingBuffer
+{
+public:
+    /**
+     * @brief Allocate ring storage
+     * @param capacity Requested number of slots (rounded up to power of two, minimum 2)
+     */
+    explicit LogRingBuffer(size_t capacity)
+        : capacity_(roundUpPow2(capacity)), mask_(capacity_ - 1), slots_(new Slot[capacity_]), head_(0),
+          tail_(0)
+    {
+        for (size_t i = 0; i < capacity_; ++i)
+        {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LogRingBuffer(const LogRingBuffer &) = delete;
+    LogRingBuffer &operator=(const LogRingBuffer &) = delete;
+
+    /**
+     * @brief Claim a slot and fill it in place
+     *
+     * @param fill Callable invoked as fill(T&) on the claimed slot
+     * @return true if a slot was claimed, false if the ring is full
+     */
+    template<typename Fill>
+    bool tryPush(Fill &&fill)
+    {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        Slot *slot;
+        for (;;)
+        {
+            slot = &slots_[pos & mask_];
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // Full
+            }
+            else
+            {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+
+        fill(slot->data);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Take the oldest record and hand it to a consumer
+     *
+     * @param consume Callable invoked as consume(const T&) before the slot is released
+     * @return true if a record was consumed, false if the ring is empty
+     */
+    template<typename Consume>
+    bool tryPop(Consume &&consume)
+    {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Slot *slot;
+        for (;;)
+        {
+            slot = &slots_[pos & mask_];
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // Empty
+            }
+            else
+            {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+
+        consume(static_cast<const T &>(slot->data));
+        slot->sequence.store(pos + capacity_, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Discard the oldest record
+     * @return true if a record was discarded
+     */
+    bool discardOldest()
+    {
+        return tryPop([](const T &) {});
+    }
+
+    /**
+     * @brief Approximate number of queued records
+     *
+     * Exact when no producer or consumer is running concurrently.
+     */
+    size_t sizeApprox() const
+    {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        return head >= tail ? head - tail : 0;
+    }
+
+    /**
+     * @brief Check if ring is (approximately) empty
+     */
+    bool empty() const
+    {
+        return sizeApprox() == 0;
+    }
+
+    /**
+     * @brief Number of slots
+     */
+    size_t capacity() const
+    {
+        return capacity_;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence; ///< Slot state relative to head/tail position
+        T data;                       ///< Record payload
+    };
+
+    static size_t roundUpPow2(size_t value)
+    {
+        size_t result = 2;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t capacity_;                ///< Slot count (power of two)
+    const size_t mask_;                    ///< capacity_ - 1
+    std::unique_ptr<Slot[]> slots_;        ///< Slot storage
+    alignas(64) std::atomic<size_t> head_; ///< Next enqueue position
+    alignas(64) std::atomic<size_t> tail_; ///< Next dequeue position
+};
+
+} // namespace lopcore
@@ -10,6 +10,7 @@
 #include <memory>
 #include <string>
 
+#include "async_log.hpp"
 #include "log_level.hpp"
 
 namespace lopcore
@@ -47,6 +48,28 @@ public:
      */
     virtual void write(const LogMessage &msg) = 0;
 
+    /**
+     * @brief Check if this sink stores deferred records without formatting
+     *
+     * When true, the async drain hands deferred records to writeDeferred()
+     * instead of formatting them and calling write().
+     *
+     * @return true if writeDeferred() is implemented
+     */
+    virtual bool supportsDeferred() const
+    {
+        return false;
+    }
+
+    /**
+     * @brief Write an unformatted (deferred) record
+     * @param record Record with format pointer and encoded arguments
+     */
+    virtual void writeDeferred(const LogRecord &record)
+    {
+        (void) record;
+    }
+
     /**
      * @brief Flush any buffered log data
      */
@@ -0,0 +1,133 @@
+/**
+ * @file log_tag_cache.hpp
+ * @brief Pointer-keyed cache of resolved per-tag log levels
+ *
+ * Tags are almost always string literals or `static const char *TAG`, so
+ * the same pointer is passed on every call from a given module. The cache
+ * maps that pointer identity to the module's effective threshold, letting
+ * Logger::shouldLog() decide with a hash and one or two loads instead of a
+ * string compare per call.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "log_level.hpp"
+
+namespace lopcore
+{
+
+/**
+ * @brief Fixed-size open-addressed hash of tag pointer -> level
+ *
+ * Lookups are lock-free and may run concurrently with a single writer
+ * (Logger inserts and clears under its mutex). A slot publishes its level
+ * before its key, so a reader that sees the key also sees the level.
+ *
+ * Entries store either a LogLevel or TAG_LEVEL_INHERIT, meaning the tag
+ * has no override and follows the global level. Caching the "no override"
+ * answer keeps untouched tags on the fast path too.
+ */
+class LogTagCache
+{
+public:
+    static constexpr size_t CAPACITY = 32;             ///< Slots (power of two, matches hash())
+    static constexpr size_t MAX_PROBE = 8;             ///< Linear probe limit
+    static constexpr uint8_t TAG_LEVEL_INHERIT = 0xFF; ///< Tag follows the global level
+
+    LogTagCache()
+    {
+        clear();
+    }
+
+    LogTagCache(const LogTagCache &) = delete;
+    LogTagCache &operator=(const LogTagCache &) = delete;
+
+    /**
+     * @brief Find the cached level for a tag pointer
+     * @param tag Tag pointer (identity, not contents)
+     * @param level Receives LogLevel value or TAG_LEVEL_INHERIT on hit
+     * @return true on cache hit
+     */
+    bool lookup(const char *tag, uint8_t &level) const
+    {
+        size_t index = hash(tag);
+        for (size_t probe = 0; probe < MAX_PROBE; ++probe)
+        {
+            const Slot &slot = slots_[(index + probe) & (CAPACITY - 1)];
+            const char *key = slot.key.load(std::memory_order_acquire);
+            if (key == tag)
+            {
+                level = slot.level.load(std::memory_order_relaxed);
+                return true;
+            }
+            if (key == nullptr)
+            {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Cache a resolved level (single writer only)
+     * @param tag Tag pointer
+     * @param level LogLevel value or TAG_LEVEL_INHERIT
+     * @return true if stored, false if the probe window is full
+     */
+    bool insert(const char *tag, uint8_t level)
+    {
+        size_t index = hash(tag);
+        for (size_t probe = 0; probe < MAX_PROBE; ++probe)
+        {
+            Slot &slot = slots_[(index + probe) & (CAPACITY - 1)];
+            const char *key = slot.key.load(std::memory_order_relaxed);
+            if (key == tag || key == nullptr)
+            {
+                slot.level.store(level, std::memory_order_relaxed);
+                slot.key.store(tag, std::memory_order_release);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Drop all entries (single writer only)
+     */
+    void clear()
+    {
+        for (auto &slot : slots_)
+        {
+            slot.key.store(nullptr, std::memory_order_release);
+            slot.level.store(TAG_LEVEL_INHERIT, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<const char *> key;
+        std::atomic<uint8_t> level;
+    };
+
+    static size_t hash(const char *tag)
+    {
+        // Fibonacci hashing of the address; low bits of literals are poorly spread.
+        // The top 5 bits of the 32-bit product index the 32 slots.
+        uint32_t value = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(tag));
+        return static_cast<size_t>((value * 2654435761u) >> 27);
+    }
+
+    static_assert(CAPACITY == 32, "hash() selects 5 bits");
+
+    Slot slots_[CAPACITY];
+};
+
+} // namespace lopcore
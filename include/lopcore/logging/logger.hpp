@@ -12,25 +12,68 @@
 
 #include <stdarg.h> // Use C header instead of cstdarg for C compatibility
 
+#include <atomic>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#ifndef ESP_PLATFORM
+#include <condition_variable>
+#include <thread>
+#endif
+
+#include "async_log.hpp"
 #include "log_level.hpp"
+#include "log_ring_buffer.hpp"
 #include "log_sink.hpp"
+#include "log_tag_cache.hpp"
 
 namespace lopcore
 {
 
+namespace metrics
+{
+class MetricsRegistry;
+class Registration;
+} // namespace metrics
+
+/**
+ * @brief Logger-wide runtime counters
+ */
+struct LoggerStats
+{
+    uint32_t recordsEmitted; ///< Records that passed level filtering (written or queued)
+    uint32_t recordsDropped; ///< Records lost to async ring overflow
+};
+
+/**
+ * @brief Per-sink runtime counters
+ *
+ * Counters are 32-bit so they stay lock-free on ESP32; bytes wrap after
+ * 4 GiB, so compare deltas rather than absolute values.
+ */
+struct LogSinkStats
+{
+    const char *name; ///< ILogSink::getName()
+    uint32_t records; ///< Records handed to the sink
+    uint32_t bytes;   ///< Message bytes handed to the sink (encoded size for deferred records)
+};
+
 /**
  * @brief Thread-safe logging manager (Singleton)
  *
  * Features:
  * - Multiple output sinks (console, file, cloud, etc.)
  * - Per-tag log level filtering
- * - Thread-safe operation (FreeRTOS mutex)
+ * - Thread-safe operation: the sink list is an immutable snapshot that
+ *   log calls read with atomics only; addSink()/clearSinks() swap it
  * - Printf-style formatting
  * - Minimal performance overhead
+ * - Optional async mode: lock-free ring + drain task, so slow sinks never
+ *   stall the calling task
  *
  * @code
  * // Initialize logger
@@ -74,18 +117,32 @@ public:
 
     /**
      * @brief Set log level for specific tag
+     *
+     * Overrides the global level for every call using this tag (compared by
+     * contents, so any pointer to "MQTT" matches). Lookups on the logging
+     * path are cached by tag pointer and do not compare strings.
+     *
+     * @note Tags passed to the logging calls must have static storage
+     *       duration (literals or `static const char *TAG`), since a reused
+     *       buffer address would hit another tag's cached level.
+     *
      * @param tag Component/module tag
      * @param level Minimum level for this tag
      */
     void setTagLevel(const char *tag, LogLevel level);
 
+    /**
+     * @brief Remove all per-tag overrides
+     */
+    void clearTagLevels();
+
     /**
      * @brief Get current global log level
      * @return Current global level
      */
     LogLevel getGlobalLevel() const
     {
-        return global_level_;
+        return global_level_.load(std::memory_order_relaxed);
     }
 
     /**
@@ -137,24 +194,189 @@ public:
      */
     void log(LogLevel level, const char *tag, const char *format, ...);
 
+    /**
+     * @brief Send a prebuilt message straight to the sinks
+     *
+     * Used to replay stored records (e.g. RtcLogSink) with their original
+     * timestamp. Sink levels apply; global and per-tag levels do not.
+     *
+     * @param msg Message to write (copied by sinks as needed)
+     */
+    void dispatch(const LogMessage &msg);
+
     /**
      * @brief Flush all sinks
+     *
+     * In async mode, queued records are drained to the sinks first.
      */
     void flush();
 
+    // ========================================
+    // Asynchronous mode
+    // ========================================
+
     /**
-     * @brief Get number of active sinks
-     * @return Sink count
+     * @brief Switch to asynchronous logging
+     *
+     * Producers format into a fixed-size record and push it into a lock-free
+     * ring; a low-priority drain task writes records to the sinks. Calling
+     * again with a new config restarts the backend (pending records are
+     * drained first).
+     *
+     * @param config Queue depth, overflow policy and drain task settings
+     * @return true if the drain task was started
+     */
+    bool enableAsync(const AsyncLogConfig &config = AsyncLogConfig());
+
+    /**
+     * @brief Return to synchronous logging
+     *
+     * Stops the drain task and writes any records still queued.
+     */
+    void disableAsync();
+
+    /**
+     * @brief Check if async mode is active
+     * @return true if records are queued for the drain task
+     */
+    bool isAsync() const
+    {
+        return async_enabled_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Write queued records to the sinks on the calling task
+     *
+     * Called by the drain task; may also be called manually (e.g. before
+     * deep sleep) to empty the queue.
+     *
+     * @param maxRecords Maximum number of records to write
+     * @return Number of records written
+     */
+    size_t drainPending(size_t maxRecords = static_cast<size_t>(-1));
+
+    /**
+     * @brief Number of records dropped because the async ring was full
+     * @return Dropped record count since start or last reset
+     */
+    uint32_t getDroppedCount() const
+    {
+        return dropped_count_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get logger-wide counters
+     * @return Snapshot of emitted and dropped record counts
+     */
+    LoggerStats getStats() const;
+
+    /**
+     * @brief Get counters for every registered sink, in registration order
+     * @return One entry per sink
+     */
+    std::vector<LogSinkStats> getSinkStats() const;
+
+    /**
+     * @brief Reset all counters, including the dropped record count
+     */
+    void resetStats();
+
+    /**
+     * @brief Reset the dropped record counter
      */
-    size_t getSinkCount() const
+    void resetDroppedCount()
     {
-        return sinks_.size();
+        dropped_count_.store(0, std::memory_order_relaxed);
     }
 
+    /**
+     * @brief Expose the emitted and dropped record counts in a metrics registry
+     *
+     * Registers sampled counters named prefix + ".emitted" and ".dropped".
+     * The logger is a process-wide singleton that can outlive the registry,
+     * so the caller keeps the returned registrations; the metrics are
+     * removed when they are destroyed.
+     */
+    std::vector<metrics::Registration> registerMetrics(metrics::MetricsRegistry &registry,
+                                                       std::string_view prefix) const;
+
+    /**
+     * @brief Get number of active sinks
+     * @return Sink count
+     */
+    size_t getSinkCount() const;
+
 private:
     Logger();
     ~Logger();
 
+    /**
+     * @brief Registered sink plus the lock that serializes its write()/flush()
+     */
+    struct SinkEntry
+    {
+        explicit SinkEntry(std::unique_ptr<ILogSink> s) : sink(std::move(s))
+        {
+        }
+
+        /**
+         * @brief Count one record of `size` bytes (caller holds lock)
+         */
+        void count(size_t size)
+        {
+            records.store(records.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            bytes.store(bytes.load(std::memory_order_relaxed) + static_cast<uint32_t>(size),
+                        std::memory_order_relaxed);
+        }
+
+        std::unique_ptr<ILogSink> sink;   ///< Owned sink
+        std::mutex lock;                  ///< Sinks are not required to be reentrant
+        std::atomic<uint32_t> records{0}; ///< Records written (updated under lock)
+        std::atomic<uint32_t> bytes{0};   ///< Message bytes written (updated under lock)
+    };
+
+    /// Sink list snapshot; never modified once published
+    using SinkList = std::vector<std::shared_ptr<SinkEntry>>;
+
+    /**
+     * @brief Pins the published sink list for the duration of a fan-out
+     *
+     * Registering as a reader before loading the pointer lets
+     * publishSinks() know when no task can still see the old list.
+     */
+    class SinkListGuard
+    {
+    public:
+        explicit SinkListGuard(const Logger &logger) : readers_(logger.sink_readers_)
+        {
+            readers_.fetch_add(1);
+            list_ = logger.sinks_.load();
+        }
+
+        ~SinkListGuard()
+        {
+            readers_.fetch_sub(1);
+        }
+
+        SinkListGuard(const SinkListGuard &) = delete;
+        SinkListGuard &operator=(const SinkListGuard &) = delete;
+
+        const SinkList &list() const
+        {
+            return *list_;
+        }
+
+    private:
+        std::atomic<uint32_t> &readers_;
+        const SinkList *list_;
+    };
+
+    /**
+     * @brief Publish a new sink list and wait until no reader holds the old one (caller holds mutex_)
+     * @return The previous list, safe to destroy
+     */
+    std::unique_ptr<SinkList> publishSinks(std::unique_ptr<SinkList> next);
+
     /**
      * @brief Internal log implementation with va_list
      */
@@ -165,17 +387,82 @@ private:
      */
     bool shouldLog(LogLevel level, const char *tag) const;
 
+    /**
+     * @brief Slow path of shouldLog(): compare tag strings and cache the result
+     * @return Level value or LogTagCache::TAG_LEVEL_INHERIT
+     */
+    uint8_t resolveTagLevel(const char *tag) const;
+
     /**
      * @brief Get current timestamp in milliseconds
      */
     uint32_t getTimestampMs() const;
 
-    std::vector<std::unique_ptr<ILogSink>> sinks_; ///< Registered output sinks
-    mutable std::mutex mutex_;                     ///< Thread safety
-    LogLevel global_level_;                        ///< Global minimum level
+    /**
+     * @brief Write one message to every enabled sink
+     * @param length Message length in bytes (for the sink counters)
+     */
+    void writeToSinks(const LogMessage &msg, size_t length);
+
+    /**
+     * @brief Write one queued record, formatting deferred records only if needed
+     */
+    void writeRecordToSinks(const LogRecord &rec);
+
+    /**
+     * @brief Format and queue a record for the drain task
+     * @return false if async mode is not active (caller logs synchronously)
+     */
+    bool enqueueAsync(LogLevel level, const char *tag, const char *format, va_list args);
 
-    // Per-tag level filtering (future enhancement)
-    // std::unordered_map<std::string, LogLevel> tag_levels_;
+    /**
+     * @brief Wake the drain task early (ring filling up or producer blocked)
+     */
+    void wakeDrainTask();
+
+    /**
+     * @brief Check if the caller is the drain task (must never block on the ring)
+     */
+    bool isDrainTask() const;
+
+    /**
+     * @brief Stop the drain task and release the ring (caller holds async_mutex_)
+     */
+    void stopAsyncLocked();
+
+    /**
+     * @brief Drain task body
+     */
+    static void drainTaskEntry(void *arg);
+
+    std::atomic<SinkList *> sinks_;              ///< Published sink list (owned)
+    mutable std::atomic<uint32_t> sink_readers_; ///< Fan-outs currently using sinks_
+    mutable std::mutex mutex_;                   ///< Serializes writers, tag levels and ring_
+    std::atomic<LogLevel> global_level_;         ///< Global minimum level
+
+    // Per-tag level filtering
+    std::vector<std::pair<std::string, LogLevel>> tag_levels_; ///< Overrides (guarded by mutex_)
+    mutable LogTagCache tag_cache_;                            ///< Tag pointer -> resolved level
+    std::atomic<bool> has_tag_levels_;                         ///< Skip tag lookup when empty
+
+    // Async backend
+    std::unique_ptr<LogRingBuffer<LogRecord>> ring_; ///< Record queue (async mode only)
+    AsyncLogConfig async_config_;                    ///< Active async configuration
+    std::mutex async_mutex_;                         ///< Serializes enable/disable
+    std::atomic<bool> async_enabled_;                ///< Producers should enqueue
+    std::atomic<uint32_t> async_producers_;          ///< Producers currently touching ring_
+    std::atomic<bool> drain_running_;                ///< Drain task keep-alive flag
+    std::atomic<uint32_t> dropped_count_;            ///< Records lost to overflow
+    std::atomic<uint32_t> emitted_count_;            ///< Records that passed filtering
+
+#ifdef ESP_PLATFORM
+    void *drain_task_;                ///< TaskHandle_t of the drain task
+    std::atomic<bool> drain_stopped_; ///< Set by the drain task on exit
+#else
+    std::thread drain_thread_;           ///< Host drain thread
+    std::mutex drain_wait_mutex_;        ///< Guards drain_wake_
+    std::condition_variable drain_wake_; ///< Wakes the host drain thread
+#endif
 };
 
 } // namespace lopcore
@@ -183,16 +470,34 @@ private:
 /**
  * @brief Convenience macros for logging
  *
+ * Calls above LOPCORE_LOG_MAX_LEVEL are removed at compile time: the
+ * arguments are not evaluated and the format string is not emitted.
+ * Arguments are still type-checked, so disabled logs cannot rot.
+ *
  * Usage:
  *   LOPCORE_LOGE("TAG", "Error: %d", code);
  *   LOPCORE_LOGI("TAG", "Started");
  */
-#define LOPCORE_LOGE(tag, format, ...) lopcore::Logger::getInstance().error(tag, format, ##__VA_ARGS__)
+#define LOPCORE_LOG_LEVEL(level, method, tag, format, ...)                                                   \
+    do                                                                                                       \
+    {                                                                                                        \
+        if constexpr (lopcore::isLogLevelCompiled(level))                                                    \
+        {                                                                                                    \
+            lopcore::Logger::getInstance().method(tag, format, ##__VA_ARGS__);                               \
+        }                                                                                                    \
+    } while (0)
+
+#define LOPCORE_LOGE(tag, format, ...)                                                                       \
+    LOPCORE_LOG_LEVEL(lopcore::LogLevel::ERROR, error, tag, format, ##__VA_ARGS__)
 
-#define LOPCORE_LOGW(tag, format, ...) lopcore::Logger::getInstance().warn(tag, format, ##__VA_ARGS__)
+#define LOPCORE_LOGW(tag, format, ...)                                                                       \
+    LOPCORE_LOG_LEVEL(lopcore::LogLevel::WARN, warn, tag, format, ##__VA_ARGS__)
 
-#define LOPCORE_LOGI(tag, format, ...) lopcore::Logger::getInstance().info(tag, format, ##__VA_ARGS__)
+#define LOPCORE_LOGI(tag, format, ...)                                                                       \
+    LOPCORE_LOG_LEVEL(lopcore::LogLevel::INFO, info, tag, format, ##__VA_ARGS__)
 
-#define LOPCORE_LOGD(tag, format, ...) lopcore::Logger::getInstance().debug(tag, format, ##__VA_ARGS__)
+#define LOPCORE_LOGD(tag, format, ...)                                                                       \
+    LOPCORE_LOG_LEVEL(lopcore::LogLevel::DEBUG, debug, tag, format, ##__VA_ARGS__)
 
-#define LOPCORE_LOGV(tag, format, ...) lopcore::Logger::getInstance().verbose(tag, format, ##__VA_ARGS__)
+#define LOPCORE_LOGV(tag, format, ...)                                                                       \
+    LOPCORE_LOG_LEVEL(lopcore::LogLevel::VERBOSE, verbose, tag, format, ##__VA_ARGS__)
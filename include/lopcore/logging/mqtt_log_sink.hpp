@@ -0,0 +1,228 @@
+/**
+ * @file mqtt_log_sink.hpp
+ * @brief Log sink that ships batched log lines over MQTT
+ *
+ * Collects formatted log lines into a fixed-size batch and publishes the
+ * whole batch as one MQTT message once it holds maxBatchRecords lines, its
+ * byte budget is used up, or the oldest line is maxBatchDelayMs old.
+ * Publishing happens on a dedicated low-priority task, never inside
+ * write(), so MQTT client logging cannot re-enter the logger.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef ESP_PLATFORM
+#include <condition_variable>
+#include <thread>
+#endif
+
+#include "lopcore/mqtt/imqtt_client.hpp"
+#include "lopcore/mqtt/mqtt_budget.hpp"
+#include "lopcore/task/task_profile.hpp"
+
+#include "log_sink.hpp"
+
+namespace lopcore
+{
+
+/**
+ * @brief Configuration for MqttLogSink
+ */
+struct MqttLogSinkConfig
+{
+    std::string topic = "lopcore/logs";              ///< Topic batches are published to
+    size_t maxBatchRecords = 20;                     ///< Publish after this many lines
+    size_t maxBatchBytes = 1024;                     ///< Batch payload capacity in bytes
+    uint32_t maxBatchDelayMs = 5000;                 ///< Publish a partial batch after this age
+    mqtt::MqttQos qos = mqtt::MqttQos::AT_MOST_ONCE; ///< Publish QoS
+    mqtt::MqttBudget *budget = nullptr;              ///< Optional dedicated log budget (not owned)
+    /// Publisher task stack (ESP32, default from the task profile)
+    uint32_t taskStackSize = task::getSettings(task::TaskRole::LOG_MQTT).stackSize;
+    /// Publisher task priority (ESP32, default from the task profile)
+    uint32_t taskPriority = task::getSettings(task::TaskRole::LOG_MQTT).priority;
+
+    MqttLogSinkConfig &setTopic(const std::string &value)
+    {
+        topic = value;
+        return *this;
+    }
+
+    MqttLogSinkConfig &setMaxBatchRecords(size_t value)
+    {
+        maxBatchRecords = value;
+        return *this;
+    }
+
+    MqttLogSinkConfig &setMaxBatchBytes(size_t value)
+    {
+        maxBatchBytes = value;
+        return *this;
+    }
+
+    MqttLogSinkConfig &setMaxBatchDelay(uint32_t ms)
+    {
+        maxBatchDelayMs = ms;
+        return *this;
+    }
+
+    MqttLogSinkConfig &setQos(mqtt::MqttQos value)
+    {
+        qos = value;
+        return *this;
+    }
+
+    MqttLogSinkConfig &setBudget(mqtt::MqttBudget *value)
+    {
+        budget = value;
+        return *this;
+    }
+
+    MqttLogSinkConfig &setTaskStackSize(uint32_t value)
+    {
+        taskStackSize = value;
+        return *this;
+    }
+
+    MqttLogSinkConfig &setTaskPriority(uint32_t value)
+    {
+        taskPriority = value;
+        return *this;
+    }
+};
+
+/**
+ * @brief Counters for monitoring the MQTT log uplink
+ */
+struct MqttLogSinkStats
+{
+    uint32_t batchesPublished = 0;  ///< Successful publishes
+    uint32_t recordsPublished = 0;  ///< Lines delivered in those publishes
+    uint32_t publishFailures = 0;   ///< Publish attempts that failed (incl. budget)
+    uint32_t recordsToFallback = 0; ///< Lines written to the fallback sink
+    uint32_t recordsDropped = 0;    ///< Lines lost (no fallback available)
+};
+
+/**
+ * @brief Log sink publishing batched lines via IMqttClient::publish
+ *
+ * Each publish goes through the client's own MqttBudget; an optional
+ * dedicated budget can cap log traffic separately so logs never starve
+ * application messages. When the client is disconnected, or a batch is
+ * still waiting for budget, new lines go to the fallback sink (typically
+ * a FileSink) instead.
+ *
+ * Payload: lines in the FileSink text format, separated by '\n'.
+ *
+ * Lines logged by the publisher task itself (e.g. MQTT client
+ * diagnostics emitted during publish) bypass the batch and go to the
+ * fallback, which avoids a feedback loop of logs about shipping logs.
+ * In async logger mode records reach the sink on the drain task, so this
+ * origin check cannot apply; keep the sink's min level at INFO or above
+ * (the client's per-publish diagnostics are DEBUG) to avoid shipping them.
+ *
+ * @code
+ * auto fallback = std::make_unique<FileSink>(fileConfig);
+ * logger.addSink(std::make_unique<MqttLogSink>(
+ *     mqttClient, MqttLogSinkConfig().setTopic("devices/abc/logs"), std::move(fallback)));
+ * @endcode
+ */
+class MqttLogSink : public ILogSink
+{
+public:
+    /**
+     * @brief Create sink and start the publisher task
+     * @param client MQTT client used for publishing (shared with the application)
+     * @param config Batching configuration
+     * @param fallback Sink used while offline (optional)
+     */
+    MqttLogSink(std::shared_ptr<mqtt::IMqttClient> client,
+                const MqttLogSinkConfig &config = MqttLogSinkConfig(),
+                std::unique_ptr<ILogSink> fallback = nullptr);
+
+    /**
+     * @brief Destructor - stops the publisher task; unsent lines are discarded
+     */
+    ~MqttLogSink() override;
+
+    MqttLogSink(const MqttLogSink &) = delete;
+    MqttLogSink &operator=(const MqttLogSink &) = delete;
+
+    void write(const LogMessage &msg) override;
+
+    /**
+     * @brief Seal the current batch and wake the publisher (does not wait)
+     */
+    void flush() override;
+
+    const char *getName() const override;
+
+    /**
+     * @brief Get uplink counters
+     * @return Snapshot of the statistics
+     */
+    MqttLogSinkStats getStats() const;
+
+    /**
+     * @brief Check whether the publisher task is running
+     * @return true if started successfully
+     */
+    bool isRunning() const
+    {
+        return running_.load();
+    }
+
+private:
+    /**
+     * @brief Fixed-capacity text batch
+     */
+    struct Batch
+    {
+        std::unique_ptr<char[]> data; ///< Payload storage (maxBatchBytes)
+        size_t length = 0;            ///< Bytes used
+        size_t records = 0;           ///< Lines in the batch
+        uint32_t firstMs = 0;         ///< Timestamp of the first line
+    };
+
+    bool isPublisherTask() const;
+    void writeFallback(const LogMessage &msg);
+    bool sealLocked();
+    void wakePublisher();
+    bool publishPending();
+    static void publisherTaskEntry(void *arg);
+    static uint32_t nowMs();
+
+    std::shared_ptr<mqtt::IMqttClient> client_; ///< Publishing client
+    MqttLogSinkConfig config_;                  ///< Configuration
+    std::unique_ptr<ILogSink> fallback_;        ///< Offline sink (may be null)
+
+    mutable std::mutex batch_mutex_; ///< Guards the batches and stats_
+    Batch filling_;                  ///< Batch receiving new lines
+    Batch pending_;                  ///< Sealed batch awaiting publish
+    bool pending_ready_ = false;     ///< pending_ holds a batch
+    std::vector<uint8_t> payload_;   ///< Publish buffer (capacity reserved once)
+    MqttLogSinkStats stats_;         ///< Counters
+
+    std::atomic<bool> running_; ///< Publisher keep-alive flag
+#ifdef ESP_PLATFORM
+    std::atomic<void *> task_;  ///< TaskHandle_t of the publisher
+    std::atomic<bool> stopped_; ///< Set by the publisher on exit
+#else
+    std::thread thread_;                        ///< Host publisher thread
+    std::atomic<std::thread::id> publisher_id_; ///< Publisher thread identity
+    std::mutex wake_mutex_;                     ///< Guards wake_
+    std::condition_variable wake_;              ///< Wakes the host publisher
+    bool wake_pending_ = false;                 ///< Wake requested
+#endif
+};
+
+} // namespace lopcore
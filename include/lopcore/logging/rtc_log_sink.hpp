@@ -0,0 +1,159 @@
+/**
+ * @file rtc_log_sink.hpp
+ * @brief Crash-persistent log ring in RTC / no-init memory
+ *
+ * Keeps the last LOPCORE_RTC_LOG_SLOTS records in a fixed ring that the
+ * bootloader does not clear, so the lines leading up to a watchdog reset
+ * or panic can be replayed into the normal sinks on the next boot.
+ * Writes are a bounded copy into a 128-byte slot: no flash I/O, no
+ * allocation, cheap enough to leave enabled in production.
+ *
+ * The ring survives software, panic, watchdog and brownout resets (and
+ * deep sleep when placed in RTC memory); a power-on reset leaves garbage,
+ * which fails validation and is discarded.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "log_sink.hpp"
+
+/**
+ * @brief Number of records kept in the crash ring
+ *
+ * Each slot is 128 bytes; the default 32 slots use 4 KB of the 8 KB RTC
+ * slow memory on ESP32.
+ */
+#ifndef LOPCORE_RTC_LOG_SLOTS
+#ifdef CONFIG_LOPCORE_LOG_RTC_RING_SLOTS
+#define LOPCORE_RTC_LOG_SLOTS CONFIG_LOPCORE_LOG_RTC_RING_SLOTS
+#else
+#define LOPCORE_RTC_LOG_SLOTS 32
+#endif
+#endif
+
+namespace lopcore
+{
+
+class Logger;
+
+static constexpr size_t RTC_LOG_TAG_SIZE = 14;      ///< Tag bytes kept per record (incl. terminator)
+static constexpr size_t RTC_LOG_MESSAGE_SIZE = 104; ///< Message bytes kept per record (incl. terminator)
+
+/**
+ * @brief One persisted record
+ *
+ * `sequence` is written last; a reset in the middle of a write leaves it
+ * at 0 and the slot is skipped on recovery.
+ */
+struct RtcLogSlot
+{
+    uint32_t sequence;                  ///< Record number (0 = empty or torn)
+    uint32_t timestamp_ms;              ///< Milliseconds since the boot that wrote it
+    uint8_t level;                      ///< LogLevel
+    uint8_t length;                     ///< Message length without terminator
+    char tag[RTC_LOG_TAG_SIZE];         ///< Tag copy (tag pointers do not survive a reset)
+    char message[RTC_LOG_MESSAGE_SIZE]; ///< Message copy
+};
+
+static_assert(sizeof(RtcLogSlot) == 128, "RtcLogSlot layout changed");
+
+/**
+ * @brief Ring storage placed in memory that survives a reset
+ */
+struct RtcLogRing
+{
+    uint32_t magic;                          ///< RTC_LOG_MAGIC when initialized
+    uint32_t layout;                         ///< Slot count and size, rejects stale layouts
+    uint32_t next_sequence;                  ///< Sequence of the next record
+    uint32_t replay_start;                   ///< First sequence not yet replayed
+    RtcLogSlot slots[LOPCORE_RTC_LOG_SLOTS]; ///< Records, indexed by sequence % slots
+};
+
+/**
+ * @brief Log sink recording into a crash-persistent ring
+ *
+ * Construct it early in boot, replay what the previous boot left behind,
+ * then register it so the current boot is recorded:
+ *
+ * @code
+ * auto rtc = std::make_unique<RtcLogSink>();
+ * rtc->setMinLevel(LogLevel::INFO);
+ * logger.addSink(std::make_unique<FileSink>(fileConfig));
+ * rtc->replay(logger); // previous boot's last lines go to the file
+ * logger.addSink(std::move(rtc));
+ * @endcode
+ *
+ * Only one RtcLogSink may use a given ring. Records are stored formatted,
+ * so the sink reports supportsDeferred() == false.
+ */
+class RtcLogSink : public ILogSink
+{
+public:
+    /**
+     * @brief Attach to a ring and recover what it holds
+     * @param ring Ring storage; nullptr uses the built-in RTC_NOINIT ring
+     *        (tests pass their own to simulate a restart)
+     */
+    explicit RtcLogSink(RtcLogRing *ring = nullptr);
+
+    ~RtcLogSink() override = default;
+
+    RtcLogSink(const RtcLogSink &) = delete;
+    RtcLogSink &operator=(const RtcLogSink &) = delete;
+
+    void write(const LogMessage &msg) override;
+    void flush() override;
+    const char *getName() const override;
+
+    /**
+     * @brief Number of records from earlier boots still waiting for replay
+     */
+    size_t getRecoveredCount() const;
+
+    /**
+     * @brief Replay recovered records, oldest first, into the logger's sinks
+     *
+     * Writes a marker line, then each record with its original tag, level
+     * and timestamp. Records are replayed only once; writes made during
+     * replay (e.g. when this sink is already registered) are ignored.
+     *
+     * @param logger Logger whose sinks receive the records
+     * @return Number of records replayed
+     */
+    size_t replay(Logger &logger);
+
+    /**
+     * @brief Replay recovered records into a single sink
+     * @param sink Destination (its min level applies)
+     * @return Number of records replayed
+     */
+    size_t replay(ILogSink &sink);
+
+    /**
+     * @brief Check whether the ring held valid data at construction
+     * @return false if it was initialized from scratch (e.g. power-on reset)
+     */
+    bool wasRecovered() const
+    {
+        return recovered_;
+    }
+
+private:
+    uint32_t firstPendingSequence() const;
+
+    template<typename Write>
+    size_t replayRecords(Write &&write);
+
+    RtcLogRing *ring_;    ///< Backing storage
+    uint32_t boot_start_; ///< First sequence written by this boot
+    bool recovered_;      ///< Ring was valid at construction
+    bool replaying_;      ///< Ignore writes fed back during replay
+};
+
+} // namespace lopcore
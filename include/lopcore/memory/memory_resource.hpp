@@ -0,0 +1,316 @@
+/**
+ * @file memory_resource.hpp
+ * @brief Library-wide memory placement hooks built on std::pmr
+ *
+ * Every buffer LopCore allocates once and keeps (network buffers, TLS
+ * contexts, log write buffers) comes from one of two process-wide memory
+ * resources picked by role:
+ *
+ * - MemoryRole::HOT: small objects touched on every operation. Internal
+ *   SRAM by default.
+ * - MemoryRole::BULK: large buffers where capacity matters more than
+ *   latency. PSRAM when CONFIG_LOPCORE_MEMORY_BULK_PSRAM is set, else
+ *   internal SRAM.
+ *
+ * Swap either for any std::pmr::memory_resource before creating the
+ * objects that use it, e.g. a FixedBlockResource so per-connect
+ * allocations recycle the same blocks instead of fragmenting the heap:
+ *
+ * @code
+ * static lopcore::memory::FixedBlockResource tlsPool(2048, 4, lopcore::memory::internalResource());
+ * lopcore::memory::setResource(lopcore::memory::MemoryRole::HOT, &tlsPool);
+ * @endcode
+ *
+ * Resources in this file report exhaustion by throwing std::bad_alloc when
+ * exceptions are enabled and by returning nullptr otherwise. Buffer and
+ * makeUnique() handle both and return empty on failure.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace lopcore
+{
+namespace memory
+{
+
+/**
+ * @brief What an allocation is for, which decides where it is placed
+ */
+enum class MemoryRole : uint8_t
+{
+    HOT, ///< Small, frequently used objects (internal SRAM)
+    BULK ///< Large buffers (PSRAM when configured)
+};
+
+/**
+ * @brief Resource currently serving a role
+ */
+std::pmr::memory_resource *getResource(MemoryRole role);
+
+/**
+ * @brief Replace the resource serving a role
+ *
+ * Objects keep the resource they allocated from, so set this at startup
+ * before creating clients and sinks. The resource must outlive everything
+ * allocated from it.
+ *
+ * @param resource New resource, nullptr to restore the default
+ */
+void setResource(MemoryRole role, std::pmr::memory_resource *resource);
+
+/**
+ * @brief Heap allocation with ESP-IDF capabilities (MALLOC_CAP_*)
+ *
+ * On the host both capability sets map to malloc.
+ */
+class CapsResource : public std::pmr::memory_resource
+{
+public:
+    /**
+     * @param caps Capabilities tried first
+     * @param fallbackCaps Capabilities tried when caps are exhausted (0 = none)
+     */
+    explicit CapsResource(uint32_t caps, uint32_t fallbackCaps = 0) : caps_(caps), fallbackCaps_(fallbackCaps)
+    {
+    }
+
+protected:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+private:
+    uint32_t caps_;
+    uint32_t fallbackCaps_;
+};
+
+/**
+ * @brief Internal 8-bit capable SRAM
+ */
+std::pmr::memory_resource *internalResource();
+
+/**
+ * @brief PSRAM, falling back to internal SRAM when there is none or it is full
+ */
+std::pmr::memory_resource *psramResource();
+
+/**
+ * @brief Fixed number of equal blocks carved from upstream once
+ *
+ * Requests that fit a block are served from the free list in O(1) and
+ * never touch the heap again, so long uptimes cannot fragment it. Larger
+ * requests, or any request once every block is in use, go to upstream.
+ * Thread-safe.
+ */
+class FixedBlockResource : public std::pmr::memory_resource
+{
+public:
+    /**
+     * @param blockSize Usable bytes per block (rounded up to max_align_t)
+     * @param blocks Number of blocks
+     * @param upstream Source of the blocks and of requests that do not fit
+     */
+    FixedBlockResource(size_t blockSize, size_t blocks, std::pmr::memory_resource *upstream = internalResource());
+
+    ~FixedBlockResource() override;
+
+    FixedBlockResource(const FixedBlockResource &) = delete;
+    FixedBlockResource &operator=(const FixedBlockResource &) = delete;
+
+    size_t blockSize() const
+    {
+        return blockSize_;
+    }
+
+    size_t capacity() const
+    {
+        return blocks_;
+    }
+
+    /**
+     * @brief Blocks currently free
+     */
+    size_t available() const;
+
+    /**
+     * @brief Requests passed to upstream because they did not fit or the pool was empty
+     */
+    size_t overflows() const;
+
+protected:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    bool owns(const void *p) const
+    {
+        auto *byte = static_cast<const uint8_t *>(p);
+        return storage_ != nullptr && byte >= storage_ && byte < storage_ + blockSize_ * blocks_;
+    }
+
+    size_t blockSize_;                     ///< Bytes per block, aligned
+    size_t blocks_;                        ///< Blocks carved at construction
+    std::pmr::memory_resource *upstream_;  ///< Source of storage_ and overflows
+    uint8_t *storage_;                     ///< blocks_ contiguous blocks
+    mutable std::mutex mutex_;             ///< Guards the fields below
+    FreeBlock *freeList_;                  ///< Free blocks, most recently freed first
+    size_t available_;                     ///< Length of freeList_
+    size_t overflows_;                     ///< Requests sent upstream
+};
+
+/**
+ * @brief Allocate from a resource without throwing
+ * @return nullptr on failure
+ */
+void *tryAllocate(std::pmr::memory_resource *resource, size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+/**
+ * @brief Byte buffer allocated once from a memory resource
+ *
+ * Replaces std::vector<uint8_t> / unique_ptr<uint8_t[]> for fixed buffers
+ * whose placement matters. Move-only.
+ */
+class Buffer
+{
+public:
+    explicit Buffer(MemoryRole role = MemoryRole::BULK) : resource_(getResource(role))
+    {
+    }
+
+    explicit Buffer(std::pmr::memory_resource *resource) : resource_(resource)
+    {
+    }
+
+    ~Buffer()
+    {
+        release();
+    }
+
+    Buffer(Buffer &&other) noexcept
+        : resource_(other.resource_), data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0))
+    {
+    }
+
+    Buffer &operator=(Buffer &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            resource_ = other.resource_;
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    Buffer(const Buffer &) = delete;
+    Buffer &operator=(const Buffer &) = delete;
+
+    /**
+     * @brief Replace the contents with size uninitialized bytes (kept if the size is unchanged)
+     * @return false if the memory is not available (the buffer is then empty)
+     */
+    bool allocate(size_t size)
+    {
+        if (size == size_)
+        {
+            return true;
+        }
+        release();
+        if (size > 0)
+        {
+            data_ = static_cast<uint8_t *>(tryAllocate(resource_, size));
+            size_ = data_ != nullptr ? size : 0;
+        }
+        return size_ == size;
+    }
+
+    void release()
+    {
+        if (data_ != nullptr)
+        {
+            resource_->deallocate(data_, size_, alignof(std::max_align_t));
+            data_ = nullptr;
+            size_ = 0;
+        }
+    }
+
+    uint8_t *data()
+    {
+        return data_;
+    }
+
+    const uint8_t *data() const
+    {
+        return data_;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+private:
+    std::pmr::memory_resource *resource_;
+    uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+/**
+ * @brief Deleter returning an object to the resource it came from
+ */
+template <typename T> struct ResourceDeleter
+{
+    std::pmr::memory_resource *resource = nullptr;
+
+    void operator()(T *object) const
+    {
+        object->~T();
+        resource->deallocate(object, sizeof(T), alignof(T));
+    }
+};
+
+/**
+ * @brief Owning pointer to an object allocated by makeUnique()
+ */
+template <typename T> using UniquePtr = std::unique_ptr<T, ResourceDeleter<T>>;
+
+/**
+ * @brief Construct a T in the memory of role
+ * @return Empty pointer if the memory is not available
+ */
+template <typename T, typename... Args> UniquePtr<T> makeUnique(MemoryRole role, Args &&...args)
+{
+    std::pmr::memory_resource *resource = getResource(role);
+    void *memory = tryAllocate(resource, sizeof(T), alignof(T));
+    if (memory == nullptr)
+    {
+        return UniquePtr<T>(nullptr, ResourceDeleter<T>{resource});
+    }
+    return UniquePtr<T>(new (memory) T(std::forward<Args>(args)...), ResourceDeleter<T>{resource});
+}
+
+} // namespace memory
+} // namespace lopcore
@@ -0,0 +1,223 @@
+/**
+ * @file metrics_exporter.hpp
+ * @brief Periodic publisher of the metrics registry over MQTT
+ *
+ * Every interval the exporter snapshots a MetricsRegistry and publishes
+ * what changed as one CBOR message. Counters and histogram buckets are
+ * sent as their increase since the last export that went out, so a lost
+ * interval is folded into the next one and nothing that did not move is
+ * sent at all. Two layouts are supported:
+ *
+ * - Format::COMPACT on MetricsExporterConfig::topic:
+ *   {"v":1, "s":seq, "t":uptime_s, "c":{name:delta}, "g":{name:value},
+ *    "h":{name:[count, sum, max since boot, bucket deltas...]}}, empty
+ *   sections left out.
+ * - Format::DEVICE_DEFENDER on $aws/things/<thing>/defender/metrics/cbor as
+ *   AWS IoT Device Defender custom metrics ("cmet"): counters and gauges as
+ *   number, histograms as number_list of bucket deltas. The custom metrics
+ *   must be defined in the account under the same names.
+ *
+ * @code
+ * MetricsExporterConfig config;
+ * config.topic = "fleet/sensor-42/metrics";
+ * MetricsExporter exporter(mqttClient, config);
+ * exporter.start(); // Low-priority task; or call exporter.poll() from a loop
+ * @endcode
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <esp_err.h>
+#include <esp_timer.h>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <condition_variable>
+#include <thread>
+#endif
+
+#include "lopcore/metrics/metrics_registry.hpp"
+#include "lopcore/mqtt/imqtt_client.hpp"
+#include "lopcore/task/task_profile.hpp"
+
+namespace lopcore
+{
+namespace metrics
+{
+
+/**
+ * @brief MetricsExporter configuration
+ */
+struct MetricsExporterConfig
+{
+    enum class Format : uint8_t
+    {
+        COMPACT,        ///< LopCore CBOR layout on topic
+        DEVICE_DEFENDER ///< Device Defender custom metrics report for thingName
+    };
+
+    Format format{Format::COMPACT};                 ///< Message layout
+    std::string topic;                              ///< COMPACT: topic to publish on
+    std::string thingName;                          ///< DEVICE_DEFENDER: thing the report is for
+    uint32_t intervalMs{300000};                    ///< Time between exports
+    bool skipUnchanged{true};                       ///< Leave out gauges equal to their last exported value
+    size_t maxPayloadSize{1024};                    ///< Encode buffer, allocated once
+    mqtt::MqttQos qos{mqtt::MqttQos::AT_MOST_ONCE}; ///< Publish QoS
+    /// Export task stack size in bytes (default from the task profile)
+    uint32_t stackSize{task::getSettings(task::TaskRole::METRICS_EXPORT).stackSize};
+    /// Export task priority, low as exports can wait (default from the task profile)
+    uint32_t priority{task::getSettings(task::TaskRole::METRICS_EXPORT).priority};
+
+    esp_err_t validate() const
+    {
+        bool hasTarget = format == Format::COMPACT ? !topic.empty() : !thingName.empty();
+        if (!hasTarget || intervalMs == 0 || maxPayloadSize < 32 || stackSize < 2048 || priority > 24)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        return ESP_OK;
+    }
+};
+
+/**
+ * @brief Exporter counters
+ */
+struct MetricsExporterStats
+{
+    uint32_t exports{0};        ///< Messages published
+    uint32_t failures{0};       ///< Publishes the client refused (retried next interval)
+    uint32_t skipped{0};        ///< Intervals with nothing to send
+    uint32_t truncated{0};      ///< Exports that did not fit maxPayloadSize (metrics left for later)
+    uint32_t bytesPublished{0}; ///< Payload bytes sent
+};
+
+/**
+ * @brief Publishes registry snapshots on a schedule
+ *
+ * Thread-safe. The registry and client must outlive the exporter.
+ */
+class MetricsExporter
+{
+public:
+    /**
+     * @brief Monotonic time source in microseconds
+     */
+    using TimeSource = int64_t (*)();
+
+    MetricsExporter(std::shared_ptr<mqtt::IMqttClient> client,
+                    const MetricsExporterConfig &config,
+                    MetricsRegistry &registry = MetricsRegistry::instance(),
+                    TimeSource timeSource = esp_timer_get_time);
+
+    /**
+     * @brief Stops the export task
+     */
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter &) = delete;
+    MetricsExporter &operator=(const MetricsExporter &) = delete;
+
+    /**
+     * @brief Export from a task of its own at config.priority
+     * @return ESP_OK, ESP_ERR_INVALID_STATE if running, ESP_ERR_INVALID_ARG
+     *         for an invalid configuration, ESP_FAIL if the task was not created
+     */
+    esp_err_t start();
+
+    void stop();
+
+    /**
+     * @brief Export if the interval has passed
+     * @return Milliseconds until the next export is due
+     */
+    uint32_t poll();
+
+    /**
+     * @brief Export now and restart the interval
+     * @return ESP_OK if sent or nothing changed, ESP_ERR_INVALID_SIZE if
+     *         nothing fit the payload buffer, otherwise the client's error
+     */
+    esp_err_t exportNow();
+
+    MetricsExporterStats getStats() const;
+
+private:
+    /**
+     * @brief Last exported state of one metric, indexed by MetricView::id
+     */
+    struct Baseline
+    {
+        bool exported{false};
+        int64_t value{0};
+        HistogramSnapshot histogram;
+    };
+
+    /**
+     * @brief A metric to send in the export being built
+     */
+    struct Item
+    {
+        size_t id{0};
+        MetricType type{MetricType::COUNTER};
+        std::string name; ///< Reused across exports, so steady state does not allocate
+        int64_t value{0};
+        int64_t delta{0};
+        HistogramSnapshot histogram;
+    };
+
+    /**
+     * @brief Collect changed metrics into items_
+     * @return Number of items
+     */
+    size_t collect();
+
+    /**
+     * @brief Encode the first count items
+     * @return Bytes written, 0 if they do not fit
+     */
+    size_t encode(size_t count);
+
+    esp_err_t exportLocked();
+
+    static void taskEntry(void *arg);
+    void runTask();
+
+    std::shared_ptr<mqtt::IMqttClient> client_; ///< Where exports go
+    const MetricsExporterConfig config_;        ///< Configuration
+    MetricsRegistry &registry_;                 ///< What is exported
+    const TimeSource timeSource_;               ///< Monotonic clock
+    std::string topic_;                         ///< Resolved publish topic
+
+    mutable std::mutex mutex_;        ///< Guards everything below
+    std::vector<uint8_t> buffer_;     ///< Encode buffer (maxPayloadSize)
+    std::vector<Item> items_;         ///< Export being built
+    std::vector<Baseline> baselines_; ///< Last exported values by metric ID
+    int64_t dueUs_;                   ///< Next scheduled export
+    uint32_t sequence_;               ///< Exports sent
+    MetricsExporterStats stats_;      ///< Counters
+
+    std::atomic<bool> running_; ///< Export task should keep running
+#ifdef ESP_PLATFORM
+    TaskHandle_t task_;         ///< Export task
+    std::atomic<bool> stopped_; ///< Export task has exited
+#else
+    std::thread thread_;           ///< Export thread
+    std::condition_variable wake_; ///< Wakes the export thread on stop()
+#endif
+};
+
+} // namespace metrics
+} // namespace lopcore
@@ -0,0 +1,318 @@
+/**
+ * @file metrics_registry.hpp
+ * @brief Process-wide registry of counters, gauges and histograms
+ *
+ * Modules register named metrics once and update them on hot paths with
+ * relaxed 32-bit atomics (64-bit atomics take a lock on Xtensa). Values
+ * a module already keeps can be registered as sampled metrics instead,
+ * read only when a snapshot is taken. MetricsExporter publishes the
+ * registry on a schedule.
+ *
+ * @code
+ * auto &registry = lopcore::metrics::MetricsRegistry::instance();
+ * static auto &writes = registry.counter("storage.writes");
+ * static auto &latency = registry.histogram("storage.write_us", {100, 1000, 10000, 100000});
+ * writes.add();
+ * latency.record(elapsedUs);
+ *
+ * // Sampled while the registration is alive
+ * auto budget = registry.sampledGauge("mqtt.budget", [&] { return mqttBudget.getRemaining(); });
+ * @endcode
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lopcore
+{
+namespace metrics
+{
+
+enum class MetricType : uint8_t
+{
+    COUNTER,  ///< Monotonic count, exported as the increase since the last export
+    GAUGE,    ///< Current level, exported as is
+    HISTOGRAM ///< Distribution over fixed buckets, exported as the increase per bucket
+};
+
+/**
+ * @brief Monotonic event count; wraps at 2^32, which exported deltas tolerate
+ */
+class Counter
+{
+public:
+    void add(uint32_t amount = 1)
+    {
+        value_.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    uint32_t value() const
+    {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint32_t> value_{0};
+};
+
+/**
+ * @brief Level that goes up and down (queue depth, free heap)
+ */
+class Gauge
+{
+public:
+    void set(int32_t value)
+    {
+        value_.store(value, std::memory_order_relaxed);
+    }
+
+    void add(int32_t amount)
+    {
+        value_.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    int32_t value() const
+    {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int32_t> value_{0};
+};
+
+/// Most buckets a histogram has, the overflow bucket included
+constexpr size_t MAX_HISTOGRAM_BUCKETS = 16;
+
+/**
+ * @brief Point-in-time copy of a histogram
+ */
+struct HistogramSnapshot
+{
+    uint32_t count{0};                                     ///< Samples recorded
+    uint32_t sum{0};                                       ///< Sum of samples (wraps)
+    uint32_t max{0};                                       ///< Largest sample
+    size_t buckets{0};                                     ///< Buckets in use
+    std::array<uint32_t, MAX_HISTOGRAM_BUCKETS> counts{}; ///< Samples per bucket
+};
+
+/**
+ * @brief Distribution over buckets fixed at registration
+ *
+ * Bucket i counts samples <= bounds[i] (and above bounds[i-1]); the last
+ * bucket counts everything above the highest bound.
+ */
+class Histogram
+{
+public:
+    /**
+     * @param bounds Ascending upper bounds, at most MAX_HISTOGRAM_BUCKETS - 1 (extra ones are ignored)
+     */
+    explicit Histogram(std::initializer_list<uint32_t> bounds);
+
+    void record(uint32_t value);
+
+    HistogramSnapshot snapshot() const;
+
+    size_t bucketCount() const
+    {
+        return bounds_.size() + 1;
+    }
+
+    /**
+     * @brief Upper bound of bucket i (UINT32_MAX for the overflow bucket)
+     */
+    uint32_t bound(size_t i) const
+    {
+        return i < bounds_.size() ? bounds_[i] : UINT32_MAX;
+    }
+
+private:
+    std::vector<uint32_t> bounds_;
+    std::array<std::atomic<uint32_t>, MAX_HISTOGRAM_BUCKETS> counts_{};
+    std::atomic<uint32_t> count_{0};
+    std::atomic<uint32_t> sum_{0};
+    std::atomic<uint32_t> max_{0};
+};
+
+class MetricsRegistry;
+
+/**
+ * @brief Keeps a sampled metric registered; removes it when destroyed
+ */
+class Registration
+{
+public:
+    Registration() = default;
+
+    Registration(MetricsRegistry *registry, size_t id) : registry_(registry), id_(id)
+    {
+    }
+
+    ~Registration()
+    {
+        reset();
+    }
+
+    Registration(Registration &&other) noexcept : registry_(other.registry_), id_(other.id_)
+    {
+        other.registry_ = nullptr;
+    }
+
+    Registration &operator=(Registration &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            registry_ = other.registry_;
+            id_ = other.id_;
+            other.registry_ = nullptr;
+        }
+        return *this;
+    }
+
+    Registration(const Registration &) = delete;
+    Registration &operator=(const Registration &) = delete;
+
+    /**
+     * @brief Remove the metric now
+     */
+    void reset();
+
+    explicit operator bool() const
+    {
+        return registry_ != nullptr;
+    }
+
+private:
+    MetricsRegistry *registry_ = nullptr;
+    size_t id_ = 0;
+};
+
+/**
+ * @brief One metric as seen by MetricsRegistry::forEach()
+ */
+struct MetricView
+{
+    size_t id;                  ///< Stable for the metric's lifetime, never reused
+    std::string_view name;      ///< Registered name
+    MetricType type;            ///< Kind of metric
+    bool sampled;               ///< Read from a sampler (64-bit totals) rather than a Counter/Gauge
+    int64_t value;              ///< Counter or gauge value (0 for histograms)
+    const Histogram *histogram; ///< The histogram, nullptr for other types
+};
+
+/**
+ * @brief Named metrics of the whole process
+ *
+ * Registration allocates and takes a lock; updates never do. Metrics
+ * created with counter(), gauge() and histogram() live as long as the
+ * registry, so the returned references can be cached.
+ */
+class MetricsRegistry
+{
+public:
+    /**
+     * @param capacity Most metrics registered at once
+     */
+    explicit MetricsRegistry(size_t capacity = 64) : capacity_(capacity)
+    {
+    }
+
+    MetricsRegistry(const MetricsRegistry &) = delete;
+    MetricsRegistry &operator=(const MetricsRegistry &) = delete;
+
+    /**
+     * @brief The registry modules register into
+     */
+    static MetricsRegistry &instance();
+
+    /**
+     * @brief Counter of this name, created on first use
+     *
+     * If the name is taken by another type, or the registry is full, the
+     * returned counter is a shared scratch instance that is never exported.
+     */
+    Counter &counter(std::string_view name);
+
+    /**
+     * @brief Gauge of this name, created on first use (see counter())
+     */
+    Gauge &gauge(std::string_view name);
+
+    /**
+     * @brief Histogram of this name, created on first use with these bounds (see counter())
+     */
+    Histogram &histogram(std::string_view name, std::initializer_list<uint32_t> bounds);
+
+    /**
+     * @brief Counter read from sampler when a snapshot is taken (a total the module already keeps)
+     * @return Registration that removes the metric; empty if the name is taken or the registry is full
+     */
+    Registration sampledCounter(std::string_view name, std::function<uint64_t()> sampler);
+
+    /**
+     * @brief Gauge read from sampler when a snapshot is taken
+     * @return Registration that removes the metric; empty if the name is taken or the registry is full
+     */
+    Registration sampledGauge(std::string_view name, std::function<int64_t()> sampler);
+
+    /**
+     * @brief Visit every metric, in registration order
+     *
+     * Samplers run inside; they must not register metrics.
+     */
+    void forEach(const std::function<void(const MetricView &)> &fn) const;
+
+    size_t size() const;
+
+    size_t capacity() const
+    {
+        return capacity_;
+    }
+
+private:
+    friend class Registration;
+
+    struct Entry
+    {
+        std::string name;
+        MetricType type;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        std::function<int64_t()> sampler;
+    };
+
+    /**
+     * @brief Entry of this name, or a new one if there is room (caller holds mutex_)
+     * @param created Set when the entry was added
+     */
+    Entry *findOrAdd(std::string_view name, MetricType type, bool *created);
+
+    void remove(size_t id);
+
+    size_t capacity_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Entry>> entries_; ///< Indexed by id; removed entries are nullptr
+    size_t live_ = 0;                             ///< Non-null entries
+    Counter scratchCounter_;                      ///< Returned when registration fails
+    Gauge scratchGauge_;
+    Histogram scratchHistogram_{};
+};
+
+} // namespace metrics
+} // namespace lopcore
@@ -0,0 +1,362 @@
+/**
+ * @file coremqtt_agent_client.hpp
+ * @brief Multi-task MQTT client built on the AWS coreMQTT-Agent library
+ *
+ * CoreMqttClient serializes every caller and its process loop on one
+ * mutex around the MQTT context. Here a single agent task owns the
+ * connection and runs the MQTT loop; application tasks hand it publish,
+ * subscribe and unsubscribe commands through a FreeRTOS queue and block
+ * only on their own command, so a slow publish from one task never holds
+ * up another.
+ *
+ * Pick it with MqttClientType::AWS_IOT_AGENT (the default when
+ * CONFIG_LOPCORE_MQTT_AGENT_PREFERRED is set). The command queue, command
+ * pool and agent task are sized by the LOPCORE_MQTT_AGENT_* Kconfig
+ * options.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#ifndef LOPCORE_MQTT_COREMQTT_AGENT_CLIENT_HPP
+#define LOPCORE_MQTT_COREMQTT_AGENT_CLIENT_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef ESP_PLATFORM
+#include <thread>
+#endif
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "lopcore/memory/memory_resource.hpp"
+#include "lopcore/mqtt/mqtt_budget.hpp"
+#include "lopcore/mqtt/mqtt_config.hpp"
+#include "lopcore/mqtt/mqtt_dispatcher.hpp"
+#include "lopcore/mqtt/mqtt_metrics.hpp"
+#include "lopcore/mqtt/mqtt_types.hpp"
+#include "lopcore/mqtt/topic_trie.hpp"
+#include "lopcore/tls/network_context.h"
+
+// coreMQTT-Agent headers
+extern "C" {
+#include "core_mqtt.h"
+#include "core_mqtt_agent.h"
+#include "transport_interface.h"
+}
+
+namespace lopcore
+{
+namespace tls
+{
+class ITlsTransport;
+}
+
+namespace mqtt
+{
+
+/**
+ * @brief coreMQTT-Agent based MQTT client for many publishing tasks
+ *
+ * Features:
+ * - One agent task owns the connection, keep-alive and QoS state
+ * - publish(), subscribe() and unsubscribe() from any task, queued to the
+ *   agent without a shared lock; the caller waits only for its own command
+ * - Zero-copy publish: the agent reads the caller's topic and payload,
+ *   which stay valid because the caller waits for completion
+ * - Wildcard subscriptions, optional callback workers (MqttConfig::dispatch)
+ * - Message budgeting and background reconnect with resubscription
+ *
+ * Thread Safety:
+ * - Every public method may be called from any task except the agent task
+ * - Subscription callbacks run on the agent task unless dispatch workers
+ *   are configured; a callback that publishes needs dispatch workers,
+ *   since the agent cannot wait for a command it has yet to run
+ *
+ * @code
+ * auto client = std::make_unique<CoreMqttAgentClient>(mqttConfig, tlsTransport);
+ * client->connect();
+ * // From any number of tasks:
+ * client->publish("sensors/temp", payload, MqttQos::AT_LEAST_ONCE);
+ * @endcode
+ */
+class CoreMqttAgentClient
+{
+public:
+    /**
+     * @brief Construct the client on a connected transport
+     *
+     * @param config MQTT configuration
+     * @param transport TLS transport, already connected
+     */
+    CoreMqttAgentClient(const MqttConfig &config, std::shared_ptr<lopcore::tls::ITlsTransport> transport);
+
+    /**
+     * @brief Disconnect and stop the agent task
+     */
+    ~CoreMqttAgentClient();
+
+    CoreMqttAgentClient(const CoreMqttAgentClient &) = delete;
+    CoreMqttAgentClient &operator=(const CoreMqttAgentClient &) = delete;
+
+    // =============================================================================
+    // Core MQTT Operations
+    // =============================================================================
+
+    /**
+     * @brief Send CONNECT, then start the agent task
+     *
+     * @return ESP_OK on success, ESP_ERR_INVALID_STATE if the transport is
+     *         not connected, ESP_FAIL if CONNECT failed or the task could not start
+     */
+    esp_err_t connect();
+
+    /**
+     * @brief Send DISCONNECT through the agent and stop its task
+     *
+     * Commands still queued or awaiting an acknowledgement complete with
+     * an error.
+     */
+    esp_err_t disconnect();
+
+    bool isConnected() const;
+
+    /**
+     * @brief Publish and wait until the agent has sent it (QoS 0) or it is acknowledged (QoS 1/2)
+     *
+     * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not connected or
+     *         called from the agent task, ESP_ERR_NO_MEM if the command queue
+     *         or pool stays full or the budget is exhausted, ESP_FAIL on error
+     */
+    esp_err_t publish(const std::string &topic,
+                      const std::vector<uint8_t> &payload,
+                      MqttQos qos = MqttQos::AT_MOST_ONCE,
+                      bool retain = false);
+
+    esp_err_t publishString(const std::string &topic,
+                            const std::string &payload,
+                            MqttQos qos = MqttQos::AT_MOST_ONCE,
+                            bool retain = false);
+
+    /**
+     * @brief Publish a payload made of several buffers
+     *
+     * coreMQTT-Agent keeps one payload pointer per command, so more than
+     * one segment is gathered into a buffer first.
+     */
+    esp_err_t publish(std::string_view topic,
+                      const MqttPayloadSegment *segments,
+                      size_t segmentCount,
+                      MqttQos qos = MqttQos::AT_MOST_ONCE,
+                      bool retain = false);
+
+    /**
+     * @brief Subscribe and wait for the SUBACK
+     *
+     * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a malformed filter,
+     *         ESP_ERR_INVALID_STATE if not connected, ESP_FAIL if refused
+     */
+    esp_err_t subscribe(const std::string &topic,
+                        MessageCallback callback,
+                        MqttQos qos = MqttQos::AT_MOST_ONCE);
+
+    /**
+     * @brief Subscribe with a callback that receives messages without copying
+     *
+     * The view points into the agent's network buffer and is valid only
+     * until the callback returns.
+     */
+    esp_err_t subscribeView(const std::string &topic,
+                            MessageViewCallback callback,
+                            MqttQos qos = MqttQos::AT_MOST_ONCE);
+
+    /**
+     * @brief Unsubscribe and wait for the UNSUBACK
+     */
+    esp_err_t unsubscribe(const std::string &topic);
+
+    /**
+     * @brief Not supported: set the will in MqttConfig before connect()
+     */
+    esp_err_t setWillMessage(const std::string &topic,
+                             const std::vector<uint8_t> &payload,
+                             MqttQos qos = MqttQos::AT_MOST_ONCE,
+                             bool retain = false);
+
+    void setConnectionCallback(ConnectionCallback callback);
+    void setErrorCallback(ErrorCallback callback);
+
+    MqttStatistics getStatistics() const;
+
+    /**
+     * @brief Counters and latency histograms, read without locking
+     *
+     * Publish latency is measured from queueing the command to its
+     * completion, which includes the wait for PUBACK/PUBCOMP.
+     */
+    MqttMetricsSnapshot getMetrics() const;
+
+    void resetStatistics();
+
+    // =============================================================================
+    // Accessors (no virtual - plain getters)
+    // =============================================================================
+
+    MqttConnectionState getConnectionState() const
+    {
+        return state_;
+    }
+    std::string getClientId() const
+    {
+        return config_.clientId;
+    }
+    std::string getBroker() const
+    {
+        return config_.broker;
+    }
+    uint16_t getPort() const
+    {
+        return config_.port;
+    }
+
+private:
+    /**
+     * @brief Subscription record
+     */
+    struct Subscription
+    {
+        std::string topic;
+        MqttQos qos;
+        MqttHandlerPtr handler; ///< Callbacks (shared with queued dispatches)
+    };
+
+    /**
+     * @brief NetworkContext_t followed by the owning client, for the transport callbacks
+     *
+     * NetworkContext_t::client names CoreMqttClient; this keeps that
+     * header untouched. context must stay the first member.
+     */
+    struct AgentNetworkContext
+    {
+        NetworkContext_t context;
+        CoreMqttAgentClient *client;
+    };
+
+    /**
+     * @brief Shared body of subscribe() and subscribeView()
+     */
+    esp_err_t addSubscription(const std::string &topic,
+                              MessageCallback callback,
+                              MessageViewCallback viewCallback,
+                              MqttQos qos);
+
+    /**
+     * @brief Commands may be queued: connected, and not on the agent task
+     */
+    esp_err_t checkCaller(const char *operation) const;
+
+    /**
+     * @brief Whether the agent task was started and not yet stopped by disconnect()
+     */
+    bool agentRunning() const;
+
+    /**
+     * @brief Whether the caller is the agent task
+     */
+    bool onAgentTask() const;
+
+    /**
+     * @brief Send CONNECT on the agent's context; the agent task must not be in its command loop
+     */
+    esp_err_t sendConnect();
+
+    /**
+     * @brief Queue SUBSCRIBE for every recorded filter, without waiting
+     *
+     * Runs after a new (not resumed) session; the agent sends the packets
+     * once its command loop runs.
+     */
+    void resubscribeAll();
+
+    /**
+     * @brief Mark the connection down and tell the application
+     */
+    void handleConnectionLost(MQTTStatus_t status);
+
+    /**
+     * @brief Whether a lost connection is re-established by the agent task
+     */
+    bool canReconnect() const;
+
+    /**
+     * @brief Reconnect the transport and resend CONNECT (agent task)
+     * @return true once connected again
+     */
+    bool reconnect();
+
+    /**
+     * @brief Deliver an incoming PUBLISH to matching subscriptions (agent task)
+     */
+    void handleIncomingPublish(uint16_t packetId, MQTTPublishInfo_t *publishInfo);
+
+    void agentTask();
+    static void agentTaskWrapper(void *pvParameters);
+
+    static void incomingPublishCallback(MQTTAgentContext_t *agentContext,
+                                        uint16_t packetId,
+                                        MQTTPublishInfo_t *publishInfo);
+    static int32_t transportSend(NetworkContext_t *pNetworkContext, const void *pBuffer, size_t bytesToSend);
+    static int32_t transportRecv(NetworkContext_t *pNetworkContext, void *pBuffer, size_t bytesToRecv);
+    static uint32_t getTimeMs();
+
+    // =============================================================================
+    // Member Variables
+    // =============================================================================
+
+    MqttConfig config_;                                         ///< Configuration
+    std::shared_ptr<lopcore::tls::ITlsTransport> tlsTransport_; ///< TLS transport
+    AgentNetworkContext networkContext_;                        ///< Transport context with back-reference
+    TransportInterface_t transport_;                            ///< Transport interface
+    MQTTAgentContext_t agent_;                                  ///< coreMQTT-Agent context (agent task only
+                                                                ///< once the task runs)
+    MQTTAgentMessageInterface_t messageInterface_;              ///< Command queue and pool
+    MQTTAgentMessageContext_t *messageContext_;                 ///< Holds the command queue
+    memory::Buffer networkBuffer_;                              ///< Network buffer (MemoryRole::BULK)
+    bool initialized_;                                          ///< Agent initialized by the constructor
+    std::unique_ptr<MqttBudget> budget_;                        ///< Message budgeting (lock-free)
+    std::unique_ptr<MqttDispatcher> dispatcher_;                ///< Callback worker pool (if enabled)
+    TopicTrie<Subscription> subscriptions_;                     ///< Active subscriptions by filter
+    mutable std::mutex subscriptionsMutex_;                     ///< Protects subscriptions_
+    std::vector<MqttHandlerPtr> dispatchHandlers_;              ///< Matches of the message being delivered
+                                                                ///< (agent task only)
+    std::vector<std::string> resubscribeTopics_;                ///< Filters of queued resubscriptions
+    std::vector<MQTTSubscribeInfo_t> resubscribeInfo_;          ///< SUBSCRIBE entries read by the agent
+    std::vector<MQTTAgentSubscribeArgs_t> resubscribeArgs_;     ///< One per resubscription command
+    std::atomic<uint32_t> resubscribesPending_;                 ///< Resubscription commands not yet complete
+    std::atomic<MqttConnectionState> state_;                    ///< Connection state
+    ConnectionCallback connectionCallback_;                     ///< Connection callback
+    ErrorCallback errorCallback_;                               ///< Error callback
+    mutable std::mutex callbackMutex_;                          ///< Protects the two callbacks
+    MqttStatistics statistics_;                                 ///< Connection times and subscription count
+    mutable std::mutex statisticsMutex_;                        ///< Protects statistics_
+    MqttMetrics metrics_;                                       ///< Lock-free counters and latency histograms
+#ifdef ESP_PLATFORM
+    TaskHandle_t agentTask_;                                    ///< Agent task, nullptr when stopped
+    SemaphoreHandle_t taskStoppedSemaphore_;                    ///< Given by the agent task as it exits
+#else
+    std::thread agentThread_;                                   ///< Host agent thread, joined by disconnect()
+    std::atomic<std::thread::id> agentThreadId_;                ///< Set by the agent thread as it starts
+#endif
+    std::atomic<bool> stopping_;                                ///< disconnect() in progress
+};
+
+} // namespace mqtt
+} // namespace lopcore
+
+#endif // LOPCORE_MQTT_COREMQTT_AGENT_CLIENT_HPP
@@ -21,17 +21,28 @@
 #define LOPCORE_MQTT_COREMQTT_CLIENT_HPP
 
 #include <atomic>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <string_view>
 #include <vector>
 
 #include <esp_timer.h>
 
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
+#include "lopcore/memory/memory_resource.hpp"
 #include "lopcore/mqtt/mqtt_budget.hpp"
+#include "lopcore/mqtt/mqtt_budget_scheduler.hpp"
 #include "lopcore/mqtt/mqtt_config.hpp"
+#include "lopcore/mqtt/mqtt_dispatcher.hpp"
+#include "lopcore/mqtt/mqtt_metrics.hpp"
+#include "lopcore/mqtt/mqtt_retransmit_store.hpp"
+#include "lopcore/mqtt/mqtt_spool.hpp"
+#include "lopcore/mqtt/mqtt_topic_table.hpp"
 #include "lopcore/mqtt/mqtt_types.hpp"
+#include "lopcore/mqtt/topic_trie.hpp"
 
 // Forward declarations for TLS transport
 namespace lopcore
@@ -67,6 +78,24 @@ namespace lopcore
 namespace mqtt
 {
 
+/**
+ * @brief Identifies a publishAsync() request (0 is never a valid handle)
+ */
+using PublishHandle = uint32_t;
+
+/**
+ * @brief Completion callback for publishAsync()
+ *
+ * Invoked from the context that runs processLoop() (normally the ProcessLoop
+ * task) or disconnect(), without the client lock held, so it may publish again.
+ *
+ * @param handle Handle returned by publishAsync()
+ * @param result ESP_OK when sent (QoS 0), acknowledged by PUBACK (QoS 1) or
+ *               PUBCOMP (QoS 2); ESP_ERR_INVALID_STATE if the connection was
+ *               lost first; ESP_FAIL if the send failed
+ */
+using PublishCompleteCallback = std::function<void(PublishHandle handle, esp_err_t result)>;
+
 /**
  * @brief coreMQTT-based standalone MQTT client
  *
@@ -80,6 +109,8 @@ namespace mqtt
  * - Automatic background processing (optional ProcessLoop task)
  * - Minimal memory footprint (~5 KB RAM)
  * - Transport abstraction (TLS + PKCS#11)
+ * - Optional flash spool for publishes made while offline (MqttConfig::spool)
+ * - Background reconnect with jittered backoff (MqttConfig::reconnect, needs MqttConfig::tls)
  *
  * Architecture:
  * - Polling-based: Application calls processLoop() to handle network I/O
@@ -95,6 +126,8 @@ namespace mqtt
  * Thread Safety:
  * - Methods are thread-safe via mutex
  * - processLoop() must be called regularly (manually or via background task)
+ * - processLoop() waits for socket data without the mutex and holds it only
+ *   while handling one packet, so publish() is not blocked by the poll timeout
  */
 class CoreMqttClient
 {
@@ -150,12 +183,100 @@ public:
                             MqttQos qos = MqttQos::AT_MOST_ONCE,
                             bool retain = false);
 
+    /**
+     * @brief Publish a payload made of several buffers without concatenating them
+     *
+     * The segments are sent back to back as one payload. QoS 0 publishes
+     * are written straight from the segments through ITlsTransport::sendv().
+     * QoS 1/2 publishes go through coreMQTT, which tracks one payload
+     * pointer for retransmission, so their segments are gathered into a
+     * reusable buffer first (no allocation once it has grown).
+     *
+     * With MqttConfig::spool enabled, a publish made while disconnected (or
+     * while older spooled records are still draining) is appended to the
+     * spool and ESP_OK is returned; processLoop() sends it later.
+     *
+     * @param topic Topic name
+     * @param segments Payload pieces, in order (kept alive until return)
+     * @param segmentCount Number of segments
+     * @param qos Quality of Service level
+     * @param retain Retained message flag
+     * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not connected,
+     *         ESP_ERR_NO_MEM if the budget is exhausted, ESP_FAIL on error
+     */
+    esp_err_t publish(std::string_view topic,
+                      const MqttPayloadSegment *segments,
+                      size_t segmentCount,
+                      MqttQos qos = MqttQos::AT_MOST_ONCE,
+                      bool retain = false);
+
+    /**
+     * @brief Intern a topic for publish(TopicHandle, ...)
+     *
+     * MQTT 3.1.1 has no topic aliases, so the full topic still goes on the
+     * wire; the handle saves building a topic string for every publish.
+     *
+     * @return Invalid handle if MqttConfig::topicTableSize topics are already registered
+     */
+    TopicHandle registerTopic(std::string_view topic);
+
+    /**
+     * @brief Topic registered under a handle (empty if unknown)
+     */
+    std::string_view topicName(TopicHandle topic) const;
+
+    /**
+     * @brief Publish on an interned topic
+     * @return ESP_ERR_INVALID_ARG if the handle is unknown, otherwise as publish()
+     */
+    esp_err_t publish(TopicHandle topic,
+                      const MqttPayloadSegment *segments,
+                      size_t segmentCount,
+                      MqttQos qos = MqttQos::AT_MOST_ONCE,
+                      bool retain = false);
+
     esp_err_t subscribe(const std::string &topic,
                         MessageCallback callback,
                         MqttQos qos = MqttQos::AT_MOST_ONCE);
 
+    /**
+     * @brief Subscribe with a callback that receives messages without copying
+     *
+     * The view points into the coreMQTT network buffer and is valid only
+     * until the callback returns; call MqttMessageView::toMessage() to keep it.
+     *
+     * @param topic Topic filter
+     * @param callback Invoked for each message received on topic
+     * @param qos Maximum QoS level
+     * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not connected, ESP_FAIL on error
+     */
+    esp_err_t subscribeView(const std::string &topic,
+                            MessageViewCallback callback,
+                            MqttQos qos = MqttQos::AT_MOST_ONCE);
+
     esp_err_t unsubscribe(const std::string &topic);
 
+    /**
+     * @brief Subscribe to several topic filters with as few SUBSCRIBE packets as possible
+     *
+     * Filters are packed up to MqttConfig::maxTopicsPerSubscribe per packet
+     * and within MqttConfig::networkBufferSize. Filters already subscribed
+     * are skipped. Every filter is validated before anything is sent.
+     *
+     * @param requests Filters with their QoS and callbacks
+     * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not connected,
+     *         ESP_ERR_INVALID_ARG if a filter is malformed, ESP_FAIL if a
+     *         packet could not be sent (filters in earlier packets stay subscribed)
+     */
+    esp_err_t subscribeMany(const std::vector<MqttSubscribeRequest> &requests);
+
+    /**
+     * @brief Unsubscribe from several topic filters with as few UNSUBSCRIBE packets as possible
+     * @param topics Topic filters exactly as subscribed
+     * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not connected, ESP_FAIL on error
+     */
+    esp_err_t unsubscribeMany(const std::vector<std::string> &topics);
+
     esp_err_t setWillMessage(const std::string &topic,
                              const std::vector<uint8_t> &payload,
                              MqttQos qos = MqttQos::AT_MOST_ONCE,
@@ -165,8 +286,70 @@ public:
     void setErrorCallback(ErrorCallback callback);
 
     MqttStatistics getStatistics() const;
+
+    /**
+     * @brief Counters and latency histograms, read without locking
+     *
+     * Covers QoS 1/2 publish-to-ack latency, the time spent delivering each
+     * inbound message and each process loop iteration. Cheap enough to take
+     * periodically and publish with MqttMetricsSnapshot::formatJson().
+     */
+    MqttMetricsSnapshot getMetrics() const;
+
+    /**
+     * @brief Expose the client's metrics and budgets in a metrics registry
+     *
+     * Registers the MqttMetrics counters under prefix, the global budget as
+     * prefix + ".budget.remaining" and each budget class as prefix +
+     * ".budget." + class name + ".remaining". They are removed with the
+     * client. Call once, before the client is shared between tasks.
+     */
+    void registerMetrics(metrics::MetricsRegistry &registry, std::string_view prefix);
+
     void resetStatistics();
 
+    // =============================================================================
+    // Asynchronous Publish
+    // =============================================================================
+
+    /**
+     * @brief Queue a publish and return without waiting for the network
+     *
+     * The request is copied into one of MqttConfig::publishQueueDepth
+     * pre-allocated slots and sent straight away; if coreMQTT's QoS records
+     * are all in use, processLoop() sends it once an acknowledgement frees
+     * one. The slot is released, and onComplete invoked, once the publish
+     * completes, so one task can keep several QoS 1 publishes in flight
+     * instead of waiting for each acknowledgement.
+     *
+     * @code
+     * PublishHandle handle;
+     * client->publishAsync("sensors/temp", payload, MqttQos::AT_LEAST_ONCE,
+     *                      [](PublishHandle h, esp_err_t result) { ... }, false, &handle);
+     * @endcode
+     *
+     * @param topic Topic to publish on
+     * @param payload Message payload
+     * @param qos Quality of service
+     * @param onComplete Called when the publish completes (optional)
+     * @param retain Retain flag
+     * @param[out] handle Handle passed to onComplete (optional)
+     * @return ESP_OK if queued
+     *         ESP_ERR_INVALID_STATE if not connected
+     *         ESP_ERR_NO_MEM if every slot is in use or the budget is exhausted
+     */
+    esp_err_t publishAsync(const std::string &topic,
+                           const std::vector<uint8_t> &payload,
+                           MqttQos qos = MqttQos::AT_MOST_ONCE,
+                           PublishCompleteCallback onComplete = nullptr,
+                           bool retain = false,
+                           PublishHandle *handle = nullptr);
+
+    /**
+     * @brief Number of publishAsync() requests queued or awaiting acknowledgement
+     */
+    size_t getPendingPublishCount() const;
+
     // =============================================================================
     // CoreMQTT-Specific Methods
     // =============================================================================
@@ -191,6 +374,9 @@ public:
      * }
      * @endcode
      *
+     * Data is waited for with the client mutex released (when the transport
+     * supports waitForData()); the mutex is taken per received packet.
+     *
      * @param timeoutMs Maximum time to block waiting for network activity
      * @return ESP_OK on success, error code otherwise
      */
@@ -212,12 +398,22 @@ public:
      */
     bool hasOutstandingPackets() const;
 
+    /**
+     * @brief Publishes waiting in the offline spool
+     * @return Records not yet replayed, 0 without MqttConfig::spool
+     */
+    size_t getSpoolPending() const;
+
     /**
      * @brief Start the background ProcessLoop task
      *
      * Creates a FreeRTOS task that continuously calls processLoop() to handle
      * incoming/outgoing MQTT packets, keep-alive pings, and ACKs.
      *
+     * When the transport supports waitForData(), the task sleeps until a
+     * packet arrives or the next keep-alive ping is due (capped at
+     * processLoopIdleMs) instead of polling every processLoopDelayMs.
+     *
      * This task is automatically started by connect() unless auto-start is disabled
      * in the configuration. You can also start it manually for more control.
      *
@@ -229,8 +425,9 @@ public:
     /**
      * @brief Stop the background ProcessLoop task
      *
-     * Gracefully stops the ProcessLoop task. Waits up to 500ms for the task
-     * to exit cleanly before forcing deletion.
+     * Gracefully stops the ProcessLoop task, waking it through
+     * ITlsTransport::cancelWait(), and waits for it to exit cleanly before
+     * forcing deletion.
      *
      * This task is automatically stopped by disconnect().
      *
@@ -293,10 +490,122 @@ private:
     struct Subscription
     {
         std::string topic;
-        MessageCallback callback;
         MqttQos qos;
+        MqttHandlerPtr handler; ///< Callbacks (shared with queued dispatches)
     };
 
+    /**
+     * @brief Lifecycle of a publishAsync() slot
+     */
+    enum class AsyncPublishState : uint8_t
+    {
+        FREE,      ///< Available
+        QUEUED,    ///< Waiting to be sent
+        IN_FLIGHT, ///< Sent, waiting for PUBACK/PUBCOMP
+        COMPLETED  ///< Finished, callback not yet delivered
+    };
+
+    /**
+     * @brief publishAsync() slot (storage is reused between requests)
+     */
+    struct AsyncPublish
+    {
+        AsyncPublishState state{AsyncPublishState::FREE};
+        PublishHandle handle{0};
+        uint16_t packetId{MQTT_PACKET_ID_INVALID};
+        MqttQos qos{MqttQos::AT_MOST_ONCE};
+        bool retain{false};
+        esp_err_t result{ESP_OK};
+        std::string topic;
+        std::vector<uint8_t> payload;
+        PublishCompleteCallback onComplete;
+    };
+
+    // =============================================================================
+    // Publish Helpers
+    // =============================================================================
+
+    /// Most segments a QoS 0 publish writes without gathering (plus header and topic)
+    static constexpr size_t MAX_GATHER_SEGMENTS = 8;
+
+    /**
+     * @brief Shared body of the publish() overloads and publishString()
+     */
+    esp_err_t publishSegments(std::string_view topic,
+                              const MqttPayloadSegment *segments,
+                              size_t segmentCount,
+                              MqttQos qos,
+                              bool retain);
+
+    /**
+     * @brief Serialize and send one PUBLISH (mutex_ held)
+     * @param[out] packetId Packet ID used (MQTT_PACKET_ID_INVALID for QoS 0)
+     */
+    MQTTStatus_t sendPublish(std::string_view topic,
+                             const uint8_t *payload,
+                             size_t payloadLength,
+                             MqttQos qos,
+                             bool retain,
+                             uint16_t *packetId);
+
+    /**
+     * @brief Write a QoS 0 PUBLISH straight from the payload segments (mutex_ held)
+     *
+     * Bypasses MQTT_Publish(), which is safe for QoS 0 because coreMQTT keeps
+     * no state for it. A failure after part of the packet was written
+     * leaves the stream corrupt, so it drops the connection.
+     */
+    MQTTStatus_t sendPublishGathered(std::string_view topic,
+                                     const MqttPayloadSegment *segments,
+                                     size_t segmentCount,
+                                     size_t payloadLength,
+                                     bool retain);
+
+    /**
+     * @brief Send queued publishAsync() requests in order (mutex_ held)
+     */
+    void sendQueuedPublishes();
+
+    /**
+     * @brief Open the offline spool on first use (mutex_ held)
+     * @return true if publishes can be spooled
+     */
+    bool spoolReady();
+
+    /**
+     * @brief Replay up to SpoolConfig::drainBatch spooled publishes (mutex_ held)
+     *
+     * Each record consumes budget like a live publish; an exhausted budget
+     * leaves the rest on flash for a later processLoop() call.
+     */
+    void drainSpool();
+
+    /**
+     * @brief Charge a publish to its budget class and the global budget (mutex_ held)
+     * @return true if the publish may be sent
+     */
+    bool consumeBudget(std::string_view topic, size_t payloadLength, MqttQos qos);
+
+    /**
+     * @brief Send publishes deferred by budget classes, by class weight (mutex_ held)
+     */
+    void drainDeferred();
+
+    /**
+     * @brief Complete the in-flight publishAsync() request for a packet ID (mutex_ held)
+     */
+    void completeAsyncPublish(uint16_t packetId);
+
+    /**
+     * @brief Complete every queued and in-flight request with an error (mutex_ held)
+     */
+    void failAsyncPublishes(esp_err_t result);
+
+    /**
+     * @brief Invoke callbacks of completed requests (mutex_ not held)
+     */
+    void deliverPublishCompletions();
+
     // =============================================================================
     // Transport Layer
     // =============================================================================
@@ -306,6 +615,13 @@ private:
      */
     static int32_t transportSend(NetworkContext_t *pNetworkContext, const void *pBuffer, size_t bytesToSend);
 
+    /**
+     * @brief Static transport vectored send function (coreMQTT callback)
+     */
+    static int32_t transportWritev(NetworkContext_t *pNetworkContext,
+                                   TransportOutVector_t *pIoVec,
+                                   size_t ioVecCount);
+
     /**
      * @brief Static transport receive function (coreMQTT callback)
      */
@@ -337,25 +653,96 @@ private:
     // =============================================================================
 
     /**
-     * @brief Resend unacknowledged publishes after reconnect
+     * @brief Resend unacknowledged publishes with DUP set after a session resume
+     *
+     * Publishes coreMQTT still waits on (PUBACK or PUBREC pending) are sent
+     * again from retransmitStore_ with their original packet IDs, oldest
+     * first. PUBREL retransmission is left to coreMQTT.
      */
     esp_err_t resendPendingPublishes();
 
+    /**
+     * @brief Drop the stored copy of an acknowledged publish (mutex_ held)
+     */
+    void releaseRetransmit(uint16_t packetId);
+
+    /**
+     * @brief Find coreMQTT's outgoing state record for a packet ID (mutex_ held)
+     *
+     * coreMQTT places and compacts records itself, so recordHints_ only
+     * remembers where a packet ID was last seen. A hit is one array read;
+     * a miss scans the records once and refreshes the hint.
+     *
+     * @return Record, or nullptr if coreMQTT holds none for packetId
+     */
+    const MQTTPubAckInfo_t *findOutgoingRecord(uint16_t packetId) const;
+
     /**
      * @brief Resubscribe to topics after reconnect
      */
     esp_err_t resubscribeTopics();
 
     /**
-     * @brief Find subscription by topic
+     * @brief Send filters in as few SUBSCRIBE or UNSUBSCRIBE packets as the limits allow
+     *
+     * Must be called with mutex_ held.
+     *
+     * @param filters Filters to send, in order
+     * @param subscribe true for SUBSCRIBE, false for UNSUBSCRIBE
+     * @param sent Set to the number of leading filters that were sent
+     * @return ESP_OK if all were sent, ESP_FAIL otherwise
+     */
+    esp_err_t sendTopicFilters(const std::vector<MQTTSubscribeInfo_t> &filters, bool subscribe, size_t *sent);
+
+    /**
+     * @brief Mark the connection down after a transport or protocol error
+     *
+     * Must be called with mutex_ held.
      */
-    Subscription *findSubscription(const std::string &topic);
+    void handleConnectionLost();
+
+    /**
+     * @brief Shared body of subscribe() and subscribeView()
+     */
+    esp_err_t addSubscription(const std::string &topic,
+                              MessageCallback callback,
+                              MessageViewCallback viewCallback,
+                              MqttQos qos);
+
+    /**
+     * @brief Whether a lost connection is re-established in the background
+     *
+     * Needs MqttConfig::reconnect.autoReconnect, MqttConfig::tls (the
+     * transport is reconnected with it) and a connect() that succeeded.
+     */
+    bool canReconnect() const;
+
+    /**
+     * @brief Reconnect the transport with ITlsTransport::connectAsync()
+     *
+     * The caller increments reconnectsPending_; onReconnect(), or this
+     * method if the attempt cannot start, decrements it.
+     */
+    void startReconnect();
+
+    /**
+     * @brief connectAsync() callback: send CONNECT, or try again
+     */
+    void onReconnect(esp_err_t result);
 
     /**
      * @brief Background task that processes MQTT loop
      */
     void processLoopTask();
 
+    /**
+     * @brief How long the ProcessLoop task may block before its next processLoop() call
+     *
+     * Until the keep-alive ping is due, at most processLoopIdleMs, or
+     * processLoopDelayMs while spooled publishes are waiting.
+     */
+    uint32_t nextWakeMs();
+
     /**
      * @brief Static wrapper for FreeRTOS task creation
      */
@@ -372,18 +759,40 @@ private:
     std::shared_ptr<lopcore::tls::ITlsTransport> tlsTransport_; ///< TLS transport (shared, can be used by
                                                                 ///< multiple clients)
     std::unique_ptr<MqttBudget> budget_;                        ///< Message budgeting
+    std::unique_ptr<MqttBudgetScheduler> budgetScheduler_;      ///< Per-topic budget classes (if configured)
+    std::unique_ptr<MqttSpool> spool_;                          ///< Offline publish spool (if enabled)
+    std::unique_ptr<MqttRetransmitStore> retransmitStore_;      ///< Unacknowledged QoS 1/2 publishes
+                                                                ///< (persistent sessions only)
+    std::unique_ptr<MqttDispatcher> dispatcher_;                ///< Callback worker pool (if enabled)
+    MqttTopicTable topicTable_;                                 ///< registerTopic() entries
+    std::vector<MqttHandlerPtr> dispatchHandlers_;              ///< Matches of the message being dispatched
     std::atomic<MqttConnectionState> state_;                    ///< Connection state
-    std::vector<uint8_t> networkBuffer_;                        ///< Network buffer
+    memory::Buffer networkBuffer_;                              ///< Network buffer (MemoryRole::BULK)
+    std::vector<uint8_t> gatherBuffer_;                         ///< Flattened QoS 1/2 segment payloads
     std::vector<MQTTPubAckInfo_t> outgoingPublishRecords_;      ///< Outgoing QoS records
     std::vector<MQTTPubAckInfo_t> incomingPublishRecords_;      ///< Incoming QoS records
-    std::vector<Subscription> subscriptions_;                   ///< Active subscriptions
+    mutable std::vector<uint16_t> recordHints_;                 ///< packetId & (size - 1) -> outgoing record
+                                                                ///< index + 1 (0 = unknown)
+    TopicTrie<Subscription> subscriptions_;                     ///< Active subscriptions by filter
+    std::vector<AsyncPublish> asyncPublishes_;                  ///< publishAsync() slots
+    PublishHandle nextPublishHandle_;                           ///< Next publishAsync() handle
     ConnectionCallback connectionCallback_;                     ///< Connection callback
     ErrorCallback errorCallback_;                               ///< Error callback
-    MqttStatistics statistics_;                                 ///< Statistics
+    MqttStatistics statistics_;                                 ///< Connection times and subscription count
+    MqttMetrics metrics_;                                       ///< Lock-free counters and latency histograms
     mutable std::mutex mutex_;                                  ///< Thread safety
+    bool skipRecv_;                                             ///< Next recv returns 0 (guarded by mutex_)
+    uint32_t lastSendMs_;                                       ///< Time of the last packet sent (guarded by
+                                                                ///< mutex_)
+    std::atomic<bool> waitSupported_;                           ///< Transport implements waitForData()
     TaskHandle_t processTask_;                                  ///< Process loop task handle
     std::atomic<bool> shouldRun_;            ///< Process loop control (atomic, no mutex needed)
     SemaphoreHandle_t taskStoppedSemaphore_; ///< Signals when task has stopped
+
+    // Background reconnect
+    std::atomic<bool> reconnectEnabled_;        ///< Set by connect(), cleared by disconnect()
+    std::atomic<uint32_t> reconnectsPending_;   ///< startReconnect() calls whose callback has not returned
+    std::atomic<TaskHandle_t> reconnectCaller_; ///< Task that called connectAsync(), to spot inline callbacks
 };
 
 } // namespace mqtt
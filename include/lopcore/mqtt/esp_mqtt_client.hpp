@@ -11,9 +11,10 @@
 
 #pragma once
 
-#include <map>
 #include <memory>
 #include <mutex>
+#include <string_view>
+#include <vector>
 
 // For host testing, include mock ESP-IDF types before mqtt_client.h
 #ifndef ESP_PLATFORM
@@ -23,8 +24,14 @@
 #include <mqtt_client.h>
 
 #include "mqtt_budget.hpp"
+#include "mqtt_budget_scheduler.hpp"
 #include "mqtt_config.hpp"
+#include "mqtt_dispatcher.hpp"
+#include "mqtt_message_pool.hpp"
+#include "mqtt_metrics.hpp"
+#include "mqtt_topic_table.hpp"
 #include "mqtt_types.hpp"
+#include "topic_trie.hpp"
 
 namespace lopcore
 {
@@ -81,10 +88,94 @@ public:
 
     esp_err_t publishString(const std::string &topic, const std::string &payload, MqttQos qos, bool retain);
 
+    /**
+     * @brief Publish a payload made of several buffers
+     *
+     * ESP-MQTT copies every payload into its own output buffer and takes a
+     * single pointer, so the segments are gathered into one buffer here
+     * (skipped when there is only one segment).
+     *
+     * @param topic Topic name
+     * @param segments Payload pieces, in order
+     * @param segmentCount Number of segments
+     * @param qos Quality of Service level
+     * @param retain Retained message flag
+     */
+    esp_err_t publish(std::string_view topic,
+                      const MqttPayloadSegment *segments,
+                      size_t segmentCount,
+                      MqttQos qos,
+                      bool retain);
+
+    /**
+     * @brief Intern a topic for publish(TopicHandle, ...)
+     * @return Invalid handle if MqttConfig::topicTableSize topics are already registered
+     */
+    TopicHandle registerTopic(std::string_view topic);
+
+    /**
+     * @brief Topic registered under a handle (empty if unknown)
+     */
+    std::string_view topicName(TopicHandle topic) const;
+
+    /**
+     * @brief Publish on an interned topic
+     *
+     * Passes the interned, null-terminated topic straight to ESP-MQTT
+     * instead of copying it for every publish.
+     *
+     * @return ESP_ERR_INVALID_ARG if the handle is unknown, otherwise as publish()
+     */
+    esp_err_t publish(TopicHandle topic,
+                      const MqttPayloadSegment *segments,
+                      size_t segmentCount,
+                      MqttQos qos,
+                      bool retain);
+
     esp_err_t subscribe(const std::string &topic, MessageCallback callback, MqttQos qos);
 
+    /**
+     * @brief Subscribe with a callback that receives messages without copying
+     *
+     * The view points into ESP-MQTT's receive buffer and is valid only until
+     * the callback returns; call MqttMessageView::toMessage() to keep it.
+     */
+    esp_err_t subscribeView(const std::string &topic, MessageViewCallback callback, MqttQos qos);
+
+    /**
+     * @brief Subscribe with a callback that processes messages as they arrive
+     *
+     * A message larger than MqttConfig::networkBufferSize reaches the
+     * callback fragment by fragment, straight from ESP-MQTT's receive
+     * buffer, so a multi-hundred-KB job document can be parsed or written
+     * to flash without ever being held in memory whole. Always called on
+     * the MQTT event task, even with callback workers configured.
+     */
+    esp_err_t subscribeStream(const std::string &topic, MessageFragmentCallback callback, MqttQos qos);
+
     esp_err_t unsubscribe(const std::string &topic);
 
+    /**
+     * @brief Subscribe to several topic filters with as few SUBSCRIBE packets as possible
+     *
+     * Filters are packed up to MqttConfig::maxTopicsPerSubscribe per packet
+     * and within MqttConfig::networkBufferSize. Every filter is validated
+     * before anything is sent.
+     *
+     * @param requests Filters with their QoS and callbacks
+     * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not connected,
+     *         ESP_ERR_INVALID_ARG if a filter is malformed, ESP_FAIL if a
+     *         packet could not be queued (all filters are retried on reconnect)
+     */
+    esp_err_t subscribeMany(const std::vector<MqttSubscribeRequest> &requests);
+
+    /**
+     * @brief Unsubscribe from several topic filters
+     *
+     * ESP-MQTT has no multi-topic UNSUBSCRIBE, so one packet is sent per filter.
+     */
+    esp_err_t unsubscribeMany(const std::vector<std::string> &topics);
+
     void setConnectionCallback(ConnectionCallback callback);
     void setErrorCallback(ErrorCallback callback);
 
@@ -92,6 +183,25 @@ public:
     setWillMessage(const std::string &topic, const std::vector<uint8_t> &payload, MqttQos qos, bool retain);
 
     MqttStatistics getStatistics() const;
+
+    /**
+     * @brief Counters and latency histograms, read without locking
+     *
+     * Covers QoS 1/2 publish-to-ack latency and the time spent delivering
+     * each inbound message; ESP-MQTT has no process loop to time.
+     */
+    MqttMetricsSnapshot getMetrics() const;
+
+    /**
+     * @brief Expose the client's metrics and budgets in a metrics registry
+     *
+     * Registers the MqttMetrics counters under prefix, the global budget as
+     * prefix + ".budget.remaining" and each budget class as prefix +
+     * ".budget." + class name + ".remaining". They are removed with the
+     * client. Call once, before the client is shared between tasks.
+     */
+    void registerMetrics(metrics::MetricsRegistry &registry, std::string_view prefix);
+
     void resetStatistics();
 
     // ========================================================================
@@ -141,6 +251,19 @@ private:
      */
     void handleData(esp_mqtt_event_handle_t event);
 
+    /**
+     * @brief Handle one MQTT_EVENT_DATA piece of a fragmented message
+     *
+     * Stream callbacks see the piece in place; other callbacks get the
+     * message once it is complete, if it fits a reassembly block.
+     */
+    void handleFragment(esp_mqtt_event_handle_t event);
+
+    /**
+     * @brief Give up on the message being reassembled
+     */
+    void abandonFragments();
+
     /**
      * @brief Handle MQTT_EVENT_ERROR
      * @param event MQTT event with error info
@@ -169,12 +292,33 @@ private:
     void resubscribeAll();
 
     /**
-     * @brief Check if topic matches subscription pattern
-     * @param pattern Subscription pattern (may contain wildcards)
-     * @param topic Incoming message topic
-     * @return True if topic matches pattern
+     * @brief Shared body of the publish() overloads and publishString()
+     * @param topic Null-terminated topic name
      */
-    bool topicMatches(const std::string &pattern, const std::string &topic) const;
+    esp_err_t
+    publishBuffer(const char *topic, const void *payload, size_t payloadLength, MqttQos qos, bool retain);
+
+    /**
+     * @brief Gather segments (if more than one) and publish them
+     * @param topic Null-terminated topic name
+     */
+    esp_err_t publishSegments(const char *topic,
+                              const MqttPayloadSegment *segments,
+                              size_t segmentCount,
+                              MqttQos qos,
+                              bool retain);
+
+    /**
+     * @brief Send filters in as few SUBSCRIBE packets as the limits allow
+     * @param topics Filters to send, in order
+     * @return Number of leading filters that were queued by ESP-MQTT
+     */
+    size_t sendSubscribeBatches(const std::vector<esp_mqtt_topic_t> &topics);
+
+    /**
+     * @brief Record a subscription and send SUBSCRIBE
+     */
+    esp_err_t addSubscription(const std::string &topic, MqttHandler handler, MqttQos qos);
 
     /**
      * @brief Convert ESP-MQTT error to MqttError
@@ -189,6 +333,32 @@ private:
      */
     void updateConnectionState(MqttConnectionState newState);
 
+    /**
+     * @brief Callbacks registered for one topic filter
+     */
+    struct SubscriptionHandler
+    {
+        MqttHandlerPtr handler; ///< Callbacks (shared with in-flight deliveries)
+        MqttQos qos;            ///< Requested QoS, restored on resubscribe
+    };
+
+    /**
+     * @brief Message arriving in fragments (MQTT event task only)
+     */
+    struct InboundFragments
+    {
+        bool active{false};                         ///< A fragmented message is in progress
+        std::string topic;                          ///< From the first fragment (later ones have none)
+        size_t totalLength{0};                      ///< Whole payload size
+        size_t received{0};                         ///< Payload bytes seen so far
+        MqttQos qos{MqttQos::AT_MOST_ONCE};         ///< From the first fragment
+        bool retained{false};                       ///< From the first fragment
+        uint32_t messageId{0};                      ///< From the first fragment
+        uint8_t *block{nullptr};                    ///< Reassembly block, if any callback needs one
+        std::vector<MqttHandlerPtr> streamHandlers; ///< Matched stream callbacks
+        std::vector<MqttHandlerPtr> handlers;       ///< Matched callbacks waiting for the whole message
+    };
+
     // ========================================================================
     // Member Variables
     // ========================================================================
@@ -197,12 +367,20 @@ private:
     esp_mqtt_client_handle_t mqttHandle_;                  ///< ESP-MQTT client handle
     std::atomic<MqttConnectionState> state_;               ///< Current connection state
     std::unique_ptr<MqttBudget> budget_;                   ///< Message budget (optional)
-    mutable MqttStatistics statistics_;                    ///< Connection statistics
+    std::unique_ptr<MqttBudgetScheduler> budgetScheduler_; ///< Per-topic budget classes (optional)
+    MqttStatistics statistics_;                            ///< Connection times and subscription count
     mutable std::mutex statisticsMutex_;                   ///< Protects statistics_
+    MqttMetrics metrics_;                                  ///< Lock-free counters and latency histograms
     ConnectionCallback connectionCallback_;                ///< Connection state callback
     ErrorCallback errorCallback_;                          ///< Error callback
-    std::map<std::string, MessageCallback> subscriptions_; ///< Topic -> callback map
+    TopicTrie<SubscriptionHandler> subscriptions_;         ///< Topic filter -> callbacks
     mutable std::mutex subscriptionsMutex_;                ///< Protects subscriptions_
+    std::vector<MqttHandlerPtr> matchedHandlers_;          ///< Matches of the message being delivered
+                                                           ///< (MQTT event task only)
+    std::unique_ptr<MqttDispatcher> dispatcher_;           ///< Callback worker pool (if enabled)
+    MqttTopicTable topicTable_;                            ///< registerTopic() entries
+    std::unique_ptr<MqttMessagePool> inboundPool_;         ///< Fragment reassembly blocks (if configured)
+    InboundFragments fragments_;                           ///< Message being reassembled
     mutable std::mutex operationMutex_;                    ///< Protects connect/disconnect operations
     std::string alpnProtocol_;                             ///< ALPN protocol string (lifetime management)
     const char *alpnProtocolPtr_[2] = {nullptr, nullptr};  ///< Null-terminated array for ESP-MQTT API
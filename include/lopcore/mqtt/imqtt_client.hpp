@@ -13,6 +13,7 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <esp_err.h>
@@ -140,6 +141,95 @@ public:
                                     MqttQos qos = MqttQos::AT_MOST_ONCE,
                                     bool retain = false) = 0;
 
+    /**
+     * @brief Publish a payload made of several buffers
+     *
+     * Lets callers send a frame built from separate pieces (header, data
+     * block, CRC) without concatenating them first. The default
+     * implementation gathers the segments and calls publish(); clients
+     * whose transport can send vectored data override it.
+     *
+     * @param topic Topic to publish to
+     * @param segments Payload pieces, in order
+     * @param segmentCount Number of segments
+     * @param qos Quality of Service level
+     * @param retain Retain flag
+     * @return ESP_OK on success, error code otherwise
+     */
+    virtual esp_err_t publish(std::string_view topic,
+                              const MqttPayloadSegment *segments,
+                              size_t segmentCount,
+                              MqttQos qos = MqttQos::AT_MOST_ONCE,
+                              bool retain = false)
+    {
+        if (segments == nullptr && segmentCount > 0)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        std::vector<uint8_t> payload;
+        for (size_t i = 0; i < segmentCount; i++)
+        {
+            const uint8_t *data = static_cast<const uint8_t *>(segments[i].data);
+            payload.insert(payload.end(), data, data + segments[i].size);
+        }
+        return publish(std::string(topic), payload, qos, retain);
+    }
+
+    /**
+     * @brief Intern a topic for publishing by handle
+     *
+     * Register long topics that are published repeatedly (e.g. AWS IoT
+     * shadow topics) once, then pass the handle to publish() so the topic
+     * is never rebuilt per publish. Registering the same topic again
+     * returns the same handle.
+     *
+     * @param topic Topic name (no wildcards)
+     * @return Handle, invalid if the client's topic table is full or the
+     *         client does not intern topics
+     */
+    virtual TopicHandle registerTopic(std::string_view topic)
+    {
+        (void)topic;
+        return TopicHandle{};
+    }
+
+    /**
+     * @brief Topic registered under a handle
+     * @return The topic, or an empty view for a handle this client did not issue
+     */
+    virtual std::string_view topicName(TopicHandle topic) const
+    {
+        (void)topic;
+        return {};
+    }
+
+    /**
+     * @brief Publish on a topic registered with registerTopic()
+     *
+     * @param topic Handle from registerTopic()
+     * @param segments Payload pieces, in order
+     * @param segmentCount Number of segments
+     * @param qos Quality of Service level
+     * @param retain Retain flag
+     * @return ESP_OK on success
+     * @return ESP_ERR_INVALID_ARG if the handle is invalid
+     * @return Otherwise as publish()
+     */
+    virtual esp_err_t publish(TopicHandle topic,
+                              const MqttPayloadSegment *segments,
+                              size_t segmentCount,
+                              MqttQos qos = MqttQos::AT_MOST_ONCE,
+                              bool retain = false)
+    {
+        std::string_view name = topicName(topic);
+        if (name.empty())
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        return publish(name, segments, segmentCount, qos, retain);
+    }
+
     /**
      * @brief Subscribe to topic with callback
      *
@@ -161,6 +251,31 @@ public:
                                 MessageCallback callback,
                                 MqttQos qos = MqttQos::AT_MOST_ONCE) = 0;
 
+    /**
+     * @brief Subscribe with a callback that receives messages without copying
+     *
+     * The view is valid only until the callback returns. Clients that can
+     * hand out their receive buffer override this; the default subscribes
+     * with subscribe() and views the copied message.
+     *
+     * @param topic Topic filter to subscribe to (can include wildcards)
+     * @param callback Function called when message received
+     * @param qos Maximum QoS level for subscription
+     * @return Same as subscribe()
+     */
+    virtual esp_err_t subscribeView(const std::string &topic,
+                                    MessageViewCallback callback,
+                                    MqttQos qos = MqttQos::AT_MOST_ONCE)
+    {
+        return subscribe(
+            topic,
+            [callback = std::move(callback)](const MqttMessage &message) {
+                callback(MqttMessageView{message.topic, message.payload.data(), message.payload.size(),
+                                         message.qos, message.retained, message.messageId});
+            },
+            qos);
+    }
+
     /**
      * @brief Unsubscribe from topic
      *
@@ -11,12 +11,14 @@
 #pragma once
 
 #include <atomic>
-#include <mutex>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
 
 #include <esp_err.h>
-#include <freertos/FreeRTOS.h>
-#include <freertos/timers.h>
+#include <esp_timer.h>
 
+#include "lopcore/metrics/metrics_registry.hpp"
 #include "mqtt_config.hpp"
 
 namespace lopcore
@@ -28,7 +30,14 @@ namespace mqtt
  * @brief MQTT message budget manager
  *
  * Implements a token bucket algorithm for rate limiting MQTT publishes.
- * Budget is consumed on each publish and automatically restored over time.
+ * Budget is consumed on each publish and refilled from elapsed time on
+ * every call, so no timer task is needed and a fractional refill rate
+ * accrues smoothly instead of in reviveCount steps.
+ *
+ * The whole bucket is one timestamp: the time at which it would have
+ * been empty. Tokens are the time elapsed since then divided by the
+ * refill interval, capped at maxBudget, and every update is a single
+ * compare-and-swap.
  *
  * Thread-safe: Can be called from multiple tasks concurrently
  */
@@ -36,15 +45,18 @@ class MqttBudget
 {
 public:
     /**
-     * @brief Construct budget manager with configuration
-     * @param config Budget configuration
+     * @brief Monotonic time source in microseconds
      */
-    explicit MqttBudget(const BudgetConfig &config);
+    using TimeSource = int64_t (*)();
 
     /**
-     * @brief Destructor - stops revive timer
+     * @brief Construct budget manager with configuration
+     * @param config Budget configuration
+     * @param timeSource Monotonic clock (esp_timer_get_time unless testing)
      */
-    ~MqttBudget();
+    explicit MqttBudget(const BudgetConfig &config, TimeSource timeSource = esp_timer_get_time);
+
+    ~MqttBudget() = default;
 
     // Non-copyable
     MqttBudget(const MqttBudget &) = delete;
@@ -61,17 +73,29 @@ public:
      * @param count Number of budget units to consume (default 1)
      * @return True if budget consumed successfully, false if insufficient
      */
-    bool consume(uint8_t count = 1);
+    bool consume(uint32_t count = 1);
 
     /**
      * @brief Manually restore budget
      * @param count Number of budget units to restore
      */
-    void restore(uint8_t count);
+    void restore(uint32_t count);
+
+    /**
+     * @brief Budget units a publish costs
+     * @return 1 in MESSAGES mode; the PUBLISH packet size, rounded up to
+     *         BudgetConfig::meteringBytes, in BYTES mode
+     */
+    uint32_t costOf(size_t topicLength, size_t payloadLength, MqttQos qos) const;
+
+    /**
+     * @brief Size of an MQTT 3.1.1 PUBLISH packet on the wire
+     */
+    static size_t publishPacketSize(size_t topicLength, size_t payloadLength, MqttQos qos);
 
     /**
      * @brief Get remaining budget
-     * @return Current budget value
+     * @return Current budget value (whole messages, or bytes in BYTES mode)
      */
     int32_t getRemaining() const;
 
@@ -81,14 +105,14 @@ public:
     void reset();
 
     /**
-     * @brief Start automatic budget restoration timer
-     * @return ESP_OK on success
+     * @brief Kept for compatibility; the budget refills without a timer
+     * @return ESP_OK
      */
     esp_err_t start();
 
     /**
-     * @brief Stop automatic budget restoration timer
-     * @return ESP_OK on success
+     * @brief Kept for compatibility; the budget refills without a timer
+     * @return ESP_OK
      */
     esp_err_t stop();
 
@@ -101,22 +125,34 @@ public:
         return config_.enabled;
     }
 
-private:
     /**
-     * @brief Timer callback for budget restoration
-     * @param timerHandle FreeRTOS timer handle
+     * @brief Time to refill one message, in microseconds
      */
-    static void reviveTimerCallback(TimerHandle_t timerHandle);
+    int64_t getIntervalUs() const
+    {
+        return intervalUs_;
+    }
 
     /**
-     * @brief Internal budget restoration logic
+     * @brief Expose the remaining budget in a metrics registry
+     *
+     * Registers a sampled gauge named prefix + ".remaining"; it is removed
+     * with this object.
      */
-    void reviveBudget();
+    void registerMetrics(metrics::MetricsRegistry &registry, std::string_view prefix);
 
-    const BudgetConfig config_;   ///< Budget configuration
-    std::atomic<int32_t> budget_; ///< Current budget (atomic for lock-free reads)
-    mutable std::mutex mutex_;    ///< Mutex for budget modifications
-    TimerHandle_t reviveTimer_;   ///< FreeRTOS timer for auto-restore
+private:
+    /**
+     * @brief Start of the current bucket contents, clamped to a full bucket
+     */
+    int64_t effectiveEmptyAt(int64_t emptyAtUs, int64_t nowUs) const;
+
+    const BudgetConfig config_;       ///< Budget configuration
+    const TimeSource timeSource_;     ///< Monotonic clock
+    const int64_t intervalUs_;        ///< Microseconds per refilled message
+    const int64_t capacityUs_;        ///< maxBudget * intervalUs_
+    std::atomic<int64_t> emptyAtUs_;  ///< Time the bucket was (or would have been) empty
+    metrics::Registration remaining_; ///< getRemaining() in a registry (if registered)
 };
 
 } // namespace mqtt
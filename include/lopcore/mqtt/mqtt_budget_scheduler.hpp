@@ -0,0 +1,205 @@
+/**
+ * @file mqtt_budget_scheduler.hpp
+ * @brief Per-topic budget classes with weighted scheduling of deferred publishes
+ *
+ * A single MqttBudget lets a chatty topic use up the budget that an alarm
+ * topic needs. Budget classes give groups of topics their own capacity
+ * and refill rate on top of the global budget. Publishes that find the
+ * global budget exhausted can be deferred and are later sent by stride
+ * scheduling, so each class gets a share of the refilled budget in
+ * proportion to its weight.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <esp_err.h>
+
+#include "mqtt_budget.hpp"
+#include "mqtt_config.hpp"
+#include "mqtt_types.hpp"
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+/**
+ * @brief Budget classes plus the queue of publishes waiting for budget
+ *
+ * classify(), consume() and restore() are thread-safe (EspMqttClient calls
+ * them from any task). admit() and drain() are not; CoreMqttClient calls
+ * them with its mutex held.
+ *
+ * @code
+ * BudgetClassConfig alarms{"alarms", {"dev/alarm/"}, {}, 8, 16};
+ * MqttBudgetScheduler scheduler({alarms}, &globalBudget);
+ *
+ * bool deferred = false;
+ * if (scheduler.admit(topic, &segment, 1, qos, false, &deferred) == ESP_OK && !deferred)
+ * {
+ *     // Budget consumed, send now
+ * }
+ * @endcode
+ */
+class MqttBudgetScheduler
+{
+public:
+    /**
+     * @brief Send one deferred publish
+     * @return ESP_OK if sent; any error stops the drain and keeps the publish queued
+     */
+    using SendFunction = std::function<esp_err_t(const MqttMessageView &)>;
+
+    /**
+     * @param classes Budget classes, in priority-independent order
+     * @param globalBudget Budget shared by all topics (nullptr for none)
+     * @param timeSource Clock for the class budgets
+     */
+    MqttBudgetScheduler(const std::vector<BudgetClassConfig> &classes,
+                        MqttBudget *globalBudget,
+                        MqttBudget::TimeSource timeSource = esp_timer_get_time);
+
+    MqttBudgetScheduler(const MqttBudgetScheduler &) = delete;
+    MqttBudgetScheduler &operator=(const MqttBudgetScheduler &) = delete;
+
+    /**
+     * @brief Class of a topic
+     * @return Class index, or classCount() for topics that only use the global budget
+     */
+    size_t classify(std::string_view topic) const;
+
+    /**
+     * @brief Charge a publish to the topic's class and the global budget
+     *
+     * Each budget charges in its own unit (see MqttBudget::costOf()).
+     *
+     * @return true if both had budget (neither is charged otherwise)
+     */
+    bool consume(std::string_view topic, size_t payloadLength, MqttQos qos);
+
+    /**
+     * @brief Return what consume() charged for a publish that was not sent
+     */
+    void restore(std::string_view topic, size_t payloadLength, MqttQos qos);
+
+    /**
+     * @brief Decide what to do with a new publish
+     *
+     * A publish is deferred instead of sent while its class has publishes
+     * waiting (to keep their order) or a heavier class does (so it cannot
+     * take the budget they are waiting for).
+     *
+     * @param[out] deferred Set to true if the publish was copied into the queue
+     * @return ESP_OK to send now (budget consumed) or if deferred
+     *         ESP_ERR_NO_MEM if over budget and the class queue is full or disabled
+     */
+    esp_err_t admit(std::string_view topic,
+                    const MqttPayloadSegment *segments,
+                    size_t segmentCount,
+                    MqttQos qos,
+                    bool retain,
+                    bool *deferred);
+
+    /**
+     * @brief Send deferred publishes while budget allows, by weight
+     * @return Number of publishes sent
+     */
+    size_t drain(const SendFunction &send);
+
+    /**
+     * @brief Discard every deferred publish
+     */
+    void clear();
+
+    size_t classCount() const
+    {
+        return classes_.size();
+    }
+
+    const std::string &className(size_t index) const
+    {
+        return classes_[index].config.name;
+    }
+
+    /**
+     * @brief Remaining budget of a class
+     */
+    int32_t getRemaining(size_t index) const
+    {
+        return classes_[index].budget->getRemaining();
+    }
+
+    /**
+     * @brief Expose each class's remaining budget in a metrics registry
+     *
+     * Registers a sampled gauge per class named prefix + "." + class name +
+     * ".remaining"; they are removed with this object.
+     */
+    void registerMetrics(metrics::MetricsRegistry &registry, std::string_view prefix);
+
+    /**
+     * @brief Publishes waiting in all classes
+     */
+    size_t deferredCount() const
+    {
+        return deferredTotal_;
+    }
+
+private:
+    struct BudgetClass
+    {
+        BudgetClassConfig config;           ///< Class configuration
+        std::unique_ptr<MqttBudget> budget; ///< Class budget
+        std::vector<MqttMessage> slots;     ///< Ring of queueDepth deferred publishes
+        size_t head{0};                     ///< Next slot to fill
+        size_t count{0};                    ///< Deferred publishes
+        uint64_t pass{0};                   ///< Stride scheduling position
+    };
+
+    /**
+     * @brief Charge the class and global budgets together
+     * @param[out] globalExhausted Set when the global budget was the one that ran out
+     */
+    bool consumeClass(size_t index,
+                      size_t topicLength,
+                      size_t payloadLength,
+                      MqttQos qos,
+                      bool *globalExhausted);
+    void restoreClass(size_t index, size_t topicLength, size_t payloadLength, MqttQos qos);
+
+    /**
+     * @brief Copy a publish into the class queue
+     */
+    esp_err_t defer(BudgetClass &budgetClass,
+                    std::string_view topic,
+                    const MqttPayloadSegment *segments,
+                    size_t segmentCount,
+                    MqttQos qos,
+                    bool retain);
+
+    /**
+     * @brief Whether this class must queue behind deferred publishes
+     */
+    bool mustWait(size_t index) const;
+
+    std::vector<BudgetClass> classes_;                     ///< Configured classes
+    std::vector<std::pair<std::string, size_t>> prefixes_; ///< Prefix -> class, longest first
+    MqttBudget *globalBudget_;                             ///< Shared budget (not owned, may be nullptr)
+    size_t deferredTotal_;                                 ///< Publishes waiting in all classes
+    uint64_t virtualTime_;                                 ///< Pass of the last publish sent
+};
+
+} // namespace mqtt
+} // namespace lopcore
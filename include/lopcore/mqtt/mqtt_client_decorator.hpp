@@ -0,0 +1,167 @@
+/**
+ * @file mqtt_client_decorator.hpp
+ * @brief Base for IMqttClient wrappers that change only a few operations
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <esp_err.h>
+
+#include "imqtt_client.hpp"
+#include "mqtt_types.hpp"
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+/**
+ * @brief IMqttClient that forwards every call to a wrapped client
+ *
+ * Wrappers such as MqttCoalescer and MqttCompressor derive from this and
+ * override the operations they change. Wrappers nest, so one client can
+ * be both compressed and coalesced.
+ */
+class MqttClientDecorator : public IMqttClient
+{
+public:
+    using IMqttClient::publish;
+
+    esp_err_t connect() override
+    {
+        return client_->connect();
+    }
+
+    esp_err_t disconnect() override
+    {
+        return client_->disconnect();
+    }
+
+    bool isConnected() const override
+    {
+        return client_->isConnected();
+    }
+
+    MqttConnectionState getConnectionState() const override
+    {
+        return client_->getConnectionState();
+    }
+
+    esp_err_t publish(const std::string &topic,
+                      const std::vector<uint8_t> &payload,
+                      MqttQos qos = MqttQos::AT_MOST_ONCE,
+                      bool retain = false) override
+    {
+        return client_->publish(topic, payload, qos, retain);
+    }
+
+    esp_err_t publishString(const std::string &topic,
+                            const std::string &payload,
+                            MqttQos qos = MqttQos::AT_MOST_ONCE,
+                            bool retain = false) override
+    {
+        return client_->publishString(topic, payload, qos, retain);
+    }
+
+    esp_err_t publish(std::string_view topic,
+                      const MqttPayloadSegment *segments,
+                      size_t segmentCount,
+                      MqttQos qos = MqttQos::AT_MOST_ONCE,
+                      bool retain = false) override
+    {
+        return client_->publish(topic, segments, segmentCount, qos, retain);
+    }
+
+    // Handles belong to the wrapped client; publish(TopicHandle) resolves
+    // them and comes back through this wrapper's publish(std::string_view)
+    TopicHandle registerTopic(std::string_view topic) override
+    {
+        return client_->registerTopic(topic);
+    }
+
+    std::string_view topicName(TopicHandle topic) const override
+    {
+        return client_->topicName(topic);
+    }
+
+    esp_err_t subscribe(const std::string &topic,
+                        MessageCallback callback,
+                        MqttQos qos = MqttQos::AT_MOST_ONCE) override
+    {
+        return client_->subscribe(topic, std::move(callback), qos);
+    }
+
+    esp_err_t subscribeView(const std::string &topic,
+                            MessageViewCallback callback,
+                            MqttQos qos = MqttQos::AT_MOST_ONCE) override
+    {
+        return client_->subscribeView(topic, std::move(callback), qos);
+    }
+
+    esp_err_t unsubscribe(const std::string &topic) override
+    {
+        return client_->unsubscribe(topic);
+    }
+
+    void setConnectionCallback(ConnectionCallback callback) override
+    {
+        client_->setConnectionCallback(std::move(callback));
+    }
+
+    void setErrorCallback(ErrorCallback callback) override
+    {
+        client_->setErrorCallback(std::move(callback));
+    }
+
+    esp_err_t setWillMessage(const std::string &topic,
+                             const std::vector<uint8_t> &payload,
+                             MqttQos qos = MqttQos::AT_MOST_ONCE,
+                             bool retain = false) override
+    {
+        return client_->setWillMessage(topic, payload, qos, retain);
+    }
+
+    MqttStatistics getStatistics() const override
+    {
+        return client_->getStatistics();
+    }
+
+    void resetStatistics() override
+    {
+        client_->resetStatistics();
+    }
+
+    std::string getClientId() const override
+    {
+        return client_->getClientId();
+    }
+
+    std::string getBroker() const override
+    {
+        return client_->getBroker();
+    }
+
+    uint16_t getPort() const override
+    {
+        return client_->getPort();
+    }
+
+protected:
+    explicit MqttClientDecorator(std::shared_ptr<IMqttClient> client) : client_(std::move(client))
+    {
+    }
+
+    const std::shared_ptr<IMqttClient> client_; ///< Wrapped client
+};
+
+} // namespace mqtt
+} // namespace lopcore
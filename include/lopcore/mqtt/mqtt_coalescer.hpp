@@ -0,0 +1,245 @@
+/**
+ * @file mqtt_coalescer.hpp
+ * @brief Last-value-wins publish coalescing for high-frequency topics
+ *
+ * A sensor publishing its latest reading at 50 Hz costs a PUBLISH (and a
+ * TLS record) per reading, even when the backend only needs the freshest
+ * value every 500 ms. MqttCoalescer wraps any IMqttClient and sends a
+ * coalesced topic at most once per interval; readings in between replace
+ * the one waiting, and a flush task sends it when the interval ends.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef ESP_PLATFORM
+#include <condition_variable>
+#include <thread>
+#endif
+
+#include <esp_err.h>
+#include <esp_timer.h>
+
+#include "mqtt_client_decorator.hpp"
+#include "mqtt_config.hpp"
+#include "mqtt_types.hpp"
+#include "topic_trie.hpp"
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+/**
+ * @brief Coalescer counters
+ */
+struct MqttCoalesceStats
+{
+    uint32_t published{0};     ///< Coalesced-topic publishes sent to the client
+    uint32_t coalesced{0};     ///< Values replaced by a newer one before they were sent
+    uint32_t passedThrough{0}; ///< Coalesced-topic publishes sent directly (all slots taken)
+    uint32_t retried{0};       ///< Values the client refused (budget, offline) and kept for a later flush
+    uint32_t failed{0};        ///< Values dropped on any other client error
+};
+
+/**
+ * @brief IMqttClient decorator that coalesces publishes per topic
+ *
+ * The first publish on a coalesced topic is sent at once; later ones
+ * within the rule's interval only update that topic's slot, which the
+ * flush task sends when the interval has passed. When the client refuses
+ * a value with ESP_ERR_NO_MEM (budget exhausted) or ESP_ERR_INVALID_STATE
+ * (not connected), the value stays in its slot and is retried every
+ * CoalesceConfig::retryMs, unless a newer one replaces it first.
+ *
+ * Slots keep their payload capacity, so after warm-up coalescing a value
+ * does not allocate. Every other IMqttClient call is forwarded unchanged.
+ *
+ * @code
+ * CoalesceConfig coalesce;
+ * coalesce.rules.push_back({"sensors/+/value", 500});
+ * auto client = std::make_shared<MqttCoalescer>(coreClient, coalesce);
+ * client->start();
+ * client->publishString("sensors/imu/value", reading); // At 50 Hz; sent at 2 Hz
+ * @endcode
+ */
+class MqttCoalescer : public MqttClientDecorator
+{
+public:
+    /**
+     * @brief Monotonic time source in microseconds
+     */
+    using TimeSource = int64_t (*)();
+
+    /**
+     * @param client Client that sends the publishes
+     * @param config Coalescing rules (rules with a malformed filter are ignored)
+     * @param timeSource Monotonic clock (esp_timer_get_time unless testing)
+     */
+    MqttCoalescer(std::shared_ptr<IMqttClient> client,
+                  const CoalesceConfig &config,
+                  TimeSource timeSource = esp_timer_get_time);
+
+    /**
+     * @brief Stops the flush task and sends the values still waiting (see stop())
+     */
+    ~MqttCoalescer() override;
+
+    /**
+     * @brief Create the flush task
+     * @return ESP_OK on success
+     *         ESP_ERR_INVALID_STATE if already running
+     *         ESP_ERR_INVALID_ARG if the configuration is invalid
+     *         ESP_FAIL if the task cannot start
+     */
+    esp_err_t start();
+
+    /**
+     * @brief Stop the flush task after its current pass, then flush()
+     *
+     * A waiting value the client refuses at this point (offline, budget)
+     * stays held for a later flush() or poll(), and is lost if the
+     * coalescer is destroyed.
+     */
+    void stop();
+
+    bool isRunning() const
+    {
+        return running_.load();
+    }
+
+    /**
+     * @brief Send every waiting value now, whether or not its interval has passed
+     * @return ESP_OK if all were sent, otherwise the first client error
+     */
+    esp_err_t flush();
+
+    /**
+     * @brief Send the waiting values whose interval has passed
+     *
+     * The flush task calls this; it is public for applications that drive
+     * the coalescer from their own loop instead of calling start().
+     *
+     * @return Milliseconds until the next waiting value is due, UINT32_MAX if none
+     */
+    uint32_t poll();
+
+    MqttCoalesceStats getCoalesceStats() const;
+
+    // =============================================================================
+    // IMqttClient
+    // =============================================================================
+
+    using MqttClientDecorator::publish;
+
+    /**
+     * @return ESP_OK if sent or held for a later flush, otherwise the client's error
+     */
+    esp_err_t publish(const std::string &topic,
+                      const std::vector<uint8_t> &payload,
+                      MqttQos qos = MqttQos::AT_MOST_ONCE,
+                      bool retain = false) override;
+
+    esp_err_t publishString(const std::string &topic,
+                            const std::string &payload,
+                            MqttQos qos = MqttQos::AT_MOST_ONCE,
+                            bool retain = false) override;
+
+    esp_err_t publish(std::string_view topic,
+                      const MqttPayloadSegment *segments,
+                      size_t segmentCount,
+                      MqttQos qos = MqttQos::AT_MOST_ONCE,
+                      bool retain = false) override;
+
+private:
+    /**
+     * @brief Latest value of one coalesced topic
+     *
+     * Slots are never removed and slots_ never grows past its reserved
+     * capacity, so a Slot stays at the same address and its topic is
+     * never rewritten once created.
+     */
+    struct Slot
+    {
+        std::string topic;                  ///< Topic name
+        std::vector<uint8_t> payload;       ///< Waiting value (capacity kept between values)
+        MqttQos qos{MqttQos::AT_MOST_ONCE}; ///< QoS of the waiting value
+        bool retain{false};                 ///< Retain flag of the waiting value
+        bool pending{false};                ///< payload holds a value not yet sent
+        int64_t intervalUs{0};              ///< Least time between two publishes
+        int64_t dueUs{0};                   ///< Earliest time the next publish may be sent
+    };
+
+    /**
+     * @brief Interval of the shortest rule matching a topic
+     * @return Interval in microseconds, or -1 if no rule matches
+     */
+    int64_t intervalFor(std::string_view topic);
+
+    /**
+     * @brief Slot of a topic, created on first use; nullptr once all are taken
+     */
+    Slot *slotFor(std::string_view topic, int64_t intervalUs);
+
+    /**
+     * @brief Copy a value into its slot
+     * @return true if the slot had no value waiting (the flush task needs waking)
+     */
+    bool hold(Slot &slot,
+              const MqttPayloadSegment *segments,
+              size_t segmentCount,
+              MqttQos qos,
+              bool retain);
+
+    /**
+     * @brief Send waiting values that are due (all of them if force)
+     * @param[out] nextDueUs Due time of the earliest value still waiting, INT64_MAX if none
+     */
+    esp_err_t flushPending(bool force, int64_t *nextDueUs);
+
+    static bool isRetryable(esp_err_t err)
+    {
+        return err == ESP_ERR_NO_MEM || err == ESP_ERR_INVALID_STATE;
+    }
+
+    static void taskEntry(void *arg);
+    void runTask();
+    void wakeTask();
+
+    const CoalesceConfig config_;  ///< Configuration
+    const TimeSource timeSource_;  ///< Monotonic clock
+    TopicTrie<int64_t> rules_;     ///< Filter -> interval in microseconds (read-only once built)
+    std::vector<Slot> slots_;      ///< Coalesced topics (at most maxTopics)
+    std::vector<uint8_t> scratch_; ///< Value a flush is sending (swapped with a slot's payload)
+    mutable std::mutex mutex_;     ///< Guards slots_
+    std::mutex flushMutex_;        ///< Held for a whole flush pass (guards scratch_)
+
+    std::atomic<bool> running_;           ///< Flush task keeps running while set
+    std::atomic<uint32_t> published_;     ///< See MqttCoalesceStats
+    std::atomic<uint32_t> coalesced_;     ///< See MqttCoalesceStats
+    std::atomic<uint32_t> passedThrough_; ///< See MqttCoalesceStats
+    std::atomic<uint32_t> retried_;       ///< See MqttCoalesceStats
+    std::atomic<uint32_t> failed_;        ///< See MqttCoalesceStats
+#ifdef ESP_PLATFORM
+    void *task_;                ///< TaskHandle_t of the flush task
+    std::atomic<bool> stopped_; ///< Set by the flush task on exit
+#else
+    std::thread thread_;           ///< Host flush thread
+    std::condition_variable wake_; ///< Signals a new waiting value or stop
+    bool wakePending_;             ///< A wake arrived while the thread was flushing
+#endif
+};
+
+} // namespace mqtt
+} // namespace lopcore
@@ -0,0 +1,154 @@
+/**
+ * @file mqtt_compressor.hpp
+ * @brief Transparent payload compression for any IMqttClient
+ *
+ * JSON telemetry compresses several times over, and every byte saved is
+ * airtime and, with a BYTES budget, budget. MqttCompressor compresses
+ * outgoing payloads with MqttPayloadCodec and marks them by appending
+ * CompressionConfig::topicSuffix to the topic, since MQTT 3.1.1 has no
+ * content-encoding property. Inbound messages carrying the suffix are
+ * decompressed, and delivered on the topic without it, before callbacks.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <esp_err.h>
+
+#include "mqtt_client_decorator.hpp"
+#include "mqtt_config.hpp"
+#include "mqtt_payload_codec.hpp"
+#include "mqtt_types.hpp"
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+/**
+ * @brief Compressor counters
+ */
+struct MqttCompressionStats
+{
+    uint32_t compressed{0};    ///< Publishes sent compressed
+    uint32_t uncompressed{0};  ///< Publishes sent as-is (too small or did not shrink)
+    uint64_t bytesIn{0};       ///< Payload bytes of compressed publishes before compression
+    uint64_t bytesOut{0};      ///< Payload bytes of compressed publishes after compression
+    uint32_t inflated{0};      ///< Inbound messages decompressed
+    uint32_t inflateErrors{0}; ///< Inbound messages dropped as corrupt or oversized
+};
+
+/**
+ * @brief IMqttClient decorator that compresses payloads
+ *
+ * subscribe() also subscribes to the filter plus the suffix (unless the
+ * filter ends in '#', which already covers it), so a peer's compressed
+ * publishes reach the same callback. Both ends must use the same suffix;
+ * a receiver without MqttCompressor sees compressed messages only if it
+ * subscribes to the suffixed topic.
+ *
+ * Compressed publishes share one codec, locked only while compressing;
+ * the inner client's publish runs unlocked, so a publish blocked on the
+ * network does not hold up compression on other tasks.
+ *
+ * @code
+ * auto client = std::make_shared<MqttCompressor>(coreClient, CompressionConfig{});
+ * client->publishString("dt/dev1/telemetry", json); // Sent on "dt/dev1/telemetry/lz"
+ * @endcode
+ */
+class MqttCompressor : public MqttClientDecorator
+{
+public:
+    /**
+     * @param client Client that sends the publishes
+     * @param config Compression settings
+     */
+    MqttCompressor(std::shared_ptr<IMqttClient> client, const CompressionConfig &config);
+
+    MqttCompressionStats getCompressionStats() const;
+
+    // =============================================================================
+    // IMqttClient
+    // =============================================================================
+
+    using MqttClientDecorator::publish;
+
+    esp_err_t publish(const std::string &topic,
+                      const std::vector<uint8_t> &payload,
+                      MqttQos qos = MqttQos::AT_MOST_ONCE,
+                      bool retain = false) override;
+
+    esp_err_t publishString(const std::string &topic,
+                            const std::string &payload,
+                            MqttQos qos = MqttQos::AT_MOST_ONCE,
+                            bool retain = false) override;
+
+    esp_err_t publish(std::string_view topic,
+                      const MqttPayloadSegment *segments,
+                      size_t segmentCount,
+                      MqttQos qos = MqttQos::AT_MOST_ONCE,
+                      bool retain = false) override;
+
+    esp_err_t subscribe(const std::string &topic,
+                        MessageCallback callback,
+                        MqttQos qos = MqttQos::AT_MOST_ONCE) override;
+
+    /**
+     * @brief Views the message as delivered by subscribe(), decompressed
+     */
+    esp_err_t subscribeView(const std::string &topic,
+                            MessageViewCallback callback,
+                            MqttQos qos = MqttQos::AT_MOST_ONCE) override;
+
+    esp_err_t unsubscribe(const std::string &topic) override;
+
+private:
+    /**
+     * @brief Whether a filter already matches its suffixed topics
+     */
+    static bool coversSuffix(const std::string &filter)
+    {
+        return !filter.empty() && filter.back() == '#';
+    }
+
+    /**
+     * @brief Buffers of one compressed publish, owned by its task until sent
+     */
+    struct Packed
+    {
+        std::vector<uint8_t> payload; ///< Compressed payload
+        std::string topic;            ///< Suffixed topic
+    };
+
+    /**
+     * @brief Decompress a message if it carries the suffix, then call the callback
+     */
+    void deliver(const MqttMessage &message, const MessageCallback &callback);
+
+    const CompressionConfig config_; ///< Configuration
+    MqttPayloadCodec codec_;         ///< Shared compressor (guarded by mutex_)
+    std::vector<uint8_t> input_;     ///< Gathered segments (guarded by mutex_)
+    std::vector<Packed> spare_;      ///< Buffers of sent publishes, reused (guarded by mutex_)
+    std::mutex mutex_;               ///< Held while compressing, not while the client publishes
+
+    std::atomic<uint32_t> compressed_;    ///< See MqttCompressionStats
+    std::atomic<uint32_t> uncompressed_;  ///< See MqttCompressionStats
+    std::atomic<uint64_t> bytesIn_;       ///< See MqttCompressionStats
+    std::atomic<uint64_t> bytesOut_;      ///< See MqttCompressionStats
+    std::atomic<uint32_t> inflated_;      ///< See MqttCompressionStats
+    std::atomic<uint32_t> inflateErrors_; ///< See MqttCompressionStats
+};
+
+} // namespace mqtt
+} // namespace lopcore
@@ -7,13 +7,17 @@
 
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include <esp_err.h>
 
+#include "lopcore/task/task_profile.hpp"
 #include "lopcore/tls/tls_config.hpp" // Use unified TLS configuration
 
 #include "mqtt_types.hpp"
@@ -30,16 +34,33 @@ class ReconnectConfigBuilder;
 // Type alias for backwards compatibility
 using TlsConfig = lopcore::tls::TlsConfig;
 
+/**
+ * @brief What a message budget counts
+ */
+enum class BudgetUnit : uint8_t
+{
+    MESSAGES, ///< One unit per publish
+    BYTES     ///< PUBLISH packet bytes (topic, header and payload)
+};
+
 /**
  * @brief Message budgeting configuration (anti-flooding)
+ *
+ * In BYTES mode the budget fields and refill rate are in bytes; prefer
+ * reviveRate there, since reviveCount is limited to 255.
  */
 struct BudgetConfig
 {
-    bool enabled{true};                   ///< Enable message budgeting
-    int32_t defaultBudget{100};           ///< Initial budget
-    int32_t maxBudget{1024};              ///< Maximum budget cap
-    uint8_t reviveCount{1};               ///< Messages restored per period
-    std::chrono::seconds revivePeriod{5}; ///< Budget restoration interval
+    bool enabled{true};                    ///< Enable message budgeting
+    int32_t defaultBudget{100};            ///< Initial budget
+    int32_t maxBudget{1024};               ///< Maximum budget cap
+    uint8_t reviveCount{1};                ///< Messages restored per period
+    std::chrono::seconds revivePeriod{5};  ///< Budget restoration interval
+    float reviveRate{0.0f};                ///< Messages restored per second, may be fractional
+                                           ///< (overrides reviveCount/revivePeriod when > 0)
+    BudgetUnit unit{BudgetUnit::MESSAGES}; ///< What the budget counts
+    uint32_t meteringBytes{0};             ///< BYTES mode: charge whole multiples of this (e.g. 5120 for
+                                           ///< AWS IoT metering); 0 charges exact bytes
 
     /**
      * @brief Validate budget configuration
@@ -62,12 +83,67 @@ struct BudgetConfig
             return ESP_ERR_INVALID_ARG;
         }
 
+        if (reviveRate < 0.0f || reviveRate > 1000000.0f)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        if (unit == BudgetUnit::MESSAGES && meteringBytes != 0)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
         return ESP_OK;
     }
 };
 
+/**
+ * @brief Named budget for the topics under a set of prefixes
+ *
+ * A publish matching a class consumes from the class budget as well as
+ * the global one. When the global budget is exhausted, deferred publishes
+ * are sent in proportion to their class weight as it refills.
+ */
+struct BudgetClassConfig
+{
+    std::string name;                       ///< Class name (for logs)
+    std::vector<std::string> topicPrefixes; ///< Topics starting with any of these (longest prefix wins)
+    BudgetConfig budget;                    ///< Class capacity and refill rate
+    uint8_t weight{1};                      ///< Share of the global budget while constrained
+    uint16_t queueDepth{0};                 ///< Publishes deferred while over budget (CoreMQTT only;
+                                            ///< 0 rejects them)
+
+    /**
+     * @brief Validate budget class configuration
+     * @return ESP_OK if valid, error code otherwise
+     */
+    esp_err_t validate() const
+    {
+        if (name.empty() || topicPrefixes.empty() || weight == 0 || queueDepth > 1024)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        for (const std::string &prefix : topicPrefixes)
+        {
+            if (prefix.empty())
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+
+        return budget.validate();
+    }
+};
+
 /**
  * @brief Reconnection strategy configuration
+ *
+ * EspMqttClient hands initialDelay to ESP-MQTT. CoreMqttClient reconnects
+ * through ITlsTransport::connectAsync() when MqttConfig::tls is set, with
+ * full-jitter backoff from initialDelay doubling up to maxDelay (the
+ * multiplier and jitterFactor are not used) and a random delay before the
+ * first attempt, so devices dropped together do not return together.
  */
 struct ReconnectConfig
 {
@@ -149,6 +225,254 @@ struct WillConfig
     }
 };
 
+/**
+ * @brief Offline publish spool configuration (CoreMQTT only)
+ *
+ * When enabled, publishes made while disconnected are appended to segment
+ * files in `directory` and replayed after the next connect. The directory
+ * must be on a filesystem the application has mounted (e.g. LittleFsStorage).
+ */
+struct SpoolConfig
+{
+    bool enabled{false};                           ///< Spool publishes while disconnected
+    std::string directory{"/littlefs/mqtt_spool"}; ///< Segment directory (created if missing)
+    uint32_t segmentSize{16 * 1024};               ///< Segment file size before rolling over
+    uint32_t maxSegments{8};                       ///< Oldest segment dropped beyond this count
+    uint32_t drainBatch{4};                        ///< Records replayed per process loop iteration
+
+    /**
+     * @brief Validate spool configuration
+     * @return ESP_OK if valid, error code otherwise
+     */
+    esp_err_t validate() const
+    {
+        if (!enabled)
+        {
+            return ESP_OK;
+        }
+
+        if (directory.empty() || segmentSize < 256 || maxSegments == 0 || drainBatch == 0)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        return ESP_OK;
+    }
+};
+
+/**
+ * @brief Inbound message dispatch configuration
+ *
+ * With workers > 0, message callbacks run on a pool of worker tasks
+ * instead of the task that receives from the network. Messages on one
+ * topic always go to the same worker, so they are delivered in order.
+ */
+struct DispatchConfig
+{
+    uint32_t workers{0};           ///< Callback worker tasks (0 = call callbacks on the receiving task)
+    uint32_t queueDepth{16};       ///< Messages queued per worker
+    uint32_t enqueueTimeoutMs{10}; ///< Wait for queue space before a message is dropped
+    /// Worker task stack size in bytes (default from the task profile)
+    uint32_t stackSize{task::getSettings(task::TaskRole::MQTT_DISPATCH).stackSize};
+    /// Worker task priority (default from the task profile)
+    uint32_t priority{task::getSettings(task::TaskRole::MQTT_DISPATCH).priority};
+
+    /**
+     * @brief Validate dispatch configuration
+     * @return ESP_OK if valid, error code otherwise
+     */
+    esp_err_t validate() const
+    {
+        if (workers == 0)
+        {
+            return ESP_OK;
+        }
+
+        if (workers > 8 || queueDepth == 0 || queueDepth > 256 || stackSize < 2048 || priority > 24)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        return ESP_OK;
+    }
+};
+
+/**
+ * @brief Buffers for reassembling fragmented inbound messages (ESP-MQTT only)
+ *
+ * ESP-MQTT hands a message larger than networkBufferSize to the client in
+ * several MQTT_EVENT_DATA events. A message that fits a block is copied
+ * into a block allocated up front and delivered whole; larger messages
+ * (and all fragmented messages when blocks is 0) only reach
+ * subscribeStream() callbacks, which see each fragment in place.
+ */
+struct InboundPoolConfig
+{
+    uint32_t blocks{0};       ///< Reassembly buffers (0 = no reassembly)
+    uint32_t blockSize{8192}; ///< Largest message a block can reassemble, in bytes
+
+    /**
+     * @brief Validate inbound pool configuration
+     * @return ESP_OK if valid, error code otherwise
+     */
+    esp_err_t validate() const
+    {
+        if (blocks == 0)
+        {
+            return ESP_OK;
+        }
+
+        if (blocks > 8 || blockSize < 1024 || blockSize > 1024 * 1024)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        return ESP_OK;
+    }
+};
+
+/**
+ * @brief Topics to coalesce and how often each may be sent
+ */
+struct CoalesceRule
+{
+    std::string topicFilter;  ///< Topic filter, wildcards allowed (e.g. "sensors/+/value")
+    uint32_t intervalMs{500}; ///< Least time between two publishes on one matching topic
+};
+
+/**
+ * @brief Publish coalescing configuration (see MqttCoalescer)
+ *
+ * A topic matching a rule is published at most once per interval. Values
+ * published in between replace the one waiting, so only the latest is sent.
+ * Topics matching no rule are published directly.
+ */
+struct CoalesceConfig
+{
+    std::vector<CoalesceRule> rules; ///< Coalesced topics (the shortest matching interval applies)
+    uint32_t maxTopics{16};          ///< Topics with a last-value slot; further topics are published directly
+    uint32_t retryMs{100};           ///< Wait before resending a value the client refused (budget, offline)
+    /// Flush task stack size in bytes (default from the task profile)
+    uint32_t stackSize{task::getSettings(task::TaskRole::MQTT_COALESCE).stackSize};
+    /// Flush task priority (default from the task profile)
+    uint32_t priority{task::getSettings(task::TaskRole::MQTT_COALESCE).priority};
+
+    /**
+     * @brief Validate coalescing configuration
+     * @return ESP_OK if valid, error code otherwise
+     */
+    esp_err_t validate() const
+    {
+        if (maxTopics == 0 || maxTopics > 256 || retryMs == 0 || stackSize < 2048 || priority > 24)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        for (const CoalesceRule &rule : rules)
+        {
+            if (rule.topicFilter.empty() || rule.intervalMs == 0)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+
+        return ESP_OK;
+    }
+};
+
+/**
+ * @brief Payload compression configuration (see MqttCompressor)
+ *
+ * A compressed publish goes to the topic plus `topicSuffix`, which tells
+ * the receiver to decompress it. Payloads that do not shrink are sent
+ * unchanged on the original topic.
+ */
+struct CompressionConfig
+{
+    uint32_t minPayloadSize{128};    ///< Smaller payloads are sent uncompressed
+    std::string topicSuffix{"/lz"};  ///< Topic level appended to compressed publishes
+    uint32_t maxInflatedSize{16384}; ///< Larger inbound payloads are rejected (decompression bomb guard)
+
+    /**
+     * @brief Validate compression configuration
+     * @return ESP_OK if valid, error code otherwise
+     */
+    esp_err_t validate() const
+    {
+        if (topicSuffix.size() < 2 || topicSuffix[0] != '/' ||
+            topicSuffix.find_first_of("+#", 1) != std::string::npos || maxInflatedSize == 0)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        return ESP_OK;
+    }
+};
+
+/**
+ * @brief One file of an AWS IoT MQTT stream to download (see MqttFileDownloader)
+ *
+ * Blocks are requested on $aws/things/<thingName>/streams/<streamId>/get/cbor.
+ * RAM use is window * blockSize for the reorder buffer, whatever the file size.
+ */
+struct FileStreamConfig
+{
+    std::string thingName;                         ///< Thing the stream is addressed to
+    std::string streamId;                          ///< Stream ID (from the OTA job document)
+    uint32_t fileId{0};                            ///< File within the stream
+    uint32_t fileSize{0};                          ///< Bytes to download
+    uint32_t blockSize{4096};                      ///< Bytes per block (256 to 131072, as the service allows)
+    uint32_t window{4};                            ///< Block requests in flight
+    uint32_t requestTimeoutMs{5000};               ///< Re-request a block not received by then
+    uint32_t maxRetries{5};                        ///< Re-requests of one block before the download fails
+    MqttQos qos{MqttQos::AT_MOST_ONCE};            ///< QoS of requests and of the data subscription
+    std::optional<std::array<uint8_t, 32>> sha256; ///< Expected SHA-256 of the file, checked at the end
+
+    /**
+     * @brief Validate file stream configuration
+     * @return ESP_OK if valid, error code otherwise
+     */
+    esp_err_t validate() const
+    {
+        if (thingName.empty() || streamId.empty() || fileSize == 0 || blockSize < 256 || blockSize > 131072 ||
+            window == 0 || window > 32 || requestTimeoutMs == 0)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        return ESP_OK;
+    }
+};
+
+/**
+ * @brief AWS IoT Device Shadow configuration (see ShadowClient)
+ */
+struct ShadowConfig
+{
+    std::string thingName;               ///< Thing that owns the shadow
+    std::string shadowName;              ///< Named shadow; empty for the classic shadow
+    uint32_t coalesceMs{1000};           ///< Changes within this window go out in one update
+    uint32_t retryMs{5000};              ///< Wait before resending an update the client refused
+    uint32_t maxDocumentSize{8192};      ///< Largest update or cached document (the service allows 8 KB)
+    std::string cacheKey{"shadow_rep"};  ///< NVS key of the cached reported document (at most 15 characters)
+    MqttQos qos{MqttQos::AT_LEAST_ONCE}; ///< QoS of updates and of the delta subscription
+
+    /**
+     * @brief Validate shadow configuration
+     * @return ESP_OK if valid, error code otherwise
+     */
+    esp_err_t validate() const
+    {
+        if (thingName.empty() || retryMs == 0 || maxDocumentSize < 64 || cacheKey.empty() ||
+            cacheKey.size() > 15)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        return ESP_OK;
+    }
+};
+
 /**
  * @brief Complete MQTT client configuration
  */
@@ -165,13 +489,27 @@ public:
     uint32_t networkBufferSize{4096};   ///< Network buffer size
     bool autoStartProcessLoop{true};    ///< Auto-start ProcessLoop task on connect (CoreMQTT only)
     uint32_t processLoopTimeoutMs{100}; ///< ProcessLoop timeout per call in milliseconds (CoreMQTT only)
-    uint32_t processLoopDelayMs{10}; ///< ProcessLoop task sleep delay between calls in milliseconds (CoreMQTT
-                                     ///< only)
-
-    std::optional<TlsConfig> tls; ///< TLS configuration (optional - if not set, transport must be injected)
-    BudgetConfig budget;          ///< Budgeting configuration
-    ReconnectConfig reconnect;    ///< Reconnection configuration
-    WillConfig will;              ///< Last Will and Testament
+    uint32_t processLoopDelayMs{10};    ///< ProcessLoop task pace when the transport cannot wait for data,
+                                        ///< or while spooled or deferred publishes drain (CoreMQTT only)
+    uint32_t processLoopIdleMs{1000};   ///< Longest the ProcessLoop task blocks without traffic (CoreMQTT
+                                        ///< only)
+    uint32_t publishQueueDepth{8};      ///< publishAsync() slots, queued plus awaiting ACK (CoreMQTT only)
+    uint32_t publishRecordCount{16};    ///< coreMQTT QoS 1/2 state records per direction (CoreMQTT only)
+    uint32_t maxTopicsPerSubscribe{8};  ///< Topic filters packed into one SUBSCRIBE/UNSUBSCRIBE packet
+    uint32_t retransmitSlots{16};       ///< QoS 1/2 publishes kept for DUP resend (cleanSession=false,
+                                        ///< CoreMQTT only; 0 disables)
+    uint32_t retransmitSlotSize{1024};  ///< Bytes per retransmit slot (topic plus payload)
+    uint32_t topicTableSize{32};        ///< Topics registerTopic() can intern (0 disables handles)
+
+    std::optional<TlsConfig> tls;                 ///< TLS configuration (optional - if not set, transport
+                                                  ///< must be injected)
+    BudgetConfig budget;                          ///< Budgeting configuration
+    std::vector<BudgetClassConfig> budgetClasses; ///< Per-topic budgets (at most 16)
+    ReconnectConfig reconnect;                    ///< Reconnection configuration
+    WillConfig will;                              ///< Last Will and Testament
+    SpoolConfig spool;                            ///< Offline publish spool (CoreMQTT only)
+    DispatchConfig dispatch;                      ///< Callback worker pool
+    InboundPoolConfig inboundPool;                ///< Fragment reassembly buffers (ESP-MQTT only)
 
     /**
      * @brief Validate complete configuration
@@ -214,6 +552,41 @@ public:
             return ESP_ERR_INVALID_ARG; // Delay should be 1-1000ms
         }
 
+        if (processLoopIdleMs < 10 || processLoopIdleMs > 60000)
+        {
+            return ESP_ERR_INVALID_ARG; // Idle wait should be 10-60000ms
+        }
+
+        if (publishQueueDepth == 0 || publishQueueDepth > 64)
+        {
+            return ESP_ERR_INVALID_ARG; // Queue depth should be 1-64
+        }
+
+        if (publishRecordCount == 0 || publishRecordCount > 1024)
+        {
+            return ESP_ERR_INVALID_ARG; // State records should be 1-1024
+        }
+
+        if (maxTopicsPerSubscribe == 0 || maxTopicsPerSubscribe > 64)
+        {
+            return ESP_ERR_INVALID_ARG; // Filters per packet should be 1-64
+        }
+
+        if (retransmitSlots > 64)
+        {
+            return ESP_ERR_INVALID_ARG; // Retransmit slots should be 0-64
+        }
+
+        if (retransmitSlots > 0 && (retransmitSlotSize < 64 || retransmitSlotSize > 65536))
+        {
+            return ESP_ERR_INVALID_ARG; // Slot size should be 64 bytes - 64 KB
+        }
+
+        if (topicTableSize > 1024)
+        {
+            return ESP_ERR_INVALID_ARG; // Interned topics should be 0-1024
+        }
+
         // Validate sub-configurations
         // TLS is optional - only validate if present
         if (tls.has_value())
@@ -235,6 +608,28 @@ public:
         if (err != ESP_OK)
             return err;
 
+        err = spool.validate();
+        if (err != ESP_OK)
+            return err;
+
+        err = dispatch.validate();
+        if (err != ESP_OK)
+            return err;
+
+        err = inboundPool.validate();
+        if (err != ESP_OK)
+            return err;
+
+        if (budgetClasses.size() > 16)
+            return ESP_ERR_INVALID_ARG;
+
+        for (const BudgetClassConfig &budgetClass : budgetClasses)
+        {
+            err = budgetClass.validate();
+            if (err != ESP_OK)
+                return err;
+        }
+
         return ESP_OK;
     }
 
@@ -281,6 +676,23 @@ public:
         return *this;
     }
 
+    BudgetConfigBuilder &reviveRate(float messagesPerSecond)
+    {
+        config_.reviveRate = messagesPerSecond;
+        return *this;
+    }
+
+    /**
+     * @brief Count bytes instead of messages
+     * @param meteringBytes Round each publish up to a multiple of this (0 = exact bytes)
+     */
+    BudgetConfigBuilder &bytes(uint32_t meteringBytes = 0)
+    {
+        config_.unit = BudgetUnit::BYTES;
+        config_.meteringBytes = meteringBytes;
+        return *this;
+    }
+
     BudgetConfig build()
     {
         return config_;
@@ -439,6 +851,10 @@ public:
     /**
      * @brief Set ProcessLoop task sleep delay in milliseconds (CoreMQTT only)
      *
+     * Only used when the transport does not support waitForData(), and as
+     * the pace while spooled publishes are replayed. Otherwise the task
+     * sleeps until data arrives.
+     *
      * @param delayMs Delay between ProcessLoop iterations (1-1000ms)
      * @return Reference to builder for chaining
      *
@@ -452,6 +868,111 @@ public:
         return *this;
     }
 
+    /**
+     * @brief Set the longest the ProcessLoop task sleeps without traffic (CoreMQTT only)
+     *
+     * The task blocks until socket data arrives, the next keep-alive ping
+     * is due or it is stopped. This cap bounds how late a missing PINGRESP
+     * is noticed.
+     *
+     * @param idleMs Maximum idle wait (10-60000ms)
+     * @return Reference to builder for chaining
+     *
+     * @note Default is 1000ms
+     */
+    MqttConfigBuilder &processLoopIdle(uint32_t idleMs)
+    {
+        config_.processLoopIdleMs = idleMs;
+        return *this;
+    }
+
+    /**
+     * @brief Set the number of publishAsync() slots (CoreMQTT only)
+     *
+     * @param depth Requests that may be queued or awaiting acknowledgement at once (1-64)
+     * @return Reference to builder for chaining
+     *
+     * @note Slots are allocated once at construction and reused
+     * @note Default is 8
+     */
+    MqttConfigBuilder &publishQueueDepth(uint32_t depth)
+    {
+        config_.publishQueueDepth = depth;
+        return *this;
+    }
+
+    /**
+     * @brief Set how many QoS 1/2 publishes coreMQTT can track at once
+     *
+     * One record per unacknowledged outgoing publish, and one per incoming
+     * QoS 2 publish awaiting PUBREL. A publish made with every outgoing
+     * record in use fails; publishAsync() queues it instead.
+     *
+     * @param count Records per direction (1-1024, 8 bytes each)
+     * @return Reference to builder for chaining
+     *
+     * @note Default is 16
+     */
+    MqttConfigBuilder &publishRecordCount(uint32_t count)
+    {
+        config_.publishRecordCount = count;
+        return *this;
+    }
+
+    /**
+     * @brief Set how many topic filters share one SUBSCRIBE/UNSUBSCRIBE packet
+     *
+     * Applies to subscribeMany(), unsubscribeMany() and resubscription after
+     * a reconnect. Packets are also kept within networkBufferSize.
+     *
+     * @param count Filters per packet (1-64)
+     * @return Reference to builder for chaining
+     *
+     * @note AWS IoT Core accepts at most 8 filters per SUBSCRIBE
+     * @note Default is 8
+     */
+    MqttConfigBuilder &maxTopicsPerSubscribe(uint32_t count)
+    {
+        config_.maxTopicsPerSubscribe = count;
+        return *this;
+    }
+
+    /**
+     * @brief Size the store of unacknowledged QoS 1/2 publishes
+     *
+     * With cleanSession(false), publishes still awaiting PUBACK/PUBREC are
+     * kept in fixed slots and sent again with DUP set when the broker
+     * resumes the session. Publishes larger than a slot are sent but not
+     * kept.
+     *
+     * @param slots Publishes kept at once (0-64, 0 disables)
+     * @param slotSize Bytes per slot for topic plus payload (64 bytes - 64 KB)
+     * @return Reference to builder for chaining
+     *
+     * @note Allocated once at construction, only when cleanSession is false
+     * @note Default is 16 slots of 1024 bytes
+     */
+    MqttConfigBuilder &retransmitStore(uint32_t slots, uint32_t slotSize)
+    {
+        config_.retransmitSlots = slots;
+        config_.retransmitSlotSize = slotSize;
+        return *this;
+    }
+
+    /**
+     * @brief Size the table of topics interned by registerTopic()
+     *
+     * @param count Topics that can be registered (0-1024, 0 disables handles)
+     * @return Reference to builder for chaining
+     *
+     * @note Default is 32
+     */
+    MqttConfigBuilder &topicTableSize(uint32_t count)
+    {
+        config_.topicTableSize = count;
+        return *this;
+    }
+
     /**
      * @brief Set TLS configuration
      *
@@ -503,6 +1024,49 @@ public:
         return *this;
     }
 
+    /**
+     * @brief Set offline publish spool configuration (CoreMQTT only)
+     *
+     * @note The spool directory must be on a mounted filesystem before connect()
+     */
+    MqttConfigBuilder &spoolConfig(const SpoolConfig &spoolConf)
+    {
+        config_.spool = spoolConf;
+        return *this;
+    }
+
+    /**
+     * @brief Set the callback worker pool configuration
+     *
+     * @note Callbacks then run on worker tasks; make them safe to call concurrently across topics
+     */
+    MqttConfigBuilder &dispatchConfig(const DispatchConfig &dispatchConf)
+    {
+        config_.dispatch = dispatchConf;
+        return *this;
+    }
+
+    /**
+     * @brief Reassemble fragmented messages of up to blockSize bytes (ESP-MQTT only)
+     */
+    MqttConfigBuilder &inboundPool(uint32_t blocks, uint32_t blockSize)
+    {
+        config_.inboundPool.blocks = blocks;
+        config_.inboundPool.blockSize = blockSize;
+        return *this;
+    }
+
+    /**
+     * @brief Add a per-topic budget class
+     *
+     * @note Callers without a class still share the global budget
+     */
+    MqttConfigBuilder &budgetClass(const BudgetClassConfig &budgetClassConf)
+    {
+        config_.budgetClasses.push_back(budgetClassConf);
+        return *this;
+    }
+
     MqttConfigBuilder &willTopic(const std::string &topic)
     {
         config_.will.topic = topic;
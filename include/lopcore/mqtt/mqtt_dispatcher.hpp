@@ -0,0 +1,200 @@
+/**
+ * @file mqtt_dispatcher.hpp
+ * @brief Worker pool that runs MQTT message callbacks off the network task
+ *
+ * Both clients otherwise call subscription callbacks on the task that
+ * receives from the network, with their subscription lock held, so one
+ * slow callback delays every other message and keep-alive. The dispatcher
+ * copies each message into a worker queue and returns; the worker runs
+ * the callbacks.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#ifndef ESP_PLATFORM
+#include <condition_variable>
+#include <thread>
+#endif
+
+#include <esp_err.h>
+
+#include "mqtt_config.hpp"
+#include "mqtt_types.hpp"
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+/**
+ * @brief Callbacks registered for one topic filter
+ *
+ * Shared between the subscription table and queued messages, so a
+ * message already queued still reaches a handler that is unsubscribed
+ * meanwhile.
+ */
+struct MqttHandler
+{
+    MessageCallback callback;                 ///< Owning callback (message copied once)
+    MessageViewCallback viewCallback;         ///< Zero-copy callback (takes precedence)
+    MessageFragmentCallback fragmentCallback; ///< Streaming callback (whole messages are one fragment)
+
+    /**
+     * @brief Call whichever callback is set
+     * @param view Message being delivered
+     * @param copy Owning copy, made on first use and shared by later handlers
+     */
+    void invoke(const MqttMessageView &view, std::optional<MqttMessage> &copy) const
+    {
+        if (viewCallback)
+        {
+            viewCallback(view);
+        }
+        else if (fragmentCallback)
+        {
+            fragmentCallback(MqttMessageFragment{view.topic, view.payload, view.payloadLength, 0,
+                                                 view.payloadLength, view.qos, view.retained,
+                                                 view.messageId});
+        }
+        else if (callback)
+        {
+            if (!copy)
+            {
+                copy = view.toMessage();
+            }
+            callback(*copy);
+        }
+    }
+};
+
+using MqttHandlerPtr = std::shared_ptr<const MqttHandler>;
+
+/**
+ * @brief Dispatcher counters
+ */
+struct MqttDispatchStats
+{
+    uint32_t messagesDispatched{0}; ///< Messages queued to a worker
+    uint32_t messagesDropped{0};    ///< Messages dropped because their worker queue stayed full
+};
+
+/**
+ * @brief Fixed pool of callback workers with per-topic ordering
+ *
+ * Each worker owns a ring of queueDepth message slots. Slots keep their
+ * topic and payload capacity between messages, so after warm-up queuing
+ * a message does not allocate. A topic is always hashed to the same
+ * worker; different topics may run concurrently.
+ *
+ * @code
+ * MqttDispatcher dispatcher(DispatchConfig{2, 16});
+ * dispatcher.start();
+ * dispatcher.dispatch(view, handlers); // Returns once copied into a slot
+ * @endcode
+ */
+class MqttDispatcher
+{
+public:
+    explicit MqttDispatcher(const DispatchConfig &config);
+
+    /**
+     * @brief Stops the workers; messages still queued are discarded
+     */
+    ~MqttDispatcher();
+
+    MqttDispatcher(const MqttDispatcher &) = delete;
+    MqttDispatcher &operator=(const MqttDispatcher &) = delete;
+
+    /**
+     * @brief Create the worker tasks
+     * @return ESP_OK on success, ESP_ERR_INVALID_STATE if already running, ESP_FAIL if a task cannot start
+     */
+    esp_err_t start();
+
+    /**
+     * @brief Let each worker finish its current message, then stop them
+     *
+     * Must not be called from a callback.
+     */
+    void stop();
+
+    bool isRunning() const
+    {
+        return running_.load();
+    }
+
+    /**
+     * @brief Queue a message for its topic's worker
+     *
+     * Waits up to DispatchConfig::enqueueTimeoutMs for a free slot.
+     *
+     * @param view Message to copy (only read during the call)
+     * @param handlers Handlers to call, in order
+     * @return ESP_OK if queued
+     *         ESP_ERR_INVALID_STATE if not running
+     *         ESP_ERR_TIMEOUT if the queue stayed full (message dropped)
+     */
+    esp_err_t dispatch(const MqttMessageView &view, const std::vector<MqttHandlerPtr> &handlers);
+
+    /**
+     * @brief Worker a topic is delivered by
+     */
+    static size_t workerFor(std::string_view topic, size_t workerCount);
+
+    MqttDispatchStats getStats() const;
+
+private:
+    /**
+     * @brief One queued message
+     */
+    struct Job
+    {
+        MqttMessage message;                  ///< Owned copy of the message
+        std::vector<MqttHandlerPtr> handlers; ///< Handlers to call
+    };
+
+    /**
+     * @brief Worker task state; slots_[tail] is in use until its callbacks return
+     */
+    struct Worker
+    {
+        MqttDispatcher *owner{nullptr}; ///< Back-reference for the task entry
+        std::vector<Job> slots;         ///< Ring of queueDepth jobs
+        size_t head{0};                 ///< Next slot to fill
+        size_t tail{0};                 ///< Next slot to run
+        size_t count{0};                ///< Queued plus running jobs
+        std::mutex mutex;               ///< Guards head, tail and count
+#ifdef ESP_PLATFORM
+        void *task{nullptr};             ///< TaskHandle_t of the worker
+        std::atomic<bool> stopped{true}; ///< Set by the worker on exit
+#else
+        std::thread thread;           ///< Host worker thread
+        std::condition_variable wake; ///< Signals a queued job or stop
+#endif
+    };
+
+    static void workerEntry(void *arg);
+    void runWorker(Worker &worker);
+    void wakeWorker(Worker &worker);
+
+    const DispatchConfig config_;                  ///< Configuration
+    std::vector<std::unique_ptr<Worker>> workers_; ///< One per worker task
+    std::atomic<bool> running_;                    ///< Workers keep running while set
+    std::atomic<uint32_t> dispatched_;             ///< Messages queued
+    std::atomic<uint32_t> dropped_;                ///< Messages dropped on a full queue
+};
+
+} // namespace mqtt
+} // namespace lopcore
@@ -0,0 +1,439 @@
+/**
+ * @file mqtt_file_downloader.hpp
+ * @brief Pipelined AWS IoT MQTT file stream download straight to storage or OTA
+ *
+ * AWS IoT delivers firmware and large files over MQTT file streams: the
+ * device publishes a CBOR GetStream request per block and the service
+ * answers with a CBOR data block. Waiting for each block before asking for
+ * the next makes every block cost a round trip. MqttFileDownloader keeps
+ * FileStreamConfig::window requests in flight, decodes each block in place
+ * from the received message and hands the file, in order, to a sink while
+ * hashing it:
+ *
+ * @code
+ * FileStreamConfig stream;
+ * stream.thingName = "sensor-42";
+ * stream.streamId = jobStreamId;
+ * stream.fileSize = jobFileSize;
+ * stream.sha256 = jobSha256;
+ *
+ * StorageFileSink sink(sdCard.openWriter("firmware.bin"));
+ * MqttFileDownloader download(client, stream, sink);
+ * download.start();
+ * while (download.isActive()) {
+ *     vTaskDelay(pdMS_TO_TICKS(std::min<uint32_t>(download.poll(), 100)));
+ * }
+ * @endcode
+ *
+ * Blocks that arrive early wait in a reorder buffer of window * blockSize
+ * bytes allocated at start(), so RAM use does not grow with the file.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <esp_err.h>
+#include <esp_timer.h>
+
+#ifdef ESP_PLATFORM
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#endif
+
+#include "lopcore/storage/storage_stream.hpp"
+
+#include "imqtt_client.hpp"
+#include "mqtt_config.hpp"
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+/**
+ * @brief Where a download writes the file, in order from offset 0
+ */
+class IFileStreamSink
+{
+public:
+    virtual ~IFileStreamSink() = default;
+
+    /**
+     * @brief Prepare for a file of size bytes
+     */
+    virtual esp_err_t begin(size_t size)
+    {
+        (void)size;
+        return ESP_OK;
+    }
+
+    /**
+     * @brief Append the next length bytes of the file
+     */
+    virtual esp_err_t write(const uint8_t *data, size_t length) = 0;
+
+    /**
+     * @brief The whole file was written and its hash matched
+     */
+    virtual esp_err_t finish()
+    {
+        return ESP_OK;
+    }
+
+    /**
+     * @brief The download failed; discard what was written
+     */
+    virtual void abort()
+    {
+    }
+};
+
+/**
+ * @brief Sink writing to a file stream from a storage backend's openWriter()
+ *
+ * Works with SdCardStorage, LittleFsStorage and SpiffsStorage. finish()
+ * syncs the file; abort() closes it, leaving the partial file to the
+ * caller.
+ */
+class StorageFileSink : public IFileStreamSink
+{
+public:
+    explicit StorageFileSink(StorageWriter writer) : writer_(std::move(writer))
+    {
+    }
+
+    esp_err_t begin(size_t size) override
+    {
+        (void)size;
+        return writer_.isOpen() ? ESP_OK : ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t write(const uint8_t *data, size_t length) override
+    {
+        return writer_.write(data, length) ? ESP_OK : ESP_FAIL;
+    }
+
+    esp_err_t finish() override
+    {
+        bool synced = writer_.sync();
+        return writer_.close() && synced ? ESP_OK : ESP_FAIL;
+    }
+
+    void abort() override
+    {
+        writer_.close();
+    }
+
+private:
+    StorageWriter writer_;
+};
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Sink writing a firmware image to the next OTA partition
+ *
+ * finish() validates the image with esp_ota_end() and, if bootOnFinish,
+ * makes it the boot partition; the application decides when to restart.
+ */
+class OtaPartitionSink : public IFileStreamSink
+{
+public:
+    /**
+     * @param partition Partition to write (nullptr = the next update partition)
+     * @param bootOnFinish Set the partition to boot once the image is complete
+     */
+    explicit OtaPartitionSink(const esp_partition_t *partition = nullptr, bool bootOnFinish = true);
+    ~OtaPartitionSink() override;
+
+    esp_err_t begin(size_t size) override;
+    esp_err_t write(const uint8_t *data, size_t length) override;
+    esp_err_t finish() override;
+    void abort() override;
+
+private:
+    const esp_partition_t *partition_;
+    bool bootOnFinish_;
+    esp_ota_handle_t handle_;
+};
+#endif
+
+/**
+ * @brief Incremental SHA-256 (mbedTLS, hardware-accelerated, on ESP32)
+ */
+class Sha256
+{
+public:
+    Sha256();
+    ~Sha256();
+
+    Sha256(const Sha256 &) = delete;
+    Sha256 &operator=(const Sha256 &) = delete;
+
+    void update(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Digest of everything passed to update(); starts a new hash
+     */
+    std::array<uint8_t, 32> finish();
+
+private:
+#ifdef ESP_PLATFORM
+    mbedtls_sha256_context context_;
+#else
+    void compress(const uint8_t *block);
+    void reset();
+
+    std::array<uint32_t, 8> state_;
+    std::array<uint8_t, 64> buffer_;
+    uint64_t length_; ///< Bytes hashed so far
+#endif
+};
+
+/**
+ * @brief Encoding of the CBOR messages of AWS IoT MQTT file streams
+ */
+namespace file_stream
+{
+
+/**
+ * @brief A data block response, pointing into the received payload
+ */
+struct DataBlock
+{
+    uint32_t fileId{0};
+    uint32_t blockId{0};
+    uint32_t blockSize{0};
+    const uint8_t *payload{nullptr};
+    size_t payloadLength{0};
+};
+
+/**
+ * @brief Encode a GetStream request for count blocks from firstBlock
+ *
+ * Map of "c" client token, "f" file ID, "l" block size, "o" first block
+ * and "n" block count.
+ *
+ * @return Bytes written, 0 if size is too small
+ */
+size_t encodeGetRequest(uint8_t *buffer,
+                        size_t size,
+                        const std::string &clientToken,
+                        uint32_t fileId,
+                        uint32_t blockSize,
+                        uint32_t firstBlock,
+                        uint32_t count);
+
+/**
+ * @brief Decode a data block response ("f", "i", "l", "p") without copying the payload
+ *
+ * Keys may come in any order; unknown keys are skipped.
+ *
+ * @return true if every field was present and well formed
+ */
+bool decodeDataBlock(const uint8_t *data, size_t length, DataBlock &block);
+
+} // namespace file_stream
+
+/**
+ * @brief Download progress
+ */
+enum class FileDownloadState : uint8_t
+{
+    IDLE,        ///< start() not called yet
+    DOWNLOADING, ///< Requests in flight
+    COMPLETE,    ///< File written, hash matched, sink finished
+    FAILED       ///< See getResult()
+};
+
+/**
+ * @brief Download counters
+ */
+struct FileDownloadStats
+{
+    uint32_t requests{0};   ///< GetStream requests published
+    uint32_t retries{0};    ///< Requests repeated after a timeout
+    uint32_t reordered{0};  ///< Blocks held until the blocks before them arrived
+    uint32_t duplicates{0}; ///< Blocks received again (a retry crossed the answer), ignored
+    uint32_t malformed{0};  ///< Responses that did not decode, ignored
+};
+
+/**
+ * @brief Downloads one file of an MQTT stream through any IMqttClient
+ *
+ * Data blocks are handled on the client's receive task: a block that is
+ * next in the file goes straight from the message to the hash and the
+ * sink, a later one is copied into its reorder slot, and the requests
+ * that refill the window are published from that task too: the client
+ * must accept publish() from a subscription callback (ESP-MQTT, or
+ * CoreMQTT with dispatch workers). poll() re-requests blocks that timed
+ * out; call it from any task. A rejected request, a sink error or a block
+ * that exhausts its retries fails the download.
+ */
+class MqttFileDownloader
+{
+public:
+    /**
+     * @brief Monotonic time source in microseconds
+     */
+    using TimeSource = int64_t (*)();
+
+    /**
+     * @brief Called once with the final result (ESP_OK when COMPLETE)
+     */
+    using CompletionCallback = std::function<void(esp_err_t result)>;
+
+    /**
+     * @param client Connected client
+     * @param config Stream, file and pipelining settings
+     * @param sink Receives the file; must outlive the downloader
+     * @param timeSource Monotonic clock (esp_timer_get_time unless testing)
+     */
+    MqttFileDownloader(std::shared_ptr<IMqttClient> client,
+                       const FileStreamConfig &config,
+                       IFileStreamSink &sink,
+                       TimeSource timeSource = esp_timer_get_time);
+
+    /**
+     * @brief Unsubscribes; an unfinished download is aborted
+     */
+    ~MqttFileDownloader();
+
+    MqttFileDownloader(const MqttFileDownloader &) = delete;
+    MqttFileDownloader &operator=(const MqttFileDownloader &) = delete;
+
+    /**
+     * @brief Subscribe to the stream's data and rejected topics and send the first window of requests
+     * @return ESP_OK on success
+     *         ESP_ERR_INVALID_ARG if the configuration is invalid
+     *         ESP_ERR_INVALID_STATE if already started
+     *         ESP_ERR_NO_MEM if the reorder buffer cannot be allocated
+     *         Otherwise the sink's or the client's error
+     */
+    esp_err_t start(CompletionCallback onComplete = nullptr);
+
+    /**
+     * @brief Stop and abort the sink; the result becomes ESP_ERR_INVALID_STATE
+     */
+    void cancel();
+
+    /**
+     * @brief Re-request blocks whose response is overdue
+     * @return Milliseconds until the next request times out, UINT32_MAX once finished
+     */
+    uint32_t poll();
+
+    FileDownloadState getState() const
+    {
+        return state_.load();
+    }
+
+    bool isActive() const
+    {
+        return getState() == FileDownloadState::DOWNLOADING;
+    }
+
+    /**
+     * @brief ESP_OK when complete, ESP_ERR_INVALID_CRC on a hash mismatch,
+     *        ESP_ERR_TIMEOUT when a block exhausted its retries, ESP_ERR_NOT_FOUND
+     *        when the service rejected a request, otherwise the sink's error
+     */
+    esp_err_t getResult() const;
+
+    /**
+     * @brief Bytes handed to the sink so far
+     */
+    size_t getBytesWritten() const;
+
+    /**
+     * @brief SHA-256 of the file, valid once COMPLETE
+     */
+    std::array<uint8_t, 32> getSha256() const;
+
+    FileDownloadStats getStats() const;
+
+private:
+    /**
+     * @brief A block in the window
+     */
+    struct Slot
+    {
+        uint32_t block{0};    ///< Block this slot holds or awaits
+        bool received{false}; ///< Data copied in, waiting for the blocks before it
+        uint32_t length{0};   ///< Bytes received
+        uint32_t retries{0};  ///< Re-requests so far
+        int64_t dueUs{0};     ///< When the request times out
+    };
+
+    static constexpr size_t MAX_TOKEN_LENGTH = 32; ///< Client token (the client ID) is cut to this
+
+    uint32_t blockCount() const
+    {
+        return (config_.fileSize + config_.blockSize - 1) / config_.blockSize;
+    }
+
+    uint32_t blockLength(uint32_t block) const
+    {
+        return block + 1 < blockCount() ? config_.blockSize : config_.fileSize - block * config_.blockSize;
+    }
+
+    void onData(const MqttMessage &message);
+    void onRejected(const MqttMessage &message);
+
+    /**
+     * @brief Write a block and then every held block after it (mutex held)
+     */
+    esp_err_t deliver(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Fill the window with requests for blocks not yet asked for (mutex held)
+     */
+    void fillWindow(int64_t nowUs, std::vector<uint32_t> &toRequest);
+
+    /**
+     * @brief Publish a request per block (mutex not held)
+     */
+    esp_err_t sendRequests(const std::vector<uint32_t> &blocks);
+
+    /**
+     * @brief Stop, abort or finish the sink and report result (mutex held)
+     */
+    void complete(esp_err_t result);
+
+    void unsubscribe();
+
+    std::shared_ptr<IMqttClient> client_; ///< Client that carries the stream
+    const FileStreamConfig config_;       ///< Configuration
+    IFileStreamSink &sink_;               ///< Destination of the file
+    const TimeSource timeSource_;         ///< Monotonic clock
+    const std::string topicPrefix_;       ///< $aws/things/<thing>/streams/<stream>/
+    const std::string clientToken_;       ///< Sent with every request
+
+    mutable std::mutex mutex_;                  ///< Guards everything below
+    std::atomic<FileDownloadState> state_;      ///< Download state
+    esp_err_t result_;                          ///< Final result
+    std::vector<Slot> slots_;                   ///< Block b lives in slots_[b % window]
+    std::vector<uint8_t> reorder_;              ///< window * blockSize bytes, slot i at i * blockSize
+    uint32_t nextBlock_;                        ///< Next block for the sink
+    uint32_t nextRequest_;                      ///< Next block not yet requested
+    size_t bytesWritten_;                       ///< Bytes handed to the sink
+    Sha256 hash_;                               ///< Hash of the bytes handed to the sink
+    std::array<uint8_t, 32> digest_;            ///< Final hash
+    FileDownloadStats stats_;                   ///< Counters
+    CompletionCallback onComplete_;             ///< Completion callback
+    bool subscribed_;                           ///< Data and rejected topics subscribed
+};
+
+} // namespace mqtt
+} // namespace lopcore
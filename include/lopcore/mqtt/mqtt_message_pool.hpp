@@ -0,0 +1,81 @@
+/**
+ * @file mqtt_message_pool.hpp
+ * @brief Fixed pool of buffers for reassembling fragmented inbound messages
+ *
+ * All blocks are allocated once at construction, so reassembling a
+ * message never touches the heap and a burst of large messages cannot
+ * fragment it.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+/**
+ * @brief Equal-sized buffers handed out and returned without locking
+ *
+ * @code
+ * MqttMessagePool pool(2, 8192);
+ * uint8_t *block = pool.acquire(); // nullptr if every block is in use
+ * ...
+ * pool.release(block);
+ * @endcode
+ */
+class MqttMessagePool
+{
+public:
+    /**
+     * @param blocks Number of buffers
+     * @param blockSize Bytes per buffer
+     */
+    MqttMessagePool(size_t blocks, size_t blockSize);
+
+    MqttMessagePool(const MqttMessagePool &) = delete;
+    MqttMessagePool &operator=(const MqttMessagePool &) = delete;
+
+    /**
+     * @brief Take a free block
+     * @return blockSize() bytes, or nullptr if every block is in use
+     */
+    uint8_t *acquire();
+
+    /**
+     * @brief Return a block from acquire() (nullptr is ignored)
+     */
+    void release(uint8_t *block);
+
+    size_t blockSize() const
+    {
+        return blockSize_;
+    }
+
+    size_t blocks() const
+    {
+        return blocks_;
+    }
+
+    /**
+     * @brief Blocks not currently acquired
+     */
+    size_t available() const;
+
+private:
+    const size_t blocks_;                       ///< Number of blocks
+    const size_t blockSize_;                    ///< Bytes per block
+    std::unique_ptr<uint8_t[]> storage_;        ///< blocks_ * blockSize_ bytes
+    std::unique_ptr<std::atomic<bool>[]> used_; ///< Per-block in-use flag
+};
+
+} // namespace mqtt
+} // namespace lopcore
@@ -0,0 +1,210 @@
+/**
+ * @file mqtt_metrics.hpp
+ * @brief Lock-free MQTT client counters and latency histograms
+ *
+ * Counters are kept per CPU core and updated with relaxed atomics, so the
+ * publish and receive paths never take a lock or contend for a cache
+ * line with the other core. Histograms use power-of-two microsecond
+ * buckets, which keeps recording to a single increment and still gives
+ * percentiles to within a factor of two.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "lopcore/metrics/metrics_registry.hpp"
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+/// Histogram buckets; bucket i counts samples of [2^(i-1), 2^i) us, the last also everything above
+constexpr size_t MQTT_HISTOGRAM_BUCKETS = 24;
+
+/**
+ * @brief Point-in-time copy of a latency histogram
+ */
+struct MqttHistogramSnapshot
+{
+    uint32_t count{0};                                      ///< Samples recorded
+    uint64_t sumUs{0};                                      ///< Sum of all samples
+    uint32_t maxUs{0};                                      ///< Largest sample
+    std::array<uint32_t, MQTT_HISTOGRAM_BUCKETS> buckets{}; ///< Samples per bucket
+
+    uint32_t meanUs() const
+    {
+        return count > 0 ? static_cast<uint32_t>(sumUs / count) : 0;
+    }
+
+    /**
+     * @brief Upper bound of the bucket holding the given percentile
+     * @param percent 1-100
+     * @return Microseconds (never above maxUs), 0 if empty
+     */
+    uint32_t percentileUs(uint32_t percent) const;
+};
+
+/**
+ * @brief Log-bucketed latency histogram, safe to record from any task
+ */
+class MqttLatencyHistogram
+{
+public:
+    void record(uint32_t us);
+    MqttHistogramSnapshot snapshot() const;
+    void reset();
+
+private:
+    std::array<std::atomic<uint32_t>, MQTT_HISTOGRAM_BUCKETS> buckets_{};
+    std::atomic<uint32_t> count_{0};
+    std::atomic<uint64_t> sumUs_{0};
+    std::atomic<uint32_t> maxUs_{0};
+};
+
+/**
+ * @brief Event counters kept by MqttMetrics
+ */
+enum class MqttCounter : uint8_t
+{
+    MESSAGES_PUBLISHED, ///< Publishes handed to the transport
+    MESSAGES_RECEIVED,  ///< Inbound messages
+    PUBLISH_ERRORS,     ///< Failed or budget-rejected publishes
+    MESSAGES_DROPPED,   ///< Inbound messages some callback missed
+    RECONNECTS,         ///< Connections lost or re-established
+    COUNT               ///< Number of counters
+};
+
+/**
+ * @brief Point-in-time copy of a client's metrics, for periodic reporting
+ */
+struct MqttMetricsSnapshot
+{
+    uint64_t messagesPublished{0};             ///< See MqttCounter
+    uint64_t messagesReceived{0};              ///< See MqttCounter
+    uint64_t publishErrors{0};                 ///< See MqttCounter
+    uint64_t messagesDropped{0};               ///< See MqttCounter
+    uint64_t reconnectCount{0};                ///< See MqttCounter
+    MqttHistogramSnapshot publishAckLatency;   ///< QoS 1/2 publish to PUBACK/PUBCOMP
+    MqttHistogramSnapshot callbackDuration;    ///< Receiving task's time delivering one message
+    MqttHistogramSnapshot processLoopDuration; ///< One coreMQTT process loop iteration (CoreMQTT only)
+
+    /**
+     * @brief Format as compact JSON, e.g. to publish on a fleet metrics topic
+     *
+     * Histograms are reported as count, p50, p90, p99 and max, in microseconds.
+     *
+     * @return Length written (excluding the terminator), 0 if it did not fit
+     */
+    size_t formatJson(char *buffer, size_t size) const;
+};
+
+/**
+ * @brief Counters and histograms of one MQTT client
+ *
+ * @code
+ * metrics.increment(MqttCounter::MESSAGES_PUBLISHED);
+ * metrics.publishSent(packetId, esp_timer_get_time());
+ * ...
+ * metrics.publishAcked(packetId, esp_timer_get_time()); // Records the ack latency
+ * @endcode
+ */
+class MqttMetrics
+{
+public:
+    MqttMetrics() = default;
+
+    MqttMetrics(const MqttMetrics &) = delete;
+    MqttMetrics &operator=(const MqttMetrics &) = delete;
+
+    /**
+     * @brief Add to a counter, in the calling core's slot
+     */
+    void increment(MqttCounter counter, uint32_t amount = 1);
+
+    /**
+     * @brief Sum of a counter over all cores
+     */
+    uint64_t total(MqttCounter counter) const;
+
+    /**
+     * @brief Note when a QoS 1/2 publish was sent
+     */
+    void publishSent(uint16_t packetId, int64_t nowUs);
+
+    /**
+     * @brief Record the ack latency of a publish passed to publishSent()
+     *
+     * Ignored if the packet was not seen, or its slot was taken by a
+     * later publish (more than ACK_SLOTS publishes in flight).
+     */
+    void publishAcked(uint16_t packetId, int64_t nowUs);
+
+    /**
+     * @brief For clients that time a publish themselves instead of by packet ID
+     */
+    MqttLatencyHistogram &publishAckLatency()
+    {
+        return publishAckLatency_;
+    }
+
+    MqttLatencyHistogram &callbackDuration()
+    {
+        return callbackDuration_;
+    }
+
+    MqttLatencyHistogram &processLoopDuration()
+    {
+        return processLoopDuration_;
+    }
+
+    MqttMetricsSnapshot snapshot() const;
+    void reset();
+
+    /**
+     * @brief Expose the counters and p99 latencies in a metrics registry
+     *
+     * Registers sampled metrics named prefix + ".published", ".received",
+     * ".publish_errors", ".dropped", ".reconnects", ".ack_p99_us" and
+     * ".callback_p99_us"; they are removed with this object.
+     */
+    void registerMetrics(metrics::MetricsRegistry &registry, std::string_view prefix);
+
+    static constexpr size_t MAX_CORES = 2;  ///< ESP32 and ESP32-S3 have two
+    static constexpr size_t ACK_SLOTS = 32; ///< Publishes timed at once (power of two)
+
+private:
+    static constexpr size_t COUNTERS = static_cast<size_t>(MqttCounter::COUNT);
+
+    /// One core's counters; 32-bit because 64-bit atomics take a lock on Xtensa
+    struct alignas(32) CoreCounters
+    {
+        std::array<std::atomic<uint32_t>, COUNTERS> values{};
+    };
+
+    /// Send time of a publish awaiting its ack (packet ID 0 = free)
+    struct AckSlot
+    {
+        std::atomic<uint16_t> packetId{0};
+        std::atomic<uint32_t> sentUs{0}; ///< Low 32 bits; differences stay exact for 71 minutes
+    };
+
+    std::array<CoreCounters, MAX_CORES> cores_;
+    std::array<AckSlot, ACK_SLOTS> ackSlots_;
+    MqttLatencyHistogram publishAckLatency_;
+    MqttLatencyHistogram callbackDuration_;
+    MqttLatencyHistogram processLoopDuration_;
+    std::vector<metrics::Registration> registrations_; ///< Declared last: removed before the rest is destroyed
+};
+
+} // namespace mqtt
+} // namespace lopcore
@@ -0,0 +1,68 @@
+/**
+ * @file mqtt_payload_codec.hpp
+ * @brief In-memory LZ compression for MQTT payloads
+ *
+ * Same LZSS token stream as the rotated log compressor, from the shared
+ * codec (compression/lzss.hpp): 4 KB window, single-probe hash match
+ * finder, and groups of one flag byte followed by up to eight tokens.
+ *
+ * A payload starts with its uncompressed length as an unsigned LEB128
+ * varint instead of the file magic, so the receiver can size its buffer
+ * and reject oversized input before decoding anything.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "lopcore/compression/lzss.hpp"
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+/**
+ * @brief Payload compressor with a fixed 4 KB match table
+ *
+ * Not thread-safe; each instance reuses its match table between calls.
+ * decompress() keeps no state and may be called from any task.
+ */
+class MqttPayloadCodec
+{
+public:
+    MqttPayloadCodec() = default;
+
+    MqttPayloadCodec(const MqttPayloadCodec &) = delete;
+    MqttPayloadCodec &operator=(const MqttPayloadCodec &) = delete;
+
+    /**
+     * @brief Compress a payload
+     * @param data Payload to compress
+     * @param length Payload size in bytes
+     * @param[out] out Compressed payload (capacity reused between calls)
+     * @return true if the result is smaller than the input; out is unspecified otherwise
+     */
+    bool compress(const uint8_t *data, size_t length, std::vector<uint8_t> &out);
+
+    /**
+     * @brief Decompress a payload made by compress()
+     * @param data Compressed payload
+     * @param length Compressed size in bytes
+     * @param maxLength Largest uncompressed size accepted
+     * @param[out] out Uncompressed payload
+     * @return false if the input is corrupt, truncated or inflates beyond maxLength
+     */
+    static bool decompress(const uint8_t *data, size_t length, size_t maxLength, std::vector<uint8_t> &out);
+
+private:
+    lzss::Encoder encoder_; ///< Match table reused between calls
+};
+
+} // namespace mqtt
+} // namespace lopcore
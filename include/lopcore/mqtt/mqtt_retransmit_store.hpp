@@ -0,0 +1,153 @@
+/**
+ * @file mqtt_retransmit_store.hpp
+ * @brief Fixed-slot store of unacknowledged QoS 1/2 publishes
+ *
+ * coreMQTT tracks only the packet ID and acknowledgement state of an
+ * outgoing publish. To resend it with DUP set after a persistent session
+ * is resumed, the topic and payload have to be kept somewhere until the
+ * broker acknowledges them. All slots share one arena allocated up front,
+ * so storing a publish never allocates.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <esp_err.h>
+
+#include "mqtt_types.hpp"
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+/**
+ * @brief Publishes awaiting PUBACK (QoS 1) or PUBREC (QoS 2), keyed by packet ID
+ *
+ * Not thread-safe; CoreMqttClient calls it with its mutex held.
+ */
+class MqttRetransmitStore
+{
+public:
+    /**
+     * @brief One stored publish; views point into the store's arena
+     */
+    struct Entry
+    {
+        uint16_t packetId;      ///< Packet ID the publish was first sent with
+        MqttQos qos;            ///< QoS level (1 or 2)
+        bool retain;            ///< Retain flag
+        std::string_view topic; ///< Topic name
+        const uint8_t *payload; ///< Payload bytes
+        size_t payloadLength;   ///< Payload size in bytes
+    };
+
+    /**
+     * @brief Allocate slotCount slots of slotSize bytes each
+     */
+    MqttRetransmitStore(size_t slotCount, size_t slotSize);
+
+    /**
+     * @brief Copy a publish into a free slot
+     *
+     * A publish already stored under the same packet ID is replaced.
+     *
+     * @return ESP_OK on success
+     *         ESP_ERR_INVALID_ARG if packetId is 0 or qos is AT_MOST_ONCE
+     *         ESP_ERR_INVALID_SIZE if topic plus payload exceed one slot
+     *         ESP_ERR_NO_MEM if every slot is in use
+     */
+    esp_err_t store(uint16_t packetId,
+                    std::string_view topic,
+                    const uint8_t *payload,
+                    size_t payloadLength,
+                    MqttQos qos,
+                    bool retain);
+
+    /**
+     * @brief Look up a stored publish
+     * @return true and fill entry if packetId is stored
+     */
+    bool find(uint16_t packetId, Entry *entry) const;
+
+    /**
+     * @brief Free the slot of an acknowledged publish
+     * @return true if packetId was stored
+     */
+    bool release(uint16_t packetId);
+
+    /**
+     * @brief Invoke fn(const Entry &) for every stored publish, oldest first
+     *
+     * fn may call release() on the entry it is given.
+     */
+    template<typename Fn>
+    void forEach(Fn &&fn)
+    {
+        for (size_t index : slotsByAge())
+        {
+            Entry entry;
+            fill(slots_[index], index, &entry);
+            fn(entry);
+        }
+    }
+
+    /**
+     * @brief Free every slot
+     */
+    void clear();
+
+    size_t size() const
+    {
+        return used_;
+    }
+
+    bool empty() const
+    {
+        return used_ == 0;
+    }
+
+    size_t capacity() const
+    {
+        return slots_.size();
+    }
+
+    size_t slotSize() const
+    {
+        return slotSize_;
+    }
+
+private:
+    struct Slot
+    {
+        uint16_t packetId{0};                ///< 0 when free
+        MqttQos qos{MqttQos::AT_LEAST_ONCE}; ///< QoS level
+        bool retain{false};                  ///< Retain flag
+        uint16_t topicLength{0};             ///< Topic bytes at the start of the slot
+        uint32_t payloadLength{0};           ///< Payload bytes after the topic
+        uint32_t sequence{0};                ///< Store order, for oldest-first resend
+    };
+
+    void fill(const Slot &slot, size_t index, Entry *entry) const;
+
+    /**
+     * @brief Indices of used slots in the order they were stored
+     */
+    std::vector<size_t> slotsByAge() const;
+
+    std::vector<Slot> slots_;    ///< Slot metadata
+    std::vector<uint8_t> arena_; ///< slots_.size() * slotSize_ bytes of topic-then-payload
+    size_t slotSize_;            ///< Bytes per slot
+    size_t used_;                ///< Slots in use
+    uint32_t nextSequence_;      ///< Sequence of the next stored publish
+};
+
+} // namespace mqtt
+} // namespace lopcore
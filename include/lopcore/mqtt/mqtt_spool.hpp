@@ -0,0 +1,204 @@
+/**
+ * @file mqtt_spool.hpp
+ * @brief Store-and-forward spool for publishes made while offline
+ *
+ * Publishes are appended to a few large segment files instead of one file
+ * per message, so thousands of spooled records cost a handful of flash
+ * files. Each record carries a CRC; a record torn by a reset is detected
+ * on replay and the rest of its segment is skipped.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <esp_err.h>
+
+#include "mqtt_config.hpp"
+#include "mqtt_types.hpp"
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+/**
+ * @brief Spool counters
+ */
+struct MqttSpoolStats
+{
+    uint32_t recordsSpooled{0}; ///< Records appended since open()
+    uint32_t recordsDrained{0}; ///< Records replayed since open()
+    uint32_t recordsDropped{0}; ///< Records lost to the maxSegments limit
+    uint32_t recordsCorrupt{0}; ///< Records skipped because of a bad header or CRC
+};
+
+/**
+ * @brief Append-only segmented log of pending publishes
+ *
+ * Layout: `directory/XXXXXXXX.seg` segments (hexadecimal, ascending), each
+ * a sequence of records:
+ *
+ * | bytes | field                                          |
+ * |-------|------------------------------------------------|
+ * | 2     | magic "SP"                                     |
+ * | 1     | flags: bits 0-1 QoS, bit 2 retain              |
+ * | 1     | reserved (0)                                   |
+ * | 2     | topic length (little endian)                   |
+ * | 4     | payload length (little endian)                 |
+ * | 4     | CRC-32 of flags through payload                |
+ * | n     | topic, then payload                            |
+ *
+ * Replay position is saved to `directory/cursor` once per drain() call,
+ * so after a reset at most one batch is delivered twice (at-least-once).
+ *
+ * Not thread-safe; CoreMqttClient calls it with its mutex held.
+ *
+ * @code
+ * MqttSpool spool(SpoolConfig{true, storage.getBasePath() + "/spool"});
+ * spool.open();
+ * spool.append("sensors/temp", &segment, 1, MqttQos::AT_LEAST_ONCE, false);
+ * spool.drain(4, [&](const MqttMessageView &msg) { return sendNow(msg); });
+ * @endcode
+ */
+class MqttSpool
+{
+public:
+    /// Bytes before the topic in every record
+    static constexpr size_t RECORD_HEADER_SIZE = 14;
+
+    /**
+     * @brief Send one replayed record; anything but ESP_OK stops the drain
+     */
+    using SendFunction = std::function<esp_err_t(const MqttMessageView &message)>;
+
+    explicit MqttSpool(const SpoolConfig &config);
+    ~MqttSpool();
+
+    MqttSpool(const MqttSpool &) = delete;
+    MqttSpool &operator=(const MqttSpool &) = delete;
+
+    /**
+     * @brief Create the directory and recover segments from a previous run
+     *
+     * Counts the records still pending and starts a fresh segment for new
+     * appends, so a torn tail record is never followed by valid data.
+     *
+     * @return ESP_OK on success, ESP_FAIL if the directory is not usable
+     */
+    esp_err_t open();
+
+    /**
+     * @brief Close open segment files (pending records stay on flash)
+     */
+    void close();
+
+    bool isOpen() const
+    {
+        return open_;
+    }
+
+    /**
+     * @brief Append one publish
+     *
+     * @param topic Topic name
+     * @param segments Payload pieces, written back to back
+     * @param segmentCount Number of segments
+     * @param qos QoS to publish with on replay
+     * @param retain Retain flag
+     * @return ESP_OK on success
+     *         ESP_ERR_INVALID_STATE if not open
+     *         ESP_ERR_INVALID_SIZE if the record does not fit in one segment
+     *         ESP_FAIL on a write error
+     */
+    esp_err_t append(std::string_view topic,
+                     const MqttPayloadSegment *segments,
+                     size_t segmentCount,
+                     MqttQos qos,
+                     bool retain);
+
+    /**
+     * @brief Replay up to maxRecords records, oldest first
+     *
+     * A record is consumed only when send returns ESP_OK. Segments are
+     * deleted once fully replayed.
+     *
+     * @param maxRecords Upper bound for this call
+     * @param send Called for each record; the view is valid until it returns
+     * @return Number of records consumed
+     */
+    size_t drain(size_t maxRecords, const SendFunction &send);
+
+    /**
+     * @brief Records waiting for replay
+     */
+    size_t pendingCount() const
+    {
+        return pendingRecords_;
+    }
+
+    bool empty() const
+    {
+        return pendingRecords_ == 0;
+    }
+
+    const MqttSpoolStats &getStats() const
+    {
+        return stats_;
+    }
+
+private:
+    /**
+     * @brief One segment file and the records it still holds
+     */
+    struct Segment
+    {
+        uint32_t id;    ///< Number in the file name
+        size_t records; ///< Valid records not yet replayed
+        size_t size;    ///< File size in bytes
+    };
+
+    std::string segmentPath(uint32_t id) const;
+    std::string cursorPath() const;
+
+    /**
+     * @brief Count valid records in a segment from offset, stopping at the first bad one
+     */
+    size_t countRecords(uint32_t id, size_t offset, size_t *fileSize);
+
+    /**
+     * @brief Read the record at the read cursor into readBuffer_
+     * @return true if a valid record was read
+     */
+    bool readRecord(FILE *file, MqttMessageView *view, size_t *recordSize);
+
+    esp_err_t startSegment();
+    void dropOldestSegment();
+    void finishReadSegment();
+    void saveCursor();
+    bool loadCursor(uint32_t *id, uint32_t *offset);
+
+    const SpoolConfig config_;        ///< Configuration
+    bool open_;                       ///< open() succeeded
+    std::deque<Segment> segments_;    ///< Oldest first; back() is the write segment
+    uint32_t nextId_;                 ///< Number of the next segment to create
+    FILE *writeFile_;                 ///< Open write segment
+    FILE *readFile_;                  ///< Open read segment (segments_.front())
+    size_t readOffset_;               ///< Replay position in segments_.front()
+    size_t pendingRecords_;           ///< Records not yet replayed
+    std::vector<uint8_t> readBuffer_; ///< Topic and payload of the record being replayed
+    MqttSpoolStats stats_;            ///< Counters
+};
+
+} // namespace mqtt
+} // namespace lopcore
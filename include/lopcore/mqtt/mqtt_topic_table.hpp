@@ -0,0 +1,109 @@
+/**
+ * @file mqtt_topic_table.hpp
+ * @brief Interned publish topics addressed by TopicHandle
+ *
+ * AWS IoT topics such as `$aws/things/<thing>/shadow/name/<n>/update` are
+ * often longer than the payloads sent on them. Registering such a topic
+ * once lets each publish reference it by a 2-byte handle instead of
+ * building a std::string. Each entry also has room for an MQTT 5 topic
+ * alias, so a v5 transport can later send the alias instead of the name.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "mqtt_types.hpp"
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+/**
+ * @brief Fixed-capacity table of registered topics
+ *
+ * Entries are never removed, so a topic returned by lookup() stays valid
+ * for the table's lifetime. intern() takes a lock; lookup() does not.
+ */
+class MqttTopicTable
+{
+public:
+    /**
+     * @param capacity Most topics that can be registered (at most 65535)
+     */
+    explicit MqttTopicTable(size_t capacity);
+
+    MqttTopicTable(const MqttTopicTable &) = delete;
+    MqttTopicTable &operator=(const MqttTopicTable &) = delete;
+
+    /**
+     * @brief Register a topic, or find it if already registered
+     * @return Handle of the topic; invalid if the topic is empty, has
+     *         wildcards, is longer than 65535 bytes, or the table is full
+     */
+    TopicHandle intern(std::string_view topic);
+
+    /**
+     * @brief Topic of a handle
+     * @return nullptr if the handle was not issued by this table
+     */
+    const std::string *lookup(TopicHandle handle) const
+    {
+        if (handle.id == 0 || handle.id > count_.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+        return &entries_[handle.id - 1].topic;
+    }
+
+    /**
+     * @brief MQTT 5 topic alias assigned to a handle on the current connection
+     * @return 0 if none
+     */
+    uint16_t aliasOf(TopicHandle handle) const;
+
+    /**
+     * @brief Record the topic alias a v5 transport chose for a handle
+     */
+    void setAlias(TopicHandle handle, uint16_t alias);
+
+    /**
+     * @brief Forget every alias (aliases only last for one connection)
+     */
+    void clearAliases();
+
+    size_t size() const
+    {
+        return count_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const
+    {
+        return capacity_;
+    }
+
+private:
+    struct Entry
+    {
+        std::string topic;              ///< Registered topic name
+        std::atomic<uint16_t> alias{0}; ///< MQTT 5 topic alias (0 = none)
+    };
+
+    const size_t capacity_;            ///< Entries allocated
+    std::unique_ptr<Entry[]> entries_; ///< First count_ entries are in use
+    std::atomic<size_t> count_;        ///< Published after an entry is filled in
+    std::mutex mutex_;                 ///< Serialises intern()
+};
+
+} // namespace mqtt
+} // namespace lopcore
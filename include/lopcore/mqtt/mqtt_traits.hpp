@@ -256,6 +256,40 @@ struct has_budget_management<T,
 template<typename T>
 inline constexpr bool has_budget_management_v = has_budget_management<T>::value;
 
+// ========================================
+// Trait 7: Zero-Copy Message Delivery
+// ========================================
+
+/**
+ * @brief Check if type can deliver messages as non-owning views
+ *
+ * Detects presence of:
+ * - subscribeView(topic, MessageViewCallback, qos)
+ *
+ * Usage:
+ * @code
+ * if constexpr (has_message_views_v<MqttClient>) {
+ *     client.subscribeView("ota/chunk", [](const MqttMessageView& msg) { ... }, MqttQos::AT_LEAST_ONCE);
+ * }
+ * @endcode
+ */
+template<typename T, typename = void>
+struct has_message_views : std::false_type
+{
+};
+
+template<typename T>
+struct has_message_views<
+    T,
+    std::void_t<decltype(std::declval<T>().subscribeView(std::declval<std::string>(),
+                                                         std::declval<MessageViewCallback>(),
+                                                         MqttQos::AT_MOST_ONCE))>> : std::true_type
+{
+};
+
+template<typename T>
+inline constexpr bool has_message_views_v = has_message_views<T>::value;
+
 // ========================================
 // Composite Traits
 // ========================================
@@ -322,6 +356,7 @@ constexpr bool report_capabilities()
                   "Reconnection control: available/unavailable");
     static_assert(!has_budget_management_v<T> || has_budget_management_v<T>,
                   "Budget management: available/unavailable");
+    static_assert(!has_message_views_v<T> || has_message_views_v<T>, "Message views: available/unavailable");
 
     return true;
 }
@@ -8,9 +8,11 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace lopcore
@@ -20,6 +22,8 @@ namespace mqtt
 
 // Forward declarations
 struct MqttMessage;
+struct MqttMessageView;
+struct MqttMessageFragment;
 enum class MqttError;
 
 /**
@@ -28,6 +32,18 @@ enum class MqttError;
  */
 using MessageCallback = std::function<void(const MqttMessage &message)>;
 
+/**
+ * @brief Callback for incoming MQTT messages, delivered without copying
+ * @param message View into the client's receive buffer, valid only during the call
+ */
+using MessageViewCallback = std::function<void(const MqttMessageView &message)>;
+
+/**
+ * @brief Callback for incoming MQTT messages, delivered piece by piece as received
+ * @param fragment Part of a message, valid only during the call
+ */
+using MessageFragmentCallback = std::function<void(const MqttMessageFragment &fragment)>;
+
 /**
  * @brief Callback for connection state changes
  * @param connected True if connected, false if disconnected
@@ -79,10 +95,11 @@ enum class MqttError
  */
 enum class MqttClientType
 {
-    AUTO,     ///< Automatically select based on broker endpoint
-    ESP_MQTT, ///< ESP-IDF native MQTT client
-    AWS_IOT,  ///< AWS IoT Core MQTT (coreMQTT)
-    MOCK      ///< Mock client for testing
+    AUTO,          ///< Automatically select based on broker endpoint
+    ESP_MQTT,      ///< ESP-IDF native MQTT client
+    AWS_IOT,       ///< AWS IoT Core MQTT (coreMQTT)
+    AWS_IOT_AGENT, ///< AWS IoT Core MQTT through coreMQTT-Agent (many publishing tasks)
+    MOCK           ///< Mock client for testing
 };
 
 /**
@@ -106,6 +123,115 @@ struct MqttMessage
     }
 };
 
+/**
+ * @brief Non-owning view of a received MQTT message
+ *
+ * Topic and payload point into the client's network buffer and are only
+ * valid until the callback returns. Use toMessage() to keep a copy.
+ */
+struct MqttMessageView
+{
+    std::string_view topic; ///< Topic the message was received on
+    const uint8_t *payload; ///< Message payload (not null-terminated)
+    size_t payloadLength;   ///< Payload size in bytes
+    MqttQos qos;            ///< Quality of Service level
+    bool retained;          ///< Retained message flag
+    uint32_t messageId;     ///< Unique message identifier (for QoS > 0)
+
+    /**
+     * @brief Get payload as a string view (no copy)
+     */
+    std::string_view getPayloadAsStringView() const
+    {
+        return std::string_view(reinterpret_cast<const char *>(payload), payloadLength);
+    }
+
+    /**
+     * @brief Copy into an owning message
+     */
+    MqttMessage toMessage() const
+    {
+        MqttMessage message;
+        message.topic.assign(topic.data(), topic.size());
+        message.payload.assign(payload, payload + payloadLength);
+        message.qos = qos;
+        message.retained = retained;
+        message.messageId = messageId;
+        return message;
+    }
+};
+
+/**
+ * @brief Part of an incoming message, viewed in place
+ *
+ * A message larger than the client's receive buffer arrives in several
+ * fragments, in order, each with the message's topic and total length.
+ * A message that arrives whole is a single fragment. Data is only valid
+ * until the callback returns.
+ */
+struct MqttMessageFragment
+{
+    std::string_view topic; ///< Topic the message was received on
+    const uint8_t *data;    ///< Bytes of this fragment
+    size_t length;          ///< Fragment size in bytes
+    size_t offset;          ///< Position of the fragment in the payload
+    size_t totalLength;     ///< Size of the whole payload
+    MqttQos qos;            ///< Quality of Service level
+    bool retained;          ///< Retained message flag
+    uint32_t messageId;     ///< Unique message identifier (for QoS > 0)
+
+    bool isFirst() const
+    {
+        return offset == 0;
+    }
+
+    bool isLast() const
+    {
+        return offset + length >= totalLength;
+    }
+};
+
+/**
+ * @brief One piece of a scatter-gather publish payload
+ *
+ * The segments of a publish are sent back to back as a single payload;
+ * the caller keeps the buffers alive until publish() returns.
+ */
+struct MqttPayloadSegment
+{
+    const void *data; ///< Segment bytes
+    size_t size;      ///< Segment length in bytes
+};
+
+/**
+ * @brief Identifies a topic interned with IMqttClient::registerTopic()
+ *
+ * A default-constructed handle is invalid. Handles are only meaningful to
+ * the client that issued them.
+ */
+struct TopicHandle
+{
+    uint16_t id{0}; ///< 1-based table index (0 = invalid)
+
+    bool isValid() const
+    {
+        return id != 0;
+    }
+};
+
+/**
+ * @brief One topic filter of a subscribeMany() call
+ *
+ * Set either callback; viewCallback takes precedence when both are set.
+ */
+struct MqttSubscribeRequest
+{
+    std::string topic;                  ///< Topic filter
+    MqttQos qos{MqttQos::AT_MOST_ONCE}; ///< Maximum QoS level
+    MessageCallback callback;           ///< Owning callback (message copied once)
+    MessageViewCallback viewCallback;   ///< Zero-copy callback
+};
+
 /**
  * @brief MQTT connection state
  */
@@ -127,11 +253,14 @@ struct MqttStatistics
     uint64_t messagesPublished{0};                          ///< Total messages published
     uint64_t messagesReceived{0};                           ///< Total messages received
     uint64_t publishErrors{0};                              ///< Failed publish attempts
+    uint64_t messagesDropped{0};                            ///< Received messages some callback missed
     uint64_t reconnectCount{0};                             ///< Number of reconnections
     uint64_t subscriptionCount{0};                          ///< Active subscriptions
-    std::chrono::milliseconds averagePublishLatency{0};     ///< Average publish latency
+    std::chrono::milliseconds averagePublishLatency{0};     ///< Mean QoS 1/2 publish-to-ack latency
     std::chrono::system_clock::time_point lastConnected;    ///< Last connection time
     std::chrono::system_clock::time_point lastDisconnected; ///< Last disconnection time
+    int32_t budgetRemaining{-1};                            ///< Global budget left when read (bytes in
+                                                            ///< BudgetUnit::BYTES mode, -1 if disabled)
 
     /**
      * @brief Reset all statistics to zero
@@ -141,6 +270,7 @@ struct MqttStatistics
         messagesPublished = 0;
         messagesReceived = 0;
         publishErrors = 0;
+        messagesDropped = 0;
         reconnectCount = 0;
         subscriptionCount = 0;
         averagePublishLatency = std::chrono::milliseconds(0);
@@ -173,6 +303,42 @@ inline MqttQos intToQos(uint8_t value)
     }
 }
 
+/**
+ * @brief Count the topic filters that fit in one SUBSCRIBE or UNSUBSCRIBE packet
+ *
+ * Each filter costs a 2-byte length prefix plus its bytes, and one options
+ * byte in a SUBSCRIBE; the fixed header and packet id take at most 7 bytes.
+ * At least one filter is always taken, so an oversized filter fails alone.
+ *
+ * @param count Filters remaining to be sent
+ * @param bufferSize Largest packet to build (MqttConfig::networkBufferSize)
+ * @param maxFilters Filter cap per packet (MqttConfig::maxTopicsPerSubscribe)
+ * @param subscribe true for SUBSCRIBE, false for UNSUBSCRIBE
+ * @param lengthAt Callable returning the length of remaining filter i
+ * @return Number of leading filters to pack into the next packet
+ */
+template<typename LengthAt>
+inline size_t topicFiltersPerPacket(size_t count,
+                                    size_t bufferSize,
+                                    size_t maxFilters,
+                                    bool subscribe,
+                                    LengthAt &&lengthAt)
+{
+    size_t used = 7;
+    size_t taken = 0;
+    while (taken < count && taken < maxFilters)
+    {
+        size_t cost = 2 + lengthAt(taken) + (subscribe ? 1 : 0);
+        if (taken > 0 && used + cost > bufferSize)
+        {
+            break;
+        }
+        used += cost;
+        taken++;
+    }
+    return taken;
+}
+
 /**
  * @brief Convert error enum to string
  */
@@ -252,6 +418,8 @@ inline const char *clientTypeToString(MqttClientType type)
             return "ESP-MQTT";
         case MqttClientType::AWS_IOT:
             return "AWS-IOT";
+        case MqttClientType::AWS_IOT_AGENT:
+            return "AWS-IOT-AGENT";
         case MqttClientType::MOCK:
             return "MOCK";
         default:
@@ -259,5 +427,36 @@ inline const char *clientTypeToString(MqttClientType type)
     }
 }
 
+/**
+ * @brief Client type picked by the LOPCORE_MQTT_DEFAULT_CLIENT Kconfig choice
+ */
+inline MqttClientType defaultClientType()
+{
+#if defined(CONFIG_LOPCORE_MQTT_AGENT_PREFERRED)
+    return MqttClientType::AWS_IOT_AGENT;
+#elif defined(CONFIG_LOPCORE_MQTT_CORE_PREFERRED)
+    return MqttClientType::AWS_IOT;
+#elif defined(CONFIG_LOPCORE_MQTT_ESP_PREFERRED)
+    return MqttClientType::ESP_MQTT;
+#else
+    return MqttClientType::AUTO;
+#endif
+}
+
+/**
+ * @brief Resolve AUTO for a broker: coreMQTT for AWS IoT endpoints, ESP-MQTT otherwise
+ *
+ * Any other type is returned unchanged.
+ */
+inline MqttClientType resolveClientType(MqttClientType type, std::string_view broker)
+{
+    if (type != MqttClientType::AUTO)
+    {
+        return type;
+    }
+    return broker.find("amazonaws.com") != std::string_view::npos ? MqttClientType::AWS_IOT
+                                                                   : MqttClientType::ESP_MQTT;
+}
+
 } // namespace mqtt
 } // namespace lopcore
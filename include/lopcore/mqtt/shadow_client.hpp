@@ -0,0 +1,269 @@
+/**
+ * @file shadow_client.hpp
+ * @brief AWS IoT Device Shadow client that reports only what changed
+ *
+ * Publishing the whole reported document on every change costs a PUBLISH
+ * of several hundred bytes per field that moved, and a budget unit with
+ * it. ShadowClient keeps the last reported document locally (optionally
+ * in NVS, so a reboot does not resend it), drops values equal to what
+ * the shadow already holds, and sends the remaining changes as one update
+ * per coalescing window:
+ *
+ * @code
+ * ShadowConfig shadow;
+ * shadow.thingName = "sensor-42";
+ * ShadowClient device(client, shadow, &nvs);
+ * device.setDeltaCallback([](std::string_view path, std::string_view value) {
+ *     if (path == "led") { setLed(value == "true"); }
+ * });
+ * device.start();
+ *
+ * device.report("fw.version", "\"1.4.2\"");   // Raw JSON value
+ * device.report("temperature", 21.5);
+ * device.report("led", true);
+ * device.poll(); // From the application loop; sends one update when the window ends
+ * @endcode
+ *
+ * Fields are addressed by dot-separated paths ("wifi.rssi"); arrays are
+ * reported and compared as a whole. A null value deletes the field.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <esp_err.h>
+#include <esp_timer.h>
+
+#include "lopcore/storage/nvs_storage.hpp"
+
+#include "imqtt_client.hpp"
+#include "mqtt_config.hpp"
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+/**
+ * @brief Allocation-free walk over the leaves of a JSON document
+ */
+namespace shadow_json
+{
+
+/// Deepest object nesting forEachLeaf() follows
+static constexpr size_t MAX_DEPTH = 8;
+
+/// Longest dotted path forEachLeaf() builds
+static constexpr size_t MAX_PATH = 128;
+
+/**
+ * @brief Called per leaf: dotted path and raw JSON value (strings keep their quotes)
+ *
+ * Both views point into the document or a stack buffer and are valid only
+ * during the call.
+ */
+using LeafCallback = std::function<void(std::string_view path, std::string_view value)>;
+
+/**
+ * @brief Call fn for every non-object value of json, objects flattened into dotted paths
+ *
+ * Arrays are leaves. Keys are used as written, escapes included.
+ *
+ * @return false if json is malformed or nested deeper than MAX_DEPTH / MAX_PATH
+ */
+bool forEachLeaf(std::string_view json, const LeafCallback &fn);
+
+/**
+ * @brief Quote and escape text as a JSON string
+ */
+std::string quote(std::string_view text);
+
+} // namespace shadow_json
+
+/**
+ * @brief Shadow counters
+ */
+struct ShadowStats
+{
+    uint32_t updatesPublished{0};  ///< Update messages sent
+    uint32_t fieldsReported{0};    ///< Changed fields carried by those updates
+    uint32_t fieldsUnchanged{0};   ///< report() calls dropped because the shadow already held the value
+    uint32_t fieldsCoalesced{0};   ///< Pending values replaced within a window
+    uint32_t bytesPublished{0};    ///< Update payload bytes sent
+    uint32_t bytesFullDocument{0}; ///< Bytes the same updates would take as full documents
+    uint32_t deltasReceived{0};    ///< Delta messages handled
+    uint32_t rejected{0};          ///< Updates the service rejected
+};
+
+/**
+ * @brief Reports device state to an AWS IoT Device Shadow as minimal deltas
+ *
+ * Every call is thread-safe. Delta callbacks run on the client's receive
+ * task without the shadow's lock held, so they may call report().
+ */
+class ShadowClient
+{
+public:
+    /**
+     * @brief Monotonic time source in microseconds
+     */
+    using TimeSource = int64_t (*)();
+
+    /**
+     * @brief Called for each desired field that differs from reported: dotted path and raw JSON value
+     */
+    using DeltaCallback = std::function<void(std::string_view path, std::string_view value)>;
+
+    /**
+     * @param client Client that carries the shadow topics
+     * @param config Shadow and coalescing settings
+     * @param cache NVS storage for the reported document (nullptr = RAM only); must outlive the client
+     * @param timeSource Monotonic clock (esp_timer_get_time unless testing)
+     */
+    ShadowClient(std::shared_ptr<IMqttClient> client,
+                 const ShadowConfig &config,
+                 NvsStorage *cache = nullptr,
+                 TimeSource timeSource = esp_timer_get_time);
+
+    /**
+     * @brief Unsubscribes; changes not yet sent are lost
+     */
+    ~ShadowClient();
+
+    ShadowClient(const ShadowClient &) = delete;
+    ShadowClient &operator=(const ShadowClient &) = delete;
+
+    void setDeltaCallback(DeltaCallback callback);
+
+    /**
+     * @brief Load the cached document and subscribe to the delta and rejected topics
+     * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the configuration is
+     *         invalid, ESP_ERR_INVALID_STATE if already started, otherwise the client's error
+     */
+    esp_err_t start();
+
+    /**
+     * @brief Set a reported field to a raw JSON value ("21.5", "true", "\"text\"", "[1,2]", "null")
+     *
+     * Sent with the next update unless the shadow already holds the value.
+     *
+     * @return ESP_OK, ESP_ERR_INVALID_ARG for an empty path or a value that is
+     *         not a single JSON value
+     */
+    esp_err_t report(std::string_view path, std::string_view rawJson);
+
+    esp_err_t report(std::string_view path, const char *rawJson)
+    {
+        return report(path, std::string_view(rawJson));
+    }
+    esp_err_t report(std::string_view path, bool value);
+    esp_err_t report(std::string_view path, int64_t value);
+    esp_err_t report(std::string_view path, int value)
+    {
+        return report(path, static_cast<int64_t>(value));
+    }
+    esp_err_t report(std::string_view path, double value);
+
+    /**
+     * @brief Set a reported field to a string, quoted and escaped
+     */
+    esp_err_t reportString(std::string_view path, std::string_view value);
+
+    /**
+     * @brief Delete a reported field (reports null)
+     */
+    esp_err_t remove(std::string_view path)
+    {
+        return report(path, "null");
+    }
+
+    /**
+     * @brief Send the pending update if its window has passed
+     * @return Milliseconds until the pending update is due, UINT32_MAX if nothing is pending
+     */
+    uint32_t poll();
+
+    /**
+     * @brief Send the pending update now
+     * @return ESP_OK if sent or nothing was pending, otherwise the client's error (changes stay pending)
+     */
+    esp_err_t flush();
+
+    /**
+     * @brief Queue every cached field again, e.g. after the shadow was deleted in the cloud
+     */
+    void resyncAll();
+
+    /**
+     * @brief Raw JSON value of a reported field, as last sent or pending
+     */
+    std::optional<std::string> getReported(std::string_view path) const;
+
+    /**
+     * @brief The whole reported document as JSON, pending changes included
+     */
+    std::string getReportedDocument() const;
+
+    /**
+     * @brief Version of the last delta received, 0 before any
+     */
+    uint32_t getVersion() const;
+
+    size_t getPendingCount() const;
+
+    ShadowStats getStats() const;
+
+private:
+    using Fields = std::map<std::string, std::string, std::less<>>;
+
+    /**
+     * @brief Serialize fields as a nested JSON object
+     * @param skipNull Leave out null values (the cached document)
+     */
+    static std::string serialize(const Fields &fields, bool skipNull);
+
+    /**
+     * @brief Drop the entries that path would contradict: its parents and its children
+     */
+    static void eraseConflicts(Fields &fields, std::string_view path);
+
+    /**
+     * @brief Send pending_ if due (all of it if force)
+     */
+    esp_err_t flushPending(bool force, int64_t *nextDueUs);
+
+    void persist(const Fields &reported);
+    void onDelta(const MqttMessage &message);
+    void onRejected(const MqttMessage &message);
+
+    std::shared_ptr<IMqttClient> client_; ///< Client that carries the shadow
+    const ShadowConfig config_;           ///< Configuration
+    NvsStorage *cache_;                   ///< Persistent copy of reported_ (optional)
+    const TimeSource timeSource_;         ///< Monotonic clock
+    const std::string topicPrefix_;       ///< $aws/things/<thing>/shadow/[name/<name>/]
+
+    mutable std::mutex mutex_;    ///< Guards everything below
+    Fields reported_;             ///< Fields the shadow holds, as last sent
+    Fields pending_;              ///< Changes for the next update (null = delete)
+    int64_t dueUs_;               ///< When pending_ is sent
+    uint32_t version_;            ///< Version of the last delta
+    ShadowStats stats_;           ///< Counters
+    DeltaCallback deltaCallback_; ///< Application delta handler
+    std::mutex flushMutex_;       ///< Held for a whole flush, so updates go out in order
+    bool started_;                ///< start() succeeded
+};
+
+} // namespace mqtt
+} // namespace lopcore
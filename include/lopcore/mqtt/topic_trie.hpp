@@ -0,0 +1,400 @@
+/**
+ * @file topic_trie.hpp
+ * @brief Topic-filter trie for MQTT subscription dispatch
+ *
+ * Stores one value per topic filter, keyed level by level, so matching an
+ * incoming topic walks at most one path per wildcard branch instead of
+ * testing every subscription. Used by both MQTT clients.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <esp_err.h>
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+/**
+ * @brief Map from MQTT topic filter to Value with wildcard matching
+ *
+ * Follows MQTT 3.1.1 section 4.7:
+ * - '+' matches exactly one level (which may be empty)
+ * - '#' matches the parent level and any number of child levels
+ * - Wildcards at the first level do not match topics starting with '$'
+ *
+ * Children are kept sorted, so a lookup costs O(levels * log children)
+ * and matching a topic never allocates.
+ *
+ * Not thread-safe; callers guard it with their subscription lock.
+ *
+ * @tparam Value Stored per filter (e.g. the subscription's callbacks)
+ */
+template<typename Value>
+class TopicTrie
+{
+public:
+    TopicTrie() : root_(std::make_unique<Node>()), size_(0)
+    {
+    }
+
+    /**
+     * @brief Check whether a topic filter is well formed
+     * @param filter Topic filter, e.g. "sensors/+/temp" or "jobs/#"
+     * @return true if non-empty and wildcards occupy whole levels ('#' last only)
+     */
+    static bool isValidFilter(std::string_view filter)
+    {
+        if (filter.empty())
+        {
+            return false;
+        }
+
+        size_t pos = 0;
+        while (true)
+        {
+            size_t slash = filter.find('/', pos);
+            bool last = (slash == std::string_view::npos);
+            std::string_view level = filter.substr(pos, last ? std::string_view::npos : slash - pos);
+
+            bool hasWildcard = level.find_first_of("+#") != std::string_view::npos;
+            if (hasWildcard && level != "+" && level != "#")
+            {
+                return false;
+            }
+            if (level == "#" && !last)
+            {
+                return false;
+            }
+            if (last)
+            {
+                return true;
+            }
+            pos = slash + 1;
+        }
+    }
+
+    /**
+     * @brief Add or replace the value stored for a filter
+     * @param filter Topic filter
+     * @param value Value to store
+     * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the filter is malformed
+     */
+    esp_err_t insert(std::string_view filter, Value value)
+    {
+        if (!isValidFilter(filter))
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        Node *node = root_.get();
+        forEachLevel(filter, [&node](std::string_view level) { node = node->childFor(level); });
+
+        if (!node->value)
+        {
+            size_++;
+            node->filter.assign(filter.data(), filter.size());
+        }
+        node->value = std::move(value);
+        return ESP_OK;
+    }
+
+    /**
+     * @brief Remove a filter
+     * @param filter Topic filter exactly as inserted
+     * @return true if it was present
+     */
+    bool erase(std::string_view filter)
+    {
+        if (!isValidFilter(filter) || !eraseFrom(*root_, filter, 0))
+        {
+            return false;
+        }
+        size_--;
+        return true;
+    }
+
+    /**
+     * @brief Look up the value stored for an exact filter (no wildcard matching)
+     * @return Pointer to the value, or nullptr if the filter is not present
+     */
+    Value *find(std::string_view filter)
+    {
+        if (filter.empty())
+        {
+            return nullptr;
+        }
+
+        Node *node = root_.get();
+        forEachLevel(filter, [&node](std::string_view level) {
+            if (node != nullptr)
+            {
+                node = node->existingChild(level);
+            }
+        });
+        return (node != nullptr && node->value) ? &(*node->value) : nullptr;
+    }
+
+    /**
+     * @brief Invoke fn(value) for every filter matching a topic
+     *
+     * A value is visited once even if several branches lead to it, since
+     * each filter is stored at exactly one node.
+     *
+     * @param topic Topic name of an incoming message (no wildcards)
+     * @param fn Callable taking Value &
+     * @return Number of matching filters
+     */
+    template<typename Fn>
+    size_t match(std::string_view topic, Fn &&fn)
+    {
+        return matchFrom(*root_, topic, 0, true, fn);
+    }
+
+    /**
+     * @brief Invoke fn(filter, value) for every stored filter
+     */
+    template<typename Fn>
+    void forEach(Fn &&fn) const
+    {
+        visit(*root_, fn);
+    }
+
+    /**
+     * @brief Number of stored filters
+     */
+    size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    /**
+     * @brief Remove every filter
+     */
+    void clear()
+    {
+        root_ = std::make_unique<Node>();
+        size_ = 0;
+    }
+
+private:
+    struct Node
+    {
+        std::string level;                           ///< Level name (empty for root and wildcards)
+        std::vector<std::unique_ptr<Node>> children; ///< Literal levels, sorted by name
+        std::unique_ptr<Node> plus;                  ///< "+" child
+        std::unique_ptr<Node> hash;                  ///< "#" child
+        std::optional<Value> value;                  ///< Value if a filter ends here
+        std::string filter;                          ///< Full filter of value
+
+        Node *existingChild(std::string_view name) const
+        {
+            if (name == "+")
+            {
+                return plus.get();
+            }
+            if (name == "#")
+            {
+                return hash.get();
+            }
+            return literalChild(name);
+        }
+
+        Node *literalChild(std::string_view name) const
+        {
+            auto it = lowerBound(name);
+            return (it != children.end() && (*it)->level == name) ? it->get() : nullptr;
+        }
+
+        Node *childFor(std::string_view name)
+        {
+            if (name == "+" || name == "#")
+            {
+                std::unique_ptr<Node> &slot = (name == "+") ? plus : hash;
+                if (!slot)
+                {
+                    slot = std::make_unique<Node>();
+                }
+                return slot.get();
+            }
+
+            auto it = lowerBound(name);
+            if (it == children.end() || (*it)->level != name)
+            {
+                auto child = std::make_unique<Node>();
+                child->level.assign(name.data(), name.size());
+                it = children.insert(it, std::move(child));
+            }
+            return it->get();
+        }
+
+        typename std::vector<std::unique_ptr<Node>>::const_iterator lowerBound(std::string_view name) const
+        {
+            return std::lower_bound(children.begin(), children.end(), name,
+                                    [](const std::unique_ptr<Node> &child, std::string_view key) {
+                                        return std::string_view(child->level) < key;
+                                    });
+        }
+
+        bool isEmpty() const
+        {
+            return !value && children.empty() && !plus && !hash;
+        }
+    };
+
+    template<typename Fn>
+    static void forEachLevel(std::string_view path, Fn &&fn)
+    {
+        size_t pos = 0;
+        while (true)
+        {
+            size_t slash = path.find('/', pos);
+            if (slash == std::string_view::npos)
+            {
+                fn(path.substr(pos));
+                return;
+            }
+            fn(path.substr(pos, slash - pos));
+            pos = slash + 1;
+        }
+    }
+
+    template<typename Fn>
+    static size_t matchFrom(Node &node, std::string_view topic, size_t pos, bool first, Fn &fn)
+    {
+        size_t slash = topic.find('/', pos);
+        bool last = (slash == std::string_view::npos);
+        std::string_view level = topic.substr(pos, last ? std::string_view::npos : slash - pos);
+        size_t next = last ? topic.size() : slash + 1;
+
+        // "$SYS/..." style topics are only matched by filters naming them
+        bool wildcards = !(first && !level.empty() && level[0] == '$');
+
+        size_t matched = 0;
+        if (wildcards && node.hash && node.hash->value)
+        {
+            fn(*node.hash->value);
+            matched++;
+        }
+        if (wildcards && node.plus)
+        {
+            matched += matchChild(*node.plus, topic, next, last, fn);
+        }
+        if (Node *child = node.literalChild(level))
+        {
+            matched += matchChild(*child, topic, next, last, fn);
+        }
+        return matched;
+    }
+
+    template<typename Fn>
+    static size_t matchChild(Node &child, std::string_view topic, size_t next, bool last, Fn &fn)
+    {
+        if (!last)
+        {
+            return matchFrom(child, topic, next, false, fn);
+        }
+
+        size_t matched = 0;
+        if (child.value)
+        {
+            fn(*child.value);
+            matched++;
+        }
+        // "a/#" also matches "a"
+        if (child.hash && child.hash->value)
+        {
+            fn(*child.hash->value);
+            matched++;
+        }
+        return matched;
+    }
+
+    static bool eraseFrom(Node &node, std::string_view filter, size_t pos)
+    {
+        size_t slash = filter.find('/', pos);
+        bool last = (slash == std::string_view::npos);
+        std::string_view level = filter.substr(pos, last ? std::string_view::npos : slash - pos);
+
+        Node *child = node.existingChild(level);
+        if (child == nullptr)
+        {
+            return false;
+        }
+
+        bool erased = false;
+        if (last)
+        {
+            erased = child->value.has_value();
+            child->value.reset();
+            child->filter.clear();
+        }
+        else
+        {
+            erased = eraseFrom(*child, filter, slash + 1);
+        }
+
+        // Prune branches left without filters
+        if (erased && child->isEmpty())
+        {
+            if (child == node.plus.get())
+            {
+                node.plus.reset();
+            }
+            else if (child == node.hash.get())
+            {
+                node.hash.reset();
+            }
+            else
+            {
+                node.children.erase(node.lowerBound(level));
+            }
+        }
+        return erased;
+    }
+
+    template<typename Fn>
+    static void visit(const Node &node, Fn &fn)
+    {
+        if (node.value)
+        {
+            fn(node.filter, *node.value);
+        }
+        for (const auto &child : node.children)
+        {
+            visit(*child, fn);
+        }
+        if (node.plus)
+        {
+            visit(*node.plus, fn);
+        }
+        if (node.hash)
+        {
+            visit(*node.hash, fn);
+        }
+    }
+
+    std::unique_ptr<Node> root_; ///< Root (level before the first '/')
+    size_t size_;                ///< Stored filters
+};
+
+} // namespace mqtt
+} // namespace lopcore
@@ -0,0 +1,63 @@
+/**
+ * @file pkcs11_keys.hpp
+ * @brief Device key pair, CSR and certificate in the PKCS#11 token
+ *
+ * Backs ProvisioningManager with corePKCS11: the P-256 key pair is
+ * generated inside the token, the CSR is signed through it, and the
+ * issued certificate is written under the label MbedtlsTransport reads
+ * (TlsConfig::clientCertLabel), so the next connect uses it. Requires
+ * esp-aws-iot (corePKCS11).
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <string>
+
+#include "lopcore/provisioning/provisioning_manager.hpp"
+
+namespace lopcore
+{
+namespace provisioning
+{
+
+/**
+ * @brief Token labels and CSR subject
+ */
+struct Pkcs11KeyConfig
+{
+    std::string privateKeyLabel{"Device Priv TLS Key"}; ///< corePKCS11's default TLS key label
+    std::string publicKeyLabel{"Device Pub TLS Key"};   ///< Public half of the pair
+    std::string certificateLabel{"Device Cert"};        ///< corePKCS11's default TLS certificate label
+    std::string subject{"CN=lopcore-device"};           ///< CSR subject; the template sets the real one
+};
+
+/**
+ * @brief Generate a P-256 key pair in the token (replacing one under the same labels) and a CSR for it
+ * @return ESP_OK, ESP_ERR_NO_MEM, or ESP_FAIL on a token or mbedTLS error
+ */
+esp_err_t createPkcs11Csr(const Pkcs11KeyConfig &config, std::string &csrPem);
+
+/**
+ * @brief Write a PEM certificate to the token, replacing one under the same label
+ * @return ESP_OK, ESP_ERR_INVALID_ARG if the PEM does not parse, or ESP_FAIL on a token error
+ */
+esp_err_t storePkcs11Certificate(const Pkcs11KeyConfig &config, const std::string &certificatePem);
+
+/**
+ * @brief ProvisioningCrypto backed by the two functions above
+ */
+inline ProvisioningCrypto pkcs11Crypto(const Pkcs11KeyConfig &config)
+{
+    ProvisioningCrypto crypto;
+    crypto.createCsr = [config](std::string &csrPem) { return createPkcs11Csr(config, csrPem); };
+    crypto.storeCertificate = [config](const std::string &certificatePem) {
+        return storePkcs11Certificate(config, certificatePem);
+    };
+    return crypto;
+}
+
+} // namespace provisioning
+} // namespace lopcore
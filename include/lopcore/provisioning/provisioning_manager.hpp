@@ -0,0 +1,265 @@
+/**
+ * @file provisioning_manager.hpp
+ * @brief AWS IoT Fleet Provisioning by claim, in one MQTT session
+ *
+ * A unit leaves the line with only a claim certificate. ProvisioningManager
+ * turns it into a registered thing with its own certificate:
+ * CreateCertificateFromCsr, then RegisterThing, both over the CBOR API
+ * on the connection the claim certificate opened. The device key is
+ * created on the device and never leaves it; generating it is the slow
+ * part, so it runs while the network comes up:
+ *
+ * @code
+ * ProvisioningConfig config;
+ * config.templateName = "factory-template";
+ * config.parameters = {{"SerialNumber", serial}};
+ * ProvisioningManager provisioning(claimClient, config, &nvs, pkcs11Crypto(Pkcs11KeyConfig()));
+ *
+ * lopcore::boot::Bootstrap boot;
+ * boot.add("keys", [&] { return provisioning.prepareKeys(); }); // PKCS#11 key pair and CSR
+ * boot.add("wifi", connectWifi);
+ * boot.add("claim", [&] { return claimClient->connect(); }).after({"wifi"});
+ * boot.add("provision", [&] { return provisioning.provision(); }).after({"keys", "claim"});
+ * boot.run();
+ * @endcode
+ *
+ * Both response topic pairs are subscribed before the first request, so
+ * the exchange is two request/response round trips after the SUBACKs.
+ * The thing name, certificate and device configuration are written to
+ * NVS in one batch (one commit). Reconnect with the new certificate
+ * afterwards; the claim session is left connected.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <esp_err.h>
+#include <esp_timer.h>
+
+#include "lopcore/mqtt/imqtt_client.hpp"
+#include "lopcore/storage/nvs_storage.hpp"
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#else
+#include <condition_variable>
+#endif
+
+namespace lopcore
+{
+namespace provisioning
+{
+
+/**
+ * @brief Device-side key operations the flow needs
+ */
+struct ProvisioningCrypto
+{
+    /// Create the device key pair and return a PEM CSR for it (required)
+    std::function<esp_err_t(std::string &csrPem)> createCsr;
+    /// Install the issued certificate where the TLS transport reads it (optional)
+    std::function<esp_err_t(const std::string &certificatePem)> storeCertificate;
+};
+
+/**
+ * @brief Provisioning configuration
+ */
+struct ProvisioningConfig
+{
+    std::string templateName;                                    ///< Fleet provisioning template
+    std::vector<std::pair<std::string, std::string>> parameters; ///< Template parameters (e.g. SerialNumber)
+    uint32_t responseTimeoutMs{10000};                           ///< Wait for each response
+    mqtt::MqttQos qos{mqtt::MqttQos::AT_LEAST_ONCE};             ///< QoS of requests and subscriptions
+    std::string thingNameKey{"fp_thing"};                        ///< NVS key of the thing name
+    std::string certificateIdKey{"fp_cert_id"};                  ///< NVS key of the certificate ID
+    std::string certificateKey{"fp_cert"};                       ///< NVS key of the certificate PEM
+    std::string configurationKey{"fp_config"};                   ///< NVS key of deviceConfiguration (CBOR map)
+
+    /**
+     * @brief Validate provisioning configuration
+     * @return ESP_OK if valid, error code otherwise
+     */
+    esp_err_t validate() const
+    {
+        if (templateName.empty() || templateName.find_first_of("/+#") != std::string::npos ||
+            responseTimeoutMs == 0)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        for (const std::string *key : {&thingNameKey, &certificateIdKey, &certificateKey, &configurationKey})
+        {
+            if (key->empty() || key->size() > 15)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+
+        return ESP_OK;
+    }
+};
+
+/**
+ * @brief What provisioning produced
+ */
+struct ProvisioningResult
+{
+    std::string thingName;                                                ///< Registered thing
+    std::string certificateId;                                            ///< ID of the issued certificate
+    std::string certificatePem;                                           ///< Issued certificate
+    std::vector<std::pair<std::string, std::string>> deviceConfiguration; ///< Template output, values as text
+};
+
+/**
+ * @brief A rejected request, as the service described it
+ */
+struct ProvisioningError
+{
+    uint32_t statusCode{0};   ///< HTTP-style status (e.g. 400)
+    std::string errorCode;    ///< Service error code
+    std::string errorMessage; ///< Service error text
+};
+
+/**
+ * @brief Where the time went, for line throughput
+ */
+struct ProvisioningTimings
+{
+    int64_t keysUs{0};        ///< Key pair and CSR generation
+    int64_t certificateUs{0}; ///< Subscriptions and CreateCertificateFromCsr
+    int64_t registerUs{0};    ///< RegisterThing
+    int64_t storeUs{0};       ///< Certificate install and NVS batch
+    int64_t totalUs{0};       ///< provision() from start to end (keys included if it had to make them)
+};
+
+/**
+ * @brief Runs fleet provisioning by claim over one connected client
+ *
+ * prepareKeys() and provision() may be called from different tasks;
+ * provision() waits for a prepareKeys() in progress and makes the keys
+ * itself if nobody did.
+ */
+class ProvisioningManager
+{
+public:
+    /**
+     * @brief Monotonic time source in microseconds
+     */
+    using TimeSource = int64_t (*)();
+
+    /**
+     * @param client Client connected with the claim certificate
+     * @param config Template and storage settings
+     * @param storage Where results are kept (nullptr = not persisted); must outlive the manager
+     * @param crypto Key pair and certificate operations
+     * @param timeSource Monotonic clock (esp_timer_get_time unless testing)
+     */
+    ProvisioningManager(std::shared_ptr<mqtt::IMqttClient> client,
+                        const ProvisioningConfig &config,
+                        NvsStorage *storage,
+                        ProvisioningCrypto crypto,
+                        TimeSource timeSource = esp_timer_get_time);
+
+    ~ProvisioningManager();
+
+    ProvisioningManager(const ProvisioningManager &) = delete;
+    ProvisioningManager &operator=(const ProvisioningManager &) = delete;
+
+    /**
+     * @brief Whether storage already holds a thing name from an earlier run
+     */
+    bool isProvisioned() const;
+
+    /**
+     * @brief Create the device key pair and its CSR (once)
+     * @return ESP_OK, ESP_ERR_INVALID_ARG without a createCsr function, or its error
+     */
+    esp_err_t prepareKeys();
+
+    /**
+     * @brief Run CreateCertificateFromCsr and RegisterThing, then store the results
+     *
+     * @return ESP_OK on success
+     *         ESP_ERR_INVALID_ARG if the configuration is invalid
+     *         ESP_ERR_TIMEOUT if a response did not arrive in time
+     *         ESP_FAIL if the service rejected a request (see lastError())
+     *         ESP_ERR_INVALID_RESPONSE if a response could not be decoded
+     *         otherwise the error of key generation, the client or storage
+     */
+    esp_err_t provision();
+
+    /**
+     * @brief Result of the last successful provision()
+     */
+    ProvisioningResult result() const;
+
+    /**
+     * @brief Why the last rejected request was rejected
+     */
+    ProvisioningError lastError() const;
+
+    ProvisioningTimings timings() const;
+
+    /**
+     * @brief Request topics (CBOR API)
+     */
+    static std::string createCertificateTopic();
+    static std::string registerThingTopic(const std::string &templateName);
+
+private:
+    /**
+     * @brief Response to the request in flight
+     */
+    struct Response
+    {
+        bool ready{false};            ///< A response arrived
+        bool accepted{false};         ///< It was on the accepted topic
+        std::vector<uint8_t> payload; ///< Its CBOR payload
+    };
+
+    /**
+     * @brief Publish a request and wait for its accepted or rejected response
+     */
+    esp_err_t exchange(const std::string &topic, const std::vector<uint8_t> &request, Response &response);
+
+    void onResponse(const mqtt::MqttMessage &message);
+    esp_err_t rejected(const char *request, const Response &response);
+    esp_err_t store(const ProvisioningResult &result, const std::vector<uint8_t> &configuration);
+
+    std::shared_ptr<mqtt::IMqttClient> client_; ///< Client connected with the claim certificate
+    const ProvisioningConfig config_;           ///< Configuration
+    NvsStorage *storage_;                       ///< Result storage (optional)
+    const ProvisioningCrypto crypto_;           ///< Key operations
+    const TimeSource timeSource_;               ///< Monotonic clock
+
+    std::mutex keysMutex_; ///< Held while the keys are made
+    std::string csrPem_;   ///< CSR from prepareKeys(), empty until then
+    int64_t keysUs_{0};    ///< Time prepareKeys() took
+
+    mutable std::mutex mutex_;    ///< Guards everything below
+    std::string expected_;        ///< Request topic whose response is awaited
+    Response response_;           ///< Response to the request in flight
+    ProvisioningResult result_;   ///< Last result
+    ProvisioningError error_;     ///< Last rejection
+    ProvisioningTimings timings_; ///< Last timings
+
+#ifdef ESP_PLATFORM
+    SemaphoreHandle_t arrived_; ///< Given when a response arrives
+#else
+    std::condition_variable arrived_; ///< Notified when a response arrives
+#endif
+};
+
+} // namespace provisioning
+} // namespace lopcore
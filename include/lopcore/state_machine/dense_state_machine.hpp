@@ -0,0 +1,541 @@
+/**
+ * @file dense_state_machine.hpp
+ * @brief State machine for small dense enums, with array dispatch
+ *
+ * Part of LopCore - Modern C++ Middleware for ESP32
+ *
+ * StateMachine keeps handlers and rules in hash maps and sets, so every
+ * update() hashes the state and every checked transition walks a tree.
+ * When the states are a dense enum (0, 1, ... N-1), DenseStateMachine
+ * indexes arrays instead: handler lookup is one load, a rule check is one
+ * bit test, and nothing is allocated after setup. It suits a control
+ * loop calling update() at 1 kHz.
+ *
+ * States may also be nested: setParent() makes one state a substate of
+ * another, so behaviour shared by several states lives once in their
+ * parent. The ancestry of every state is tabulated when the hierarchy is
+ * set up, so a transition finds the least common ancestor with one AND
+ * and a popcount and runs exactly the exit and entry chains it needs.
+ *
+ * @copyright Copyright (c) 2025 LopTech
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "lopcore/logging/logger.hpp"
+
+#include "istate.hpp"
+#include "state_observer.hpp"
+
+namespace lopcore
+{
+
+// Logging tag for dense state machine
+static constexpr const char *DENSE_STATE_MACHINE_TAG = "DenseStateMachine";
+
+/**
+ * @brief Allowed transitions between StateCount dense states, as a bit matrix
+ *
+ * Built at compile time; a table with no allow() calls allows every
+ * transition, like StateMachine without rules.
+ *
+ * @code
+ * enum class Motor { IDLE, RAMP, RUN, FAULT, COUNT };
+ *
+ * constexpr auto motorRules = TransitionTable<Motor, 4>()
+ *                                 .allow(Motor::IDLE, Motor::RAMP)
+ *                                 .allow(Motor::RAMP, Motor::RUN)
+ *                                 .allowFromAll(Motor::FAULT);
+ * static_assert(!motorRules.allows(Motor::IDLE, Motor::RUN));
+ * @endcode
+ *
+ * @tparam StateEnum Enum whose values are 0 to StateCount - 1
+ * @tparam StateCount Number of states, at most 64
+ */
+template<typename StateEnum, size_t StateCount>
+class TransitionTable
+{
+    static_assert(StateCount > 0 && StateCount <= 64, "TransitionTable rows are 64-bit masks");
+
+public:
+    constexpr TransitionTable() = default;
+
+    /**
+     * @brief Allow from -> to
+     *
+     * @return Copy of this table with the transition allowed, for chaining
+     */
+    constexpr TransitionTable allow(StateEnum from, StateEnum to) const
+    {
+        TransitionTable table = *this;
+        table.rows_[index(from)] |= bit(to);
+        table.restricted_ = true;
+        return table;
+    }
+
+    /**
+     * @brief Allow every state to enter to (an error or emergency state)
+     */
+    constexpr TransitionTable allowFromAll(StateEnum to) const
+    {
+        TransitionTable table = *this;
+        for (size_t from = 0; from < StateCount; from++)
+        {
+            table.rows_[from] |= bit(to);
+        }
+        table.restricted_ = true;
+        return table;
+    }
+
+    /**
+     * @brief Whether from -> to is allowed
+     *
+     * States outside the table are never allowed.
+     */
+    constexpr bool allows(StateEnum from, StateEnum to) const
+    {
+        size_t row = static_cast<size_t>(from);
+        size_t column = static_cast<size_t>(to);
+        if (row >= StateCount || column >= StateCount)
+        {
+            return false;
+        }
+        return !restricted_ || ((rows_[row] >> column) & 1u) != 0;
+    }
+
+    /**
+     * @brief Whether any transition was allowed explicitly
+     */
+    constexpr bool restricts() const
+    {
+        return restricted_;
+    }
+
+    static constexpr size_t size()
+    {
+        return StateCount;
+    }
+
+private:
+    static constexpr size_t index(StateEnum state)
+    {
+        return static_cast<size_t>(state);
+    }
+
+    static constexpr uint64_t bit(StateEnum state)
+    {
+        return uint64_t{1} << static_cast<size_t>(state);
+    }
+
+    std::array<uint64_t, StateCount> rows_{}; ///< Bit to of row from: from -> to allowed
+    bool restricted_ = false;
+};
+
+/**
+ * @brief State machine over a dense enum, dispatching through arrays
+ *
+ * Same hooks and transition order as StateMachine (exit, enter,
+ * observers), with these differences:
+ * - Handlers are not owned: register states that outlive the machine
+ *   (members or statics), so registering allocates nothing
+ * - Rules come from a TransitionTable, usually constexpr; runtime
+ *   addTransitionRule() sets bits in the machine's copy
+ * - At most MaxObservers observers, stored inline, and the last
+ *   HistoryDepth states
+ * - No warning is logged for a transition to the current state or to a
+ *   state without a handler, keeping the tick path free of logging
+ * - States can be nested up to MaxDepth levels with setParent()
+ *
+ * With nesting, the machine is in its current state and in all of that
+ * state's ancestors. A transition exits from the current state up to,
+ * not including, the least common ancestor of source and target, then
+ * enters down to the target; a transition to an ancestor or descendant
+ * of the current state neither exits nor re-enters the outer one.
+ * update() runs the ancestors' update() first, outermost to innermost.
+ * Rules and observers see only the current (innermost) states.
+ *
+ * update(), transition() and the rule check take constant time and do
+ * not allocate. Not thread-safe: drive it from one task.
+ *
+ * @code
+ * DenseStateMachine<Motor, 4> motor(Motor::IDLE, motorRules);
+ * motor.registerState(Motor::RUN, runState);
+ * motor.transition(Motor::RAMP);
+ * // Control task, 1 kHz
+ * motor.update();
+ *
+ * // ONLINE and DEGRADED share the reconnect logic of CONNECTED
+ * link.setParent(Link::ONLINE, Link::CONNECTED);
+ * link.setParent(Link::DEGRADED, Link::CONNECTED);
+ * @endcode
+ *
+ * @tparam StateEnum Enum whose values are 0 to StateCount - 1
+ * @tparam StateCount Number of states, at most 64
+ * @tparam MaxObservers Observer slots
+ * @tparam HistoryDepth States kept by getHistory()
+ * @tparam MaxDepth Nesting levels, counting top-level states as one
+ */
+template<typename StateEnum,
+         size_t StateCount,
+         size_t MaxObservers = 4,
+         size_t HistoryDepth = 8,
+         size_t MaxDepth = 4>
+class DenseStateMachine
+{
+    static_assert(StateCount > 0 && StateCount <= 64, "Ancestry is kept as 64-bit masks");
+    static_assert(HistoryDepth > 0, "History keeps at least the current state");
+    static_assert(MaxDepth > 0 && MaxDepth <= 64, "Nesting is bounded by the state count");
+
+public:
+    using StateChangeCallback = InplaceFunction<void(StateEnum from, StateEnum to)>;
+    using Rules = TransitionTable<StateEnum, StateCount>;
+
+    /**
+     * @brief Construct a state machine with an initial state
+     *
+     * @param initialState The starting state (no handler needs to be registered yet)
+     * @param rules Allowed transitions; the default allows all
+     */
+    explicit DenseStateMachine(StateEnum initialState, const Rules &rules = Rules())
+        : currentState_(initialState), previousState_(initialState), rules_(rules)
+    {
+        parent_.fill(NO_PARENT);
+        buildAncestry();
+        addToHistory(initialState);
+    }
+
+    /**
+     * @brief Register a state handler, replacing any earlier one
+     *
+     * @param state The state enum value
+     * @param handler Handler, which must outlive the machine
+     * @return false if state is outside the enum range
+     */
+    bool registerState(StateEnum state, IState<StateEnum> &handler)
+    {
+        if (!inRange(state))
+        {
+            LOPCORE_LOGE(DENSE_STATE_MACHINE_TAG, "State %u out of range", static_cast<unsigned>(state));
+            return false;
+        }
+        handlers_[static_cast<size_t>(state)] = &handler;
+        return true;
+    }
+
+    /**
+     * @brief Remove the handler of state
+     */
+    void unregisterState(StateEnum state)
+    {
+        if (inRange(state))
+        {
+            handlers_[static_cast<size_t>(state)] = nullptr;
+        }
+    }
+
+    /**
+     * @brief Make child a substate of parent, replacing any earlier parent
+     *
+     * Set the hierarchy up before the first transition; it rebuilds the
+     * ancestry tables.
+     *
+     * @return false if a state is out of range, or the change would form a
+     *         cycle or nest deeper than MaxDepth
+     */
+    bool setParent(StateEnum child, StateEnum parent)
+    {
+        if (!inRange(child) || !inRange(parent) || child == parent)
+        {
+            LOPCORE_LOGE(DENSE_STATE_MACHINE_TAG, "Invalid parent for state %u", static_cast<unsigned>(child));
+            return false;
+        }
+
+        uint8_t previous = parent_[static_cast<size_t>(child)];
+        parent_[static_cast<size_t>(child)] = static_cast<uint8_t>(parent);
+        if (!buildAncestry())
+        {
+            parent_[static_cast<size_t>(child)] = previous;
+            buildAncestry();
+            LOPCORE_LOGE(DENSE_STATE_MACHINE_TAG, "Parent of state %u would form a cycle or nest too deep",
+                         static_cast<unsigned>(child));
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief The parent of state, if it has one
+     */
+    std::optional<StateEnum> getParent(StateEnum state) const
+    {
+        if (!inRange(state) || parent_[static_cast<size_t>(state)] == NO_PARENT)
+        {
+            return std::nullopt;
+        }
+        return static_cast<StateEnum>(parent_[static_cast<size_t>(state)]);
+    }
+
+    /**
+     * @brief Whether the machine is in state: the current state or one of its ancestors
+     */
+    bool isInState(StateEnum state) const
+    {
+        return inRange(state) &&
+               ((ancestors_[static_cast<size_t>(currentState_)] >> static_cast<size_t>(state)) & 1u) != 0;
+    }
+
+    /**
+     * @brief Transition to a new state
+     *
+     * Calls onExit() of the current state and of its ancestors below the
+     * least common ancestor, innermost first, then onEnter() down to the
+     * new state, then the observers. A transition to the current state does
+     * nothing.
+     *
+     * @param newState The target state
+     * @return true if the machine is in newState afterwards, false if the
+     *         rules forbid the transition or newState is out of range
+     */
+    bool transition(StateEnum newState)
+    {
+        return transition(newState, [] {});
+    }
+
+    /**
+     * @brief Transition, running action between onExit() and onEnter()
+     *
+     * The transition action of an event table row (see EventStateMachine).
+     * action does not run if the transition does not happen.
+     */
+    template<typename Action>
+    bool transition(StateEnum newState, Action &&action)
+    {
+        if (newState == currentState_)
+        {
+            return inRange(newState);
+        }
+        if (!rules_.allows(currentState_, newState))
+        {
+            LOPCORE_LOGE(DENSE_STATE_MACHINE_TAG, "Transition %u -> %u not allowed",
+                         static_cast<unsigned>(currentState_), static_cast<unsigned>(newState));
+            return false;
+        }
+
+        size_t from = static_cast<size_t>(currentState_);
+        size_t to = static_cast<size_t>(newState);
+        // Ancestors form a chain, so the shared ones are the levels above the LCA's child
+        size_t shared = popcount(ancestors_[from] & ancestors_[to]);
+
+        for (size_t level = depth_[from] + 1; level-- > shared;)
+        {
+            if (IState<StateEnum> *exiting = handler(static_cast<StateEnum>(path_[from][level])))
+            {
+                exiting->onExit();
+            }
+        }
+        action();
+
+        previousState_ = currentState_;
+        currentState_ = newState;
+        addToHistory(newState);
+
+        for (size_t level = shared; level <= depth_[to]; level++)
+        {
+            if (IState<StateEnum> *entering = handler(static_cast<StateEnum>(path_[to][level])))
+            {
+                entering->onEnter();
+            }
+        }
+
+        observers_.notify(previousState_, currentState_);
+        return true;
+    }
+
+    /**
+     * @brief Run update() of the current state's ancestors, then of the current state
+     */
+    void update()
+    {
+        size_t current = static_cast<size_t>(currentState_);
+        for (size_t level = 0; level <= depth_[current]; level++)
+        {
+            if (IState<StateEnum> *state = handler(static_cast<StateEnum>(path_[current][level])))
+            {
+                state->update();
+            }
+        }
+    }
+
+    StateEnum getCurrentState() const
+    {
+        return currentState_;
+    }
+
+    StateEnum getPreviousState() const
+    {
+        return previousState_;
+    }
+
+    /**
+     * @brief Allow from -> to at runtime
+     *
+     * Once any rule exists, only allowed transitions succeed.
+     */
+    void addTransitionRule(StateEnum from, StateEnum to)
+    {
+        if (inRange(from) && inRange(to))
+        {
+            rules_ = rules_.allow(from, to);
+        }
+    }
+
+    bool isTransitionAllowed(StateEnum from, StateEnum to) const
+    {
+        return rules_.allows(from, to);
+    }
+
+    /**
+     * @brief Allow every transition again
+     */
+    void clearTransitionRules()
+    {
+        rules_ = Rules();
+    }
+
+    /**
+     * @brief Add an observer for state changes
+     *
+     * @return Token for removeObserver(), or 0 if all MaxObservers slots are taken
+     */
+    ObserverToken addObserver(StateChangeCallback callback)
+    {
+        ObserverToken token = observers_.add(std::move(callback));
+        if (token == 0)
+        {
+            LOPCORE_LOGE(DENSE_STATE_MACHINE_TAG, "No observer slot left");
+        }
+        return token;
+    }
+
+    /**
+     * @brief Remove an observer; safe from inside an observer
+     */
+    bool removeObserver(ObserverToken token)
+    {
+        return observers_.remove(token);
+    }
+
+    void clearObservers()
+    {
+        observers_.clear();
+    }
+
+    /**
+     * @brief The last HistoryDepth states, oldest first
+     */
+    std::vector<StateEnum> getHistory() const
+    {
+        std::vector<StateEnum> history;
+        history.reserve(historySize_);
+        size_t oldest = (historyNext_ + HistoryDepth - historySize_) % HistoryDepth;
+        for (size_t i = 0; i < historySize_; i++)
+        {
+            history.push_back(history_[(oldest + i) % HistoryDepth]);
+        }
+        return history;
+    }
+
+    void clearHistory()
+    {
+        historySize_ = 0;
+        historyNext_ = 0;
+        addToHistory(currentState_);
+    }
+
+    static constexpr size_t stateCount()
+    {
+        return StateCount;
+    }
+
+private:
+    static constexpr uint8_t NO_PARENT = 0xFF;
+
+    static constexpr bool inRange(StateEnum state)
+    {
+        return static_cast<size_t>(state) < StateCount;
+    }
+
+    IState<StateEnum> *handler(StateEnum state) const
+    {
+        return inRange(state) ? handlers_[static_cast<size_t>(state)] : nullptr;
+    }
+
+    static size_t popcount(uint64_t bits)
+    {
+        return static_cast<size_t>(__builtin_popcountll(bits));
+    }
+
+    /**
+     * @brief Tabulate each state's path from its top-level ancestor
+     *
+     * @return false if a chain is longer than MaxDepth (or loops)
+     */
+    bool buildAncestry()
+    {
+        for (size_t state = 0; state < StateCount; state++)
+        {
+            std::array<uint8_t, MaxDepth> chain{}; // Innermost first
+            size_t length = 0;
+            for (size_t link = state; link != NO_PARENT; link = parent_[link])
+            {
+                if (length == MaxDepth)
+                {
+                    return false;
+                }
+                chain[length++] = static_cast<uint8_t>(link);
+            }
+
+            depth_[state] = static_cast<uint8_t>(length - 1);
+            ancestors_[state] = 0;
+            for (size_t level = 0; level < length; level++)
+            {
+                path_[state][level] = chain[length - 1 - level];
+                ancestors_[state] |= uint64_t{1} << chain[level];
+            }
+        }
+        return true;
+    }
+
+    void addToHistory(StateEnum state)
+    {
+        history_[historyNext_] = state;
+        historyNext_ = (historyNext_ + 1) % HistoryDepth;
+        if (historySize_ < HistoryDepth)
+        {
+            historySize_++;
+        }
+    }
+
+    StateEnum currentState_;
+    StateEnum previousState_;
+    Rules rules_;
+    std::array<IState<StateEnum> *, StateCount> handlers_{};
+    ObserverList<StateChangeCallback, MaxObservers> observers_;
+    std::array<StateEnum, HistoryDepth> history_{};
+    size_t historyNext_ = 0; ///< Slot the next state is written to
+    size_t historySize_ = 0;
+
+    std::array<uint8_t, StateCount> parent_{};                     ///< Parent index, or NO_PARENT
+    std::array<uint8_t, StateCount> depth_{};                      ///< 0 for top-level states
+    std::array<std::array<uint8_t, MaxDepth>, StateCount> path_{}; ///< Top-level ancestor down to the state
+    std::array<uint64_t, StateCount> ancestors_{};                 ///< Bit per ancestor, the state included
+};
+
+} // namespace lopcore
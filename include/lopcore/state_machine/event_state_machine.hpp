@@ -0,0 +1,405 @@
+/**
+ * @file event_state_machine.hpp
+ * @brief Event-driven state machine with a lock-free event queue
+ *
+ * Part of LopCore - Modern C++ Middleware for ESP32
+ *
+ * StateMachine::transition() runs the hooks on whichever task calls it,
+ * so two tasks changing state race unless the application locks around
+ * it. EventStateMachine separates the two: any task or ISR posts an
+ * event into a fixed-capacity lock-free queue, and one owner task
+ * dispatches the events one at a time, each to completion, through a
+ * table of guarded transitions:
+ *
+ * @code
+ * enum class Door { CLOSED, OPEN, LOCKED };
+ * enum class DoorEvent { OPEN, CLOSE, LOCK, UNLOCK };
+ *
+ * EventStateMachine<Door, 3, DoorEvent, 4> door(Door::CLOSED, 16);
+ * door.on(Door::CLOSED, DoorEvent::OPEN, Door::OPEN);
+ * door.on(Door::CLOSED, DoorEvent::LOCK, Door::LOCKED, [](const auto &e) { return e.data == pin; });
+ * door.on(Door::LOCKED, DoorEvent::UNLOCK, Door::CLOSED, nullptr, [](const auto &) { beep(); });
+ *
+ * door.post(DoorEvent::OPEN);               // Any task
+ * door.postFromIsr(DoorEvent::CLOSE, 0, &woken); // Interrupt handler
+ *
+ * while (true) {                            // Owner task
+ *     door.waitForEvent(100);
+ *     door.dispatch();
+ * }
+ * @endcode
+ *
+ * @copyright Copyright (c) 2025 LopTech
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <type_traits>
+
+#include "lopcore/logging/log_ring_buffer.hpp"
+
+#include "dense_state_machine.hpp"
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace lopcore
+{
+
+/**
+ * @brief Event posted to an EventStateMachine
+ *
+ * @tparam EventEnum Dense enum of event types
+ * @tparam Payload Trivially copyable data carried with the event
+ */
+template<typename EventEnum, typename Payload = uint32_t>
+struct StateEvent
+{
+    EventEnum id;
+    Payload data;
+};
+
+/**
+ * @brief EventStateMachine counters
+ */
+struct EventStateMachineStats
+{
+    uint32_t posted{0};      ///< Events accepted into the queue
+    uint32_t dropped{0};     ///< Events refused because the queue was full
+    uint32_t dispatched{0};  ///< Events taken from the queue and run
+    uint32_t transitions{0}; ///< Events that matched a row (state changes and internal actions)
+    uint32_t unhandled{0};   ///< Events no row of the current state or its ancestors took
+};
+
+/**
+ * @brief State machine driven by queued events, run to completion by one owner task
+ *
+ * post() and postFromIsr() may be called from any task or interrupt; they
+ * claim a queue slot with one compare-and-swap and never block. All other
+ * methods, and every hook, guard and action, run on the owner task, so
+ * states need no locking. An event posted by an action is queued behind
+ * the events already waiting and never interrupts the current one.
+ *
+ * The transition table is indexed by (state, event), so finding the
+ * rows for an event is one array load; rows for the same pair are tried
+ * in the order they were added, and the first whose guard passes wins:
+ * exit hook, action, entry hook, observers. A row whose target is its
+ * source is internal: only its action runs.
+ *
+ * With nested states (machine().setParent()), an event the current state
+ * has no matching row for bubbles to its parent, then the grandparent,
+ * so a row on a parent handles the event for all of its substates. A
+ * parent's internal row runs its action and leaves the current state as
+ * it is.
+ *
+ * Guards and actions are std::function, set up before dispatching starts;
+ * dispatching allocates nothing. postFromIsr() is not in IRAM, so it must
+ * not be called while the flash cache is disabled.
+ *
+ * @tparam StateEnum Dense enum of states, 0 to StateCount - 1
+ * @tparam StateCount Number of states, at most 64
+ * @tparam EventEnum Dense enum of events, 0 to EventCount - 1
+ * @tparam EventCount Number of event types
+ * @tparam Payload Trivially copyable data carried by each event
+ * @tparam MaxTransitions Rows the table holds, at most 255
+ */
+template<typename StateEnum,
+         size_t StateCount,
+         typename EventEnum,
+         size_t EventCount,
+         typename Payload = uint32_t,
+         size_t MaxTransitions = 32>
+class EventStateMachine
+{
+    static_assert(std::is_trivially_copyable_v<Payload>, "Events are copied through a lock-free queue");
+    static_assert(MaxTransitions > 0 && MaxTransitions < 255, "Rows are chained by 8-bit index");
+
+public:
+    using Event = StateEvent<EventEnum, Payload>;
+    using Machine = DenseStateMachine<StateEnum, StateCount>;
+    using Guard = std::function<bool(const Event &)>;
+    using Action = std::function<void(const Event &)>;
+
+    /**
+     * @param initialState The starting state
+     * @param queueCapacity Events that may wait (rounded up to a power of two)
+     */
+    EventStateMachine(StateEnum initialState, size_t queueCapacity)
+        : machine_(initialState), queue_(queueCapacity)
+    {
+        first_.fill(NO_ROW);
+    }
+
+    EventStateMachine(const EventStateMachine &) = delete;
+    EventStateMachine &operator=(const EventStateMachine &) = delete;
+
+    /**
+     * @brief The underlying machine, to register state handlers and observers
+     *
+     * Use it from the owner task only; transition() called on it directly
+     * bypasses the event table.
+     */
+    Machine &machine()
+    {
+        return machine_;
+    }
+
+    /**
+     * @brief Add a row: in from, event moves to to if guard passes
+     *
+     * @param guard Checked against the event; nullptr always passes
+     * @param action Run between from's exit and to's entry; may be nullptr
+     * @return false if the table is full or a value is out of range
+     */
+    bool on(StateEnum from, EventEnum event, StateEnum to, Guard guard = nullptr, Action action = nullptr)
+    {
+        size_t cell = cellOf(from, event);
+        if (rowCount_ == MaxTransitions || cell == NO_CELL || static_cast<size_t>(to) >= StateCount)
+        {
+            LOPCORE_LOGE(DENSE_STATE_MACHINE_TAG, "Cannot add transition row");
+            return false;
+        }
+
+        uint8_t index = static_cast<uint8_t>(rowCount_++);
+        rows_[index] = Row{to, std::move(guard), std::move(action), NO_ROW};
+
+        // Append, so alternatives are tried in the order they were added
+        uint8_t *link = &first_[cell];
+        while (*link != NO_ROW)
+        {
+            link = &rows_[*link].next;
+        }
+        *link = index;
+        return true;
+    }
+
+    /**
+     * @brief Queue an event from a task
+     *
+     * @return false if the queue is full; the event is dropped
+     */
+    bool post(EventEnum id, Payload data = Payload{})
+    {
+        if (!enqueue(id, data))
+        {
+            return false;
+        }
+#ifdef ESP_PLATFORM
+        TaskHandle_t owner = static_cast<TaskHandle_t>(owner_.load(std::memory_order_acquire));
+        if (owner != nullptr)
+        {
+            xTaskNotifyGive(owner);
+        }
+#else
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        woken_ = true;
+        wake_.notify_one();
+#endif
+        return true;
+    }
+
+    /**
+     * @brief Queue an event from an interrupt handler
+     *
+     * @param[out] higherPriorityTaskWoken Set if the owner task should run
+     *             next; pass it to portYIELD_FROM_ISR()
+     * @return false if the queue is full; the event is dropped
+     */
+    bool postFromIsr(EventEnum id, Payload data, bool *higherPriorityTaskWoken)
+    {
+#ifdef ESP_PLATFORM
+        if (!enqueue(id, data))
+        {
+            return false;
+        }
+        BaseType_t woken = pdFALSE;
+        TaskHandle_t owner = static_cast<TaskHandle_t>(owner_.load(std::memory_order_acquire));
+        if (owner != nullptr)
+        {
+            vTaskNotifyGiveFromISR(owner, &woken);
+        }
+        if (higherPriorityTaskWoken != nullptr)
+        {
+            *higherPriorityTaskWoken = woken == pdTRUE;
+        }
+        return true;
+#else
+        if (higherPriorityTaskWoken != nullptr)
+        {
+            *higherPriorityTaskWoken = false;
+        }
+        return post(id, data);
+#endif
+    }
+
+    /**
+     * @brief Run queued events to completion, oldest first (owner task)
+     *
+     * @param maxEvents Stop after this many, bounding the time spent
+     * @return Events dispatched
+     */
+    size_t dispatch(size_t maxEvents = SIZE_MAX)
+    {
+        size_t count = 0;
+        Event event{};
+        while (count < maxEvents && queue_.tryPop([&event](const Event &queued) { event = queued; }))
+        {
+            run(event);
+            count++;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Block the owner task until an event is queued
+     *
+     * The first call makes the calling task the one post() wakes.
+     *
+     * @return true if an event is waiting, false on timeout
+     */
+    bool waitForEvent(uint32_t timeoutMs)
+    {
+        if (!queue_.empty())
+        {
+            return true;
+        }
+#ifdef ESP_PLATFORM
+        owner_.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+        if (!queue_.empty()) // Posted before the owner was known
+        {
+            return true;
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs));
+#else
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        wake_.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return woken_; });
+        woken_ = false;
+#endif
+        return !queue_.empty();
+    }
+
+    StateEnum getCurrentState() const
+    {
+        return machine_.getCurrentState();
+    }
+
+    /**
+     * @brief Events waiting (approximate while producers post)
+     */
+    size_t pending() const
+    {
+        return queue_.sizeApprox();
+    }
+
+    EventStateMachineStats getStats() const
+    {
+        EventStateMachineStats stats = stats_;
+        stats.posted = posted_.load(std::memory_order_relaxed);
+        stats.dropped = dropped_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    static constexpr uint8_t NO_ROW = 0xFF;
+    static constexpr size_t NO_CELL = SIZE_MAX;
+
+    struct Row
+    {
+        StateEnum to;
+        Guard guard;
+        Action action;
+        uint8_t next; ///< Next row for the same (state, event), or NO_ROW
+    };
+
+    static size_t cellOf(StateEnum state, EventEnum event)
+    {
+        size_t s = static_cast<size_t>(state);
+        size_t e = static_cast<size_t>(event);
+        return s < StateCount && e < EventCount ? s * EventCount + e : NO_CELL;
+    }
+
+    bool enqueue(EventEnum id, Payload data)
+    {
+        if (!queue_.tryPush([id, &data](Event &slot) {
+                slot.id = id;
+                slot.data = data;
+            }))
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        posted_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void run(const Event &event)
+    {
+        stats_.dispatched++;
+        std::optional<StateEnum> source = machine_.getCurrentState();
+        for (; source; source = machine_.getParent(*source))
+        {
+            size_t cell = cellOf(*source, event.id);
+            for (uint8_t index = cell == NO_CELL ? NO_ROW : first_[cell]; index != NO_ROW; index = rows_[index].next)
+            {
+                Row &row = rows_[index];
+                if (row.guard && !row.guard(event))
+                {
+                    continue;
+                }
+
+                if (row.to == *source)
+                {
+                    if (row.action)
+                    {
+                        row.action(event);
+                    }
+                }
+                else
+                {
+                    machine_.transition(row.to, [&row, &event] {
+                        if (row.action)
+                        {
+                            row.action(event);
+                        }
+                    });
+                }
+                stats_.transitions++;
+                return;
+            }
+        }
+        stats_.unhandled++; // Not even an ancestor took it
+    }
+
+    Machine machine_;
+    LogRingBuffer<Event> queue_;
+    std::array<Row, MaxTransitions> rows_{};
+    size_t rowCount_ = 0;
+    std::array<uint8_t, StateCount * EventCount> first_; ///< First row of each (state, event), or NO_ROW
+
+    EventStateMachineStats stats_; ///< Owner-task counters
+    std::atomic<uint32_t> posted_{0};
+    std::atomic<uint32_t> dropped_{0};
+
+#ifdef ESP_PLATFORM
+    std::atomic<void *> owner_{nullptr}; ///< TaskHandle_t woken by post()
+#else
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;
+    bool woken_ = false;
+#endif
+};
+
+} // namespace lopcore
@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 namespace lopcore
 {
 
@@ -38,6 +40,9 @@ template<typename StateEnum>
 class IState
 {
 public:
+    /// nextUpdateDelayMs() value: no update() until the next transition or event
+    static constexpr uint32_t NO_UPDATE = UINT32_MAX;
+
     virtual ~IState() = default;
 
     /**
@@ -55,6 +60,34 @@ public:
      */
     virtual void update() = 0;
 
+    /**
+     * @brief How long until update() should run again
+     *
+     * Asked by StateMachine::tick() after each update(): return a fixed
+     * period, or compute the next wakeup (a timeout, the next sample), or
+     * NO_UPDATE for a state that only waits for events. The task driving
+     * the machine can sleep until then (see TickScheduler).
+     *
+     * @return Milliseconds; the default 0 updates on every tick()
+     */
+    virtual uint32_t nextUpdateDelayMs()
+    {
+        return 0;
+    }
+
+    /**
+     * @brief Called when a timer started by StateMachine::startTimer() fires
+     *
+     * Timers belong to the state that was current when they started and
+     * are cancelled when it is left, so this only sees its own timers.
+     *
+     * @param timerId The id the timer was started with
+     */
+    virtual void onTimer(uint32_t timerId)
+    {
+        (void)timerId;
+    }
+
     /**
      * @brief Called once when leaving this state
      *
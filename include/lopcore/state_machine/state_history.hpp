@@ -0,0 +1,212 @@
+/**
+ * @file state_history.hpp
+ * @brief Fixed-capacity, timestamped ring of visited states
+ *
+ * Part of LopCore - Modern C++ Middleware for ESP32
+ *
+ * @copyright Copyright (c) 2025 LopTech
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace lopcore
+{
+
+/**
+ * @brief One visited state and when it was entered
+ */
+template<typename StateEnum>
+struct StateHistoryEntry
+{
+    StateEnum state;
+    int64_t enteredUs; ///< Monotonic time of entry, in microseconds
+};
+
+/**
+ * @brief The last capacity() states a StateMachine entered, oldest first
+ *
+ * Storage is allocated when the capacity is set; recording a state
+ * overwrites the oldest entry once the ring is full, so a transition
+ * costs the same with 10 entries or 256. Read it in place, by index or
+ * with a range-for:
+ *
+ * @code
+ * const auto &history = sm.history();
+ * for (size_t i = 0; i < history.size(); i++) {
+ *     printf("%d for %lld us\n", static_cast<int>(history[i].state), history.timeInStateUs(i, now));
+ * }
+ * @endcode
+ *
+ * Not thread-safe; read it from the task that drives the machine.
+ */
+template<typename StateEnum>
+class StateHistory
+{
+public:
+    using Entry = StateHistoryEntry<StateEnum>;
+
+    /**
+     * @brief Forward iterator, oldest entry first
+     */
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Entry;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Entry *;
+        using reference = const Entry &;
+
+        const_iterator(const StateHistory *history, size_t index) : history_(history), index_(index)
+        {
+        }
+
+        reference operator*() const
+        {
+            return (*history_)[index_];
+        }
+
+        pointer operator->() const
+        {
+            return &(*history_)[index_];
+        }
+
+        const_iterator &operator++()
+        {
+            index_++;
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator previous = *this;
+            index_++;
+            return previous;
+        }
+
+        bool operator==(const const_iterator &other) const
+        {
+            return index_ == other.index_ && history_ == other.history_;
+        }
+
+        bool operator!=(const const_iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        const StateHistory *history_;
+        size_t index_;
+    };
+
+    explicit StateHistory(size_t capacity) : entries_(capacity)
+    {
+    }
+
+    /**
+     * @brief Record a state, dropping the oldest entry if full
+     */
+    void push(StateEnum state, int64_t enteredUs)
+    {
+        if (entries_.empty())
+        {
+            return;
+        }
+        entries_[(oldest_ + size_) % entries_.size()] = Entry{state, enteredUs};
+        if (size_ < entries_.size())
+        {
+            size_++;
+        }
+        else
+        {
+            oldest_ = (oldest_ + 1) % entries_.size();
+        }
+    }
+
+    /**
+     * @brief Change the capacity, keeping the newest entries that fit
+     *
+     * Allocates; call it at setup, not per transition.
+     */
+    void setCapacity(size_t capacity)
+    {
+        size_t kept = size_ < capacity ? size_ : capacity;
+        std::vector<Entry> entries(capacity);
+        for (size_t i = 0; i < kept; i++)
+        {
+            entries[i] = (*this)[size_ - kept + i];
+        }
+        entries_.swap(entries);
+        oldest_ = 0;
+        size_ = kept;
+    }
+
+    void clear()
+    {
+        oldest_ = 0;
+        size_ = 0;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    size_t capacity() const
+    {
+        return entries_.size();
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    /**
+     * @brief Entry i, 0 being the oldest; i must be below size()
+     */
+    const Entry &operator[](size_t i) const
+    {
+        return entries_[(oldest_ + i) % entries_.size()];
+    }
+
+    /**
+     * @brief The most recent entry; the history must not be empty
+     */
+    const Entry &newest() const
+    {
+        return (*this)[size_ - 1];
+    }
+
+    /**
+     * @brief How long entry i's state lasted: until the next entry, or until nowUs for the newest
+     */
+    int64_t timeInStateUs(size_t i, int64_t nowUs) const
+    {
+        int64_t leftUs = i + 1 < size_ ? (*this)[i + 1].enteredUs : nowUs;
+        return leftUs - (*this)[i].enteredUs;
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, size_);
+    }
+
+private:
+    std::vector<Entry> entries_;
+    size_t oldest_ = 0; ///< Slot of entry 0
+    size_t size_ = 0;
+};
+
+} // namespace lopcore
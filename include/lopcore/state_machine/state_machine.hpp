@@ -10,16 +10,26 @@
 
 #pragma once
 
-#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <set>
 #include <unordered_map>
 #include <vector>
 
+#include "lopcore/logging/log_ring_buffer.hpp"
 #include "lopcore/logging/logger.hpp"
 
 #include "istate.hpp"
+#include "state_history.hpp"
+#include "state_observer.hpp"
+#include "state_profiler.hpp"
+
+#ifdef ESP_PLATFORM
+#include <esp_timer.h>
+#endif
 
 namespace lopcore
 {
@@ -34,11 +44,13 @@ static constexpr const char *STATE_MACHINE_TAG = "StateMachine";
  * - Type-safe state transitions using enums
  * - Entry/exit/update hooks for each state
  * - Transition validation rules
- * - Observer pattern for state changes
- * - State history tracking
+ * - Observer pattern for state changes, allocation-free, optionally deferred
+ * - Per-state timeouts and timers, delivered by tick() or update()
+ * - State history tracking, timestamped, in a fixed-capacity ring
  * - Thread-safe operation (when used with proper locking)
  *
  * @tparam StateEnum The enum class representing your application states
+ * @tparam MaxObservers Observer slots, immediate and deferred together
  *
  * @example
  * enum class AppState { INIT, RUNNING, ERROR };
@@ -53,11 +65,15 @@ static constexpr const char *STATE_MACHINE_TAG = "StateMachine";
  * // In your main loop
  * sm.update();
  */
-template<typename StateEnum>
+template<typename StateEnum, size_t MaxObservers = 8>
 class StateMachine
 {
 public:
-    using StateChangeCallback = std::function<void(StateEnum from, StateEnum to)>;
+    using StateChangeCallback = InplaceFunction<void(StateEnum from, StateEnum to)>;
+    using TimerId = uint32_t;
+
+    /// Id reserved for the timers armed by setTimeout()
+    static constexpr TimerId STATE_TIMEOUT_TIMER = UINT32_MAX;
 
     /**
      * @brief Construct a state machine with an initial state
@@ -65,9 +81,10 @@ public:
      * @param initialState The starting state (no handler needs to be registered yet)
      */
     explicit StateMachine(StateEnum initialState)
-        : currentState_(initialState), previousState_(initialState), maxHistorySize_(10)
+        : currentState_(initialState), previousState_(initialState), history_(10)
     {
-        history_.push_back(initialState);
+        timers_.reserve(8);
+        history_.push(initialState, enteredUs_);
     }
 
     /**
@@ -126,16 +143,26 @@ public:
             }
         }
 
+        int64_t startUs = profiler_ ? nowUs() : 0;
+        int64_t leftEnteredUs = enteredUs_;
+
         // Call exit on current state if handler exists
         auto currentIt = states_.find(currentState_);
         if (currentIt != states_.end() && currentIt->second)
         {
             currentIt->second->onExit();
         }
+        int64_t exitedUs = profiler_ ? nowUs() : 0;
 
         // Update state
         previousState_ = currentState_;
         currentState_ = newState;
+        nextUpdateUs_ = 0; // The new state's first tick() updates at once
+        transitionCount_++;
+
+        // Timers belong to the state just left; onEnter() may start new ones
+        timers_.clear();
+        armTimeout(newState);
 
         // Add to history
         addToHistory(newState);
@@ -151,6 +178,11 @@ public:
             LOPCORE_LOGW(STATE_MACHINE_TAG, "No handler registered for new state");
         }
 
+        if (profiler_)
+        {
+            profiler_->recordTransition(previousState_, newState, leftEnteredUs, startUs, exitedUs, nowUs());
+        }
+
         // Notify observers
         notifyObservers(previousState_, currentState_);
 
@@ -165,6 +197,7 @@ public:
      */
     void update()
     {
+        fireTimers();
         auto it = states_.find(currentState_);
         if (it != states_.end() && it->second)
         {
@@ -172,6 +205,136 @@ public:
         }
     }
 
+    /**
+     * @brief Update the current state if its update is due
+     *
+     * The per-state alternative to calling update() at a fixed rate: each
+     * state says through IState::nextUpdateDelayMs() when it next needs
+     * updating, and the caller sleeps for the returned time (TickScheduler
+     * does, waking early for events). A state entered by transition() is
+     * updated on the next tick().
+     *
+     * Expired timers fire first, so a state that only waits for a
+     * timeout costs nothing until it expires.
+     *
+     * @return Milliseconds until the next update or timer is due (0 if due
+     *         now), or IState::NO_UPDATE if neither is pending
+     */
+    uint32_t tick()
+    {
+        fireTimers();
+        int64_t now = nowUs();
+        if (nextUpdateUs_ != NEVER && now >= nextUpdateUs_)
+        {
+            auto it = states_.find(currentState_);
+            if (it == states_.end() || !it->second)
+            {
+                nextUpdateUs_ = NEVER;
+            }
+            else
+            {
+                uint32_t transitions = transitionCount_;
+                it->second->update();
+                if (transitionCount_ != transitions)
+                {
+                    return 0; // update() moved on; the new state is due
+                }
+
+                uint32_t delayMs = it->second->nextUpdateDelayMs();
+                now = nowUs();
+                nextUpdateUs_ = delayMs == IState<StateEnum>::NO_UPDATE ? NEVER : now + int64_t{delayMs} * 1000;
+            }
+        }
+
+        int64_t nextUs = timers_.empty() ? nextUpdateUs_ : std::min(nextUpdateUs_, timers_.front().dueUs);
+        if (nextUs == NEVER)
+        {
+            return IState<StateEnum>::NO_UPDATE;
+        }
+        int64_t remainingUs = nextUs - now;
+        return remainingUs <= 0 ? 0 : static_cast<uint32_t>((remainingUs + 999) / 1000);
+    }
+
+    /**
+     * @brief Leave state for target once it has lasted after
+     *
+     * Replaces "leave after 30 s" checks in update(): the timeout is armed
+     * on each entry to state and dropped when state is left earlier.
+     *
+     * @param state The state to bound
+     * @param after How long state may last
+     * @param target Where to go when it expires
+     */
+    void setTimeout(StateEnum state, std::chrono::milliseconds after, StateEnum target)
+    {
+        timeouts_[state] = Timeout{static_cast<uint32_t>(after.count()), target};
+        if (state == currentState_)
+        {
+            cancelTimer(STATE_TIMEOUT_TIMER);
+            armTimeout(state);
+        }
+    }
+
+    /**
+     * @brief Remove the timeout of state
+     */
+    void clearTimeout(StateEnum state)
+    {
+        timeouts_.erase(state);
+        if (state == currentState_)
+        {
+            cancelTimer(STATE_TIMEOUT_TIMER);
+        }
+    }
+
+    /**
+     * @brief Start a timer for the current state, restarting it if running
+     *
+     * When it fires, tick() or update() calls the current state's
+     * onTimer(id). Leaving the state cancels it. Timers sit in a min-heap
+     * with room for eight before it grows.
+     *
+     * @param id Any id but STATE_TIMEOUT_TIMER
+     * @param delay Time until it fires
+     * @param periodic Fire again every delay until cancelled
+     * @return false if id is reserved
+     */
+    bool startTimer(TimerId id, std::chrono::milliseconds delay, bool periodic = false)
+    {
+        if (id == STATE_TIMEOUT_TIMER)
+        {
+            LOPCORE_LOGE(STATE_MACHINE_TAG, "Timer id reserved for state timeouts");
+            return false;
+        }
+        cancelTimer(id);
+        uint32_t delayMs = static_cast<uint32_t>(delay.count());
+        pushTimer(Timer{nowUs() + int64_t{delayMs} * 1000, periodic ? std::max<uint32_t>(delayMs, 1) : 0, id,
+                        currentState_});
+        return true;
+    }
+
+    /**
+     * @brief Stop a timer
+     *
+     * @return false if it was not running
+     */
+    bool cancelTimer(TimerId id)
+    {
+        auto it = std::remove_if(timers_.begin(), timers_.end(), [id](const Timer &timer) { return timer.id == id; });
+        if (it == timers_.end())
+        {
+            return false;
+        }
+        timers_.erase(it, timers_.end());
+        std::make_heap(timers_.begin(), timers_.end(), firesLater);
+        return true;
+    }
+
+    bool isTimerActive(TimerId id) const
+    {
+        return std::any_of(timers_.begin(), timers_.end(), [id](const Timer &timer) { return timer.id == id; });
+    }
+
     /**
      * @brief Get the current state
      *
@@ -233,37 +396,237 @@ public:
     /**
      * @brief Add an observer for state changes
      *
-     * The callback will be called whenever a state transition occurs.
+     * The callback will be called whenever a state transition occurs,
+     * inside transition(). It is stored inline (a lambda capturing up to
+     * four pointers or references), so adding it does not allocate.
      *
      * @param callback Function to call on state change (from, to)
+     * @return Token for removeObserver(), or 0 if all MaxObservers slots are taken
+     */
+    ObserverToken addObserver(StateChangeCallback callback)
+    {
+        return addObserver(std::move(callback), false);
+    }
+
+    /**
+     * @brief Add an observer called later, from deliverNotifications()
+     *
+     * transition() only queues the change, so a slow observer (logging,
+     * publishing) adds no latency to it. The first deferred observer
+     * allocates the change queue; size it with setNotificationQueueSize()
+     * before then.
+     *
+     * @param callback Function to call on state change (from, to)
+     * @return Token for removeObserver(), or 0 if all MaxObservers slots are taken
+     */
+    ObserverToken addDeferredObserver(StateChangeCallback callback)
+    {
+        if (!notifications_)
+        {
+            notifications_ = std::make_unique<LogRingBuffer<StateChange>>(notificationQueueSize_);
+        }
+        return addObserver(std::move(callback), true);
+    }
+
+    /**
+     * @brief Remove an observer added by addObserver() or addDeferredObserver()
+     *
+     * Safe to call from inside an observer.
+     *
+     * @return false if token is not registered
      */
-    void addObserver(StateChangeCallback callback)
+    bool removeObserver(ObserverToken token)
     {
-        observers_.push_back(callback);
+        return observers_.remove(token);
+    }
+
+    /**
+     * @brief Set how many changes may wait for deliverNotifications()
+     *
+     * @param size Queue capacity, rounded up to a power of two (default: 16);
+     *             takes effect when the first deferred observer is added
+     */
+    void setNotificationQueueSize(size_t size)
+    {
+        notificationQueueSize_ = size;
+    }
+
+    /**
+     * @brief Call the deferred observers for queued changes, oldest first
+     *
+     * Call it from the task that should carry the observers' cost, or at
+     * the end of each main loop iteration. Changes are queued lock-free,
+     * so this may run on another task than transition(), provided
+     * observers are not added or removed meanwhile.
+     *
+     * @param maxChanges Stop after this many changes
+     * @return Changes delivered
+     */
+    size_t deliverNotifications(size_t maxChanges = SIZE_MAX)
+    {
+        if (!notifications_)
+        {
+            return 0;
+        }
+
+        size_t delivered = 0;
+        StateChange change{};
+        while (delivered < maxChanges &&
+               notifications_->tryPop([&change](const StateChange &queued) { change = queued; }))
+        {
+            observers_.forEach([&change](const Observer &observer) {
+                if (observer.deferred)
+                {
+                    observer.callback(change.from, change.to);
+                }
+            });
+            delivered++;
+        }
+        return delivered;
+    }
+
+    /**
+     * @brief Changes lost because the notification queue was full
+     */
+    uint32_t getDroppedNotifications() const
+    {
+        return droppedNotifications_;
     }
 
     /**
      * @brief Get state transition history
      *
+     * Copies the states out; use history() to read them, with entry
+     * times, in place.
+     *
      * @return Vector of states in chronological order (oldest to newest)
      */
     std::vector<StateEnum> getHistory() const
+    {
+        std::vector<StateEnum> states;
+        states.reserve(history_.size());
+        for (const auto &entry : history_)
+        {
+            states.push_back(entry.state);
+        }
+        return states;
+    }
+
+    /**
+     * @brief State transition history with entry times, without copying
+     *
+     * @return The history ring, oldest entry first
+     */
+    const StateHistory<StateEnum> &history() const
     {
         return history_;
     }
 
+    /**
+     * @brief Time spent in the current state so far
+     *
+     * @return Microseconds since the current state was entered
+     */
+    int64_t getTimeInStateUs() const
+    {
+        return nowUs() - enteredUs_;
+    }
+
+    /**
+     * @brief Start profiling: time in each state, onEnter()/onExit() durations, a transition trace
+     *
+     * Off by default, when transition() reads no clocks for it. Allocates
+     * the trace ring once; call it at setup. Calling it again restarts
+     * profiling.
+     *
+     * @param traceCapacity Most recent transitions kept for exportTrace()
+     */
+    void enableProfiling(size_t traceCapacity = 64)
+    {
+        profiler_ = std::make_unique<StateProfiler<StateEnum>>(traceCapacity, nowUs());
+    }
+
+    void disableProfiling()
+    {
+        profiler_.reset();
+    }
+
+    bool isProfiling() const
+    {
+        return profiler_ != nullptr;
+    }
+
+    /**
+     * @brief Profile of state, including the current visit if it is the current state
+     *
+     * @return Zeroed profile if profiling is disabled
+     */
+    StateProfile getStateProfile(StateEnum state) const
+    {
+        if (!profiler_)
+        {
+            return StateProfile{};
+        }
+        StateProfile profile = profiler_->getProfile(state);
+        if (state == currentState_)
+        {
+            int64_t since = std::max(enteredUs_, profiler_->getStartUs());
+            profile.timeInStateUs += static_cast<uint64_t>(nowUs() - since);
+        }
+        return profile;
+    }
+
+    /**
+     * @brief The profiler, for the trace and counters; nullptr unless enabled
+     */
+    const StateProfiler<StateEnum> *getProfiler() const
+    {
+        return profiler_.get();
+    }
+
+    /**
+     * @brief Write the transition trace (format in state_profiler.hpp), e.g. to publish over MQTT
+     *
+     * @return Bytes written; 0 if profiling is disabled or buffer is too small
+     */
+    size_t exportTrace(uint8_t *buffer, size_t size) const
+    {
+        return profiler_ ? profiler_->exportTrace(buffer, size) : 0;
+    }
+
+    /**
+     * @brief Log the profile and the trace through the logger
+     */
+    void logProfile() const
+    {
+        if (profiler_)
+        {
+            profiler_->log(STATE_MACHINE_TAG, nowUs());
+        }
+    }
+
+    /**
+     * @brief Zero the profile and start a new window now
+     */
+    void resetProfile()
+    {
+        if (profiler_)
+        {
+            profiler_->reset(nowUs());
+        }
+    }
+
     /**
      * @brief Set maximum history size
      *
+     * Allocates the ring once; recording a transition never does. Call it
+     * at setup.
+     *
      * @param size Maximum number of states to keep in history (default: 10)
      */
     void setMaxHistorySize(size_t size)
     {
-        maxHistorySize_ = size;
-        while (history_.size() > maxHistorySize_)
-        {
-            history_.erase(history_.begin());
-        }
+        history_.setCapacity(size);
     }
 
     /**
@@ -288,32 +651,156 @@ public:
     void clearHistory()
     {
         history_.clear();
-        history_.push_back(currentState_);
+        history_.push(currentState_, enteredUs_);
     }
 
 private:
+    struct Observer
+    {
+        StateChangeCallback callback;
+        bool deferred = false; ///< Called from deliverNotifications(), not transition()
+    };
+
+    struct StateChange
+    {
+        StateEnum from;
+        StateEnum to;
+    };
+
+    struct Timeout
+    {
+        uint32_t afterMs;
+        StateEnum target;
+    };
+
+    struct Timer
+    {
+        int64_t dueUs;
+        uint32_t periodMs; ///< 0 for a one-shot timer
+        TimerId id;
+        StateEnum target; ///< Where a STATE_TIMEOUT_TIMER leads
+    };
+
     StateEnum currentState_;
     StateEnum previousState_;
     std::unordered_map<StateEnum, std::unique_ptr<IState<StateEnum>>> states_;
     std::unordered_map<StateEnum, std::set<StateEnum>> transitionRules_;
-    std::vector<StateChangeCallback> observers_;
-    std::vector<StateEnum> history_;
-    size_t maxHistorySize_;
+    ObserverList<Observer, MaxObservers> observers_;
+    std::unique_ptr<LogRingBuffer<StateChange>> notifications_; ///< Changes for deferred observers
+    size_t notificationQueueSize_ = 16;
+    uint32_t droppedNotifications_ = 0;
+    StateHistory<StateEnum> history_;
+    int64_t enteredUs_ = nowUs(); ///< When currentState_ was entered
+    static constexpr int64_t NEVER = INT64_MAX;
+    int64_t nextUpdateUs_ = 0;     ///< When tick() next updates, or NEVER
+    uint32_t transitionCount_ = 0; ///< Lets tick() notice a transition made by update()
+    std::unordered_map<StateEnum, Timeout> timeouts_;
+    std::vector<Timer> timers_; ///< Min-heap on dueUs, the current state's timers
+    std::unique_ptr<StateProfiler<StateEnum>> profiler_; ///< Null unless profiling
 
     void addToHistory(StateEnum state)
     {
-        history_.push_back(state);
-        if (history_.size() > maxHistorySize_)
+        enteredUs_ = nowUs();
+        history_.push(state, enteredUs_);
+    }
+
+    static int64_t nowUs()
+    {
+#ifdef ESP_PLATFORM
+        return esp_timer_get_time();
+#else
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+    }
+
+    static bool firesLater(const Timer &a, const Timer &b)
+    {
+        return a.dueUs > b.dueUs;
+    }
+
+    void pushTimer(const Timer &timer)
+    {
+        timers_.push_back(timer);
+        std::push_heap(timers_.begin(), timers_.end(), firesLater);
+    }
+
+    void armTimeout(StateEnum state)
+    {
+        auto it = timeouts_.find(state);
+        if (it != timeouts_.end())
+        {
+            pushTimer(Timer{nowUs() + int64_t{it->second.afterMs} * 1000, 0, STATE_TIMEOUT_TIMER, it->second.target});
+        }
+    }
+
+    /**
+     * @brief Deliver every expired timer, earliest first
+     */
+    void fireTimers()
+    {
+        int64_t now = nowUs();
+        while (!timers_.empty() && timers_.front().dueUs <= now)
+        {
+            std::pop_heap(timers_.begin(), timers_.end(), firesLater);
+            Timer timer = timers_.back();
+            timers_.pop_back();
+
+            if (timer.periodMs > 0)
+            {
+                Timer next = timer;
+                next.dueUs += int64_t{timer.periodMs} * 1000;
+                if (next.dueUs <= now)
+                {
+                    next.dueUs = now + int64_t{timer.periodMs} * 1000; // Skip periods missed while busy
+                }
+                pushTimer(next);
+            }
+
+            // Either may transition, which replaces the heap with the new state's timers
+            if (timer.id == STATE_TIMEOUT_TIMER)
+            {
+                transition(timer.target);
+            }
+            else
+            {
+                auto it = states_.find(currentState_);
+                if (it != states_.end() && it->second)
+                {
+                    it->second->onTimer(timer.id);
+                }
+            }
+        }
+    }
+
+    ObserverToken addObserver(StateChangeCallback callback, bool deferred)
+    {
+        ObserverToken token = observers_.add(Observer{std::move(callback), deferred});
+        if (token == 0)
         {
-            history_.erase(history_.begin());
+            LOPCORE_LOGE(STATE_MACHINE_TAG, "No observer slot left");
         }
+        return token;
     }
 
     void notifyObservers(StateEnum from, StateEnum to)
     {
-        for (const auto &observer : observers_)
+        bool deferred = false;
+        observers_.forEach([&](const Observer &observer) {
+            if (observer.deferred)
+            {
+                deferred = true;
+            }
+            else
+            {
+                observer.callback(from, to);
+            }
+        });
+
+        if (deferred && !notifications_->tryPush([from, to](StateChange &slot) { slot = StateChange{from, to}; }))
         {
-            observer(from, to);
+            droppedNotifications_++;
         }
     }
 };
@@ -0,0 +1,487 @@
+/**
+ * @file state_machine_pool.hpp
+ * @brief Many instances of one state machine definition, stored as arrays
+ *
+ * Part of LopCore - Modern C++ Middleware for ESP32
+ *
+ * A gateway tracking 200 peripherals with StateMachine pays for 200 sets
+ * of hash maps and handler objects describing the same behaviour. Here
+ * the behaviour is a StateGraph, built once and shared, and each
+ * instance is one slot in a StateMachinePool: a state byte, a timeout
+ * deadline and the user data, each kept in its own array so a tick scans
+ * contiguous memory.
+ *
+ * @code
+ * enum class Peer { DISCOVERED, CONNECTING, READY, LOST };
+ * enum class PeerEvent { CONNECT, CONNECTED, DISCONNECTED };
+ * struct PeerData { uint16_t handle; int8_t rssi; };
+ *
+ * using PeerGraph = StateGraph<Peer, 4, PeerEvent, 3, PeerData>;
+ * static PeerGraph graph = PeerGraph()
+ *                              .on(Peer::DISCOVERED, PeerEvent::CONNECT, Peer::CONNECTING)
+ *                              .on(Peer::CONNECTING, PeerEvent::CONNECTED, Peer::READY)
+ *                              .on(Peer::READY, PeerEvent::DISCONNECTED, Peer::LOST)
+ *                              .timeout(Peer::CONNECTING, 5000, Peer::LOST)
+ *                              .onEnter(Peer::READY, [](uint16_t id, PeerData &peer) { subscribe(peer.handle); });
+ *
+ * static StateMachinePool<PeerGraph, 200> peers(graph, 64);
+ * auto id = peers.create(Peer::DISCOVERED, PeerData{handle, rssi});
+ * peers.post(id, PeerEvent::CONNECT);   // BLE callback, any task
+ *
+ * while (true) {                        // Owner task
+ *     peers.dispatch();
+ *     vTaskDelay(pdMS_TO_TICKS(std::min<uint32_t>(peers.tick(), 100)));
+ * }
+ * @endcode
+ *
+ * @copyright Copyright (c) 2025 LopTech
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "lopcore/logging/log_ring_buffer.hpp"
+
+#include "event_state_machine.hpp"
+
+#ifdef ESP_PLATFORM
+#include <esp_timer.h>
+#else
+#include <chrono>
+#endif
+
+namespace lopcore
+{
+
+/**
+ * @brief Immutable behaviour shared by every instance of a StateMachinePool
+ *
+ * Hooks, guards and actions are plain function pointers: everything an
+ * instance owns is passed in (its id and its UserData), so one graph
+ * serves any number of instances. Each (state, event) has at most one
+ * row; a row whose target is its source is internal and runs only its
+ * action.
+ *
+ * @tparam StateEnum Dense enum of states, 0 to StateCount - 1
+ * @tparam StateCount Number of states, at most 255
+ * @tparam EventEnum Dense enum of events, 0 to EventCount - 1
+ * @tparam EventCount Number of event types
+ * @tparam UserData Per-instance data, kept in the pool
+ */
+template<typename StateEnum, size_t StateCount, typename EventEnum, size_t EventCount, typename UserData>
+class StateGraph
+{
+    static_assert(StateCount > 0 && StateCount < 256, "Instance states are stored in a byte");
+
+public:
+    using State = StateEnum;
+    using Event = EventEnum;
+    using Data = UserData;
+    using Hook = void (*)(uint16_t instance, UserData &data);
+    using Guard = bool (*)(uint16_t instance, const UserData &data, uint32_t payload);
+    using Action = void (*)(uint16_t instance, UserData &data, uint32_t payload);
+
+    static constexpr size_t STATE_COUNT = StateCount;
+    static constexpr size_t EVENT_COUNT = EventCount;
+    static constexpr uint8_t NO_STATE = 0xFF;
+
+    StateGraph()
+    {
+        for (Row &row : rows_)
+        {
+            row.to = NO_STATE;
+        }
+        for (StateInfo &info : states_)
+        {
+            info.timeoutTarget = NO_STATE;
+        }
+    }
+
+    /**
+     * @brief In from, event moves to to if guard passes, running action
+     *
+     * Replaces an earlier row for the same (from, event).
+     *
+     * @return This graph, for chaining
+     */
+    StateGraph &on(StateEnum from, EventEnum event, StateEnum to, Guard guard = nullptr, Action action = nullptr)
+    {
+        if (inRange(from) && inRange(to) && static_cast<size_t>(event) < EventCount)
+        {
+            rows_[cell(from, event)] = Row{static_cast<uint8_t>(to), guard, action};
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Leave state for target once an instance has been in it for afterMs
+     */
+    StateGraph &timeout(StateEnum state, uint32_t afterMs, StateEnum target)
+    {
+        if (inRange(state) && inRange(target))
+        {
+            states_[static_cast<size_t>(state)].timeoutMs = afterMs;
+            states_[static_cast<size_t>(state)].timeoutTarget = static_cast<uint8_t>(target);
+        }
+        return *this;
+    }
+
+    StateGraph &onEnter(StateEnum state, Hook hook)
+    {
+        if (inRange(state))
+        {
+            states_[static_cast<size_t>(state)].enter = hook;
+        }
+        return *this;
+    }
+
+    StateGraph &onExit(StateEnum state, Hook hook)
+    {
+        if (inRange(state))
+        {
+            states_[static_cast<size_t>(state)].exit = hook;
+        }
+        return *this;
+    }
+
+private:
+    template<typename, size_t>
+    friend class StateMachinePool;
+
+    struct Row
+    {
+        uint8_t to; ///< NO_STATE: no row
+        Guard guard = nullptr;
+        Action action = nullptr;
+    };
+
+    struct StateInfo
+    {
+        Hook enter = nullptr;
+        Hook exit = nullptr;
+        uint32_t timeoutMs = 0;
+        uint8_t timeoutTarget; ///< NO_STATE: no timeout
+    };
+
+    static constexpr bool inRange(StateEnum state)
+    {
+        return static_cast<size_t>(state) < StateCount;
+    }
+
+    static constexpr size_t cell(StateEnum state, EventEnum event)
+    {
+        return static_cast<size_t>(state) * EventCount + static_cast<size_t>(event);
+    }
+
+    std::array<Row, StateCount * EventCount> rows_;
+    std::array<StateInfo, StateCount> states_;
+};
+
+/**
+ * @brief Up to MaxInstances instances of one StateGraph
+ *
+ * Instance state lives in parallel arrays (state, timeout deadline,
+ * user data) rather than in an object per instance. post() may be called
+ * from any task; the rest, and every hook, guard and action, run on the
+ * single owner task, which drains the shared event queue with dispatch()
+ * and fires timeouts with tick(), each a batch over all instances. Only
+ * the event queue is allocated, once, at construction.
+ *
+ * An event posted to an instance that is destroyed before dispatch is
+ * dropped; one that is destroyed and re-created in between receives it.
+ *
+ * @tparam Graph A StateGraph
+ * @tparam MaxInstances Instance slots, at most 65535
+ */
+template<typename Graph, size_t MaxInstances>
+class StateMachinePool
+{
+    static_assert(MaxInstances > 0 && MaxInstances < 0xFFFF, "Instance ids are 16-bit");
+
+public:
+    using StateEnum = typename Graph::State;
+    using EventEnum = typename Graph::Event;
+    using UserData = typename Graph::Data;
+    using InstanceId = uint16_t;
+
+    static constexpr InstanceId NO_INSTANCE = 0xFFFF;
+
+    /**
+     * @param graph Shared behaviour; must outlive the pool and stay unchanged
+     * @param eventQueueCapacity Events that may wait for dispatch() (rounded up to a power of two)
+     */
+    StateMachinePool(const Graph &graph, size_t eventQueueCapacity) : graph_(graph), queue_(eventQueueCapacity)
+    {
+    }
+
+    StateMachinePool(const StateMachinePool &) = delete;
+    StateMachinePool &operator=(const StateMachinePool &) = delete;
+
+    /**
+     * @brief Start an instance in initial, running its entry hook (owner task)
+     *
+     * @return The instance id, or NO_INSTANCE if every slot is in use
+     */
+    InstanceId create(StateEnum initial, const UserData &data = UserData{})
+    {
+        if (!Graph::inRange(initial))
+        {
+            return NO_INSTANCE;
+        }
+        for (size_t i = 0; i < MaxInstances; i++)
+        {
+            if (!active_[i])
+            {
+                active_[i] = true;
+                data_[i] = data;
+                enter(static_cast<InstanceId>(i), static_cast<uint8_t>(initial));
+                count_++;
+                return static_cast<InstanceId>(i);
+            }
+        }
+        LOPCORE_LOGE(DENSE_STATE_MACHINE_TAG, "State machine pool is full");
+        return NO_INSTANCE;
+    }
+
+    /**
+     * @brief Stop an instance, running its current state's exit hook (owner task)
+     */
+    void destroy(InstanceId id)
+    {
+        if (!isActive(id))
+        {
+            return;
+        }
+        if (typename Graph::Hook exit = graph_.states_[states_[id]].exit)
+        {
+            exit(id, data_[id]);
+        }
+        active_[id] = false;
+        timed_[id] = false;
+        count_--;
+    }
+
+    /**
+     * @brief Queue an event for an instance, from any task
+     *
+     * @return false if the queue is full; the event is dropped
+     */
+    bool post(InstanceId id, EventEnum event, uint32_t payload = 0)
+    {
+        if (!queue_.tryPush([id, event, payload](QueuedEvent &slot) { slot = QueuedEvent{id, event, payload}; }))
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        posted_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Run queued events to completion, oldest first (owner task)
+     *
+     * @param maxEvents Stop after this many
+     * @return Events dispatched
+     */
+    size_t dispatch(size_t maxEvents = SIZE_MAX)
+    {
+        size_t count = 0;
+        QueuedEvent event{};
+        while (count < maxEvents && queue_.tryPop([&event](const QueuedEvent &queued) { event = queued; }))
+        {
+            run(event);
+            count++;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Fire the timeouts that have expired, across all instances (owner task)
+     *
+     * @return Milliseconds until the next timeout, or UINT32_MAX if none is armed
+     */
+    uint32_t tick()
+    {
+        uint32_t now = nowMs();
+        uint32_t next = UINT32_MAX;
+        for (size_t i = 0; i < MaxInstances; i++)
+        {
+            if (!timed_[i])
+            {
+                continue;
+            }
+            int32_t remaining = static_cast<int32_t>(deadlinesMs_[i] - now); // Wrap-safe
+            if (remaining <= 0)
+            {
+                uint8_t target = graph_.states_[states_[i]].timeoutTarget;
+                moveTo(static_cast<InstanceId>(i), target, nullptr, 0);
+                stats_.transitions++;
+                if (timed_[i]) // The target has its own timeout
+                {
+                    remaining = static_cast<int32_t>(deadlinesMs_[i] - now);
+                }
+            }
+            if (timed_[i] && remaining > 0 && static_cast<uint32_t>(remaining) < next)
+            {
+                next = static_cast<uint32_t>(remaining);
+            }
+        }
+        return next;
+    }
+
+    StateEnum getState(InstanceId id) const
+    {
+        return static_cast<StateEnum>(states_[id]);
+    }
+
+    UserData &data(InstanceId id)
+    {
+        return data_[id];
+    }
+
+    const UserData &data(InstanceId id) const
+    {
+        return data_[id];
+    }
+
+    bool isActive(InstanceId id) const
+    {
+        return id < MaxInstances && active_[id];
+    }
+
+    /**
+     * @brief Instances currently in state
+     */
+    size_t countIn(StateEnum state) const
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < MaxInstances; i++)
+        {
+            count += active_[i] && states_[i] == static_cast<uint8_t>(state);
+        }
+        return count;
+    }
+
+    size_t size() const
+    {
+        return count_;
+    }
+
+    static constexpr size_t capacity()
+    {
+        return MaxInstances;
+    }
+
+    /**
+     * @brief Counters; events to destroyed instances count as unhandled
+     */
+    EventStateMachineStats getStats() const
+    {
+        EventStateMachineStats stats = stats_;
+        stats.posted = posted_.load(std::memory_order_relaxed);
+        stats.dropped = dropped_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    struct QueuedEvent
+    {
+        InstanceId instance;
+        EventEnum event;
+        uint32_t payload;
+    };
+
+    void run(const QueuedEvent &event)
+    {
+        stats_.dispatched++;
+        InstanceId id = event.instance;
+        if (!isActive(id) || static_cast<size_t>(event.event) >= Graph::EVENT_COUNT)
+        {
+            stats_.unhandled++;
+            return;
+        }
+
+        const auto &row = graph_.rows_[Graph::cell(static_cast<StateEnum>(states_[id]), event.event)];
+        if (row.to == Graph::NO_STATE || (row.guard != nullptr && !row.guard(id, data_[id], event.payload)))
+        {
+            stats_.unhandled++;
+            return;
+        }
+
+        if (row.to == states_[id])
+        {
+            if (row.action != nullptr)
+            {
+                row.action(id, data_[id], event.payload);
+            }
+        }
+        else
+        {
+            moveTo(id, row.to, row.action, event.payload);
+        }
+        stats_.transitions++;
+    }
+
+    void moveTo(InstanceId id, uint8_t to, typename Graph::Action action, uint32_t payload)
+    {
+        if (typename Graph::Hook exit = graph_.states_[states_[id]].exit)
+        {
+            exit(id, data_[id]);
+        }
+        if (action != nullptr)
+        {
+            action(id, data_[id], payload);
+        }
+        enter(id, to);
+    }
+
+    void enter(InstanceId id, uint8_t state)
+    {
+        states_[id] = state;
+        const auto &info = graph_.states_[state];
+        timed_[id] = info.timeoutTarget != Graph::NO_STATE;
+        if (timed_[id])
+        {
+            deadlinesMs_[id] = nowMs() + info.timeoutMs;
+        }
+        if (info.enter != nullptr)
+        {
+            info.enter(id, data_[id]);
+        }
+    }
+
+    static uint32_t nowMs()
+    {
+#ifdef ESP_PLATFORM
+        return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+#else
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+#endif
+    }
+
+    const Graph &graph_;
+
+    // Instance data, one array per field
+    std::array<uint8_t, MaxInstances> states_{};
+    std::array<uint32_t, MaxInstances> deadlinesMs_{}; ///< Timeout of the current state, if timed_
+    std::array<UserData, MaxInstances> data_{};
+    std::bitset<MaxInstances> active_;
+    std::bitset<MaxInstances> timed_;
+    size_t count_ = 0;
+
+    LogRingBuffer<QueuedEvent> queue_;
+    EventStateMachineStats stats_; ///< Owner-task counters
+    std::atomic<uint32_t> posted_{0};
+    std::atomic<uint32_t> dropped_{0};
+};
+
+} // namespace lopcore
@@ -0,0 +1,293 @@
+/**
+ * @file state_observer.hpp
+ * @brief Allocation-free callbacks and observer lists for the state machines
+ *
+ * Part of LopCore - Modern C++ Middleware for ESP32
+ *
+ * std::function may allocate for any capture beyond a pointer or two and
+ * a vector of them cannot drop one observer. InplaceFunction keeps the
+ * callable in a fixed buffer inside itself, so registering never touches
+ * the heap, and ObserverList keeps a fixed number of them behind tokens
+ * that remove them again.
+ *
+ * @copyright Copyright (c) 2025 LopTech
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace lopcore
+{
+
+template<typename Signature, size_t Capacity = 4 * sizeof(void *)>
+class InplaceFunction;
+
+/**
+ * @brief Callable wrapper storing its target inline, never on the heap
+ *
+ * Holds any callable of up to Capacity bytes: a lambda capturing a few
+ * pointers or references, a function pointer, a small functor. A larger
+ * callable fails to compile rather than allocating.
+ *
+ * @tparam R Return type
+ * @tparam Args Argument types
+ * @tparam Capacity Inline buffer size in bytes
+ */
+template<typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity>
+{
+public:
+    InplaceFunction() = default;
+
+    InplaceFunction(std::nullptr_t)
+    {
+    }
+
+    template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InplaceFunction>>>
+    InplaceFunction(F &&callable)
+    {
+        using Callable = std::decay_t<F>;
+        static_assert(sizeof(Callable) <= Capacity, "Callable does not fit inline: capture less or raise Capacity");
+        static_assert(alignof(Callable) <= alignof(std::max_align_t), "Callable is over-aligned");
+        static_assert(std::is_invocable_r_v<R, Callable &, Args...>, "Callable does not match the signature");
+
+        new (storage_) Callable(std::forward<F>(callable));
+        invoke_ = [](void *target, Args... args) -> R {
+            return (*static_cast<Callable *>(target))(std::forward<Args>(args)...);
+        };
+        manage_ = [](Operation operation, void *target, void *source) {
+            switch (operation)
+            {
+                case Operation::COPY:
+                    new (target) Callable(*static_cast<const Callable *>(source));
+                    break;
+                case Operation::MOVE:
+                    new (target) Callable(std::move(*static_cast<Callable *>(source)));
+                    break;
+                case Operation::DESTROY:
+                    static_cast<Callable *>(target)->~Callable();
+                    break;
+            }
+        };
+    }
+
+    InplaceFunction(const InplaceFunction &other)
+    {
+        if (other.manage_ != nullptr)
+        {
+            other.manage_(Operation::COPY, storage_, const_cast<unsigned char *>(other.storage_));
+            invoke_ = other.invoke_;
+            manage_ = other.manage_;
+        }
+    }
+
+    InplaceFunction(InplaceFunction &&other) noexcept
+    {
+        if (other.manage_ != nullptr)
+        {
+            other.manage_(Operation::MOVE, storage_, other.storage_);
+            invoke_ = other.invoke_;
+            manage_ = other.manage_;
+        }
+    }
+
+    InplaceFunction &operator=(const InplaceFunction &other)
+    {
+        if (this != &other)
+        {
+            InplaceFunction copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    InplaceFunction &operator=(InplaceFunction &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            if (other.manage_ != nullptr)
+            {
+                other.manage_(Operation::MOVE, storage_, other.storage_);
+                invoke_ = other.invoke_;
+                manage_ = other.manage_;
+            }
+        }
+        return *this;
+    }
+
+    InplaceFunction &operator=(std::nullptr_t)
+    {
+        reset();
+        return *this;
+    }
+
+    ~InplaceFunction()
+    {
+        reset();
+    }
+
+    explicit operator bool() const
+    {
+        return invoke_ != nullptr;
+    }
+
+    /**
+     * @brief Call the target; it must be set
+     */
+    R operator()(Args... args) const
+    {
+        return invoke_(const_cast<unsigned char *>(storage_), std::forward<Args>(args)...);
+    }
+
+private:
+    enum class Operation
+    {
+        COPY,
+        MOVE,
+        DESTROY
+    };
+
+    void reset()
+    {
+        if (manage_ != nullptr)
+        {
+            manage_(Operation::DESTROY, storage_, nullptr);
+        }
+        invoke_ = nullptr;
+        manage_ = nullptr;
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[Capacity];
+    R (*invoke_)(void *, Args...) = nullptr;
+    void (*manage_)(Operation, void *, void *) = nullptr;
+};
+
+/**
+ * @brief Identifies a registered observer (0 is never a valid token)
+ */
+using ObserverToken = uint32_t;
+
+/**
+ * @brief Fixed number of callbacks, added and removed by token
+ *
+ * An observer may remove itself, or another, from inside notify():
+ * remove() only frees the slot, and the callback is destroyed when the
+ * slot is reused or by clear(). Tokens carry a sequence number, so a
+ * stale token never removes a later observer that reused the slot. Not
+ * thread-safe.
+ *
+ * @tparam Callback Callback type, usually an InplaceFunction
+ * @tparam MaxObservers Slots, at most 255
+ */
+template<typename Callback, size_t MaxObservers>
+class ObserverList
+{
+    static_assert(MaxObservers > 0 && MaxObservers < 256, "Tokens keep the slot in 8 bits");
+
+public:
+    /**
+     * @brief Add callback to a free slot
+     *
+     * @return Token for remove(), or 0 if every slot is taken
+     */
+    ObserverToken add(Callback callback)
+    {
+        for (size_t slot = 0; slot < MaxObservers; slot++)
+        {
+            if (slots_[slot].token == 0)
+            {
+                sequence_ = (sequence_ + 1) & 0xFFFFFF;
+                slots_[slot].callback = std::move(callback);
+                slots_[slot].token = (sequence_ << 8) | static_cast<ObserverToken>(slot + 1);
+                count_++;
+                return slots_[slot].token;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Remove the observer token names
+     *
+     * @return false if token is not registered (already removed, or 0)
+     */
+    bool remove(ObserverToken token)
+    {
+        size_t slot = (token & 0xFF) - 1;
+        if (token == 0 || slot >= MaxObservers || slots_[slot].token != token)
+        {
+            return false;
+        }
+        slots_[slot].token = 0;
+        count_--;
+        return true;
+    }
+
+    /**
+     * @brief Remove and destroy every callback; not from inside notify()
+     */
+    void clear()
+    {
+        for (Slot &slot : slots_)
+        {
+            slot.token = 0;
+            slot.callback = Callback{};
+        }
+        count_ = 0;
+    }
+
+    /**
+     * @brief Call every observer, in slot order
+     */
+    template<typename... Args>
+    void notify(const Args &...args) const
+    {
+        forEach([&args...](const Callback &callback) { callback(args...); });
+    }
+
+    /**
+     * @brief Pass every registered callback to visit, in slot order
+     */
+    template<typename Visit>
+    void forEach(Visit &&visit) const
+    {
+        for (size_t slot = 0; slot < MaxObservers && count_ > 0; slot++)
+        {
+            if (slots_[slot].token != 0)
+            {
+                visit(slots_[slot].callback);
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        return count_;
+    }
+
+    bool empty() const
+    {
+        return count_ == 0;
+    }
+
+private:
+    struct Slot
+    {
+        Callback callback;
+        ObserverToken token = 0; ///< 0 while the slot is free
+    };
+
+    std::array<Slot, MaxObservers> slots_{};
+    size_t count_ = 0;
+    uint32_t sequence_ = 0;
+};
+
+} // namespace lopcore
@@ -0,0 +1,281 @@
+/**
+ * @file state_profiler.hpp
+ * @brief Opt-in time-in-state, handler latency and transition trace for StateMachine
+ *
+ * Part of LopCore - Modern C++ Middleware for ESP32
+ *
+ * Enabled with StateMachine::enableProfiling(). The profiler adds up the
+ * time spent in each state, times every onExit()/onEnter(), counts
+ * transitions, and keeps the most recent transitions in a ring that
+ * exports to a compact binary trace:
+ *
+ *   Header, 8 bytes:  "SMTR", version (1), record size (12), record count (uint16)
+ *   Record, 12 bytes: time since profiling began in ms (uint32), from state (uint16),
+ *                     to state (uint16), onExit() us (uint16), onEnter() us (uint16)
+ *
+ * All fields are little-endian; handler times saturate at 65535 us. The
+ * buffer suits an MQTT publish or a file; log() writes the summary and
+ * the trace (as hex) through the logger.
+ *
+ * @copyright Copyright (c) 2025 LopTech
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "lopcore/logging/logger.hpp"
+
+namespace lopcore
+{
+
+/**
+ * @brief Profile of one state since profiling began
+ */
+struct StateProfile
+{
+    uint64_t timeInStateUs{0}; ///< Total time spent in the state
+    uint32_t entries{0};       ///< Times the state was entered
+    uint64_t totalEnterUs{0};  ///< Total time in its onEnter()
+    uint32_t maxEnterUs{0};    ///< Slowest onEnter()
+    uint64_t totalExitUs{0};   ///< Total time in its onExit()
+    uint32_t maxExitUs{0};     ///< Slowest onExit()
+};
+
+/**
+ * @brief One transition in the trace
+ */
+struct TransitionTraceRecord
+{
+    uint32_t timeMs;  ///< Since profiling began
+    uint16_t from;
+    uint16_t to;
+    uint16_t exitUs;  ///< onExit() of from, saturated
+    uint16_t enterUs; ///< onEnter() of to, saturated
+};
+
+/**
+ * @brief Time-in-state counters, handler durations and a transition trace
+ *
+ * Fed by StateMachine::transition(); read it from the task that drives
+ * the machine.
+ */
+template<typename StateEnum>
+class StateProfiler
+{
+public:
+    static constexpr uint8_t TRACE_VERSION = 1;
+    static constexpr size_t TRACE_HEADER_SIZE = 8;
+    static constexpr size_t TRACE_RECORD_SIZE = 12;
+
+    /**
+     * @param traceCapacity Transitions kept for the trace (allocated here)
+     * @param startUs Time profiling begins
+     */
+    StateProfiler(size_t traceCapacity, int64_t startUs) : trace_(traceCapacity), startUs_(startUs)
+    {
+    }
+
+    /**
+     * @brief Account for one transition
+     *
+     * @param fromEnteredUs When from was entered (clamped to the start of profiling)
+     * @param startUs Transition start, before onExit()
+     * @param exitedUs After onExit()
+     * @param enteredUs After onEnter()
+     */
+    void recordTransition(StateEnum from, StateEnum to, int64_t fromEnteredUs, int64_t startUs, int64_t exitedUs,
+                          int64_t enteredUs)
+    {
+        uint32_t exitUs = static_cast<uint32_t>(exitedUs - startUs);
+        uint32_t enterUs = static_cast<uint32_t>(enteredUs - exitedUs);
+
+        StateProfile &left = states_[from];
+        left.timeInStateUs += static_cast<uint64_t>(startUs - (fromEnteredUs > startUs_ ? fromEnteredUs : startUs_));
+        left.totalExitUs += exitUs;
+        left.maxExitUs = exitUs > left.maxExitUs ? exitUs : left.maxExitUs;
+
+        StateProfile &entered = states_[to];
+        entered.entries++;
+        entered.totalEnterUs += enterUs;
+        entered.maxEnterUs = enterUs > entered.maxEnterUs ? enterUs : entered.maxEnterUs;
+
+        transitions_++;
+        if (!trace_.empty())
+        {
+            trace_[(oldest_ + size_) % trace_.size()] =
+                TransitionTraceRecord{static_cast<uint32_t>((startUs - startUs_) / 1000), static_cast<uint16_t>(from),
+                                      static_cast<uint16_t>(to), saturate(exitUs), saturate(enterUs)};
+            if (size_ < trace_.size())
+            {
+                size_++;
+            }
+            else
+            {
+                oldest_ = (oldest_ + 1) % trace_.size();
+            }
+        }
+    }
+
+    /**
+     * @brief Profile of state, not counting a visit still in progress
+     */
+    StateProfile getProfile(StateEnum state) const
+    {
+        auto it = states_.find(state);
+        return it == states_.end() ? StateProfile{} : it->second;
+    }
+
+    uint32_t getTransitionCount() const
+    {
+        return transitions_;
+    }
+
+    int64_t getStartUs() const
+    {
+        return startUs_;
+    }
+
+    /**
+     * @brief Transitions held in the trace ring
+     */
+    size_t getTraceSize() const
+    {
+        return size_;
+    }
+
+    /**
+     * @brief Trace record i, 0 being the oldest kept
+     */
+    const TransitionTraceRecord &getTraceRecord(size_t i) const
+    {
+        return trace_[(oldest_ + i) % trace_.size()];
+    }
+
+    /**
+     * @brief Bytes exportTrace() needs for the whole trace
+     */
+    size_t getTraceExportSize() const
+    {
+        return TRACE_HEADER_SIZE + size_ * TRACE_RECORD_SIZE;
+    }
+
+    /**
+     * @brief Write the trace in the binary format above
+     *
+     * If buffer is too small for every record, the newest that fit are
+     * written.
+     *
+     * @return Bytes written, 0 if size cannot hold the header
+     */
+    size_t exportTrace(uint8_t *buffer, size_t size) const
+    {
+        if (buffer == nullptr || size < TRACE_HEADER_SIZE)
+        {
+            return 0;
+        }
+        size_t count = (size - TRACE_HEADER_SIZE) / TRACE_RECORD_SIZE;
+        count = count < size_ ? count : size_;
+        count = count < 0xFFFF ? count : 0xFFFF;
+
+        uint8_t *out = buffer;
+        *out++ = 'S';
+        *out++ = 'M';
+        *out++ = 'T';
+        *out++ = 'R';
+        *out++ = TRACE_VERSION;
+        *out++ = static_cast<uint8_t>(TRACE_RECORD_SIZE);
+        out = put16(out, static_cast<uint16_t>(count));
+        for (size_t i = size_ - count; i < size_; i++)
+        {
+            const TransitionTraceRecord &record = getTraceRecord(i);
+            out = put32(out, record.timeMs);
+            out = put16(out, record.from);
+            out = put16(out, record.to);
+            out = put16(out, record.exitUs);
+            out = put16(out, record.enterUs);
+        }
+        return static_cast<size_t>(out - buffer);
+    }
+
+    /**
+     * @brief Log each state's profile, then the trace as hex lines
+     *
+     * @param tag Log tag
+     * @param nowUs Current time, to report the profiling window
+     */
+    void log(const char *tag, int64_t nowUs) const
+    {
+        LOPCORE_LOGI(tag, "Profile over %lld ms, %u transitions", static_cast<long long>((nowUs - startUs_) / 1000),
+                     static_cast<unsigned>(transitions_));
+        for (const auto &entry : states_)
+        {
+            const StateProfile &profile = entry.second;
+            LOPCORE_LOGI(tag, "  state %u: %llu ms, entered %u, onEnter max %u us, onExit max %u us",
+                         static_cast<unsigned>(entry.first),
+                         static_cast<unsigned long long>(profile.timeInStateUs / 1000),
+                         static_cast<unsigned>(profile.entries), static_cast<unsigned>(profile.maxEnterUs),
+                         static_cast<unsigned>(profile.maxExitUs));
+        }
+
+        std::vector<uint8_t> trace(getTraceExportSize());
+        size_t length = exportTrace(trace.data(), trace.size());
+        static const char digits[] = "0123456789abcdef";
+        char line[2 * 32 + 1];
+        for (size_t offset = 0; offset < length; offset += 32)
+        {
+            size_t chunk = length - offset < 32 ? length - offset : 32;
+            for (size_t i = 0; i < chunk; i++)
+            {
+                line[2 * i] = digits[trace[offset + i] >> 4];
+                line[2 * i + 1] = digits[trace[offset + i] & 0x0F];
+            }
+            line[2 * chunk] = '\0';
+            LOPCORE_LOGI(tag, "  trace %s", line);
+        }
+    }
+
+    /**
+     * @brief Forget everything and start a new profiling window at nowUs
+     */
+    void reset(int64_t nowUs)
+    {
+        states_.clear();
+        transitions_ = 0;
+        oldest_ = 0;
+        size_ = 0;
+        startUs_ = nowUs;
+    }
+
+private:
+    static uint16_t saturate(uint32_t value)
+    {
+        return value > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(value);
+    }
+
+    static uint8_t *put16(uint8_t *out, uint16_t value)
+    {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+        return out + 2;
+    }
+
+    static uint8_t *put32(uint8_t *out, uint32_t value)
+    {
+        out = put16(out, static_cast<uint16_t>(value));
+        return put16(out, static_cast<uint16_t>(value >> 16));
+    }
+
+    std::unordered_map<StateEnum, StateProfile> states_;
+    std::vector<TransitionTraceRecord> trace_;
+    size_t oldest_ = 0; ///< Slot of trace record 0
+    size_t size_ = 0;
+    int64_t startUs_;
+    uint32_t transitions_ = 0;
+};
+
+} // namespace lopcore
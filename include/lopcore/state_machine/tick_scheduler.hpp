@@ -0,0 +1,192 @@
+/**
+ * @file tick_scheduler.hpp
+ * @brief Sleep the task driving a state machine until its next update or an event
+ *
+ * Part of LopCore - Modern C++ Middleware for ESP32
+ *
+ * Calling StateMachine::update() at a fixed rate polls every state at
+ * the rate of the most demanding one. With StateMachine::tick(), each
+ * state says when it next needs updating, and TickScheduler blocks the
+ * task until then, or until another task or an ISR calls wake():
+ *
+ * @code
+ * TickScheduler scheduler(1000); // Never sleep longer than the watchdog allows
+ *
+ * void buttonIsr(void *) {
+ *     bool woken = false;
+ *     scheduler.wakeFromIsr(&woken);
+ *     if (woken) portYIELD_FROM_ISR();
+ * }
+ *
+ * while (true) {
+ *     scheduler.runOnce(sm);
+ * }
+ * @endcode
+ *
+ * While every task is blocked, FreeRTOS runs the idle task; with power
+ * management enabled (CONFIG_PM_ENABLE, CONFIG_FREERTOS_USE_TICKLESS_IDLE)
+ * it puts the chip in light sleep until the earliest deadline, so a state
+ * returning a long nextUpdateDelayMs() or IState::NO_UPDATE sleeps the
+ * chip rather than spinning it.
+ *
+ * @copyright Copyright (c) 2025 LopTech
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace lopcore
+{
+
+/**
+ * @brief Blocks one task between state machine ticks
+ *
+ * runOnce() and sleep() belong to the driving task; wake() and
+ * wakeFromIsr() may be called from anywhere. A wake() before the task
+ * sleeps is kept, so the next sleep returns at once.
+ */
+class TickScheduler
+{
+public:
+    /**
+     * @param maxSleepMs Longest single sleep, whatever the state asks for
+     */
+    explicit TickScheduler(uint32_t maxSleepMs = UINT32_MAX) : maxSleepMs_(maxSleepMs)
+    {
+    }
+
+    TickScheduler(const TickScheduler &) = delete;
+    TickScheduler &operator=(const TickScheduler &) = delete;
+
+    /**
+     * @brief Tick machine, then sleep until its next update is due or wake()
+     *
+     * @param machine Anything with uint32_t tick() returning the delay in ms
+     * @return true if woken before the deadline
+     */
+    template<typename Machine>
+    bool runOnce(Machine &machine)
+    {
+        uint32_t delayMs = machine.tick();
+        return delayMs == 0 ? false : sleep(delayMs);
+    }
+
+    /**
+     * @brief Block for up to timeoutMs (capped at maxSleepMs), or until wake()
+     *
+     * @return true if woken, false on timeout
+     */
+    bool sleep(uint32_t timeoutMs)
+    {
+        if (timeoutMs > maxSleepMs_)
+        {
+            timeoutMs = maxSleepMs_;
+        }
+        sleeps_++;
+#ifdef ESP_PLATFORM
+        owner_.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+        if (pending_.exchange(false))
+        {
+            return true;
+        }
+        TickType_t ticks = timeoutMs == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+        bool woken = ulTaskNotifyTake(pdTRUE, ticks) > 0;
+        pending_.store(false);
+        return woken;
+#else
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto isPending = [this] { return pending_.load(); };
+        if (timeoutMs == UINT32_MAX)
+        {
+            wake_.wait(lock, isPending);
+        }
+        else
+        {
+            wake_.wait_for(lock, std::chrono::milliseconds(timeoutMs), isPending);
+        }
+        return pending_.exchange(false);
+#endif
+    }
+
+    /**
+     * @brief End the current or next sleep, from a task
+     */
+    void wake()
+    {
+#ifdef ESP_PLATFORM
+        pending_.store(true);
+        TaskHandle_t owner = static_cast<TaskHandle_t>(owner_.load(std::memory_order_acquire));
+        if (owner != nullptr)
+        {
+            xTaskNotifyGive(owner);
+        }
+#else
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.store(true);
+        wake_.notify_one();
+#endif
+    }
+
+    /**
+     * @brief End the current or next sleep, from an interrupt handler
+     *
+     * @param[out] higherPriorityTaskWoken Set if the driving task should run
+     *             next; pass it to portYIELD_FROM_ISR()
+     */
+    void wakeFromIsr(bool *higherPriorityTaskWoken)
+    {
+#ifdef ESP_PLATFORM
+        pending_.store(true);
+        BaseType_t woken = pdFALSE;
+        TaskHandle_t owner = static_cast<TaskHandle_t>(owner_.load(std::memory_order_acquire));
+        if (owner != nullptr)
+        {
+            vTaskNotifyGiveFromISR(owner, &woken);
+        }
+        if (higherPriorityTaskWoken != nullptr)
+        {
+            *higherPriorityTaskWoken = woken == pdTRUE;
+        }
+#else
+        if (higherPriorityTaskWoken != nullptr)
+        {
+            *higherPriorityTaskWoken = false;
+        }
+        wake();
+#endif
+    }
+
+    /**
+     * @brief Number of sleeps so far, to compare against a fixed-rate loop
+     */
+    uint32_t getSleepCount() const
+    {
+        return sleeps_;
+    }
+
+private:
+    uint32_t maxSleepMs_;
+    uint32_t sleeps_ = 0;
+    std::atomic<bool> pending_{false}; ///< wake() not yet consumed by a sleep
+
+#ifdef ESP_PLATFORM
+    std::atomic<void *> owner_{nullptr}; ///< TaskHandle_t of the sleeping task
+#else
+    std::mutex mutex_;
+    std::condition_variable wake_;
+#endif
+};
+
+} // namespace lopcore
@@ -0,0 +1,190 @@
+/**
+ * @file asset_bundle.hpp
+ * @brief Read-only assets used in place from memory-mapped flash
+ *
+ * read() on a file backend copies the whole file to the heap, which ML
+ * model weights, CA bundles or fonts of several hundred KB cannot afford.
+ * Packed into a bundle with tools/lopcore_asset_pack.py and flashed to a
+ * raw data partition, they are mapped into the address space instead and
+ * read straight from flash through the cache, with no copy:
+ *
+ * @code
+ * // partitions.csv:  assets, data, 0x40, , 1M
+ * // lopcore_asset_pack.py bundle.bin model.tflite ca.pem
+ * // parttool.py write_partition --partition-name assets --input bundle.bin
+ * AssetBundle assets;
+ * assets.mapPartition("assets");
+ * AssetView model = assets.find("model.tflite");
+ * interpreter.load(model.data, model.size);
+ * @endcode
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace lopcore
+{
+
+/**
+ * @brief A contiguous, read-only byte range that is never copied
+ */
+struct AssetView
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+    explicit operator bool() const
+    {
+        return data != nullptr;
+    }
+};
+
+/**
+ * @brief A data partition mapped read-only into the address space
+ *
+ * The mapping lasts until unmap() or destruction; views into it must not
+ * outlive that. Mapping takes MMU pages (64 KB each) from the same pool as
+ * the application's flash rodata, so map only what is needed.
+ */
+class MappedPartition
+{
+public:
+    MappedPartition() = default;
+    ~MappedPartition();
+
+    MappedPartition(const MappedPartition &) = delete;
+    MappedPartition &operator=(const MappedPartition &) = delete;
+
+    /**
+     * @brief Map the first length bytes of a data partition
+     *
+     * @param label Partition label from the partition table
+     * @param length Bytes to map (0 = the whole partition)
+     * @return false if the partition is not found, too small, or cannot be
+     *         mapped; always false on the host
+     */
+    bool map(const std::string &label, size_t length = 0);
+
+    void unmap();
+
+    /**
+     * @brief Read from the partition without mapping it
+     *
+     * @return false if not found or out of range; always false on the host
+     */
+    static bool read(const std::string &label, size_t offset, void *buffer, size_t length);
+
+    AssetView view() const
+    {
+        return AssetView{data_, size_};
+    }
+
+private:
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+    uint32_t handle_ = 0; ///< esp_partition_mmap_handle_t
+};
+
+/**
+ * @brief Named assets packed into one image, looked up in place
+ *
+ * Bundle layout (little-endian), written by tools/lopcore_asset_pack.py:
+ *
+ *     Header  "LCAB", u16 version, u16 alignment, u32 count,
+ *             u32 totalSize, u32 crc32 of bytes [24, totalSize), u32 reserved
+ *     Entries count x {u32 nameOffset, u32 dataOffset, u32 dataSize,
+ *             u16 nameLength, u16 reserved}, sorted by name
+ *     Names   UTF-8, not NUL-terminated
+ *     Data    each asset at a multiple of alignment from the bundle start
+ *
+ * Offsets are from the bundle start. find() is a binary search over the
+ * entries, reading only the names it compares.
+ */
+class AssetBundle
+{
+public:
+    static constexpr uint16_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 24;
+    static constexpr size_t ENTRY_SIZE = 16;
+
+    AssetBundle() = default;
+
+    AssetBundle(const AssetBundle &) = delete;
+    AssetBundle &operator=(const AssetBundle &) = delete;
+
+    /**
+     * @brief Use a bundle image already in the address space
+     *
+     * For bundles linked into the application (EMBED_FILES) or in RAM.
+     * image must outlive this object.
+     *
+     * @return false if the header or entry table is malformed
+     */
+    bool attach(const uint8_t *image, size_t length);
+
+    /**
+     * @brief Map the bundle at the start of a data partition and attach it
+     *
+     * Only the bundle's totalSize is mapped, not the whole partition.
+     *
+     * @return false if the partition holds no valid bundle
+     */
+    bool mapPartition(const std::string &label);
+
+    bool isOpen() const
+    {
+        return image_ != nullptr;
+    }
+
+    /**
+     * @brief Locate an asset by exact name
+     *
+     * @return View into the bundle, empty if there is no such asset
+     */
+    AssetView find(const std::string &name) const;
+
+    /**
+     * @brief Number of assets
+     */
+    size_t count() const
+    {
+        return count_;
+    }
+
+    /**
+     * @brief Name of the asset at index (in name order)
+     */
+    std::string nameAt(size_t index) const;
+
+    /**
+     * @brief Asset at index (in name order)
+     */
+    AssetView at(size_t index) const;
+
+    /**
+     * @brief Check the CRC-32 over everything after the header
+     *
+     * Reads the whole bundle from flash once; meant for boot or after an
+     * update, not before every find().
+     */
+    bool verify() const;
+
+private:
+    const uint8_t *entry(size_t index) const
+    {
+        return image_ + HEADER_SIZE + index * ENTRY_SIZE;
+    }
+
+    const uint8_t *image_ = nullptr;
+    size_t size_ = 0;
+    size_t count_ = 0;
+    MappedPartition partition_; ///< Backs image_ after mapPartition()
+};
+
+} // namespace lopcore
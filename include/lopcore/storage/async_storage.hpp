@@ -0,0 +1,220 @@
+/**
+ * @file async_storage.hpp
+ * @brief Storage operations queued to a dedicated worker task
+ *
+ * An SD card pauses writes for 50-200 ms while it collects garbage
+ * internally, and a flash erase blocks for tens of ms. AsyncStorage puts
+ * any backend behind a bounded queue served by its own task, so
+ * time-critical producers hand the data over and carry on:
+ *
+ * @code
+ * SdCardStorage card(cardConfig);
+ * AsyncStorage async(card, storage::AsyncStorageConfig().setPriority(3));
+ * async.start();
+ * async.writeAsync("state", snapshot);                  // Returns at once
+ * auto pending = async.readAsync("calibration");        // std::future
+ * @endcode
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef ESP_PLATFORM
+#include <condition_variable>
+#include <thread>
+#endif
+
+#include "storage_config.hpp"
+
+namespace lopcore
+{
+
+/**
+ * @brief AsyncStorage counters
+ */
+struct AsyncStorageStats
+{
+    uint32_t writes{0};    ///< Writes performed by the worker
+    uint32_t reads{0};     ///< Reads performed by the worker
+    uint32_t coalesced{0}; ///< Writes merged into a queued write to the same key
+    uint32_t rejected{0};  ///< Operations refused because the queue stayed full or the worker is stopped
+    uint32_t failed{0};    ///< Writes the backend reported as failed
+};
+
+/**
+ * @brief Bounded operation queue in front of a storage backend
+ *
+ * Operations run in submission order on the worker task, with one
+ * exception: a write to a key that already has a write waiting replaces
+ * that write's data instead of taking another slot, and both callers get
+ * its result. A read of the key in between stops this, so a read always
+ * sees the data written before it was submitted and nothing later.
+ *
+ * Completion is reported through a std::future or a callback; callbacks
+ * run on the worker task and should return quickly. The backend must not
+ * be used directly while the worker may be accessing it from another task
+ * unless the backend is thread-safe (all LopCore backends are).
+ */
+class AsyncStorage
+{
+public:
+    using WriteFunction = std::function<bool(const std::string &, const std::vector<uint8_t> &)>;
+    using ReadFunction = std::function<std::optional<std::vector<uint8_t>>(const std::string &)>;
+    using WriteCallback = std::function<void(bool)>;
+    using ReadCallback = std::function<void(std::optional<std::vector<uint8_t>>)>;
+
+    /**
+     * @brief Queue in front of a backend with write(key, vector) and readBinary(key)
+     *
+     * @param storage Backend, which must outlive this object
+     * @param config Queue and worker task settings
+     */
+    template <typename Storage>
+    AsyncStorage(Storage &storage, const storage::AsyncStorageConfig &config)
+        : AsyncStorage(
+              [&storage](const std::string &key, const std::vector<uint8_t> &data) {
+                  return storage.write(key, data);
+              },
+              [&storage](const std::string &key) { return storage.readBinary(key); },
+              config)
+    {
+    }
+
+    /**
+     * @brief Queue in front of arbitrary write and read functions
+     */
+    AsyncStorage(WriteFunction write, ReadFunction read, const storage::AsyncStorageConfig &config);
+
+    /**
+     * @brief Stops the worker after the queued operations (see stop())
+     */
+    ~AsyncStorage();
+
+    AsyncStorage(const AsyncStorage &) = delete;
+    AsyncStorage &operator=(const AsyncStorage &) = delete;
+
+    /**
+     * @brief Create the worker task
+     *
+     * @return false if already running or the task cannot be created
+     */
+    bool start();
+
+    /**
+     * @brief Finish every queued operation, then stop the worker
+     *
+     * Operations submitted meanwhile are rejected. Must not be called
+     * from a callback.
+     */
+    void stop();
+
+    bool isRunning() const
+    {
+        return running_.load();
+    }
+
+    /**
+     * @brief Queue a write
+     *
+     * @return Future of the backend's result; false at once if rejected
+     */
+    std::future<bool> writeAsync(const std::string &key, std::vector<uint8_t> data);
+    std::future<bool> writeAsync(const std::string &key, const std::string &data);
+
+    /**
+     * @brief Queue a write, reporting its result to done on the worker task
+     *
+     * @return false if rejected; done is then not called
+     */
+    bool writeAsync(const std::string &key, std::vector<uint8_t> data, WriteCallback done);
+
+    /**
+     * @brief Queue a read
+     *
+     * @return Future of the data; nullopt at once if rejected
+     */
+    std::future<std::optional<std::vector<uint8_t>>> readAsync(const std::string &key);
+
+    /**
+     * @brief Queue a read, passing the data to done on the worker task
+     *
+     * @return false if rejected; done is then not called
+     */
+    bool readAsync(const std::string &key, ReadCallback done);
+
+    /**
+     * @brief Wait until every operation submitted so far has completed
+     *
+     * Must not be called from a callback.
+     */
+    void flush();
+
+    /**
+     * @brief Operations waiting for the worker
+     */
+    size_t pending() const;
+
+    AsyncStorageStats getStats() const;
+
+private:
+    /**
+     * @brief One queued operation
+     */
+    struct Job
+    {
+        bool isWrite;
+        std::string key;
+        std::vector<uint8_t> data;            ///< Data to write
+        std::vector<WriteCallback> writeDone; ///< One per coalesced writer
+        ReadCallback readDone;                ///< Receives the read data
+    };
+
+    /**
+     * @brief Add a job, coalescing writes; waits up to enqueueTimeoutMs for space
+     */
+    bool submit(Job job);
+
+    static void workerEntry(void *arg);
+    void run();
+    void wakeWorker();
+
+    WriteFunction write_;
+    ReadFunction read_;
+    const storage::AsyncStorageConfig config_;
+
+    mutable std::mutex mutex_;                                            ///< Guards the fields below
+    std::list<Job> queue_;                                                ///< Waiting operations, oldest first
+    std::unordered_map<std::string, std::list<Job>::iterator> openWrite_; ///< Waiting write each key may coalesce into
+    bool busy_ = false;                                                   ///< Worker is running an operation
+
+    std::atomic<bool> running_{false}; ///< Submissions accepted while set
+    std::atomic<uint32_t> writes_{0};
+    std::atomic<uint32_t> reads_{0};
+    std::atomic<uint32_t> coalesced_{0};
+    std::atomic<uint32_t> rejected_{0};
+    std::atomic<uint32_t> failed_{0};
+
+#ifdef ESP_PLATFORM
+    void *task_ = nullptr;            ///< TaskHandle_t of the worker
+    std::atomic<bool> stopped_{true}; ///< Set by the worker on exit
+#else
+    std::thread thread_;           ///< Host worker thread
+    std::condition_variable wake_; ///< Signals a queued job or stop
+#endif
+};
+
+} // namespace lopcore
@@ -0,0 +1,382 @@
+/**
+ * @file compressed_storage.hpp
+ * @brief Transparent LZ compression over a file backend
+ *
+ * JSON configuration and telemetry backlogs are repetitive text that
+ * fills a small flash partition quickly. CompressedStorage compresses
+ * values on write and decompresses them on read, including through
+ * chunked streams, so large files never sit whole in RAM:
+ *
+ * @code
+ * LittleFsStorage flash(config);
+ * CompressedStorage<LittleFsStorage> store(flash, storage::CompressedStorageConfig().addSuffix(".json"));
+ * store.write("config.json", json);              // Compressed
+ * auto size = store.getFileSize("config.json");  // Uncompressed size, from the header
+ *
+ * CompressedWriter backlog = store.openWriter("backlog.json");
+ * backlog.write(record);                         // Repeatedly
+ * backlog.close();
+ * @endcode
+ *
+ * Stored format: "LCZS", the uncompressed size (u32, little-endian),
+ * then the token stream of compression/lzss.hpp (4 KB window, LZSS flag
+ * groups). A value without the header is read as stored, so files
+ * written before compression was enabled stay readable.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "storage_config.hpp"
+#include "storage_stream.hpp"
+#include "storage_traits.hpp"
+
+namespace lopcore
+{
+
+namespace lzss
+{
+class StreamEncoder;
+} // namespace lzss
+
+/**
+ * @brief Decompressing read stream, closed when destroyed
+ *
+ * Holds a 4 KB window while the value is compressed. Not thread-safe:
+ * use one reader per task.
+ */
+class CompressedReader
+{
+public:
+    CompressedReader() = default;
+
+    /**
+     * @brief Read a stored value through a file stream
+     *
+     * @param reader Stream positioned at the start of the stored value
+     * @param compressed Whether the key is one that may be compressed;
+     *                   if false the value is always read as stored
+     */
+    CompressedReader(StorageReader reader, bool compressed);
+
+    ~CompressedReader();
+
+    CompressedReader(CompressedReader &&other) noexcept;
+    CompressedReader &operator=(CompressedReader &&other) noexcept;
+    CompressedReader(const CompressedReader &) = delete;
+    CompressedReader &operator=(const CompressedReader &) = delete;
+
+    /**
+     * @brief Whether the value was opened and is not closed yet
+     *
+     * A compressed value whose writer was never closed does not open.
+     */
+    bool isOpen() const
+    {
+        return reader_.isOpen();
+    }
+
+    explicit operator bool() const
+    {
+        return isOpen();
+    }
+
+    /**
+     * @brief Read up to length uncompressed bytes
+     *
+     * @return Bytes read; less than length only at the end or on error
+     */
+    size_t read(uint8_t *buffer, size_t length);
+
+    /**
+     * @brief Uncompressed size of the value
+     */
+    size_t size() const
+    {
+        return size_;
+    }
+
+    /**
+     * @brief Whether every byte of the value has been read
+     */
+    bool eof() const
+    {
+        return position_ >= size_;
+    }
+
+    /**
+     * @brief Whether the compressed data turned out to be corrupt or truncated
+     */
+    bool failed() const
+    {
+        return failed_;
+    }
+
+    /**
+     * @brief Whether the value is stored compressed
+     */
+    bool isCompressed() const
+    {
+        return decoder_ != nullptr;
+    }
+
+    void close();
+
+    /**
+     * @brief Uncompressed size of a stored value, reading only its header
+     *
+     * Leaves the stream after the header if compressed, at the start otherwise.
+     *
+     * @return The size, or std::nullopt if reader is closed or the value's
+     *         writer was never closed
+     */
+    static std::optional<size_t> storedSize(StorageReader &reader, bool compressed);
+
+private:
+    struct Decoder;
+
+    StorageReader reader_;
+    std::unique_ptr<Decoder> decoder_; ///< Null when the value is stored as is
+    size_t size_ = 0;
+    size_t position_ = 0;
+    bool failed_ = false;
+};
+
+/**
+ * @brief Compressing write stream, finished and closed when destroyed
+ *
+ * Holds about 12 KB (input window and match table) while compressing.
+ * Call close() to learn whether the final write succeeded; the
+ * destructor cannot report it. Not thread-safe: use one writer per task.
+ */
+class CompressedWriter
+{
+public:
+    CompressedWriter() = default;
+
+    /**
+     * @brief Write a value through a file stream
+     *
+     * @param writer Stream truncating the file, not appending
+     * @param compress Compress, or write the data as it is
+     */
+    CompressedWriter(StorageWriter writer, bool compress);
+
+    ~CompressedWriter();
+
+    CompressedWriter(CompressedWriter &&other) noexcept;
+    CompressedWriter &operator=(CompressedWriter &&other) noexcept;
+    CompressedWriter(const CompressedWriter &) = delete;
+    CompressedWriter &operator=(const CompressedWriter &) = delete;
+
+    bool isOpen() const
+    {
+        return writer_.isOpen();
+    }
+
+    explicit operator bool() const
+    {
+        return isOpen();
+    }
+
+    /**
+     * @brief Write length uncompressed bytes
+     *
+     * @return true if all bytes were accepted, false if closed or on error
+     */
+    bool write(const uint8_t *data, size_t length);
+
+    bool write(const std::string &data)
+    {
+        return write(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+    }
+
+    /**
+     * @brief Uncompressed bytes written so far
+     */
+    size_t tell() const
+    {
+        return written_;
+    }
+
+    /**
+     * @brief Compress the remaining input, record the size in the header and close
+     *
+     * @return true if everything written reached the file
+     */
+    bool close();
+
+    /**
+     * @brief Compress a whole value in memory, header included
+     *
+     * @param[out] out Stored form of the value
+     * @return true if out is smaller than the input
+     */
+    static bool compress(const uint8_t *data, size_t length, std::vector<uint8_t> &out);
+
+    /**
+     * @brief Whether data starts like a compressed value
+     *
+     * Such data must be stored compressed even if that does not save
+     * space, or reading it back would try to decompress it.
+     */
+    static bool looksCompressed(const uint8_t *data, size_t length);
+
+private:
+    bool flushPending();
+
+    StorageWriter writer_;
+    std::unique_ptr<lzss::StreamEncoder> encoder_; ///< Null when writing as is
+    std::vector<uint8_t> pending_;                 ///< Encoded bytes not yet written
+    size_t written_ = 0;
+    bool ok_ = true;
+};
+
+/**
+ * @brief File backend whose selected keys are stored compressed
+ *
+ * Keys ending in one of the configured suffixes (all keys if none are
+ * configured) are compressed; the rest pass through unchanged. write()
+ * keeps a value as it is if compressing would not make it smaller, so
+ * incompressible data costs nothing extra to read.
+ *
+ * Holds no state of its own: as thread-safe as the backend.
+ */
+template <typename Backend>
+class CompressedStorage
+{
+    static_assert(storage::traits::supports_streaming_v<Backend>,
+                  "CompressedStorage needs a file backend with openReader and openWriter");
+
+public:
+    /**
+     * @param backend File backend, which must outlive this object
+     */
+    CompressedStorage(Backend &backend, const storage::CompressedStorageConfig &config)
+        : backend_(backend), config_(config)
+    {
+    }
+
+    Backend &backend() const
+    {
+        return backend_;
+    }
+
+    bool write(const std::string &key, const std::vector<uint8_t> &data)
+    {
+        if (!compresses(key) ||
+            (data.size() < config_.minSize && !CompressedWriter::looksCompressed(data.data(), data.size())))
+        {
+            return backend_.write(key, data);
+        }
+
+        std::vector<uint8_t> stored;
+        if (!CompressedWriter::compress(data.data(), data.size(), stored) &&
+            !CompressedWriter::looksCompressed(data.data(), data.size()))
+        {
+            return backend_.write(key, data);
+        }
+        return backend_.write(key, stored);
+    }
+
+    bool write(const std::string &key, const std::string &data)
+    {
+        return write(key, std::vector<uint8_t>(data.begin(), data.end()));
+    }
+
+    std::optional<std::vector<uint8_t>> readBinary(const std::string &key)
+    {
+        CompressedReader reader = openReader(key);
+        if (!reader)
+        {
+            return std::nullopt;
+        }
+        std::vector<uint8_t> data(reader.size());
+        if (reader.read(data.data(), data.size()) != data.size() || reader.failed())
+        {
+            return std::nullopt;
+        }
+        return data;
+    }
+
+    std::optional<std::string> read(const std::string &key)
+    {
+        std::optional<std::vector<uint8_t>> data = readBinary(key);
+        if (!data)
+        {
+            return std::nullopt;
+        }
+        return std::string(data->begin(), data->end());
+    }
+
+    /**
+     * @brief Uncompressed size, from the header; no decompression
+     */
+    std::optional<size_t> getFileSize(const std::string &key)
+    {
+        StorageReader reader = backend_.openReader(key, 0);
+        return CompressedReader::storedSize(reader, compresses(key));
+    }
+
+    bool exists(const std::string &key)
+    {
+        return backend_.exists(key);
+    }
+
+    bool remove(const std::string &key)
+    {
+        return backend_.remove(key);
+    }
+
+    /**
+     * @brief Open a value for chunked, decompressing reads
+     */
+    CompressedReader openReader(const std::string &key, size_t bufferSize = STORAGE_STREAM_BUFFER_SIZE)
+    {
+        return CompressedReader(backend_.openReader(key, bufferSize), compresses(key));
+    }
+
+    /**
+     * @brief Open a value for chunked, compressing writes, replacing it
+     *
+     * Compressed values cannot be appended to; write them in one pass.
+     */
+    CompressedWriter openWriter(const std::string &key, size_t bufferSize = STORAGE_STREAM_BUFFER_SIZE)
+    {
+        return CompressedWriter(backend_.openWriter(key, false, bufferSize), compresses(key));
+    }
+
+    /**
+     * @brief Whether values of key are stored compressed
+     */
+    bool compresses(const std::string &key) const
+    {
+        if (config_.suffixes.empty())
+        {
+            return true;
+        }
+        for (const std::string &suffix : config_.suffixes)
+        {
+            if (key.size() >= suffix.size() && key.compare(key.size() - suffix.size(), suffix.size(), suffix) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    Backend &backend_;
+    const storage::CompressedStorageConfig config_;
+};
+
+} // namespace lopcore
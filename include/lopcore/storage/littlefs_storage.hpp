@@ -11,12 +11,17 @@
 
 #pragma once
 
+#include <atomic>
 #include <mutex>
 #include <optional>
+#include <shared_mutex>
 #include <string>
 #include <vector>
 
+#include "path_lock.hpp"
 #include "storage_config.hpp"
+#include "storage_index.hpp"
+#include "storage_stream.hpp"
 #include "storage_type.hpp"
 
 namespace lopcore
@@ -105,6 +110,21 @@ public:
      */
     bool write(const std::string &key, const void *data, size_t dataLen);
 
+    /**
+     * @brief Replace a file so that a power loss leaves the old or the new content
+     *
+     * One open/fsync/close of a temporary file and a rename; see
+     * writeFileAtomic(). Prefer it over write() for configuration files.
+     *
+     * @param key File path relative to base path
+     * @param data Content to write
+     * @param keepBackup Keep the previous content as the key's ".bak" file
+     * @return true if the file now holds data, false otherwise
+     */
+    bool writeAtomic(const std::string &key, const std::string &data, bool keepBackup = false);
+    bool writeAtomic(const std::string &key, const std::vector<uint8_t> &data, bool keepBackup = false);
+    bool writeAtomic(const std::string &key, const void *data, size_t dataLen, bool keepBackup = false);
+
     /**
      * @brief Read string data from file
      *
@@ -121,6 +141,49 @@ public:
      */
     std::optional<std::vector<uint8_t>> readBinary(const std::string &key);
 
+    /**
+     * @brief Open a file for chunked reading
+     *
+     * @param key File path relative to base path
+     * @param bufferSize stdio buffer of the stream
+     * @return The reader, closed if the file could not be opened
+     */
+    StorageReader openReader(const std::string &key, size_t bufferSize = STORAGE_STREAM_BUFFER_SIZE);
+
+    /**
+     * @brief Open a file for chunked writing
+     *
+     * @param key File path relative to base path
+     * @param append Write after existing content instead of replacing it
+     * @param bufferSize stdio buffer of the stream
+     * @return The writer, closed if the file could not be opened
+     */
+    StorageWriter openWriter(const std::string &key,
+                             bool append = false,
+                             size_t bufferSize = STORAGE_STREAM_BUFFER_SIZE);
+
+    /**
+     * @brief Append data to the end of a file, creating it if needed
+     *
+     * Costs the size of data, not of the file. The config's AppendPolicy
+     * decides whether the file stays open for the next append() and when
+     * it is fsynced; any other operation on the file closes it first.
+     *
+     * @param key File path relative to base path
+     * @param data Data to append
+     * @return true if all data was written, false otherwise
+     */
+    bool append(const std::string &key, const std::string &data);
+    bool append(const std::string &key, const std::vector<uint8_t> &data);
+    bool append(const std::string &key, const void *data, size_t dataLen);
+
+    /**
+     * @brief fsync every file kept open by append()
+     *
+     * @return false if syncing any of them failed
+     */
+    bool syncAppends();
+
     /**
      * @brief Check if file exists
      *
@@ -192,7 +255,9 @@ public:
     /**
      * @brief List files matching a wildcard pattern
      *
-     * Supports simple wildcard matching with '*' (e.g., "acc_raw_*.bin")
+     * Supports '*', '?' and character classes (e.g., "acc_raw_*.bin",
+     * "log_2026-0[1-3]-??"); see globMatch(). With the file index enabled,
+     * only names starting with the pattern's literal prefix are visited.
      *
      * @param directory Directory to search (empty for root)
      * @param pattern Wildcard pattern
@@ -265,9 +330,12 @@ public:
     bool initialize();
 
 private:
-    storage::LittleFsConfig config_; ///< LittleFS configuration
-    bool initialized_;               ///< Whether LittleFS was successfully mounted
-    mutable std::mutex mutex_;       ///< Mutex for thread safety
+    storage::LittleFsConfig config_;  ///< LittleFS configuration
+    std::atomic<bool> initialized_;   ///< Whether LittleFS was successfully mounted
+    mutable std::shared_mutex mutex_; ///< Shared by file operations, exclusive for mount and format
+    mutable PathLocks pathLocks_;     ///< Per file: shared by reads, exclusive by changes
+    StorageAppender appender_;        ///< Files kept open by append()
+    StorageIndex index_;              ///< File metadata, built if config_.indexFiles
 
     /**
      * @brief Get full file path from key
@@ -278,16 +346,9 @@ private:
     std::string getFullPath(const std::string &key) const;
 
     /**
-     * @brief Simple wildcard pattern matching
-     *
-     * Supports patterns with '*' wildcard (matches any characters)
-     * Example: "acc_raw_*.bin" matches "acc_raw_1.bin", "acc_raw_123.bin", etc.
-     *
-     * @param pattern Pattern string with optional '*' wildcard
-     * @param str String to match against pattern
-     * @return true if matches, false otherwise
+     * @brief Build index_ from the mounted directory, if config_.indexFiles
      */
-    static bool patternMatch(const char *pattern, const char *str);
+    void buildIndex();
 
     /**
      * @brief Check if LittleFS is already mounted
@@ -15,22 +15,42 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <list>
 #include <mutex>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "storage_config.hpp"
+#include "storage_traits.hpp"
 #include "storage_type.hpp"
 
 #ifdef ESP_PLATFORM
+#include <esp_timer.h>
 #include <nvs.h>
 #include <nvs_flash.h>
+#else
+#include <condition_variable>
+#include <thread>
 #endif
 
 namespace lopcore
 {
 
+/**
+ * @brief NvsStorage read cache counters
+ */
+struct NvsCacheStats
+{
+    size_t entries{0};     ///< Values currently cached
+    uint32_t hits{0};      ///< Reads served from the cache
+    uint32_t misses{0};    ///< Reads that went to NVS
+    uint32_t evictions{0}; ///< Values dropped to make room
+};
+
 /**
  * @brief NVS implementation of IStorage interface
  *
@@ -54,10 +74,23 @@ namespace lopcore
  * std::string ssid;
  * storage.readString("wifi_ssid", ssid);
  * @endcode
+ *
+ * Writing many keys at once (a whole configuration) should be batched so
+ * they cost one flash commit instead of one each:
+ * @code
+ * {
+ *     NvsStorage::Batch batch(storage);
+ *     for (const auto &field : fields) {
+ *         storage.write(field.key, field.value);
+ *     }
+ * } // Committed here, or earlier with batch.commit()
+ * @endcode
  */
 class NvsStorage
 {
 public:
+    class Batch;
+
     /**
      * @brief Construct NVS storage with configuration (RECOMMENDED)
      *
@@ -95,6 +128,108 @@ public:
     bool write(const std::string &key, const std::vector<uint8_t> &data);
     std::optional<std::string> read(const std::string &key);
     std::optional<std::vector<uint8_t>> readBinary(const std::string &key);
+
+    /**
+     * @brief Read a string value into a caller-provided buffer
+     *
+     * One NVS lookup and no heap allocation. The value is NUL-terminated.
+     *
+     * @param key Key to read
+     * @param buffer Destination, at least capacity bytes
+     * @param capacity Size of buffer, terminator included
+     * @param length Set to the string length on success, or to the capacity
+     *               needed (terminator included) if buffer is too small
+     * @return true if the value was read, false if missing, too large or on error
+     */
+    bool read(const std::string &key, char *buffer, size_t capacity, size_t *length);
+
+    /**
+     * @brief Read a binary value into a caller-provided buffer
+     *
+     * One NVS lookup and no heap allocation.
+     *
+     * @param key Key to read
+     * @param buffer Destination, at least capacity bytes
+     * @param capacity Size of buffer
+     * @param length Set to the value size on success, or to the capacity
+     *               needed if buffer is too small
+     * @return true if the value was read, false if missing, too large or on error
+     */
+    bool readBinary(const std::string &key, uint8_t *buffer, size_t capacity, size_t *length);
+
+    /**
+     * @brief Write a binary value from a caller-provided buffer
+     *
+     * @param key Key to write
+     * @param data Bytes to store
+     * @param size Number of bytes
+     * @return true if the value was written, false otherwise
+     */
+    bool writeBinary(const std::string &key, const uint8_t *data, size_t size);
+
+    /**
+     * @brief Write a typed value without heap allocation
+     *
+     * Integers use NVS's native u8 ... i64 entries, so they are read back
+     * with get<T> of the same width and signedness. Other trivially
+     * copyable types are stored as a blob of their bytes.
+     *
+     * @code
+     * storage.set<uint32_t>("boot_count", count + 1);
+     * storage.set("calib", Calibration{1.02f, -0.4f});
+     * @endcode
+     *
+     * @tparam T A type with storage::traits::is_nvs_storable_v
+     * @return true if the value was written, false otherwise
+     */
+    template<typename T>
+    bool set(const std::string &key, const T &value)
+    {
+        static_assert(storage::traits::is_nvs_storable_v<T>,
+                      "NvsStorage::set needs an integer or a trivially copyable type");
+        if constexpr (storage::traits::is_nvs_scalar_v<T>)
+        {
+            return setScalar(key, scalarTypeOf<T>(), static_cast<uint64_t>(value));
+        }
+        else
+        {
+            return writeBinary(key, reinterpret_cast<const uint8_t *>(&value), sizeof(T));
+        }
+    }
+
+    /**
+     * @brief Read a typed value written by set<T>
+     *
+     * @tparam T A type with storage::traits::is_nvs_storable_v
+     * @return The value, or std::nullopt if missing, of another type or size,
+     *         or on error
+     */
+    template<typename T>
+    std::optional<T> get(const std::string &key)
+    {
+        static_assert(storage::traits::is_nvs_storable_v<T>,
+                      "NvsStorage::get needs an integer or a trivially copyable type");
+        if constexpr (storage::traits::is_nvs_scalar_v<T>)
+        {
+            uint64_t bits = 0;
+            if (!getScalar(key, scalarTypeOf<T>(), bits))
+            {
+                return std::nullopt;
+            }
+            return static_cast<T>(bits);
+        }
+        else
+        {
+            T value{};
+            size_t length = 0;
+            if (!readBinary(key, reinterpret_cast<uint8_t *>(&value), sizeof(T), &length) || length != sizeof(T))
+            {
+                return std::nullopt;
+            }
+            return value;
+        }
+    }
+
     bool exists(const std::string &key);
     std::vector<std::string> listKeys();
     bool remove(const std::string &key);
@@ -122,10 +257,44 @@ public:
      *
      * @return true if commit succeeded, false otherwise
      *
-     * @note Writes are automatically committed, but you can manually commit for performance
+     * @note Writes are committed by the NvsConfig auto-commit policy and at the
+     *       end of a batch; call this to commit pending writes sooner
      */
     bool commit();
 
+    /**
+     * @brief Defer commits until the matching commitBatch()
+     *
+     * Writes, removals and namespace erases inside a batch are applied at
+     * once but committed together at the end, whatever the auto-commit
+     * policy. Batches nest: only the outermost commitBatch() commits.
+     * Prefer the Batch guard, which cannot leave a batch open.
+     *
+     * @return true if a batch was started, false if not initialized
+     */
+    bool beginBatch();
+
+    /**
+     * @brief End a batch started with beginBatch()
+     *
+     * @return true if the batch ended and, for the outermost one, its
+     *         writes were committed; false if no batch was open or the
+     *         commit failed (the writes stay pending for the next commit)
+     */
+    bool commitBatch();
+
+    /**
+     * @brief Writes applied but not yet committed
+     */
+    size_t pendingWrites() const;
+
+    /**
+     * @brief Read cache counters, to size NvsConfig::cacheEntries
+     *
+     * All zero when the cache is off.
+     */
+    NvsCacheStats getCacheStats() const;
+
     /**
      * @brief Get the namespace name
      *
@@ -144,15 +313,186 @@ public:
     bool initialize();
 
 private:
-    storage::NvsConfig config_; ///< NVS configuration
-    mutable std::mutex mutex_;  ///< Mutex for thread safety
-    bool initialized_;          ///< Whether NVS was initialized by this instance
+    /// Values up to this size are read through a stack buffer in one lookup
+    static constexpr size_t SMALL_VALUE_SIZE = 64;
+
+    enum class ReadResult
+    {
+        OK,
+        NOT_FOUND,
+        TOO_SMALL, ///< Buffer too small; length holds the size needed
+        FAILED
+    };
+
+    /// NVS integer entry types used by get/set
+    enum class ScalarType
+    {
+        U8,
+        I8,
+        U16,
+        I16,
+        U32,
+        I32,
+        U64,
+        I64
+    };
+
+    template<typename T>
+    static constexpr ScalarType scalarTypeOf()
+    {
+        constexpr bool isSigned = std::is_signed_v<T>;
+        if constexpr (sizeof(T) == 1)
+        {
+            return isSigned ? ScalarType::I8 : ScalarType::U8;
+        }
+        else if constexpr (sizeof(T) == 2)
+        {
+            return isSigned ? ScalarType::I16 : ScalarType::U16;
+        }
+        else if constexpr (sizeof(T) == 4)
+        {
+            return isSigned ? ScalarType::I32 : ScalarType::U32;
+        }
+        else
+        {
+            return isSigned ? ScalarType::I64 : ScalarType::U64;
+        }
+    }
+
+    static constexpr size_t scalarWidth(ScalarType type)
+    {
+        switch (type)
+        {
+            case ScalarType::U8:
+            case ScalarType::I8:
+                return 1;
+            case ScalarType::U16:
+            case ScalarType::I16:
+                return 2;
+            case ScalarType::U32:
+            case ScalarType::I32:
+                return 4;
+            default:
+                return 8;
+        }
+    }
+
+    storage::NvsConfig config_;                          ///< NVS configuration
+    mutable std::mutex mutex_;                           ///< Mutex for thread safety
+    bool initialized_;                                   ///< Whether NVS was initialized by this instance
+    size_t batchDepth_;                                  ///< Open beginBatch() calls
+    size_t pendingWrites_;                               ///< Writes since the last successful commit
+    std::chrono::steady_clock::time_point firstPending_; ///< When the oldest pending write was made
+
+    struct CacheEntry
+    {
+        std::string key;
+        bool blob;                  ///< Written or read as binary rather than string
+        std::vector<uint8_t> value; ///< Strings without their terminator
+    };
+
+    std::list<CacheEntry> cache_; ///< Most recently used first
+    std::unordered_map<std::string, std::list<CacheEntry>::iterator> cacheIndex_;
+    NvsCacheStats cacheStats_;
+
+    /**
+     * @brief Count a write and commit if the batch state and policy allow
+     *
+     * Called with mutex_ held after each successful modification.
+     *
+     * @return false only if a commit was due and failed
+     */
+    bool commitIfDue();
+
+    /**
+     * @brief Commit pending writes, with mutex_ held
+     */
+    bool commitLocked();
+
+    /**
+     * @brief Start the autoCommitInterval timer, if any
+     *
+     * Called by the constructors; the timer is armed by commitIfDue() on
+     * the first pending write and stopped by the destructor.
+     */
+    void startCommitTimer();
+
+    /**
+     * @brief Arm the timer for the oldest pending write, with mutex_ held
+     */
+    void armCommitTimer();
+
+    /**
+     * @brief Commit writes left pending for autoCommitInterval, with mutex_ held
+     *
+     * A commit that cannot be made now (batch open, commit failed) is
+     * retried one interval later.
+     */
+    void commitOnTimer();
+
+    /**
+     * @brief Single NVS lookup into buffer, with mutex_ held
+     *
+     * @param key Key to read
+     * @param blob Read as binary (nvs_get_blob) rather than string (nvs_get_str)
+     * @param buffer Destination of length bytes
+     * @param length In: capacity of buffer. Out: bytes read, or bytes needed
+     *               on TOO_SMALL (strings count their terminator)
+     */
+    ReadResult readValue(const std::string &key, bool blob, void *buffer, size_t &length);
+
+    /**
+     * @brief Write an integer as the given NVS entry type
+     *
+     * @param bits The value, converted to uint64_t
+     */
+    bool setScalar(const std::string &key, ScalarType type, uint64_t bits);
+
+    /**
+     * @brief Read an integer stored as the given NVS entry type
+     *
+     * @param bits Set to the value converted to uint64_t; get<T> narrows it back
+     */
+    bool getScalar(const std::string &key, ScalarType type, uint64_t &bits);
+
+    /**
+     * @brief Cached value of key, counting the hit or miss, with mutex_ held
+     *
+     * @return The entry, now most recently used, or nullptr if not cached
+     *         as that type or the cache is off
+     */
+    const CacheEntry *cacheFind(const std::string &key, bool blob);
+
+    /**
+     * @brief Cache a value, evicting the least recently used if full
+     */
+    void cacheStore(const std::string &key, bool blob, const uint8_t *data, size_t size);
+
+    /**
+     * @brief Drop key from the cache
+     */
+    void cacheErase(const std::string &key);
+
+#ifdef ESP_PLATFORM
+    esp_timer_handle_t commitTimer_ = nullptr; ///< One-shot autoCommitInterval timer
+
+    static void commitTimerEntry(void *arg);
+#else
+    std::thread commitThread_;           ///< Host stand-in for the esp_timer
+    std::condition_variable commitWake_; ///< Signals a first pending write or destruction
+    bool stopping_ = false;              ///< Set by the destructor
+
+    void commitWorker();
+#endif
 
 #ifdef ESP_PLATFORM
     nvs_handle_t handle_; ///< NVS handle for operations
 
     /**
-     * @brief Open NVS handle
+     * @brief Open NVS handle, if not already open
+     *
+     * The handle is opened by initialize() and kept until destruction;
+     * later calls only reopen it if that first open failed.
      *
      * @return true if open succeeded, false otherwise
      */
@@ -173,4 +513,45 @@ private:
     bool isValidKey(const std::string &key) const;
 };
 
+/**
+ * @brief Scoped NvsStorage batch: commits once when destroyed
+ *
+ * NVS cannot roll writes back, so leaving the scope early (an error, a
+ * return) still commits what was written so far.
+ */
+class NvsStorage::Batch
+{
+public:
+    explicit Batch(NvsStorage &storage) : storage_(storage), active_(storage.beginBatch())
+    {
+    }
+
+    ~Batch()
+    {
+        commit();
+    }
+
+    Batch(const Batch &) = delete;
+    Batch &operator=(const Batch &) = delete;
+
+    /**
+     * @brief End the batch now instead of at destruction
+     *
+     * @return Result of NvsStorage::commitBatch(); false if already ended
+     */
+    bool commit()
+    {
+        if (!active_)
+        {
+            return false;
+        }
+        active_ = false;
+        return storage_.commitBatch();
+    }
+
+private:
+    NvsStorage &storage_;
+    bool active_; ///< beginBatch() succeeded and commit() not called yet
+};
+
 } // namespace lopcore
@@ -0,0 +1,48 @@
+/**
+ * @file path_lock.hpp
+ * @brief Striped reader/writer locks by file path
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <shared_mutex>
+#include <string>
+
+namespace lopcore
+{
+
+/**
+ * @brief Fixed set of reader/writer locks, one chosen per path by hash
+ *
+ * The file backends lock a file's stripe shared to read it and exclusive
+ * to change it, so reads of any files run concurrently and only changes
+ * to the same file (or, rarely, to two files sharing a stripe) wait for
+ * each other. A fixed number of locks keeps the memory constant however
+ * many files there are.
+ *
+ * Hold at most one stripe at a time: two paths may map to the same one.
+ */
+class PathLocks
+{
+public:
+    static constexpr size_t STRIPES = 8;
+
+    /**
+     * @brief Lock guarding path
+     */
+    std::shared_mutex &forPath(const std::string &path)
+    {
+        return stripes_[std::hash<std::string>{}(path) % STRIPES];
+    }
+
+private:
+    std::array<std::shared_mutex, STRIPES> stripes_;
+};
+
+} // namespace lopcore
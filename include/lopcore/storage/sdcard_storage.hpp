@@ -11,13 +11,19 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <shared_mutex>
 #include <string>
 #include <vector>
 
+#include "path_lock.hpp"
 #include "storage_config.hpp"
+#include "storage_index.hpp"
+#include "storage_stream.hpp"
 #include "storage_type.hpp"
 
 #ifdef ESP_PLATFORM
@@ -96,6 +102,21 @@ public:
      */
     bool write(const std::string &key, const std::vector<uint8_t> &data);
 
+    /**
+     * @brief Replace a file so that a power loss leaves the old or the new content
+     *
+     * One open/fsync/close of a temporary file and a rename; see
+     * writeFileAtomic(). Prefer it over write() for configuration files.
+     *
+     * @param key File path relative to mount point
+     * @param data Content to write
+     * @param keepBackup Keep the previous content as the key's ".bak" file
+     * @return true if the file now holds data, false otherwise
+     */
+    bool writeAtomic(const std::string &key, const std::string &data, bool keepBackup = false);
+    bool writeAtomic(const std::string &key, const std::vector<uint8_t> &data, bool keepBackup = false);
+    bool writeAtomic(const std::string &key, const void *data, size_t dataLen, bool keepBackup = false);
+
     /**
      * @brief Read string data from file
      *
@@ -112,6 +133,54 @@ public:
      */
     std::optional<std::vector<uint8_t>> readBinary(const std::string &key);
 
+    /**
+     * @brief Open a file for chunked reading
+     *
+     * @param key File path relative to mount point
+     * @param bufferSize stdio buffer of the stream
+     * @return The reader, closed if the file could not be opened
+     */
+    StorageReader openReader(const std::string &key, size_t bufferSize = STORAGE_STREAM_BUFFER_SIZE);
+
+    /**
+     * @brief Open a file for chunked writing
+     *
+     * @param key File path relative to mount point
+     * @param append Write after existing content instead of replacing it
+     * @param bufferSize stdio buffer of the stream
+     * @return The writer, closed if the file could not be opened
+     */
+    StorageWriter openWriter(const std::string &key,
+                             bool append = false,
+                             size_t bufferSize = STORAGE_STREAM_BUFFER_SIZE);
+
+    /**
+     * @brief Append data to the end of a file, creating it if needed
+     *
+     * Costs the size of data, not of the file. The config's AppendPolicy
+     * decides whether the file stays open for the next append() and when
+     * it is fsynced; any other operation on the file closes it first.
+     *
+     * For logging, set the policy's write-back chunk to the card's
+     * allocation unit (AppendPolicy::setWriteBack()): the card then only
+     * receives whole, aligned units instead of a read-modify-write of one
+     * per small append.
+     *
+     * @param key File path relative to mount point
+     * @param data Data to append
+     * @return true if all data was written, false otherwise
+     */
+    bool append(const std::string &key, const std::string &data);
+    bool append(const std::string &key, const std::vector<uint8_t> &data);
+    bool append(const std::string &key, const void *data, size_t dataLen);
+
+    /**
+     * @brief fsync every file kept open by append()
+     *
+     * @return false if syncing any of them failed
+     */
+    bool syncAppends();
+
     /**
      * @brief Check if file exists
      *
@@ -139,13 +208,16 @@ public:
     /**
      * @brief Get total storage size in bytes
      *
-     * @return Total size in bytes
+     * @return Size of the FAT data area in bytes
      */
     size_t getTotalSize() const;
 
     /**
      * @brief Get used storage size in bytes
      *
+     * Whole clusters in use, including directories and all subdirectories.
+     * Served from the free-space cache (see setSpaceRefreshInterval()).
+     *
      * @return Used size in bytes
      */
     size_t getUsedSize() const;
@@ -153,10 +225,28 @@ public:
     /**
      * @brief Get free storage size in bytes
      *
+     * Served from the free-space cache (see setSpaceRefreshInterval()), so
+     * it does not wait for a write in progress.
+     *
      * @return Free size in bytes
      */
     size_t getFreeSize() const;
 
+    /**
+     * @brief Check if sufficient space is available
+     *
+     * @param requiredBytes Number of bytes needed
+     * @return true if space available, false otherwise
+     */
+    bool hasSpace(size_t requiredBytes) const;
+
+    /**
+     * @brief Re-read the FAT free-cluster count now
+     *
+     * @return true if the filesystem reported its size
+     */
+    bool refreshSpaceInfo() const;
+
     /**
      * @brief Get storage type
      *
@@ -195,14 +285,35 @@ public:
     bool initialize();
 
 private:
-    storage::SdCardConfig config_; ///< SD card configuration
-    bool initialized_;             ///< Whether SD card was successfully mounted
-    mutable std::mutex mutex_;     ///< Mutex for thread safety
+    storage::SdCardConfig config_;    ///< SD card configuration
+    std::atomic<bool> initialized_;   ///< Whether SD card was successfully mounted
+    mutable std::shared_mutex mutex_; ///< Shared by file operations, exclusive for mount and format
+    mutable PathLocks pathLocks_;     ///< Per file: shared by reads, exclusive by changes
 
 #ifdef ESP_PLATFORM
     sdmmc_card_t *card_; ///< SD card handle
 #endif
 
+    StorageAppender appender_; ///< Files kept open by append()
+    StorageIndex index_;       ///< File metadata, built if config_.indexFiles
+
+    /**
+     * @brief FAT size and free space, refreshed per config_.spaceRefreshInterval
+     *
+     * Has its own lock: FatFs holds its volume lock for the whole of a
+     * write, and space queries must not wait behind one.
+     */
+    struct SpaceCache
+    {
+        uint64_t totalBytes = 0;
+        uint64_t freeBytes = 0;
+        std::chrono::steady_clock::time_point updated;
+        bool valid = false;
+    };
+
+    mutable std::mutex spaceMutex_; ///< Guards space_
+    mutable SpaceCache space_;      ///< Cached FAT figures
+
     /**
      * @brief Get full file path from key
      *
@@ -210,6 +321,26 @@ private:
      * @return Full path (e.g., "/sdcard/config.json")
      */
     std::string getFullPath(const std::string &key) const;
+
+    /**
+     * @brief Build index_ from the mounted directory, if config_.indexFiles
+     */
+    void buildIndex();
+
+    /**
+     * @brief Read FAT total and free bytes into space_; spaceMutex_ must be held
+     */
+    bool readSpaceInfo() const;
+
+    /**
+     * @brief space_, refreshed first if older than the configured interval
+     */
+    SpaceCache currentSpace() const;
+
+    /**
+     * @brief Lower the cached free space by bytes just written
+     */
+    void consumeSpace(size_t bytes);
 };
 
 } // namespace lopcore
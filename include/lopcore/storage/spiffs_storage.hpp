@@ -15,12 +15,17 @@
 
 #pragma once
 
+#include <atomic>
 #include <mutex>
 #include <optional>
+#include <shared_mutex>
 #include <string>
 #include <vector>
 
+#include "path_lock.hpp"
 #include "storage_config.hpp"
+#include "storage_index.hpp"
+#include "storage_stream.hpp"
 #include "storage_type.hpp"
 
 namespace lopcore
@@ -30,7 +35,8 @@ namespace lopcore
  * @brief SPIFFS storage implementation
  *
  * Provides file-based storage using ESP-IDF's SPIFFS (SPI Flash File System).
- * Thread-safe: All operations are protected by mutex.
+ * Thread-safe: reads of any files run concurrently, while changes to a
+ * file wait for that file's readers and other writers (see PathLocks).
  *
  * SPIFFS Characteristics:
  * - Wear leveling built-in
@@ -86,6 +92,49 @@ public:
     size_t getUsedSize() const;
     size_t getFreeSize() const;
 
+    /**
+     * @brief Open a file for chunked reading
+     *
+     * @param key File path relative to base path
+     * @param bufferSize stdio buffer of the stream
+     * @return The reader, closed if the file could not be opened
+     */
+    StorageReader openReader(const std::string &key, size_t bufferSize = STORAGE_STREAM_BUFFER_SIZE);
+
+    /**
+     * @brief Open a file for chunked writing
+     *
+     * @param key File path relative to base path
+     * @param append Write after existing content instead of replacing it
+     * @param bufferSize stdio buffer of the stream
+     * @return The writer, closed if the file could not be opened
+     */
+    StorageWriter openWriter(const std::string &key,
+                             bool append = false,
+                             size_t bufferSize = STORAGE_STREAM_BUFFER_SIZE);
+
+    /**
+     * @brief Append data to the end of a file, creating it if needed
+     *
+     * Costs the size of data, not of the file. The config's AppendPolicy
+     * decides whether the file stays open for the next append() and when
+     * it is fsynced; any other operation on the file closes it first.
+     *
+     * @param key File path relative to base path
+     * @param data Data to append
+     * @return true if all data was written, false otherwise
+     */
+    bool append(const std::string &key, const std::string &data);
+    bool append(const std::string &key, const std::vector<uint8_t> &data);
+    bool append(const std::string &key, const void *data, size_t dataLen);
+
+    /**
+     * @brief fsync every file kept open by append()
+     *
+     * @return false if syncing any of them failed
+     */
+    bool syncAppends();
+
     /**
      * @brief Check if sufficient space is available
      *
@@ -110,6 +159,10 @@ public:
     /**
      * @brief List files matching a wildcard pattern
      *
+     * Supports '*', '?' and character classes; see globMatch(). With the
+     * file index enabled, only names starting with the pattern's literal
+     * prefix are visited.
+     *
      * @param pattern Wildcard pattern (e.g., "acc_raw_*.bin")
      * @return Vector of matching filenames
      */
@@ -165,6 +218,19 @@ public:
      */
     bool check();
 
+    /**
+     * @brief Collect garbage until bytes of erased space are available
+     *
+     * SPIFFS otherwise collects inside write() when it runs out of erased
+     * pages, stalling that write; run this while the device is idle (see
+     * StorageMaintenance). Blocks every other operation while it runs.
+     *
+     * @param bytes Erased space wanted
+     * @return true if that much space is available; false if the
+     *         partition cannot free it (too few deleted pages) or on host
+     */
+    bool collectGarbage(size_t bytes);
+
     /**
      * @brief Get the base path for this storage
      *
@@ -190,9 +256,12 @@ public:
     bool isMounted() const;
 
 private:
-    storage::SpiffsConfig config_; ///< SPIFFS configuration
-    bool initialized_;             ///< Whether SPIFFS was initialized by this instance
-    mutable std::mutex mutex_;     ///< Mutex for thread safety
+    storage::SpiffsConfig config_;    ///< SPIFFS configuration
+    std::atomic<bool> initialized_;   ///< Whether SPIFFS was initialized by this instance
+    mutable std::shared_mutex mutex_; ///< Shared by file operations, exclusive for mount and format
+    mutable PathLocks pathLocks_;     ///< Per file: shared by reads, exclusive by changes
+    StorageAppender appender_;        ///< Files kept open by append()
+    StorageIndex index_;              ///< File metadata, built if config_.indexFiles
 
     /**
      * @brief Get full file path from key
@@ -203,13 +272,19 @@ private:
     std::string getFullPath(const std::string &key) const;
 
     /**
-     * @brief Simple wildcard pattern matching
+     * @brief Build index_ from the mounted directory, if config_.indexFiles
+     */
+    void buildIndex();
+
+    /**
+     * @brief Partition label for the esp_spiffs calls
      *
-     * @param pattern Pattern string with optional '*' wildcard
-     * @param str String to match against pattern
-     * @return true if matches, false otherwise
+     * @return config_.partitionLabel, or nullptr for the first SPIFFS partition
      */
-    static bool patternMatch(const char *pattern, const char *str);
+    const char *partitionLabel() const
+    {
+        return config_.partitionLabel.empty() ? nullptr : config_.partitionLabel.c_str();
+    }
 };
 
 } // namespace lopcore
@@ -0,0 +1,445 @@
+/**
+ * @file storage_adapter.hpp
+ * @brief One storage API over every backend, dispatched at compile time
+ *
+ * The backends share method names but no base class, so generic code
+ * either names one backend or repeats itself. StorageAdapter gives any
+ * backend the full API, resolving optional features through the traits
+ * in storage_traits.hpp; StorageSelector holds one of several adapters
+ * in a std::variant for a backend chosen at boot:
+ *
+ * @code
+ * template <typename Backend>
+ * bool saveLog(Backend &backend, const std::string &line)
+ * {
+ *     StorageAdapter<Backend> storage(backend);
+ *     return storage.append("events.log", line) && storage.syncAppends(); // Native or rewritten
+ * }
+ *
+ * using BootStorage = StorageSelector<SdCardStorage, LittleFsStorage>;
+ * BootStorage storage = card.isMounted() ? BootStorage(card) : BootStorage(flash);
+ * storage.write("state.bin", snapshot);
+ * @endcode
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "storage_stream.hpp"
+#include "storage_traits.hpp"
+#include "storage_type.hpp"
+
+namespace lopcore
+{
+
+/**
+ * @brief Full storage API over one backend, without virtual calls
+ *
+ * Every call is forwarded directly and inlines as if the backend were
+ * used by name. Features a backend lacks fall back as follows:
+ *
+ * - commit(): true, as file writes need no commit
+ * - format(): false
+ * - append(): reads the value and writes it back extended; fine for
+ *   small NVS values, linear in their size
+ * - syncAppends(): commit()
+ * - openReader() / openWriter(): a closed stream
+ * - isMounted(): true
+ *
+ * supportsAppend() and the like tell generic code which path it gets.
+ * The adapter only refers to the backend, which must outlive it; it is
+ * as cheap to copy as a pointer.
+ */
+template <typename Backend>
+class StorageAdapter
+{
+    static_assert(storage::traits::is_storage_backend_v<Backend>,
+                  "StorageAdapter needs write(key, vector), readBinary, exists and remove");
+
+public:
+    explicit StorageAdapter(Backend &backend) : backend_(&backend)
+    {
+    }
+
+    /**
+     * @brief The adapted backend, for backend-specific calls
+     */
+    Backend &backend() const
+    {
+        return *backend_;
+    }
+
+    bool write(const std::string &key, const std::string &data) const
+    {
+        return backend_->write(key, data);
+    }
+
+    bool write(const std::string &key, const std::vector<uint8_t> &data) const
+    {
+        return backend_->write(key, data);
+    }
+
+    std::optional<std::string> read(const std::string &key) const
+    {
+        return backend_->read(key);
+    }
+
+    std::optional<std::vector<uint8_t>> readBinary(const std::string &key) const
+    {
+        return backend_->readBinary(key);
+    }
+
+    bool exists(const std::string &key) const
+    {
+        return backend_->exists(key);
+    }
+
+    bool remove(const std::string &key) const
+    {
+        return backend_->remove(key);
+    }
+
+    std::vector<std::string> listKeys() const
+    {
+        return backend_->listKeys();
+    }
+
+    size_t getTotalSize() const
+    {
+        return backend_->getTotalSize();
+    }
+
+    size_t getUsedSize() const
+    {
+        return backend_->getUsedSize();
+    }
+
+    size_t getFreeSize() const
+    {
+        return backend_->getFreeSize();
+    }
+
+    StorageType getType() const
+    {
+        return backend_->getType();
+    }
+
+    /**
+     * @brief Append to a value, natively if the backend can
+     */
+    bool append(const std::string &key, const void *data, size_t length) const
+    {
+        if constexpr (supportsAppend())
+        {
+            return backend_->append(key, data, length);
+        }
+        else
+        {
+            std::vector<uint8_t> value = backend_->readBinary(key).value_or(std::vector<uint8_t>());
+            const uint8_t *bytes = static_cast<const uint8_t *>(data);
+            value.insert(value.end(), bytes, bytes + length);
+            return backend_->write(key, value);
+        }
+    }
+
+    bool append(const std::string &key, const std::string &data) const
+    {
+        return append(key, data.data(), data.size());
+    }
+
+    bool append(const std::string &key, const std::vector<uint8_t> &data) const
+    {
+        return append(key, data.data(), data.size());
+    }
+
+    /**
+     * @brief Make appended data durable
+     */
+    bool syncAppends() const
+    {
+        if constexpr (supportsAppend())
+        {
+            return backend_->syncAppends();
+        }
+        else
+        {
+            return commit();
+        }
+    }
+
+    /**
+     * @brief Commit pending writes, on backends that defer them
+     */
+    bool commit() const
+    {
+        if constexpr (storage::traits::requires_commit_v<Backend>)
+        {
+            return backend_->commit();
+        }
+        else
+        {
+            return true;
+        }
+    }
+
+    /**
+     * @brief Erase everything, on backends that can
+     *
+     * @return false if the backend cannot format
+     */
+    bool format() const
+    {
+        if constexpr (supportsFormat())
+        {
+            return backend_->format();
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    /**
+     * @brief Open a value for chunked reading
+     *
+     * @return The reader, closed if the backend cannot stream or the value is missing
+     */
+    StorageReader openReader(const std::string &key, size_t bufferSize = STORAGE_STREAM_BUFFER_SIZE) const
+    {
+        if constexpr (supportsStreaming())
+        {
+            return backend_->openReader(key, bufferSize);
+        }
+        else
+        {
+            (void) key;
+            (void) bufferSize;
+            return StorageReader();
+        }
+    }
+
+    /**
+     * @brief Open a value for chunked writing
+     *
+     * @return The writer, closed if the backend cannot stream or on error
+     */
+    StorageWriter openWriter(const std::string &key,
+                             bool append = false,
+                             size_t bufferSize = STORAGE_STREAM_BUFFER_SIZE) const
+    {
+        if constexpr (supportsStreaming())
+        {
+            return backend_->openWriter(key, append, bufferSize);
+        }
+        else
+        {
+            (void) key;
+            (void) append;
+            (void) bufferSize;
+            return StorageWriter();
+        }
+    }
+
+    bool isMounted() const
+    {
+        if constexpr (storage::traits::reports_mounted_v<Backend>)
+        {
+            return backend_->isMounted();
+        }
+        else
+        {
+            return true;
+        }
+    }
+
+    static constexpr bool supportsAppend()
+    {
+        return storage::traits::supports_append_v<Backend>;
+    }
+
+    static constexpr bool supportsStreaming()
+    {
+        return storage::traits::supports_streaming_v<Backend>;
+    }
+
+    static constexpr bool supportsFormat()
+    {
+        return storage::traits::supports_format_v<Backend>;
+    }
+
+private:
+    Backend *backend_;
+};
+
+/**
+ * @brief One of several backends, chosen at runtime, without virtual calls
+ *
+ * Holds a StorageAdapter of one of Backends in a std::variant; each call
+ * is a std::visit, a switch on the held index, after which the backend
+ * call is direct and inlinable. For a backend picked once at boot (SD
+ * card if inserted, else LittleFS), from a config value or by board.
+ *
+ * Backend-specific calls go through get<Backend>().
+ */
+template <typename... Backends>
+class StorageSelector
+{
+public:
+    /**
+     * @brief Select backend, which must be one of Backends and outlive this object
+     */
+    template <typename Backend>
+    explicit StorageSelector(Backend &backend)
+        : adapter_(std::in_place_type<StorageAdapter<Backend>>, backend)
+    {
+    }
+
+    /**
+     * @brief The selected backend, or nullptr if another one is selected
+     */
+    template <typename Backend>
+    Backend *get() const
+    {
+        const auto *adapter = std::get_if<StorageAdapter<Backend>>(&adapter_);
+        return adapter != nullptr ? &adapter->backend() : nullptr;
+    }
+
+    /**
+     * @brief Run f with the selected StorageAdapter
+     *
+     * f is instantiated for every backend, so it may use the full
+     * adapter API, including supportsAppend() and friends with if constexpr.
+     */
+    template <typename Function>
+    decltype(auto) visit(Function &&f) const
+    {
+        return std::visit(std::forward<Function>(f), adapter_);
+    }
+
+    bool write(const std::string &key, const std::string &data) const
+    {
+        return visit([&](const auto &storage) { return storage.write(key, data); });
+    }
+
+    bool write(const std::string &key, const std::vector<uint8_t> &data) const
+    {
+        return visit([&](const auto &storage) { return storage.write(key, data); });
+    }
+
+    std::optional<std::string> read(const std::string &key) const
+    {
+        return visit([&](const auto &storage) { return storage.read(key); });
+    }
+
+    std::optional<std::vector<uint8_t>> readBinary(const std::string &key) const
+    {
+        return visit([&](const auto &storage) { return storage.readBinary(key); });
+    }
+
+    bool exists(const std::string &key) const
+    {
+        return visit([&](const auto &storage) { return storage.exists(key); });
+    }
+
+    bool remove(const std::string &key) const
+    {
+        return visit([&](const auto &storage) { return storage.remove(key); });
+    }
+
+    std::vector<std::string> listKeys() const
+    {
+        return visit([](const auto &storage) { return storage.listKeys(); });
+    }
+
+    size_t getTotalSize() const
+    {
+        return visit([](const auto &storage) { return storage.getTotalSize(); });
+    }
+
+    size_t getUsedSize() const
+    {
+        return visit([](const auto &storage) { return storage.getUsedSize(); });
+    }
+
+    size_t getFreeSize() const
+    {
+        return visit([](const auto &storage) { return storage.getFreeSize(); });
+    }
+
+    StorageType getType() const
+    {
+        return visit([](const auto &storage) { return storage.getType(); });
+    }
+
+    bool append(const std::string &key, const void *data, size_t length) const
+    {
+        return visit([&](const auto &storage) { return storage.append(key, data, length); });
+    }
+
+    bool append(const std::string &key, const std::string &data) const
+    {
+        return append(key, data.data(), data.size());
+    }
+
+    bool append(const std::string &key, const std::vector<uint8_t> &data) const
+    {
+        return append(key, data.data(), data.size());
+    }
+
+    bool syncAppends() const
+    {
+        return visit([](const auto &storage) { return storage.syncAppends(); });
+    }
+
+    bool commit() const
+    {
+        return visit([](const auto &storage) { return storage.commit(); });
+    }
+
+    bool format() const
+    {
+        return visit([](const auto &storage) { return storage.format(); });
+    }
+
+    StorageReader openReader(const std::string &key, size_t bufferSize = STORAGE_STREAM_BUFFER_SIZE) const
+    {
+        return visit([&](const auto &storage) { return storage.openReader(key, bufferSize); });
+    }
+
+    StorageWriter openWriter(const std::string &key,
+                             bool append = false,
+                             size_t bufferSize = STORAGE_STREAM_BUFFER_SIZE) const
+    {
+        return visit([&](const auto &storage) { return storage.openWriter(key, append, bufferSize); });
+    }
+
+    bool isMounted() const
+    {
+        return visit([](const auto &storage) { return storage.isMounted(); });
+    }
+
+    bool supportsAppend() const
+    {
+        return visit([](const auto &storage) { return storage.supportsAppend(); });
+    }
+
+    bool supportsStreaming() const
+    {
+        return visit([](const auto &storage) { return storage.supportsStreaming(); });
+    }
+
+private:
+    std::variant<StorageAdapter<Backends>...> adapter_;
+};
+
+} // namespace lopcore
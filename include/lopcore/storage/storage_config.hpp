@@ -11,14 +11,125 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
+
+#include "lopcore/task/task_profile.hpp"
 
 namespace lopcore
 {
 namespace storage
 {
 
+/**
+ * @brief How the file backends' append() keeps files open and synced
+ *
+ * By default every append() opens the file, writes at its end and closes
+ * it. For frequent small appends (sensor samples) keep the files open:
+ * their data is then only guaranteed on flash after an fsync, done by
+ * syncBytes/syncInterval, syncAppends(), or when the file is closed.
+ *
+ * @code
+ * AppendPolicy policy;
+ * policy.setOpenFiles(2).setSyncBytes(4096).setSyncInterval(std::chrono::seconds(5));
+ * @endcode
+ *
+ * An SD card rewrites a whole allocation unit for a small write, so on
+ * SdCardStorage also coalesce appends into aligned chunks:
+ *
+ * @code
+ * policy.setOpenFiles(1).setWriteBack(16 * 1024, std::chrono::seconds(2));
+ * @endcode
+ */
+struct AppendPolicy
+{
+    size_t openFiles = 0;                        // Files kept open between append() calls (0 = close each call)
+    size_t syncBytes = 0;                        // fsync a kept-open file after this many bytes (0 = off)
+    std::chrono::milliseconds syncInterval{0};   // fsync when the oldest unsynced append is older (0 = off)
+    size_t bufferSize = 1024;                    // stdio buffer of each kept-open file
+    size_t writeBackSize = 0;                    // Aligned chunk appends are coalesced into (0 = off)
+    std::chrono::milliseconds writeBackDelay{0}; // Write out a partial chunk older than this (0 = off)
+
+    /**
+     * @brief Set how many files stay open between append() calls
+     *
+     * The least recently appended file is closed to make room. Kept-open
+     * files count against the filesystem's open file limit.
+     *
+     * @param files Files kept open (0 = open and close on each call)
+     * @return Reference to this policy for chaining
+     */
+    AppendPolicy &setOpenFiles(size_t files)
+    {
+        openFiles = files;
+        return *this;
+    }
+
+    /**
+     * @brief Set how many bytes a kept-open file takes before an fsync
+     *
+     * @param bytes Unsynced bytes that trigger an fsync (0 = off)
+     * @return Reference to this policy for chaining
+     */
+    AppendPolicy &setSyncBytes(size_t bytes)
+    {
+        syncBytes = bytes;
+        return *this;
+    }
+
+    /**
+     * @brief Set how long an append may stay unsynced
+     *
+     * Checked on each append() to that file.
+     *
+     * @param interval Age of the oldest unsynced append that triggers an fsync (0 = off)
+     * @return Reference to this policy for chaining
+     */
+    AppendPolicy &setSyncInterval(std::chrono::milliseconds interval)
+    {
+        syncInterval = interval;
+        return *this;
+    }
+
+    /**
+     * @brief Set the stdio buffer of each kept-open file
+     *
+     * @param size Buffer size in bytes (0 = unbuffered)
+     * @return Reference to this policy for chaining
+     */
+    AppendPolicy &setBufferSize(size_t size)
+    {
+        bufferSize = size;
+        return *this;
+    }
+
+    /**
+     * @brief Coalesce appends to each kept-open file into aligned chunks
+     *
+     * Appends collect in a buffer of chunkSize bytes (DMA-capable memory on
+     * ESP32), written out whenever it reaches the next multiple of
+     * chunkSize in the file, so the filesystem only sees whole, aligned
+     * chunks. A partial chunk is written by syncAppends(), by closing the
+     * file, by syncBytes/syncInterval, or once it is older than maxDelay.
+     * Needs openFiles > 0; the stdio buffer is then not used.
+     *
+     * @param chunkSize Chunk size, a multiple of 512 (e.g., the SD card's
+     *                  allocation unit; 0 = off)
+     * @param maxDelay Age of the oldest buffered byte that triggers a write,
+     *                 checked on each append() to any file (0 = off)
+     * @return Reference to this policy for chaining
+     */
+    AppendPolicy &setWriteBack(size_t chunkSize, std::chrono::milliseconds maxDelay)
+    {
+        writeBackSize = chunkSize;
+        writeBackDelay = maxDelay;
+        return *this;
+    }
+};
+
 /**
  * @brief SPIFFS filesystem configuration
  *
@@ -40,6 +151,8 @@ struct SpiffsConfig
     std::string partitionLabel = "storage";
     size_t maxFiles = 5;
     bool formatIfFailed = false;
+    AppendPolicy append;     // How append() keeps files open and synced
+    bool indexFiles = false; // Keep file metadata in RAM for listing
 
     /**
      * @brief Set SPIFFS mount point path
@@ -88,6 +201,35 @@ struct SpiffsConfig
         formatIfFailed = format;
         return *this;
     }
+
+    /**
+     * @brief Set how append() keeps files open and synced
+     *
+     * @param policy Append policy
+     * @return Reference to this config for chaining
+     */
+    SpiffsConfig &setAppendPolicy(const AppendPolicy &policy)
+    {
+        append = policy;
+        return *this;
+    }
+
+    /**
+     * @brief Keep an in-RAM index of file names, sizes and times
+     *
+     * Built when the storage is initialized and kept current by its own
+     * writes and removals, so listing never scans the directory. Costs
+     * roughly 40 bytes plus the name per file; files changed behind the
+     * storage's back are not seen until the next initialize().
+     *
+     * @param enable True to keep the index
+     * @return Reference to this config for chaining
+     */
+    SpiffsConfig &setIndexFiles(bool enable)
+    {
+        indexFiles = enable;
+        return *this;
+    }
 };
 
 /**
@@ -103,11 +245,23 @@ struct SpiffsConfig
  *
  * NvsStorage storage(config);
  * @endcode
+ *
+ * Writes outside an NvsStorage batch are committed by the auto-commit
+ * policy: by default after every write. Raising autoCommitWrites or
+ * setting autoCommitInterval trades a window of uncommitted writes for
+ * fewer flash commits.
+ *
+ * Keys read often from several tasks can be served from RAM by setting
+ * cacheEntries: the most recently used values are kept decoded, updated
+ * by write() and dropped by remove() and eraseNamespace().
  */
 struct NvsConfig
 {
     std::string namespaceName = "lopcore";
     bool readOnly = false;
+    size_t autoCommitWrites = 1;                     // Commit at this many pending writes (0 = no limit)
+    std::chrono::milliseconds autoCommitInterval{0}; // Commit when a pending write is older (0 = off)
+    size_t cacheEntries = 0;                         // Values kept in the RAM read cache (0 = off)
 
     /**
      * @brief Set NVS namespace
@@ -132,6 +286,52 @@ struct NvsConfig
         readOnly = ro;
         return *this;
     }
+
+    /**
+     * @brief Set how many writes may be pending before they are committed
+     *
+     * @param writes 1 commits every write; 0 leaves it to the interval,
+     *               commit() and the destructor
+     * @return Reference to this config for chaining
+     */
+    NvsConfig &setAutoCommitWrites(size_t writes)
+    {
+        autoCommitWrites = writes;
+        return *this;
+    }
+
+    /**
+     * @brief Set how long a write may stay pending before it is committed
+     *
+     * A timer started by the first pending write commits once it expires,
+     * so a write followed by silence is committed on time. Writes inside
+     * a batch wait for commitBatch(); the timer then retries an interval
+     * later.
+     *
+     * @param interval Age of the oldest pending write that triggers a commit (0 = off)
+     * @return Reference to this config for chaining
+     */
+    NvsConfig &setAutoCommitInterval(std::chrono::milliseconds interval)
+    {
+        autoCommitInterval = interval;
+        return *this;
+    }
+
+    /**
+     * @brief Set how many values the read cache holds
+     *
+     * The least recently used value is dropped when the cache is full.
+     * Only values written or read through this NvsStorage are cached, so
+     * keep it off for namespaces that other handles write to.
+     *
+     * @param entries Cache capacity (0 = no cache)
+     * @return Reference to this config for chaining
+     */
+    NvsConfig &setCacheEntries(size_t entries)
+    {
+        cacheEntries = entries;
+        return *this;
+    }
 };
 
 /**
@@ -183,6 +383,10 @@ struct SdCardConfig
     bool sdmmcEnableInternalPullups = false; // Enable internal pullups (insufficient, use 10k external)
     uint32_t sdmmcFreqKhz = 20000; // Clock frequency in kHz (20000=20MHz default, 40000=40MHz high-speed)
 
+    AppendPolicy append;     // How append() keeps files open and synced
+    bool indexFiles = false; // Keep file metadata in RAM for listing
+    std::chrono::milliseconds spaceRefreshInterval{10000}; // Re-read FAT free space after this long (0 = every query)
+
     /**
      * @brief Set SD card mount point
      *
@@ -336,6 +540,52 @@ struct SdCardConfig
         sdmmcFreqKhz = freqKhz;
         return *this;
     }
+
+    /**
+     * @brief Set how append() keeps files open and synced
+     *
+     * @param policy Append policy
+     * @return Reference to this config for chaining
+     */
+    SdCardConfig &setAppendPolicy(const AppendPolicy &policy)
+    {
+        append = policy;
+        return *this;
+    }
+
+    /**
+     * @brief Keep an in-RAM index of file names, sizes and times
+     *
+     * Built when the storage is initialized and kept current by its own
+     * writes and removals, so listing never scans the directory. Costs
+     * roughly 40 bytes plus the name per file; files changed behind the
+     * storage's back are not seen until the next initialize().
+     *
+     * @param enable True to keep the index
+     * @return Reference to this config for chaining
+     */
+    SdCardConfig &setIndexFiles(bool enable)
+    {
+        indexFiles = enable;
+        return *this;
+    }
+
+    /**
+     * @brief Set how long free-space figures are served from cache
+     *
+     * getFreeSize(), getUsedSize() and hasSpace() read the FAT free-cluster
+     * count at most this often; in between, the cached count is lowered by
+     * the bytes this storage writes (removals are only seen at the next
+     * refresh, so it errs low).
+     *
+     * @param interval Cache lifetime (0 = query FAT on every call)
+     * @return Reference to this config for chaining
+     */
+    SdCardConfig &setSpaceRefreshInterval(std::chrono::milliseconds interval)
+    {
+        spaceRefreshInterval = interval;
+        return *this;
+    }
 };
 
 /**
@@ -359,6 +609,8 @@ struct LittleFsConfig
     std::string partitionLabel = "littlefs";
     bool formatIfFailed = false;
     bool growOnMount = false; // Automatically grow filesystem to partition size
+    AppendPolicy append;      // How append() keeps files open and synced
+    bool indexFiles = false;  // Keep file metadata in RAM for listing
 
     /**
      * @brief Set LittleFS mount point path
@@ -407,6 +659,524 @@ struct LittleFsConfig
         growOnMount = grow;
         return *this;
     }
+
+    /**
+     * @brief Set how append() keeps files open and synced
+     *
+     * @param policy Append policy
+     * @return Reference to this config for chaining
+     */
+    LittleFsConfig &setAppendPolicy(const AppendPolicy &policy)
+    {
+        append = policy;
+        return *this;
+    }
+
+    /**
+     * @brief Keep an in-RAM index of file names, sizes and times
+     *
+     * Built when the storage is initialized and kept current by its own
+     * writes and removals, so listing never scans the directory. Costs
+     * roughly 40 bytes plus the name per file; files changed behind the
+     * storage's back are not seen until the next initialize().
+     *
+     * @param enable True to keep the index
+     * @return Reference to this config for chaining
+     */
+    LittleFsConfig &setIndexFiles(bool enable)
+    {
+        indexFiles = enable;
+        return *this;
+    }
+};
+
+/**
+ * @brief AsyncStorage queue and worker task configuration
+ *
+ * @code
+ * AsyncStorageConfig config;
+ * config.setQueueDepth(32).setPriority(3).setCoreId(0);
+ * @endcode
+ */
+struct AsyncStorageConfig
+{
+    size_t queueDepth = 16;        // Operations waiting for the worker (coalesced writes count once)
+    uint32_t enqueueTimeoutMs = 0; // Wait for queue space before an operation is rejected (0 = never wait)
+
+    // Worker task placement; defaults from the task profile
+    uint32_t stackSize = task::getSettings(task::TaskRole::STORAGE_IO).stackSize; // Stack size in bytes
+    uint32_t priority = task::getSettings(task::TaskRole::STORAGE_IO).priority;   // Priority
+    int coreId = task::getSettings(task::TaskRole::STORAGE_IO).coreId;            // Core (-1 = any)
+
+    /**
+     * @brief Set how many operations may wait for the worker
+     *
+     * @param depth Queue depth
+     * @return Reference to this config for chaining
+     */
+    AsyncStorageConfig &setQueueDepth(size_t depth)
+    {
+        queueDepth = depth;
+        return *this;
+    }
+
+    /**
+     * @brief Set how long a full queue may block the caller
+     *
+     * @param timeoutMs Wait before rejecting (0 = reject at once)
+     * @return Reference to this config for chaining
+     */
+    AsyncStorageConfig &setEnqueueTimeoutMs(uint32_t timeoutMs)
+    {
+        enqueueTimeoutMs = timeoutMs;
+        return *this;
+    }
+
+    /**
+     * @brief Set the worker task stack size
+     *
+     * @param bytes Stack size in bytes
+     * @return Reference to this config for chaining
+     */
+    AsyncStorageConfig &setStackSize(uint32_t bytes)
+    {
+        stackSize = bytes;
+        return *this;
+    }
+
+    /**
+     * @brief Set the worker task priority
+     *
+     * Below the control loop, so flash stalls only delay the worker.
+     *
+     * @param taskPriority FreeRTOS priority
+     * @return Reference to this config for chaining
+     */
+    AsyncStorageConfig &setPriority(uint32_t taskPriority)
+    {
+        priority = taskPriority;
+        return *this;
+    }
+
+    /**
+     * @brief Pin the worker task to a core
+     *
+     * @param core Core number, or -1 for no affinity
+     * @return Reference to this config for chaining
+     */
+    AsyncStorageConfig &setCoreId(int core)
+    {
+        coreId = core;
+        return *this;
+    }
+};
+
+/**
+ * @brief How TimeSeriesStore writes record timestamps
+ */
+enum class TimeSeriesEncoding
+{
+    FIXED, // 8-byte timestamp per record; records have a constant size
+    DELTA  // Varint difference to the previous record; usually 1-2 bytes
+};
+
+/**
+ * @brief TimeSeriesStore segment layout and retention
+ *
+ * Timestamps are int64 in whatever unit the application uses (ms, us
+ * since boot or epoch); retention is in the same unit.
+ *
+ * @code
+ * TimeSeriesConfig config;
+ * config.setDirectory("/littlefs/imu")
+ *       .setRecordSize(sizeof(ImuSample))
+ *       .setSegmentBytes(128 * 1024)
+ *       .setRetention(24LL * 3600 * 1000); // One day of ms timestamps
+ * @endcode
+ */
+struct TimeSeriesConfig
+{
+    std::string directory;                                 // Segment directory (full path)
+    size_t recordSize = 0;                                 // Payload bytes per record
+    TimeSeriesEncoding encoding = TimeSeriesEncoding::DELTA;
+    size_t segmentBytes = 64 * 1024;                       // Start a new segment file beyond this size
+    size_t indexInterval = 64;                             // Records between sparse index points
+    int64_t retention = 0;                                 // Drop segments older than newest - retention (0 = keep)
+    size_t maxSegments = 0;                                // Drop the oldest segments beyond this count (0 = no limit)
+    size_t bufferSize = 1024;                              // stdio buffer of the segment being written
+    size_t syncBytes = 0;                                  // fsync after this many unsynced bytes (0 = on sync() and roll)
+
+    /**
+     * @brief Set the directory holding the segment files
+     *
+     * @param path Full path (e.g., "/littlefs/imu"); created by open()
+     * @return Reference to this config for chaining
+     */
+    TimeSeriesConfig &setDirectory(const std::string &path)
+    {
+        directory = path;
+        return *this;
+    }
+
+    /**
+     * @brief Set the payload size of every record
+     *
+     * @param bytes Payload bytes, excluding the timestamp
+     * @return Reference to this config for chaining
+     */
+    TimeSeriesConfig &setRecordSize(size_t bytes)
+    {
+        recordSize = bytes;
+        return *this;
+    }
+
+    /**
+     * @brief Set how timestamps are encoded
+     *
+     * Must match the encoding the existing segments were written with.
+     *
+     * @param timestampEncoding FIXED or DELTA
+     * @return Reference to this config for chaining
+     */
+    TimeSeriesConfig &setEncoding(TimeSeriesEncoding timestampEncoding)
+    {
+        encoding = timestampEncoding;
+        return *this;
+    }
+
+    /**
+     * @brief Set the size at which a new segment file is started
+     *
+     * Retention deletes whole segments, so this is its granularity.
+     *
+     * @param bytes Segment size limit
+     * @return Reference to this config for chaining
+     */
+    TimeSeriesConfig &setSegmentBytes(size_t bytes)
+    {
+        segmentBytes = bytes;
+        return *this;
+    }
+
+    /**
+     * @brief Set how many records lie between sparse index points
+     *
+     * A range query reads at most this many records before its start.
+     *
+     * @param records Records per index point
+     * @return Reference to this config for chaining
+     */
+    TimeSeriesConfig &setIndexInterval(size_t records)
+    {
+        indexInterval = records;
+        return *this;
+    }
+
+    /**
+     * @brief Set how much history to keep
+     *
+     * @param span Segments whose newest record is older than the newest
+     *             appended timestamp minus span are deleted (0 = keep all)
+     * @return Reference to this config for chaining
+     */
+    TimeSeriesConfig &setRetention(int64_t span)
+    {
+        retention = span;
+        return *this;
+    }
+
+    /**
+     * @brief Set how many segment files to keep at most
+     *
+     * @param segments Segment limit (0 = no limit)
+     * @return Reference to this config for chaining
+     */
+    TimeSeriesConfig &setMaxSegments(size_t segments)
+    {
+        maxSegments = segments;
+        return *this;
+    }
+
+    /**
+     * @brief Set the stdio buffer of the segment being written
+     *
+     * @param size Buffer size in bytes (0 = unbuffered)
+     * @return Reference to this config for chaining
+     */
+    TimeSeriesConfig &setBufferSize(size_t size)
+    {
+        bufferSize = size;
+        return *this;
+    }
+
+    /**
+     * @brief Set how many bytes may be appended before an fsync
+     *
+     * @param bytes Unsynced bytes that trigger an fsync (0 = only on sync() and segment roll)
+     * @return Reference to this config for chaining
+     */
+    TimeSeriesConfig &setSyncBytes(size_t bytes)
+    {
+        syncBytes = bytes;
+        return *this;
+    }
+};
+
+/**
+ * @brief TieredStorage placement and migration thresholds
+ *
+ * Heat is a key's reads and writes since the last rebalance(), plus half
+ * its heat before that, so it follows recent access frequency.
+ *
+ * @code
+ * TieredStorageConfig config;
+ * config.setHotMaxSize(128)
+ *       .setHotCapacity(2048)
+ *       .setPromoteHeat(8)
+ *       .setDemoteAfter(6);
+ * @endcode
+ */
+struct TieredStorageConfig
+{
+    size_t hotMaxSize = 256;         // Largest value the hot tier (NVS) may hold
+    size_t warmMaxSize = 16 * 1024;  // Larger values are written to the cold tier when it is available
+    size_t hotCapacity = 4096;       // Bytes of values kept in the hot tier
+    uint32_t promoteHeat = 4;        // Heat at which rebalance() moves a key one tier up
+    uint32_t demoteAfter = 4;        // Idle rebalance() passes after which a key moves one tier down
+    size_t maxKeys = 128;            // Keys whose placement and heat are tracked
+
+    /**
+     * @brief Set the largest value the hot tier may hold
+     *
+     * @param bytes Value size limit (NVS blobs above ~4 KB do not fit)
+     * @return Reference to this config for chaining
+     */
+    TieredStorageConfig &setHotMaxSize(size_t bytes)
+    {
+        hotMaxSize = bytes;
+        return *this;
+    }
+
+    /**
+     * @brief Set the size above which values go to the cold tier
+     *
+     * @param bytes Value size limit of the warm tier; larger values fall
+     *              back to it only while the cold tier is unavailable
+     * @return Reference to this config for chaining
+     */
+    TieredStorageConfig &setWarmMaxSize(size_t bytes)
+    {
+        warmMaxSize = bytes;
+        return *this;
+    }
+
+    /**
+     * @brief Set how many bytes of values the hot tier keeps
+     *
+     * A promotion that would exceed this first demotes colder hot keys.
+     *
+     * @param bytes Hot working set size
+     * @return Reference to this config for chaining
+     */
+    TieredStorageConfig &setHotCapacity(size_t bytes)
+    {
+        hotCapacity = bytes;
+        return *this;
+    }
+
+    /**
+     * @brief Set the heat at which a key is promoted
+     *
+     * @param heat Accesses (decayed) that earn a faster tier
+     * @return Reference to this config for chaining
+     */
+    TieredStorageConfig &setPromoteHeat(uint32_t heat)
+    {
+        promoteHeat = heat;
+        return *this;
+    }
+
+    /**
+     * @brief Set how long a key may go unused before it is demoted
+     *
+     * @param passes rebalance() calls without an access (0 = never demote)
+     * @return Reference to this config for chaining
+     */
+    TieredStorageConfig &setDemoteAfter(uint32_t passes)
+    {
+        demoteAfter = passes;
+        return *this;
+    }
+
+    /**
+     * @brief Set how many keys are tracked
+     *
+     * Beyond this the coldest key is forgotten; its data stays where it
+     * is and is found again by probing the tiers on its next access.
+     *
+     * @param keys Tracked key limit
+     * @return Reference to this config for chaining
+     */
+    TieredStorageConfig &setMaxKeys(size_t keys)
+    {
+        maxKeys = keys;
+        return *this;
+    }
+};
+
+/**
+ * @brief CompressedStorage key selection
+ *
+ * @code
+ * CompressedStorageConfig config;
+ * config.addSuffix(".json").addSuffix(".log").setMinSize(128);
+ * @endcode
+ */
+struct CompressedStorageConfig
+{
+    std::vector<std::string> suffixes; // Keys compressed, by ending (empty = every key)
+    size_t minSize = 64;               // Smaller values written with write() are stored as they are
+
+    /**
+     * @brief Compress keys ending in suffix
+     *
+     * Call once per suffix. Keys matching none are stored as they are.
+     *
+     * @param suffix Key ending, e.g. ".json"
+     * @return Reference to this config for chaining
+     */
+    CompressedStorageConfig &addSuffix(const std::string &suffix)
+    {
+        suffixes.push_back(suffix);
+        return *this;
+    }
+
+    /**
+     * @brief Set the size below which write() does not compress
+     *
+     * The header and the codec's flag bytes outweigh any gain on tiny
+     * values. Streams are always compressed.
+     *
+     * @param bytes Smallest value worth compressing
+     * @return Reference to this config for chaining
+     */
+    CompressedStorageConfig &setMinSize(size_t bytes)
+    {
+        minSize = bytes;
+        return *this;
+    }
+};
+
+/**
+ * @brief StorageMaintenance schedule and worker task
+ *
+ * @code
+ * StorageMaintenanceConfig config;
+ * config.setGcInterval(std::chrono::minutes(1)).setGcReserveBytes(32 * 1024);
+ * @endcode
+ */
+struct StorageMaintenanceConfig
+{
+    std::chrono::milliseconds gcInterval{60000};      // Between garbage collections of one backend (0 = off)
+    size_t gcReserveBytes = 16 * 1024;                // Erased space garbage collection keeps ready for writes
+    std::chrono::milliseconds checkInterval{3600000}; // Between integrity checks of one backend (0 = off)
+    std::chrono::milliseconds syncInterval{5000};     // Between syncs of appends and NVS commits (0 = off)
+
+    // Worker task placement; defaults from the task profile
+    uint32_t stackSize = task::getSettings(task::TaskRole::STORAGE_MAINT).stackSize; // Stack size in bytes
+    uint32_t priority = task::getSettings(task::TaskRole::STORAGE_MAINT).priority;   // Priority
+    int coreId = task::getSettings(task::TaskRole::STORAGE_MAINT).coreId;            // Core (-1 = any)
+
+    /**
+     * @brief Set how often each backend collects garbage while idle
+     *
+     * @param interval Minimum time between collections (0 = never)
+     * @return Reference to this config for chaining
+     */
+    StorageMaintenanceConfig &setGcInterval(std::chrono::milliseconds interval)
+    {
+        gcInterval = interval;
+        return *this;
+    }
+
+    /**
+     * @brief Set the erased space garbage collection aims for
+     *
+     * Writes up to this size between idle periods then find erased pages
+     * and do not collect garbage themselves.
+     *
+     * @param bytes Space to keep erased
+     * @return Reference to this config for chaining
+     */
+    StorageMaintenanceConfig &setGcReserveBytes(size_t bytes)
+    {
+        gcReserveBytes = bytes;
+        return *this;
+    }
+
+    /**
+     * @brief Set how often each backend checks its file system while idle
+     *
+     * A check reads the whole partition and takes seconds on a large one.
+     *
+     * @param interval Minimum time between checks (0 = never)
+     * @return Reference to this config for chaining
+     */
+    StorageMaintenanceConfig &setCheckInterval(std::chrono::milliseconds interval)
+    {
+        checkInterval = interval;
+        return *this;
+    }
+
+    /**
+     * @brief Set how often buffered appends are synced and NVS committed while idle
+     *
+     * @param interval Minimum time between syncs (0 = never)
+     * @return Reference to this config for chaining
+     */
+    StorageMaintenanceConfig &setSyncInterval(std::chrono::milliseconds interval)
+    {
+        syncInterval = interval;
+        return *this;
+    }
+
+    /**
+     * @brief Set the worker task stack size
+     *
+     * @param bytes Stack size in bytes
+     * @return Reference to this config for chaining
+     */
+    StorageMaintenanceConfig &setStackSize(uint32_t bytes)
+    {
+        stackSize = bytes;
+        return *this;
+    }
+
+    /**
+     * @brief Set the worker task priority
+     *
+     * Maintenance runs only while idle, so the lowest useful priority.
+     *
+     * @param taskPriority FreeRTOS priority
+     * @return Reference to this config for chaining
+     */
+    StorageMaintenanceConfig &setPriority(uint32_t taskPriority)
+    {
+        priority = taskPriority;
+        return *this;
+    }
+
+    /**
+     * @brief Pin the worker task to a core
+     *
+     * @param core Core number, or -1 for no affinity
+     * @return Reference to this config for chaining
+     */
+    StorageMaintenanceConfig &setCoreId(int core)
+    {
+        coreId = core;
+        return *this;
+    }
 };
 
 } // namespace storage
@@ -0,0 +1,166 @@
+/**
+ * @file storage_index.hpp
+ * @brief In-RAM file metadata index for the file-based storage backends
+ *
+ * Listing a directory costs a readdir plus a stat per entry, which on a
+ * flat SPIFFS partition with hundreds of files takes hundreds of ms. With
+ * the index enabled (setIndexFiles() on the backend config), the backend
+ * scans once at mount and then keeps names, sizes and modification times
+ * current from its own writes and removals, so listKeys(), listDetailed()
+ * and the pattern queries never touch flash.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <atomic>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace lopcore
+{
+
+/**
+ * @brief Match a file name against a shell-style wildcard pattern
+ *
+ * Supports '*' (any run of characters), '?' (any one character) and
+ * classes such as "[abc]", "[0-9]" and "[!.]". A '[' without a closing
+ * ']' matches itself. Iterative, so the time is at most proportional to
+ * the pattern length times the name length however many '*' it has.
+ *
+ * @param pattern Wildcard pattern (e.g., "log_2026-0[1-3]-??.txt")
+ * @param str Name to match
+ * @return true if the whole name matches
+ */
+bool globMatch(const char *pattern, const char *str);
+
+/**
+ * @brief Literal characters a pattern's matches must start with
+ *
+ * @return pattern up to its first '*', '?' or '['
+ */
+std::string globPrefix(const std::string &pattern);
+
+/**
+ * @brief File and directory metadata under one root, by relative path
+ *
+ * Paths given to the index are full paths under the root it was built
+ * for. Only changes made through the owning backend are seen: files
+ * written behind its back (another storage instance, raw stdio) appear
+ * after the next build().
+ *
+ * Thread-safe, so backends can update it from operations on different
+ * files running concurrently.
+ */
+class StorageIndex
+{
+public:
+    struct Entry
+    {
+        std::string name;  ///< Name within its directory
+        size_t size;       ///< Bytes (0 for directories)
+        std::time_t mtime; ///< Last modification
+        bool isDirectory;
+    };
+
+    /**
+     * @brief Scan root recursively, replacing any previous content
+     *
+     * @return false if root cannot be read; the index is then not built
+     */
+    bool build(const std::string &root);
+
+    /**
+     * @brief Forget everything; queries must scan again
+     */
+    void reset();
+
+    /**
+     * @brief Whether build() succeeded and the index answers queries
+     */
+    bool isBuilt() const
+    {
+        return built_.load();
+    }
+
+    /**
+     * @brief Record a file written with size bytes, now
+     */
+    void update(const std::string &path, size_t size);
+
+    /**
+     * @brief Record size bytes appended to a file, now
+     */
+    void grow(const std::string &path, size_t size);
+
+    /**
+     * @brief Record a file written by other means; it is stat'ed when next listed
+     */
+    void invalidate(const std::string &path);
+
+    /**
+     * @brief Record a file or directory (and everything under it) removed
+     */
+    void erase(const std::string &path);
+
+    /**
+     * @brief Record a rename
+     */
+    void rename(const std::string &from, const std::string &to);
+
+    /**
+     * @brief Entries directly in directory (relative to root, "" for root), by name
+     */
+    std::vector<Entry> list(const std::string &directory);
+
+    /**
+     * @brief Entries directly in directory whose names match a globMatch() pattern
+     *
+     * Only names starting with the pattern's literal prefix are visited, so
+     * "log_2026*" is a range scan rather than a pass over the directory.
+     */
+    std::vector<Entry> match(const std::string &directory, const std::string &pattern);
+
+    /**
+     * @brief Sum of all file sizes
+     */
+    size_t totalSize() const;
+
+private:
+    struct Meta
+    {
+        size_t size;
+        std::time_t mtime;
+        bool isDirectory;
+        bool stale; ///< Written by other means, size and mtime unknown
+    };
+
+    mutable std::mutex mutex_;            ///< Guards the fields below
+    std::string root_;
+    std::map<std::string, Meta> entries_; ///< By path relative to root_
+    std::atomic<bool> built_{false};
+
+    /**
+     * @brief Path relative to root_, or empty if path is not under it
+     */
+    std::string relative(const std::string &path) const;
+
+    /**
+     * @brief Record the directories containing relative path rel
+     */
+    void addParents(const std::string &rel);
+
+    /**
+     * @brief Entries directly in directory starting with namePrefix, optionally filtered by pattern
+     */
+    std::vector<Entry> collect(const std::string &directory, const std::string &namePrefix, const char *pattern);
+
+    void scan(const std::string &dir, const std::string &prefix);
+};
+
+} // namespace lopcore
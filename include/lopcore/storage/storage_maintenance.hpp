@@ -0,0 +1,251 @@
+/**
+ * @file storage_maintenance.hpp
+ * @brief File system upkeep run while the application declares itself idle
+ *
+ * SPIFFS collects garbage inside write() when it runs out of erased
+ * pages, stalling that write for hundreds of milliseconds, and a check or
+ * a pile of buffered appends costs the same at whatever moment it lands.
+ * StorageMaintenance runs that work on a low-priority task, but only
+ * while the application says it is idle (radio off, a quiet state), so
+ * foreground writes find erased space ready:
+ *
+ * @code
+ * StorageMaintenance maintenance(storage::StorageMaintenanceConfig().setGcReserveBytes(32 * 1024));
+ * maintenance.watch(spiffs, "spiffs");   // GC, check, append sync
+ * maintenance.watch(nvs, "nvs");         // Commit
+ * maintenance.idleWhile(machine, {AppState::SLEEP, AppState::RADIO_OFF});
+ * maintenance.start();
+ * @endcode
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef ESP_PLATFORM
+#include <condition_variable>
+#include <thread>
+#endif
+
+#include "storage_config.hpp"
+#include "storage_traits.hpp"
+
+namespace lopcore
+{
+
+/**
+ * @brief Kind of maintenance a task does
+ */
+enum class MaintenanceTask
+{
+    GC,    ///< Garbage collection, so writes find erased space
+    CHECK, ///< File system integrity check
+    SYNC   ///< Sync buffered appends or commit pending NVS writes
+};
+
+/**
+ * @brief StorageMaintenance counters
+ */
+struct StorageMaintenanceStats
+{
+    uint32_t gcRuns{0};        ///< Garbage collections run
+    uint32_t checks{0};        ///< Integrity checks run
+    uint32_t syncs{0};         ///< Syncs and commits run
+    uint32_t failed{0};        ///< Tasks that reported failure (a check that found damage, GC short of space)
+    uint32_t longestTaskMs{0}; ///< Longest single task, the worst stall it could have caused in write()
+};
+
+/**
+ * @brief Scheduler of periodic storage upkeep for idle periods
+ *
+ * Each task has an interval and runs at most once per interval, the most
+ * overdue first, and only while idle: from the worker task after
+ * setIdle(true), or from the caller's task in runDue(). A task already
+ * running when idle ends is not interrupted; bound GC with
+ * gcReserveBytes. Tasks are first due as soon as they are added.
+ *
+ * Backends are thread-safe, so foreground operations may run meanwhile;
+ * they wait for the backend's lock while a task holds it.
+ */
+class StorageMaintenance
+{
+public:
+    using TaskFunction = std::function<bool()>;
+
+    explicit StorageMaintenance(const storage::StorageMaintenanceConfig &config);
+
+    /**
+     * @brief Stops the worker (see stop())
+     */
+    ~StorageMaintenance();
+
+    StorageMaintenance(const StorageMaintenance &) = delete;
+    StorageMaintenance &operator=(const StorageMaintenance &) = delete;
+
+    /**
+     * @brief Add the maintenance a backend supports
+     *
+     * - collectGarbage(size_t): GC every gcInterval, for gcReserveBytes
+     * - check(): integrity check every checkInterval
+     * - syncAppends(), or else commit(): sync every syncInterval
+     *
+     * @param storage Backend, which must outlive this object
+     * @param name Prefix of the task names, for logs
+     */
+    template <typename Storage>
+    void watch(Storage &storage, const std::string &name)
+    {
+        if constexpr (storage::traits::supports_gc_v<Storage>)
+        {
+            size_t reserve = config_.gcReserveBytes;
+            addTask(name + " gc", MaintenanceTask::GC,
+                    [&storage, reserve] { return storage.collectGarbage(reserve); }, config_.gcInterval);
+        }
+        if constexpr (storage::traits::supports_check_v<Storage>)
+        {
+            addTask(name + " check", MaintenanceTask::CHECK, [&storage] { return storage.check(); },
+                    config_.checkInterval);
+        }
+        if constexpr (storage::traits::supports_append_v<Storage>)
+        {
+            addTask(name + " sync", MaintenanceTask::SYNC, [&storage] { return storage.syncAppends(); },
+                    config_.syncInterval);
+        }
+        else if constexpr (storage::traits::requires_commit_v<Storage>)
+        {
+            addTask(name + " commit", MaintenanceTask::SYNC, [&storage] { return storage.commit(); },
+                    config_.syncInterval);
+        }
+    }
+
+    /**
+     * @brief Add a task of any kind
+     *
+     * @param interval Minimum time between runs; 0 does not add the task
+     */
+    void addTask(const std::string &name, MaintenanceTask kind, TaskFunction task,
+                 std::chrono::milliseconds interval);
+
+    /**
+     * @brief Create the worker task
+     *
+     * @return false if already running or the task cannot be created
+     */
+    bool start();
+
+    /**
+     * @brief Stop the worker after the task it is running, if any
+     */
+    void stop();
+
+    bool isRunning() const
+    {
+        return running_.load();
+    }
+
+    /**
+     * @brief Declare whether the application is idle
+     *
+     * The worker runs due tasks only while idle, and starts no new task
+     * once idle is cleared.
+     */
+    void setIdle(bool idle);
+
+    bool isIdle() const
+    {
+        return idle_.load();
+    }
+
+    /**
+     * @brief Be idle exactly while machine is in one of states
+     *
+     * Adds an observer to machine, a StateMachine or anything with
+     * getCurrentState() and addObserver(void(State from, State to)).
+     */
+    template <typename Machine, typename State>
+    void idleWhile(Machine &machine, std::initializer_list<State> states)
+    {
+        std::vector<State> idleStates(states);
+        auto isIdleState = [idleStates](State state) {
+            return std::find(idleStates.begin(), idleStates.end(), state) != idleStates.end();
+        };
+        setIdle(isIdleState(machine.getCurrentState()));
+        machine.addObserver([this, isIdleState](State, State to) { setIdle(isIdleState(to)); });
+    }
+
+    /**
+     * @brief Run due tasks on the caller's task, for an idle window it knows
+     *
+     * Ignores the idle flag. Starts tasks until none is due or budget has
+     * passed; the last task may run past it.
+     *
+     * @return Tasks run
+     */
+    size_t runDue(std::chrono::milliseconds budget);
+
+    /**
+     * @brief Tasks due now
+     */
+    size_t due() const;
+
+    StorageMaintenanceStats getStats() const;
+
+private:
+    struct Task
+    {
+        std::string name;
+        MaintenanceTask kind;
+        TaskFunction run;
+        int64_t intervalMs;
+        int64_t dueMs;        ///< Time it is next due
+        bool running = false; ///< Picked by the worker or runDue()
+    };
+
+    /**
+     * @brief Run the most overdue task, if any is due
+     */
+    bool runNext();
+
+    /**
+     * @brief Milliseconds until the next task is due, -1 if there are none
+     */
+    int64_t untilDue() const;
+
+    static int64_t nowMs();
+    static void workerEntry(void *arg);
+    void run();
+    void sleep(int64_t timeoutMs);
+    void wakeWorker();
+
+    const storage::StorageMaintenanceConfig config_;
+
+    mutable std::mutex mutex_;     ///< Guards the fields below
+    std::list<Task> tasks_;        ///< Stable addresses while a task runs unlocked
+    StorageMaintenanceStats stats_;
+
+    std::atomic<bool> running_{false};
+    std::atomic<bool> idle_{false};
+
+#ifdef ESP_PLATFORM
+    void *task_ = nullptr;            ///< TaskHandle_t of the worker
+    std::atomic<bool> stopped_{true}; ///< Set by the worker on exit
+#else
+    std::thread thread_;           ///< Host worker thread
+    std::condition_variable wake_; ///< Signals idle, a new task or stop
+    bool woken_ = false;           ///< A wake the worker has not seen yet
+#endif
+};
+
+} // namespace lopcore
@@ -0,0 +1,376 @@
+/**
+ * @file storage_stream.hpp
+ * @brief Chunked file streams for the file-based storage backends
+ *
+ * read()/readBinary() and write() on SpiffsStorage, LittleFsStorage and
+ * SdCardStorage move a whole file through one heap buffer. Recordings and
+ * firmware images of several megabytes should be streamed instead, and
+ * logs grown with the backends' append() (see StorageAppender):
+ *
+ * @code
+ * StorageReader reader = storage.openReader("firmware.bin");
+ * uint8_t chunk[512];
+ * while (size_t n = reader.read(chunk, sizeof(chunk))) {
+ *     ota.write(chunk, n);
+ * }
+ * @endcode
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "storage_config.hpp"
+
+namespace lopcore
+{
+
+/// Default stdio buffer of a stream, a multiple of flash pages and SD sectors
+static constexpr size_t STORAGE_STREAM_BUFFER_SIZE = 4096;
+
+/**
+ * @brief Read-only file stream, closed when destroyed
+ *
+ * Obtained from a file backend's openReader(). A default-constructed or
+ * moved-from reader is closed. Not thread-safe: use one reader per task.
+ */
+class StorageReader
+{
+public:
+    StorageReader() = default;
+
+    /**
+     * @brief Open a file for reading
+     *
+     * @param path Full path of the file
+     * @param bufferSize stdio buffer size (0 = unbuffered)
+     */
+    StorageReader(const std::string &path, size_t bufferSize);
+
+    ~StorageReader();
+
+    StorageReader(StorageReader &&other) noexcept;
+    StorageReader &operator=(StorageReader &&other) noexcept;
+    StorageReader(const StorageReader &) = delete;
+    StorageReader &operator=(const StorageReader &) = delete;
+
+    /**
+     * @brief Whether the file was opened and is not closed yet
+     */
+    bool isOpen() const
+    {
+        return file_ != nullptr;
+    }
+
+    explicit operator bool() const
+    {
+        return isOpen();
+    }
+
+    /**
+     * @brief Read up to length bytes
+     *
+     * @return Bytes read; less than length only at end of file or on error
+     */
+    size_t read(uint8_t *buffer, size_t length);
+
+    /**
+     * @brief Move to an absolute offset
+     *
+     * @return true if the position changed, false if closed or out of range
+     */
+    bool seek(size_t offset);
+
+    /**
+     * @brief Current offset
+     */
+    size_t tell() const;
+
+    /**
+     * @brief File size when it was opened
+     */
+    size_t size() const
+    {
+        return size_;
+    }
+
+    /**
+     * @brief Whether the last read() stopped at end of file
+     */
+    bool eof() const;
+
+    /**
+     * @brief Close the file early
+     */
+    void close();
+
+private:
+    FILE *file_ = nullptr;
+    size_t size_ = 0;
+};
+
+/**
+ * @brief Write-only file stream, flushed and closed when destroyed
+ *
+ * Obtained from a file backend's openWriter(). Call close() to learn
+ * whether the final flush succeeded; the destructor cannot report it.
+ * Not thread-safe: use one writer per task.
+ */
+class StorageWriter
+{
+public:
+    StorageWriter() = default;
+
+    /**
+     * @brief Open a file for writing
+     *
+     * @param path Full path of the file
+     * @param append Keep existing content and write after it, instead of truncating
+     * @param bufferSize stdio buffer size (0 = unbuffered)
+     */
+    StorageWriter(const std::string &path, bool append, size_t bufferSize);
+
+    ~StorageWriter();
+
+    StorageWriter(StorageWriter &&other) noexcept;
+    StorageWriter &operator=(StorageWriter &&other) noexcept;
+    StorageWriter(const StorageWriter &) = delete;
+    StorageWriter &operator=(const StorageWriter &) = delete;
+
+    /**
+     * @brief Whether the file was opened and is not closed yet
+     */
+    bool isOpen() const
+    {
+        return file_ != nullptr;
+    }
+
+    explicit operator bool() const
+    {
+        return isOpen();
+    }
+
+    /**
+     * @brief Write length bytes
+     *
+     * @return true if all bytes were accepted, false if closed or on error
+     */
+    bool write(const uint8_t *data, size_t length);
+
+    bool write(const std::string &data)
+    {
+        return write(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+    }
+
+    /**
+     * @brief Move to an absolute offset, flushing buffered data first
+     *
+     * Ignored by appending writers, which always write at the end.
+     *
+     * @return true if the position changed, false if closed or on error
+     */
+    bool seek(size_t offset);
+
+    /**
+     * @brief Current offset
+     */
+    size_t tell() const;
+
+    /**
+     * @brief Push buffered data to the filesystem
+     */
+    bool flush();
+
+    /**
+     * @brief Flush and fsync, so the data survives a power loss
+     */
+    bool sync();
+
+    /**
+     * @brief Flush and close
+     *
+     * @return false if a write or the final flush failed
+     */
+    bool close();
+
+private:
+    FILE *file_ = nullptr;
+    bool failed_ = false; ///< A write failed; reported by close()
+};
+
+/**
+ * @brief Replace a file so that a power loss leaves the old or the new content
+ *
+ * Writes data to path + ".tmp" in one open/fsync/close cycle, then renames
+ * it over path. Where rename cannot replace a file (FAT), or with
+ * keepBackup, the old content is first renamed to path + ".bak"; a crash
+ * then leaves either path or the .bak complete. With keepBackup the .bak
+ * generation is kept afterwards, otherwise it is removed.
+ *
+ * @param path Full path of the file
+ * @param data Content to write
+ * @param length Bytes in data
+ * @param keepBackup Keep the previous content as path + ".bak"
+ * @return true if path now holds data
+ */
+bool writeFileAtomic(const std::string &path, const uint8_t *data, size_t length, bool keepBackup);
+
+/**
+ * @brief Appends to files under an AppendPolicy, keeping some open
+ *
+ * Used by the file backends' append(). Thread-safe, but appends to one
+ * file must not race each other: the backends hold that file's lock
+ * around every call. Another operation on a file that may be kept open
+ * must close() it first, so it sees the appended data and never
+ * truncates a file with buffered appends still to come.
+ *
+ * Each kept-open file has its own lock, held while it is written,
+ * flushed or closed; the lock over the list of open files is only held
+ * to look files up, never across I/O. Flushing one file, including one
+ * closed to make room for another, does not hold up the others.
+ */
+class StorageAppender
+{
+public:
+    explicit StorageAppender(const storage::AppendPolicy &policy) : policy_(policy)
+    {
+    }
+
+    ~StorageAppender()
+    {
+        closeAll();
+    }
+
+    StorageAppender(const StorageAppender &) = delete;
+    StorageAppender &operator=(const StorageAppender &) = delete;
+
+    /**
+     * @brief Append length bytes to the file at path, creating it if needed
+     *
+     * @return true if all bytes were written (and synced, if the policy
+     *         asked for it now)
+     */
+    bool append(const std::string &path, const uint8_t *data, size_t length);
+
+    /**
+     * @brief Close path if it is kept open
+     *
+     * @return false if flushing it failed
+     */
+    bool close(const std::string &path);
+
+    /**
+     * @brief Close every kept-open file
+     *
+     * @return false if flushing any of them failed
+     */
+    bool closeAll();
+
+    /**
+     * @brief Sync every kept-open file and leave them open
+     *
+     * @return false if syncing any of them failed
+     */
+    bool syncAll();
+
+    /**
+     * @brief Files currently kept open
+     */
+    size_t openFiles() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return files_.size();
+    }
+
+private:
+    struct FreeDeleter
+    {
+        void operator()(uint8_t *buffer) const
+        {
+            free(buffer);
+        }
+    };
+
+    /**
+     * @brief A file kept open; fields below mutex are guarded by it
+     */
+    struct OpenFile
+    {
+        explicit OpenFile(const std::string &filePath) : path(filePath)
+        {
+        }
+
+        const std::string path;
+        std::mutex mutex;   ///< Held while the file is opened, written, flushed or closed
+        bool listed = true; ///< Still in files_; cleared when closed, so waiters look it up again
+        StorageWriter writer;
+        size_t unsyncedBytes = 0;
+        std::chrono::steady_clock::time_point firstUnsynced; ///< When the oldest unsynced append was made
+        std::unique_ptr<uint8_t[], FreeDeleter> chunk;      ///< Write-back buffer, if policy_.writeBackSize
+        size_t buffered = 0;                                 ///< Bytes in chunk
+        size_t offset = 0;                                   ///< File offset of chunk[0]
+        std::chrono::steady_clock::time_point firstBuffered; ///< When chunk[0] was appended
+    };
+
+    /**
+     * @brief Entry for path, added to the front of files_ if new
+     *
+     * @param[out] victim Least recently appended file to close for room, if any
+     */
+    std::shared_ptr<OpenFile> lookup(const std::string &path, std::shared_ptr<OpenFile> &victim);
+
+    /**
+     * @brief Entries of files_, to visit one at a time without the list lock
+     */
+    std::vector<std::shared_ptr<OpenFile>> snapshot() const;
+
+    /**
+     * @brief Close file and drop it from files_, with file.mutex held
+     *
+     * @return false if flushing it failed
+     */
+    bool retire(OpenFile &file);
+
+    /**
+     * @brief Write back partial chunks of other files left longer than writeBackDelay
+     */
+    bool writeBackIdle(const OpenFile &current, std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Open file for appending, with a write-back buffer if the policy asks
+     */
+    bool openFile(OpenFile &file, std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Copy data into file's chunk, writing out every completed chunk
+     */
+    bool bufferAppend(OpenFile &file, const uint8_t *data, size_t length, std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Write out file's partially filled chunk
+     */
+    bool writeBack(OpenFile &file);
+
+    /**
+     * @brief Write back and close file
+     */
+    bool closeFile(OpenFile &file);
+
+    storage::AppendPolicy policy_;
+    mutable std::mutex mutex_;                   ///< Guards files_ only; never held across I/O
+    std::list<std::shared_ptr<OpenFile>> files_; ///< Most recently appended first
+};
+
+} // namespace lopcore
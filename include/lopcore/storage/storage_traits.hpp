@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <type_traits>
 #include <vector>
@@ -146,6 +148,64 @@ struct has_typed_operations<
 template<typename T>
 inline constexpr bool has_typed_operations_v = has_typed_operations<T>::value;
 
+/**
+ * @brief Detects if a value type has a native NVS integer encoding
+ *
+ * Integral types of 1, 2, 4 or 8 bytes map to nvs_set_u8/i8 ... u64/i64.
+ */
+template<typename V>
+struct is_nvs_scalar
+    : std::bool_constant<std::is_integral_v<V> &&
+                         (sizeof(V) == 1 || sizeof(V) == 2 || sizeof(V) == 4 || sizeof(V) == 8)>
+{
+};
+
+template<typename V>
+inline constexpr bool is_nvs_scalar_v = is_nvs_scalar<V>::value;
+
+/**
+ * @brief Detects if a value type can be stored by NvsStorage::get/set
+ *
+ * NVS scalars, plus trivially copyable types stored as blobs of their
+ * bytes. Pointers are rejected: their bytes mean nothing after a reboot.
+ */
+template<typename V>
+struct is_nvs_storable
+    : std::bool_constant<is_nvs_scalar_v<V> || (std::is_trivially_copyable_v<V> && !std::is_pointer_v<V> &&
+                                                 !std::is_array_v<V> && std::is_default_constructible_v<V>)>
+{
+};
+
+template<typename V>
+inline constexpr bool is_nvs_storable_v = is_nvs_storable<V>::value;
+
+/**
+ * @brief Detects if storage supports templated typed accessors
+ *
+ * Checks for presence of:
+ * - get<uint32_t>(const std::string& key)
+ * - set<uint32_t>(const std::string& key, const uint32_t& value)
+ *
+ * NvsStorage: values of is_nvs_storable_v types without heap allocation.
+ */
+template<typename T, typename = void>
+struct has_typed_accessors : std::false_type
+{
+};
+
+template<typename T>
+struct has_typed_accessors<
+    T,
+    std::void_t<decltype(std::declval<T>().template get<uint32_t>(std::declval<const std::string &>())),
+                decltype(std::declval<T>().template set<uint32_t>(std::declval<const std::string &>(),
+                                                                  std::declval<const uint32_t &>()))>>
+    : std::true_type
+{
+};
+
+template<typename T>
+inline constexpr bool has_typed_accessors_v = has_typed_accessors<T>::value;
+
 // ========================================
 // Trait: Commit support (NVS specific)
 // ========================================
@@ -172,6 +232,31 @@ struct requires_commit<T, std::void_t<decltype(std::declval<T>().commit())>> : s
 template<typename T>
 inline constexpr bool requires_commit_v = requires_commit<T>::value;
 
+/**
+ * @brief Detects if storage can defer commits over several writes
+ *
+ * Checks for presence of:
+ * - beginBatch()
+ * - commitBatch()
+ *
+ * NvsStorage batches writes into one commit.
+ */
+template<typename T, typename = void>
+struct supports_batch : std::false_type
+{
+};
+
+template<typename T>
+struct supports_batch<
+    T,
+    std::void_t<decltype(std::declval<T>().beginBatch()), decltype(std::declval<T>().commitBatch())>>
+    : std::true_type
+{
+};
+
+template<typename T>
+inline constexpr bool supports_batch_v = supports_batch<T>::value;
+
 // ========================================
 // Trait: Format support
 // ========================================
@@ -232,6 +317,176 @@ struct supports_strings<
 template<typename T>
 inline constexpr bool supports_strings_v = supports_strings<T>::value;
 
+// ========================================
+// Trait: Core backend operations
+// ========================================
+
+/**
+ * @brief Detects the operations every storage backend provides
+ *
+ * Checks for presence of:
+ * - write(const std::string& key, const std::vector<uint8_t>& data)
+ * - readBinary(const std::string& key)
+ * - exists(const std::string& key)
+ * - remove(const std::string& key)
+ *
+ * All LopCore backends: SpiffsStorage, LittleFsStorage, SdCardStorage,
+ * NvsStorage. StorageAdapter requires it.
+ */
+template<typename T, typename = void>
+struct is_storage_backend : std::false_type
+{
+};
+
+template<typename T>
+struct is_storage_backend<
+    T,
+    std::void_t<decltype(std::declval<T>().write(std::declval<const std::string &>(),
+                                                 std::declval<const std::vector<uint8_t> &>())),
+                decltype(std::declval<T>().readBinary(std::declval<const std::string &>())),
+                decltype(std::declval<T>().exists(std::declval<const std::string &>())),
+                decltype(std::declval<T>().remove(std::declval<const std::string &>()))>> : std::true_type
+{
+};
+
+template<typename T>
+inline constexpr bool is_storage_backend_v = is_storage_backend<T>::value;
+
+// ========================================
+// Trait: Append support
+// ========================================
+
+/**
+ * @brief Detects if storage appends without rewriting the whole value
+ *
+ * Checks for presence of:
+ * - append(const std::string& key, const void* data, size_t length)
+ * - syncAppends()
+ *
+ * File-based storage appends in place. NVS values can only be rewritten.
+ */
+template<typename T, typename = void>
+struct supports_append : std::false_type
+{
+};
+
+template<typename T>
+struct supports_append<T,
+                       std::void_t<decltype(std::declval<T>().append(std::declval<const std::string &>(),
+                                                                     std::declval<const void *>(),
+                                                                     std::declval<size_t>())),
+                                   decltype(std::declval<T>().syncAppends())>> : std::true_type
+{
+};
+
+template<typename T>
+inline constexpr bool supports_append_v = supports_append<T>::value;
+
+// ========================================
+// Trait: Streaming
+// ========================================
+
+/**
+ * @brief Detects if storage opens values as chunked streams
+ *
+ * Checks for presence of:
+ * - openReader(const std::string& key)
+ * - openWriter(const std::string& key)
+ *
+ * File-based storage streams; NVS values are read and written whole.
+ */
+template<typename T, typename = void>
+struct supports_streaming : std::false_type
+{
+};
+
+template<typename T>
+struct supports_streaming<T,
+                          std::void_t<decltype(std::declval<T>().openReader(std::declval<const std::string &>())),
+                                      decltype(std::declval<T>().openWriter(std::declval<const std::string &>()))>>
+    : std::true_type
+{
+};
+
+template<typename T>
+inline constexpr bool supports_streaming_v = supports_streaming<T>::value;
+
+// ========================================
+// Trait: Mount state
+// ========================================
+
+/**
+ * @brief Detects if storage reports whether its medium is mounted
+ *
+ * Checks for presence of:
+ * - isMounted()
+ *
+ * File-based storage (SPIFFS, LittleFS, SD card) reports it; a removable
+ * SD card may be absent at runtime. NVS has no mount state.
+ */
+template<typename T, typename = void>
+struct reports_mounted : std::false_type
+{
+};
+
+template<typename T>
+struct reports_mounted<T, std::void_t<decltype(std::declval<const T>().isMounted())>> : std::true_type
+{
+};
+
+template<typename T>
+inline constexpr bool reports_mounted_v = reports_mounted<T>::value;
+
+// ========================================
+// Trait: Garbage collection
+// ========================================
+
+/**
+ * @brief Detects if storage collects garbage on request
+ *
+ * Checks for presence of:
+ * - collectGarbage(size_t bytes)
+ *
+ * SPIFFS otherwise collects inside write() when it runs out of erased
+ * pages, stalling the writer.
+ */
+template<typename T, typename = void>
+struct supports_gc : std::false_type
+{
+};
+
+template<typename T>
+struct supports_gc<T, std::void_t<decltype(std::declval<T>().collectGarbage(std::declval<size_t>()))>>
+    : std::true_type
+{
+};
+
+template<typename T>
+inline constexpr bool supports_gc_v = supports_gc<T>::value;
+
+// ========================================
+// Trait: Integrity check
+// ========================================
+
+/**
+ * @brief Detects if storage checks its file system on request
+ *
+ * Checks for presence of:
+ * - check()
+ */
+template<typename T, typename = void>
+struct supports_check : std::false_type
+{
+};
+
+template<typename T>
+struct supports_check<T, std::void_t<decltype(std::declval<T>().check())>> : std::true_type
+{
+};
+
+template<typename T>
+inline constexpr bool supports_check_v = supports_check<T>::value;
+
 } // namespace traits
 } // namespace storage
 } // namespace lopcore
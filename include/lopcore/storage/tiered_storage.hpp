@@ -0,0 +1,270 @@
+/**
+ * @file tiered_storage.hpp
+ * @brief One key space over NVS, LittleFS and SD card, placed by size and heat
+ *
+ * Picking a backend per call pins each key to one medium for good. This
+ * facade instead keeps small, frequently used values in NVS (hot), the
+ * rest in LittleFS (warm) and large or long-unused data on the SD card
+ * (cold), and moves keys between them as their use changes:
+ *
+ * @code
+ * NvsStorage nvs(nvsConfig);
+ * LittleFsStorage flash(littleFsConfig);
+ * SdCardStorage card(sdConfig);
+ * TieredStorage store(nvs, flash, card, storage::TieredStorageConfig());
+ *
+ * store.write("pid_gains", gains);    // Warm at first
+ * store.readBinary("pid_gains");      // Counts towards promotion
+ * store.rebalance();                  // Periodically, e.g. once a minute
+ * @endcode
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "storage_config.hpp"
+#include "storage_traits.hpp"
+
+namespace lopcore
+{
+
+/**
+ * @brief Storage tiers, fastest first
+ */
+enum class StorageTier
+{
+    HOT,  ///< NVS: small values, lowest latency
+    WARM, ///< LittleFS: medium values
+    COLD  ///< SD card: large or rarely used values, may be absent
+};
+
+/**
+ * @brief TieredStorage counters
+ */
+struct TieredStorageStats
+{
+    uint32_t hotReads{0};   ///< Reads served by the hot tier
+    uint32_t warmReads{0};  ///< Reads served by the warm tier
+    uint32_t coldReads{0};  ///< Reads served by the cold tier
+    uint32_t misses{0};     ///< Reads of keys found in no tier
+    uint32_t promotions{0}; ///< Keys moved one tier up
+    uint32_t demotions{0};  ///< Keys moved one tier down
+    size_t trackedKeys{0};  ///< Keys with a known placement
+    size_t hotBytes{0};     ///< Bytes of tracked values in the hot tier
+};
+
+/**
+ * @brief Size- and access-driven placement of keys across three backends
+ *
+ * A new key is written to the warm tier, or to the cold tier if it is
+ * larger than warmMaxSize and the cold tier is available. Reads and
+ * writes heat a key; rebalance() promotes keys whose heat reaches
+ * promoteHeat by one tier (into hot only if they fit hotMaxSize and
+ * hotCapacity) and demotes keys left idle for demoteAfter passes by one
+ * tier. A key lives in exactly one tier: a move writes the new copy
+ * before removing the old one, so a crash in between leaves two equal
+ * copies rather than none.
+ *
+ * Placement is kept in RAM only. After a reboot, or once a key has been
+ * forgotten because maxKeys were tracked, its tier is found again by
+ * probing hot, warm and cold in turn.
+ *
+ * Keys must suit every tier a key may reach: NVS keys are limited to 15
+ * characters, so longer keys stay out of the hot tier. Thread-safe; every
+ * operation holds one mutex, so backend I/O is serialized.
+ */
+class TieredStorage
+{
+public:
+    using WriteFunction = std::function<bool(const std::string &, const std::vector<uint8_t> &)>;
+    using ReadFunction = std::function<std::optional<std::vector<uint8_t>>(const std::string &)>;
+    using RemoveFunction = std::function<bool(const std::string &)>;
+    using AvailableFunction = std::function<bool()>;
+
+    /**
+     * @brief One tier's operations
+     *
+     * A tier without write is not configured. available, if set, is asked
+     * before each use, so a removed SD card is skipped.
+     */
+    struct Backend
+    {
+        WriteFunction write;
+        ReadFunction read;
+        RemoveFunction remove;
+        AvailableFunction available;
+
+        /**
+         * @brief Operations of a backend with write(key, vector), readBinary(key) and remove(key)
+         *
+         * @param storage Backend, which must outlive the TieredStorage
+         */
+        template <typename Storage>
+        static Backend of(Storage &storage)
+        {
+            Backend backend;
+            backend.write = [&storage](const std::string &key, const std::vector<uint8_t> &data) {
+                return storage.write(key, data);
+            };
+            backend.read = [&storage](const std::string &key) { return storage.readBinary(key); };
+            backend.remove = [&storage](const std::string &key) { return storage.remove(key); };
+            if constexpr (storage::traits::reports_mounted_v<Storage>)
+            {
+                backend.available = [&storage]() { return storage.isMounted(); };
+            }
+            return backend;
+        }
+    };
+
+    /**
+     * @brief Hot and warm tiers only
+     */
+    template <typename Hot, typename Warm>
+    TieredStorage(Hot &hot, Warm &warm, const storage::TieredStorageConfig &config)
+        : TieredStorage(Backend::of(hot), Backend::of(warm), Backend(), config)
+    {
+    }
+
+    /**
+     * @brief All three tiers
+     */
+    template <typename Hot, typename Warm, typename Cold>
+    TieredStorage(Hot &hot, Warm &warm, Cold &cold, const storage::TieredStorageConfig &config)
+        : TieredStorage(Backend::of(hot), Backend::of(warm), Backend::of(cold), config)
+    {
+    }
+
+    /**
+     * @brief Tiers given as functions; cold may be left empty
+     */
+    TieredStorage(Backend hot, Backend warm, Backend cold, const storage::TieredStorageConfig &config);
+
+    TieredStorage(const TieredStorage &) = delete;
+    TieredStorage &operator=(const TieredStorage &) = delete;
+
+    /**
+     * @brief Write a value to the key's current tier, or place it by size
+     *
+     * A key keeps its tier while its new size still fits there.
+     *
+     * @return false if no suitable tier accepted the value
+     */
+    bool write(const std::string &key, const std::vector<uint8_t> &data);
+    bool write(const std::string &key, const std::string &data);
+
+    /**
+     * @brief Read a value from whichever tier holds it
+     */
+    std::optional<std::vector<uint8_t>> readBinary(const std::string &key);
+    std::optional<std::string> read(const std::string &key);
+
+    bool exists(const std::string &key);
+
+    /**
+     * @brief Remove the key from every tier
+     *
+     * @return true if a copy was removed
+     */
+    bool remove(const std::string &key);
+
+    /**
+     * @brief Tier holding the key, probing if it is not tracked
+     */
+    std::optional<StorageTier> tierOf(const std::string &key);
+
+    /**
+     * @brief Promote hot keys, demote idle ones, then age all heat
+     *
+     * Does the migrations' I/O on the calling task; call it periodically
+     * from a low-priority task rather than from a latency-sensitive path.
+     *
+     * @return Number of keys moved
+     */
+    size_t rebalance();
+
+    TieredStorageStats getStats() const;
+
+private:
+    static constexpr size_t TIERS = 3;
+
+    /**
+     * @brief Placement and heat of a tracked key
+     */
+    struct Placement
+    {
+        StorageTier tier;
+        size_t size;
+        uint32_t heat; ///< Accesses, halved each rebalance()
+        uint32_t idle; ///< rebalance() passes since the last access
+    };
+
+    bool usable(StorageTier tier) const;
+    Backend &backend(StorageTier tier);
+
+    /**
+     * @brief Tier a new value of this size is written to
+     */
+    StorageTier homeFor(size_t size) const;
+
+    /**
+     * @brief Whether a value of this size may live in tier
+     */
+    bool fits(StorageTier tier, size_t size) const;
+
+    /**
+     * @brief Write to preferred, or to the warm tier if that fails; with mutex_ held
+     *
+     * @return Tier written, or std::nullopt if none accepted the value
+     */
+    std::optional<StorageTier> store(const std::string &key, const std::vector<uint8_t> &data,
+                                     StorageTier preferred);
+
+    /**
+     * @brief Tracked placement of key, probing the tiers if untracked; with mutex_ held
+     *
+     * Probing reads the value; it is returned through probed to save a
+     * second read.
+     */
+    Placement *locate(const std::string &key, std::optional<std::vector<uint8_t>> *probed = nullptr);
+
+    /**
+     * @brief Start tracking key, forgetting the coldest key if full; with mutex_ held
+     */
+    Placement &track(const std::string &key, StorageTier tier, size_t size);
+
+    void untrack(const std::string &key);
+
+    /**
+     * @brief Copy key to tier and remove it from its old tier; with mutex_ held
+     */
+    bool move(const std::string &key, Placement &placement, StorageTier to);
+
+    /**
+     * @brief Demote the coldest hot keys until size more bytes fit; with mutex_ held
+     *
+     * Only keys colder than heat are demoted.
+     *
+     * @return false if not enough room could be made
+     */
+    bool makeHotRoom(size_t size, uint32_t heat);
+
+    Backend tiers_[TIERS];
+    const storage::TieredStorageConfig config_;
+
+    mutable std::mutex mutex_; ///< Guards the fields below and serializes backend I/O
+    std::unordered_map<std::string, Placement> placements_;
+    size_t hotBytes_ = 0;
+    TieredStorageStats stats_;
+};
+
+} // namespace lopcore
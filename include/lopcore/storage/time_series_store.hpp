@@ -0,0 +1,207 @@
+/**
+ * @file time_series_store.hpp
+ * @brief Append-only time-series records in rolling segment files
+ *
+ * Sensor logs are written once, in time order, and read back as "the last
+ * N minutes" or dropped when they age out. TimeSeriesStore appends each
+ * record to the newest segment file of a directory on LittleFS or an SD
+ * card, so every byte is written once; a sparse in-RAM index of each
+ * segment lets a range query seek close to its start, and retention
+ * deletes whole segments instead of rewriting files:
+ *
+ * @code
+ * storage::TimeSeriesConfig config;
+ * config.setDirectory("/littlefs/imu").setRecordSize(sizeof(ImuSample));
+ * TimeSeriesStore imu(config);
+ * imu.open();
+ * imu.append(nowMs, &sample);
+ * imu.query(nowMs - 5 * 60 * 1000, nowMs, [](int64_t timestamp, const uint8_t *record) {
+ *     plot(timestamp, *reinterpret_cast<const ImuSample *>(record));
+ *     return true;
+ * });
+ * @endcode
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "storage_config.hpp"
+#include "storage_stream.hpp"
+
+namespace lopcore
+{
+
+/**
+ * @brief TimeSeriesStore contents
+ */
+struct TimeSeriesStats
+{
+    size_t segments{0};        ///< Segment files in the directory
+    size_t records{0};         ///< Records over all segments
+    size_t bytes{0};           ///< Bytes over all segments
+    int64_t firstTimestamp{0}; ///< Oldest stored timestamp (0 if empty)
+    int64_t lastTimestamp{0};  ///< Newest stored timestamp (0 if empty)
+};
+
+/**
+ * @brief Append-only store of fixed-size records keyed by timestamp
+ *
+ * Timestamps must not decrease and must not be negative. Each segment is
+ * named after its first timestamp ("<16 hex digits>.seg") and holds
+ * records back to back with no header, so a file cut short by power loss
+ * loses only its last record: open() truncates the partial tail.
+ *
+ * The index is rebuilt by open() reading every segment once, and takes
+ * 24 bytes per config.indexInterval records in RAM. Thread-safe.
+ */
+class TimeSeriesStore
+{
+public:
+    /**
+     * @brief Receives one record; return false to stop the query
+     */
+    using Visitor = std::function<bool(int64_t timestamp, const uint8_t *record)>;
+
+    explicit TimeSeriesStore(const storage::TimeSeriesConfig &config);
+
+    /**
+     * @brief Syncs and closes the segment being written
+     */
+    ~TimeSeriesStore();
+
+    TimeSeriesStore(const TimeSeriesStore &) = delete;
+    TimeSeriesStore &operator=(const TimeSeriesStore &) = delete;
+
+    /**
+     * @brief Create the directory if needed and index the existing segments
+     *
+     * @return false if the config is invalid or the directory is unusable
+     */
+    bool open();
+
+    bool isOpen() const
+    {
+        return open_;
+    }
+
+    /**
+     * @brief Append one record
+     *
+     * Starts a new segment when the current one would exceed
+     * config.segmentBytes, and applies retention when it does.
+     *
+     * @param timestamp Not lower than the previous record's
+     * @param record config.recordSize bytes
+     * @return false if the timestamp goes backwards or the write failed
+     */
+    bool append(int64_t timestamp, const void *record);
+
+    /**
+     * @brief Visit the records with from <= timestamp <= to, oldest first
+     *
+     * @return Number of records visited
+     */
+    size_t query(int64_t from, int64_t to, const Visitor &visit);
+
+    /**
+     * @brief Visit the records of the last span time units
+     *
+     * Same as query(lastTimestamp() - span, lastTimestamp(), visit).
+     */
+    size_t queryLast(int64_t span, const Visitor &visit);
+
+    /**
+     * @brief Delete every segment whose records are all older than timestamp
+     *
+     * The segment being written is kept.
+     *
+     * @return Number of segments deleted
+     */
+    size_t removeBefore(int64_t timestamp);
+
+    /**
+     * @brief Flush and fsync the segment being written
+     */
+    bool sync();
+
+    /**
+     * @brief Newest appended timestamp (0 if empty)
+     */
+    int64_t lastTimestamp() const;
+
+    TimeSeriesStats getStats() const;
+
+private:
+    /**
+     * @brief Sparse index entry: a record and where it starts
+     */
+    struct IndexPoint
+    {
+        int64_t timestamp; ///< Timestamp of the record
+        int64_t previous;  ///< Timestamp of the record before it (DELTA base)
+        size_t offset;     ///< File offset of the record
+    };
+
+    struct Segment
+    {
+        int64_t first;                  ///< Timestamp in the file name
+        int64_t last;                   ///< Newest record's timestamp
+        size_t bytes;                   ///< Bytes of complete records
+        size_t records;                 ///< Number of records
+        std::vector<IndexPoint> points; ///< Every config.indexInterval-th record
+    };
+
+    using RecordFunction = std::function<bool(int64_t timestamp, const uint8_t *record, size_t offset)>;
+
+    std::string segmentPath(int64_t first) const;
+
+    /**
+     * @brief Encode a record into scratch_
+     *
+     * @return Encoded size
+     */
+    size_t encode(int64_t timestamp, int64_t previous, const void *record);
+
+    /**
+     * @brief Decode one record at data
+     *
+     * @return Encoded size, 0 if length holds no complete record
+     */
+    size_t decode(const uint8_t *data, size_t length, int64_t previous, int64_t &timestamp) const;
+
+    /**
+     * @brief Read records of a segment starting at a record boundary
+     *
+     * @param previous Timestamp of the record before offset
+     * @return Offset after the last complete record read
+     */
+    size_t readSegment(const Segment &segment, size_t offset, int64_t previous, const RecordFunction &visit) const;
+
+    /**
+     * @brief Rebuild a segment's index from its file, truncating a partial tail
+     */
+    bool indexSegment(Segment &segment);
+
+    bool startSegment(int64_t first);
+    bool closeWriter();
+    void applyRetention();
+    void removeSegment(size_t position);
+
+    const storage::TimeSeriesConfig config_;
+    mutable std::mutex mutex_;      ///< Guards the fields below
+    bool open_ = false;
+    std::vector<Segment> segments_; ///< Oldest first; the last one is written
+    StorageWriter writer_;          ///< Open on segments_.back() once appended to
+    size_t unsyncedBytes_ = 0;
+    std::vector<uint8_t> scratch_; ///< Encoded record
+};
+
+} // namespace lopcore
@@ -0,0 +1,345 @@
+/**
+ * @file task_profile.hpp
+ * @brief Scheduling profile for every task LopCore creates
+ *
+ * Each background task LopCore starts has a TaskRole. A process-wide
+ * TaskProfile maps every role to a core, a priority and a stack size, so
+ * one place decides where network I/O, logging and storage work run:
+ *
+ * @code
+ * auto profile = lopcore::task::TaskProfile::defaults();
+ * profile.pinGroup(lopcore::task::TaskGroup::NETWORK, 0);    // Sockets, TLS, MQTT on core 0
+ * profile.pinGroup(lopcore::task::TaskGroup::BACKGROUND, 0); // Core 1 left to the control loop
+ * profile[lopcore::task::TaskRole::MQTT_LOOP].stackSize = 6144;
+ * lopcore::task::setProfile(profile);
+ * @endcode
+ *
+ * Set the profile at startup, before creating clients, sinks and storage
+ * workers: component configs (DispatchConfig::stackSize,
+ * AsyncStorageConfig::coreId, ...) take their defaults from it when they
+ * are constructed, and can still override them per instance. Roles
+ * without a config of their own (MQTT_LOOP, MQTT_AGENT, MQTT_ESP) read it
+ * when their task starts. The esp-mqtt task takes priority and stack from
+ * the profile; its core is chosen by CONFIG_MQTT_TASK_CORE_SELECTION.
+ *
+ * Tasks started through spawn() are tracked, and getStackReport() gives
+ * the lowest free stack each role has reached, for sizing stacks from
+ * field data instead of guesses.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include <esp_err.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+#ifndef CONFIG_LOPCORE_THREAD_STACK_SIZE
+#define CONFIG_LOPCORE_THREAD_STACK_SIZE 4096
+#endif
+#ifndef CONFIG_LOPCORE_TASK_NETWORK_CORE
+#define CONFIG_LOPCORE_TASK_NETWORK_CORE -1
+#endif
+#ifndef CONFIG_LOPCORE_TASK_BACKGROUND_CORE
+#define CONFIG_LOPCORE_TASK_BACKGROUND_CORE -1
+#endif
+#ifndef CONFIG_LOPCORE_MQTT_AGENT_TASK_STACK_SIZE
+#define CONFIG_LOPCORE_MQTT_AGENT_TASK_STACK_SIZE 6144
+#endif
+#ifndef CONFIG_LOPCORE_MQTT_AGENT_TASK_PRIORITY
+#define CONFIG_LOPCORE_MQTT_AGENT_TASK_PRIORITY 5
+#endif
+
+namespace lopcore
+{
+namespace task
+{
+
+/**
+ * @brief Core ID meaning "let the scheduler pick"
+ */
+constexpr int ANY_CORE = -1;
+
+/**
+ * @brief Highest core ID a profile may name
+ */
+#ifdef ESP_PLATFORM
+constexpr int MAX_CORE = portNUM_PROCESSORS - 1;
+#else
+constexpr int MAX_CORE = 1;
+#endif
+
+/**
+ * @brief Every kind of task LopCore creates
+ */
+enum class TaskRole : uint8_t
+{
+    MQTT_LOOP,      ///< CoreMqttClient ProcessLoop task
+    MQTT_AGENT,     ///< CoreMqttAgentClient agent task
+    MQTT_ESP,       ///< esp-mqtt client task (EspMqttClient)
+    MQTT_DISPATCH,  ///< MqttDispatcher callback workers
+    MQTT_COALESCE,  ///< MqttCoalescer flush task
+    TLS_CONNECT,    ///< MbedtlsTransport::connectAsync() handshake task
+    LOG_DRAIN,      ///< Async logger drain task
+    LOG_COMPRESS,   ///< FileSink rotated-file compression task
+    LOG_MQTT,       ///< MqttLogSink publisher task
+    STORAGE_IO,     ///< AsyncStorage worker
+    STORAGE_MAINT,  ///< StorageMaintenance worker
+    METRICS_EXPORT, ///< MetricsExporter task
+    BOOT_STEP,      ///< Bootstrap step run in parallel with others
+    COUNT
+};
+
+constexpr size_t TASK_ROLE_COUNT = static_cast<size_t>(TaskRole::COUNT);
+
+/**
+ * @brief Roles that are usually placed together
+ */
+enum class TaskGroup : uint8_t
+{
+    NETWORK,   ///< MQTT and TLS tasks: socket I/O and protocol handling
+    BACKGROUND ///< Logging, storage, metrics and boot steps: deferrable work
+};
+
+constexpr TaskGroup groupOf(TaskRole role)
+{
+    return role <= TaskRole::TLS_CONNECT ? TaskGroup::NETWORK : TaskGroup::BACKGROUND;
+}
+
+/**
+ * @brief Role name for logs and reports (e.g. "mqtt_loop")
+ */
+const char *roleName(TaskRole role);
+
+/**
+ * @brief Where and how one task runs
+ */
+struct TaskSettings
+{
+    int coreId{ANY_CORE};                                 ///< Core to pin to, ANY_CORE to float
+    uint32_t priority{1};                                 ///< FreeRTOS priority
+    uint32_t stackSize{CONFIG_LOPCORE_THREAD_STACK_SIZE}; ///< Stack size in bytes
+
+    esp_err_t validate() const
+    {
+        if (coreId < ANY_CORE || coreId > MAX_CORE || priority == 0 || priority > 24 || stackSize < 2048)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        return ESP_OK;
+    }
+};
+
+/**
+ * @brief TaskSettings for every role
+ */
+class TaskProfile
+{
+public:
+    /**
+     * @brief The built-in profile
+     *
+     * Cores come from CONFIG_LOPCORE_TASK_NETWORK_CORE and
+     * CONFIG_LOPCORE_TASK_BACKGROUND_CORE (any core by default), stacks from
+     * CONFIG_LOPCORE_THREAD_STACK_SIZE except where a role needs more.
+     */
+    static TaskProfile defaults()
+    {
+        TaskProfile profile;
+        profile.pinGroup(TaskGroup::NETWORK, CONFIG_LOPCORE_TASK_NETWORK_CORE);
+        profile.pinGroup(TaskGroup::BACKGROUND, CONFIG_LOPCORE_TASK_BACKGROUND_CORE);
+
+        profile[TaskRole::MQTT_LOOP].priority = 5;
+        profile[TaskRole::MQTT_AGENT].priority = CONFIG_LOPCORE_MQTT_AGENT_TASK_PRIORITY;
+        profile[TaskRole::MQTT_AGENT].stackSize = CONFIG_LOPCORE_MQTT_AGENT_TASK_STACK_SIZE;
+        profile[TaskRole::MQTT_ESP].priority = 5;
+        profile[TaskRole::MQTT_ESP].stackSize = 6144; // esp-mqtt's own default
+        profile[TaskRole::MQTT_DISPATCH].priority = 5;
+        profile[TaskRole::MQTT_COALESCE].priority = 5;
+        profile[TaskRole::TLS_CONNECT].priority = 5;
+        profile[TaskRole::TLS_CONNECT].stackSize = 8192; // Full handshake
+        profile[TaskRole::LOG_DRAIN].priority = 2;
+        profile[TaskRole::STORAGE_IO].priority = 5;
+        profile[TaskRole::METRICS_EXPORT].stackSize = 3072;
+        profile[TaskRole::BOOT_STEP].priority = 5;
+        return profile;
+    }
+
+    TaskSettings &operator[](TaskRole role)
+    {
+        return settings_[static_cast<size_t>(role)];
+    }
+
+    const TaskSettings &operator[](TaskRole role) const
+    {
+        return settings_[static_cast<size_t>(role)];
+    }
+
+    /**
+     * @brief Pin every role of a group to one core
+     * @param coreId Core, or ANY_CORE to let the group float
+     */
+    TaskProfile &pinGroup(TaskGroup group, int coreId)
+    {
+        for (size_t i = 0; i < TASK_ROLE_COUNT; i++)
+        {
+            if (groupOf(static_cast<TaskRole>(i)) == group)
+            {
+                settings_[i].coreId = coreId;
+            }
+        }
+        return *this;
+    }
+
+    esp_err_t validate() const
+    {
+        for (const auto &settings : settings_)
+        {
+            if (settings.validate() != ESP_OK)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+        return ESP_OK;
+    }
+
+private:
+    std::array<TaskSettings, TASK_ROLE_COUNT> settings_{};
+};
+
+namespace detail
+{
+
+struct ProfileState
+{
+    std::mutex mutex;
+    TaskProfile profile{TaskProfile::defaults()};
+};
+
+inline ProfileState &profileState()
+{
+    static ProfileState state;
+    return state;
+}
+
+} // namespace detail
+
+/**
+ * @brief Copy of the active profile
+ */
+inline TaskProfile getProfile()
+{
+    auto &state = detail::profileState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.profile;
+}
+
+/**
+ * @brief Replace the active profile
+ *
+ * Tasks already running keep their settings.
+ *
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG (profile unchanged) if any role is invalid
+ */
+inline esp_err_t setProfile(const TaskProfile &profile)
+{
+    if (profile.validate() != ESP_OK)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto &state = detail::profileState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.profile = profile;
+    return ESP_OK;
+}
+
+/**
+ * @brief Active settings of one role
+ */
+inline TaskSettings getSettings(TaskRole role)
+{
+    auto &state = detail::profileState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.profile[role];
+}
+
+/**
+ * @brief Stack usage of one role, over every task of it started with spawn()
+ */
+struct TaskStackReport
+{
+    TaskRole role{TaskRole::COUNT};
+    uint32_t started{0};      ///< Tasks started since boot
+    uint32_t running{0};      ///< Tasks currently alive
+    uint32_t stackSize{0};    ///< Stack of the most recently started task (bytes)
+    uint32_t minFreeStack{0}; ///< Lowest free stack any of them reached (bytes, 0 if never started)
+};
+
+/**
+ * @brief Stack usage of every role, indexed by TaskRole
+ *
+ * Samples the high-water mark of running tasks; tasks that have exited
+ * contribute the mark they left with. The host has no stacks to measure:
+ * minFreeStack stays 0 there.
+ */
+std::array<TaskStackReport, TASK_ROLE_COUNT> getStackReport();
+
+/**
+ * @brief Log getStackReport() for roles that have started a task
+ */
+void logStackReport();
+
+/**
+ * @brief Start a task with its role's profile settings
+ * @param handle Receives the task handle (optional)
+ * @return ESP_OK, or ESP_ERR_NO_MEM if the task could not be created
+ */
+esp_err_t spawn(TaskRole role, const char *name, TaskFunction_t entry, void *arg, TaskHandle_t *handle = nullptr);
+
+/**
+ * @brief Start a task with explicit stack and priority, on its role's core
+ */
+esp_err_t spawn(TaskRole role,
+                const char *name,
+                TaskFunction_t entry,
+                void *arg,
+                uint32_t stackSize,
+                uint32_t priority,
+                TaskHandle_t *handle = nullptr);
+
+/**
+ * @brief Start a task with fully explicit settings
+ */
+esp_err_t spawn(TaskRole role,
+                const char *name,
+                TaskFunction_t entry,
+                void *arg,
+                const TaskSettings &settings,
+                TaskHandle_t *handle = nullptr);
+
+/**
+ * @brief End the calling task (replaces vTaskDelete(nullptr) in spawned tasks)
+ *
+ * Records the task's final stack high-water mark before deleting it.
+ */
+void exitTask();
+
+/**
+ * @brief Stop tracking a spawned task about to be deleted by another task
+ */
+void forgetTask(TaskHandle_t handle);
+
+} // namespace task
+} // namespace lopcore
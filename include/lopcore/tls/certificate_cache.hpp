@@ -0,0 +1,118 @@
+/**
+ * @file certificate_cache.hpp
+ * @brief Process-wide cache of parsed TLS certificates
+ *
+ * Parsing the root CA chain from the filesystem and exporting the client
+ * certificate from PKCS#11 costs a file read, two C_GetAttributeValue
+ * calls, a heap buffer and an X.509 parse on every connect. The cache does
+ * this once per path or label and shares the parsed result across every
+ * MbedtlsTransport and every reconnect.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Forward declare to avoid exposing the MbedTLS and PKCS#11 headers
+typedef unsigned long CK_SESSION_HANDLE;
+struct mbedtls_x509_crt;
+
+namespace lopcore
+{
+namespace tls
+{
+
+/**
+ * @brief Singleton cache of parsed CA chains and client certificates
+ *
+ * Entries are shared_ptrs: a connection keeps the certificates it was set
+ * up with alive, so invalidating an entry never frees a certificate that
+ * an open connection still references. The next connect parses the new
+ * one.
+ *
+ * Usage:
+ * @code
+ * // After writing a rotated certificate into PKCS#11
+ * CertificateCache::instance().invalidate("Device Cert");
+ * transport.clearSession(); // The saved session was made with the old one
+ * @endcode
+ */
+class CertificateCache
+{
+public:
+    /**
+     * @brief Get singleton instance (thread-safe lazy initialization)
+     */
+    static CertificateCache &instance();
+
+    /**
+     * @brief Root CA chain parsed from a PEM or DER file
+     *
+     * @param path Filesystem path of the CA bundle
+     * @return The parsed chain, or nullptr if the file cannot be read or parsed
+     */
+    std::shared_ptr<mbedtls_x509_crt> caChain(const std::string &path);
+
+    /**
+     * @brief Client certificate exported from PKCS#11
+     *
+     * @param label PKCS#11 label of the certificate object
+     * @param session PKCS#11 session used on a cache miss
+     * @return The parsed certificate, or nullptr if it cannot be exported or parsed
+     */
+    std::shared_ptr<mbedtls_x509_crt> clientCertificate(const std::string &label, CK_SESSION_HANDLE session);
+
+    /**
+     * @brief Drop the entry for a CA path or certificate label
+     *
+     * Call after rotating the certificate it names.
+     *
+     * @return True if an entry was cached under that key
+     */
+    bool invalidate(const std::string &key);
+
+    /**
+     * @brief Drop every entry
+     */
+    void clear();
+
+    /**
+     * @brief Number of cached certificates
+     */
+    size_t size() const;
+
+    // Delete copy and move to enforce singleton
+    CertificateCache(const CertificateCache &) = delete;
+    CertificateCache &operator=(const CertificateCache &) = delete;
+    CertificateCache(CertificateCache &&) = delete;
+    CertificateCache &operator=(CertificateCache &&) = delete;
+
+private:
+    using Entries = std::map<std::string, std::shared_ptr<mbedtls_x509_crt>>;
+
+    CertificateCache();
+    ~CertificateCache();
+
+    /**
+     * @brief Allocate an initialized certificate freed with mbedtls_x509_crt_free()
+     */
+    static std::shared_ptr<mbedtls_x509_crt> makeCertificate();
+
+    Entries caChains_;    ///< Keyed by file path
+    Entries clientCerts_; ///< Keyed by PKCS#11 label
+
+    // Thread safety (also serialises parsing, so a miss is parsed once)
+    SemaphoreHandle_t mutex_;
+};
+
+} // namespace tls
+} // namespace lopcore
@@ -44,6 +44,7 @@ extern "C" {
 #include "mbedtls/net_sockets.h"
 #include "mbedtls/pk.h"
 #include "mbedtls/ssl.h"
+#include "mbedtls/version.h"
 
 #include "esp_idf_version.h"
 
@@ -68,6 +69,40 @@ extern "C" {
  */
 #define MBEDTLS_DEBUG_LOG_LEVEL 0
 
+/**
+ * @brief Most cipher suites #MbedtlsPkcs11Credentials_t::pCipherSuites may list.
+ */
+#define MBEDTLS_PKCS11_MAX_CIPHERSUITES 8
+
+/**
+ * @brief Most groups #MbedtlsPkcs11Credentials_t::pGroups may list.
+ */
+#define MBEDTLS_PKCS11_MAX_GROUPS 4
+
+/**
+ * @brief Timing of the last Mbedtls_Pkcs11_Connect() and I/O counters of the
+ * connection it established.
+ *
+ * Times are in microseconds of esp_timer. #signUs is part of #handshakeUs.
+ * Each Mbedtls_Pkcs11_Send() writes at most one record; a received record may
+ * take several Mbedtls_Pkcs11_Recv() calls, and is counted once consumed.
+ */
+typedef struct MbedtlsPkcs11Stats
+{
+    uint32_t resolveUs;       /**< @brief DNS resolution of the host name. */
+    uint32_t tcpConnectUs;    /**< @brief TCP connection to the resolved address. */
+    uint32_t handshakeUs;     /**< @brief TLS handshake, certificate verification included. */
+    uint32_t signUs;          /**< @brief PKCS #11 signature(s) for client authentication, 0 if resumed. */
+    uint32_t firstByteUs;     /**< @brief Handshake end to first byte received, 0 until then. */
+    int64_t connectedAtUs;    /**< @brief esp_timer time the handshake finished. */
+    uint64_t bytesSent;       /**< @brief Application bytes written. */
+    uint64_t bytesReceived;   /**< @brief Application bytes read. */
+    uint32_t recordsSent;     /**< @brief Records written. */
+    uint32_t recordsReceived; /**< @brief Records read to the end. */
+    uint64_t sendUs;          /**< @brief Time spent in Mbedtls_Pkcs11_Send(). */
+    uint64_t recvUs;          /**< @brief Time spent in Mbedtls_Pkcs11_Recv(), socket waits included. */
+} MbedtlsPkcs11Stats_t;
+
 /**
  * @brief Context containing state for the MbedTLS and corePKCS11 based
  * transport interface implementation.
@@ -93,6 +128,19 @@ typedef struct MbedtlsPkcs11Context
     CK_OBJECT_HANDLE p11PrivateKey;        /**< @brief PKCS #11 handle for the private key to use for client
                                               authentication. */
     CK_KEY_TYPE keyType;                   /**< @brief PKCS #11 key type corresponding to #p11PrivateKey. */
+
+    /* Algorithm preferences, referenced by #config until the connection closes. */
+    int cipherSuites[MBEDTLS_PKCS11_MAX_CIPHERSUITES + 1]; /**< @brief Zero-terminated cipher suite IDs. */
+#if (MBEDTLS_VERSION_NUMBER >= 0x03010000)
+    uint16_t groups[MBEDTLS_PKCS11_MAX_GROUPS + 1]; /**< @brief Zero-terminated TLS group IDs. */
+#elif defined(MBEDTLS_ECP_C)
+    mbedtls_ecp_group_id groups[MBEDTLS_PKCS11_MAX_GROUPS + 1]; /**< @brief MBEDTLS_ECP_DP_NONE-terminated
+                                                                   curves. */
+#endif
+
+    /* Instrumentation. */
+    MbedtlsPkcs11Stats_t stats; /**< @brief Reset by Mbedtls_Pkcs11_Connect(). Send counters change under
+                                   the caller's send lock, receive counters under its receive lock. */
 } MbedtlsPkcs11Context_t;
 
 /**
@@ -133,6 +181,60 @@ typedef struct MbedtlsPkcs11Credentials
     char *pClientCertLabel;  /**< @brief String representing the PKCS #11 label for the client certificate. */
     char *pPrivateKeyLabel;  /**< @brief String representing the PKCS #11 label for the private key. */
     CK_SESSION_HANDLE p11Session; /**< @brief PKCS #11 session handle. */
+
+    /**
+     * @brief Handle of the #pPrivateKeyLabel object if the caller already
+     * knows it, or CK_INVALID_HANDLE to search the token for the label.
+     */
+    CK_OBJECT_HANDLE privateKeyHandle;
+
+    /**
+     * @brief Session saved with Mbedtls_Pkcs11_SaveSession() to offer for
+     * resumption, or NULL for a full handshake.
+     *
+     * If the server accepts the session ID or ticket, the handshake is
+     * abbreviated and the private key is not used. A session that cannot be
+     * loaded, or that the server declines, falls back to a full handshake.
+     */
+    const unsigned char *pSession;
+    size_t sessionLength; /**< @brief Length of #pSession in bytes. */
+
+    /**
+     * @brief Already parsed root CA chain to trust instead of reading
+     * #pRootCaPath, or NULL.
+     *
+     * The chain is only referenced, never freed, and must outlive the
+     * connection.
+     */
+    mbedtls_x509_crt *pRootCa;
+
+    /**
+     * @brief Already parsed client certificate to present instead of
+     * exporting #pClientCertLabel, or NULL. Same lifetime rules as #pRootCa.
+     */
+    mbedtls_x509_crt *pClientCert;
+
+    /**
+     * @brief Maximum fragment length to negotiate: 512, 1024, 2048 or 4096,
+     * or 0 to leave records at their 16 KB default.
+     */
+    uint16_t maxFragmentLength;
+
+    /**
+     * @brief IANA IDs of the cipher suites to offer, most preferred first, or
+     * NULL for the MbedTLS defaults.
+     *
+     * Suites MbedTLS was built without are skipped with a warning.
+     */
+    const uint16_t *pCipherSuites;
+    size_t cipherSuiteCount; /**< @brief Entries in #pCipherSuites, up to #MBEDTLS_PKCS11_MAX_CIPHERSUITES. */
+
+    /**
+     * @brief IANA IDs of the (EC)DHE groups to offer, most preferred first,
+     * or NULL for the MbedTLS defaults.
+     */
+    const uint16_t *pGroups;
+    size_t groupCount; /**< @brief Entries in #pGroups, up to #MBEDTLS_PKCS11_MAX_GROUPS. */
 } MbedtlsPkcs11Credentials_t;
 
 /**
@@ -159,6 +261,45 @@ MbedtlsPkcs11Status_t Mbedtls_Pkcs11_Connect(NetworkContext_t *pNetworkContext,
                                              const MbedtlsPkcs11Credentials_t *pMbedtlsPkcs11Credentials,
                                              uint32_t recvTimeoutMs);
 
+/**
+ * @brief Serializes the session of an established TLS connection so a later
+ * Mbedtls_Pkcs11_Connect() can resume it.
+ *
+ * Call once per connection, after Mbedtls_Pkcs11_Connect() succeeds:
+ * MbedTLS 3.x refuses to export a TLS 1.2 session a second time.
+ *
+ * @param[in] pNetworkContext The network context created using Mbedtls_Pkcs11_Connect API.
+ * @param[out] ppSession The serialized session, allocated with malloc(); release it with free().
+ * @param[out] pSessionLength Length of the serialized session.
+ *
+ * @note The session holds the connection's master secret; store it only
+ * where the private key would be acceptable to store.
+ *
+ * @return #MBEDTLS_PKCS11_SUCCESS on success;
+ * #MBEDTLS_PKCS11_INVALID_PARAMETER, #MBEDTLS_PKCS11_INSUFFICIENT_MEMORY,
+ * or #MBEDTLS_PKCS11_INTERNAL_ERROR on failure.
+ */
+MbedtlsPkcs11Status_t Mbedtls_Pkcs11_SaveSession(NetworkContext_t *pNetworkContext,
+                                                 unsigned char **ppSession,
+                                                 size_t *pSessionLength);
+
+/**
+ * @brief Exports a certificate object from PKCS #11 and parses it.
+ *
+ * Lets a caller parse the client certificate once and pass it as
+ * #MbedtlsPkcs11Credentials_t.pClientCert on every connect.
+ *
+ * @param[in] p11Session PKCS #11 session to read the certificate with.
+ * @param[in] pLabelName PKCS #11 label of the certificate object.
+ * @param[out] pCertificate Initialized certificate context to parse into.
+ *
+ * @return #MBEDTLS_PKCS11_SUCCESS on success;
+ * #MBEDTLS_PKCS11_INVALID_PARAMETER or #MBEDTLS_PKCS11_INVALID_CREDENTIALS on failure.
+ */
+MbedtlsPkcs11Status_t Mbedtls_Pkcs11_ReadCertificate(CK_SESSION_HANDLE p11Session,
+                                                     const char *pLabelName,
+                                                     mbedtls_x509_crt *pCertificate);
+
 /**
  * @brief Gracefully disconnect an established TLS connection.
  *
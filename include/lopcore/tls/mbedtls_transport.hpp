@@ -11,6 +11,7 @@
  * - Exponential backoff retry logic
  * - ALPN protocol support
  * - Server Name Indication (SNI)
+ * - TLS session resumption on reconnect, optionally persisted in NVS
  * - Network context abstraction for coreMQTT integration
  *
  * @copyright Copyright (c) 2025 LopCore Contributors
@@ -19,6 +20,7 @@
 
 #pragma once
 
+#include "lopcore/memory/memory_resource.hpp"
 #include "lopcore/tls/network_context.h"
 #include "lopcore/tls/pkcs11_session.hpp"
 #include "lopcore/tls/tls_config.hpp"
@@ -28,16 +30,61 @@
 #include "lopcore/tls/mbedtls_pkcs11_posix.h"
 
 // FreeRTOS includes
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 
 namespace lopcore
 {
+
+class NvsStorage;
+
 namespace tls
 {
 
+/**
+ * @brief MbedtlsTransport connection timing and I/O counters
+ *
+ * The phase times tell where a slow connect() went: DNS, TCP, the
+ * handshake, or the PKCS#11 signature inside it. They describe the last
+ * successful connect(); the other counters add up every connection since
+ * construction or resetStatistics().
+ */
+struct TlsStatistics
+{
+    // Last successful connect()
+    std::chrono::microseconds resolveTime{0};    ///< DNS resolution of the hostname
+    std::chrono::microseconds tcpConnectTime{0}; ///< TCP connection
+    std::chrono::microseconds handshakeTime{0};  ///< TLS handshake, signTime included
+    std::chrono::microseconds signTime{0};       ///< PKCS#11 signature, 0 when the session was resumed
+    std::chrono::microseconds firstByteTime{0};  ///< Handshake end to the first byte received (0 until then)
+    std::chrono::microseconds connectTime{0};    ///< Whole connect(), failed attempts and backoff included
+    uint32_t connectAttempts{0};                 ///< Attempts the last connect() made
+
+    // All connections
+    uint32_t connects{0};                  ///< connect() calls that succeeded
+    uint32_t connectFailures{0};           ///< connect() calls that gave up
+    uint64_t bytesSent{0};                 ///< Application bytes sent
+    uint64_t bytesReceived{0};             ///< Application bytes received
+    uint64_t recordsSent{0};               ///< TLS records sent
+    uint64_t recordsReceived{0};           ///< TLS records received
+    std::chrono::microseconds sendTime{0}; ///< Time in send() and sendv() writes
+    std::chrono::microseconds recvTime{0}; ///< Time in recv() reads, socket waits included
+
+    /**
+     * @brief Reset all statistics to zero
+     */
+    void reset()
+    {
+        *this = TlsStatistics{};
+    }
+};
+
 /**
  * @brief Concrete implementation of ITlsTransport using MbedTLS and PKCS#11
  *
@@ -68,9 +115,15 @@ namespace tls
  * }
  * @endcode
  *
- * @note This class is NOT thread-safe for concurrent operations on the same
- *       instance. Use separate instances or external synchronization for
- *       concurrent connections.
+ * @note One task may send while another receives: send() and recv() take
+ *       separate locks, which MbedTLS allows for one context as long as
+ *       renegotiation (the only read-path write besides alerts) is off. The
+ *       C wrapper disables it. Two concurrent senders, or two concurrent
+ *       receivers, are serialised.
+ *
+ * @note While connect() or connectAsync() is in progress, send(), recv()
+ *       and waitForData() return ESP_ERR_INVALID_STATE at once instead of
+ *       waiting for the retries. Do not move a transport that is connecting.
  */
 class MbedtlsTransport : public ITlsTransport
 {
@@ -110,6 +163,12 @@ public:
      * The connection uses exponential backoff retry logic (default: 500ms to 5000ms,
      * 5 attempts) as configured in TlsConfig.
      *
+     * With TlsConfig::sessionResumption, the session of the previous
+     * connection to the same host and port is offered first. When the
+     * server accepts it the handshake takes one round trip and skips the
+     * PKCS#11 private-key signature. A resumed handshake that fails is
+     * retried at once as a full handshake.
+     *
      * @param[in] config TLS configuration including server details, certificates, and options
      * @return ESP_OK on success
      * @return ESP_ERR_INVALID_ARG if config is invalid
@@ -118,10 +177,30 @@ public:
      * @return ESP_ERR_INVALID_STATE if already connected
      *
      * @note This operation is synchronous and may take several seconds if retries
-     *       are needed.
+     *       are needed. Use connectAsync() to keep the calling task free.
      */
     esp_err_t connect(const TlsConfig &config) override;
 
+    /**
+     * @brief Run connect() in a background task
+     *
+     * The task (TlsConfig::connectTaskStackSize bytes of stack) runs the
+     * same retries as connect(), sleeping a full-jitter backoff (a random
+     * delay up to the exponential ceiling) between attempts, then calls
+     * the callback and exits. With TlsConfig::jitterFirstAttempt the first
+     * attempt is delayed too. disconnect() cuts a backoff short and the
+     * callback gets ESP_ERR_INVALID_STATE.
+     *
+     * The callback may call connectAsync() again.
+     *
+     * @param[in] config TLS configuration, copied
+     * @param[in] callback Called from the background task with the result
+     * @return ESP_OK if the task was started
+     * @return ESP_ERR_INVALID_STATE if connected, connecting or being destroyed
+     * @return ESP_ERR_NO_MEM if the task could not be created
+     */
+    esp_err_t connectAsync(const TlsConfig &config, ConnectCallback callback) override;
+
     /**
      * @brief Gracefully close the TLS connection
      *
@@ -148,12 +227,38 @@ public:
      */
     esp_err_t send(const void *data, size_t size, size_t *bytesSent) override;
 
+    /**
+     * @brief Send several buffers under one lock acquisition
+     *
+     * Consecutive segments smaller than SENDV_STAGING_SIZE are copied into
+     * a stack buffer and written together, so a packet made of a short
+     * header, topic and CRC does not cost one TLS record per piece. Larger
+     * segments are written directly.
+     *
+     * @param[in] segments Buffers to send, in order
+     * @param[in] count Number of segments
+     * @param[out] bytesSent Total bytes sent (less than requested on a short write)
+     * @return ESP_OK on success
+     * @return ESP_ERR_INVALID_ARG if segments or bytesSent is NULL
+     * @return ESP_ERR_INVALID_STATE if not connected
+     * @return ESP_FAIL if send operation fails
+     */
+    esp_err_t sendv(const TlsSegment *segments, size_t count, size_t *bytesSent) override;
+
+    /// Stack buffer used by sendv() to coalesce small segments
+    static constexpr size_t SENDV_STAGING_SIZE = 256;
+
     /**
      * @brief Receive data from the established TLS connection
      *
      * This function blocks until at least one byte is received or a timeout occurs.
      * The timeout is configured in TlsConfig (default: 3000ms).
      *
+     * Reads smaller than TlsConfig::recvBufferSize decrypt as much of the
+     * current record as fits into the receive buffer, and later reads are
+     * copied from it without calling MbedTLS. coreMQTT's few-byte header
+     * reads then cost a memcpy instead of a trip through the TLS stack.
+     *
      * @param[out] buffer Pointer to buffer to store received data
      * @param[in] size Maximum number of bytes to receive
      * @param[out] bytesReceived Number of bytes actually received (may be NULL)
@@ -167,6 +272,30 @@ public:
      */
     esp_err_t recv(void *buffer, size_t size, size_t *bytesReceived) override;
 
+    /**
+     * @brief Wait until recv() would return data without blocking
+     *
+     * Polls the socket (or the already-decrypted bytes) without
+     * holding the transport mutex, so send() is not blocked meanwhile.
+     * The socket is selected together with an eventfd that cancelWait()
+     * signals.
+     *
+     * @param[in] timeoutMs Maximum time to wait
+     * @return ESP_OK if data is ready
+     * @return ESP_ERR_TIMEOUT if nothing arrived within timeoutMs, or the wait was cancelled
+     * @return ESP_ERR_INVALID_STATE if not connected
+     * @return ESP_FAIL if polling the socket fails
+     */
+    esp_err_t waitForData(uint32_t timeoutMs) override;
+
+    /**
+     * @brief Wake a task blocked in waitForData()
+     *
+     * Safe to call from any task. Without the eventfd VFS (registration
+     * failed) waits simply run to their timeout.
+     */
+    void cancelWait() override;
+
     /**
      * @brief Check if currently connected to server
      *
@@ -186,7 +315,90 @@ public:
      */
     void *getNetworkContext() noexcept override;
 
+    /**
+     * @brief Whether a session is saved for the next connect()
+     *
+     * @return true if the next connect() will offer a session for resumption
+     */
+    bool hasSession() const;
+
+    /**
+     * @brief Forget the saved session, in RAM and in NVS
+     *
+     * Call after rotating the client certificate so the next connection
+     * authenticates with the new one, together with
+     * CertificateCache::invalidate() for the certificate's label.
+     */
+    void clearSession();
+
+    /**
+     * @brief Heap taken by the current connection
+     *
+     * Drop in free 8-bit heap across connect(): MbedTLS contexts and I/O
+     * buffers, the receive buffer and the handshake's leftovers. Compare
+     * TlsBufferProfile choices with it. Other tasks allocating during the
+     * handshake skew the figure.
+     *
+     * @return Bytes, or 0 if never connected or not measurable (host builds)
+     */
+    size_t heapUsage() const
+    {
+        return heapUsage_;
+    }
+
+    /**
+     * @brief Connection timing and I/O counters
+     *
+     * Does not wait for a recv() in progress: its receive counters are
+     * then those before the call.
+     */
+    TlsStatistics getStatistics() const;
+
+    /**
+     * @brief Reset the statistics to zero
+     *
+     * Waits for a recv() in progress, like disconnect().
+     */
+    void resetStatistics();
+
+    /**
+     * @brief Cipher suite negotiated for the current connection
+     *
+     * @return MbedTLS suite name (e.g. "TLS-ECDHE-RSA-WITH-AES-128-GCM-SHA256"),
+     *         or empty when not connected
+     */
+    std::string cipherSuite() const;
+
 private:
+    /**
+     * @brief Body of connect(), called with connecting_ set
+     */
+    esp_err_t establish(const TlsConfig &config);
+
+    /**
+     * @brief Entry point of the connectAsync() task
+     */
+    static void connectTaskEntry(void *param);
+
+    /**
+     * @brief Sleep between attempts, cut short by disconnect()
+     *
+     * @return false if disconnect() cancelled the connection
+     */
+    bool backoffWait(uint32_t delayMs);
+
+    /**
+     * @brief Take mutex_ then recvMutex_, for operations that change the connection
+     *
+     * @return false if a mutex is missing or cannot be taken
+     */
+    bool lockAll();
+
+    /**
+     * @brief Release the mutexes taken by lockAll()
+     */
+    void unlockAll();
+
     /**
      * @brief Convert MbedTLS PKCS11 status to esp_err_t
      *
@@ -211,13 +423,34 @@ private:
      */
     const char **setupAlpnProtocols(uint16_t port);
 
+    /**
+     * @brief Select the saved session for the configured server
+     *
+     * Loads it from NVS if the session is persisted and none is in RAM.
+     * A session saved for another server is discarded.
+     */
+    void prepareSession(const TlsConfig &config);
+
+    /**
+     * @brief Save the session just established for the next connect()
+     *
+     * Called once per connection, right after the handshake, and writes
+     * NVS only when the session changed.
+     */
+    void saveSession();
+
+    /**
+     * @brief Drop the saved session (caller holds the mutex)
+     */
+    void dropSession();
+
 private:
     // Connection state
     bool connected_; ///< Connection state flag
 
-    // MbedTLS and network contexts (allocated on heap)
-    std::unique_ptr<MbedtlsPkcs11Context_t> tlsContext_; ///< MbedTLS context
-    std::unique_ptr<NetworkContext_t> networkContext_;   ///< Network context
+    // MbedTLS and network contexts (MemoryRole::HOT)
+    memory::UniquePtr<MbedtlsPkcs11Context_t> tlsContext_; ///< MbedTLS context
+    memory::UniquePtr<NetworkContext_t> networkContext_;   ///< Network context
 
     // PKCS#11 session (RAII wrapper)
     Pkcs11Session pkcs11Session_; ///< PKCS#11 session wrapper
@@ -225,8 +458,42 @@ private:
     // ALPN protocol storage (must persist for connection lifetime)
     const char *alpnProtos_[2]; ///< ALPN protocol list (NULL-terminated)
 
-    // Thread safety mutex
-    SemaphoreHandle_t mutex_; ///< Mutex for thread-safe operations
+    // Thread safety mutexes
+    SemaphoreHandle_t mutex_;     ///< Guards connection state and the send path
+    SemaphoreHandle_t recvMutex_; ///< Guards the receive path; taken after mutex_
+
+    // Wake-up for waitForData()
+    int wakeFd_; ///< eventfd signalled by cancelWait(), or -1
+
+    // Connection attempts in progress
+    std::atomic<bool> connecting_;       ///< connect() or a connectAsync() task is retrying
+    std::atomic<bool> closing_;          ///< Destructor running: no new connectAsync()
+    std::atomic<uint32_t> connectTasks_; ///< connectAsync() tasks not yet finished
+    SemaphoreHandle_t connectAbort_;     ///< Given by disconnect() to end backoffWait()
+
+    // Session resumption
+    bool resumeSessions_;                        ///< TlsConfig::sessionResumption of the current connection
+    bool sessionCleared_;                        ///< Remove the NVS copy once storage is opened
+    std::vector<uint8_t> session_;               ///< Serialized session of the last connection, or empty
+    std::string sessionPeer_;                    ///< "host:port" session_ belongs to
+    std::string sessionKey_;                     ///< NVS key for the session
+    std::unique_ptr<NvsStorage> sessionStorage_; ///< Persists session_ when a namespace is configured
+
+    // Certificates from CertificateCache, held for the connection's lifetime
+    std::shared_ptr<mbedtls_x509_crt> caChain_;    ///< Parsed root CA chain, or nullptr
+    std::shared_ptr<mbedtls_x509_crt> clientCert_; ///< Parsed client certificate, or nullptr
+
+    // Receive buffer (decrypted bytes not yet returned by recv())
+    memory::Buffer recvBuffer_; ///< Allocated on connect() (MemoryRole::BULK), empty when unbuffered
+    size_t recvCapacity_;       ///< Size of recvBuffer_
+    size_t recvStart_;                      ///< First unread byte
+    size_t recvEnd_;                        ///< One past the last buffered byte
+
+    size_t heapUsage_; ///< Measured by the last successful connect()
+
+    // Instrumentation (guarded by mutex_); the live connection's counters are in tlsContext_->stats
+    TlsStatistics statistics_;                  ///< Last connect() phases and finished connections' I/O
+    mutable MbedtlsPkcs11Stats_t recvSnapshot_; ///< Receive counters read while recvMutex_ was free
 };
 
 } // namespace tls
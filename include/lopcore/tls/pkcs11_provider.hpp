@@ -8,12 +8,18 @@
 
 #pragma once
 
+#include <map>
+#include <string>
+#include <utility>
+
 #include <esp_err.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 
 // Forward declare PKCS#11 types to avoid exposing full API
 typedef unsigned long CK_SESSION_HANDLE;
+typedef unsigned long CK_OBJECT_HANDLE;
+typedef unsigned long CK_OBJECT_CLASS;
 typedef unsigned long CK_RV;
 struct CK_FUNCTION_LIST;
 
@@ -65,6 +71,33 @@ public:
      */
     esp_err_t getFunctionList(CK_FUNCTION_LIST **functionList);
 
+    /**
+     * @brief Find a PKCS#11 object by label and class
+     *
+     * The handle is cached after the first lookup, so repeated connects
+     * skip the token's linear object search. Call invalidateObject() after
+     * writing or destroying an object with that label.
+     *
+     * @param label Object label (CKA_LABEL)
+     * @param objectClass Object class, e.g. CKO_PRIVATE_KEY
+     * @param[out] handle Object handle
+     * @return ESP_OK on success, ESP_ERR_NOT_FOUND if there is no such object,
+     *         ESP_ERR_INVALID_ARG if handle is nullptr, or an error from getSession()
+     */
+    esp_err_t findObject(const std::string &label, CK_OBJECT_CLASS objectClass, CK_OBJECT_HANDLE *handle);
+
+    /**
+     * @brief Forget the cached handles of every object with a label
+     *
+     * @param label Label of an object that was written or destroyed
+     */
+    void invalidateObject(const std::string &label);
+
+    /**
+     * @brief Forget every cached object handle
+     */
+    void invalidateObjects();
+
     /**
      * @brief Initialize PKCS#11 library
      *
@@ -112,6 +145,11 @@ private:
      */
     esp_err_t initializeInternal();
 
+    /**
+     * @brief Initialize and open the session if needed (caller holds the mutex)
+     */
+    esp_err_t ensureSession();
+
     /**
      * @brief Open PKCS#11 session (internal)
      */
@@ -132,6 +170,9 @@ private:
     CK_FUNCTION_LIST *functionList_;
     bool initialized_;
 
+    // Object handles by class and label; valid until the session closes
+    std::map<std::pair<CK_OBJECT_CLASS, std::string>, CK_OBJECT_HANDLE> objects_;
+
     // Thread safety
     SemaphoreHandle_t mutex_;
 };
@@ -12,17 +12,91 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
 #include <esp_err.h>
 #include <lopcore/logging/logger.hpp>
+#include <lopcore/task/task_profile.hpp>
 
 namespace lopcore
 {
 namespace tls
 {
 
+/**
+ * @brief Presets trading TLS buffer RAM against throughput
+ *
+ * Each profile picks the maximum fragment length asked of the server and
+ * the transport's receive buffer size. MbedTLS 3.x built with
+ * CONFIG_MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH shrinks its 16 KB input and
+ * output buffers to the negotiated fragment length once the handshake is
+ * done, so a smaller fragment means less RAM for every idle connection.
+ */
+enum class TlsBufferProfile
+{
+    LOW_MEMORY, ///< 1 KB records, small receive buffer: many connections, slow bulk transfers
+    BALANCED,   ///< CONFIG_LOPCORE_TLS_MAX_FRAGMENT_LENGTH records (default 4 KB)
+    THROUGHPUT  ///< Full 16 KB records and no fragment negotiation: OTA downloads
+};
+
+/**
+ * @brief Maximum fragment length of TlsBufferProfile::BALANCED
+ *
+ * CONFIG_LOPCORE_TLS_MAX_FRAGMENT_LENGTH rounded down to a length RFC 6066
+ * allows (512, 1024, 2048 or 4096); 0 (no negotiation) above 4096.
+ */
+constexpr uint16_t defaultMaxFragmentLength()
+{
+#ifdef CONFIG_LOPCORE_TLS_MAX_FRAGMENT_LENGTH
+    return CONFIG_LOPCORE_TLS_MAX_FRAGMENT_LENGTH > 4096   ? 0
+           : CONFIG_LOPCORE_TLS_MAX_FRAGMENT_LENGTH >= 4096 ? 4096
+           : CONFIG_LOPCORE_TLS_MAX_FRAGMENT_LENGTH >= 2048 ? 2048
+           : CONFIG_LOPCORE_TLS_MAX_FRAGMENT_LENGTH >= 1024 ? 1024
+                                                            : 512;
+#else
+    return 4096;
+#endif
+}
+
+/**
+ * @brief IANA IDs for TlsConfig::cipherSuites
+ *
+ * ESP32 chips accelerate AES (GCM included) and SHA-2, so the AES-GCM
+ * suites are the fast ones; ChaCha20-Poly1305 always runs in software.
+ */
+namespace cipher_suite
+{
+constexpr uint16_t TLS13_AES_128_GCM_SHA256 = 0x1301;
+constexpr uint16_t TLS13_AES_256_GCM_SHA384 = 0x1302;
+constexpr uint16_t TLS13_CHACHA20_POLY1305_SHA256 = 0x1303;
+constexpr uint16_t ECDHE_RSA_AES_128_CBC_SHA256 = 0xC027;
+constexpr uint16_t ECDHE_ECDSA_AES_128_GCM_SHA256 = 0xC02B;
+constexpr uint16_t ECDHE_ECDSA_AES_256_GCM_SHA384 = 0xC02C;
+constexpr uint16_t ECDHE_RSA_AES_128_GCM_SHA256 = 0xC02F;
+constexpr uint16_t ECDHE_RSA_AES_256_GCM_SHA384 = 0xC030;
+constexpr uint16_t ECDHE_RSA_CHACHA20_POLY1305_SHA256 = 0xCCA8;
+constexpr uint16_t ECDHE_ECDSA_CHACHA20_POLY1305_SHA256 = 0xCCA9;
+} // namespace cipher_suite
+
+/**
+ * @brief IANA IDs for TlsConfig::keyExchangeGroups
+ *
+ * P-256 and P-384 run on the bignum (MPI) accelerator, and P-256 on the ECC
+ * accelerator of chips that have one (ESP32-C2/C6/H2); X25519 is software.
+ */
+namespace tls_group
+{
+constexpr uint16_t SECP256R1 = 0x0017;
+constexpr uint16_t SECP384R1 = 0x0018;
+constexpr uint16_t X25519 = 0x001D;
+} // namespace tls_group
+
+constexpr size_t MAX_CIPHER_SUITES = 8;       ///< Most entries in TlsConfig::cipherSuites
+constexpr size_t MAX_KEY_EXCHANGE_GROUPS = 4; ///< Most entries in TlsConfig::keyExchangeGroups
+
 /**
  * @brief Unified TLS connection configuration
  *
@@ -72,9 +146,34 @@ struct TlsConfig
     // ========================================================================
     // Retry configuration
     // ========================================================================
-    uint32_t maxRetries{5};                        ///< Maximum connection retry attempts
+    uint32_t maxRetries{5};                        ///< Maximum connection retry attempts (0 = no limit)
     std::chrono::milliseconds retryBaseDelay{500}; ///< Base retry delay (exponential backoff)
     std::chrono::milliseconds retryMaxDelay{5000}; ///< Maximum retry delay
+    bool jitterFirstAttempt{false};                ///< Wait 0..retryBaseDelay before the first attempt too
+    /// Stack of the connectAsync() task, handshake included (default from the task profile)
+    uint32_t connectTaskStackSize{task::getSettings(task::TaskRole::TLS_CONNECT).stackSize};
+
+    // ========================================================================
+    // Session resumption
+    // ========================================================================
+    bool sessionResumption{true};    ///< Reconnect with the previous session (no private-key signature)
+    std::string sessionNvsNamespace; ///< NVS namespace to keep the session across reboots (empty = RAM only)
+
+    // ========================================================================
+    // Receive buffering
+    // ========================================================================
+    size_t recvBufferSize{1024}; ///< Decrypted bytes kept for later small recv() calls (0 = unbuffered)
+
+    // ========================================================================
+    // Record size (see TlsBufferProfile)
+    // ========================================================================
+    uint16_t maxFragmentLength{defaultMaxFragmentLength()}; ///< 512/1024/2048/4096, or 0 for 16 KB records
+
+    // ========================================================================
+    // Algorithms offered, most preferred first (empty = MbedTLS defaults)
+    // ========================================================================
+    std::vector<uint16_t> cipherSuites;      ///< cipher_suite IDs; ones MbedTLS lacks are skipped
+    std::vector<uint16_t> keyExchangeGroups; ///< tls_group IDs for the (EC)DHE key exchange
 
     /**
      * @brief Validate configuration
@@ -122,6 +221,29 @@ struct TlsConfig
             }
         }
 
+        // RFC 6066 only defines these lengths
+        if (maxFragmentLength != 0 && maxFragmentLength != 512 && maxFragmentLength != 1024 &&
+            maxFragmentLength != 2048 && maxFragmentLength != 4096)
+        {
+            LOPCORE_LOGE(TAG, "Validation failed: max fragment length must be 0, 512, 1024, 2048 or 4096");
+            hasError = true;
+        }
+
+        if (cipherSuites.size() > MAX_CIPHER_SUITES || keyExchangeGroups.size() > MAX_KEY_EXCHANGE_GROUPS)
+        {
+            LOPCORE_LOGE(TAG, "Validation failed: at most %u cipher suites and %u key exchange groups",
+                         static_cast<unsigned>(MAX_CIPHER_SUITES),
+                         static_cast<unsigned>(MAX_KEY_EXCHANGE_GROUPS));
+            hasError = true;
+        }
+
+        // NVS namespaces are limited to 15 characters
+        if (sessionNvsNamespace.size() > 15)
+        {
+            LOPCORE_LOGE(TAG, "Validation failed: session NVS namespace must be at most 15 characters");
+            hasError = true;
+        }
+
         if (hasError)
         {
             LOPCORE_LOGE(TAG, "TLS configuration is invalid");
@@ -310,6 +432,134 @@ public:
         return *this;
     }
 
+    /**
+     * @brief Delay the first attempt by a random 0..retryBaseDelay
+     *
+     * Set for reconnects, so a fleet dropped by the same outage does not
+     * hit the server in one wave.
+     */
+    TlsConfigBuilder &jitterFirstAttempt(bool enable = true)
+    {
+        config_.jitterFirstAttempt = enable;
+        return *this;
+    }
+
+    /**
+     * @brief Enable/disable TLS session resumption on reconnect
+     */
+    TlsConfigBuilder &sessionResumption(bool enable)
+    {
+        config_.sessionResumption = enable;
+        return *this;
+    }
+
+    /**
+     * @brief Keep the resumption session in NVS so it survives a reboot
+     *
+     * The session holds the connection's master secret; use an encrypted
+     * NVS partition.
+     */
+    TlsConfigBuilder &persistSession(const std::string &nvsNamespace)
+    {
+        config_.sessionNvsNamespace = nvsNamespace;
+        return *this;
+    }
+
+    /**
+     * @brief Set the receive buffer size
+     *
+     * Reads smaller than the buffer decrypt as much of the current TLS
+     * record as fits and serve the following reads from memory; larger
+     * reads go straight to MbedTLS. 0 disables buffering.
+     */
+    TlsConfigBuilder &recvBufferSize(size_t size)
+    {
+        config_.recvBufferSize = size;
+        return *this;
+    }
+
+    /**
+     * @brief Set the maximum fragment length asked of the server
+     *
+     * @param length 512, 1024, 2048 or 4096; 0 keeps 16 KB records. Servers
+     *               without the RFC 6066 extension (AWS IoT Core among them)
+     *               ignore it, and their records stay 16 KB.
+     */
+    TlsConfigBuilder &maxFragmentLength(uint16_t length)
+    {
+        config_.maxFragmentLength = length;
+        return *this;
+    }
+
+    /**
+     * @brief Apply a buffer profile (maximum fragment length and receive buffer)
+     *
+     * Call before maxFragmentLength() or recvBufferSize() to override one of
+     * the profile's choices.
+     */
+    TlsConfigBuilder &bufferProfile(TlsBufferProfile profile)
+    {
+        switch (profile)
+        {
+            case TlsBufferProfile::LOW_MEMORY:
+                config_.maxFragmentLength = 1024;
+                config_.recvBufferSize = 256;
+                break;
+            case TlsBufferProfile::BALANCED:
+                config_.maxFragmentLength = defaultMaxFragmentLength();
+                config_.recvBufferSize = 1024;
+                break;
+            case TlsBufferProfile::THROUGHPUT:
+                config_.maxFragmentLength = 0;
+                config_.recvBufferSize = 4096;
+                break;
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Set the cipher suites offered, most preferred first
+     *
+     * @param suites cipher_suite IDs, at most MAX_CIPHER_SUITES; empty
+     *               restores the MbedTLS defaults
+     */
+    TlsConfigBuilder &cipherSuites(const std::vector<uint16_t> &suites)
+    {
+        config_.cipherSuites = suites;
+        return *this;
+    }
+
+    /**
+     * @brief Set the key exchange groups offered, most preferred first
+     *
+     * @param groups tls_group IDs, at most MAX_KEY_EXCHANGE_GROUPS; empty
+     *               restores the MbedTLS defaults
+     */
+    TlsConfigBuilder &keyExchangeGroups(const std::vector<uint16_t> &groups)
+    {
+        config_.keyExchangeGroups = groups;
+        return *this;
+    }
+
+    /**
+     * @brief Offer only algorithms the ESP32 crypto accelerators speed up
+     *
+     * AES-GCM suites (TLS 1.3 first, then ECDHE with ECDSA or RSA server
+     * keys, so AWS IoT Core's RSA certificates still work) over P-256, then
+     * P-384. Servers that only offer ChaCha20-Poly1305 or X25519 will fail
+     * the handshake. examples/08_tls_benchmark measures the difference.
+     */
+    TlsConfigBuilder &preferHardwareCrypto()
+    {
+        config_.cipherSuites = {
+            cipher_suite::TLS13_AES_128_GCM_SHA256,       cipher_suite::TLS13_AES_256_GCM_SHA384,
+            cipher_suite::ECDHE_ECDSA_AES_128_GCM_SHA256, cipher_suite::ECDHE_RSA_AES_128_GCM_SHA256,
+            cipher_suite::ECDHE_ECDSA_AES_256_GCM_SHA384, cipher_suite::ECDHE_RSA_AES_256_GCM_SHA384,
+        };
+        config_.keyExchangeGroups = {tls_group::SECP256R1, tls_group::SECP384R1};
+        return *this;
+    }
+
     /**
      * @brief Build and return the configuration
      *
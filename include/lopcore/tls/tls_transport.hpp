@@ -10,6 +10,8 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 
 #include <esp_err.h>
 
@@ -21,6 +23,15 @@ namespace tls
 // Forward declare config type
 struct TlsConfig;
 
+/**
+ * @brief One buffer of a vectored send
+ */
+struct TlsSegment
+{
+    const void *data; ///< Bytes to send
+    size_t size;      ///< Number of bytes
+};
+
 /**
  * @brief Abstract interface for TLS transport operations
  *
@@ -51,6 +62,38 @@ public:
      */
     virtual esp_err_t connect(const TlsConfig &config) = 0;
 
+    /**
+     * @brief Called when a connectAsync() finishes
+     *
+     * @param result What connect() would have returned
+     */
+    using ConnectCallback = std::function<void(esp_err_t result)>;
+
+    /**
+     * @brief Establish the connection without blocking the caller
+     *
+     * Runs connect(), retries included, in the background and reports the
+     * outcome through the callback, called from the background task.
+     * disconnect() cancels a connection still retrying; the callback then
+     * gets ESP_ERR_INVALID_STATE. The default implementation connects
+     * synchronously and calls the callback before returning.
+     *
+     * @param[in] config TLS connection configuration, copied
+     * @param[in] callback Called once with the result, may be empty
+     * @return ESP_OK if the connection was started (the callback is called)
+     *         ESP_ERR_INVALID_STATE if connected or already connecting
+     *         ESP_ERR_NO_MEM if the background task could not be created
+     */
+    virtual esp_err_t connectAsync(const TlsConfig &config, ConnectCallback callback)
+    {
+        esp_err_t result = connect(config);
+        if (callback)
+        {
+            callback(result);
+        }
+        return ESP_OK;
+    }
+
     /**
      * @brief Disconnect from remote server
      *
@@ -75,6 +118,52 @@ public:
      */
     virtual esp_err_t send(const void *data, size_t size, size_t *bytesSent) = 0;
 
+    /**
+     * @brief Send several buffers as one contiguous stream
+     *
+     * Lets callers send a packet built from separate pieces (header, topic,
+     * payload blocks) without first copying them into one buffer. The
+     * default implementation calls send() once per segment; transports may
+     * override it to hold their lock once or coalesce small segments.
+     *
+     * @param[in] segments Buffers to send, in order (empty segments are skipped)
+     * @param[in] count Number of segments
+     * @param[out] bytesSent Total bytes sent (less than the sum of sizes on a short write)
+     * @return ESP_OK if the bytes reported in bytesSent were sent
+     *         ESP_ERR_INVALID_ARG if segments or bytesSent is null
+     *         Otherwise the error returned by send()
+     */
+    virtual esp_err_t sendv(const TlsSegment *segments, size_t count, size_t *bytesSent)
+    {
+        if (segments == nullptr || bytesSent == nullptr)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        *bytesSent = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (segments[i].size == 0)
+            {
+                continue;
+            }
+
+            size_t sent = 0;
+            esp_err_t err = send(segments[i].data, segments[i].size, &sent);
+            if (err != ESP_OK)
+            {
+                return err;
+            }
+
+            *bytesSent += sent;
+            if (sent < segments[i].size)
+            {
+                break; // Short write: let the caller resume
+            }
+        }
+        return ESP_OK;
+    }
+
     /**
      * @brief Receive data from TLS connection
      *
@@ -91,6 +180,37 @@ public:
      */
     virtual esp_err_t recv(void *buffer, size_t size, size_t *bytesReceived) = 0;
 
+    /**
+     * @brief Wait until recv() can return data without blocking
+     *
+     * Lets callers wait for incoming data without holding their own locks
+     * for the whole receive timeout. The default implementation reports
+     * ESP_ERR_NOT_SUPPORTED, in which case callers fall back to recv().
+     *
+     * @param[in] timeoutMs Maximum time to wait
+     * @return ESP_OK if data is ready to be received
+     *         ESP_ERR_TIMEOUT if no data arrived within timeoutMs or cancelWait() was called
+     *         ESP_ERR_INVALID_STATE if not connected
+     *         ESP_ERR_NOT_SUPPORTED if the transport cannot wait for readiness
+     *         ESP_FAIL on other errors
+     */
+    virtual esp_err_t waitForData(uint32_t timeoutMs)
+    {
+        (void) timeoutMs;
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /**
+     * @brief Make a waitForData() call in another task return early
+     *
+     * If no wait is in progress, the next one returns at once instead, so
+     * a wake-up is never lost. The default implementation does nothing and
+     * waits run to their timeout.
+     */
+    virtual void cancelWait()
+    {
+    }
+
     /**
      * @brief Check if transport is connected
      *
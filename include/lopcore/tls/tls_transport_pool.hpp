@@ -0,0 +1,178 @@
+/**
+ * @file tls_transport_pool.hpp
+ * @brief Pool of connected TLS transports shared between protocol clients
+ *
+ * MQTT and HTTPS (OTA, device APIs) usually talk to the same endpoint.
+ * Each MbedtlsTransport costs a full handshake and about 40 KB of MbedTLS
+ * buffers, so a client that only needs a connection for a while borrows
+ * one from the pool and hands it back instead of opening its own.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <esp_err.h>
+
+#include "tls_config.hpp"
+#include "tls_transport.hpp"
+
+namespace lopcore
+{
+namespace tls
+{
+
+/**
+ * @brief TlsTransportPool limits
+ */
+struct TlsPoolConfig
+{
+    size_t maxTransports{2};                      ///< Most live TLS connections, parked or in use
+    std::chrono::milliseconds idleTimeout{60000}; ///< Parked connections idle longer are closed
+};
+
+/**
+ * @brief TlsTransportPool counters
+ */
+struct TlsPoolStats
+{
+    size_t live{0};      ///< Connections open, parked or in use
+    size_t parked{0};    ///< Connections waiting for reuse
+    uint32_t reused{0};  ///< acquire() calls served by a parked connection
+    uint32_t opened{0};  ///< acquire() calls that opened a new connection
+    uint32_t evicted{0}; ///< Parked connections closed to make room or when idle
+};
+
+/**
+ * @brief Hands out connected transports by server and reuses them
+ *
+ * acquire() returns a parked connection made with the same server,
+ * server authentication (verifyPeer, CA, name check, SNI) and client
+ * credentials and cipher settings if one is still healthy, or connects a
+ * new transport. A transport is used by one holder at a time: when the last
+ * copy of the returned shared_ptr goes away, a still-connected transport
+ * is parked for the next acquire(), and a disconnected one is destroyed.
+ *
+ * At most TlsPoolConfig::maxTransports connections exist at once. When
+ * the pool is full, the least recently parked connection is closed to
+ * make room; if every connection is in use, acquire() fails.
+ *
+ * Transports may outlive the pool; they are then destroyed on release.
+ * Thread-safe. Handshakes run without the pool lock held.
+ *
+ * Example usage:
+ * @code
+ * TlsTransportPool pool([] { return std::make_unique<MbedtlsTransport>(); });
+ *
+ * std::shared_ptr<ITlsTransport> transport;
+ * if (pool.acquire(otaTlsConfig, transport) == ESP_OK) {
+ *     // HTTPS request over transport...
+ * }
+ * transport.reset(); // Parked; the next acquire() skips the handshake
+ * @endcode
+ */
+class TlsTransportPool
+{
+public:
+    /**
+     * @brief Creates an unconnected transport for a new pool entry
+     */
+    using TransportFactory = std::function<std::unique_ptr<ITlsTransport>()>;
+
+    explicit TlsTransportPool(TransportFactory factory, const TlsPoolConfig &config = TlsPoolConfig());
+
+    /**
+     * @brief Close parked connections; transports in use are destroyed on release
+     */
+    ~TlsTransportPool();
+
+    TlsTransportPool(const TlsTransportPool &) = delete;
+    TlsTransportPool &operator=(const TlsTransportPool &) = delete;
+
+    /**
+     * @brief Borrow a connected transport for a server
+     *
+     * @param config TLS configuration; hostname, port, ALPN list and client
+     *               certificate label select which parked connections match
+     * @param[out] transport Connected transport, parked again when released
+     * @return ESP_OK on success
+     * @return ESP_ERR_NO_MEM if maxTransports connections are all in use
+     * @return Otherwise the error from the factory or ITlsTransport::connect()
+     */
+    esp_err_t acquire(const TlsConfig &config, std::shared_ptr<ITlsTransport> &transport);
+
+    /**
+     * @brief Close parked connections idle longer than TlsPoolConfig::idleTimeout
+     *
+     * Also done by every acquire(); call periodically to free RAM sooner.
+     *
+     * @return Number of connections closed
+     */
+    size_t reclaimIdle();
+
+    /**
+     * @brief Close every parked connection
+     */
+    void clear();
+
+    /**
+     * @brief Current counters
+     */
+    TlsPoolStats getStats() const;
+
+private:
+    struct Parked
+    {
+        std::string key;                          ///< Server and security settings, see keyFor()
+        std::unique_ptr<ITlsTransport> transport; ///< Connected, not in use
+        int64_t parkedAtUs;                       ///< esp_timer time of the release
+    };
+
+    // Pool state outliving the pool while transports are still in use
+    struct Shared
+    {
+        mutable std::mutex mutex;
+        TlsPoolConfig config;
+        std::vector<Parked> parked; ///< Oldest first
+        TlsPoolStats stats;         ///< live and parked kept current
+    };
+
+    /**
+     * @brief Every TlsConfig field that affects whom the connection reaches and trusts
+     *
+     * "host:port|alpn,...|flags|caCertPath|certLabel|keyLabel|suites|groups|fragment";
+     * timeouts, retries and session settings are left out.
+     */
+    static std::string keyFor(const TlsConfig &config);
+
+    /**
+     * @brief No unexpected data pending, so the connection can be handed out again
+     */
+    static bool isReusable(ITlsTransport &transport);
+
+    /**
+     * @brief Park a released transport, or destroy it
+     */
+    static void release(const std::weak_ptr<Shared> &weak, std::string key, ITlsTransport *transport);
+
+    /**
+     * @brief Wrap a transport in a shared_ptr that releases it to the pool
+     */
+    std::shared_ptr<ITlsTransport> lend(std::string key, std::unique_ptr<ITlsTransport> transport);
+
+    TransportFactory factory_;       ///< Creates transports for new entries
+    std::shared_ptr<Shared> shared_; ///< Also referenced weakly by lent transports
+};
+
+} // namespace tls
+} // namespace lopcore
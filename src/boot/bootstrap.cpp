@@ -0,0 +1,483 @@
+/**
+ * @file bootstrap.cpp
+ * @brief Dependency-ordered, parallel subsystem start-up
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/boot/bootstrap.hpp"
+
+#include <algorithm>
+#include <new>
+
+#ifdef ESP_PLATFORM
+#include "freertos/task.h"
+#else
+#include <chrono>
+#endif
+
+#include "lopcore/logging/logger.hpp"
+#include "lopcore/task/task_profile.hpp"
+
+static const char *TAG = "Bootstrap";
+
+namespace lopcore
+{
+namespace boot
+{
+
+const char *stateName(StepState state)
+{
+    switch (state)
+    {
+        case StepState::PENDING:
+            return "pending";
+        case StepState::DEFERRED:
+            return "deferred";
+        case StepState::RUNNING:
+            return "running";
+        case StepState::DONE:
+            return "done";
+        case StepState::FAILED:
+            return "failed";
+        case StepState::SKIPPED:
+            return "skipped";
+        default:
+            return "unknown";
+    }
+}
+
+Bootstrap::Bootstrap(const BootstrapConfig &config, TimeSource timeSource)
+    : config_(config), timeSource_(timeSource)
+{
+#ifdef ESP_PLATFORM
+    progress_ = xSemaphoreCreateBinary();
+#endif
+}
+
+Bootstrap::~Bootstrap()
+{
+#ifdef ESP_PLATFORM
+    if (progress_ != nullptr)
+    {
+        vSemaphoreDelete(progress_);
+    }
+#endif
+}
+
+Bootstrap::Step &Bootstrap::add(const std::string &name, StepFunction function)
+{
+    auto step = std::make_unique<Step>();
+    step->name_ = name;
+    step->function_ = std::move(function);
+    step->phase_.name = name;
+    step->index_ = steps_.size();
+    steps_.push_back(std::move(step));
+    return *steps_.back();
+}
+
+esp_err_t Bootstrap::prepare()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (prepared_ || prepareResult_ != ESP_OK)
+    {
+        return prepareResult_;
+    }
+
+    auto find = [this](const std::string &name) -> Step * {
+        for (const auto &step : steps_)
+        {
+            if (step->name_ == name)
+            {
+                return step.get();
+            }
+        }
+        return nullptr;
+    };
+
+    for (const auto &step : steps_)
+    {
+        if (find(step->name_) != step.get())
+        {
+            LOPCORE_LOGE(TAG, "Step '%s' added twice", step->name_.c_str());
+            prepareResult_ = ESP_ERR_INVALID_ARG;
+            return prepareResult_;
+        }
+        for (const auto &name : step->after_)
+        {
+            Step *dependency = find(name);
+            if (dependency == nullptr)
+            {
+                LOPCORE_LOGE(TAG, "Step '%s' needs unknown step '%s'", step->name_.c_str(), name.c_str());
+                prepareResult_ = ESP_ERR_INVALID_ARG;
+                return prepareResult_;
+            }
+            step->dependencies_.push_back(dependency);
+        }
+        step->phase_.state = step->lazy_ ? StepState::DEFERRED : StepState::PENDING;
+    }
+
+    // Kahn's algorithm: steps never freed of their dependencies are on a cycle
+    std::vector<size_t> unresolved(steps_.size());
+    for (size_t i = 0; i < steps_.size(); i++)
+    {
+        unresolved[i] = steps_[i]->dependencies_.size();
+    }
+    size_t resolved = 0;
+    bool progress = true;
+    while (progress)
+    {
+        progress = false;
+        for (size_t i = 0; i < steps_.size(); i++)
+        {
+            if (unresolved[i] != 0)
+            {
+                continue;
+            }
+            unresolved[i] = SIZE_MAX;
+            resolved++;
+            progress = true;
+            for (size_t j = 0; j < steps_.size(); j++)
+            {
+                const auto &dependencies = steps_[j]->dependencies_;
+                if (unresolved[j] != SIZE_MAX)
+                {
+                    unresolved[j] -= std::count(dependencies.begin(), dependencies.end(), steps_[i].get());
+                }
+            }
+        }
+    }
+    if (resolved != steps_.size())
+    {
+        LOPCORE_LOGE(TAG, "Step dependencies form a cycle");
+        prepareResult_ = ESP_ERR_INVALID_ARG;
+        return prepareResult_;
+    }
+
+    prepared_ = true;
+    return ESP_OK;
+}
+
+bool Bootstrap::satisfied(const Step &dependency)
+{
+    StepState state = dependency.phase_.state;
+    return state == StepState::DONE ||
+           (dependency.optional_ && (state == StepState::FAILED || state == StepState::SKIPPED));
+}
+
+bool Bootstrap::blocks(const Step &dependency)
+{
+    StepState state = dependency.phase_.state;
+    return !dependency.optional_ && (state == StepState::FAILED || state == StepState::SKIPPED);
+}
+
+void Bootstrap::execute(Step &step)
+{
+    std::lock_guard<std::mutex> running(step.runMutex_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        StepState state = step.phase_.state;
+        if (state == StepState::DONE || state == StepState::FAILED || state == StepState::SKIPPED)
+        {
+            return; // Ran through ensure() or run() meanwhile
+        }
+        step.phase_.state = StepState::RUNNING;
+        step.phase_.startUs = timeSource_();
+    }
+
+    esp_err_t result = step.function_ ? step.function_() : ESP_OK;
+
+    int64_t end = timeSource_();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        step.phase_.result = result;
+        step.phase_.durationUs = end - step.phase_.startUs;
+        step.phase_.state = result == ESP_OK ? StepState::DONE : StepState::FAILED;
+    }
+
+    if (result != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "Step '%s' failed: %s%s", step.name_.c_str(), esp_err_to_name(result),
+                     step.optional_ ? " (optional)" : "");
+    }
+}
+
+esp_err_t Bootstrap::ensure(const std::string &name)
+{
+    esp_err_t err = prepare();
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    for (const auto &step : steps_)
+    {
+        if (step->name_ == name)
+        {
+            return ensureStep(*step);
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t Bootstrap::ensureStep(Step &step)
+{
+    for (Step *dependency : step.dependencies_)
+    {
+        esp_err_t err = ensureStep(*dependency);
+        if (err != ESP_OK && !dependency->optional_)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (step.phase_.state == StepState::PENDING || step.phase_.state == StepState::DEFERRED)
+            {
+                step.phase_.state = StepState::SKIPPED;
+            }
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+
+    execute(step);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return step.phase_.state == StepState::SKIPPED ? ESP_ERR_INVALID_STATE : step.phase_.result;
+}
+
+esp_err_t Bootstrap::run()
+{
+    esp_err_t err = prepare();
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    // Lazy steps an eager step needs are run too
+    std::vector<bool> wanted(steps_.size(), false);
+    std::vector<Step *> marking;
+    for (const auto &step : steps_)
+    {
+        if (!step->lazy_)
+        {
+            marking.push_back(step.get());
+        }
+    }
+    while (!marking.empty())
+    {
+        Step *step = marking.back();
+        marking.pop_back();
+        if (!wanted[step->index_])
+        {
+            wanted[step->index_] = true;
+            marking.insert(marking.end(), step->dependencies_.begin(), step->dependencies_.end());
+        }
+    }
+
+    int64_t start = timeSource_();
+    std::vector<bool> started(steps_.size(), false);
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;)
+    {
+        bool pending = false; // Wanted steps still to start
+        bool launched = false;
+        for (size_t i = 0; i < steps_.size() && !launched; i++)
+        {
+            Step &step = *steps_[i];
+            if (!wanted[i] || started[i])
+            {
+                continue;
+            }
+
+            StepState state = step.phase_.state;
+            if (state == StepState::DONE || state == StepState::FAILED || state == StepState::SKIPPED)
+            {
+                started[i] = true; // Already run through ensure()
+                continue;
+            }
+
+            bool blocked = std::any_of(step.dependencies_.begin(), step.dependencies_.end(),
+                                       [](const Step *dependency) { return blocks(*dependency); });
+            if (blocked)
+            {
+                step.phase_.state = StepState::SKIPPED;
+                started[i] = true;
+                LOPCORE_LOGW(TAG, "Step '%s' skipped: a step it needs failed", step.name_.c_str());
+                continue;
+            }
+
+            bool ready = state != StepState::RUNNING &&
+                         std::all_of(step.dependencies_.begin(), step.dependencies_.end(),
+                                     [](const Step *dependency) { return satisfied(*dependency); });
+            if (!ready || (config_.maxParallel > 0 && running_ >= config_.maxParallel))
+            {
+                pending = true;
+                continue;
+            }
+
+            started[i] = true;
+            launched = true;
+            if (config_.maxParallel == 0 || !launch(step))
+            {
+                lock.unlock();
+                execute(step);
+                lock.lock();
+            }
+        }
+
+        if (launched)
+        {
+            continue; // Rescan: more may be ready now
+        }
+        if (running_ > 0)
+        {
+#ifdef ESP_PLATFORM
+            lock.unlock();
+            xSemaphoreTake(progress_, portMAX_DELAY);
+            lock.lock();
+#else
+            uint32_t running = running_;
+            progress_.wait(lock, [this, running] { return running_ != running; });
+#endif
+        }
+        else if (pending)
+        {
+            // What is left waits on a step another task is running through ensure()
+            lock.unlock();
+#ifdef ESP_PLATFORM
+            vTaskDelay(pdMS_TO_TICKS(10));
+#else
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+#endif
+            lock.lock();
+        }
+        else
+        {
+            break;
+        }
+    }
+    totalUs_ = timeSource_() - start;
+    lock.unlock();
+
+#ifndef ESP_PLATFORM
+    for (auto &thread : threads_)
+    {
+        thread.join();
+    }
+    threads_.clear();
+#endif
+
+    if (config_.logReport)
+    {
+        logReport();
+    }
+
+    std::lock_guard<std::mutex> relock(mutex_);
+    for (size_t i = 0; i < steps_.size(); i++)
+    {
+        if (wanted[i] && !steps_[i]->optional_ && steps_[i]->phase_.state != StepState::DONE)
+        {
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+bool Bootstrap::launch(Step &step)
+{
+    // Called with mutex_ held
+    auto *job = new (std::nothrow) Launch{this, &step};
+    if (job == nullptr)
+    {
+        return false;
+    }
+    running_++;
+
+#ifdef ESP_PLATFORM
+    task::TaskSettings settings = task::getSettings(task::TaskRole::BOOT_STEP);
+    if (step.stackSize_ != 0)
+    {
+        settings.stackSize = step.stackSize_;
+    }
+    if (task::spawn(task::TaskRole::BOOT_STEP, "lopcore_boot", taskEntry, job, settings) != ESP_OK)
+    {
+        running_--;
+        delete job;
+        return false;
+    }
+#else
+    threads_.emplace_back(taskEntry, job);
+#endif
+    return true;
+}
+
+void Bootstrap::taskEntry(void *arg)
+{
+    auto *job = static_cast<Launch *>(arg);
+    Bootstrap *self = job->owner;
+    Step *step = job->step;
+    delete job;
+
+    self->execute(*step);
+    self->finished();
+
+#ifdef ESP_PLATFORM
+    task::exitTask();
+#endif
+}
+
+void Bootstrap::finished()
+{
+    // Signalled under the lock: once run() sees running_ drop it may return
+    // and destroy this object, so nothing of it is touched after unlocking
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_--;
+#ifdef ESP_PLATFORM
+    xSemaphoreGive(progress_);
+#else
+    progress_.notify_all();
+#endif
+}
+
+std::vector<BootPhase> Bootstrap::report() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<BootPhase> phases;
+    phases.reserve(steps_.size());
+    for (const auto &step : steps_)
+    {
+        phases.push_back(step->phase_);
+    }
+    return phases;
+}
+
+int64_t Bootstrap::totalUs() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return totalUs_;
+}
+
+void Bootstrap::logReport() const
+{
+    std::vector<BootPhase> phases = report();
+    std::stable_sort(phases.begin(), phases.end(), [](const BootPhase &a, const BootPhase &b) {
+        bool aRan = a.state == StepState::DONE || a.state == StepState::FAILED;
+        bool bRan = b.state == StepState::DONE || b.state == StepState::FAILED;
+        return aRan != bRan ? aRan : a.startUs < b.startUs;
+    });
+
+    for (const auto &phase : phases)
+    {
+        if (phase.state == StepState::DONE || phase.state == StepState::FAILED)
+        {
+            LOPCORE_LOGI(TAG, "%-16s %-8s at %6lld ms, took %5lld ms", phase.name.c_str(), stateName(phase.state),
+                         static_cast<long long>(phase.startUs / 1000), static_cast<long long>(phase.durationUs / 1000));
+        }
+        else
+        {
+            LOPCORE_LOGI(TAG, "%-16s %s", phase.name.c_str(), stateName(phase.state));
+        }
+    }
+    LOPCORE_LOGI(TAG, "Boot steps finished in %lld ms", static_cast<long long>(totalUs() / 1000));
+}
+
+} // namespace boot
+} // namespace lopcore
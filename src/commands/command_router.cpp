@@ -0,0 +1,803 @@
+/**
+ * @file command_router.cpp
+ * @brief Cloud-to-device command routing over one wildcard subscription
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/commands/command_router.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include "lopcore/logging/logger.hpp"
+
+static const char *TAG = "CommandRouter";
+
+namespace lopcore
+{
+namespace commands
+{
+
+namespace
+{
+
+// =============================================================================
+// JSON
+// =============================================================================
+
+/**
+ * @brief Single pass over the top-level members of a JSON object
+ */
+class JsonScanner
+{
+public:
+    explicit JsonScanner(std::string_view json) : json_(json)
+    {
+    }
+
+    void skipSpace()
+    {
+        while (pos_ < json_.size() &&
+               (json_[pos_] == ' ' || json_[pos_] == '\t' || json_[pos_] == '\n' || json_[pos_] == '\r'))
+        {
+            pos_++;
+        }
+    }
+
+    bool at(char c)
+    {
+        skipSpace();
+        return pos_ < json_.size() && json_[pos_] == c;
+    }
+
+    bool done()
+    {
+        skipSpace();
+        return pos_ == json_.size();
+    }
+
+    void advance()
+    {
+        pos_++;
+    }
+
+    /**
+     * @brief Read the string starting at pos_
+     * @param contents Text between the quotes
+     * @param escaped Set if the contents hold a backslash escape
+     */
+    bool string(std::string_view &contents, bool &escaped)
+    {
+        size_t start = ++pos_;
+        escaped = false;
+        for (; pos_ < json_.size(); pos_++)
+        {
+            if (json_[pos_] == '\\')
+            {
+                escaped = true;
+                pos_++;
+            }
+            else if (json_[pos_] == '"')
+            {
+                contents = json_.substr(start, pos_++ - start);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Move past the object or array starting at pos_, strings included
+     */
+    bool nested(std::string_view &raw)
+    {
+        size_t start = pos_;
+        size_t depth = 0;
+        while (pos_ < json_.size())
+        {
+            char c = json_[pos_];
+            if (c == '"')
+            {
+                std::string_view unused;
+                bool escaped;
+                if (!string(unused, escaped))
+                {
+                    return false;
+                }
+                continue;
+            }
+            pos_++;
+            if (c == '[' || c == '{')
+            {
+                if (++depth > CommandArgs::MAX_DEPTH)
+                {
+                    return false;
+                }
+            }
+            else if ((c == ']' || c == '}') && --depth == 0)
+            {
+                raw = json_.substr(start, pos_ - start);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Read the number or literal starting at pos_
+     */
+    bool scalar(CommandArg &arg)
+    {
+        size_t start = pos_;
+        while (pos_ < json_.size() && std::string_view("-+.0123456789eEtrufalsn").find(json_[pos_]) !=
+                                          std::string_view::npos)
+        {
+            pos_++;
+        }
+        std::string_view literal = json_.substr(start, pos_ - start);
+        arg.text = literal;
+        if (literal == "true" || literal == "false")
+        {
+            arg.type = ArgType::BOOL;
+            arg.boolean = literal == "true";
+            return true;
+        }
+        if (literal == "null")
+        {
+            arg.type = ArgType::NULL_VALUE;
+            return true;
+        }
+        return number(literal, arg);
+    }
+
+private:
+    /**
+     * @brief Convert a number through a stack copy (strtod needs a terminator)
+     */
+    static bool number(std::string_view literal, CommandArg &arg)
+    {
+        char buffer[40];
+        if (literal.empty() || literal.size() >= sizeof(buffer) ||
+            literal.find_first_not_of("-+.0123456789eE") != std::string_view::npos)
+        {
+            return false;
+        }
+        literal.copy(buffer, literal.size());
+        buffer[literal.size()] = '\0';
+
+        char *end = nullptr;
+        if (literal.find_first_of(".eE") == std::string_view::npos)
+        {
+            errno = 0;
+            long long value = std::strtoll(buffer, &end, 10);
+            if (*end == '\0' && errno == 0)
+            {
+                arg.type = ArgType::INTEGER;
+                arg.integer = value;
+                arg.number = static_cast<double>(value);
+                return true;
+            }
+        }
+        double value = std::strtod(buffer, &end);
+        if (*end != '\0')
+        {
+            return false;
+        }
+        arg.type = ArgType::NUMBER;
+        arg.number = value;
+        return true;
+    }
+
+    std::string_view json_;
+    size_t pos_{0};
+};
+
+// =============================================================================
+// CBOR
+// =============================================================================
+
+// Major types of RFC 8949
+constexpr uint8_t CBOR_UNSIGNED = 0;
+constexpr uint8_t CBOR_NEGATIVE = 1;
+constexpr uint8_t CBOR_BYTES = 2;
+constexpr uint8_t CBOR_TEXT = 3;
+constexpr uint8_t CBOR_ARRAY = 4;
+constexpr uint8_t CBOR_MAP = 5;
+constexpr uint8_t CBOR_TAG = 6;
+constexpr uint8_t CBOR_SIMPLE = 7;
+
+/**
+ * @brief Bounds-checked CBOR reader for definite-length items
+ */
+class CborReader
+{
+public:
+    CborReader(const uint8_t *data, size_t length) : in_(data), end_(data + length)
+    {
+    }
+
+    bool done() const
+    {
+        return in_ == end_;
+    }
+
+    const uint8_t *position() const
+    {
+        return in_;
+    }
+
+    /**
+     * @brief Read an item head
+     * @param info Additional information (low five bits), for floats and simple values
+     * @return false on truncation or indefinite lengths
+     */
+    bool head(uint8_t &major, uint8_t &info, uint64_t &value)
+    {
+        if (in_ >= end_)
+        {
+            return false;
+        }
+        major = *in_ >> 5;
+        info = *in_++ & 0x1F;
+        if (info < 24)
+        {
+            value = info;
+            return true;
+        }
+        size_t bytes = info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : info == 27 ? 8 : 0;
+        if (bytes == 0 || static_cast<size_t>(end_ - in_) < bytes)
+        {
+            return false;
+        }
+        value = 0;
+        for (size_t i = 0; i < bytes; i++)
+        {
+            value = (value << 8) | *in_++;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Take length bytes of a string's content
+     */
+    const uint8_t *take(uint64_t length)
+    {
+        if (static_cast<uint64_t>(end_ - in_) < length)
+        {
+            return nullptr;
+        }
+        const uint8_t *data = in_;
+        in_ += length;
+        return data;
+    }
+
+    /**
+     * @brief Skip one value whose head was already read
+     */
+    bool skip(uint8_t major, uint64_t value, size_t depth)
+    {
+        switch (major)
+        {
+            case CBOR_UNSIGNED:
+            case CBOR_NEGATIVE:
+            case CBOR_SIMPLE:
+                return true;
+            case CBOR_BYTES:
+            case CBOR_TEXT:
+                return take(value) != nullptr;
+            case CBOR_ARRAY:
+            case CBOR_MAP:
+            case CBOR_TAG:
+            {
+                if (depth >= CommandArgs::MAX_DEPTH)
+                {
+                    return false;
+                }
+                uint64_t items = major == CBOR_MAP ? value * 2 : major == CBOR_TAG ? 1 : value;
+                // Every item takes at least one byte
+                if (items > static_cast<uint64_t>(end_ - in_))
+                {
+                    return false;
+                }
+                for (uint64_t i = 0; i < items; i++)
+                {
+                    uint8_t itemMajor;
+                    uint8_t itemInfo;
+                    uint64_t itemValue;
+                    if (!head(itemMajor, itemInfo, itemValue) || !skip(itemMajor, itemValue, depth + 1))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+private:
+    const uint8_t *in_;
+    const uint8_t *end_;
+};
+
+/**
+ * @brief Decode an IEEE 754 half-precision float
+ */
+double halfToDouble(uint16_t half)
+{
+    int exponent = (half >> 10) & 0x1F;
+    double mantissa = half & 0x3FF;
+    double value;
+    if (exponent == 0)
+    {
+        value = std::ldexp(mantissa, -24);
+    }
+    else if (exponent == 31)
+    {
+        value = mantissa == 0 ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+    }
+    else
+    {
+        value = std::ldexp(mantissa + 1024, exponent - 25);
+    }
+    return (half & 0x8000) ? -value : value;
+}
+
+} // namespace
+
+// =============================================================================
+// CommandArgs
+// =============================================================================
+
+bool CommandArgs::parse(const uint8_t *data, size_t length)
+{
+    count_ = 0;
+    cbor_ = false;
+    if (length == 0)
+    {
+        return true;
+    }
+    if (data == nullptr)
+    {
+        return false;
+    }
+    if ((data[0] >> 5) == CBOR_MAP)
+    {
+        cbor_ = true;
+        return parseCbor(data, length);
+    }
+    return parseJson(std::string_view(reinterpret_cast<const char *>(data), length));
+}
+
+CommandArg *CommandArgs::next(std::string_view key)
+{
+    if (count_ >= MAX_ARGS)
+    {
+        return nullptr;
+    }
+    CommandArg &arg = args_[count_++];
+    arg = CommandArg();
+    arg.key = key;
+    return &arg;
+}
+
+bool CommandArgs::parseJson(std::string_view json)
+{
+    JsonScanner scanner(json);
+    if (scanner.done())
+    {
+        return true;
+    }
+    if (!scanner.at('{'))
+    {
+        return false;
+    }
+    scanner.advance();
+    if (scanner.at('}'))
+    {
+        scanner.advance();
+        return scanner.done();
+    }
+
+    while (true)
+    {
+        std::string_view key;
+        bool escaped;
+        if (!scanner.at('"') || !scanner.string(key, escaped) || !scanner.at(':'))
+        {
+            return false;
+        }
+        scanner.advance();
+
+        CommandArg *arg = next(key);
+        if (arg == nullptr)
+        {
+            LOPCORE_LOGW(TAG, "Command has more than %zu arguments", MAX_ARGS);
+            return false;
+        }
+        bool ok;
+        if (scanner.at('"'))
+        {
+            arg->type = ArgType::STRING;
+            ok = scanner.string(arg->text, arg->escaped);
+        }
+        else if (scanner.at('{') || scanner.at('['))
+        {
+            arg->type = ArgType::RAW;
+            ok = scanner.nested(arg->text);
+        }
+        else
+        {
+            ok = scanner.scalar(*arg);
+        }
+        if (!ok)
+        {
+            return false;
+        }
+
+        if (scanner.at(','))
+        {
+            scanner.advance();
+            continue;
+        }
+        if (scanner.at('}'))
+        {
+            scanner.advance();
+            return scanner.done();
+        }
+        return false;
+    }
+}
+
+bool CommandArgs::parseCbor(const uint8_t *data, size_t length)
+{
+    CborReader reader(data, length);
+    uint8_t major;
+    uint8_t info;
+    uint64_t pairs;
+    if (!reader.head(major, info, pairs) || major != CBOR_MAP)
+    {
+        return false;
+    }
+
+    for (uint64_t i = 0; i < pairs; i++)
+    {
+        uint64_t keyLength;
+        const uint8_t *keyData;
+        if (!reader.head(major, info, keyLength) || major != CBOR_TEXT ||
+            (keyData = reader.take(keyLength)) == nullptr)
+        {
+            return false;
+        }
+        CommandArg *arg = next(std::string_view(reinterpret_cast<const char *>(keyData), keyLength));
+        if (arg == nullptr)
+        {
+            LOPCORE_LOGW(TAG, "Command has more than %zu arguments", MAX_ARGS);
+            return false;
+        }
+
+        const uint8_t *start = reader.position();
+        uint64_t value;
+        if (!reader.head(major, info, value))
+        {
+            return false;
+        }
+        switch (major)
+        {
+            case CBOR_UNSIGNED:
+            case CBOR_NEGATIVE:
+                if (value > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+                {
+                    arg->type = ArgType::NUMBER;
+                    arg->number = major == CBOR_UNSIGNED ? static_cast<double>(value) : -1.0 - value;
+                }
+                else
+                {
+                    arg->type = ArgType::INTEGER;
+                    arg->integer = major == CBOR_UNSIGNED ? static_cast<int64_t>(value)
+                                                          : -1 - static_cast<int64_t>(value);
+                    arg->number = static_cast<double>(arg->integer);
+                }
+                break;
+            case CBOR_TEXT:
+            {
+                const uint8_t *text = reader.take(value);
+                if (text == nullptr)
+                {
+                    return false;
+                }
+                arg->type = ArgType::STRING;
+                arg->text = std::string_view(reinterpret_cast<const char *>(text), value);
+                break;
+            }
+            case CBOR_SIMPLE:
+                if (info == 20 || info == 21)
+                {
+                    arg->type = ArgType::BOOL;
+                    arg->boolean = info == 21;
+                }
+                else if (info == 22 || info == 23)
+                {
+                    arg->type = ArgType::NULL_VALUE;
+                }
+                else if (info == 25)
+                {
+                    arg->type = ArgType::NUMBER;
+                    arg->number = halfToDouble(static_cast<uint16_t>(value));
+                }
+                else if (info == 26)
+                {
+                    uint32_t bits = static_cast<uint32_t>(value);
+                    float single;
+                    std::memcpy(&single, &bits, sizeof(single));
+                    arg->type = ArgType::NUMBER;
+                    arg->number = single;
+                }
+                else if (info == 27)
+                {
+                    arg->type = ArgType::NUMBER;
+                    std::memcpy(&arg->number, &value, sizeof(arg->number));
+                }
+                else
+                {
+                    return false;
+                }
+                break;
+            default:
+                // Byte strings, arrays, maps and tagged items stay encoded
+                if (!reader.skip(major, value, 0))
+                {
+                    return false;
+                }
+                arg->type = ArgType::RAW;
+                arg->text = std::string_view(reinterpret_cast<const char *>(start), reader.position() - start);
+                break;
+        }
+    }
+    return reader.done();
+}
+
+const CommandArg *CommandArgs::find(std::string_view key) const
+{
+    for (size_t i = 0; i < count_; i++)
+    {
+        if (args_[i].key == key)
+        {
+            return &args_[i];
+        }
+    }
+    return nullptr;
+}
+
+std::optional<int64_t> CommandArgs::getInt(std::string_view key) const
+{
+    const CommandArg *arg = find(key);
+    if (arg == nullptr || arg->type != ArgType::INTEGER)
+    {
+        return std::nullopt;
+    }
+    return arg->integer;
+}
+
+std::optional<double> CommandArgs::getDouble(std::string_view key) const
+{
+    const CommandArg *arg = find(key);
+    if (arg == nullptr || (arg->type != ArgType::INTEGER && arg->type != ArgType::NUMBER))
+    {
+        return std::nullopt;
+    }
+    return arg->number;
+}
+
+std::optional<bool> CommandArgs::getBool(std::string_view key) const
+{
+    const CommandArg *arg = find(key);
+    if (arg == nullptr || arg->type != ArgType::BOOL)
+    {
+        return std::nullopt;
+    }
+    return arg->boolean;
+}
+
+std::optional<std::string_view> CommandArgs::getString(std::string_view key) const
+{
+    const CommandArg *arg = find(key);
+    if (arg == nullptr || arg->type != ArgType::STRING)
+    {
+        return std::nullopt;
+    }
+    return arg->text;
+}
+
+// =============================================================================
+// CommandRouter
+// =============================================================================
+
+CommandRouter::CommandRouter(std::shared_ptr<mqtt::IMqttClient> client, const CommandRouterConfig &config)
+    : client_(std::move(client)),
+      config_(config),
+      filter_(config.topicPrefix + "/+"),
+      dispatcher_(config.dispatch),
+      started_(false)
+{
+}
+
+CommandRouter::~CommandRouter()
+{
+    stop();
+}
+
+esp_err_t CommandRouter::on(const std::string &id, CommandHandler handler)
+{
+    if (started_)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (id.empty() || id.find_first_of("/+#") != std::string::npos || !handler)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (const auto &entry : entries_)
+    {
+        if (entry->id == id)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    auto entry = std::make_unique<Entry>();
+    entry->id = id;
+    entry->handler = std::move(handler);
+    entries_.push_back(std::move(entry));
+    return ESP_OK;
+}
+
+esp_err_t CommandRouter::start()
+{
+    if (!client_ || config_.validate() != ESP_OK)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (started_)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    std::sort(entries_.begin(), entries_.end(),
+              [](const std::unique_ptr<Entry> &a, const std::unique_ptr<Entry> &b) { return a->id < b->id; });
+    for (auto &entry : entries_)
+    {
+        auto route = std::make_shared<mqtt::MqttHandler>();
+        const Entry *target = entry.get();
+        route->viewCallback = [this, target](const mqtt::MqttMessageView &view) { execute(*target, view); };
+        entry->route.assign(1, std::move(route));
+    }
+
+    if (config_.dispatch.workers > 0)
+    {
+        esp_err_t err = dispatcher_.start();
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+    }
+
+    // Arguments are parsed in place; only a dispatched command copies its payload
+    esp_err_t err = client_->subscribeView(
+        filter_, [this](const mqtt::MqttMessageView &view) { onMessage(view); }, config_.qos);
+    if (err != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "Cannot subscribe to %s: %s", filter_.c_str(), esp_err_to_name(err));
+        dispatcher_.stop();
+        return err;
+    }
+
+    started_ = true;
+    LOPCORE_LOGI(TAG, "Routing %zu commands on %s", entries_.size(), filter_.c_str());
+    return ESP_OK;
+}
+
+void CommandRouter::stop()
+{
+    if (!started_)
+    {
+        return;
+    }
+    client_->unsubscribe(filter_);
+    dispatcher_.stop();
+    started_ = false;
+}
+
+size_t CommandRouter::commandCount() const
+{
+    return entries_.size();
+}
+
+CommandRouterStats CommandRouter::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+const CommandRouter::Entry *CommandRouter::lookup(std::string_view id) const
+{
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), id,
+                               [](const std::unique_ptr<Entry> &entry, std::string_view key) {
+                                   return std::string_view(entry->id) < key;
+                               });
+    return it != entries_.end() && (*it)->id == id ? it->get() : nullptr;
+}
+
+void CommandRouter::onMessage(const mqtt::MqttMessageView &view)
+{
+    std::string_view topic = view.topic;
+    std::string_view id = topic.size() > filter_.size() - 1 ? topic.substr(filter_.size() - 1) : std::string_view();
+    const Entry *entry = lookup(id);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.received++;
+        if (entry == nullptr)
+        {
+            stats_.unknown++;
+        }
+        else if (view.payloadLength > config_.maxPayload)
+        {
+            stats_.malformed++;
+            entry = nullptr;
+        }
+    }
+    if (entry == nullptr)
+    {
+        LOPCORE_LOGW(TAG, "Dropped command on %.*s (%zu bytes)", static_cast<int>(topic.size()), topic.data(),
+                     view.payloadLength);
+        return;
+    }
+
+    if (config_.dispatch.workers == 0)
+    {
+        execute(*entry, view);
+        return;
+    }
+    if (dispatcher_.dispatch(view, entry->route) != ESP_OK)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.dropped++;
+    }
+}
+
+void CommandRouter::execute(const Entry &entry, const mqtt::MqttMessageView &view)
+{
+    CommandArgs args;
+    if (!args.parse(view.payload, view.payloadLength))
+    {
+        LOPCORE_LOGW(TAG, "Malformed arguments for command %s", entry.id.c_str());
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.malformed++;
+        return;
+    }
+
+    esp_err_t err = entry.handler(Command{entry.id, args, view});
+    if (err != ESP_OK)
+    {
+        LOPCORE_LOGW(TAG, "Command %s failed: %s", entry.id.c_str(), esp_err_to_name(err));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (err == ESP_OK)
+    {
+        stats_.executed++;
+    }
+    else
+    {
+        stats_.failed++;
+    }
+}
+
+} // namespace commands
+} // namespace lopcore
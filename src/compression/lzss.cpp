@@ -0,0 +1,180 @@
+/**
+ * @file lzss.cpp
+ * @brief LZSS token codec shared by the log, MQTT payload and storage compressors
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/compression/lzss.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace lopcore
+{
+namespace lzss
+{
+
+namespace
+{
+
+constexpr size_t HASH_BITS = 10;
+constexpr size_t HASH_SIZE = 1u << HASH_BITS;
+constexpr size_t INPUT_SIZE = 2 * WINDOW_SIZE;
+
+uint32_t hash3(const uint8_t *p)
+{
+    uint32_t value = static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+                     (static_cast<uint32_t>(p[2]) << 16);
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+} // namespace
+
+// ============================================================================
+// Encoder
+// ============================================================================
+
+Encoder::Encoder() : head_(new int32_t[HASH_SIZE])
+{
+    reset();
+}
+
+void Encoder::reset()
+{
+    std::fill(head_.get(), head_.get() + HASH_SIZE, -1);
+    group_[0] = 0;
+    used_ = 1;
+    count_ = 0;
+}
+
+size_t Encoder::encode(const uint8_t *buf,
+                       size_t pos,
+                       size_t length,
+                       size_t lookahead,
+                       std::vector<uint8_t> &out,
+                       size_t outputLimit)
+{
+    int32_t *head = head_.get();
+
+    while (length - pos >= lookahead && pos < length && out.size() < outputLimit)
+    {
+        size_t bestLength = 0;
+        size_t bestOffset = 0;
+        if (length - pos >= MIN_MATCH)
+        {
+            uint32_t h = hash3(buf + pos);
+            int32_t candidate = head[h];
+            head[h] = static_cast<int32_t>(pos);
+
+            if (candidate >= 0 && pos - static_cast<size_t>(candidate) <= WINDOW_SIZE)
+            {
+                size_t limit = std::min(length - pos, MAX_MATCH);
+                size_t n = 0;
+                while (n < limit && buf[candidate + n] == buf[pos + n])
+                {
+                    ++n;
+                }
+                if (n >= MIN_MATCH)
+                {
+                    bestLength = n;
+                    bestOffset = pos - static_cast<size_t>(candidate);
+                }
+            }
+        }
+
+        if (bestLength > 0)
+        {
+            size_t encodedOffset = bestOffset - 1;
+            group_[0] |= static_cast<uint8_t>(1u << count_);
+            group_[used_++] = static_cast<uint8_t>(encodedOffset & 0xFF);
+            group_[used_++] = static_cast<uint8_t>(((encodedOffset >> 8) & 0x0F) | ((bestLength - MIN_MATCH) << 4));
+
+            // Index the skipped positions so later repeats can find them
+            for (size_t i = 1; i < bestLength && pos + i + MIN_MATCH <= length; ++i)
+            {
+                head[hash3(buf + pos + i)] = static_cast<int32_t>(pos + i);
+            }
+            pos += bestLength;
+        }
+        else
+        {
+            group_[used_++] = buf[pos];
+            ++pos;
+        }
+
+        if (++count_ == 8)
+        {
+            writeGroup(out);
+        }
+    }
+    return pos;
+}
+
+void Encoder::shift(size_t count)
+{
+    int32_t shifted = static_cast<int32_t>(count);
+    for (size_t i = 0; i < HASH_SIZE; ++i)
+    {
+        head_[i] = head_[i] >= shifted ? head_[i] - shifted : -1;
+    }
+}
+
+void Encoder::finish(std::vector<uint8_t> &out)
+{
+    if (count_ > 0)
+    {
+        writeGroup(out);
+    }
+}
+
+void Encoder::writeGroup(std::vector<uint8_t> &out)
+{
+    out.insert(out.end(), group_, group_ + used_);
+    group_[0] = 0;
+    used_ = 1;
+    count_ = 0;
+}
+
+// ============================================================================
+// StreamEncoder
+// ============================================================================
+
+StreamEncoder::StreamEncoder() : buffer_(new uint8_t[INPUT_SIZE])
+{
+}
+
+void StreamEncoder::write(const uint8_t *data, size_t length, std::vector<uint8_t> &out)
+{
+    while (length > 0)
+    {
+        // Drop input older than the window to make room at the end
+        if (length_ == INPUT_SIZE)
+        {
+            size_t shift = pos_ - WINDOW_SIZE;
+            memmove(buffer_.get(), buffer_.get() + shift, length_ - shift);
+            length_ -= shift;
+            pos_ -= shift;
+            encoder_.shift(shift);
+        }
+
+        size_t n = std::min(length, INPUT_SIZE - length_);
+        memcpy(buffer_.get() + length_, data, n);
+        length_ += n;
+        data += n;
+        length -= n;
+
+        // Keep a full match of lookahead until more input or finish() arrives
+        pos_ = encoder_.encode(buffer_.get(), pos_, length_, MAX_MATCH, out);
+    }
+}
+
+void StreamEncoder::finish(std::vector<uint8_t> &out)
+{
+    pos_ = encoder_.encode(buffer_.get(), pos_, length_, 1, out);
+    encoder_.finish(out);
+}
+
+} // namespace lzss
+} // namespace lopcore
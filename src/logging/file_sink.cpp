@@ -16,20 +16,34 @@
 #include <cstdio>
 #include <cstring>
 
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+#include "lopcore/logging/log_compress.hpp"
+#include "lopcore/task/task_profile.hpp"
+
 namespace lopcore
 {
 
 FileSink::FileSink(const FileSinkConfig &config)
-    : config_(config), file_handle_(nullptr), bytes_written_(0), file_open_(false)
+    : config_(config), file_handle_(nullptr), buffer_capacity_(config.buffer_size + MAX_RECORD_SIZE),
+      buffer_(memory::MemoryRole::BULK), buffer_used_(0), bytes_written_(0), file_open_(false),
+      compressing_(false)
 {
-    buffer_.reserve(config_.buffer_size);
-    openFile();
+    // Without a buffer the file stays closed and records are dropped
+    if (buffer_.allocate(buffer_capacity_))
+    {
+        openFile();
+    }
 }
 
 FileSink::~FileSink()
 {
     flush();
     closeFile();
+    waitForCompression();
 }
 
 void FileSink::write(const LogMessage &msg)
@@ -39,11 +53,43 @@ void FileSink::write(const LogMessage &msg)
         return;
     }
 
-    std::string formatted = formatMessage(msg);
-    buffer_.append(formatted);
+    reserveRecord();
+
+    if (config_.binary)
+    {
+        // Text frame payload: "tag\0message"
+        const char *tag = msg.tag != nullptr ? msg.tag : "";
+        appendFrame(FRAME_TEXT, msg.level, msg.timestamp_ms, 0, 0, tag, strlen(tag) + 1, msg.message,
+                    strlen(msg.message));
+    }
+    else
+    {
+        buffer_used_ += formatMessage(msg, buffer() + buffer_used_, buffer_capacity_ - buffer_used_);
+    }
 
     // Flush if buffer is getting full
-    if (buffer_.size() >= config_.buffer_size)
+    if (buffer_used_ >= config_.buffer_size)
+    {
+        flush();
+    }
+}
+
+void FileSink::writeDeferred(const LogRecord &record)
+{
+    if (!file_open_)
+    {
+        return;
+    }
+
+    reserveRecord();
+
+    // Addresses are 32-bit on the ESP32; the decoder resolves them against the ELF
+    uint32_t tagAddress = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(record.tag));
+    uint32_t formatAddress = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(record.format));
+    appendFrame(FRAME_DEFERRED, record.level, record.timestamp_ms, tagAddress, formatAddress, record.message,
+                record.length, nullptr, 0);
+
+    if (buffer_used_ >= config_.buffer_size)
     {
         flush();
     }
@@ -51,17 +97,17 @@ void FileSink::write(const LogMessage &msg)
 
 void FileSink::flush()
 {
-    if (!file_open_ || buffer_.empty())
+    if (!file_open_ || buffer_used_ == 0)
     {
         return;
     }
 
     FILE *fp = static_cast<FILE *>(file_handle_);
-    size_t written = fwrite(buffer_.c_str(), 1, buffer_.size(), fp);
+    size_t written = fwrite(buffer(), 1, buffer_used_, fp);
     fflush(fp);
 
     bytes_written_ += written;
-    buffer_.clear();
+    buffer_used_ = 0;
 
     // Check if we need to rotate
     if (config_.auto_rotate)
@@ -101,13 +147,122 @@ bool FileSink::rotate()
     flush();
     closeFile();
 
-    // Delete old file
-    std::string path = getFilePath();
-    remove(path.c_str());
+    if (config_.max_generations == 0)
+    {
+        // Delete old file
+        std::string path = getFilePath();
+        remove(path.c_str());
+    }
+    else
+    {
+        shiftGenerations();
+    }
 
     // Reopen fresh file
     bytes_written_ = 0;
-    return openFile();
+    bool opened = openFile();
+
+    if (config_.max_generations > 0 && config_.compress_rotated)
+    {
+        startCompression();
+    }
+    return opened;
+}
+
+std::string FileSink::getGenerationPath(size_t generation, bool compressed) const
+{
+    std::string path = getFilePath() + "." + std::to_string(generation);
+    if (compressed)
+    {
+        path += ".lz";
+    }
+    return path;
+}
+
+void FileSink::waitForCompression()
+{
+#ifdef ESP_PLATFORM
+    while (compressing_.load())
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+#else
+    if (compress_thread_.joinable())
+    {
+        compress_thread_.join();
+    }
+#endif
+}
+
+void FileSink::shiftGenerations()
+{
+    // Generation 1 must not be renamed underneath the compressor
+    waitForCompression();
+
+    size_t oldest = config_.max_generations;
+    remove(getGenerationPath(oldest).c_str());
+    remove(getGenerationPath(oldest, true).c_str());
+
+    // Renames only; a missing generation simply fails to rename
+    for (size_t generation = oldest - 1; generation >= 1; --generation)
+    {
+        rename(getGenerationPath(generation).c_str(), getGenerationPath(generation + 1).c_str());
+        rename(getGenerationPath(generation, true).c_str(), getGenerationPath(generation + 1, true).c_str());
+    }
+
+    rename(getFilePath().c_str(), getGenerationPath(1).c_str());
+}
+
+namespace
+{
+
+struct CompressJob
+{
+    std::string source;
+    std::string dest;
+    std::atomic<bool> *busy;
+};
+
+} // namespace
+
+void FileSink::startCompression()
+{
+    auto *job = new CompressJob{getGenerationPath(1), getGenerationPath(1, true), &compressing_};
+    compressing_.store(true);
+
+#ifdef ESP_PLATFORM
+    if (task::spawn(task::TaskRole::LOG_COMPRESS, "lopcore_logz", compressTaskEntry, job,
+                    config_.compress_task_stack, config_.compress_task_priority) != ESP_OK)
+    {
+        // Keep the uncompressed generation rather than lose it
+        compressing_.store(false);
+        delete job;
+    }
+#else
+    compress_thread_ = std::thread(compressTaskEntry, job);
+#endif
+}
+
+void FileSink::compressTaskEntry(void *arg)
+{
+    std::unique_ptr<CompressJob> job(static_cast<CompressJob *>(arg));
+
+    if (compressLogFile(job->source.c_str(), job->dest.c_str()))
+    {
+        remove(job->source.c_str());
+    }
+    else
+    {
+        remove(job->dest.c_str());
+    }
+
+    std::atomic<bool> *busy = job->busy;
+    job.reset();
+    busy->store(false);
+
+#ifdef ESP_PLATFORM
+    task::exitTask();
+#endif
 }
 
 std::string FileSink::getFilePath() const
@@ -153,15 +308,69 @@ void FileSink::checkRotation()
     }
 }
 
-std::string FileSink::formatMessage(const LogMessage &msg) const
+void FileSink::reserveRecord()
+{
+    if (buffer_capacity_ - buffer_used_ < MAX_RECORD_SIZE)
+    {
+        flush();
+    }
+}
+
+size_t FileSink::formatMessage(const LogMessage &msg, char *out, size_t capacity) const
 {
-    char buffer[512];
+    if (capacity > MAX_RECORD_SIZE)
+    {
+        capacity = MAX_RECORD_SIZE;
+    }
 
     // Format: [timestamp] LEVEL (tag): message
-    snprintf(buffer, sizeof(buffer), "[%10lu] %c (%s): %s\n", (unsigned long) msg.timestamp_ms,
-             logLevelToChar(msg.level), msg.tag, msg.message);
+    int length = snprintf(out, capacity, "[%10lu] %c (%s): %s\n", (unsigned long) msg.timestamp_ms,
+                          logLevelToChar(msg.level), msg.tag, msg.message);
+    if (length < 0)
+    {
+        return 0;
+    }
+
+    size_t written = static_cast<size_t>(length);
+    if (written >= capacity)
+    {
+        // Truncated: keep the line terminator so the file stays line-oriented
+        written = capacity - 1;
+        out[written - 1] = '\n';
+    }
+    return written;
+}
 
-    return std::string(buffer);
+void FileSink::appendFrame(uint8_t marker, LogLevel level, uint32_t timestampMs, uint32_t tagAddress,
+                           uint32_t formatAddress, const char *first, size_t firstLength, const char *second,
+                           size_t secondLength)
+{
+    // Frames never exceed one record so they always fit after reserveRecord()
+    static constexpr size_t MAX_PAYLOAD = MAX_RECORD_SIZE - FRAME_HEADER_SIZE;
+    firstLength = firstLength < MAX_PAYLOAD ? firstLength : MAX_PAYLOAD;
+    secondLength = secondLength < MAX_PAYLOAD - firstLength ? secondLength : MAX_PAYLOAD - firstLength;
+    size_t payloadLength = firstLength + secondLength;
+
+    uint8_t header[FRAME_HEADER_SIZE];
+    header[0] = marker;
+    header[1] = static_cast<uint8_t>(level);
+    header[2] = static_cast<uint8_t>(payloadLength & 0xFF);
+    header[3] = static_cast<uint8_t>((payloadLength >> 8) & 0xFF);
+    for (int i = 0; i < 4; ++i)
+    {
+        header[4 + i] = static_cast<uint8_t>((timestampMs >> (8 * i)) & 0xFF);
+        header[8 + i] = static_cast<uint8_t>((tagAddress >> (8 * i)) & 0xFF);
+        header[12 + i] = static_cast<uint8_t>((formatAddress >> (8 * i)) & 0xFF);
+    }
+
+    char *out = buffer() + buffer_used_;
+    memcpy(out, header, sizeof(header));
+    memcpy(out + sizeof(header), first, firstLength);
+    if (second != nullptr && secondLength > 0)
+    {
+        memcpy(out + sizeof(header) + firstLength, second, secondLength);
+    }
+    buffer_used_ += sizeof(header) + payloadLength;
 }
 
 } // namespace lopcore
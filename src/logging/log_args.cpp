@@ -0,0 +1,618 @@
+/**
+ * @file log_args.cpp
+ * @brief Binary capture and replay of printf-style arguments
+ *
+ * Both directions share one conversion-spec parser so the producer and the
+ * consumer always agree on how many bytes each argument occupies.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/logging/log_args.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+namespace lopcore
+{
+
+namespace
+{
+
+enum class ArgKind : uint8_t
+{
+    INT32,
+    INT64,
+    DOUBLE,
+    POINTER,
+    STRING,
+    PERCENT,    ///< "%%" - no argument
+    UNSUPPORTED ///< %n, unknown or truncated spec
+};
+
+/**
+ * @brief One parsed conversion specification
+ */
+struct ConversionSpec
+{
+    const char *flags;  ///< First flag character
+    size_t flagsLength; ///< Number of flag characters
+    bool widthStar;     ///< Width given as '*'
+    int width;          ///< Literal width, -1 if absent
+    bool hasPrecision;  ///< '.' present
+    bool precisionStar; ///< Precision given as '*'
+    int precision;      ///< Literal precision (0 if only '.')
+    char length[3];     ///< Length modifier as written ("", "h", "ll", ...)
+    char conversion;    ///< Conversion character
+    ArgKind kind;       ///< Encoded representation
+    bool isUnsigned;    ///< Unsigned integer conversion
+};
+
+bool isWide(const char *length)
+{
+    return length[0] == 'l' || length[0] == 'j' || length[0] == 'z' || length[0] == 't' || length[0] == 'q';
+}
+
+/**
+ * @brief Parse the spec starting at p (which points at '%')
+ * @return Pointer one past the conversion character
+ */
+const char *parseSpec(const char *p, ConversionSpec &spec)
+{
+    ++p; // skip '%'
+
+    spec.flags = p;
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0' || *p == '\'')
+    {
+        ++p;
+    }
+    spec.flagsLength = static_cast<size_t>(p - spec.flags);
+
+    spec.widthStar = false;
+    spec.width = -1;
+    if (*p == '*')
+    {
+        spec.widthStar = true;
+        ++p;
+    }
+    else if (*p >= '0' && *p <= '9')
+    {
+        spec.width = 0;
+        while (*p >= '0' && *p <= '9')
+        {
+            spec.width = spec.width * 10 + (*p - '0');
+            ++p;
+        }
+    }
+
+    spec.hasPrecision = false;
+    spec.precisionStar = false;
+    spec.precision = 0;
+    if (*p == '.')
+    {
+        spec.hasPrecision = true;
+        ++p;
+        if (*p == '*')
+        {
+            spec.precisionStar = true;
+            ++p;
+        }
+        else
+        {
+            while (*p >= '0' && *p <= '9')
+            {
+                spec.precision = spec.precision * 10 + (*p - '0');
+                ++p;
+            }
+        }
+    }
+
+    size_t lengthChars = 0;
+    while (lengthChars < 2 &&
+           (*p == 'h' || *p == 'l' || *p == 'j' || *p == 'z' || *p == 't' || *p == 'L' || *p == 'q'))
+    {
+        spec.length[lengthChars++] = *p++;
+    }
+    spec.length[lengthChars] = '\0';
+
+    spec.conversion = *p;
+    spec.isUnsigned = false;
+    switch (spec.conversion)
+    {
+        case '%':
+            spec.kind = ArgKind::PERCENT;
+            break;
+        case 'd':
+        case 'i':
+            spec.kind = isWide(spec.length) ? ArgKind::INT64 : ArgKind::INT32;
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            spec.kind = isWide(spec.length) ? ArgKind::INT64 : ArgKind::INT32;
+            spec.isUnsigned = true;
+            break;
+        case 'c':
+            spec.kind = ArgKind::INT32;
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            spec.kind = ArgKind::DOUBLE;
+            break;
+        case 's':
+            spec.kind = ArgKind::STRING;
+            break;
+        case 'p':
+            spec.kind = ArgKind::POINTER;
+            break;
+        default:
+            spec.kind = ArgKind::UNSUPPORTED;
+            return p; // do not step past a NUL terminator
+    }
+
+    return p + 1;
+}
+
+// ============================================================================
+// Byte-buffer helpers
+// ============================================================================
+
+class Writer
+{
+public:
+    Writer(uint8_t *out, size_t capacity) : out_(out), capacity_(capacity), pos_(0)
+    {
+    }
+
+    template<typename T>
+    bool put(T value)
+    {
+        if (capacity_ - pos_ < sizeof(T))
+        {
+            return false;
+        }
+        memcpy(out_ + pos_, &value, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool putString(const char *str, int maxLength)
+    {
+        if (pos_ >= capacity_)
+        {
+            return false;
+        }
+        size_t limit = capacity_ - pos_ - 1;
+        if (limit > 255)
+        {
+            limit = 255;
+        }
+        if (maxLength >= 0 && static_cast<size_t>(maxLength) < limit)
+        {
+            limit = static_cast<size_t>(maxLength);
+        }
+        size_t len = 0;
+        while (len < limit && str[len] != '\0')
+        {
+            ++len;
+        }
+        out_[pos_++] = static_cast<uint8_t>(len);
+        memcpy(out_ + pos_, str, len);
+        pos_ += len;
+        return true;
+    }
+
+    size_t size() const
+    {
+        return pos_;
+    }
+
+private:
+    uint8_t *out_;
+    size_t capacity_;
+    size_t pos_;
+};
+
+class Reader
+{
+public:
+    Reader(const uint8_t *in, size_t length) : in_(in), length_(length), pos_(0)
+    {
+    }
+
+    template<typename T>
+    bool get(T &value)
+    {
+        if (length_ - pos_ < sizeof(T))
+        {
+            return false;
+        }
+        memcpy(&value, in_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool getString(const char *&str, size_t &len)
+    {
+        if (pos_ >= length_)
+        {
+            return false;
+        }
+        len = in_[pos_++];
+        if (length_ - pos_ < len)
+        {
+            return false;
+        }
+        str = reinterpret_cast<const char *>(in_ + pos_);
+        pos_ += len;
+        return true;
+    }
+
+private:
+    const uint8_t *in_;
+    size_t length_;
+    size_t pos_;
+};
+
+/**
+ * @brief Append text to the output buffer, tracking remaining space
+ */
+void emit(char *&out, size_t &remaining, const char *text, size_t len)
+{
+    if (remaining <= 1)
+    {
+        return;
+    }
+    size_t n = len < remaining - 1 ? len : remaining - 1;
+    memcpy(out, text, n);
+    out += n;
+    remaining -= n;
+    *out = '\0';
+}
+
+/**
+ * @brief snprintf into the output buffer, tracking remaining space
+ */
+template<typename T>
+void emitFormatted(char *&out, size_t &remaining, const char *spec, T value)
+{
+    if (remaining <= 1)
+    {
+        return;
+    }
+    int n = snprintf(out, remaining, spec, value);
+    if (n < 0)
+    {
+        return;
+    }
+    size_t advance = static_cast<size_t>(n) < remaining - 1 ? static_cast<size_t>(n) : remaining - 1;
+    out += advance;
+    remaining -= advance;
+}
+
+void emitString(char *&out, size_t &remaining, const char *spec, const char *str, int len)
+{
+    if (remaining <= 1)
+    {
+        return;
+    }
+    int n = snprintf(out, remaining, spec, len, str);
+    if (n < 0)
+    {
+        return;
+    }
+    size_t advance = static_cast<size_t>(n) < remaining - 1 ? static_cast<size_t>(n) : remaining - 1;
+    out += advance;
+    remaining -= advance;
+}
+
+/**
+ * @brief Build a self-contained snprintf spec (stars resolved, length normalized)
+ */
+void buildSpec(const ConversionSpec &spec, int width, int precision, char *buf, size_t size)
+{
+    char flags[8];
+    size_t flagsLength = spec.flagsLength < sizeof(flags) - 1 ? spec.flagsLength : sizeof(flags) - 1;
+    memcpy(flags, spec.flags, flagsLength);
+    flags[flagsLength] = '\0';
+
+    char widthText[12] = "";
+    if (width >= 0)
+    {
+        snprintf(widthText, sizeof(widthText), "%d", width);
+    }
+    else if (width < -1)
+    {
+        // Negative '*' width means left-justify
+        snprintf(widthText, sizeof(widthText), "-%d", -width);
+    }
+
+    char precisionText[13] = "";
+    if (spec.kind == ArgKind::STRING)
+    {
+        snprintf(precisionText, sizeof(precisionText), ".*");
+    }
+    else if (spec.hasPrecision && precision >= 0)
+    {
+        snprintf(precisionText, sizeof(precisionText), ".%d", precision);
+    }
+
+    const char *length = "";
+    if (spec.kind == ArgKind::INT64)
+    {
+        length = "ll";
+    }
+    else if (spec.kind == ArgKind::INT32 && spec.length[0] == 'h')
+    {
+        length = spec.length;
+    }
+
+    snprintf(buf, size, "%%%s%s%s%s%c", flags, widthText, precisionText, length, spec.conversion);
+}
+
+} // namespace
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+bool encodeLogArgs(const char *format, va_list args, uint8_t *out, size_t capacity, size_t &written)
+{
+    Writer writer(out, capacity);
+    written = 0;
+
+    const char *p = format;
+    while (*p != '\0')
+    {
+        if (*p != '%')
+        {
+            ++p;
+            continue;
+        }
+
+        ConversionSpec spec;
+        p = parseSpec(p, spec);
+
+        if (spec.kind == ArgKind::UNSUPPORTED)
+        {
+            return false;
+        }
+        if (spec.kind == ArgKind::PERCENT)
+        {
+            continue;
+        }
+
+        if (spec.widthStar && !writer.put<int32_t>(va_arg(args, int)))
+        {
+            return false;
+        }
+
+        int precision = spec.hasPrecision ? spec.precision : -1;
+        if (spec.precisionStar)
+        {
+            precision = va_arg(args, int);
+            if (!writer.put<int32_t>(precision))
+            {
+                return false;
+            }
+        }
+
+        bool ok = true;
+        switch (spec.kind)
+        {
+            case ArgKind::INT32:
+                ok = writer.put<int32_t>(va_arg(args, int));
+                break;
+
+            case ArgKind::INT64:
+            {
+                int64_t value;
+                const char *len = spec.length;
+                if (len[0] == 'l' && len[1] == '\0')
+                {
+                    value = spec.isUnsigned ? static_cast<int64_t>(va_arg(args, unsigned long))
+                                            : static_cast<int64_t>(va_arg(args, long));
+                }
+                else if (len[0] == 'z')
+                {
+                    value = static_cast<int64_t>(va_arg(args, size_t));
+                }
+                else if (len[0] == 't')
+                {
+                    value = static_cast<int64_t>(va_arg(args, ptrdiff_t));
+                }
+                else if (len[0] == 'j')
+                {
+                    value = spec.isUnsigned ? static_cast<int64_t>(va_arg(args, uintmax_t))
+                                            : static_cast<int64_t>(va_arg(args, intmax_t));
+                }
+                else
+                {
+                    value = spec.isUnsigned ? static_cast<int64_t>(va_arg(args, unsigned long long))
+                                            : static_cast<int64_t>(va_arg(args, long long));
+                }
+                ok = writer.put<int64_t>(value);
+                break;
+            }
+
+            case ArgKind::DOUBLE:
+                if (spec.length[0] == 'L')
+                {
+                    ok = writer.put<double>(static_cast<double>(va_arg(args, long double)));
+                }
+                else
+                {
+                    ok = writer.put<double>(va_arg(args, double));
+                }
+                break;
+
+            case ArgKind::POINTER:
+                ok = writer.put<uint64_t>(
+                    static_cast<uint64_t>(reinterpret_cast<uintptr_t>(va_arg(args, void *))));
+                break;
+
+            case ArgKind::STRING:
+            {
+                const char *str = va_arg(args, const char *);
+                ok = writer.putString(str != nullptr ? str : "(null)", precision);
+                break;
+            }
+
+            default:
+                break;
+        }
+
+        if (!ok)
+        {
+            return false;
+        }
+    }
+
+    written = writer.size();
+    return true;
+}
+
+size_t formatLogArgs(const char *format, const uint8_t *args, size_t argsLength, char *out, size_t capacity)
+{
+    if (capacity == 0)
+    {
+        return 0;
+    }
+
+    char *start = out;
+    size_t remaining = capacity;
+    *out = '\0';
+
+    Reader reader(args, argsLength);
+    const char *p = format;
+    while (*p != '\0')
+    {
+        const char *literal = p;
+        while (*p != '\0' && *p != '%')
+        {
+            ++p;
+        }
+        emit(out, remaining, literal, static_cast<size_t>(p - literal));
+        if (*p == '\0')
+        {
+            break;
+        }
+
+        ConversionSpec spec;
+        const char *specStart = p;
+        p = parseSpec(p, spec);
+
+        if (spec.kind == ArgKind::PERCENT)
+        {
+            emit(out, remaining, "%", 1);
+            continue;
+        }
+        if (spec.kind == ArgKind::UNSUPPORTED)
+        {
+            emit(out, remaining, specStart, static_cast<size_t>(p - specStart));
+            break;
+        }
+
+        int32_t width = spec.width;
+        int32_t precision = spec.hasPrecision ? spec.precision : -1;
+        if ((spec.widthStar && !reader.get(width)) || (spec.precisionStar && !reader.get(precision)))
+        {
+            emit(out, remaining, "?", 1);
+            break;
+        }
+
+        char specText[32];
+        buildSpec(spec, width, precision, specText, sizeof(specText));
+
+        bool ok = true;
+        switch (spec.kind)
+        {
+            case ArgKind::INT32:
+            {
+                int32_t value;
+                ok = reader.get(value);
+                if (ok && spec.isUnsigned)
+                {
+                    emitFormatted(out, remaining, specText, static_cast<unsigned int>(value));
+                }
+                else if (ok)
+                {
+                    emitFormatted(out, remaining, specText, static_cast<int>(value));
+                }
+                break;
+            }
+
+            case ArgKind::INT64:
+            {
+                int64_t value;
+                ok = reader.get(value);
+                if (ok && spec.isUnsigned)
+                {
+                    emitFormatted(out, remaining, specText, static_cast<unsigned long long>(value));
+                }
+                else if (ok)
+                {
+                    emitFormatted(out, remaining, specText, static_cast<long long>(value));
+                }
+                break;
+            }
+
+            case ArgKind::DOUBLE:
+            {
+                double value;
+                ok = reader.get(value);
+                if (ok)
+                {
+                    emitFormatted(out, remaining, specText, value);
+                }
+                break;
+            }
+
+            case ArgKind::POINTER:
+            {
+                uint64_t value;
+                ok = reader.get(value);
+                if (ok)
+                {
+                    emitFormatted(out, remaining, specText,
+                                  reinterpret_cast<void *>(static_cast<uintptr_t>(value)));
+                }
+                break;
+            }
+
+            case ArgKind::STRING:
+            {
+                const char *str;
+                size_t len;
+                ok = reader.getString(str, len);
+                if (ok)
+                {
+                    emitString(out, remaining, specText, str, static_cast<int>(len));
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+
+        if (!ok)
+        {
+            emit(out, remaining, "?", 1);
+            break;
+        }
+    }
+
+    return static_cast<size_t>(out - start);
+}
+
+} // namespace lopcore
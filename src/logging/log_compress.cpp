@@ -0,0 +1,110 @@
+/**
+ * @file log_compress.cpp
+ * @brief Streaming LZ compression for rotated log files
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/logging/log_compress.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "lopcore/compression/lzss.hpp"
+
+namespace lopcore
+{
+
+namespace
+{
+
+constexpr uint8_t MAGIC[4] = {'L', 'C', 'Z', '1'};
+constexpr size_t CHUNK_SIZE = 512; ///< Bytes moved per fread()/fwrite()
+
+} // namespace
+
+bool compressLogFile(const char *sourcePath, const char *destPath)
+{
+    FILE *in = fopen(sourcePath, "rb");
+    if (in == nullptr)
+    {
+        return false;
+    }
+    FILE *out = fopen(destPath, "wb");
+    if (out == nullptr)
+    {
+        fclose(in);
+        return false;
+    }
+
+    std::unique_ptr<lzss::StreamEncoder> encoder(new lzss::StreamEncoder());
+    std::vector<uint8_t> encoded;
+    encoded.reserve(2 * CHUNK_SIZE);
+    uint8_t chunk[CHUNK_SIZE];
+
+    bool ok = fwrite(MAGIC, 1, sizeof(MAGIC), out) == sizeof(MAGIC);
+    size_t got;
+    while (ok && (got = fread(chunk, 1, sizeof(chunk), in)) > 0)
+    {
+        encoder->write(chunk, got, encoded);
+        if (encoded.size() >= CHUNK_SIZE)
+        {
+            ok = fwrite(encoded.data(), 1, encoded.size(), out) == encoded.size();
+            encoded.clear();
+        }
+    }
+    if (ok)
+    {
+        encoder->finish(encoded);
+        ok = fwrite(encoded.data(), 1, encoded.size(), out) == encoded.size();
+    }
+
+    ok = ok && !ferror(in);
+    fclose(in);
+    ok = fclose(out) == 0 && ok;
+    return ok;
+}
+
+bool decompressLogFile(const char *sourcePath, const char *destPath)
+{
+    FILE *in = fopen(sourcePath, "rb");
+    if (in == nullptr)
+    {
+        return false;
+    }
+
+    uint8_t magic[sizeof(MAGIC)];
+    if (fread(magic, 1, sizeof(magic), in) != sizeof(magic) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        fclose(in);
+        return false;
+    }
+
+    FILE *out = fopen(destPath, "wb");
+    if (out == nullptr)
+    {
+        fclose(in);
+        return false;
+    }
+
+    lzss::Decoder decoder;
+    lzss::Decoder::Status status = lzss::Decoder::Status::OK;
+    uint8_t chunk[CHUNK_SIZE];
+    bool ok = true;
+    while (ok && status == lzss::Decoder::Status::OK)
+    {
+        size_t n = decoder.decode([in] { return fgetc(in); }, chunk, sizeof(chunk), status);
+        ok = fwrite(chunk, 1, n, out) == n;
+    }
+
+    ok = ok && status == lzss::Decoder::Status::END && !ferror(in);
+    fclose(in);
+    ok = fclose(out) == 0 && ok;
+    return ok;
+}
+
+} // namespace lopcore
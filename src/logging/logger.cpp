@@ -14,7 +14,13 @@
 #include <cstdio>
 #include <cstring>
 
+#include "lopcore/logging/log_args.hpp"
+#include "lopcore/task/task_profile.hpp"
+
 #ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
 #include "esp_timer.h"
 #else
 #include <chrono>
@@ -24,15 +30,26 @@ namespace lopcore
 {
 
 // Static buffer for formatted messages
-static constexpr size_t MAX_LOG_MESSAGE_SIZE = 256;
+static constexpr size_t MAX_LOG_MESSAGE_SIZE = LOG_RECORD_MESSAGE_SIZE;
 
-Logger::Logger() : global_level_(LogLevel::INFO)
+// Records written per drain pass before the drain task re-checks its stop flag
+static constexpr size_t DRAIN_BATCH_SIZE = 16;
+
+Logger::Logger()
+    : sinks_(new SinkList()), sink_readers_(0), global_level_(LogLevel::INFO), has_tag_levels_(false),
+      async_enabled_(false), async_producers_(0), drain_running_(false), dropped_count_(0), emitted_count_(0)
+#ifdef ESP_PLATFORM
+      ,
+      drain_task_(nullptr), drain_stopped_(true)
+#endif
 {
 }
 
 Logger::~Logger()
 {
+    disableAsync();
     flush();
+    delete sinks_.load();
 }
 
 Logger &Logger::getInstance()
@@ -43,28 +60,130 @@ Logger &Logger::getInstance()
 
 void Logger::addSink(std::unique_ptr<ILogSink> sink)
 {
+    if (!sink)
+    {
+        return;
+    }
+
     std::lock_guard<std::mutex> lock(mutex_);
-    sinks_.push_back(std::move(sink));
+    // Copy-on-write: entries are shared, only the list itself is new
+    std::unique_ptr<SinkList> next(new SinkList(*sinks_.load()));
+    next->push_back(std::make_shared<SinkEntry>(std::move(sink)));
+    publishSinks(std::move(next));
 }
 
 void Logger::clearSinks()
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    sinks_.clear();
+    std::unique_ptr<SinkList> removed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        removed = publishSinks(std::unique_ptr<SinkList>(new SinkList()));
+    }
+    // Destroyed outside the lock so sinks with worker tasks can join them
+    // even if those tasks are logging
+}
+
+size_t Logger::getSinkCount() const
+{
+    SinkListGuard guard(*this);
+    return guard.list().size();
+}
+
+LoggerStats Logger::getStats() const
+{
+    LoggerStats stats;
+    stats.recordsEmitted = emitted_count_.load(std::memory_order_relaxed);
+    stats.recordsDropped = dropped_count_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+std::vector<LogSinkStats> Logger::getSinkStats() const
+{
+    SinkListGuard guard(*this);
+    std::vector<LogSinkStats> result;
+    result.reserve(guard.list().size());
+    for (const auto &entry : guard.list())
+    {
+        LogSinkStats stats;
+        stats.name = entry->sink->getName();
+        stats.records = entry->records.load(std::memory_order_relaxed);
+        stats.bytes = entry->bytes.load(std::memory_order_relaxed);
+        result.push_back(stats);
+    }
+    return result;
+}
+
+void Logger::resetStats()
+{
+    emitted_count_.store(0, std::memory_order_relaxed);
+    dropped_count_.store(0, std::memory_order_relaxed);
+
+    SinkListGuard guard(*this);
+    for (const auto &entry : guard.list())
+    {
+        std::lock_guard<std::mutex> lock(entry->lock);
+        entry->records.store(0, std::memory_order_relaxed);
+        entry->bytes.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::unique_ptr<Logger::SinkList> Logger::publishSinks(std::unique_ptr<SinkList> next)
+{
+    std::unique_ptr<SinkList> previous(sinks_.exchange(next.release()));
+
+    // Grace period: readers that loaded the old pointer have all registered
+    // before the exchange, so once the count reaches zero nobody can see it.
+    // Writers are rare (boot, tests) and fan-outs are short.
+    while (sink_readers_.load() != 0)
+    {
+#ifdef ESP_PLATFORM
+        vTaskDelay(1);
+#else
+        std::this_thread::yield();
+#endif
+    }
+    return previous;
 }
 
 void Logger::setGlobalLevel(LogLevel level)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    global_level_ = level;
+    global_level_.store(level, std::memory_order_relaxed);
 }
 
 void Logger::setTagLevel(const char *tag, LogLevel level)
 {
-    // TODO: Implement per-tag filtering
-    // For now, just set global level
-    (void) tag;
-    setGlobalLevel(level);
+    if (tag == nullptr)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool found = false;
+    for (auto &entry : tag_levels_)
+    {
+        if (entry.first == tag)
+        {
+            entry.second = level;
+            found = true;
+            break;
+        }
+    }
+    if (!found)
+    {
+        tag_levels_.emplace_back(tag, level);
+    }
+
+    // Cached answers may now be stale; they are re-resolved on next use
+    tag_cache_.clear();
+    has_tag_levels_.store(true, std::memory_order_release);
+}
+
+void Logger::clearTagLevels()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    has_tag_levels_.store(false, std::memory_order_release);
+    tag_levels_.clear();
+    tag_cache_.clear();
 }
 
 void Logger::error(const char *tag, const char *format, ...)
@@ -115,15 +234,337 @@ void Logger::log(LogLevel level, const char *tag, const char *format, ...)
     va_end(args);
 }
 
+void Logger::dispatch(const LogMessage &msg)
+{
+    writeToSinks(msg, msg.message != nullptr ? strlen(msg.message) : 0);
+}
+
 void Logger::flush()
 {
+    drainPending();
+
+    SinkListGuard guard(*this);
+    for (const auto &entry : guard.list())
+    {
+        std::lock_guard<std::mutex> lock(entry->lock);
+        entry->sink->flush();
+    }
+}
+
+// ============================================================================
+// Asynchronous mode
+// ============================================================================
+
+bool Logger::enableAsync(const AsyncLogConfig &config)
+{
+    std::lock_guard<std::mutex> asyncLock(async_mutex_);
+
+    if (async_enabled_.load())
+    {
+        stopAsyncLocked();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ring_ = std::make_unique<LogRingBuffer<LogRecord>>(config.queueDepth);
+        async_config_ = config;
+    }
+
+    drain_running_.store(true);
+
+#ifdef ESP_PLATFORM
+    drain_stopped_.store(false);
+    TaskHandle_t handle = nullptr;
+    if (task::spawn(task::TaskRole::LOG_DRAIN, "lopcore_log", drainTaskEntry, this, config.drainTaskStackSize,
+                    config.drainTaskPriority, &handle) != ESP_OK)
+    {
+        drain_running_.store(false);
+        drain_stopped_.store(true);
+        std::lock_guard<std::mutex> lock(mutex_);
+        ring_.reset();
+        return false;
+    }
+    drain_task_ = handle;
+#else
+    drain_thread_ = std::thread(drainTaskEntry, this);
+#endif
+
+    async_enabled_.store(true);
+    return true;
+}
+
+void Logger::disableAsync()
+{
+    std::lock_guard<std::mutex> asyncLock(async_mutex_);
+    if (ring_)
+    {
+        stopAsyncLocked();
+    }
+}
+
+void Logger::stopAsyncLocked()
+{
+    // Stop producers from entering, then wait for in-flight pushes to finish
+    async_enabled_.store(false);
+    while (async_producers_.load() != 0)
+    {
+#ifdef ESP_PLATFORM
+        vTaskDelay(1);
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    drain_running_.store(false);
+    wakeDrainTask();
+
+#ifdef ESP_PLATFORM
+    while (!drain_stopped_.load())
+    {
+        vTaskDelay(1);
+    }
+    drain_task_ = nullptr;
+#else
+    if (drain_thread_.joinable())
+    {
+        drain_thread_.join();
+    }
+#endif
+
+    // Write whatever is left, then release the ring
+    drainPending();
     std::lock_guard<std::mutex> lock(mutex_);
-    for (auto &sink : sinks_)
+    ring_.reset();
+}
+
+size_t Logger::drainPending(size_t maxRecords)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!ring_)
+    {
+        return 0;
+    }
+
+    // Copy each record out so its slot is free again before the (possibly
+    // slow) sink write; DROP_OLDEST producers need that slot to make progress
+    LogRecord rec;
+    size_t drained = 0;
+    while (drained < maxRecords && ring_->tryPop([&rec](const LogRecord &slot) {
+        rec.level = slot.level;
+        rec.timestamp_ms = slot.timestamp_ms;
+        rec.tag = slot.tag;
+        rec.format = slot.format;
+        rec.length = slot.length;
+        memcpy(rec.message, slot.message, slot.isDeferred() ? slot.length : slot.length + 1u);
+    }))
     {
-        sink->flush();
+        writeRecordToSinks(rec);
+        ++drained;
     }
+
+    return drained;
+}
+
+void Logger::writeRecordToSinks(const LogRecord &rec)
+{
+    LogMessage msg;
+    msg.level = rec.level;
+    msg.timestamp_ms = rec.timestamp_ms;
+    msg.tag = rec.tag;
+    msg.message = rec.message;
+    msg.file = nullptr;
+    msg.line = 0;
+
+    // Deferred records are formatted at most once, and only if a text sink wants them
+    char text[MAX_LOG_MESSAGE_SIZE];
+    bool needsText = rec.isDeferred();
+    size_t textLength = rec.length;
+
+    SinkListGuard guard(*this);
+    for (const auto &entry : guard.list())
+    {
+        ILogSink *sink = entry->sink.get();
+        if (!sink->isEnabled() || rec.level > sink->getMinLevel())
+        {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(entry->lock);
+        if (rec.isDeferred() && sink->supportsDeferred())
+        {
+            sink->writeDeferred(rec);
+            entry->count(rec.length);
+            continue;
+        }
+
+        if (needsText)
+        {
+            textLength = formatLogArgs(rec.format, reinterpret_cast<const uint8_t *>(rec.message), rec.length,
+                                       text, sizeof(text));
+            msg.message = text;
+            needsText = false;
+        }
+        sink->write(msg);
+        entry->count(textLength);
+    }
+}
+
+bool Logger::enqueueAsync(LogLevel level, const char *tag, const char *format, va_list args)
+{
+    async_producers_.fetch_add(1);
+    if (!async_enabled_.load())
+    {
+        async_producers_.fetch_sub(1);
+        return false;
+    }
+
+    const uint32_t timestamp = getTimestampMs();
+    const bool deferred = async_config_.deferredFormatting;
+    auto fill = [&](LogRecord &rec) {
+        rec.level = level;
+        rec.timestamp_ms = timestamp;
+        rec.tag = tag;
+
+        if (deferred)
+        {
+            size_t encoded = 0;
+            va_list copy;
+            va_copy(copy, args);
+            uint8_t *out = reinterpret_cast<uint8_t *>(rec.message);
+            bool ok = encodeLogArgs(format, copy, out, sizeof(rec.message), encoded);
+            va_end(copy);
+            if (ok)
+            {
+                rec.format = format;
+                rec.length = static_cast<uint16_t>(encoded);
+                return;
+            }
+            // Arguments don't fit (or %n): fall back to eager formatting
+        }
+
+        rec.format = nullptr;
+        int len = vsnprintf(rec.message, sizeof(rec.message), format, args);
+        if (len < 0)
+        {
+            len = 0;
+            rec.message[0] = '\0';
+        }
+        else if (static_cast<size_t>(len) >= sizeof(rec.message))
+        {
+            len = sizeof(rec.message) - 1;
+        }
+        rec.length = static_cast<uint16_t>(len);
+    };
+
+    bool queued = ring_->tryPush(fill);
+
+    if (!queued)
+    {
+        switch (async_config_.overflowPolicy)
+        {
+            case LogOverflowPolicy::DROP_NEWEST:
+                break;
+
+            case LogOverflowPolicy::DROP_OLDEST:
+                // Make room from the producer side; retry a few times in case
+                // other producers grab the freed slot first
+                for (int attempt = 0; attempt < 4 && !queued; ++attempt)
+                {
+                    if (ring_->discardOldest())
+                    {
+                        dropped_count_.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    queued = ring_->tryPush(fill);
+                }
+                break;
+
+            case LogOverflowPolicy::BLOCK:
+            {
+                // The drain task itself must never wait on the ring it empties
+                if (isDrainTask())
+                {
+                    break;
+                }
+
+                const uint32_t start = getTimestampMs();
+                while (!queued && (getTimestampMs() - start) < async_config_.blockTimeoutMs)
+                {
+                    wakeDrainTask();
+#ifdef ESP_PLATFORM
+                    vTaskDelay(1);
+#else
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+                    queued = ring_->tryPush(fill);
+                }
+                break;
+            }
+        }
+    }
+
+    if (!queued)
+    {
+        dropped_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    else if (ring_->sizeApprox() >= ring_->capacity() / 2)
+    {
+        wakeDrainTask();
+    }
+
+    async_producers_.fetch_sub(1);
+    return true;
+}
+
+void Logger::wakeDrainTask()
+{
+#ifdef ESP_PLATFORM
+    TaskHandle_t handle = static_cast<TaskHandle_t>(drain_task_);
+    if (handle != nullptr)
+    {
+        xTaskNotifyGive(handle);
+    }
+#else
+    drain_wake_.notify_one();
+#endif
+}
+
+bool Logger::isDrainTask() const
+{
+#ifdef ESP_PLATFORM
+    return drain_task_ != nullptr && xTaskGetCurrentTaskHandle() == static_cast<TaskHandle_t>(drain_task_);
+#else
+    return std::this_thread::get_id() == drain_thread_.get_id();
+#endif
+}
+
+void Logger::drainTaskEntry(void *arg)
+{
+    Logger *self = static_cast<Logger *>(arg);
+
+    while (self->drain_running_.load())
+    {
+        if (self->drainPending(DRAIN_BATCH_SIZE) == 0)
+        {
+#ifdef ESP_PLATFORM
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(self->async_config_.drainIntervalMs));
+#else
+            std::unique_lock<std::mutex> lock(self->drain_wait_mutex_);
+            self->drain_wake_.wait_for(lock, std::chrono::milliseconds(self->async_config_.drainIntervalMs));
+#endif
+        }
+    }
+
+#ifdef ESP_PLATFORM
+    self->drain_stopped_.store(true);
+    task::exitTask();
+#endif
 }
 
+// ============================================================================
+// Core logging path
+// ============================================================================
+
 void Logger::logImpl(LogLevel level, const char *tag, const char *format, va_list args)
 {
     // Check if we should log this message
@@ -131,10 +572,26 @@ void Logger::logImpl(LogLevel level, const char *tag, const char *format, va_lis
     {
         return;
     }
+    emitted_count_.fetch_add(1, std::memory_order_relaxed);
+
+    // Async mode: queue and return without touching the sinks
+    if (isAsync() && enqueueAsync(level, tag, format, args))
+    {
+        return;
+    }
 
     // Format the message
     char buffer[MAX_LOG_MESSAGE_SIZE];
-    vsnprintf(buffer, sizeof(buffer), format, args);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    if (length < 0)
+    {
+        length = 0;
+        buffer[0] = '\0';
+    }
+    else if (static_cast<size_t>(length) >= sizeof(buffer))
+    {
+        length = sizeof(buffer) - 1;
+    }
 
     // Create log message
     LogMessage msg;
@@ -146,20 +603,64 @@ void Logger::logImpl(LogLevel level, const char *tag, const char *format, va_lis
     msg.line = 0;
 
     // Send to all sinks
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (auto &sink : sinks_)
+    writeToSinks(msg, static_cast<size_t>(length));
+}
+
+void Logger::writeToSinks(const LogMessage &msg, size_t length)
+{
+    // No logger-wide lock: tasks logging to different sinks never contend
+    SinkListGuard guard(*this);
+    for (const auto &entry : guard.list())
     {
-        if (sink->isEnabled() && level <= sink->getMinLevel())
+        ILogSink *sink = entry->sink.get();
+        if (sink->isEnabled() && msg.level <= sink->getMinLevel())
         {
+            std::lock_guard<std::mutex> lock(entry->lock);
             sink->write(msg);
+            entry->count(length);
         }
     }
 }
 
 bool Logger::shouldLog(LogLevel level, const char *tag) const
 {
-    (void) tag; // TODO: Implement per-tag filtering
-    return level <= global_level_;
+    const LogLevel globalLevel = global_level_.load(std::memory_order_relaxed);
+    if (tag == nullptr || !has_tag_levels_.load(std::memory_order_acquire))
+    {
+        return level <= globalLevel;
+    }
+
+    uint8_t tagLevel;
+    if (!tag_cache_.lookup(tag, tagLevel))
+    {
+        tagLevel = resolveTagLevel(tag);
+    }
+
+    if (tagLevel == LogTagCache::TAG_LEVEL_INHERIT)
+    {
+        return level <= globalLevel;
+    }
+    return static_cast<uint8_t>(level) <= tagLevel;
+}
+
+uint8_t Logger::resolveTagLevel(const char *tag) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    uint8_t tagLevel = LogTagCache::TAG_LEVEL_INHERIT;
+    for (const auto &entry : tag_levels_)
+    {
+        if (entry.first == tag)
+        {
+            tagLevel = static_cast<uint8_t>(entry.second);
+            break;
+        }
+    }
+
+    // Inserting under mutex_ keeps setTagLevel()'s clear() from racing a stale result.
+    // If the probe window is full the tag simply stays on this slow path.
+    tag_cache_.insert(tag, tagLevel);
+    return tagLevel;
 }
 
 uint32_t Logger::getTimestampMs() const
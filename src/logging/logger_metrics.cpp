@@ -0,0 +1,34 @@
+/**
+ * @file logger_metrics.cpp
+ * @brief Logger counters as sampled metrics
+ *
+ * Kept apart from logger.cpp so that only builds using the metrics
+ * registry link it.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/logging/logger.hpp"
+
+#include <string>
+
+#include "lopcore/metrics/metrics_registry.hpp"
+
+namespace lopcore
+{
+
+std::vector<metrics::Registration> Logger::registerMetrics(metrics::MetricsRegistry &registry,
+                                                           std::string_view prefix) const
+{
+    std::vector<metrics::Registration> registrations;
+    std::string name(prefix);
+    registrations.push_back(registry.sampledCounter(
+        name.append(".emitted"), [this] { return emitted_count_.load(std::memory_order_relaxed); }));
+    name.resize(prefix.size());
+    registrations.push_back(registry.sampledCounter(
+        name.append(".dropped"), [this] { return dropped_count_.load(std::memory_order_relaxed); }));
+    return registrations;
+}
+
+} // namespace lopcore
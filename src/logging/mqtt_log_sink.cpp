@@ -0,0 +1,375 @@
+/**
+ * @file mqtt_log_sink.cpp
+ * @brief MQTT log sink implementation
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/logging/mqtt_log_sink.hpp"
+
+#include "lopcore/task/task_profile.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <chrono>
+#endif
+
+namespace lopcore
+{
+
+// Smallest batch that still holds a full log line
+static constexpr size_t MIN_BATCH_BYTES = 128;
+
+// Longest single line: header plus a full LogRecord message
+static constexpr size_t MAX_LINE_SIZE = LOG_RECORD_MESSAGE_SIZE + 64;
+
+MqttLogSink::MqttLogSink(std::shared_ptr<mqtt::IMqttClient> client,
+                         const MqttLogSinkConfig &config,
+                         std::unique_ptr<ILogSink> fallback)
+    : client_(std::move(client)), config_(config), fallback_(std::move(fallback)), running_(false)
+#ifdef ESP_PLATFORM
+      ,
+      task_(nullptr), stopped_(true)
+#endif
+{
+    if (config_.maxBatchBytes < MIN_BATCH_BYTES)
+    {
+        config_.maxBatchBytes = MIN_BATCH_BYTES;
+    }
+    if (config_.maxBatchRecords == 0)
+    {
+        config_.maxBatchRecords = 1;
+    }
+
+    // All buffers are allocated here; the logging path never allocates
+    filling_.data.reset(new char[config_.maxBatchBytes]);
+    pending_.data.reset(new char[config_.maxBatchBytes]);
+    payload_.reserve(config_.maxBatchBytes);
+
+    if (!client_)
+    {
+        return;
+    }
+
+    running_.store(true);
+#ifdef ESP_PLATFORM
+    stopped_.store(false);
+    TaskHandle_t handle = nullptr;
+    if (task::spawn(task::TaskRole::LOG_MQTT, "lopcore_mqlog", publisherTaskEntry, this, config_.taskStackSize,
+                    config_.taskPriority, &handle) != ESP_OK)
+    {
+        running_.store(false);
+        stopped_.store(true);
+        return;
+    }
+    task_.store(handle);
+#else
+    thread_ = std::thread(publisherTaskEntry, this);
+#endif
+}
+
+MqttLogSink::~MqttLogSink()
+{
+    if (running_.exchange(false))
+    {
+        wakePublisher();
+#ifdef ESP_PLATFORM
+        while (!stopped_.load())
+        {
+            vTaskDelay(1);
+        }
+#endif
+    }
+#ifndef ESP_PLATFORM
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+#endif
+
+    if (fallback_)
+    {
+        fallback_->flush();
+    }
+}
+
+void MqttLogSink::write(const LogMessage &msg)
+{
+    if (!running_.load() || isPublisherTask() || !client_->isConnected())
+    {
+        writeFallback(msg);
+        return;
+    }
+
+    char line[MAX_LINE_SIZE];
+    int formatted = snprintf(line, sizeof(line), "[%10lu] %c (%s): %s", (unsigned long) msg.timestamp_ms,
+                             logLevelToChar(msg.level), msg.tag, msg.message);
+    if (formatted < 0)
+    {
+        return;
+    }
+    size_t length = static_cast<size_t>(formatted);
+    if (length >= sizeof(line))
+    {
+        length = sizeof(line) - 1;
+    }
+    if (length > config_.maxBatchBytes)
+    {
+        length = config_.maxBatchBytes;
+    }
+
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex_);
+
+        size_t separator = filling_.records > 0 ? 1 : 0;
+        bool full = filling_.records >= config_.maxBatchRecords ||
+                    filling_.length + separator + length > config_.maxBatchBytes;
+        if (full)
+        {
+            wake = true;
+            separator = 0;
+            if (!sealLocked())
+            {
+                // Publisher still holds the previous batch (offline or out of budget)
+                length = 0;
+            }
+        }
+
+        if (length > 0)
+        {
+            if (separator > 0)
+            {
+                filling_.data[filling_.length++] = '\n';
+            }
+            else
+            {
+                filling_.firstMs = nowMs();
+            }
+            memcpy(filling_.data.get() + filling_.length, line, length);
+            filling_.length += length;
+            filling_.records++;
+
+            if (filling_.records >= config_.maxBatchRecords && sealLocked())
+            {
+                wake = true;
+            }
+        }
+    }
+
+    if (length == 0)
+    {
+        writeFallback(msg);
+    }
+    if (wake)
+    {
+        wakePublisher();
+    }
+}
+
+void MqttLogSink::flush()
+{
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex_);
+        if (filling_.records > 0)
+        {
+            sealLocked();
+        }
+    }
+    wakePublisher();
+
+    if (fallback_)
+    {
+        fallback_->flush();
+    }
+}
+
+const char *MqttLogSink::getName() const
+{
+    return "MqttLogSink";
+}
+
+MqttLogSinkStats MqttLogSink::getStats() const
+{
+    std::lock_guard<std::mutex> lock(batch_mutex_);
+    return stats_;
+}
+
+bool MqttLogSink::isPublisherTask() const
+{
+#ifdef ESP_PLATFORM
+    return task_.load() != nullptr && xTaskGetCurrentTaskHandle() == task_.load();
+#else
+    return std::this_thread::get_id() == publisher_id_.load();
+#endif
+}
+
+void MqttLogSink::writeFallback(const LogMessage &msg)
+{
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex_);
+        if (fallback_)
+        {
+            stats_.recordsToFallback++;
+        }
+        else
+        {
+            stats_.recordsDropped++;
+        }
+    }
+
+    // Only the logger calls write(), one record at a time, so the fallback needs no lock
+    if (fallback_ && fallback_->isEnabled() && msg.level <= fallback_->getMinLevel())
+    {
+        fallback_->write(msg);
+    }
+}
+
+bool MqttLogSink::sealLocked()
+{
+    if (pending_ready_)
+    {
+        return false;
+    }
+
+    std::swap(filling_, pending_);
+    filling_.length = 0;
+    filling_.records = 0;
+    pending_ready_ = true;
+    return true;
+}
+
+void MqttLogSink::wakePublisher()
+{
+#ifdef ESP_PLATFORM
+    TaskHandle_t handle = static_cast<TaskHandle_t>(task_.load());
+    if (handle != nullptr)
+    {
+        xTaskNotifyGive(handle);
+    }
+#else
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_pending_ = true;
+    }
+    wake_.notify_one();
+#endif
+}
+
+bool MqttLogSink::publishPending()
+{
+    size_t records = 0;
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex_);
+        if (!pending_ready_)
+        {
+            return false;
+        }
+        // Copy out so write() can keep filling while the publish is in flight
+        payload_.assign(pending_.data.get(), pending_.data.get() + pending_.length);
+        records = pending_.records;
+    }
+
+    if (!client_->isConnected())
+    {
+        return false; // Keep the batch until the link is back
+    }
+
+    if (config_.budget != nullptr && !config_.budget->consume(1))
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex_);
+        stats_.publishFailures++;
+        return false;
+    }
+
+    esp_err_t err = client_->publish(config_.topic, payload_, config_.qos, false);
+
+    if (err != ESP_OK && config_.budget != nullptr)
+    {
+        config_.budget->restore(1);
+    }
+
+    std::lock_guard<std::mutex> lock(batch_mutex_);
+    if (err == ESP_OK)
+    {
+        pending_ready_ = false;
+        stats_.batchesPublished++;
+        stats_.recordsPublished += static_cast<uint32_t>(records);
+        return true;
+    }
+
+    // ESP_ERR_NO_MEM means the client's budget is exhausted; retry later
+    stats_.publishFailures++;
+    return false;
+}
+
+void MqttLogSink::publisherTaskEntry(void *arg)
+{
+    MqttLogSink *self = static_cast<MqttLogSink *>(arg);
+
+    // Poll often enough to honour maxBatchDelayMs without spinning
+    uint32_t tickMs = self->config_.maxBatchDelayMs / 4;
+    tickMs = tickMs < 10 ? 10 : (tickMs > 1000 ? 1000 : tickMs);
+
+#ifdef ESP_PLATFORM
+    self->task_.store(xTaskGetCurrentTaskHandle());
+#else
+    self->publisher_id_.store(std::this_thread::get_id());
+#endif
+
+    while (self->running_.load())
+    {
+#ifdef ESP_PLATFORM
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(tickMs));
+#else
+        {
+            std::unique_lock<std::mutex> lock(self->wake_mutex_);
+            self->wake_.wait_for(lock, std::chrono::milliseconds(tickMs),
+                                 [self] { return self->wake_pending_; });
+            self->wake_pending_ = false;
+        }
+#endif
+        if (!self->running_.load())
+        {
+            break;
+        }
+
+        // Keep publishing while sealed batches are ready, e.g. after a burst
+        do
+        {
+            std::lock_guard<std::mutex> lock(self->batch_mutex_);
+            bool full = self->filling_.records >= self->config_.maxBatchRecords;
+            bool aged = self->filling_.records > 0 &&
+                        nowMs() - self->filling_.firstMs >= self->config_.maxBatchDelayMs;
+            if (full || aged)
+            {
+                self->sealLocked();
+            }
+        } while (self->publishPending() && self->running_.load());
+    }
+
+#ifdef ESP_PLATFORM
+    self->stopped_.store(true);
+    task::exitTask();
+#endif
+}
+
+uint32_t MqttLogSink::nowMs()
+{
+#ifdef ESP_PLATFORM
+    return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+#else
+    using namespace std::chrono;
+    return static_cast<uint32_t>(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+} // namespace lopcore
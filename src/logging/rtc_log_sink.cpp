@@ -0,0 +1,190 @@
+/**
+ * @file rtc_log_sink.cpp
+ * @brief Crash-persistent log ring implementation
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/logging/rtc_log_sink.hpp"
+
+#include <atomic>
+#include <cstring>
+
+#include "lopcore/logging/logger.hpp"
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#include "esp_system.h"
+#endif
+
+namespace lopcore
+{
+
+static constexpr uint32_t RTC_LOG_MAGIC = 0x4C435254; // "TRCL"
+static constexpr uint32_t RTC_LOG_LAYOUT = (LOPCORE_RTC_LOG_SLOTS << 16) | sizeof(RtcLogSlot);
+static constexpr const char *TAG = "RtcLogSink";
+
+#ifdef ESP_PLATFORM
+#if CONFIG_LOPCORE_LOG_RTC_RING_NOINIT_RAM
+// Internal RAM: faster, larger, but lost in deep sleep
+static __NOINIT_ATTR RtcLogRing s_ring;
+#else
+static RTC_NOINIT_ATTR RtcLogRing s_ring;
+#endif
+#else
+static RtcLogRing s_ring;
+#endif
+
+static bool isSlotValid(const RtcLogSlot &slot, uint32_t sequence)
+{
+    return slot.sequence == sequence && slot.level <= static_cast<uint8_t>(LogLevel::VERBOSE) &&
+           slot.length < RTC_LOG_MESSAGE_SIZE && slot.message[slot.length] == '\0' &&
+           memchr(slot.tag, '\0', RTC_LOG_TAG_SIZE) != nullptr;
+}
+
+RtcLogSink::RtcLogSink(RtcLogRing *ring)
+    : ring_(ring != nullptr ? ring : &s_ring), boot_start_(1), recovered_(false), replaying_(false)
+{
+    min_level_ = LogLevel::INFO;
+
+    // next_sequence == 0 would make sequence numbers wrap into "empty"
+    recovered_ = ring_->magic == RTC_LOG_MAGIC && ring_->layout == RTC_LOG_LAYOUT &&
+                 ring_->next_sequence != 0 && ring_->replay_start <= ring_->next_sequence;
+    if (!recovered_)
+    {
+        memset(ring_, 0, sizeof(RtcLogRing));
+        ring_->magic = RTC_LOG_MAGIC;
+        ring_->layout = RTC_LOG_LAYOUT;
+        ring_->next_sequence = 1;
+        ring_->replay_start = 1;
+    }
+
+    boot_start_ = ring_->next_sequence;
+}
+
+void RtcLogSink::write(const LogMessage &msg)
+{
+    if (replaying_)
+    {
+        return;
+    }
+
+    uint32_t sequence = ring_->next_sequence;
+    RtcLogSlot &slot = ring_->slots[sequence % LOPCORE_RTC_LOG_SLOTS];
+
+    // Invalidate first, fill, then publish: a reset in between leaves a skipped slot
+    slot.sequence = 0;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+
+    slot.timestamp_ms = msg.timestamp_ms;
+    slot.level = static_cast<uint8_t>(msg.level);
+
+    const char *tag = msg.tag != nullptr ? msg.tag : "";
+    size_t tagLength = strnlen(tag, RTC_LOG_TAG_SIZE - 1);
+    memcpy(slot.tag, tag, tagLength);
+    slot.tag[tagLength] = '\0';
+
+    const char *text = msg.message != nullptr ? msg.message : "";
+    size_t length = strnlen(text, RTC_LOG_MESSAGE_SIZE - 1);
+    memcpy(slot.message, text, length);
+    slot.message[length] = '\0';
+    slot.length = static_cast<uint8_t>(length);
+
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    slot.sequence = sequence;
+    ring_->next_sequence = sequence + 1 != 0 ? sequence + 1 : 1;
+}
+
+void RtcLogSink::flush()
+{
+    // Every write is already in place
+}
+
+const char *RtcLogSink::getName() const
+{
+    return "RtcLogSink";
+}
+
+uint32_t RtcLogSink::firstPendingSequence() const
+{
+    // Older records have been overwritten; only the last LOPCORE_RTC_LOG_SLOTS can remain
+    uint32_t first = ring_->replay_start;
+    if (boot_start_ - first > LOPCORE_RTC_LOG_SLOTS)
+    {
+        first = boot_start_ - LOPCORE_RTC_LOG_SLOTS;
+    }
+    return first;
+}
+
+size_t RtcLogSink::getRecoveredCount() const
+{
+    size_t count = 0;
+    for (uint32_t sequence = firstPendingSequence(); sequence != boot_start_; ++sequence)
+    {
+        if (sequence != 0 && isSlotValid(ring_->slots[sequence % LOPCORE_RTC_LOG_SLOTS], sequence))
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
+template<typename Write>
+size_t RtcLogSink::replayRecords(Write &&write)
+{
+    replaying_ = true;
+    size_t replayed = 0;
+    for (uint32_t sequence = firstPendingSequence(); sequence != boot_start_; ++sequence)
+    {
+        const RtcLogSlot &slot = ring_->slots[sequence % LOPCORE_RTC_LOG_SLOTS];
+        if (sequence == 0 || !isSlotValid(slot, sequence))
+        {
+            continue; // Torn, or already overwritten by this boot
+        }
+
+        LogMessage msg;
+        msg.level = static_cast<LogLevel>(slot.level);
+        msg.timestamp_ms = slot.timestamp_ms;
+        msg.tag = slot.tag;
+        msg.message = slot.message;
+        msg.file = nullptr;
+        msg.line = 0;
+        write(msg);
+        ++replayed;
+    }
+    replaying_ = false;
+
+    ring_->replay_start = boot_start_;
+    return replayed;
+}
+
+size_t RtcLogSink::replay(Logger &logger)
+{
+    size_t pending = getRecoveredCount();
+    if (pending == 0)
+    {
+        return 0;
+    }
+
+#ifdef ESP_PLATFORM
+    logger.warn(TAG, "Replaying %u records from previous boot (reset reason %d)",
+                static_cast<unsigned>(pending), static_cast<int>(esp_reset_reason()));
+#else
+    logger.warn(TAG, "Replaying %u records from previous boot", static_cast<unsigned>(pending));
+#endif
+
+    return replayRecords([&logger](const LogMessage &msg) { logger.dispatch(msg); });
+}
+
+size_t RtcLogSink::replay(ILogSink &sink)
+{
+    return replayRecords([&sink](const LogMessage &msg) {
+        if (sink.isEnabled() && msg.level <= sink.getMinLevel())
+        {
+            sink.write(msg);
+        }
+    });
+}
+
+} // namespace lopcore
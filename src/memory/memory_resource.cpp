@@ -0,0 +1,218 @@
+/**
+ * @file memory_resource.cpp
+ * @brief Library-wide memory placement hooks built on std::pmr
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/memory/memory_resource.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+#ifdef ESP_PLATFORM
+#include <esp_heap_caps.h>
+#include <sdkconfig.h>
+#else
+// Accepted and ignored on the host
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_8BIT (1 << 2)
+#endif
+
+namespace lopcore
+{
+namespace memory
+{
+
+namespace
+{
+
+std::pmr::memory_resource *defaultResource(MemoryRole role)
+{
+#if CONFIG_LOPCORE_MEMORY_BULK_PSRAM
+    if (role == MemoryRole::BULK)
+    {
+        return psramResource();
+    }
+#else
+    (void)role;
+#endif
+    return internalResource();
+}
+
+std::atomic<std::pmr::memory_resource *> roleResources[2] = {{nullptr}, {nullptr}};
+
+void *exhausted()
+{
+#if defined(__cpp_exceptions)
+    throw std::bad_alloc();
+#else
+    return nullptr;
+#endif
+}
+
+} // namespace
+
+// =============================================================================
+// Roles
+// =============================================================================
+
+std::pmr::memory_resource *getResource(MemoryRole role)
+{
+    std::pmr::memory_resource *resource = roleResources[static_cast<size_t>(role)].load(std::memory_order_acquire);
+    return resource != nullptr ? resource : defaultResource(role);
+}
+
+void setResource(MemoryRole role, std::pmr::memory_resource *resource)
+{
+    roleResources[static_cast<size_t>(role)].store(resource, std::memory_order_release);
+}
+
+void *tryAllocate(std::pmr::memory_resource *resource, size_t bytes, size_t alignment)
+{
+#if defined(__cpp_exceptions)
+    try
+    {
+        return resource->allocate(bytes, alignment);
+    }
+    catch (const std::bad_alloc &)
+    {
+        return nullptr;
+    }
+#else
+    return resource->allocate(bytes, alignment);
+#endif
+}
+
+// =============================================================================
+// CapsResource
+// =============================================================================
+
+void *CapsResource::do_allocate(size_t bytes, size_t alignment)
+{
+#ifdef ESP_PLATFORM
+    void *p = heap_caps_aligned_alloc(alignment, bytes, caps_);
+    if (p == nullptr && fallbackCaps_ != 0)
+    {
+        p = heap_caps_aligned_alloc(alignment, bytes, fallbackCaps_);
+    }
+#else
+    void *p = ::operator new(bytes, std::align_val_t(alignment), std::nothrow);
+#endif
+    return p != nullptr ? p : exhausted();
+}
+
+void CapsResource::do_deallocate(void *p, size_t bytes, size_t alignment)
+{
+#ifdef ESP_PLATFORM
+    (void)bytes;
+    (void)alignment;
+    heap_caps_free(p);
+#else
+    ::operator delete(p, bytes, std::align_val_t(alignment));
+#endif
+}
+
+bool CapsResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
+
+std::pmr::memory_resource *internalResource()
+{
+    static CapsResource resource(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    return &resource;
+}
+
+std::pmr::memory_resource *psramResource()
+{
+    static CapsResource resource(MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    return &resource;
+}
+
+// =============================================================================
+// FixedBlockResource
+// =============================================================================
+
+FixedBlockResource::FixedBlockResource(size_t blockSize, size_t blocks, std::pmr::memory_resource *upstream)
+    : blockSize_((std::max(blockSize, sizeof(FreeBlock)) + alignof(std::max_align_t) - 1) &
+                 ~(alignof(std::max_align_t) - 1)),
+      blocks_(blocks), upstream_(upstream), storage_(nullptr), freeList_(nullptr), available_(0), overflows_(0)
+{
+    storage_ = static_cast<uint8_t *>(tryAllocate(upstream_, blockSize_ * blocks_));
+    if (storage_ == nullptr)
+    {
+        blocks_ = 0;
+        return;
+    }
+
+    // Thread the free list so the lowest block is handed out first
+    for (size_t i = blocks_; i > 0; i--)
+    {
+        auto *block = reinterpret_cast<FreeBlock *>(storage_ + (i - 1) * blockSize_);
+        block->next = freeList_;
+        freeList_ = block;
+    }
+    available_ = blocks_;
+}
+
+FixedBlockResource::~FixedBlockResource()
+{
+    if (storage_ != nullptr)
+    {
+        upstream_->deallocate(storage_, blockSize_ * blocks_, alignof(std::max_align_t));
+    }
+}
+
+size_t FixedBlockResource::available() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return available_;
+}
+
+size_t FixedBlockResource::overflows() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return overflows_;
+}
+
+void *FixedBlockResource::do_allocate(size_t bytes, size_t alignment)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (bytes <= blockSize_ && alignment <= alignof(std::max_align_t) && freeList_ != nullptr)
+        {
+            FreeBlock *block = freeList_;
+            freeList_ = block->next;
+            available_--;
+            return block;
+        }
+        overflows_++;
+    }
+    return upstream_->allocate(bytes, alignment);
+}
+
+void FixedBlockResource::do_deallocate(void *p, size_t bytes, size_t alignment)
+{
+    if (!owns(p))
+    {
+        upstream_->deallocate(p, bytes, alignment);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto *block = static_cast<FreeBlock *>(p);
+    block->next = freeList_;
+    freeList_ = block;
+    available_++;
+}
+
+bool FixedBlockResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
+
+} // namespace memory
+} // namespace lopcore
@@ -0,0 +1,486 @@
+/**
+ * @file metrics_exporter.cpp
+ * @brief Periodic publisher of the metrics registry over MQTT
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/metrics/metrics_exporter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
+#include "lopcore/logging/logger.hpp"
+#include "lopcore/task/task_profile.hpp"
+
+static const char *TAG = "MetricsExporter";
+
+namespace lopcore
+{
+namespace metrics
+{
+
+namespace
+{
+
+// Major types of RFC 8949
+constexpr uint8_t CBOR_UNSIGNED = 0;
+constexpr uint8_t CBOR_NEGATIVE = 1;
+constexpr uint8_t CBOR_TEXT = 3;
+constexpr uint8_t CBOR_ARRAY = 4;
+constexpr uint8_t CBOR_MAP = 5;
+
+/**
+ * @brief Bounds-checked CBOR writer
+ */
+class CborWriter
+{
+public:
+    CborWriter(uint8_t *buffer, size_t size) : start_(buffer), out_(buffer), end_(buffer + size)
+    {
+    }
+
+    void head(uint8_t major, uint64_t value)
+    {
+        uint8_t type = static_cast<uint8_t>(major << 5);
+        if (value < 24)
+        {
+            put(type | static_cast<uint8_t>(value), 0, 0);
+        }
+        else if (value <= 0xFF)
+        {
+            put(type | 24, value, 1);
+        }
+        else if (value <= 0xFFFF)
+        {
+            put(type | 25, value, 2);
+        }
+        else if (value <= 0xFFFFFFFF)
+        {
+            put(type | 26, value, 4);
+        }
+        else
+        {
+            put(type | 27, value, 8);
+        }
+    }
+
+    void integer(int64_t value)
+    {
+        if (value >= 0)
+        {
+            head(CBOR_UNSIGNED, static_cast<uint64_t>(value));
+        }
+        else
+        {
+            head(CBOR_NEGATIVE, static_cast<uint64_t>(-(value + 1)));
+        }
+    }
+
+    void text(std::string_view text)
+    {
+        head(CBOR_TEXT, text.size());
+        if (ok() && static_cast<size_t>(end_ - out_) >= text.size())
+        {
+            std::memcpy(out_, text.data(), text.size());
+            out_ += text.size();
+        }
+        else
+        {
+            out_ = nullptr;
+        }
+    }
+
+    bool ok() const
+    {
+        return out_ != nullptr;
+    }
+
+    size_t length() const
+    {
+        return ok() ? static_cast<size_t>(out_ - start_) : 0;
+    }
+
+private:
+    void put(uint8_t first, uint64_t value, size_t bytes)
+    {
+        if (!ok() || static_cast<size_t>(end_ - out_) < 1 + bytes)
+        {
+            out_ = nullptr;
+            return;
+        }
+        *out_++ = first;
+        for (size_t i = bytes; i > 0; i--)
+        {
+            *out_++ = static_cast<uint8_t>(value >> (8 * (i - 1)));
+        }
+    }
+
+    uint8_t *start_;
+    uint8_t *out_;
+    uint8_t *end_;
+};
+
+} // namespace
+
+// =============================================================================
+// Construction
+// =============================================================================
+
+MetricsExporter::MetricsExporter(std::shared_ptr<mqtt::IMqttClient> client,
+                                 const MetricsExporterConfig &config,
+                                 MetricsRegistry &registry,
+                                 TimeSource timeSource)
+    : client_(std::move(client)), config_(config), registry_(registry), timeSource_(timeSource),
+      topic_(config.format == MetricsExporterConfig::Format::DEVICE_DEFENDER
+                 ? "$aws/things/" + config.thingName + "/defender/metrics/cbor"
+                 : config.topic),
+      buffer_(config.maxPayloadSize), dueUs_(timeSource() + static_cast<int64_t>(config.intervalMs) * 1000),
+      sequence_(0), running_(false)
+#ifdef ESP_PLATFORM
+      ,
+      task_(nullptr), stopped_(true)
+#endif
+{
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+}
+
+// =============================================================================
+// Task
+// =============================================================================
+
+esp_err_t MetricsExporter::start()
+{
+    if (running_.load())
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!client_ || config_.validate() != ESP_OK)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    running_.store(true);
+#ifdef ESP_PLATFORM
+    stopped_.store(false);
+    TaskHandle_t handle = nullptr;
+    if (task::spawn(task::TaskRole::METRICS_EXPORT, "metrics_export", taskEntry, this, config_.stackSize,
+                    config_.priority, &handle) != ESP_OK)
+    {
+        stopped_.store(true);
+        running_.store(false);
+        LOPCORE_LOGE(TAG, "Failed to create metrics export task");
+        return ESP_FAIL;
+    }
+    task_ = handle;
+#else
+    thread_ = std::thread(taskEntry, this);
+#endif
+
+    LOPCORE_LOGI(TAG, "Exporting metrics to %s every %lu ms", topic_.c_str(),
+                 static_cast<unsigned long>(config_.intervalMs));
+    return ESP_OK;
+}
+
+void MetricsExporter::stop()
+{
+    running_.store(false);
+
+#ifdef ESP_PLATFORM
+    if (task_ != nullptr)
+    {
+        xTaskNotifyGive(task_);
+    }
+    while (!stopped_.load())
+    {
+        vTaskDelay(1);
+    }
+    task_ = nullptr;
+#else
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wake_.notify_all();
+    }
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+#endif
+}
+
+void MetricsExporter::taskEntry(void *arg)
+{
+    MetricsExporter *self = static_cast<MetricsExporter *>(arg);
+    self->runTask();
+
+#ifdef ESP_PLATFORM
+    self->stopped_.store(true);
+    task::exitTask();
+#endif
+}
+
+void MetricsExporter::runTask()
+{
+    while (running_.load())
+    {
+        uint32_t waitMs = poll();
+
+#ifdef ESP_PLATFORM
+        ulTaskNotifyTake(pdTRUE, std::max<TickType_t>(pdMS_TO_TICKS(waitMs), 1));
+#else
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait_for(lock, std::chrono::milliseconds(waitMs), [this] { return !running_.load(); });
+#endif
+    }
+}
+
+// =============================================================================
+// Exporting
+// =============================================================================
+
+uint32_t MetricsExporter::poll()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t nowUs = timeSource_();
+    if (nowUs >= dueUs_)
+    {
+        exportLocked();
+        dueUs_ = nowUs + static_cast<int64_t>(config_.intervalMs) * 1000;
+    }
+    return static_cast<uint32_t>((dueUs_ - nowUs + 999) / 1000);
+}
+
+esp_err_t MetricsExporter::exportNow()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    esp_err_t err = exportLocked();
+    dueUs_ = timeSource_() + static_cast<int64_t>(config_.intervalMs) * 1000;
+    return err;
+}
+
+MetricsExporterStats MetricsExporter::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+esp_err_t MetricsExporter::exportLocked()
+{
+    size_t count = collect();
+    if (count == 0)
+    {
+        stats_.skipped++;
+        return ESP_OK;
+    }
+
+    // What does not fit goes out with the next export
+    size_t sending = count;
+    size_t length = encode(sending);
+    while (length == 0 && sending > 1)
+    {
+        sending /= 2;
+        length = encode(sending);
+    }
+    if (length == 0)
+    {
+        LOPCORE_LOGW(TAG, "Metric '%s' does not fit %zu bytes", items_[0].name.c_str(), config_.maxPayloadSize);
+        stats_.truncated++;
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (sending < count)
+    {
+        stats_.truncated++;
+    }
+
+    mqtt::MqttPayloadSegment segment{buffer_.data(), length};
+    esp_err_t err = client_->publish(topic_, &segment, 1, config_.qos);
+    if (err != ESP_OK)
+    {
+        // Baselines stay put, so the next export carries this interval too
+        LOPCORE_LOGW(TAG, "Metrics export not sent: %s", esp_err_to_name(err));
+        stats_.failures++;
+        return err;
+    }
+
+    for (size_t i = 0; i < sending; i++)
+    {
+        const Item &item = items_[i];
+        if (baselines_.size() <= item.id)
+        {
+            baselines_.resize(item.id + 1);
+        }
+        Baseline &baseline = baselines_[item.id];
+        baseline.exported = true;
+        baseline.value = item.value;
+        baseline.histogram = item.histogram;
+    }
+    sequence_++;
+    stats_.exports++;
+    stats_.bytesPublished += static_cast<uint32_t>(length);
+    return ESP_OK;
+}
+
+size_t MetricsExporter::collect()
+{
+    size_t count = 0;
+    registry_.forEach([&](const MetricView &metric) {
+        static const Baseline NONE;
+        const Baseline &baseline = metric.id < baselines_.size() ? baselines_[metric.id] : NONE;
+
+        if (count == items_.size())
+        {
+            items_.emplace_back();
+        }
+        Item &item = items_[count];
+        item.id = metric.id;
+        item.type = metric.type;
+        item.value = metric.value;
+
+        bool changed = false;
+        switch (metric.type)
+        {
+        case MetricType::COUNTER:
+            if (!metric.sampled)
+            {
+                // 32-bit counters wrap; the difference modulo 2^32 is still right
+                item.delta = static_cast<uint32_t>(metric.value - baseline.value);
+            }
+            else
+            {
+                // A sampled total that went down was reset: count from zero
+                item.delta = metric.value >= baseline.value ? metric.value - baseline.value : metric.value;
+            }
+            changed = item.delta != 0;
+            break;
+        case MetricType::GAUGE:
+            changed = !config_.skipUnchanged || !baseline.exported || metric.value != baseline.value;
+            break;
+        case MetricType::HISTOGRAM:
+            item.histogram = metric.histogram->snapshot();
+            changed = item.histogram.count != baseline.histogram.count;
+            break;
+        }
+
+        if (changed)
+        {
+            item.name.assign(metric.name.data(), metric.name.size());
+            count++;
+        }
+    });
+    return count;
+}
+
+size_t MetricsExporter::encode(size_t count)
+{
+    CborWriter writer(buffer_.data(), buffer_.size());
+    auto histogramDeltas = [&](const Item &item) {
+        const HistogramSnapshot &previous =
+            item.id < baselines_.size() ? baselines_[item.id].histogram : HistogramSnapshot();
+        for (size_t b = 0; b < item.histogram.buckets; b++)
+        {
+            writer.head(CBOR_UNSIGNED, static_cast<uint32_t>(item.histogram.counts[b] - previous.counts[b]));
+        }
+    };
+
+    if (config_.format == MetricsExporterConfig::Format::DEVICE_DEFENDER)
+    {
+        // Report IDs must increase across reboots: epoch seconds once the clock is set
+        time_t now = time(nullptr);
+        uint64_t reportId = now > 1600000000 ? static_cast<uint64_t>(now) * 1000 + sequence_ % 1000 : sequence_;
+
+        writer.head(CBOR_MAP, 2);
+        writer.text("hed");
+        writer.head(CBOR_MAP, 2);
+        writer.text("rid");
+        writer.head(CBOR_UNSIGNED, reportId);
+        writer.text("v");
+        writer.text("1.0");
+
+        writer.text("cmet");
+        writer.head(CBOR_MAP, count);
+        for (size_t i = 0; i < count; i++)
+        {
+            const Item &item = items_[i];
+            writer.text(item.name);
+            writer.head(CBOR_ARRAY, 1);
+            writer.head(CBOR_MAP, 1);
+            if (item.type == MetricType::HISTOGRAM)
+            {
+                writer.text("number_list");
+                writer.head(CBOR_ARRAY, item.histogram.buckets);
+                histogramDeltas(item);
+            }
+            else
+            {
+                writer.text("number");
+                writer.integer(item.type == MetricType::COUNTER ? item.delta : item.value);
+            }
+        }
+        return writer.length();
+    }
+
+    size_t sections[3] = {0, 0, 0};
+    for (size_t i = 0; i < count; i++)
+    {
+        sections[static_cast<size_t>(items_[i].type)]++;
+    }
+    static const char *const SECTION_KEYS[3] = {"c", "g", "h"};
+
+    writer.head(CBOR_MAP, 3 + (sections[0] > 0) + (sections[1] > 0) + (sections[2] > 0));
+    writer.text("v");
+    writer.head(CBOR_UNSIGNED, 1);
+    writer.text("s");
+    writer.head(CBOR_UNSIGNED, sequence_);
+    writer.text("t");
+    writer.head(CBOR_UNSIGNED, static_cast<uint64_t>(timeSource_() / 1000000));
+
+    for (size_t section = 0; section < 3; section++)
+    {
+        if (sections[section] == 0)
+        {
+            continue;
+        }
+        writer.text(SECTION_KEYS[section]);
+        writer.head(CBOR_MAP, sections[section]);
+        for (size_t i = 0; i < count; i++)
+        {
+            const Item &item = items_[i];
+            if (static_cast<size_t>(item.type) != section)
+            {
+                continue;
+            }
+            writer.text(item.name);
+            switch (item.type)
+            {
+            case MetricType::COUNTER:
+                writer.integer(item.delta);
+                break;
+            case MetricType::GAUGE:
+                writer.integer(item.value);
+                break;
+            case MetricType::HISTOGRAM:
+            {
+                const HistogramSnapshot &previous =
+                    item.id < baselines_.size() ? baselines_[item.id].histogram : HistogramSnapshot();
+                writer.head(CBOR_ARRAY, 3 + item.histogram.buckets);
+                writer.head(CBOR_UNSIGNED, static_cast<uint32_t>(item.histogram.count - previous.count));
+                writer.head(CBOR_UNSIGNED, static_cast<uint32_t>(item.histogram.sum - previous.sum));
+                writer.head(CBOR_UNSIGNED, item.histogram.max);
+                histogramDeltas(item);
+                break;
+            }
+            }
+        }
+    }
+    return writer.length();
+}
+
+} // namespace metrics
+} // namespace lopcore
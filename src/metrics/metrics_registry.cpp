@@ -0,0 +1,238 @@
+/**
+ * @file metrics_registry.cpp
+ * @brief Process-wide registry of counters, gauges and histograms
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/metrics/metrics_registry.hpp"
+
+#include <algorithm>
+
+#include "lopcore/logging/logger.hpp"
+
+static const char *TAG = "Metrics";
+
+namespace lopcore
+{
+namespace metrics
+{
+
+// =============================================================================
+// Histogram
+// =============================================================================
+
+Histogram::Histogram(std::initializer_list<uint32_t> bounds)
+    : bounds_(bounds.begin(), bounds.begin() + std::min(bounds.size(), MAX_HISTOGRAM_BUCKETS - 1))
+{
+}
+
+void Histogram::record(uint32_t value)
+{
+    // A handful of bounds: a linear scan beats a binary search
+    size_t bucket = 0;
+    while (bucket < bounds_.size() && value > bounds_[bucket])
+    {
+        bucket++;
+    }
+    counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    uint32_t max = max_.load(std::memory_order_relaxed);
+    while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+HistogramSnapshot Histogram::snapshot() const
+{
+    HistogramSnapshot snapshot;
+    snapshot.count = count_.load(std::memory_order_relaxed);
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    snapshot.max = max_.load(std::memory_order_relaxed);
+    snapshot.buckets = bucketCount();
+    for (size_t i = 0; i < snapshot.buckets; i++)
+    {
+        snapshot.counts[i] = counts_[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+// =============================================================================
+// Registration
+// =============================================================================
+
+void Registration::reset()
+{
+    if (registry_ != nullptr)
+    {
+        registry_->remove(id_);
+        registry_ = nullptr;
+    }
+}
+
+// =============================================================================
+// MetricsRegistry
+// =============================================================================
+
+MetricsRegistry &MetricsRegistry::instance()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Entry *MetricsRegistry::findOrAdd(std::string_view name, MetricType type, bool *created)
+{
+    *created = false;
+    for (const auto &entry : entries_)
+    {
+        if (entry && entry->name == name)
+        {
+            if (entry->type != type)
+            {
+                LOPCORE_LOGE(TAG, "Metric '%.*s' already registered with another type",
+                             static_cast<int>(name.size()), name.data());
+                return nullptr;
+            }
+            return entry.get();
+        }
+    }
+
+    if (live_ >= capacity_)
+    {
+        LOPCORE_LOGE(TAG, "Registry full (%zu metrics), '%.*s' not exported", capacity_,
+                     static_cast<int>(name.size()), name.data());
+        return nullptr;
+    }
+
+    auto entry = std::make_unique<Entry>();
+    entry->name = std::string(name);
+    entry->type = type;
+    entries_.push_back(std::move(entry));
+    live_++;
+    *created = true;
+    return entries_.back().get();
+}
+
+Counter &MetricsRegistry::counter(std::string_view name)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool created;
+    Entry *entry = findOrAdd(name, MetricType::COUNTER, &created);
+    if (entry == nullptr || (!created && !entry->counter))
+    {
+        return scratchCounter_; // Unavailable, or the name is sampled
+    }
+    if (created)
+    {
+        entry->counter = std::make_unique<Counter>();
+    }
+    return *entry->counter;
+}
+
+Gauge &MetricsRegistry::gauge(std::string_view name)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool created;
+    Entry *entry = findOrAdd(name, MetricType::GAUGE, &created);
+    if (entry == nullptr || (!created && !entry->gauge))
+    {
+        return scratchGauge_;
+    }
+    if (created)
+    {
+        entry->gauge = std::make_unique<Gauge>();
+    }
+    return *entry->gauge;
+}
+
+Histogram &MetricsRegistry::histogram(std::string_view name, std::initializer_list<uint32_t> bounds)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool created;
+    Entry *entry = findOrAdd(name, MetricType::HISTOGRAM, &created);
+    if (entry == nullptr)
+    {
+        return scratchHistogram_;
+    }
+    if (created)
+    {
+        entry->histogram = std::make_unique<Histogram>(bounds);
+    }
+    return *entry->histogram;
+}
+
+Registration MetricsRegistry::sampledCounter(std::string_view name, std::function<uint64_t()> sampler)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool created;
+    Entry *entry = findOrAdd(name, MetricType::COUNTER, &created);
+    if (entry == nullptr || !created)
+    {
+        return Registration();
+    }
+    entry->sampler = [sampler = std::move(sampler)] { return static_cast<int64_t>(sampler()); };
+    return Registration(this, entries_.size() - 1);
+}
+
+Registration MetricsRegistry::sampledGauge(std::string_view name, std::function<int64_t()> sampler)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool created;
+    Entry *entry = findOrAdd(name, MetricType::GAUGE, &created);
+    if (entry == nullptr || !created)
+    {
+        return Registration();
+    }
+    entry->sampler = std::move(sampler);
+    return Registration(this, entries_.size() - 1);
+}
+
+void MetricsRegistry::remove(size_t id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id < entries_.size() && entries_[id])
+    {
+        entries_[id].reset();
+        live_--;
+    }
+}
+
+void MetricsRegistry::forEach(const std::function<void(const MetricView &)> &fn) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t id = 0; id < entries_.size(); id++)
+    {
+        const Entry *entry = entries_[id].get();
+        if (entry == nullptr)
+        {
+            continue;
+        }
+
+        MetricView view{id, entry->name, entry->type, static_cast<bool>(entry->sampler), 0, entry->histogram.get()};
+        if (entry->sampler)
+        {
+            view.value = entry->sampler();
+        }
+        else if (entry->counter)
+        {
+            view.value = entry->counter->value();
+        }
+        else if (entry->gauge)
+        {
+            view.value = entry->gauge->value();
+        }
+        fn(view);
+    }
+}
+
+size_t MetricsRegistry::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return live_;
+}
+
+} // namespace metrics
+} // namespace lopcore
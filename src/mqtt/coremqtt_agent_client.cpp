@@ -0,0 +1,1010 @@
+/**
+ * @file coremqtt_agent_client.cpp
+ * @brief Implementation of the coreMQTT-Agent client
+ *
+ * The agent task runs MQTTAgent_CommandLoop(); every other task talks to
+ * it through MQTTAgent_*() commands queued on a FreeRTOS queue. Commands
+ * come from a static pool shared by all agent clients (coreMQTT-Agent's
+ * pool callbacks take no context).
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/mqtt/coremqtt_agent_client.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+
+#include <esp_timer.h>
+
+#include "freertos/queue.h"
+#include "lopcore/logging/logger.hpp"
+#include "lopcore/task/task_profile.hpp"
+#include "lopcore/tls/tls_config.hpp"
+#include "lopcore/tls/tls_transport.hpp"
+
+#ifndef CONFIG_LOPCORE_MQTT_AGENT_QUEUE_LENGTH
+#define CONFIG_LOPCORE_MQTT_AGENT_QUEUE_LENGTH 10
+#endif
+#ifndef CONFIG_LOPCORE_MQTT_AGENT_COMMAND_POOL_SIZE
+#define CONFIG_LOPCORE_MQTT_AGENT_COMMAND_POOL_SIZE 10
+#endif
+#ifndef CONFIG_LOPCORE_MQTT_AGENT_COMMAND_TIMEOUT_MS
+#define CONFIG_LOPCORE_MQTT_AGENT_COMMAND_TIMEOUT_MS 500
+#endif
+
+static const char *TAG = "coremqtt_agent";
+
+// coreMQTT-Agent leaves these two types to the application
+
+/**
+ * @brief The agent's command queue
+ */
+struct MQTTAgentMessageContext
+{
+    QueueHandle_t queue;
+};
+
+/**
+ * @brief A caller waiting for its command to complete
+ */
+struct MQTTAgentCommandContext
+{
+    SemaphoreHandle_t done;
+    MQTTStatus_t status;
+};
+
+namespace
+{
+
+// =============================================================================
+// Command Queue and Pool
+// =============================================================================
+
+bool sendCommand(MQTTAgentMessageContext_t *context, MQTTAgentCommand_t *const *command, uint32_t blockTimeMs)
+{
+    return xQueueSendToBack(context->queue, command, pdMS_TO_TICKS(blockTimeMs)) == pdPASS;
+}
+
+bool receiveCommand(MQTTAgentMessageContext_t *context, MQTTAgentCommand_t **command, uint32_t blockTimeMs)
+{
+    return xQueueReceive(context->queue, command, pdMS_TO_TICKS(blockTimeMs)) == pdPASS;
+}
+
+/**
+ * @brief Free commands, shared by every client; built on first use
+ */
+QueueHandle_t commandPool()
+{
+    static MQTTAgentCommand_t commands[CONFIG_LOPCORE_MQTT_AGENT_COMMAND_POOL_SIZE];
+    static QueueHandle_t pool = [] {
+        QueueHandle_t queue = xQueueCreate(CONFIG_LOPCORE_MQTT_AGENT_COMMAND_POOL_SIZE, sizeof(MQTTAgentCommand_t *));
+        for (MQTTAgentCommand_t &command : commands)
+        {
+            MQTTAgentCommand_t *free = &command;
+            xQueueSendToBack(queue, &free, 0);
+        }
+        return queue;
+    }();
+    return pool;
+}
+
+MQTTAgentCommand_t *getCommand(uint32_t blockTimeMs)
+{
+    MQTTAgentCommand_t *command = nullptr;
+    xQueueReceive(commandPool(), &command, pdMS_TO_TICKS(blockTimeMs));
+    return command;
+}
+
+bool releaseCommand(MQTTAgentCommand_t *command)
+{
+    std::memset(command, 0, sizeof(*command));
+    return xQueueSendToBack(commandPool(), &command, 0) == pdPASS;
+}
+
+// =============================================================================
+// Waiting for Commands
+// =============================================================================
+
+void commandComplete(MQTTAgentCommandContext_t *context, MQTTAgentReturnInfo_t *returnInfo)
+{
+    context->status = returnInfo->returnCode;
+    xSemaphoreGive(context->done);
+}
+
+/**
+ * @brief Queue a command with submit(commandInfo) and wait for it to complete
+ *
+ * The wait has no timeout: whatever the command points at lives in the
+ * caller's frame. The agent completes every command it accepts, with an
+ * error if the connection is lost or the client disconnects first.
+ */
+template<typename Submit>
+esp_err_t runCommand(const char *operation, Submit &&submit)
+{
+    StaticSemaphore_t doneBuffer;
+    MQTTAgentCommandContext_t context{xSemaphoreCreateBinaryStatic(&doneBuffer), MQTTSuccess};
+    MQTTAgentCommandInfo_t commandInfo{commandComplete, &context, CONFIG_LOPCORE_MQTT_AGENT_COMMAND_TIMEOUT_MS};
+
+    MQTTStatus_t status = submit(&commandInfo);
+    if (status != MQTTSuccess)
+    {
+        vSemaphoreDelete(context.done);
+        LOPCORE_LOGE(TAG, "%s not queued: %s", operation, MQTT_Status_strerror(status));
+        // MQTTNoMemory: no free command; MQTTSendFailed: the queue stayed full
+        return status == MQTTNoMemory || status == MQTTSendFailed ? ESP_ERR_NO_MEM : ESP_FAIL;
+    }
+
+    xSemaphoreTake(context.done, portMAX_DELAY);
+    status = context.status;
+    vSemaphoreDelete(context.done);
+    if (status == MQTTSuccess)
+    {
+        return ESP_OK;
+    }
+    LOPCORE_LOGE(TAG, "%s failed: %s", operation, MQTT_Status_strerror(status));
+    return status == MQTTNoMemory ? ESP_ERR_NO_MEM : ESP_FAIL;
+}
+
+} // namespace
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+// =============================================================================
+// Construction & Destruction
+// =============================================================================
+
+CoreMqttAgentClient::CoreMqttAgentClient(const MqttConfig &config,
+                                         std::shared_ptr<lopcore::tls::ITlsTransport> transport)
+    : config_(config), tlsTransport_(std::move(transport)), networkContext_{}, transport_{}, agent_{},
+      messageInterface_{}, messageContext_(nullptr), initialized_(false), resubscribesPending_(0),
+      state_(MqttConnectionState::DISCONNECTED),
+#ifdef ESP_PLATFORM
+      agentTask_(nullptr), taskStoppedSemaphore_(nullptr),
+#else
+      agentThreadId_(std::thread::id()),
+#endif
+      stopping_(false)
+{
+#ifdef ESP_PLATFORM
+    taskStoppedSemaphore_ = xSemaphoreCreateBinary();
+    if (taskStoppedSemaphore_ == nullptr)
+    {
+        LOPCORE_LOGE(TAG, "Failed to create task synchronization semaphore");
+        return;
+    }
+#endif
+
+    esp_err_t err = config_.validate();
+    if (err != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "Invalid MQTT configuration: %s", esp_err_to_name(err));
+        return;
+    }
+
+    if (!tlsTransport_ || !tlsTransport_->isConnected())
+    {
+        LOPCORE_LOGE(TAG, "TLS transport must be connected before creating MQTT client");
+        return;
+    }
+
+    NetworkContext_t *netContext = static_cast<NetworkContext_t *>(tlsTransport_->getNetworkContext());
+    if (netContext == nullptr)
+    {
+        LOPCORE_LOGE(TAG, "Failed to get network context from TLS transport");
+        return;
+    }
+    networkContext_.context = *netContext;
+    networkContext_.context.client = nullptr; // The agent's callbacks use networkContext_.client
+    networkContext_.client = this;
+
+    if (config_.budget.enabled)
+    {
+        budget_ = std::make_unique<MqttBudget>(config_.budget);
+        LOPCORE_LOGI(TAG, "Message budgeting enabled");
+    }
+
+    if (config_.dispatch.workers > 0)
+    {
+        dispatcher_ = std::make_unique<MqttDispatcher>(config_.dispatch);
+        if (dispatcher_->start() != ESP_OK)
+        {
+            LOPCORE_LOGW(TAG, "Dispatch workers unavailable, callbacks run inline");
+            dispatcher_.reset();
+        }
+    }
+
+    messageContext_ = new MQTTAgentMessageContext{
+        xQueueCreate(CONFIG_LOPCORE_MQTT_AGENT_QUEUE_LENGTH, sizeof(MQTTAgentCommand_t *))};
+    if (messageContext_->queue == nullptr || commandPool() == nullptr)
+    {
+        LOPCORE_LOGE(TAG, "Failed to create the agent command queue");
+        return;
+    }
+    messageInterface_.pMsgCtx = messageContext_;
+    messageInterface_.send = sendCommand;
+    messageInterface_.recv = receiveCommand;
+    messageInterface_.getCommand = getCommand;
+    messageInterface_.releaseCommand = releaseCommand;
+
+    if (!networkBuffer_.allocate(config_.networkBufferSize))
+    {
+        // MQTTAgent_Init() below rejects the empty buffer
+        LOPCORE_LOGE(TAG, "No memory for a %u-byte network buffer",
+                     static_cast<unsigned>(config_.networkBufferSize));
+    }
+
+    transport_.send = transportSend;
+    transport_.recv = transportRecv;
+    transport_.pNetworkContext = &networkContext_.context;
+
+    MQTTFixedBuffer_t fixedBuffer = {.pBuffer = networkBuffer_.data(), .size = networkBuffer_.size()};
+    MQTTStatus_t status = MQTTAgent_Init(&agent_, &messageInterface_, &fixedBuffer, &transport_, getTimeMs,
+                                         incomingPublishCallback, this);
+    if (status != MQTTSuccess)
+    {
+        LOPCORE_LOGE(TAG, "MQTTAgent_Init failed: %s", MQTT_Status_strerror(status));
+        return;
+    }
+    initialized_ = true;
+
+    LOPCORE_LOGI(TAG, "CoreMQTT agent client created: broker=%s:%d, clientId=%s", config_.broker.c_str(),
+                 config_.port, config_.clientId.c_str());
+}
+
+CoreMqttAgentClient::~CoreMqttAgentClient()
+{
+    disconnect();
+
+    // Workers may still be calling into this client
+    if (dispatcher_)
+    {
+        dispatcher_->stop();
+    }
+
+    if (messageContext_ != nullptr)
+    {
+        if (messageContext_->queue != nullptr)
+        {
+            vQueueDelete(messageContext_->queue);
+        }
+        delete messageContext_;
+    }
+
+#ifdef ESP_PLATFORM
+    if (taskStoppedSemaphore_ != nullptr)
+    {
+        vSemaphoreDelete(taskStoppedSemaphore_);
+    }
+#endif
+
+    LOPCORE_LOGI(TAG, "CoreMQTT agent client destroyed");
+}
+
+// =============================================================================
+// Connection Management
+// =============================================================================
+
+esp_err_t CoreMqttAgentClient::connect()
+{
+    if (!initialized_)
+    {
+        LOPCORE_LOGE(TAG, "Client was not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (agentRunning())
+    {
+        LOPCORE_LOGW(TAG, "Already connected");
+        return ESP_OK;
+    }
+
+    if (!tlsTransport_ || !tlsTransport_->isConnected())
+    {
+        LOPCORE_LOGE(TAG, "TLS transport is not connected");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // The agent task is not running, so this task may use the MQTT context directly
+    esp_err_t err = sendConnect();
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    stopping_ = false;
+#ifdef ESP_PLATFORM
+    if (task::spawn(task::TaskRole::MQTT_AGENT, "mqtt_agent", agentTaskWrapper, this, &agentTask_) != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "Failed to create the agent task");
+        agentTask_ = nullptr;
+        MQTT_Disconnect(&agent_.mqttContext);
+        state_ = MqttConnectionState::ERROR;
+        return ESP_FAIL;
+    }
+#else
+    agentThread_ = std::thread(agentTaskWrapper, this);
+#endif
+
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    if (connectionCallback_)
+    {
+        connectionCallback_(true);
+    }
+    return ESP_OK;
+}
+
+esp_err_t CoreMqttAgentClient::sendConnect()
+{
+    MQTTConnectInfo_t connectInfo = {};
+    connectInfo.cleanSession = config_.cleanSession;
+    connectInfo.pClientIdentifier = config_.clientId.c_str();
+    connectInfo.clientIdentifierLength = config_.clientId.length();
+    connectInfo.keepAliveSeconds = config_.keepAlive.count();
+
+    if (!config_.username.empty())
+    {
+        connectInfo.pUserName = config_.username.c_str();
+        connectInfo.userNameLength = config_.username.length();
+    }
+
+    if (!config_.password.empty())
+    {
+        connectInfo.pPassword = config_.password.c_str();
+        connectInfo.passwordLength = config_.password.length();
+    }
+
+    MQTTPublishInfo_t willInfo = {};
+    if (config_.will.isConfigured())
+    {
+        const auto &will = config_.will;
+        willInfo.pTopicName = will.topic.c_str();
+        willInfo.topicNameLength = will.topic.length();
+        willInfo.pPayload = will.payload.data();
+        willInfo.payloadLength = will.payload.size();
+        willInfo.qos = static_cast<MQTTQoS_t>(qosToInt(will.qos));
+        willInfo.retain = will.retain;
+    }
+
+    uint32_t connectTimeoutMs = config_.tls.has_value() ? config_.tls->timeoutMs : 30000;
+
+    bool sessionPresent = false;
+    MQTTStatus_t status = MQTT_Connect(&agent_.mqttContext, &connectInfo,
+                                       config_.will.isConfigured() ? &willInfo : nullptr, connectTimeoutMs,
+                                       &sessionPresent);
+    if (status != MQTTSuccess)
+    {
+        LOPCORE_LOGE(TAG, "MQTT_Connect failed: %s", MQTT_Status_strerror(status));
+        return ESP_FAIL;
+    }
+
+    // Resends unacknowledged publishes of a resumed session, or fails them for a new one
+    status = MQTTAgent_ResumeSession(&agent_, sessionPresent);
+    if (status != MQTTSuccess)
+    {
+        LOPCORE_LOGW(TAG, "MQTTAgent_ResumeSession failed: %s", MQTT_Status_strerror(status));
+    }
+
+    state_ = MqttConnectionState::CONNECTED;
+    metrics_.increment(MqttCounter::RECONNECTS);
+    {
+        std::lock_guard<std::mutex> lock(statisticsMutex_);
+        statistics_.lastConnected = std::chrono::system_clock::now();
+    }
+
+    LOPCORE_LOGI(TAG, "Connected to %s:%d (session=%s)", config_.broker.c_str(), config_.port,
+                 sessionPresent ? "resumed" : "new");
+
+    if (!sessionPresent)
+    {
+        resubscribeAll();
+    }
+    return ESP_OK;
+}
+
+esp_err_t CoreMqttAgentClient::disconnect()
+{
+    if (!agentRunning())
+    {
+        return ESP_OK;
+    }
+
+    stopping_ = true;
+    if (state_ == MqttConnectionState::CONNECTED)
+    {
+        // Ends the command loop once DISCONNECT is sent
+        runCommand("Disconnect", [this](const MQTTAgentCommandInfo_t *commandInfo) {
+            return MQTTAgent_Disconnect(&agent_, commandInfo);
+        });
+    }
+    else
+    {
+        // Reconnecting: drop the transport so the attempt ends
+        tlsTransport_->disconnect();
+    }
+
+#ifdef ESP_PLATFORM
+    xSemaphoreTake(taskStoppedSemaphore_, portMAX_DELAY);
+    agentTask_ = nullptr;
+#else
+    agentThread_.join();
+#endif
+
+    if (tlsTransport_)
+    {
+        tlsTransport_->disconnect();
+    }
+
+    bool wasConnected = state_.exchange(MqttConnectionState::DISCONNECTED) != MqttConnectionState::DISCONNECTED;
+    metrics_.increment(MqttCounter::RECONNECTS);
+    {
+        std::lock_guard<std::mutex> lock(statisticsMutex_);
+        statistics_.lastDisconnected = std::chrono::system_clock::now();
+    }
+    LOPCORE_LOGI(TAG, "Disconnected");
+
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    if (wasConnected && connectionCallback_)
+    {
+        connectionCallback_(false);
+    }
+    return ESP_OK;
+}
+
+bool CoreMqttAgentClient::isConnected() const
+{
+    return state_ == MqttConnectionState::CONNECTED;
+}
+
+// =============================================================================
+// Publish/Subscribe
+// =============================================================================
+
+esp_err_t CoreMqttAgentClient::checkCaller(const char *operation) const
+{
+    if (state_ != MqttConnectionState::CONNECTED)
+    {
+        LOPCORE_LOGE(TAG, "Cannot %s: not connected", operation);
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (onAgentTask())
+    {
+        LOPCORE_LOGE(TAG, "Cannot %s from the agent task: enable dispatch workers", operation);
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+bool CoreMqttAgentClient::agentRunning() const
+{
+#ifdef ESP_PLATFORM
+    return agentTask_ != nullptr;
+#else
+    return agentThread_.joinable();
+#endif
+}
+
+bool CoreMqttAgentClient::onAgentTask() const
+{
+#ifdef ESP_PLATFORM
+    return xTaskGetCurrentTaskHandle() == agentTask_;
+#else
+    return std::this_thread::get_id() == agentThreadId_.load();
+#endif
+}
+
+esp_err_t CoreMqttAgentClient::publish(const std::string &topic,
+                                       const std::vector<uint8_t> &payload,
+                                       MqttQos qos,
+                                       bool retain)
+{
+    MqttPayloadSegment segment{payload.data(), payload.size()};
+    return publish(topic, &segment, 1, qos, retain);
+}
+
+esp_err_t CoreMqttAgentClient::publishString(const std::string &topic,
+                                             const std::string &payload,
+                                             MqttQos qos,
+                                             bool retain)
+{
+    MqttPayloadSegment segment{payload.data(), payload.size()};
+    return publish(topic, &segment, 1, qos, retain);
+}
+
+esp_err_t CoreMqttAgentClient::publish(std::string_view topic,
+                                       const MqttPayloadSegment *segments,
+                                       size_t segmentCount,
+                                       MqttQos qos,
+                                       bool retain)
+{
+    esp_err_t err = checkCaller("publish");
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    if (budget_ && !budget_->consume())
+    {
+        LOPCORE_LOGW(TAG, "Budget exhausted, publish to '%.*s' rejected", static_cast<int>(topic.size()),
+                     topic.data());
+        metrics_.increment(MqttCounter::PUBLISH_ERRORS);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // The command holds one payload pointer; only a multi-segment payload is copied
+    std::vector<uint8_t> gathered;
+    const void *payload = segmentCount > 0 ? segments[0].data : nullptr;
+    size_t payloadLength = segmentCount > 0 ? segments[0].size : 0;
+    if (segmentCount > 1)
+    {
+        for (size_t i = 0; i < segmentCount; i++)
+        {
+            const uint8_t *data = static_cast<const uint8_t *>(segments[i].data);
+            gathered.insert(gathered.end(), data, data + segments[i].size);
+        }
+        payload = gathered.data();
+        payloadLength = gathered.size();
+    }
+
+    MQTTPublishInfo_t publishInfo = {};
+    publishInfo.qos = static_cast<MQTTQoS_t>(qosToInt(qos));
+    publishInfo.retain = retain;
+    publishInfo.pTopicName = topic.data();
+    publishInfo.topicNameLength = static_cast<uint16_t>(topic.size());
+    publishInfo.pPayload = payload;
+    publishInfo.payloadLength = payloadLength;
+
+    int64_t startUs = esp_timer_get_time();
+    err = runCommand("Publish", [this, &publishInfo](const MQTTAgentCommandInfo_t *commandInfo) {
+        return MQTTAgent_Publish(&agent_, &publishInfo, commandInfo);
+    });
+    if (err != ESP_OK)
+    {
+        metrics_.increment(MqttCounter::PUBLISH_ERRORS);
+        return err;
+    }
+
+    metrics_.increment(MqttCounter::MESSAGES_PUBLISHED);
+    if (qos != MqttQos::AT_MOST_ONCE)
+    {
+        metrics_.publishAckLatency().record(static_cast<uint32_t>(esp_timer_get_time() - startUs));
+    }
+    return ESP_OK;
+}
+
+esp_err_t CoreMqttAgentClient::subscribe(const std::string &topic, MessageCallback callback, MqttQos qos)
+{
+    return addSubscription(topic, std::move(callback), nullptr, qos);
+}
+
+esp_err_t CoreMqttAgentClient::subscribeView(const std::string &topic, MessageViewCallback callback, MqttQos qos)
+{
+    return addSubscription(topic, nullptr, std::move(callback), qos);
+}
+
+esp_err_t CoreMqttAgentClient::addSubscription(const std::string &topic,
+                                               MessageCallback callback,
+                                               MessageViewCallback viewCallback,
+                                               MqttQos qos)
+{
+    esp_err_t err = checkCaller("subscribe");
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    if (!TopicTrie<Subscription>::isValidFilter(topic))
+    {
+        LOPCORE_LOGE(TAG, "Invalid topic filter '%s'", topic.c_str());
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Recorded first, so messages arriving right after the SUBACK are delivered
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+        if (subscriptions_.find(topic) != nullptr)
+        {
+            LOPCORE_LOGW(TAG, "Already subscribed to '%s'", topic.c_str());
+            return ESP_OK;
+        }
+        auto handler =
+            std::make_shared<MqttHandler>(MqttHandler{std::move(callback), std::move(viewCallback), nullptr});
+        subscriptions_.insert(topic, Subscription{topic, qos, std::move(handler)});
+    }
+
+    MQTTSubscribeInfo_t subscribeInfo = {};
+    subscribeInfo.pTopicFilter = topic.c_str();
+    subscribeInfo.topicFilterLength = topic.length();
+    subscribeInfo.qos = static_cast<MQTTQoS_t>(qosToInt(qos));
+    MQTTAgentSubscribeArgs_t args{&subscribeInfo, 1};
+
+    err = runCommand("Subscribe", [this, &args](const MQTTAgentCommandInfo_t *commandInfo) {
+        return MQTTAgent_Subscribe(&agent_, &args, commandInfo);
+    });
+
+    std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+    if (err != ESP_OK)
+    {
+        subscriptions_.erase(topic);
+        return err;
+    }
+    {
+        std::lock_guard<std::mutex> statisticsLock(statisticsMutex_);
+        statistics_.subscriptionCount = subscriptions_.size();
+    }
+
+    LOPCORE_LOGI(TAG, "Subscribed to '%s' (qos=%d)", topic.c_str(), qosToInt(qos));
+    return ESP_OK;
+}
+
+esp_err_t CoreMqttAgentClient::unsubscribe(const std::string &topic)
+{
+    esp_err_t err = checkCaller("unsubscribe");
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    MQTTSubscribeInfo_t unsubscribeInfo = {};
+    unsubscribeInfo.pTopicFilter = topic.c_str();
+    unsubscribeInfo.topicFilterLength = topic.length();
+    MQTTAgentSubscribeArgs_t args{&unsubscribeInfo, 1};
+
+    err = runCommand("Unsubscribe", [this, &args](const MQTTAgentCommandInfo_t *commandInfo) {
+        return MQTTAgent_Unsubscribe(&agent_, &args, commandInfo);
+    });
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+    subscriptions_.erase(topic);
+    {
+        std::lock_guard<std::mutex> statisticsLock(statisticsMutex_);
+        statistics_.subscriptionCount = subscriptions_.size();
+    }
+
+    LOPCORE_LOGI(TAG, "Unsubscribed from '%s'", topic.c_str());
+    return ESP_OK;
+}
+
+void CoreMqttAgentClient::resubscribeAll()
+{
+    if (resubscribesPending_ > 0)
+    {
+        LOPCORE_LOGW(TAG, "Previous resubscription still queued, skipping");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+    if (subscriptions_.empty())
+    {
+        return;
+    }
+    LOPCORE_LOGI(TAG, "Resubscribing to %zu topics", subscriptions_.size());
+
+    // The agent reads these after this returns; nothing touches them until every command completes
+    resubscribeTopics_.clear();
+    resubscribeInfo_.clear();
+    resubscribeArgs_.clear();
+    subscriptions_.forEach([this](const std::string &, const Subscription &sub) {
+        resubscribeTopics_.push_back(sub.topic);
+        MQTTSubscribeInfo_t subscribeInfo = {};
+        subscribeInfo.qos = static_cast<MQTTQoS_t>(qosToInt(sub.qos));
+        resubscribeInfo_.push_back(subscribeInfo);
+    });
+    for (size_t i = 0; i < resubscribeInfo_.size(); i++)
+    {
+        resubscribeInfo_[i].pTopicFilter = resubscribeTopics_[i].c_str();
+        resubscribeInfo_[i].topicFilterLength = resubscribeTopics_[i].length();
+    }
+
+    size_t perPacket = std::max<size_t>(config_.maxTopicsPerSubscribe, 1);
+    for (size_t first = 0; first < resubscribeInfo_.size(); first += perPacket)
+    {
+        resubscribeArgs_.push_back(
+            MQTTAgentSubscribeArgs_t{&resubscribeInfo_[first], std::min(perPacket, resubscribeInfo_.size() - first)});
+    }
+
+    static const auto resubscribed = [](MQTTAgentCommandContext_t *context, MQTTAgentReturnInfo_t *returnInfo) {
+        auto *client = reinterpret_cast<CoreMqttAgentClient *>(context);
+        if (returnInfo->returnCode != MQTTSuccess)
+        {
+            LOPCORE_LOGE(TAG, "Resubscribe failed: %s", MQTT_Status_strerror(returnInfo->returnCode));
+        }
+        client->resubscribesPending_--;
+    };
+
+    // Not waited for: this may run on the agent task, before its command loop resumes
+    for (MQTTAgentSubscribeArgs_t &args : resubscribeArgs_)
+    {
+        MQTTAgentCommandInfo_t commandInfo{resubscribed, reinterpret_cast<MQTTAgentCommandContext_t *>(this), 0};
+        resubscribesPending_++;
+        MQTTStatus_t status = MQTTAgent_Subscribe(&agent_, &args, &commandInfo);
+        if (status != MQTTSuccess)
+        {
+            resubscribesPending_--;
+            LOPCORE_LOGE(TAG, "Resubscribe not queued: %s", MQTT_Status_strerror(status));
+        }
+    }
+}
+
+esp_err_t CoreMqttAgentClient::setWillMessage(const std::string &topic,
+                                              const std::vector<uint8_t> &payload,
+                                              MqttQos qos,
+                                              bool retain)
+{
+    LOPCORE_LOGW(TAG, "setWillMessage() not supported: set the will in MqttConfig before connect()");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+// =============================================================================
+// Callbacks & Statistics
+// =============================================================================
+
+void CoreMqttAgentClient::setConnectionCallback(ConnectionCallback callback)
+{
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    connectionCallback_ = std::move(callback);
+}
+
+void CoreMqttAgentClient::setErrorCallback(ErrorCallback callback)
+{
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    errorCallback_ = std::move(callback);
+}
+
+MqttStatistics CoreMqttAgentClient::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(statisticsMutex_);
+    MqttStatistics stats = statistics_;
+    MqttMetricsSnapshot metrics = metrics_.snapshot();
+    stats.messagesPublished = metrics.messagesPublished;
+    stats.messagesReceived = metrics.messagesReceived;
+    stats.publishErrors = metrics.publishErrors;
+    stats.messagesDropped = metrics.messagesDropped;
+    stats.reconnectCount = metrics.reconnectCount;
+    stats.averagePublishLatency = std::chrono::milliseconds(metrics.publishAckLatency.meanUs() / 1000);
+    stats.budgetRemaining = budget_ ? budget_->getRemaining() : -1;
+    return stats;
+}
+
+MqttMetricsSnapshot CoreMqttAgentClient::getMetrics() const
+{
+    return metrics_.snapshot();
+}
+
+void CoreMqttAgentClient::resetStatistics()
+{
+    std::lock_guard<std::mutex> lock(statisticsMutex_);
+    statistics_ = MqttStatistics{};
+    metrics_.reset();
+}
+
+// =============================================================================
+// Agent Task
+// =============================================================================
+
+void CoreMqttAgentClient::agentTaskWrapper(void *pvParameters)
+{
+    static_cast<CoreMqttAgentClient *>(pvParameters)->agentTask();
+}
+
+void CoreMqttAgentClient::agentTask()
+{
+#ifndef ESP_PLATFORM
+    agentThreadId_ = std::this_thread::get_id();
+#endif
+    LOPCORE_LOGI(TAG, "Agent task started");
+
+    while (true)
+    {
+        // Returns after DISCONNECT or TERMINATE, or when the connection fails
+        MQTTStatus_t status = MQTTAgent_CommandLoop(&agent_);
+        if (stopping_)
+        {
+            break;
+        }
+
+        handleConnectionLost(status);
+        if (!canReconnect() || !reconnect())
+        {
+            break;
+        }
+    }
+
+    // Wake every task still waiting on a command
+    MQTTAgent_CancelAll(&agent_);
+
+    LOPCORE_LOGI(TAG, "Agent task exiting");
+#ifdef ESP_PLATFORM
+    xSemaphoreGive(taskStoppedSemaphore_);
+    task::exitTask();
+#else
+    agentThreadId_ = std::thread::id();
+#endif
+}
+
+void CoreMqttAgentClient::handleConnectionLost(MQTTStatus_t status)
+{
+    LOPCORE_LOGW(TAG, "Connection lost: %s", MQTT_Status_strerror(status));
+    state_ = MqttConnectionState::DISCONNECTED;
+    metrics_.increment(MqttCounter::RECONNECTS);
+    {
+        std::lock_guard<std::mutex> lock(statisticsMutex_);
+        statistics_.lastDisconnected = std::chrono::system_clock::now();
+    }
+
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    if (connectionCallback_)
+    {
+        connectionCallback_(false);
+    }
+    if (errorCallback_)
+    {
+        errorCallback_(MqttError::CONNECTION_LOST, MQTT_Status_strerror(status));
+    }
+}
+
+bool CoreMqttAgentClient::canReconnect() const
+{
+    return !stopping_ && config_.reconnect.autoReconnect && config_.tls.has_value() && tlsTransport_;
+}
+
+bool CoreMqttAgentClient::reconnect()
+{
+    // The transport retries with full-jitter backoff; the jittered first
+    // attempt spreads devices dropped by the same outage
+    lopcore::tls::TlsConfig tlsConfig = *config_.tls;
+    tlsConfig.maxRetries = config_.reconnect.maxAttempts;
+    tlsConfig.retryBaseDelay = config_.reconnect.initialDelay;
+    tlsConfig.retryMaxDelay = config_.reconnect.maxDelay;
+    tlsConfig.jitterFirstAttempt = true;
+
+    state_ = MqttConnectionState::RECONNECTING;
+    LOPCORE_LOGI(TAG, "Reconnecting to %s:%d", config_.broker.c_str(), config_.port);
+
+    tlsTransport_->disconnect();
+    esp_err_t err = tlsTransport_->connect(tlsConfig);
+    if (err == ESP_OK && !stopping_)
+    {
+        // The agent task owns the MQTT context and is outside its command loop
+        err = sendConnect();
+        if (err == ESP_OK)
+        {
+            std::lock_guard<std::mutex> lock(callbackMutex_);
+            if (connectionCallback_)
+            {
+                connectionCallback_(true);
+            }
+            return true;
+        }
+    }
+
+    state_ = MqttConnectionState::DISCONNECTED;
+    if (!stopping_)
+    {
+        LOPCORE_LOGE(TAG, "Reconnect failed: %s", esp_err_to_name(err));
+        std::lock_guard<std::mutex> lock(callbackMutex_);
+        if (errorCallback_)
+        {
+            errorCallback_(MqttError::CONNECTION_LOST, "Reconnect failed");
+        }
+    }
+    return false;
+}
+
+// =============================================================================
+// Incoming Messages
+// =============================================================================
+
+void CoreMqttAgentClient::incomingPublishCallback(MQTTAgentContext_t *agentContext,
+                                                  uint16_t packetId,
+                                                  MQTTPublishInfo_t *publishInfo)
+{
+    auto *client = static_cast<CoreMqttAgentClient *>(agentContext->pIncomingCallbackContext);
+    if (client != nullptr)
+    {
+        client->handleIncomingPublish(packetId, publishInfo);
+    }
+}
+
+void CoreMqttAgentClient::handleIncomingPublish(uint16_t packetId, MQTTPublishInfo_t *publishInfo)
+{
+    MqttMessageView view;
+    view.topic = std::string_view(publishInfo->pTopicName, publishInfo->topicNameLength);
+    view.payload = static_cast<const uint8_t *>(publishInfo->pPayload);
+    view.payloadLength = publishInfo->payloadLength;
+    view.qos = static_cast<MqttQos>(publishInfo->qos);
+    view.retained = publishInfo->retain;
+    view.messageId = packetId;
+
+    metrics_.increment(MqttCounter::MESSAGES_RECEIVED);
+    int64_t deliveryStartUs = esp_timer_get_time();
+
+    // Only the trie lookup holds the lock; callbacks run without it
+    dispatchHandlers_.clear();
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+        subscriptions_.match(view.topic, [this](Subscription &sub) { dispatchHandlers_.push_back(sub.handler); });
+    }
+
+    if (dispatcher_)
+    {
+        if (!dispatchHandlers_.empty())
+        {
+            dispatcher_->dispatch(view, dispatchHandlers_);
+        }
+    }
+    else
+    {
+        std::optional<MqttMessage> msg;
+        for (const MqttHandlerPtr &handler : dispatchHandlers_)
+        {
+            handler->invoke(view, msg);
+        }
+    }
+    metrics_.callbackDuration().record(static_cast<uint32_t>(esp_timer_get_time() - deliveryStartUs));
+}
+
+// =============================================================================
+// Transport Layer
+// =============================================================================
+
+int32_t CoreMqttAgentClient::transportSend(NetworkContext_t *pNetworkContext,
+                                           const void *pBuffer,
+                                           size_t bytesToSend)
+{
+    if (pNetworkContext == nullptr || pBuffer == nullptr)
+    {
+        LOPCORE_LOGE(TAG, "Invalid transport send parameters");
+        return -1;
+    }
+
+    CoreMqttAgentClient *client = reinterpret_cast<AgentNetworkContext *>(pNetworkContext)->client;
+    size_t bytesSent = 0;
+    esp_err_t err = client->tlsTransport_->send(pBuffer, bytesToSend, &bytesSent);
+    if (err != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "TLS send failed: %s", esp_err_to_name(err));
+        return -1;
+    }
+    return static_cast<int32_t>(bytesSent);
+}
+
+int32_t CoreMqttAgentClient::transportRecv(NetworkContext_t *pNetworkContext, void *pBuffer, size_t bytesToRecv)
+{
+    if (pNetworkContext == nullptr || pBuffer == nullptr)
+    {
+        LOPCORE_LOGE(TAG, "Invalid transport receive parameters");
+        return -1;
+    }
+
+    CoreMqttAgentClient *client = reinterpret_cast<AgentNetworkContext *>(pNetworkContext)->client;
+    size_t bytesReceived = 0;
+    esp_err_t err = client->tlsTransport_->recv(pBuffer, bytesToRecv, &bytesReceived);
+    if (err == ESP_OK)
+    {
+        return static_cast<int32_t>(bytesReceived);
+    }
+    if (err == ESP_ERR_TIMEOUT)
+    {
+        return 0; // No data yet; the agent goes back to its command queue
+    }
+    LOPCORE_LOGE(TAG, "TLS recv failed: %s", esp_err_to_name(err));
+    return -1;
+}
+
+uint32_t CoreMqttAgentClient::getTimeMs()
+{
+    return esp_timer_get_time() / 1000;
+}
+
+} // namespace mqtt
+} // namespace lopcore
@@ -13,9 +13,11 @@
 
 #include <algorithm>
 #include <cstring>
+#include <optional>
 
 #include "lopcore/logging/logger.hpp"
-#include "lopcore/tls/mbedtls_transport.hpp"
+#include "lopcore/task/task_profile.hpp"
+#include "lopcore/tls/tls_transport.hpp"
 #include "lopcore/tls/tls_config.hpp"
 
 static const char *TAG = "coremqtt_client";
@@ -32,8 +34,10 @@ namespace mqtt
 CoreMqttClient::CoreMqttClient(const MqttConfig &config,
                                std::shared_ptr<lopcore::tls::ITlsTransport> transport)
     : config_(config), mqttContext_{}, transport_{}, networkContext_{}, tlsTransport_(transport),
-      budget_(nullptr), state_(MqttConnectionState::DISCONNECTED), processTask_(nullptr), shouldRun_(false),
-      taskStoppedSemaphore_(nullptr)
+      budget_(nullptr), topicTable_(config.topicTableSize), state_(MqttConnectionState::DISCONNECTED),
+      nextPublishHandle_(1), skipRecv_(false), lastSendMs_(0), waitSupported_(true), processTask_(nullptr),
+      shouldRun_(false), taskStoppedSemaphore_(nullptr), reconnectEnabled_(false), reconnectsPending_(0),
+      reconnectCaller_(nullptr)
 {
     // Create semaphore for task synchronization
     taskStoppedSemaphore_ = xSemaphoreCreateBinary();
@@ -79,15 +83,61 @@ CoreMqttClient::CoreMqttClient(const MqttConfig &config,
         LOPCORE_LOGI(TAG, "Message budgeting enabled");
     }
 
+    if (!config_.budgetClasses.empty())
+    {
+        budgetScheduler_ = std::make_unique<MqttBudgetScheduler>(config_.budgetClasses, budget_.get());
+    }
+
+    // Only a resumed session can ask for a DUP resend
+    if (!config_.cleanSession && config_.retransmitSlots > 0)
+    {
+        retransmitStore_ = std::make_unique<MqttRetransmitStore>(config_.retransmitSlots,
+                                                                 config_.retransmitSlotSize);
+    }
+
+    // Opened lazily: the filesystem may be mounted after the client is built
+    if (config_.spool.enabled)
+    {
+        spool_ = std::make_unique<MqttSpool>(config_.spool);
+    }
+
+    if (config_.dispatch.workers > 0)
+    {
+        dispatcher_ = std::make_unique<MqttDispatcher>(config_.dispatch);
+        if (dispatcher_->start() != ESP_OK)
+        {
+            LOPCORE_LOGW(TAG, "Dispatch workers unavailable, callbacks run inline");
+            dispatcher_.reset();
+        }
+    }
+
     // Allocate network buffer
-    networkBuffer_.resize(config_.networkBufferSize);
+    if (!networkBuffer_.allocate(config_.networkBufferSize))
+    {
+        // MQTT_Init() below rejects the empty buffer
+        LOPCORE_LOGE(TAG, "No memory for a %u-byte network buffer",
+                     static_cast<unsigned>(config_.networkBufferSize));
+    }
 
     // Allocate QoS record arrays
-    outgoingPublishRecords_.resize(16); // MQTT_STATE_ARRAY_MAX_COUNT
-    incomingPublishRecords_.resize(16);
+    outgoingPublishRecords_.resize(config_.publishRecordCount);
+    incomingPublishRecords_.resize(config_.publishRecordCount);
+
+    // Direct-mapped packet ID -> record table, at least twice the records so
+    // the sequential IDs in flight rarely share a bucket
+    size_t hintCount = 1;
+    while (hintCount < 2 * outgoingPublishRecords_.size())
+    {
+        hintCount <<= 1;
+    }
+    recordHints_.assign(hintCount, 0);
+
+    // Allocate publishAsync() slots
+    asyncPublishes_.resize(config_.publishQueueDepth);
 
     // Setup transport interface
     transport_.send = transportSend;
+    transport_.writev = transportWritev;
     transport_.recv = transportRecv;
     transport_.pNetworkContext = &networkContext_;
 
@@ -121,6 +171,22 @@ CoreMqttClient::~CoreMqttClient()
 {
     disconnect();
 
+    // A reconnect callback may still be running on the transport's task
+    while (reconnectsPending_.load() > 0)
+    {
+        if (tlsTransport_)
+        {
+            tlsTransport_->disconnect();
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    // Workers may still be calling into this client
+    if (dispatcher_)
+    {
+        dispatcher_->stop();
+    }
+
     // Clean up semaphore
     if (taskStoppedSemaphore_ != nullptr)
     {
@@ -209,7 +275,8 @@ esp_err_t CoreMqttClient::connect()
     }
 
     state_ = MqttConnectionState::CONNECTED;
-    statistics_.reconnectCount++;
+    reconnectEnabled_ = true;
+    metrics_.increment(MqttCounter::RECONNECTS);
     statistics_.lastConnected = std::chrono::system_clock::now();
 
     LOPCORE_LOGI(TAG, "Connected to %s:%d (session=%s)", config_.broker.c_str(), config_.port,
@@ -240,6 +307,13 @@ esp_err_t CoreMqttClient::connect()
     // Resubscribe if needed
     if (!sessionPresent)
     {
+        // coreMQTT cleared its QoS records, so nothing is left to resend
+        if (retransmitStore_ && !retransmitStore_->empty())
+        {
+            LOPCORE_LOGW(TAG, "Broker started a new session: %zu unacknowledged publishes dropped",
+                         retransmitStore_->size());
+            retransmitStore_->clear();
+        }
         resubscribeTopics();
     }
     else
@@ -253,10 +327,26 @@ esp_err_t CoreMqttClient::connect()
 
 esp_err_t CoreMqttClient::disconnect()
 {
+    reconnectEnabled_ = false;
+
     // Stop ProcessLoop task first (if running)
     stopProcessLoopTask();
 
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (state_ == MqttConnectionState::RECONNECTING ||
+        (state_ == MqttConnectionState::DISCONNECTED && reconnectsPending_ > 0))
+    {
+        // Nothing to send DISCONNECT on: cancel the transport's retries
+        state_ = MqttConnectionState::DISCONNECTED;
+        lock.unlock();
+        if (tlsTransport_)
+        {
+            tlsTransport_->disconnect();
+        }
+        LOPCORE_LOGI(TAG, "Reconnect cancelled");
+        return ESP_OK;
+    }
 
     if (state_ == MqttConnectionState::DISCONNECTED)
     {
@@ -271,7 +361,8 @@ esp_err_t CoreMqttClient::disconnect()
     }
 
     state_ = MqttConnectionState::DISCONNECTED;
-    statistics_.reconnectCount++;
+    failAsyncPublishes(ESP_ERR_INVALID_STATE);
+    metrics_.increment(MqttCounter::RECONNECTS);
     statistics_.lastDisconnected = std::chrono::system_clock::now();
 
     // Disconnect TLS transport
@@ -288,6 +379,9 @@ esp_err_t CoreMqttClient::disconnect()
         connectionCallback_(false);
     }
 
+    lock.unlock();
+    deliverPublishCompletions();
+
     return ESP_OK;
 }
 
@@ -304,66 +398,484 @@ esp_err_t CoreMqttClient::publish(const std::string &topic,
                                   const std::vector<uint8_t> &payload,
                                   MqttQos qos,
                                   bool retain)
+{
+    MqttPayloadSegment segment{payload.data(), payload.size()};
+    return publishSegments(topic, &segment, 1, qos, retain);
+}
+
+esp_err_t CoreMqttClient::publish(std::string_view topic,
+                                  const MqttPayloadSegment *segments,
+                                  size_t segmentCount,
+                                  MqttQos qos,
+                                  bool retain)
+{
+    if (segments == nullptr && segmentCount > 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return publishSegments(topic, segments, segmentCount, qos, retain);
+}
+
+TopicHandle CoreMqttClient::registerTopic(std::string_view topic)
+{
+    return topicTable_.intern(topic);
+}
+
+std::string_view CoreMqttClient::topicName(TopicHandle topic) const
+{
+    const std::string *name = topicTable_.lookup(topic);
+    return name != nullptr ? std::string_view(*name) : std::string_view();
+}
+
+esp_err_t CoreMqttClient::publish(TopicHandle topic,
+                                  const MqttPayloadSegment *segments,
+                                  size_t segmentCount,
+                                  MqttQos qos,
+                                  bool retain)
+{
+    const std::string *name = topicTable_.lookup(topic);
+    if (name == nullptr || (segments == nullptr && segmentCount > 0))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return publishSegments(*name, segments, segmentCount, qos, retain);
+}
+
+esp_err_t
+CoreMqttClient::publishString(const std::string &topic, const std::string &payload, MqttQos qos, bool retain)
+{
+    MqttPayloadSegment segment{payload.data(), payload.size()};
+    return publishSegments(topic, &segment, 1, qos, retain);
+}
+
+esp_err_t CoreMqttClient::publishSegments(std::string_view topic,
+                                          const MqttPayloadSegment *segments,
+                                          size_t segmentCount,
+                                          MqttQos qos,
+                                          bool retain)
 {
     std::lock_guard<std::mutex> lock(mutex_);
 
-    if (state_ != MqttConnectionState::CONNECTED)
+    // Spooled records go out first, so queue behind them until drained
+    bool connected = (state_ == MqttConnectionState::CONNECTED);
+    if (spoolReady() && (!connected || !spool_->empty()))
+    {
+        esp_err_t err = spool_->append(topic, segments, segmentCount, qos, retain);
+        if (err != ESP_OK)
+        {
+            LOPCORE_LOGE(TAG, "Failed to spool publish to '%.*s': %s", static_cast<int>(topic.size()),
+                         topic.data(), esp_err_to_name(err));
+            metrics_.increment(MqttCounter::PUBLISH_ERRORS);
+            return err;
+        }
+        LOPCORE_LOGD(TAG, "Spooled publish to '%.*s' (%zu pending)", static_cast<int>(topic.size()),
+                     topic.data(), spool_->pendingCount());
+        return ESP_OK;
+    }
+
+    if (!connected)
     {
         LOPCORE_LOGE(TAG, "Cannot publish: not connected");
         return ESP_ERR_INVALID_STATE;
     }
 
-    // Check budget
-    if (budget_ && !budget_->consume())
+    size_t payloadLength = 0;
+    for (size_t i = 0; i < segmentCount; i++)
+    {
+        payloadLength += segments[i].size;
+    }
+
+    // Check budget; a budget class may queue the publish instead
+    if (budgetScheduler_)
+    {
+        bool deferred = false;
+        if (budgetScheduler_->admit(topic, segments, segmentCount, qos, retain, &deferred) != ESP_OK)
+        {
+            LOPCORE_LOGW(TAG, "Publish rejected: budget exceeded");
+            metrics_.increment(MqttCounter::PUBLISH_ERRORS); // Track as publish error
+            return ESP_ERR_NO_MEM;
+        }
+        if (deferred)
+        {
+            LOPCORE_LOGD(TAG, "Deferred publish to '%.*s' (%zu waiting for budget)",
+                         static_cast<int>(topic.size()), topic.data(), budgetScheduler_->deferredCount());
+            return ESP_OK;
+        }
+    }
+    else if (!consumeBudget(topic, payloadLength, qos))
     {
         LOPCORE_LOGW(TAG, "Publish rejected: budget exceeded");
-        statistics_.publishErrors++; // Track as publish error
+        metrics_.increment(MqttCounter::PUBLISH_ERRORS); // Track as publish error
         return ESP_ERR_NO_MEM;
     }
 
+    uint16_t packetId = MQTT_PACKET_ID_INVALID;
+    MQTTStatus_t mqttStatus;
+    if (segmentCount <= 1)
+    {
+        const uint8_t *payload = segmentCount == 1 ? static_cast<const uint8_t *>(segments[0].data) : nullptr;
+        mqttStatus = sendPublish(topic, payload, payloadLength, qos, retain, &packetId);
+    }
+    else if (qos == MqttQos::AT_MOST_ONCE && segmentCount <= MAX_GATHER_SEGMENTS)
+    {
+        mqttStatus = sendPublishGathered(topic, segments, segmentCount, payloadLength, retain);
+    }
+    else
+    {
+        // coreMQTT keeps a single payload pointer for QoS 1/2 retransmission
+        gatherBuffer_.clear();
+        for (size_t i = 0; i < segmentCount; i++)
+        {
+            const uint8_t *data = static_cast<const uint8_t *>(segments[i].data);
+            gatherBuffer_.insert(gatherBuffer_.end(), data, data + segments[i].size);
+        }
+        mqttStatus = sendPublish(topic, gatherBuffer_.data(), payloadLength, qos, retain, &packetId);
+    }
+
+    if (mqttStatus != MQTTSuccess)
+    {
+        LOPCORE_LOGE(TAG, "MQTT_Publish failed: %d", mqttStatus);
+        return ESP_FAIL;
+    }
+
+    LOPCORE_LOGD(TAG, "Published to '%.*s' (qos=%d, size=%zu, packetId=%u)", static_cast<int>(topic.size()),
+                 topic.data(), qosToInt(qos), payloadLength, packetId);
+
+    return ESP_OK;
+}
+
+MQTTStatus_t CoreMqttClient::sendPublish(std::string_view topic,
+                                         const uint8_t *payload,
+                                         size_t payloadLength,
+                                         MqttQos qos,
+                                         bool retain,
+                                         uint16_t *packetId)
+{
     // Build PUBLISH packet
     MQTTPublishInfo_t publishInfo = {};
     publishInfo.qos = static_cast<MQTTQoS_t>(qosToInt(qos));
     publishInfo.retain = retain;
-    publishInfo.pTopicName = topic.c_str();
-    publishInfo.topicNameLength = topic.length();
-    publishInfo.pPayload = payload.data();
-    publishInfo.payloadLength = payload.size();
+    publishInfo.pTopicName = topic.data();
+    publishInfo.topicNameLength = static_cast<uint16_t>(topic.size());
+    publishInfo.pPayload = payload;
+    publishInfo.payloadLength = payloadLength;
 
     // Generate packet ID for QoS > 0
-    uint16_t packetId = MQTT_PACKET_ID_INVALID;
+    *packetId = MQTT_PACKET_ID_INVALID;
     if (qos != MqttQos::AT_MOST_ONCE)
     {
-        packetId = MQTT_GetPacketId(&mqttContext_);
+        *packetId = MQTT_GetPacketId(&mqttContext_);
+    }
+
+    // Keep a copy until acknowledged, for a DUP resend if the session is resumed
+    bool stored = false;
+    if (retransmitStore_ && *packetId != MQTT_PACKET_ID_INVALID)
+    {
+        esp_err_t err = retransmitStore_->store(*packetId, topic, payload, payloadLength, qos, retain);
+        stored = (err == ESP_OK);
+        if (!stored)
+        {
+            LOPCORE_LOGW(TAG, "Publish %u to '%.*s' not kept for retransmission: %s", *packetId,
+                         static_cast<int>(topic.size()), topic.data(), esp_err_to_name(err));
+        }
     }
 
     // Send PUBLISH
-    MQTTStatus_t mqttStatus = MQTT_Publish(&mqttContext_, &publishInfo, packetId);
+    MQTTStatus_t mqttStatus = MQTT_Publish(&mqttContext_, &publishInfo, *packetId);
 
-    if (mqttStatus != MQTTSuccess)
+    if (mqttStatus == MQTTSuccess)
     {
-        LOPCORE_LOGE(TAG, "MQTT_Publish failed: %d", mqttStatus);
-        return ESP_FAIL;
+        metrics_.increment(MqttCounter::MESSAGES_PUBLISHED);
+        metrics_.publishSent(*packetId, esp_timer_get_time()); // Ignored for QoS 0
+    }
+    else if (stored)
+    {
+        retransmitStore_->release(*packetId); // The caller sees the error and owns the retry
+    }
+
+    return mqttStatus;
+}
+
+MQTTStatus_t CoreMqttClient::sendPublishGathered(std::string_view topic,
+                                                 const MqttPayloadSegment *segments,
+                                                 size_t segmentCount,
+                                                 size_t payloadLength,
+                                                 bool retain)
+{
+    // MQTT 3.1.1 limits: 16-bit topic length, remaining length up to 268435455
+    constexpr size_t MAX_REMAINING_LENGTH = 268435455;
+    if (tlsTransport_ == nullptr || topic.empty() || topic.size() > UINT16_MAX ||
+        payloadLength > MAX_REMAINING_LENGTH - 2 - topic.size())
+    {
+        return MQTTBadParameter;
     }
 
-    statistics_.messagesPublished++;
-    // Note: bytesPublished not in MqttStatistics struct
+    // Fixed header, remaining length (1-4 bytes) and topic length prefix
+    uint8_t header[7];
+    size_t headerLength = 0;
+    header[headerLength++] = static_cast<uint8_t>(0x30 | (retain ? 0x01 : 0x00));
+    size_t remaining = 2 + topic.size() + payloadLength;
+    do
+    {
+        uint8_t byte = static_cast<uint8_t>(remaining % 128);
+        remaining /= 128;
+        header[headerLength++] = remaining > 0 ? static_cast<uint8_t>(byte | 0x80) : byte;
+    } while (remaining > 0);
+    header[headerLength++] = static_cast<uint8_t>(topic.size() >> 8);
+    header[headerLength++] = static_cast<uint8_t>(topic.size() & 0xFF);
+
+    lopcore::tls::TlsSegment vector[MAX_GATHER_SEGMENTS + 2];
+    size_t vectorCount = 0;
+    vector[vectorCount++] = {header, headerLength};
+    vector[vectorCount++] = {topic.data(), topic.size()};
+    for (size_t i = 0; i < segmentCount; i++)
+    {
+        vector[vectorCount++] = {segments[i].data, segments[i].size};
+    }
 
-    LOPCORE_LOGD(TAG, "Published to '%s' (qos=%d, size=%zu, packetId=%u)", topic.c_str(), qosToInt(qos),
-                 payload.size(), packetId);
+    size_t packetLength = headerLength + topic.size() + payloadLength;
+    size_t written = 0;
+    lopcore::tls::TlsSegment *next = vector;
+    size_t left = vectorCount;
+    while (written < packetLength)
+    {
+        size_t sent = 0;
+        esp_err_t err = tlsTransport_->sendv(next, left, &sent);
+        if (err != ESP_OK || sent == 0)
+        {
+            LOPCORE_LOGE(TAG, "Gathered publish failed after %zu of %zu bytes: %s", written, packetLength,
+                         esp_err_to_name(err));
+            if (written > 0)
+            {
+                handleConnectionLost(); // Peer saw a partial packet
+            }
+            return MQTTSendFailed;
+        }
 
+        // Skip what was written and resume inside a partly sent segment
+        written += sent;
+        while (left > 0 && sent >= next->size)
+        {
+            sent -= next->size;
+            next++;
+            left--;
+        }
+        if (left > 0)
+        {
+            next->data = static_cast<const uint8_t *>(next->data) + sent;
+            next->size -= sent;
+        }
+    }
+
+    metrics_.increment(MqttCounter::MESSAGES_PUBLISHED);
+    return MQTTSuccess;
+}
+
+// =============================================================================
+// Asynchronous Publish
+// =============================================================================
+
+esp_err_t CoreMqttClient::publishAsync(const std::string &topic,
+                                       const std::vector<uint8_t> &payload,
+                                       MqttQos qos,
+                                       PublishCompleteCallback onComplete,
+                                       bool retain,
+                                       PublishHandle *handle)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (state_ != MqttConnectionState::CONNECTED)
+    {
+        LOPCORE_LOGE(TAG, "Cannot publish: not connected");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    AsyncPublish *slot = nullptr;
+    for (auto &entry : asyncPublishes_)
+    {
+        if (entry.state == AsyncPublishState::FREE)
+        {
+            slot = &entry;
+            break;
+        }
+    }
+    if (slot == nullptr)
+    {
+        LOPCORE_LOGW(TAG, "Publish rejected: async queue full");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Check budget
+    if (!consumeBudget(topic, payload.size(), qos))
+    {
+        LOPCORE_LOGW(TAG, "Publish rejected: budget exceeded");
+        metrics_.increment(MqttCounter::PUBLISH_ERRORS); // Track as publish error
+        return ESP_ERR_NO_MEM;
+    }
+
+    // assign() reuses the slot's capacity from earlier requests
+    slot->handle = nextPublishHandle_++;
+    if (nextPublishHandle_ == 0)
+    {
+        nextPublishHandle_ = 1;
+    }
+    slot->packetId = MQTT_PACKET_ID_INVALID;
+    slot->qos = qos;
+    slot->retain = retain;
+    slot->result = ESP_OK;
+    slot->topic.assign(topic);
+    slot->payload.assign(payload.begin(), payload.end());
+    slot->onComplete = std::move(onComplete);
+    slot->state = AsyncPublishState::QUEUED;
+
+    if (handle != nullptr)
+    {
+        *handle = slot->handle;
+    }
+
+    // processLoop() holds the lock only per packet, so this rarely waits
+    sendQueuedPublishes();
     return ESP_OK;
 }
 
-esp_err_t
-CoreMqttClient::publishString(const std::string &topic, const std::string &payload, MqttQos qos, bool retain)
+size_t CoreMqttClient::getPendingPublishCount() const
 {
-    // Convert string to byte vector
-    std::vector<uint8_t> data(payload.begin(), payload.end());
-    return publish(topic, data, qos, retain);
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t count = 0;
+    for (const auto &entry : asyncPublishes_)
+    {
+        if (entry.state == AsyncPublishState::QUEUED || entry.state == AsyncPublishState::IN_FLIGHT)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+void CoreMqttClient::sendQueuedPublishes()
+{
+    while (true)
+    {
+        // Oldest queued request first (handles increase monotonically)
+        AsyncPublish *next = nullptr;
+        for (auto &entry : asyncPublishes_)
+        {
+            if (entry.state == AsyncPublishState::QUEUED &&
+                (next == nullptr || static_cast<int32_t>(entry.handle - next->handle) < 0))
+            {
+                next = &entry;
+            }
+        }
+        if (next == nullptr)
+        {
+            return;
+        }
+
+        MQTTStatus_t mqttStatus = sendPublish(next->topic, next->payload.data(), next->payload.size(),
+                                              next->qos, next->retain, &next->packetId);
+
+        if (mqttStatus == MQTTNoMemory)
+        {
+            // coreMQTT's outgoing QoS records are full; retry after an ACK frees one
+            return;
+        }
+
+        if (mqttStatus != MQTTSuccess)
+        {
+            LOPCORE_LOGE(TAG, "MQTT_Publish failed: %d", mqttStatus);
+            metrics_.increment(MqttCounter::PUBLISH_ERRORS);
+            next->result = ESP_FAIL;
+            next->state = AsyncPublishState::COMPLETED;
+            continue;
+        }
+
+        LOPCORE_LOGD(TAG, "Published to '%s' (qos=%d, size=%zu, packetId=%u)", next->topic.c_str(),
+                     qosToInt(next->qos), next->payload.size(), next->packetId);
+
+        next->state = (next->qos == MqttQos::AT_MOST_ONCE) ? AsyncPublishState::COMPLETED
+                                                           : AsyncPublishState::IN_FLIGHT;
+    }
+}
+
+void CoreMqttClient::completeAsyncPublish(uint16_t packetId)
+{
+    for (auto &entry : asyncPublishes_)
+    {
+        if (entry.state == AsyncPublishState::IN_FLIGHT && entry.packetId == packetId)
+        {
+            entry.result = ESP_OK;
+            entry.state = AsyncPublishState::COMPLETED;
+            return;
+        }
+    }
+}
+
+void CoreMqttClient::failAsyncPublishes(esp_err_t result)
+{
+    for (auto &entry : asyncPublishes_)
+    {
+        if (entry.state == AsyncPublishState::QUEUED || entry.state == AsyncPublishState::IN_FLIGHT)
+        {
+            entry.result = result;
+            entry.state = AsyncPublishState::COMPLETED;
+        }
+    }
+}
+
+void CoreMqttClient::deliverPublishCompletions()
+{
+    // One completion per lock hold, so callbacks run unlocked and may publish again
+    while (true)
+    {
+        PublishCompleteCallback onComplete;
+        PublishHandle handle = 0;
+        esp_err_t result = ESP_OK;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            AsyncPublish *done = nullptr;
+            for (auto &entry : asyncPublishes_)
+            {
+                if (entry.state == AsyncPublishState::COMPLETED)
+                {
+                    done = &entry;
+                    break;
+                }
+            }
+            if (done == nullptr)
+            {
+                return;
+            }
+
+            onComplete = std::move(done->onComplete);
+            done->onComplete = nullptr;
+            handle = done->handle;
+            result = done->result;
+            done->state = AsyncPublishState::FREE;
+        }
+
+        if (onComplete)
+        {
+            onComplete(handle, result);
+        }
+    }
 }
 
 esp_err_t CoreMqttClient::subscribe(const std::string &topic, MessageCallback callback, MqttQos qos)
+{
+    return addSubscription(topic, std::move(callback), nullptr, qos);
+}
+
+esp_err_t CoreMqttClient::subscribeView(const std::string &topic, MessageViewCallback callback, MqttQos qos)
+{
+    return addSubscription(topic, nullptr, std::move(callback), qos);
+}
+
+esp_err_t CoreMqttClient::addSubscription(const std::string &topic,
+                                          MessageCallback callback,
+                                          MessageViewCallback viewCallback,
+                                          MqttQos qos)
 {
     std::lock_guard<std::mutex> lock(mutex_);
 
@@ -373,8 +885,14 @@ esp_err_t CoreMqttClient::subscribe(const std::string &topic, MessageCallback ca
         return ESP_ERR_INVALID_STATE;
     }
 
+    if (!TopicTrie<Subscription>::isValidFilter(topic))
+    {
+        LOPCORE_LOGE(TAG, "Invalid topic filter '%s'", topic.c_str());
+        return ESP_ERR_INVALID_ARG;
+    }
+
     // Check if already subscribed
-    if (findSubscription(topic) != nullptr)
+    if (subscriptions_.find(topic) != nullptr)
     {
         LOPCORE_LOGW(TAG, "Already subscribed to '%s'", topic.c_str());
         return ESP_OK;
@@ -397,7 +915,8 @@ esp_err_t CoreMqttClient::subscribe(const std::string &topic, MessageCallback ca
     }
 
     // Add to subscription list
-    subscriptions_.push_back({topic, callback, qos});
+    auto handler = std::make_shared<MqttHandler>(MqttHandler{std::move(callback), std::move(viewCallback), nullptr});
+    subscriptions_.insert(topic, Subscription{topic, qos, std::move(handler)});
     statistics_.subscriptionCount = subscriptions_.size();
 
     LOPCORE_LOGI(TAG, "Subscribed to '%s' (qos=%d)", topic.c_str(), qosToInt(qos));
@@ -409,37 +928,161 @@ esp_err_t CoreMqttClient::unsubscribe(const std::string &topic)
 {
     std::lock_guard<std::mutex> lock(mutex_);
 
-    if (state_ != MqttConnectionState::CONNECTED)
+    if (state_ != MqttConnectionState::CONNECTED)
+    {
+        LOPCORE_LOGE(TAG, "Cannot unsubscribe: not connected");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Build UNSUBSCRIBE packet
+    MQTTSubscribeInfo_t unsubscribeInfo = {};
+    unsubscribeInfo.pTopicFilter = topic.c_str();
+    unsubscribeInfo.topicFilterLength = topic.length();
+
+    uint16_t packetId = MQTT_GetPacketId(&mqttContext_);
+
+    MQTTStatus_t mqttStatus = MQTT_Unsubscribe(&mqttContext_, &unsubscribeInfo, 1, packetId);
+
+    if (mqttStatus != MQTTSuccess)
+    {
+        LOPCORE_LOGE(TAG, "MQTT_Unsubscribe failed: %d", mqttStatus);
+        return ESP_FAIL;
+    }
+
+    // Remove from subscription list
+    subscriptions_.erase(topic);
+    statistics_.subscriptionCount = subscriptions_.size();
+
+    LOPCORE_LOGI(TAG, "Unsubscribed from '%s'", topic.c_str());
+
+    return ESP_OK;
+}
+
+esp_err_t CoreMqttClient::subscribeMany(const std::vector<MqttSubscribeRequest> &requests)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (state_ != MqttConnectionState::CONNECTED)
+    {
+        LOPCORE_LOGE(TAG, "Cannot subscribe: not connected");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    for (const auto &request : requests)
+    {
+        if (!TopicTrie<Subscription>::isValidFilter(request.topic))
+        {
+            LOPCORE_LOGE(TAG, "Invalid topic filter '%s'", request.topic.c_str());
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    std::vector<const MqttSubscribeRequest *> pending;
+    std::vector<MQTTSubscribeInfo_t> filters;
+    pending.reserve(requests.size());
+    filters.reserve(requests.size());
+    for (const auto &request : requests)
+    {
+        if (subscriptions_.find(request.topic) != nullptr)
+        {
+            LOPCORE_LOGW(TAG, "Already subscribed to '%s'", request.topic.c_str());
+            continue;
+        }
+
+        MQTTSubscribeInfo_t subscribeInfo = {};
+        subscribeInfo.pTopicFilter = request.topic.c_str();
+        subscribeInfo.topicFilterLength = request.topic.length();
+        subscribeInfo.qos = static_cast<MQTTQoS_t>(qosToInt(request.qos));
+        filters.push_back(subscribeInfo);
+        pending.push_back(&request);
+    }
+
+    size_t sent = 0;
+    esp_err_t result = sendTopicFilters(filters, true, &sent);
+
+    // Only what reached the broker is tracked (and resubscribed later)
+    for (size_t i = 0; i < sent; i++)
+    {
+        const MqttSubscribeRequest &request = *pending[i];
+        auto handler = std::make_shared<MqttHandler>(MqttHandler{request.callback, request.viewCallback, nullptr});
+        subscriptions_.insert(request.topic, Subscription{request.topic, request.qos, std::move(handler)});
+    }
+    statistics_.subscriptionCount = subscriptions_.size();
+
+    LOPCORE_LOGI(TAG, "Subscribed to %zu of %zu topics", sent, filters.size());
+
+    return result;
+}
+
+esp_err_t CoreMqttClient::unsubscribeMany(const std::vector<std::string> &topics)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (state_ != MqttConnectionState::CONNECTED)
+    {
+        LOPCORE_LOGE(TAG, "Cannot unsubscribe: not connected");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    std::vector<MQTTSubscribeInfo_t> filters;
+    filters.reserve(topics.size());
+    for (const auto &topic : topics)
+    {
+        MQTTSubscribeInfo_t unsubscribeInfo = {};
+        unsubscribeInfo.pTopicFilter = topic.c_str();
+        unsubscribeInfo.topicFilterLength = topic.length();
+        filters.push_back(unsubscribeInfo);
+    }
+
+    size_t sent = 0;
+    esp_err_t result = sendTopicFilters(filters, false, &sent);
+
+    for (size_t i = 0; i < sent; i++)
     {
-        LOPCORE_LOGE(TAG, "Cannot unsubscribe: not connected");
-        return ESP_ERR_INVALID_STATE;
+        subscriptions_.erase(topics[i]);
     }
+    statistics_.subscriptionCount = subscriptions_.size();
 
-    // Build UNSUBSCRIBE packet
-    MQTTSubscribeInfo_t unsubscribeInfo = {};
-    unsubscribeInfo.pTopicFilter = topic.c_str();
-    unsubscribeInfo.topicFilterLength = topic.length();
+    LOPCORE_LOGI(TAG, "Unsubscribed from %zu of %zu topics", sent, topics.size());
 
-    uint16_t packetId = MQTT_GetPacketId(&mqttContext_);
+    return result;
+}
 
-    MQTTStatus_t mqttStatus = MQTT_Unsubscribe(&mqttContext_, &unsubscribeInfo, 1, packetId);
+esp_err_t CoreMqttClient::sendTopicFilters(const std::vector<MQTTSubscribeInfo_t> &filters,
+                                           bool subscribe,
+                                           size_t *sent)
+{
+    size_t first = 0;
+    size_t packets = 0;
+    esp_err_t result = ESP_OK;
 
-    if (mqttStatus != MQTTSuccess)
+    while (first < filters.size())
     {
-        LOPCORE_LOGE(TAG, "MQTT_Unsubscribe failed: %d", mqttStatus);
-        return ESP_FAIL;
-    }
+        const MQTTSubscribeInfo_t *batch = &filters[first];
+        size_t count = topicFiltersPerPacket(filters.size() - first, config_.networkBufferSize,
+                                             config_.maxTopicsPerSubscribe, subscribe,
+                                             [batch](size_t i) { return batch[i].topicFilterLength; });
 
-    // Remove from subscription list
-    auto it = std::remove_if(subscriptions_.begin(), subscriptions_.end(),
-                             [&topic](const Subscription &sub) { return sub.topic == topic; });
+        uint16_t packetId = MQTT_GetPacketId(&mqttContext_);
+        MQTTStatus_t mqttStatus = subscribe ? MQTT_Subscribe(&mqttContext_, batch, count, packetId)
+                                            : MQTT_Unsubscribe(&mqttContext_, batch, count, packetId);
 
-    subscriptions_.erase(it, subscriptions_.end());
-    statistics_.subscriptionCount = subscriptions_.size();
+        if (mqttStatus != MQTTSuccess)
+        {
+            LOPCORE_LOGE(TAG, "%s of %zu topics failed: %d",
+                         subscribe ? "MQTT_Subscribe" : "MQTT_Unsubscribe", count, mqttStatus);
+            result = ESP_FAIL;
+            break;
+        }
 
-    LOPCORE_LOGI(TAG, "Unsubscribed from '%s'", topic.c_str());
+        first += count;
+        packets++;
+    }
 
-    return ESP_OK;
+    LOPCORE_LOGD(TAG, "Sent %zu topic filters in %zu packets", first, packets);
+
+    *sent = first;
+    return result;
 }
 
 esp_err_t CoreMqttClient::setWillMessage(const std::string &topic,
@@ -477,13 +1120,43 @@ void CoreMqttClient::setErrorCallback(ErrorCallback callback)
 MqttStatistics CoreMqttClient::getStatistics() const
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    return statistics_;
+    MqttStatistics stats = statistics_;
+    MqttMetricsSnapshot metrics = metrics_.snapshot();
+    stats.messagesPublished = metrics.messagesPublished;
+    stats.messagesReceived = metrics.messagesReceived;
+    stats.publishErrors = metrics.publishErrors;
+    stats.messagesDropped = metrics.messagesDropped;
+    stats.reconnectCount = metrics.reconnectCount;
+    stats.averagePublishLatency = std::chrono::milliseconds(metrics.publishAckLatency.meanUs() / 1000);
+    stats.budgetRemaining = budget_ ? budget_->getRemaining() : -1;
+    return stats;
+}
+
+MqttMetricsSnapshot CoreMqttClient::getMetrics() const
+{
+    return metrics_.snapshot();
+}
+
+void CoreMqttClient::registerMetrics(metrics::MetricsRegistry &registry, std::string_view prefix)
+{
+    metrics_.registerMetrics(registry, prefix);
+    std::string name(prefix);
+    name.append(".budget");
+    if (budget_)
+    {
+        budget_->registerMetrics(registry, name);
+    }
+    if (budgetScheduler_)
+    {
+        budgetScheduler_->registerMetrics(registry, name);
+    }
 }
 
 void CoreMqttClient::resetStatistics()
 {
     std::lock_guard<std::mutex> lock(mutex_);
     statistics_ = MqttStatistics{};
+    metrics_.reset();
 }
 
 // =============================================================================
@@ -492,8 +1165,6 @@ void CoreMqttClient::resetStatistics()
 
 esp_err_t CoreMqttClient::processLoop(uint32_t timeoutMs)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-
     if (state_ != MqttConnectionState::CONNECTED)
     {
         return ESP_ERR_INVALID_STATE;
@@ -502,58 +1173,289 @@ esp_err_t CoreMqttClient::processLoop(uint32_t timeoutMs)
     // Calculate timeout deadline
     uint32_t startTimeMs = getTimeMs();
     uint32_t endTimeMs = startTimeMs + timeoutMs;
-    uint32_t currentTimeMs = startTimeMs;
 
-    MQTTStatus_t mqttStatus = MQTTSuccess;
+    esp_err_t result = ESP_OK;
+
+    // Wait for socket data with mutex_ released, then take it for one
+    // MQTT_ProcessLoop() call at a time. publish() and friends therefore
+    // wait behind a single packet, not behind the whole timeout window.
+    do
+    {
+        uint32_t currentTimeMs = getTimeMs();
+        uint32_t remainingMs = (currentTimeMs < endTimeMs) ? (endTimeMs - currentTimeMs) : 0;
+
+        esp_err_t ready = tlsTransport_ ? tlsTransport_->waitForData(remainingMs) : ESP_ERR_INVALID_STATE;
+        waitSupported_ = (ready != ESP_ERR_NOT_SUPPORTED);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (state_ != MqttConnectionState::CONNECTED)
+            {
+                result = ESP_ERR_INVALID_STATE;
+                break;
+            }
+
+            if (ready != ESP_OK && ready != ESP_ERR_TIMEOUT && ready != ESP_ERR_NOT_SUPPORTED)
+            {
+                LOPCORE_LOGE(TAG, "Transport wait failed: %s", esp_err_to_name(ready));
+                handleConnectionLost();
+                result = ESP_FAIL;
+                break;
+            }
+
+            // Nothing to read: still run once so keep-alive pings go out,
+            // but make the receive return straight away instead of blocking
+            skipRecv_ = (ready == ESP_ERR_TIMEOUT);
+
+            // MQTT_ProcessLoop() processes at most one MQTT packet per call
+            // MQTTNeedMoreBytes means "no data available yet, try again"
+            int64_t iterationStartUs = esp_timer_get_time();
+            MQTTStatus_t mqttStatus = MQTT_ProcessLoop(&mqttContext_);
+            skipRecv_ = false;
+            metrics_.processLoopDuration().record(
+                static_cast<uint32_t>(esp_timer_get_time() - iterationStartUs));
+
+            // Check for actual errors (not timeout-related)
+            if (mqttStatus != MQTTSuccess && mqttStatus != MQTTNeedMoreBytes)
+            {
+                LOPCORE_LOGE(TAG, "MQTT_ProcessLoop failed: %d", mqttStatus);
+                handleConnectionLost();
+                result = ESP_FAIL;
+                break;
+            }
+
+            // An acknowledgement may have freed a QoS record for a queued publish
+            sendQueuedPublishes();
+        }
+
+        deliverPublishCompletions();
+
+        if (ready == ESP_ERR_TIMEOUT)
+        {
+            break;
+        }
+    } while (getTimeMs() < endTimeMs);
+
+    // Replay a bounded batch per call so live traffic keeps flowing
+    if (result == ESP_OK && (spool_ || budgetScheduler_))
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (state_ == MqttConnectionState::CONNECTED)
+        {
+            drainSpool();
+            drainDeferred();
+        }
+    }
+
+    // Failures above complete the remaining publishAsync() requests
+    deliverPublishCompletions();
+
+    // Timeout or success
+    return result;
+}
+
+bool CoreMqttClient::spoolReady()
+{
+    if (!spool_)
+    {
+        return false;
+    }
+    if (!spool_->isOpen() && spool_->open() != ESP_OK)
+    {
+        return false; // Retried on the next publish
+    }
+    return true;
+}
+
+void CoreMqttClient::drainSpool()
+{
+    if (!spoolReady() || spool_->empty())
+    {
+        return;
+    }
+
+    size_t sent = spool_->drain(config_.spool.drainBatch, [this](const MqttMessageView &msg) {
+        if (!consumeBudget(msg.topic, msg.payloadLength, msg.qos))
+        {
+            return ESP_ERR_NO_MEM; // Resume once the budget refills
+        }
+
+        uint16_t packetId = MQTT_PACKET_ID_INVALID;
+        MQTTStatus_t mqttStatus =
+            sendPublish(msg.topic, msg.payload, msg.payloadLength, msg.qos, msg.retained, &packetId);
+        if (mqttStatus != MQTTSuccess)
+        {
+            LOPCORE_LOGW(TAG, "Spooled publish to '%.*s' failed: %d", static_cast<int>(msg.topic.size()),
+                         msg.topic.data(), mqttStatus);
+            return ESP_FAIL;
+        }
+        return ESP_OK;
+    });
+
+    if (sent > 0)
+    {
+        LOPCORE_LOGI(TAG, "Replayed %zu spooled publishes (%zu pending)", sent, spool_->pendingCount());
+    }
+}
+
+bool CoreMqttClient::consumeBudget(std::string_view topic, size_t payloadLength, MqttQos qos)
+{
+    if (budgetScheduler_)
+    {
+        return budgetScheduler_->consume(topic, payloadLength, qos);
+    }
+    return !budget_ || budget_->consume(budget_->costOf(topic.size(), payloadLength, qos));
+}
+
+void CoreMqttClient::drainDeferred()
+{
+    if (!budgetScheduler_ || budgetScheduler_->deferredCount() == 0)
+    {
+        return;
+    }
+
+    size_t sent = budgetScheduler_->drain([this](const MqttMessageView &msg) {
+        uint16_t packetId = MQTT_PACKET_ID_INVALID;
+        MQTTStatus_t mqttStatus =
+            sendPublish(msg.topic, msg.payload, msg.payloadLength, msg.qos, msg.retained, &packetId);
+        if (mqttStatus != MQTTSuccess)
+        {
+            LOPCORE_LOGW(TAG, "Deferred publish to '%.*s' failed: %d", static_cast<int>(msg.topic.size()),
+                         msg.topic.data(), mqttStatus);
+            return ESP_FAIL;
+        }
+        return ESP_OK;
+    });
+
+    if (sent > 0)
+    {
+        LOPCORE_LOGD(TAG, "Sent %zu deferred publishes (%zu waiting)", sent,
+                     budgetScheduler_->deferredCount());
+    }
+}
+
+void CoreMqttClient::handleConnectionLost()
+{
+    // Connection lost - trigger disconnect
+    state_ = MqttConnectionState::DISCONNECTED;
+    failAsyncPublishes(ESP_ERR_INVALID_STATE);
 
-    // Call MQTT_ProcessLoop repeatedly until timeout expires
-    // MQTT_ProcessLoop() processes exactly one MQTT packet per call
-    // MQTTNeedMoreBytes means "no data available yet, try again"
-    while ((currentTimeMs < endTimeMs) && (mqttStatus == MQTTSuccess || mqttStatus == MQTTNeedMoreBytes))
+    // Disconnect TLS transport
+    if (tlsTransport_)
     {
-        mqttStatus = MQTT_ProcessLoop(&mqttContext_);
-        currentTimeMs = getTimeMs();
+        tlsTransport_->disconnect();
     }
 
-    // Check for actual errors (not timeout-related)
-    if (mqttStatus != MQTTSuccess && mqttStatus != MQTTNeedMoreBytes)
+    if (connectionCallback_)
     {
-        LOPCORE_LOGE(TAG, "MQTT_ProcessLoop failed: %d", mqttStatus);
+        connectionCallback_(false);
+    }
+}
+
+bool CoreMqttClient::canReconnect() const
+{
+    return reconnectEnabled_ && config_.reconnect.autoReconnect && config_.tls.has_value() && tlsTransport_;
+}
 
-        // Connection lost - trigger disconnect
+void CoreMqttClient::startReconnect()
+{
+    // The transport's backoff is full jitter; the extra random delay before
+    // the first attempt spreads devices dropped by the same outage
+    lopcore::tls::TlsConfig tlsConfig = *config_.tls;
+    tlsConfig.maxRetries = config_.reconnect.maxAttempts;
+    tlsConfig.retryBaseDelay = config_.reconnect.initialDelay;
+    tlsConfig.retryMaxDelay = config_.reconnect.maxDelay;
+    tlsConfig.jitterFirstAttempt = true;
+
+    state_ = MqttConnectionState::RECONNECTING;
+    reconnectCaller_ = xTaskGetCurrentTaskHandle();
+    LOPCORE_LOGI(TAG, "Reconnecting to %s:%d in the background", config_.broker.c_str(), config_.port);
+
+    esp_err_t err =
+        tlsTransport_->connectAsync(tlsConfig, [this](esp_err_t result) { onReconnect(result); });
+    if (err != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "Failed to start reconnect: %s", esp_err_to_name(err));
         state_ = MqttConnectionState::DISCONNECTED;
+        reconnectsPending_--;
+    }
+}
 
-        // Disconnect TLS transport
-        if (tlsTransport_)
+void CoreMqttClient::onReconnect(esp_err_t result)
+{
+    // Transports without a background task call back from connectAsync()
+    // itself; trying again from here would recurse
+    bool calledInline = reconnectCaller_.load() == xTaskGetCurrentTaskHandle();
+    bool retry = false;
+
+    // Nothing to do once disconnect() cancelled the reconnect
+    if (reconnectEnabled_ && result == ESP_OK)
+    {
+        // Reap the process loop task that exited on the connection loss;
+        // connect() starts a new one
+        stopProcessLoopTask();
+        result = connect();
+        if (result != ESP_OK)
         {
+            LOPCORE_LOGW(TAG, "MQTT CONNECT after reconnect failed: %s", esp_err_to_name(result));
             tlsTransport_->disconnect();
+            retry = !calledInline && reconnectEnabled_;
         }
+    }
+    else if (reconnectEnabled_)
+    {
+        LOPCORE_LOGE(TAG, "Reconnect attempts exhausted: %s", esp_err_to_name(result));
+    }
 
-        if (connectionCallback_)
+    if (retry)
+    {
+        reconnectsPending_++;
+        startReconnect();
+    }
+    else if (result != ESP_OK)
+    {
+        state_ = MqttConnectionState::DISCONNECTED;
+        if (reconnectEnabled_ && errorCallback_)
         {
-            connectionCallback_(false);
+            errorCallback_(MqttError::CONNECTION_LOST, "Reconnect failed");
         }
-
-        return ESP_FAIL;
     }
 
-    // Timeout or success
-    return ESP_OK;
+    // Last access: the destructor waits for this to reach zero
+    reconnectsPending_--;
 }
 
 MQTTPublishState_t CoreMqttClient::getPublishState(uint16_t packetId) const
 {
     std::lock_guard<std::mutex> lock(mutex_);
 
-    for (const auto &record : outgoingPublishRecords_)
+    const MQTTPubAckInfo_t *record = findOutgoingRecord(packetId);
+    return record != nullptr ? record->publishState : MQTTStateNull;
+}
+
+const MQTTPubAckInfo_t *CoreMqttClient::findOutgoingRecord(uint16_t packetId) const
+{
+    if (packetId == MQTT_PACKET_ID_INVALID || recordHints_.empty())
+    {
+        return nullptr;
+    }
+
+    uint16_t &hint = recordHints_[packetId & (recordHints_.size() - 1)];
+    if (hint != 0 && outgoingPublishRecords_[hint - 1].packetId == packetId)
     {
-        if (record.packetId == packetId)
+        return &outgoingPublishRecords_[hint - 1];
+    }
+
+    for (size_t i = 0; i < outgoingPublishRecords_.size(); i++)
+    {
+        if (outgoingPublishRecords_[i].packetId == packetId)
         {
-            return record.publishState;
+            hint = static_cast<uint16_t>(i + 1);
+            return &outgoingPublishRecords_[i];
         }
     }
-
-    return MQTTStateNull;
+    return nullptr;
 }
 
 bool CoreMqttClient::hasOutstandingPackets() const
@@ -572,6 +1474,12 @@ bool CoreMqttClient::hasOutstandingPackets() const
     return false;
 }
 
+size_t CoreMqttClient::getSpoolPending() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return spool_ && spool_->isOpen() ? spool_->pendingCount() : 0;
+}
+
 // =============================================================================
 // Transport Layer (TLS with PKCS#11)
 // =============================================================================
@@ -600,6 +1508,7 @@ int32_t CoreMqttClient::transportSend(NetworkContext_t *pNetworkContext,
 
     if (err == ESP_OK)
     {
+        client->lastSendMs_ = getTimeMs();
         return static_cast<int32_t>(bytesSent);
     }
     else
@@ -609,6 +1518,56 @@ int32_t CoreMqttClient::transportSend(NetworkContext_t *pNetworkContext,
     }
 }
 
+int32_t CoreMqttClient::transportWritev(NetworkContext_t *pNetworkContext,
+                                        TransportOutVector_t *pIoVec,
+                                        size_t ioVecCount)
+{
+    if (pNetworkContext == nullptr || pIoVec == nullptr)
+    {
+        LOPCORE_LOGE(TAG, "Invalid transport writev parameters");
+        return -1;
+    }
+
+    CoreMqttClient *client = pNetworkContext->client;
+    if (client == nullptr || client->tlsTransport_ == nullptr)
+    {
+        LOPCORE_LOGE(TAG, "Invalid client or transport");
+        return -1;
+    }
+
+    // coreMQTT passes a handful of vectors per packet; forward them in small batches
+    constexpr size_t BATCH = 8;
+    lopcore::tls::TlsSegment segments[BATCH];
+    size_t total = 0;
+    for (size_t first = 0; first < ioVecCount; first += BATCH)
+    {
+        size_t count = std::min(BATCH, ioVecCount - first);
+        size_t requested = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            segments[i] = {pIoVec[first + i].iov_base, pIoVec[first + i].iov_len};
+            requested += pIoVec[first + i].iov_len;
+        }
+
+        size_t sent = 0;
+        esp_err_t err = client->tlsTransport_->sendv(segments, count, &sent);
+        if (err != ESP_OK)
+        {
+            LOPCORE_LOGE(TAG, "TLS send failed: %s", esp_err_to_name(err));
+            return total > 0 ? static_cast<int32_t>(total) : -1;
+        }
+
+        total += sent;
+        client->lastSendMs_ = getTimeMs();
+        if (sent < requested)
+        {
+            break; // coreMQTT resumes short writes itself
+        }
+    }
+
+    return static_cast<int32_t>(total);
+}
+
 int32_t CoreMqttClient::transportRecv(NetworkContext_t *pNetworkContext, void *pBuffer, size_t bytesToRecv)
 {
     if (pNetworkContext == nullptr || pBuffer == nullptr)
@@ -625,6 +1584,13 @@ int32_t CoreMqttClient::transportRecv(NetworkContext_t *pNetworkContext, void *p
         return -1;
     }
 
+    if (client->skipRecv_)
+    {
+        // processLoop() already knows no data is waiting
+        client->skipRecv_ = false;
+        return 0;
+    }
+
     // Receive via TLS transport
     size_t bytesReceived = 0;
     esp_err_t err = client->tlsTransport_->recv(pBuffer, bytesToRecv, &bytesReceived);
@@ -677,26 +1643,45 @@ void CoreMqttClient::handleEvent(MQTTPacketInfo_t *pPacketInfo, MQTTDeserialized
     // out the lower bits to check if the packet is publish.
     if ((pPacketInfo->type & 0xF0U) == MQTT_PACKET_TYPE_PUBLISH)
     {
-        // Incoming message
+        // Incoming message, viewed in place in the network buffer
         MQTTPublishInfo_t *pubInfo = pDeserializedInfo->pPublishInfo;
 
-        std::string topic(pubInfo->pTopicName, pubInfo->topicNameLength);
-        std::vector<uint8_t> payload(static_cast<const uint8_t *>(pubInfo->pPayload),
-                                     static_cast<const uint8_t *>(pubInfo->pPayload) +
-                                         pubInfo->payloadLength);
+        MqttMessageView view;
+        view.topic = std::string_view(pubInfo->pTopicName, pubInfo->topicNameLength);
+        view.payload = static_cast<const uint8_t *>(pubInfo->pPayload);
+        view.payloadLength = pubInfo->payloadLength;
+        view.qos = static_cast<MqttQos>(pubInfo->qos);
+        view.retained = pubInfo->retain;
+        view.messageId = pDeserializedInfo->packetIdentifier;
 
-        statistics_.messagesReceived++;
-        // Note: bytesReceived not in MqttStatistics struct
+        metrics_.increment(MqttCounter::MESSAGES_RECEIVED);
 
-        LOPCORE_LOGD(TAG, "Received message on '%s' (size=%zu)", topic.c_str(), payload.size());
+        LOPCORE_LOGD(TAG, "Received message on '%.*s' (size=%zu)", static_cast<int>(view.topic.size()),
+                     view.topic.data(), view.payloadLength);
 
-        // Call topic-specific callback
-        Subscription *sub = findSubscription(topic);
-        if (sub && sub->callback)
+        int64_t deliveryStartUs = esp_timer_get_time();
+
+        if (dispatcher_)
+        {
+            // Copy the message into a worker queue; callbacks run on the
+            // worker, so a slow one no longer stalls this loop
+            dispatchHandlers_.clear();
+            subscriptions_.match(view.topic,
+                                 [this](Subscription &sub) { dispatchHandlers_.push_back(sub.handler); });
+            if (!dispatchHandlers_.empty())
+            {
+                dispatcher_->dispatch(view, dispatchHandlers_);
+            }
+        }
+        else
         {
-            MqttMessage msg{topic, payload, static_cast<MqttQos>(pubInfo->qos), pubInfo->retain};
-            sub->callback(msg);
+            // Call every matching subscription (wildcards included); the owning
+            // copy is made at most once, and only if an owning callback matches
+            std::optional<MqttMessage> msg;
+            subscriptions_.match(view.topic,
+                                 [&view, &msg](Subscription &sub) { sub.handler->invoke(view, msg); });
         }
+        metrics_.callbackDuration().record(static_cast<uint32_t>(esp_timer_get_time() - deliveryStartUs));
     }
     else
     {
@@ -713,10 +1698,14 @@ void CoreMqttClient::handleEvent(MQTTPacketInfo_t *pPacketInfo, MQTTDeserialized
 
             case MQTT_PACKET_TYPE_PUBACK:
                 LOPCORE_LOGD(TAG, "PUBACK received (packetId=%u)", pDeserializedInfo->packetIdentifier);
+                releaseRetransmit(pDeserializedInfo->packetIdentifier);
+                completeAsyncPublish(pDeserializedInfo->packetIdentifier);
+                metrics_.publishAcked(pDeserializedInfo->packetIdentifier, esp_timer_get_time());
                 break;
 
             case MQTT_PACKET_TYPE_PUBREC:
                 LOPCORE_LOGD(TAG, "PUBREC received (packetId=%u)", pDeserializedInfo->packetIdentifier);
+                releaseRetransmit(pDeserializedInfo->packetIdentifier); // Only PUBREL is resent from here
                 break;
 
             case MQTT_PACKET_TYPE_PUBREL:
@@ -725,6 +1714,8 @@ void CoreMqttClient::handleEvent(MQTTPacketInfo_t *pPacketInfo, MQTTDeserialized
 
             case MQTT_PACKET_TYPE_PUBCOMP:
                 LOPCORE_LOGD(TAG, "PUBCOMP received (packetId=%u)", pDeserializedInfo->packetIdentifier);
+                completeAsyncPublish(pDeserializedInfo->packetIdentifier);
+                metrics_.publishAcked(pDeserializedInfo->packetIdentifier, esp_timer_get_time());
                 break;
 
             case MQTT_PACKET_TYPE_PINGRESP:
@@ -749,68 +1740,89 @@ uint32_t CoreMqttClient::getTimeMs()
 
 esp_err_t CoreMqttClient::resendPendingPublishes()
 {
-    LOPCORE_LOGI(TAG, "Resending pending publishes");
-
-    // Note: CoreMQTT's stateful QoS management handles retransmission internally.
-    // The MQTTPubAckInfo_t structure only tracks acknowledgment state, not the
-    // original publish parameters (topic, payload, etc.).
-    //
-    // For proper DUP flag retransmission, we would need to:
-    // 1. Store original publish info (topic, payload, QoS) for each packet
-    // 2. Re-create MQTTPublishInfo_t from stored data
-    // 3. Call MQTT_Publish() with dup=true
-    //
-    // However, CoreMQTT's MQTT_ProcessLoop() handles retransmission automatically
-    // for QoS > 0 messages, so manual resending is typically not required.
-
-    for (const auto &record : outgoingPublishRecords_)
+    if (!retransmitStore_ || retransmitStore_->empty())
     {
-        if (record.packetId != MQTT_PACKET_ID_INVALID && record.publishState == MQTTPubAckPending)
+        return ESP_OK;
+    }
+
+    LOPCORE_LOGI(TAG, "Resending %zu unacknowledged publishes", retransmitStore_->size());
+
+    esp_err_t result = ESP_OK;
+    size_t resent = 0;
+    retransmitStore_->forEach([this, &result, &resent](const MqttRetransmitStore::Entry &entry) {
+        const MQTTPubAckInfo_t *record = findOutgoingRecord(entry.packetId);
+        bool awaitingPublish = record != nullptr &&
+                               (record->publishState == MQTTPubAckPending ||
+                                record->publishState == MQTTPubRecPending ||
+                                record->publishState == MQTTPublishSend);
+        if (!awaitingPublish)
         {
-            LOPCORE_LOGD(TAG, "Pending PUBACK for packetId=%u (handled by CoreMQTT)", record.packetId);
+            // Acknowledged, or forgotten by coreMQTT: nothing to send
+            retransmitStore_->release(entry.packetId);
+            return;
         }
-        else if (record.packetId != MQTT_PACKET_ID_INVALID && record.publishState == MQTTPubCompPending)
+        if (result != ESP_OK)
         {
-            LOPCORE_LOGD(TAG, "Pending PUBCOMP for packetId=%u (handled by CoreMQTT)", record.packetId);
+            return; // Kept for the next resume
         }
-    }
 
-    return ESP_OK;
+        MQTTPublishInfo_t publishInfo = {};
+        publishInfo.qos = static_cast<MQTTQoS_t>(qosToInt(entry.qos));
+        publishInfo.retain = entry.retain;
+        publishInfo.dup = true;
+        publishInfo.pTopicName = entry.topic.data();
+        publishInfo.topicNameLength = static_cast<uint16_t>(entry.topic.size());
+        publishInfo.pPayload = entry.payload;
+        publishInfo.payloadLength = entry.payloadLength;
+
+        // coreMQTT accepts the existing state record for a DUP publish
+        MQTTStatus_t mqttStatus = MQTT_Publish(&mqttContext_, &publishInfo, entry.packetId);
+        if (mqttStatus != MQTTSuccess)
+        {
+            LOPCORE_LOGE(TAG, "DUP resend of packetId=%u failed: %d", entry.packetId, mqttStatus);
+            result = ESP_FAIL;
+            return;
+        }
+        resent++;
+    });
+
+    LOPCORE_LOGI(TAG, "Resent %zu publishes with DUP set", resent);
+    return result;
+}
+
+void CoreMqttClient::releaseRetransmit(uint16_t packetId)
+{
+    if (retransmitStore_)
+    {
+        retransmitStore_->release(packetId);
+    }
 }
 
 esp_err_t CoreMqttClient::resubscribeTopics()
 {
     LOPCORE_LOGI(TAG, "Resubscribing to %zu topics", subscriptions_.size());
 
-    for (const auto &sub : subscriptions_)
-    {
+    // Pointers into the trie stay valid: it is not modified while mutex_ is held
+    std::vector<MQTTSubscribeInfo_t> filters;
+    filters.reserve(subscriptions_.size());
+    subscriptions_.forEach([&filters](const std::string &, const Subscription &sub) {
         MQTTSubscribeInfo_t subscribeInfo = {};
         subscribeInfo.pTopicFilter = sub.topic.c_str();
         subscribeInfo.topicFilterLength = sub.topic.length();
         subscribeInfo.qos = static_cast<MQTTQoS_t>(qosToInt(sub.qos));
+        filters.push_back(subscribeInfo);
+    });
 
-        uint16_t packetId = MQTT_GetPacketId(&mqttContext_);
-
-        MQTTStatus_t mqttStatus = MQTT_Subscribe(&mqttContext_, &subscribeInfo, 1, packetId);
-
-        if (mqttStatus != MQTTSuccess)
-        {
-            LOPCORE_LOGE(TAG, "Failed to resubscribe to '%s': %d", sub.topic.c_str(), mqttStatus);
-            return ESP_FAIL;
-        }
-
-        LOPCORE_LOGD(TAG, "Resubscribed to '%s'", sub.topic.c_str());
+    size_t sent = 0;
+    esp_err_t result = sendTopicFilters(filters, true, &sent);
+    if (result != ESP_OK)
+    {
+        const MQTTSubscribeInfo_t &failed = filters[sent];
+        LOPCORE_LOGE(TAG, "Failed to resubscribe to '%.*s'", static_cast<int>(failed.topicFilterLength),
+                     failed.pTopicFilter);
     }
 
-    return ESP_OK;
-}
-
-CoreMqttClient::Subscription *CoreMqttClient::findSubscription(const std::string &topic)
-{
-    auto it = std::find_if(subscriptions_.begin(), subscriptions_.end(),
-                           [&topic](const Subscription &sub) { return sub.topic == topic; });
-
-    return (it != subscriptions_.end()) ? &(*it) : nullptr;
+    return result;
 }
 
 // =============================================================================
@@ -834,15 +1846,9 @@ esp_err_t CoreMqttClient::startProcessLoopTask()
     }
 
     shouldRun_ = true;
-    BaseType_t xReturned = xTaskCreate(processLoopTaskWrapper,
-                                       "coremqtt_loop", // Task name
-                                       4096,            // Stack size (4KB)
-                                       this,            // Pass 'this' pointer as parameter
-                                       5,               // Priority (tskIDLE_PRIORITY + 5)
-                                       &processTask_    // Task handle
-    );
-
-    if (xReturned != pdPASS)
+    // Core, priority and stack from the task profile (TaskRole::MQTT_LOOP)
+    if (task::spawn(task::TaskRole::MQTT_LOOP, "coremqtt_loop", processLoopTaskWrapper, this, &processTask_) !=
+        ESP_OK)
     {
         LOPCORE_LOGE(TAG, "Failed to create ProcessLoop task");
         processTask_ = nullptr;
@@ -863,13 +1869,18 @@ esp_err_t CoreMqttClient::stopProcessLoopTask()
 
     LOPCORE_LOGI(TAG, "Stopping ProcessLoop task...");
 
-    // Signal task to stop (atomic - no mutex needed)
+    // Signal task to stop (atomic - no mutex needed) and wake it from its socket wait
     shouldRun_ = false;
+    if (tlsTransport_)
+    {
+        tlsTransport_->cancelWait();
+    }
 
     // Wait for task to signal completion via semaphore
     // Task will exit its loop and give the semaphore before deleting itself
-    // Max wait time: processLoop timeout + delay + some overhead
-    const uint32_t maxWaitMs = config_.processLoopTimeoutMs + config_.processLoopDelayMs + 100;
+    // Max wait time: longest wait (if it cannot be cancelled) + delay + some overhead
+    const uint32_t maxWaitMs = std::max(config_.processLoopTimeoutMs, config_.processLoopIdleMs) +
+                               config_.processLoopDelayMs + 100;
     const TickType_t maxWaitTicks = pdMS_TO_TICKS(maxWaitMs);
 
     if (xSemaphoreTake(taskStoppedSemaphore_, maxWaitTicks) == pdTRUE)
@@ -882,6 +1893,7 @@ esp_err_t CoreMqttClient::stopProcessLoopTask()
         // Timeout - task didn't signal completion
         LOPCORE_LOGE(TAG, "ProcessLoop task did not stop within timeout!");
         LOPCORE_LOGW(TAG, "Force deleting ProcessLoop task");
+        task::forgetTask(processTask_);
         vTaskDelete(processTask_);
         processTask_ = nullptr;
     }
@@ -912,6 +1924,25 @@ bool CoreMqttClient::isAutoProcessingEnabled() const
     return isProcessLoopTaskRunning();
 }
 
+uint32_t CoreMqttClient::nextWakeMs()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Keep replaying the spool and deferred publishes at a steady pace
+    if ((spool_ && spool_->isOpen() && !spool_->empty()) ||
+        (budgetScheduler_ && budgetScheduler_->deferredCount() > 0))
+    {
+        return config_.processLoopDelayMs;
+    }
+
+    // coreMQTT sends PINGREQ once nothing was sent for a keep-alive interval
+    uint32_t keepAliveMs = static_cast<uint32_t>(config_.keepAlive.count()) * 1000;
+    uint32_t idleMs = getTimeMs() - lastSendMs_;
+    uint32_t untilPingMs = idleMs < keepAliveMs ? keepAliveMs - idleMs : 0;
+
+    return std::min(untilPingMs, config_.processLoopIdleMs);
+}
+
 void CoreMqttClient::processLoopTaskWrapper(void *pvParameters)
 {
     CoreMqttClient *client = static_cast<CoreMqttClient *>(pvParameters);
@@ -923,8 +1954,8 @@ void CoreMqttClient::processLoopTaskWrapper(void *pvParameters)
 
 void CoreMqttClient::processLoopTask()
 {
-    LOPCORE_LOGI(TAG, "ProcessLoop task started (timeout: %lu ms, delay: %lu ms)",
-                 config_.processLoopTimeoutMs, config_.processLoopDelayMs);
+    LOPCORE_LOGI(TAG, "ProcessLoop task started (idle: %lu ms, delay: %lu ms)", config_.processLoopIdleMs,
+                 config_.processLoopDelayMs);
 
     // Main processing loop - check shouldRun_ at the start of each iteration
     while (shouldRun_)
@@ -936,8 +1967,9 @@ void CoreMqttClient::processLoopTask()
             break;
         }
 
-        // Call processLoop with configured timeout
-        esp_err_t err = processLoop(config_.processLoopTimeoutMs);
+        // Block on the socket until data, the next keep-alive ping or cancelWait()
+        uint32_t waitMs = waitSupported_ ? nextWakeMs() : config_.processLoopTimeoutMs;
+        esp_err_t err = processLoop(waitMs);
 
         if (err != ESP_OK)
         {
@@ -955,17 +1987,33 @@ void CoreMqttClient::processLoopTask()
             }
         }
 
-        // Sleep between iterations to prevent busy-waiting
-        vTaskDelay(pdMS_TO_TICKS(config_.processLoopDelayMs));
+        // Without waitForData() processLoop() returns at once when idle; sleep to prevent busy-waiting
+        if (!waitSupported_)
+        {
+            vTaskDelay(pdMS_TO_TICKS(config_.processLoopDelayMs));
+        }
     }
 
     LOPCORE_LOGI(TAG, "ProcessLoop task exiting gracefully");
 
+    // Left because the connection was lost, not because of stopProcessLoopTask().
+    // Counted before the semaphore so the destructor waits for the reconnect.
+    bool reconnect = shouldRun_ && canReconnect();
+    if (reconnect)
+    {
+        reconnectsPending_++;
+    }
+
     // Signal that we've stopped (give semaphore before deleting ourselves)
     xSemaphoreGive(taskStoppedSemaphore_);
 
+    if (reconnect)
+    {
+        startReconnect();
+    }
+
     // Delete ourselves
-    vTaskDelete(nullptr);
+    task::exitTask();
 }
 
 } // namespace mqtt
@@ -13,8 +13,12 @@
 
 #include <algorithm>
 #include <cstring>
+#include <optional>
+
+#include <esp_timer.h>
 
 #include "lopcore/logging/logger.hpp"
+#include "lopcore/task/task_profile.hpp"
 
 static const char *TAG = "esp_mqtt_client";
 
@@ -28,7 +32,8 @@ namespace mqtt
 // =============================================================================
 
 EspMqttClient::EspMqttClient(const MqttConfig &config)
-    : config_(config), mqttHandle_(nullptr), state_(MqttConnectionState::DISCONNECTED), budget_(nullptr)
+    : config_(config), mqttHandle_(nullptr), state_(MqttConnectionState::DISCONNECTED), budget_(nullptr),
+      topicTable_(config.topicTableSize)
 {
     // Validate configuration
     esp_err_t err = config_.validate();
@@ -46,6 +51,28 @@ EspMqttClient::EspMqttClient(const MqttConfig &config)
         LOPCORE_LOGI(TAG, "Message budgeting enabled");
     }
 
+    // ESP-MQTT has no loop to send deferred publishes from, so classes only limit
+    if (!config_.budgetClasses.empty())
+    {
+        budgetScheduler_ = std::make_unique<MqttBudgetScheduler>(config_.budgetClasses, budget_.get());
+    }
+
+    if (config_.inboundPool.blocks > 0)
+    {
+        inboundPool_ =
+            std::make_unique<MqttMessagePool>(config_.inboundPool.blocks, config_.inboundPool.blockSize);
+    }
+
+    if (config_.dispatch.workers > 0)
+    {
+        dispatcher_ = std::make_unique<MqttDispatcher>(config_.dispatch);
+        if (dispatcher_->start() != ESP_OK)
+        {
+            LOPCORE_LOGW(TAG, "Dispatch workers unavailable, callbacks run inline");
+            dispatcher_.reset();
+        }
+    }
+
     // Configure ESP-MQTT client
     esp_mqtt_client_config_t mqttConfig = {};
 
@@ -112,6 +139,11 @@ EspMqttClient::EspMqttClient(const MqttConfig &config)
     mqttConfig.buffer.size = config_.networkBufferSize;
     mqttConfig.buffer.out_size = config_.networkBufferSize;
 
+    // Task placement; the core is fixed by CONFIG_MQTT_TASK_CORE_SELECTION
+    task::TaskSettings taskSettings = task::getSettings(task::TaskRole::MQTT_ESP);
+    mqttConfig.task.priority = static_cast<int>(taskSettings.priority);
+    mqttConfig.task.stack_size = static_cast<int>(taskSettings.stackSize);
+
     // Reconnection configuration
     const auto &reconnect = config_.reconnect;
     mqttConfig.network.reconnect_timeout_ms = reconnect.initialDelay.count();
@@ -153,6 +185,12 @@ EspMqttClient::~EspMqttClient()
         mqttHandle_ = nullptr;
     }
 
+    // Workers may still be calling into this client
+    if (dispatcher_)
+    {
+        dispatcher_->stop();
+    }
+
     LOPCORE_LOGI(TAG, "ESP-MQTT client destroyed");
 }
 
@@ -244,6 +282,91 @@ esp_err_t EspMqttClient::publish(const std::string &topic,
                                  const std::vector<uint8_t> &payload,
                                  MqttQos qos,
                                  bool retain)
+{
+    return publishBuffer(topic.c_str(), payload.data(), payload.size(), qos, retain);
+}
+
+esp_err_t
+EspMqttClient::publishString(const std::string &topic, const std::string &payload, MqttQos qos, bool retain)
+{
+    return publishBuffer(topic.c_str(), payload.data(), payload.size(), qos, retain);
+}
+
+esp_err_t EspMqttClient::publish(std::string_view topic,
+                                 const MqttPayloadSegment *segments,
+                                 size_t segmentCount,
+                                 MqttQos qos,
+                                 bool retain)
+{
+    if (segments == nullptr && segmentCount > 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // ESP-MQTT needs a null-terminated topic
+    std::string topicName(topic);
+    return publishSegments(topicName.c_str(), segments, segmentCount, qos, retain);
+}
+
+TopicHandle EspMqttClient::registerTopic(std::string_view topic)
+{
+    return topicTable_.intern(topic);
+}
+
+std::string_view EspMqttClient::topicName(TopicHandle topic) const
+{
+    const std::string *name = topicTable_.lookup(topic);
+    return name != nullptr ? std::string_view(*name) : std::string_view();
+}
+
+esp_err_t EspMqttClient::publish(TopicHandle topic,
+                                 const MqttPayloadSegment *segments,
+                                 size_t segmentCount,
+                                 MqttQos qos,
+                                 bool retain)
+{
+    const std::string *name = topicTable_.lookup(topic);
+    if (name == nullptr || (segments == nullptr && segmentCount > 0))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // The interned entry is already null-terminated, so no per-publish copy
+    return publishSegments(name->c_str(), segments, segmentCount, qos, retain);
+}
+
+esp_err_t EspMqttClient::publishSegments(const char *topic,
+                                         const MqttPayloadSegment *segments,
+                                         size_t segmentCount,
+                                         MqttQos qos,
+                                         bool retain)
+{
+    if (segmentCount == 1)
+    {
+        return publishBuffer(topic, segments[0].data, segments[0].size, qos, retain);
+    }
+
+    size_t payloadLength = 0;
+    for (size_t i = 0; i < segmentCount; i++)
+    {
+        payloadLength += segments[i].size;
+    }
+
+    std::vector<uint8_t> payload;
+    payload.reserve(payloadLength);
+    for (size_t i = 0; i < segmentCount; i++)
+    {
+        const uint8_t *data = static_cast<const uint8_t *>(segments[i].data);
+        payload.insert(payload.end(), data, data + segments[i].size);
+    }
+    return publishBuffer(topic, payload.data(), payload.size(), qos, retain);
+}
+
+esp_err_t EspMqttClient::publishBuffer(const char *topic,
+                                       const void *payload,
+                                       size_t payloadLength,
+                                       MqttQos qos,
+                                       bool retain)
 {
     if (!isConnected())
     {
@@ -252,57 +375,83 @@ esp_err_t EspMqttClient::publish(const std::string &topic,
     }
 
     // Check message budget
-    if (budget_ != nullptr && !budget_->consume(1))
+    std::string_view topicName(topic);
+    bool budgetOk = true;
+    if (budgetScheduler_)
+    {
+        budgetOk = budgetScheduler_->consume(topicName, payloadLength, qos);
+    }
+    else if (budget_ != nullptr)
+    {
+        budgetOk = budget_->consume(budget_->costOf(topicName.size(), payloadLength, qos));
+    }
+    if (!budgetOk)
     {
         LOPCORE_LOGW(TAG, "Publish rejected: budget exhausted");
-        std::lock_guard<std::mutex> lock(statisticsMutex_);
-        statistics_.publishErrors++;
+        metrics_.increment(MqttCounter::PUBLISH_ERRORS);
         return ESP_ERR_NO_MEM; // Budget exhausted
     }
 
-    int msgId = esp_mqtt_client_publish(mqttHandle_, topic.c_str(),
-                                        reinterpret_cast<const char *>(payload.data()), payload.size(),
-                                        qosToInt(qos), retain ? 1 : 0);
+    int msgId = esp_mqtt_client_publish(mqttHandle_, topic, static_cast<const char *>(payload),
+                                        static_cast<int>(payloadLength), qosToInt(qos), retain ? 1 : 0);
 
     if (msgId < 0)
     {
-        LOPCORE_LOGE(TAG, "Failed to publish to topic '%s'", topic.c_str());
+        LOPCORE_LOGE(TAG, "Failed to publish to topic '%s'", topic);
 
         // Restore budget on failure
-        if (budget_ != nullptr)
+        if (budgetScheduler_)
         {
-            budget_->restore(1);
+            budgetScheduler_->restore(topicName, payloadLength, qos);
+        }
+        else if (budget_ != nullptr)
+        {
+            budget_->restore(budget_->costOf(topicName.size(), payloadLength, qos));
         }
 
-        std::lock_guard<std::mutex> lock(statisticsMutex_);
-        statistics_.publishErrors++;
+        metrics_.increment(MqttCounter::PUBLISH_ERRORS);
         return ESP_FAIL;
     }
 
-    // Update statistics
+    metrics_.increment(MqttCounter::MESSAGES_PUBLISHED);
+    if (qos != MqttQos::AT_MOST_ONCE)
     {
-        std::lock_guard<std::mutex> lock(statisticsMutex_);
-        statistics_.messagesPublished++;
+        metrics_.publishSent(static_cast<uint16_t>(msgId), esp_timer_get_time());
     }
 
-    LOPCORE_LOGD(TAG, "Published to '%s': %zu bytes, QoS%d, msgId=%d", topic.c_str(), payload.size(),
-                 qosToInt(qos), msgId);
+    LOPCORE_LOGD(TAG, "Published to '%s': %zu bytes, QoS%d, msgId=%d", topic, payloadLength, qosToInt(qos),
+                 msgId);
 
     return ESP_OK;
 }
 
-esp_err_t
-EspMqttClient::publishString(const std::string &topic, const std::string &payload, MqttQos qos, bool retain)
-{
-    std::vector<uint8_t> data(payload.begin(), payload.end());
-    return publish(topic, data, qos, retain);
-}
-
 // =============================================================================
 // Subscription Management
 // =============================================================================
 
 esp_err_t EspMqttClient::subscribe(const std::string &topic, MessageCallback callback, MqttQos qos)
+{
+    MqttHandler handler;
+    handler.callback = std::move(callback);
+    return addSubscription(topic, std::move(handler), qos);
+}
+
+esp_err_t EspMqttClient::subscribeView(const std::string &topic, MessageViewCallback callback, MqttQos qos)
+{
+    MqttHandler handler;
+    handler.viewCallback = std::move(callback);
+    return addSubscription(topic, std::move(handler), qos);
+}
+
+esp_err_t
+EspMqttClient::subscribeStream(const std::string &topic, MessageFragmentCallback callback, MqttQos qos)
+{
+    MqttHandler handler;
+    handler.fragmentCallback = std::move(callback);
+    return addSubscription(topic, std::move(handler), qos);
+}
+
+esp_err_t EspMqttClient::addSubscription(const std::string &topic, MqttHandler handler, MqttQos qos)
 {
     if (!isConnected())
     {
@@ -313,7 +462,12 @@ esp_err_t EspMqttClient::subscribe(const std::string &topic, MessageCallback cal
     // Store subscription for resubscription on reconnect
     {
         std::lock_guard<std::mutex> lock(subscriptionsMutex_);
-        subscriptions_[topic] = callback;
+        SubscriptionHandler subscription{std::make_shared<MqttHandler>(std::move(handler)), qos};
+        if (subscriptions_.insert(topic, std::move(subscription)) != ESP_OK)
+        {
+            LOPCORE_LOGE(TAG, "Invalid topic filter '%s'", topic.c_str());
+            return ESP_ERR_INVALID_ARG;
+        }
     }
 
     int msgId = esp_mqtt_client_subscribe(mqttHandle_, topic.c_str(), qosToInt(qos));
@@ -354,6 +508,63 @@ esp_err_t EspMqttClient::unsubscribe(const std::string &topic)
     return ESP_OK;
 }
 
+esp_err_t EspMqttClient::subscribeMany(const std::vector<MqttSubscribeRequest> &requests)
+{
+    if (!isConnected())
+    {
+        LOPCORE_LOGW(TAG, "Cannot subscribe: not connected");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    for (const auto &request : requests)
+    {
+        if (!TopicTrie<SubscriptionHandler>::isValidFilter(request.topic))
+        {
+            LOPCORE_LOGE(TAG, "Invalid topic filter '%s'", request.topic.c_str());
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    std::vector<esp_mqtt_topic_t> topics;
+    topics.reserve(requests.size());
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+        for (const auto &request : requests)
+        {
+            subscriptions_.insert(request.topic,
+                                  SubscriptionHandler{std::make_shared<MqttHandler>(MqttHandler{
+                                                          request.callback, request.viewCallback, nullptr}),
+                                                      request.qos});
+            topics.push_back(esp_mqtt_topic_t{request.topic.c_str(), qosToInt(request.qos)});
+        }
+    }
+
+    size_t sent = sendSubscribeBatches(topics);
+    if (sent < topics.size())
+    {
+        LOPCORE_LOGE(TAG, "Failed to subscribe to '%s'", topics[sent].filter);
+        return ESP_FAIL;
+    }
+
+    LOPCORE_LOGI(TAG, "Subscribed to %zu topics", sent);
+
+    return ESP_OK;
+}
+
+esp_err_t EspMqttClient::unsubscribeMany(const std::vector<std::string> &topics)
+{
+    esp_err_t result = ESP_OK;
+    for (const auto &topic : topics)
+    {
+        esp_err_t err = unsubscribe(topic);
+        if (err != ESP_OK && result == ESP_OK)
+        {
+            result = err;
+        }
+    }
+    return result;
+}
+
 // =============================================================================
 // Callbacks
 // =============================================================================
@@ -385,14 +596,49 @@ esp_err_t EspMqttClient::setWillMessage(const std::string &topic,
 
 MqttStatistics EspMqttClient::getStatistics() const
 {
-    std::lock_guard<std::mutex> lock(statisticsMutex_);
-    return statistics_;
+    MqttStatistics stats;
+    {
+        std::lock_guard<std::mutex> lock(statisticsMutex_);
+        stats = statistics_;
+    }
+    MqttMetricsSnapshot metrics = metrics_.snapshot();
+    stats.messagesPublished = metrics.messagesPublished;
+    stats.messagesReceived = metrics.messagesReceived;
+    stats.publishErrors = metrics.publishErrors;
+    stats.messagesDropped = metrics.messagesDropped;
+    stats.reconnectCount = metrics.reconnectCount;
+    stats.averagePublishLatency = std::chrono::milliseconds(metrics.publishAckLatency.meanUs() / 1000);
+    stats.budgetRemaining = budget_ ? budget_->getRemaining() : -1;
+    return stats;
+}
+
+MqttMetricsSnapshot EspMqttClient::getMetrics() const
+{
+    return metrics_.snapshot();
+}
+
+void EspMqttClient::registerMetrics(metrics::MetricsRegistry &registry, std::string_view prefix)
+{
+    metrics_.registerMetrics(registry, prefix);
+    std::string name(prefix);
+    name.append(".budget");
+    if (budget_)
+    {
+        budget_->registerMetrics(registry, name);
+    }
+    if (budgetScheduler_)
+    {
+        budgetScheduler_->registerMetrics(registry, name);
+    }
 }
 
 void EspMqttClient::resetStatistics()
 {
-    std::lock_guard<std::mutex> lock(statisticsMutex_);
-    statistics_.reset();
+    {
+        std::lock_guard<std::mutex> lock(statisticsMutex_);
+        statistics_.reset();
+    }
+    metrics_.reset();
     LOPCORE_LOGI(TAG, "Statistics reset");
 }
 
@@ -431,8 +677,13 @@ void EspMqttClient::eventHandler(void *handlerArgs, esp_event_base_t base, int32
             client->handleUnsubscribed(event);
             break;
 
+        case MQTT_EVENT_PUBLISHED:
+            // PUBACK (QoS 1) or PUBCOMP (QoS 2)
+            client->metrics_.publishAcked(static_cast<uint16_t>(event->msg_id), esp_timer_get_time());
+            break;
+
         default:
-            // Other events (PUBLISHED, BEFORE_CONNECT, etc.) are logged but not handled
+            // Other events (BEFORE_CONNECT, etc.) are logged but not handled
             LOPCORE_LOGD(TAG, "MQTT event: %d", eventId);
             break;
     }
@@ -478,8 +729,8 @@ void EspMqttClient::handleDisconnected()
         {
             std::lock_guard<std::mutex> lock(statisticsMutex_);
             statistics_.lastDisconnected = std::chrono::system_clock::now();
-            statistics_.reconnectCount++;
         }
+        metrics_.increment(MqttCounter::RECONNECTS);
     }
 
     // Notify application
@@ -491,38 +742,195 @@ void EspMqttClient::handleDisconnected()
 
 void EspMqttClient::handleData(esp_mqtt_event_handle_t event)
 {
-    // Extract topic and payload
-    std::string topic(event->topic, event->topic_len);
-    std::vector<uint8_t> payload(event->data, event->data + event->data_len);
+    // A message larger than the receive buffer arrives as several events
+    if (event->current_data_offset > 0 || event->data_len < event->total_data_len)
+    {
+        handleFragment(event);
+        return;
+    }
 
-    LOPCORE_LOGD(TAG, "Received message on '%s': %d bytes", topic.c_str(), event->data_len);
+    // View topic and payload in place in ESP-MQTT's receive buffer
+    MqttMessageView view;
+    view.topic = std::string_view(event->topic, event->topic_len);
+    view.payload = reinterpret_cast<const uint8_t *>(event->data);
+    view.payloadLength = static_cast<size_t>(event->data_len);
+    view.qos = intToQos(event->qos);
+    view.retained = event->retain;
+    view.messageId = event->msg_id;
 
-    // Update statistics
+    LOPCORE_LOGD(TAG, "Received message on '%.*s': %d bytes", static_cast<int>(view.topic.size()),
+                 view.topic.data(), event->data_len);
+
+    metrics_.increment(MqttCounter::MESSAGES_RECEIVED);
+
+    // Collect the matching handlers, then call them without the lock so a
+    // callback can subscribe or unsubscribe and never blocks those calls
+    matchedHandlers_.clear();
     {
-        std::lock_guard<std::mutex> lock(statisticsMutex_);
-        statistics_.messagesReceived++;
+        std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+        subscriptions_.match(view.topic, [this](SubscriptionHandler &handler) {
+            matchedHandlers_.push_back(handler.handler);
+        });
+    }
+    if (matchedHandlers_.empty())
+    {
+        return;
     }
 
-    // Create message object
-    MqttMessage msg;
-    msg.topic = topic;
-    msg.payload = payload;
-    msg.qos = intToQos(event->qos);
-    msg.retained = event->retain;
-    msg.messageId = event->msg_id;
+    int64_t deliveryStartUs = esp_timer_get_time();
+    if (dispatcher_)
+    {
+        dispatcher_->dispatch(view, matchedHandlers_);
+    }
+    else
+    {
+        // Owning copy, made at most once and only if an owning callback matches
+        std::optional<MqttMessage> msg;
+        for (const MqttHandlerPtr &handler : matchedHandlers_)
+        {
+            handler->invoke(view, msg);
+        }
+    }
+    metrics_.callbackDuration().record(static_cast<uint32_t>(esp_timer_get_time() - deliveryStartUs));
+}
 
-    // Find matching subscriptions and invoke callbacks
-    std::lock_guard<std::mutex> lock(subscriptionsMutex_);
-    for (const auto &[pattern, callback] : subscriptions_)
+void EspMqttClient::handleFragment(esp_mqtt_event_handle_t event)
+{
+    size_t offset = static_cast<size_t>(event->current_data_offset);
+    size_t length = static_cast<size_t>(event->data_len);
+
+    if (offset == 0)
     {
-        if (topicMatches(pattern, topic))
+        if (fragments_.active)
+        {
+            abandonFragments(); // The previous message never completed
+        }
+
+        fragments_.topic.assign(event->topic, event->topic_len);
+        fragments_.totalLength = static_cast<size_t>(event->total_data_len);
+        fragments_.received = 0;
+        fragments_.qos = intToQos(event->qos);
+        fragments_.retained = event->retain;
+        fragments_.messageId = event->msg_id;
+
+        metrics_.increment(MqttCounter::MESSAGES_RECEIVED);
+
+        fragments_.streamHandlers.clear();
+        fragments_.handlers.clear();
+        {
+            std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+            subscriptions_.match(fragments_.topic, [this](SubscriptionHandler &handler) {
+                if (handler.handler->fragmentCallback)
+                {
+                    fragments_.streamHandlers.push_back(handler.handler);
+                }
+                else
+                {
+                    fragments_.handlers.push_back(handler.handler);
+                }
+            });
+        }
+
+        if (!fragments_.handlers.empty())
         {
-            if (callback)
+            if (inboundPool_ && fragments_.totalLength <= inboundPool_->blockSize())
+            {
+                fragments_.block = inboundPool_->acquire();
+            }
+            if (fragments_.block == nullptr)
             {
-                callback(msg);
+                LOPCORE_LOGW(TAG, "No reassembly buffer for %zu-byte message on '%s'; only stream callbacks "
+                             "receive it", fragments_.totalLength, fragments_.topic.c_str());
+                fragments_.handlers.clear();
+                metrics_.increment(MqttCounter::MESSAGES_DROPPED);
             }
         }
+
+        fragments_.active = !fragments_.streamHandlers.empty() || fragments_.block != nullptr;
+        if (!fragments_.active)
+        {
+            return;
+        }
     }
+    else if (!fragments_.active || offset != fragments_.received ||
+             offset + length > fragments_.totalLength)
+    {
+        if (fragments_.active)
+        {
+            abandonFragments();
+        }
+        return; // The start of this message was missed or not wanted
+    }
+
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(event->data);
+    MqttMessageFragment fragment;
+    fragment.topic = fragments_.topic;
+    fragment.data = data;
+    fragment.length = length;
+    fragment.offset = offset;
+    fragment.totalLength = fragments_.totalLength;
+    fragment.qos = fragments_.qos;
+    fragment.retained = fragments_.retained;
+    fragment.messageId = fragments_.messageId;
+    for (const MqttHandlerPtr &handler : fragments_.streamHandlers)
+    {
+        handler->fragmentCallback(fragment);
+    }
+
+    if (fragments_.block != nullptr)
+    {
+        std::memcpy(fragments_.block + offset, data, length);
+    }
+    fragments_.received = offset + length;
+    if (!fragment.isLast())
+    {
+        return;
+    }
+
+    fragments_.active = false;
+    if (fragments_.block == nullptr)
+    {
+        return;
+    }
+
+    MqttMessageView view;
+    view.topic = fragments_.topic;
+    view.payload = fragments_.block;
+    view.payloadLength = fragments_.totalLength;
+    view.qos = fragments_.qos;
+    view.retained = fragments_.retained;
+    view.messageId = fragments_.messageId;
+
+    int64_t deliveryStartUs = esp_timer_get_time();
+    if (dispatcher_)
+    {
+        dispatcher_->dispatch(view, fragments_.handlers); // Copies before returning
+    }
+    else
+    {
+        std::optional<MqttMessage> msg;
+        for (const MqttHandlerPtr &handler : fragments_.handlers)
+        {
+            handler->invoke(view, msg);
+        }
+    }
+    metrics_.callbackDuration().record(static_cast<uint32_t>(esp_timer_get_time() - deliveryStartUs));
+
+    inboundPool_->release(fragments_.block);
+    fragments_.block = nullptr;
+}
+
+void EspMqttClient::abandonFragments()
+{
+    LOPCORE_LOGW(TAG, "Incomplete message on '%s' dropped after %zu of %zu bytes", fragments_.topic.c_str(),
+                 fragments_.received, fragments_.totalLength);
+    if (inboundPool_)
+    {
+        inboundPool_->release(fragments_.block);
+    }
+    fragments_.block = nullptr;
+    fragments_.active = false;
+    metrics_.increment(MqttCounter::MESSAGES_DROPPED);
 }
 
 void EspMqttClient::handleError(esp_mqtt_event_handle_t event)
@@ -577,78 +985,41 @@ void EspMqttClient::resubscribeAll()
 
     LOPCORE_LOGI(TAG, "Resubscribing to %zu topics", subscriptions_.size());
 
-    for (const auto &[topic, callback] : subscriptions_)
+    // Filter strings live in the trie, which is not modified while the lock is held
+    std::vector<esp_mqtt_topic_t> topics;
+    topics.reserve(subscriptions_.size());
+    subscriptions_.forEach([&topics](const std::string &topic, const SubscriptionHandler &handler) {
+        topics.push_back(esp_mqtt_topic_t{topic.c_str(), qosToInt(handler.qos)});
+    });
+
+    size_t sent = sendSubscribeBatches(topics);
+    if (sent < topics.size())
     {
-        int msgId = esp_mqtt_client_subscribe(mqttHandle_, topic.c_str(), qosToInt(MqttQos::AT_LEAST_ONCE));
-        if (msgId < 0)
-        {
-            LOPCORE_LOGE(TAG, "Failed to resubscribe to '%s'", topic.c_str());
-        }
-        else
-        {
-            LOPCORE_LOGD(TAG, "Resubscribed to '%s'", topic.c_str());
-        }
+        LOPCORE_LOGE(TAG, "Failed to resubscribe to '%s' and %zu more", topics[sent].filter,
+                     topics.size() - sent - 1);
     }
 }
 
-bool EspMqttClient::topicMatches(const std::string &pattern, const std::string &topic) const
+size_t EspMqttClient::sendSubscribeBatches(const std::vector<esp_mqtt_topic_t> &topics)
 {
-    // Implement MQTT wildcard matching
-    // '+' matches exactly one level (but not empty)
-    // '#' matches zero or more levels (must be at end)
-
-    size_t patternPos = 0;
-    size_t topicPos = 0;
-
-    while (patternPos < pattern.length() && topicPos < topic.length())
+    size_t first = 0;
+    while (first < topics.size())
     {
-        if (pattern[patternPos] == '#')
-        {
-            // '#' must be at the end and preceded by '/' or be the only character
-            if (patternPos == pattern.length() - 1 && (patternPos == 0 || pattern[patternPos - 1] == '/'))
-            {
-                return true; // '#' matches everything remaining
-            }
-            return false; // Invalid '#' placement
-        }
-        else if (pattern[patternPos] == '+')
-        {
-            // '+' matches a single level
-            // Must be surrounded by '/' or at start/end
-            if ((patternPos > 0 && pattern[patternPos - 1] != '/') ||
-                (patternPos < pattern.length() - 1 && pattern[patternPos + 1] != '/'))
-            {
-                return false; // Invalid '+' placement
-            }
+        const esp_mqtt_topic_t *batch = &topics[first];
+        size_t count = topicFiltersPerPacket(topics.size() - first, config_.networkBufferSize,
+                                             config_.maxTopicsPerSubscribe, true,
+                                             [batch](size_t i) { return strlen(batch[i].filter); });
 
-            // Skip to the next '/' in topic
-            while (topicPos < topic.length() && topic[topicPos] != '/')
-            {
-                topicPos++;
-            }
-            patternPos++;
-        }
-        else if (pattern[patternPos] == topic[topicPos])
-        {
-            // Characters match
-            patternPos++;
-            topicPos++;
-        }
-        else
+        int msgId = esp_mqtt_client_subscribe_multiple(mqttHandle_, batch, static_cast<int>(count));
+        if (msgId < 0)
         {
-            // Mismatch
-            return false;
+            break;
         }
-    }
 
-    // Both must be fully consumed (except for trailing '#')
-    if (patternPos < pattern.length())
-    {
-        // Check if remaining pattern is just "/#"
-        return (pattern.substr(patternPos) == "/#" || pattern[patternPos] == '#');
+        LOPCORE_LOGD(TAG, "Subscribed to %zu topics, msgId=%d", count, msgId);
+        first += count;
     }
-
-    return topicPos == topic.length();
+    return first;
 }
 
 MqttError EspMqttClient::convertEspError(esp_err_t espError) const
@@ -12,6 +12,8 @@
 #include "lopcore/mqtt/mqtt_budget.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <string>
 
 #include "lopcore/logging/logger.hpp"
 
@@ -22,8 +24,30 @@ namespace lopcore
 namespace mqtt
 {
 
-MqttBudget::MqttBudget(const BudgetConfig &config)
-    : config_(config), budget_(config.defaultBudget), reviveTimer_(nullptr)
+namespace
+{
+
+int64_t refillIntervalUs(const BudgetConfig &config)
+{
+    int64_t interval;
+    if (config.reviveRate > 0.0f)
+    {
+        interval = static_cast<int64_t>(std::llround(1000000.0 / config.reviveRate));
+    }
+    else
+    {
+        int64_t periodUs = static_cast<int64_t>(config.revivePeriod.count()) * 1000000;
+        interval = periodUs / std::max<int64_t>(config.reviveCount, 1);
+    }
+    return std::max<int64_t>(interval, 1);
+}
+
+} // namespace
+
+MqttBudget::MqttBudget(const BudgetConfig &config, TimeSource timeSource)
+    : config_(config), timeSource_(timeSource), intervalUs_(refillIntervalUs(config)),
+      capacityUs_(static_cast<int64_t>(config.maxBudget) * intervalUs_),
+      emptyAtUs_(timeSource() - static_cast<int64_t>(config.defaultBudget) * intervalUs_)
 {
     if (!config_.enabled)
     {
@@ -31,13 +55,8 @@ MqttBudget::MqttBudget(const BudgetConfig &config)
         return;
     }
 
-    LOPCORE_LOGI(TAG, "Budget initialized: default=%d, max=%d, revive=%d per %llds", config_.defaultBudget,
-                 config_.maxBudget, config_.reviveCount, config_.revivePeriod.count());
-}
-
-MqttBudget::~MqttBudget()
-{
-    stop();
+    LOPCORE_LOGI(TAG, "Budget initialized: default=%d, max=%d, refill every %lld ms", config_.defaultBudget,
+                 config_.maxBudget, static_cast<long long>(intervalUs_ / 1000));
 }
 
 bool MqttBudget::isAvailable() const
@@ -47,145 +66,127 @@ bool MqttBudget::isAvailable() const
         return true; // Always available if disabled
     }
 
-    return budget_.load(std::memory_order_relaxed) > 0;
+    return getRemaining() > 0;
 }
 
-bool MqttBudget::consume(uint8_t count)
+bool MqttBudget::consume(uint32_t count)
 {
     if (!config_.enabled)
     {
         return true; // Always succeed if disabled
     }
 
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    int32_t currentBudget = budget_.load(std::memory_order_relaxed);
-
-    if (currentBudget < count)
+    const int64_t cost = static_cast<int64_t>(count) * intervalUs_;
+    int64_t emptyAt = emptyAtUs_.load(std::memory_order_relaxed);
+    while (true)
     {
-        LOPCORE_LOGW(TAG, "Budget exhausted: requested=%d, available=%d", count, currentBudget);
-        return false;
+        int64_t now = timeSource_();
+        int64_t start = effectiveEmptyAt(emptyAt, now);
+        if (now - start < cost)
+        {
+            LOPCORE_LOGW(TAG, "Budget exhausted: requested=%lu, available=%lld",
+                         static_cast<unsigned long>(count), static_cast<long long>((now - start) / intervalUs_));
+            return false;
+        }
+
+        // Moving the start forward by the cost keeps any partly refilled message
+        if (emptyAtUs_.compare_exchange_weak(emptyAt, start + cost, std::memory_order_relaxed))
+        {
+            return true;
+        }
     }
-
-    int32_t newBudget = currentBudget - count;
-    budget_.store(newBudget, std::memory_order_relaxed);
-
-    LOPCORE_LOGD(TAG, "Budget consumed: %d -> %d", currentBudget, newBudget);
-
-    return true;
 }
 
-void MqttBudget::restore(uint8_t count)
+void MqttBudget::restore(uint32_t count)
 {
     if (!config_.enabled)
     {
         return;
     }
 
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    int32_t currentBudget = budget_.load(std::memory_order_relaxed);
-    int32_t newBudget = std::min(currentBudget + count, config_.maxBudget);
-
-    budget_.store(newBudget, std::memory_order_relaxed);
-
-    LOPCORE_LOGD(TAG, "Budget restored: %d -> %d", currentBudget, newBudget);
-}
-
-int32_t MqttBudget::getRemaining() const
-{
-    return budget_.load(std::memory_order_relaxed);
-}
-
-void MqttBudget::reset()
-{
-    if (!config_.enabled)
+    const int64_t credit = static_cast<int64_t>(count) * intervalUs_;
+    int64_t emptyAt = emptyAtUs_.load(std::memory_order_relaxed);
+    while (true)
     {
-        return;
+        int64_t now = timeSource_();
+        int64_t start = std::max(effectiveEmptyAt(emptyAt, now) - credit, now - capacityUs_);
+        if (emptyAtUs_.compare_exchange_weak(emptyAt, start, std::memory_order_relaxed))
+        {
+            return;
+        }
     }
-
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    budget_.store(config_.defaultBudget, std::memory_order_relaxed);
-
-    LOPCORE_LOGI(TAG, "Budget reset to %d", config_.defaultBudget);
 }
 
-esp_err_t MqttBudget::start()
+uint32_t MqttBudget::costOf(size_t topicLength, size_t payloadLength, MqttQos qos) const
 {
-    if (!config_.enabled)
+    if (config_.unit == BudgetUnit::MESSAGES)
     {
-        return ESP_OK;
+        return 1;
     }
 
-    if (reviveTimer_ != nullptr)
+    size_t bytes = publishPacketSize(topicLength, payloadLength, qos);
+    if (config_.meteringBytes > 0)
     {
-        LOPCORE_LOGW(TAG, "Timer already started");
-        return ESP_ERR_INVALID_STATE;
+        bytes = (bytes + config_.meteringBytes - 1) / config_.meteringBytes * config_.meteringBytes;
     }
+    return static_cast<uint32_t>(std::min<size_t>(bytes, UINT32_MAX));
+}
 
-    // Create periodic timer
-    reviveTimer_ = xTimerCreate("mqtt_budget", pdMS_TO_TICKS(config_.revivePeriod.count() * 1000), // Convert
-                                                                                                   // seconds
-                                                                                                   // to ms
-                                pdTRUE, // Auto-reload
-                                this,   // Timer ID (passed to callback)
-                                reviveTimerCallback);
+size_t MqttBudget::publishPacketSize(size_t topicLength, size_t payloadLength, MqttQos qos)
+{
+    // Topic length prefix, topic, packet ID (QoS 1/2 only), payload
+    size_t remaining = 2 + topicLength + (qos == MqttQos::AT_MOST_ONCE ? 0 : 2) + payloadLength;
 
-    if (reviveTimer_ == nullptr)
-    {
-        LOPCORE_LOGE(TAG, "Failed to create revive timer");
-        return ESP_ERR_NO_MEM;
-    }
+    // Fixed header: type byte plus a 1-4 byte variable-length remaining length
+    size_t lengthBytes = remaining < 128 ? 1 : remaining < 16384 ? 2 : remaining < 2097152 ? 3 : 4;
+    return 1 + lengthBytes + remaining;
+}
 
-    if (xTimerStart(reviveTimer_, 0) != pdPASS)
+int32_t MqttBudget::getRemaining() const
+{
+    if (!config_.enabled)
     {
-        LOPCORE_LOGE(TAG, "Failed to start revive timer");
-        xTimerDelete(reviveTimer_, 0);
-        reviveTimer_ = nullptr;
-        return ESP_FAIL;
+        return config_.defaultBudget;
     }
 
-    LOPCORE_LOGI(TAG, "Budget revival started: +%d every %llds", config_.reviveCount,
-                 config_.revivePeriod.count());
-
-    return ESP_OK;
+    int64_t now = timeSource_();
+    int64_t start = effectiveEmptyAt(emptyAtUs_.load(std::memory_order_relaxed), now);
+    return static_cast<int32_t>(std::max<int64_t>(now - start, 0) / intervalUs_);
 }
 
-esp_err_t MqttBudget::stop()
+void MqttBudget::registerMetrics(metrics::MetricsRegistry &registry, std::string_view prefix)
 {
-    if (reviveTimer_ == nullptr)
-    {
-        return ESP_OK;
-    }
+    std::string name(prefix);
+    remaining_ = registry.sampledGauge(name.append(".remaining"), [this] { return getRemaining(); });
+}
 
-    if (xTimerStop(reviveTimer_, pdMS_TO_TICKS(1000)) != pdPASS)
+void MqttBudget::reset()
+{
+    if (!config_.enabled)
     {
-        LOPCORE_LOGW(TAG, "Failed to stop revive timer");
+        return;
     }
 
-    xTimerDelete(reviveTimer_, pdMS_TO_TICKS(1000));
-    reviveTimer_ = nullptr;
+    emptyAtUs_.store(timeSource_() - static_cast<int64_t>(config_.defaultBudget) * intervalUs_,
+                     std::memory_order_relaxed);
 
-    LOPCORE_LOGI(TAG, "Budget revival stopped");
+    LOPCORE_LOGI(TAG, "Budget reset to %d", config_.defaultBudget);
+}
 
+esp_err_t MqttBudget::start()
+{
     return ESP_OK;
 }
 
-void MqttBudget::reviveTimerCallback(TimerHandle_t timerHandle)
+esp_err_t MqttBudget::stop()
 {
-    // Get MqttBudget instance from timer ID
-    MqttBudget *budget = static_cast<MqttBudget *>(pvTimerGetTimerID(timerHandle));
-
-    if (budget != nullptr)
-    {
-        budget->reviveBudget();
-    }
+    return ESP_OK;
 }
 
-void MqttBudget::reviveBudget()
+int64_t MqttBudget::effectiveEmptyAt(int64_t emptyAtUs, int64_t nowUs) const
 {
-    restore(config_.reviveCount);
+    // Refill beyond maxBudget is discarded
+    return std::max(emptyAtUs, nowUs - capacityUs_);
 }
 
 } // namespace mqtt
@@ -0,0 +1,302 @@
+/**
+ * @file mqtt_budget_scheduler.cpp
+ * @brief Per-topic budget classes with weighted scheduling of deferred publishes
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/mqtt/mqtt_budget_scheduler.hpp"
+
+#include <algorithm>
+
+#include "lopcore/logging/logger.hpp"
+
+static const char *TAG = "mqtt_budget_sched";
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+namespace
+{
+
+// Divisible by every weight up to 16, so common weights advance exactly
+constexpr uint64_t STRIDE = 720720;
+
+} // namespace
+
+MqttBudgetScheduler::MqttBudgetScheduler(const std::vector<BudgetClassConfig> &classes,
+                                         MqttBudget *globalBudget,
+                                         MqttBudget::TimeSource timeSource)
+    : globalBudget_(globalBudget), deferredTotal_(0), virtualTime_(0)
+{
+    classes_.resize(classes.size());
+    for (size_t i = 0; i < classes.size(); i++)
+    {
+        BudgetClass &budgetClass = classes_[i];
+        budgetClass.config = classes[i];
+        budgetClass.budget = std::make_unique<MqttBudget>(classes[i].budget, timeSource);
+        budgetClass.slots.resize(classes[i].queueDepth);
+
+        for (const std::string &prefix : classes[i].topicPrefixes)
+        {
+            prefixes_.emplace_back(prefix, i);
+        }
+    }
+
+    // Longest prefix first, so the first match is the most specific
+    std::stable_sort(prefixes_.begin(), prefixes_.end(), [](const auto &a, const auto &b) {
+        return a.first.size() > b.first.size();
+    });
+
+    LOPCORE_LOGI(TAG, "%zu budget classes, %zu topic prefixes", classes_.size(), prefixes_.size());
+}
+
+size_t MqttBudgetScheduler::classify(std::string_view topic) const
+{
+    for (const auto &prefix : prefixes_)
+    {
+        if (topic.compare(0, prefix.first.size(), prefix.first) == 0)
+        {
+            return prefix.second;
+        }
+    }
+    return classes_.size();
+}
+
+bool MqttBudgetScheduler::consume(std::string_view topic, size_t payloadLength, MqttQos qos)
+{
+    bool globalExhausted = false;
+    return consumeClass(classify(topic), topic.size(), payloadLength, qos, &globalExhausted);
+}
+
+void MqttBudgetScheduler::restore(std::string_view topic, size_t payloadLength, MqttQos qos)
+{
+    restoreClass(classify(topic), topic.size(), payloadLength, qos);
+}
+
+esp_err_t MqttBudgetScheduler::admit(std::string_view topic,
+                                     const MqttPayloadSegment *segments,
+                                     size_t segmentCount,
+                                     MqttQos qos,
+                                     bool retain,
+                                     bool *deferred)
+{
+    *deferred = false;
+
+    size_t payloadLength = 0;
+    for (size_t i = 0; i < segmentCount; i++)
+    {
+        payloadLength += segments[i].size;
+    }
+
+    size_t index = classify(topic);
+    bool globalExhausted = false;
+    if (!mustWait(index) && consumeClass(index, topic.size(), payloadLength, qos, &globalExhausted))
+    {
+        return ESP_OK;
+    }
+
+    if (index == classes_.size() || classes_[index].slots.empty())
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = defer(classes_[index], topic, segments, segmentCount, qos, retain);
+    if (err != ESP_OK)
+    {
+        LOPCORE_LOGW(TAG, "Budget class '%s' queue full", classes_[index].config.name.c_str());
+        return err;
+    }
+
+    *deferred = true;
+    return ESP_OK;
+}
+
+size_t MqttBudgetScheduler::drain(const SendFunction &send)
+{
+    size_t sent = 0;
+    uint32_t blocked = 0; // Classes out of their own budget
+
+    while (deferredTotal_ > 0)
+    {
+        // Stride scheduling: the waiting class furthest behind goes next, heavier on a tie
+        size_t next = classes_.size();
+        for (size_t i = 0; i < classes_.size(); i++)
+        {
+            const BudgetClass &budgetClass = classes_[i];
+            if (budgetClass.count == 0 || (blocked & (1u << i)) != 0)
+            {
+                continue;
+            }
+            if (next == classes_.size() || budgetClass.pass < classes_[next].pass ||
+                (budgetClass.pass == classes_[next].pass &&
+                 budgetClass.config.weight > classes_[next].config.weight))
+            {
+                next = i;
+            }
+        }
+        if (next == classes_.size())
+        {
+            break;
+        }
+
+        BudgetClass &budgetClass = classes_[next];
+        const MqttMessage &message =
+            budgetClass.slots[(budgetClass.head + budgetClass.slots.size() - budgetClass.count) %
+                              budgetClass.slots.size()];
+
+        bool globalExhausted = false;
+        if (!consumeClass(next, message.topic.size(), message.payload.size(), message.qos, &globalExhausted))
+        {
+            if (globalExhausted)
+            {
+                break; // No class can send until the global budget refills
+            }
+            blocked |= 1u << next;
+            continue;
+        }
+
+        MqttMessageView view;
+        view.topic = message.topic;
+        view.payload = message.payload.data();
+        view.payloadLength = message.payload.size();
+        view.qos = message.qos;
+        view.retained = message.retained;
+
+        if (send(view) != ESP_OK)
+        {
+            restoreClass(next, message.topic.size(), message.payload.size(), message.qos);
+            break;
+        }
+
+        budgetClass.count--;
+        deferredTotal_--;
+        sent++;
+
+        virtualTime_ = budgetClass.pass;
+        budgetClass.pass += STRIDE / budgetClass.config.weight;
+    }
+
+    return sent;
+}
+
+void MqttBudgetScheduler::registerMetrics(metrics::MetricsRegistry &registry, std::string_view prefix)
+{
+    std::string name(prefix);
+    for (BudgetClass &budgetClass : classes_)
+    {
+        name.resize(prefix.size());
+        budgetClass.budget->registerMetrics(registry, name.append(".").append(budgetClass.config.name));
+    }
+}
+
+void MqttBudgetScheduler::clear()
+{
+    for (BudgetClass &budgetClass : classes_)
+    {
+        budgetClass.head = 0;
+        budgetClass.count = 0;
+    }
+    deferredTotal_ = 0;
+}
+
+bool MqttBudgetScheduler::consumeClass(size_t index,
+                                       size_t topicLength,
+                                       size_t payloadLength,
+                                       MqttQos qos,
+                                       bool *globalExhausted)
+{
+    MqttBudget *classBudget = index < classes_.size() ? classes_[index].budget.get() : nullptr;
+    uint32_t classCost = classBudget ? classBudget->costOf(topicLength, payloadLength, qos) : 0;
+    if (classBudget && !classBudget->consume(classCost))
+    {
+        return false;
+    }
+
+    if (globalBudget_ != nullptr &&
+        !globalBudget_->consume(globalBudget_->costOf(topicLength, payloadLength, qos)))
+    {
+        if (classBudget)
+        {
+            classBudget->restore(classCost);
+        }
+        *globalExhausted = true;
+        return false;
+    }
+
+    return true;
+}
+
+void MqttBudgetScheduler::restoreClass(size_t index, size_t topicLength, size_t payloadLength, MqttQos qos)
+{
+    if (index < classes_.size())
+    {
+        MqttBudget &classBudget = *classes_[index].budget;
+        classBudget.restore(classBudget.costOf(topicLength, payloadLength, qos));
+    }
+    if (globalBudget_ != nullptr)
+    {
+        globalBudget_->restore(globalBudget_->costOf(topicLength, payloadLength, qos));
+    }
+}
+
+esp_err_t MqttBudgetScheduler::defer(BudgetClass &budgetClass,
+                                     std::string_view topic,
+                                     const MqttPayloadSegment *segments,
+                                     size_t segmentCount,
+                                     MqttQos qos,
+                                     bool retain)
+{
+    if (budgetClass.count == budgetClass.slots.size())
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // A class that was idle starts level with the others instead of banking turns
+    if (budgetClass.count == 0)
+    {
+        budgetClass.pass = std::max(budgetClass.pass, virtualTime_);
+    }
+
+    // assign() keeps the slot's capacity from earlier publishes
+    MqttMessage &message = budgetClass.slots[budgetClass.head];
+    message.topic.assign(topic.data(), topic.size());
+    message.payload.clear();
+    for (size_t i = 0; i < segmentCount; i++)
+    {
+        const uint8_t *data = static_cast<const uint8_t *>(segments[i].data);
+        message.payload.insert(message.payload.end(), data, data + segments[i].size);
+    }
+    message.qos = qos;
+    message.retained = retain;
+
+    budgetClass.head = (budgetClass.head + 1) % budgetClass.slots.size();
+    budgetClass.count++;
+    deferredTotal_++;
+    return ESP_OK;
+}
+
+bool MqttBudgetScheduler::mustWait(size_t index) const
+{
+    // Unclassified topics weigh 1
+    uint8_t weight = index < classes_.size() ? classes_[index].config.weight : 1;
+    if (index < classes_.size() && classes_[index].count > 0)
+    {
+        return true;
+    }
+
+    for (const BudgetClass &budgetClass : classes_)
+    {
+        if (budgetClass.count > 0 && budgetClass.config.weight > weight)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace mqtt
+} // namespace lopcore
@@ -0,0 +1,453 @@
+/**
+ * @file mqtt_coalescer.cpp
+ * @brief Last-value-wins publish coalescing for high-frequency topics
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/mqtt/mqtt_coalescer.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include "lopcore/logging/logger.hpp"
+#include "lopcore/task/task_profile.hpp"
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <chrono>
+#endif
+
+static const char *TAG = "MqttCoalescer";
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+MqttCoalescer::MqttCoalescer(std::shared_ptr<IMqttClient> client,
+                             const CoalesceConfig &config,
+                             TimeSource timeSource)
+    : MqttClientDecorator(std::move(client)),
+      config_(config),
+      timeSource_(timeSource),
+      running_(false),
+      published_(0),
+      coalesced_(0),
+      passedThrough_(0),
+      retried_(0),
+      failed_(0)
+#ifdef ESP_PLATFORM
+      ,
+      task_(nullptr),
+      stopped_(true)
+#else
+      ,
+      wakePending_(false)
+#endif
+{
+    for (const CoalesceRule &rule : config_.rules)
+    {
+        int64_t intervalUs = static_cast<int64_t>(rule.intervalMs) * 1000;
+        int64_t *existing = rules_.find(rule.topicFilter);
+        if (existing != nullptr)
+        {
+            *existing = std::min(*existing, intervalUs);
+        }
+        else if (rules_.insert(rule.topicFilter, intervalUs) != ESP_OK)
+        {
+            LOPCORE_LOGE(TAG, "Ignoring malformed coalesce filter '%s'", rule.topicFilter.c_str());
+        }
+    }
+
+    // Never grows past this, so Slot addresses stay valid outside the lock
+    slots_.reserve(config_.maxTopics);
+}
+
+MqttCoalescer::~MqttCoalescer()
+{
+    stop();
+}
+
+esp_err_t MqttCoalescer::start()
+{
+    if (running_.load())
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config_.validate() != ESP_OK)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    running_.store(true);
+#ifdef ESP_PLATFORM
+    stopped_.store(false);
+    TaskHandle_t handle = nullptr;
+    if (task::spawn(task::TaskRole::MQTT_COALESCE, "mqtt_coalesce", taskEntry, this, config_.stackSize,
+                    config_.priority, &handle) != ESP_OK)
+    {
+        stopped_.store(true);
+        running_.store(false);
+        LOPCORE_LOGE(TAG, "Failed to create coalesce flush task");
+        return ESP_FAIL;
+    }
+    task_ = handle;
+#else
+    thread_ = std::thread(taskEntry, this);
+#endif
+
+    LOPCORE_LOGI(TAG, "Coalescing %zu topic filters (%lu slots)", rules_.size(),
+                 static_cast<unsigned long>(config_.maxTopics));
+    return ESP_OK;
+}
+
+void MqttCoalescer::stop()
+{
+    running_.store(false);
+    wakeTask();
+
+#ifdef ESP_PLATFORM
+    while (!stopped_.load())
+    {
+        vTaskDelay(1);
+    }
+    task_ = nullptr;
+#else
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+#endif
+
+    // Don't leave the latest value of a topic unsent
+    esp_err_t err = flush();
+    if (err != ESP_OK)
+    {
+        LOPCORE_LOGW(TAG, "Values still waiting after stop (%s)", esp_err_to_name(err));
+    }
+}
+
+esp_err_t MqttCoalescer::flush()
+{
+    int64_t nextDueUs = 0;
+    return flushPending(true, &nextDueUs);
+}
+
+uint32_t MqttCoalescer::poll()
+{
+    int64_t nextDueUs = 0;
+    flushPending(false, &nextDueUs);
+    if (nextDueUs == std::numeric_limits<int64_t>::max())
+    {
+        return UINT32_MAX;
+    }
+
+    int64_t waitUs = std::max<int64_t>(nextDueUs - timeSource_(), 0);
+    return static_cast<uint32_t>(std::min<int64_t>((waitUs + 999) / 1000, UINT32_MAX - 1));
+}
+
+MqttCoalesceStats MqttCoalescer::getCoalesceStats() const
+{
+    MqttCoalesceStats stats;
+    stats.published = published_.load(std::memory_order_relaxed);
+    stats.coalesced = coalesced_.load(std::memory_order_relaxed);
+    stats.passedThrough = passedThrough_.load(std::memory_order_relaxed);
+    stats.retried = retried_.load(std::memory_order_relaxed);
+    stats.failed = failed_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+esp_err_t MqttCoalescer::publish(const std::string &topic,
+                                 const std::vector<uint8_t> &payload,
+                                 MqttQos qos,
+                                 bool retain)
+{
+    MqttPayloadSegment segment{payload.data(), payload.size()};
+    return publish(std::string_view(topic), &segment, 1, qos, retain);
+}
+
+esp_err_t MqttCoalescer::publishString(const std::string &topic,
+                                       const std::string &payload,
+                                       MqttQos qos,
+                                       bool retain)
+{
+    MqttPayloadSegment segment{payload.data(), payload.size()};
+    return publish(std::string_view(topic), &segment, 1, qos, retain);
+}
+
+esp_err_t MqttCoalescer::publish(std::string_view topic,
+                                 const MqttPayloadSegment *segments,
+                                 size_t segmentCount,
+                                 MqttQos qos,
+                                 bool retain)
+{
+    if (segments == nullptr && segmentCount > 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t intervalUs = intervalFor(topic);
+    if (intervalUs < 0)
+    {
+        return client_->publish(topic, segments, segmentCount, qos, retain);
+    }
+
+    Slot *slot = nullptr;
+    bool sendNow = false;
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        slot = slotFor(topic, intervalUs);
+        if (slot != nullptr)
+        {
+            int64_t nowUs = timeSource_();
+            if (!slot->pending && nowUs >= slot->dueUs)
+            {
+                // Quiet topic: send at once and open the interval
+                slot->dueUs = nowUs + slot->intervalUs;
+                sendNow = true;
+            }
+            else
+            {
+                wake = hold(*slot, segments, segmentCount, qos, retain);
+            }
+        }
+    }
+
+    if (slot == nullptr)
+    {
+        passedThrough_.fetch_add(1, std::memory_order_relaxed);
+        return client_->publish(topic, segments, segmentCount, qos, retain);
+    }
+
+    if (sendNow)
+    {
+        esp_err_t err = client_->publish(topic, segments, segmentCount, qos, retain);
+        if (err == ESP_OK)
+        {
+            published_.fetch_add(1, std::memory_order_relaxed);
+            return ESP_OK;
+        }
+        if (!isRetryable(err))
+        {
+            failed_.fetch_add(1, std::memory_order_relaxed);
+            return err;
+        }
+
+        // Refused for now; keep it unless a newer value arrived meanwhile
+        retried_.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!slot->pending)
+        {
+            hold(*slot, segments, segmentCount, qos, retain);
+        }
+        slot->dueUs = timeSource_() + static_cast<int64_t>(config_.retryMs) * 1000;
+        wake = true;
+    }
+
+    if (wake)
+    {
+        wakeTask();
+    }
+    return ESP_OK;
+}
+
+int64_t MqttCoalescer::intervalFor(std::string_view topic)
+{
+    int64_t intervalUs = -1;
+    rules_.match(topic, [&intervalUs](int64_t &ruleUs) {
+        intervalUs = intervalUs < 0 ? ruleUs : std::min(intervalUs, ruleUs);
+    });
+    return intervalUs;
+}
+
+MqttCoalescer::Slot *MqttCoalescer::slotFor(std::string_view topic, int64_t intervalUs)
+{
+    // maxTopics is small; a linear scan beats hashing a std::string per publish
+    for (Slot &slot : slots_)
+    {
+        if (slot.topic == topic)
+        {
+            return &slot;
+        }
+    }
+
+    if (slots_.size() >= config_.maxTopics)
+    {
+        return nullptr;
+    }
+
+    slots_.emplace_back();
+    Slot &slot = slots_.back();
+    slot.topic.assign(topic.data(), topic.size());
+    slot.intervalUs = intervalUs;
+    slot.dueUs = std::numeric_limits<int64_t>::min();
+    return &slot;
+}
+
+bool MqttCoalescer::hold(Slot &slot,
+                         const MqttPayloadSegment *segments,
+                         size_t segmentCount,
+                         MqttQos qos,
+                         bool retain)
+{
+    bool wasPending = slot.pending;
+    if (wasPending)
+    {
+        coalesced_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // clear() keeps the slot's capacity from earlier values
+    slot.payload.clear();
+    for (size_t i = 0; i < segmentCount; i++)
+    {
+        const uint8_t *data = static_cast<const uint8_t *>(segments[i].data);
+        slot.payload.insert(slot.payload.end(), data, data + segments[i].size);
+    }
+    slot.qos = qos;
+    slot.retain = retain;
+    slot.pending = true;
+    return !wasPending;
+}
+
+esp_err_t MqttCoalescer::flushPending(bool force, int64_t *nextDueUs)
+{
+    std::lock_guard<std::mutex> flushLock(flushMutex_);
+
+    esp_err_t result = ESP_OK;
+    int64_t nextUs = std::numeric_limits<int64_t>::max();
+
+    for (size_t i = 0;; i++)
+    {
+        Slot *slot = nullptr;
+        MqttQos qos = MqttQos::AT_MOST_ONCE;
+        bool retain = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (i >= slots_.size())
+            {
+                break;
+            }
+
+            slot = &slots_[i];
+            if (!slot->pending)
+            {
+                continue;
+            }
+            int64_t nowUs = timeSource_();
+            if (!force && nowUs < slot->dueUs)
+            {
+                nextUs = std::min(nextUs, slot->dueUs);
+                continue;
+            }
+
+            // Take the value, leaving the slot free for the next one
+            scratch_.swap(slot->payload);
+            qos = slot->qos;
+            retain = slot->retain;
+            slot->pending = false;
+            slot->dueUs = nowUs + slot->intervalUs;
+        }
+
+        MqttPayloadSegment segment{scratch_.data(), scratch_.size()};
+        esp_err_t err = client_->publish(slot->topic, &segment, 1, qos, retain);
+        if (err == ESP_OK)
+        {
+            published_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        if (result == ESP_OK)
+        {
+            result = err;
+        }
+
+        if (!isRetryable(err))
+        {
+            failed_.fetch_add(1, std::memory_order_relaxed);
+            LOPCORE_LOGW(TAG, "Dropped coalesced value on '%s' (%s)", slot->topic.c_str(),
+                         esp_err_to_name(err));
+            continue;
+        }
+
+        retried_.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!slot->pending)
+        {
+            // Put the value back; scratch_ takes the slot's spare buffer
+            slot->payload.swap(scratch_);
+            slot->qos = qos;
+            slot->retain = retain;
+            slot->pending = true;
+        }
+        else
+        {
+            coalesced_.fetch_add(1, std::memory_order_relaxed);
+        }
+        slot->dueUs = timeSource_() + static_cast<int64_t>(config_.retryMs) * 1000;
+        nextUs = std::min(nextUs, slot->dueUs);
+    }
+
+    *nextDueUs = nextUs;
+    return result;
+}
+
+void MqttCoalescer::taskEntry(void *arg)
+{
+    MqttCoalescer *self = static_cast<MqttCoalescer *>(arg);
+    self->runTask();
+
+#ifdef ESP_PLATFORM
+    self->stopped_.store(true);
+    task::exitTask();
+#endif
+}
+
+void MqttCoalescer::runTask()
+{
+    while (running_.load())
+    {
+        uint32_t waitMs = poll();
+
+#ifdef ESP_PLATFORM
+        TickType_t ticks =
+            waitMs == UINT32_MAX ? portMAX_DELAY : std::max<TickType_t>(pdMS_TO_TICKS(waitMs), 1);
+        ulTaskNotifyTake(pdTRUE, ticks);
+#else
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto woken = [this] { return wakePending_ || !running_.load(); };
+        if (waitMs == UINT32_MAX)
+        {
+            wake_.wait(lock, woken);
+        }
+        else
+        {
+            wake_.wait_for(lock, std::chrono::milliseconds(waitMs), woken);
+        }
+        wakePending_ = false;
+#endif
+    }
+}
+
+void MqttCoalescer::wakeTask()
+{
+#ifdef ESP_PLATFORM
+    TaskHandle_t handle = static_cast<TaskHandle_t>(task_);
+    if (handle != nullptr)
+    {
+        xTaskNotifyGive(handle);
+    }
+#else
+    // Taking the lock orders the notify after a concurrent predicate check
+    std::lock_guard<std::mutex> lock(mutex_);
+    wakePending_ = true;
+    wake_.notify_one();
+#endif
+}
+
+} // namespace mqtt
+} // namespace lopcore
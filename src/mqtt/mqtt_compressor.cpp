@@ -0,0 +1,201 @@
+/**
+ * @file mqtt_compressor.cpp
+ * @brief Transparent payload compression for any IMqttClient
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/mqtt/mqtt_compressor.hpp"
+
+#include "lopcore/logging/logger.hpp"
+
+static const char *TAG = "MqttCompressor";
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+MqttCompressor::MqttCompressor(std::shared_ptr<IMqttClient> client, const CompressionConfig &config)
+    : MqttClientDecorator(std::move(client)),
+      config_(config),
+      compressed_(0),
+      uncompressed_(0),
+      bytesIn_(0),
+      bytesOut_(0),
+      inflated_(0),
+      inflateErrors_(0)
+{
+}
+
+MqttCompressionStats MqttCompressor::getCompressionStats() const
+{
+    MqttCompressionStats stats;
+    stats.compressed = compressed_.load(std::memory_order_relaxed);
+    stats.uncompressed = uncompressed_.load(std::memory_order_relaxed);
+    stats.bytesIn = bytesIn_.load(std::memory_order_relaxed);
+    stats.bytesOut = bytesOut_.load(std::memory_order_relaxed);
+    stats.inflated = inflated_.load(std::memory_order_relaxed);
+    stats.inflateErrors = inflateErrors_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+esp_err_t MqttCompressor::publish(const std::string &topic,
+                                  const std::vector<uint8_t> &payload,
+                                  MqttQos qos,
+                                  bool retain)
+{
+    MqttPayloadSegment segment{payload.data(), payload.size()};
+    return publish(std::string_view(topic), &segment, 1, qos, retain);
+}
+
+esp_err_t MqttCompressor::publishString(const std::string &topic,
+                                        const std::string &payload,
+                                        MqttQos qos,
+                                        bool retain)
+{
+    MqttPayloadSegment segment{payload.data(), payload.size()};
+    return publish(std::string_view(topic), &segment, 1, qos, retain);
+}
+
+esp_err_t MqttCompressor::publish(std::string_view topic,
+                                  const MqttPayloadSegment *segments,
+                                  size_t segmentCount,
+                                  MqttQos qos,
+                                  bool retain)
+{
+    if (segments == nullptr && segmentCount > 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t payloadLength = 0;
+    for (size_t i = 0; i < segmentCount; i++)
+    {
+        payloadLength += segments[i].size;
+    }
+    if (payloadLength < config_.minPayloadSize)
+    {
+        uncompressed_.fetch_add(1, std::memory_order_relaxed);
+        return client_->publish(topic, segments, segmentCount, qos, retain);
+    }
+
+    Packed packed;
+    bool shrunk;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!spare_.empty())
+        {
+            packed = std::move(spare_.back());
+            spare_.pop_back();
+        }
+
+        // The match finder needs the whole payload in one buffer
+        const uint8_t *data = static_cast<const uint8_t *>(segments[0].data);
+        if (segmentCount > 1)
+        {
+            input_.clear();
+            for (size_t i = 0; i < segmentCount; i++)
+            {
+                const uint8_t *segment = static_cast<const uint8_t *>(segments[i].data);
+                input_.insert(input_.end(), segment, segment + segments[i].size);
+            }
+            data = input_.data();
+        }
+        shrunk = codec_.compress(data, payloadLength, packed.payload);
+    }
+
+    esp_err_t err;
+    if (!shrunk)
+    {
+        uncompressed_.fetch_add(1, std::memory_order_relaxed);
+        err = client_->publish(topic, segments, segmentCount, qos, retain);
+    }
+    else
+    {
+        packed.topic.assign(topic.data(), topic.size());
+        packed.topic += config_.topicSuffix;
+
+        MqttPayloadSegment segment{packed.payload.data(), packed.payload.size()};
+        err = client_->publish(packed.topic, &segment, 1, qos, retain);
+        if (err == ESP_OK)
+        {
+            compressed_.fetch_add(1, std::memory_order_relaxed);
+            bytesIn_.fetch_add(payloadLength, std::memory_order_relaxed);
+            bytesOut_.fetch_add(packed.payload.size(), std::memory_order_relaxed);
+        }
+    }
+
+    // Keep the buffers for the next publish
+    std::lock_guard<std::mutex> lock(mutex_);
+    spare_.push_back(std::move(packed));
+    return err;
+}
+
+esp_err_t MqttCompressor::subscribe(const std::string &topic, MessageCallback callback, MqttQos qos)
+{
+    auto shared = std::make_shared<MessageCallback>(std::move(callback));
+    auto wrapped = [this, shared](const MqttMessage &message) { deliver(message, *shared); };
+
+    esp_err_t err = client_->subscribe(topic, wrapped, qos);
+    if (err != ESP_OK || coversSuffix(topic))
+    {
+        return err;
+    }
+
+    err = client_->subscribe(topic + config_.topicSuffix, wrapped, qos);
+    if (err != ESP_OK)
+    {
+        client_->unsubscribe(topic);
+    }
+    return err;
+}
+
+esp_err_t MqttCompressor::subscribeView(const std::string &topic, MessageViewCallback callback, MqttQos qos)
+{
+    // The inner client's view would be the compressed bytes
+    return IMqttClient::subscribeView(topic, std::move(callback), qos);
+}
+
+esp_err_t MqttCompressor::unsubscribe(const std::string &topic)
+{
+    esp_err_t err = client_->unsubscribe(topic);
+    if (!coversSuffix(topic))
+    {
+        esp_err_t suffixErr = client_->unsubscribe(topic + config_.topicSuffix);
+        err = err != ESP_OK ? err : suffixErr;
+    }
+    return err;
+}
+
+void MqttCompressor::deliver(const MqttMessage &message, const MessageCallback &callback)
+{
+    const std::string &suffix = config_.topicSuffix;
+    bool packed = message.topic.size() > suffix.size() &&
+                  message.topic.compare(message.topic.size() - suffix.size(), suffix.size(), suffix) == 0;
+    if (!packed)
+    {
+        callback(message);
+        return;
+    }
+
+    MqttMessage inflated;
+    if (!MqttPayloadCodec::decompress(message.payload.data(), message.payload.size(), config_.maxInflatedSize,
+                                      inflated.payload))
+    {
+        inflateErrors_.fetch_add(1, std::memory_order_relaxed);
+        LOPCORE_LOGW(TAG, "Dropped undecodable compressed message on '%s'", message.topic.c_str());
+        return;
+    }
+
+    inflated.topic.assign(message.topic, 0, message.topic.size() - suffix.size());
+    inflated.qos = message.qos;
+    inflated.retained = message.retained;
+    inflated.messageId = message.messageId;
+    inflated_.fetch_add(1, std::memory_order_relaxed);
+    callback(inflated);
+}
+
+} // namespace mqtt
+} // namespace lopcore
@@ -0,0 +1,269 @@
+/**
+ * @file mqtt_dispatcher.cpp
+ * @brief Worker pool that runs MQTT message callbacks off the network task
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/mqtt/mqtt_dispatcher.hpp"
+
+#include "lopcore/logging/logger.hpp"
+#include "lopcore/task/task_profile.hpp"
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <chrono>
+#endif
+
+static const char *TAG = "MqttDispatcher";
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+MqttDispatcher::MqttDispatcher(const DispatchConfig &config)
+    : config_(config), running_(false), dispatched_(0), dropped_(0)
+{
+    for (uint32_t i = 0; i < config_.workers; i++)
+    {
+        auto worker = std::make_unique<Worker>();
+        worker->owner = this;
+        worker->slots.resize(config_.queueDepth);
+        workers_.push_back(std::move(worker));
+    }
+}
+
+MqttDispatcher::~MqttDispatcher()
+{
+    stop();
+}
+
+esp_err_t MqttDispatcher::start()
+{
+    if (running_.load())
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (workers_.empty())
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    running_.store(true);
+    for (auto &worker : workers_)
+    {
+#ifdef ESP_PLATFORM
+        worker->stopped.store(false);
+        TaskHandle_t handle = nullptr;
+        if (task::spawn(task::TaskRole::MQTT_DISPATCH, "mqtt_dispatch", workerEntry, worker.get(),
+                        config_.stackSize, config_.priority, &handle) != ESP_OK)
+        {
+            worker->stopped.store(true);
+            LOPCORE_LOGE(TAG, "Failed to create dispatch worker task");
+            stop();
+            return ESP_FAIL;
+        }
+        worker->task = handle;
+#else
+        worker->thread = std::thread(workerEntry, worker.get());
+#endif
+    }
+
+    LOPCORE_LOGI(TAG, "Started %zu dispatch workers (queue depth %lu)", workers_.size(),
+                 static_cast<unsigned long>(config_.queueDepth));
+    return ESP_OK;
+}
+
+void MqttDispatcher::stop()
+{
+    running_.store(false);
+
+    for (auto &worker : workers_)
+    {
+        wakeWorker(*worker);
+#ifdef ESP_PLATFORM
+        while (!worker->stopped.load())
+        {
+            vTaskDelay(1);
+        }
+        worker->task = nullptr;
+#else
+        if (worker->thread.joinable())
+        {
+            worker->thread.join();
+        }
+#endif
+
+        // Discard queued messages and release their handlers
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        for (Job &job : worker->slots)
+        {
+            job.handlers.clear();
+        }
+        worker->head = 0;
+        worker->tail = 0;
+        worker->count = 0;
+    }
+}
+
+esp_err_t MqttDispatcher::dispatch(const MqttMessageView &view, const std::vector<MqttHandlerPtr> &handlers)
+{
+    if (!running_.load())
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    Worker &worker = *workers_[workerFor(view.topic, workers_.size())];
+
+    uint32_t waitedMs = 0;
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if (worker.count < worker.slots.size())
+            {
+                // assign() keeps the slot's capacity from earlier messages
+                Job &job = worker.slots[worker.head];
+                job.message.topic.assign(view.topic.data(), view.topic.size());
+                job.message.payload.assign(view.payload, view.payload + view.payloadLength);
+                job.message.qos = view.qos;
+                job.message.retained = view.retained;
+                job.message.messageId = view.messageId;
+                job.handlers.assign(handlers.begin(), handlers.end());
+
+                worker.head = (worker.head + 1) % worker.slots.size();
+                worker.count++;
+                break;
+            }
+        }
+
+        if (waitedMs >= config_.enqueueTimeoutMs)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            LOPCORE_LOGW(TAG, "Dispatch queue full, dropped message on '%.*s'",
+                         static_cast<int>(view.topic.size()), view.topic.data());
+            return ESP_ERR_TIMEOUT;
+        }
+
+#ifdef ESP_PLATFORM
+        vTaskDelay(1);
+        waitedMs += portTICK_PERIOD_MS;
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        waitedMs++;
+#endif
+    }
+
+    dispatched_.fetch_add(1, std::memory_order_relaxed);
+    wakeWorker(worker);
+    return ESP_OK;
+}
+
+size_t MqttDispatcher::workerFor(std::string_view topic, size_t workerCount)
+{
+    // FNV-1a: cheap, and spreads similar topic names well
+    uint32_t hash = 2166136261u;
+    for (char c : topic)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return workerCount > 0 ? hash % workerCount : 0;
+}
+
+MqttDispatchStats MqttDispatcher::getStats() const
+{
+    MqttDispatchStats stats;
+    stats.messagesDispatched = dispatched_.load(std::memory_order_relaxed);
+    stats.messagesDropped = dropped_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void MqttDispatcher::workerEntry(void *arg)
+{
+    Worker *worker = static_cast<Worker *>(arg);
+    worker->owner->runWorker(*worker);
+
+#ifdef ESP_PLATFORM
+    worker->stopped.store(true);
+    task::exitTask();
+#endif
+}
+
+void MqttDispatcher::runWorker(Worker &worker)
+{
+    while (true)
+    {
+        Job *job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+#ifndef ESP_PLATFORM
+            worker.wake.wait(lock, [this, &worker] { return worker.count > 0 || !running_.load(); });
+#endif
+            if (!running_.load())
+            {
+                break;
+            }
+            if (worker.count > 0)
+            {
+                job = &worker.slots[worker.tail];
+            }
+        }
+
+        if (job == nullptr)
+        {
+#ifdef ESP_PLATFORM
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#endif
+            continue;
+        }
+
+        // The slot stays counted, so dispatch() does not reuse it while the callbacks run
+        MqttMessageView view;
+        view.topic = job->message.topic;
+        view.payload = job->message.payload.data();
+        view.payloadLength = job->message.payload.size();
+        view.qos = job->message.qos;
+        view.retained = job->message.retained;
+        view.messageId = job->message.messageId;
+
+        for (const MqttHandlerPtr &handler : job->handlers)
+        {
+            if (handler->viewCallback)
+            {
+                handler->viewCallback(view);
+            }
+            else if (handler->callback)
+            {
+                handler->callback(job->message);
+            }
+        }
+        job->handlers.clear();
+
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tail = (worker.tail + 1) % worker.slots.size();
+        worker.count--;
+    }
+}
+
+void MqttDispatcher::wakeWorker(Worker &worker)
+{
+#ifdef ESP_PLATFORM
+    TaskHandle_t handle = static_cast<TaskHandle_t>(worker.task);
+    if (handle != nullptr)
+    {
+        xTaskNotifyGive(handle);
+    }
+#else
+    // Taking the lock orders the notify after a concurrent predicate check
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.wake.notify_one();
+#endif
+}
+
+} // namespace mqtt
+} // namespace lopcore
@@ -0,0 +1,887 @@
+/**
+ * @file mqtt_file_downloader.cpp
+ * @brief Pipelined AWS IoT MQTT file stream download straight to storage or OTA
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/mqtt/mqtt_file_downloader.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "lopcore/logging/logger.hpp"
+
+static const char *TAG = "MqttFileDownloader";
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+// =============================================================================
+// Sinks
+// =============================================================================
+
+#ifdef ESP_PLATFORM
+OtaPartitionSink::OtaPartitionSink(const esp_partition_t *partition, bool bootOnFinish)
+    : partition_(partition), bootOnFinish_(bootOnFinish), handle_(0)
+{
+}
+
+OtaPartitionSink::~OtaPartitionSink()
+{
+    abort();
+}
+
+esp_err_t OtaPartitionSink::begin(size_t size)
+{
+    if (partition_ == nullptr)
+    {
+        partition_ = esp_ota_get_next_update_partition(nullptr);
+        if (partition_ == nullptr)
+        {
+            LOPCORE_LOGE(TAG, "No OTA update partition");
+            return ESP_ERR_NOT_FOUND;
+        }
+    }
+    esp_err_t err = esp_ota_begin(partition_, size, &handle_);
+    if (err != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "esp_ota_begin failed: %s", esp_err_to_name(err));
+        handle_ = 0;
+    }
+    return err;
+}
+
+esp_err_t OtaPartitionSink::write(const uint8_t *data, size_t length)
+{
+    return esp_ota_write(handle_, data, length);
+}
+
+esp_err_t OtaPartitionSink::finish()
+{
+    esp_err_t err = esp_ota_end(handle_);
+    handle_ = 0;
+    if (err != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "esp_ota_end failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    return bootOnFinish_ ? esp_ota_set_boot_partition(partition_) : ESP_OK;
+}
+
+void OtaPartitionSink::abort()
+{
+    if (handle_ != 0)
+    {
+        esp_ota_abort(handle_);
+        handle_ = 0;
+    }
+}
+#endif
+
+// =============================================================================
+// SHA-256
+// =============================================================================
+
+#ifdef ESP_PLATFORM
+Sha256::Sha256()
+{
+    mbedtls_sha256_init(&context_);
+    mbedtls_sha256_starts(&context_, 0);
+}
+
+Sha256::~Sha256()
+{
+    mbedtls_sha256_free(&context_);
+}
+
+void Sha256::update(const uint8_t *data, size_t length)
+{
+    mbedtls_sha256_update(&context_, data, length);
+}
+
+std::array<uint8_t, 32> Sha256::finish()
+{
+    std::array<uint8_t, 32> digest;
+    mbedtls_sha256_finish(&context_, digest.data());
+    mbedtls_sha256_starts(&context_, 0);
+    return digest;
+}
+#else
+// FIPS 180-4, for host builds without mbedTLS
+
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static uint32_t rotr(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+Sha256::Sha256()
+{
+    reset();
+}
+
+Sha256::~Sha256() = default;
+
+void Sha256::compress(const uint8_t *block)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = (static_cast<uint32_t>(block[4 * i]) << 24) | (static_cast<uint32_t>(block[4 * i + 1]) << 16) |
+               (static_cast<uint32_t>(block[4 * i + 2]) << 8) | block[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++)
+    {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+    uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+    for (int i = 0; i < 64; i++)
+    {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+    state_[5] += f;
+    state_[6] += g;
+    state_[7] += h;
+}
+
+void Sha256::update(const uint8_t *data, size_t length)
+{
+    size_t used = length_ % 64;
+    length_ += length;
+    if (used > 0)
+    {
+        size_t take = std::min(length, 64 - used);
+        std::memcpy(buffer_.data() + used, data, take);
+        data += take;
+        length -= take;
+        if (used + take < 64)
+        {
+            return;
+        }
+        compress(buffer_.data());
+    }
+    for (; length >= 64; data += 64, length -= 64)
+    {
+        compress(data);
+    }
+    std::memcpy(buffer_.data(), data, length);
+}
+
+std::array<uint8_t, 32> Sha256::finish()
+{
+    uint64_t bits = length_ * 8;
+    uint8_t padding[72] = {0x80};
+    size_t padLength = (length_ % 64 < 56 ? 56 : 120) - length_ % 64;
+    for (int i = 0; i < 8; i++)
+    {
+        padding[padLength + i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+    }
+    update(padding, padLength + 8);
+
+    std::array<uint8_t, 32> digest;
+    for (int i = 0; i < 8; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            digest[4 * i + j] = static_cast<uint8_t>(state_[i] >> (24 - 8 * j));
+        }
+    }
+    reset();
+    return digest;
+}
+
+void Sha256::reset()
+{
+    state_ = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    length_ = 0;
+}
+#endif
+
+// =============================================================================
+// CBOR
+// =============================================================================
+
+namespace file_stream
+{
+
+namespace
+{
+
+// Major types of RFC 8949
+constexpr uint8_t CBOR_UNSIGNED = 0;
+constexpr uint8_t CBOR_BYTES = 2;
+constexpr uint8_t CBOR_TEXT = 3;
+constexpr uint8_t CBOR_MAP = 5;
+
+/**
+ * @brief Bounds-checked CBOR writer
+ */
+class CborWriter
+{
+public:
+    CborWriter(uint8_t *buffer, size_t size) : out_(buffer), end_(buffer + size)
+    {
+    }
+
+    void head(uint8_t major, uint64_t value)
+    {
+        uint8_t type = static_cast<uint8_t>(major << 5);
+        if (value < 24)
+        {
+            put(type | static_cast<uint8_t>(value), 0, 0);
+        }
+        else if (value <= 0xFF)
+        {
+            put(type | 24, value, 1);
+        }
+        else if (value <= 0xFFFF)
+        {
+            put(type | 25, value, 2);
+        }
+        else
+        {
+            put(type | 26, value, 4);
+        }
+    }
+
+    void text(const char *text, size_t length)
+    {
+        head(CBOR_TEXT, length);
+        if (ok() && static_cast<size_t>(end_ - out_) >= length)
+        {
+            std::memcpy(out_, text, length);
+            out_ += length;
+        }
+        else
+        {
+            out_ = nullptr;
+        }
+    }
+
+    void key(const char *name)
+    {
+        text(name, std::strlen(name));
+    }
+
+    bool ok() const
+    {
+        return out_ != nullptr;
+    }
+
+    uint8_t *position() const
+    {
+        return out_;
+    }
+
+private:
+    void put(uint8_t first, uint64_t value, size_t bytes)
+    {
+        if (!ok() || static_cast<size_t>(end_ - out_) < 1 + bytes)
+        {
+            out_ = nullptr;
+            return;
+        }
+        *out_++ = first;
+        for (size_t i = bytes; i > 0; i--)
+        {
+            *out_++ = static_cast<uint8_t>(value >> (8 * (i - 1)));
+        }
+    }
+
+    uint8_t *out_;
+    uint8_t *end_;
+};
+
+/**
+ * @brief Bounds-checked CBOR reader for definite-length items
+ */
+class CborReader
+{
+public:
+    CborReader(const uint8_t *data, size_t length) : in_(data), end_(data + length)
+    {
+    }
+
+    /**
+     * @brief Read an item head
+     * @return false on truncation, indefinite lengths or values over 32 bits
+     */
+    bool head(uint8_t &major, uint32_t &value)
+    {
+        if (in_ >= end_)
+        {
+            return false;
+        }
+        major = *in_ >> 5;
+        uint8_t info = *in_++ & 0x1F;
+        if (info < 24)
+        {
+            value = info;
+            return true;
+        }
+        size_t bytes = info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : 0;
+        if (bytes == 0 || static_cast<size_t>(end_ - in_) < bytes)
+        {
+            return false;
+        }
+        value = 0;
+        for (size_t i = 0; i < bytes; i++)
+        {
+            value = (value << 8) | *in_++;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Take length bytes of a string's content
+     */
+    const uint8_t *take(uint32_t length)
+    {
+        if (static_cast<size_t>(end_ - in_) < length)
+        {
+            return nullptr;
+        }
+        const uint8_t *data = in_;
+        in_ += length;
+        return data;
+    }
+
+    /**
+     * @brief Skip one value whose head was already read
+     */
+    bool skip(uint8_t major, uint32_t value)
+    {
+        switch (major)
+        {
+            case CBOR_UNSIGNED:
+            case 1:
+            case 7:
+                return true;
+            case CBOR_BYTES:
+            case CBOR_TEXT:
+                return take(value) != nullptr;
+            case 4:
+            case CBOR_MAP:
+            {
+                uint32_t items = major == CBOR_MAP ? value * 2 : value;
+                for (uint32_t i = 0; i < items; i++)
+                {
+                    uint8_t itemMajor;
+                    uint32_t itemValue;
+                    if (!head(itemMajor, itemValue) || !skip(itemMajor, itemValue))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+private:
+    const uint8_t *in_;
+    const uint8_t *end_;
+};
+
+} // namespace
+
+size_t encodeGetRequest(uint8_t *buffer,
+                        size_t size,
+                        const std::string &clientToken,
+                        uint32_t fileId,
+                        uint32_t blockSize,
+                        uint32_t firstBlock,
+                        uint32_t count)
+{
+    CborWriter writer(buffer, size);
+    writer.head(CBOR_MAP, 5);
+    writer.key("c");
+    writer.text(clientToken.data(), clientToken.size());
+    writer.key("f");
+    writer.head(CBOR_UNSIGNED, fileId);
+    writer.key("l");
+    writer.head(CBOR_UNSIGNED, blockSize);
+    writer.key("o");
+    writer.head(CBOR_UNSIGNED, firstBlock);
+    writer.key("n");
+    writer.head(CBOR_UNSIGNED, count);
+    return writer.ok() ? static_cast<size_t>(writer.position() - buffer) : 0;
+}
+
+bool decodeDataBlock(const uint8_t *data, size_t length, DataBlock &block)
+{
+    CborReader reader(data, length);
+    uint8_t major;
+    uint32_t pairs;
+    if (!reader.head(major, pairs) || major != CBOR_MAP)
+    {
+        return false;
+    }
+
+    uint8_t seen = 0;
+    for (uint32_t i = 0; i < pairs; i++)
+    {
+        uint32_t keyLength;
+        const uint8_t *key;
+        if (!reader.head(major, keyLength) || major != CBOR_TEXT || (key = reader.take(keyLength)) == nullptr)
+        {
+            return false;
+        }
+
+        uint32_t value;
+        if (!reader.head(major, value))
+        {
+            return false;
+        }
+        char name = keyLength == 1 ? static_cast<char>(key[0]) : '\0';
+        if (major == CBOR_UNSIGNED && (name == 'f' || name == 'i' || name == 'l'))
+        {
+            (name == 'f' ? block.fileId : name == 'i' ? block.blockId : block.blockSize) = value;
+            seen |= name == 'f' ? 1 : name == 'i' ? 2 : 4;
+        }
+        else if (major == CBOR_BYTES && name == 'p')
+        {
+            block.payload = reader.take(value);
+            block.payloadLength = value;
+            if (block.payload == nullptr)
+            {
+                return false;
+            }
+            seen |= 8;
+        }
+        else if (!reader.skip(major, value))
+        {
+            return false;
+        }
+    }
+    return seen == 0x0F;
+}
+
+} // namespace file_stream
+
+// =============================================================================
+// MqttFileDownloader
+// =============================================================================
+
+MqttFileDownloader::MqttFileDownloader(std::shared_ptr<IMqttClient> client,
+                                       const FileStreamConfig &config,
+                                       IFileStreamSink &sink,
+                                       TimeSource timeSource)
+    : client_(std::move(client)),
+      config_(config),
+      sink_(sink),
+      timeSource_(timeSource),
+      topicPrefix_("$aws/things/" + config.thingName + "/streams/" + config.streamId + "/"),
+      clientToken_(client_ ? client_->getClientId().substr(0, MAX_TOKEN_LENGTH) : std::string()),
+      state_(FileDownloadState::IDLE),
+      result_(ESP_OK),
+      nextBlock_(0),
+      nextRequest_(0),
+      bytesWritten_(0),
+      digest_{},
+      subscribed_(false)
+{
+}
+
+MqttFileDownloader::~MqttFileDownloader()
+{
+    cancel();
+    unsubscribe();
+}
+
+esp_err_t MqttFileDownloader::start(CompletionCallback onComplete)
+{
+    if (!client_ || config_.validate() != ESP_OK)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    std::vector<uint32_t> toRequest;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (state_ != FileDownloadState::IDLE)
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+
+        uint32_t window = std::min(config_.window, blockCount());
+        reorder_.resize(static_cast<size_t>(window) * config_.blockSize);
+        slots_.resize(window);
+        if (reorder_.size() != static_cast<size_t>(window) * config_.blockSize)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+
+        esp_err_t err = sink_.begin(config_.fileSize);
+        if (err != ESP_OK)
+        {
+            LOPCORE_LOGE(TAG, "Sink refused the download: %s", esp_err_to_name(err));
+            return err;
+        }
+        onComplete_ = std::move(onComplete);
+        state_ = FileDownloadState::DOWNLOADING;
+        fillWindow(timeSource_(), toRequest);
+    }
+
+    esp_err_t err = client_->subscribe(
+        topicPrefix_ + "data/cbor", [this](const MqttMessage &message) { onData(message); }, config_.qos);
+    if (err == ESP_OK)
+    {
+        err = client_->subscribe(
+            topicPrefix_ + "rejected/cbor", [this](const MqttMessage &message) { onRejected(message); },
+            config_.qos);
+    }
+    subscribed_ = true;
+    if (err == ESP_OK)
+    {
+        err = sendRequests(toRequest);
+    }
+    if (err != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "Cannot start stream %s: %s", config_.streamId.c_str(), esp_err_to_name(err));
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            complete(err);
+            onComplete_ = nullptr;
+        }
+        unsubscribe();
+        return err;
+    }
+
+    LOPCORE_LOGI(TAG, "Downloading %u bytes of stream %s in %u blocks, %u in flight",
+                 static_cast<unsigned>(config_.fileSize), config_.streamId.c_str(),
+                 static_cast<unsigned>(blockCount()), static_cast<unsigned>(slots_.size()));
+    return ESP_OK;
+}
+
+void MqttFileDownloader::cancel()
+{
+    CompletionCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (state_ != FileDownloadState::DOWNLOADING)
+        {
+            return;
+        }
+        complete(ESP_ERR_INVALID_STATE);
+        callback = std::move(onComplete_);
+    }
+    if (callback)
+    {
+        callback(ESP_ERR_INVALID_STATE);
+    }
+}
+
+uint32_t MqttFileDownloader::poll()
+{
+    std::vector<uint32_t> toRequest;
+    int64_t nextDueUs = std::numeric_limits<int64_t>::max();
+    CompletionCallback callback;
+    esp_err_t result = ESP_OK;
+    int64_t nowUs = timeSource_();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (state_ != FileDownloadState::DOWNLOADING)
+        {
+            return UINT32_MAX;
+        }
+
+        for (uint32_t block = nextBlock_; block < nextRequest_; block++)
+        {
+            Slot &slot = slots_[block % slots_.size()];
+            if (slot.received)
+            {
+                continue;
+            }
+            if (slot.dueUs <= nowUs)
+            {
+                if (slot.retries >= config_.maxRetries)
+                {
+                    LOPCORE_LOGE(TAG, "Block %u not received after %u retries", static_cast<unsigned>(block),
+                                 static_cast<unsigned>(slot.retries));
+                    complete(ESP_ERR_TIMEOUT);
+                    callback = std::move(onComplete_);
+                    result = ESP_ERR_TIMEOUT;
+                    break;
+                }
+                slot.retries++;
+                slot.dueUs = nowUs + static_cast<int64_t>(config_.requestTimeoutMs) * 1000;
+                stats_.retries++;
+                toRequest.push_back(block);
+            }
+            nextDueUs = std::min(nextDueUs, slot.dueUs);
+        }
+    }
+
+    if (callback)
+    {
+        callback(result);
+    }
+    if (result != ESP_OK)
+    {
+        return UINT32_MAX;
+    }
+    sendRequests(toRequest); // A request the client refuses times out and is retried
+    return nextDueUs == std::numeric_limits<int64_t>::max()
+               ? UINT32_MAX
+               : static_cast<uint32_t>(std::max<int64_t>(nextDueUs - nowUs, 0) / 1000);
+}
+
+esp_err_t MqttFileDownloader::getResult() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return result_;
+}
+
+size_t MqttFileDownloader::getBytesWritten() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytesWritten_;
+}
+
+std::array<uint8_t, 32> MqttFileDownloader::getSha256() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return digest_;
+}
+
+FileDownloadStats MqttFileDownloader::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void MqttFileDownloader::onData(const MqttMessage &message)
+{
+    file_stream::DataBlock block;
+    std::vector<uint32_t> toRequest;
+    CompletionCallback callback;
+    esp_err_t result = ESP_OK;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (state_ != FileDownloadState::DOWNLOADING)
+        {
+            return;
+        }
+
+        if (!file_stream::decodeDataBlock(message.payload.data(), message.payload.size(), block))
+        {
+            stats_.malformed++;
+            return;
+        }
+        if (block.fileId != config_.fileId)
+        {
+            return; // Another file of the same stream
+        }
+        if (block.blockId >= blockCount() || block.payloadLength != blockLength(block.blockId))
+        {
+            stats_.malformed++;
+            return;
+        }
+
+        Slot &slot = slots_[block.blockId % slots_.size()];
+        if (block.blockId < nextBlock_ || block.blockId >= nextRequest_ || slot.received)
+        {
+            stats_.duplicates++;
+            return;
+        }
+
+        if (block.blockId == nextBlock_)
+        {
+            result = deliver(block.payload, block.payloadLength);
+        }
+        else
+        {
+            std::memcpy(&reorder_[static_cast<size_t>(block.blockId % slots_.size()) * config_.blockSize],
+                        block.payload, block.payloadLength);
+            slot.received = true;
+            slot.length = static_cast<uint32_t>(block.payloadLength);
+            stats_.reordered++;
+        }
+
+        if (result != ESP_OK || nextBlock_ == blockCount())
+        {
+            complete(result);
+            result = result_;
+            callback = std::move(onComplete_);
+        }
+        else
+        {
+            fillWindow(timeSource_(), toRequest);
+        }
+    }
+
+    if (callback)
+    {
+        callback(result);
+    }
+    sendRequests(toRequest);
+}
+
+void MqttFileDownloader::onRejected(const MqttMessage &message)
+{
+    (void)message;
+    CompletionCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (state_ != FileDownloadState::DOWNLOADING)
+        {
+            return;
+        }
+        LOPCORE_LOGE(TAG, "Stream %s rejected the request", config_.streamId.c_str());
+        complete(ESP_ERR_NOT_FOUND);
+        callback = std::move(onComplete_);
+    }
+    if (callback)
+    {
+        callback(ESP_ERR_NOT_FOUND);
+    }
+}
+
+esp_err_t MqttFileDownloader::deliver(const uint8_t *data, size_t length)
+{
+    while (true)
+    {
+        esp_err_t err = sink_.write(data, length);
+        if (err != ESP_OK)
+        {
+            LOPCORE_LOGE(TAG, "Sink write at %zu failed: %s", bytesWritten_, esp_err_to_name(err));
+            return err;
+        }
+        hash_.update(data, length);
+        bytesWritten_ += length;
+
+        slots_[nextBlock_ % slots_.size()] = Slot{};
+        nextBlock_++;
+
+        // Blocks that arrived early and are now next
+        Slot &next = slots_[nextBlock_ % slots_.size()];
+        if (nextBlock_ >= nextRequest_ || !next.received)
+        {
+            return ESP_OK;
+        }
+        data = &reorder_[static_cast<size_t>(nextBlock_ % slots_.size()) * config_.blockSize];
+        length = next.length;
+    }
+}
+
+void MqttFileDownloader::fillWindow(int64_t nowUs, std::vector<uint32_t> &toRequest)
+{
+    while (nextRequest_ < blockCount() && nextRequest_ < nextBlock_ + slots_.size())
+    {
+        Slot &slot = slots_[nextRequest_ % slots_.size()];
+        slot = Slot{};
+        slot.block = nextRequest_;
+        slot.dueUs = nowUs + static_cast<int64_t>(config_.requestTimeoutMs) * 1000;
+        toRequest.push_back(nextRequest_++);
+    }
+}
+
+esp_err_t MqttFileDownloader::sendRequests(const std::vector<uint32_t> &blocks)
+{
+    // One request per run of consecutive blocks: "o" first block, "n" count
+    uint8_t request[MAX_TOKEN_LENGTH + 64];
+    std::string topic = topicPrefix_ + "get/cbor";
+    esp_err_t result = ESP_OK;
+    for (size_t first = 0; first < blocks.size();)
+    {
+        size_t last = first;
+        while (last + 1 < blocks.size() && blocks[last + 1] == blocks[last] + 1)
+        {
+            last++;
+        }
+        size_t length = file_stream::encodeGetRequest(request, sizeof(request), clientToken_, config_.fileId,
+                                                      config_.blockSize, blocks[first],
+                                                      static_cast<uint32_t>(last - first + 1));
+        MqttPayloadSegment segment{request, length};
+        esp_err_t err = length > 0 ? client_->publish(topic, &segment, 1, config_.qos) : ESP_ERR_INVALID_SIZE;
+        if (err != ESP_OK)
+        {
+            LOPCORE_LOGW(TAG, "Request for blocks %u-%u not sent: %s", static_cast<unsigned>(blocks[first]),
+                         static_cast<unsigned>(blocks[last]), esp_err_to_name(err));
+            result = result == ESP_OK ? err : result;
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.requests++;
+        }
+        first = last + 1;
+    }
+    return result;
+}
+
+void MqttFileDownloader::complete(esp_err_t result)
+{
+    if (result == ESP_OK)
+    {
+        digest_ = hash_.finish();
+        if (config_.sha256.has_value() && *config_.sha256 != digest_)
+        {
+            LOPCORE_LOGE(TAG, "SHA-256 of stream %s does not match", config_.streamId.c_str());
+            result = ESP_ERR_INVALID_CRC;
+        }
+        else
+        {
+            result = sink_.finish();
+        }
+    }
+    if (result != ESP_OK)
+    {
+        sink_.abort();
+    }
+
+    result_ = result;
+    state_ = result == ESP_OK ? FileDownloadState::COMPLETE : FileDownloadState::FAILED;
+    reorder_.clear();
+    reorder_.shrink_to_fit();
+    LOPCORE_LOGI(TAG, "Stream %s %s after %zu bytes, %u requests", config_.streamId.c_str(),
+                 result == ESP_OK ? "complete" : "failed", bytesWritten_, static_cast<unsigned>(stats_.requests));
+}
+
+void MqttFileDownloader::unsubscribe()
+{
+    if (subscribed_)
+    {
+        client_->unsubscribe(topicPrefix_ + "data/cbor");
+        client_->unsubscribe(topicPrefix_ + "rejected/cbor");
+        subscribed_ = false;
+    }
+}
+
+} // namespace mqtt
+} // namespace lopcore
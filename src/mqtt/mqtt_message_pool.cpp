@@ -0,0 +1,67 @@
+/**
+ * @file mqtt_message_pool.cpp
+ * @brief Fixed pool of buffers for reassembling fragmented inbound messages
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/mqtt/mqtt_message_pool.hpp"
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+MqttMessagePool::MqttMessagePool(size_t blocks, size_t blockSize)
+    : blocks_(blocks), blockSize_(blockSize), storage_(new uint8_t[blocks * blockSize]),
+      used_(new std::atomic<bool>[blocks])
+{
+    for (size_t i = 0; i < blocks_; i++)
+    {
+        used_[i].store(false, std::memory_order_relaxed);
+    }
+}
+
+uint8_t *MqttMessagePool::acquire()
+{
+    for (size_t i = 0; i < blocks_; i++)
+    {
+        bool expected = false;
+        if (!used_[i].load(std::memory_order_relaxed) &&
+            used_[i].compare_exchange_strong(expected, true, std::memory_order_acquire))
+        {
+            return storage_.get() + i * blockSize_;
+        }
+    }
+    return nullptr;
+}
+
+void MqttMessagePool::release(uint8_t *block)
+{
+    if (block == nullptr)
+    {
+        return;
+    }
+    size_t index = static_cast<size_t>(block - storage_.get()) / blockSize_;
+    if (index < blocks_)
+    {
+        used_[index].store(false, std::memory_order_release);
+    }
+}
+
+size_t MqttMessagePool::available() const
+{
+    size_t count = 0;
+    for (size_t i = 0; i < blocks_; i++)
+    {
+        if (!used_[i].load(std::memory_order_relaxed))
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+} // namespace mqtt
+} // namespace lopcore
@@ -0,0 +1,271 @@
+/**
+ * @file mqtt_metrics.cpp
+ * @brief Lock-free MQTT client counters and latency histograms
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/mqtt/mqtt_metrics.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+namespace
+{
+
+size_t bucketOf(uint32_t us)
+{
+    size_t bucket = 0;
+    while (us != 0 && bucket < MQTT_HISTOGRAM_BUCKETS - 1)
+    {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+size_t currentCore()
+{
+#ifdef ESP_PLATFORM
+    return static_cast<size_t>(xPortGetCoreID()) % MqttMetrics::MAX_CORES;
+#else
+    return 0;
+#endif
+}
+
+int formatHistogram(char *buffer, size_t size, const char *name, const MqttHistogramSnapshot &histogram)
+{
+    return snprintf(buffer, size, ",\"%s\":{\"n\":%" PRIu32 ",\"p50\":%" PRIu32 ",\"p90\":%" PRIu32
+                    ",\"p99\":%" PRIu32 ",\"max\":%" PRIu32 "}",
+                    name, histogram.count, histogram.percentileUs(50), histogram.percentileUs(90),
+                    histogram.percentileUs(99), histogram.maxUs);
+}
+
+} // namespace
+
+// =============================================================================
+// Histograms
+// =============================================================================
+
+uint32_t MqttHistogramSnapshot::percentileUs(uint32_t percent) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    uint64_t rank = (static_cast<uint64_t>(count) * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < MQTT_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += buckets[i];
+        if (seen >= rank && i < MQTT_HISTOGRAM_BUCKETS - 1)
+        {
+            uint32_t upper = (1u << i) - 1;
+            return upper < maxUs ? upper : maxUs;
+        }
+    }
+    return maxUs;
+}
+
+void MqttLatencyHistogram::record(uint32_t us)
+{
+    buckets_[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sumUs_.fetch_add(us, std::memory_order_relaxed);
+
+    uint32_t max = maxUs_.load(std::memory_order_relaxed);
+    while (us > max && !maxUs_.compare_exchange_weak(max, us, std::memory_order_relaxed))
+    {
+    }
+}
+
+MqttHistogramSnapshot MqttLatencyHistogram::snapshot() const
+{
+    MqttHistogramSnapshot snapshot;
+    for (size_t i = 0; i < MQTT_HISTOGRAM_BUCKETS; i++)
+    {
+        snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count = count_.load(std::memory_order_relaxed);
+    snapshot.sumUs = sumUs_.load(std::memory_order_relaxed);
+    snapshot.maxUs = maxUs_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+void MqttLatencyHistogram::reset()
+{
+    for (std::atomic<uint32_t> &bucket : buckets_)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sumUs_.store(0, std::memory_order_relaxed);
+    maxUs_.store(0, std::memory_order_relaxed);
+}
+
+// =============================================================================
+// Client Metrics
+// =============================================================================
+
+void MqttMetrics::increment(MqttCounter counter, uint32_t amount)
+{
+    cores_[currentCore()].values[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+uint64_t MqttMetrics::total(MqttCounter counter) const
+{
+    uint64_t sum = 0;
+    for (const CoreCounters &core : cores_)
+    {
+        sum += core.values[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+void MqttMetrics::publishSent(uint16_t packetId, int64_t nowUs)
+{
+    if (packetId == 0)
+    {
+        return;
+    }
+    AckSlot &slot = ackSlots_[packetId & (ACK_SLOTS - 1)];
+    slot.sentUs.store(static_cast<uint32_t>(nowUs), std::memory_order_relaxed);
+    slot.packetId.store(packetId, std::memory_order_release);
+}
+
+void MqttMetrics::publishAcked(uint16_t packetId, int64_t nowUs)
+{
+    if (packetId == 0)
+    {
+        return;
+    }
+    AckSlot &slot = ackSlots_[packetId & (ACK_SLOTS - 1)];
+    uint16_t expected = packetId;
+    if (slot.packetId.load(std::memory_order_acquire) != packetId)
+    {
+        return;
+    }
+    uint32_t sentUs = slot.sentUs.load(std::memory_order_relaxed);
+    if (slot.packetId.compare_exchange_strong(expected, 0, std::memory_order_relaxed))
+    {
+        publishAckLatency_.record(static_cast<uint32_t>(nowUs) - sentUs);
+    }
+}
+
+MqttMetricsSnapshot MqttMetrics::snapshot() const
+{
+    MqttMetricsSnapshot snapshot;
+    snapshot.messagesPublished = total(MqttCounter::MESSAGES_PUBLISHED);
+    snapshot.messagesReceived = total(MqttCounter::MESSAGES_RECEIVED);
+    snapshot.publishErrors = total(MqttCounter::PUBLISH_ERRORS);
+    snapshot.messagesDropped = total(MqttCounter::MESSAGES_DROPPED);
+    snapshot.reconnectCount = total(MqttCounter::RECONNECTS);
+    snapshot.publishAckLatency = publishAckLatency_.snapshot();
+    snapshot.callbackDuration = callbackDuration_.snapshot();
+    snapshot.processLoopDuration = processLoopDuration_.snapshot();
+    return snapshot;
+}
+
+void MqttMetrics::reset()
+{
+    for (CoreCounters &core : cores_)
+    {
+        for (std::atomic<uint32_t> &value : core.values)
+        {
+            value.store(0, std::memory_order_relaxed);
+        }
+    }
+    for (AckSlot &slot : ackSlots_)
+    {
+        slot.packetId.store(0, std::memory_order_relaxed);
+    }
+    publishAckLatency_.reset();
+    callbackDuration_.reset();
+    processLoopDuration_.reset();
+}
+
+void MqttMetrics::registerMetrics(metrics::MetricsRegistry &registry, std::string_view prefix)
+{
+    static const struct
+    {
+        const char *suffix;
+        MqttCounter counter;
+    } COUNTERS_BY_NAME[] = {
+        {".published", MqttCounter::MESSAGES_PUBLISHED}, {".received", MqttCounter::MESSAGES_RECEIVED},
+        {".publish_errors", MqttCounter::PUBLISH_ERRORS}, {".dropped", MqttCounter::MESSAGES_DROPPED},
+        {".reconnects", MqttCounter::RECONNECTS},
+    };
+
+    std::string name(prefix);
+    for (const auto &entry : COUNTERS_BY_NAME)
+    {
+        name.resize(prefix.size());
+        MqttCounter counter = entry.counter;
+        registrations_.push_back(
+            registry.sampledCounter(name.append(entry.suffix), [this, counter] { return total(counter); }));
+    }
+
+    name.resize(prefix.size());
+    registrations_.push_back(registry.sampledGauge(
+        name.append(".ack_p99_us"), [this] { return publishAckLatency_.snapshot().percentileUs(99); }));
+    name.resize(prefix.size());
+    registrations_.push_back(registry.sampledGauge(
+        name.append(".callback_p99_us"), [this] { return callbackDuration_.snapshot().percentileUs(99); }));
+}
+
+size_t MqttMetricsSnapshot::formatJson(char *buffer, size_t size) const
+{
+    if (buffer == nullptr || size == 0)
+    {
+        return 0;
+    }
+
+    const struct
+    {
+        const char *name;
+        const MqttHistogramSnapshot &histogram;
+    } histograms[] = {{"ack", publishAckLatency}, {"cb", callbackDuration}, {"loop", processLoopDuration}};
+
+    int written =
+        snprintf(buffer, size,
+                 "{\"pub\":%" PRIu64 ",\"rx\":%" PRIu64 ",\"err\":%" PRIu64 ",\"drop\":%" PRIu64
+                 ",\"reconn\":%" PRIu64,
+                 messagesPublished, messagesReceived, publishErrors, messagesDropped, reconnectCount);
+    size_t used = 0;
+    for (const auto &entry : histograms)
+    {
+        if (written < 0 || static_cast<size_t>(written) >= size - used)
+        {
+            break;
+        }
+        used += static_cast<size_t>(written);
+        written = formatHistogram(buffer + used, size - used, entry.name, entry.histogram);
+    }
+    if (written >= 0 && static_cast<size_t>(written) < size - used)
+    {
+        used += static_cast<size_t>(written);
+        written = snprintf(buffer + used, size - used, "}");
+        if (written > 0 && static_cast<size_t>(written) < size - used)
+        {
+            return used + static_cast<size_t>(written);
+        }
+    }
+
+    buffer[0] = '\0';
+    return 0;
+}
+
+} // namespace mqtt
+} // namespace lopcore
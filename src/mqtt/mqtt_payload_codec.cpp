@@ -0,0 +1,87 @@
+/**
+ * @file mqtt_payload_codec.cpp
+ * @brief In-memory LZ compression for MQTT payloads
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/mqtt/mqtt_payload_codec.hpp"
+
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+namespace
+{
+
+constexpr size_t MAX_VARINT_BYTES = 5;
+
+} // namespace
+
+bool MqttPayloadCodec::compress(const uint8_t *data, size_t length, std::vector<uint8_t> &out)
+{
+    out.clear();
+    for (size_t value = length;;)
+    {
+        uint8_t byte = static_cast<uint8_t>(value & 0x7F);
+        value >>= 7;
+        out.push_back(value != 0 ? (byte | 0x80) : byte);
+        if (value == 0)
+        {
+            break;
+        }
+    }
+
+    // Give up as soon as the output can no longer be smaller
+    encoder_.reset();
+    if (encoder_.encode(data, 0, length, 1, out, length) < length)
+    {
+        return false;
+    }
+    encoder_.finish(out);
+    return out.size() < length;
+}
+
+bool MqttPayloadCodec::decompress(const uint8_t *data,
+                                  size_t length,
+                                  size_t maxLength,
+                                  std::vector<uint8_t> &out)
+{
+    out.clear();
+
+    size_t pos = 0;
+    uint64_t expected = 0;
+    for (size_t i = 0;; i++)
+    {
+        if (pos >= length || i == MAX_VARINT_BYTES)
+        {
+            return false;
+        }
+        uint8_t byte = data[pos++];
+        expected |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+        if ((byte & 0x80) == 0)
+        {
+            break;
+        }
+    }
+    if (expected > maxLength)
+    {
+        return false;
+    }
+    out.resize(static_cast<size_t>(expected));
+
+    lzss::Decoder decoder;
+    lzss::Decoder::Status status;
+    auto next = [data, length, &pos]() -> int { return pos < length ? data[pos++] : -1; };
+    size_t produced = decoder.decode(next, out.data(), out.size(), status);
+
+    // The last match must end exactly at the expected size, with no input left over
+    return status == lzss::Decoder::Status::OK && produced == out.size() && decoder.atTokenBoundary() &&
+           pos == length;
+}
+
+} // namespace mqtt
+} // namespace lopcore
@@ -0,0 +1,146 @@
+/**
+ * @file mqtt_retransmit_store.cpp
+ * @brief Fixed-slot store of unacknowledged QoS 1/2 publishes
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/mqtt/mqtt_retransmit_store.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+MqttRetransmitStore::MqttRetransmitStore(size_t slotCount, size_t slotSize)
+    : slots_(slotCount), arena_(slotCount * slotSize), slotSize_(slotSize), used_(0), nextSequence_(0)
+{
+}
+
+esp_err_t MqttRetransmitStore::store(uint16_t packetId,
+                                     std::string_view topic,
+                                     const uint8_t *payload,
+                                     size_t payloadLength,
+                                     MqttQos qos,
+                                     bool retain)
+{
+    if (packetId == 0 || qos == MqttQos::AT_MOST_ONCE)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (topic.size() > UINT16_MAX || payloadLength > slotSize_ || topic.size() > slotSize_ - payloadLength)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Reuse the slot of a stale entry with the same ID, else the first free one
+    auto it = std::find_if(slots_.begin(), slots_.end(), [packetId](const Slot &slot) {
+        return slot.packetId == packetId;
+    });
+    if (it == slots_.end())
+    {
+        it = std::find_if(slots_.begin(), slots_.end(), [](const Slot &slot) { return slot.packetId == 0; });
+        if (it == slots_.end())
+        {
+            return ESP_ERR_NO_MEM;
+        }
+        used_++;
+    }
+
+    size_t index = static_cast<size_t>(it - slots_.begin());
+    uint8_t *data = arena_.data() + index * slotSize_;
+    memcpy(data, topic.data(), topic.size());
+    if (payloadLength > 0)
+    {
+        memcpy(data + topic.size(), payload, payloadLength);
+    }
+
+    it->packetId = packetId;
+    it->qos = qos;
+    it->retain = retain;
+    it->topicLength = static_cast<uint16_t>(topic.size());
+    it->payloadLength = static_cast<uint32_t>(payloadLength);
+    it->sequence = nextSequence_++;
+    return ESP_OK;
+}
+
+bool MqttRetransmitStore::find(uint16_t packetId, Entry *entry) const
+{
+    if (packetId == 0)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < slots_.size(); i++)
+    {
+        if (slots_[i].packetId == packetId)
+        {
+            fill(slots_[i], i, entry);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MqttRetransmitStore::release(uint16_t packetId)
+{
+    if (packetId == 0)
+    {
+        return false;
+    }
+    for (Slot &slot : slots_)
+    {
+        if (slot.packetId == packetId)
+        {
+            slot.packetId = 0;
+            used_--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void MqttRetransmitStore::clear()
+{
+    for (Slot &slot : slots_)
+    {
+        slot.packetId = 0;
+    }
+    used_ = 0;
+}
+
+void MqttRetransmitStore::fill(const Slot &slot, size_t index, Entry *entry) const
+{
+    const uint8_t *data = arena_.data() + index * slotSize_;
+    entry->packetId = slot.packetId;
+    entry->qos = slot.qos;
+    entry->retain = slot.retain;
+    entry->topic = std::string_view(reinterpret_cast<const char *>(data), slot.topicLength);
+    entry->payload = data + slot.topicLength;
+    entry->payloadLength = slot.payloadLength;
+}
+
+std::vector<size_t> MqttRetransmitStore::slotsByAge() const
+{
+    std::vector<size_t> order;
+    order.reserve(used_);
+    for (size_t i = 0; i < slots_.size(); i++)
+    {
+        if (slots_[i].packetId != 0)
+        {
+            order.push_back(i);
+        }
+    }
+
+    // Compare ages rather than sequences so wraparound keeps the order
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return nextSequence_ - slots_[a].sequence > nextSequence_ - slots_[b].sequence;
+    });
+    return order;
+}
+
+} // namespace mqtt
+} // namespace lopcore
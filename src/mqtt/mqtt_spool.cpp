@@ -0,0 +1,538 @@
+/**
+ * @file mqtt_spool.cpp
+ * @brief Store-and-forward spool implementation
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/mqtt/mqtt_spool.hpp"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "lopcore/logging/logger.hpp"
+
+static const char *TAG = "mqtt_spool";
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+static constexpr uint8_t RECORD_MAGIC_0 = 'S';
+static constexpr uint8_t RECORD_MAGIC_1 = 'P';
+static constexpr uint8_t FLAG_QOS_MASK = 0x03;
+static constexpr uint8_t FLAG_RETAIN = 0x04;
+static constexpr const char *SEGMENT_SUFFIX = ".seg";
+static constexpr size_t SEGMENT_NAME_LENGTH = 12; // 8 hex digits + ".seg"
+
+// =============================================================================
+// Encoding Helpers
+// =============================================================================
+
+/**
+ * @brief CRC-32 (IEEE 802.3, reflected) with a nibble table
+ */
+static uint32_t crc32Update(uint32_t crc, const void *data, size_t length)
+{
+    static const uint32_t table[16] = {0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+                                       0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+                                       0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= bytes[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return crc;
+}
+
+static void putLe16(uint8_t *out, uint16_t value)
+{
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static void putLe32(uint8_t *out, uint32_t value)
+{
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+    out[2] = static_cast<uint8_t>(value >> 16);
+    out[3] = static_cast<uint8_t>(value >> 24);
+}
+
+static uint16_t getLe16(const uint8_t *in)
+{
+    return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+static uint32_t getLe32(const uint8_t *in)
+{
+    return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8) |
+           (static_cast<uint32_t>(in[2]) << 16) | (static_cast<uint32_t>(in[3]) << 24);
+}
+
+// =============================================================================
+// Construction & Destruction
+// =============================================================================
+
+MqttSpool::MqttSpool(const SpoolConfig &config)
+    : config_(config), open_(false), nextId_(0), writeFile_(nullptr), readFile_(nullptr), readOffset_(0),
+      pendingRecords_(0)
+{
+}
+
+MqttSpool::~MqttSpool()
+{
+    close();
+}
+
+std::string MqttSpool::segmentPath(uint32_t id) const
+{
+    char name[SEGMENT_NAME_LENGTH + 1];
+    snprintf(name, sizeof(name), "%08lx%s", static_cast<unsigned long>(id), SEGMENT_SUFFIX);
+    return config_.directory + "/" + name;
+}
+
+std::string MqttSpool::cursorPath() const
+{
+    return config_.directory + "/cursor";
+}
+
+// =============================================================================
+// Recovery
+// =============================================================================
+
+esp_err_t MqttSpool::open()
+{
+    if (open_)
+    {
+        return ESP_OK;
+    }
+
+    if (mkdir(config_.directory.c_str(), 0775) != 0 && errno != EEXIST)
+    {
+        LOPCORE_LOGE(TAG, "Cannot create spool directory '%s': errno %d", config_.directory.c_str(), errno);
+        return ESP_FAIL;
+    }
+
+    DIR *dir = opendir(config_.directory.c_str());
+    if (dir == nullptr)
+    {
+        LOPCORE_LOGE(TAG, "Cannot open spool directory '%s'", config_.directory.c_str());
+        return ESP_FAIL;
+    }
+
+    std::vector<uint32_t> ids;
+    while (struct dirent *entry = readdir(dir))
+    {
+        const char *name = entry->d_name;
+        if (strlen(name) != SEGMENT_NAME_LENGTH || strcmp(name + 8, SEGMENT_SUFFIX) != 0)
+        {
+            continue;
+        }
+        char *end = nullptr;
+        unsigned long id = strtoul(name, &end, 16);
+        if (end == name + 8)
+        {
+            ids.push_back(static_cast<uint32_t>(id));
+        }
+    }
+    closedir(dir);
+    std::sort(ids.begin(), ids.end());
+
+    uint32_t cursorId = 0;
+    uint32_t cursorOffset = 0;
+    bool haveCursor = loadCursor(&cursorId, &cursorOffset);
+
+    segments_.clear();
+    pendingRecords_ = 0;
+    readOffset_ = 0;
+    // Never reuse a number the cursor may still refer to
+    nextId_ = ids.empty() ? 0 : ids.back() + 1;
+    if (haveCursor && cursorId >= nextId_)
+    {
+        nextId_ = cursorId + 1;
+    }
+
+    for (uint32_t id : ids)
+    {
+        // Segments before the cursor were replayed but not yet deleted
+        if (haveCursor && id < cursorId)
+        {
+            ::remove(segmentPath(id).c_str());
+            continue;
+        }
+
+        size_t offset = (haveCursor && id == cursorId && segments_.empty()) ? cursorOffset : 0;
+        size_t fileSize = 0;
+        size_t records = countRecords(id, offset, &fileSize);
+        if (records == 0)
+        {
+            ::remove(segmentPath(id).c_str());
+            continue;
+        }
+
+        if (segments_.empty())
+        {
+            readOffset_ = offset;
+        }
+        segments_.push_back(Segment{id, records, fileSize});
+        pendingRecords_ += records;
+    }
+
+    esp_err_t err = startSegment();
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    open_ = true;
+    LOPCORE_LOGI(TAG, "Spool open: %zu records pending in %zu segments", pendingRecords_,
+                 segments_.size() - 1);
+    return ESP_OK;
+}
+
+void MqttSpool::close()
+{
+    if (writeFile_ != nullptr)
+    {
+        fclose(writeFile_);
+        writeFile_ = nullptr;
+    }
+    if (readFile_ != nullptr)
+    {
+        fclose(readFile_);
+        readFile_ = nullptr;
+    }
+    open_ = false;
+}
+
+size_t MqttSpool::countRecords(uint32_t id, size_t offset, size_t *fileSize)
+{
+    FILE *file = fopen(segmentPath(id).c_str(), "rb");
+    if (file == nullptr)
+    {
+        *fileSize = 0;
+        return 0;
+    }
+
+    fseek(file, 0, SEEK_END);
+    *fileSize = static_cast<size_t>(ftell(file));
+    fseek(file, static_cast<long>(offset), SEEK_SET);
+
+    size_t records = 0;
+    size_t position = offset;
+    MqttMessageView view;
+    size_t recordSize = 0;
+    while (position < *fileSize && readRecord(file, &view, &recordSize))
+    {
+        records++;
+        position += recordSize;
+    }
+    fclose(file);
+
+    if (position < *fileSize)
+    {
+        // Torn or damaged tail: replay stops before it
+        LOPCORE_LOGW(TAG, "Segment %08lx: %zu bytes after record %zu are unreadable",
+                     static_cast<unsigned long>(id), *fileSize - position, records);
+        stats_.recordsCorrupt++;
+    }
+    return records;
+}
+
+bool MqttSpool::loadCursor(uint32_t *id, uint32_t *offset)
+{
+    FILE *file = fopen(cursorPath().c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    uint8_t data[12];
+    bool valid = fread(data, 1, sizeof(data), file) == sizeof(data) &&
+                 getLe32(data + 8) == crc32Update(0, data, 8);
+    fclose(file);
+
+    if (valid)
+    {
+        *id = getLe32(data);
+        *offset = getLe32(data + 4);
+    }
+    return valid;
+}
+
+void MqttSpool::saveCursor()
+{
+    if (segments_.empty())
+    {
+        return;
+    }
+
+    uint8_t data[12];
+    putLe32(data, segments_.front().id);
+    putLe32(data + 4, static_cast<uint32_t>(readOffset_));
+    putLe32(data + 8, crc32Update(0, data, 8));
+
+    FILE *file = fopen(cursorPath().c_str(), "wb");
+    if (file == nullptr)
+    {
+        LOPCORE_LOGW(TAG, "Cannot save spool cursor");
+        return;
+    }
+    fwrite(data, 1, sizeof(data), file);
+    fclose(file);
+}
+
+// =============================================================================
+// Segments
+// =============================================================================
+
+esp_err_t MqttSpool::startSegment()
+{
+    if (writeFile_ != nullptr)
+    {
+        fclose(writeFile_);
+        writeFile_ = nullptr;
+    }
+
+    uint32_t id = nextId_++;
+    writeFile_ = fopen(segmentPath(id).c_str(), "wb");
+    if (writeFile_ == nullptr)
+    {
+        LOPCORE_LOGE(TAG, "Cannot create segment %08lx", static_cast<unsigned long>(id));
+        return ESP_FAIL;
+    }
+
+    segments_.push_back(Segment{id, 0, 0});
+    return ESP_OK;
+}
+
+void MqttSpool::dropOldestSegment()
+{
+    Segment &oldest = segments_.front();
+    LOPCORE_LOGW(TAG, "Spool full: dropping %zu records", oldest.records);
+    stats_.recordsDropped += static_cast<uint32_t>(oldest.records);
+    pendingRecords_ -= oldest.records;
+    finishReadSegment();
+}
+
+void MqttSpool::finishReadSegment()
+{
+    if (readFile_ != nullptr)
+    {
+        fclose(readFile_);
+        readFile_ = nullptr;
+    }
+    ::remove(segmentPath(segments_.front().id).c_str());
+    segments_.pop_front();
+    readOffset_ = 0;
+}
+
+// =============================================================================
+// Records
+// =============================================================================
+
+esp_err_t MqttSpool::append(std::string_view topic,
+                            const MqttPayloadSegment *segments,
+                            size_t segmentCount,
+                            MqttQos qos,
+                            bool retain)
+{
+    if (!open_)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t payloadLength = 0;
+    for (size_t i = 0; i < segmentCount; i++)
+    {
+        payloadLength += segments[i].size;
+    }
+
+    size_t recordSize = RECORD_HEADER_SIZE + topic.size() + payloadLength;
+    if (topic.empty() || topic.size() > UINT16_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (recordSize > config_.segmentSize)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (segments_.back().size + recordSize > config_.segmentSize)
+    {
+        esp_err_t err = startSegment();
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+        while (segments_.size() > config_.maxSegments)
+        {
+            dropOldestSegment();
+        }
+    }
+
+    uint8_t header[RECORD_HEADER_SIZE];
+    header[0] = RECORD_MAGIC_0;
+    header[1] = RECORD_MAGIC_1;
+    header[2] = static_cast<uint8_t>((qosToInt(qos) & FLAG_QOS_MASK) | (retain ? FLAG_RETAIN : 0));
+    header[3] = 0;
+    putLe16(header + 4, static_cast<uint16_t>(topic.size()));
+    putLe32(header + 6, static_cast<uint32_t>(payloadLength));
+
+    uint32_t crc = crc32Update(0, header + 2, 8);
+    crc = crc32Update(crc, topic.data(), topic.size());
+    for (size_t i = 0; i < segmentCount; i++)
+    {
+        crc = crc32Update(crc, segments[i].data, segments[i].size);
+    }
+    putLe32(header + 10, crc);
+
+    bool ok = fwrite(header, 1, sizeof(header), writeFile_) == sizeof(header) &&
+              fwrite(topic.data(), 1, topic.size(), writeFile_) == topic.size();
+    for (size_t i = 0; ok && i < segmentCount; i++)
+    {
+        const MqttPayloadSegment &segment = segments[i];
+        ok = segment.size == 0 || fwrite(segment.data, 1, segment.size, writeFile_) == segment.size;
+    }
+    ok = ok && fflush(writeFile_) == 0 && fsync(fileno(writeFile_)) == 0;
+
+    if (!ok)
+    {
+        // Never append after a partial record: it would hide everything behind it
+        LOPCORE_LOGE(TAG, "Spool write failed: errno %d", errno);
+        startSegment();
+        return ESP_FAIL;
+    }
+
+    Segment &segment = segments_.back();
+    segment.records++;
+    segment.size += recordSize;
+    pendingRecords_++;
+    stats_.recordsSpooled++;
+    return ESP_OK;
+}
+
+bool MqttSpool::readRecord(FILE *file, MqttMessageView *view, size_t *recordSize)
+{
+    uint8_t header[RECORD_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) || header[0] != RECORD_MAGIC_0 ||
+        header[1] != RECORD_MAGIC_1)
+    {
+        return false;
+    }
+
+    size_t topicLength = getLe16(header + 4);
+    size_t payloadLength = getLe32(header + 6);
+    if (topicLength == 0 || RECORD_HEADER_SIZE + topicLength + payloadLength > config_.segmentSize)
+    {
+        return false;
+    }
+
+    readBuffer_.resize(topicLength + payloadLength);
+    if (fread(readBuffer_.data(), 1, readBuffer_.size(), file) != readBuffer_.size())
+    {
+        return false;
+    }
+
+    uint32_t crc = crc32Update(crc32Update(0, header + 2, 8), readBuffer_.data(), readBuffer_.size());
+    if (crc != getLe32(header + 10))
+    {
+        return false;
+    }
+
+    view->topic = std::string_view(reinterpret_cast<const char *>(readBuffer_.data()), topicLength);
+    view->payload = readBuffer_.data() + topicLength;
+    view->payloadLength = payloadLength;
+    view->qos = intToQos(header[2] & FLAG_QOS_MASK);
+    view->retained = (header[2] & FLAG_RETAIN) != 0;
+    view->messageId = 0;
+    *recordSize = RECORD_HEADER_SIZE + topicLength + payloadLength;
+    return true;
+}
+
+size_t MqttSpool::drain(size_t maxRecords, const SendFunction &send)
+{
+    if (!open_)
+    {
+        return 0;
+    }
+
+    size_t consumed = 0;
+    while (consumed < maxRecords && pendingRecords_ > 0)
+    {
+        Segment &segment = segments_.front();
+        if (segment.records == 0)
+        {
+            finishReadSegment(); // Only the write segment can be empty, and it has records here
+            continue;
+        }
+
+        if (readFile_ == nullptr)
+        {
+            readFile_ = fopen(segmentPath(segment.id).c_str(), "rb");
+        }
+
+        MqttMessageView view;
+        size_t recordSize = 0;
+        if (readFile_ == nullptr || fseek(readFile_, static_cast<long>(readOffset_), SEEK_SET) != 0 ||
+            !readRecord(readFile_, &view, &recordSize))
+        {
+            LOPCORE_LOGE(TAG, "Segment %08lx unreadable: skipping %zu records",
+                         static_cast<unsigned long>(segment.id), segment.records);
+            stats_.recordsCorrupt += static_cast<uint32_t>(segment.records);
+            pendingRecords_ -= segment.records;
+            segment.records = 0;
+            if (segments_.size() == 1 && startSegment() != ESP_OK)
+            {
+                break;
+            }
+            finishReadSegment();
+            continue;
+        }
+
+        if (send(view) != ESP_OK)
+        {
+            break;
+        }
+
+        readOffset_ += recordSize;
+        segment.records--;
+        pendingRecords_--;
+        consumed++;
+        stats_.recordsDrained++;
+
+        if (segment.records == 0 && segments_.size() > 1)
+        {
+            finishReadSegment();
+        }
+    }
+
+    // Fully replayed write segment: start over in a fresh file
+    if (pendingRecords_ == 0 && segments_.size() == 1 && segments_.front().size > 0)
+    {
+        if (startSegment() == ESP_OK)
+        {
+            finishReadSegment();
+        }
+    }
+
+    if (consumed > 0)
+    {
+        saveCursor();
+    }
+    return consumed;
+}
+
+} // namespace mqtt
+} // namespace lopcore
@@ -0,0 +1,79 @@
+/**
+ * @file mqtt_topic_table.cpp
+ * @brief Interned publish topics addressed by TopicHandle
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/mqtt/mqtt_topic_table.hpp"
+
+#include <algorithm>
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+MqttTopicTable::MqttTopicTable(size_t capacity)
+    : capacity_(std::min<size_t>(capacity, UINT16_MAX)), entries_(new Entry[capacity_]), count_(0)
+{
+}
+
+TopicHandle MqttTopicTable::intern(std::string_view topic)
+{
+    if (topic.empty() || topic.size() > UINT16_MAX || topic.find_first_of("+#") != std::string_view::npos)
+    {
+        return TopicHandle{};
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = count_.load(std::memory_order_relaxed);
+
+    // Registration is rare and tables are small; a scan keeps lookup() a plain index
+    for (size_t i = 0; i < count; i++)
+    {
+        if (entries_[i].topic == topic)
+        {
+            return TopicHandle{static_cast<uint16_t>(i + 1)};
+        }
+    }
+
+    if (count == capacity_)
+    {
+        return TopicHandle{};
+    }
+
+    entries_[count].topic.assign(topic.data(), topic.size());
+    count_.store(count + 1, std::memory_order_release);
+    return TopicHandle{static_cast<uint16_t>(count + 1)};
+}
+
+uint16_t MqttTopicTable::aliasOf(TopicHandle handle) const
+{
+    if (lookup(handle) == nullptr)
+    {
+        return 0;
+    }
+    return entries_[handle.id - 1].alias.load(std::memory_order_relaxed);
+}
+
+void MqttTopicTable::setAlias(TopicHandle handle, uint16_t alias)
+{
+    if (lookup(handle) != nullptr)
+    {
+        entries_[handle.id - 1].alias.store(alias, std::memory_order_relaxed);
+    }
+}
+
+void MqttTopicTable::clearAliases()
+{
+    size_t count = count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; i++)
+    {
+        entries_[i].alias.store(0, std::memory_order_relaxed);
+    }
+}
+
+} // namespace mqtt
+} // namespace lopcore
@@ -0,0 +1,727 @@
+/**
+ * @file shadow_client.cpp
+ * @brief AWS IoT Device Shadow client that reports only what changed
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/mqtt/shadow_client.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#include "lopcore/logging/logger.hpp"
+
+static const char *TAG = "ShadowClient";
+
+static const std::string UPDATE_PREFIX = "{\"state\":{\"reported\":";
+static const std::string UPDATE_SUFFIX = "}}";
+
+namespace lopcore
+{
+namespace mqtt
+{
+
+// =============================================================================
+// JSON
+// =============================================================================
+
+namespace shadow_json
+{
+
+namespace
+{
+
+/**
+ * @brief Recursive descent over one JSON value, building dotted paths in a stack buffer
+ */
+class LeafWalker
+{
+public:
+    LeafWalker(std::string_view json, const LeafCallback &fn) : json_(json), fn_(fn)
+    {
+    }
+
+    bool walk()
+    {
+        if (!value(0))
+        {
+            return false;
+        }
+        skipSpace();
+        return pos_ == json_.size();
+    }
+
+private:
+    void skipSpace()
+    {
+        while (pos_ < json_.size() &&
+               (json_[pos_] == ' ' || json_[pos_] == '\t' || json_[pos_] == '\n' || json_[pos_] == '\r'))
+        {
+            pos_++;
+        }
+    }
+
+    bool at(char c)
+    {
+        skipSpace();
+        return pos_ < json_.size() && json_[pos_] == c;
+    }
+
+    /**
+     * @brief Move past the string starting at pos_
+     */
+    bool skipString()
+    {
+        for (pos_++; pos_ < json_.size(); pos_++)
+        {
+            if (json_[pos_] == '\\')
+            {
+                pos_++;
+            }
+            else if (json_[pos_] == '"')
+            {
+                pos_++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Move past the array starting at pos_, strings and nesting included
+     */
+    bool skipArray()
+    {
+        size_t depth = 0;
+        while (pos_ < json_.size())
+        {
+            char c = json_[pos_];
+            if (c == '"')
+            {
+                if (!skipString())
+                {
+                    return false;
+                }
+                continue;
+            }
+            pos_++;
+            if (c == '[' || c == '{')
+            {
+                depth++;
+            }
+            else if ((c == ']' || c == '}') && --depth == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool skipLiteral()
+    {
+        size_t start = pos_;
+        while (pos_ < json_.size() && std::string_view("-+.0123456789eEtrufalsn").find(json_[pos_]) !=
+                                          std::string_view::npos)
+        {
+            pos_++;
+        }
+        std::string_view literal = json_.substr(start, pos_ - start);
+        return literal == "true" || literal == "false" || literal == "null" ||
+               (!literal.empty() && literal.find_first_not_of("-+.0123456789eE") == std::string_view::npos);
+    }
+
+    bool value(size_t depth)
+    {
+        if (at('{'))
+        {
+            return object(depth);
+        }
+        if (pos_ >= json_.size())
+        {
+            return false;
+        }
+
+        size_t start = pos_;
+        bool ok = json_[pos_] == '[' ? skipArray() : json_[pos_] == '"' ? skipString() : skipLiteral();
+        if (ok)
+        {
+            fn_(std::string_view(path_, pathLength_), json_.substr(start, pos_ - start));
+        }
+        return ok;
+    }
+
+    bool object(size_t depth)
+    {
+        if (depth >= MAX_DEPTH)
+        {
+            return false;
+        }
+        pos_++;
+        if (at('}'))
+        {
+            pos_++;
+            return true;
+        }
+
+        while (true)
+        {
+            if (!at('"'))
+            {
+                return false;
+            }
+            size_t keyStart = pos_ + 1;
+            if (!skipString())
+            {
+                return false;
+            }
+            std::string_view key = json_.substr(keyStart, pos_ - 1 - keyStart);
+            if (!at(':'))
+            {
+                return false;
+            }
+            pos_++;
+
+            size_t parentLength = pathLength_;
+            size_t separator = parentLength > 0 ? 1 : 0;
+            if (parentLength + separator + key.size() > MAX_PATH)
+            {
+                return false;
+            }
+            if (separator)
+            {
+                path_[pathLength_++] = '.';
+            }
+            key.copy(path_ + pathLength_, key.size());
+            pathLength_ += key.size();
+            bool ok = value(depth + 1);
+            pathLength_ = parentLength;
+            if (!ok)
+            {
+                return false;
+            }
+
+            if (at(','))
+            {
+                pos_++;
+            }
+            else if (at('}'))
+            {
+                pos_++;
+                return true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+    }
+
+    std::string_view json_;
+    const LeafCallback &fn_;
+    size_t pos_ = 0;
+    char path_[MAX_PATH];
+    size_t pathLength_ = 0;
+};
+
+} // namespace
+
+bool forEachLeaf(std::string_view json, const LeafCallback &fn)
+{
+    return LeafWalker(json, fn).walk();
+}
+
+std::string quote(std::string_view text)
+{
+    std::string out;
+    out.reserve(text.size() + 2);
+    out += '"';
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[7];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+            out += escaped;
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    out += '"';
+    return out;
+}
+
+} // namespace shadow_json
+
+// =============================================================================
+// Construction
+// =============================================================================
+
+ShadowClient::ShadowClient(std::shared_ptr<IMqttClient> client,
+                           const ShadowConfig &config,
+                           NvsStorage *cache,
+                           TimeSource timeSource)
+    : client_(std::move(client)),
+      config_(config),
+      cache_(cache),
+      timeSource_(timeSource),
+      topicPrefix_("$aws/things/" + config.thingName + "/shadow/" +
+                   (config.shadowName.empty() ? std::string() : "name/" + config.shadowName + "/")),
+      dueUs_(0),
+      version_(0),
+      started_(false)
+{
+}
+
+ShadowClient::~ShadowClient()
+{
+    if (started_)
+    {
+        client_->unsubscribe(topicPrefix_ + "update/delta");
+        client_->unsubscribe(topicPrefix_ + "update/rejected");
+    }
+}
+
+void ShadowClient::setDeltaCallback(DeltaCallback callback)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    deltaCallback_ = std::move(callback);
+}
+
+esp_err_t ShadowClient::start()
+{
+    if (!client_ || config_.validate() != ESP_OK)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (started_)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (cache_ != nullptr)
+    {
+        std::optional<std::string> document = cache_->read(config_.cacheKey);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (document && !shadow_json::forEachLeaf(*document, [this](std::string_view path, std::string_view value) {
+                reported_.emplace(std::string(path), std::string(value));
+            }))
+        {
+            LOPCORE_LOGW(TAG, "Cached shadow document is corrupt, starting empty");
+            reported_.clear();
+        }
+        LOPCORE_LOGI(TAG, "Restored %zu reported fields", reported_.size());
+    }
+
+    esp_err_t err = client_->subscribe(
+        topicPrefix_ + "update/delta", [this](const MqttMessage &message) { onDelta(message); }, config_.qos);
+    if (err == ESP_OK)
+    {
+        err = client_->subscribe(
+            topicPrefix_ + "update/rejected", [this](const MqttMessage &message) { onRejected(message); },
+            config_.qos);
+        if (err != ESP_OK)
+        {
+            client_->unsubscribe(topicPrefix_ + "update/delta");
+        }
+    }
+    if (err != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "Cannot subscribe to %supdate/delta: %s", topicPrefix_.c_str(), esp_err_to_name(err));
+        return err;
+    }
+    started_ = true;
+    return ESP_OK;
+}
+
+// =============================================================================
+// Reporting
+// =============================================================================
+
+esp_err_t ShadowClient::report(std::string_view path, std::string_view rawJson)
+{
+    if (path.empty() || path.front() == '.' || path.back() == '.' || path.find("..") != std::string_view::npos)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // An object value is flattened into one field per leaf
+    std::vector<std::pair<std::string, std::string>> leaves;
+    bool valid = shadow_json::forEachLeaf(rawJson, [&](std::string_view subPath, std::string_view value) {
+        std::string fullPath(path);
+        if (!subPath.empty())
+        {
+            fullPath.append(".").append(subPath);
+        }
+        leaves.emplace_back(std::move(fullPath), std::string(value));
+    });
+    if (!valid)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &leaf : leaves)
+    {
+        auto reported = reported_.find(leaf.first);
+        std::string_view shadowValue = reported != reported_.end() ? std::string_view(reported->second) : "null";
+        if (reported == reported_.end())
+        {
+            // The field may be an object; no leaf value equals it
+            auto child = reported_.lower_bound(leaf.first + '.');
+            if (child != reported_.end() && child->first.compare(0, leaf.first.size() + 1, leaf.first + '.') == 0)
+            {
+                shadowValue = "{}";
+            }
+        }
+        auto pending = pending_.find(leaf.first);
+
+        if (pending == pending_.end())
+        {
+            if (shadowValue == leaf.second)
+            {
+                stats_.fieldsUnchanged++;
+                continue;
+            }
+            if (pending_.empty())
+            {
+                dueUs_ = timeSource_() + static_cast<int64_t>(config_.coalesceMs) * 1000;
+            }
+            eraseConflicts(pending_, leaf.first);
+            pending_.emplace(std::move(leaf.first), std::move(leaf.second));
+        }
+        else if (pending->second != leaf.second)
+        {
+            stats_.fieldsCoalesced++;
+            if (shadowValue == leaf.second)
+            {
+                pending_.erase(pending); // Changed back before it was sent
+            }
+            else
+            {
+                pending->second = std::move(leaf.second);
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t ShadowClient::report(std::string_view path, bool value)
+{
+    return report(path, std::string_view(value ? "true" : "false"));
+}
+
+esp_err_t ShadowClient::report(std::string_view path, int64_t value)
+{
+    char text[24];
+    snprintf(text, sizeof(text), "%" PRId64, value);
+    return report(path, std::string_view(text));
+}
+
+esp_err_t ShadowClient::report(std::string_view path, double value)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%.10g", value);
+    return report(path, std::string_view(text));
+}
+
+esp_err_t ShadowClient::reportString(std::string_view path, std::string_view value)
+{
+    return report(path, std::string_view(shadow_json::quote(value)));
+}
+
+uint32_t ShadowClient::poll()
+{
+    int64_t nextDueUs = std::numeric_limits<int64_t>::max();
+    flushPending(false, &nextDueUs);
+    if (nextDueUs == std::numeric_limits<int64_t>::max())
+    {
+        return UINT32_MAX;
+    }
+    return static_cast<uint32_t>(std::max<int64_t>(nextDueUs - timeSource_(), 0) / 1000);
+}
+
+esp_err_t ShadowClient::flush()
+{
+    int64_t nextDueUs;
+    return flushPending(true, &nextDueUs);
+}
+
+void ShadowClient::resyncAll()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.empty())
+    {
+        dueUs_ = timeSource_() + static_cast<int64_t>(config_.coalesceMs) * 1000;
+    }
+    for (const auto &field : reported_)
+    {
+        pending_.emplace(field.first, field.second); // A newer pending value wins
+    }
+}
+
+esp_err_t ShadowClient::flushPending(bool force, int64_t *nextDueUs)
+{
+    std::lock_guard<std::mutex> flushLock(flushMutex_);
+    int64_t nowUs = timeSource_();
+
+    Fields sending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        *nextDueUs = pending_.empty() ? std::numeric_limits<int64_t>::max() : dueUs_;
+        if (pending_.empty() || (!force && nowUs < dueUs_))
+        {
+            return ESP_OK;
+        }
+        sending = pending_;
+    }
+
+    std::string payload = UPDATE_PREFIX + serialize(sending, false) + UPDATE_SUFFIX;
+    if (payload.size() > config_.maxDocumentSize)
+    {
+        LOPCORE_LOGE(TAG, "Update of %zu bytes exceeds %u, dropped", payload.size(),
+                     static_cast<unsigned>(config_.maxDocumentSize));
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &field : sending)
+        {
+            auto pending = pending_.find(field.first);
+            if (pending != pending_.end() && pending->second == field.second)
+            {
+                pending_.erase(pending);
+            }
+        }
+        *nextDueUs = pending_.empty() ? std::numeric_limits<int64_t>::max() : dueUs_;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_err_t err = client_->publishString(topicPrefix_ + "update", payload, config_.qos);
+
+    Fields reported;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (err != ESP_OK)
+        {
+            LOPCORE_LOGW(TAG, "Shadow update not sent: %s", esp_err_to_name(err));
+            dueUs_ = nowUs + static_cast<int64_t>(config_.retryMs) * 1000;
+            *nextDueUs = dueUs_;
+            return err;
+        }
+
+        for (const auto &field : sending)
+        {
+            // A value reported while this update was out stays pending
+            auto pending = pending_.find(field.first);
+            if (pending != pending_.end() && pending->second == field.second)
+            {
+                pending_.erase(pending);
+            }
+            eraseConflicts(reported_, field.first);
+            if (field.second == "null")
+            {
+                reported_.erase(field.first);
+            }
+            else
+            {
+                reported_[field.first] = field.second;
+            }
+        }
+
+        stats_.updatesPublished++;
+        stats_.fieldsReported += static_cast<uint32_t>(sending.size());
+        stats_.bytesPublished += static_cast<uint32_t>(payload.size());
+        stats_.bytesFullDocument +=
+            static_cast<uint32_t>(UPDATE_PREFIX.size() + serialize(reported_, true).size() + UPDATE_SUFFIX.size());
+        *nextDueUs = pending_.empty() ? std::numeric_limits<int64_t>::max() : dueUs_;
+        if (cache_ != nullptr)
+        {
+            reported = reported_;
+        }
+    }
+
+    if (cache_ != nullptr)
+    {
+        persist(reported);
+    }
+    return ESP_OK;
+}
+
+void ShadowClient::persist(const Fields &reported)
+{
+    std::string document = serialize(reported, true);
+    if (document.size() > config_.maxDocumentSize || !cache_->write(config_.cacheKey, document))
+    {
+        LOPCORE_LOGW(TAG, "Reported document (%zu bytes) not cached", document.size());
+    }
+}
+
+// =============================================================================
+// Queries
+// =============================================================================
+
+std::optional<std::string> ShadowClient::getReported(std::string_view path) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto pending = pending_.find(path);
+    if (pending != pending_.end())
+    {
+        return pending->second == "null" ? std::nullopt : std::optional<std::string>(pending->second);
+    }
+    auto reported = reported_.find(path);
+    return reported != reported_.end() ? std::optional<std::string>(reported->second) : std::nullopt;
+}
+
+std::string ShadowClient::getReportedDocument() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Fields document = reported_;
+    for (const auto &field : pending_)
+    {
+        eraseConflicts(document, field.first);
+        document[field.first] = field.second;
+    }
+    return serialize(document, true);
+}
+
+uint32_t ShadowClient::getVersion() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return version_;
+}
+
+size_t ShadowClient::getPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_.size();
+}
+
+ShadowStats ShadowClient::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// =============================================================================
+// Inbound
+// =============================================================================
+
+void ShadowClient::onDelta(const MqttMessage &message)
+{
+    DeltaCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        callback = deltaCallback_;
+        stats_.deltasReceived++;
+    }
+
+    // Fields are handed out straight from the payload
+    uint32_t version = 0;
+    std::string_view json(reinterpret_cast<const char *>(message.payload.data()), message.payload.size());
+    bool valid = shadow_json::forEachLeaf(json, [&](std::string_view path, std::string_view value) {
+        if (path == "version")
+        {
+            version = static_cast<uint32_t>(strtoul(std::string(value).c_str(), nullptr, 10));
+        }
+        else if (path.substr(0, 6) == "state." && callback)
+        {
+            callback(path.substr(6), value);
+        }
+    });
+    if (!valid)
+    {
+        LOPCORE_LOGW(TAG, "Malformed delta ignored");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    version_ = version;
+}
+
+void ShadowClient::onRejected(const MqttMessage &message)
+{
+    LOPCORE_LOGW(TAG, "Shadow update rejected: %.*s", static_cast<int>(message.payload.size()),
+                 reinterpret_cast<const char *>(message.payload.data()));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.rejected++;
+    }
+    // The shadow may lack anything reported since; send the whole document again
+    resyncAll();
+}
+
+// =============================================================================
+// Document helpers
+// =============================================================================
+
+std::string ShadowClient::serialize(const Fields &fields, bool skipNull)
+{
+    // Sorted paths keep every object's fields together
+    std::string out = "{";
+    std::vector<std::string_view> open;
+    bool needComma = false;
+    for (const auto &field : fields)
+    {
+        if (skipNull && field.second == "null")
+        {
+            continue;
+        }
+
+        std::vector<std::string_view> segments;
+        std::string_view path = field.first;
+        for (size_t dot; (dot = path.find('.')) != std::string_view::npos; path.remove_prefix(dot + 1))
+        {
+            segments.push_back(path.substr(0, dot));
+        }
+
+        size_t common = 0;
+        while (common < open.size() && common < segments.size() && open[common] == segments[common])
+        {
+            common++;
+        }
+        for (; open.size() > common; open.pop_back())
+        {
+            out += '}';
+            needComma = true;
+        }
+        for (size_t i = common; i < segments.size(); i++)
+        {
+            out.append(needComma ? ",\"" : "\"").append(segments[i]).append("\":{");
+            open.push_back(segments[i]);
+            needComma = false;
+        }
+        out.append(needComma ? ",\"" : "\"").append(path).append("\":").append(field.second);
+        needComma = true;
+    }
+    out.append(open.size(), '}');
+    out += '}';
+    return out;
+}
+
+void ShadowClient::eraseConflicts(Fields &fields, std::string_view path)
+{
+    for (size_t dot = path.find('.'); dot != std::string_view::npos; dot = path.find('.', dot + 1))
+    {
+        auto parent = fields.find(path.substr(0, dot));
+        if (parent != fields.end())
+        {
+            fields.erase(parent);
+        }
+    }
+
+    // Children sort between "path." and "path/"
+    std::string first = std::string(path) + '.';
+    std::string last = std::string(path) + '/';
+    fields.erase(fields.lower_bound(first), fields.lower_bound(last));
+}
+
+} // namespace mqtt
+} // namespace lopcore
@@ -0,0 +1,316 @@
+/**
+ * @file pkcs11_keys.cpp
+ * @brief Device key pair, CSR and certificate in the PKCS#11 token
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include <mbedtls/version.h>
+
+#if (MBEDTLS_VERSION_NUMBER >= 0x03000000) && !defined(MBEDTLS_ALLOW_PRIVATE_ACCESS)
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+#endif
+
+#include "lopcore/provisioning/pkcs11_keys.hpp"
+
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include <esp_random.h>
+
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/x509_csr.h"
+
+#include "core_pki_utils.h"
+#include "lopcore/logging/logger.hpp"
+#include "lopcore/tls/mbedtls_pkcs11_posix.h"
+#include "lopcore/tls/pkcs11_provider.hpp"
+
+static const char *TAG = "Pkcs11Keys";
+
+namespace lopcore
+{
+namespace provisioning
+{
+
+namespace
+{
+
+/// DER length of a CKA_EC_POINT for P-256: OCTET STRING header and uncompressed point
+constexpr size_t EC_POINT_LENGTH = 67;
+
+/// Largest PEM CSR for a P-256 key
+constexpr size_t CSR_PEM_SIZE = 2048;
+
+/**
+ * @brief Token key the CSR is signed with
+ *
+ * mbedTLS calls the signing function with only its own context, so the
+ * key in use is published here for the duration of one CSR.
+ */
+struct Signer
+{
+    CK_FUNCTION_LIST *functions{nullptr};
+    CK_SESSION_HANDLE session{CK_INVALID_HANDLE};
+    CK_OBJECT_HANDLE privateKey{CK_INVALID_HANDLE};
+};
+
+std::mutex signerMutex;
+Signer *activeSigner = nullptr;
+
+int randomBytes(void *, unsigned char *output, size_t length)
+{
+    esp_fill_random(output, length);
+    return 0;
+}
+
+/**
+ * @brief ECDSA through C_Sign, returned in the ASN.1 form mbedTLS expects
+ */
+#if (MBEDTLS_VERSION_NUMBER >= 0x03000000)
+int signWithToken(mbedtls_pk_context *,
+                  mbedtls_md_type_t,
+                  const unsigned char *hash,
+                  size_t hashLength,
+                  unsigned char *signature,
+                  size_t signatureSize,
+                  size_t *signatureLength,
+                  int (*)(void *, unsigned char *, size_t),
+                  void *)
+#else
+int signWithToken(void *,
+                  mbedtls_md_type_t,
+                  const unsigned char *hash,
+                  size_t hashLength,
+                  unsigned char *signature,
+                  size_t *signatureLength,
+                  int (*)(void *, unsigned char *, size_t),
+                  void *)
+#endif
+{
+    Signer *signer = activeSigner;
+    CK_MECHANISM mechanism = {CKM_ECDSA, nullptr, 0};
+    CK_BYTE digest[64];
+    if (signer == nullptr || hashLength > sizeof(digest))
+    {
+        return -1;
+    }
+#if (MBEDTLS_VERSION_NUMBER >= 0x03000000)
+    if (signatureSize < pkcs11ECDSA_P256_SIGNATURE_LENGTH + 8)
+    {
+        return -1;
+    }
+#endif
+    std::memcpy(digest, hash, hashLength);
+
+    CK_ULONG length = pkcs11ECDSA_P256_SIGNATURE_LENGTH;
+    CK_RV rv = signer->functions->C_SignInit(signer->session, &mechanism, signer->privateKey);
+    if (rv == CKR_OK)
+    {
+        rv = signer->functions->C_Sign(signer->session, digest, hashLength, signature, &length);
+    }
+    if (rv != CKR_OK || length != pkcs11ECDSA_P256_SIGNATURE_LENGTH)
+    {
+        LOPCORE_LOGE(TAG, "C_Sign failed: 0x%lx", static_cast<unsigned long>(rv));
+        return -1;
+    }
+
+    // Raw R || S to an ASN.1 SEQUENCE, in place
+    *signatureLength = length;
+    return PKI_pkcs11SignatureTombedTLSSignature(signature, signatureLength) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Destroy every object of a class under a label
+ */
+esp_err_t destroyObjects(CK_FUNCTION_LIST *functions,
+                         CK_SESSION_HANDLE session,
+                         const std::string &label,
+                         CK_OBJECT_CLASS objectClass)
+{
+    auto &provider = tls::Pkcs11Provider::instance();
+    CK_OBJECT_HANDLE handle = CK_INVALID_HANDLE;
+    esp_err_t err;
+    while ((err = provider.findObject(label, objectClass, &handle)) == ESP_OK)
+    {
+        CK_RV rv = functions->C_DestroyObject(session, handle);
+        provider.invalidateObject(label);
+        if (rv != CKR_OK)
+        {
+            LOPCORE_LOGE(TAG, "Cannot destroy %s: 0x%lx", label.c_str(), static_cast<unsigned long>(rv));
+            return ESP_FAIL;
+        }
+    }
+    return err == ESP_ERR_NOT_FOUND ? ESP_OK : err;
+}
+
+} // namespace
+
+esp_err_t createPkcs11Csr(const Pkcs11KeyConfig &config, std::string &csrPem)
+{
+    auto &provider = tls::Pkcs11Provider::instance();
+    Signer signer;
+    esp_err_t err = provider.getFunctionList(&signer.functions);
+    if (err == ESP_OK)
+    {
+        err = provider.getSession(&signer.session);
+    }
+    if (err == ESP_OK)
+    {
+        err = destroyObjects(signer.functions, signer.session, config.privateKeyLabel, CKO_PRIVATE_KEY);
+    }
+    if (err == ESP_OK)
+    {
+        err = destroyObjects(signer.functions, signer.session, config.publicKeyLabel, CKO_PUBLIC_KEY);
+    }
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    // P-256 pair generated inside the token; the private half never leaves it
+    CK_BYTE curve[] = pkcs11DER_ENCODED_OID_P256;
+    CK_MECHANISM mechanism = {CKM_EC_KEY_PAIR_GEN, nullptr, 0};
+    CK_KEY_TYPE keyType = CKK_EC;
+    CK_BBOOL yes = CK_TRUE;
+    CK_ATTRIBUTE publicTemplate[] = {
+        {CKA_KEY_TYPE, &keyType, sizeof(keyType)},
+        {CKA_VERIFY, &yes, sizeof(yes)},
+        {CKA_EC_PARAMS, curve, sizeof(curve)},
+        {CKA_LABEL, const_cast<char *>(config.publicKeyLabel.c_str()), config.publicKeyLabel.size()},
+    };
+    CK_ATTRIBUTE privateTemplate[] = {
+        {CKA_KEY_TYPE, &keyType, sizeof(keyType)},
+        {CKA_TOKEN, &yes, sizeof(yes)},
+        {CKA_PRIVATE, &yes, sizeof(yes)},
+        {CKA_SIGN, &yes, sizeof(yes)},
+        {CKA_LABEL, const_cast<char *>(config.privateKeyLabel.c_str()), config.privateKeyLabel.size()},
+    };
+    CK_OBJECT_HANDLE publicKey = CK_INVALID_HANDLE;
+    CK_RV rv = signer.functions->C_GenerateKeyPair(
+        signer.session, &mechanism, publicTemplate, sizeof(publicTemplate) / sizeof(publicTemplate[0]),
+        privateTemplate, sizeof(privateTemplate) / sizeof(privateTemplate[0]), &publicKey, &signer.privateKey);
+    if (rv != CKR_OK)
+    {
+        LOPCORE_LOGE(TAG, "C_GenerateKeyPair failed: 0x%lx", static_cast<unsigned long>(rv));
+        return ESP_FAIL;
+    }
+
+    CK_BYTE point[EC_POINT_LENGTH];
+    CK_ATTRIBUTE pointTemplate = {CKA_EC_POINT, point, sizeof(point)};
+    rv = signer.functions->C_GetAttributeValue(signer.session, publicKey, &pointTemplate, 1);
+    if (rv != CKR_OK || pointTemplate.ulValueLen != EC_POINT_LENGTH)
+    {
+        LOPCORE_LOGE(TAG, "Cannot read the public key: 0x%lx", static_cast<unsigned long>(rv));
+        return ESP_FAIL;
+    }
+
+    // mbedTLS writes the public key from an ECDSA context and signs through the token
+    mbedtls_ecdsa_context publicContext;
+    mbedtls_ecdsa_init(&publicContext);
+    mbedtls_pk_context key;
+    mbedtls_pk_init(&key);
+    mbedtls_pk_info_t keyInfo;
+    mbedtls_x509write_csr csr;
+    mbedtls_x509write_csr_init(&csr);
+    std::vector<unsigned char> pem(CSR_PEM_SIZE);
+
+    int ret = mbedtls_ecp_group_load(&publicContext.grp, MBEDTLS_ECP_DP_SECP256R1);
+    if (ret == 0)
+    {
+        // Skip the OCTET STRING tag and length
+        ret = mbedtls_ecp_point_read_binary(&publicContext.grp, &publicContext.Q, point + 2, EC_POINT_LENGTH - 2);
+    }
+    if (ret == 0)
+    {
+        std::memcpy(&keyInfo, mbedtls_pk_info_from_type(MBEDTLS_PK_ECKEY), sizeof(keyInfo));
+        keyInfo.sign_func = signWithToken;
+        key.pk_info = &keyInfo;
+        key.pk_ctx = &publicContext;
+
+        mbedtls_x509write_csr_set_md_alg(&csr, MBEDTLS_MD_SHA256);
+        mbedtls_x509write_csr_set_key(&csr, &key);
+        ret = mbedtls_x509write_csr_set_subject_name(&csr, config.subject.c_str());
+    }
+    if (ret == 0)
+    {
+        std::lock_guard<std::mutex> lock(signerMutex);
+        activeSigner = &signer;
+        ret = mbedtls_x509write_csr_pem(&csr, pem.data(), pem.size(), randomBytes, nullptr);
+        activeSigner = nullptr;
+    }
+
+    // Not mbedtls_pk_free(): the context is the stack object freed below
+    key.pk_ctx = nullptr;
+    key.pk_info = nullptr;
+    mbedtls_x509write_csr_free(&csr);
+    mbedtls_ecdsa_free(&publicContext);
+
+    if (ret != 0)
+    {
+        LOPCORE_LOGE(TAG, "Cannot write the CSR: -0x%04x", static_cast<unsigned>(-ret));
+        return ESP_FAIL;
+    }
+    csrPem.assign(reinterpret_cast<const char *>(pem.data()));
+    provider.invalidateObject(config.privateKeyLabel);
+    return ESP_OK;
+}
+
+esp_err_t storePkcs11Certificate(const Pkcs11KeyConfig &config, const std::string &certificatePem)
+{
+    mbedtls_x509_crt certificate;
+    mbedtls_x509_crt_init(&certificate);
+    if (mbedtls_x509_crt_parse(&certificate, reinterpret_cast<const unsigned char *>(certificatePem.c_str()),
+                               certificatePem.size() + 1) != 0)
+    {
+        mbedtls_x509_crt_free(&certificate);
+        LOPCORE_LOGE(TAG, "Issued certificate does not parse");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    auto &provider = tls::Pkcs11Provider::instance();
+    CK_FUNCTION_LIST *functions = nullptr;
+    CK_SESSION_HANDLE session = CK_INVALID_HANDLE;
+    esp_err_t err = provider.getFunctionList(&functions);
+    if (err == ESP_OK)
+    {
+        err = provider.getSession(&session);
+    }
+    if (err == ESP_OK)
+    {
+        err = destroyObjects(functions, session, config.certificateLabel, CKO_CERTIFICATE);
+    }
+    if (err == ESP_OK)
+    {
+        CK_OBJECT_CLASS objectClass = CKO_CERTIFICATE;
+        CK_CERTIFICATE_TYPE certificateType = CKC_X_509;
+        CK_BBOOL yes = CK_TRUE;
+        CK_ATTRIBUTE certificateTemplate[] = {
+            {CKA_CLASS, &objectClass, sizeof(objectClass)},
+            {CKA_SUBJECT, certificate.subject_raw.p, certificate.subject_raw.len},
+            {CKA_VALUE, certificate.raw.p, certificate.raw.len},
+            {CKA_LABEL, const_cast<char *>(config.certificateLabel.c_str()), config.certificateLabel.size()},
+            {CKA_CERTIFICATE_TYPE, &certificateType, sizeof(certificateType)},
+            {CKA_TOKEN, &yes, sizeof(yes)},
+        };
+        CK_OBJECT_HANDLE handle = CK_INVALID_HANDLE;
+        CK_RV rv = functions->C_CreateObject(session, certificateTemplate,
+                                             sizeof(certificateTemplate) / sizeof(certificateTemplate[0]), &handle);
+        if (rv != CKR_OK)
+        {
+            LOPCORE_LOGE(TAG, "Cannot write the certificate: 0x%lx", static_cast<unsigned long>(rv));
+            err = ESP_FAIL;
+        }
+        provider.invalidateObject(config.certificateLabel);
+    }
+
+    mbedtls_x509_crt_free(&certificate);
+    return err;
+}
+
+} // namespace provisioning
+} // namespace lopcore
@@ -0,0 +1,487 @@
+/**
+ * @file provisioning_manager.cpp
+ * @brief AWS IoT Fleet Provisioning by claim, in one MQTT session
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/provisioning/provisioning_manager.hpp"
+
+#include <cinttypes>
+#include <string_view>
+
+#include "lopcore/commands/command_router.hpp"
+#include "lopcore/logging/logger.hpp"
+
+#ifndef ESP_PLATFORM
+#include <chrono>
+#endif
+
+static const char *TAG = "Provisioning";
+
+static const std::string CREATE_TOPIC = "$aws/certificates/create-from-csr/cbor";
+static const std::string TEMPLATE_PREFIX = "$aws/provisioning-templates/";
+static const std::string REGISTER_SUFFIX = "/provision/cbor";
+
+namespace lopcore
+{
+namespace provisioning
+{
+
+namespace
+{
+
+// Major types of RFC 8949
+constexpr uint8_t CBOR_TEXT = 3;
+constexpr uint8_t CBOR_MAP = 5;
+
+/**
+ * @brief Appends definite-length CBOR items to a buffer
+ */
+class CborWriter
+{
+public:
+    explicit CborWriter(std::vector<uint8_t> &out) : out_(out)
+    {
+    }
+
+    void head(uint8_t major, uint32_t value)
+    {
+        uint8_t type = static_cast<uint8_t>(major << 5);
+        if (value < 24)
+        {
+            out_.push_back(type | static_cast<uint8_t>(value));
+            return;
+        }
+        size_t bytes = value <= 0xFF ? 1 : value <= 0xFFFF ? 2 : 4;
+        out_.push_back(type | (bytes == 1 ? 24 : bytes == 2 ? 25 : 26));
+        for (size_t i = bytes; i > 0; i--)
+        {
+            out_.push_back(static_cast<uint8_t>(value >> (8 * (i - 1))));
+        }
+    }
+
+    void text(std::string_view text)
+    {
+        head(CBOR_TEXT, static_cast<uint32_t>(text.size()));
+        out_.insert(out_.end(), text.begin(), text.end());
+    }
+
+private:
+    std::vector<uint8_t> &out_;
+};
+
+/**
+ * @brief Copy a text field of a response, false if it is missing
+ */
+bool copyString(const commands::CommandArgs &fields, std::string_view key, std::string &out)
+{
+    auto value = fields.getString(key);
+    if (!value)
+    {
+        return false;
+    }
+    out.assign(value->data(), value->size());
+    return true;
+}
+
+/**
+ * @brief A deviceConfiguration value as text (empty for nested values)
+ */
+std::string asText(const commands::CommandArg &value)
+{
+    switch (value.type)
+    {
+        case commands::ArgType::STRING:
+            return std::string(value.text);
+        case commands::ArgType::INTEGER:
+            return std::to_string(value.integer);
+        case commands::ArgType::NUMBER:
+            return std::to_string(value.number);
+        case commands::ArgType::BOOL:
+            return value.boolean ? "true" : "false";
+        default:
+            return std::string();
+    }
+}
+
+} // namespace
+
+ProvisioningManager::ProvisioningManager(std::shared_ptr<mqtt::IMqttClient> client,
+                                         const ProvisioningConfig &config,
+                                         NvsStorage *storage,
+                                         ProvisioningCrypto crypto,
+                                         TimeSource timeSource)
+    : client_(std::move(client)),
+      config_(config),
+      storage_(storage),
+      crypto_(std::move(crypto)),
+      timeSource_(timeSource)
+{
+#ifdef ESP_PLATFORM
+    arrived_ = xSemaphoreCreateBinary();
+#endif
+}
+
+ProvisioningManager::~ProvisioningManager()
+{
+#ifdef ESP_PLATFORM
+    if (arrived_ != nullptr)
+    {
+        vSemaphoreDelete(arrived_);
+    }
+#endif
+}
+
+std::string ProvisioningManager::createCertificateTopic()
+{
+    return CREATE_TOPIC;
+}
+
+std::string ProvisioningManager::registerThingTopic(const std::string &templateName)
+{
+    return TEMPLATE_PREFIX + templateName + REGISTER_SUFFIX;
+}
+
+bool ProvisioningManager::isProvisioned() const
+{
+    return storage_ != nullptr && storage_->exists(config_.thingNameKey);
+}
+
+esp_err_t ProvisioningManager::prepareKeys()
+{
+    if (!crypto_.createCsr)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    std::lock_guard<std::mutex> lock(keysMutex_);
+    if (!csrPem_.empty())
+    {
+        return ESP_OK;
+    }
+
+    int64_t start = timeSource_();
+    std::string csr;
+    esp_err_t err = crypto_.createCsr(csr);
+    if (err == ESP_OK && csr.empty())
+    {
+        err = ESP_FAIL;
+    }
+    if (err != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "Cannot create the device key and CSR: %s", esp_err_to_name(err));
+        return err;
+    }
+    csrPem_ = std::move(csr);
+    keysUs_ = timeSource_() - start;
+    LOPCORE_LOGI(TAG, "Device key and CSR ready in %" PRId64 " ms", keysUs_ / 1000);
+    return ESP_OK;
+}
+
+esp_err_t ProvisioningManager::provision()
+{
+    if (!client_ || config_.validate() != ESP_OK)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t start = timeSource_();
+    ProvisioningTimings timings;
+
+    // Waits for a prepareKeys() still running on another task
+    esp_err_t err = prepareKeys();
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    std::string csr;
+    {
+        std::lock_guard<std::mutex> lock(keysMutex_);
+        csr = csrPem_;
+        timings.keysUs = keysUs_;
+    }
+
+    // Both exchanges' responses are subscribed up front: no SUBACK wait
+    // between the two requests
+    const std::string registerTopic = registerThingTopic(config_.templateName);
+    auto callback = [this](const mqtt::MqttMessage &message) { onResponse(message); };
+    int64_t phase = timeSource_();
+    err = client_->subscribe(CREATE_TOPIC + "/+", callback, config_.qos);
+    if (err == ESP_OK)
+    {
+        err = client_->subscribe(registerTopic + "/+", callback, config_.qos);
+        if (err != ESP_OK)
+        {
+            client_->unsubscribe(CREATE_TOPIC + "/+");
+        }
+    }
+    if (err != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "Cannot subscribe to the provisioning responses: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    ProvisioningResult result;
+    std::vector<uint8_t> configuration;
+    Response response;
+    std::vector<uint8_t> request;
+    CborWriter writer(request);
+    writer.head(CBOR_MAP, 1);
+    writer.text("certificateSigningRequest");
+    writer.text(csr);
+
+    err = exchange(CREATE_TOPIC, request, response);
+    std::string ownershipToken;
+    if (err == ESP_OK && !response.accepted)
+    {
+        err = rejected("CreateCertificateFromCsr", response);
+    }
+    else if (err == ESP_OK)
+    {
+        commands::CommandArgs fields;
+        if (!fields.parse(response.payload.data(), response.payload.size()) || !fields.isCbor() ||
+            !copyString(fields, "certificateId", result.certificateId) ||
+            !copyString(fields, "certificatePem", result.certificatePem) ||
+            !copyString(fields, "certificateOwnershipToken", ownershipToken))
+        {
+            LOPCORE_LOGE(TAG, "Malformed CreateCertificateFromCsr response");
+            err = ESP_ERR_INVALID_RESPONSE;
+        }
+    }
+    timings.certificateUs = timeSource_() - phase;
+
+    if (err == ESP_OK)
+    {
+        phase = timeSource_();
+        request.clear();
+        writer.head(CBOR_MAP, 2);
+        writer.text("certificateOwnershipToken");
+        writer.text(ownershipToken);
+        writer.text("parameters");
+        writer.head(CBOR_MAP, static_cast<uint32_t>(config_.parameters.size()));
+        for (const auto &parameter : config_.parameters)
+        {
+            writer.text(parameter.first);
+            writer.text(parameter.second);
+        }
+
+        err = exchange(registerTopic, request, response);
+        if (err == ESP_OK && !response.accepted)
+        {
+            err = rejected("RegisterThing", response);
+        }
+        else if (err == ESP_OK)
+        {
+            commands::CommandArgs fields;
+            if (!fields.parse(response.payload.data(), response.payload.size()) || !fields.isCbor() ||
+                !copyString(fields, "thingName", result.thingName))
+            {
+                LOPCORE_LOGE(TAG, "Malformed RegisterThing response");
+                err = ESP_ERR_INVALID_RESPONSE;
+            }
+            else if (const commands::CommandArg *device = fields.find("deviceConfiguration"))
+            {
+                // A CBOR map kept encoded: stored as is, flattened to text for result()
+                commands::CommandArgs entries;
+                if (device->type != commands::ArgType::RAW ||
+                    !entries.parse(reinterpret_cast<const uint8_t *>(device->text.data()), device->text.size()))
+                {
+                    LOPCORE_LOGE(TAG, "Malformed deviceConfiguration");
+                    err = ESP_ERR_INVALID_RESPONSE;
+                }
+                else
+                {
+                    configuration.assign(device->text.begin(), device->text.end());
+                    for (size_t i = 0; i < entries.size(); i++)
+                    {
+                        result.deviceConfiguration.emplace_back(std::string(entries[i].key), asText(entries[i]));
+                    }
+                }
+            }
+        }
+        timings.registerUs = timeSource_() - phase;
+    }
+
+    client_->unsubscribe(CREATE_TOPIC + "/+");
+    client_->unsubscribe(registerTopic + "/+");
+
+    if (err == ESP_OK)
+    {
+        phase = timeSource_();
+        err = store(result, configuration);
+        timings.storeUs = timeSource_() - phase;
+    }
+    timings.totalUs = timeSource_() - start;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    timings_ = timings;
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    result_ = std::move(result);
+    LOPCORE_LOGI(TAG, "Provisioned %s in %" PRId64 " ms (keys %" PRId64 ", certificate %" PRId64
+                      ", register %" PRId64 ", store %" PRId64 ")",
+                 result_.thingName.c_str(), timings.totalUs / 1000, timings.keysUs / 1000,
+                 timings.certificateUs / 1000, timings.registerUs / 1000, timings.storeUs / 1000);
+    return ESP_OK;
+}
+
+esp_err_t ProvisioningManager::exchange(const std::string &topic,
+                                        const std::vector<uint8_t> &request,
+                                        Response &response)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        expected_ = topic;
+        response_ = Response();
+#ifdef ESP_PLATFORM
+        xSemaphoreTake(arrived_, 0);
+#endif
+    }
+
+    esp_err_t err = client_->publish(topic, request, config_.qos, false);
+    if (err != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "Cannot publish to %s: %s", topic.c_str(), esp_err_to_name(err));
+    }
+    else
+    {
+#ifdef ESP_PLATFORM
+        int64_t deadline = timeSource_() + static_cast<int64_t>(config_.responseTimeoutMs) * 1000;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!response_.ready)
+        {
+            int64_t remainingUs = deadline - timeSource_();
+            if (remainingUs <= 0)
+            {
+                break;
+            }
+            lock.unlock();
+            xSemaphoreTake(arrived_, pdMS_TO_TICKS(remainingUs / 1000 + 1));
+            lock.lock();
+        }
+#else
+        std::unique_lock<std::mutex> lock(mutex_);
+        arrived_.wait_for(lock, std::chrono::milliseconds(config_.responseTimeoutMs),
+                          [this] { return response_.ready; });
+#endif
+        if (response_.ready)
+        {
+            response = std::move(response_);
+        }
+        else
+        {
+            LOPCORE_LOGE(TAG, "No response to %s within %lu ms", topic.c_str(),
+                         static_cast<unsigned long>(config_.responseTimeoutMs));
+            err = ESP_ERR_TIMEOUT;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    expected_.clear();
+    return err;
+}
+
+void ProvisioningManager::onResponse(const mqtt::MqttMessage &message)
+{
+    std::string_view topic(message.topic);
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Only the request in flight; a late response to an earlier one is ignored
+    if (expected_.empty() || response_.ready || topic.size() <= expected_.size() + 1 ||
+        topic.compare(0, expected_.size(), expected_) != 0 || topic[expected_.size()] != '/')
+    {
+        return;
+    }
+    std::string_view outcome = topic.substr(expected_.size() + 1);
+    if (outcome != "accepted" && outcome != "rejected")
+    {
+        return;
+    }
+
+    response_.ready = true;
+    response_.accepted = outcome == "accepted";
+    response_.payload = message.payload;
+#ifdef ESP_PLATFORM
+    xSemaphoreGive(arrived_);
+#else
+    arrived_.notify_all();
+#endif
+}
+
+esp_err_t ProvisioningManager::rejected(const char *request, const Response &response)
+{
+    ProvisioningError error;
+    commands::CommandArgs fields;
+    if (fields.parse(response.payload.data(), response.payload.size()))
+    {
+        error.statusCode = static_cast<uint32_t>(fields.getInt("statusCode").value_or(0));
+        copyString(fields, "errorCode", error.errorCode);
+        copyString(fields, "errorMessage", error.errorMessage);
+    }
+    LOPCORE_LOGE(TAG, "%s rejected (%lu %s): %s", request, static_cast<unsigned long>(error.statusCode),
+                 error.errorCode.c_str(), error.errorMessage.c_str());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    error_ = std::move(error);
+    return ESP_FAIL;
+}
+
+esp_err_t ProvisioningManager::store(const ProvisioningResult &result, const std::vector<uint8_t> &configuration)
+{
+    if (crypto_.storeCertificate)
+    {
+        esp_err_t err = crypto_.storeCertificate(result.certificatePem);
+        if (err != ESP_OK)
+        {
+            LOPCORE_LOGE(TAG, "Cannot install the certificate: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+    if (storage_ == nullptr)
+    {
+        return ESP_OK;
+    }
+
+    // One commit for every key; the thing name last, so isProvisioned()
+    // never sees a partial set if a write fails
+    NvsStorage::Batch batch(*storage_);
+    bool ok = storage_->write(config_.certificateIdKey, result.certificateId) &&
+              storage_->write(config_.certificateKey, result.certificatePem);
+    if (ok)
+    {
+        ok = configuration.empty() ? (!storage_->exists(config_.configurationKey) ||
+                                      storage_->remove(config_.configurationKey))
+                                   : storage_->write(config_.configurationKey, configuration);
+    }
+    ok = ok && storage_->write(config_.thingNameKey, result.thingName);
+    if (!batch.commit() || !ok)
+    {
+        LOPCORE_LOGE(TAG, "Cannot store the provisioning result");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+ProvisioningResult ProvisioningManager::result() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return result_;
+}
+
+ProvisioningError ProvisioningManager::lastError() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+}
+
+ProvisioningTimings ProvisioningManager::timings() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return timings_;
+}
+
+} // namespace provisioning
+} // namespace lopcore
@@ -0,0 +1,290 @@
+/**
+ * @file asset_bundle.cpp
+ * @brief Read-only assets used in place from memory-mapped flash
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/storage/asset_bundle.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef ESP_PLATFORM
+#include <esp_log.h>
+#include <esp_partition.h>
+
+#include <cinttypes>
+#else
+// Host mocks
+#include <iostream>
+#define ESP_LOGI(tag, format, ...) std::cout << "[INFO] " << tag << ": " << format << std::endl
+#define ESP_LOGE(tag, format, ...) std::cerr << "[ERROR] " << tag << ": " << format << std::endl
+#endif
+
+static const char *TAG = "AssetBundle";
+
+namespace lopcore
+{
+
+static const uint8_t BUNDLE_MAGIC[4] = {'L', 'C', 'A', 'B'};
+
+/**
+ * @brief CRC-32 (IEEE 802.3, reflected) with a nibble table
+ */
+static uint32_t crc32Update(uint32_t crc, const void *data, size_t length)
+{
+    static const uint32_t table[16] = {0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+                                       0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+                                       0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= bytes[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return crc;
+}
+
+static uint16_t getLe16(const uint8_t *in)
+{
+    return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+static uint32_t getLe32(const uint8_t *in)
+{
+    return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8) |
+           (static_cast<uint32_t>(in[2]) << 16) | (static_cast<uint32_t>(in[3]) << 24);
+}
+
+// ============================================================================
+// MappedPartition
+// ============================================================================
+
+MappedPartition::~MappedPartition()
+{
+    unmap();
+}
+
+bool MappedPartition::map(const std::string &label, size_t length)
+{
+    unmap();
+
+#ifdef ESP_PLATFORM
+    const esp_partition_t *partition =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label.c_str());
+    if (partition == nullptr)
+    {
+        ESP_LOGE(TAG, "Partition not found: %s", label.c_str());
+        return false;
+    }
+
+    if (length == 0)
+    {
+        length = partition->size;
+    }
+    if (length > partition->size)
+    {
+        ESP_LOGE(TAG, "Cannot map %zu bytes of %" PRIu32 " byte partition %s", length, partition->size,
+                 label.c_str());
+        return false;
+    }
+
+    const void *data = nullptr;
+    esp_partition_mmap_handle_t handle;
+    esp_err_t ret = esp_partition_mmap(partition, 0, length, ESP_PARTITION_MMAP_DATA, &data, &handle);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to map partition %s: %s", label.c_str(), esp_err_to_name(ret));
+        return false;
+    }
+
+    data_ = static_cast<const uint8_t *>(data);
+    size_ = length;
+    handle_ = handle;
+    ESP_LOGI(TAG, "Mapped %zu bytes of partition %s", length, label.c_str());
+    return true;
+#else
+    (void)label;
+    (void)length;
+    ESP_LOGE(TAG, "Partition mapping needs ESP-IDF: %s", label.c_str());
+    return false;
+#endif
+}
+
+void MappedPartition::unmap()
+{
+#ifdef ESP_PLATFORM
+    if (data_ != nullptr)
+    {
+        esp_partition_munmap(handle_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    handle_ = 0;
+}
+
+bool MappedPartition::read(const std::string &label, size_t offset, void *buffer, size_t length)
+{
+#ifdef ESP_PLATFORM
+    const esp_partition_t *partition =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label.c_str());
+    return partition != nullptr && esp_partition_read(partition, offset, buffer, length) == ESP_OK;
+#else
+    (void) label;
+    (void) offset;
+    (void) buffer;
+    (void) length;
+    return false;
+#endif
+}
+
+// ============================================================================
+// AssetBundle
+// ============================================================================
+
+bool AssetBundle::attach(const uint8_t *image, size_t length)
+{
+    image_ = nullptr;
+    size_ = 0;
+    count_ = 0;
+
+    if (image == nullptr || length < HEADER_SIZE || memcmp(image, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) != 0)
+    {
+        ESP_LOGE(TAG, "Not an asset bundle");
+        return false;
+    }
+
+    uint16_t version = getLe16(image + 4);
+    uint32_t count = getLe32(image + 8);
+    uint32_t totalSize = getLe32(image + 12);
+    if (version != VERSION)
+    {
+        ESP_LOGE(TAG, "Unsupported bundle version %u", version);
+        return false;
+    }
+    if (totalSize > length || totalSize < HEADER_SIZE ||
+        static_cast<uint64_t>(count) * ENTRY_SIZE > totalSize - HEADER_SIZE)
+    {
+        ESP_LOGE(TAG, "Bundle truncated or entry table out of range");
+        return false;
+    }
+
+    // Checked once here, so find() and at() can trust every offset
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint8_t *e = image + HEADER_SIZE + i * ENTRY_SIZE;
+        uint64_t nameEnd = static_cast<uint64_t>(getLe32(e)) + getLe16(e + 12);
+        uint64_t dataEnd = static_cast<uint64_t>(getLe32(e + 4)) + getLe32(e + 8);
+        if (nameEnd > totalSize || dataEnd > totalSize)
+        {
+            ESP_LOGE(TAG, "Asset %zu lies outside the bundle", i);
+            return false;
+        }
+    }
+
+    image_ = image;
+    size_ = totalSize;
+    count_ = count;
+    return true;
+}
+
+bool AssetBundle::mapPartition(const std::string &label)
+{
+    uint8_t header[HEADER_SIZE];
+    if (!MappedPartition::read(label, 0, header, sizeof(header)))
+    {
+        ESP_LOGE(TAG, "Failed to read bundle header from partition %s", label.c_str());
+        return false;
+    }
+    if (memcmp(header, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) != 0)
+    {
+        ESP_LOGE(TAG, "Partition %s holds no asset bundle", label.c_str());
+        return false;
+    }
+
+    uint32_t totalSize = getLe32(header + 12);
+    if (!partition_.map(label, totalSize))
+    {
+        return false;
+    }
+
+    AssetView mapped = partition_.view();
+    if (!attach(mapped.data, mapped.size))
+    {
+        partition_.unmap();
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Mapped %zu assets from partition %s", count_, label.c_str());
+    return true;
+}
+
+AssetView AssetBundle::find(const std::string &name) const
+{
+    size_t low = 0;
+    size_t high = count_;
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        const uint8_t *e = entry(mid);
+        const char *entryName = reinterpret_cast<const char *>(image_ + getLe32(e));
+        size_t entryLength = getLe16(e + 12);
+
+        int order = memcmp(entryName, name.data(), std::min(entryLength, name.size()));
+        if (order == 0)
+        {
+            order = entryLength < name.size() ? -1 : (entryLength > name.size() ? 1 : 0);
+        }
+
+        if (order == 0)
+        {
+            return at(mid);
+        }
+        if (order < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return AssetView();
+}
+
+std::string AssetBundle::nameAt(size_t index) const
+{
+    if (index >= count_)
+    {
+        return std::string();
+    }
+    const uint8_t *e = entry(index);
+    return std::string(reinterpret_cast<const char *>(image_ + getLe32(e)), getLe16(e + 12));
+}
+
+AssetView AssetBundle::at(size_t index) const
+{
+    if (index >= count_)
+    {
+        return AssetView();
+    }
+    const uint8_t *e = entry(index);
+    return AssetView{image_ + getLe32(e + 4), getLe32(e + 8)};
+}
+
+bool AssetBundle::verify() const
+{
+    if (image_ == nullptr)
+    {
+        return false;
+    }
+    uint32_t crc = ~crc32Update(0xFFFFFFFF, image_ + HEADER_SIZE, size_ - HEADER_SIZE);
+    return crc == getLe32(image_ + 16);
+}
+
+} // namespace lopcore
@@ -0,0 +1,332 @@
+/**
+ * @file async_storage.cpp
+ * @brief Storage operations queued to a dedicated worker task
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/storage/async_storage.hpp"
+
+#include <utility>
+
+#include "lopcore/task/task_profile.hpp"
+
+#ifdef ESP_PLATFORM
+#include <esp_log.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+// Host mocks
+#include <chrono>
+#include <iostream>
+#define ESP_LOGI(tag, format, ...) std::cout << "[INFO] " << tag << ": " << format << std::endl
+#define ESP_LOGE(tag, format, ...) std::cerr << "[ERROR] " << tag << ": " << format << std::endl
+#endif
+
+static const char *TAG = "AsyncStorage";
+
+namespace lopcore
+{
+
+AsyncStorage::AsyncStorage(WriteFunction write, ReadFunction read, const storage::AsyncStorageConfig &config)
+    : write_(std::move(write)), read_(std::move(read)), config_(config)
+{
+}
+
+AsyncStorage::~AsyncStorage()
+{
+    stop();
+}
+
+bool AsyncStorage::start()
+{
+    if (running_.load())
+    {
+        return false;
+    }
+
+    running_.store(true);
+#ifdef ESP_PLATFORM
+    stopped_.store(false);
+    TaskHandle_t handle = nullptr;
+    task::TaskSettings settings{config_.coreId, config_.priority, config_.stackSize};
+    if (task::spawn(task::TaskRole::STORAGE_IO, "storage_io", workerEntry, this, settings, &handle) != ESP_OK)
+    {
+        stopped_.store(true);
+        running_.store(false);
+        ESP_LOGE(TAG, "Failed to create storage worker task");
+        return false;
+    }
+    task_ = handle;
+#else
+    thread_ = std::thread(workerEntry, this);
+#endif
+
+    ESP_LOGI(TAG, "Started storage worker (queue depth %zu)", config_.queueDepth);
+    return true;
+}
+
+void AsyncStorage::stop()
+{
+    running_.store(false);
+    wakeWorker();
+
+    // The worker drains the queue before it exits
+#ifdef ESP_PLATFORM
+    while (!stopped_.load())
+    {
+        vTaskDelay(1);
+    }
+    task_ = nullptr;
+#else
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+#endif
+}
+
+std::future<bool> AsyncStorage::writeAsync(const std::string &key, std::vector<uint8_t> data)
+{
+    auto promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> result = promise->get_future();
+    if (!writeAsync(key, std::move(data), [promise](bool ok) { promise->set_value(ok); }))
+    {
+        promise->set_value(false);
+    }
+    return result;
+}
+
+std::future<bool> AsyncStorage::writeAsync(const std::string &key, const std::string &data)
+{
+    return writeAsync(key, std::vector<uint8_t>(data.begin(), data.end()));
+}
+
+bool AsyncStorage::writeAsync(const std::string &key, std::vector<uint8_t> data, WriteCallback done)
+{
+    Job job;
+    job.isWrite = true;
+    job.key = key;
+    job.data = std::move(data);
+    job.writeDone.push_back(std::move(done));
+    return submit(std::move(job));
+}
+
+std::future<std::optional<std::vector<uint8_t>>> AsyncStorage::readAsync(const std::string &key)
+{
+    auto promise = std::make_shared<std::promise<std::optional<std::vector<uint8_t>>>>();
+    std::future<std::optional<std::vector<uint8_t>>> result = promise->get_future();
+    if (!readAsync(key, [promise](std::optional<std::vector<uint8_t>> data) { promise->set_value(std::move(data)); }))
+    {
+        promise->set_value(std::nullopt);
+    }
+    return result;
+}
+
+bool AsyncStorage::readAsync(const std::string &key, ReadCallback done)
+{
+    Job job;
+    job.isWrite = false;
+    job.key = key;
+    job.readDone = std::move(done);
+    return submit(std::move(job));
+}
+
+bool AsyncStorage::submit(Job job)
+{
+    uint32_t waitedMs = 0;
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // Checked under the lock, so the worker cannot exit between the check and the push
+            if (!running_.load())
+            {
+                rejected_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            auto open = openWrite_.find(job.key);
+            if (job.isWrite && open != openWrite_.end())
+            {
+                // Last value wins; every writer learns the result of the one write
+                Job &queued = *open->second;
+                queued.data = std::move(job.data);
+                for (WriteCallback &done : job.writeDone)
+                {
+                    queued.writeDone.push_back(std::move(done));
+                }
+                coalesced_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            if (queue_.size() < config_.queueDepth)
+            {
+                if (!job.isWrite && open != openWrite_.end())
+                {
+                    // A later write must not overtake this read
+                    openWrite_.erase(open);
+                }
+
+                queue_.push_back(std::move(job));
+                if (queue_.back().isWrite)
+                {
+                    openWrite_[queue_.back().key] = std::prev(queue_.end());
+                }
+                break;
+            }
+        }
+
+        if (waitedMs >= config_.enqueueTimeoutMs)
+        {
+            ESP_LOGE(TAG, "Storage queue full, rejected operation on '%s'", job.key.c_str());
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+#ifdef ESP_PLATFORM
+        vTaskDelay(1);
+        waitedMs += portTICK_PERIOD_MS;
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        waitedMs++;
+#endif
+    }
+
+    wakeWorker();
+    return true;
+}
+
+void AsyncStorage::flush()
+{
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.empty() && !busy_)
+            {
+                return;
+            }
+        }
+#ifdef ESP_PLATFORM
+        vTaskDelay(1);
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+    }
+}
+
+size_t AsyncStorage::pending() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+AsyncStorageStats AsyncStorage::getStats() const
+{
+    AsyncStorageStats stats;
+    stats.writes = writes_.load(std::memory_order_relaxed);
+    stats.reads = reads_.load(std::memory_order_relaxed);
+    stats.coalesced = coalesced_.load(std::memory_order_relaxed);
+    stats.rejected = rejected_.load(std::memory_order_relaxed);
+    stats.failed = failed_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void AsyncStorage::workerEntry(void *arg)
+{
+    AsyncStorage *self = static_cast<AsyncStorage *>(arg);
+    self->run();
+
+#ifdef ESP_PLATFORM
+    self->stopped_.store(true);
+    task::exitTask();
+#endif
+}
+
+void AsyncStorage::run()
+{
+    while (true)
+    {
+        Job job;
+        bool haveJob = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+#ifndef ESP_PLATFORM
+            wake_.wait(lock, [this] { return !queue_.empty() || !running_.load(); });
+#endif
+            if (!queue_.empty())
+            {
+                auto open = openWrite_.find(queue_.front().key);
+                if (open != openWrite_.end() && open->second == queue_.begin())
+                {
+                    openWrite_.erase(open);
+                }
+                job = std::move(queue_.front());
+                queue_.pop_front();
+                busy_ = true;
+                haveJob = true;
+            }
+            else if (!running_.load())
+            {
+                break;
+            }
+        }
+
+        if (!haveJob)
+        {
+#ifdef ESP_PLATFORM
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#endif
+            continue;
+        }
+
+        if (job.isWrite)
+        {
+            bool ok = write_(job.key, job.data);
+            writes_.fetch_add(1, std::memory_order_relaxed);
+            if (!ok)
+            {
+                failed_.fetch_add(1, std::memory_order_relaxed);
+            }
+            for (WriteCallback &done : job.writeDone)
+            {
+                if (done)
+                {
+                    done(ok);
+                }
+            }
+        }
+        else
+        {
+            std::optional<std::vector<uint8_t>> data = read_(job.key);
+            reads_.fetch_add(1, std::memory_order_relaxed);
+            if (job.readDone)
+            {
+                job.readDone(std::move(data));
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        busy_ = false;
+    }
+}
+
+void AsyncStorage::wakeWorker()
+{
+#ifdef ESP_PLATFORM
+    TaskHandle_t handle = static_cast<TaskHandle_t>(task_);
+    if (handle != nullptr)
+    {
+        xTaskNotifyGive(handle);
+    }
+#else
+    // Taking the lock orders the notify after a concurrent predicate check
+    std::lock_guard<std::mutex> lock(mutex_);
+    wake_.notify_one();
+#endif
+}
+
+} // namespace lopcore
@@ -0,0 +1,260 @@
+/**
+ * @file compressed_storage.cpp
+ * @brief Transparent LZ compression over a file backend
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/storage/compressed_storage.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "lopcore/compression/lzss.hpp"
+
+namespace lopcore
+{
+
+namespace
+{
+
+constexpr uint8_t MAGIC[4] = {'L', 'C', 'Z', 'S'};
+constexpr size_t HEADER_SIZE = 8;
+constexpr uint32_t SIZE_UNKNOWN = 0xFFFFFFFF; ///< Header of a value whose writer has not closed
+constexpr size_t FLUSH_SIZE = 512;            ///< Encoded bytes gathered before a stream write
+
+void putHeader(uint8_t *out, uint32_t size)
+{
+    memcpy(out, MAGIC, sizeof(MAGIC));
+    for (int i = 0; i < 4; i++)
+    {
+        out[4 + i] = static_cast<uint8_t>(size >> (8 * i));
+    }
+}
+
+} // namespace
+
+// ============================================================================
+// Decoder
+// ============================================================================
+
+/**
+ * @brief Shared token decoder fed from the stream in small reads
+ */
+struct CompressedReader::Decoder
+{
+    lzss::Decoder tokens;
+    uint8_t input[128];
+    size_t inputUsed = 0;
+    size_t inputLength = 0;
+
+    /**
+     * @return Bytes produced, or fewer than length and set failed on corrupt or truncated input
+     */
+    size_t decode(StorageReader &reader, uint8_t *out, size_t length, bool &failed)
+    {
+        auto next = [this, &reader]() -> int {
+            if (inputUsed == inputLength)
+            {
+                inputLength = reader.read(input, sizeof(input));
+                inputUsed = 0;
+                if (inputLength == 0)
+                {
+                    return -1;
+                }
+            }
+            return input[inputUsed++];
+        };
+
+        lzss::Decoder::Status status;
+        size_t n = tokens.decode(next, out, length, status);
+        failed = failed || status != lzss::Decoder::Status::OK;
+        return n;
+    }
+};
+
+// ============================================================================
+// CompressedReader
+// ============================================================================
+
+CompressedReader::CompressedReader(StorageReader reader, bool compressed) : reader_(std::move(reader))
+{
+    std::optional<size_t> size = storedSize(reader_, compressed);
+    if (!size)
+    {
+        reader_.close();
+        return;
+    }
+    size_ = *size;
+    // storedSize() skipped a header only if there was one
+    if (reader_.tell() == HEADER_SIZE)
+    {
+        decoder_.reset(new Decoder());
+    }
+}
+
+CompressedReader::~CompressedReader() = default;
+
+CompressedReader::CompressedReader(CompressedReader &&other) noexcept = default;
+
+CompressedReader &CompressedReader::operator=(CompressedReader &&other) noexcept = default;
+
+size_t CompressedReader::read(uint8_t *buffer, size_t length)
+{
+    if (!isOpen() || failed_)
+    {
+        return 0;
+    }
+    length = std::min(length, size_ - position_);
+
+    size_t n = decoder_ ? decoder_->decode(reader_, buffer, length, failed_) : reader_.read(buffer, length);
+    position_ += n;
+    return n;
+}
+
+void CompressedReader::close()
+{
+    reader_.close();
+    decoder_.reset();
+}
+
+std::optional<size_t> CompressedReader::storedSize(StorageReader &reader, bool compressed)
+{
+    if (!reader)
+    {
+        return std::nullopt;
+    }
+    if (compressed && reader.size() >= HEADER_SIZE)
+    {
+        uint8_t header[HEADER_SIZE];
+        if (reader.read(header, sizeof(header)) == sizeof(header) && memcmp(header, MAGIC, sizeof(MAGIC)) == 0)
+        {
+            uint32_t size = static_cast<uint32_t>(header[4]) | (static_cast<uint32_t>(header[5]) << 8) |
+                            (static_cast<uint32_t>(header[6]) << 16) | (static_cast<uint32_t>(header[7]) << 24);
+            if (size == SIZE_UNKNOWN)
+            {
+                return std::nullopt;
+            }
+            return size;
+        }
+        reader.seek(0);
+    }
+    return reader.size();
+}
+
+// ============================================================================
+// CompressedWriter
+// ============================================================================
+
+CompressedWriter::CompressedWriter(StorageWriter writer, bool compress) : writer_(std::move(writer))
+{
+    if (!compress || !writer_)
+    {
+        return;
+    }
+
+    encoder_.reset(new lzss::StreamEncoder());
+    uint8_t header[HEADER_SIZE];
+    putHeader(header, SIZE_UNKNOWN);
+    ok_ = writer_.write(header, sizeof(header));
+}
+
+CompressedWriter::~CompressedWriter()
+{
+    close();
+}
+
+CompressedWriter::CompressedWriter(CompressedWriter &&other) noexcept = default;
+
+CompressedWriter &CompressedWriter::operator=(CompressedWriter &&other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        writer_ = std::move(other.writer_);
+        encoder_ = std::move(other.encoder_);
+        pending_ = std::move(other.pending_);
+        written_ = other.written_;
+        ok_ = other.ok_;
+    }
+    return *this;
+}
+
+bool CompressedWriter::write(const uint8_t *data, size_t length)
+{
+    if (!isOpen() || !ok_)
+    {
+        return false;
+    }
+    if (!encoder_)
+    {
+        ok_ = writer_.write(data, length);
+    }
+    else if (length > SIZE_UNKNOWN - 1 - written_)
+    {
+        ok_ = false; // The header holds a 32-bit size
+    }
+    else
+    {
+        encoder_->write(data, length, pending_);
+        if (pending_.size() >= FLUSH_SIZE)
+        {
+            ok_ = flushPending();
+        }
+    }
+    if (ok_)
+    {
+        written_ += length;
+    }
+    return ok_;
+}
+
+bool CompressedWriter::close()
+{
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    if (encoder_ && ok_)
+    {
+        encoder_->finish(pending_);
+        uint8_t header[HEADER_SIZE];
+        putHeader(header, static_cast<uint32_t>(written_));
+        ok_ = flushPending() && writer_.seek(0) && writer_.write(header, sizeof(header));
+    }
+    encoder_.reset();
+    pending_ = std::vector<uint8_t>();
+    return writer_.close() && ok_;
+}
+
+bool CompressedWriter::flushPending()
+{
+    bool written = writer_.write(pending_.data(), pending_.size());
+    pending_.clear();
+    return written;
+}
+
+bool CompressedWriter::compress(const uint8_t *data, size_t length, std::vector<uint8_t> &out)
+{
+    if (length >= SIZE_UNKNOWN)
+    {
+        return false;
+    }
+
+    out.assign(HEADER_SIZE, 0);
+    putHeader(out.data(), static_cast<uint32_t>(length));
+    lzss::StreamEncoder encoder;
+    encoder.write(data, length, out);
+    encoder.finish(out);
+    return out.size() < length;
+}
+
+bool CompressedWriter::looksCompressed(const uint8_t *data, size_t length)
+{
+    return length >= sizeof(MAGIC) && memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+} // namespace lopcore
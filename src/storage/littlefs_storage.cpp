@@ -28,7 +28,8 @@ static const char *TAG = "LittleFsStorage";
 // Constructor & Destructor
 // ============================================================================
 
-LittleFsStorage::LittleFsStorage(const storage::LittleFsConfig &config) : config_(config), initialized_(false)
+LittleFsStorage::LittleFsStorage(const storage::LittleFsConfig &config)
+    : config_(config), initialized_(false), appender_(config_.append)
 {
     LOPCORE_LOGI(TAG, "Creating LittleFS storage with base path: %s", config_.basePath.c_str());
 }
@@ -37,10 +38,13 @@ LittleFsStorage::~LittleFsStorage()
 {
     if (initialized_)
     {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::unique_lock<std::shared_mutex> lock(mutex_);
 
         LOPCORE_LOGI(TAG, "Cleaning up LittleFS storage");
 
+        // Before unregistering, while the files can still be flushed
+        appender_.closeAll();
+
         esp_err_t ret = esp_vfs_littlefs_unregister(config_.partitionLabel.c_str());
         if (ret != ESP_OK)
         {
@@ -57,7 +61,7 @@ LittleFsStorage::~LittleFsStorage()
 
 bool LittleFsStorage::initialize()
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_lock<std::shared_mutex> lock(mutex_);
 
     if (initialized_)
     {
@@ -108,6 +112,7 @@ bool LittleFsStorage::initialize()
         LOPCORE_LOGW(TAG, "LittleFS initialized but couldn't get filesystem info");
     }
 
+    buildIndex();
     return true;
 }
 
@@ -117,7 +122,7 @@ bool LittleFsStorage::initialize()
 
 bool LittleFsStorage::write(const std::string &key, const std::string &data)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -126,6 +131,8 @@ bool LittleFsStorage::write(const std::string &key, const std::string &data)
     }
 
     std::string filepath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
 
     std::ofstream file(filepath, std::ios::out | std::ios::trunc);
     if (!file.is_open())
@@ -143,13 +150,54 @@ bool LittleFsStorage::write(const std::string &key, const std::string &data)
         return false;
     }
 
+    index_.update(filepath, data.size());
     LOPCORE_LOGD(TAG, "Wrote %zu bytes to key '%s'", data.size(), key.c_str());
     return true;
 }
 
+bool LittleFsStorage::writeAtomic(const std::string &key, const std::string &data, bool keepBackup)
+{
+    return writeAtomic(key, data.data(), data.size(), keepBackup);
+}
+
+bool LittleFsStorage::writeAtomic(const std::string &key, const std::vector<uint8_t> &data, bool keepBackup)
+{
+    return writeAtomic(key, data.data(), data.size(), keepBackup);
+}
+
+bool LittleFsStorage::writeAtomic(const std::string &key, const void *data, size_t dataLen, bool keepBackup)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    if (!initialized_)
+    {
+        LOPCORE_LOGE(TAG, "Cannot write: storage not initialized");
+        return false;
+    }
+
+    std::string filepath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
+
+    if (!writeFileAtomic(filepath, static_cast<const uint8_t *>(data), dataLen, keepBackup))
+    {
+        LOPCORE_LOGE(TAG, "Failed to write atomically: %s", filepath.c_str());
+        return false;
+    }
+
+    if (keepBackup)
+    {
+        index_.erase(filepath + ".bak");
+        index_.rename(filepath, filepath + ".bak");
+    }
+    index_.update(filepath, dataLen);
+    LOPCORE_LOGD(TAG, "Wrote %zu bytes atomically to key '%s'", dataLen, key.c_str());
+    return true;
+}
+
 std::optional<std::string> LittleFsStorage::read(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -158,6 +206,8 @@ std::optional<std::string> LittleFsStorage::read(const std::string &key)
     }
 
     std::string filepath = getFullPath(key);
+    std::shared_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
 
     std::ifstream file(filepath);
     if (!file.is_open())
@@ -178,7 +228,7 @@ std::optional<std::string> LittleFsStorage::read(const std::string &key)
 
 bool LittleFsStorage::write(const std::string &key, const std::vector<uint8_t> &data)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -187,6 +237,8 @@ bool LittleFsStorage::write(const std::string &key, const std::vector<uint8_t> &
     }
 
     std::string filepath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
 
     std::ofstream file(filepath, std::ios::out | std::ios::binary | std::ios::trunc);
     if (!file.is_open())
@@ -204,13 +256,14 @@ bool LittleFsStorage::write(const std::string &key, const std::vector<uint8_t> &
         return false;
     }
 
+    index_.update(filepath, data.size());
     LOPCORE_LOGD(TAG, "Wrote %zu bytes (binary) to key '%s'", data.size(), key.c_str());
     return true;
 }
 
 bool LittleFsStorage::write(const std::string &key, const void *data, size_t dataLen)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -225,6 +278,8 @@ bool LittleFsStorage::write(const std::string &key, const void *data, size_t dat
     }
 
     std::string filepath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
 
     std::ofstream file(filepath, std::ios::out | std::ios::binary | std::ios::trunc);
     if (!file.is_open())
@@ -242,13 +297,14 @@ bool LittleFsStorage::write(const std::string &key, const void *data, size_t dat
         return false;
     }
 
+    index_.update(filepath, dataLen);
     LOPCORE_LOGD(TAG, "Wrote %zu bytes (binary) to key '%s'", dataLen, key.c_str());
     return true;
 }
 
 std::optional<std::vector<uint8_t>> LittleFsStorage::readBinary(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -257,6 +313,8 @@ std::optional<std::vector<uint8_t>> LittleFsStorage::readBinary(const std::strin
     }
 
     std::string filepath = getFullPath(key);
+    std::shared_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
 
     std::ifstream file(filepath, std::ios::in | std::ios::binary | std::ios::ate);
     if (!file.is_open())
@@ -281,9 +339,79 @@ std::optional<std::vector<uint8_t>> LittleFsStorage::readBinary(const std::strin
     return data;
 }
 
+StorageReader LittleFsStorage::openReader(const std::string &key, size_t bufferSize)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    if (!initialized_)
+    {
+        LOPCORE_LOGE(TAG, "Storage not initialized");
+        return StorageReader();
+    }
+
+    std::string filepath = getFullPath(key);
+    std::shared_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
+    return StorageReader(filepath, bufferSize);
+}
+
+StorageWriter LittleFsStorage::openWriter(const std::string &key, bool append, size_t bufferSize)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    if (!initialized_)
+    {
+        LOPCORE_LOGE(TAG, "Storage not initialized");
+        return StorageWriter();
+    }
+
+    std::string filepath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
+    index_.invalidate(filepath);
+    return StorageWriter(filepath, append, bufferSize);
+}
+
+bool LittleFsStorage::append(const std::string &key, const std::string &data)
+{
+    return append(key, data.data(), data.size());
+}
+
+bool LittleFsStorage::append(const std::string &key, const std::vector<uint8_t> &data)
+{
+    return append(key, data.data(), data.size());
+}
+
+bool LittleFsStorage::append(const std::string &key, const void *data, size_t dataLen)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    if (!initialized_)
+    {
+        LOPCORE_LOGE(TAG, "Storage not initialized");
+        return false;
+    }
+
+    std::string filepath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    if (!appender_.append(filepath, static_cast<const uint8_t *>(data), dataLen))
+    {
+        LOPCORE_LOGE(TAG, "Failed to append to: %s", filepath.c_str());
+        return false;
+    }
+    index_.grow(filepath, dataLen);
+    return true;
+}
+
+bool LittleFsStorage::syncAppends()
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return appender_.syncAll();
+}
+
 bool LittleFsStorage::exists(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -291,13 +419,14 @@ bool LittleFsStorage::exists(const std::string &key)
     }
 
     std::string filepath = getFullPath(key);
+    std::shared_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
     struct stat st;
     return (stat(filepath.c_str(), &st) == 0);
 }
 
 std::vector<std::string> LittleFsStorage::listKeys(const std::string &directory)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     std::vector<std::string> keys;
 
@@ -307,6 +436,15 @@ std::vector<std::string> LittleFsStorage::listKeys(const std::string &directory)
         return keys;
     }
 
+    if (index_.isBuilt())
+    {
+        for (const StorageIndex::Entry &entry : index_.list(directory))
+        {
+            keys.push_back(entry.name);
+        }
+        return keys;
+    }
+
     // Use base path + directory for listing
     std::string searchPath = config_.basePath;
     if (!directory.empty())
@@ -344,7 +482,7 @@ std::vector<std::string> LittleFsStorage::listKeys(const std::string &directory)
 
 bool LittleFsStorage::remove(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -353,6 +491,8 @@ bool LittleFsStorage::remove(const std::string &key)
     }
 
     std::string filepath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
 
     if (unlink(filepath.c_str()) != 0)
     {
@@ -360,6 +500,7 @@ bool LittleFsStorage::remove(const std::string &key)
         return false;
     }
 
+    index_.erase(filepath);
     LOPCORE_LOGD(TAG, "Removed key '%s'", key.c_str());
     return true;
 }
@@ -370,7 +511,7 @@ bool LittleFsStorage::remove(const std::string &key)
 
 size_t LittleFsStorage::getTotalSize() const
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -390,7 +531,7 @@ size_t LittleFsStorage::getTotalSize() const
 
 size_t LittleFsStorage::getUsedSize() const
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -410,7 +551,7 @@ size_t LittleFsStorage::getUsedSize() const
 
 size_t LittleFsStorage::getFreeSize() const
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -444,7 +585,7 @@ bool LittleFsStorage::hasSpace(size_t requiredBytes) const
 
 std::optional<size_t> LittleFsStorage::getFileSize(const std::string &key) const
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -452,6 +593,7 @@ std::optional<size_t> LittleFsStorage::getFileSize(const std::string &key) const
     }
 
     std::string filepath = getFullPath(key);
+    std::shared_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
     struct stat file_stat;
 
     if (stat(filepath.c_str(), &file_stat) != 0)
@@ -487,7 +629,7 @@ void LittleFsStorage::displayStats() const
 std::vector<std::string> LittleFsStorage::listKeysByPattern(const std::string &directory,
                                                             const std::string &pattern)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     std::vector<std::string> matchingKeys;
 
@@ -497,6 +639,18 @@ std::vector<std::string> LittleFsStorage::listKeysByPattern(const std::string &d
         return matchingKeys;
     }
 
+    if (index_.isBuilt())
+    {
+        for (const StorageIndex::Entry &entry : index_.match(directory, pattern))
+        {
+            if (!entry.isDirectory)
+            {
+                matchingKeys.push_back(entry.name);
+            }
+        }
+        return matchingKeys;
+    }
+
     // Use base path + directory for searching
     std::string searchPath = config_.basePath;
     if (!directory.empty())
@@ -523,7 +677,7 @@ std::vector<std::string> LittleFsStorage::listKeysByPattern(const std::string &d
         }
 
         // Check if filename matches pattern
-        if (patternMatch(pattern.c_str(), filename.c_str()))
+        if (globMatch(pattern.c_str(), filename.c_str()))
         {
             // Verify it's a regular file
             std::string fullPath = searchPath + "/" + filename;
@@ -570,7 +724,7 @@ size_t LittleFsStorage::removeByPattern(const std::string &directory, const std:
     // Now delete each matching file
     for (const auto &filename : matchingFiles)
     {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::shared_lock<std::shared_mutex> lock(mutex_);
 
         if (!initialized_)
         {
@@ -579,9 +733,13 @@ size_t LittleFsStorage::removeByPattern(const std::string &directory, const std:
         }
 
         std::string fullPath = searchPath + "/" + filename;
+        std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(fullPath));
 
+        // It may be kept open by append()
+        appender_.close(fullPath);
         if (unlink(fullPath.c_str()) == 0)
         {
+            index_.erase(fullPath);
             LOPCORE_LOGD(TAG, "Deleted: %s", filename.c_str());
             deletedCount++;
         }
@@ -598,7 +756,7 @@ size_t LittleFsStorage::removeByPattern(const std::string &directory, const std:
 
 std::vector<LittleFsStorage::FileInfo> LittleFsStorage::listDetailed(const std::string &directory)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     std::vector<FileInfo> files;
 
@@ -608,6 +766,15 @@ std::vector<LittleFsStorage::FileInfo> LittleFsStorage::listDetailed(const std::
         return files;
     }
 
+    if (index_.isBuilt())
+    {
+        for (const StorageIndex::Entry &entry : index_.list(directory))
+        {
+            files.push_back(FileInfo{entry.name, entry.size, entry.isDirectory});
+        }
+        return files;
+    }
+
     // Use base path + directory for listing
     std::string searchPath = config_.basePath;
     if (!directory.empty())
@@ -661,34 +828,12 @@ std::string LittleFsStorage::getFullPath(const std::string &key) const
     return config_.basePath + "/" + key;
 }
 
-bool LittleFsStorage::patternMatch(const char *pattern, const char *str)
+void LittleFsStorage::buildIndex()
 {
-    const char *star = strchr(pattern, '*');
-
-    if (star == nullptr)
-    {
-        // No wildcard, exact match required
-        return strcmp(pattern, str) == 0;
-    }
-
-    // Match prefix (before *)
-    size_t prefix_len = star - pattern;
-    if (strncmp(pattern, str, prefix_len) != 0)
-    {
-        return false;
-    }
-
-    // Match suffix (after *)
-    const char *suffix = star + 1;
-    size_t suffix_len = strlen(suffix);
-    size_t str_len = strlen(str);
-
-    if (suffix_len > str_len - prefix_len)
+    if (config_.indexFiles && !index_.build(config_.basePath))
     {
-        return false;
+        LOPCORE_LOGW(TAG, "Failed to index %s, listing will scan it", config_.basePath.c_str());
     }
-
-    return strcmp(str + str_len - suffix_len, suffix) == 0;
 }
 
 } // namespace lopcore
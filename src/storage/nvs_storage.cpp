@@ -11,6 +11,8 @@
 
 #include "lopcore/storage/nvs_storage.hpp"
 
+#include <algorithm>
+
 #ifdef ESP_PLATFORM
 #include <esp_log.h>
 #else
@@ -36,29 +38,52 @@ static std::map<std::string, std::map<std::string, std::vector<uint8_t>>> g_nvsD
 #endif
 
 NvsStorage::NvsStorage(const storage::NvsConfig &config)
-    : config_(config), initialized_(false)
+    : config_(config), initialized_(false), batchDepth_(0), pendingWrites_(0)
 #ifdef ESP_PLATFORM
       ,
       handle_(0)
 #endif
 {
     // Don't auto-initialize - let user call initialize() explicitly
+    startCommitTimer();
 }
 
 NvsStorage::NvsStorage(const std::string &namespaceName)
-    : config_(storage::NvsConfig(namespaceName)), initialized_(false)
+    : config_(storage::NvsConfig().setNamespace(namespaceName)), initialized_(false), batchDepth_(0), pendingWrites_(0)
 #ifdef ESP_PLATFORM
       ,
       handle_(0)
 #endif
 {
     // Don't auto-initialize - let user call initialize() explicitly
+    startCommitTimer();
 }
 
 NvsStorage::~NvsStorage()
 {
 #ifdef ESP_PLATFORM
+    if (commitTimer_ != nullptr)
+    {
+        esp_timer_stop(commitTimer_);
+        esp_timer_delete(commitTimer_);
+    }
+
+    // An open batch or a lenient auto-commit policy may have left writes pending
+    if (pendingWrites_ > 0)
+    {
+        commitLocked();
+    }
     closeHandle();
+#else
+    if (commitThread_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        commitWake_.notify_one();
+        commitThread_.join();
+    }
 #endif
 }
 
@@ -83,10 +108,16 @@ bool NvsStorage::initialize()
     }
 
     ESP_LOGI(TAG, "NVS initialized with namespace: %s", config_.namespaceName.c_str());
+    initialized_ = true;
+
+    // Kept open until destruction. A read-only namespace that does not exist
+    // yet cannot be opened; operations retry and report that themselves.
+    openHandle();
     return true;
 #else
     // Host: Mock initialization
     ESP_LOGI(TAG, "NVS initialized (mock) with namespace: %s", config_.namespaceName.c_str());
+    initialized_ = true;
     return true;
 #endif
 }
@@ -157,12 +188,11 @@ bool NvsStorage::write(const std::string &key, const std::string &data)
         ESP_LOGE(TAG, "Failed to write key '%s': %d", key.c_str(), ret);
         return false;
     }
+    cacheStore(key, false, reinterpret_cast<const uint8_t *>(data.data()), data.size());
 
-    // Commit to flash
-    ret = nvs_commit(handle_);
-    if (ret != ESP_OK)
+    // Committed now, or later with the batch or by the auto-commit policy
+    if (!commitIfDue())
     {
-        ESP_LOGE(TAG, "Failed to commit NVS: %d", ret);
         return false;
     }
 
@@ -173,12 +203,18 @@ bool NvsStorage::write(const std::string &key, const std::string &data)
     std::vector<uint8_t> bytes(data.begin(), data.end());
     bytes.push_back('\0'); // Null terminator
     g_nvsData[config_.namespaceName][key] = bytes;
+    cacheStore(key, false, reinterpret_cast<const uint8_t *>(data.data()), data.size());
     ESP_LOGI(TAG, "Wrote string key '%s' (%zu bytes) [MOCK]", key.c_str(), data.length());
-    return true;
+    return commitIfDue();
 #endif
 }
 
 bool NvsStorage::write(const std::string &key, const std::vector<uint8_t> &data)
+{
+    return writeBinary(key, data.data(), data.size());
+}
+
+bool NvsStorage::writeBinary(const std::string &key, const uint8_t *data, size_t size)
 {
     std::lock_guard<std::mutex> lock(mutex_);
 
@@ -188,7 +224,7 @@ bool NvsStorage::write(const std::string &key, const std::vector<uint8_t> &data)
         return false;
     }
 
-    if (!isValidKey(key))
+    if (!isValidKey(key) || (data == nullptr && size > 0))
     {
         return false;
     }
@@ -199,107 +235,281 @@ bool NvsStorage::write(const std::string &key, const std::vector<uint8_t> &data)
         return false;
     }
 
-    esp_err_t ret = nvs_set_blob(handle_, key.c_str(), data.data(), data.size());
+    esp_err_t ret = nvs_set_blob(handle_, key.c_str(), data, size);
     if (ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to write binary key '%s': %d", key.c_str(), ret);
         return false;
     }
+    cacheStore(key, true, data, size);
 
-    // Commit to flash
-    ret = nvs_commit(handle_);
-    if (ret != ESP_OK)
+    // Committed now, or later with the batch or by the auto-commit policy
+    if (!commitIfDue())
     {
-        ESP_LOGE(TAG, "Failed to commit NVS: %d", ret);
         return false;
     }
 
-    ESP_LOGI(TAG, "Wrote binary key '%s' (%zu bytes)", key.c_str(), data.size());
+    ESP_LOGI(TAG, "Wrote binary key '%s' (%zu bytes)", key.c_str(), size);
     return true;
 #else
     // Host mock
-    g_nvsData[config_.namespaceName][key] = data;
-    ESP_LOGI(TAG, "Wrote binary key '%s' (%zu bytes) [MOCK]", key.c_str(), data.size());
+    g_nvsData[config_.namespaceName][key].assign(data, data + size);
+    cacheStore(key, true, data, size);
+    ESP_LOGI(TAG, "Wrote binary key '%s' (%zu bytes) [MOCK]", key.c_str(), size);
+    return commitIfDue();
+#endif
+}
+
+bool NvsStorage::setScalar(const std::string &key, ScalarType type, uint64_t bits)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!initialized_)
+    {
+        ESP_LOGE(TAG, "Storage not initialized");
+        return false;
+    }
+
+    if (!isValidKey(key))
+    {
+        return false;
+    }
+
+    // Scalars are not cached; drop any string or blob cached under the key
+    cacheErase(key);
+
+#ifdef ESP_PLATFORM
+    if (!openHandle())
+    {
+        return false;
+    }
+
+    // Narrowing casts keep the low bytes, which is the value that was widened
+    esp_err_t ret = ESP_FAIL;
+    switch (type)
+    {
+        case ScalarType::U8:
+            ret = nvs_set_u8(handle_, key.c_str(), static_cast<uint8_t>(bits));
+            break;
+        case ScalarType::I8:
+            ret = nvs_set_i8(handle_, key.c_str(), static_cast<int8_t>(bits));
+            break;
+        case ScalarType::U16:
+            ret = nvs_set_u16(handle_, key.c_str(), static_cast<uint16_t>(bits));
+            break;
+        case ScalarType::I16:
+            ret = nvs_set_i16(handle_, key.c_str(), static_cast<int16_t>(bits));
+            break;
+        case ScalarType::U32:
+            ret = nvs_set_u32(handle_, key.c_str(), static_cast<uint32_t>(bits));
+            break;
+        case ScalarType::I32:
+            ret = nvs_set_i32(handle_, key.c_str(), static_cast<int32_t>(bits));
+            break;
+        case ScalarType::U64:
+            ret = nvs_set_u64(handle_, key.c_str(), bits);
+            break;
+        case ScalarType::I64:
+            ret = nvs_set_i64(handle_, key.c_str(), static_cast<int64_t>(bits));
+            break;
+    }
+
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to write scalar key '%s': %d", key.c_str(), ret);
+        return false;
+    }
+
+    // Committed now, or later with the batch or by the auto-commit policy
+    if (!commitIfDue())
+    {
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Wrote scalar key '%s'", key.c_str());
     return true;
+#else
+    // Host mock: the value's bytes, little-endian
+    size_t width = scalarWidth(type);
+    std::vector<uint8_t> bytes(width);
+    for (size_t i = 0; i < width; ++i)
+    {
+        bytes[i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+    g_nvsData[config_.namespaceName][key] = bytes;
+    ESP_LOGI(TAG, "Wrote scalar key '%s' [MOCK]", key.c_str());
+    return commitIfDue();
 #endif
 }
 
-std::optional<std::string> NvsStorage::read(const std::string &key)
+bool NvsStorage::getScalar(const std::string &key, ScalarType type, uint64_t &bits)
 {
     std::lock_guard<std::mutex> lock(mutex_);
 
     if (!initialized_)
     {
         ESP_LOGE(TAG, "Storage not initialized");
-        return std::nullopt;
+        return false;
     }
 
     if (!isValidKey(key))
     {
-        return std::nullopt;
+        return false;
     }
 
 #ifdef ESP_PLATFORM
     if (!openHandle())
     {
-        return std::nullopt;
+        return false;
+    }
+
+    esp_err_t ret = ESP_FAIL;
+    switch (type)
+    {
+        case ScalarType::U8:
+        {
+            uint8_t value = 0;
+            ret = nvs_get_u8(handle_, key.c_str(), &value);
+            bits = value;
+            break;
+        }
+        case ScalarType::I8:
+        {
+            int8_t value = 0;
+            ret = nvs_get_i8(handle_, key.c_str(), &value);
+            bits = static_cast<uint64_t>(value);
+            break;
+        }
+        case ScalarType::U16:
+        {
+            uint16_t value = 0;
+            ret = nvs_get_u16(handle_, key.c_str(), &value);
+            bits = value;
+            break;
+        }
+        case ScalarType::I16:
+        {
+            int16_t value = 0;
+            ret = nvs_get_i16(handle_, key.c_str(), &value);
+            bits = static_cast<uint64_t>(value);
+            break;
+        }
+        case ScalarType::U32:
+        {
+            uint32_t value = 0;
+            ret = nvs_get_u32(handle_, key.c_str(), &value);
+            bits = value;
+            break;
+        }
+        case ScalarType::I32:
+        {
+            int32_t value = 0;
+            ret = nvs_get_i32(handle_, key.c_str(), &value);
+            bits = static_cast<uint64_t>(value);
+            break;
+        }
+        case ScalarType::U64:
+            ret = nvs_get_u64(handle_, key.c_str(), &bits);
+            break;
+        case ScalarType::I64:
+        {
+            int64_t value = 0;
+            ret = nvs_get_i64(handle_, key.c_str(), &value);
+            bits = static_cast<uint64_t>(value);
+            break;
+        }
     }
 
-    // First, get the required size
-    size_t requiredSize = 0;
-    esp_err_t ret = nvs_get_str(handle_, key.c_str(), nullptr, &requiredSize);
     if (ret == ESP_ERR_NVS_NOT_FOUND)
     {
         ESP_LOGE(TAG, "Key not found: '%s'", key.c_str());
-        return std::nullopt;
+        return false;
     }
-    else if (ret != ESP_OK)
+    if (ret != ESP_OK)
     {
-        ESP_LOGE(TAG, "Failed to get size for key '%s': %d", key.c_str(), ret);
-        return std::nullopt;
+        ESP_LOGE(TAG, "Failed to read scalar key '%s': %d", key.c_str(), ret);
+        return false;
+    }
+    return true;
+#else
+    // Host mock: a value of another width stands in for NVS's type mismatch
+    auto nsIt = g_nvsData.find(config_.namespaceName);
+    if (nsIt == g_nvsData.end())
+    {
+        return false;
     }
 
-    // Allocate buffer and read
-    std::string value(requiredSize - 1, '\0'); // -1 for null terminator
-    ret = nvs_get_str(handle_, key.c_str(), &value[0], &requiredSize);
-    if (ret != ESP_OK)
+    auto keyIt = nsIt->second.find(key);
+    if (keyIt == nsIt->second.end() || keyIt->second.size() != scalarWidth(type))
     {
-        ESP_LOGE(TAG, "Failed to read key '%s': %d", key.c_str(), ret);
-        return std::nullopt;
+        ESP_LOGE(TAG, "Key not found: '%s'", key.c_str());
+        return false;
     }
 
-    ESP_LOGI(TAG, "Read string key '%s' (%zu bytes)", key.c_str(), value.length());
-    return value;
+    bits = 0;
+    for (size_t i = 0; i < keyIt->second.size(); ++i)
+    {
+        bits |= static_cast<uint64_t>(keyIt->second[i]) << (8 * i);
+    }
+    return true;
+#endif
+}
+
+NvsStorage::ReadResult NvsStorage::readValue(const std::string &key, bool blob, void *buffer, size_t &length)
+{
+#ifdef ESP_PLATFORM
+    if (!openHandle())
+    {
+        return ReadResult::FAILED;
+    }
+
+    // A too-small buffer fails with the needed size in length, so one lookup answers both
+    esp_err_t ret = blob ? nvs_get_blob(handle_, key.c_str(), buffer, &length)
+                         : nvs_get_str(handle_, key.c_str(), static_cast<char *>(buffer), &length);
+    if (ret == ESP_OK)
+    {
+        return ReadResult::OK;
+    }
+    if (ret == ESP_ERR_NVS_NOT_FOUND)
+    {
+        return ReadResult::NOT_FOUND;
+    }
+    if (ret == ESP_ERR_NVS_INVALID_LENGTH)
+    {
+        return ReadResult::TOO_SMALL;
+    }
+
+    ESP_LOGE(TAG, "Failed to read key '%s': %d", key.c_str(), ret);
+    return ReadResult::FAILED;
 #else
-    // Host mock
+    // Host mock, with the same length semantics (strings are stored NUL-terminated)
+    (void)blob;
     auto nsIt = g_nvsData.find(config_.namespaceName);
     if (nsIt == g_nvsData.end())
     {
-        ESP_LOGE(TAG, "Namespace not found: '%s'", config_.namespaceName.c_str());
-        return std::nullopt;
+        return ReadResult::NOT_FOUND;
     }
 
     auto keyIt = nsIt->second.find(key);
     if (keyIt == nsIt->second.end())
     {
-        ESP_LOGE(TAG, "Key not found: '%s'", key.c_str());
-        return std::nullopt;
+        return ReadResult::NOT_FOUND;
     }
 
-    // Convert bytes to string (remove null terminator if present)
-    const auto &bytes = keyIt->second;
-    std::string value(bytes.begin(), bytes.end());
-    if (!value.empty() && value.back() == '\0')
+    const std::vector<uint8_t> &bytes = keyIt->second;
+    if (length < bytes.size())
     {
-        value.pop_back();
+        length = bytes.size();
+        return ReadResult::TOO_SMALL;
     }
 
-    ESP_LOGI(TAG, "Read string key '%s' (%zu bytes) [MOCK]", key.c_str(), value.length());
-    return value;
+    std::copy(bytes.begin(), bytes.end(), static_cast<uint8_t *>(buffer));
+    length = bytes.size();
+    return ReadResult::OK;
 #endif
 }
 
-std::optional<std::vector<uint8_t>> NvsStorage::readBinary(const std::string &key)
+std::optional<std::string> NvsStorage::read(const std::string &key)
 {
     std::lock_guard<std::mutex> lock(mutex_);
 
@@ -314,56 +524,178 @@ std::optional<std::vector<uint8_t>> NvsStorage::readBinary(const std::string &ke
         return std::nullopt;
     }
 
-#ifdef ESP_PLATFORM
-    if (!openHandle())
+    if (const CacheEntry *entry = cacheFind(key, false))
     {
-        return std::nullopt;
+        return std::string(entry->value.begin(), entry->value.end());
     }
 
-    // First, get the required size
-    size_t requiredSize = 0;
-    esp_err_t ret = nvs_get_blob(handle_, key.c_str(), nullptr, &requiredSize);
-    if (ret == ESP_ERR_NVS_NOT_FOUND)
+    // Small values take one lookup into the stack; larger ones a second into the string
+    char small[SMALL_VALUE_SIZE];
+    size_t length = sizeof(small);
+    ReadResult result = readValue(key, false, small, length);
+
+    std::string value;
+    if (result == ReadResult::OK)
+    {
+        value.assign(small, length > 0 ? length - 1 : 0); // -1 for null terminator
+    }
+    else if (result == ReadResult::TOO_SMALL)
+    {
+        value.assign(length, '\0');
+        result = readValue(key, false, &value[0], length);
+        value.resize(length > 0 ? length - 1 : 0);
+    }
+
+    if (result == ReadResult::NOT_FOUND)
     {
         ESP_LOGE(TAG, "Key not found: '%s'", key.c_str());
         return std::nullopt;
     }
-    else if (ret != ESP_OK)
+    if (result != ReadResult::OK)
     {
-        ESP_LOGE(TAG, "Failed to get size for key '%s': %d", key.c_str(), ret);
         return std::nullopt;
     }
 
-    // Allocate buffer and read
-    std::vector<uint8_t> data(requiredSize);
-    ret = nvs_get_blob(handle_, key.c_str(), data.data(), &requiredSize);
-    if (ret != ESP_OK)
+    cacheStore(key, false, reinterpret_cast<const uint8_t *>(value.data()), value.size());
+    ESP_LOGI(TAG, "Read string key '%s' (%zu bytes)", key.c_str(), value.length());
+    return value;
+}
+
+bool NvsStorage::read(const std::string &key, char *buffer, size_t capacity, size_t *length)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!initialized_)
+    {
+        ESP_LOGE(TAG, "Storage not initialized");
+        return false;
+    }
+
+    if (!isValidKey(key) || buffer == nullptr || length == nullptr)
+    {
+        return false;
+    }
+
+    if (const CacheEntry *entry = cacheFind(key, false))
+    {
+        if (capacity < entry->value.size() + 1)
+        {
+            *length = entry->value.size() + 1;
+            return false;
+        }
+        std::copy(entry->value.begin(), entry->value.end(), buffer);
+        buffer[entry->value.size()] = '\0';
+        *length = entry->value.size();
+        return true;
+    }
+
+    size_t size = capacity;
+    ReadResult result = readValue(key, false, buffer, size);
+    if (result == ReadResult::TOO_SMALL)
     {
-        ESP_LOGE(TAG, "Failed to read key '%s': %d", key.c_str(), ret);
+        *length = size; // Capacity needed, terminator included
+        return false;
+    }
+    if (result != ReadResult::OK)
+    {
+        return false;
+    }
+
+    *length = size > 0 ? size - 1 : 0;
+    cacheStore(key, false, reinterpret_cast<const uint8_t *>(buffer), *length);
+    return true;
+}
+
+std::optional<std::vector<uint8_t>> NvsStorage::readBinary(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!initialized_)
+    {
+        ESP_LOGE(TAG, "Storage not initialized");
         return std::nullopt;
     }
 
-    ESP_LOGI(TAG, "Read binary key '%s' (%zu bytes)", key.c_str(), data.size());
-    return data;
-#else
-    // Host mock
-    auto nsIt = g_nvsData.find(config_.namespaceName);
-    if (nsIt == g_nvsData.end())
+    if (!isValidKey(key))
     {
-        ESP_LOGE(TAG, "Namespace not found: '%s'", config_.namespaceName.c_str());
         return std::nullopt;
     }
 
-    auto keyIt = nsIt->second.find(key);
-    if (keyIt == nsIt->second.end())
+    if (const CacheEntry *entry = cacheFind(key, true))
+    {
+        return entry->value;
+    }
+
+    uint8_t small[SMALL_VALUE_SIZE];
+    size_t length = sizeof(small);
+    ReadResult result = readValue(key, true, small, length);
+
+    std::vector<uint8_t> data;
+    if (result == ReadResult::OK)
+    {
+        data.assign(small, small + length);
+    }
+    else if (result == ReadResult::TOO_SMALL)
+    {
+        data.resize(length);
+        result = readValue(key, true, data.data(), length);
+        data.resize(length);
+    }
+
+    if (result == ReadResult::NOT_FOUND)
     {
         ESP_LOGE(TAG, "Key not found: '%s'", key.c_str());
         return std::nullopt;
     }
+    if (result != ReadResult::OK)
+    {
+        return std::nullopt;
+    }
 
-    ESP_LOGI(TAG, "Read binary key '%s' (%zu bytes) [MOCK]", key.c_str(), keyIt->second.size());
-    return keyIt->second;
-#endif
+    cacheStore(key, true, data.data(), data.size());
+    ESP_LOGI(TAG, "Read binary key '%s' (%zu bytes)", key.c_str(), data.size());
+    return data;
+}
+
+bool NvsStorage::readBinary(const std::string &key, uint8_t *buffer, size_t capacity, size_t *length)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!initialized_)
+    {
+        ESP_LOGE(TAG, "Storage not initialized");
+        return false;
+    }
+
+    if (!isValidKey(key) || (buffer == nullptr && capacity > 0) || length == nullptr)
+    {
+        return false;
+    }
+
+    if (const CacheEntry *entry = cacheFind(key, true))
+    {
+        *length = entry->value.size();
+        if (capacity < entry->value.size())
+        {
+            return false;
+        }
+        std::copy(entry->value.begin(), entry->value.end(), buffer);
+        return true;
+    }
+
+    size_t size = capacity;
+    ReadResult result = readValue(key, true, buffer, size);
+    if (result == ReadResult::TOO_SMALL || result == ReadResult::OK)
+    {
+        *length = size;
+    }
+    if (result != ReadResult::OK)
+    {
+        return false;
+    }
+
+    cacheStore(key, true, buffer, size);
+    return true;
 }
 
 bool NvsStorage::exists(const std::string &key)
@@ -386,16 +718,8 @@ bool NvsStorage::exists(const std::string &key)
         return false;
     }
 
-    // Try to get size - if key doesn't exist, will return ESP_ERR_NVS_NOT_FOUND
-    size_t requiredSize = 0;
-    esp_err_t ret = nvs_get_str(handle_, key.c_str(), nullptr, &requiredSize);
-    if (ret == ESP_ERR_NVS_NOT_FOUND)
-    {
-        // Try as blob
-        ret = nvs_get_blob(handle_, key.c_str(), nullptr, &requiredSize);
-    }
-
-    return (ret == ESP_OK);
+    // One lookup whatever the value's type
+    return nvs_find_key(handle_, key.c_str(), nullptr) == ESP_OK;
 #else
     // Host mock
     auto nsIt = g_nvsData.find(config_.namespaceName);
@@ -457,6 +781,8 @@ bool NvsStorage::remove(const std::string &key)
         return false;
     }
 
+    cacheErase(key);
+
 #ifdef ESP_PLATFORM
     if (!openHandle())
     {
@@ -476,11 +802,9 @@ bool NvsStorage::remove(const std::string &key)
         return false;
     }
 
-    // Commit to flash
-    ret = nvs_commit(handle_);
-    if (ret != ESP_OK)
+    // Committed now, or later with the batch or by the auto-commit policy
+    if (!commitIfDue())
     {
-        ESP_LOGE(TAG, "Failed to commit NVS: %d", ret);
         return false;
     }
 
@@ -495,7 +819,7 @@ bool NvsStorage::remove(const std::string &key)
     }
 
     ESP_LOGI(TAG, "Removed key: '%s' [MOCK]", key.c_str());
-    return true;
+    return commitIfDue();
 #endif
 }
 
@@ -528,6 +852,10 @@ bool NvsStorage::eraseNamespace()
         return false;
     }
 
+    cache_.clear();
+    cacheIndex_.clear();
+    cacheStats_.entries = 0;
+
 #ifdef ESP_PLATFORM
     if (!openHandle())
     {
@@ -541,11 +869,9 @@ bool NvsStorage::eraseNamespace()
         return false;
     }
 
-    // Commit to flash
-    ret = nvs_commit(handle_);
-    if (ret != ESP_OK)
+    // Committed now, or later with the batch or by the auto-commit policy
+    if (!commitIfDue())
     {
-        ESP_LOGE(TAG, "Failed to commit NVS: %d", ret);
         return false;
     }
 
@@ -555,7 +881,7 @@ bool NvsStorage::eraseNamespace()
     // Host mock
     g_nvsData[config_.namespaceName].clear();
     ESP_LOGI(TAG, "Erased namespace: '%s' [MOCK]", config_.namespaceName.c_str());
-    return true;
+    return commitIfDue();
 #endif
 }
 
@@ -563,6 +889,154 @@ bool NvsStorage::commit()
 {
     std::lock_guard<std::mutex> lock(mutex_);
 
+    if (!commitLocked())
+    {
+        return false;
+    }
+
+#ifdef ESP_PLATFORM
+    ESP_LOGI(TAG, "Committed NVS changes");
+#else
+    ESP_LOGI(TAG, "Committed NVS changes [MOCK]");
+#endif
+    return true;
+}
+
+bool NvsStorage::beginBatch()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!initialized_)
+    {
+        ESP_LOGE(TAG, "Storage not initialized");
+        return false;
+    }
+
+    batchDepth_++;
+    return true;
+}
+
+bool NvsStorage::commitBatch()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (batchDepth_ == 0)
+    {
+        ESP_LOGE(TAG, "No batch to commit");
+        return false;
+    }
+
+    // Inner batches commit with the outermost one
+    if (--batchDepth_ > 0 || pendingWrites_ == 0)
+    {
+        return true;
+    }
+
+    [[maybe_unused]] size_t batched = pendingWrites_;
+    if (!commitLocked())
+    {
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Committed batch of %zu writes", batched);
+    return true;
+}
+
+size_t NvsStorage::pendingWrites() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pendingWrites_;
+}
+
+NvsCacheStats NvsStorage::getCacheStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cacheStats_;
+}
+
+const NvsStorage::CacheEntry *NvsStorage::cacheFind(const std::string &key, bool blob)
+{
+    if (config_.cacheEntries == 0)
+    {
+        return nullptr;
+    }
+
+    auto it = cacheIndex_.find(key);
+    if (it == cacheIndex_.end() || it->second->blob != blob)
+    {
+        cacheStats_.misses++;
+        return nullptr;
+    }
+
+    cache_.splice(cache_.begin(), cache_, it->second);
+    cacheStats_.hits++;
+    return &cache_.front();
+}
+
+void NvsStorage::cacheStore(const std::string &key, bool blob, const uint8_t *data, size_t size)
+{
+    if (config_.cacheEntries == 0)
+    {
+        return;
+    }
+
+    auto it = cacheIndex_.find(key);
+    if (it != cacheIndex_.end())
+    {
+        cache_.splice(cache_.begin(), cache_, it->second);
+    }
+    else
+    {
+        if (cache_.size() >= config_.cacheEntries)
+        {
+            cacheIndex_.erase(cache_.back().key);
+            cache_.pop_back();
+            cacheStats_.evictions++;
+        }
+        cache_.push_front(CacheEntry{key, blob, {}});
+        cacheIndex_[key] = cache_.begin();
+    }
+
+    CacheEntry &entry = cache_.front();
+    entry.blob = blob;
+    entry.value.assign(data, data + size);
+    cacheStats_.entries = cache_.size();
+}
+
+void NvsStorage::cacheErase(const std::string &key)
+{
+    auto it = cacheIndex_.find(key);
+    if (it == cacheIndex_.end())
+    {
+        return;
+    }
+
+    cache_.erase(it->second);
+    cacheIndex_.erase(it);
+    cacheStats_.entries = cache_.size();
+}
+
+bool NvsStorage::commitIfDue()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (pendingWrites_++ == 0)
+    {
+        firstPending_ = now;
+        armCommitTimer();
+    }
+
+    if (batchDepth_ > 0)
+    {
+        return true;
+    }
+
+    bool countDue = config_.autoCommitWrites > 0 && pendingWrites_ >= config_.autoCommitWrites;
+    bool ageDue = config_.autoCommitInterval.count() > 0 && now - firstPending_ >= config_.autoCommitInterval;
+    return (countDue || ageDue) ? commitLocked() : true;
+}
+
+bool NvsStorage::commitLocked()
+{
 #ifdef ESP_PLATFORM
     if (!openHandle())
     {
@@ -575,14 +1049,92 @@ bool NvsStorage::commit()
         ESP_LOGE(TAG, "Failed to commit NVS: %d", ret);
         return false;
     }
+#endif
 
-    ESP_LOGI(TAG, "Committed NVS changes");
+    // Host mock: writes land in g_nvsData immediately, only the count is kept
+    pendingWrites_ = 0;
     return true;
+}
+
+void NvsStorage::startCommitTimer()
+{
+    if (config_.autoCommitInterval.count() <= 0)
+    {
+        return;
+    }
+
+#ifdef ESP_PLATFORM
+    esp_timer_create_args_t args = {};
+    args.callback = commitTimerEntry;
+    args.arg = this;
+    args.name = "nvs_commit";
+    if (esp_timer_create(&args, &commitTimer_) != ESP_OK)
+    {
+        commitTimer_ = nullptr;
+        ESP_LOGE(TAG, "Failed to create commit timer; interval checked on writes only");
+    }
 #else
-    // Host mock - no-op
-    ESP_LOGI(TAG, "Committed NVS changes [MOCK]");
-    return true;
+    commitThread_ = std::thread(&NvsStorage::commitWorker, this);
+#endif
+}
+
+void NvsStorage::armCommitTimer()
+{
+#ifdef ESP_PLATFORM
+    if (commitTimer_ != nullptr)
+    {
+        esp_timer_stop(commitTimer_);
+        auto interval = std::chrono::duration_cast<std::chrono::microseconds>(config_.autoCommitInterval);
+        esp_timer_start_once(commitTimer_, static_cast<uint64_t>(interval.count()));
+    }
+#else
+    commitWake_.notify_one();
 #endif
 }
 
+void NvsStorage::commitOnTimer()
+{
+    if (pendingWrites_ == 0)
+    {
+        return;
+    }
+
+    if (batchDepth_ == 0 && commitLocked())
+    {
+        return;
+    }
+
+    firstPending_ = std::chrono::steady_clock::now();
+    armCommitTimer();
+}
+
+#ifdef ESP_PLATFORM
+void NvsStorage::commitTimerEntry(void *arg)
+{
+    NvsStorage *self = static_cast<NvsStorage *>(arg);
+    std::lock_guard<std::mutex> lock(self->mutex_);
+    self->commitOnTimer();
+}
+#else
+void NvsStorage::commitWorker()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_)
+    {
+        if (pendingWrites_ == 0)
+        {
+            commitWake_.wait(lock);
+            continue;
+        }
+
+        auto deadline = firstPending_ + config_.autoCommitInterval;
+        if (commitWake_.wait_until(lock, deadline) == std::cv_status::timeout && !stopping_ &&
+            std::chrono::steady_clock::now() >= firstPending_ + config_.autoCommitInterval)
+        {
+            commitOnTimer();
+        }
+    }
+}
+#endif
+
 } // namespace lopcore
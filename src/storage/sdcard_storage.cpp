@@ -11,6 +11,7 @@
 #include <dirent.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <sstream>
@@ -18,9 +19,14 @@
 #include "driver/sdspi_host.h"
 #include "lopcore/logging/logger.hpp"
 
+#include "esp_idf_version.h"
 #include "esp_vfs_fat.h"
 #include "sdmmc_cmd.h"
 
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 1, 0)
+#include "diskio_sdmmc.h"
+#endif
+
 namespace lopcore
 {
 
@@ -32,7 +38,7 @@ static const char *FILE_EXTENSION = ".txt";
 // ============================================================================
 
 SdCardStorage::SdCardStorage(const storage::SdCardConfig &config)
-    : config_(config), initialized_(false), card_(nullptr)
+    : config_(config), initialized_(false), card_(nullptr), appender_(config_.append)
 {
     LOPCORE_LOGI(TAG, "Creating SD card storage with mount point: %s", config_.mountPoint.c_str());
 }
@@ -41,10 +47,13 @@ SdCardStorage::~SdCardStorage()
 {
     if (initialized_)
     {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::unique_lock<std::shared_mutex> lock(mutex_);
 
         LOPCORE_LOGI(TAG, "Cleaning up SD card storage");
 
+        // Before unmounting, while the files can still be flushed
+        appender_.closeAll();
+
         // Unmount
         esp_err_t ret = esp_vfs_fat_sdcard_unmount(config_.mountPoint.c_str(), card_);
         if (ret != ESP_OK)
@@ -69,7 +78,7 @@ SdCardStorage::~SdCardStorage()
 
 bool SdCardStorage::initialize()
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_lock<std::shared_mutex> lock(mutex_);
 
     if (initialized_)
     {
@@ -189,6 +198,7 @@ bool SdCardStorage::initialize()
         LOPCORE_LOGI(TAG, "Used size: %zu KB", getUsedSize() / 1024);
     }
 
+    buildIndex();
     return true;
 }
 
@@ -198,7 +208,7 @@ bool SdCardStorage::initialize()
 
 bool SdCardStorage::write(const std::string &key, const std::string &data)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -207,6 +217,8 @@ bool SdCardStorage::write(const std::string &key, const std::string &data)
     }
 
     std::string filepath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
 
     std::ofstream file(filepath, std::ios::out | std::ios::trunc);
     if (!file.is_open())
@@ -224,13 +236,56 @@ bool SdCardStorage::write(const std::string &key, const std::string &data)
         return false;
     }
 
+    index_.update(filepath, data.size());
+    consumeSpace(data.size());
     LOPCORE_LOGD(TAG, "Wrote %zu bytes to key '%s'", data.size(), key.c_str());
     return true;
 }
 
+bool SdCardStorage::writeAtomic(const std::string &key, const std::string &data, bool keepBackup)
+{
+    return writeAtomic(key, data.data(), data.size(), keepBackup);
+}
+
+bool SdCardStorage::writeAtomic(const std::string &key, const std::vector<uint8_t> &data, bool keepBackup)
+{
+    return writeAtomic(key, data.data(), data.size(), keepBackup);
+}
+
+bool SdCardStorage::writeAtomic(const std::string &key, const void *data, size_t dataLen, bool keepBackup)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    if (!initialized_)
+    {
+        LOPCORE_LOGE(TAG, "Cannot write: storage not initialized");
+        return false;
+    }
+
+    std::string filepath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
+
+    if (!writeFileAtomic(filepath, static_cast<const uint8_t *>(data), dataLen, keepBackup))
+    {
+        LOPCORE_LOGE(TAG, "Failed to write atomically: %s", filepath.c_str());
+        return false;
+    }
+
+    if (keepBackup)
+    {
+        index_.erase(filepath + ".bak");
+        index_.rename(filepath, filepath + ".bak");
+    }
+    index_.update(filepath, dataLen);
+    consumeSpace(dataLen);
+    LOPCORE_LOGD(TAG, "Wrote %zu bytes atomically to key '%s'", dataLen, key.c_str());
+    return true;
+}
+
 std::optional<std::string> SdCardStorage::read(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -239,6 +294,8 @@ std::optional<std::string> SdCardStorage::read(const std::string &key)
     }
 
     std::string filepath = getFullPath(key);
+    std::shared_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
 
     std::ifstream file(filepath);
     if (!file.is_open())
@@ -259,7 +316,7 @@ std::optional<std::string> SdCardStorage::read(const std::string &key)
 
 bool SdCardStorage::write(const std::string &key, const std::vector<uint8_t> &data)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -268,6 +325,8 @@ bool SdCardStorage::write(const std::string &key, const std::vector<uint8_t> &da
     }
 
     std::string filepath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
 
     std::ofstream file(filepath, std::ios::out | std::ios::binary | std::ios::trunc);
     if (!file.is_open())
@@ -285,13 +344,15 @@ bool SdCardStorage::write(const std::string &key, const std::vector<uint8_t> &da
         return false;
     }
 
+    index_.update(filepath, data.size());
+    consumeSpace(data.size());
     LOPCORE_LOGD(TAG, "Wrote %zu bytes (binary) to key '%s'", data.size(), key.c_str());
     return true;
 }
 
 std::optional<std::vector<uint8_t>> SdCardStorage::readBinary(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -300,6 +361,8 @@ std::optional<std::vector<uint8_t>> SdCardStorage::readBinary(const std::string
     }
 
     std::string filepath = getFullPath(key);
+    std::shared_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
 
     std::ifstream file(filepath, std::ios::in | std::ios::binary | std::ios::ate);
     if (!file.is_open())
@@ -324,9 +387,80 @@ std::optional<std::vector<uint8_t>> SdCardStorage::readBinary(const std::string
     return data;
 }
 
+StorageReader SdCardStorage::openReader(const std::string &key, size_t bufferSize)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    if (!initialized_)
+    {
+        LOPCORE_LOGE(TAG, "Storage not initialized");
+        return StorageReader();
+    }
+
+    std::string filepath = getFullPath(key);
+    std::shared_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
+    return StorageReader(filepath, bufferSize);
+}
+
+StorageWriter SdCardStorage::openWriter(const std::string &key, bool append, size_t bufferSize)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    if (!initialized_)
+    {
+        LOPCORE_LOGE(TAG, "Storage not initialized");
+        return StorageWriter();
+    }
+
+    std::string filepath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
+    index_.invalidate(filepath);
+    return StorageWriter(filepath, append, bufferSize);
+}
+
+bool SdCardStorage::append(const std::string &key, const std::string &data)
+{
+    return append(key, data.data(), data.size());
+}
+
+bool SdCardStorage::append(const std::string &key, const std::vector<uint8_t> &data)
+{
+    return append(key, data.data(), data.size());
+}
+
+bool SdCardStorage::append(const std::string &key, const void *data, size_t dataLen)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    if (!initialized_)
+    {
+        LOPCORE_LOGE(TAG, "Storage not initialized");
+        return false;
+    }
+
+    std::string filepath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    if (!appender_.append(filepath, static_cast<const uint8_t *>(data), dataLen))
+    {
+        LOPCORE_LOGE(TAG, "Failed to append to: %s", filepath.c_str());
+        return false;
+    }
+    index_.grow(filepath, dataLen);
+    consumeSpace(dataLen);
+    return true;
+}
+
+bool SdCardStorage::syncAppends()
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return appender_.syncAll();
+}
+
 bool SdCardStorage::exists(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -334,13 +468,14 @@ bool SdCardStorage::exists(const std::string &key)
     }
 
     std::string filepath = getFullPath(key);
+    std::shared_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
     struct stat st;
     return (stat(filepath.c_str(), &st) == 0);
 }
 
 std::vector<std::string> SdCardStorage::listKeys(const std::string &directory)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     std::vector<std::string> keys;
 
@@ -350,31 +485,45 @@ std::vector<std::string> SdCardStorage::listKeys(const std::string &directory)
         return keys;
     }
 
-    // Use mount point + directory for listing
-    std::string searchPath = config_.mountPoint;
-    if (!directory.empty())
+    std::vector<std::string> filenames;
+    if (index_.isBuilt())
     {
-        searchPath += "/" + directory;
+        for (const StorageIndex::Entry &entry : index_.list(directory))
+        {
+            filenames.push_back(entry.name);
+        }
     }
-
-    DIR *dir = opendir(searchPath.c_str());
-    if (!dir)
+    else
     {
-        LOPCORE_LOGE(TAG, "Failed to open directory: %s", searchPath.c_str());
-        return keys;
-    }
+        // Use mount point + directory for listing
+        std::string searchPath = config_.mountPoint;
+        if (!directory.empty())
+        {
+            searchPath += "/" + directory;
+        }
 
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != nullptr)
-    {
-        std::string filename = entry->d_name;
+        DIR *dir = opendir(searchPath.c_str());
+        if (!dir)
+        {
+            LOPCORE_LOGE(TAG, "Failed to open directory: %s", searchPath.c_str());
+            return keys;
+        }
 
-        // Skip . and ..
-        if (filename == "." || filename == "..")
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != nullptr)
         {
-            continue;
+            // Skip . and ..
+            if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+            {
+                filenames.push_back(entry->d_name);
+            }
         }
 
+        closedir(dir);
+    }
+
+    for (std::string &filename : filenames)
+    {
         // Remove file extension if it matches
         if (filename.size() > strlen(FILE_EXTENSION))
         {
@@ -388,7 +537,6 @@ std::vector<std::string> SdCardStorage::listKeys(const std::string &directory)
         keys.push_back(filename);
     }
 
-    closedir(dir);
     LOPCORE_LOGD(TAG, "Found %zu keys", keys.size());
 
     return keys;
@@ -396,7 +544,7 @@ std::vector<std::string> SdCardStorage::listKeys(const std::string &directory)
 
 bool SdCardStorage::remove(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -405,6 +553,8 @@ bool SdCardStorage::remove(const std::string &key)
     }
 
     std::string filepath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(filepath));
+    appender_.close(filepath);
 
     if (unlink(filepath.c_str()) != 0)
     {
@@ -412,6 +562,7 @@ bool SdCardStorage::remove(const std::string &key)
         return false;
     }
 
+    index_.erase(filepath);
     LOPCORE_LOGD(TAG, "Removed key '%s'", key.c_str());
     return true;
 }
@@ -422,53 +573,109 @@ bool SdCardStorage::remove(const std::string &key)
 
 size_t SdCardStorage::getTotalSize() const
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    return currentSpace().totalBytes;
+}
+
+size_t SdCardStorage::getUsedSize() const
+{
+    SpaceCache space = currentSpace();
+    return space.totalBytes - space.freeBytes;
+}
+
+size_t SdCardStorage::getFreeSize() const
+{
+    return currentSpace().freeBytes;
+}
+
+bool SdCardStorage::hasSpace(size_t requiredBytes) const
+{
+    size_t freeSpace = getFreeSize();
 
-    if (!initialized_ || !card_)
+    if (freeSpace < requiredBytes)
     {
-        return 0;
+        LOPCORE_LOGE(TAG, "Insufficient space! Need %zu bytes, but only %zu bytes free", requiredBytes,
+                     freeSpace);
+        return false;
     }
 
-    return ((uint64_t) card_->csd.capacity) * card_->csd.sector_size;
+    return true;
 }
 
-size_t SdCardStorage::getUsedSize() const
+bool SdCardStorage::refreshSpaceInfo() const
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> lock(spaceMutex_);
+    return initialized_ && readSpaceInfo();
+}
+
+SdCardStorage::SpaceCache SdCardStorage::currentSpace() const
+{
+    std::lock_guard<std::mutex> lock(spaceMutex_);
 
     if (!initialized_)
     {
-        return 0;
+        return SpaceCache();
     }
 
-    // Calculate used space by iterating through files
-    uint64_t usedSize = 0;
-    DIR *dir = opendir(config_.mountPoint.c_str());
-    if (!dir)
+    auto now = std::chrono::steady_clock::now();
+    if (!space_.valid || now - space_.updated >= config_.spaceRefreshInterval)
     {
-        return 0;
+        // On failure keep serving the last figures rather than none
+        readSpaceInfo();
     }
+    return space_;
+}
 
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != nullptr)
+bool SdCardStorage::readSpaceInfo() const
+{
+    uint64_t totalBytes = 0;
+    uint64_t freeBytes = 0;
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+    esp_err_t ret = esp_vfs_fat_info(config_.mountPoint.c_str(), &totalBytes, &freeBytes);
+    if (ret != ESP_OK)
     {
-        std::string filepath = config_.mountPoint + "/" + entry->d_name;
-        struct stat st;
-        if (stat(filepath.c_str(), &st) == 0)
-        {
-            usedSize += st.st_size;
-        }
+        LOPCORE_LOGW(TAG, "Failed to read FAT free space: %s", esp_err_to_name(ret));
+        return false;
+    }
+#else
+    BYTE pdrv = ff_diskio_get_pdrv_card(card_);
+    if (pdrv == 0xFF)
+    {
+        LOPCORE_LOGW(TAG, "SD card has no FAT drive registered");
+        return false;
+    }
+
+    // FatFs keeps the free cluster count once it has scanned the FAT, so this is cheap after the first call
+    char drive[3] = {static_cast<char>('0' + pdrv), ':', '\0'};
+    FATFS *fs = nullptr;
+    DWORD freeClusters = 0;
+    FRESULT res = f_getfree(drive, &freeClusters, &fs);
+    if (res != FR_OK)
+    {
+        LOPCORE_LOGW(TAG, "Failed to read FAT free space: %d", res);
+        return false;
     }
 
-    closedir(dir);
-    return usedSize;
+#if FF_MAX_SS != FF_MIN_SS
+    uint64_t clusterBytes = static_cast<uint64_t>(fs->csize) * fs->ssize;
+#else
+    uint64_t clusterBytes = static_cast<uint64_t>(fs->csize) * FF_MIN_SS;
+#endif
+    totalBytes = static_cast<uint64_t>(fs->n_fatent - 2) * clusterBytes;
+    freeBytes = static_cast<uint64_t>(freeClusters) * clusterBytes;
+#endif
+
+    space_.totalBytes = totalBytes;
+    space_.freeBytes = freeBytes;
+    space_.updated = std::chrono::steady_clock::now();
+    space_.valid = true;
+    return true;
 }
 
-size_t SdCardStorage::getFreeSize() const
+void SdCardStorage::consumeSpace(size_t bytes)
 {
-    uint64_t total = getTotalSize();
-    uint64_t used = getUsedSize();
-    return (total > used) ? (total - used) : 0;
+    std::lock_guard<std::mutex> lock(spaceMutex_);
+    space_.freeBytes -= std::min<uint64_t>(space_.freeBytes, bytes);
 }
 
 // ============================================================================
@@ -480,4 +687,12 @@ std::string SdCardStorage::getFullPath(const std::string &key) const
     return config_.mountPoint + "/" + key + FILE_EXTENSION;
 }
 
+void SdCardStorage::buildIndex()
+{
+    if (config_.indexFiles && !index_.build(config_.mountPoint))
+    {
+        LOPCORE_LOGW(TAG, "Failed to index %s, listing will scan it", config_.mountPoint.c_str());
+    }
+}
+
 } // namespace lopcore
@@ -35,17 +35,21 @@ static const char *TAG = "SpiffsStorage";
 namespace lopcore
 {
 
-SpiffsStorage::SpiffsStorage(const storage::SpiffsConfig &config) : config_(config), initialized_(false)
+SpiffsStorage::SpiffsStorage(const storage::SpiffsConfig &config)
+    : config_(config), initialized_(false), appender_(config_.append)
 {
     // Don't auto-initialize - let user call initialize() explicitly
 }
 
 SpiffsStorage::~SpiffsStorage()
 {
+    // Before unmounting, while the files can still be flushed
+    appender_.closeAll();
+
 #ifdef ESP_PLATFORM
     if (initialized_)
     {
-        esp_vfs_spiffs_unregister("spiffs_storage");
+        esp_vfs_spiffs_unregister(partitionLabel());
         ESP_LOGI(TAG, "SPIFFS unmounted");
     }
 #endif
@@ -53,6 +57,8 @@ SpiffsStorage::~SpiffsStorage()
 
 bool SpiffsStorage::initialize()
 {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+
 #ifdef ESP_PLATFORM
     // Check if already mounted
     if (isMounted())
@@ -62,9 +68,7 @@ bool SpiffsStorage::initialize()
     }
 
     esp_vfs_spiffs_conf_t conf = {.base_path = config_.basePath.c_str(),
-                                  .partition_label = config_.partitionLabel.empty()
-                                                         ? nullptr
-                                                         : config_.partitionLabel.c_str(),
+                                  .partition_label = partitionLabel(),
                                   .max_files = config_.maxFiles,
                                   .format_if_mount_failed = config_.formatIfFailed};
 
@@ -85,6 +89,8 @@ bool SpiffsStorage::initialize()
         ESP_LOGI(TAG, "Partition size: total=%zu, used=%zu", total, used);
     }
 
+    initialized_ = true;
+    buildIndex();
     return true;
 #else
     // Host: Just check/create directory
@@ -98,10 +104,20 @@ bool SpiffsStorage::initialize()
             return false;
         }
     }
+    initialized_ = true;
+    buildIndex();
     return true;
 #endif
 }
 
+void SpiffsStorage::buildIndex()
+{
+    if (config_.indexFiles && !index_.build(config_.basePath))
+    {
+        ESP_LOGE(TAG, "Failed to index %s, listing will scan it", config_.basePath.c_str());
+    }
+}
+
 bool SpiffsStorage::isMounted() const
 {
 #ifdef ESP_PLATFORM
@@ -132,7 +148,7 @@ std::string SpiffsStorage::getFullPath(const std::string &key) const
 
 bool SpiffsStorage::write(const std::string &key, const std::string &data)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -141,6 +157,8 @@ bool SpiffsStorage::write(const std::string &key, const std::string &data)
     }
 
     std::string fullPath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(fullPath));
+    appender_.close(fullPath);
     FILE *file = fopen(fullPath.c_str(), "w");
     if (file == nullptr)
     {
@@ -157,13 +175,14 @@ bool SpiffsStorage::write(const std::string &key, const std::string &data)
         return false;
     }
 
+    index_.update(fullPath, written);
     ESP_LOGI(TAG, "Wrote %zu bytes to: %s", written, fullPath.c_str());
     return true;
 }
 
 bool SpiffsStorage::write(const std::string &key, const std::vector<uint8_t> &data)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -172,6 +191,8 @@ bool SpiffsStorage::write(const std::string &key, const std::vector<uint8_t> &da
     }
 
     std::string fullPath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(fullPath));
+    appender_.close(fullPath);
     FILE *file = fopen(fullPath.c_str(), "wb");
     if (file == nullptr)
     {
@@ -188,13 +209,14 @@ bool SpiffsStorage::write(const std::string &key, const std::vector<uint8_t> &da
         return false;
     }
 
+    index_.update(fullPath, written);
     ESP_LOGI(TAG, "Wrote %zu bytes to: %s", written, fullPath.c_str());
     return true;
 }
 
 bool SpiffsStorage::write(const std::string &key, const void *data, size_t dataLen)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -209,6 +231,8 @@ bool SpiffsStorage::write(const std::string &key, const void *data, size_t dataL
     }
 
     std::string fullPath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(fullPath));
+    appender_.close(fullPath);
     FILE *file = fopen(fullPath.c_str(), "wb");
     if (file == nullptr)
     {
@@ -225,13 +249,14 @@ bool SpiffsStorage::write(const std::string &key, const void *data, size_t dataL
         return false;
     }
 
+    index_.update(fullPath, written);
     ESP_LOGI(TAG, "Wrote %zu bytes to: %s", written, fullPath.c_str());
     return true;
 }
 
 std::optional<std::string> SpiffsStorage::read(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -240,6 +265,8 @@ std::optional<std::string> SpiffsStorage::read(const std::string &key)
     }
 
     std::string fullPath = getFullPath(key);
+    std::shared_lock<std::shared_mutex> fileLock(pathLocks_.forPath(fullPath));
+    appender_.close(fullPath);
     FILE *file = fopen(fullPath.c_str(), "r");
     if (file == nullptr)
     {
@@ -276,7 +303,7 @@ std::optional<std::string> SpiffsStorage::read(const std::string &key)
 
 std::optional<std::vector<uint8_t>> SpiffsStorage::readBinary(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -285,6 +312,8 @@ std::optional<std::vector<uint8_t>> SpiffsStorage::readBinary(const std::string
     }
 
     std::string fullPath = getFullPath(key);
+    std::shared_lock<std::shared_mutex> fileLock(pathLocks_.forPath(fullPath));
+    appender_.close(fullPath);
     FILE *file = fopen(fullPath.c_str(), "rb");
     if (file == nullptr)
     {
@@ -319,9 +348,79 @@ std::optional<std::vector<uint8_t>> SpiffsStorage::readBinary(const std::string
     return content;
 }
 
+StorageReader SpiffsStorage::openReader(const std::string &key, size_t bufferSize)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    if (!initialized_)
+    {
+        ESP_LOGE(TAG, "Storage not initialized");
+        return StorageReader();
+    }
+
+    std::string fullPath = getFullPath(key);
+    std::shared_lock<std::shared_mutex> fileLock(pathLocks_.forPath(fullPath));
+    appender_.close(fullPath);
+    return StorageReader(fullPath, bufferSize);
+}
+
+StorageWriter SpiffsStorage::openWriter(const std::string &key, bool append, size_t bufferSize)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    if (!initialized_)
+    {
+        ESP_LOGE(TAG, "Storage not initialized");
+        return StorageWriter();
+    }
+
+    std::string fullPath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(fullPath));
+    appender_.close(fullPath);
+    index_.invalidate(fullPath);
+    return StorageWriter(fullPath, append, bufferSize);
+}
+
+bool SpiffsStorage::append(const std::string &key, const std::string &data)
+{
+    return append(key, data.data(), data.size());
+}
+
+bool SpiffsStorage::append(const std::string &key, const std::vector<uint8_t> &data)
+{
+    return append(key, data.data(), data.size());
+}
+
+bool SpiffsStorage::append(const std::string &key, const void *data, size_t dataLen)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    if (!initialized_)
+    {
+        ESP_LOGE(TAG, "Storage not initialized");
+        return false;
+    }
+
+    std::string fullPath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(fullPath));
+    if (!appender_.append(fullPath, static_cast<const uint8_t *>(data), dataLen))
+    {
+        ESP_LOGE(TAG, "Failed to append to: %s", fullPath.c_str());
+        return false;
+    }
+    index_.grow(fullPath, dataLen);
+    return true;
+}
+
+bool SpiffsStorage::syncAppends()
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return appender_.syncAll();
+}
+
 bool SpiffsStorage::exists(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -329,13 +428,14 @@ bool SpiffsStorage::exists(const std::string &key)
     }
 
     std::string fullPath = getFullPath(key);
+    std::shared_lock<std::shared_mutex> fileLock(pathLocks_.forPath(fullPath));
     struct stat st;
     return (stat(fullPath.c_str(), &st) == 0);
 }
 
 std::vector<std::string> SpiffsStorage::listKeys()
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     std::vector<std::string> keys;
 
@@ -345,6 +445,15 @@ std::vector<std::string> SpiffsStorage::listKeys()
         return keys;
     }
 
+    if (index_.isBuilt())
+    {
+        for (const StorageIndex::Entry &entry : index_.list(""))
+        {
+            keys.push_back(entry.name);
+        }
+        return keys;
+    }
+
     DIR *dir = opendir(config_.basePath.c_str());
     if (dir == nullptr)
     {
@@ -370,7 +479,7 @@ std::vector<std::string> SpiffsStorage::listKeys()
 
 bool SpiffsStorage::remove(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -379,6 +488,8 @@ bool SpiffsStorage::remove(const std::string &key)
     }
 
     std::string fullPath = getFullPath(key);
+    std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(fullPath));
+    appender_.close(fullPath);
 
     // Check if file exists first
     struct stat st;
@@ -391,6 +502,7 @@ bool SpiffsStorage::remove(const std::string &key)
 
     if (::remove(fullPath.c_str()) == 0)
     {
+        index_.erase(fullPath);
         ESP_LOGI(TAG, "Removed file: %s", fullPath.c_str());
         return true;
     }
@@ -403,11 +515,11 @@ bool SpiffsStorage::remove(const std::string &key)
 
 size_t SpiffsStorage::getTotalSize() const
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
 #ifdef ESP_PLATFORM
     size_t total = 0, used = 0;
-    esp_err_t ret = esp_spiffs_info("spiffs_storage", &total, &used);
+    esp_err_t ret = esp_spiffs_info(partitionLabel(), &total, &used);
     if (ret == ESP_OK)
     {
         return total;
@@ -418,11 +530,11 @@ size_t SpiffsStorage::getTotalSize() const
 
 size_t SpiffsStorage::getUsedSize() const
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
 #ifdef ESP_PLATFORM
     size_t total = 0, used = 0;
-    esp_err_t ret = esp_spiffs_info("spiffs_storage", &total, &used);
+    esp_err_t ret = esp_spiffs_info(partitionLabel(), &total, &used);
     if (ret == ESP_OK)
     {
         return used;
@@ -452,7 +564,7 @@ bool SpiffsStorage::hasSpace(size_t requiredBytes) const
 
 std::optional<size_t> SpiffsStorage::getFileSize(const std::string &key) const
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     if (!initialized_)
     {
@@ -460,6 +572,7 @@ std::optional<size_t> SpiffsStorage::getFileSize(const std::string &key) const
     }
 
     std::string fullPath = getFullPath(key);
+    std::shared_lock<std::shared_mutex> fileLock(pathLocks_.forPath(fullPath));
     struct stat file_stat;
 
     if (stat(fullPath.c_str(), &file_stat) != 0)
@@ -492,39 +605,9 @@ void SpiffsStorage::displayStats() const
     ESP_LOGI(TAG, "========================================");
 }
 
-bool SpiffsStorage::patternMatch(const char *pattern, const char *str)
-{
-    const char *star = strchr(pattern, '*');
-
-    if (star == nullptr)
-    {
-        // No wildcard, exact match required
-        return strcmp(pattern, str) == 0;
-    }
-
-    // Match prefix (before *)
-    size_t prefix_len = star - pattern;
-    if (strncmp(pattern, str, prefix_len) != 0)
-    {
-        return false;
-    }
-
-    // Match suffix (after *)
-    const char *suffix = star + 1;
-    size_t suffix_len = strlen(suffix);
-    size_t str_len = strlen(str);
-
-    if (suffix_len > str_len - prefix_len)
-    {
-        return false;
-    }
-
-    return strcmp(str + str_len - suffix_len, suffix) == 0;
-}
-
 std::vector<std::string> SpiffsStorage::listKeysByPattern(const std::string &pattern)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     std::vector<std::string> matchingKeys;
 
@@ -534,6 +617,18 @@ std::vector<std::string> SpiffsStorage::listKeysByPattern(const std::string &pat
         return matchingKeys;
     }
 
+    if (index_.isBuilt())
+    {
+        for (const StorageIndex::Entry &entry : index_.match("", pattern))
+        {
+            if (!entry.isDirectory)
+            {
+                matchingKeys.push_back(entry.name);
+            }
+        }
+        return matchingKeys;
+    }
+
     DIR *dir = opendir(config_.basePath.c_str());
     if (dir == nullptr)
     {
@@ -553,7 +648,7 @@ std::vector<std::string> SpiffsStorage::listKeysByPattern(const std::string &pat
         }
 
         // Check if filename matches pattern
-        if (patternMatch(pattern.c_str(), filename.c_str()))
+        if (globMatch(pattern.c_str(), filename.c_str()))
         {
             // Verify it's a regular file
             std::string fullPath = config_.basePath + "/" + filename;
@@ -594,7 +689,7 @@ size_t SpiffsStorage::removeByPattern(const std::string &pattern)
     // Now delete each matching file
     for (const auto &filename : matchingFiles)
     {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::shared_lock<std::shared_mutex> lock(mutex_);
 
         if (!initialized_)
         {
@@ -603,9 +698,13 @@ size_t SpiffsStorage::removeByPattern(const std::string &pattern)
         }
 
         std::string fullPath = config_.basePath + "/" + filename;
+        std::unique_lock<std::shared_mutex> fileLock(pathLocks_.forPath(fullPath));
 
+        // It may be kept open by append()
+        appender_.close(fullPath);
         if (::remove(fullPath.c_str()) == 0)
         {
+            index_.erase(fullPath);
             ESP_LOGI(TAG, "Deleted: %s", filename.c_str());
             deletedCount++;
         }
@@ -622,7 +721,7 @@ size_t SpiffsStorage::removeByPattern(const std::string &pattern)
 
 std::vector<SpiffsStorage::FileInfo> SpiffsStorage::listDetailed()
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
     std::vector<FileInfo> files;
 
@@ -632,6 +731,15 @@ std::vector<SpiffsStorage::FileInfo> SpiffsStorage::listDetailed()
         return files;
     }
 
+    if (index_.isBuilt())
+    {
+        for (const StorageIndex::Entry &entry : index_.list(""))
+        {
+            files.push_back(FileInfo{entry.name, entry.size, entry.isDirectory});
+        }
+        return files;
+    }
+
     DIR *dir = opendir(config_.basePath.c_str());
     if (dir == nullptr)
     {
@@ -671,14 +779,19 @@ std::vector<SpiffsStorage::FileInfo> SpiffsStorage::listDetailed()
 
 bool SpiffsStorage::format()
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    appender_.closeAll();
 
 #ifdef ESP_PLATFORM
     ESP_LOGI(TAG, "Formatting SPIFFS partition...");
-    esp_err_t ret = esp_spiffs_format("spiffs_storage");
+    esp_err_t ret = esp_spiffs_format(partitionLabel());
     if (ret == ESP_OK)
     {
         ESP_LOGI(TAG, "SPIFFS formatted successfully");
+        if (index_.isBuilt())
+        {
+            buildIndex();
+        }
         return true;
     }
     else
@@ -694,12 +807,12 @@ bool SpiffsStorage::format()
 
 bool SpiffsStorage::check()
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_lock<std::shared_mutex> lock(mutex_);
 
 #ifdef ESP_PLATFORM
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 4, 0)
     ESP_LOGI(TAG, "Checking SPIFFS filesystem integrity...");
-    esp_err_t ret = esp_spiffs_check("spiffs_storage");
+    esp_err_t ret = esp_spiffs_check(partitionLabel());
     if (ret == ESP_OK)
     {
         ESP_LOGI(TAG, "SPIFFS check passed");
@@ -720,4 +833,35 @@ bool SpiffsStorage::check()
 #endif
 }
 
+bool SpiffsStorage::collectGarbage(size_t bytes)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+
+#ifdef ESP_PLATFORM
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 4, 0)
+    esp_err_t ret = esp_spiffs_gc(partitionLabel(), bytes);
+    if (ret == ESP_OK)
+    {
+        return true;
+    }
+    if (ret == ESP_ERR_NOT_FINISHED)
+    {
+        ESP_LOGI(TAG, "SPIFFS GC could not free %zu bytes", bytes);
+    }
+    else
+    {
+        ESP_LOGE(TAG, "SPIFFS GC failed: %d", ret);
+    }
+    return false;
+#else
+    ESP_LOGI(TAG, "SPIFFS GC not available (requires ESP-IDF >= 4.4.0)");
+    return false;
+#endif
+#else
+    (void)bytes;
+    ESP_LOGI(TAG, "SPIFFS GC not supported on host");
+    return false;
+#endif
+}
+
 } // namespace lopcore
@@ -0,0 +1,362 @@
+/**
+ * @file storage_index.cpp
+ * @brief In-RAM file metadata index for the file-based storage backends
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/storage/storage_index.hpp"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace lopcore
+{
+
+/**
+ * @brief Match c against the class starting after a '['
+ *
+ * @return Position after the closing ']', or nullptr if there is none
+ */
+static const char *matchClass(const char *p, char c, bool &matched)
+{
+    bool negate = *p == '!' || *p == '^';
+    if (negate)
+    {
+        ++p;
+    }
+
+    matched = false;
+    // A ']' right after the '[' (or "[!") is a member, not the end
+    for (bool first = true; *p != '\0' && (*p != ']' || first); first = false)
+    {
+        char lo = *p;
+        char hi = lo;
+        if (p[1] == '-' && p[2] != '\0' && p[2] != ']')
+        {
+            hi = p[2];
+            p += 3;
+        }
+        else
+        {
+            ++p;
+        }
+        matched = matched || (lo <= c && c <= hi);
+    }
+
+    if (*p != ']')
+    {
+        return nullptr;
+    }
+    matched = matched != negate;
+    return p + 1;
+}
+
+bool globMatch(const char *pattern, const char *str)
+{
+    const char *p = pattern;
+    const char *s = str;
+    // Where to resume after the last '*': its pattern position and the next name position for it to absorb
+    const char *starPattern = nullptr;
+    const char *starStr = nullptr;
+
+    while (*s != '\0')
+    {
+        if (*p == '*')
+        {
+            starPattern = ++p;
+            starStr = s;
+            continue;
+        }
+
+        const char *next = nullptr;
+        if (*p == '?')
+        {
+            next = p + 1;
+        }
+        else if (*p == '[')
+        {
+            bool matched = false;
+            const char *end = matchClass(p + 1, *s, matched);
+            if (end == nullptr)
+            {
+                next = *s == '[' ? p + 1 : nullptr; // Unterminated: a literal '['
+            }
+            else if (matched)
+            {
+                next = end;
+            }
+        }
+        else if (*p != '\0' && *p == *s)
+        {
+            next = p + 1;
+        }
+
+        if (next != nullptr)
+        {
+            p = next;
+            ++s;
+        }
+        else if (starPattern != nullptr)
+        {
+            // Let the last '*' absorb one more character; earlier stars never need revisiting
+            p = starPattern;
+            s = ++starStr;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    while (*p == '*')
+    {
+        ++p;
+    }
+    return *p == '\0';
+}
+
+std::string globPrefix(const std::string &pattern)
+{
+    return pattern.substr(0, pattern.find_first_of("*?["));
+}
+
+bool StorageIndex::build(const std::string &root)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    root_.clear();
+    built_ = false;
+
+    DIR *dir = opendir(root.c_str());
+    if (dir == nullptr)
+    {
+        return false;
+    }
+    closedir(dir);
+
+    root_ = root;
+    scan(root, "");
+    built_ = true;
+    return true;
+}
+
+void StorageIndex::scan(const std::string &dir, const std::string &prefix)
+{
+    DIR *handle = opendir(dir.c_str());
+    if (handle == nullptr)
+    {
+        return;
+    }
+
+    std::vector<std::string> subdirectories;
+    struct dirent *entry;
+    while ((entry = readdir(handle)) != nullptr)
+    {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+
+        struct stat st;
+        if (stat((dir + "/" + name).c_str(), &st) != 0)
+        {
+            continue;
+        }
+
+        bool isDirectory = S_ISDIR(st.st_mode);
+        entries_[prefix + name] =
+            Meta{isDirectory ? 0 : static_cast<size_t>(st.st_size), st.st_mtime, isDirectory, false};
+        if (isDirectory)
+        {
+            subdirectories.push_back(name);
+        }
+    }
+    closedir(handle);
+
+    // Recurse after closing, so only one directory handle is open at a time
+    for (const std::string &name : subdirectories)
+    {
+        scan(dir + "/" + name, prefix + name + "/");
+    }
+}
+
+void StorageIndex::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    root_.clear();
+    built_ = false;
+}
+
+std::string StorageIndex::relative(const std::string &path) const
+{
+    if (path.size() <= root_.size() + 1 || path.compare(0, root_.size(), root_) != 0 || path[root_.size()] != '/')
+    {
+        return std::string();
+    }
+    return path.substr(root_.size() + 1);
+}
+
+void StorageIndex::addParents(const std::string &rel)
+{
+    std::time_t now = std::time(nullptr);
+    for (size_t slash = rel.find('/'); slash != std::string::npos; slash = rel.find('/', slash + 1))
+    {
+        entries_.emplace(rel.substr(0, slash), Meta{0, now, true, false});
+    }
+}
+
+void StorageIndex::update(const std::string &path, size_t size)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string rel = relative(path);
+    if (!built_ || rel.empty())
+    {
+        return;
+    }
+
+    addParents(rel);
+    entries_[rel] = Meta{size, std::time(nullptr), false, false};
+}
+
+void StorageIndex::grow(const std::string &path, size_t size)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string rel = relative(path);
+    if (!built_ || rel.empty())
+    {
+        return;
+    }
+
+    auto it = entries_.find(rel);
+    if (it == entries_.end())
+    {
+        addParents(rel);
+        entries_[rel] = Meta{size, std::time(nullptr), false, false};
+        return;
+    }
+
+    it->second.size += size;
+    it->second.mtime = std::time(nullptr);
+}
+
+void StorageIndex::invalidate(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string rel = relative(path);
+    if (!built_ || rel.empty())
+    {
+        return;
+    }
+
+    addParents(rel);
+    entries_[rel] = Meta{0, 0, false, true};
+}
+
+void StorageIndex::erase(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string rel = relative(path);
+    if (!built_ || rel.empty())
+    {
+        return;
+    }
+
+    entries_.erase(rel);
+
+    // Everything under it, if it was a directory
+    std::string prefix = rel + "/";
+    auto it = entries_.lower_bound(prefix);
+    while (it != entries_.end() && it->first.compare(0, prefix.size(), prefix) == 0)
+    {
+        it = entries_.erase(it);
+    }
+}
+
+void StorageIndex::rename(const std::string &from, const std::string &to)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string fromRel = relative(from);
+    std::string toRel = relative(to);
+    if (!built_ || fromRel.empty() || toRel.empty())
+    {
+        return;
+    }
+
+    auto it = entries_.find(fromRel);
+    if (it == entries_.end())
+    {
+        return;
+    }
+
+    Meta meta = it->second;
+    entries_.erase(it);
+    addParents(toRel);
+    entries_[toRel] = meta;
+}
+
+std::vector<StorageIndex::Entry> StorageIndex::list(const std::string &directory)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return collect(directory, std::string(), nullptr);
+}
+
+std::vector<StorageIndex::Entry> StorageIndex::match(const std::string &directory, const std::string &pattern)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return collect(directory, globPrefix(pattern), pattern.c_str());
+}
+
+std::vector<StorageIndex::Entry> StorageIndex::collect(const std::string &directory,
+                                                       const std::string &namePrefix,
+                                                       const char *pattern)
+{
+    std::vector<Entry> result;
+    std::string dirPrefix = directory.empty() ? std::string() : directory + "/";
+    std::string prefix = dirPrefix + namePrefix;
+
+    for (auto it = entries_.lower_bound(prefix);
+         it != entries_.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+    {
+        std::string name = it->first.substr(dirPrefix.size());
+        if (name.find('/') != std::string::npos)
+        {
+            continue; // Deeper than directory
+        }
+        if (pattern != nullptr && !globMatch(pattern, name.c_str()))
+        {
+            continue;
+        }
+
+        Meta &meta = it->second;
+        if (meta.stale)
+        {
+            struct stat st;
+            if (stat((root_ + "/" + it->first).c_str(), &st) == 0)
+            {
+                meta.size = static_cast<size_t>(st.st_size);
+                meta.mtime = st.st_mtime;
+            }
+            meta.stale = false;
+        }
+
+        result.push_back(Entry{name, meta.size, meta.mtime, meta.isDirectory});
+    }
+    return result;
+}
+
+size_t StorageIndex::totalSize() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t total = 0;
+    for (const auto &pair : entries_)
+    {
+        total += pair.second.size;
+    }
+    return total;
+}
+
+} // namespace lopcore
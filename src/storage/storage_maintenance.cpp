@@ -0,0 +1,277 @@
+/**
+ * @file storage_maintenance.cpp
+ * @brief File system upkeep run while the application declares itself idle
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/storage/storage_maintenance.hpp"
+
+#include <utility>
+
+#include "lopcore/task/task_profile.hpp"
+
+#ifdef ESP_PLATFORM
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+// Host mocks
+#include <iostream>
+#define ESP_LOGI(tag, format, ...) std::cout << "[INFO] " << tag << ": " << format << std::endl
+#define ESP_LOGE(tag, format, ...) std::cerr << "[ERROR] " << tag << ": " << format << std::endl
+#endif
+
+static const char *TAG = "StorageMaintenance";
+
+namespace lopcore
+{
+
+StorageMaintenance::StorageMaintenance(const storage::StorageMaintenanceConfig &config) : config_(config)
+{
+}
+
+StorageMaintenance::~StorageMaintenance()
+{
+    stop();
+}
+
+void StorageMaintenance::addTask(const std::string &name, MaintenanceTask kind, TaskFunction task,
+                                 std::chrono::milliseconds interval)
+{
+    if (interval.count() <= 0 || !task)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(Task{name, kind, std::move(task), interval.count(), nowMs()});
+    }
+    wakeWorker();
+}
+
+bool StorageMaintenance::start()
+{
+    if (running_.load())
+    {
+        return false;
+    }
+
+    running_.store(true);
+#ifdef ESP_PLATFORM
+    stopped_.store(false);
+    TaskHandle_t handle = nullptr;
+    task::TaskSettings settings{config_.coreId, config_.priority, config_.stackSize};
+    if (task::spawn(task::TaskRole::STORAGE_MAINT, "storage_maint", workerEntry, this, settings, &handle) !=
+        ESP_OK)
+    {
+        stopped_.store(true);
+        running_.store(false);
+        ESP_LOGE(TAG, "Failed to create maintenance task");
+        return false;
+    }
+    task_ = handle;
+#else
+    thread_ = std::thread(workerEntry, this);
+#endif
+
+    ESP_LOGI(TAG, "Started storage maintenance");
+    return true;
+}
+
+void StorageMaintenance::stop()
+{
+    running_.store(false);
+    wakeWorker();
+
+#ifdef ESP_PLATFORM
+    while (!stopped_.load())
+    {
+        vTaskDelay(1);
+    }
+    task_ = nullptr;
+#else
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+#endif
+}
+
+void StorageMaintenance::setIdle(bool idle)
+{
+    if (idle_.exchange(idle) != idle && idle)
+    {
+        wakeWorker();
+    }
+}
+
+size_t StorageMaintenance::runDue(std::chrono::milliseconds budget)
+{
+    int64_t deadline = nowMs() + budget.count();
+    size_t ran = 0;
+    while (nowMs() < deadline && runNext())
+    {
+        ran++;
+    }
+    return ran;
+}
+
+size_t StorageMaintenance::due() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t now = nowMs();
+    return static_cast<size_t>(std::count_if(tasks_.begin(), tasks_.end(), [now](const Task &task) {
+        return !task.running && task.dueMs <= now;
+    }));
+}
+
+StorageMaintenanceStats StorageMaintenance::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+bool StorageMaintenance::runNext()
+{
+    Task *next = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int64_t now = nowMs();
+        for (Task &task : tasks_)
+        {
+            if (!task.running && task.dueMs <= now && (next == nullptr || task.dueMs < next->dueMs))
+            {
+                next = &task;
+            }
+        }
+        if (next == nullptr)
+        {
+            return false;
+        }
+        next->running = true;
+    }
+
+    int64_t start = nowMs();
+    bool ok = next->run();
+    int64_t end = nowMs();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    next->running = false;
+    next->dueMs = end + next->intervalMs;
+    switch (next->kind)
+    {
+        case MaintenanceTask::GC:
+            stats_.gcRuns++;
+            break;
+        case MaintenanceTask::CHECK:
+            stats_.checks++;
+            break;
+        case MaintenanceTask::SYNC:
+            stats_.syncs++;
+            break;
+    }
+    if (!ok)
+    {
+        stats_.failed++;
+        ESP_LOGE(TAG, "Maintenance task '%s' failed", next->name.c_str());
+    }
+    stats_.longestTaskMs = std::max(stats_.longestTaskMs, static_cast<uint32_t>(end - start));
+    return true;
+}
+
+int64_t StorageMaintenance::untilDue() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t now = nowMs();
+    int64_t wait = -1;
+    for (const Task &task : tasks_)
+    {
+        if (!task.running)
+        {
+            int64_t remaining = std::max<int64_t>(0, task.dueMs - now);
+            wait = wait < 0 ? remaining : std::min(wait, remaining);
+        }
+    }
+    return wait;
+}
+
+int64_t StorageMaintenance::nowMs()
+{
+#ifdef ESP_PLATFORM
+    return esp_timer_get_time() / 1000;
+#else
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+void StorageMaintenance::workerEntry(void *arg)
+{
+    StorageMaintenance *self = static_cast<StorageMaintenance *>(arg);
+    self->run();
+
+#ifdef ESP_PLATFORM
+    self->stopped_.store(true);
+    task::exitTask();
+#endif
+}
+
+void StorageMaintenance::run()
+{
+    while (running_.load())
+    {
+        int64_t wait = -1; // Until woken
+        if (idle_.load())
+        {
+            if (runNext())
+            {
+                continue;
+            }
+            wait = untilDue();
+        }
+        sleep(wait);
+    }
+}
+
+void StorageMaintenance::sleep(int64_t timeoutMs)
+{
+#ifdef ESP_PLATFORM
+    TickType_t ticks = timeoutMs < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs) + 1;
+    ulTaskNotifyTake(pdTRUE, ticks);
+#else
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto woken = [this] { return woken_ || !running_.load(); };
+    if (timeoutMs < 0)
+    {
+        wake_.wait(lock, woken);
+    }
+    else
+    {
+        wake_.wait_for(lock, std::chrono::milliseconds(timeoutMs), woken);
+    }
+    woken_ = false;
+#endif
+}
+
+void StorageMaintenance::wakeWorker()
+{
+#ifdef ESP_PLATFORM
+    TaskHandle_t handle = static_cast<TaskHandle_t>(task_);
+    if (handle != nullptr)
+    {
+        xTaskNotifyGive(handle);
+    }
+#else
+    std::lock_guard<std::mutex> lock(mutex_);
+    woken_ = true;
+    wake_.notify_one();
+#endif
+}
+
+} // namespace lopcore
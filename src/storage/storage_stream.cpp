@@ -0,0 +1,575 @@
+/**
+ * @file storage_stream.cpp
+ * @brief Chunked file streams for the file-based storage backends
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/storage/storage_stream.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#ifdef ESP_PLATFORM
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#else
+// Host mocks
+#include <iostream>
+#define ESP_LOGE(tag, format, ...) std::cerr << "[ERROR] " << tag << ": " << format << std::endl
+#endif
+
+static const char *TAG = "StorageStream";
+
+namespace lopcore
+{
+
+/**
+ * @brief Open path in mode with a stdio buffer of bufferSize
+ */
+static FILE *openBuffered(const std::string &path, const char *mode, size_t bufferSize)
+{
+    FILE *file = fopen(path.c_str(), mode);
+    if (file == nullptr)
+    {
+        ESP_LOGE(TAG, "Failed to open file: %s", path.c_str());
+        return nullptr;
+    }
+
+    // Must precede any I/O; stdio allocates the buffer and frees it on fclose()
+    int ret = bufferSize > 0 ? setvbuf(file, nullptr, _IOFBF, bufferSize) : setvbuf(file, nullptr, _IONBF, 0);
+    if (ret != 0)
+    {
+        ESP_LOGE(TAG, "Failed to set %zu byte buffer for: %s", bufferSize, path.c_str());
+    }
+    return file;
+}
+
+// ============================================================================
+// StorageReader
+// ============================================================================
+
+StorageReader::StorageReader(const std::string &path, size_t bufferSize)
+    : file_(openBuffered(path, "rb", bufferSize))
+{
+    struct stat st;
+    if (file_ != nullptr && fstat(fileno(file_), &st) == 0)
+    {
+        size_ = static_cast<size_t>(st.st_size);
+    }
+}
+
+StorageReader::~StorageReader()
+{
+    close();
+}
+
+StorageReader::StorageReader(StorageReader &&other) noexcept
+    : file_(std::exchange(other.file_, nullptr)), size_(std::exchange(other.size_, 0))
+{
+}
+
+StorageReader &StorageReader::operator=(StorageReader &&other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        file_ = std::exchange(other.file_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+size_t StorageReader::read(uint8_t *buffer, size_t length)
+{
+    if (file_ == nullptr || buffer == nullptr)
+    {
+        return 0;
+    }
+    return fread(buffer, 1, length, file_);
+}
+
+bool StorageReader::seek(size_t offset)
+{
+    if (file_ == nullptr || offset > size_)
+    {
+        return false;
+    }
+    return fseek(file_, static_cast<long>(offset), SEEK_SET) == 0;
+}
+
+size_t StorageReader::tell() const
+{
+    if (file_ == nullptr)
+    {
+        return 0;
+    }
+    long position = ftell(file_);
+    return position < 0 ? 0 : static_cast<size_t>(position);
+}
+
+bool StorageReader::eof() const
+{
+    return file_ == nullptr || feof(file_) != 0;
+}
+
+void StorageReader::close()
+{
+    if (file_ != nullptr)
+    {
+        fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+// ============================================================================
+// StorageWriter
+// ============================================================================
+
+StorageWriter::StorageWriter(const std::string &path, bool append, size_t bufferSize)
+    : file_(openBuffered(path, append ? "ab" : "wb", bufferSize))
+{
+}
+
+StorageWriter::~StorageWriter()
+{
+    close();
+}
+
+StorageWriter::StorageWriter(StorageWriter &&other) noexcept
+    : file_(std::exchange(other.file_, nullptr)), failed_(std::exchange(other.failed_, false))
+{
+}
+
+StorageWriter &StorageWriter::operator=(StorageWriter &&other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        file_ = std::exchange(other.file_, nullptr);
+        failed_ = std::exchange(other.failed_, false);
+    }
+    return *this;
+}
+
+bool StorageWriter::write(const uint8_t *data, size_t length)
+{
+    if (file_ == nullptr || (data == nullptr && length > 0))
+    {
+        return false;
+    }
+
+    if (fwrite(data, 1, length, file_) != length)
+    {
+        ESP_LOGE(TAG, "Failed to write %zu bytes", length);
+        failed_ = true;
+        return false;
+    }
+    return true;
+}
+
+bool StorageWriter::seek(size_t offset)
+{
+    if (file_ == nullptr)
+    {
+        return false;
+    }
+    return fseek(file_, static_cast<long>(offset), SEEK_SET) == 0;
+}
+
+size_t StorageWriter::tell() const
+{
+    if (file_ == nullptr)
+    {
+        return 0;
+    }
+    long position = ftell(file_);
+    return position < 0 ? 0 : static_cast<size_t>(position);
+}
+
+bool StorageWriter::flush()
+{
+    if (file_ == nullptr)
+    {
+        return false;
+    }
+    if (fflush(file_) != 0)
+    {
+        failed_ = true;
+        return false;
+    }
+    return true;
+}
+
+bool StorageWriter::sync()
+{
+    if (!flush())
+    {
+        return false;
+    }
+    if (fsync(fileno(file_)) != 0)
+    {
+        ESP_LOGE(TAG, "Failed to sync file");
+        failed_ = true;
+        return false;
+    }
+    return true;
+}
+
+bool StorageWriter::close()
+{
+    if (file_ == nullptr)
+    {
+        return false;
+    }
+
+    bool ok = fclose(file_) == 0 && !failed_;
+    file_ = nullptr;
+    failed_ = false;
+    return ok;
+}
+
+// ============================================================================
+// Atomic replace
+// ============================================================================
+
+bool writeFileAtomic(const std::string &path, const uint8_t *data, size_t length, bool keepBackup)
+{
+    if (data == nullptr && length > 0)
+    {
+        return false;
+    }
+
+    std::string tempPath = path + ".tmp";
+    std::string backupPath = path + ".bak";
+
+    // Unbuffered: fwrite goes straight to the file, fsync then makes it durable
+    FILE *file = openBuffered(tempPath, "wb", 0);
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    bool written = fwrite(data, 1, length, file) == length && fsync(fileno(file)) == 0;
+    if (fclose(file) != 0 || !written)
+    {
+        ESP_LOGE(TAG, "Failed to write temporary file: %s", tempPath.c_str());
+        unlink(tempPath.c_str());
+        return false;
+    }
+
+    // POSIX and LittleFS replace the target atomically
+    if (!keepBackup && rename(tempPath.c_str(), path.c_str()) == 0)
+    {
+        return true;
+    }
+
+    // Keep the old content aside until the new file is in place
+    unlink(backupPath.c_str());
+    bool hadOld = rename(path.c_str(), backupPath.c_str()) == 0;
+    if (rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        ESP_LOGE(TAG, "Failed to rename into place: %s", path.c_str());
+        if (hadOld)
+        {
+            rename(backupPath.c_str(), path.c_str());
+        }
+        unlink(tempPath.c_str());
+        return false;
+    }
+
+    if (!keepBackup)
+    {
+        unlink(backupPath.c_str());
+    }
+    return true;
+}
+
+// ============================================================================
+// StorageAppender
+// ============================================================================
+
+bool StorageAppender::append(const std::string &path, const uint8_t *data, size_t length)
+{
+    if (data == nullptr && length > 0)
+    {
+        return false;
+    }
+
+    if (policy_.openFiles == 0)
+    {
+        // "ab" writes at the end without reading or rewriting what is there
+        StorageWriter writer(path, true, policy_.bufferSize);
+        return writer.write(data, length) && writer.close();
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    std::shared_ptr<OpenFile> entry;
+    std::unique_lock<std::mutex> fileLock;
+    do
+    {
+        std::shared_ptr<OpenFile> victim;
+        entry = lookup(path, victim);
+        if (victim)
+        {
+            std::lock_guard<std::mutex> victimLock(victim->mutex);
+            if (victim->listed)
+            {
+                retire(*victim);
+            }
+        }
+
+        // Closed by close() or for room since the lookup: look it up again
+        fileLock = std::unique_lock<std::mutex>(entry->mutex);
+    } while (!entry->listed);
+
+    OpenFile &file = *entry;
+    if (!file.writer.isOpen() && !openFile(file, now))
+    {
+        retire(file);
+        return false;
+    }
+
+    bool written = file.chunk ? bufferAppend(file, data, length, now) : file.writer.write(data, length);
+    if (!written)
+    {
+        // Reopened on the next append, which may then succeed
+        file.writer.close();
+        retire(file);
+        return false;
+    }
+
+    if (file.unsyncedBytes == 0)
+    {
+        file.firstUnsynced = now;
+    }
+    file.unsyncedBytes += length;
+
+    bool ok = true;
+    bool bytesDue = policy_.syncBytes > 0 && file.unsyncedBytes >= policy_.syncBytes;
+    bool ageDue = policy_.syncInterval.count() > 0 && now - file.firstUnsynced >= policy_.syncInterval;
+    if (bytesDue || ageDue)
+    {
+        file.unsyncedBytes = 0;
+        ok = writeBack(file) && file.writer.sync();
+    }
+    fileLock.unlock();
+
+    // Partial chunks of files no longer appended to would otherwise wait for a sync
+    if (policy_.writeBackDelay.count() > 0)
+    {
+        ok = writeBackIdle(file, now) && ok;
+    }
+    return ok;
+}
+
+bool StorageAppender::close(const std::string &path)
+{
+    std::shared_ptr<OpenFile> entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const std::shared_ptr<OpenFile> &file : files_)
+        {
+            if (file->path == path)
+            {
+                entry = file;
+                break;
+            }
+        }
+    }
+    if (!entry)
+    {
+        return true;
+    }
+
+    // A concurrent close() of the same file waits here until it is flushed
+    std::lock_guard<std::mutex> fileLock(entry->mutex);
+    return !entry->listed || retire(*entry);
+}
+
+bool StorageAppender::closeAll()
+{
+    bool ok = true;
+    for (const std::shared_ptr<OpenFile> &file : snapshot())
+    {
+        std::lock_guard<std::mutex> fileLock(file->mutex);
+        if (file->listed)
+        {
+            ok = retire(*file) && ok;
+        }
+    }
+    return ok;
+}
+
+bool StorageAppender::syncAll()
+{
+    bool ok = true;
+    for (const std::shared_ptr<OpenFile> &file : snapshot())
+    {
+        std::lock_guard<std::mutex> fileLock(file->mutex);
+        if (file->listed && file->unsyncedBytes > 0)
+        {
+            ok = writeBack(*file) && file->writer.sync() && ok;
+            file->unsyncedBytes = 0;
+        }
+    }
+    return ok;
+}
+
+std::shared_ptr<StorageAppender::OpenFile> StorageAppender::lookup(const std::string &path,
+                                                                   std::shared_ptr<OpenFile> &victim)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = files_.begin();
+    while (it != files_.end() && (*it)->path != path)
+    {
+        ++it;
+    }
+
+    if (it != files_.end())
+    {
+        files_.splice(files_.begin(), files_, it);
+        return files_.front();
+    }
+
+    // Left in files_ until closed, so a close() of it still waits for the flush
+    if (files_.size() >= policy_.openFiles)
+    {
+        victim = files_.back();
+    }
+    files_.push_front(std::make_shared<OpenFile>(path));
+    return files_.front();
+}
+
+std::vector<std::shared_ptr<StorageAppender::OpenFile>> StorageAppender::snapshot() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::vector<std::shared_ptr<OpenFile>>(files_.begin(), files_.end());
+}
+
+bool StorageAppender::retire(OpenFile &file)
+{
+    bool ok = closeFile(file);
+    file.listed = false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    files_.remove_if([&file](const std::shared_ptr<OpenFile> &entry) { return entry.get() == &file; });
+    return ok;
+}
+
+bool StorageAppender::writeBackIdle(const OpenFile &current, std::chrono::steady_clock::time_point now)
+{
+    bool ok = true;
+    for (const std::shared_ptr<OpenFile> &file : snapshot())
+    {
+        if (file.get() == &current)
+        {
+            continue;
+        }
+
+        // A file busy on another task is written back by that task or by a later append
+        std::unique_lock<std::mutex> fileLock(file->mutex, std::try_to_lock);
+        if (fileLock && file->listed && file->buffered > 0 && now - file->firstBuffered >= policy_.writeBackDelay)
+        {
+            ok = writeBack(*file) && ok;
+        }
+    }
+    return ok;
+}
+
+bool StorageAppender::openFile(OpenFile &file, std::chrono::steady_clock::time_point now)
+{
+    file.unsyncedBytes = 0;
+    file.firstUnsynced = now;
+    file.buffered = 0;
+    file.firstBuffered = now;
+
+    if (policy_.writeBackSize == 0)
+    {
+        file.writer = StorageWriter(file.path, true, policy_.bufferSize);
+        return file.writer.isOpen();
+    }
+
+    if (!file.chunk)
+    {
+#ifdef ESP_PLATFORM
+        // Lets the SD driver DMA straight from the chunk instead of through a bounce buffer
+        uint8_t *memory = static_cast<uint8_t *>(heap_caps_malloc(policy_.writeBackSize, MALLOC_CAP_DMA));
+#else
+        uint8_t *memory = static_cast<uint8_t *>(malloc(policy_.writeBackSize));
+#endif
+        file.chunk.reset(memory);
+        if (!file.chunk)
+        {
+            ESP_LOGE(TAG, "Failed to allocate %zu byte write-back buffer", policy_.writeBackSize);
+            return false;
+        }
+    }
+
+    // The chunk is the only buffer, so whole chunks reach the filesystem in one call
+    file.writer = StorageWriter(file.path, true, 0);
+    if (!file.writer.isOpen())
+    {
+        return false;
+    }
+
+    struct stat st;
+    file.offset = stat(file.path.c_str(), &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+    return true;
+}
+
+bool StorageAppender::bufferAppend(OpenFile &file,
+                                   const uint8_t *data,
+                                   size_t length,
+                                   std::chrono::steady_clock::time_point now)
+{
+    while (length > 0)
+    {
+        // Fill up to the next chunk boundary in the file, not just to the chunk size
+        size_t end = policy_.writeBackSize - file.offset % policy_.writeBackSize;
+        size_t count = std::min(length, end - file.buffered);
+        if (file.buffered == 0)
+        {
+            file.firstBuffered = now;
+        }
+        memcpy(file.chunk.get() + file.buffered, data, count);
+        file.buffered += count;
+        data += count;
+        length -= count;
+
+        if (file.buffered == end && !writeBack(file))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StorageAppender::writeBack(OpenFile &file)
+{
+    if (file.buffered == 0)
+    {
+        return true;
+    }
+
+    if (!file.writer.write(file.chunk.get(), file.buffered))
+    {
+        return false;
+    }
+    file.offset += file.buffered;
+    file.buffered = 0;
+    return true;
+}
+
+bool StorageAppender::closeFile(OpenFile &file)
+{
+    bool ok = writeBack(file);
+    return file.writer.close() && ok;
+}
+
+} // namespace lopcore
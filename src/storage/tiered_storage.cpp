@@ -0,0 +1,431 @@
+/**
+ * @file tiered_storage.cpp
+ * @brief One key space over NVS, LittleFS and SD card, placed by size and heat
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/storage/tiered_storage.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#ifdef ESP_PLATFORM
+#include <esp_log.h>
+#else
+// Host mocks
+#include <iostream>
+#define ESP_LOGI(tag, format, ...) std::cout << "[INFO] " << tag << ": " << format << std::endl
+#define ESP_LOGE(tag, format, ...) std::cerr << "[ERROR] " << tag << ": " << format << std::endl
+#endif
+
+static const char *TAG = "TieredStorage";
+
+namespace lopcore
+{
+
+static const StorageTier ALL_TIERS[] = {StorageTier::HOT, StorageTier::WARM, StorageTier::COLD};
+
+TieredStorage::TieredStorage(Backend hot, Backend warm, Backend cold, const storage::TieredStorageConfig &config)
+    : tiers_{std::move(hot), std::move(warm), std::move(cold)}, config_(config)
+{
+}
+
+bool TieredStorage::write(const std::string &key, const std::vector<uint8_t> &data)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = placements_.find(key);
+    if (it == placements_.end())
+    {
+        // Untracked: a copy written before a reboot may sit in any tier
+        std::optional<StorageTier> written = store(key, data, homeFor(data.size()));
+        if (!written)
+        {
+            return false;
+        }
+        for (StorageTier tier : ALL_TIERS)
+        {
+            if (tier != *written && usable(tier))
+            {
+                backend(tier).remove(key);
+            }
+        }
+        Placement &placement = track(key, *written, data.size());
+        placement.heat++;
+        return true;
+    }
+
+    Placement &placement = it->second;
+    StorageTier target = placement.tier;
+    size_t hotAfter = hotBytes_ - (placement.tier == StorageTier::HOT ? placement.size : 0) + data.size();
+    if (!usable(target) || !fits(target, data.size()) ||
+        (target == StorageTier::HOT && hotAfter > config_.hotCapacity))
+    {
+        target = homeFor(data.size());
+    }
+
+    std::optional<StorageTier> written = store(key, data, target);
+    if (!written)
+    {
+        return false;
+    }
+    if (*written != placement.tier && usable(placement.tier))
+    {
+        backend(placement.tier).remove(key);
+    }
+
+    if (placement.tier == StorageTier::HOT)
+    {
+        hotBytes_ -= placement.size;
+    }
+    if (*written == StorageTier::HOT)
+    {
+        hotBytes_ += data.size();
+    }
+    placement.tier = *written;
+    placement.size = data.size();
+    placement.heat++;
+    placement.idle = 0;
+    return true;
+}
+
+bool TieredStorage::write(const std::string &key, const std::string &data)
+{
+    return write(key, std::vector<uint8_t>(data.begin(), data.end()));
+}
+
+std::optional<std::vector<uint8_t>> TieredStorage::readBinary(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::optional<std::vector<uint8_t>> value;
+    Placement *placement = nullptr;
+
+    auto it = placements_.find(key);
+    if (it != placements_.end())
+    {
+        if (usable(it->second.tier))
+        {
+            value = backend(it->second.tier).read(key);
+        }
+        if (value)
+        {
+            placement = &it->second;
+        }
+        else
+        {
+            // Removed behind our back, or its SD card was pulled
+            untrack(key);
+        }
+    }
+    if (placement == nullptr)
+    {
+        placement = locate(key, &value);
+    }
+    if (placement == nullptr)
+    {
+        stats_.misses++;
+        return std::nullopt;
+    }
+
+    switch (placement->tier)
+    {
+        case StorageTier::HOT:
+            stats_.hotReads++;
+            hotBytes_ = hotBytes_ - placement->size + value->size();
+            break;
+        case StorageTier::WARM:
+            stats_.warmReads++;
+            break;
+        case StorageTier::COLD:
+            stats_.coldReads++;
+            break;
+    }
+    placement->size = value->size();
+    placement->heat++;
+    placement->idle = 0;
+    return value;
+}
+
+std::optional<std::string> TieredStorage::read(const std::string &key)
+{
+    std::optional<std::vector<uint8_t>> value = readBinary(key);
+    if (!value)
+    {
+        return std::nullopt;
+    }
+    return std::string(value->begin(), value->end());
+}
+
+bool TieredStorage::exists(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return placements_.count(key) != 0 || locate(key) != nullptr;
+}
+
+bool TieredStorage::remove(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    untrack(key);
+    bool removed = false;
+    for (StorageTier tier : ALL_TIERS)
+    {
+        if (usable(tier) && backend(tier).remove(key))
+        {
+            removed = true;
+        }
+    }
+    return removed;
+}
+
+std::optional<StorageTier> TieredStorage::tierOf(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = placements_.find(key);
+    if (it != placements_.end())
+    {
+        return it->second.tier;
+    }
+    Placement *placement = locate(key);
+    if (placement == nullptr)
+    {
+        return std::nullopt;
+    }
+    return placement->tier;
+}
+
+size_t TieredStorage::rebalance()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t moved = 0;
+
+    // Hottest first, so they win any contested hot capacity
+    std::vector<std::pair<const std::string *, Placement *>> hot;
+    for (auto &entry : placements_)
+    {
+        if (entry.second.heat >= config_.promoteHeat && entry.second.tier != StorageTier::HOT)
+        {
+            hot.emplace_back(&entry.first, &entry.second);
+        }
+    }
+    std::sort(hot.begin(), hot.end(), [](const auto &a, const auto &b) { return a.second->heat > b.second->heat; });
+
+    for (auto &candidate : hot)
+    {
+        Placement &placement = *candidate.second;
+        StorageTier target = placement.tier == StorageTier::COLD ? StorageTier::WARM : StorageTier::HOT;
+        if (!usable(target) || !fits(target, placement.size))
+        {
+            continue;
+        }
+        if (target == StorageTier::HOT && !makeHotRoom(placement.size, placement.heat))
+        {
+            continue;
+        }
+        if (move(*candidate.first, placement, target))
+        {
+            stats_.promotions++;
+            moved++;
+        }
+    }
+
+    for (auto &entry : placements_)
+    {
+        Placement &placement = entry.second;
+        if (config_.demoteAfter == 0 || placement.idle < config_.demoteAfter ||
+            placement.heat >= config_.promoteHeat || placement.tier == StorageTier::COLD)
+        {
+            continue;
+        }
+        StorageTier target = placement.tier == StorageTier::HOT ? StorageTier::WARM : StorageTier::COLD;
+        if (usable(target) && move(entry.first, placement, target))
+        {
+            stats_.demotions++;
+            moved++;
+            placement.idle = 0; // Another demoteAfter passes before the next tier down
+        }
+    }
+
+    for (auto &entry : placements_)
+    {
+        entry.second.heat /= 2;
+        entry.second.idle++;
+    }
+
+    if (moved > 0)
+    {
+        ESP_LOGI(TAG, "Rebalanced %zu keys (%zu hot bytes)", moved, hotBytes_);
+    }
+    return moved;
+}
+
+TieredStorageStats TieredStorage::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    TieredStorageStats stats = stats_;
+    stats.trackedKeys = placements_.size();
+    stats.hotBytes = hotBytes_;
+    return stats;
+}
+
+bool TieredStorage::usable(StorageTier tier) const
+{
+    const Backend &tierBackend = tiers_[static_cast<size_t>(tier)];
+    return tierBackend.write && (!tierBackend.available || tierBackend.available());
+}
+
+TieredStorage::Backend &TieredStorage::backend(StorageTier tier)
+{
+    return tiers_[static_cast<size_t>(tier)];
+}
+
+StorageTier TieredStorage::homeFor(size_t size) const
+{
+    if (size > config_.warmMaxSize && usable(StorageTier::COLD))
+    {
+        return StorageTier::COLD;
+    }
+    return StorageTier::WARM;
+}
+
+bool TieredStorage::fits(StorageTier tier, size_t size) const
+{
+    switch (tier)
+    {
+        case StorageTier::HOT:
+            return size <= config_.hotMaxSize;
+        case StorageTier::WARM:
+            return size <= config_.warmMaxSize || !usable(StorageTier::COLD);
+        default:
+            return true;
+    }
+}
+
+std::optional<StorageTier> TieredStorage::store(const std::string &key, const std::vector<uint8_t> &data,
+                                                StorageTier preferred)
+{
+    if (usable(preferred) && backend(preferred).write(key, data))
+    {
+        return preferred;
+    }
+    if (preferred != StorageTier::WARM && usable(StorageTier::WARM) && backend(StorageTier::WARM).write(key, data))
+    {
+        return StorageTier::WARM;
+    }
+    ESP_LOGE(TAG, "No tier accepted %s (%zu bytes)", key.c_str(), data.size());
+    return std::nullopt;
+}
+
+TieredStorage::Placement *TieredStorage::locate(const std::string &key, std::optional<std::vector<uint8_t>> *probed)
+{
+    auto it = placements_.find(key);
+    if (it != placements_.end())
+    {
+        return &it->second;
+    }
+
+    for (StorageTier tier : ALL_TIERS)
+    {
+        if (!usable(tier))
+        {
+            continue;
+        }
+        std::optional<std::vector<uint8_t>> value = backend(tier).read(key);
+        if (value)
+        {
+            Placement &placement = track(key, tier, value->size());
+            if (probed != nullptr)
+            {
+                *probed = std::move(value);
+            }
+            return &placement;
+        }
+    }
+    return nullptr;
+}
+
+TieredStorage::Placement &TieredStorage::track(const std::string &key, StorageTier tier, size_t size)
+{
+    if (config_.maxKeys > 0 && placements_.size() >= config_.maxKeys)
+    {
+        auto coldest = std::min_element(placements_.begin(), placements_.end(), [](const auto &a, const auto &b) {
+            return a.second.heat != b.second.heat ? a.second.heat < b.second.heat : a.second.idle > b.second.idle;
+        });
+        untrack(coldest->first);
+    }
+
+    if (tier == StorageTier::HOT)
+    {
+        hotBytes_ += size;
+    }
+    return placements_[key] = Placement{tier, size, 0, 0};
+}
+
+void TieredStorage::untrack(const std::string &key)
+{
+    auto it = placements_.find(key);
+    if (it == placements_.end())
+    {
+        return;
+    }
+    if (it->second.tier == StorageTier::HOT)
+    {
+        hotBytes_ -= it->second.size;
+    }
+    placements_.erase(it);
+}
+
+bool TieredStorage::move(const std::string &key, Placement &placement, StorageTier to)
+{
+    if (!usable(placement.tier))
+    {
+        return false;
+    }
+    std::optional<std::vector<uint8_t>> value = backend(placement.tier).read(key);
+    if (!value || !backend(to).write(key, *value))
+    {
+        return false;
+    }
+    backend(placement.tier).remove(key);
+
+    if (placement.tier == StorageTier::HOT)
+    {
+        hotBytes_ -= placement.size;
+    }
+    if (to == StorageTier::HOT)
+    {
+        hotBytes_ += value->size();
+    }
+    placement.tier = to;
+    placement.size = value->size();
+    return true;
+}
+
+bool TieredStorage::makeHotRoom(size_t size, uint32_t heat)
+{
+    while (hotBytes_ + size > config_.hotCapacity)
+    {
+        auto coldest = placements_.end();
+        for (auto it = placements_.begin(); it != placements_.end(); ++it)
+        {
+            if (it->second.tier == StorageTier::HOT && it->second.heat < heat &&
+                (coldest == placements_.end() || it->second.heat < coldest->second.heat))
+            {
+                coldest = it;
+            }
+        }
+        if (coldest == placements_.end() || !usable(StorageTier::WARM) ||
+            !move(coldest->first, coldest->second, StorageTier::WARM))
+        {
+            return false;
+        }
+        stats_.demotions++;
+    }
+    return true;
+}
+
+} // namespace lopcore
@@ -0,0 +1,525 @@
+/**
+ * @file time_series_store.cpp
+ * @brief Append-only time-series records in rolling segment files
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/storage/time_series_store.hpp"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef ESP_PLATFORM
+#include <esp_log.h>
+#else
+// Host mocks
+#include <iostream>
+#define ESP_LOGI(tag, format, ...) std::cout << "[INFO] " << tag << ": " << format << std::endl
+#define ESP_LOGW(tag, format, ...) std::cout << "[WARN] " << tag << ": " << format << std::endl
+#define ESP_LOGE(tag, format, ...) std::cerr << "[ERROR] " << tag << ": " << format << std::endl
+#endif
+
+static const char *TAG = "TimeSeriesStore";
+
+namespace lopcore
+{
+
+static constexpr size_t FIXED_TIMESTAMP_BYTES = 8;
+static constexpr size_t MAX_VARINT_BYTES = 10;
+static constexpr size_t READ_CHUNK_SIZE = 1024;
+static constexpr const char *SEGMENT_SUFFIX = ".seg";
+static constexpr size_t SEGMENT_NAME_LENGTH = 16 + 4;
+
+TimeSeriesStore::TimeSeriesStore(const storage::TimeSeriesConfig &config) : config_(config)
+{
+}
+
+TimeSeriesStore::~TimeSeriesStore()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    closeWriter();
+}
+
+bool TimeSeriesStore::open()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (open_)
+    {
+        return true;
+    }
+
+    if (config_.directory.empty() || config_.recordSize == 0 || config_.indexInterval == 0)
+    {
+        ESP_LOGE(TAG, "Invalid config: directory, recordSize and indexInterval are required");
+        return false;
+    }
+
+    if (mkdir(config_.directory.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        ESP_LOGE(TAG, "Failed to create directory: %s", config_.directory.c_str());
+        return false;
+    }
+
+    DIR *dir = opendir(config_.directory.c_str());
+    if (dir == nullptr)
+    {
+        ESP_LOGE(TAG, "Failed to open directory: %s", config_.directory.c_str());
+        return false;
+    }
+
+    // Also the largest encoded record, which readSegment() relies on
+    scratch_.resize(MAX_VARINT_BYTES + FIXED_TIMESTAMP_BYTES + config_.recordSize);
+
+    segments_.clear();
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        const char *name = entry->d_name;
+        if (strlen(name) != SEGMENT_NAME_LENGTH || strcmp(name + 16, SEGMENT_SUFFIX) != 0)
+        {
+            continue;
+        }
+
+        char *end = nullptr;
+        uint64_t first = strtoull(name, &end, 16);
+        if (end != name + 16)
+        {
+            continue;
+        }
+
+        Segment segment = {};
+        segment.first = static_cast<int64_t>(first);
+        segment.last = segment.first;
+        segments_.push_back(segment);
+    }
+    closedir(dir);
+
+    std::sort(segments_.begin(), segments_.end(),
+              [](const Segment &a, const Segment &b) { return a.first < b.first; });
+
+    for (size_t i = 0; i < segments_.size();)
+    {
+        if (indexSegment(segments_[i]) && segments_[i].records > 0)
+        {
+            i++;
+            continue;
+        }
+
+        // Empty or unreadable; an empty last segment is recreated by the next append
+        unlink(segmentPath(segments_[i].first).c_str());
+        segments_.erase(segments_.begin() + i);
+    }
+
+    unsyncedBytes_ = 0;
+    open_ = true;
+
+    ESP_LOGI(TAG, "Opened %s with %zu segments", config_.directory.c_str(), segments_.size());
+    return true;
+}
+
+bool TimeSeriesStore::append(int64_t timestamp, const void *record)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_ || record == nullptr || timestamp < 0)
+    {
+        return false;
+    }
+
+    int64_t previous = segments_.empty() ? timestamp : segments_.back().last;
+    if (timestamp < previous)
+    {
+        ESP_LOGE(TAG, "Timestamp %" PRId64 " is older than %" PRId64, timestamp, previous);
+        return false;
+    }
+
+    size_t length = encode(timestamp, previous, record);
+    if (segments_.empty() || segments_.back().bytes + length > config_.segmentBytes)
+    {
+        if (!startSegment(timestamp))
+        {
+            return false;
+        }
+        previous = timestamp;
+        length = encode(timestamp, previous, record);
+    }
+
+    Segment &segment = segments_.back();
+    if (!writer_)
+    {
+        writer_ = StorageWriter(segmentPath(segment.first), true, config_.bufferSize);
+        if (!writer_)
+        {
+            return false;
+        }
+    }
+
+    if (!writer_.write(scratch_.data(), length))
+    {
+        // Cut off whatever part of the record reached the file
+        writer_.close();
+        if (truncate(segmentPath(segment.first).c_str(), static_cast<off_t>(segment.bytes)) != 0)
+        {
+            ESP_LOGE(TAG, "Failed to truncate segment after write error");
+        }
+        return false;
+    }
+
+    if (segment.records % config_.indexInterval == 0)
+    {
+        segment.points.push_back({timestamp, previous, segment.bytes});
+    }
+    segment.bytes += length;
+    segment.records++;
+    segment.last = timestamp;
+
+    unsyncedBytes_ += length;
+    if (config_.syncBytes > 0 && unsyncedBytes_ >= config_.syncBytes)
+    {
+        if (!writer_.sync())
+        {
+            ESP_LOGE(TAG, "Failed to sync segment");
+        }
+        unsyncedBytes_ = 0;
+    }
+    return true;
+}
+
+size_t TimeSeriesStore::query(int64_t from, int64_t to, const Visitor &visit)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_ || from > to)
+    {
+        return 0;
+    }
+
+    // Make buffered records of the newest segment readable
+    if (writer_)
+    {
+        writer_.flush();
+    }
+
+    size_t visited = 0;
+    bool stopped = false;
+    for (const Segment &segment : segments_)
+    {
+        if (segment.last < from)
+        {
+            continue;
+        }
+        if (segment.first > to || stopped)
+        {
+            break;
+        }
+
+        // Start at the last index point before from; records equal to from may precede a point equal to it
+        auto point = std::lower_bound(segment.points.begin(), segment.points.end(), from,
+                                      [](const IndexPoint &p, int64_t t) { return p.timestamp < t; });
+        size_t offset = 0;
+        int64_t previous = segment.first;
+        if (point != segment.points.begin())
+        {
+            --point;
+            offset = point->offset;
+            previous = point->previous;
+        }
+
+        readSegment(segment, offset, previous, [&](int64_t timestamp, const uint8_t *record, size_t) {
+            if (timestamp < from)
+            {
+                return true;
+            }
+            if (timestamp > to)
+            {
+                stopped = true;
+                return false;
+            }
+            visited++;
+            stopped = !visit(timestamp, record);
+            return !stopped;
+        });
+    }
+    return visited;
+}
+
+size_t TimeSeriesStore::queryLast(int64_t span, const Visitor &visit)
+{
+    int64_t last = lastTimestamp();
+    return query(last - span, last, visit);
+}
+
+size_t TimeSeriesStore::removeBefore(int64_t timestamp)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t removed = 0;
+    while (segments_.size() > 1 && segments_.front().last < timestamp)
+    {
+        removeSegment(0);
+        removed++;
+    }
+    return removed;
+}
+
+bool TimeSeriesStore::sync()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    unsyncedBytes_ = 0;
+    return !writer_ || writer_.sync();
+}
+
+int64_t TimeSeriesStore::lastTimestamp() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return segments_.empty() ? 0 : segments_.back().last;
+}
+
+TimeSeriesStats TimeSeriesStore::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    TimeSeriesStats stats;
+    stats.segments = segments_.size();
+    for (const Segment &segment : segments_)
+    {
+        stats.records += segment.records;
+        stats.bytes += segment.bytes;
+    }
+    if (!segments_.empty())
+    {
+        stats.firstTimestamp = segments_.front().first;
+        stats.lastTimestamp = segments_.back().last;
+    }
+    return stats;
+}
+
+std::string TimeSeriesStore::segmentPath(int64_t first) const
+{
+    char name[SEGMENT_NAME_LENGTH + 1];
+    snprintf(name, sizeof(name), "%016" PRIx64 "%s", static_cast<uint64_t>(first), SEGMENT_SUFFIX);
+    return config_.directory + "/" + name;
+}
+
+size_t TimeSeriesStore::encode(int64_t timestamp, int64_t previous, const void *record)
+{
+    uint8_t *out = scratch_.data();
+    size_t length = 0;
+    if (config_.encoding == storage::TimeSeriesEncoding::FIXED)
+    {
+        uint64_t value = static_cast<uint64_t>(timestamp);
+        for (size_t i = 0; i < FIXED_TIMESTAMP_BYTES; i++)
+        {
+            out[length++] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+    else
+    {
+        // LEB128: 7 bits per byte, high bit set on all but the last
+        uint64_t delta = static_cast<uint64_t>(timestamp - previous);
+        do
+        {
+            uint8_t byte = delta & 0x7F;
+            delta >>= 7;
+            out[length++] = delta != 0 ? (byte | 0x80) : byte;
+        } while (delta != 0);
+    }
+
+    memcpy(out + length, record, config_.recordSize);
+    return length + config_.recordSize;
+}
+
+size_t TimeSeriesStore::decode(const uint8_t *data, size_t length, int64_t previous, int64_t &timestamp) const
+{
+    size_t used = 0;
+    if (config_.encoding == storage::TimeSeriesEncoding::FIXED)
+    {
+        if (length < FIXED_TIMESTAMP_BYTES)
+        {
+            return 0;
+        }
+        uint64_t value = 0;
+        for (size_t i = 0; i < FIXED_TIMESTAMP_BYTES; i++)
+        {
+            value |= static_cast<uint64_t>(data[i]) << (8 * i);
+        }
+        timestamp = static_cast<int64_t>(value);
+        used = FIXED_TIMESTAMP_BYTES;
+    }
+    else
+    {
+        uint64_t delta = 0;
+        for (unsigned shift = 0;; shift += 7)
+        {
+            if (used >= length || used >= MAX_VARINT_BYTES)
+            {
+                return 0;
+            }
+            uint8_t byte = data[used++];
+            delta |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                break;
+            }
+        }
+        timestamp = previous + static_cast<int64_t>(delta);
+    }
+
+    if (length - used < config_.recordSize)
+    {
+        return 0;
+    }
+    return used + config_.recordSize;
+}
+
+size_t TimeSeriesStore::readSegment(const Segment &segment,
+                                    size_t offset,
+                                    int64_t previous,
+                                    const RecordFunction &visit) const
+{
+    // Chunks are read straight into buffer, so the stream needs no buffer of its own
+    StorageReader reader(segmentPath(segment.first), 0);
+    if (!reader || !reader.seek(offset))
+    {
+        return offset;
+    }
+
+    std::vector<uint8_t> buffer(std::max(READ_CHUNK_SIZE, 2 * scratch_.size()));
+    size_t start = 0; // First unread byte in buffer
+    size_t end = 0;   // One past the last byte read into buffer
+    bool eof = false;
+    while (true)
+    {
+        if (!eof && end - start < scratch_.size())
+        {
+            memmove(buffer.data(), buffer.data() + start, end - start);
+            end -= start;
+            start = 0;
+            size_t got = reader.read(buffer.data() + end, buffer.size() - end);
+            eof = got == 0;
+            end += got;
+        }
+
+        int64_t timestamp = 0;
+        size_t used = decode(buffer.data() + start, end - start, previous, timestamp);
+        if (used == 0)
+        {
+            // A full record always fits in scratch_.size() bytes, so more data cannot help
+            if (eof || end - start >= scratch_.size())
+            {
+                break;
+            }
+            continue;
+        }
+
+        bool more = visit(timestamp, buffer.data() + start + used - config_.recordSize, offset);
+        start += used;
+        offset += used;
+        previous = timestamp;
+        if (!more)
+        {
+            break;
+        }
+    }
+    return offset;
+}
+
+bool TimeSeriesStore::indexSegment(Segment &segment)
+{
+    std::string path = segmentPath(segment.first);
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+    {
+        return false;
+    }
+
+    segment.points.clear();
+    segment.records = 0;
+    segment.last = segment.first;
+    size_t end = readSegment(segment, 0, segment.first, [&](int64_t timestamp, const uint8_t *, size_t offset) {
+        if (segment.records % config_.indexInterval == 0)
+        {
+            segment.points.push_back({timestamp, segment.last, offset});
+        }
+        segment.records++;
+        segment.last = timestamp;
+        return true;
+    });
+    segment.bytes = end;
+
+    if (end < static_cast<size_t>(st.st_size))
+    {
+        ESP_LOGW(TAG, "Dropping %zu byte partial record from %s", static_cast<size_t>(st.st_size) - end,
+                 path.c_str());
+        if (truncate(path.c_str(), static_cast<off_t>(end)) != 0)
+        {
+            ESP_LOGE(TAG, "Failed to truncate: %s", path.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TimeSeriesStore::startSegment(int64_t first)
+{
+    closeWriter();
+
+    if (!segments_.empty() && segments_.back().first == first)
+    {
+        // Every record of the full segment has this timestamp; the name is taken
+        ESP_LOGE(TAG, "Segment for timestamp %" PRId64 " is full", first);
+        return false;
+    }
+
+    writer_ = StorageWriter(segmentPath(first), false, config_.bufferSize);
+    if (!writer_)
+    {
+        return false;
+    }
+
+    Segment segment = {};
+    segment.first = first;
+    segment.last = first;
+    segments_.push_back(segment);
+    applyRetention();
+    return true;
+}
+
+bool TimeSeriesStore::closeWriter()
+{
+    unsyncedBytes_ = 0;
+    if (!writer_)
+    {
+        return true;
+    }
+    bool ok = writer_.sync();
+    return writer_.close() && ok;
+}
+
+void TimeSeriesStore::applyRetention()
+{
+    int64_t newest = segments_.back().last;
+    while (segments_.size() > 1 && ((config_.retention > 0 && segments_.front().last < newest - config_.retention) ||
+                                    (config_.maxSegments > 0 && segments_.size() > config_.maxSegments)))
+    {
+        removeSegment(0);
+    }
+}
+
+void TimeSeriesStore::removeSegment(size_t position)
+{
+    std::string path = segmentPath(segments_[position].first);
+    if (unlink(path.c_str()) != 0)
+    {
+        ESP_LOGE(TAG, "Failed to delete segment: %s", path.c_str());
+    }
+    segments_.erase(segments_.begin() + position);
+}
+
+} // namespace lopcore
@@ -0,0 +1,220 @@
+/**
+ * @file task_profile.cpp
+ * @brief Task creation with profile settings and stack tracking
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/task/task_profile.hpp"
+
+#include <algorithm>
+
+#include "lopcore/logging/logger.hpp"
+
+static const char *TAG = "TaskProfile";
+
+namespace lopcore
+{
+namespace task
+{
+
+namespace
+{
+
+std::mutex trackingMutex;                 ///< Guards the tables below
+TaskStackReport reports[TASK_ROLE_COUNT]; ///< Per-role totals
+
+/**
+ * @brief A spawned task still alive, sampled by getStackReport()
+ */
+struct LiveTask
+{
+    TaskHandle_t handle;
+    TaskRole role;
+};
+
+constexpr size_t MAX_LIVE_TASKS = 32; ///< Tasks tracked at once; more are counted as started only
+LiveTask liveTasks[MAX_LIVE_TASKS]{};
+
+void sampleStack(TaskStackReport &report, TaskHandle_t handle)
+{
+#ifdef ESP_PLATFORM
+    // ESP-IDF stacks are byte-addressed: the mark is in bytes
+    uint32_t freeBytes = uxTaskGetStackHighWaterMark(handle);
+    report.minFreeStack = report.minFreeStack == 0 ? freeBytes : std::min(report.minFreeStack, freeBytes);
+#else
+    (void)report;
+    (void)handle;
+#endif
+}
+
+} // namespace
+
+const char *roleName(TaskRole role)
+{
+    switch (role)
+    {
+        case TaskRole::MQTT_LOOP:
+            return "mqtt_loop";
+        case TaskRole::MQTT_AGENT:
+            return "mqtt_agent";
+        case TaskRole::MQTT_ESP:
+            return "mqtt_esp";
+        case TaskRole::MQTT_DISPATCH:
+            return "mqtt_dispatch";
+        case TaskRole::MQTT_COALESCE:
+            return "mqtt_coalesce";
+        case TaskRole::TLS_CONNECT:
+            return "tls_connect";
+        case TaskRole::LOG_DRAIN:
+            return "log_drain";
+        case TaskRole::LOG_COMPRESS:
+            return "log_compress";
+        case TaskRole::LOG_MQTT:
+            return "log_mqtt";
+        case TaskRole::STORAGE_IO:
+            return "storage_io";
+        case TaskRole::STORAGE_MAINT:
+            return "storage_maint";
+        case TaskRole::METRICS_EXPORT:
+            return "metrics_export";
+        case TaskRole::BOOT_STEP:
+            return "boot_step";
+        default:
+            return "unknown";
+    }
+}
+
+std::array<TaskStackReport, TASK_ROLE_COUNT> getStackReport()
+{
+    std::lock_guard<std::mutex> lock(trackingMutex);
+    for (const LiveTask &live : liveTasks)
+    {
+        if (live.handle != nullptr)
+        {
+            sampleStack(reports[static_cast<size_t>(live.role)], live.handle);
+        }
+    }
+    std::array<TaskStackReport, TASK_ROLE_COUNT> result;
+    for (size_t i = 0; i < TASK_ROLE_COUNT; i++)
+    {
+        result[i] = reports[i];
+        result[i].role = static_cast<TaskRole>(i);
+    }
+    return result;
+}
+
+void logStackReport()
+{
+    for (const auto &report : getStackReport())
+    {
+        if (report.started == 0)
+        {
+            continue;
+        }
+        LOPCORE_LOGI(TAG, "%-14s core %2d prio %2u running %u/%u stack %u min free %u",
+                     roleName(report.role), getSettings(report.role).coreId,
+                     static_cast<unsigned>(getSettings(report.role).priority), static_cast<unsigned>(report.running),
+                     static_cast<unsigned>(report.started), static_cast<unsigned>(report.stackSize),
+                     static_cast<unsigned>(report.minFreeStack));
+    }
+}
+
+esp_err_t spawn(TaskRole role, const char *name, TaskFunction_t entry, void *arg, TaskHandle_t *handle)
+{
+    return spawn(role, name, entry, arg, getSettings(role), handle);
+}
+
+esp_err_t spawn(TaskRole role,
+                const char *name,
+                TaskFunction_t entry,
+                void *arg,
+                uint32_t stackSize,
+                uint32_t priority,
+                TaskHandle_t *handle)
+{
+    TaskSettings settings = getSettings(role);
+    settings.stackSize = stackSize;
+    settings.priority = priority;
+    return spawn(role, name, entry, arg, settings, handle);
+}
+
+esp_err_t spawn(TaskRole role,
+                const char *name,
+                TaskFunction_t entry,
+                void *arg,
+                const TaskSettings &settings,
+                TaskHandle_t *handle)
+{
+    TaskHandle_t created = nullptr;
+    TaskHandle_t *target = handle != nullptr ? handle : &created; // Set before the task first runs
+
+    // Held across creation so a task that exits at once finds itself in the table
+    std::lock_guard<std::mutex> lock(trackingMutex);
+#ifdef ESP_PLATFORM
+    BaseType_t core = settings.coreId < 0 ? tskNO_AFFINITY : settings.coreId;
+    BaseType_t result = xTaskCreatePinnedToCore(entry, name, settings.stackSize, arg, settings.priority, target, core);
+#else
+    BaseType_t result = xTaskCreate(entry, name, settings.stackSize, arg, settings.priority, target);
+#endif
+    if (result != pdPASS)
+    {
+        LOPCORE_LOGE(TAG, "Failed to create %s (%s, %u bytes of stack)", name, roleName(role),
+                     static_cast<unsigned>(settings.stackSize));
+        return ESP_ERR_NO_MEM;
+    }
+
+    TaskStackReport &report = reports[static_cast<size_t>(role)];
+    report.started++;
+    report.stackSize = settings.stackSize;
+    for (LiveTask &live : liveTasks)
+    {
+        if (live.handle == nullptr)
+        {
+            live = {*target, role};
+            report.running++;
+            break;
+        }
+    }
+
+    return ESP_OK;
+}
+
+namespace
+{
+
+void untrack(TaskHandle_t handle)
+{
+    std::lock_guard<std::mutex> lock(trackingMutex);
+    for (LiveTask &live : liveTasks)
+    {
+        if (live.handle == handle)
+        {
+            TaskStackReport &report = reports[static_cast<size_t>(live.role)];
+            sampleStack(report, handle);
+            report.running--;
+            live.handle = nullptr;
+            return;
+        }
+    }
+}
+
+} // namespace
+
+void exitTask()
+{
+    untrack(xTaskGetCurrentTaskHandle());
+    vTaskDelete(nullptr);
+}
+
+void forgetTask(TaskHandle_t handle)
+{
+    if (handle != nullptr)
+    {
+        untrack(handle);
+    }
+}
+
+} // namespace task
+} // namespace lopcore
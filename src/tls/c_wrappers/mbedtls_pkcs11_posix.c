@@ -35,9 +35,16 @@
 /* Standard includes. */
 #include <assert.h>
 #include <inttypes.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <esp_log.h>
+#include <esp_timer.h>
+
+/* Sockets, to resolve the host separately from the TCP connection. */
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
 
 #include "lopcore/tls/mbedtls_pkcs11_posix.h" /* TLS transport header. */
 
@@ -155,15 +162,63 @@ configureMbedtlsSniAlpn(MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context,
                         const MbedtlsPkcs11Credentials_t *pMbedtlsPkcs11Credentials,
                         const char *pHostName);
 
+/**
+ * @brief Restrict the cipher suites and key exchange groups offered to the server.
+ *
+ * The lists are copied into the context, which MbedTLS references until the
+ * connection closes. Without a list, the MbedTLS defaults are offered.
+ *
+ * @param[in] pMbedtlsPkcs11Context Network context.
+ * @param[in] pMbedtlsPkcs11Credentials TLS setup parameters.
+ *
+ * @return #MBEDTLS_PKCS11_SUCCESS on success,
+ * #MBEDTLS_PKCS11_INVALID_CREDENTIALS on error.
+ */
+static MbedtlsPkcs11Status_t
+configureMbedtlsAlgorithms(MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context,
+                           const MbedtlsPkcs11Credentials_t *pMbedtlsPkcs11Credentials);
+
 /**
  * @brief Configure the Maximum Fragment Length in the MbedTLS SSL context.
  *
  * @param[in] pMbedtlsPkcs11Context Network context.
+ * @param[in] maxFragmentLength 512, 1024, 2048 or 4096; 0 skips the extension.
  *
  * @return #MBEDTLS_PKCS11_SUCCESS on success,
  * #MBEDTLS_PKCS11_INVALID_CREDENTIALS on error.
  */
-static MbedtlsPkcs11Status_t configureMbedtlsFragmentLength(MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context);
+static MbedtlsPkcs11Status_t configureMbedtlsFragmentLength(MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context,
+                                                            uint16_t maxFragmentLength);
+
+/**
+ * @brief Resolve the host and open a TCP connection to it, timing each step.
+ *
+ * mbedtls_net_connect() resolves and connects in one call; resolving first
+ * and handing it the numeric address lets #MbedtlsPkcs11Stats_t tell a slow
+ * DNS server from a slow network. Addresses are tried in resolver order.
+ *
+ * @param[in] pMbedtlsPkcs11Context Network context; its stats are updated.
+ * @param[in] pHostName Server host name.
+ * @param[in] pPortStr Server port as a string.
+ *
+ * @return #MBEDTLS_PKCS11_SUCCESS on success,
+ * #MBEDTLS_PKCS11_CONNECT_FAILURE on error.
+ */
+static MbedtlsPkcs11Status_t connectSocket(MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context,
+                                           const char *pHostName,
+                                           const char *pPortStr);
+
+/**
+ * @brief Configure a saved session for resumption in the MbedTLS SSL context.
+ *
+ * A session that cannot be loaded is logged and skipped, so the handshake
+ * falls back to a full one.
+ *
+ * @param[in] pMbedtlsPkcs11Context Network context.
+ * @param[in] pMbedtlsPkcs11Credentials TLS setup parameters.
+ */
+static void configureMbedtlsSession(MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context,
+                                    const MbedtlsPkcs11Credentials_t *pMbedtlsPkcs11Credentials);
 
 /**
  * @brief Callback that wraps PKCS #11 for pseudo-random number generation. This
@@ -182,14 +237,16 @@ static int generateRandomBytes(void *pCtx, unsigned char *pRandom, size_t random
  * out of storage, into RAM, and then into an mbedTLS certificate context
  * object.
  *
- * @param[in] pContext Caller TLS context.
+ * @param[in] pP11FunctionList PKCS #11 function list.
+ * @param[in] p11Session PKCS #11 session.
  * @param[in] pLabelName PKCS #11 certificate object label.
  * @param[out] pCertificateContext Certificate context.
  *
  * @return True on success.
  */
-static bool readCertificateIntoContext(MbedtlsPkcs11Context_t *pContext,
-                                       char *pLabelName,
+static bool readCertificateIntoContext(CK_FUNCTION_LIST_PTR pP11FunctionList,
+                                       CK_SESSION_HANDLE p11Session,
+                                       const char *pLabelName,
                                        mbedtls_x509_crt *pCertificateContext);
 
 /**
@@ -197,10 +254,13 @@ static bool readCertificateIntoContext(MbedtlsPkcs11Context_t *pContext,
  *
  * @param pContext Caller context.
  * @param pPrivateKeyLabel PKCS #11 label for the private key.
+ * @param privateKeyHandle Handle of the private key, or CK_INVALID_HANDLE to search for the label.
  *
  * @return True on success.
  */
-static bool initializeClientKeys(MbedtlsPkcs11Context_t *pContext, const char *pPrivateKeyLabel);
+static bool initializeClientKeys(MbedtlsPkcs11Context_t *pContext,
+                                 const char *pPrivateKeyLabel,
+                                 CK_OBJECT_HANDLE privateKeyHandle);
 
 /**
  * @brief Sign a cryptographic hash with the private key. This is passed as a
@@ -323,6 +383,15 @@ static MbedtlsPkcs11Status_t configureMbedtls(MbedtlsPkcs11Context_t *pMbedtlsPk
                                       &(pMbedtlsPkcs11Context->certProfile));
         mbedtls_ssl_conf_read_timeout(&(pMbedtlsPkcs11Context->config), recvTimeoutMs);
         mbedtls_ssl_conf_dbg(&pMbedtlsPkcs11Context->config, mbedtlsDebugPrint, NULL);
+#ifdef MBEDTLS_SSL_RENEGOTIATION
+        /* A renegotiation would write from the read path, racing a concurrent send. */
+        mbedtls_ssl_conf_renegotiation(&(pMbedtlsPkcs11Context->config), MBEDTLS_SSL_RENEGOTIATION_DISABLED);
+#endif
+#ifdef MBEDTLS_SSL_SESSION_TICKETS
+        /* Ask for a ticket so the next connection can resume without a server-side cache. */
+        mbedtls_ssl_conf_session_tickets(&(pMbedtlsPkcs11Context->config),
+                                         MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
         // mbedtls_debug_set_threshold( MBEDTLS_DEBUG_LOG_LEVEL );
 
         returnStatus = configureMbedtlsCertificates(pMbedtlsPkcs11Context, pMbedtlsPkcs11Credentials);
@@ -333,6 +402,11 @@ static MbedtlsPkcs11Status_t configureMbedtls(MbedtlsPkcs11Context_t *pMbedtlsPk
         returnStatus = configureMbedtlsSniAlpn(pMbedtlsPkcs11Context, pMbedtlsPkcs11Credentials, pHostName);
     }
 
+    if (returnStatus == MBEDTLS_PKCS11_SUCCESS)
+    {
+        returnStatus = configureMbedtlsAlgorithms(pMbedtlsPkcs11Context, pMbedtlsPkcs11Credentials);
+    }
+
     if (returnStatus == MBEDTLS_PKCS11_SUCCESS)
     {
         /* Initialize the MbedTLS secured connection context. */
@@ -353,7 +427,13 @@ static MbedtlsPkcs11Status_t configureMbedtls(MbedtlsPkcs11Context_t *pMbedtlsPk
                             (void *) &(pMbedtlsPkcs11Context->socketContext), mbedtls_net_send,
                             mbedtls_net_recv, mbedtls_net_recv_timeout);
 
-        returnStatus = configureMbedtlsFragmentLength(pMbedtlsPkcs11Context);
+        returnStatus = configureMbedtlsFragmentLength(pMbedtlsPkcs11Context,
+                                                      pMbedtlsPkcs11Credentials->maxFragmentLength);
+    }
+
+    if ((returnStatus == MBEDTLS_PKCS11_SUCCESS) && (pMbedtlsPkcs11Credentials->pSession != NULL))
+    {
+        configureMbedtlsSession(pMbedtlsPkcs11Context, pMbedtlsPkcs11Credentials);
     }
 
     if (returnStatus != MBEDTLS_PKCS11_SUCCESS)
@@ -378,14 +458,25 @@ configureMbedtlsCertificates(MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context,
     MbedtlsPkcs11Status_t returnStatus = MBEDTLS_PKCS11_SUCCESS;
     int32_t mbedtlsError = 0;
     bool result;
+    mbedtls_x509_crt *pRootCa = &(pMbedtlsPkcs11Context->rootCa);
+    mbedtls_x509_crt *pClientCert = &(pMbedtlsPkcs11Context->clientCert);
 
     assert(pMbedtlsPkcs11Context != NULL);
     assert(pMbedtlsPkcs11Credentials != NULL);
-    assert(pMbedtlsPkcs11Credentials->pRootCaPath != NULL);
+    assert((pMbedtlsPkcs11Credentials->pRootCa != NULL) || (pMbedtlsPkcs11Credentials->pRootCaPath != NULL));
+    assert((pMbedtlsPkcs11Credentials->pClientCert != NULL) ||
+           (pMbedtlsPkcs11Credentials->pClientCertLabel != NULL));
 
-    /* Parse the server root CA certificate into the SSL context. */
-    mbedtlsError = mbedtls_x509_crt_parse_file(&(pMbedtlsPkcs11Context->rootCa),
-                                               pMbedtlsPkcs11Credentials->pRootCaPath);
+    /* Parse the server root CA certificate into the SSL context, unless the caller parsed it already. */
+    if (pMbedtlsPkcs11Credentials->pRootCa != NULL)
+    {
+        pRootCa = pMbedtlsPkcs11Credentials->pRootCa;
+    }
+    else
+    {
+        mbedtlsError = mbedtls_x509_crt_parse_file(&(pMbedtlsPkcs11Context->rootCa),
+                                                   pMbedtlsPkcs11Credentials->pRootCaPath);
+    }
 
     if (mbedtlsError != 0)
     {
@@ -395,9 +486,10 @@ configureMbedtlsCertificates(MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context,
     }
     else
     {
-        mbedtls_ssl_conf_ca_chain(&(pMbedtlsPkcs11Context->config), &(pMbedtlsPkcs11Context->rootCa), NULL);
+        mbedtls_ssl_conf_ca_chain(&(pMbedtlsPkcs11Context->config), pRootCa, NULL);
         /* Setup the client private key. */
-        result = initializeClientKeys(pMbedtlsPkcs11Context, pMbedtlsPkcs11Credentials->pPrivateKeyLabel);
+        result = initializeClientKeys(pMbedtlsPkcs11Context, pMbedtlsPkcs11Credentials->pPrivateKeyLabel,
+                                      pMbedtlsPkcs11Credentials->privateKeyHandle);
 
         if (result == false)
         {
@@ -406,10 +498,15 @@ configureMbedtlsCertificates(MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context,
         }
     }
 
-    if (returnStatus == MBEDTLS_PKCS11_SUCCESS)
+    if ((returnStatus == MBEDTLS_PKCS11_SUCCESS) && (pMbedtlsPkcs11Credentials->pClientCert != NULL))
+    {
+        pClientCert = pMbedtlsPkcs11Credentials->pClientCert;
+    }
+    else if (returnStatus == MBEDTLS_PKCS11_SUCCESS)
     {
         /* Setup the client certificate. */
-        result = readCertificateIntoContext(pMbedtlsPkcs11Context,
+        result = readCertificateIntoContext(pMbedtlsPkcs11Context->pP11FunctionList,
+                                            pMbedtlsPkcs11Context->p11Session,
                                             pMbedtlsPkcs11Credentials->pClientCertLabel,
                                             &(pMbedtlsPkcs11Context->clientCert));
 
@@ -422,8 +519,7 @@ configureMbedtlsCertificates(MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context,
 
     if (returnStatus == MBEDTLS_PKCS11_SUCCESS)
     {
-        (void) mbedtls_ssl_conf_own_cert(&(pMbedtlsPkcs11Context->config),
-                                         &(pMbedtlsPkcs11Context->clientCert),
+        (void) mbedtls_ssl_conf_own_cert(&(pMbedtlsPkcs11Context->config), pClientCert,
                                          &(pMbedtlsPkcs11Context->privKey));
     }
 
@@ -477,36 +573,208 @@ configureMbedtlsSniAlpn(MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context,
 
 /*-----------------------------------------------------------*/
 
-static MbedtlsPkcs11Status_t configureMbedtlsFragmentLength(MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context)
+static MbedtlsPkcs11Status_t
+configureMbedtlsAlgorithms(MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context,
+                           const MbedtlsPkcs11Credentials_t *pMbedtlsPkcs11Credentials)
+{
+    MbedtlsPkcs11Status_t returnStatus = MBEDTLS_PKCS11_SUCCESS;
+    const uint16_t *pGroups = NULL;
+    size_t groupCount = 0U;
+    size_t count = 0U;
+    size_t i = 0U;
+
+    assert(pMbedtlsPkcs11Context != NULL);
+    assert(pMbedtlsPkcs11Credentials != NULL);
+
+    pGroups = pMbedtlsPkcs11Credentials->pGroups;
+    groupCount = (pGroups != NULL) ? pMbedtlsPkcs11Credentials->groupCount : 0U;
+
+    if ((pMbedtlsPkcs11Credentials->cipherSuiteCount > MBEDTLS_PKCS11_MAX_CIPHERSUITES) ||
+        (groupCount > MBEDTLS_PKCS11_MAX_GROUPS))
+    {
+        ESP_LOGE(TAG, "Too many cipher suites or groups: %u and %u, at most %u and %u.",
+                 (unsigned) pMbedtlsPkcs11Credentials->cipherSuiteCount, (unsigned) groupCount,
+                 (unsigned) MBEDTLS_PKCS11_MAX_CIPHERSUITES, (unsigned) MBEDTLS_PKCS11_MAX_GROUPS);
+        returnStatus = MBEDTLS_PKCS11_INVALID_CREDENTIALS;
+    }
+
+    if ((returnStatus == MBEDTLS_PKCS11_SUCCESS) && (pMbedtlsPkcs11Credentials->pCipherSuites != NULL) &&
+        (pMbedtlsPkcs11Credentials->cipherSuiteCount > 0U))
+    {
+        for (i = 0U; i < pMbedtlsPkcs11Credentials->cipherSuiteCount; i++)
+        {
+            int suite = (int) pMbedtlsPkcs11Credentials->pCipherSuites[i];
+
+            /* An unknown ID would only fail later, as a handshake error. */
+            if (mbedtls_ssl_ciphersuite_from_id(suite) == NULL)
+            {
+                ESP_LOGW(TAG, "Cipher suite 0x%04X is not enabled in MbedTLS, skipping it.",
+                         (unsigned) suite);
+            }
+            else
+            {
+                pMbedtlsPkcs11Context->cipherSuites[count] = suite;
+                count++;
+            }
+        }
+
+        pMbedtlsPkcs11Context->cipherSuites[count] = 0;
+
+        if (count == 0U)
+        {
+            ESP_LOGE(TAG, "None of the requested cipher suites is enabled in MbedTLS.");
+            returnStatus = MBEDTLS_PKCS11_INVALID_CREDENTIALS;
+        }
+        else
+        {
+            mbedtls_ssl_conf_ciphersuites(&(pMbedtlsPkcs11Context->config),
+                                          pMbedtlsPkcs11Context->cipherSuites);
+        }
+    }
+
+    if ((returnStatus == MBEDTLS_PKCS11_SUCCESS) && (groupCount > 0U))
+    {
+#if (MBEDTLS_VERSION_NUMBER >= 0x03010000)
+        /* MbedTLS leaves groups it was built without out of the offer. */
+        for (i = 0U; i < groupCount; i++)
+        {
+            pMbedtlsPkcs11Context->groups[i] = pGroups[i];
+        }
+
+        pMbedtlsPkcs11Context->groups[groupCount] = MBEDTLS_SSL_IANA_TLS_GROUP_NONE;
+        mbedtls_ssl_conf_groups(&(pMbedtlsPkcs11Context->config), pMbedtlsPkcs11Context->groups);
+#elif defined(MBEDTLS_ECP_C)
+        count = 0U;
+
+        for (i = 0U; i < groupCount; i++)
+        {
+            const mbedtls_ecp_curve_info *pCurve = mbedtls_ecp_curve_info_from_tls_id(pGroups[i]);
+
+            if (pCurve == NULL)
+            {
+                ESP_LOGW(TAG, "Group 0x%04X is not enabled in MbedTLS, skipping it.", (unsigned) pGroups[i]);
+            }
+            else
+            {
+                pMbedtlsPkcs11Context->groups[count] = pCurve->grp_id;
+                count++;
+            }
+        }
+
+        pMbedtlsPkcs11Context->groups[count] = MBEDTLS_ECP_DP_NONE;
+
+        if (count == 0U)
+        {
+            ESP_LOGE(TAG, "None of the requested groups is enabled in MbedTLS.");
+            returnStatus = MBEDTLS_PKCS11_INVALID_CREDENTIALS;
+        }
+        else
+        {
+            mbedtls_ssl_conf_curves(&(pMbedtlsPkcs11Context->config), pMbedtlsPkcs11Context->groups);
+        }
+#else
+        ESP_LOGW(TAG, "MbedTLS is built without elliptic curves, ignoring the group preferences.");
+#endif /* MBEDTLS_VERSION_NUMBER >= 0x03010000 */
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static MbedtlsPkcs11Status_t configureMbedtlsFragmentLength(MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context,
+                                                            uint16_t maxFragmentLength)
 {
     MbedtlsPkcs11Status_t returnStatus = MBEDTLS_PKCS11_SUCCESS;
-    int32_t mbedtlsError = 0;
 
     assert(pMbedtlsPkcs11Context != NULL);
 
 /* Set Maximum Fragment Length if enabled. */
 #ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+    int32_t mbedtlsError = 0;
+    unsigned char mflCode = MBEDTLS_SSL_MAX_FRAG_LEN_NONE;
 
-    /* Enable the max fragment extension. 4096 bytes is currently the largest fragment size permitted.
-     * See RFC 6066 https://tools.ietf.org/html/rfc6066#page-8 for more information.
-     *
-     * Smaller values can be found in "mbedtls/include/ssl.h".
-     */
-    mbedtlsError = mbedtls_ssl_conf_max_frag_len(&(pMbedtlsPkcs11Context->config),
-                                                 MBEDTLS_SSL_MAX_FRAG_LEN_4096);
+    /* RFC 6066 only defines these lengths, 4096 bytes being the largest.
+     * See https://tools.ietf.org/html/rfc6066#page-8 for more information.
+     * With MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH the I/O buffers shrink to the
+     * negotiated length after the handshake. */
+    switch (maxFragmentLength)
+    {
+        case 0:
+            break;
+        case 512:
+            mflCode = MBEDTLS_SSL_MAX_FRAG_LEN_512;
+            break;
+        case 1024:
+            mflCode = MBEDTLS_SSL_MAX_FRAG_LEN_1024;
+            break;
+        case 2048:
+            mflCode = MBEDTLS_SSL_MAX_FRAG_LEN_2048;
+            break;
+        case 4096:
+            mflCode = MBEDTLS_SSL_MAX_FRAG_LEN_4096;
+            break;
+        default:
+            ESP_LOGE(TAG, "Unsupported maximum fragment length: %u.", (unsigned) maxFragmentLength);
+            returnStatus = MBEDTLS_PKCS11_INVALID_CREDENTIALS;
+            break;
+    }
 
-    if (mbedtlsError != 0)
+    if ((returnStatus == MBEDTLS_PKCS11_SUCCESS) && (mflCode != MBEDTLS_SSL_MAX_FRAG_LEN_NONE))
     {
-        ESP_LOGE(TAG, "Failed to maximum fragment length extension: mbedTLSError= %s : %s.",
-                 mbedtlsHighLevelCodeOrDefault(mbedtlsError), mbedtlsLowLevelCodeOrDefault(mbedtlsError));
-        returnStatus = MBEDTLS_PKCS11_INTERNAL_ERROR;
+        mbedtlsError = mbedtls_ssl_conf_max_frag_len(&(pMbedtlsPkcs11Context->config), mflCode);
+
+        if (mbedtlsError != 0)
+        {
+            ESP_LOGE(TAG, "Failed to maximum fragment length extension: mbedTLSError= %s : %s.",
+                     mbedtlsHighLevelCodeOrDefault(mbedtlsError), mbedtlsLowLevelCodeOrDefault(mbedtlsError));
+            returnStatus = MBEDTLS_PKCS11_INTERNAL_ERROR;
+        }
     }
+#else
+    (void) maxFragmentLength;
 #endif /* ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
     return returnStatus;
 }
 
 /*-----------------------------------------------------------*/
 
+static void configureMbedtlsSession(MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context,
+                                    const MbedtlsPkcs11Credentials_t *pMbedtlsPkcs11Credentials)
+{
+    mbedtls_ssl_session session;
+    int32_t mbedtlsError = 0;
+
+    assert(pMbedtlsPkcs11Context != NULL);
+    assert(pMbedtlsPkcs11Credentials != NULL);
+
+    mbedtls_ssl_session_init(&session);
+
+    /* Fails after an MbedTLS upgrade changed the serialized format; a full handshake follows. */
+    mbedtlsError = mbedtls_ssl_session_load(&session, pMbedtlsPkcs11Credentials->pSession,
+                                            pMbedtlsPkcs11Credentials->sessionLength);
+
+    if (mbedtlsError == 0)
+    {
+        /* Copies the session into the SSL context. */
+        mbedtlsError = mbedtls_ssl_set_session(&(pMbedtlsPkcs11Context->context), &session);
+    }
+
+    if (mbedtlsError != 0)
+    {
+        ESP_LOGW(TAG, "Saved TLS session not usable, doing a full handshake: mbedTLSError= %s : %s.",
+                 mbedtlsHighLevelCodeOrDefault(mbedtlsError), mbedtlsLowLevelCodeOrDefault(mbedtlsError));
+    }
+    else
+    {
+        ESP_LOGD(TAG, "Offering saved TLS session for resumption.");
+    }
+
+    mbedtls_ssl_session_free(&session);
+}
+
+/*-----------------------------------------------------------*/
+
 static int generateRandomBytes(void *pCtx, unsigned char *pRandom, size_t randomLength)
 {
     /* Must cast from void pointer to conform to MbedTLS API. */
@@ -528,8 +796,9 @@ static int generateRandomBytes(void *pCtx, unsigned char *pRandom, size_t random
 
 /*----------------------------------------------------------*/
 
-static bool readCertificateIntoContext(MbedtlsPkcs11Context_t *pContext,
-                                       char *pLabelName,
+static bool readCertificateIntoContext(CK_FUNCTION_LIST_PTR pP11FunctionList,
+                                       CK_SESSION_HANDLE p11Session,
+                                       const char *pLabelName,
                                        mbedtls_x509_crt *pCertificateContext)
 {
     CK_RV pkcs11Ret = CKR_OK;
@@ -537,12 +806,12 @@ static bool readCertificateIntoContext(MbedtlsPkcs11Context_t *pContext,
     CK_OBJECT_HANDLE certificateHandle = 0;
     int32_t mbedtlsRet = -1;
 
-    assert(pContext != NULL);
+    assert(pP11FunctionList != NULL);
     assert(pLabelName != NULL);
     assert(pCertificateContext != NULL);
 
     /* Get the handle of the certificate. */
-    pkcs11Ret = xFindObjectWithLabelAndClass(pContext->p11Session, pLabelName, strlen(pLabelName),
+    pkcs11Ret = xFindObjectWithLabelAndClass(p11Session, (char *) pLabelName, strlen(pLabelName),
                                              CKO_CERTIFICATE, &certificateHandle);
 
     if ((pkcs11Ret == CKR_OK) && (certificateHandle == CK_INVALID_HANDLE))
@@ -556,8 +825,7 @@ static bool readCertificateIntoContext(MbedtlsPkcs11Context_t *pContext,
         template.type = CKA_VALUE;
         template.ulValueLen = 0;
         template.pValue = NULL;
-        pkcs11Ret = pContext->pP11FunctionList->C_GetAttributeValue(pContext->p11Session, certificateHandle,
-                                                                    &template, 1);
+        pkcs11Ret = pP11FunctionList->C_GetAttributeValue(p11Session, certificateHandle, &template, 1);
     }
 
     /* Create a buffer for the certificate. */
@@ -576,8 +844,7 @@ static bool readCertificateIntoContext(MbedtlsPkcs11Context_t *pContext,
     /* Export the certificate. */
     if (pkcs11Ret == CKR_OK)
     {
-        pkcs11Ret = pContext->pP11FunctionList->C_GetAttributeValue(pContext->p11Session, certificateHandle,
-                                                                    &template, 1);
+        pkcs11Ret = pP11FunctionList->C_GetAttributeValue(p11Session, certificateHandle, &template, 1);
     }
 
     /* Decode the certificate. */
@@ -595,7 +862,9 @@ static bool readCertificateIntoContext(MbedtlsPkcs11Context_t *pContext,
 
 /*-----------------------------------------------------------*/
 
-static bool initializeClientKeys(MbedtlsPkcs11Context_t *pContext, const char *pPrivateKeyLabel)
+static bool initializeClientKeys(MbedtlsPkcs11Context_t *pContext,
+                                 const char *pPrivateKeyLabel,
+                                 CK_OBJECT_HANDLE privateKeyHandle)
 {
     CK_RV ret = CKR_OK;
     CK_ATTRIBUTE template[2] = {0};
@@ -604,9 +873,17 @@ static bool initializeClientKeys(MbedtlsPkcs11Context_t *pContext, const char *p
     assert(pContext != NULL);
     assert(pPrivateKeyLabel != NULL);
 
-    /* Get the handle of the device private key. */
-    ret = xFindObjectWithLabelAndClass(pContext->p11Session, (char *) pPrivateKeyLabel,
-                                       strlen(pPrivateKeyLabel), CKO_PRIVATE_KEY, &pContext->p11PrivateKey);
+    /* Get the handle of the device private key, unless the caller already knows it. */
+    if (privateKeyHandle != CK_INVALID_HANDLE)
+    {
+        pContext->p11PrivateKey = privateKeyHandle;
+    }
+    else
+    {
+        ret = xFindObjectWithLabelAndClass(pContext->p11Session, (char *) pPrivateKeyLabel,
+                                           strlen(pPrivateKeyLabel), CKO_PRIVATE_KEY,
+                                           &pContext->p11PrivateKey);
+    }
 
     if ((ret == CKR_OK) && (pContext->p11PrivateKey == CK_INVALID_HANDLE))
     {
@@ -694,6 +971,7 @@ static int privateKeySigningCallback(void *pContext,
     /* Buffer big enough to hold data to be signed. */
     CK_BYTE toBeSigned[256];
     CK_ULONG toBeSignedLen = sizeof(toBeSigned);
+    int64_t signStartUs = 0;
 
     /* Unreferenced parameters. */
     (void) (pRng);
@@ -733,6 +1011,8 @@ static int privateKeySigningCallback(void *pContext,
         ret = CKR_ARGUMENTS_BAD;
     }
 
+    signStartUs = esp_timer_get_time();
+
     if (ret == CKR_OK)
     {
         /* Use the PKCS #11 module to sign. */
@@ -747,6 +1027,8 @@ static int privateKeySigningCallback(void *pContext,
                                                               toBeSignedLen, pSig, (CK_ULONG_PTR) pSigLen);
     }
 
+    pMbedtlsPkcs11Context->stats.signUs += (uint32_t) (esp_timer_get_time() - signStartUs);
+
     if ((ret == CKR_OK) && (pMbedtlsPkcs11Context->keyType == CKK_EC))
     {
         /* PKCS #11 for P256 returns a 64-byte signature with 32 bytes for R and 32 bytes for S.
@@ -782,10 +1064,13 @@ MbedtlsPkcs11Status_t Mbedtls_Pkcs11_Connect(NetworkContext_t *pNetworkContext,
     MbedtlsPkcs11Status_t returnStatus = MBEDTLS_PKCS11_SUCCESS;
     int32_t mbedtlsError = 0;
     char portStr[6] = {0};
+    int64_t startUs = 0;
 
     if ((pNetworkContext == NULL) || (pNetworkContext->pParams == NULL) || (pHostName == NULL) ||
-        (pMbedtlsPkcs11Credentials == NULL) || (pMbedtlsPkcs11Credentials->pRootCaPath == NULL) ||
-        (pMbedtlsPkcs11Credentials->pClientCertLabel == NULL) ||
+        (pMbedtlsPkcs11Credentials == NULL) ||
+        ((pMbedtlsPkcs11Credentials->pRootCaPath == NULL) && (pMbedtlsPkcs11Credentials->pRootCa == NULL)) ||
+        ((pMbedtlsPkcs11Credentials->pClientCertLabel == NULL) &&
+         (pMbedtlsPkcs11Credentials->pClientCert == NULL)) ||
         (pMbedtlsPkcs11Credentials->pPrivateKeyLabel == NULL))
     {
         ESP_LOGE(TAG,
@@ -799,6 +1084,7 @@ MbedtlsPkcs11Status_t Mbedtls_Pkcs11_Connect(NetworkContext_t *pNetworkContext,
     {
         snprintf(portStr, sizeof(portStr), "%u", port);
         pMbedtlsPkcs11Context = pNetworkContext->pParams;
+        memset(&(pMbedtlsPkcs11Context->stats), 0, sizeof(pMbedtlsPkcs11Context->stats));
 
         /* Configure MbedTLS. */
         returnStatus = configureMbedtls(pMbedtlsPkcs11Context, pHostName, pMbedtlsPkcs11Credentials,
@@ -808,24 +1094,22 @@ MbedtlsPkcs11Status_t Mbedtls_Pkcs11_Connect(NetworkContext_t *pNetworkContext,
     /* Establish a TCP connection with the server. */
     if (returnStatus == MBEDTLS_PKCS11_SUCCESS)
     {
-        mbedtlsError = mbedtls_net_connect(&(pMbedtlsPkcs11Context->socketContext), pHostName, portStr,
-                                           MBEDTLS_NET_PROTO_TCP);
-
-        if (mbedtlsError != 0)
-        {
-            ESP_LOGE(TAG, "Failed to connect to %s with error %" PRIu32 ".", pHostName, mbedtlsError);
-            returnStatus = MBEDTLS_PKCS11_CONNECT_FAILURE;
-        }
+        returnStatus = connectSocket(pMbedtlsPkcs11Context, pHostName, portStr);
     }
 
     if (returnStatus == MBEDTLS_PKCS11_SUCCESS)
     {
         /* Perform the TLS handshake. */
+        startUs = esp_timer_get_time();
         do
         {
             mbedtlsError = mbedtls_ssl_handshake(&(pMbedtlsPkcs11Context->context));
         } while ((mbedtlsError == MBEDTLS_ERR_SSL_WANT_READ) || (mbedtlsError == MBEDTLS_ERR_SSL_WANT_WRITE));
 
+        pMbedtlsPkcs11Context->stats.connectedAtUs = esp_timer_get_time();
+        pMbedtlsPkcs11Context->stats.handshakeUs =
+            (uint32_t) (pMbedtlsPkcs11Context->stats.connectedAtUs - startUs);
+
         if ((mbedtlsError != 0) || (mbedtls_ssl_get_verify_result(&(pMbedtlsPkcs11Context->context)) != 0U))
         {
             ESP_LOGE(TAG, "Failed to perform TLS handshake: mbedTLSError= %s : %s.",
@@ -841,7 +1125,204 @@ MbedtlsPkcs11Status_t Mbedtls_Pkcs11_Connect(NetworkContext_t *pNetworkContext,
     }
     else
     {
-        ESP_LOGI(TAG, "TLS Connection to %s established.", pHostName);
+        ESP_LOGI(TAG,
+                 "TLS Connection to %s established (resolve %" PRIu32 " us, TCP %" PRIu32
+                 " us, handshake %" PRIu32 " us, sign %" PRIu32 " us).",
+                 pHostName, pMbedtlsPkcs11Context->stats.resolveUs, pMbedtlsPkcs11Context->stats.tcpConnectUs,
+                 pMbedtlsPkcs11Context->stats.handshakeUs, pMbedtlsPkcs11Context->stats.signUs);
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static MbedtlsPkcs11Status_t connectSocket(MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context,
+                                           const char *pHostName,
+                                           const char *pPortStr)
+{
+    MbedtlsPkcs11Status_t returnStatus = MBEDTLS_PKCS11_CONNECT_FAILURE;
+    struct addrinfo hints;
+    struct addrinfo *pAddresses = NULL;
+    const struct addrinfo *pCurrent = NULL;
+    char addressStr[INET6_ADDRSTRLEN] = {0};
+    const void *pRawAddress = NULL;
+    int32_t mbedtlsError = 0;
+    int64_t startUs = 0;
+    int resolveError = 0;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    startUs = esp_timer_get_time();
+    resolveError = getaddrinfo(pHostName, pPortStr, &hints, &pAddresses);
+    pMbedtlsPkcs11Context->stats.resolveUs = (uint32_t) (esp_timer_get_time() - startUs);
+
+    if ((resolveError != 0) || (pAddresses == NULL))
+    {
+        ESP_LOGE(TAG, "Failed to resolve %s with error %d.", pHostName, resolveError);
+    }
+
+    startUs = esp_timer_get_time();
+
+    for (pCurrent = pAddresses; (pCurrent != NULL) && (returnStatus != MBEDTLS_PKCS11_SUCCESS);
+         pCurrent = pCurrent->ai_next)
+    {
+        if (pCurrent->ai_family == AF_INET)
+        {
+            pRawAddress = &(((const struct sockaddr_in *) pCurrent->ai_addr)->sin_addr);
+        }
+        else if (pCurrent->ai_family == AF_INET6)
+        {
+            pRawAddress = &(((const struct sockaddr_in6 *) pCurrent->ai_addr)->sin6_addr);
+        }
+        else
+        {
+            continue;
+        }
+
+        if (inet_ntop(pCurrent->ai_family, pRawAddress, addressStr, sizeof(addressStr)) == NULL)
+        {
+            continue;
+        }
+
+        /* Numeric host: mbedtls_net_connect() does not query DNS again. */
+        mbedtlsError = mbedtls_net_connect(&(pMbedtlsPkcs11Context->socketContext), addressStr, pPortStr,
+                                           MBEDTLS_NET_PROTO_TCP);
+
+        if (mbedtlsError == 0)
+        {
+            returnStatus = MBEDTLS_PKCS11_SUCCESS;
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Failed to connect to %s (%s) with error %" PRIi32 ".", pHostName, addressStr,
+                     mbedtlsError);
+        }
+    }
+
+    pMbedtlsPkcs11Context->stats.tcpConnectUs = (uint32_t) (esp_timer_get_time() - startUs);
+
+    if (pAddresses != NULL)
+    {
+        freeaddrinfo(pAddresses);
+    }
+
+    if ((returnStatus != MBEDTLS_PKCS11_SUCCESS) && (resolveError == 0))
+    {
+        ESP_LOGE(TAG, "Failed to connect to %s.", pHostName);
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MbedtlsPkcs11Status_t Mbedtls_Pkcs11_SaveSession(NetworkContext_t *pNetworkContext,
+                                                 unsigned char **ppSession,
+                                                 size_t *pSessionLength)
+{
+    MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context = NULL;
+    MbedtlsPkcs11Status_t returnStatus = MBEDTLS_PKCS11_SUCCESS;
+    mbedtls_ssl_session session;
+    int32_t mbedtlsError = 0;
+    size_t sessionLength = 0;
+    unsigned char *pSession = NULL;
+
+    mbedtls_ssl_session_init(&session);
+
+    if ((pNetworkContext == NULL) || (pNetworkContext->pParams == NULL) || (ppSession == NULL) ||
+        (pSessionLength == NULL))
+    {
+        ESP_LOGE(TAG,
+                 "Invalid input parameter(s): Arguments cannot be NULL. pNetworkContext=%p, "
+                 "ppSession=%p, pSessionLength=%p.",
+                 (void *) pNetworkContext, (void *) ppSession, (void *) pSessionLength);
+        returnStatus = MBEDTLS_PKCS11_INVALID_PARAMETER;
+    }
+    else
+    {
+        *ppSession = NULL;
+        *pSessionLength = 0;
+        pMbedtlsPkcs11Context = pNetworkContext->pParams;
+
+        /* MbedTLS 3.x exports a TLS 1.2 session only once per connection. */
+        mbedtlsError = mbedtls_ssl_get_session(&(pMbedtlsPkcs11Context->context), &session);
+
+        if (mbedtlsError != 0)
+        {
+            ESP_LOGE(TAG, "Failed to get TLS session: mbedTLSError= %s : %s.",
+                     mbedtlsHighLevelCodeOrDefault(mbedtlsError), mbedtlsLowLevelCodeOrDefault(mbedtlsError));
+            returnStatus = MBEDTLS_PKCS11_INTERNAL_ERROR;
+        }
+    }
+
+    if (returnStatus == MBEDTLS_PKCS11_SUCCESS)
+    {
+        /* Query the serialized length, then serialize into a buffer of that size. */
+        (void) mbedtls_ssl_session_save(&session, NULL, 0, &sessionLength);
+        pSession = malloc(sessionLength);
+
+        if ((sessionLength == 0) || (pSession == NULL))
+        {
+            ESP_LOGE(TAG, "Failed to allocate %u bytes for the TLS session.", (unsigned) sessionLength);
+            returnStatus = MBEDTLS_PKCS11_INSUFFICIENT_MEMORY;
+        }
+    }
+
+    if (returnStatus == MBEDTLS_PKCS11_SUCCESS)
+    {
+        mbedtlsError = mbedtls_ssl_session_save(&session, pSession, sessionLength, &sessionLength);
+
+        if (mbedtlsError != 0)
+        {
+            ESP_LOGE(TAG, "Failed to serialize TLS session: mbedTLSError= %s : %s.",
+                     mbedtlsHighLevelCodeOrDefault(mbedtlsError), mbedtlsLowLevelCodeOrDefault(mbedtlsError));
+            returnStatus = MBEDTLS_PKCS11_INTERNAL_ERROR;
+        }
+    }
+
+    if (returnStatus == MBEDTLS_PKCS11_SUCCESS)
+    {
+        *ppSession = pSession;
+        *pSessionLength = sessionLength;
+    }
+    else
+    {
+        free(pSession);
+    }
+
+    mbedtls_ssl_session_free(&session);
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MbedtlsPkcs11Status_t Mbedtls_Pkcs11_ReadCertificate(CK_SESSION_HANDLE p11Session,
+                                                     const char *pLabelName,
+                                                     mbedtls_x509_crt *pCertificate)
+{
+    MbedtlsPkcs11Status_t returnStatus = MBEDTLS_PKCS11_SUCCESS;
+    CK_FUNCTION_LIST_PTR pP11FunctionList = NULL;
+
+    if ((pLabelName == NULL) || (pCertificate == NULL))
+    {
+        ESP_LOGE(TAG, "Invalid input parameter(s): Arguments cannot be NULL. pLabelName=%p, pCertificate=%p.",
+                 (const void *) pLabelName, (void *) pCertificate);
+        returnStatus = MBEDTLS_PKCS11_INVALID_PARAMETER;
+    }
+    else if ((C_GetFunctionList(&pP11FunctionList) != CKR_OK) || (pP11FunctionList == NULL))
+    {
+        ESP_LOGE(TAG, "Failed to get the PKCS #11 function list.");
+        returnStatus = MBEDTLS_PKCS11_INVALID_CREDENTIALS;
+    }
+    else if (readCertificateIntoContext(pP11FunctionList, p11Session, pLabelName, pCertificate) == false)
+    {
+        ESP_LOGE(TAG, "Failed to get certificate %s from PKCS #11 module.", pLabelName);
+        returnStatus = MBEDTLS_PKCS11_INVALID_CREDENTIALS;
     }
 
     return returnStatus;
@@ -894,11 +1375,34 @@ int32_t Mbedtls_Pkcs11_Recv(NetworkContext_t *pNetworkContext, void *pBuffer, si
 {
     MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context = NULL;
     int32_t tlsStatus = 0;
+    int64_t startUs = 0;
+    int64_t endUs = 0;
 
     assert((pNetworkContext != NULL) && (pNetworkContext->pParams != NULL));
 
     pMbedtlsPkcs11Context = pNetworkContext->pParams;
+    startUs = esp_timer_get_time();
     tlsStatus = (int32_t) mbedtls_ssl_read(&(pMbedtlsPkcs11Context->context), pBuffer, bytesToRecv);
+    endUs = esp_timer_get_time();
+    pMbedtlsPkcs11Context->stats.recvUs += (uint64_t) (endUs - startUs);
+
+    if (tlsStatus > 0)
+    {
+        if ((pMbedtlsPkcs11Context->stats.firstByteUs == 0U) &&
+            (pMbedtlsPkcs11Context->stats.connectedAtUs != 0))
+        {
+            pMbedtlsPkcs11Context->stats.firstByteUs =
+                (uint32_t) (endUs - pMbedtlsPkcs11Context->stats.connectedAtUs);
+        }
+
+        pMbedtlsPkcs11Context->stats.bytesReceived += (uint64_t) tlsStatus;
+
+        /* A read returns data from one record only; count it once nothing of it is left. */
+        if (mbedtls_ssl_get_bytes_avail(&(pMbedtlsPkcs11Context->context)) == 0U)
+        {
+            pMbedtlsPkcs11Context->stats.recordsReceived++;
+        }
+    }
 
     if ((tlsStatus == MBEDTLS_ERR_SSL_TIMEOUT) || (tlsStatus == MBEDTLS_ERR_SSL_WANT_READ) ||
         (tlsStatus == MBEDTLS_ERR_SSL_WANT_WRITE))
@@ -931,11 +1435,21 @@ int32_t Mbedtls_Pkcs11_Send(NetworkContext_t *pNetworkContext, const void *pBuff
 {
     MbedtlsPkcs11Context_t *pMbedtlsPkcs11Context = NULL;
     int32_t tlsStatus = 0;
+    int64_t startUs = 0;
 
     assert((pNetworkContext != NULL) && (pNetworkContext->pParams != NULL));
 
     pMbedtlsPkcs11Context = pNetworkContext->pParams;
+    startUs = esp_timer_get_time();
     tlsStatus = (int32_t) mbedtls_ssl_write(&(pMbedtlsPkcs11Context->context), pBuffer, bytesToSend);
+    pMbedtlsPkcs11Context->stats.sendUs += (uint64_t) (esp_timer_get_time() - startUs);
+
+    if (tlsStatus > 0)
+    {
+        /* Each successful write produces exactly one record. */
+        pMbedtlsPkcs11Context->stats.bytesSent += (uint64_t) tlsStatus;
+        pMbedtlsPkcs11Context->stats.recordsSent++;
+    }
 
     if ((tlsStatus == MBEDTLS_ERR_SSL_TIMEOUT) || (tlsStatus == MBEDTLS_ERR_SSL_WANT_READ) ||
         (tlsStatus == MBEDTLS_ERR_SSL_WANT_WRITE))
@@ -0,0 +1,165 @@
+/**
+ * @file certificate_cache.cpp
+ * @brief Implementation of the parsed certificate cache
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/tls/certificate_cache.hpp"
+
+#include "lopcore/logging/logger.hpp"
+#include "lopcore/tls/mbedtls_pkcs11_posix.h"
+
+static const char *TAG = "CertificateCache";
+
+namespace lopcore
+{
+namespace tls
+{
+
+// Meyer's singleton - thread-safe in C++11+
+CertificateCache &CertificateCache::instance()
+{
+    static CertificateCache instance;
+    return instance;
+}
+
+CertificateCache::CertificateCache() : mutex_(nullptr)
+{
+    // Create mutex for thread safety
+    mutex_ = xSemaphoreCreateMutex();
+    if (mutex_ == nullptr)
+    {
+        LOPCORE_LOGE(TAG, "Failed to create mutex");
+    }
+}
+
+CertificateCache::~CertificateCache()
+{
+    clear();
+    if (mutex_ != nullptr)
+    {
+        vSemaphoreDelete(mutex_);
+        mutex_ = nullptr;
+    }
+}
+
+std::shared_ptr<mbedtls_x509_crt> CertificateCache::makeCertificate()
+{
+    std::shared_ptr<mbedtls_x509_crt> certificate(new mbedtls_x509_crt, [](mbedtls_x509_crt *crt) {
+        mbedtls_x509_crt_free(crt);
+        delete crt;
+    });
+    mbedtls_x509_crt_init(certificate.get());
+    return certificate;
+}
+
+std::shared_ptr<mbedtls_x509_crt> CertificateCache::caChain(const std::string &path)
+{
+    if (mutex_ == nullptr || xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<mbedtls_x509_crt> chain;
+    auto it = caChains_.find(path);
+    if (it != caChains_.end())
+    {
+        chain = it->second;
+    }
+    else
+    {
+        chain = makeCertificate();
+        int ret = mbedtls_x509_crt_parse_file(chain.get(), path.c_str());
+        if (ret == 0)
+        {
+            caChains_.emplace(path, chain);
+            LOPCORE_LOGD(TAG, "Cached CA chain %s", path.c_str());
+        }
+        else
+        {
+            LOPCORE_LOGE(TAG, "Failed to parse CA chain %s: -0x%04x", path.c_str(), static_cast<unsigned>(-ret));
+            chain.reset();
+        }
+    }
+
+    xSemaphoreGive(mutex_);
+    return chain;
+}
+
+std::shared_ptr<mbedtls_x509_crt> CertificateCache::clientCertificate(const std::string &label,
+                                                                      CK_SESSION_HANDLE session)
+{
+    if (mutex_ == nullptr || xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<mbedtls_x509_crt> certificate;
+    auto it = clientCerts_.find(label);
+    if (it != clientCerts_.end())
+    {
+        certificate = it->second;
+    }
+    else
+    {
+        certificate = makeCertificate();
+        if (Mbedtls_Pkcs11_ReadCertificate(session, label.c_str(), certificate.get()) == MBEDTLS_PKCS11_SUCCESS)
+        {
+            clientCerts_.emplace(label, certificate);
+            LOPCORE_LOGD(TAG, "Cached client certificate '%s'", label.c_str());
+        }
+        else
+        {
+            certificate.reset();
+        }
+    }
+
+    xSemaphoreGive(mutex_);
+    return certificate;
+}
+
+bool CertificateCache::invalidate(const std::string &key)
+{
+    if (mutex_ == nullptr || xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
+    {
+        return false;
+    }
+
+    size_t erased = caChains_.erase(key) + clientCerts_.erase(key);
+    xSemaphoreGive(mutex_);
+
+    if (erased > 0)
+    {
+        LOPCORE_LOGI(TAG, "Invalidated cached certificate %s", key.c_str());
+    }
+    return erased > 0;
+}
+
+void CertificateCache::clear()
+{
+    if (mutex_ == nullptr || xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
+    {
+        return;
+    }
+
+    caChains_.clear();
+    clientCerts_.clear();
+    xSemaphoreGive(mutex_);
+}
+
+size_t CertificateCache::size() const
+{
+    if (mutex_ == nullptr || xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
+    {
+        return 0;
+    }
+
+    size_t count = caChains_.size() + clientCerts_.size();
+    xSemaphoreGive(mutex_);
+    return count;
+}
+
+} // namespace tls
+} // namespace lopcore
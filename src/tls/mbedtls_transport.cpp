@@ -11,10 +11,23 @@
 
 #include "lopcore/tls/mbedtls_transport.hpp"
 
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/select.h>
 #include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <new>
+
+#include <esp_timer.h>
 
 #include "lopcore/logging/logger.hpp"
+#include "lopcore/storage/nvs_storage.hpp"
+#include "lopcore/task/task_profile.hpp"
+#include "lopcore/tls/certificate_cache.hpp"
 #include "lopcore/tls/pkcs11_provider.hpp"
 
 // Backoff algorithm for retries
@@ -23,6 +36,15 @@
 // Clock for sleep
 #include <clock.h>
 
+// Task for connectAsync()
+#include "freertos/task.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#include "esp_random.h"
+#include "esp_vfs_eventfd.h"
+#endif
+
 static const char *TAG = "MbedtlsTransport";
 
 namespace lopcore
@@ -37,20 +59,112 @@ static constexpr uint32_t DEFAULT_RETRY_BASE_MS = 500;
 static constexpr uint32_t DEFAULT_RETRY_MAX_MS = 5000;
 static constexpr uint32_t DEFAULT_RETRY_MAX_ATTEMPTS = 5;
 
+static_assert(MAX_CIPHER_SUITES == MBEDTLS_PKCS11_MAX_CIPHERSUITES, "TlsConfig and C wrapper limits differ");
+static_assert(MAX_KEY_EXCHANGE_GROUPS == MBEDTLS_PKCS11_MAX_GROUPS, "TlsConfig and C wrapper limits differ");
+
+/**
+ * @brief NVS key for a server's session: "tls_" and a 32-bit FNV-1a hash of "host:port"
+ *
+ * NVS keys are limited to 15 characters, too short for a hostname.
+ */
+static std::string sessionKeyFor(const std::string &peer)
+{
+    uint32_t hash = 2166136261u;
+    for (char c : peer)
+    {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    char key[16];
+    snprintf(key, sizeof(key), "tls_%08lx", static_cast<unsigned long>(hash));
+    return key;
+}
+
+namespace
+{
+
+/**
+ * @brief What a connectAsync() task owns
+ */
+struct AsyncConnect
+{
+    MbedtlsTransport *transport;             ///< Transport to connect
+    TlsConfig config;                        ///< Copy of the caller's configuration
+    ITlsTransport::ConnectCallback callback; ///< Called with the result
+};
+
+} // namespace
+
+/**
+ * @brief Random input for the backoff jitter
+ *
+ * The hardware RNG on target: devices booted together, before SNTP, would
+ * seed rand() from the same clock and retry in lockstep.
+ */
+static uint32_t backoffRandom()
+{
+#ifdef ESP_PLATFORM
+    return esp_random();
+#else
+    return static_cast<uint32_t>(rand());
+#endif
+}
+
+/**
+ * @brief Free 8-bit heap, for heapUsage(); 0 where it cannot be measured
+ */
+static size_t freeHeap()
+{
+#ifdef ESP_PLATFORM
+    return heap_caps_get_free_size(MALLOC_CAP_8BIT);
+#else
+    return 0;
+#endif
+}
+
 MbedtlsTransport::MbedtlsTransport()
     : connected_(false), tlsContext_(nullptr), networkContext_(nullptr), pkcs11Session_(),
-      alpnProtos_{nullptr, nullptr}, mutex_(nullptr)
+      alpnProtos_{nullptr, nullptr}, mutex_(nullptr), recvMutex_(nullptr), wakeFd_(-1), connecting_(false),
+      closing_(false), connectTasks_(0), connectAbort_(nullptr), resumeSessions_(true),
+      sessionCleared_(false), recvCapacity_(0), recvStart_(0), recvEnd_(0), heapUsage_(0),
+      statistics_(), recvSnapshot_{}
 {
-    // Create mutex for thread safety
+    // Create mutexes for thread safety: one for the connection and send path,
+    // one for the receive path, so a blocked recv() never holds up send()
     mutex_ = xSemaphoreCreateMutex();
-    if (mutex_ == nullptr)
+    recvMutex_ = xSemaphoreCreateMutex();
+    if (mutex_ == nullptr || recvMutex_ == nullptr)
     {
         LOPCORE_LOGE(TAG, "Failed to create mutex");
     }
+
+    // Without it backoffs cannot be cut short and disconnect() waits them out
+    connectAbort_ = xSemaphoreCreateBinary();
+
+#ifdef ESP_PLATFORM
+    // Shared by every eventfd in the application; already registered is fine
+    esp_vfs_eventfd_config_t eventfdConfig = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    esp_err_t err = esp_vfs_eventfd_register(&eventfdConfig);
+    if (err == ESP_OK || err == ESP_ERR_INVALID_STATE)
+    {
+        wakeFd_ = eventfd(0, 0);
+    }
+    if (wakeFd_ < 0)
+    {
+        LOPCORE_LOGW(TAG, "No eventfd for waitForData() wake-ups; waits run to their timeout");
+    }
+#endif
 }
 
 MbedtlsTransport::~MbedtlsTransport()
 {
+    // Cancel connectAsync() tasks and wait for their callbacks to return
+    closing_ = true;
+    while (connectTasks_.load() > 0)
+    {
+        disconnect();
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
     disconnect();
 
     if (mutex_ != nullptr)
@@ -58,17 +172,49 @@ MbedtlsTransport::~MbedtlsTransport()
         vSemaphoreDelete(mutex_);
         mutex_ = nullptr;
     }
+    if (recvMutex_ != nullptr)
+    {
+        vSemaphoreDelete(recvMutex_);
+        recvMutex_ = nullptr;
+    }
+    if (connectAbort_ != nullptr)
+    {
+        vSemaphoreDelete(connectAbort_);
+        connectAbort_ = nullptr;
+    }
+
+    if (wakeFd_ >= 0)
+    {
+        close(wakeFd_);
+        wakeFd_ = -1;
+    }
 }
 
 MbedtlsTransport::MbedtlsTransport(MbedtlsTransport &&other) noexcept
     : connected_(other.connected_), tlsContext_(std::move(other.tlsContext_)),
       networkContext_(std::move(other.networkContext_)), pkcs11Session_(std::move(other.pkcs11Session_)),
-      alpnProtos_{other.alpnProtos_[0], other.alpnProtos_[1]}, mutex_(other.mutex_)
+      alpnProtos_{other.alpnProtos_[0], other.alpnProtos_[1]}, mutex_(other.mutex_),
+      recvMutex_(other.recvMutex_), wakeFd_(other.wakeFd_), connecting_(false), closing_(false),
+      connectTasks_(0), connectAbort_(other.connectAbort_), resumeSessions_(other.resumeSessions_),
+      sessionCleared_(other.sessionCleared_),
+      session_(std::move(other.session_)), sessionPeer_(std::move(other.sessionPeer_)),
+      sessionKey_(std::move(other.sessionKey_)),
+      sessionStorage_(std::move(other.sessionStorage_)), caChain_(std::move(other.caChain_)),
+      clientCert_(std::move(other.clientCert_)), recvBuffer_(std::move(other.recvBuffer_)),
+      recvCapacity_(other.recvCapacity_), recvStart_(other.recvStart_), recvEnd_(other.recvEnd_),
+      heapUsage_(other.heapUsage_), statistics_(other.statistics_), recvSnapshot_(other.recvSnapshot_)
 {
     other.connected_ = false;
+    other.recvCapacity_ = 0;
+    other.recvStart_ = 0;
+    other.recvEnd_ = 0;
+    other.heapUsage_ = 0;
     other.alpnProtos_[0] = nullptr;
     other.alpnProtos_[1] = nullptr;
     other.mutex_ = nullptr;
+    other.recvMutex_ = nullptr;
+    other.connectAbort_ = nullptr;
+    other.wakeFd_ = -1;
 }
 
 MbedtlsTransport &MbedtlsTransport::operator=(MbedtlsTransport &&other) noexcept
@@ -81,6 +227,18 @@ MbedtlsTransport &MbedtlsTransport::operator=(MbedtlsTransport &&other) noexcept
         {
             vSemaphoreDelete(mutex_);
         }
+        if (recvMutex_ != nullptr)
+        {
+            vSemaphoreDelete(recvMutex_);
+        }
+        if (connectAbort_ != nullptr)
+        {
+            vSemaphoreDelete(connectAbort_);
+        }
+        if (wakeFd_ >= 0)
+        {
+            close(wakeFd_);
+        }
 
         // Move from other
         connected_ = other.connected_;
@@ -90,17 +248,139 @@ MbedtlsTransport &MbedtlsTransport::operator=(MbedtlsTransport &&other) noexcept
         alpnProtos_[0] = other.alpnProtos_[0];
         alpnProtos_[1] = other.alpnProtos_[1];
         mutex_ = other.mutex_;
+        recvMutex_ = other.recvMutex_;
+        connectAbort_ = other.connectAbort_;
+        wakeFd_ = other.wakeFd_;
+        resumeSessions_ = other.resumeSessions_;
+        sessionCleared_ = other.sessionCleared_;
+        session_ = std::move(other.session_);
+        sessionPeer_ = std::move(other.sessionPeer_);
+        sessionKey_ = std::move(other.sessionKey_);
+        sessionStorage_ = std::move(other.sessionStorage_);
+        caChain_ = std::move(other.caChain_);
+        clientCert_ = std::move(other.clientCert_);
+        recvBuffer_ = std::move(other.recvBuffer_);
+        recvCapacity_ = other.recvCapacity_;
+        recvStart_ = other.recvStart_;
+        recvEnd_ = other.recvEnd_;
+        heapUsage_ = other.heapUsage_;
+        statistics_ = other.statistics_;
+        recvSnapshot_ = other.recvSnapshot_;
 
         // Reset other
         other.connected_ = false;
+        other.recvCapacity_ = 0;
+        other.recvStart_ = 0;
+        other.recvEnd_ = 0;
+        other.heapUsage_ = 0;
         other.alpnProtos_[0] = nullptr;
         other.alpnProtos_[1] = nullptr;
         other.mutex_ = nullptr;
+        other.recvMutex_ = nullptr;
+        other.connectAbort_ = nullptr;
+        other.wakeFd_ = -1;
     }
     return *this;
 }
 
 esp_err_t MbedtlsTransport::connect(const TlsConfig &config)
+{
+    bool idle = false;
+    if (!connecting_.compare_exchange_strong(idle, true))
+    {
+        LOPCORE_LOGW(TAG, "Connection already in progress");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // A disconnect() before this connect() must not cancel it
+    if (connectAbort_ != nullptr)
+    {
+        xSemaphoreTake(connectAbort_, 0);
+    }
+
+    esp_err_t err = establish(config);
+    connecting_ = false;
+    return err;
+}
+
+esp_err_t MbedtlsTransport::connectAsync(const TlsConfig &config, ConnectCallback callback)
+{
+    if (closing_)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    bool idle = false;
+    if (!connecting_.compare_exchange_strong(idle, true))
+    {
+        LOPCORE_LOGW(TAG, "Connection already in progress");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (connected_)
+    {
+        connecting_ = false;
+        LOPCORE_LOGW(TAG, "Already connected");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (connectAbort_ != nullptr)
+    {
+        xSemaphoreTake(connectAbort_, 0);
+    }
+
+    auto *job = new (std::nothrow) AsyncConnect{this, config, std::move(callback)};
+    if (job == nullptr)
+    {
+        connecting_ = false;
+        return ESP_ERR_NO_MEM;
+    }
+
+    connectTasks_++;
+    if (task::spawn(task::TaskRole::TLS_CONNECT, "tls_connect", connectTaskEntry, job, config.connectTaskStackSize,
+                    task::getSettings(task::TaskRole::TLS_CONNECT).priority) != ESP_OK)
+    {
+        LOPCORE_LOGE(TAG, "Failed to create connect task");
+        connectTasks_--;
+        connecting_ = false;
+        delete job;
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+void MbedtlsTransport::connectTaskEntry(void *param)
+{
+    auto *job = static_cast<AsyncConnect *>(param);
+    MbedtlsTransport *self = job->transport;
+
+    esp_err_t err = self->establish(job->config);
+
+    // Cleared first so the callback can start another attempt
+    self->connecting_ = false;
+    if (job->callback)
+    {
+        job->callback(err);
+    }
+    delete job;
+
+    // Last access: the destructor may run as soon as this reaches zero
+    self->connectTasks_--;
+    task::exitTask();
+}
+
+bool MbedtlsTransport::backoffWait(uint32_t delayMs)
+{
+    if (connectAbort_ == nullptr)
+    {
+        Clock_SleepMs(delayMs);
+        return true;
+    }
+    return xSemaphoreTake(connectAbort_, pdMS_TO_TICKS(delayMs)) != pdTRUE;
+}
+
+esp_err_t MbedtlsTransport::establish(const TlsConfig &config)
 {
     // Validate configuration (detailed error messages are logged by validate())
     esp_err_t err = config.validate();
@@ -110,8 +390,8 @@ esp_err_t MbedtlsTransport::connect(const TlsConfig &config)
         return err;
     }
 
-    // Take mutex
-    if (mutex_ == nullptr || xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
+    // Take both mutexes: connect() replaces the contexts recv() uses
+    if (!lockAll())
     {
         LOPCORE_LOGE(TAG, "Failed to take mutex");
         return ESP_FAIL;
@@ -120,18 +400,33 @@ esp_err_t MbedtlsTransport::connect(const TlsConfig &config)
     // Check if already connected
     if (connected_)
     {
-        xSemaphoreGive(mutex_);
+        unlockAll();
         LOPCORE_LOGW(TAG, "Already connected");
         return ESP_ERR_INVALID_STATE;
     }
 
+#if !defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH) && !defined(CONFIG_MBEDTLS_DYNAMIC_BUFFER)
+    // Without these MbedTLS keeps its full 16 KB buffers whatever is negotiated
+    static bool shrinkWarned = false;
+    if (config.maxFragmentLength != 0 && !shrinkWarned)
+    {
+        shrinkWarned = true;
+        LOPCORE_LOGW(TAG, "Max fragment length %u set, but MbedTLS buffers do not shrink without "
+                          "CONFIG_MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH",
+                     static_cast<unsigned>(config.maxFragmentLength));
+    }
+#endif
+
+    // Heap use of this connection, measured across the handshake
+    size_t freeBefore = freeHeap();
+
     // Get PKCS#11 session
     CK_SESSION_HANDLE sessionHandle = 0;
     auto &provider = Pkcs11Provider::instance();
     err = provider.getSession(&sessionHandle);
     if (err != ESP_OK)
     {
-        xSemaphoreGive(mutex_);
+        unlockAll();
         LOPCORE_LOGE(TAG, "Failed to get PKCS#11 session: %d", err);
         return err;
     }
@@ -140,18 +435,26 @@ esp_err_t MbedtlsTransport::connect(const TlsConfig &config)
     pkcs11Session_ = Pkcs11Session();
     if (!pkcs11Session_.isValid())
     {
-        xSemaphoreGive(mutex_);
+        unlockAll();
         LOPCORE_LOGE(TAG, "Failed to create PKCS#11 session wrapper");
         return pkcs11Session_.error();
     }
 
+    // Parsed once per process and shared by every connection; on a miss the
+    // C wrapper reads them itself and reports the error
+    auto &certificates = CertificateCache::instance();
+    caChain_ = config.caCertPath.empty() ? nullptr : certificates.caChain(config.caCertPath);
+    clientCert_ = config.clientCertLabel.empty()
+                      ? nullptr
+                      : certificates.clientCertificate(config.clientCertLabel, sessionHandle);
+
     // Allocate contexts
-    tlsContext_ = std::make_unique<MbedtlsPkcs11Context_t>();
-    networkContext_ = std::make_unique<NetworkContext_t>();
+    tlsContext_ = memory::makeUnique<MbedtlsPkcs11Context_t>(memory::MemoryRole::HOT);
+    networkContext_ = memory::makeUnique<NetworkContext_t>(memory::MemoryRole::HOT);
 
     if (!tlsContext_ || !networkContext_)
     {
-        xSemaphoreGive(mutex_);
+        unlockAll();
         LOPCORE_LOGE(TAG, "Failed to allocate memory for contexts");
         return ESP_ERR_NO_MEM;
     }
@@ -163,32 +466,90 @@ esp_err_t MbedtlsTransport::connect(const TlsConfig &config)
     // Set network context to point to TLS context
     networkContext_->pParams = tlsContext_.get();
 
+    // Kept across reconnects while the size stays the same
+    if (recvCapacity_ != config.recvBufferSize)
+    {
+        bool allocated = recvBuffer_.allocate(config.recvBufferSize);
+        recvCapacity_ = recvBuffer_.size();
+        if (!allocated)
+        {
+            LOPCORE_LOGW(TAG, "No memory for a %u-byte receive buffer; receiving unbuffered",
+                         static_cast<unsigned>(config.recvBufferSize));
+        }
+    }
+    recvStart_ = 0;
+    recvEnd_ = 0;
+
+    resumeSessions_ = config.sessionResumption;
+    if (resumeSessions_)
+    {
+        prepareSession(config);
+    }
+
     // Attempt connection with retry logic
+    int64_t connectStartUs = esp_timer_get_time();
     err = connectWithRetries(config);
+    statistics_.connectTime = std::chrono::microseconds(esp_timer_get_time() - connectStartUs);
 
     if (err == ESP_OK)
     {
         // Connection successful
         connected_ = true;
-        LOPCORE_LOGI(TAG, "Successfully connected to %s:%u", config.hostname.c_str(), config.port);
+
+        const MbedtlsPkcs11Stats_t &phases = tlsContext_->stats;
+        statistics_.resolveTime = std::chrono::microseconds(phases.resolveUs);
+        statistics_.tcpConnectTime = std::chrono::microseconds(phases.tcpConnectUs);
+        statistics_.handshakeTime = std::chrono::microseconds(phases.handshakeUs);
+        statistics_.signTime = std::chrono::microseconds(phases.signUs);
+        statistics_.firstByteTime = std::chrono::microseconds(0);
+        statistics_.connects++;
+        recvSnapshot_ = MbedtlsPkcs11Stats_t{};
+        if (resumeSessions_)
+        {
+            saveSession();
+        }
+        size_t freeAfter = freeHeap();
+        heapUsage_ = freeBefore > freeAfter ? freeBefore - freeAfter : 0;
+        LOPCORE_LOGI(TAG, "Successfully connected to %s:%u (%u bytes of heap)", config.hostname.c_str(),
+                     config.port, static_cast<unsigned>(heapUsage_));
     }
     else
     {
         // Connection failed - clean up
+        statistics_.connectFailures++;
         tlsContext_.reset();
         networkContext_.reset();
+        caChain_.reset();
+        clientCert_.reset();
         LOPCORE_LOGE(TAG, "Failed to connect to %s:%u after retries", config.hostname.c_str(), config.port);
     }
 
-    xSemaphoreGive(mutex_);
+    unlockAll();
     return err;
 }
 
 void MbedtlsTransport::disconnect() noexcept
 {
-    if (mutex_ != nullptr)
+    // Ends a backoff of a connection being retried, which holds the mutexes
+    if (connecting_ && connectAbort_ != nullptr)
     {
-        xSemaphoreTake(mutex_, portMAX_DELAY);
+        xSemaphoreGive(connectAbort_);
+    }
+
+    // Waits for a recv() in progress, at most the receive timeout
+    bool locked = lockAll();
+
+    // Keep the connection's I/O counters in the totals
+    if (connected_ && tlsContext_)
+    {
+        const MbedtlsPkcs11Stats_t &io = tlsContext_->stats;
+        statistics_.firstByteTime = std::chrono::microseconds(io.firstByteUs);
+        statistics_.bytesSent += io.bytesSent;
+        statistics_.bytesReceived += io.bytesReceived;
+        statistics_.recordsSent += io.recordsSent;
+        statistics_.recordsReceived += io.recordsReceived;
+        statistics_.sendTime += std::chrono::microseconds(io.sendUs);
+        statistics_.recvTime += std::chrono::microseconds(io.recvUs);
     }
 
     if (connected_ && networkContext_)
@@ -201,14 +562,18 @@ void MbedtlsTransport::disconnect() noexcept
     // Clean up contexts
     tlsContext_.reset();
     networkContext_.reset();
+    caChain_.reset();
+    clientCert_.reset();
+    recvStart_ = 0;
+    recvEnd_ = 0;
 
     // Reset ALPN
     alpnProtos_[0] = nullptr;
     alpnProtos_[1] = nullptr;
 
-    if (mutex_ != nullptr)
+    if (locked)
     {
-        xSemaphoreGive(mutex_);
+        unlockAll();
     }
 }
 
@@ -219,6 +584,12 @@ esp_err_t MbedtlsTransport::send(const void *data, size_t size, size_t *bytesSen
         return ESP_ERR_INVALID_ARG;
     }
 
+    // Not connected yet: do not wait behind the connection's retries
+    if (connecting_)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
     if (mutex_ == nullptr || xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
     {
         return ESP_FAIL;
@@ -249,12 +620,18 @@ esp_err_t MbedtlsTransport::send(const void *data, size_t size, size_t *bytesSen
     return ESP_OK;
 }
 
-esp_err_t MbedtlsTransport::recv(void *buffer, size_t size, size_t *bytesReceived)
+esp_err_t MbedtlsTransport::sendv(const TlsSegment *segments, size_t count, size_t *bytesSent)
 {
-    if (buffer == nullptr || size == 0)
+    if (segments == nullptr || bytesSent == nullptr)
     {
         return ESP_ERR_INVALID_ARG;
     }
+    *bytesSent = 0;
+
+    if (connecting_)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
 
     if (mutex_ == nullptr || xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
     {
@@ -267,11 +644,133 @@ esp_err_t MbedtlsTransport::recv(void *buffer, size_t size, size_t *bytesReceive
         return ESP_ERR_INVALID_STATE;
     }
 
-    // Call C function to receive data
-    int32_t result = Mbedtls_Pkcs11_Recv(networkContext_.get(), buffer, size);
+    uint8_t staging[SENDV_STAGING_SIZE];
+    size_t staged = 0;
+    size_t total = 0;
+    int32_t result = 0;
+
+    // Writes staged bytes; false on error or short write
+    auto flushStaging = [&]() {
+        if (staged == 0)
+        {
+            return true;
+        }
+        result = Mbedtls_Pkcs11_Send(networkContext_.get(), staging, staged);
+        if (result < 0)
+        {
+            return false;
+        }
+        total += static_cast<size_t>(result);
+        bool complete = static_cast<size_t>(result) == staged;
+        staged = 0;
+        return complete;
+    };
+
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; i++)
+    {
+        const TlsSegment &segment = segments[i];
+        if (segment.size == 0)
+        {
+            continue;
+        }
+
+        if (segment.size < SENDV_STAGING_SIZE)
+        {
+            if (staged + segment.size > SENDV_STAGING_SIZE)
+            {
+                ok = flushStaging();
+                if (!ok)
+                {
+                    break;
+                }
+            }
+            memcpy(staging + staged, segment.data, segment.size);
+            staged += segment.size;
+            continue;
+        }
+
+        ok = flushStaging();
+        if (!ok)
+        {
+            break;
+        }
+        result = Mbedtls_Pkcs11_Send(networkContext_.get(), segment.data, segment.size);
+        if (result < 0)
+        {
+            ok = false;
+            break;
+        }
+        total += static_cast<size_t>(result);
+        ok = static_cast<size_t>(result) == segment.size; // Stop after a short write
+    }
+    if (ok)
+    {
+        flushStaging();
+    }
 
     xSemaphoreGive(mutex_);
 
+    if (result < 0)
+    {
+        LOPCORE_LOGE(TAG, "Send failed: %ld", result);
+        return ESP_FAIL;
+    }
+
+    *bytesSent = total;
+    return ESP_OK;
+}
+
+esp_err_t MbedtlsTransport::recv(void *buffer, size_t size, size_t *bytesReceived)
+{
+    if (buffer == nullptr || size == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (connecting_)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (recvMutex_ == nullptr || xSemaphoreTake(recvMutex_, portMAX_DELAY) != pdTRUE)
+    {
+        return ESP_FAIL;
+    }
+
+    if (!connected_ || !networkContext_)
+    {
+        xSemaphoreGive(recvMutex_);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int32_t result = 0;
+    if (recvStart_ == recvEnd_ && size >= recvCapacity_)
+    {
+        // Large read (or unbuffered): straight into the caller's buffer
+        result = Mbedtls_Pkcs11_Recv(networkContext_.get(), buffer, size);
+    }
+    else
+    {
+        if (recvStart_ == recvEnd_)
+        {
+            // Decrypt as much of the record as fits, for this read and the next ones
+            result = Mbedtls_Pkcs11_Recv(networkContext_.get(), recvBuffer_.data(), recvCapacity_);
+            recvStart_ = 0;
+            recvEnd_ = result > 0 ? static_cast<size_t>(result) : 0;
+        }
+
+        if (result >= 0)
+        {
+            size_t count = std::min(size, recvEnd_ - recvStart_);
+            memcpy(buffer, recvBuffer_.data() + recvStart_, count);
+            recvStart_ += count;
+            result = static_cast<int32_t>(count);
+        }
+    }
+
+    xSemaphoreGive(recvMutex_);
+
     if (result < 0)
     {
         LOPCORE_LOGE(TAG, "Receive failed: %ld", result);
@@ -292,11 +791,175 @@ esp_err_t MbedtlsTransport::recv(void *buffer, size_t size, size_t *bytesReceive
     return ESP_OK;
 }
 
+esp_err_t MbedtlsTransport::waitForData(uint32_t timeoutMs)
+{
+    if (connecting_)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (recvMutex_ == nullptr || xSemaphoreTake(recvMutex_, portMAX_DELAY) != pdTRUE)
+    {
+        return ESP_FAIL;
+    }
+
+    if (!connected_ || !tlsContext_)
+    {
+        xSemaphoreGive(recvMutex_);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Bytes may already be decrypted, in the receive buffer or inside MbedTLS
+    bool buffered = recvStart_ < recvEnd_ || mbedtls_ssl_get_bytes_avail(&tlsContext_->context) > 0;
+
+    // Poll a copy of the socket so disconnect() can free the context meanwhile
+    mbedtls_net_context socket = tlsContext_->socketContext;
+
+    xSemaphoreGive(recvMutex_);
+
+    if (buffered)
+    {
+        return ESP_OK;
+    }
+
+    if (wakeFd_ < 0)
+    {
+        int result = mbedtls_net_poll(&socket, MBEDTLS_NET_POLL_READ, timeoutMs);
+        if (result < 0)
+        {
+            LOPCORE_LOGE(TAG, "Socket poll failed: %d", result);
+            return ESP_FAIL;
+        }
+        return (result & MBEDTLS_NET_POLL_READ) != 0 ? ESP_OK : ESP_ERR_TIMEOUT;
+    }
+
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(socket.fd, &readSet);
+    FD_SET(wakeFd_, &readSet);
+
+    struct timeval timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_usec = (timeoutMs % 1000) * 1000;
+
+    int result = select(std::max(socket.fd, wakeFd_) + 1, &readSet, nullptr, nullptr, &timeout);
+    if (result < 0)
+    {
+        LOPCORE_LOGE(TAG, "Socket select failed: %d", errno);
+        return ESP_FAIL;
+    }
+
+    if (FD_ISSET(wakeFd_, &readSet))
+    {
+        uint64_t count = 0;
+        (void) read(wakeFd_, &count, sizeof(count)); // Reset the counter
+    }
+
+    return FD_ISSET(socket.fd, &readSet) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+void MbedtlsTransport::cancelWait()
+{
+    if (wakeFd_ >= 0)
+    {
+        uint64_t one = 1;
+        (void) write(wakeFd_, &one, sizeof(one));
+    }
+}
+
+TlsStatistics MbedtlsTransport::getStatistics() const
+{
+    if (mutex_ == nullptr || xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
+    {
+        return TlsStatistics{};
+    }
+
+    TlsStatistics stats = statistics_;
+    if (connected_ && tlsContext_)
+    {
+        // Send counters change under mutex_, receive counters under recvMutex_
+        const MbedtlsPkcs11Stats_t &live = tlsContext_->stats;
+        stats.bytesSent += live.bytesSent;
+        stats.recordsSent += live.recordsSent;
+        stats.sendTime += std::chrono::microseconds(live.sendUs);
+
+        if (recvMutex_ != nullptr && xSemaphoreTake(recvMutex_, 0) == pdTRUE)
+        {
+            recvSnapshot_ = live;
+            xSemaphoreGive(recvMutex_);
+        }
+        stats.firstByteTime = std::chrono::microseconds(recvSnapshot_.firstByteUs);
+        stats.bytesReceived += recvSnapshot_.bytesReceived;
+        stats.recordsReceived += recvSnapshot_.recordsReceived;
+        stats.recvTime += std::chrono::microseconds(recvSnapshot_.recvUs);
+    }
+
+    xSemaphoreGive(mutex_);
+    return stats;
+}
+
+void MbedtlsTransport::resetStatistics()
+{
+    if (!lockAll())
+    {
+        return;
+    }
+
+    statistics_.reset();
+    recvSnapshot_ = MbedtlsPkcs11Stats_t{};
+    if (tlsContext_)
+    {
+        // Phase times stay: they describe the connection still open
+        MbedtlsPkcs11Stats_t &live = tlsContext_->stats;
+        live.bytesSent = 0;
+        live.bytesReceived = 0;
+        live.recordsSent = 0;
+        live.recordsReceived = 0;
+        live.sendUs = 0;
+        live.recvUs = 0;
+    }
+
+    unlockAll();
+}
+
+std::string MbedtlsTransport::cipherSuite() const
+{
+    if (mutex_ == nullptr || xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
+    {
+        return std::string();
+    }
+
+    std::string name;
+    if (connected_ && tlsContext_)
+    {
+        const char *suite = mbedtls_ssl_get_ciphersuite(&tlsContext_->context);
+        name = suite != nullptr ? suite : "";
+    }
+
+    xSemaphoreGive(mutex_);
+    return name;
+}
+
 bool MbedtlsTransport::isConnected() const noexcept
 {
     return connected_;
 }
 
+bool MbedtlsTransport::hasSession() const
+{
+    return !session_.empty();
+}
+
+void MbedtlsTransport::clearSession()
+{
+    if (mutex_ == nullptr || xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
+    {
+        return;
+    }
+    dropSession();
+    xSemaphoreGive(mutex_);
+}
+
 void *MbedtlsTransport::getNetworkContext() noexcept
 {
     if (mutex_ != nullptr)
@@ -314,6 +977,30 @@ void *MbedtlsTransport::getNetworkContext() noexcept
     return context;
 }
 
+bool MbedtlsTransport::lockAll()
+{
+    if (mutex_ == nullptr || recvMutex_ == nullptr)
+    {
+        return false;
+    }
+    if (xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
+    {
+        return false;
+    }
+    if (xSemaphoreTake(recvMutex_, portMAX_DELAY) != pdTRUE)
+    {
+        xSemaphoreGive(mutex_);
+        return false;
+    }
+    return true;
+}
+
+void MbedtlsTransport::unlockAll()
+{
+    xSemaphoreGive(recvMutex_);
+    xSemaphoreGive(mutex_);
+}
+
 esp_err_t MbedtlsTransport::convertMbedtlsError(MbedtlsPkcs11Status_t status)
 {
     switch (status)
@@ -352,7 +1039,27 @@ esp_err_t MbedtlsTransport::connectWithRetries(const TlsConfig &config)
     credentials.pClientCertLabel = const_cast<char *>(config.clientCertLabel.c_str());
     credentials.pPrivateKeyLabel = const_cast<char *>(config.clientKeyLabel.c_str());
     credentials.p11Session = pkcs11Session_.get();
+
+    // Looked up once per process; the C wrapper searches the token itself on a miss
+    auto &provider = Pkcs11Provider::instance();
+    if (config.clientKeyLabel.empty() ||
+        provider.findObject(config.clientKeyLabel, CKO_PRIVATE_KEY, &credentials.privateKeyHandle) != ESP_OK)
+    {
+        credentials.privateKeyHandle = CK_INVALID_HANDLE;
+    }
     credentials.disableSni = !config.enableSni;
+    credentials.pRootCa = caChain_.get();
+    credentials.pClientCert = clientCert_.get();
+    credentials.maxFragmentLength = config.maxFragmentLength;
+    credentials.pCipherSuites = config.cipherSuites.empty() ? nullptr : config.cipherSuites.data();
+    credentials.cipherSuiteCount = config.cipherSuites.size();
+    credentials.pGroups = config.keyExchangeGroups.empty() ? nullptr : config.keyExchangeGroups.data();
+    credentials.groupCount = config.keyExchangeGroups.size();
+
+    // Offer the saved session first (prepareSession() checked it belongs to this server)
+    bool resuming = resumeSessions_ && !session_.empty();
+    credentials.pSession = resuming ? session_.data() : nullptr;
+    credentials.sessionLength = resuming ? session_.size() : 0;
 
     // Setup ALPN if needed (port 443)
     const char **alpnProtos = setupAlpnProtocols(config.port);
@@ -365,20 +1072,31 @@ esp_err_t MbedtlsTransport::connectWithRetries(const TlsConfig &config)
         timeoutMs = DEFAULT_SEND_RECV_TIMEOUT_MS;
     }
 
-    // Initialize backoff algorithm for retries
+    // Initialize backoff algorithm for retries: each delay is random up to a
+    // ceiling that doubles per attempt (full jitter); 0 attempts retries forever
     BackoffAlgorithmContext_t backoffContext;
-    uint32_t baseMs = static_cast<uint32_t>(config.retryBaseDelay.count());
-    uint32_t maxMs = static_cast<uint32_t>(config.retryMaxDelay.count());
-    uint32_t maxAttempts = config.maxRetries;
+    uint16_t baseMs = static_cast<uint16_t>(std::min<int64_t>(config.retryBaseDelay.count(), UINT16_MAX));
+    uint16_t maxMs = static_cast<uint16_t>(std::min<int64_t>(config.retryMaxDelay.count(), UINT16_MAX));
+    uint32_t maxAttempts = config.maxRetries > 0 ? config.maxRetries : BACKOFF_ALGORITHM_RETRY_FOREVER;
 
     BackoffAlgorithm_InitializeParams(&backoffContext, baseMs, maxMs, maxAttempts);
 
+#ifndef ESP_PLATFORM
     // Seed random number generator for backoff jitter
     struct timespec tp;
     clock_gettime(CLOCK_REALTIME, &tp);
     srand(tp.tv_nsec);
+#endif
+
+    // Spread reconnects of devices that lost the server at the same moment
+    if (config.jitterFirstAttempt && baseMs > 0 && !backoffWait(backoffRandom() % (baseMs + 1u)))
+    {
+        LOPCORE_LOGI(TAG, "Connection cancelled");
+        return ESP_ERR_INVALID_STATE;
+    }
 
     // Retry loop
+    statistics_.connectAttempts = 0;
     bool success = false;
     BackoffAlgorithmStatus_t backoffStatus = BackoffAlgorithmSuccess;
     uint16_t nextBackoffMs = 0;
@@ -386,6 +1104,7 @@ esp_err_t MbedtlsTransport::connectWithRetries(const TlsConfig &config)
     do
     {
         LOPCORE_LOGI(TAG, "Attempting TLS connection to %s:%u", config.hostname.c_str(), config.port);
+        statistics_.connectAttempts++;
 
         // Attempt connection
         MbedtlsPkcs11Status_t tlsStatus = Mbedtls_Pkcs11_Connect(networkContext_.get(),
@@ -394,15 +1113,39 @@ esp_err_t MbedtlsTransport::connectWithRetries(const TlsConfig &config)
 
         success = (tlsStatus == MBEDTLS_PKCS11_SUCCESS);
 
+        if (!success && tlsStatus == MBEDTLS_PKCS11_INVALID_CREDENTIALS &&
+            credentials.privateKeyHandle != CK_INVALID_HANDLE)
+        {
+            // The key may have been replaced without invalidating its cached handle
+            LOPCORE_LOGW(TAG, "Credentials rejected, retrying with a fresh private key lookup");
+            provider.invalidateObject(config.clientKeyLabel);
+            credentials.privateKeyHandle = CK_INVALID_HANDLE;
+            continue;
+        }
+
+        if (!success && tlsStatus == MBEDTLS_PKCS11_HANDSHAKE_FAILED && credentials.pSession != nullptr)
+        {
+            // Servers should fall back to a full handshake, but some abort instead
+            LOPCORE_LOGW(TAG, "Resumed handshake failed, retrying with a full handshake");
+            credentials.pSession = nullptr;
+            credentials.sessionLength = 0;
+            dropSession();
+            continue;
+        }
+
         if (!success)
         {
             // Get next backoff delay
-            backoffStatus = BackoffAlgorithm_GetNextBackoff(&backoffContext, rand(), &nextBackoffMs);
+            backoffStatus = BackoffAlgorithm_GetNextBackoff(&backoffContext, backoffRandom(), &nextBackoffMs);
 
             if (backoffStatus == BackoffAlgorithmSuccess)
             {
                 LOPCORE_LOGW(TAG, "Connection failed, retrying after %u ms backoff", nextBackoffMs);
-                Clock_SleepMs(nextBackoffMs);
+                if (!backoffWait(nextBackoffMs))
+                {
+                    LOPCORE_LOGI(TAG, "Connection cancelled");
+                    return ESP_ERR_INVALID_STATE;
+                }
             }
             else
             {
@@ -434,5 +1177,105 @@ const char **MbedtlsTransport::setupAlpnProtocols(uint16_t port)
     return nullptr;
 }
 
+void MbedtlsTransport::prepareSession(const TlsConfig &config)
+{
+    std::string peer = config.hostname + ":" + std::to_string(config.port);
+    if (peer != sessionPeer_)
+    {
+        session_.clear();
+        sessionPeer_ = peer;
+        sessionKey_ = sessionKeyFor(peer);
+    }
+
+    if (config.sessionNvsNamespace.empty())
+    {
+        sessionStorage_.reset();
+        return;
+    }
+
+    if (sessionStorage_ == nullptr)
+    {
+        storage::NvsConfig nvsConfig;
+        nvsConfig.setNamespace(config.sessionNvsNamespace);
+        sessionStorage_ = std::make_unique<NvsStorage>(nvsConfig);
+        if (!sessionStorage_->initialize())
+        {
+            LOPCORE_LOGW(TAG, "NVS unavailable, TLS session kept in RAM only");
+            sessionStorage_.reset();
+            return;
+        }
+    }
+
+    if (sessionCleared_)
+    {
+        // clearSession() was called before NVS was opened
+        sessionStorage_->remove(sessionKey_);
+        sessionCleared_ = false;
+        return;
+    }
+
+    if (!session_.empty())
+    {
+        return;
+    }
+
+    // Stored as "host:port", a NUL, then the serialized session
+    auto stored = sessionStorage_->readBinary(sessionKey_);
+    if (!stored.has_value())
+    {
+        return;
+    }
+    auto separator = std::find(stored->begin(), stored->end(), 0);
+    if (separator != stored->end() && std::string(stored->begin(), separator) == peer)
+    {
+        session_.assign(separator + 1, stored->end());
+        LOPCORE_LOGD(TAG, "Loaded TLS session for %s from NVS (%u bytes)", peer.c_str(),
+                     static_cast<unsigned>(session_.size()));
+    }
+}
+
+void MbedtlsTransport::saveSession()
+{
+    unsigned char *data = nullptr;
+    size_t length = 0;
+    if (Mbedtls_Pkcs11_SaveSession(networkContext_.get(), &data, &length) != MBEDTLS_PKCS11_SUCCESS)
+    {
+        return;
+    }
+    std::vector<uint8_t> session(data, data + length);
+    free(data);
+
+    // A session ID resumption keeps the same session; skip the NVS write
+    if (session == session_)
+    {
+        return;
+    }
+    session_ = std::move(session);
+
+    if (sessionStorage_ != nullptr)
+    {
+        std::vector<uint8_t> record(sessionPeer_.begin(), sessionPeer_.end());
+        record.push_back(0);
+        record.insert(record.end(), session_.begin(), session_.end());
+        if (!sessionStorage_->write(sessionKey_, record))
+        {
+            LOPCORE_LOGW(TAG, "Failed to persist TLS session");
+        }
+    }
+}
+
+void MbedtlsTransport::dropSession()
+{
+    session_.clear();
+    if (sessionStorage_ != nullptr)
+    {
+        sessionStorage_->remove(sessionKey_);
+    }
+    else
+    {
+        sessionCleared_ = true;
+    }
+}
+
 } // namespace tls
 } // namespace lopcore
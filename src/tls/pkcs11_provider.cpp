@@ -11,6 +11,8 @@
 
 #include "lopcore/tls/pkcs11_provider.hpp"
 
+#include <iterator>
+
 #include <core_pkcs11.h>
 #include <esp_log.h>
 
@@ -64,26 +66,12 @@ esp_err_t Pkcs11Provider::getSession(CK_SESSION_HANDLE *session)
         return ESP_FAIL;
     }
 
-    // Initialize if needed
-    if (!initialized_)
-    {
-        esp_err_t err = initializeInternal();
-        if (err != ESP_OK)
-        {
-            xSemaphoreGive(mutex_);
-            return err;
-        }
-    }
-
-    // Open session if needed
-    if (session_ == CK_INVALID_HANDLE)
+    // Initialize and open session if needed
+    esp_err_t err = ensureSession();
+    if (err != ESP_OK)
     {
-        esp_err_t err = openSession();
-        if (err != ESP_OK)
-        {
-            xSemaphoreGive(mutex_);
-            return err;
-        }
+        xSemaphoreGive(mutex_);
+        return err;
     }
 
     *session = session_;
@@ -125,6 +113,90 @@ esp_err_t Pkcs11Provider::getFunctionList(CK_FUNCTION_LIST **functionList)
     return ESP_OK;
 }
 
+esp_err_t Pkcs11Provider::findObject(const std::string &label,
+                                     CK_OBJECT_CLASS objectClass,
+                                     CK_OBJECT_HANDLE *handle)
+{
+    if (handle == nullptr)
+    {
+        ESP_LOGE(TAG, "Handle pointer is null");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Lock for thread safety
+    if (xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
+    {
+        ESP_LOGE(TAG, "Failed to acquire mutex");
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = ensureSession();
+    if (err != ESP_OK)
+    {
+        xSemaphoreGive(mutex_);
+        return err;
+    }
+
+    auto key = std::make_pair(objectClass, label);
+    auto it = objects_.find(key);
+    if (it != objects_.end())
+    {
+        *handle = it->second;
+        xSemaphoreGive(mutex_);
+        return ESP_OK;
+    }
+
+    CK_OBJECT_HANDLE found = CK_INVALID_HANDLE;
+    CK_RV rv = xFindObjectWithLabelAndClass(session_, const_cast<char *>(label.c_str()), label.size(),
+                                            objectClass, &found);
+    if (rv != CKR_OK)
+    {
+        xSemaphoreGive(mutex_);
+        ESP_LOGE(TAG, "Object search for '%s' failed: 0x%lx", label.c_str(), rv);
+        return convertPkcs11Error(rv);
+    }
+    if (found == CK_INVALID_HANDLE)
+    {
+        xSemaphoreGive(mutex_);
+        ESP_LOGW(TAG, "No object labelled '%s' (class 0x%lx)", label.c_str(), objectClass);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    objects_.emplace(std::move(key), found);
+    *handle = found;
+    xSemaphoreGive(mutex_);
+
+    ESP_LOGD(TAG, "Cached handle %lu for '%s'", found, label.c_str());
+    return ESP_OK;
+}
+
+void Pkcs11Provider::invalidateObject(const std::string &label)
+{
+    if (xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
+    {
+        ESP_LOGE(TAG, "Failed to acquire mutex");
+        return;
+    }
+
+    for (auto it = objects_.begin(); it != objects_.end();)
+    {
+        it = it->first.second == label ? objects_.erase(it) : std::next(it);
+    }
+    xSemaphoreGive(mutex_);
+}
+
+void Pkcs11Provider::invalidateObjects()
+{
+    if (xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE)
+    {
+        ESP_LOGE(TAG, "Failed to acquire mutex");
+        return;
+    }
+
+    objects_.clear();
+    xSemaphoreGive(mutex_);
+}
+
 esp_err_t Pkcs11Provider::initialize()
 {
     // Lock for thread safety
@@ -196,6 +268,27 @@ bool Pkcs11Provider::isInitialized() const
 
 // Private methods
 
+esp_err_t Pkcs11Provider::ensureSession()
+{
+    // Initialize if needed
+    if (!initialized_)
+    {
+        esp_err_t err = initializeInternal();
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+    }
+
+    // Open session if needed
+    if (session_ == CK_INVALID_HANDLE)
+    {
+        return openSession();
+    }
+
+    return ESP_OK;
+}
+
 esp_err_t Pkcs11Provider::initializeInternal()
 {
     ESP_LOGI(TAG, "Initializing PKCS#11...");
@@ -279,6 +372,7 @@ void Pkcs11Provider::closeSession()
     }
 
     session_ = CK_INVALID_HANDLE;
+    objects_.clear();
 }
 
 esp_err_t Pkcs11Provider::convertPkcs11Error(CK_RV rv)
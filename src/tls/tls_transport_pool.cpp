@@ -0,0 +1,253 @@
+/**
+ * @file tls_transport_pool.cpp
+ * @brief Pool of connected TLS transports shared between protocol clients
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include "lopcore/tls/tls_transport_pool.hpp"
+
+#include <iterator>
+
+#include <esp_timer.h>
+
+#include "lopcore/logging/logger.hpp"
+
+static const char *TAG = "TlsTransportPool";
+
+namespace lopcore
+{
+namespace tls
+{
+
+TlsTransportPool::TlsTransportPool(TransportFactory factory, const TlsPoolConfig &config)
+    : factory_(std::move(factory)), shared_(std::make_shared<Shared>())
+{
+    shared_->config = config;
+}
+
+TlsTransportPool::~TlsTransportPool()
+{
+    clear();
+}
+
+esp_err_t TlsTransportPool::acquire(const TlsConfig &config, std::shared_ptr<ITlsTransport> &transport)
+{
+    transport.reset();
+    reclaimIdle();
+
+    std::string key = keyFor(config);
+
+    // Newest matching parked connection first; dead ones are dropped
+    for (;;)
+    {
+        std::unique_ptr<ITlsTransport> candidate;
+        {
+            std::lock_guard<std::mutex> lock(shared_->mutex);
+            auto &parked = shared_->parked;
+            for (auto it = parked.rbegin(); it != parked.rend(); ++it)
+            {
+                if (it->key == key)
+                {
+                    candidate = std::move(it->transport);
+                    parked.erase(std::next(it).base());
+                    shared_->stats.parked--;
+                    break;
+                }
+            }
+        }
+
+        if (!candidate)
+        {
+            break;
+        }
+
+        if (isReusable(*candidate))
+        {
+            {
+                std::lock_guard<std::mutex> lock(shared_->mutex);
+                shared_->stats.reused++;
+            }
+            LOPCORE_LOGD(TAG, "Reusing connection to %s:%u", config.hostname.c_str(), config.port);
+            transport = lend(std::move(key), std::move(candidate));
+            return ESP_OK;
+        }
+
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        shared_->stats.live--;
+    }
+
+    // Reserve a slot, closing the least recently parked connection if the pool is full
+    std::unique_ptr<ITlsTransport> victim;
+    {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        if (shared_->stats.live >= shared_->config.maxTransports)
+        {
+            if (shared_->parked.empty())
+            {
+                LOPCORE_LOGW(TAG, "All %u connections in use", static_cast<unsigned>(shared_->stats.live));
+                return ESP_ERR_NO_MEM;
+            }
+            victim = std::move(shared_->parked.front().transport);
+            shared_->parked.erase(shared_->parked.begin());
+            shared_->stats.parked--;
+            shared_->stats.live--;
+            shared_->stats.evicted++;
+        }
+        shared_->stats.live++;
+    }
+
+    // Free the victim's buffers before the new handshake allocates its own
+    victim.reset();
+
+    std::unique_ptr<ITlsTransport> fresh = factory_ ? factory_() : nullptr;
+    esp_err_t err = fresh ? fresh->connect(config) : ESP_ERR_NO_MEM;
+    if (err != ESP_OK)
+    {
+        fresh.reset();
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        shared_->stats.live--;
+        return err;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        shared_->stats.opened++;
+    }
+    transport = lend(std::move(key), std::move(fresh));
+    return ESP_OK;
+}
+
+size_t TlsTransportPool::reclaimIdle()
+{
+    std::vector<std::unique_ptr<ITlsTransport>> closing;
+    {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        int64_t nowUs = esp_timer_get_time();
+        int64_t limitUs = static_cast<int64_t>(shared_->config.idleTimeout.count()) * 1000;
+
+        auto &parked = shared_->parked;
+        for (auto it = parked.begin(); it != parked.end();)
+        {
+            if (nowUs - it->parkedAtUs >= limitUs)
+            {
+                closing.push_back(std::move(it->transport));
+                it = parked.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        shared_->stats.parked -= closing.size();
+        shared_->stats.live -= closing.size();
+        shared_->stats.evicted += static_cast<uint32_t>(closing.size());
+    }
+
+    // Disconnected as they go out of scope, without the lock held
+    return closing.size();
+}
+
+void TlsTransportPool::clear()
+{
+    std::vector<Parked> closing;
+    {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        closing.swap(shared_->parked);
+        shared_->stats.parked = 0;
+        shared_->stats.live -= closing.size();
+    }
+}
+
+TlsPoolStats TlsTransportPool::getStats() const
+{
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    return shared_->stats;
+}
+
+std::string TlsTransportPool::keyFor(const TlsConfig &config)
+{
+    auto appendIds = [](std::string &key, const std::vector<uint16_t> &ids) {
+        for (size_t i = 0; i < ids.size(); i++)
+        {
+            key += i > 0 ? "," : "";
+            key += std::to_string(ids[i]);
+        }
+        key += '|';
+    };
+
+    std::string key = config.hostname;
+    key += ':';
+    key += std::to_string(config.port);
+    key += '|';
+    for (size_t i = 0; i < config.alpnProtocols.size(); i++)
+    {
+        key += i > 0 ? "," : "";
+        key += config.alpnProtocols[i];
+    }
+    key += '|';
+
+    // How the server was authenticated, so a laxer connection never serves a stricter caller
+    key += config.verifyPeer ? 'V' : '-';
+    key += config.skipCommonNameCheck ? '-' : 'N';
+    key += config.enableSni ? 'S' : '-';
+    key += '|';
+    key += config.caCertPath;
+    key += '|';
+
+    // What the client presented and negotiated
+    key += config.clientCertLabel;
+    key += '|';
+    key += config.clientKeyLabel;
+    key += '|';
+    appendIds(key, config.cipherSuites);
+    appendIds(key, config.keyExchangeGroups);
+    key += std::to_string(config.maxFragmentLength);
+    return key;
+}
+
+bool TlsTransportPool::isReusable(ITlsTransport &transport)
+{
+    if (!transport.isConnected())
+    {
+        return false;
+    }
+
+    // Data on an idle connection is a close_notify or a protocol leftover
+    esp_err_t err = transport.waitForData(0);
+    return err == ESP_ERR_TIMEOUT || err == ESP_ERR_NOT_SUPPORTED;
+}
+
+void TlsTransportPool::release(const std::weak_ptr<Shared> &weak, std::string key, ITlsTransport *transport)
+{
+    std::unique_ptr<ITlsTransport> owned(transport);
+    std::shared_ptr<Shared> shared = weak.lock();
+    if (!shared)
+    {
+        return; // Pool gone: just close it
+    }
+
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    if (owned->isConnected())
+    {
+        shared->parked.push_back(Parked{std::move(key), std::move(owned), esp_timer_get_time()});
+        shared->stats.parked++;
+    }
+    else
+    {
+        shared->stats.live--;
+    }
+}
+
+std::shared_ptr<ITlsTransport> TlsTransportPool::lend(std::string key,
+                                                      std::unique_ptr<ITlsTransport> transport)
+{
+    std::weak_ptr<Shared> weak = shared_;
+    auto deleter = [weak, key = std::move(key)](ITlsTransport *lent) { release(weak, key, lent); };
+    return std::shared_ptr<ITlsTransport>(transport.release(), std::move(deleter));
+}
+
+} // namespace tls
+} // namespace lopcore
@@ -0,0 +1,224 @@
+/**
+ * @file bench_logger.cpp
+ * @brief Host benchmark for the Logger hot path
+ *
+ * Measures nanoseconds per log call for the sync, async and deferred
+ * modes across the filtered-out, console and file paths and several
+ * message sizes. Numbers are only comparable on the same machine; run
+ * before and after a change rather than against a fixed threshold.
+ *
+ * Usage: bench_logger [--iterations N] [--quick]
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "lopcore/logging/console_sink.hpp"
+#include "lopcore/logging/file_sink.hpp"
+#include "lopcore/logging/logger.hpp"
+
+using namespace lopcore;
+
+namespace
+{
+
+enum class Mode
+{
+    SYNC,
+    ASYNC,
+    DEFERRED
+};
+
+enum class Path
+{
+    FILTERED,
+    CONSOLE,
+    FILE_SINK
+};
+
+const char *modeName(Mode mode)
+{
+    switch (mode)
+    {
+        case Mode::SYNC:
+            return "sync";
+        case Mode::ASYNC:
+            return "async";
+        case Mode::DEFERRED:
+            return "deferred";
+    }
+    return "?";
+}
+
+const char *pathName(Path path)
+{
+    switch (path)
+    {
+        case Path::FILTERED:
+            return "filtered";
+        case Path::CONSOLE:
+            return "console";
+        case Path::FILE_SINK:
+            return "file";
+    }
+    return "?";
+}
+
+/**
+ * @brief Points stdout at /dev/null while console records are written
+ */
+class StdoutSilencer
+{
+public:
+    StdoutSilencer()
+    {
+        fflush(stdout);
+        saved_ = dup(STDOUT_FILENO);
+        int devNull = open("/dev/null", O_WRONLY);
+        if (devNull >= 0)
+        {
+            dup2(devNull, STDOUT_FILENO);
+            close(devNull);
+        }
+    }
+
+    ~StdoutSilencer()
+    {
+        fflush(stdout);
+        if (saved_ >= 0)
+        {
+            dup2(saved_, STDOUT_FILENO);
+            close(saved_);
+        }
+    }
+
+private:
+    int saved_;
+};
+
+struct Result
+{
+    double callNs;    ///< Caller-side cost per log call
+    double totalNs;   ///< Per record including drain and flush
+    uint32_t dropped; ///< Records lost to ring overflow
+};
+
+Result run(Mode mode, Path path, size_t messageSize, size_t iterations)
+{
+    auto &logger = Logger::getInstance();
+    logger.disableAsync();
+    logger.clearSinks();
+    logger.clearTagLevels();
+    logger.setGlobalLevel(path == Path::FILTERED ? LogLevel::WARN : LogLevel::INFO);
+
+    if (path == Path::CONSOLE)
+    {
+        auto console = std::make_unique<ConsoleSink>();
+        console->setColorEnabled(false);
+        logger.addSink(std::move(console));
+    }
+    else if (path == Path::FILE_SINK)
+    {
+        FileSinkConfig config;
+        config.base_path = "/tmp";
+        config.filename = "lopcore_bench.log";
+        config.max_file_size = 4 * 1024 * 1024;
+        config.buffer_size = 4096;
+        logger.addSink(std::make_unique<FileSink>(config));
+    }
+
+    if (mode != Mode::SYNC)
+    {
+        logger.enableAsync(AsyncLogConfig()
+                               .setQueueDepth(1024)
+                               .setOverflowPolicy(LogOverflowPolicy::BLOCK)
+                               .setDeferredFormatting(mode == Mode::DEFERRED));
+    }
+    logger.resetStats();
+
+    std::string payload(messageSize, 'x');
+    const char *text = payload.c_str();
+
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        logger.info("Bench", "%s %u", text, static_cast<unsigned>(i));
+    }
+    auto called = Clock::now();
+    logger.flush();
+    auto done = Clock::now();
+
+    Result result;
+    result.callNs = std::chrono::duration<double, std::nano>(called - start).count() / iterations;
+    result.totalNs = std::chrono::duration<double, std::nano>(done - start).count() / iterations;
+    result.dropped = logger.getStats().recordsDropped;
+
+    logger.disableAsync();
+    logger.clearSinks();
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t iterations = 100000;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+        {
+            iterations = 1000;
+        }
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--iterations N] [--quick]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (iterations == 0)
+    {
+        iterations = 1;
+    }
+
+    const Mode modes[] = {Mode::SYNC, Mode::ASYNC, Mode::DEFERRED};
+    const Path paths[] = {Path::FILTERED, Path::CONSOLE, Path::FILE_SINK};
+    const size_t sizes[] = {16, 64, 200};
+
+    printf("%-9s %-9s %6s %12s %12s %8s\n", "mode", "path", "bytes", "ns/call", "ns/record", "dropped");
+    for (Mode mode : modes)
+    {
+        for (Path path : paths)
+        {
+            for (size_t size : sizes)
+            {
+                Result result;
+                if (path == Path::CONSOLE)
+                {
+                    StdoutSilencer silence;
+                    result = run(mode, path, size, iterations);
+                }
+                else
+                {
+                    result = run(mode, path, size, iterations);
+                }
+                printf("%-9s %-9s %6zu %12.1f %12.1f %8u\n", modeName(mode), pathName(path), size,
+                       result.callNs, result.totalNs, static_cast<unsigned>(result.dropped));
+            }
+        }
+    }
+
+    remove("/tmp/lopcore_bench.log");
+    return 0;
+}
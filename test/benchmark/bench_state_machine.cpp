@@ -0,0 +1,279 @@
+/**
+ * @file bench_state_machine.cpp
+ * @brief Host benchmark for the state machine variants
+ *
+ * Measures nanoseconds per transition() and per update() for the
+ * map-based StateMachine, the table-based DenseStateMachine and the
+ * event-queue EventStateMachine (post() and dispatch() per event) with 4,
+ * 16 and 64 states. Every variant replays the same pseudo-random walk of
+ * 1 to 3 states forward, so each transition is real and the branch
+ * predictor cannot learn it; handlers only count calls. The fuzz suite
+ * test_state_machine_fuzz checks the variants behave the same.
+ *
+ * Numbers are only comparable on the same machine; run before and after
+ * a change rather than against a fixed threshold.
+ *
+ * Usage: bench_state_machine [--iterations N] [--quick]
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "lopcore/state_machine/dense_state_machine.hpp"
+#include "lopcore/state_machine/event_state_machine.hpp"
+#include "lopcore/state_machine/state_machine.hpp"
+
+using namespace lopcore;
+
+namespace
+{
+
+enum class BenchState : uint8_t
+{
+    // 0 to N - 1, by cast
+};
+
+enum class Step : uint8_t
+{
+    ONE,
+    TWO,
+    THREE
+};
+
+constexpr size_t STEP_COUNT = 3;
+constexpr size_t WALK_LENGTH = 4096;
+constexpr size_t BATCH = 64; ///< Events posted before each dispatch()
+
+uint64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+class CountingState : public IState<BenchState>
+{
+public:
+    explicit CountingState(BenchState id) : id_(id)
+    {
+    }
+
+    void onEnter() override
+    {
+        calls_++;
+    }
+
+    void update() override
+    {
+        calls_++;
+    }
+
+    void onExit() override
+    {
+        calls_++;
+    }
+
+    BenchState getStateId() const override
+    {
+        return id_;
+    }
+
+    uint64_t calls() const
+    {
+        return calls_;
+    }
+
+private:
+    BenchState id_;
+    uint64_t calls_ = 0;
+};
+
+/**
+ * @brief The steps of the walk, the same for every variant
+ */
+std::vector<Step> makeWalk()
+{
+    std::vector<Step> walk(WALK_LENGTH);
+    uint32_t x = 0x9E3779B9u;
+    for (Step &step : walk)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        step = static_cast<Step>(x % STEP_COUNT);
+    }
+    return walk;
+}
+
+struct Result
+{
+    double transitionNs;
+    double updateNs;
+    uint64_t checksum; ///< Handler calls, so the work is not optimized away
+};
+
+template<size_t N>
+BenchState stepFrom(BenchState state, Step step)
+{
+    return static_cast<BenchState>((static_cast<size_t>(state) + static_cast<size_t>(step) + 1) % N);
+}
+
+template<size_t N>
+Result benchMap(const std::vector<Step> &walk, size_t iterations)
+{
+    StateMachine<BenchState> machine(BenchState{});
+    std::vector<CountingState *> handlers;
+    for (size_t i = 0; i < N; i++)
+    {
+        auto handler = std::make_unique<CountingState>(static_cast<BenchState>(i));
+        handlers.push_back(handler.get());
+        machine.registerState(static_cast<BenchState>(i), std::move(handler));
+    }
+
+    uint64_t start = nowNs();
+    for (size_t i = 0; i < iterations; i++)
+    {
+        machine.transition(stepFrom<N>(machine.getCurrentState(), walk[i % WALK_LENGTH]));
+    }
+    uint64_t transitionsDone = nowNs();
+    for (size_t i = 0; i < iterations; i++)
+    {
+        machine.update();
+    }
+    uint64_t updatesDone = nowNs();
+
+    uint64_t checksum = 0;
+    for (CountingState *handler : handlers)
+    {
+        checksum += handler->calls();
+    }
+    return Result{static_cast<double>(transitionsDone - start) / iterations,
+                  static_cast<double>(updatesDone - transitionsDone) / iterations, checksum};
+}
+
+template<size_t N>
+Result benchDense(const std::vector<Step> &walk, size_t iterations)
+{
+    DenseStateMachine<BenchState, N> machine(BenchState{});
+    std::vector<std::unique_ptr<CountingState>> handlers;
+    for (size_t i = 0; i < N; i++)
+    {
+        handlers.push_back(std::make_unique<CountingState>(static_cast<BenchState>(i)));
+        machine.registerState(static_cast<BenchState>(i), *handlers.back());
+    }
+
+    uint64_t start = nowNs();
+    for (size_t i = 0; i < iterations; i++)
+    {
+        machine.transition(stepFrom<N>(machine.getCurrentState(), walk[i % WALK_LENGTH]));
+    }
+    uint64_t transitionsDone = nowNs();
+    for (size_t i = 0; i < iterations; i++)
+    {
+        machine.update();
+    }
+    uint64_t updatesDone = nowNs();
+
+    uint64_t checksum = 0;
+    for (const auto &handler : handlers)
+    {
+        checksum += handler->calls();
+    }
+    return Result{static_cast<double>(transitionsDone - start) / iterations,
+                  static_cast<double>(updatesDone - transitionsDone) / iterations, checksum};
+}
+
+template<size_t N>
+Result benchEvents(const std::vector<Step> &walk, size_t iterations)
+{
+    EventStateMachine<BenchState, N, Step, STEP_COUNT, uint32_t, N * STEP_COUNT> machine(BenchState{}, BATCH);
+    std::vector<std::unique_ptr<CountingState>> handlers;
+    for (size_t i = 0; i < N; i++)
+    {
+        BenchState state = static_cast<BenchState>(i);
+        handlers.push_back(std::make_unique<CountingState>(state));
+        machine.machine().registerState(state, *handlers.back());
+        for (size_t step = 0; step < STEP_COUNT; step++)
+        {
+            machine.on(state, static_cast<Step>(step), stepFrom<N>(state, static_cast<Step>(step)));
+        }
+    }
+
+    uint64_t start = nowNs();
+    for (size_t i = 0; i < iterations; i += BATCH)
+    {
+        for (size_t j = i; j < i + BATCH && j < iterations; j++)
+        {
+            machine.post(walk[j % WALK_LENGTH]);
+        }
+        machine.dispatch();
+    }
+    uint64_t transitionsDone = nowNs();
+    for (size_t i = 0; i < iterations; i++)
+    {
+        machine.machine().update();
+    }
+    uint64_t updatesDone = nowNs();
+
+    uint64_t checksum = 0;
+    for (const auto &handler : handlers)
+    {
+        checksum += handler->calls();
+    }
+    return Result{static_cast<double>(transitionsDone - start) / iterations,
+                  static_cast<double>(updatesDone - transitionsDone) / iterations, checksum};
+}
+
+void printResult(const char *variant, size_t states, const Result &result)
+{
+    printf("%-8s %6zu %14.1f %10.1f %12llu\n", variant, states, result.transitionNs, result.updateNs,
+           static_cast<unsigned long long>(result.checksum));
+}
+
+template<size_t N>
+void benchStates(const std::vector<Step> &walk, size_t iterations)
+{
+    printResult("map", N, benchMap<N>(walk, iterations));
+    printResult("dense", N, benchDense<N>(walk, iterations));
+    printResult("event", N, benchEvents<N>(walk, iterations));
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t iterations = 1000000;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+        {
+            iterations = 10000;
+        }
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--iterations N] [--quick]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (iterations == 0)
+    {
+        fprintf(stderr, "iterations must be positive\n");
+        return 1;
+    }
+
+    std::vector<Step> walk = makeWalk();
+    printf("%-8s %6s %14s %10s %12s\n", "variant", "states", "ns/transition", "ns/update", "calls");
+    benchStates<4>(walk, iterations);
+    benchStates<16>(walk, iterations);
+    benchStates<64>(walk, iterations);
+    return 0;
+}
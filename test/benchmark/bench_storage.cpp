@@ -0,0 +1,165 @@
+/**
+ * @file bench_storage.cpp
+ * @brief Host benchmark for the storage backends
+ *
+ * Runs the sweep of storage_bench.hpp against the host builds of
+ * NvsStorage (the in-memory NVS mock) and SpiffsStorage (a directory in
+ * /tmp). LittleFS and the SD card have no host build; run
+ * examples/09_storage_benchmark on a device for those and for real flash
+ * timings. Host numbers show the cost of the library code around the
+ * medium, not the medium itself.
+ *
+ * "written" is the write(2) byte count of the process from
+ * /proc/self/io, so it is reported for SPIFFS only: it includes the
+ * index and metadata the backend writes besides the values, not what the
+ * disk below does with them.
+ *
+ * Usage: bench_storage [--quick] [--max-case-mb N]
+ */
+
+#include <malloc.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "lopcore/storage/nvs_storage.hpp"
+#include "lopcore/storage/spiffs_storage.hpp"
+#include "storage_bench.hpp"
+
+using namespace lopcore;
+
+namespace
+{
+
+const char *BASE_PATH = "/tmp/lopcore_bench_storage";
+
+uint64_t nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+size_t heapUsed()
+{
+    return mallinfo2().uordblks;
+}
+
+/**
+ * @brief Bytes this process has passed to write(2)
+ */
+uint64_t processBytesWritten()
+{
+    std::ifstream io("/proc/self/io");
+    std::string field;
+    uint64_t value;
+    while (io >> field >> value)
+    {
+        if (field == "wchar:")
+        {
+            return value;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Discards std::cout, where the host backends log every call
+ *
+ * The results are printed with printf and are not affected.
+ */
+class CoutSilencer
+{
+public:
+    CoutSilencer() : saved_(std::cout.rdbuf(nullptr))
+    {
+    }
+
+    ~CoutSilencer()
+    {
+        std::cout.rdbuf(saved_);
+        std::cout.clear();
+    }
+
+private:
+    std::streambuf *saved_;
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    bool quick = false;
+    size_t maxCaseBytes = 16 * 1024 * 1024;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+        {
+            quick = true;
+        }
+        else if (strcmp(argv[i], "--max-case-mb") == 0 && i + 1 < argc)
+        {
+            maxCaseBytes = static_cast<size_t>(strtoul(argv[++i], nullptr, 10)) * 1024 * 1024;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--quick] [--max-case-mb N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    bench::Sweep sweep;
+    if (quick)
+    {
+        sweep.valueSizes = {16, 4096, 64 * 1024};
+        sweep.fileCounts = {10};
+        sweep.listRepeats = 2;
+    }
+    else
+    {
+        sweep.valueSizes = {16, 256, 4096, 64 * 1024, 1024 * 1024};
+        sweep.fileCounts = {10, 100};
+    }
+    sweep.maxCaseBytes = maxCaseBytes;
+
+    bench::Platform memory{nowUs, heapUsed, {}};
+    bench::Platform disk{nowUs, heapUsed, processBytesWritten};
+
+    bench::Sweep nvsSweep = sweep;
+    nvsSweep.maxValueSize = 4096; // Blobs span NVS pages, but a small partition holds few larger ones
+
+    system((std::string("rm -rf ") + BASE_PATH).c_str());
+    mkdir(BASE_PATH, 0755);
+
+    size_t failures = 0;
+    bench::printHeader();
+    {
+        CoutSilencer silence;
+        NvsStorage nvs(storage::NvsConfig().setNamespace("bench"));
+        SpiffsStorage spiffs(storage::SpiffsConfig().setBasePath(BASE_PATH));
+        if (!nvs.initialize() || !spiffs.initialize())
+        {
+            fprintf(stderr, "cannot initialize the backends\n");
+            return 1;
+        }
+
+        failures += bench::runSweep("nvs", nvs, nvsSweep, memory);
+        failures += bench::runSweep("spiffs", spiffs, sweep, disk);
+    }
+    bench::printLegend();
+
+    system((std::string("rm -rf ") + BASE_PATH).c_str());
+
+    if (failures > 0)
+    {
+        fprintf(stderr, "%zu operations failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,763 @@
+/**
+ * @file sim_fleet.cpp
+ * @brief Host load and soak simulation of a device fleet
+ *
+ * Runs N simulated devices against one broker over a link with latency,
+ * loss, connection drops and broker restarts (sim_network.hpp). Each
+ * device runs the stack a unit does: a CommandRouter on a CoreMqttClient
+ * with an MqttSpool over a TLS transport, NvsStorage (host fallback) for
+ * its counters, and the Logger. The coreMQTT and esp_timer mocks put the
+ * client on the simulated broker and the virtual clock, and each device
+ * does the work of the process loop task itself. Devices publish QoS 1
+ * telemetry; the cloud side sends commands.
+ *
+ * At every report interval it prints throughput, backlog, live heap and
+ * heap allocations per delivered message, and at the end the heap growth
+ * since the first report. The heap counters include the simulator's own
+ * event queue, so compare runs with the same options (before and after a
+ * change) rather than against absolute numbers.
+ *
+ * Usage: sim_fleet [--devices N] [--duration S] [--interval MS] [--latency MS] [--jitter MS]
+ *                  [--loss PCT] [--drop-every S] [--outage-every S] [--outage-for S]
+ *                  [--commands PER_S] [--report S] [--seed N] [--spool-dir PATH]
+ *                  [--max-growth-kb N] [--quick]
+ *
+ * Exits with 2 if --max-growth-kb is set and the live heap grew by more.
+ */
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "esp_timer.h"
+#include "lopcore/commands/command_router.hpp"
+#include "lopcore/logging/logger.hpp"
+#include "lopcore/mqtt/coremqtt_client.hpp"
+#include "lopcore/storage/nvs_storage.hpp"
+#include "sim_network.hpp"
+
+using namespace lopcore;
+
+// =============================================================================
+// Heap accounting: every operator new in the process
+// =============================================================================
+
+namespace
+{
+
+constexpr size_t HEADER = alignof(std::max_align_t); ///< Block prefix holding the size
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<int64_t> g_liveBytes{0};
+std::atomic<int64_t> g_peakBytes{0};
+
+} // namespace
+
+void *operator new(size_t size)
+{
+    void *block = malloc(size + HEADER);
+    if (block == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    *static_cast<size_t *>(block) = size;
+
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    int64_t live = g_liveBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) +
+                   static_cast<int64_t>(size);
+    int64_t peak = g_peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !g_peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    {
+    }
+    return static_cast<char *>(block) + HEADER;
+}
+
+void operator delete(void *p) noexcept
+{
+    if (p == nullptr)
+    {
+        return;
+    }
+    char *block = static_cast<char *>(p) - HEADER;
+    g_liveBytes.fetch_sub(static_cast<int64_t>(*reinterpret_cast<size_t *>(block)), std::memory_order_relaxed);
+    free(block);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+namespace
+{
+
+static const char *TAG = "SimFleet";
+
+constexpr uint32_t PERSIST_EVERY = 16; ///< Telemetry records between NVS writes of the sequence number
+
+struct Options
+{
+    uint32_t devices{1000};
+    uint32_t durationS{600};
+    uint32_t intervalMs{10000};
+    uint32_t reportS{60};
+    double commandsPerS{10.0};
+    uint32_t seed{1};
+    uint32_t maxGrowthKb{0};
+    std::string spoolDir{"/tmp/lopcore_sim"};
+    sim::LinkProfile link;
+};
+
+/**
+ * @brief Counts records per level instead of printing them
+ */
+class CountingSink : public ILogSink
+{
+public:
+    void write(const LogMessage &msg) override
+    {
+        counts[static_cast<size_t>(msg.level)]++;
+    }
+
+    void flush() override
+    {
+    }
+
+    const char *getName() const override
+    {
+        return "counting";
+    }
+
+    uint64_t counts[6] = {};
+};
+
+/**
+ * @brief Discards what is written to it
+ */
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override
+    {
+        return traits_type::not_eof(c);
+    }
+};
+
+/**
+ * @brief IMqttClient over a CoreMqttClient, for the CommandRouter
+ */
+class CoreClientAdapter : public mqtt::IMqttClient
+{
+public:
+    explicit CoreClientAdapter(std::shared_ptr<mqtt::CoreMqttClient> client) : client_(std::move(client))
+    {
+    }
+
+    esp_err_t connect() override
+    {
+        return client_->connect();
+    }
+
+    esp_err_t disconnect() override
+    {
+        return client_->disconnect();
+    }
+
+    bool isConnected() const override
+    {
+        return client_->isConnected();
+    }
+
+    mqtt::MqttConnectionState getConnectionState() const override
+    {
+        return client_->getConnectionState();
+    }
+
+    esp_err_t publish(const std::string &topic,
+                      const std::vector<uint8_t> &payload,
+                      mqtt::MqttQos qos,
+                      bool retain) override
+    {
+        return client_->publish(topic, payload, qos, retain);
+    }
+
+    esp_err_t publishString(const std::string &topic,
+                            const std::string &payload,
+                            mqtt::MqttQos qos,
+                            bool retain) override
+    {
+        return client_->publishString(topic, payload, qos, retain);
+    }
+
+    esp_err_t subscribe(const std::string &topic, MessageCallback callback, mqtt::MqttQos qos) override
+    {
+        return client_->subscribe(topic, std::move(callback), qos);
+    }
+
+    esp_err_t subscribeView(const std::string &topic, mqtt::MessageViewCallback callback, mqtt::MqttQos qos) override
+    {
+        return client_->subscribeView(topic, std::move(callback), qos);
+    }
+
+    esp_err_t unsubscribe(const std::string &topic) override
+    {
+        return client_->unsubscribe(topic);
+    }
+
+    void setConnectionCallback(ConnectionCallback callback) override
+    {
+        client_->setConnectionCallback(std::move(callback));
+    }
+
+    void setErrorCallback(ErrorCallback callback) override
+    {
+        client_->setErrorCallback(std::move(callback));
+    }
+
+    esp_err_t setWillMessage(const std::string &topic,
+                             const std::vector<uint8_t> &payload,
+                             mqtt::MqttQos qos,
+                             bool retain) override
+    {
+        return client_->setWillMessage(topic, payload, qos, retain);
+    }
+
+    mqtt::MqttStatistics getStatistics() const override
+    {
+        return client_->getStatistics();
+    }
+
+    void resetStatistics() override
+    {
+        client_->resetStatistics();
+    }
+
+    std::string getClientId() const override
+    {
+        return client_->getClientId();
+    }
+
+    std::string getBroker() const override
+    {
+        return client_->getBroker();
+    }
+
+    uint16_t getPort() const override
+    {
+        return client_->getPort();
+    }
+
+private:
+    const std::shared_ptr<mqtt::CoreMqttClient> client_;
+};
+
+/**
+ * @brief One simulated unit
+ */
+class Device
+{
+public:
+    Device(uint32_t id, sim::SimNetwork &network, sim::SimBroker &broker, const Options &options)
+        : id_(id), network_(network), broker_(broker), telemetryTopic_("sim/" + std::to_string(id) + "/telemetry"),
+          ackTopic_("sim/" + std::to_string(id) + "/ack"), tlsConfig_(tlsConfig(options)),
+          transport_(std::make_shared<sim::SimTransport>(network, broker)),
+          mqtt_(connectedClient(transport_, tlsConfig_, clientConfig(options, id))),
+          client_(std::make_shared<CoreClientAdapter>(mqtt_)), router_(client_, routerConfig(id)), nvs_(nvsConfig(id)),
+          session_(broker.attach("sim-" + std::to_string(id), [this] { wake(); })),
+          intervalUs_(static_cast<int64_t>(options.intervalMs) * 1000), loopUs_(options.link.loopUs)
+    {
+    }
+
+    void start()
+    {
+        nvs_.initialize();
+        sequence_ = nvs_.get<uint32_t>("seq").value_or(0);
+
+        router_.on("ping", [this](const commands::Command &command) {
+            // The client holds its lock while callbacks run; reply after the loop, as a dispatch worker would
+            long long n = static_cast<long long>(command.args.getInt("n").value_or(0));
+            network_.after(0, [this, n] {
+                char ack[48];
+                int length = snprintf(ack, sizeof(ack), "{\"n\":%lld}", n);
+                client_->publishString(ackTopic_, std::string(ack, length), mqtt::MqttQos::AT_MOST_ONCE, false);
+            });
+            return ESP_OK;
+        });
+        router_.on("interval", [this](const commands::Command &command) {
+            std::optional<int64_t> ms = command.args.getInt("ms");
+            if (!ms || *ms < 100 || *ms > 3600000)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+            intervalUs_ = *ms * 1000;
+            return nvs_.set<uint32_t>("interval", static_cast<uint32_t>(*ms)) ? ESP_OK : ESP_FAIL;
+        });
+
+        // Called from processLoop() with the client's lock held
+        mqtt_->setConnectionCallback([this](bool connected) {
+            if (!connected)
+            {
+                network_.after(0, [this] { reconnect(); });
+            }
+        });
+        reconnect();
+
+        network_.after(network_.uniform(intervalUs_), [this] { tick(); });
+    }
+
+    bool isConnected() const
+    {
+        return mqtt_->isConnected();
+    }
+
+    /// Telemetry accepted while offline (spooled)
+    uint64_t offlinePublishes() const
+    {
+        return offlinePublishes_;
+    }
+
+    size_t spoolPending() const
+    {
+        return mqtt_->getSpoolPending();
+    }
+
+private:
+    static tls::TlsConfig tlsConfig(const Options &options)
+    {
+        // What CoreMqttClient asks of the transport when it reconnects by itself
+        tls::TlsConfig config;
+        config.hostname = "sim";
+        config.maxRetries = 0;
+        config.retryBaseDelay = std::chrono::milliseconds(options.link.reconnectBaseUs / 1000);
+        config.retryMaxDelay = std::chrono::milliseconds(options.link.reconnectMaxUs / 1000);
+        config.jitterFirstAttempt = true;
+        return config;
+    }
+
+    static mqtt::MqttConfig clientConfig(const Options &options, uint32_t id)
+    {
+        mqtt::MqttConfig config;
+        config.broker = "sim";
+        config.clientId = "sim-" + std::to_string(id);
+        config.cleanSession = false;         // Unacknowledged publishes are resent with DUP after a reconnect
+        config.autoStartProcessLoop = false; // poll() does the task's work on the virtual clock
+        config.budget.enabled = false;       // --interval sets the publish rate
+        config.networkBufferSize = 1024;
+        config.retransmitSlotSize = 256;
+        config.spool = spoolConfig(options, id);
+        return config;
+    }
+
+    /**
+     * @brief Build the client on a connected transport, then drop the connection
+     *
+     * CoreMqttClient takes its network context from a connected transport;
+     * the first connection then goes through connectAsync() like the others.
+     */
+    static std::shared_ptr<mqtt::CoreMqttClient> connectedClient(const std::shared_ptr<sim::SimTransport> &transport,
+                                                                 const tls::TlsConfig &tlsConfig,
+                                                                 const mqtt::MqttConfig &config)
+    {
+        transport->connect(tlsConfig);
+        auto client = std::make_shared<mqtt::CoreMqttClient>(config, transport);
+        transport->disconnect();
+        return client;
+    }
+
+    static mqtt::SpoolConfig spoolConfig(const Options &options, uint32_t id)
+    {
+        mqtt::SpoolConfig config;
+        config.enabled = true;
+        config.directory = options.spoolDir + "/" + std::to_string(id);
+        config.segmentSize = 4096;
+        config.maxSegments = 4;
+        return config;
+    }
+
+    static commands::CommandRouterConfig routerConfig(uint32_t id)
+    {
+        commands::CommandRouterConfig config;
+        config.topicPrefix = "sim/" + std::to_string(id) + "/cmd";
+        config.dispatch.workers = 0; // One thread drives the whole simulation
+        return config;
+    }
+
+    static storage::NvsConfig nvsConfig(uint32_t id)
+    {
+        storage::NvsConfig config;
+        config.namespaceName = "sim" + std::to_string(id);
+        return config;
+    }
+
+    void reconnect()
+    {
+        transport_->connectAsync(tlsConfig_, [this](esp_err_t result) { onTransport(result); });
+    }
+
+    void onTransport(esp_err_t result)
+    {
+        if (result != ESP_OK || mqtt_->connect() != ESP_OK)
+        {
+            transport_->disconnect();
+            reconnect();
+            return;
+        }
+        if (!routerStarted_)
+        {
+            routerStarted_ = router_.start() == ESP_OK; // Subscribing needs a connection
+        }
+        poll();
+    }
+
+    /**
+     * @brief The broker has a packet for this device: run the process loop once the current event is done
+     */
+    void wake()
+    {
+        if (!pollQueued_)
+        {
+            pollQueued_ = true;
+            network_.after(0, [this] {
+                pollQueued_ = false;
+                poll();
+            });
+        }
+    }
+
+    /**
+     * @brief What the process loop task does between waits
+     *
+     * processLoop() reads one packet per call and then replays a batch of
+     * the spool; while the spool holds records it runs every loopUs.
+     */
+    void poll()
+    {
+        while (mqtt_->isConnected() && broker_.hasInput(session_))
+        {
+            mqtt_->processLoop(0);
+        }
+        if (!replayQueued_ && mqtt_->isConnected() && mqtt_->getSpoolPending() > 0)
+        {
+            replayQueued_ = true;
+            network_.after(loopUs_, [this] {
+                replayQueued_ = false;
+                mqtt_->processLoop(0);
+                poll();
+            });
+        }
+    }
+
+    void tick()
+    {
+        char payload[96];
+        int length = snprintf(payload, sizeof(payload), "{\"seq\":%u,\"t\":%lld,\"temp\":%.1f}", sequence_,
+                              static_cast<long long>(network_.now() / 1000), 20.0 + (sequence_ % 50) / 10.0);
+        bool online = mqtt_->isConnected();
+        esp_err_t err =
+            client_->publishString(telemetryTopic_, std::string(payload, length), mqtt::MqttQos::AT_LEAST_ONCE, false);
+        if (err != ESP_OK)
+        {
+            LOPCORE_LOGW(TAG, "Device %u: telemetry %u not sent: %s", id_, sequence_, esp_err_to_name(err));
+        }
+        else if (!online)
+        {
+            offlinePublishes_++;
+        }
+        LOPCORE_LOGD(TAG, "Device %u: telemetry %u", id_, sequence_);
+
+        if (++sequence_ % PERSIST_EVERY == 0)
+        {
+            nvs_.set<uint32_t>("seq", sequence_);
+        }
+        poll(); // Replays the spool if this publish was queued behind it
+        network_.after(intervalUs_, [this] { tick(); });
+    }
+
+    const uint32_t id_;
+    sim::SimNetwork &network_;
+    sim::SimBroker &broker_;
+    const std::string telemetryTopic_;
+    const std::string ackTopic_;
+    const tls::TlsConfig tlsConfig_;
+    std::shared_ptr<sim::SimTransport> transport_;
+    std::shared_ptr<mqtt::CoreMqttClient> mqtt_;
+    std::shared_ptr<CoreClientAdapter> client_;
+    commands::CommandRouter router_;
+    NvsStorage nvs_;
+    const size_t session_; ///< Broker session
+    int64_t intervalUs_;
+    const int64_t loopUs_;
+    uint32_t sequence_{0};
+    uint64_t offlinePublishes_{0};
+    bool routerStarted_{false};
+    bool pollQueued_{false};
+    bool replayQueued_{false};
+};
+
+bool parseOptions(int argc, char **argv, Options &options)
+{
+    auto seconds = [](const char *text) { return static_cast<int64_t>(strtod(text, nullptr) * 1e6); };
+    auto millis = [](const char *text) { return static_cast<int64_t>(strtod(text, nullptr) * 1e3); };
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--quick") == 0)
+        {
+            options.devices = 50;
+            options.durationS = 120;
+            options.intervalMs = 1000;
+            options.reportS = 30;
+            options.commandsPerS = 5.0;
+            options.link.dropMeanUs = 30000000;
+            options.link.outageEveryUs = 50000000;
+            options.link.outageForUs = 5000000;
+            continue;
+        }
+        if (value == nullptr)
+        {
+            return false;
+        }
+        ++i;
+        if (strcmp(arg, "--devices") == 0)
+        {
+            options.devices = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else if (strcmp(arg, "--duration") == 0)
+        {
+            options.durationS = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else if (strcmp(arg, "--interval") == 0)
+        {
+            options.intervalMs = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else if (strcmp(arg, "--latency") == 0)
+        {
+            options.link.latencyUs = millis(value);
+        }
+        else if (strcmp(arg, "--jitter") == 0)
+        {
+            options.link.jitterUs = millis(value);
+        }
+        else if (strcmp(arg, "--loss") == 0)
+        {
+            options.link.lossRate = strtod(value, nullptr) / 100.0;
+        }
+        else if (strcmp(arg, "--drop-every") == 0)
+        {
+            options.link.dropMeanUs = seconds(value);
+        }
+        else if (strcmp(arg, "--outage-every") == 0)
+        {
+            options.link.outageEveryUs = seconds(value);
+        }
+        else if (strcmp(arg, "--outage-for") == 0)
+        {
+            options.link.outageForUs = seconds(value);
+        }
+        else if (strcmp(arg, "--commands") == 0)
+        {
+            options.commandsPerS = strtod(value, nullptr);
+        }
+        else if (strcmp(arg, "--report") == 0)
+        {
+            options.reportS = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else if (strcmp(arg, "--seed") == 0)
+        {
+            options.seed = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else if (strcmp(arg, "--spool-dir") == 0)
+        {
+            options.spoolDir = value;
+        }
+        else if (strcmp(arg, "--max-growth-kb") == 0)
+        {
+            options.maxGrowthKb = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return options.devices > 0 && options.durationS > 0 && options.intervalMs > 0 && options.reportS > 0 &&
+           options.link.lossRate >= 0.0 && options.link.lossRate < 1.0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        fprintf(stderr,
+                "usage: %s [--devices N] [--duration S] [--interval MS] [--latency MS] [--jitter MS]\n"
+                "       [--loss PCT] [--drop-every S] [--outage-every S] [--outage-for S]\n"
+                "       [--commands PER_S] [--report S] [--seed N] [--spool-dir PATH]\n"
+                "       [--max-growth-kb N] [--quick]\n",
+                argv[0]);
+        return 1;
+    }
+
+    // Each device keeps its spool segments open once it has used them, as a unit does
+    struct rlimit files;
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max)
+    {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    std::error_code ignored;
+    std::filesystem::remove_all(options.spoolDir, ignored);
+    if (mkdir(options.spoolDir.c_str(), 0775) != 0)
+    {
+        fprintf(stderr, "cannot create %s\n", options.spoolDir.c_str());
+        return 1;
+    }
+
+    auto &logger = Logger::getInstance();
+    logger.disableAsync();
+    logger.clearSinks();
+    logger.setGlobalLevel(LogLevel::INFO);
+    auto sink = std::make_unique<CountingSink>();
+    CountingSink *counts = sink.get();
+    logger.addSink(std::move(sink));
+
+    // NvsStorage's host fallback reports every write on std::cout; the table goes to stdout via printf
+    NullBuffer nullBuffer;
+    std::streambuf *coutBuffer = std::cout.rdbuf(&nullBuffer);
+
+    sim::SimNetwork network(options.link, options.seed);
+    MockEspTimer::setSource([&network] { return network.now(); });
+    sim::SimBroker broker(network);
+    uint64_t telemetry = 0;
+    uint64_t acks = 0;
+    broker.setPublishHook([&](size_t, const std::string &topic, const std::vector<uint8_t> &) {
+        bool ack = topic.size() > 4 && topic.compare(topic.size() - 4, 4, "/ack") == 0;
+        (ack ? acks : telemetry)++;
+    });
+
+    std::vector<std::unique_ptr<Device>> devices;
+    devices.reserve(options.devices);
+    for (uint32_t id = 0; id < options.devices; ++id)
+    {
+        devices.push_back(std::make_unique<Device>(id, network, broker, options));
+        devices.back()->start();
+    }
+    broker.start();
+
+    // Cloud side: pings and interval updates to random devices
+    uint64_t commandsSent = 0;
+    std::function<void()> sendCommand;
+    if (options.commandsPerS > 0.0)
+    {
+        int64_t gapUs = static_cast<int64_t>(1e6 / options.commandsPerS);
+        sendCommand = [&, gapUs] {
+            size_t target = static_cast<size_t>(network.uniform(options.devices - 1));
+            std::string prefix = "sim/" + std::to_string(target) + "/cmd/";
+            char payload[48];
+            int length = commandsSent % 4 == 3
+                             ? snprintf(payload, sizeof(payload), "{\"ms\":%u}", options.intervalMs)
+                             : snprintf(payload, sizeof(payload), "{\"n\":%llu}",
+                                        static_cast<unsigned long long>(commandsSent));
+            broker.send(target, prefix + (commandsSent % 4 == 3 ? "interval" : "ping"),
+                        std::vector<uint8_t>(payload, payload + length));
+            commandsSent++;
+            network.after(gapUs, sendCommand);
+        };
+        network.after(gapUs, sendCommand);
+    }
+
+    printf("%u devices, %u s, telemetry every %u ms, latency %lld+%lld ms, loss %.2f%%, seed %u\n",
+           options.devices, options.durationS, options.intervalMs,
+           static_cast<long long>(options.link.latencyUs / 1000), static_cast<long long>(options.link.jitterUs / 1000),
+           options.link.lossRate * 100.0, options.seed);
+    printf("%7s %7s %9s %10s %7s %7s %8s %8s %8s %10s %10s\n", "sim_s", "online", "msg/s", "received", "lost",
+           "dup", "spooled", "backlog", "cmd_ack", "live_kB", "allocs/msg");
+
+    using Clock = std::chrono::steady_clock;
+    auto wallStart = Clock::now();
+    int64_t firstLive = -1;
+    uint64_t lastReceived = 0;
+    uint64_t lastAllocations = g_allocations.load();
+    for (uint32_t t = options.reportS; t < options.durationS + options.reportS; t += options.reportS)
+    {
+        uint32_t at = std::min(t, options.durationS);
+        int64_t lastAt = network.now();
+        network.runUntil(static_cast<int64_t>(at) * 1000000);
+
+        size_t online = 0;
+        uint64_t spooled = 0;
+        size_t backlog = 0;
+        for (const auto &device : devices)
+        {
+            online += device->isConnected() ? 1 : 0;
+            spooled += device->offlinePublishes();
+            backlog += device->spoolPending();
+        }
+
+        const sim::BrokerStats &brokerStats = broker.getStats();
+        uint64_t received = brokerStats.received;
+        uint64_t allocations = g_allocations.load();
+        int64_t live = g_liveBytes.load();
+        if (firstLive < 0)
+        {
+            firstLive = live;
+        }
+        double spanS = (network.now() - lastAt) / 1e6;
+        uint64_t delta = received - lastReceived;
+        printf("%7u %7zu %9.1f %10llu %7llu %7llu %8llu %8zu %8llu %10.1f %10.1f\n", at, online,
+               spanS > 0 ? delta / spanS : 0.0, static_cast<unsigned long long>(received),
+               static_cast<unsigned long long>(brokerStats.lost),
+               static_cast<unsigned long long>(brokerStats.duplicates),
+               static_cast<unsigned long long>(spooled), backlog, static_cast<unsigned long long>(acks),
+               live / 1024.0, delta > 0 ? static_cast<double>(allocations - lastAllocations) / delta : 0.0);
+        lastReceived = received;
+        lastAllocations = allocations;
+    }
+    double wallS = std::chrono::duration<double>(Clock::now() - wallStart).count();
+
+    int64_t growth = g_liveBytes.load() - firstLive;
+    const sim::BrokerStats &stats = broker.getStats();
+    printf("\nwall %.2f s (%.0fx real time), %.0f broker messages per wall second\n", wallS,
+           wallS > 0 ? options.durationS / wallS : 0.0, wallS > 0 ? stats.received / wallS : 0.0);
+    printf("telemetry %llu, commands %llu sent / %llu acked, downlink held %llu / expired %llu, connects %llu, "
+           "outages %llu\n",
+           static_cast<unsigned long long>(telemetry), static_cast<unsigned long long>(commandsSent),
+           static_cast<unsigned long long>(acks), static_cast<unsigned long long>(stats.queued),
+           static_cast<unsigned long long>(stats.expired), static_cast<unsigned long long>(stats.connects),
+           static_cast<unsigned long long>(stats.outages));
+    printf("heap: %.1f kB after first report, %.1f kB at end (growth %+.1f kB), peak %.1f kB, %llu allocations\n",
+           firstLive / 1024.0, g_liveBytes.load() / 1024.0, growth / 1024.0, g_peakBytes.load() / 1024.0,
+           static_cast<unsigned long long>(g_allocations.load()));
+    printf("log records: %llu error, %llu warn, %llu info\n", static_cast<unsigned long long>(counts->counts[1]),
+           static_cast<unsigned long long>(counts->counts[2]), static_cast<unsigned long long>(counts->counts[3]));
+
+    network.clear();
+    devices.clear();
+    MockEspTimer::setSource(nullptr);
+    logger.clearSinks();
+    std::cout.rdbuf(coutBuffer);
+    std::filesystem::remove_all(options.spoolDir, ignored);
+
+    if (options.maxGrowthKb > 0 && growth > static_cast<int64_t>(options.maxGrowthKb) * 1024)
+    {
+        fprintf(stderr, "heap grew by %.1f kB (limit %u kB)\n", growth / 1024.0, options.maxGrowthKb);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,661 @@
+/**
+ * @file sim_network.hpp
+ * @brief Discrete-event network, broker and TLS transport for host simulation
+ *
+ * Everything runs on one thread against a virtual clock, so a run with a
+ * given seed is reproducible and an hour of fleet traffic takes seconds.
+ * Devices run the real CoreMqttClient: SimBroker is the far end of the
+ * coreMQTT mock (MockCoreMqtt::Broker), so publishes, acknowledgements
+ * and inbound messages cross the simulated link, and SimTransport is the
+ * MockTlsTransport it connects over, reconnecting with full jitter on
+ * the virtual clock as the real transport does.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core_mqtt.h"
+#include "tls/mock_tls_transport.hpp"
+
+namespace lopcore
+{
+namespace sim
+{
+
+/**
+ * @brief Link and broker behaviour (all times in simulated microseconds)
+ */
+struct LinkProfile
+{
+    int64_t latencyUs{50000};         ///< One-way latency
+    int64_t jitterUs{20000};          ///< Extra latency, uniform in [0, jitterUs]
+    double lossRate{0.01};            ///< Probability that a packet is lost once (resent after retryUs)
+    int64_t dropMeanUs{0};            ///< Mean time between drops of one connection (0 = never)
+    int64_t outageEveryUs{0};         ///< Broker restart period (0 = never)
+    int64_t outageForUs{30000000};    ///< Broker downtime per restart
+    int64_t reconnectBaseUs{500000};  ///< First reconnect backoff window
+    int64_t reconnectMaxUs{32000000}; ///< Backoff window cap
+    int64_t retryUs{1000000};         ///< TCP retransmission timeout
+    int64_t loopUs{10000};            ///< Process loop period while the spool drains
+    size_t brokerQueue{32};           ///< Downlink messages kept for an offline client
+};
+
+/**
+ * @brief Event queue on a virtual clock
+ */
+class SimNetwork
+{
+public:
+    using Action = std::function<void()>;
+
+    SimNetwork(const LinkProfile &profile, uint32_t seed) : profile_(profile), rng_(seed)
+    {
+    }
+
+    int64_t now() const
+    {
+        return now_;
+    }
+
+    const LinkProfile &profile() const
+    {
+        return profile_;
+    }
+
+    size_t pendingEvents() const
+    {
+        return events_.size();
+    }
+
+    /**
+     * @brief Run an action delayUs from now
+     */
+    void after(int64_t delayUs, Action action)
+    {
+        events_.push(Event{now_ + std::max<int64_t>(delayUs, 0), sequence_++, std::move(action)});
+    }
+
+    /**
+     * @brief Run every event due up to endUs, then move the clock to endUs
+     */
+    void runUntil(int64_t endUs)
+    {
+        while (!events_.empty() && events_.top().atUs <= endUs)
+        {
+            Action action = std::move(const_cast<Event &>(events_.top()).action);
+            now_ = events_.top().atUs;
+            events_.pop();
+            action();
+        }
+        now_ = std::max(now_, endUs);
+    }
+
+    /**
+     * @brief Drop all pending events (before the objects they refer to go away)
+     */
+    void clear()
+    {
+        events_ = {};
+    }
+
+    /// One-way delay of a packet; TCP hides a loss behind a retransmission
+    int64_t delay()
+    {
+        return profile_.latencyUs + uniform(profile_.jitterUs) + (lose() ? profile_.retryUs : 0);
+    }
+
+    /// Whether a packet (or a connection attempt) is lost
+    bool lose()
+    {
+        return profile_.lossRate > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < profile_.lossRate;
+    }
+
+    /// Uniform in [0, maxUs]
+    int64_t uniform(int64_t maxUs)
+    {
+        return maxUs > 0 ? std::uniform_int_distribution<int64_t>(0, maxUs)(rng_) : 0;
+    }
+
+    /// Exponentially distributed with the given mean
+    int64_t exponential(int64_t meanUs)
+    {
+        return static_cast<int64_t>(std::exponential_distribution<double>(1.0 / meanUs)(rng_));
+    }
+
+private:
+    struct Event
+    {
+        int64_t atUs;
+        uint64_t sequence; ///< Keeps events at the same time in scheduling order
+        Action action;
+    };
+
+    struct Later
+    {
+        bool operator()(const Event &a, const Event &b) const
+        {
+            return a.atUs != b.atUs ? a.atUs > b.atUs : a.sequence > b.sequence;
+        }
+    };
+
+    const LinkProfile profile_;
+    std::mt19937 rng_;
+    std::priority_queue<Event, std::vector<Event>, Later> events_;
+    int64_t now_{0};
+    uint64_t sequence_{0};
+};
+
+/**
+ * @brief Broker counters
+ */
+struct BrokerStats
+{
+    uint64_t received{0};      ///< Uplink publishes (duplicates included)
+    uint64_t receivedBytes{0}; ///< Their topic and payload bytes
+    uint64_t duplicates{0};    ///< Uplink publishes resent with DUP after a reconnect
+    uint64_t lost{0};          ///< Packets in flight on a connection that went down
+    uint64_t sent{0};          ///< Downlink messages read by their client
+    uint64_t queued{0};        ///< Downlink messages held for an offline client
+    uint64_t expired{0};       ///< Held messages dropped to the queue limit
+    uint64_t connects{0};      ///< Accepted CONNECTs
+    uint64_t outages{0};       ///< Broker restarts
+};
+
+/**
+ * @brief Broker all clients connect to, installed as the coreMQTT mock's far end
+ *
+ * Sessions are persistent: a client that connects with cleanSession off
+ * finds its session again, even after a broker restart. Uplink publishes
+ * are handed to onPublish and QoS 1/2 ones acknowledged; a packet still
+ * on a connection that goes down is lost, so the client resends it with
+ * DUP once it has reconnected. Downlink messages are QoS 1: held (up to
+ * brokerQueue) while the client is offline and again when lost.
+ * SUBACK and UNSUBACK are not sent; the client only logs them.
+ */
+class SimBroker : public MockCoreMqtt::Broker
+{
+public:
+    using PublishHook = std::function<void(size_t client, const std::string &topic, const std::vector<uint8_t> &)>;
+
+    explicit SimBroker(SimNetwork &network) : network_(network)
+    {
+    }
+
+    ~SimBroker() override
+    {
+        if (MockCoreMqtt::broker() == this)
+        {
+            MockCoreMqtt::setBroker(nullptr);
+        }
+    }
+
+    /**
+     * @brief Take over the coreMQTT mock and start the restart schedule, if any
+     */
+    void start()
+    {
+        MockCoreMqtt::setBroker(this);
+        if (network_.profile().outageEveryUs > 0)
+        {
+            network_.after(network_.profile().outageEveryUs, [this] { restart(); });
+        }
+    }
+
+    /**
+     * @brief Add the session of a client
+     *
+     * @param wake Called when the client has a packet to read; runs its process loop later, not inline
+     */
+    size_t attach(const std::string &clientId, std::function<void()> wake)
+    {
+        sessions_.push_back(Session{});
+        sessions_.back().wake = std::move(wake);
+        clientIds_.emplace(clientId, sessions_.size() - 1);
+        return sessions_.size() - 1;
+    }
+
+    bool isUp() const
+    {
+        return up_;
+    }
+
+    /**
+     * @brief Whether a process loop call would read something (a packet or the lost connection)
+     */
+    bool hasInput(size_t client) const
+    {
+        return !sessions_[client].inbox.empty() || sessions_[client].broken;
+    }
+
+    void setPublishHook(PublishHook hook)
+    {
+        onPublish_ = std::move(hook);
+    }
+
+    /**
+     * @brief Send a message to one client
+     */
+    void send(size_t client, std::string topic, std::vector<uint8_t> payload)
+    {
+        Message message{std::move(topic), std::move(payload)};
+        if (!up_ || sessions_[client].context == nullptr)
+        {
+            hold(client, std::move(message));
+            return;
+        }
+        transmit(client, std::make_shared<const Message>(std::move(message)));
+    }
+
+    /**
+     * @brief Break the connection of one client (link failure)
+     */
+    void drop(size_t client)
+    {
+        Session &session = sessions_[client];
+        if (session.context == nullptr)
+        {
+            return;
+        }
+        close(client);
+        session.broken = true;
+        session.wake();
+    }
+
+    const BrokerStats &getStats() const
+    {
+        return stats_;
+    }
+
+    // =============================================================================
+    // MockCoreMqtt::Broker
+    // =============================================================================
+
+    MQTTStatus_t connect(MQTTContext_t *context, const MQTTConnectInfo_t &info, bool *sessionPresent) override
+    {
+        auto id = clientIds_.find(std::string(info.pClientIdentifier, info.clientIdentifierLength));
+        if (!up_ || id == clientIds_.end())
+        {
+            return up_ ? MQTTServerRefused : MQTTRecvFailed;
+        }
+
+        size_t client = id->second;
+        Session &session = sessions_[client];
+        if (session.context != nullptr)
+        {
+            close(client); // Session taken over
+        }
+        contexts_[context] = client;
+        session.context = context;
+        session.broken = false;
+        *sessionPresent = session.known && !info.cleanSession;
+        session.known = !info.cleanSession;
+        stats_.connects++;
+
+        if (network_.profile().dropMeanUs > 0)
+        {
+            uint64_t epoch = session.epoch;
+            network_.after(network_.exponential(network_.profile().dropMeanUs), [this, client, epoch] {
+                if (sessions_[client].epoch == epoch)
+                {
+                    drop(client);
+                }
+            });
+        }
+
+        // Messages held while the client was away
+        std::deque<Message> held;
+        held.swap(session.held);
+        for (Message &message : held)
+        {
+            transmit(client, std::make_shared<const Message>(std::move(message)));
+        }
+        return MQTTSuccess;
+    }
+
+    MQTTStatus_t publish(MQTTContext_t *context, const MQTTPublishInfo_t &info, uint16_t packetId) override
+    {
+        size_t client = 0;
+        if (!connected(context, &client))
+        {
+            stats_.lost++; // Written to a socket the broker has already closed
+            return MQTTSuccess;
+        }
+
+        auto message = std::make_shared<const Message>(
+            Message{std::string(info.pTopicName, info.topicNameLength),
+                    std::vector<uint8_t>(static_cast<const uint8_t *>(info.pPayload),
+                                         static_cast<const uint8_t *>(info.pPayload) + info.payloadLength)});
+        uint64_t epoch = sessions_[client].epoch;
+        bool acknowledge = info.qos != MQTTQoS0;
+        bool dup = info.dup;
+        network_.after(network_.delay(), [this, client, epoch, message, packetId, acknowledge, dup] {
+            if (sessions_[client].epoch != epoch || !up_)
+            {
+                stats_.lost++;
+                return;
+            }
+            stats_.received++;
+            stats_.receivedBytes += message->topic.size() + message->payload.size();
+            stats_.duplicates += dup ? 1 : 0;
+            if (onPublish_)
+            {
+                onPublish_(client, message->topic, message->payload);
+            }
+            if (acknowledge)
+            {
+                network_.after(network_.delay(), [this, client, epoch, packetId] {
+                    if (sessions_[client].epoch != epoch)
+                    {
+                        stats_.lost++;
+                        return;
+                    }
+                    arrive(client, Packet{MQTT_PACKET_TYPE_PUBACK, packetId, nullptr});
+                });
+            }
+        });
+        return MQTTSuccess;
+    }
+
+    MQTTStatus_t subscribe(MQTTContext_t *context, const MQTTSubscribeInfo_t *, size_t, bool) override
+    {
+        // Delivery goes by client, not by filter: the client's own subscriptions pick the callbacks
+        size_t client = 0;
+        if (!connected(context, &client))
+        {
+            stats_.lost++;
+        }
+        return MQTTSuccess;
+    }
+
+    MQTTStatus_t receive(MQTTContext_t *context, MQTTPacketInfo_t *packet, MQTTDeserializedInfo_t *info) override
+    {
+        auto it = contexts_.find(context);
+        if (it == contexts_.end())
+        {
+            return MQTTRecvFailed;
+        }
+        Session &session = sessions_[it->second];
+        if (session.context != context)
+        {
+            session.broken = false; // Reported
+            return MQTTRecvFailed;
+        }
+        if (session.inbox.empty())
+        {
+            return MQTTNoDataAvailable;
+        }
+
+        session.reading = std::move(session.inbox.front());
+        session.inbox.pop_front();
+        info->packetIdentifier = session.reading.packetId;
+        if (session.reading.type == MQTT_PACKET_TYPE_PUBACK)
+        {
+            packet->type = MQTT_PACKET_TYPE_PUBACK;
+            return MQTTSuccess;
+        }
+
+        const Message &message = *session.reading.message;
+        packet->type = static_cast<MQTTPacketType_t>(MQTT_PACKET_TYPE_PUBLISH | (MQTTQoS1 << 1));
+        info->pPublishInfo->qos = MQTTQoS1;
+        info->pPublishInfo->pTopicName = message.topic.data();
+        info->pPublishInfo->topicNameLength = static_cast<uint16_t>(message.topic.size());
+        info->pPublishInfo->pPayload = message.payload.data();
+        info->pPublishInfo->payloadLength = message.payload.size();
+        stats_.sent++;
+        return MQTTSuccess;
+    }
+
+    void disconnect(MQTTContext_t *context) override
+    {
+        size_t client = 0;
+        if (connected(context, &client))
+        {
+            close(client);
+        }
+    }
+
+private:
+    struct Message
+    {
+        std::string topic;
+        std::vector<uint8_t> payload;
+    };
+
+    /**
+     * @brief Packet that reached the client, waiting to be read
+     */
+    struct Packet
+    {
+        MQTTPacketType_t type;                  ///< PUBLISH or PUBACK
+        uint16_t packetId;                      ///< Of the PUBACK, or of the downlink PUBLISH
+        std::shared_ptr<const Message> message; ///< PUBLISH only
+    };
+
+    struct Session
+    {
+        std::function<void()> wake;
+        MQTTContext_t *context{nullptr}; ///< Current connection, nullptr while offline
+        uint64_t epoch{0};               ///< Bumped when a connection ends; its packets check it
+        bool known{false};               ///< A persistent session exists
+        bool broken{false};              ///< Dropped without the client noticing yet
+        uint16_t nextPacketId{0};        ///< Downlink packet IDs
+        std::deque<Packet> inbox;        ///< Arrived at the client
+        Packet reading{};                ///< Last packet read, referenced until the next read
+        std::deque<Message> held;        ///< Downlink kept while offline
+    };
+
+    bool connected(MQTTContext_t *context, size_t *client) const
+    {
+        auto it = contexts_.find(context);
+        if (it == contexts_.end() || sessions_[it->second].context != context)
+        {
+            return false;
+        }
+        *client = it->second;
+        return true;
+    }
+
+    /**
+     * @brief End the current connection of a client; what it had not read is lost
+     */
+    void close(size_t client)
+    {
+        Session &session = sessions_[client];
+        session.context = nullptr;
+        session.epoch++;
+        for (Packet &packet : session.inbox)
+        {
+            if (packet.message)
+            {
+                hold(client, *packet.message); // Not acknowledged, so sent again
+            }
+            else
+            {
+                stats_.lost++;
+            }
+        }
+        session.inbox.clear();
+    }
+
+    void transmit(size_t client, std::shared_ptr<const Message> message)
+    {
+        Session &session = sessions_[client];
+        if (++session.nextPacketId == MQTT_PACKET_ID_INVALID)
+        {
+            session.nextPacketId = 1;
+        }
+        uint16_t packetId = session.nextPacketId;
+        uint64_t epoch = session.epoch;
+        network_.after(network_.delay(), [this, client, epoch, packetId, message] {
+            if (sessions_[client].epoch == epoch && up_)
+            {
+                arrive(client, Packet{MQTT_PACKET_TYPE_PUBLISH, packetId, message});
+            }
+            else
+            {
+                hold(client, *message);
+            }
+        });
+    }
+
+    void arrive(size_t client, Packet packet)
+    {
+        sessions_[client].inbox.push_back(std::move(packet));
+        sessions_[client].wake();
+    }
+
+    void hold(size_t client, Message message)
+    {
+        std::deque<Message> &held = sessions_[client].held;
+        if (held.size() >= network_.profile().brokerQueue)
+        {
+            held.pop_front();
+            stats_.expired++;
+        }
+        held.push_back(std::move(message));
+        stats_.queued++;
+    }
+
+    void restart()
+    {
+        up_ = false;
+        stats_.outages++;
+        for (size_t client = 0; client < sessions_.size(); ++client)
+        {
+            drop(client);
+        }
+        network_.after(network_.profile().outageForUs, [this] {
+            up_ = true;
+            network_.after(network_.profile().outageEveryUs, [this] { restart(); });
+        });
+    }
+
+    SimNetwork &network_;
+    std::vector<Session> sessions_;
+    std::unordered_map<std::string, size_t> clientIds_;
+    std::unordered_map<const MQTTContext_t *, size_t> contexts_;
+    PublishHook onPublish_;
+    BrokerStats stats_;
+    bool up_{true};
+};
+
+/**
+ * @brief MockTlsTransport that connects on the simulated network
+ *
+ * connectAsync() waits and retries like the real transport: full jitter
+ * in a window starting at retryBaseDelay and doubling up to retryMaxDelay
+ * (the first attempt too with jitterFirstAttempt). An attempt fails while
+ * the broker is down or when the link loses it, and otherwise takes two
+ * round trips for the TCP and TLS handshakes. disconnect() cancels a
+ * connection still retrying without calling back.
+ */
+class SimTransport : public test::MockTlsTransport
+{
+public:
+    SimTransport(SimNetwork &network, SimBroker &broker) : network_(network), broker_(broker)
+    {
+    }
+
+    esp_err_t connectAsync(const tls::TlsConfig &config, ConnectCallback callback) override
+    {
+        if (isConnected() || connecting_)
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+        config_ = config;
+        callback_ = std::move(callback);
+        connecting_ = true;
+        attempt(0, config_.jitterFirstAttempt ? toUs(config_.retryBaseDelay) : 0);
+        return ESP_OK;
+    }
+
+    void disconnect() noexcept override
+    {
+        generation_++;
+        connecting_ = false;
+        MockTlsTransport::disconnect();
+    }
+
+    void *getNetworkContext() noexcept override
+    {
+        return &context_;
+    }
+
+private:
+    static int64_t toUs(std::chrono::milliseconds delay)
+    {
+        return static_cast<int64_t>(delay.count()) * 1000;
+    }
+
+    void attempt(uint32_t failures, int64_t windowUs)
+    {
+        uint64_t generation = generation_;
+        network_.after(network_.uniform(windowUs), [this, failures, generation] {
+            if (generation != generation_)
+            {
+                return;
+            }
+            if (!broker_.isUp() || network_.lose())
+            {
+                retry(failures + 1);
+                return;
+            }
+            network_.after(2 * (network_.delay() + network_.delay()), [this, failures, generation] {
+                if (generation != generation_)
+                {
+                    return;
+                }
+                if (!broker_.isUp())
+                {
+                    retry(failures + 1);
+                    return;
+                }
+                finish(connect(config_));
+            });
+        });
+    }
+
+    void retry(uint32_t failures)
+    {
+        if (config_.maxRetries > 0 && failures >= config_.maxRetries)
+        {
+            finish(ESP_ERR_TIMEOUT);
+            return;
+        }
+        int64_t window = toUs(config_.retryBaseDelay) << std::min<uint32_t>(failures - 1, 16);
+        attempt(failures, std::min(window, toUs(config_.retryMaxDelay)));
+    }
+
+    void finish(esp_err_t result)
+    {
+        connecting_ = false;
+        ConnectCallback callback = std::move(callback_);
+        callback_ = nullptr;
+        if (callback)
+        {
+            callback(result);
+        }
+    }
+
+    SimNetwork &network_;
+    SimBroker &broker_;
+    NetworkContext_t context_{};
+    tls::TlsConfig config_;
+    ConnectCallback callback_;
+    bool connecting_{false};
+    uint64_t generation_{0}; ///< Bumped by disconnect(); stale attempts check it
+};
+
+} // namespace sim
+} // namespace lopcore
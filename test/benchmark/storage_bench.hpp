@@ -0,0 +1,212 @@
+/**
+ * @file storage_bench.hpp
+ * @brief Storage backend sweep shared by bench_storage (host) and
+ *        examples/09_storage_benchmark (device)
+ *
+ * For each value size and file count, a case writes every file, reads
+ * every file back, lists the keys and removes every file, timing each
+ * call. The platform supplies the clock, the heap counter and, where the
+ * medium allows, a count of bytes physically written, so the same sweep
+ * runs against the host fallbacks and the real partitions.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace lopcore
+{
+namespace bench
+{
+
+/**
+ * @brief Measurements the sweep takes from the platform
+ */
+struct Platform
+{
+    std::function<uint64_t()> nowUs;        ///< Monotonic time in microseconds
+    std::function<size_t()> heapUsed;       ///< Heap bytes in use
+    std::function<uint64_t()> bytesWritten; ///< Bytes written to the medium so far; empty if not measurable
+};
+
+/**
+ * @brief Sizes and counts swept for one backend
+ */
+struct Sweep
+{
+    std::vector<size_t> valueSizes;
+    std::vector<size_t> fileCounts;
+    size_t maxValueSize = SIZE_MAX; ///< Larger sizes are skipped (NVS entries)
+    size_t maxCaseBytes = SIZE_MAX; ///< File count is reduced so one case stays below this
+    size_t listRepeats = 5;         ///< listKeys() calls per case
+};
+
+/**
+ * @brief One operation type of one case
+ */
+struct PhaseResult
+{
+    size_t ops = 0;
+    size_t failures = 0;
+    uint64_t bytes = 0;       ///< Payload bytes moved
+    uint64_t totalUs = 0;
+    uint64_t p99Us = 0;
+    long heapDelta = 0;       ///< Heap in use after the phase minus before
+    uint64_t written = 0;     ///< Bytes written to the medium during the phase
+};
+
+inline void printHeader()
+{
+    printf("%-9s %-6s %8s %6s %10s %9s %9s %9s %10s %6s\n", "backend", "op", "bytes", "files", "ops/s", "MB/s",
+           "p99 us", "heap", "written", "amp");
+}
+
+inline void printRow(const char *backend, const char *op, size_t valueSize, size_t files,
+                     const PhaseResult &result, bool wearMeasured)
+{
+    double seconds = result.totalUs / 1e6;
+    double opsPerSecond = seconds > 0 ? result.ops / seconds : 0;
+    double megabytesPerSecond = seconds > 0 ? result.bytes / seconds / (1024.0 * 1024.0) : 0;
+
+    printf("%-9s %-6s %8zu %6zu %10.0f %9.2f %9llu %9ld", backend, op, valueSize, files, opsPerSecond,
+           megabytesPerSecond, static_cast<unsigned long long>(result.p99Us), result.heapDelta);
+    if (wearMeasured)
+    {
+        printf(" %10llu", static_cast<unsigned long long>(result.written));
+        if (result.bytes > 0)
+        {
+            printf(" %6.2f", static_cast<double>(result.written) / result.bytes);
+        }
+        else
+        {
+            printf(" %6s", "-");
+        }
+    }
+    else
+    {
+        printf(" %10s %6s", "-", "-");
+    }
+    printf("%s\n", result.failures > 0 ? "  FAILED" : "");
+}
+
+/**
+ * @brief Times op once per index and summarizes the latencies
+ */
+template <typename Operation>
+PhaseResult measure(const Platform &platform, size_t count, Operation op)
+{
+    PhaseResult result;
+    std::vector<uint32_t> latencies;
+    latencies.reserve(count);
+
+    size_t heapBefore = platform.heapUsed();
+    uint64_t writtenBefore = platform.bytesWritten ? platform.bytesWritten() : 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t start = platform.nowUs();
+        size_t moved = 0;
+        bool ok = op(i, moved);
+        uint64_t elapsed = platform.nowUs() - start;
+
+        latencies.push_back(static_cast<uint32_t>(std::min<uint64_t>(elapsed, UINT32_MAX)));
+        result.totalUs += elapsed;
+        result.bytes += moved;
+        result.ops++;
+        if (!ok)
+        {
+            result.failures++;
+        }
+    }
+    result.heapDelta = static_cast<long>(platform.heapUsed()) - static_cast<long>(heapBefore);
+    result.written = platform.bytesWritten ? platform.bytesWritten() - writtenBefore : 0;
+
+    if (!latencies.empty())
+    {
+        size_t rank = (latencies.size() * 99 + 99) / 100 - 1; // Nearest-rank p99
+        std::nth_element(latencies.begin(), latencies.begin() + rank, latencies.end());
+        result.p99Us = latencies[rank];
+    }
+    return result;
+}
+
+/**
+ * @brief Run the sweep against one backend and print a row per operation
+ *
+ * Storage needs write(key, vector), readBinary(key), listKeys() and
+ * remove(key). Keys are "bench_<n>", short enough for NVS.
+ *
+ * @return Number of operations that failed
+ */
+template <typename Storage>
+size_t runSweep(const char *name, Storage &storage, const Sweep &sweep, const Platform &platform)
+{
+    size_t failures = 0;
+    bool wearMeasured = static_cast<bool>(platform.bytesWritten);
+
+    for (size_t valueSize : sweep.valueSizes)
+    {
+        if (valueSize > sweep.maxValueSize)
+        {
+            printf("%-9s %-6s %8zu  skipped: larger than the backend's value limit\n", name, "-", valueSize);
+            continue;
+        }
+
+        size_t previousFiles = 0;
+        for (size_t fileCount : sweep.fileCounts)
+        {
+            size_t files = std::max<size_t>(1, std::min(fileCount, sweep.maxCaseBytes / valueSize));
+            if (files == previousFiles)
+            {
+                continue; // Capped to the same count as the last case
+            }
+            previousFiles = files;
+
+            std::vector<uint8_t> value(valueSize);
+            for (size_t i = 0; i < valueSize; i++)
+            {
+                value[i] = static_cast<uint8_t>(i * 31 + 7);
+            }
+            std::vector<std::string> keys;
+            for (size_t i = 0; i < files; i++)
+            {
+                keys.push_back("bench_" + std::to_string(i));
+            }
+
+            PhaseResult write = measure(platform, files, [&](size_t i, size_t &moved) {
+                moved = value.size();
+                return storage.write(keys[i], value);
+            });
+            PhaseResult read = measure(platform, files, [&](size_t i, size_t &moved) {
+                auto data = storage.readBinary(keys[i]);
+                moved = data ? data->size() : 0;
+                return data && data->size() == value.size();
+            });
+            PhaseResult list = measure(platform, sweep.listRepeats, [&](size_t, size_t &) {
+                return storage.listKeys().size() >= files;
+            });
+            PhaseResult remove = measure(platform, files, [&](size_t i, size_t &) { return storage.remove(keys[i]); });
+
+            printRow(name, "write", valueSize, files, write, wearMeasured);
+            printRow(name, "read", valueSize, files, read, false);
+            printRow(name, "list", valueSize, files, list, false);
+            printRow(name, "remove", valueSize, files, remove, wearMeasured);
+            failures += write.failures + read.failures + list.failures + remove.failures;
+        }
+    }
+    return failures;
+}
+
+inline void printLegend()
+{
+    printf("\nops/s and MB/s over the whole phase, p99 is the 99th percentile latency of one call,\n"
+           "heap is the change in heap use across the phase (caches and indexes show up here),\n"
+           "written is bytes the medium took during the phase and amp is written / payload bytes.\n");
+}
+
+} // namespace bench
+} // namespace lopcore
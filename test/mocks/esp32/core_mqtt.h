@@ -3,6 +3,8 @@
  * @brief Mock coreMQTT API for host testing
  *
  * This provides minimal mocks of the AWS IoT coreMQTT library for testing.
+ * Nothing is serialized: MockCoreMqtt::setBroker() installs the far end
+ * of every connection, which sees the calls and supplies inbound packets.
  */
 
 #pragma once
@@ -165,7 +167,11 @@ struct MQTTContext;
 // MQTT context
 typedef struct MQTTContext
 {
-    const TransportInterface_t *pNetworkInterface;
+    MQTTPubAckInfo_t *outgoingPublishRecords;
+    MQTTPubAckInfo_t *incomingPublishRecords;
+    size_t outgoingPublishRecordMaxCount;
+    size_t incomingPublishRecordMaxCount;
+    TransportInterface_t transportInterface;
     MQTTFixedBuffer_t networkBuffer;
     MQTTGetCurrentTimeFunc_t getTime;
     MQTTEventCallback_t appCallback;
@@ -173,6 +179,97 @@ typedef struct MQTTContext
     MQTTConnectionStatus_t connectStatus;
 } MQTTContext_t;
 
+#ifdef __cplusplus
+}
+#endif
+
+extern "C++" {
+namespace MockCoreMqtt
+{
+
+/**
+ * @brief Far end of every connection, e.g. a simulated broker
+ *
+ * Without one, every call succeeds and nothing ever arrives. With one,
+ * QoS 1/2 publishes hold an outgoing record until their PUBACK/PUBCOMP
+ * comes back through receive(), as in the real library.
+ */
+class Broker
+{
+public:
+    virtual ~Broker() = default;
+
+    /// CONNECT; sets *sessionPresent
+    virtual MQTTStatus_t connect(MQTTContext_t *context, const MQTTConnectInfo_t &info, bool *sessionPresent) = 0;
+
+    /// PUBLISH (packetId is MQTT_PACKET_ID_INVALID for QoS 0)
+    virtual MQTTStatus_t publish(MQTTContext_t *context, const MQTTPublishInfo_t &info, uint16_t packetId) = 0;
+
+    /// SUBSCRIBE (subscribe = true) or UNSUBSCRIBE
+    virtual MQTTStatus_t subscribe(MQTTContext_t *context,
+                                   const MQTTSubscribeInfo_t *filters,
+                                   size_t count,
+                                   bool subscribe) = 0;
+
+    /**
+     * @brief Next packet for the client, read by MQTT_ProcessLoop()
+     *
+     * Fill packet and info (info->pPublishInfo points at storage for an
+     * inbound PUBLISH; what it references must stay valid until the next
+     * call) and return MQTTSuccess, MQTTNoDataAvailable when nothing is
+     * waiting, or the error the connection failed with.
+     */
+    virtual MQTTStatus_t receive(MQTTContext_t *context, MQTTPacketInfo_t *packet, MQTTDeserializedInfo_t *info) = 0;
+
+    /// DISCONNECT
+    virtual void disconnect(MQTTContext_t *context) = 0;
+};
+
+inline Broker *&broker()
+{
+    static Broker *instance = nullptr;
+    return instance;
+}
+
+/**
+ * @brief Route every context to broker (nullptr: back to always succeeding)
+ */
+inline void setBroker(Broker *broker)
+{
+    MockCoreMqtt::broker() = broker;
+}
+
+inline MQTTPubAckInfo_t *findRecord(MQTTContext_t *context, uint16_t packetId)
+{
+    for (size_t i = 0; i < context->outgoingPublishRecordMaxCount; i++)
+    {
+        if (context->outgoingPublishRecords[i].packetId == packetId)
+        {
+            return &context->outgoingPublishRecords[i];
+        }
+    }
+    return nullptr;
+}
+
+inline void clearRecords(MQTTContext_t *context)
+{
+    for (size_t i = 0; i < context->outgoingPublishRecordMaxCount; i++)
+    {
+        context->outgoingPublishRecords[i] = MQTTPubAckInfo_t{};
+    }
+    for (size_t i = 0; i < context->incomingPublishRecordMaxCount; i++)
+    {
+        context->incomingPublishRecords[i] = MQTTPubAckInfo_t{};
+    }
+}
+
+} // namespace MockCoreMqtt
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // Mock functions
 
 /**
@@ -186,8 +283,12 @@ inline MQTTStatus_t MQTT_Init(MQTTContext_t *pContext,
 {
     if (pContext != nullptr && pTransportInterface != nullptr && pNetworkBuffer != nullptr)
     {
-        pContext->pNetworkInterface = pTransportInterface;
+        *pContext = MQTTContext_t{};
+        pContext->transportInterface = *pTransportInterface;
+        pContext->networkBuffer = *pNetworkBuffer;
         pContext->getTime = getTimeFunction;
+        pContext->appCallback = userCallback;
+        pContext->nextPacketId = 1;
         pContext->connectStatus = MQTTNotConnected;
         return MQTTSuccess;
     }
@@ -200,17 +301,21 @@ inline MQTTStatus_t MQTT_InitStatefulQoS(MQTTContext_t *pContext,
                                          MQTTPubAckInfo_t *pIncomingPublishRecords,
                                          size_t incomingPublishCount)
 {
-    // Mock implementation - just return success
-    (void) pContext;
-    (void) pOutgoingPublishRecords;
-    (void) outgoingPublishCount;
-    (void) pIncomingPublishRecords;
-    (void) incomingPublishCount;
+    if (pContext == nullptr)
+    {
+        return MQTTBadParameter;
+    }
+
+    pContext->outgoingPublishRecords = pOutgoingPublishRecords;
+    pContext->outgoingPublishRecordMaxCount = pOutgoingPublishRecords != nullptr ? outgoingPublishCount : 0;
+    pContext->incomingPublishRecords = pIncomingPublishRecords;
+    pContext->incomingPublishRecordMaxCount = pIncomingPublishRecords != nullptr ? incomingPublishCount : 0;
+    MockCoreMqtt::clearRecords(pContext);
     return MQTTSuccess;
 }
 
 /**
- * @brief Connect to MQTT broker (mock - always succeeds)
+ * @brief Connect to MQTT broker (mock - succeeds unless a broker refuses)
  */
 inline MQTTStatus_t MQTT_Connect(MQTTContext_t *pContext,
                                  const MQTTConnectInfo_t *pConnectInfo,
@@ -218,38 +323,58 @@ inline MQTTStatus_t MQTT_Connect(MQTTContext_t *pContext,
                                  uint32_t timeoutMs,
                                  bool *pSessionPresent)
 {
-    (void) pConnectInfo;
     (void) pWillInfo;
     (void) timeoutMs;
 
-    if (!pContext)
+    if (!pContext || !pConnectInfo)
     {
         return MQTTBadParameter;
     }
 
+    bool sessionPresent = false;
+    if (MockCoreMqtt::broker() != nullptr)
+    {
+        MQTTStatus_t status = MockCoreMqtt::broker()->connect(pContext, *pConnectInfo, &sessionPresent);
+        if (status != MQTTSuccess)
+        {
+            return status;
+        }
+    }
+
+    // A new session starts without QoS state
+    if (!sessionPresent)
+    {
+        MockCoreMqtt::clearRecords(pContext);
+    }
+
     pContext->connectStatus = MQTTConnected;
 
     if (pSessionPresent)
     {
-        *pSessionPresent = false;
+        *pSessionPresent = sessionPresent;
     }
 
     return MQTTSuccess;
 }
 
 /**
- * @brief Subscribe to topics (mock - always succeeds)
+ * @brief Subscribe to topics (mock - succeeds unless a broker fails it)
  */
 inline MQTTStatus_t MQTT_Subscribe(MQTTContext_t *pContext,
                                    const MQTTSubscribeInfo_t *pSubscriptionList,
                                    size_t subscriptionCount,
                                    uint16_t packetId)
 {
-    // Mock implementation - just return success
-    (void) pContext;
-    (void) pSubscriptionList;
-    (void) subscriptionCount;
     (void) packetId;
+
+    if (!pContext || !pSubscriptionList)
+    {
+        return MQTTBadParameter;
+    }
+    if (MockCoreMqtt::broker() != nullptr)
+    {
+        return MockCoreMqtt::broker()->subscribe(pContext, pSubscriptionList, subscriptionCount, true);
+    }
     return MQTTSuccess;
 }
 
@@ -258,39 +383,109 @@ inline MQTTStatus_t MQTT_Unsubscribe(MQTTContext_t *pContext,
                                      size_t subscriptionCount,
                                      uint16_t packetId)
 {
-    // Mock implementation - just return success
-    (void) pContext;
-    (void) pSubscriptionList;
-    (void) subscriptionCount;
     (void) packetId;
+
+    if (!pContext || !pSubscriptionList)
+    {
+        return MQTTBadParameter;
+    }
+    if (MockCoreMqtt::broker() != nullptr)
+    {
+        return MockCoreMqtt::broker()->subscribe(pContext, pSubscriptionList, subscriptionCount, false);
+    }
     return MQTTSuccess;
 }
 
 /**
- * @brief Publish message (mock - always succeeds)
+ * @brief Publish message (mock - succeeds unless out of records or a broker fails it)
  */
 inline MQTTStatus_t MQTT_Publish(MQTTContext_t *pContext,
                                  const MQTTPublishInfo_t *pPublishInfo,
                                  uint16_t packetId)
 {
-    (void) pPublishInfo;
-    (void) packetId;
-
-    if (!pContext)
+    if (!pContext || !pPublishInfo)
     {
         return MQTTBadParameter;
     }
 
-    return MQTTSuccess;
+    MockCoreMqtt::Broker *broker = MockCoreMqtt::broker();
+    if (broker == nullptr)
+    {
+        return MQTTSuccess;
+    }
+
+    // Nothing is acknowledged without a broker, so records are only kept with one.
+    // A DUP resend reuses the record of the original publish.
+    MQTTPubAckInfo_t *record = nullptr;
+    if (pPublishInfo->qos != MQTTQoS0 && pContext->outgoingPublishRecordMaxCount > 0)
+    {
+        record = MockCoreMqtt::findRecord(pContext, packetId);
+        if (record == nullptr)
+        {
+            record = MockCoreMqtt::findRecord(pContext, MQTT_PACKET_ID_INVALID);
+            if (record == nullptr)
+            {
+                return MQTTNoMemory;
+            }
+            record->packetId = packetId;
+        }
+        record->publishState = pPublishInfo->qos == MQTTQoS1 ? MQTTPubAckPending : MQTTPubRecPending;
+    }
+
+    MQTTStatus_t status = broker->publish(pContext, *pPublishInfo, packetId);
+    if (status != MQTTSuccess && record != nullptr)
+    {
+        *record = MQTTPubAckInfo_t{};
+    }
+    return status;
 }
 
 /**
- * @brief Process loop (mock - no-op)
+ * @brief Process loop (mock - reads at most one packet from the broker, if any)
  */
 inline MQTTStatus_t MQTT_ProcessLoop(MQTTContext_t *pContext)
 {
-    // Mock implementation - just return success
-    (void) pContext;
+    if (!pContext)
+    {
+        return MQTTBadParameter;
+    }
+
+    MockCoreMqtt::Broker *broker = MockCoreMqtt::broker();
+    if (broker == nullptr)
+    {
+        return MQTTSuccess;
+    }
+
+    MQTTPacketInfo_t packet = {};
+    MQTTPublishInfo_t publish = {};
+    MQTTDeserializedInfo_t info = {};
+    info.pPublishInfo = &publish;
+    MQTTStatus_t status = broker->receive(pContext, &packet, &info);
+    if (status == MQTTNoDataAvailable)
+    {
+        return MQTTSuccess;
+    }
+    if (status != MQTTSuccess)
+    {
+        pContext->connectStatus = MQTTNotConnected;
+        return status;
+    }
+
+    // The record is freed before the application hears of the acknowledgement
+    if (packet.type == MQTT_PACKET_TYPE_PUBACK || packet.type == MQTT_PACKET_TYPE_PUBCOMP)
+    {
+        MQTTPubAckInfo_t *record = MockCoreMqtt::findRecord(pContext, info.packetIdentifier);
+        if (record != nullptr)
+        {
+            *record = MQTTPubAckInfo_t{};
+        }
+    }
+
+    info.packetInfo = packet;
+    if (pContext->appCallback != nullptr)
+    {
+        pContext->appCallback(pContext, &packet, &info);
+    }
     return MQTTSuccess;
 }
 
@@ -304,6 +499,10 @@ inline MQTTStatus_t MQTT_Disconnect(MQTTContext_t *pContext)
         return MQTTBadParameter;
     }
 
+    if (MockCoreMqtt::broker() != nullptr)
+    {
+        MockCoreMqtt::broker()->disconnect(pContext);
+    }
     pContext->connectStatus = MQTTNotConnected;
     return MQTTSuccess;
 }
@@ -318,7 +517,13 @@ inline uint16_t MQTT_GetPacketId(MQTTContext_t *pContext)
         return 0;
     }
 
-    return pContext->nextPacketId++;
+    // Never MQTT_PACKET_ID_INVALID, as in the real library
+    uint16_t packetId = pContext->nextPacketId++;
+    if (pContext->nextPacketId == MQTT_PACKET_ID_INVALID)
+    {
+        pContext->nextPacketId = 1;
+    }
+    return packetId == MQTT_PACKET_ID_INVALID ? MQTT_GetPacketId(pContext) : packetId;
 }
 
 /**
@@ -0,0 +1,467 @@
+/**
+ * @file core_mqtt_agent.h
+ * @brief Mock coreMQTT-Agent API for host testing
+ *
+ * Keeps the parts of the real library a client depends on: commands are
+ * taken from the application's pool, sent through its queue and completed
+ * by MQTTAgent_CommandLoop() on the agent thread, and MQTTAgent_CancelAll()
+ * completes whatever is left with an error. Nothing goes on the wire;
+ * MockMqttAgent records what the loop ran and lets a test pause the loop,
+ * hold acknowledgements, deliver inbound publishes or drop the connection.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core_mqtt.h"
+
+// The client includes this inside extern "C"
+extern "C++" {
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Left to the application, as in the real library
+typedef struct MQTTAgentMessageContext MQTTAgentMessageContext_t;
+typedef struct MQTTAgentCommandContext MQTTAgentCommandContext_t;
+
+typedef enum MQTTAgentCommandType
+{
+    NONE = 0,
+    PROCESSLOOP,
+    PUBLISH,
+    SUBSCRIBE,
+    UNSUBSCRIBE,
+    PING,
+    CONNECT,
+    DISCONNECT,
+    TERMINATE,
+    NUM_COMMANDS
+} MQTTAgentCommandType_t;
+
+typedef struct MQTTAgentReturnInfo
+{
+    MQTTStatus_t returnCode;
+    uint8_t *pSubackCodes;
+} MQTTAgentReturnInfo_t;
+
+typedef void (*MQTTAgentCommandCallback_t)(MQTTAgentCommandContext_t *pCmdCallbackContext,
+                                           MQTTAgentReturnInfo_t *pReturnInfo);
+
+typedef struct MQTTAgentCommand
+{
+    MQTTAgentCommandType_t commandType;
+    void *pArgs;
+    MQTTAgentCommandCallback_t pCommandCompleteCallback;
+    MQTTAgentCommandContext_t *pCmdContext;
+} MQTTAgentCommand_t;
+
+typedef struct MQTTAgentCommandInfo
+{
+    MQTTAgentCommandCallback_t cmdCompleteCallback;
+    MQTTAgentCommandContext_t *pCmdCompleteCallbackContext;
+    uint32_t blockTimeMs;
+} MQTTAgentCommandInfo_t;
+
+typedef struct MQTTAgentSubscribeArgs
+{
+    MQTTSubscribeInfo_t *pSubscribeInfo;
+    size_t numSubscriptions;
+} MQTTAgentSubscribeArgs_t;
+
+typedef bool (*MQTTAgentMessageSend_t)(MQTTAgentMessageContext_t *pMsgCtx,
+                                       MQTTAgentCommand_t *const *pCommandToSend,
+                                       uint32_t blockTimeMs);
+typedef bool (*MQTTAgentMessageRecv_t)(MQTTAgentMessageContext_t *pMsgCtx,
+                                       MQTTAgentCommand_t **pReceivedCommand,
+                                       uint32_t blockTimeMs);
+typedef MQTTAgentCommand_t *(*MQTTAgentCommandGet_t)(uint32_t blockTimeMs);
+typedef bool (*MQTTAgentCommandRelease_t)(MQTTAgentCommand_t *pCommandToRelease);
+
+typedef struct MQTTAgentMessageInterface
+{
+    MQTTAgentMessageContext_t *pMsgCtx;
+    MQTTAgentMessageSend_t send;
+    MQTTAgentMessageRecv_t recv;
+    MQTTAgentCommandGet_t getCommand;
+    MQTTAgentCommandRelease_t releaseCommand;
+} MQTTAgentMessageInterface_t;
+
+struct MQTTAgentContext;
+
+typedef void (*MQTTAgentIncomingPublishCallback_t)(struct MQTTAgentContext *pMqttAgentContext,
+                                                   uint16_t packetId,
+                                                   MQTTPublishInfo_t *pPublishInfo);
+
+typedef struct MQTTAgentContext
+{
+    MQTTContext_t mqttContext;
+    MQTTAgentMessageInterface_t agentInterface;
+    MQTTAgentIncomingPublishCallback_t pIncomingCallback;
+    void *pIncomingCallbackContext;
+} MQTTAgentContext_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+extern "C++" {
+namespace MockMqttAgent
+{
+
+/**
+ * @brief A command the loop ran (or holds, awaiting an acknowledgement)
+ */
+struct Record
+{
+    MQTTAgentCommandType_t type;
+    std::string topic; ///< Publish topic, or the first filter
+    std::vector<uint8_t> payload;
+    MQTTQoS_t qos;
+};
+
+/**
+ * @brief Shared by every agent context; reset() between tests
+ */
+struct State
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool paused = false;                      ///< Loop leaves the queue alone
+    bool holdAcks = false;                    ///< QoS 1/2 publishes and (un)subscribes wait for acknowledge()
+    bool acknowledged = false;                ///< Loop completes the held commands
+    MQTTStatus_t dropWith = MQTTSuccess;      ///< Loop returns this once, as on a lost connection
+    MQTTStatus_t commandResult = MQTTSuccess; ///< Completion status of executed commands
+    uint32_t submitted = 0;                   ///< Commands queued by MQTTAgent_*()
+    std::vector<Record> ran;                  ///< Commands executed, in order
+    std::vector<MQTTAgentCommand_t *> awaitingAck;
+    std::deque<Record> inbound; ///< Publishes for the loop to deliver
+};
+
+inline State &state()
+{
+    static State s;
+    return s;
+}
+
+inline void reset()
+{
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.paused = false;
+    s.holdAcks = false;
+    s.acknowledged = false;
+    s.dropWith = MQTTSuccess;
+    s.commandResult = MQTTSuccess;
+    s.submitted = 0;
+    s.ran.clear();
+    s.awaitingAck.clear();
+    s.inbound.clear();
+}
+
+inline void setPaused(bool paused)
+{
+    std::lock_guard<std::mutex> lock(state().mutex);
+    state().paused = paused;
+    state().changed.notify_all();
+}
+
+inline void setHoldAcks(bool hold)
+{
+    std::lock_guard<std::mutex> lock(state().mutex);
+    state().holdAcks = hold;
+}
+
+/**
+ * @brief Let the loop complete every held command, as if the acknowledgements arrived
+ */
+inline void acknowledge()
+{
+    std::lock_guard<std::mutex> lock(state().mutex);
+    state().acknowledged = true;
+    state().changed.notify_all();
+}
+
+/**
+ * @brief Make the loop return status, as if the connection failed
+ */
+inline void dropConnection(MQTTStatus_t status)
+{
+    std::lock_guard<std::mutex> lock(state().mutex);
+    state().dropWith = status;
+    state().changed.notify_all();
+}
+
+/**
+ * @brief Queue a PUBLISH from the broker
+ */
+inline void deliver(const std::string &topic, const std::vector<uint8_t> &payload)
+{
+    std::lock_guard<std::mutex> lock(state().mutex);
+    state().inbound.push_back(Record{PUBLISH, topic, payload, MQTTQoS0});
+    state().changed.notify_all();
+}
+
+inline uint32_t submitted()
+{
+    std::lock_guard<std::mutex> lock(state().mutex);
+    return state().submitted;
+}
+
+inline size_t awaitingAck()
+{
+    std::lock_guard<std::mutex> lock(state().mutex);
+    return state().awaitingAck.size();
+}
+
+inline std::vector<Record> ran()
+{
+    std::lock_guard<std::mutex> lock(state().mutex);
+    return state().ran;
+}
+
+/**
+ * @brief Complete a command and return it to the pool, as the real agent does
+ */
+inline void conclude(const MQTTAgentContext_t *context, MQTTAgentCommand_t *command, MQTTStatus_t status)
+{
+    if (command->pCommandCompleteCallback != nullptr)
+    {
+        MQTTAgentReturnInfo_t returnInfo{status, nullptr};
+        command->pCommandCompleteCallback(command->pCmdContext, &returnInfo);
+    }
+    context->agentInterface.releaseCommand(command);
+}
+
+/**
+ * @brief Complete every command held for an acknowledgement with status
+ */
+inline void concludeHeld(const MQTTAgentContext_t *context, MQTTStatus_t status)
+{
+    std::vector<MQTTAgentCommand_t *> held;
+    {
+        std::lock_guard<std::mutex> lock(state().mutex);
+        held.swap(state().awaitingAck);
+    }
+    for (MQTTAgentCommand_t *command : held)
+    {
+        conclude(context, command, status);
+    }
+}
+
+inline MQTTStatus_t addCommand(const MQTTAgentContext_t *context,
+                               MQTTAgentCommandType_t type,
+                               void *args,
+                               const MQTTAgentCommandInfo_t *commandInfo)
+{
+    if (context == nullptr || commandInfo == nullptr)
+    {
+        return MQTTBadParameter;
+    }
+
+    MQTTAgentCommand_t *command = context->agentInterface.getCommand(commandInfo->blockTimeMs);
+    if (command == nullptr)
+    {
+        return MQTTNoMemory;
+    }
+    command->commandType = type;
+    command->pArgs = args;
+    command->pCommandCompleteCallback = commandInfo->cmdCompleteCallback;
+    command->pCmdContext = commandInfo->pCmdCompleteCallbackContext;
+
+    if (!context->agentInterface.send(context->agentInterface.pMsgCtx, &command, commandInfo->blockTimeMs))
+    {
+        context->agentInterface.releaseCommand(command);
+        return MQTTSendFailed;
+    }
+    std::lock_guard<std::mutex> lock(state().mutex);
+    state().submitted++;
+    return MQTTSuccess;
+}
+
+} // namespace MockMqttAgent
+}
+
+inline MQTTStatus_t MQTTAgent_Init(MQTTAgentContext_t *pMqttAgentContext,
+                                   const MQTTAgentMessageInterface_t *pMsgInterface,
+                                   const MQTTFixedBuffer_t *pNetworkBuffer,
+                                   const TransportInterface_t *pTransportInterface,
+                                   MQTTGetCurrentTimeFunc_t getCurrentTimeMs,
+                                   MQTTAgentIncomingPublishCallback_t incomingCallback,
+                                   void *pIncomingPacketContext)
+{
+    if (pMqttAgentContext == nullptr || pMsgInterface == nullptr || pNetworkBuffer == nullptr ||
+        pNetworkBuffer->pBuffer == nullptr || pMsgInterface->getCommand == nullptr)
+    {
+        return MQTTBadParameter;
+    }
+    pMqttAgentContext->agentInterface = *pMsgInterface;
+    pMqttAgentContext->pIncomingCallback = incomingCallback;
+    pMqttAgentContext->pIncomingCallbackContext = pIncomingPacketContext;
+    return MQTT_Init(&pMqttAgentContext->mqttContext, pTransportInterface, getCurrentTimeMs, nullptr,
+                     pNetworkBuffer);
+}
+
+/**
+ * @brief Run commands until DISCONNECT or TERMINATE, or until dropConnection()
+ */
+inline MQTTStatus_t MQTTAgent_CommandLoop(MQTTAgentContext_t *pMqttAgentContext)
+{
+    MockMqttAgent::State &s = MockMqttAgent::state();
+    uint16_t packetId = 1;
+    while (true)
+    {
+        std::deque<MockMqttAgent::Record> inbound;
+        bool acknowledged;
+        {
+            std::unique_lock<std::mutex> lock(s.mutex);
+            s.changed.wait_for(lock, std::chrono::milliseconds(5), [&s] {
+                return !s.paused || s.acknowledged || s.dropWith != MQTTSuccess || !s.inbound.empty();
+            });
+            if (s.dropWith != MQTTSuccess)
+            {
+                MQTTStatus_t status = s.dropWith;
+                s.dropWith = MQTTSuccess;
+                pMqttAgentContext->mqttContext.connectStatus = MQTTNotConnected;
+                return status;
+            }
+            inbound.swap(s.inbound);
+            acknowledged = s.acknowledged;
+            s.acknowledged = false;
+        }
+        if (acknowledged)
+        {
+            MockMqttAgent::concludeHeld(pMqttAgentContext, MQTTSuccess);
+        }
+
+        for (MockMqttAgent::Record &message : inbound)
+        {
+            MQTTPublishInfo_t publishInfo = {};
+            publishInfo.qos = message.qos;
+            publishInfo.pTopicName = message.topic.c_str();
+            publishInfo.topicNameLength = static_cast<uint16_t>(message.topic.size());
+            publishInfo.pPayload = message.payload.data();
+            publishInfo.payloadLength = message.payload.size();
+            pMqttAgentContext->pIncomingCallback(pMqttAgentContext, packetId++, &publishInfo);
+        }
+
+        MQTTAgentCommand_t *command = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (s.paused)
+            {
+                continue;
+            }
+        }
+        if (!pMqttAgentContext->agentInterface.recv(pMqttAgentContext->agentInterface.pMsgCtx, &command, 5))
+        {
+            continue;
+        }
+
+        MockMqttAgent::Record record{command->commandType, std::string(), {}, MQTTQoS0};
+        bool awaitsAck = false;
+        if (command->commandType == PUBLISH)
+        {
+            const MQTTPublishInfo_t *publishInfo = static_cast<const MQTTPublishInfo_t *>(command->pArgs);
+            const uint8_t *payload = static_cast<const uint8_t *>(publishInfo->pPayload);
+            record.topic.assign(publishInfo->pTopicName, publishInfo->topicNameLength);
+            record.payload.assign(payload, payload + publishInfo->payloadLength);
+            record.qos = publishInfo->qos;
+            awaitsAck = publishInfo->qos != MQTTQoS0;
+        }
+        else if (command->commandType == SUBSCRIBE || command->commandType == UNSUBSCRIBE)
+        {
+            const MQTTAgentSubscribeArgs_t *args = static_cast<const MQTTAgentSubscribeArgs_t *>(command->pArgs);
+            record.topic.assign(args->pSubscribeInfo[0].pTopicFilter, args->pSubscribeInfo[0].topicFilterLength);
+            awaitsAck = true;
+        }
+
+        MQTTStatus_t result;
+        bool hold;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.ran.push_back(record);
+            result = s.commandResult;
+            hold = awaitsAck && s.holdAcks;
+            if (hold)
+            {
+                s.awaitingAck.push_back(command);
+            }
+        }
+        if (hold)
+        {
+            continue;
+        }
+
+        MockMqttAgent::conclude(pMqttAgentContext, command, result);
+        if (record.type == DISCONNECT || record.type == TERMINATE)
+        {
+            pMqttAgentContext->mqttContext.connectStatus = MQTTNotConnected;
+            return MQTTSuccess;
+        }
+    }
+}
+
+inline MQTTStatus_t MQTTAgent_ResumeSession(MQTTAgentContext_t *pMqttAgentContext, bool sessionPresent)
+{
+    (void) pMqttAgentContext;
+    (void) sessionPresent;
+    return MQTTSuccess;
+}
+
+/**
+ * @brief Complete every queued and unacknowledged command with MQTTRecvFailed
+ */
+inline MQTTStatus_t MQTTAgent_CancelAll(MQTTAgentContext_t *pMqttAgentContext)
+{
+    MockMqttAgent::concludeHeld(pMqttAgentContext, MQTTRecvFailed);
+    MQTTAgentCommand_t *command = nullptr;
+    while (pMqttAgentContext->agentInterface.recv(pMqttAgentContext->agentInterface.pMsgCtx, &command, 0))
+    {
+        MockMqttAgent::conclude(pMqttAgentContext, command, MQTTRecvFailed);
+    }
+    return MQTTSuccess;
+}
+
+inline MQTTStatus_t MQTTAgent_Publish(const MQTTAgentContext_t *pMqttAgentContext,
+                                      MQTTPublishInfo_t *pPublishInfo,
+                                      const MQTTAgentCommandInfo_t *pCommandInfo)
+{
+    return MockMqttAgent::addCommand(pMqttAgentContext, PUBLISH, pPublishInfo, pCommandInfo);
+}
+
+inline MQTTStatus_t MQTTAgent_Subscribe(const MQTTAgentContext_t *pMqttAgentContext,
+                                        MQTTAgentSubscribeArgs_t *pSubscriptionArgs,
+                                        const MQTTAgentCommandInfo_t *pCommandInfo)
+{
+    return MockMqttAgent::addCommand(pMqttAgentContext, SUBSCRIBE, pSubscriptionArgs, pCommandInfo);
+}
+
+inline MQTTStatus_t MQTTAgent_Unsubscribe(const MQTTAgentContext_t *pMqttAgentContext,
+                                          MQTTAgentSubscribeArgs_t *pSubscriptionArgs,
+                                          const MQTTAgentCommandInfo_t *pCommandInfo)
+{
+    return MockMqttAgent::addCommand(pMqttAgentContext, UNSUBSCRIBE, pSubscriptionArgs, pCommandInfo);
+}
+
+inline MQTTStatus_t MQTTAgent_Disconnect(const MQTTAgentContext_t *pMqttAgentContext,
+                                         const MQTTAgentCommandInfo_t *pCommandInfo)
+{
+    return MockMqttAgent::addCommand(pMqttAgentContext, DISCONNECT, nullptr, pCommandInfo);
+}
+
+inline MQTTStatus_t MQTTAgent_Terminate(const MQTTAgentContext_t *pMqttAgentContext,
+                                        const MQTTAgentCommandInfo_t *pCommandInfo)
+{
+    return MockMqttAgent::addCommand(pMqttAgentContext, TERMINATE, nullptr, pCommandInfo);
+}
@@ -9,16 +9,48 @@
 
 #include "esp_err.h"
 
+// Included inside extern "C" by some headers
+extern "C++" {
+#include <functional>
+
+namespace MockEspTimer
+{
+
+/**
+ * @brief Replacement clock for esp_timer_get_time(), e.g. a simulation's virtual time
+ */
+inline std::function<int64_t()> &source()
+{
+    static std::function<int64_t()> clock;
+    return clock;
+}
+
+/**
+ * @brief Use clock for esp_timer_get_time(); an empty function restores the default
+ */
+inline void setSource(std::function<int64_t()> clock)
+{
+    source() = std::move(clock);
+}
+
+} // namespace MockEspTimer
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
  * @brief Get time since boot in microseconds
- * @return Time in microseconds (mock returns incrementing value)
+ * @return Time in microseconds (mock returns incrementing value unless a source is set)
  */
 inline int64_t esp_timer_get_time(void)
 {
+    if (MockEspTimer::source())
+    {
+        return MockEspTimer::source()();
+    }
+
     // Simple mock: return a fixed value or use system time
     static int64_t mock_time = 0;
     return mock_time += 1000; // Increment by 1ms each call
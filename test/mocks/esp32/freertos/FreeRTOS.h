@@ -29,6 +29,7 @@ typedef uint32_t UBaseType_t;
 #define portTICK_PERIOD_MS 1
 #define pdMS_TO_TICKS(ms) ((TickType_t) (ms))
 #define pdTICKS_TO_MS(ticks) ((TickType_t) (ticks))
+#define portMAX_DELAY ((TickType_t) 0xffffffffUL)
 
 // Task priorities
 #define tskIDLE_PRIORITY 0
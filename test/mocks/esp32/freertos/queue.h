@@ -0,0 +1,110 @@
+/**
+ * @file queue.h
+ * @brief Mock FreeRTOS queue API for host testing
+ *
+ * Unlike the task and timer mocks these queues really block: items are
+ * copied by value into a std::deque guarded by a mutex, and senders and
+ * receivers wait on a condition variable for up to their timeout.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "FreeRTOS.h"
+
+namespace MockFreeRTOS
+{
+struct MockQueue
+{
+    MockQueue(UBaseType_t length, UBaseType_t itemSize) : length(length), itemSize(itemSize)
+    {
+    }
+
+    /**
+     * @brief Wait until ready() holds, for up to ticks (portMAX_DELAY = forever)
+     */
+    template<typename Ready>
+    bool wait(std::unique_lock<std::mutex> &lock, TickType_t ticks, Ready ready)
+    {
+        if (ticks == portMAX_DELAY)
+        {
+            changed.wait(lock, ready);
+            return true;
+        }
+        return changed.wait_for(lock, std::chrono::milliseconds(pdTICKS_TO_MS(ticks)), ready);
+    }
+
+    const UBaseType_t length;
+    const UBaseType_t itemSize;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t>> items;
+};
+} // namespace MockFreeRTOS
+
+typedef MockFreeRTOS::MockQueue *QueueHandle_t;
+
+/**
+ * @brief Create a queue of length items of itemSize bytes
+ */
+inline QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+    return new MockFreeRTOS::MockQueue(uxQueueLength, uxItemSize);
+}
+
+inline void vQueueDelete(QueueHandle_t xQueue)
+{
+    delete xQueue;
+}
+
+/**
+ * @brief Copy an item to the back, waiting up to xTicksToWait for space
+ */
+inline BaseType_t xQueueSendToBack(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+    std::unique_lock<std::mutex> lock(xQueue->mutex);
+    if (!xQueue->wait(lock, xTicksToWait, [xQueue] { return xQueue->items.size() < xQueue->length; }))
+    {
+        return pdFAIL;
+    }
+    const uint8_t *item = static_cast<const uint8_t *>(pvItemToQueue);
+    xQueue->items.emplace_back(item, item + xQueue->itemSize);
+    xQueue->changed.notify_all();
+    return pdPASS;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+    return xQueueSendToBack(xQueue, pvItemToQueue, xTicksToWait);
+}
+
+/**
+ * @brief Copy the front item out, waiting up to xTicksToWait for one
+ */
+inline BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+    std::unique_lock<std::mutex> lock(xQueue->mutex);
+    if (!xQueue->wait(lock, xTicksToWait, [xQueue] { return !xQueue->items.empty(); }))
+    {
+        return pdFAIL;
+    }
+    if (xQueue->itemSize > 0)
+    {
+        std::memcpy(pvBuffer, xQueue->items.front().data(), xQueue->itemSize);
+    }
+    xQueue->items.pop_front();
+    xQueue->changed.notify_all();
+    return pdPASS;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue)
+{
+    std::lock_guard<std::mutex> lock(xQueue->mutex);
+    return static_cast<UBaseType_t>(xQueue->items.size());
+}
@@ -0,0 +1,56 @@
+/**
+ * @file semphr.h
+ * @brief Mock FreeRTOS semaphore API for host testing
+ *
+ * Binary semaphores are length-1 queues of empty items, as in FreeRTOS,
+ * so a take really blocks until another thread gives.
+ */
+
+#pragma once
+
+#include "queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+/**
+ * @brief Storage for a static semaphore; unused by the mock, which allocates
+ */
+typedef struct
+{
+    uint8_t unused;
+} StaticSemaphore_t;
+
+/**
+ * @brief Create a binary semaphore, initially taken
+ */
+inline SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return xQueueCreate(1, 0);
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *pxSemaphoreBuffer)
+{
+    (void) pxSemaphoreBuffer;
+    return xSemaphoreCreateBinary();
+}
+
+/**
+ * @brief Give the semaphore; fails if it is already given
+ */
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore)
+{
+    return xQueueSendToBack(xSemaphore, nullptr, 0);
+}
+
+/**
+ * @brief Take the semaphore, waiting up to xBlockTime for a give
+ */
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime)
+{
+    return xQueueReceive(xSemaphore, nullptr, xBlockTime);
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t xSemaphore)
+{
+    vQueueDelete(xSemaphore);
+}
@@ -28,6 +28,22 @@ typedef int32_t (*TransportSend_t)(struct NetworkContext *pNetworkContext,
  */
 typedef int32_t (*TransportRecv_t)(struct NetworkContext *pNetworkContext, void *pBuffer, size_t bytesToRecv);
 
+/**
+ * @brief One buffer of a vectored send
+ */
+typedef struct TransportOutVector
+{
+    const void *iov_base;
+    size_t iov_len;
+} TransportOutVector_t;
+
+/**
+ * @brief Transport vectored send function pointer (optional)
+ */
+typedef int32_t (*TransportWritev_t)(struct NetworkContext *pNetworkContext,
+                                     TransportOutVector_t *pIoVec,
+                                     size_t ioVecCount);
+
 // NetworkContext_t is just an alias - actual definition comes from application
 typedef struct NetworkContext NetworkContext_t;
 
@@ -38,6 +54,7 @@ typedef struct TransportInterface
 {
     TransportRecv_t recv;
     TransportSend_t send;
+    TransportWritev_t writev;
     NetworkContext_t *pNetworkContext;
 } TransportInterface_t;
 
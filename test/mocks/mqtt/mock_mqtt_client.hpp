@@ -0,0 +1,216 @@
+/**
+ * @file mock_mqtt_client.hpp
+ * @brief Mock IMqttClient for testing client decorators
+ *
+ * Records publishes and subscriptions instead of talking to a broker,
+ * and lets a test inject inbound messages through the subscribed
+ * callbacks.
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "lopcore/mqtt/imqtt_client.hpp"
+#include "lopcore/mqtt/mqtt_topic_table.hpp"
+#include "lopcore/mqtt/topic_trie.hpp"
+
+namespace lopcore
+{
+namespace test
+{
+
+/**
+ * @brief IMqttClient that records what it is asked to do
+ *
+ * Usage:
+ * @code
+ * auto mock = std::make_shared<MockMqttClient>();
+ * mock->publishResult = ESP_ERR_NO_MEM; // Simulate an exhausted budget
+ * decorator.publishString("a/b", "x");
+ * EXPECT_EQ(mock->takePublished().size(), 1u);
+ * @endcode
+ */
+class MockMqttClient : public mqtt::IMqttClient
+{
+public:
+    esp_err_t publish(const std::string &topic,
+                      const std::vector<uint8_t> &payload,
+                      mqtt::MqttQos qos,
+                      bool retain) override
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (publishResult == ESP_OK)
+        {
+            mqtt::MqttMessage message;
+            message.topic = topic;
+            message.payload = payload;
+            message.qos = qos;
+            message.retained = retain;
+            message.messageId = 0;
+            published_.push_back(std::move(message));
+        }
+        return publishResult;
+    }
+
+    esp_err_t publishString(const std::string &topic,
+                            const std::string &payload,
+                            mqtt::MqttQos qos,
+                            bool retain) override
+    {
+        return publish(topic, std::vector<uint8_t>(payload.begin(), payload.end()), qos, retain);
+    }
+
+    mqtt::TopicHandle registerTopic(std::string_view topic) override
+    {
+        return topics_.intern(topic);
+    }
+
+    std::string_view topicName(mqtt::TopicHandle topic) const override
+    {
+        const std::string *name = topics_.lookup(topic);
+        return name != nullptr ? std::string_view(*name) : std::string_view();
+    }
+
+    esp_err_t subscribe(const std::string &topic, MessageCallback callback, mqtt::MqttQos) override
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return subscriptions_.insert(topic, [callback = std::move(callback)](const mqtt::MqttMessageView &view) {
+            callback(view.toMessage());
+        });
+    }
+
+    esp_err_t subscribeView(const std::string &topic, mqtt::MessageViewCallback callback, mqtt::MqttQos) override
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return subscriptions_.insert(topic, std::move(callback));
+    }
+
+    esp_err_t unsubscribe(const std::string &topic) override
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return subscriptions_.erase(topic) ? ESP_OK : ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t connect() override
+    {
+        return ESP_OK;
+    }
+
+    esp_err_t disconnect() override
+    {
+        return ESP_OK;
+    }
+
+    bool isConnected() const override
+    {
+        return true;
+    }
+
+    mqtt::MqttConnectionState getConnectionState() const override
+    {
+        return mqtt::MqttConnectionState::CONNECTED;
+    }
+
+    void setConnectionCallback(ConnectionCallback) override
+    {
+    }
+
+    void setErrorCallback(ErrorCallback) override
+    {
+    }
+
+    esp_err_t setWillMessage(const std::string &, const std::vector<uint8_t> &, mqtt::MqttQos, bool) override
+    {
+        return ESP_OK;
+    }
+
+    mqtt::MqttStatistics getStatistics() const override
+    {
+        return mqtt::MqttStatistics{};
+    }
+
+    void resetStatistics() override
+    {
+    }
+
+    std::string getClientId() const override
+    {
+        return "mock";
+    }
+
+    std::string getBroker() const override
+    {
+        return "localhost";
+    }
+
+    uint16_t getPort() const override
+    {
+        return 1883;
+    }
+
+    // =============================================================================
+    // Test helpers
+    // =============================================================================
+
+    /**
+     * @brief Publishes recorded since the last call
+     */
+    std::vector<mqtt::MqttMessage> takePublished()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<mqtt::MqttMessage> out;
+        out.swap(published_);
+        return out;
+    }
+
+    /**
+     * @brief Deliver an inbound message to every matching subscription
+     *
+     * subscribeView() callbacks see payload's own bytes, like a client
+     * handing out its receive buffer.
+     *
+     * @return Number of callbacks called
+     */
+    size_t inject(const std::string &topic, const std::vector<uint8_t> &payload)
+    {
+        mqtt::MqttMessageView view{topic, payload.data(), payload.size(), mqtt::MqttQos::AT_MOST_ONCE, false, 0};
+
+        std::vector<mqtt::MessageViewCallback> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            subscriptions_.match(
+                topic, [&callbacks](mqtt::MessageViewCallback &callback) { callbacks.push_back(callback); });
+        }
+        for (const mqtt::MessageViewCallback &callback : callbacks)
+        {
+            callback(view);
+        }
+        return callbacks.size();
+    }
+
+    /**
+     * @brief Whether a filter is currently subscribed
+     */
+    bool isSubscribed(const std::string &filter)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return subscriptions_.find(filter) != nullptr;
+    }
+
+    esp_err_t publishResult{ESP_OK}; ///< Returned by every publish
+
+private:
+    std::mutex mutex_;
+    std::vector<mqtt::MqttMessage> published_;
+    mqtt::TopicTrie<mqtt::MessageViewCallback> subscriptions_;
+    mqtt::MqttTopicTable topics_{8};
+};
+
+} // namespace test
+} // namespace lopcore
@@ -21,8 +21,8 @@
 #include <queue>
 #include <vector>
 
-#include "tls/tls_config.hpp"
-#include "tls/tls_transport.hpp"
+#include "lopcore/tls/tls_config.hpp"
+#include "lopcore/tls/tls_transport.hpp"
 
 namespace lopcore
 {
@@ -0,0 +1,274 @@
+/**
+ * @file test_bootstrap.cpp
+ * @brief Unit tests for dependency-ordered parallel start-up
+ */
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/boot/bootstrap.hpp"
+
+using namespace lopcore::boot;
+
+namespace
+{
+
+std::atomic<int64_t> fakeNowUs{0};
+
+int64_t fakeTime()
+{
+    return fakeNowUs.load();
+}
+
+/**
+ * @brief Records the order steps ran in
+ */
+class Trace
+{
+public:
+    Bootstrap::StepFunction step(const std::string &name, esp_err_t result = ESP_OK)
+    {
+        return [this, name, result] {
+            std::lock_guard<std::mutex> lock(mutex_);
+            order_.push_back(name);
+            return result;
+        };
+    }
+
+    std::vector<std::string> order()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return order_;
+    }
+
+    size_t indexOf(const std::string &name)
+    {
+        auto order = this->order();
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            if (order[i] == name)
+            {
+                return i;
+            }
+        }
+        return SIZE_MAX;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::string> order_;
+};
+
+BootstrapConfig quiet(uint32_t maxParallel = 3)
+{
+    BootstrapConfig config;
+    config.maxParallel = maxParallel;
+    config.logReport = false;
+    return config;
+}
+
+StepState stateOf(const Bootstrap &boot, const std::string &name)
+{
+    for (const auto &phase : boot.report())
+    {
+        if (phase.name == name)
+        {
+            return phase.state;
+        }
+    }
+    return StepState::PENDING;
+}
+
+} // namespace
+
+TEST(BootstrapTest, RunsStepsAfterTheirDependencies)
+{
+    Trace trace;
+    Bootstrap boot(quiet());
+    boot.add("mqtt", trace.step("mqtt")).after({"wifi", "ca"});
+    boot.add("ca", trace.step("ca")).after({"spiffs"});
+    boot.add("spiffs", trace.step("spiffs"));
+    boot.add("wifi", trace.step("wifi"));
+
+    ASSERT_EQ(boot.run(), ESP_OK);
+
+    ASSERT_EQ(trace.order().size(), 4u);
+    EXPECT_LT(trace.indexOf("spiffs"), trace.indexOf("ca"));
+    EXPECT_LT(trace.indexOf("ca"), trace.indexOf("mqtt"));
+    EXPECT_LT(trace.indexOf("wifi"), trace.indexOf("mqtt"));
+    for (const auto &phase : boot.report())
+    {
+        EXPECT_EQ(phase.state, StepState::DONE) << phase.name;
+    }
+}
+
+TEST(BootstrapTest, IndependentStepsOverlap)
+{
+    // Each step only succeeds if the other is running at the same time
+    std::atomic<int> inside{0};
+    auto rendezvous = [&inside] {
+        inside++;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (inside.load() < 2 && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return inside.load() >= 2 ? ESP_OK : ESP_ERR_TIMEOUT;
+    };
+
+    Bootstrap boot(quiet());
+    boot.add("wifi", rendezvous);
+    boot.add("spiffs", rendezvous);
+
+    EXPECT_EQ(boot.run(), ESP_OK);
+}
+
+TEST(BootstrapTest, ZeroParallelRunsInlineOnCaller)
+{
+    std::thread::id caller = std::this_thread::get_id();
+    std::vector<std::thread::id> ranOn;
+    Bootstrap boot(quiet(0));
+    boot.add("a", [&] {
+        ranOn.push_back(std::this_thread::get_id());
+        return ESP_OK;
+    });
+    boot.add("b", [&] {
+        ranOn.push_back(std::this_thread::get_id());
+        return ESP_OK;
+    }).after({"a"});
+
+    ASSERT_EQ(boot.run(), ESP_OK);
+    ASSERT_EQ(ranOn.size(), 2u);
+    EXPECT_EQ(ranOn[0], caller);
+    EXPECT_EQ(ranOn[1], caller);
+}
+
+TEST(BootstrapTest, FailureSkipsDependentsButNotOthers)
+{
+    Trace trace;
+    Bootstrap boot(quiet());
+    boot.add("pkcs11", trace.step("pkcs11", ESP_FAIL));
+    boot.add("mqtt", trace.step("mqtt")).after({"pkcs11"});
+    boot.add("shadow", trace.step("shadow")).after({"mqtt"});
+    boot.add("nvs", trace.step("nvs"));
+
+    EXPECT_EQ(boot.run(), ESP_FAIL);
+
+    EXPECT_EQ(stateOf(boot, "pkcs11"), StepState::FAILED);
+    EXPECT_EQ(stateOf(boot, "mqtt"), StepState::SKIPPED);
+    EXPECT_EQ(stateOf(boot, "shadow"), StepState::SKIPPED);
+    EXPECT_EQ(stateOf(boot, "nvs"), StepState::DONE);
+    EXPECT_EQ(trace.indexOf("mqtt"), SIZE_MAX);
+}
+
+TEST(BootstrapTest, OptionalFailureDoesNotBlock)
+{
+    Trace trace;
+    Bootstrap boot(quiet());
+    boot.add("sntp", trace.step("sntp", ESP_ERR_TIMEOUT)).optional();
+    boot.add("mqtt", trace.step("mqtt")).after({"sntp"});
+
+    EXPECT_EQ(boot.run(), ESP_OK);
+    EXPECT_EQ(stateOf(boot, "sntp"), StepState::FAILED);
+    EXPECT_EQ(stateOf(boot, "mqtt"), StepState::DONE);
+}
+
+TEST(BootstrapTest, LazyStepsWaitForEnsure)
+{
+    int mounts = 0;
+    Trace trace;
+    Bootstrap boot(quiet());
+    boot.add("nvs", trace.step("nvs"));
+    boot.add("spi", trace.step("spi")).lazy();
+    boot.add("sdcard", [&] {
+        mounts++;
+        return ESP_OK;
+    }).after({"spi"}).lazy();
+
+    ASSERT_EQ(boot.run(), ESP_OK);
+    EXPECT_EQ(stateOf(boot, "sdcard"), StepState::DEFERRED);
+    EXPECT_EQ(stateOf(boot, "spi"), StepState::DEFERRED);
+    EXPECT_EQ(mounts, 0);
+
+    EXPECT_EQ(boot.ensure("sdcard"), ESP_OK);
+    EXPECT_EQ(boot.ensure("sdcard"), ESP_OK);
+    EXPECT_EQ(mounts, 1);
+    EXPECT_EQ(stateOf(boot, "spi"), StepState::DONE);
+    EXPECT_EQ(boot.ensure("nope"), ESP_ERR_NOT_FOUND);
+}
+
+TEST(BootstrapTest, LazyDependencyOfEagerStepRuns)
+{
+    Trace trace;
+    Bootstrap boot(quiet());
+    boot.add("pkcs11", trace.step("pkcs11")).lazy();
+    boot.add("mqtt", trace.step("mqtt")).after({"pkcs11"});
+
+    ASSERT_EQ(boot.run(), ESP_OK);
+    EXPECT_EQ(trace.order(), (std::vector<std::string>{"pkcs11", "mqtt"}));
+}
+
+TEST(BootstrapTest, EnsureReportsFailedDependency)
+{
+    Bootstrap boot(quiet());
+    boot.add("spi", [] { return ESP_ERR_NOT_FOUND; }).lazy();
+    boot.add("sdcard", [] { return ESP_OK; }).after({"spi"}).lazy();
+
+    EXPECT_EQ(boot.ensure("sdcard"), ESP_ERR_INVALID_STATE);
+    EXPECT_EQ(stateOf(boot, "sdcard"), StepState::SKIPPED);
+    EXPECT_EQ(boot.ensure("spi"), ESP_ERR_NOT_FOUND);
+}
+
+TEST(BootstrapTest, InvalidGraphRunsNothing)
+{
+    Trace trace;
+    Bootstrap unknown(quiet());
+    unknown.add("a", trace.step("a")).after({"missing"});
+    EXPECT_EQ(unknown.run(), ESP_ERR_INVALID_ARG);
+
+    Bootstrap cycle(quiet());
+    cycle.add("root", trace.step("root"));
+    cycle.add("a", trace.step("a")).after({"b"});
+    cycle.add("b", trace.step("b")).after({"a", "root"});
+    EXPECT_EQ(cycle.run(), ESP_ERR_INVALID_ARG);
+    EXPECT_EQ(cycle.ensure("root"), ESP_ERR_INVALID_ARG);
+
+    Bootstrap duplicate(quiet());
+    duplicate.add("a", trace.step("a"));
+    duplicate.add("a", trace.step("a"));
+    EXPECT_EQ(duplicate.run(), ESP_ERR_INVALID_ARG);
+
+    EXPECT_TRUE(trace.order().empty());
+}
+
+TEST(BootstrapTest, ReportsPhaseTimings)
+{
+    fakeNowUs = 1000000;
+    Bootstrap boot(quiet(0), fakeTime);
+    boot.add("spiffs", [] {
+        fakeNowUs += 300000;
+        return ESP_OK;
+    });
+    boot.add("ca", [] {
+        fakeNowUs += 50000;
+        return ESP_OK;
+    }).after({"spiffs"});
+
+    ASSERT_EQ(boot.run(), ESP_OK);
+
+    auto phases = boot.report();
+    ASSERT_EQ(phases.size(), 2u);
+    EXPECT_EQ(phases[0].name, "spiffs");
+    EXPECT_EQ(phases[0].startUs, 1000000);
+    EXPECT_EQ(phases[0].durationUs, 300000);
+    EXPECT_EQ(phases[1].startUs, 1300000);
+    EXPECT_EQ(phases[1].durationUs, 50000);
+    EXPECT_EQ(boot.totalUs(), 350000);
+    boot.logReport();
+}
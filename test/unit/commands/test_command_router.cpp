@@ -0,0 +1,259 @@
+/**
+ * @file test_command_router.cpp
+ * @brief Unit tests for the command router and its in-place argument parser
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/commands/command_router.hpp"
+#include "mqtt/mock_mqtt_client.hpp"
+
+using namespace lopcore::commands;
+using lopcore::test::MockMqttClient;
+
+namespace
+{
+
+std::vector<uint8_t> bytes(const std::string &text)
+{
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+CommandRouterConfig inlineConfig()
+{
+    CommandRouterConfig config;
+    config.topicPrefix = "dev/cmd";
+    config.dispatch.workers = 0;
+    return config;
+}
+
+} // namespace
+
+TEST(CommandArgsTest, ParsesJsonInPlace)
+{
+    std::string payload = R"( {"on": true, "level": -42, "gain": 1.5e2, "name": "a\"b", "tags": [1, {"x": "]"}],)"
+                          R"( "none": null, "big": 123456789012345678901234} )";
+    CommandArgs args;
+    ASSERT_TRUE(args.parse(payload));
+    EXPECT_FALSE(args.isCbor());
+    ASSERT_EQ(args.size(), 7u);
+
+    EXPECT_EQ(args.getBool("on"), true);
+    EXPECT_EQ(args.getInt("level"), -42);
+    EXPECT_EQ(args.getDouble("level"), -42.0);
+    EXPECT_EQ(args.getDouble("gain"), 150.0);
+    EXPECT_FALSE(args.getInt("gain").has_value());
+    EXPECT_EQ(args.getString("name"), std::string_view("a\\\"b"));
+    EXPECT_TRUE(args.find("name")->escaped);
+    EXPECT_EQ(args.find("tags")->type, ArgType::RAW);
+    EXPECT_EQ(args.find("tags")->text, R"([1, {"x": "]"}])");
+    EXPECT_EQ(args.find("none")->type, ArgType::NULL_VALUE);
+    EXPECT_EQ(args.find("big")->type, ArgType::NUMBER);
+    EXPECT_FALSE(args.getString("missing").has_value());
+
+    // Views point into the payload, not into a copy
+    const char *name = args.getString("name")->data();
+    EXPECT_GE(name, payload.data());
+    EXPECT_LT(name, payload.data() + payload.size());
+}
+
+TEST(CommandArgsTest, ParsesCborMap)
+{
+    // {"on": true, "n": -500, "id": "ab", "f": 1.5 (half), "d": 0.25 (double), "b": h'0102', "a": [1, 2]}
+    const std::vector<uint8_t> payload = {
+        0xA7,                                                       // map(7)
+        0x62, 'o',  'n',  0xF5,                                     // "on": true
+        0x61, 'n',  0x39, 0x01, 0xF3,                               // "n": -500
+        0x62, 'i',  'd',  0x62, 'a',  'b',                          // "id": "ab"
+        0x61, 'f',  0xF9, 0x3E, 0x00,                               // "f": 1.5
+        0x61, 'd',  0xFB, 0x3F, 0xD0, 0x00, 0x00, 0x00, 0x00, 0x00, // "d": 0.25 ...
+        0x00,                                                       // ... (last byte)
+        0x61, 'b',  0x42, 0x01, 0x02,                               // "b": h'0102'
+        0x61, 'a',  0x82, 0x01, 0x02,                               // "a": [1, 2]
+    };
+    CommandArgs args;
+    ASSERT_TRUE(args.parse(payload.data(), payload.size()));
+    EXPECT_TRUE(args.isCbor());
+    ASSERT_EQ(args.size(), 7u);
+
+    EXPECT_EQ(args.getBool("on"), true);
+    EXPECT_EQ(args.getInt("n"), -500);
+    EXPECT_EQ(args.getString("id"), std::string_view("ab"));
+    EXPECT_EQ(args.getDouble("f"), 1.5);
+    EXPECT_EQ(args.getDouble("d"), 0.25);
+    EXPECT_EQ(args.find("b")->type, ArgType::RAW);
+    EXPECT_EQ(args.find("b")->text.size(), 3u);
+    EXPECT_EQ(args.find("a")->text.size(), 3u);
+}
+
+TEST(CommandArgsTest, RejectsMalformedPayloads)
+{
+    CommandArgs args;
+    EXPECT_TRUE(args.parse(""));
+    EXPECT_TRUE(args.parse("  {}  "));
+    EXPECT_TRUE(args.empty());
+
+    EXPECT_FALSE(args.parse("[1, 2]"));
+    EXPECT_FALSE(args.parse(R"({"a": 1,})"));
+    EXPECT_FALSE(args.parse(R"({"a": "open)"));
+    EXPECT_FALSE(args.parse(R"({"a": 1} trailing)"));
+    EXPECT_FALSE(args.parse(R"({"a": tru})"));
+    EXPECT_FALSE(args.parse(R"({"a": [[[[[[[[[1]]]]]]]]]})"));
+
+    std::string many = "{";
+    for (size_t i = 0; i <= CommandArgs::MAX_ARGS; i++)
+    {
+        many += (i ? ",\"k" : "\"k") + std::to_string(i) + "\":1";
+    }
+    EXPECT_FALSE(args.parse(many + "}"));
+
+    const std::vector<uint8_t> truncated = {0xA1, 0x61, 'a', 0x62, 'x'};
+    EXPECT_FALSE(args.parse(truncated.data(), truncated.size()));
+    const std::vector<uint8_t> integerKey = {0xA1, 0x01, 0x02};
+    EXPECT_FALSE(args.parse(integerKey.data(), integerKey.size()));
+    const std::vector<uint8_t> hugeArray = {0xA1, 0x61, 'a', 0x9B, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    EXPECT_FALSE(args.parse(hugeArray.data(), hugeArray.size()));
+}
+
+TEST(CommandRouterTest, SubscribesOnceAndRoutesById)
+{
+    auto mock = std::make_shared<MockMqttClient>();
+    CommandRouter router(mock, inlineConfig());
+
+    std::vector<std::string> calls;
+    for (const char *id : {"zeta", "alpha", "reboot", "set_led"})
+    {
+        ASSERT_EQ(router.on(id,
+                            [&calls](const Command &command) {
+                                calls.push_back(std::string(command.id) + ":" +
+                                                std::to_string(command.args.getInt("n").value_or(-1)));
+                                return ESP_OK;
+                            }),
+                  ESP_OK);
+    }
+    ASSERT_EQ(router.start(), ESP_OK);
+    EXPECT_TRUE(mock->isSubscribed("dev/cmd/+"));
+    EXPECT_EQ(router.topicFilter(), "dev/cmd/+");
+
+    EXPECT_EQ(mock->inject("dev/cmd/set_led", bytes(R"({"n": 3})")), 1u);
+    mock->inject("dev/cmd/alpha", {});
+    mock->inject("dev/cmd/zeta", bytes(R"({"n": 1})"));
+    mock->inject("dev/cmd/unknown", bytes(R"({"n": 2})"));
+    mock->inject("dev/cmd/reboot", bytes("not json"));
+
+    EXPECT_EQ(calls, (std::vector<std::string>{"set_led:3", "alpha:-1", "zeta:1"}));
+    auto stats = router.getStats();
+    EXPECT_EQ(stats.received, 5u);
+    EXPECT_EQ(stats.executed, 3u);
+    EXPECT_EQ(stats.unknown, 1u);
+    EXPECT_EQ(stats.malformed, 1u);
+
+    router.stop();
+    EXPECT_FALSE(mock->isSubscribed("dev/cmd/+"));
+}
+
+TEST(CommandRouterTest, InlineHandlersSeeTheReceiveBuffer)
+{
+    auto mock = std::make_shared<MockMqttClient>();
+    CommandRouter router(mock, inlineConfig());
+
+    const uint8_t *seen = nullptr;
+    ASSERT_EQ(router.on("reboot",
+                        [&seen](const Command &command) {
+                            seen = command.message.payload;
+                            return ESP_OK;
+                        }),
+              ESP_OK);
+    ASSERT_EQ(router.start(), ESP_OK);
+
+    std::vector<uint8_t> payload = bytes(R"({"delay": 5})");
+    mock->inject("dev/cmd/reboot", payload);
+    EXPECT_EQ(seen, payload.data());
+    router.stop();
+}
+
+TEST(CommandRouterTest, RegistrationRules)
+{
+    auto mock = std::make_shared<MockMqttClient>();
+    CommandRouter router(mock, inlineConfig());
+    auto ok = [](const Command &) { return ESP_OK; };
+
+    EXPECT_EQ(router.on("", ok), ESP_ERR_INVALID_ARG);
+    EXPECT_EQ(router.on("a/b", ok), ESP_ERR_INVALID_ARG);
+    EXPECT_EQ(router.on("#", ok), ESP_ERR_INVALID_ARG);
+    EXPECT_EQ(router.on("a", nullptr), ESP_ERR_INVALID_ARG);
+    EXPECT_EQ(router.on("a", ok), ESP_OK);
+    EXPECT_EQ(router.on("a", ok), ESP_ERR_INVALID_ARG);
+    ASSERT_EQ(router.start(), ESP_OK);
+    EXPECT_EQ(router.start(), ESP_ERR_INVALID_STATE);
+    EXPECT_EQ(router.on("b", ok), ESP_ERR_INVALID_STATE);
+    EXPECT_EQ(router.commandCount(), 1u);
+
+    CommandRouterConfig bad = inlineConfig();
+    bad.topicPrefix = "dev/+/cmd";
+    CommandRouter invalid(mock, bad);
+    EXPECT_EQ(invalid.start(), ESP_ERR_INVALID_ARG);
+}
+
+TEST(CommandRouterTest, FailuresAndOversizedPayloadsAreCounted)
+{
+    auto mock = std::make_shared<MockMqttClient>();
+    CommandRouterConfig config = inlineConfig();
+    config.maxPayload = 16;
+    CommandRouter router(mock, config);
+    int runs = 0;
+    router.on("fail", [&runs](const Command &) {
+        runs++;
+        return ESP_ERR_INVALID_ARG;
+    });
+    ASSERT_EQ(router.start(), ESP_OK);
+
+    mock->inject("dev/cmd/fail", {});
+    mock->inject("dev/cmd/fail", bytes(R"({"padding": "0123456789"})"));
+
+    EXPECT_EQ(runs, 1);
+    auto stats = router.getStats();
+    EXPECT_EQ(stats.failed, 1u);
+    EXPECT_EQ(stats.malformed, 1u);
+}
+
+TEST(CommandRouterTest, HandlersRunOnWorkerNotReceiveTask)
+{
+    auto mock = std::make_shared<MockMqttClient>();
+    CommandRouterConfig config = inlineConfig();
+    config.dispatch.workers = 1;
+    config.dispatch.queueDepth = 4;
+    CommandRouter router(mock, config);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<int64_t> seen;
+    std::thread::id ranOn;
+    router.on("count", [&](const Command &command) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ranOn = std::this_thread::get_id();
+        seen.push_back(command.args.getInt("i").value_or(-1));
+        cv.notify_all();
+        return ESP_OK;
+    });
+    ASSERT_EQ(router.start(), ESP_OK);
+
+    for (int i = 0; i < 3; i++)
+    {
+        mock->inject("dev/cmd/count", bytes("{\"i\":" + std::to_string(i) + "}"));
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(2), [&seen] { return seen.size() == 3; }));
+    EXPECT_EQ(seen, (std::vector<int64_t>{0, 1, 2}));
+    EXPECT_NE(ranOn, std::this_thread::get_id());
+}
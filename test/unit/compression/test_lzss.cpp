@@ -0,0 +1,103 @@
+/**
+ * @file test_lzss.cpp
+ * @brief Unit tests for the shared LZSS token codec
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/compression/lzss.hpp"
+
+using namespace lopcore;
+
+namespace
+{
+
+std::vector<uint8_t> sampleText(size_t lines)
+{
+    std::string text;
+    for (size_t i = 0; i < lines; ++i)
+    {
+        text += "{\"seq\":" + std::to_string(i * 37) + ",\"temp\":" + std::to_string(20 + i % 7) + "}\n";
+    }
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+std::vector<uint8_t> decodeAll(const std::vector<uint8_t> &tokens, size_t size, size_t step)
+{
+    lzss::Decoder decoder;
+    std::vector<uint8_t> out(size);
+    size_t pos = 0;
+    size_t produced = 0;
+    auto next = [&tokens, &pos]() -> int { return pos < tokens.size() ? tokens[pos++] : -1; };
+
+    // Small output steps stop the decoder inside matches
+    while (produced < size)
+    {
+        lzss::Decoder::Status status;
+        size_t n = decoder.decode(next, out.data() + produced, std::min(step, size - produced), status);
+        produced += n;
+        if (status != lzss::Decoder::Status::OK)
+        {
+            break;
+        }
+    }
+    out.resize(produced);
+    return out;
+}
+
+} // namespace
+
+TEST(LzssTest, StreamEncoderFedInPiecesRoundTrips)
+{
+    std::vector<uint8_t> input = sampleText(2000);
+    lzss::StreamEncoder encoder;
+    std::vector<uint8_t> tokens;
+    for (size_t pos = 0; pos < input.size(); pos += 333)
+    {
+        encoder.write(input.data() + pos, std::min<size_t>(333, input.size() - pos), tokens);
+    }
+    encoder.finish(tokens);
+
+    EXPECT_LT(tokens.size(), input.size() / 3);
+    EXPECT_EQ(decodeAll(tokens, input.size(), 7), input);
+}
+
+TEST(LzssTest, EncoderStopsAtOutputLimit)
+{
+    std::vector<uint8_t> input = sampleText(50);
+    lzss::Encoder encoder;
+    std::vector<uint8_t> tokens;
+
+    size_t pos = encoder.encode(input.data(), 0, input.size(), 1, tokens, 16);
+    EXPECT_LT(pos, input.size());
+    EXPECT_GE(tokens.size(), 16u);
+
+    encoder.reset();
+    tokens.clear();
+    EXPECT_EQ(encoder.encode(input.data(), 0, input.size(), 1, tokens), input.size());
+    encoder.finish(tokens);
+    EXPECT_EQ(decodeAll(tokens, input.size(), input.size()), input);
+}
+
+TEST(LzssTest, DecoderReportsEndAndCorruptInput)
+{
+    lzss::Decoder::Status status;
+    uint8_t out[8];
+
+    // Two literals, then the input ends inside the group
+    std::vector<uint8_t> literals = {0x00, 'a', 'b'};
+    size_t pos = 0;
+    lzss::Decoder decoder;
+    EXPECT_EQ(decoder.decode([&] { return pos < literals.size() ? literals[pos++] : -1; }, out, 8, status), 2u);
+    EXPECT_EQ(status, lzss::Decoder::Status::END);
+
+    // A match before anything was produced
+    std::vector<uint8_t> early = {0x01, 0x00, 0x00};
+    pos = 0;
+    lzss::Decoder fresh;
+    EXPECT_EQ(fresh.decode([&] { return pos < early.size() ? early[pos++] : -1; }, out, 8, status), 0u);
+    EXPECT_EQ(status, lzss::Decoder::Status::CORRUPT);
+}
@@ -0,0 +1,399 @@
+/**
+ * @file test_async_logger.cpp
+ * @brief Unit tests for the asynchronous logger backend and its ring buffer
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/logging/log_ring_buffer.hpp"
+#include "lopcore/logging/logger.hpp"
+
+using namespace lopcore;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+/**
+ * @brief Sink that records messages and can hold the drain task inside write()
+ */
+class GatedSink : public ILogSink
+{
+public:
+    GatedSink(std::vector<std::string> &out, std::mutex &outMutex) : out_(out), outMutex_(outMutex)
+    {
+    }
+
+    void write(const LogMessage &msg) override
+    {
+        {
+            std::unique_lock<std::mutex> lock(gateMutex_);
+            entered_ = true;
+            gateCv_.notify_all();
+            gateCv_.wait(lock, [this] { return open_; });
+        }
+        if (delay_.count() > 0)
+        {
+            std::this_thread::sleep_for(delay_);
+        }
+        std::lock_guard<std::mutex> lock(outMutex_);
+        out_.push_back(msg.message);
+    }
+
+    void flush() override
+    {
+    }
+
+    const char *getName() const override
+    {
+        return "GatedSink";
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(gateMutex_);
+        open_ = false;
+    }
+
+    void open()
+    {
+        std::lock_guard<std::mutex> lock(gateMutex_);
+        open_ = true;
+        gateCv_.notify_all();
+    }
+
+    bool waitEntered(std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock(gateMutex_);
+        return gateCv_.wait_for(lock, timeout, [this] { return entered_; });
+    }
+
+    void setDelay(std::chrono::milliseconds delay)
+    {
+        delay_ = delay;
+    }
+
+private:
+    std::vector<std::string> &out_;
+    std::mutex &outMutex_;
+    std::mutex gateMutex_;
+    std::condition_variable gateCv_;
+    bool open_ = true;
+    bool entered_ = false;
+    std::chrono::milliseconds delay_{0};
+};
+
+} // namespace
+
+// ============================================================================
+// LogRingBuffer
+// ============================================================================
+
+TEST(LogRingBufferTest, CapacityRoundsUpToPowerOfTwo)
+{
+    LogRingBuffer<int> ring(5);
+    EXPECT_EQ(ring.capacity(), 8u);
+
+    LogRingBuffer<int> tiny(0);
+    EXPECT_EQ(tiny.capacity(), 2u);
+}
+
+TEST(LogRingBufferTest, FifoOrderAndFullEmpty)
+{
+    LogRingBuffer<int> ring(4);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(ring.tryPush([i](int &slot) { slot = i; }));
+    }
+    EXPECT_FALSE(ring.tryPush([](int &slot) { slot = 99; }));
+    EXPECT_EQ(ring.sizeApprox(), 4u);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        int value = -1;
+        EXPECT_TRUE(ring.tryPop([&value](const int &slot) { value = slot; }));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(ring.tryPop([](const int &) {}));
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(LogRingBufferTest, DiscardOldestMakesRoom)
+{
+    LogRingBuffer<int> ring(2);
+    ring.tryPush([](int &slot) { slot = 1; });
+    ring.tryPush([](int &slot) { slot = 2; });
+
+    EXPECT_TRUE(ring.discardOldest());
+    EXPECT_TRUE(ring.tryPush([](int &slot) { slot = 3; }));
+
+    int value = 0;
+    ring.tryPop([&value](const int &slot) { value = slot; });
+    EXPECT_EQ(value, 2);
+}
+
+TEST(LogRingBufferTest, ConcurrentProducersLoseNothing)
+{
+    constexpr int PRODUCERS = 4;
+    constexpr int PER_PRODUCER = 5000;
+    LogRingBuffer<int> ring(64);
+    std::atomic<int> popped{0};
+    std::atomic<long> sum{0};
+    std::atomic<bool> done{false};
+
+    std::thread consumer([&] {
+        while (!done.load() || !ring.empty())
+        {
+            ring.tryPop([&](const int &v) {
+                sum.fetch_add(v);
+                popped.fetch_add(1);
+            });
+        }
+    });
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p)
+    {
+        producers.emplace_back([&ring] {
+            for (int i = 1; i <= PER_PRODUCER; ++i)
+            {
+                while (!ring.tryPush([i](int &slot) { slot = i; }))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &t : producers)
+    {
+        t.join();
+    }
+    done.store(true);
+    consumer.join();
+
+    EXPECT_EQ(popped.load(), PRODUCERS * PER_PRODUCER);
+    EXPECT_EQ(sum.load(), static_cast<long>(PRODUCERS) * PER_PRODUCER * (PER_PRODUCER + 1) / 2);
+}
+
+// ============================================================================
+// Logger async mode
+// ============================================================================
+
+class AsyncLoggerTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        auto &logger = Logger::getInstance();
+        logger.disableAsync();
+        logger.clearSinks();
+        logger.setGlobalLevel(LogLevel::VERBOSE);
+        logger.resetDroppedCount();
+
+        auto sink = std::make_unique<GatedSink>(received_, receivedMutex_);
+        sink_ = sink.get();
+        logger.addSink(std::move(sink));
+    }
+
+    void TearDown() override
+    {
+        sink_->open();
+        Logger::getInstance().disableAsync();
+        Logger::getInstance().clearSinks();
+    }
+
+    std::vector<std::string> snapshot()
+    {
+        std::lock_guard<std::mutex> lock(receivedMutex_);
+        return received_;
+    }
+
+    std::vector<std::string> received_;
+    std::mutex receivedMutex_;
+    GatedSink *sink_ = nullptr;
+};
+
+TEST_F(AsyncLoggerTest, EnableAndDisable)
+{
+    auto &logger = Logger::getInstance();
+    EXPECT_FALSE(logger.isAsync());
+
+    EXPECT_TRUE(logger.enableAsync());
+    EXPECT_TRUE(logger.isAsync());
+
+    logger.disableAsync();
+    EXPECT_FALSE(logger.isAsync());
+}
+
+TEST_F(AsyncLoggerTest, RecordsReachSinksInOrder)
+{
+    auto &logger = Logger::getInstance();
+    ASSERT_TRUE(logger.enableAsync(AsyncLogConfig().setQueueDepth(128)));
+
+    for (int i = 0; i < 50; ++i)
+    {
+        logger.info("Async", "msg %d", i);
+    }
+    logger.flush();
+
+    auto out = snapshot();
+    ASSERT_EQ(out.size(), 50u);
+    for (int i = 0; i < 50; ++i)
+    {
+        EXPECT_EQ(out[i], "msg " + std::to_string(i));
+    }
+    EXPECT_EQ(logger.getDroppedCount(), 0u);
+}
+
+TEST_F(AsyncLoggerTest, ProducerDoesNotWaitForSlowSink)
+{
+    auto &logger = Logger::getInstance();
+    ASSERT_TRUE(logger.enableAsync(AsyncLogConfig().setQueueDepth(8)));
+
+    sink_->close();
+    logger.info("Async", "first");
+    ASSERT_TRUE(sink_->waitEntered(1s));
+
+    // Drain task is stuck inside the sink; logging must still return promptly
+    auto start = std::chrono::steady_clock::now();
+    logger.info("Async", "second");
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_LT(elapsed, 50ms);
+
+    sink_->open();
+    logger.flush();
+    EXPECT_EQ(snapshot().size(), 2u);
+}
+
+TEST_F(AsyncLoggerTest, DropNewestKeepsEarliestRecords)
+{
+    auto &logger = Logger::getInstance();
+    ASSERT_TRUE(logger.enableAsync(
+        AsyncLogConfig().setQueueDepth(8).setOverflowPolicy(LogOverflowPolicy::DROP_NEWEST)));
+
+    sink_->close();
+    logger.info("Async", "m0");
+    ASSERT_TRUE(sink_->waitEntered(1s));
+
+    // m0 has left the ring, so all 8 slots are free for m1..m8
+    for (int i = 1; i <= 20; ++i)
+    {
+        logger.info("Async", "m%d", i);
+    }
+    EXPECT_EQ(logger.getDroppedCount(), 12u);
+
+    sink_->open();
+    logger.flush();
+    auto out = snapshot();
+    ASSERT_EQ(out.size(), 9u);
+    EXPECT_EQ(out.front(), "m0");
+    EXPECT_EQ(out.back(), "m8");
+}
+
+TEST_F(AsyncLoggerTest, DropOldestKeepsLatestRecords)
+{
+    auto &logger = Logger::getInstance();
+    ASSERT_TRUE(logger.enableAsync(
+        AsyncLogConfig().setQueueDepth(8).setOverflowPolicy(LogOverflowPolicy::DROP_OLDEST)));
+
+    sink_->close();
+    logger.info("Async", "m0");
+    ASSERT_TRUE(sink_->waitEntered(1s));
+
+    for (int i = 1; i <= 20; ++i)
+    {
+        logger.info("Async", "m%d", i);
+    }
+    EXPECT_EQ(logger.getDroppedCount(), 12u);
+
+    sink_->open();
+    logger.flush();
+    auto out = snapshot();
+    ASSERT_EQ(out.size(), 9u);
+    EXPECT_EQ(out[0], "m0");
+    EXPECT_EQ(out[1], "m13");
+    EXPECT_EQ(out.back(), "m20");
+}
+
+TEST_F(AsyncLoggerTest, BlockPolicyWaitsForDrain)
+{
+    auto &logger = Logger::getInstance();
+    ASSERT_TRUE(logger.enableAsync(AsyncLogConfig()
+                                       .setQueueDepth(4)
+                                       .setOverflowPolicy(LogOverflowPolicy::BLOCK)
+                                       .setBlockTimeout(1000)
+                                       .setDrainInterval(1)));
+    sink_->setDelay(1ms);
+
+    for (int i = 0; i < 40; ++i)
+    {
+        logger.info("Async", "b%d", i);
+    }
+    logger.flush();
+
+    EXPECT_EQ(logger.getDroppedCount(), 0u);
+    EXPECT_EQ(snapshot().size(), 40u);
+}
+
+TEST_F(AsyncLoggerTest, BlockPolicyDropsAfterTimeout)
+{
+    auto &logger = Logger::getInstance();
+    ASSERT_TRUE(logger.enableAsync(AsyncLogConfig()
+                                       .setQueueDepth(2)
+                                       .setOverflowPolicy(LogOverflowPolicy::BLOCK)
+                                       .setBlockTimeout(5)));
+
+    sink_->close();
+    logger.info("Async", "held");
+    ASSERT_TRUE(sink_->waitEntered(1s));
+
+    logger.info("Async", "queued1");
+    logger.info("Async", "queued2");
+    logger.info("Async", "dropped");
+    EXPECT_EQ(logger.getDroppedCount(), 1u);
+}
+
+TEST_F(AsyncLoggerTest, DisableWritesPendingAndReturnsToSync)
+{
+    auto &logger = Logger::getInstance();
+    ASSERT_TRUE(logger.enableAsync(AsyncLogConfig().setQueueDepth(16)));
+
+    sink_->close();
+    logger.info("Async", "a");
+    ASSERT_TRUE(sink_->waitEntered(1s));
+    logger.info("Async", "b");
+    logger.info("Async", "c");
+    sink_->open();
+
+    logger.disableAsync();
+    EXPECT_EQ(snapshot().size(), 3u);
+
+    logger.info("Sync", "d");
+    auto out = snapshot();
+    ASSERT_EQ(out.size(), 4u);
+    EXPECT_EQ(out.back(), "d");
+}
+
+TEST_F(AsyncLoggerTest, LevelFilterAppliesBeforeQueueing)
+{
+    auto &logger = Logger::getInstance();
+    logger.setGlobalLevel(LogLevel::WARN);
+    ASSERT_TRUE(logger.enableAsync());
+
+    logger.debug("Async", "filtered");
+    logger.warn("Async", "kept");
+    logger.flush();
+
+    auto out = snapshot();
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(out[0], "kept");
+}
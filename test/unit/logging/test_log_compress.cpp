@@ -0,0 +1,129 @@
+/**
+ * @file test_log_compress.cpp
+ * @brief Unit tests for the streaming log file compressor
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/logging/log_compress.hpp"
+
+using namespace lopcore;
+
+namespace
+{
+
+std::string readFile(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+void writeFile(const std::string &path, const std::string &content)
+{
+    std::ofstream file(path, std::ios::binary);
+    file << content;
+}
+
+} // namespace
+
+class LogCompressTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char pattern[] = "/tmp/lopcore_compress_XXXXXX";
+        ASSERT_NE(mkdtemp(pattern), nullptr);
+        dir_ = pattern;
+        plain_ = dir_ + "/plain.log";
+        packed_ = plain_ + ".lz";
+        unpacked_ = dir_ + "/unpacked.log";
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(dir_);
+    }
+
+    void roundTrip(const std::string &content)
+    {
+        writeFile(plain_, content);
+        ASSERT_TRUE(compressLogFile(plain_.c_str(), packed_.c_str()));
+        ASSERT_TRUE(decompressLogFile(packed_.c_str(), unpacked_.c_str()));
+        EXPECT_EQ(readFile(unpacked_), content);
+    }
+
+    std::string dir_;
+    std::string plain_;
+    std::string packed_;
+    std::string unpacked_;
+};
+
+TEST_F(LogCompressTest, EmptyFile)
+{
+    roundTrip("");
+    EXPECT_EQ(readFile(packed_), "LCZ1");
+}
+
+TEST_F(LogCompressTest, ShortInputWithoutMatches)
+{
+    roundTrip("ab");
+    roundTrip("abcdefg");
+}
+
+TEST_F(LogCompressTest, LogTextCompressesWell)
+{
+    std::string content;
+    for (int i = 0; i < 2000; ++i)
+    {
+        content += "[" + std::to_string(100000 + i * 7) + "] I (MQTT): Published message " +
+                   std::to_string(i % 13) + " to topic devices/lopcore/telemetry\n";
+    }
+    roundTrip(content);
+
+    // Multi-window input exercises the sliding buffer; text logs shrink a lot
+    EXPECT_LT(readFile(packed_).size(), content.size() / 3);
+}
+
+TEST_F(LogCompressTest, RandomDataRoundTrips)
+{
+    std::mt19937 rng(1234);
+    std::string content(30000, '\0');
+    for (auto &c : content)
+    {
+        c = static_cast<char>(rng() & 0xFF);
+    }
+    roundTrip(content);
+}
+
+TEST_F(LogCompressTest, LongRunsUseOverlappingMatches)
+{
+    roundTrip(std::string(10000, 'z') + "tail");
+}
+
+TEST_F(LogCompressTest, MatchEndingOnBufferBoundary)
+{
+    // Runs of maximum-length matches land exactly on the 8 KB input boundary
+    roundTrip(std::string(3 * 8192, 'z') + "tail");
+}
+
+TEST_F(LogCompressTest, RejectsMissingOrCorruptInput)
+{
+    EXPECT_FALSE(compressLogFile((dir_ + "/missing.log").c_str(), packed_.c_str()));
+
+    writeFile(packed_, "nope");
+    EXPECT_FALSE(decompressLogFile(packed_.c_str(), unpacked_.c_str()));
+
+    // Match referring before the start of the stream
+    writeFile(packed_, std::string("LCZ1\x01\xff\x0f", 7));
+    EXPECT_FALSE(decompressLogFile(packed_.c_str(), unpacked_.c_str()));
+}
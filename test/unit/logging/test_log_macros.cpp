@@ -0,0 +1,114 @@
+/**
+ * @file test_log_macros.cpp
+ * @brief Unit tests for compile-time elimination in the LOPCORE_LOGx macros
+ */
+
+// Compile everything above INFO out of this translation unit
+#define LOPCORE_LOG_MAX_LEVEL 3
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/logging/logger.hpp"
+
+using namespace lopcore;
+
+namespace
+{
+
+class CaptureSink : public ILogSink
+{
+public:
+    explicit CaptureSink(std::vector<std::string> &out) : out_(out)
+    {
+    }
+
+    void write(const LogMessage &msg) override
+    {
+        out_.push_back(msg.message);
+    }
+
+    void flush() override
+    {
+    }
+
+    const char *getName() const override
+    {
+        return "CaptureSink";
+    }
+
+private:
+    std::vector<std::string> &out_;
+};
+
+int evaluations = 0;
+
+int countEvaluation()
+{
+    return ++evaluations;
+}
+
+} // namespace
+
+class LogMacroTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        evaluations = 0;
+        auto &logger = Logger::getInstance();
+        logger.clearSinks();
+        logger.setGlobalLevel(LogLevel::VERBOSE);
+        logger.addSink(std::make_unique<CaptureSink>(received_));
+    }
+
+    void TearDown() override
+    {
+        Logger::getInstance().clearSinks();
+    }
+
+    std::vector<std::string> received_;
+};
+
+TEST_F(LogMacroTest, CompiledLevelsFollowThreshold)
+{
+    static_assert(isLogLevelCompiled(LogLevel::ERROR), "ERROR must be compiled in");
+    static_assert(isLogLevelCompiled(LogLevel::INFO), "INFO must be compiled in");
+    static_assert(!isLogLevelCompiled(LogLevel::DEBUG), "DEBUG must be compiled out");
+    static_assert(!isLogLevelCompiled(LogLevel::VERBOSE), "VERBOSE must be compiled out");
+}
+
+TEST_F(LogMacroTest, LevelsAboveThresholdAreNotEvaluated)
+{
+    LOPCORE_LOGD("Macro", "debug %d", countEvaluation());
+    LOPCORE_LOGV("Macro", "verbose %d", countEvaluation());
+
+    EXPECT_EQ(evaluations, 0);
+    EXPECT_TRUE(received_.empty());
+}
+
+TEST_F(LogMacroTest, LevelsAtOrBelowThresholdAreLogged)
+{
+    LOPCORE_LOGE("Macro", "error %d", countEvaluation());
+    LOPCORE_LOGW("Macro", "warn");
+    LOPCORE_LOGI("Macro", "info %d", countEvaluation());
+
+    EXPECT_EQ(evaluations, 2);
+    ASSERT_EQ(received_.size(), 3u);
+    EXPECT_EQ(received_[0], "error 1");
+    EXPECT_EQ(received_[2], "info 2");
+}
+
+TEST_F(LogMacroTest, MacroIsASingleStatement)
+{
+    bool flag = true;
+    if (flag)
+        LOPCORE_LOGI("Macro", "then");
+    else
+        LOPCORE_LOGI("Macro", "else");
+
+    ASSERT_EQ(received_.size(), 1u);
+    EXPECT_EQ(received_[0], "then");
+}
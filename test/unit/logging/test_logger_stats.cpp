@@ -0,0 +1,152 @@
+/**
+ * @file test_logger_stats.cpp
+ * @brief Unit tests for the Logger runtime counters
+ */
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/logging/logger.hpp"
+
+using namespace lopcore;
+
+namespace
+{
+
+class NamedSink : public ILogSink
+{
+public:
+    explicit NamedSink(const char *name,
+                       LogLevel minLevel = LogLevel::VERBOSE,
+                       std::chrono::milliseconds delay = std::chrono::milliseconds(0))
+        : name_(name), delay_(delay)
+    {
+        min_level_ = minLevel;
+    }
+
+    void write(const LogMessage &msg) override
+    {
+        (void) msg;
+        if (delay_.count() > 0)
+        {
+            std::this_thread::sleep_for(delay_);
+        }
+    }
+
+    void flush() override
+    {
+    }
+
+    const char *getName() const override
+    {
+        return name_;
+    }
+
+private:
+    const char *name_;
+    std::chrono::milliseconds delay_;
+};
+
+} // namespace
+
+class LoggerStatsTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        logger_.disableAsync();
+        logger_.clearSinks();
+        logger_.clearTagLevels();
+        logger_.setGlobalLevel(LogLevel::INFO);
+        logger_.resetStats();
+    }
+
+    void TearDown() override
+    {
+        logger_.disableAsync();
+        logger_.clearSinks();
+    }
+
+    Logger &logger_ = Logger::getInstance();
+};
+
+TEST_F(LoggerStatsTest, CountsEmittedRecordsOnly)
+{
+    logger_.addSink(std::make_unique<NamedSink>("all"));
+
+    logger_.info("Stats", "one");
+    logger_.warn("Stats", "two");
+    logger_.debug("Stats", "filtered");
+
+    LoggerStats stats = logger_.getStats();
+    EXPECT_EQ(stats.recordsEmitted, 2u);
+    EXPECT_EQ(stats.recordsDropped, 0u);
+}
+
+TEST_F(LoggerStatsTest, CountsRecordsAndBytesPerSink)
+{
+    logger_.addSink(std::make_unique<NamedSink>("all"));
+    logger_.addSink(std::make_unique<NamedSink>("errors", LogLevel::ERROR));
+
+    logger_.info("Stats", "hello");         // 5 bytes
+    logger_.error("Stats", "failed %d", 7); // 8 bytes
+
+    std::vector<LogSinkStats> sinks = logger_.getSinkStats();
+    ASSERT_EQ(sinks.size(), 2u);
+    EXPECT_STREQ(sinks[0].name, "all");
+    EXPECT_EQ(sinks[0].records, 2u);
+    EXPECT_EQ(sinks[0].bytes, 13u);
+    EXPECT_STREQ(sinks[1].name, "errors");
+    EXPECT_EQ(sinks[1].records, 1u);
+    EXPECT_EQ(sinks[1].bytes, 8u);
+}
+
+TEST_F(LoggerStatsTest, AsyncModeCountsAfterDrain)
+{
+    logger_.addSink(std::make_unique<NamedSink>("all"));
+    ASSERT_TRUE(logger_.enableAsync(AsyncLogConfig().setDeferredFormatting(true)));
+
+    logger_.info("Stats", "value %d", 42); // "value 42"
+    logger_.flush();
+
+    std::vector<LogSinkStats> sinks = logger_.getSinkStats();
+    ASSERT_EQ(sinks.size(), 1u);
+    EXPECT_EQ(sinks[0].records, 1u);
+    EXPECT_EQ(sinks[0].bytes, 8u);
+    EXPECT_EQ(logger_.getStats().recordsEmitted, 1u);
+}
+
+TEST_F(LoggerStatsTest, OverflowIsCountedAsDropped)
+{
+    // A slow sink keeps the drain task from catching up with the burst
+    logger_.addSink(std::make_unique<NamedSink>("slow", LogLevel::VERBOSE, std::chrono::milliseconds(2)));
+    ASSERT_TRUE(
+        logger_.enableAsync(AsyncLogConfig().setQueueDepth(4).setOverflowPolicy(LogOverflowPolicy::DROP_NEWEST)));
+
+    for (int i = 0; i < 64; ++i)
+    {
+        logger_.info("Stats", "burst %d", i);
+    }
+    logger_.flush();
+
+    LoggerStats stats = logger_.getStats();
+    EXPECT_EQ(stats.recordsEmitted, 64u);
+    EXPECT_GT(stats.recordsDropped, 0u);
+    EXPECT_EQ(logger_.getSinkStats()[0].records + stats.recordsDropped, 64u);
+}
+
+TEST_F(LoggerStatsTest, ResetClearsAllCounters)
+{
+    logger_.addSink(std::make_unique<NamedSink>("all"));
+    logger_.info("Stats", "something");
+
+    logger_.resetStats();
+
+    EXPECT_EQ(logger_.getStats().recordsEmitted, 0u);
+    EXPECT_EQ(logger_.getSinkStats()[0].records, 0u);
+    EXPECT_EQ(logger_.getSinkStats()[0].bytes, 0u);
+}
@@ -0,0 +1,345 @@
+/**
+ * @file test_mqtt_log_sink.cpp
+ * @brief Unit tests for the batching MQTT log sink
+ */
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/logging/logger.hpp"
+#include "lopcore/logging/mqtt_log_sink.hpp"
+
+using namespace lopcore;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+/**
+ * @brief Minimal IMqttClient that records publishes
+ */
+class FakeMqttClient : public mqtt::IMqttClient
+{
+public:
+    esp_err_t connect() override
+    {
+        connected = true;
+        return ESP_OK;
+    }
+
+    esp_err_t disconnect() override
+    {
+        connected = false;
+        return ESP_OK;
+    }
+
+    bool isConnected() const override
+    {
+        return connected.load();
+    }
+
+    mqtt::MqttConnectionState getConnectionState() const override
+    {
+        return connected ? mqtt::MqttConnectionState::CONNECTED : mqtt::MqttConnectionState::DISCONNECTED;
+    }
+
+    esp_err_t publish(const std::string &topic,
+                      const std::vector<uint8_t> &payload,
+                      mqtt::MqttQos qos,
+                      bool retain) override
+    {
+        (void) qos;
+        (void) retain;
+        if (logDuringPublish)
+        {
+            Logger::getInstance().warn("fake_mqtt", "publishing %zu bytes", payload.size());
+        }
+        esp_err_t result = publishResult.load();
+        if (result == ESP_OK)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            topics.push_back(topic);
+            payloads.emplace_back(payload.begin(), payload.end());
+        }
+        return result;
+    }
+
+    esp_err_t publishString(const std::string &topic,
+                            const std::string &payload,
+                            mqtt::MqttQos qos,
+                            bool retain) override
+    {
+        return publish(topic, std::vector<uint8_t>(payload.begin(), payload.end()), qos, retain);
+    }
+
+    esp_err_t subscribe(const std::string &, MessageCallback, mqtt::MqttQos) override
+    {
+        return ESP_OK;
+    }
+
+    esp_err_t unsubscribe(const std::string &) override
+    {
+        return ESP_OK;
+    }
+
+    void setConnectionCallback(ConnectionCallback) override
+    {
+    }
+
+    void setErrorCallback(ErrorCallback) override
+    {
+    }
+
+    esp_err_t setWillMessage(const std::string &, const std::vector<uint8_t> &, mqtt::MqttQos, bool) override
+    {
+        return ESP_OK;
+    }
+
+    mqtt::MqttStatistics getStatistics() const override
+    {
+        return mqtt::MqttStatistics();
+    }
+
+    void resetStatistics() override
+    {
+    }
+
+    std::string getClientId() const override
+    {
+        return "fake";
+    }
+
+    std::string getBroker() const override
+    {
+        return "localhost";
+    }
+
+    uint16_t getPort() const override
+    {
+        return 1883;
+    }
+
+    size_t publishCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return payloads.size();
+    }
+
+    std::string payloadAt(size_t index)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return payloads.at(index);
+    }
+
+    std::atomic<bool> connected{true};
+    std::atomic<esp_err_t> publishResult{ESP_OK};
+    std::atomic<bool> logDuringPublish{false};
+    std::mutex mutex;
+    std::vector<std::string> topics;
+    std::vector<std::string> payloads;
+};
+
+class CaptureSink : public ILogSink
+{
+public:
+    explicit CaptureSink(std::vector<std::string> &out) : out_(out)
+    {
+    }
+
+    void write(const LogMessage &msg) override
+    {
+        out_.push_back(std::string(msg.tag) + ":" + msg.message);
+    }
+
+    void flush() override
+    {
+    }
+
+    const char *getName() const override
+    {
+        return "CaptureSink";
+    }
+
+private:
+    std::vector<std::string> &out_;
+};
+
+template<typename Predicate>
+bool waitFor(Predicate predicate, std::chrono::milliseconds timeout = 2s)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!predicate())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(2ms);
+    }
+    return true;
+}
+
+LogMessage makeMessage(const char *text, uint32_t timestamp = 1000)
+{
+    LogMessage msg{};
+    msg.level = LogLevel::INFO;
+    msg.timestamp_ms = timestamp;
+    msg.tag = "App";
+    msg.message = text;
+    return msg;
+}
+
+} // namespace
+
+class MqttLogSinkTest : public ::testing::Test
+{
+protected:
+    std::shared_ptr<FakeMqttClient> client_ = std::make_shared<FakeMqttClient>();
+    std::vector<std::string> fallback_;
+};
+
+TEST_F(MqttLogSinkTest, PublishesOneMessagePerBatch)
+{
+    MqttLogSink sink(client_,
+                     MqttLogSinkConfig().setTopic("dev/logs").setMaxBatchRecords(3).setMaxBatchDelay(60000));
+    ASSERT_TRUE(sink.isRunning());
+
+    const char *texts[] = {"a", "b", "c", "d", "e", "f"};
+    for (const char *text : texts)
+    {
+        sink.write(makeMessage(text));
+    }
+
+    ASSERT_TRUE(waitFor([&] { return client_->publishCount() == 2; }));
+    EXPECT_EQ(client_->topics[0], "dev/logs");
+    EXPECT_EQ(client_->payloadAt(0),
+              "[      1000] I (App): a\n[      1000] I (App): b\n[      1000] I (App): c");
+
+    auto stats = sink.getStats();
+    EXPECT_EQ(stats.batchesPublished, 2u);
+    EXPECT_EQ(stats.recordsPublished, 6u);
+}
+
+TEST_F(MqttLogSinkTest, PartialBatchIsPublishedAfterDelay)
+{
+    MqttLogSink sink(client_, MqttLogSinkConfig().setMaxBatchRecords(100).setMaxBatchDelay(40));
+
+    sink.write(makeMessage("lonely"));
+    ASSERT_TRUE(waitFor([&] { return client_->publishCount() == 1; }));
+    EXPECT_EQ(client_->payloadAt(0), "[      1000] I (App): lonely");
+}
+
+TEST_F(MqttLogSinkTest, FlushSealsCurrentBatch)
+{
+    MqttLogSink sink(client_, MqttLogSinkConfig().setMaxBatchRecords(100).setMaxBatchDelay(60000));
+
+    sink.write(makeMessage("x"));
+    sink.write(makeMessage("y"));
+    sink.flush();
+    ASSERT_TRUE(waitFor([&] { return client_->publishCount() == 1; }));
+    EXPECT_EQ(sink.getStats().recordsPublished, 2u);
+}
+
+TEST_F(MqttLogSinkTest, ByteCapacitySplitsBatches)
+{
+    MqttLogSink sink(client_,
+                     MqttLogSinkConfig().setMaxBatchBytes(128).setMaxBatchRecords(100).setMaxBatchDelay(60000));
+
+    // 40-byte lines: three fit in 128 bytes, the fourth starts a new batch
+    std::string text(18, 'm');
+    for (int i = 0; i < 4; ++i)
+    {
+        sink.write(makeMessage(text.c_str()));
+    }
+    ASSERT_TRUE(waitFor([&] { return client_->publishCount() == 1; }));
+    EXPECT_LE(client_->payloadAt(0).size(), 128u);
+    EXPECT_EQ(sink.getStats().recordsPublished, 3u);
+}
+
+TEST_F(MqttLogSinkTest, DisconnectedRecordsGoToFallback)
+{
+    client_->connected = false;
+    MqttLogSink sink(client_, MqttLogSinkConfig().setMaxBatchRecords(1),
+                     std::make_unique<CaptureSink>(fallback_));
+
+    sink.write(makeMessage("offline"));
+    std::this_thread::sleep_for(30ms);
+
+    EXPECT_EQ(client_->publishCount(), 0u);
+    ASSERT_EQ(fallback_.size(), 1u);
+    EXPECT_EQ(fallback_[0], "App:offline");
+    EXPECT_EQ(sink.getStats().recordsToFallback, 1u);
+}
+
+TEST_F(MqttLogSinkTest, HeldBatchIsRetriedWhenBudgetReturns)
+{
+    client_->publishResult = ESP_ERR_NO_MEM; // Client budget exhausted
+    MqttLogSink sink(client_, MqttLogSinkConfig().setMaxBatchRecords(1).setMaxBatchDelay(40),
+                     std::make_unique<CaptureSink>(fallback_));
+
+    sink.write(makeMessage("first"));
+    ASSERT_TRUE(waitFor([&] { return sink.getStats().publishFailures > 0; }));
+
+    // The held batch blocks sealing; once the filling batch is full too, lines spill to the fallback
+    sink.write(makeMessage("second"));
+    sink.write(makeMessage("third"));
+    ASSERT_EQ(fallback_.size(), 1u);
+    EXPECT_EQ(fallback_[0], "App:third");
+
+    client_->publishResult = ESP_OK;
+    ASSERT_TRUE(waitFor([&] { return client_->publishCount() == 2; }));
+    EXPECT_EQ(client_->payloadAt(0), "[      1000] I (App): first");
+    EXPECT_EQ(client_->payloadAt(1), "[      1000] I (App): second");
+}
+
+TEST_F(MqttLogSinkTest, DedicatedBudgetLimitsPublishes)
+{
+    mqtt::BudgetConfig budgetConfig;
+    budgetConfig.defaultBudget = 1;
+    budgetConfig.maxBudget = 10;
+    mqtt::MqttBudget budget(budgetConfig);
+
+    MqttLogSink sink(client_,
+                     MqttLogSinkConfig().setMaxBatchRecords(1).setMaxBatchDelay(40).setBudget(&budget));
+
+    sink.write(makeMessage("one"));
+    ASSERT_TRUE(waitFor([&] { return client_->publishCount() == 1; }));
+    sink.write(makeMessage("two"));
+    ASSERT_TRUE(waitFor([&] { return sink.getStats().publishFailures > 0; }));
+    EXPECT_EQ(client_->publishCount(), 1u);
+
+    budget.restore(1);
+    ASSERT_TRUE(waitFor([&] { return client_->publishCount() == 2; }));
+}
+
+TEST_F(MqttLogSinkTest, LogsFromPublisherTaskAreNotShipped)
+{
+    auto &logger = Logger::getInstance();
+    logger.clearSinks();
+    logger.setGlobalLevel(LogLevel::INFO);
+
+    client_->logDuringPublish = true;
+    auto sink = std::make_unique<MqttLogSink>(client_,
+                                              MqttLogSinkConfig().setMaxBatchRecords(1).setMaxBatchDelay(40),
+                                              std::make_unique<CaptureSink>(fallback_));
+    MqttLogSink *raw = sink.get();
+    logger.addSink(std::move(sink));
+
+    logger.info("App", "ship me");
+    ASSERT_TRUE(waitFor([&] { return client_->publishCount() == 1; }));
+    std::this_thread::sleep_for(100ms);
+
+    // The client's own log line went to the fallback, not into another batch
+    EXPECT_EQ(client_->publishCount(), 1u);
+    EXPECT_EQ(raw->getStats().recordsToFallback, 1u);
+
+    logger.clearSinks();
+    ASSERT_EQ(fallback_.size(), 1u);
+    EXPECT_EQ(fallback_[0].rfind("fake_mqtt:publishing ", 0), 0u);
+}
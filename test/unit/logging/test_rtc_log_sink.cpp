@@ -0,0 +1,212 @@
+/**
+ * @file test_rtc_log_sink.cpp
+ * @brief Unit tests for the crash-persistent RTC log ring
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/logging/logger.hpp"
+#include "lopcore/logging/rtc_log_sink.hpp"
+
+using namespace lopcore;
+
+namespace
+{
+
+class CaptureSink : public ILogSink
+{
+public:
+    explicit CaptureSink(std::vector<std::string> &out) : out_(out)
+    {
+    }
+
+    void write(const LogMessage &msg) override
+    {
+        out_.push_back(std::string(msg.tag) + "@" + std::to_string(msg.timestamp_ms) + ":" + msg.message);
+    }
+
+    void flush() override
+    {
+    }
+
+    const char *getName() const override
+    {
+        return "CaptureSink";
+    }
+
+private:
+    std::vector<std::string> &out_;
+};
+
+LogMessage makeMessage(const char *tag, const char *text, uint32_t timestamp, LogLevel level = LogLevel::INFO)
+{
+    LogMessage msg{};
+    msg.level = level;
+    msg.timestamp_ms = timestamp;
+    msg.tag = tag;
+    msg.message = text;
+    return msg;
+}
+
+} // namespace
+
+class RtcLogSinkTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        // Power-on RAM contents are arbitrary
+        memset(&ring_, 0xA5, sizeof(ring_));
+    }
+
+    RtcLogRing ring_;
+    std::vector<std::string> captured_;
+};
+
+TEST_F(RtcLogSinkTest, GarbageRingStartsEmpty)
+{
+    RtcLogSink sink(&ring_);
+    EXPECT_FALSE(sink.wasRecovered());
+    EXPECT_EQ(sink.getRecoveredCount(), 0u);
+
+    CaptureSink capture(captured_);
+    EXPECT_EQ(sink.replay(capture), 0u);
+    EXPECT_TRUE(captured_.empty());
+}
+
+TEST_F(RtcLogSinkTest, RecordsSurviveRestart)
+{
+    {
+        RtcLogSink before(&ring_);
+        before.write(makeMessage("Wifi", "connected", 100));
+        before.write(makeMessage("Ota", "downloading", 200));
+        before.write(makeMessage("Wdt", "task stuck", 300, LogLevel::ERROR));
+    }
+
+    RtcLogSink after(&ring_);
+    EXPECT_TRUE(after.wasRecovered());
+    EXPECT_EQ(after.getRecoveredCount(), 3u);
+
+    CaptureSink capture(captured_);
+    EXPECT_EQ(after.replay(capture), 3u);
+    ASSERT_EQ(captured_.size(), 3u);
+    EXPECT_EQ(captured_[0], "Wifi@100:connected");
+    EXPECT_EQ(captured_[1], "Ota@200:downloading");
+    EXPECT_EQ(captured_[2], "Wdt@300:task stuck");
+
+    // Replayed once only
+    EXPECT_EQ(after.getRecoveredCount(), 0u);
+    EXPECT_EQ(after.replay(capture), 0u);
+}
+
+TEST_F(RtcLogSinkTest, KeepsNewestRecords)
+{
+    {
+        RtcLogSink before(&ring_);
+        for (uint32_t i = 0; i < LOPCORE_RTC_LOG_SLOTS + 5; ++i)
+        {
+            std::string text = "line " + std::to_string(i);
+            before.write(makeMessage("App", text.c_str(), i));
+        }
+    }
+
+    RtcLogSink after(&ring_);
+    CaptureSink capture(captured_);
+    ASSERT_EQ(after.replay(capture), static_cast<size_t>(LOPCORE_RTC_LOG_SLOTS));
+    EXPECT_EQ(captured_.front(), "App@5:line 5");
+    EXPECT_EQ(captured_.back(), "App@" + std::to_string(LOPCORE_RTC_LOG_SLOTS + 4) + ":line " +
+                                    std::to_string(LOPCORE_RTC_LOG_SLOTS + 4));
+}
+
+TEST_F(RtcLogSinkTest, TornSlotIsSkipped)
+{
+    {
+        RtcLogSink before(&ring_);
+        before.write(makeMessage("App", "one", 1));
+        before.write(makeMessage("App", "two", 2));
+        before.write(makeMessage("App", "three", 3));
+    }
+
+    // Reset hit in the middle of writing "two"
+    for (auto &slot : ring_.slots)
+    {
+        if (slot.sequence != 0 && strcmp(slot.message, "two") == 0)
+        {
+            slot.sequence = 0;
+        }
+    }
+
+    RtcLogSink after(&ring_);
+    CaptureSink capture(captured_);
+    EXPECT_EQ(after.replay(capture), 2u);
+    ASSERT_EQ(captured_.size(), 2u);
+    EXPECT_EQ(captured_[0], "App@1:one");
+    EXPECT_EQ(captured_[1], "App@3:three");
+}
+
+TEST_F(RtcLogSinkTest, LongFieldsAreTruncated)
+{
+    std::string longText(300, 'x');
+    {
+        RtcLogSink before(&ring_);
+        before.write(makeMessage("AVeryLongComponentTag", longText.c_str(), 7));
+    }
+
+    RtcLogSink after(&ring_);
+    CaptureSink capture(captured_);
+    ASSERT_EQ(after.replay(capture), 1u);
+    std::string expected = std::string("AVeryLongComp") + "@7:" + std::string(RTC_LOG_MESSAGE_SIZE - 1, 'x');
+    EXPECT_EQ(captured_[0], expected);
+}
+
+TEST_F(RtcLogSinkTest, CurrentBootIsKeptForNextReplay)
+{
+    {
+        RtcLogSink first(&ring_);
+        first.write(makeMessage("App", "boot 1", 1));
+    }
+    {
+        RtcLogSink second(&ring_);
+        CaptureSink capture(captured_);
+        EXPECT_EQ(second.replay(capture), 1u);
+        second.write(makeMessage("App", "boot 2", 2));
+    }
+
+    captured_.clear();
+    RtcLogSink third(&ring_);
+    CaptureSink capture(captured_);
+    EXPECT_EQ(third.replay(capture), 1u);
+    ASSERT_EQ(captured_.size(), 1u);
+    EXPECT_EQ(captured_[0], "App@2:boot 2");
+}
+
+TEST_F(RtcLogSinkTest, ReplayIntoLoggerSkipsItself)
+{
+    {
+        RtcLogSink before(&ring_);
+        before.write(makeMessage("App", "before reset", 42, LogLevel::WARN));
+    }
+
+    auto &logger = Logger::getInstance();
+    logger.clearSinks();
+    logger.setGlobalLevel(LogLevel::INFO);
+    logger.addSink(std::make_unique<CaptureSink>(captured_));
+
+    auto rtc = std::make_unique<RtcLogSink>(&ring_);
+    RtcLogSink *raw = rtc.get();
+    logger.addSink(std::move(rtc));
+
+    EXPECT_EQ(raw->replay(logger), 1u);
+    ASSERT_EQ(captured_.size(), 2u);
+    EXPECT_EQ(captured_[0].rfind("RtcLogSink@", 0), 0u);
+    EXPECT_EQ(captured_[1], "App@42:before reset");
+
+    // Only the marker line was recorded for the next boot, not the replayed record
+    logger.clearSinks();
+    RtcLogSink next(&ring_);
+    EXPECT_EQ(next.getRecoveredCount(), 1u);
+}
@@ -0,0 +1,248 @@
+/**
+ * @file test_sink_snapshot.cpp
+ * @brief Unit tests for the Logger sink list snapshot and lock-free fan-out
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/logging/logger.hpp"
+
+using namespace lopcore;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+/**
+ * @brief Sink that counts writes and flags overlapping calls
+ */
+class CountingSink : public ILogSink
+{
+public:
+    CountingSink(std::atomic<uint32_t> &writes,
+                 std::atomic<bool> &overlapped,
+                 std::atomic<bool> *destroyed = nullptr)
+        : writes_(writes), overlapped_(overlapped), destroyed_(destroyed)
+    {
+    }
+
+    ~CountingSink() override
+    {
+        if (destroyed_ != nullptr)
+        {
+            destroyed_->store(true);
+        }
+    }
+
+    void write(const LogMessage &msg) override
+    {
+        (void) msg;
+        if (inside_.exchange(true))
+        {
+            overlapped_.store(true);
+        }
+        writes_.fetch_add(1);
+        std::this_thread::yield();
+        inside_.store(false);
+    }
+
+    void flush() override
+    {
+    }
+
+    const char *getName() const override
+    {
+        return "CountingSink";
+    }
+
+private:
+    std::atomic<uint32_t> &writes_;
+    std::atomic<bool> &overlapped_;
+    std::atomic<bool> *destroyed_;
+    std::atomic<bool> inside_{false};
+};
+
+/**
+ * @brief Sink whose write() blocks until released
+ */
+class BlockingSink : public ILogSink
+{
+public:
+    void write(const LogMessage &msg) override
+    {
+        (void) msg;
+        std::unique_lock<std::mutex> lock(mutex_);
+        entered_ = true;
+        cv_.notify_all();
+        cv_.wait(lock, [this] { return released_; });
+    }
+
+    void flush() override
+    {
+    }
+
+    const char *getName() const override
+    {
+        return "BlockingSink";
+    }
+
+    bool waitEntered()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, 2s, [this] { return entered_; });
+    }
+
+    void release()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        released_ = true;
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool entered_ = false;
+    bool released_ = false;
+};
+
+} // namespace
+
+class SinkSnapshotTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        logger_.clearSinks();
+        logger_.clearTagLevels();
+        logger_.setGlobalLevel(LogLevel::INFO);
+    }
+
+    void TearDown() override
+    {
+        logger_.clearSinks();
+    }
+
+    Logger &logger_ = Logger::getInstance();
+};
+
+TEST_F(SinkSnapshotTest, ConcurrentLoggingReachesEverySink)
+{
+    std::atomic<uint32_t> writes{0};
+    std::atomic<bool> overlapped{false};
+    logger_.addSink(std::make_unique<CountingSink>(writes, overlapped));
+    logger_.addSink(std::make_unique<CountingSink>(writes, overlapped));
+
+    constexpr int THREADS = 4;
+    constexpr int PER_THREAD = 500;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t)
+    {
+        threads.emplace_back([this] {
+            for (int i = 0; i < PER_THREAD; ++i)
+            {
+                logger_.info("Snap", "message %d", i);
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(writes.load(), 2u * THREADS * PER_THREAD);
+    // Each sink still sees one write() at a time
+    EXPECT_FALSE(overlapped.load());
+}
+
+TEST_F(SinkSnapshotTest, SinksCanBeSwappedWhileLogging)
+{
+    std::atomic<bool> stop{false};
+    std::atomic<uint32_t> writes{0};
+    std::atomic<bool> overlapped{false};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 2; ++t)
+    {
+        threads.emplace_back([this, &stop] {
+            while (!stop.load())
+            {
+                logger_.info("Snap", "busy");
+            }
+        });
+    }
+
+    for (int i = 0; i < 200; ++i)
+    {
+        logger_.addSink(std::make_unique<CountingSink>(writes, overlapped));
+        logger_.addSink(std::make_unique<CountingSink>(writes, overlapped));
+        EXPECT_EQ(logger_.getSinkCount(), 2u);
+        logger_.clearSinks();
+    }
+
+    stop.store(true);
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(logger_.getSinkCount(), 0u);
+    EXPECT_FALSE(overlapped.load());
+}
+
+TEST_F(SinkSnapshotTest, ClearWaitsForInFlightWrite)
+{
+    auto blocking = std::make_unique<BlockingSink>();
+    BlockingSink *raw = blocking.get();
+    logger_.addSink(std::move(blocking));
+
+    std::atomic<uint32_t> writes{0};
+    std::atomic<bool> overlapped{false};
+    std::atomic<bool> destroyed{false};
+    logger_.addSink(std::make_unique<CountingSink>(writes, overlapped, &destroyed));
+
+    std::thread writer([this] { logger_.info("Snap", "in flight"); });
+    ASSERT_TRUE(raw->waitEntered());
+
+    std::atomic<bool> cleared{false};
+    std::thread clearer([this, &cleared] {
+        logger_.clearSinks();
+        cleared.store(true);
+    });
+
+    // The writer still holds the old snapshot, so nothing may be freed yet
+    std::this_thread::sleep_for(50ms);
+    EXPECT_FALSE(cleared.load());
+    EXPECT_FALSE(destroyed.load());
+
+    raw->release();
+    writer.join();
+    clearer.join();
+
+    EXPECT_TRUE(cleared.load());
+    EXPECT_TRUE(destroyed.load());
+    EXPECT_EQ(writes.load(), 1u);
+}
+
+TEST_F(SinkSnapshotTest, GlobalLevelUpdatesWithoutLock)
+{
+    std::atomic<uint32_t> writes{0};
+    std::atomic<bool> overlapped{false};
+    logger_.addSink(std::make_unique<CountingSink>(writes, overlapped));
+
+    logger_.setGlobalLevel(LogLevel::WARN);
+    EXPECT_EQ(logger_.getGlobalLevel(), LogLevel::WARN);
+    logger_.info("Snap", "filtered");
+    logger_.warn("Snap", "kept");
+    EXPECT_EQ(writes.load(), 1u);
+
+    logger_.setGlobalLevel(LogLevel::INFO);
+    logger_.info("Snap", "kept");
+    EXPECT_EQ(writes.load(), 2u);
+}
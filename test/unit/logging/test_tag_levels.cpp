@@ -0,0 +1,213 @@
+/**
+ * @file test_tag_levels.cpp
+ * @brief Unit tests for per-tag log level filtering and the tag lookup cache
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/logging/log_tag_cache.hpp"
+#include "lopcore/logging/logger.hpp"
+
+using namespace lopcore;
+
+namespace
+{
+
+class CaptureSink : public ILogSink
+{
+public:
+    explicit CaptureSink(std::vector<std::string> &out) : out_(out)
+    {
+    }
+
+    void write(const LogMessage &msg) override
+    {
+        out_.push_back(std::string(msg.tag) + ":" + msg.message);
+    }
+
+    void flush() override
+    {
+    }
+
+    const char *getName() const override
+    {
+        return "CaptureSink";
+    }
+
+private:
+    std::vector<std::string> &out_;
+};
+
+} // namespace
+
+// ============================================================================
+// LogTagCache
+// ============================================================================
+
+TEST(LogTagCacheTest, LookupIsByPointerIdentity)
+{
+    LogTagCache cache;
+    static const char TAG_A[] = "MQTT";
+    static const char TAG_B[] = "MQTT";
+
+    uint8_t level = 0;
+    EXPECT_FALSE(cache.lookup(TAG_A, level));
+
+    EXPECT_TRUE(cache.insert(TAG_A, static_cast<uint8_t>(LogLevel::DEBUG)));
+    ASSERT_TRUE(cache.lookup(TAG_A, level));
+    EXPECT_EQ(level, static_cast<uint8_t>(LogLevel::DEBUG));
+
+    // Same contents, different pointer: not a hit
+    EXPECT_FALSE(cache.lookup(TAG_B, level));
+}
+
+TEST(LogTagCacheTest, ClearDropsEntries)
+{
+    LogTagCache cache;
+    static const char TAG[] = "Storage";
+    cache.insert(TAG, LogTagCache::TAG_LEVEL_INHERIT);
+
+    uint8_t level = 0;
+    ASSERT_TRUE(cache.lookup(TAG, level));
+    EXPECT_EQ(level, LogTagCache::TAG_LEVEL_INHERIT);
+
+    cache.clear();
+    EXPECT_FALSE(cache.lookup(TAG, level));
+}
+
+TEST(LogTagCacheTest, FullProbeWindowRejectsInsert)
+{
+    LogTagCache cache;
+    static char tags[256][2];
+
+    size_t stored = 0;
+    for (auto &tag : tags)
+    {
+        stored += cache.insert(tag, 1) ? 1 : 0;
+    }
+    EXPECT_LE(stored, LogTagCache::CAPACITY);
+
+    // Every stored entry is still found
+    size_t found = 0;
+    for (auto &tag : tags)
+    {
+        uint8_t level;
+        found += cache.lookup(tag, level) ? 1 : 0;
+    }
+    EXPECT_EQ(found, stored);
+}
+
+// ============================================================================
+// Logger per-tag levels
+// ============================================================================
+
+class TagLevelTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        auto &logger = Logger::getInstance();
+        logger.clearSinks();
+        logger.clearTagLevels();
+        logger.setGlobalLevel(LogLevel::INFO);
+        logger.addSink(std::make_unique<CaptureSink>(received_));
+    }
+
+    void TearDown() override
+    {
+        auto &logger = Logger::getInstance();
+        logger.clearTagLevels();
+        logger.clearSinks();
+    }
+
+    std::vector<std::string> received_;
+};
+
+TEST_F(TagLevelTest, SetTagLevelDoesNotChangeGlobalLevel)
+{
+    auto &logger = Logger::getInstance();
+    logger.setTagLevel("MQTT", LogLevel::DEBUG);
+    EXPECT_EQ(logger.getGlobalLevel(), LogLevel::INFO);
+}
+
+TEST_F(TagLevelTest, TagOverrideRaisesOnlyThatTag)
+{
+    auto &logger = Logger::getInstance();
+    logger.setTagLevel("MQTT", LogLevel::DEBUG);
+
+    logger.debug("MQTT", "a");
+    logger.debug("Storage", "b");
+    logger.info("Storage", "c");
+
+    ASSERT_EQ(received_.size(), 2u);
+    EXPECT_EQ(received_[0], "MQTT:a");
+    EXPECT_EQ(received_[1], "Storage:c");
+}
+
+TEST_F(TagLevelTest, TagOverrideCanSilenceTag)
+{
+    auto &logger = Logger::getInstance();
+    logger.setTagLevel("Noisy", LogLevel::ERROR);
+
+    logger.warn("Noisy", "dropped");
+    logger.error("Noisy", "kept");
+    logger.warn("Other", "kept");
+
+    ASSERT_EQ(received_.size(), 2u);
+    EXPECT_EQ(received_[0], "Noisy:kept");
+}
+
+TEST_F(TagLevelTest, MatchesByContentsAcrossPointers)
+{
+    auto &logger = Logger::getInstance();
+    std::string configured = "Shadow";
+    logger.setTagLevel(configured.c_str(), LogLevel::VERBOSE);
+
+    static const char TAG[] = "Shadow";
+    logger.verbose(TAG, "first");
+    logger.verbose(TAG, "cached");
+
+    ASSERT_EQ(received_.size(), 2u);
+}
+
+TEST_F(TagLevelTest, ChangingOverrideInvalidatesCache)
+{
+    auto &logger = Logger::getInstance();
+    static const char TAG[] = "Ota";
+    logger.setTagLevel(TAG, LogLevel::DEBUG);
+    logger.debug(TAG, "one");
+
+    logger.setTagLevel(TAG, LogLevel::WARN);
+    logger.debug(TAG, "two");
+    logger.info(TAG, "three");
+
+    ASSERT_EQ(received_.size(), 1u);
+    EXPECT_EQ(received_[0], "Ota:one");
+}
+
+TEST_F(TagLevelTest, InheritingTagsFollowGlobalChanges)
+{
+    auto &logger = Logger::getInstance();
+    logger.setTagLevel("MQTT", LogLevel::ERROR);
+
+    static const char TAG[] = "App";
+    logger.debug(TAG, "hidden");
+    logger.setGlobalLevel(LogLevel::DEBUG);
+    logger.debug(TAG, "shown");
+
+    ASSERT_EQ(received_.size(), 1u);
+    EXPECT_EQ(received_[0], "App:shown");
+}
+
+TEST_F(TagLevelTest, ClearTagLevelsRestoresGlobalFiltering)
+{
+    auto &logger = Logger::getInstance();
+    logger.setTagLevel("MQTT", LogLevel::DEBUG);
+    logger.clearTagLevels();
+
+    logger.debug("MQTT", "hidden");
+    EXPECT_TRUE(received_.empty());
+}
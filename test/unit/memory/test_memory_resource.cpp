@@ -0,0 +1,229 @@
+/**
+ * @file test_memory_resource.cpp
+ * @brief Unit tests for the library-wide memory resources
+ */
+
+#include <cstdint>
+#include <memory_resource>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/memory/memory_resource.hpp"
+
+using namespace lopcore::memory;
+
+namespace
+{
+
+/**
+ * @brief Upstream that counts what passes through it
+ */
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    size_t allocations = 0;
+    size_t live = 0;
+    bool fail = false;
+
+protected:
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        if (fail)
+        {
+            throw std::bad_alloc();
+        }
+        allocations++;
+        live++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override
+    {
+        live--;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+struct Tracked
+{
+    explicit Tracked(int value, int *destroyed) : value(value), destroyed(destroyed)
+    {
+    }
+
+    ~Tracked()
+    {
+        (*destroyed)++;
+    }
+
+    int value;
+    int *destroyed;
+};
+
+} // namespace
+
+TEST(MemoryResourceTest, RolesDefaultAndCanBeReplaced)
+{
+    EXPECT_EQ(getResource(MemoryRole::HOT), internalResource());
+    EXPECT_NE(getResource(MemoryRole::BULK), nullptr);
+
+    CountingResource counting;
+    setResource(MemoryRole::BULK, &counting);
+    EXPECT_EQ(getResource(MemoryRole::BULK), &counting);
+    EXPECT_EQ(getResource(MemoryRole::HOT), internalResource());
+
+    {
+        Buffer buffer;
+        ASSERT_TRUE(buffer.allocate(256));
+        EXPECT_EQ(buffer.size(), 256u);
+        EXPECT_EQ(counting.live, 1u);
+
+        // Same size keeps the allocation
+        ASSERT_TRUE(buffer.allocate(256));
+        EXPECT_EQ(counting.allocations, 1u);
+    }
+    EXPECT_EQ(counting.live, 0u);
+
+    setResource(MemoryRole::BULK, nullptr);
+    EXPECT_NE(getResource(MemoryRole::BULK), &counting);
+}
+
+TEST(MemoryResourceTest, BufferReportsExhaustion)
+{
+    CountingResource counting;
+    counting.fail = true;
+    Buffer buffer(&counting);
+    EXPECT_FALSE(buffer.allocate(64));
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(buffer.data(), nullptr);
+    EXPECT_TRUE(buffer.allocate(0));
+}
+
+TEST(MemoryResourceTest, BufferMovesOwnership)
+{
+    CountingResource counting;
+    Buffer first(&counting);
+    ASSERT_TRUE(first.allocate(32));
+    uint8_t *data = first.data();
+
+    Buffer second(std::move(first));
+    EXPECT_EQ(second.data(), data);
+    EXPECT_TRUE(first.empty());
+
+    Buffer third(&counting);
+    ASSERT_TRUE(third.allocate(16));
+    third = std::move(second);
+    EXPECT_EQ(third.data(), data);
+    EXPECT_EQ(counting.live, 1u);
+}
+
+TEST(MemoryResourceTest, MakeUniqueUsesRoleResource)
+{
+    CountingResource counting;
+    setResource(MemoryRole::HOT, &counting);
+    int destroyed = 0;
+    {
+        auto object = makeUnique<Tracked>(MemoryRole::HOT, 7, &destroyed);
+        ASSERT_TRUE(object);
+        EXPECT_EQ(object->value, 7);
+        EXPECT_EQ(counting.live, 1u);
+    }
+    EXPECT_EQ(destroyed, 1);
+    EXPECT_EQ(counting.live, 0u);
+
+    counting.fail = true;
+    EXPECT_FALSE(makeUnique<Tracked>(MemoryRole::HOT, 1, &destroyed));
+    setResource(MemoryRole::HOT, nullptr);
+}
+
+TEST(MemoryResourceTest, MakeUniqueValueInitializes)
+{
+    struct Plain
+    {
+        int a;
+        char b[16];
+    };
+    auto plain = makeUnique<Plain>(MemoryRole::HOT);
+    ASSERT_TRUE(plain);
+    EXPECT_EQ(plain->a, 0);
+    EXPECT_EQ(plain->b[15], 0);
+}
+
+TEST(FixedBlockResourceTest, RecyclesBlocksWithoutUpstream)
+{
+    CountingResource upstream;
+    FixedBlockResource pool(100, 3, &upstream);
+    EXPECT_EQ(upstream.allocations, 1u);
+    EXPECT_GE(pool.blockSize(), 100u);
+    EXPECT_EQ(pool.blockSize() % alignof(std::max_align_t), 0u);
+    EXPECT_EQ(pool.available(), 3u);
+
+    std::set<void *> seen;
+    for (int round = 0; round < 10; round++)
+    {
+        void *a = pool.allocate(100);
+        void *b = pool.allocate(40, 8);
+        seen.insert(a);
+        seen.insert(b);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % alignof(std::max_align_t), 0u);
+        pool.deallocate(b, 40, 8);
+        pool.deallocate(a, 100);
+    }
+    EXPECT_LE(seen.size(), 3u);
+    EXPECT_EQ(upstream.allocations, 1u);
+    EXPECT_EQ(pool.overflows(), 0u);
+}
+
+TEST(FixedBlockResourceTest, OverflowGoesUpstream)
+{
+    CountingResource upstream;
+    FixedBlockResource pool(64, 2, &upstream);
+
+    void *big = pool.allocate(65);
+    EXPECT_EQ(upstream.live, 2u);
+
+    void *a = pool.allocate(8);
+    void *b = pool.allocate(8);
+    void *c = pool.allocate(8);
+    EXPECT_EQ(pool.available(), 0u);
+    EXPECT_EQ(pool.overflows(), 2u);
+    EXPECT_EQ(upstream.live, 3u);
+
+    pool.deallocate(c, 8);
+    pool.deallocate(big, 65);
+    EXPECT_EQ(upstream.live, 1u);
+    pool.deallocate(a, 8);
+    pool.deallocate(b, 8);
+    EXPECT_EQ(pool.available(), 2u);
+}
+
+TEST(FixedBlockResourceTest, ServesPmrContainers)
+{
+    FixedBlockResource pool(sizeof(int) * 16, 4);
+    {
+        std::pmr::vector<int> values(&pool);
+        values.reserve(16);
+        for (int i = 0; i < 16; i++)
+        {
+            values.push_back(i);
+        }
+        EXPECT_EQ(values[15], 15);
+        EXPECT_EQ(pool.available(), 3u);
+    }
+    EXPECT_EQ(pool.available(), 4u);
+}
+
+TEST(FixedBlockResourceTest, EmptyWhenUpstreamFails)
+{
+    CountingResource upstream;
+    upstream.fail = true;
+    FixedBlockResource pool(32, 4, &upstream);
+    EXPECT_EQ(pool.capacity(), 0u);
+    EXPECT_EQ(pool.available(), 0u);
+}
@@ -0,0 +1,429 @@
+/**
+ * @file test_metrics.cpp
+ * @brief Unit tests for the metrics registry and exporter
+ */
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/logging/logger.hpp"
+#include "lopcore/metrics/metrics_exporter.hpp"
+#include "lopcore/metrics/metrics_registry.hpp"
+#include "lopcore/mqtt/mqtt_budget_scheduler.hpp"
+#include "lopcore/mqtt/mqtt_metrics.hpp"
+#include "mqtt/mock_mqtt_client.hpp"
+
+using namespace lopcore::metrics;
+using lopcore::test::MockMqttClient;
+
+namespace
+{
+
+int64_t fakeNowUs = 0;
+
+int64_t fakeClock()
+{
+    return fakeNowUs;
+}
+
+/**
+ * @brief Render CBOR as JSON-like text, enough to compare exports
+ */
+class CborText
+{
+public:
+    explicit CborText(const std::vector<uint8_t> &data) : data_(data)
+    {
+    }
+
+    std::string render()
+    {
+        std::string out;
+        item(out);
+        return pos_ == data_.size() ? out : "<trailing bytes>";
+    }
+
+private:
+    uint64_t argument(uint8_t info)
+    {
+        if (info < 24)
+        {
+            return info;
+        }
+        size_t bytes = size_t(1) << (info - 24);
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; i++)
+        {
+            value = (value << 8) | data_.at(pos_++);
+        }
+        return value;
+    }
+
+    void item(std::string &out)
+    {
+        uint8_t first = data_.at(pos_++);
+        uint64_t value = argument(first & 0x1F);
+        switch (first >> 5)
+        {
+        case 0:
+            out += std::to_string(value);
+            break;
+        case 1:
+            out += std::to_string(-1 - static_cast<int64_t>(value));
+            break;
+        case 3:
+            out += "\"" + std::string(data_.begin() + pos_, data_.begin() + pos_ + value) + "\"";
+            pos_ += value;
+            break;
+        case 4:
+            out += "[";
+            for (uint64_t i = 0; i < value; i++)
+            {
+                out += i > 0 ? "," : "";
+                item(out);
+            }
+            out += "]";
+            break;
+        case 5:
+            out += "{";
+            for (uint64_t i = 0; i < value; i++)
+            {
+                out += i > 0 ? "," : "";
+                item(out);
+                out += ":";
+                item(out);
+            }
+            out += "}";
+            break;
+        default:
+            out += "?";
+        }
+    }
+
+    const std::vector<uint8_t> &data_;
+    size_t pos_ = 0;
+};
+
+std::vector<std::string> exported(MockMqttClient &mock, const std::string &topic)
+{
+    std::vector<std::string> messages;
+    for (const auto &message : mock.takePublished())
+    {
+        EXPECT_EQ(message.topic, topic);
+        messages.push_back(CborText(message.payload).render());
+    }
+    return messages;
+}
+
+} // namespace
+
+TEST(MetricsRegistryTest, CountersGaugesHistograms)
+{
+    MetricsRegistry registry;
+    Counter &writes = registry.counter("writes");
+    EXPECT_EQ(&writes, &registry.counter("writes"));
+    writes.add();
+    writes.add(4);
+    registry.gauge("depth").set(-3);
+
+    Histogram &latency = registry.histogram("latency", {10, 100});
+    latency.record(5);
+    latency.record(10);
+    latency.record(50);
+    latency.record(1000);
+    HistogramSnapshot snapshot = latency.snapshot();
+    EXPECT_EQ(snapshot.buckets, 3u);
+    EXPECT_EQ(snapshot.counts[0], 2u);
+    EXPECT_EQ(snapshot.counts[1], 1u);
+    EXPECT_EQ(snapshot.counts[2], 1u);
+    EXPECT_EQ(snapshot.count, 4u);
+    EXPECT_EQ(snapshot.sum, 1065u);
+    EXPECT_EQ(snapshot.max, 1000u);
+
+    std::vector<std::string> names;
+    std::vector<int64_t> values;
+    registry.forEach([&](const MetricView &metric) {
+        names.emplace_back(metric.name);
+        values.push_back(metric.value);
+    });
+    EXPECT_EQ(names, (std::vector<std::string>{"writes", "depth", "latency"}));
+    EXPECT_EQ(values, (std::vector<int64_t>{5, -3, 0}));
+}
+
+TEST(MetricsRegistryTest, TypeClashAndCapacityGiveScratch)
+{
+    MetricsRegistry registry(2);
+    registry.counter("a").add(1);
+    Gauge &clash = registry.gauge("a");
+    clash.set(9);
+    registry.gauge("b");
+    registry.counter("c").add(7);
+    EXPECT_EQ(registry.size(), 2u);
+
+    int64_t a = 0;
+    registry.forEach([&](const MetricView &metric) {
+        if (metric.name == "a")
+        {
+            a = metric.value;
+        }
+    });
+    EXPECT_EQ(a, 1);
+}
+
+TEST(MetricsRegistryTest, SampledMetricsFollowRegistration)
+{
+    MetricsRegistry registry;
+    uint64_t total = 41;
+    {
+        Registration registration = registry.sampledCounter("total", [&] { return total; });
+        ASSERT_TRUE(registration);
+        EXPECT_FALSE(registry.sampledGauge("total", [] { return 0; }));
+
+        total++;
+        int64_t seen = 0;
+        registry.forEach([&](const MetricView &metric) {
+            seen = metric.value;
+            EXPECT_TRUE(metric.sampled);
+        });
+        EXPECT_EQ(seen, 42);
+    }
+    EXPECT_EQ(registry.size(), 0u);
+}
+
+TEST(MetricsRegistryTest, MqttMetricsRegister)
+{
+    MetricsRegistry registry;
+    {
+        lopcore::mqtt::MqttMetrics mqtt;
+        mqtt.registerMetrics(registry, "mqtt");
+        mqtt.increment(lopcore::mqtt::MqttCounter::MESSAGES_PUBLISHED, 3);
+        EXPECT_EQ(registry.size(), 7u);
+
+        int64_t published = 0;
+        registry.forEach([&](const MetricView &metric) {
+            if (metric.name == "mqtt.published")
+            {
+                published = metric.value;
+            }
+        });
+        EXPECT_EQ(published, 3);
+    }
+    EXPECT_EQ(registry.size(), 0u);
+}
+
+TEST(MetricsRegistryTest, BudgetsRegisterRemaining)
+{
+    lopcore::mqtt::BudgetConfig config;
+    config.enabled = true;
+    config.defaultBudget = 5;
+    config.maxBudget = 5;
+    config.reviveRate = 1.0f;
+    lopcore::mqtt::BudgetClassConfig alarms;
+    alarms.name = "alarms";
+    alarms.topicPrefixes = {"dev/alarm/"};
+    alarms.budget = config;
+    alarms.budget.defaultBudget = 2;
+
+    MetricsRegistry registry;
+    {
+        fakeNowUs = 0;
+        lopcore::mqtt::MqttBudget global(config, fakeClock);
+        lopcore::mqtt::MqttBudgetScheduler scheduler({alarms}, &global, fakeClock);
+        global.registerMetrics(registry, "mqtt.budget");
+        scheduler.registerMetrics(registry, "mqtt.budget");
+        EXPECT_EQ(registry.size(), 2u);
+        ASSERT_TRUE(global.consume(3));
+
+        std::map<std::string, int64_t> values;
+        registry.forEach([&](const MetricView &metric) {
+            EXPECT_EQ(metric.type, MetricType::GAUGE);
+            values[std::string(metric.name)] = metric.value;
+        });
+        EXPECT_EQ(values["mqtt.budget.remaining"], 2);
+        EXPECT_EQ(values["mqtt.budget.alarms.remaining"], 2);
+    }
+    EXPECT_EQ(registry.size(), 0u);
+}
+
+TEST(MetricsRegistryTest, LoggerRegistersRecordCounts)
+{
+    auto &logger = lopcore::Logger::getInstance();
+    logger.resetStats();
+    MetricsRegistry registry;
+    {
+        auto registrations = logger.registerMetrics(registry, "log");
+        EXPECT_EQ(registry.size(), 2u);
+        logger.info("metrics", "counted");
+
+        std::map<std::string, int64_t> values;
+        registry.forEach([&](const MetricView &metric) {
+            EXPECT_EQ(metric.type, MetricType::COUNTER);
+            values[std::string(metric.name)] = metric.value;
+        });
+        EXPECT_EQ(values["log.emitted"], 1);
+        EXPECT_EQ(values["log.dropped"], 0);
+    }
+    EXPECT_EQ(registry.size(), 0u);
+}
+
+class MetricsExporterTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        fakeNowUs = 0;
+        mock = std::make_shared<MockMqttClient>();
+        config.topic = "fleet/dev/metrics";
+        config.intervalMs = 1000;
+    }
+
+    std::shared_ptr<MockMqttClient> mock;
+    MetricsExporterConfig config;
+    MetricsRegistry registry;
+};
+
+TEST_F(MetricsExporterTest, ExportsDeltasOnSchedule)
+{
+    MetricsExporter exporter(mock, config, registry, fakeClock);
+    Counter &sent = registry.counter("sent");
+    Gauge &queue = registry.gauge("queue");
+    Histogram &latency = registry.histogram("lat", {10, 100});
+
+    sent.add(5);
+    queue.set(-2);
+    latency.record(7);
+    latency.record(500);
+
+    EXPECT_EQ(exporter.poll(), 1000u);
+    EXPECT_TRUE(mock->takePublished().empty());
+
+    fakeNowUs = 1000000;
+    EXPECT_EQ(exporter.poll(), 1000u);
+    auto messages = exported(*mock, config.topic);
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_EQ(messages[0], R"({"v":1,"s":0,"t":1,"c":{"sent":5},"g":{"queue":-2},"h":{"lat":[2,507,500,1,0,1]}})");
+
+    // Only what moved
+    sent.add(2);
+    latency.record(50);
+    fakeNowUs = 2000000;
+    exporter.poll();
+    messages = exported(*mock, config.topic);
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_EQ(messages[0], R"({"v":1,"s":1,"t":2,"c":{"sent":2},"h":{"lat":[1,50,500,0,1,0]}})");
+
+    // Nothing moved: nothing sent
+    fakeNowUs = 3000000;
+    exporter.poll();
+    EXPECT_TRUE(mock->takePublished().empty());
+    EXPECT_EQ(exporter.getStats().skipped, 1u);
+    EXPECT_EQ(exporter.getStats().exports, 2u);
+}
+
+TEST_F(MetricsExporterTest, FailedExportFoldsIntoNext)
+{
+    MetricsExporter exporter(mock, config, registry, fakeClock);
+    Counter &sent = registry.counter("sent");
+    sent.add(3);
+
+    mock->publishResult = ESP_ERR_NO_MEM;
+    EXPECT_EQ(exporter.exportNow(), ESP_ERR_NO_MEM);
+    EXPECT_EQ(exporter.getStats().failures, 1u);
+
+    mock->publishResult = ESP_OK;
+    sent.add(4);
+    ASSERT_EQ(exporter.exportNow(), ESP_OK);
+    auto messages = exported(*mock, config.topic);
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_EQ(messages[0], R"({"v":1,"s":0,"t":0,"c":{"sent":7}})");
+}
+
+TEST_F(MetricsExporterTest, CounterWrapAndSampledReset)
+{
+    MetricsExporter exporter(mock, config, registry, fakeClock);
+    Counter &wrapping = registry.counter("wrap");
+    uint64_t total = 100;
+    Registration registration = registry.sampledCounter("total", [&] { return total; });
+
+    wrapping.add(UINT32_MAX - 1);
+    ASSERT_EQ(exporter.exportNow(), ESP_OK);
+    mock->takePublished();
+
+    wrapping.add(5); // Wraps to 3
+    total = 10;      // Source was reset
+    ASSERT_EQ(exporter.exportNow(), ESP_OK);
+    auto messages = exported(*mock, config.topic);
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_EQ(messages[0], R"({"v":1,"s":1,"t":0,"c":{"wrap":5,"total":10}})");
+}
+
+TEST_F(MetricsExporterTest, DeviceDefenderLayout)
+{
+    config.format = MetricsExporterConfig::Format::DEVICE_DEFENDER;
+    config.thingName = "dev";
+    MetricsExporter exporter(mock, config, registry, fakeClock);
+    registry.counter("errors").add(2);
+    registry.histogram("lat", {10}).record(3);
+
+    ASSERT_EQ(exporter.exportNow(), ESP_OK);
+    auto published = mock->takePublished();
+    ASSERT_EQ(published.size(), 1u);
+    EXPECT_EQ(published[0].topic, "$aws/things/dev/defender/metrics/cbor");
+
+    std::string text = CborText(published[0].payload).render();
+    EXPECT_EQ(text.substr(0, 14), R"({"hed":{"rid":)");
+    EXPECT_NE(text.find(R"("v":"1.0"},"cmet":{"errors":[{"number":2}],"lat":[{"number_list":[1,0]}]}})"),
+              std::string::npos);
+}
+
+TEST_F(MetricsExporterTest, OversizedExportIsSplitAcrossIntervals)
+{
+    config.maxPayloadSize = 48;
+    MetricsExporter exporter(mock, config, registry, fakeClock);
+    registry.counter("first_long_counter_name").add(1);
+    registry.counter("second_long_counter_name").add(1);
+
+    ASSERT_EQ(exporter.exportNow(), ESP_OK);
+    auto messages = exported(*mock, config.topic);
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_EQ(messages[0], R"({"v":1,"s":0,"t":0,"c":{"first_long_counter_name":1}})");
+    EXPECT_EQ(exporter.getStats().truncated, 1u);
+
+    ASSERT_EQ(exporter.exportNow(), ESP_OK);
+    messages = exported(*mock, config.topic);
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_EQ(messages[0], R"({"v":1,"s":1,"t":0,"c":{"second_long_counter_name":1}})");
+}
+
+TEST_F(MetricsExporterTest, TaskExportsInBackground)
+{
+    config.intervalMs = 10;
+    MetricsExporter exporter(mock, config, registry);
+    registry.counter("ticks").add(1);
+    ASSERT_EQ(exporter.start(), ESP_OK);
+    EXPECT_EQ(exporter.start(), ESP_ERR_INVALID_STATE);
+
+    for (int i = 0; i < 200 && exporter.getStats().exports == 0; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    exporter.stop();
+    EXPECT_EQ(exporter.getStats().exports, 1u);
+}
+
+TEST(MetricsExporterConfigTest, Validation)
+{
+    MetricsExporterConfig config;
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+    config.topic = "t";
+    EXPECT_EQ(config.validate(), ESP_OK);
+    config.format = MetricsExporterConfig::Format::DEVICE_DEFENDER;
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+    config.thingName = "dev";
+    EXPECT_EQ(config.validate(), ESP_OK);
+}
@@ -0,0 +1,221 @@
+/**
+ * @file test_coremqtt_agent_client.cpp
+ * @brief Unit tests for the coreMQTT-Agent client's command queue and pool
+ *
+ * Built with a 2-command queue, a 4-command pool and a 50 ms command
+ * timeout (see CMakeLists.txt) so both can be filled from a few threads.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "core_mqtt_agent.h"
+#include "lopcore/mqtt/coremqtt_agent_client.hpp"
+#include "tls/mock_tls_transport.hpp"
+
+using namespace lopcore::mqtt;
+
+namespace
+{
+
+/**
+ * @brief Connected mock transport with a network context for the client to copy
+ */
+class AgentTransport : public lopcore::test::MockTlsTransport
+{
+public:
+    AgentTransport()
+    {
+        connect(lopcore::tls::TlsConfig{});
+    }
+
+    void *getNetworkContext() noexcept override
+    {
+        return &context_;
+    }
+
+private:
+    NetworkContext_t context_{};
+};
+
+bool waitFor(const std::function<bool()> &done)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (!done())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+std::vector<uint8_t> bytes(const std::string &text)
+{
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+} // namespace
+
+class CoreMqttAgentClientTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        MockMqttAgent::reset();
+        MqttConfig config;
+        config.broker = "broker.local";
+        config.clientId = "agent-test";
+        client = std::make_unique<CoreMqttAgentClient>(config, std::make_shared<AgentTransport>());
+        ASSERT_EQ(client->connect(), ESP_OK);
+    }
+
+    void TearDown() override
+    {
+        MockMqttAgent::setPaused(false);
+        MockMqttAgent::setHoldAcks(false);
+        MockMqttAgent::acknowledge();
+        client.reset();
+    }
+
+    /**
+     * @brief Publish from a new thread; the result lands in result
+     */
+    std::thread publishAsync(const std::string &topic, MqttQos qos, std::atomic<esp_err_t> &result)
+    {
+        return std::thread([this, topic, qos, &result] { result = client->publishString(topic, "x", qos); });
+    }
+
+    std::unique_ptr<CoreMqttAgentClient> client;
+};
+
+TEST_F(CoreMqttAgentClientTest, CommandsCompleteThroughTheAgent)
+{
+    std::string received;
+    std::thread::id callbackThread;
+    ASSERT_EQ(client->subscribeView("cmd/+",
+                                    [&](const MqttMessageView &view) {
+                                        callbackThread = std::this_thread::get_id();
+                                        received = std::string(view.topic) + "=" +
+                                                   std::string(view.getPayloadAsStringView());
+                                    }),
+              ESP_OK);
+    ASSERT_EQ(client->publishString("dt/dev1", "21.5", MqttQos::AT_LEAST_ONCE), ESP_OK);
+
+    auto ran = MockMqttAgent::ran();
+    ASSERT_EQ(ran.size(), 2u);
+    EXPECT_EQ(ran[0].type, SUBSCRIBE);
+    EXPECT_EQ(ran[0].topic, "cmd/+");
+    EXPECT_EQ(ran[1].type, PUBLISH);
+    EXPECT_EQ(ran[1].topic, "dt/dev1");
+    EXPECT_EQ(ran[1].payload, bytes("21.5"));
+    EXPECT_EQ(ran[1].qos, MQTTQoS1);
+
+    MockMqttAgent::deliver("cmd/reboot", bytes("now"));
+    ASSERT_TRUE(waitFor([&] { return client->getMetrics().messagesReceived == 1; }));
+    EXPECT_EQ(received, "cmd/reboot=now");
+    EXPECT_NE(callbackThread, std::this_thread::get_id());
+
+    EXPECT_EQ(client->unsubscribe("cmd/+"), ESP_OK);
+    EXPECT_EQ(MockMqttAgent::ran().back().type, UNSUBSCRIBE);
+    EXPECT_EQ(client->getMetrics().messagesPublished, 1u);
+}
+
+TEST_F(CoreMqttAgentClientTest, FullQueueRejectsWithNoMemory)
+{
+    MockMqttAgent::setPaused(true);
+    std::atomic<esp_err_t> first{ESP_FAIL};
+    std::atomic<esp_err_t> second{ESP_FAIL};
+    std::thread a = publishAsync("dt/a", MqttQos::AT_MOST_ONCE, first);
+    std::thread b = publishAsync("dt/b", MqttQos::AT_MOST_ONCE, second);
+    bool queued = waitFor([] { return MockMqttAgent::submitted() == 2; });
+
+    // Both queue slots are taken; this one gives up after the command timeout
+    esp_err_t third = client->publishString("dt/c", "x");
+    MockMqttAgent::setPaused(false);
+    a.join();
+    b.join();
+
+    ASSERT_TRUE(queued);
+    EXPECT_EQ(third, ESP_ERR_NO_MEM);
+    EXPECT_EQ(first, ESP_OK);
+    EXPECT_EQ(second, ESP_OK);
+    EXPECT_EQ(client->getMetrics().publishErrors, 1u);
+}
+
+TEST_F(CoreMqttAgentClientTest, EmptyPoolRejectsWithNoMemory)
+{
+    // Each unacknowledged QoS 1 publish keeps its command out of the pool
+    MockMqttAgent::setHoldAcks(true);
+    std::atomic<esp_err_t> results[4] = {{ESP_FAIL}, {ESP_FAIL}, {ESP_FAIL}, {ESP_FAIL}};
+    std::vector<std::thread> publishers;
+    for (std::atomic<esp_err_t> &result : results)
+    {
+        publishers.push_back(publishAsync("dt/qos1", MqttQos::AT_LEAST_ONCE, result));
+    }
+    bool held = waitFor([] { return MockMqttAgent::awaitingAck() == 4; });
+
+    esp_err_t extra = client->publishString("dt/extra", "x");
+    MockMqttAgent::acknowledge();
+    for (std::thread &publisher : publishers)
+    {
+        publisher.join();
+    }
+
+    ASSERT_TRUE(held);
+    EXPECT_EQ(extra, ESP_ERR_NO_MEM);
+    for (std::atomic<esp_err_t> &result : results)
+    {
+        EXPECT_EQ(result, ESP_OK);
+    }
+
+    // Every command went back to the pool
+    MockMqttAgent::setHoldAcks(false);
+    EXPECT_EQ(client->publishString("dt/after", "x"), ESP_OK);
+}
+
+TEST_F(CoreMqttAgentClientTest, LostConnectionFailsWaitingCommands)
+{
+    std::atomic<bool> connected{true};
+    client->setConnectionCallback([&connected](bool up) { connected = up; });
+
+    MockMqttAgent::setHoldAcks(true);
+    std::atomic<esp_err_t> result{ESP_OK};
+    std::thread publisher = publishAsync("dt/qos1", MqttQos::AT_LEAST_ONCE, result);
+    bool held = waitFor([] { return MockMqttAgent::awaitingAck() == 1; });
+
+    // No TLS config to reconnect with, so the agent cancels everything and stops
+    MockMqttAgent::dropConnection(MQTTRecvFailed);
+    publisher.join();
+
+    ASSERT_TRUE(held);
+    EXPECT_EQ(result, ESP_FAIL);
+    EXPECT_FALSE(connected);
+    EXPECT_FALSE(client->isConnected());
+    EXPECT_EQ(client->publishString("dt/late", "x"), ESP_ERR_INVALID_STATE);
+}
+
+TEST_F(CoreMqttAgentClientTest, CallbackCannotWaitOnTheAgent)
+{
+    std::atomic<esp_err_t> nested{ESP_OK};
+    std::atomic<bool> called{false};
+    ASSERT_EQ(client->subscribe("cmd/ping",
+                                [&](const MqttMessage &) {
+                                    nested = client->publishString("cmd/pong", "x");
+                                    called = true;
+                                }),
+              ESP_OK);
+
+    MockMqttAgent::deliver("cmd/ping", bytes("1"));
+    ASSERT_TRUE(waitFor([&] { return called.load(); }));
+    EXPECT_EQ(nested, ESP_ERR_INVALID_STATE);
+}
@@ -2,16 +2,20 @@
  * @file test_mqtt_budget.cpp
  * @brief Unit tests for MQTT message budgeting
  *
- * Note: These tests focus on the budget logic without FreeRTOS timer functionality.
- * Timer-based restoration is tested in integration tests on hardware.
+ * The TestBudget tests cover the budget API contract; the MqttBudget tests
+ * drive the real token bucket from a fake clock.
  */
 
 #include <atomic>
 #include <chrono>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
-#include <mqtt/mqtt_config.hpp>
+
+#include "lopcore/mqtt/mqtt_budget.hpp"
+#include "lopcore/mqtt/mqtt_config.hpp"
 
 using namespace lopcore::mqtt;
 using namespace std::chrono_literals;
@@ -343,5 +347,200 @@ TEST(MqttBudgetTest, ConcurrentConsumeAndRestore)
     EXPECT_LE(remaining, 100);
 }
 
-// Note: FreeRTOS timer-based restoration is tested in integration tests
-// running on actual hardware with ESP-IDF environment
+// =============================================================================
+// Token Bucket Tests (real MqttBudget, fake clock)
+// =============================================================================
+
+namespace
+{
+
+int64_t fakeNowUs = 0;
+
+int64_t fakeClock()
+{
+    return fakeNowUs;
+}
+
+BudgetConfig bucketConfig(int32_t defaultBudget, int32_t maxBudget)
+{
+    BudgetConfig config;
+    config.enabled = true;
+    config.defaultBudget = defaultBudget;
+    config.maxBudget = maxBudget;
+    config.reviveCount = 1;
+    config.revivePeriod = std::chrono::seconds(1);
+    return config;
+}
+
+} // namespace
+
+class MqttTokenBucketTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        fakeNowUs = 1000000;
+    }
+};
+
+TEST_F(MqttTokenBucketTest, StartsWithDefaultBudget)
+{
+    MqttBudget budget(bucketConfig(5, 10), fakeClock);
+
+    EXPECT_EQ(budget.getRemaining(), 5);
+    EXPECT_EQ(budget.getIntervalUs(), 1000000);
+    EXPECT_EQ(budget.start(), ESP_OK);
+}
+
+TEST_F(MqttTokenBucketTest, RefillsFromElapsedTime)
+{
+    MqttBudget budget(bucketConfig(2, 10), fakeClock);
+
+    EXPECT_TRUE(budget.consume(2));
+    EXPECT_FALSE(budget.consume(1));
+
+    fakeNowUs += 999999;
+    EXPECT_FALSE(budget.isAvailable());
+
+    fakeNowUs += 1;
+    EXPECT_EQ(budget.getRemaining(), 1);
+    EXPECT_TRUE(budget.consume(1));
+}
+
+TEST_F(MqttTokenBucketTest, KeepsPartialRefillAcrossConsumes)
+{
+    MqttBudget budget(bucketConfig(1, 10), fakeClock);
+    EXPECT_TRUE(budget.consume(1));
+
+    // 1.5 intervals: one message, and half of the next is kept
+    fakeNowUs += 1500000;
+    EXPECT_TRUE(budget.consume(1));
+
+    fakeNowUs += 500000;
+    EXPECT_TRUE(budget.consume(1));
+    EXPECT_FALSE(budget.consume(1));
+}
+
+TEST_F(MqttTokenBucketTest, RefillIsCappedAtMax)
+{
+    MqttBudget budget(bucketConfig(0, 3), fakeClock);
+
+    fakeNowUs += 3600LL * 1000000;
+    EXPECT_EQ(budget.getRemaining(), 3);
+    EXPECT_TRUE(budget.consume(3));
+    EXPECT_FALSE(budget.consume(1));
+}
+
+TEST_F(MqttTokenBucketTest, FractionalRate)
+{
+    BudgetConfig config = bucketConfig(0, 10);
+    config.reviveRate = 0.25f; // One message every 4 s
+    MqttBudget budget(config, fakeClock);
+
+    EXPECT_EQ(budget.getIntervalUs(), 4000000);
+    fakeNowUs += 3999999;
+    EXPECT_FALSE(budget.consume(1));
+    fakeNowUs += 1;
+    EXPECT_TRUE(budget.consume(1));
+}
+
+TEST_F(MqttTokenBucketTest, RestoreAndReset)
+{
+    MqttBudget budget(bucketConfig(4, 5), fakeClock);
+
+    EXPECT_TRUE(budget.consume(4));
+    budget.restore(2);
+    EXPECT_EQ(budget.getRemaining(), 2);
+
+    budget.restore(10);
+    EXPECT_EQ(budget.getRemaining(), 5);
+
+    EXPECT_TRUE(budget.consume(5));
+    budget.reset();
+    EXPECT_EQ(budget.getRemaining(), 4);
+}
+
+TEST_F(MqttTokenBucketTest, DisabledAlwaysConsumes)
+{
+    BudgetConfig config = bucketConfig(1, 1);
+    config.enabled = false;
+    MqttBudget budget(config, fakeClock);
+
+    for (int i = 0; i < 10; i++)
+    {
+        EXPECT_TRUE(budget.consume(1));
+    }
+    EXPECT_TRUE(budget.isAvailable());
+}
+
+TEST_F(MqttTokenBucketTest, PublishPacketSize)
+{
+    // 1 type byte + 1 length byte + 2 + 5 topic + 10 payload
+    EXPECT_EQ(MqttBudget::publishPacketSize(5, 10, MqttQos::AT_MOST_ONCE), 19u);
+    // Packet ID adds 2 bytes at QoS 1/2
+    EXPECT_EQ(MqttBudget::publishPacketSize(5, 10, MqttQos::AT_LEAST_ONCE), 21u);
+    // Remaining length of 128 or more takes a second length byte
+    EXPECT_EQ(MqttBudget::publishPacketSize(6, 120, MqttQos::AT_MOST_ONCE), 131u);
+}
+
+TEST_F(MqttTokenBucketTest, ByteBudgetChargesPacketSize)
+{
+    BudgetConfig config = bucketConfig(1000, 1000);
+    config.unit = BudgetUnit::BYTES;
+    config.reviveRate = 100.0f; // 100 bytes per second
+    MqttBudget budget(config, fakeClock);
+
+    uint32_t cost = budget.costOf(5, 10, MqttQos::AT_MOST_ONCE);
+    EXPECT_EQ(cost, 19u);
+    EXPECT_TRUE(budget.consume(cost));
+    EXPECT_EQ(budget.getRemaining(), 981);
+
+    EXPECT_FALSE(budget.consume(budget.costOf(5, 2000, MqttQos::AT_MOST_ONCE)));
+
+    fakeNowUs += 190000; // 19 bytes refilled
+    EXPECT_EQ(budget.getRemaining(), 1000);
+}
+
+TEST_F(MqttTokenBucketTest, ByteBudgetRoundsUpToMeteringUnit)
+{
+    BudgetConfig config = bucketConfig(20480, 20480);
+    config.unit = BudgetUnit::BYTES;
+    config.meteringBytes = 5120;
+    MqttBudget budget(config, fakeClock);
+
+    EXPECT_EQ(budget.costOf(5, 10, MqttQos::AT_MOST_ONCE), 5120u);
+    EXPECT_EQ(budget.costOf(10, 5120, MqttQos::AT_LEAST_ONCE), 10240u);
+
+    BudgetConfig messages = bucketConfig(10, 10);
+    EXPECT_EQ(MqttBudget(messages, fakeClock).costOf(10, 5120, MqttQos::AT_LEAST_ONCE), 1u);
+
+    messages.meteringBytes = 5120;
+    EXPECT_EQ(messages.validate(), ESP_ERR_INVALID_ARG);
+}
+
+TEST_F(MqttTokenBucketTest, ConcurrentConsumeNeverOverdraws)
+{
+    MqttBudget budget(bucketConfig(1000, 1000), fakeClock);
+
+    std::atomic<int> successCount{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++)
+    {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 200; i++)
+            {
+                if (budget.consume(1))
+                {
+                    successCount++;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(successCount, 1000);
+    EXPECT_EQ(budget.getRemaining(), 0);
+}
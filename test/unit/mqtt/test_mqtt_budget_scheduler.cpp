@@ -0,0 +1,268 @@
+/**
+ * @file test_mqtt_budget_scheduler.cpp
+ * @brief Unit tests for per-topic budget classes and deferred publish scheduling
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/mqtt/mqtt_budget_scheduler.hpp"
+
+using namespace lopcore::mqtt;
+
+namespace
+{
+
+int64_t fakeNowUs = 0;
+
+int64_t fakeClock()
+{
+    return fakeNowUs;
+}
+
+BudgetConfig budgetOf(int32_t budget, float ratePerSecond = 1.0f)
+{
+    BudgetConfig config;
+    config.enabled = true;
+    config.defaultBudget = budget;
+    config.maxBudget = budget;
+    config.reviveRate = ratePerSecond;
+    return config;
+}
+
+BudgetClassConfig classOf(const std::string &name,
+                          const std::string &prefix,
+                          int32_t budget,
+                          uint8_t weight,
+                          uint16_t queueDepth)
+{
+    BudgetClassConfig config;
+    config.name = name;
+    config.topicPrefixes = {prefix};
+    config.budget = budgetOf(budget);
+    config.weight = weight;
+    config.queueDepth = queueDepth;
+    return config;
+}
+
+esp_err_t admit(MqttBudgetScheduler &scheduler, const std::string &topic, bool *deferred)
+{
+    std::string payload = "p:" + topic;
+    MqttPayloadSegment segment{payload.data(), payload.size()};
+    return scheduler.admit(topic, &segment, 1, MqttQos::AT_LEAST_ONCE, false, deferred);
+}
+
+} // namespace
+
+class MqttBudgetSchedulerTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        fakeNowUs = 1000000;
+    }
+};
+
+TEST_F(MqttBudgetSchedulerTest, ClassifiesByLongestPrefix)
+{
+    std::vector<BudgetClassConfig> classes = {classOf("all", "dev/", 10, 1, 0),
+                                              classOf("alarms", "dev/alarm/", 10, 4, 0)};
+    MqttBudgetScheduler scheduler(classes, nullptr, fakeClock);
+
+    EXPECT_EQ(scheduler.classify("dev/temp"), 0u);
+    EXPECT_EQ(scheduler.classify("dev/alarm/fire"), 1u);
+    EXPECT_EQ(scheduler.classify("other/topic"), scheduler.classCount());
+    EXPECT_EQ(scheduler.className(1), "alarms");
+}
+
+TEST_F(MqttBudgetSchedulerTest, ChattyClassCannotSpendOtherClassBudget)
+{
+    std::vector<BudgetClassConfig> classes = {classOf("diag", "diag/", 3, 1, 0),
+                                              classOf("alarms", "alarm/", 2, 1, 0)};
+    MqttBudgetScheduler scheduler(classes, nullptr, fakeClock);
+
+    for (int i = 0; i < 3; i++)
+    {
+        EXPECT_TRUE(scheduler.consume("diag/cpu", 0, MqttQos::AT_MOST_ONCE));
+    }
+    EXPECT_FALSE(scheduler.consume("diag/cpu", 0, MqttQos::AT_MOST_ONCE));
+
+    EXPECT_TRUE(scheduler.consume("alarm/fire", 0, MqttQos::AT_MOST_ONCE));
+    EXPECT_EQ(scheduler.getRemaining(1), 1);
+}
+
+TEST_F(MqttBudgetSchedulerTest, GlobalBudgetIsNotChargedWhenClassRefuses)
+{
+    MqttBudget global(budgetOf(10), fakeClock);
+    std::vector<BudgetClassConfig> classes = {classOf("diag", "diag/", 1, 1, 0)};
+    MqttBudgetScheduler scheduler(classes, &global, fakeClock);
+
+    EXPECT_TRUE(scheduler.consume("diag/a", 0, MqttQos::AT_MOST_ONCE));
+    EXPECT_FALSE(scheduler.consume("diag/a", 0, MqttQos::AT_MOST_ONCE));
+    EXPECT_EQ(global.getRemaining(), 9);
+
+    scheduler.restore("diag/a", 0, MqttQos::AT_MOST_ONCE);
+    EXPECT_EQ(global.getRemaining(), 10);
+    EXPECT_EQ(scheduler.getRemaining(0), 1);
+}
+
+TEST_F(MqttBudgetSchedulerTest, DefersWhenOverBudgetAndRejectsWithoutQueue)
+{
+    MqttBudget global(budgetOf(1), fakeClock);
+    std::vector<BudgetClassConfig> classes = {classOf("bulk", "bulk/", 100, 1, 2)};
+    MqttBudgetScheduler scheduler(classes, &global, fakeClock);
+
+    bool deferred = true;
+    EXPECT_EQ(admit(scheduler, "bulk/1", &deferred), ESP_OK);
+    EXPECT_FALSE(deferred);
+
+    EXPECT_EQ(admit(scheduler, "bulk/2", &deferred), ESP_OK);
+    EXPECT_TRUE(deferred);
+    EXPECT_EQ(admit(scheduler, "bulk/3", &deferred), ESP_OK);
+    EXPECT_TRUE(deferred);
+    EXPECT_EQ(admit(scheduler, "bulk/4", &deferred), ESP_ERR_NO_MEM);
+
+    // Unclassified topics cannot be queued
+    EXPECT_EQ(admit(scheduler, "misc/1", &deferred), ESP_ERR_NO_MEM);
+    EXPECT_EQ(scheduler.deferredCount(), 2u);
+}
+
+TEST_F(MqttBudgetSchedulerTest, DrainKeepsOrderAndStopsWhenBudgetRunsOut)
+{
+    MqttBudget global(budgetOf(1), fakeClock);
+    std::vector<BudgetClassConfig> classes = {classOf("bulk", "bulk/", 100, 1, 4)};
+    MqttBudgetScheduler scheduler(classes, &global, fakeClock);
+
+    bool deferred = false;
+    ASSERT_TRUE(global.consume());
+    for (const char *topic : {"bulk/1", "bulk/2", "bulk/3"})
+    {
+        ASSERT_EQ(admit(scheduler, topic, &deferred), ESP_OK);
+        ASSERT_TRUE(deferred);
+    }
+
+    std::vector<std::string> sent;
+    auto send = [&sent](const MqttMessageView &view) {
+        sent.emplace_back(view.topic);
+        EXPECT_EQ(std::string(reinterpret_cast<const char *>(view.payload), view.payloadLength),
+                  "p:" + sent.back());
+        return ESP_OK;
+    };
+
+    EXPECT_EQ(scheduler.drain(send), 0u);
+
+    fakeNowUs += 1000000;
+    EXPECT_EQ(scheduler.drain(send), 1u);
+    fakeNowUs += 1000000;
+    EXPECT_EQ(scheduler.drain(send), 1u);
+    fakeNowUs += 1000000;
+    EXPECT_EQ(scheduler.drain(send), 1u);
+
+    EXPECT_EQ(sent, (std::vector<std::string>{"bulk/1", "bulk/2", "bulk/3"}));
+    EXPECT_EQ(scheduler.deferredCount(), 0u);
+}
+
+TEST_F(MqttBudgetSchedulerTest, FailedSendKeepsPublishAndBudget)
+{
+    MqttBudget global(budgetOf(1), fakeClock);
+    std::vector<BudgetClassConfig> classes = {classOf("bulk", "bulk/", 100, 1, 4)};
+    MqttBudgetScheduler scheduler(classes, &global, fakeClock);
+
+    bool deferred = false;
+    ASSERT_TRUE(global.consume());
+    ASSERT_EQ(admit(scheduler, "bulk/1", &deferred), ESP_OK);
+
+    fakeNowUs += 1000000;
+    EXPECT_EQ(scheduler.drain([](const MqttMessageView &) { return ESP_FAIL; }), 0u);
+    EXPECT_EQ(scheduler.deferredCount(), 1u);
+    EXPECT_EQ(global.getRemaining(), 1);
+}
+
+TEST_F(MqttBudgetSchedulerTest, RefilledBudgetIsSharedByWeight)
+{
+    MqttBudget global(budgetOf(1, 1000.0f), fakeClock);
+    std::vector<BudgetClassConfig> classes = {classOf("bulk", "bulk/", 1000, 1, 100),
+                                              classOf("alarms", "alarm/", 1000, 3, 100)};
+    MqttBudgetScheduler scheduler(classes, &global, fakeClock);
+
+    bool deferred = false;
+    ASSERT_TRUE(global.consume());
+    for (int i = 0; i < 40; i++)
+    {
+        ASSERT_EQ(admit(scheduler, "bulk/" + std::to_string(i), &deferred), ESP_OK);
+        ASSERT_EQ(admit(scheduler, "alarm/" + std::to_string(i), &deferred), ESP_OK);
+    }
+
+    // One message of global budget per drain, as on a constrained link
+    std::map<std::string, int> sentByClass;
+    for (int i = 0; i < 40; i++)
+    {
+        fakeNowUs += 1000;
+        scheduler.drain([&](const MqttMessageView &view) {
+            sentByClass[std::string(view.topic.substr(0, view.topic.find('/')))]++;
+            return ESP_OK;
+        });
+    }
+
+    EXPECT_EQ(sentByClass["alarm"], 30);
+    EXPECT_EQ(sentByClass["bulk"], 10);
+}
+
+TEST_F(MqttBudgetSchedulerTest, LighterClassWaitsBehindHeavierDeferredClass)
+{
+    MqttBudget global(budgetOf(1), fakeClock);
+    std::vector<BudgetClassConfig> classes = {classOf("bulk", "bulk/", 100, 1, 4),
+                                              classOf("alarms", "alarm/", 100, 8, 4)};
+    MqttBudgetScheduler scheduler(classes, &global, fakeClock);
+
+    bool deferred = false;
+    ASSERT_TRUE(global.consume());
+    ASSERT_EQ(admit(scheduler, "alarm/fire", &deferred), ESP_OK);
+    ASSERT_TRUE(deferred);
+
+    // The global budget refills, but the alarm is owed it first
+    fakeNowUs += 1000000;
+    ASSERT_EQ(admit(scheduler, "bulk/1", &deferred), ESP_OK);
+    EXPECT_TRUE(deferred);
+    EXPECT_EQ(admit(scheduler, "misc/1", &deferred), ESP_ERR_NO_MEM);
+
+    std::vector<std::string> sent;
+    scheduler.drain([&sent](const MqttMessageView &view) {
+        sent.emplace_back(view.topic);
+        return ESP_OK;
+    });
+    EXPECT_EQ(sent, (std::vector<std::string>{"alarm/fire"}));
+}
+
+TEST_F(MqttBudgetSchedulerTest, ClassAndGlobalChargeInTheirOwnUnits)
+{
+    BudgetConfig bytes = budgetOf(1000);
+    bytes.unit = BudgetUnit::BYTES;
+    MqttBudget global(bytes, fakeClock);
+    std::vector<BudgetClassConfig> classes = {classOf("diag", "diag/", 5, 1, 0)};
+    MqttBudgetScheduler scheduler(classes, &global, fakeClock);
+
+    // "diag/a" (6) + 100 byte payload at QoS 1: 2 + 6 + 2 + 100 = 110, plus a 2 byte fixed header
+    EXPECT_TRUE(scheduler.consume("diag/a", 100, MqttQos::AT_LEAST_ONCE));
+    EXPECT_EQ(global.getRemaining(), 1000 - 112);
+    EXPECT_EQ(scheduler.getRemaining(0), 4);
+}
+
+TEST_F(MqttBudgetSchedulerTest, ConfigValidation)
+{
+    BudgetClassConfig config = classOf("alarms", "alarm/", 10, 1, 0);
+    EXPECT_EQ(config.validate(), ESP_OK);
+
+    config.weight = 0;
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+
+    config.weight = 1;
+    config.topicPrefixes = {""};
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+
+    config.topicPrefixes.clear();
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+}
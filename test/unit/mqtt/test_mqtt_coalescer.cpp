@@ -0,0 +1,238 @@
+/**
+ * @file test_mqtt_coalescer.cpp
+ * @brief Unit tests for last-value-wins publish coalescing
+ */
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/mqtt/mqtt_coalescer.hpp"
+#include "mqtt/mock_mqtt_client.hpp"
+
+using namespace lopcore::mqtt;
+using lopcore::test::MockMqttClient;
+
+namespace
+{
+
+int64_t fakeNowUs = 0;
+
+int64_t fakeClock()
+{
+    return fakeNowUs;
+}
+
+int64_t steadyClock()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+std::vector<std::string> takeSent(MockMqttClient &client)
+{
+    std::vector<std::string> sent;
+    for (const MqttMessage &message : client.takePublished())
+    {
+        sent.push_back(message.topic + "=" + message.getPayloadAsString());
+    }
+    return sent;
+}
+
+CoalesceConfig makeConfig(const std::string &filter, uint32_t intervalMs, uint32_t maxTopics = 16)
+{
+    CoalesceConfig config;
+    config.rules.push_back({filter, intervalMs});
+    config.maxTopics = maxTopics;
+    config.retryMs = 50;
+    return config;
+}
+
+} // namespace
+
+class MqttCoalescerTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        fakeNowUs = 1000000;
+        client = std::make_shared<MockMqttClient>();
+    }
+
+    std::shared_ptr<MockMqttClient> client;
+};
+
+TEST_F(MqttCoalescerTest, UnmatchedTopicsPassStraightThrough)
+{
+    MqttCoalescer coalescer(client, makeConfig("sensors/+/value", 500), fakeClock);
+
+    EXPECT_EQ(coalescer.publishString("alarms/fire", "1"), ESP_OK);
+    EXPECT_EQ(coalescer.publishString("alarms/fire", "2"), ESP_OK);
+
+    EXPECT_EQ(takeSent(*client), (std::vector<std::string>{"alarms/fire=1", "alarms/fire=2"}));
+    EXPECT_EQ(coalescer.getCoalesceStats().published, 0u);
+}
+
+TEST_F(MqttCoalescerTest, SendsFirstValueAndLatestAfterInterval)
+{
+    MqttCoalescer coalescer(client, makeConfig("sensors/+/value", 500), fakeClock);
+
+    // 50 Hz for one interval
+    for (int i = 0; i < 25; i++)
+    {
+        ASSERT_EQ(coalescer.publishString("sensors/imu/value", std::to_string(i)), ESP_OK);
+        fakeNowUs += 20000;
+    }
+    EXPECT_EQ(takeSent(*client), (std::vector<std::string>{"sensors/imu/value=0"}));
+
+    EXPECT_EQ(coalescer.poll(), UINT32_MAX);
+    EXPECT_EQ(takeSent(*client), (std::vector<std::string>{"sensors/imu/value=24"}));
+
+    MqttCoalesceStats stats = coalescer.getCoalesceStats();
+    EXPECT_EQ(stats.published, 2u);
+    EXPECT_EQ(stats.coalesced, 23u);
+}
+
+TEST_F(MqttCoalescerTest, PollReportsTimeUntilNextValueIsDue)
+{
+    MqttCoalescer coalescer(client, makeConfig("sensors/#", 500), fakeClock);
+    EXPECT_EQ(coalescer.poll(), UINT32_MAX);
+
+    ASSERT_EQ(coalescer.publishString("sensors/a", "1"), ESP_OK);
+    fakeNowUs += 100000;
+    ASSERT_EQ(coalescer.publishString("sensors/a", "2"), ESP_OK);
+
+    EXPECT_EQ(coalescer.poll(), 400u);
+    EXPECT_EQ(takeSent(*client).size(), 1u);
+}
+
+TEST_F(MqttCoalescerTest, ShortestMatchingRuleApplies)
+{
+    CoalesceConfig config = makeConfig("sensors/#", 1000);
+    config.rules.push_back({"sensors/+/fast", 100});
+    MqttCoalescer coalescer(client, config, fakeClock);
+
+    ASSERT_EQ(coalescer.publishString("sensors/imu/fast", "1"), ESP_OK);
+    ASSERT_EQ(coalescer.publishString("sensors/imu/fast", "2"), ESP_OK);
+    EXPECT_EQ(coalescer.poll(), 100u);
+}
+
+TEST_F(MqttCoalescerTest, RefusedValueIsRetriedUnlessSuperseded)
+{
+    MqttCoalescer coalescer(client, makeConfig("sensors/+/value", 500), fakeClock);
+
+    client->publishResult = ESP_ERR_NO_MEM; // Budget exhausted
+    EXPECT_EQ(coalescer.publishString("sensors/imu/value", "1"), ESP_OK);
+    EXPECT_EQ(coalescer.poll(), 50u);
+
+    fakeNowUs += 50000;
+    EXPECT_EQ(coalescer.poll(), 50u);
+    EXPECT_EQ(coalescer.getCoalesceStats().retried, 2u);
+
+    ASSERT_EQ(coalescer.publishString("sensors/imu/value", "2"), ESP_OK);
+    client->publishResult = ESP_OK;
+    fakeNowUs += 50000;
+    EXPECT_EQ(coalescer.poll(), UINT32_MAX);
+    EXPECT_EQ(takeSent(*client), (std::vector<std::string>{"sensors/imu/value=2"}));
+}
+
+TEST_F(MqttCoalescerTest, OtherErrorsDropTheValue)
+{
+    MqttCoalescer coalescer(client, makeConfig("sensors/+/value", 500), fakeClock);
+
+    client->publishResult = ESP_FAIL;
+    EXPECT_EQ(coalescer.publishString("sensors/imu/value", "1"), ESP_FAIL);
+    EXPECT_EQ(coalescer.poll(), UINT32_MAX);
+    EXPECT_EQ(coalescer.getCoalesceStats().failed, 1u);
+}
+
+TEST_F(MqttCoalescerTest, TopicsBeyondMaxTopicsPassThrough)
+{
+    MqttCoalescer coalescer(client, makeConfig("sensors/#", 500, 1), fakeClock);
+
+    ASSERT_EQ(coalescer.publishString("sensors/a", "1"), ESP_OK);
+    ASSERT_EQ(coalescer.publishString("sensors/a", "2"), ESP_OK);
+    ASSERT_EQ(coalescer.publishString("sensors/b", "1"), ESP_OK);
+    ASSERT_EQ(coalescer.publishString("sensors/b", "2"), ESP_OK);
+
+    EXPECT_EQ(takeSent(*client),
+              (std::vector<std::string>{"sensors/a=1", "sensors/b=1", "sensors/b=2"}));
+    EXPECT_EQ(coalescer.getCoalesceStats().passedThrough, 2u);
+}
+
+TEST_F(MqttCoalescerTest, FlushSendsEverythingWaiting)
+{
+    MqttCoalescer coalescer(client, makeConfig("sensors/#", 500), fakeClock);
+
+    for (const char *topic : {"sensors/a", "sensors/b"})
+    {
+        ASSERT_EQ(coalescer.publishString(topic, "1"), ESP_OK);
+        ASSERT_EQ(coalescer.publishString(topic, "2"), ESP_OK);
+    }
+    takeSent(*client);
+
+    EXPECT_EQ(coalescer.flush(), ESP_OK);
+    EXPECT_EQ(takeSent(*client), (std::vector<std::string>{"sensors/a=2", "sensors/b=2"}));
+    EXPECT_EQ(coalescer.poll(), UINT32_MAX);
+}
+
+TEST_F(MqttCoalescerTest, StopAndDestructionSendWhatIsWaiting)
+{
+    {
+        MqttCoalescer coalescer(client, makeConfig("sensors/#", 500), fakeClock);
+        ASSERT_EQ(coalescer.publishString("sensors/a", "1"), ESP_OK);
+        ASSERT_EQ(coalescer.publishString("sensors/a", "2"), ESP_OK);
+        coalescer.stop();
+        EXPECT_EQ(takeSent(*client), (std::vector<std::string>{"sensors/a=1", "sensors/a=2"}));
+
+        ASSERT_EQ(coalescer.publishString("sensors/a", "3"), ESP_OK);
+        EXPECT_TRUE(takeSent(*client).empty());
+    }
+    EXPECT_EQ(takeSent(*client), (std::vector<std::string>{"sensors/a=3"}));
+}
+
+TEST(MqttCoalescerTaskTest, FlushTaskSendsWithoutPolling)
+{
+    auto client = std::make_shared<MockMqttClient>();
+    MqttCoalescer coalescer(client, makeConfig("sensors/#", 20), steadyClock);
+    ASSERT_EQ(coalescer.start(), ESP_OK);
+    EXPECT_EQ(coalescer.start(), ESP_ERR_INVALID_STATE);
+
+    ASSERT_EQ(coalescer.publishString("sensors/a", "1"), ESP_OK);
+    ASSERT_EQ(coalescer.publishString("sensors/a", "2"), ESP_OK);
+
+    std::vector<std::string> sent;
+    for (int i = 0; i < 2000 && sent.size() < 2; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        for (std::string &entry : takeSent(*client))
+        {
+            sent.push_back(entry);
+        }
+    }
+    EXPECT_EQ(sent, (std::vector<std::string>{"sensors/a=1", "sensors/a=2"}));
+
+    coalescer.stop();
+    EXPECT_FALSE(coalescer.isRunning());
+}
+
+TEST(MqttCoalescerConfigTest, Validation)
+{
+    CoalesceConfig config = makeConfig("sensors/#", 500);
+    EXPECT_EQ(config.validate(), ESP_OK);
+
+    config.rules[0].intervalMs = 0;
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+
+    config.rules[0] = {"", 500};
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+
+    config.rules[0] = {"sensors/#", 500};
+    config.maxTopics = 0;
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+}
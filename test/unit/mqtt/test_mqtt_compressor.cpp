@@ -0,0 +1,273 @@
+/**
+ * @file test_mqtt_compressor.cpp
+ * @brief Unit tests for the MQTT payload codec and compressing client decorator
+ */
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/mqtt/mqtt_compressor.hpp"
+#include "mqtt/mock_mqtt_client.hpp"
+
+using namespace lopcore::mqtt;
+using lopcore::test::MockMqttClient;
+
+namespace
+{
+
+std::string telemetryJson(int samples)
+{
+    std::string json = "{\"device\":\"sensor-01\",\"samples\":[";
+    for (int i = 0; i < samples; i++)
+    {
+        json += "{\"t\":" + std::to_string(1700000000 + i) + ",\"temp\":21." + std::to_string(i % 10) +
+                ",\"humidity\":45." + std::to_string(i % 7) + "}";
+        json += i + 1 < samples ? "," : "]}";
+    }
+    return json;
+}
+
+std::vector<uint8_t> bytesOf(const std::string &text)
+{
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+} // namespace
+
+TEST(MqttPayloadCodecTest, RoundTripsJsonAndShrinksIt)
+{
+    std::vector<uint8_t> input = bytesOf(telemetryJson(40));
+    MqttPayloadCodec codec;
+    std::vector<uint8_t> packed;
+    ASSERT_TRUE(codec.compress(input.data(), input.size(), packed));
+    EXPECT_LT(packed.size() * 3, input.size());
+
+    std::vector<uint8_t> output;
+    ASSERT_TRUE(MqttPayloadCodec::decompress(packed.data(), packed.size(), input.size(), output));
+    EXPECT_EQ(output, input);
+}
+
+TEST(MqttPayloadCodecTest, RoundTripsBeyondOneWindow)
+{
+    std::string text;
+    for (int i = 0; text.size() < 12000; i++)
+    {
+        text += "line " + std::to_string(i * 7919 % 1000) + " of the log\n";
+    }
+    std::vector<uint8_t> input = bytesOf(text);
+
+    MqttPayloadCodec codec;
+    std::vector<uint8_t> packed;
+    ASSERT_TRUE(codec.compress(input.data(), input.size(), packed));
+
+    std::vector<uint8_t> output;
+    ASSERT_TRUE(MqttPayloadCodec::decompress(packed.data(), packed.size(), input.size(), output));
+    EXPECT_EQ(output, input);
+}
+
+TEST(MqttPayloadCodecTest, IncompressibleInputIsRefused)
+{
+    std::vector<uint8_t> input(256);
+    uint32_t state = 12345;
+    for (uint8_t &byte : input)
+    {
+        state = state * 1103515245u + 12345u;
+        byte = static_cast<uint8_t>(state >> 24);
+    }
+
+    MqttPayloadCodec codec;
+    std::vector<uint8_t> packed;
+    EXPECT_FALSE(codec.compress(input.data(), input.size(), packed));
+}
+
+TEST(MqttPayloadCodecTest, RejectsCorruptAndOversizedInput)
+{
+    std::vector<uint8_t> input = bytesOf(telemetryJson(10));
+    MqttPayloadCodec codec;
+    std::vector<uint8_t> packed;
+    ASSERT_TRUE(codec.compress(input.data(), input.size(), packed));
+
+    std::vector<uint8_t> output;
+    EXPECT_FALSE(MqttPayloadCodec::decompress(packed.data(), packed.size(), input.size() - 1, output));
+    EXPECT_FALSE(MqttPayloadCodec::decompress(packed.data(), packed.size() - 1, input.size(), output));
+
+    // A match pointing before the start of the output
+    std::vector<uint8_t> bad = {10, 0x01, 0xFF, 0x0F};
+    EXPECT_FALSE(MqttPayloadCodec::decompress(bad.data(), bad.size(), 100, output));
+}
+
+class MqttCompressorTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        mock = std::make_shared<MockMqttClient>();
+        compressor = std::make_unique<MqttCompressor>(mock, CompressionConfig{});
+    }
+
+    std::shared_ptr<MockMqttClient> mock;
+    std::unique_ptr<MqttCompressor> compressor;
+};
+
+TEST_F(MqttCompressorTest, SmallPayloadsAreSentAsIs)
+{
+    ASSERT_EQ(compressor->publishString("dt/dev1/state", "{\"on\":true}"), ESP_OK);
+
+    std::vector<MqttMessage> sent = mock->takePublished();
+    ASSERT_EQ(sent.size(), 1u);
+    EXPECT_EQ(sent[0].topic, "dt/dev1/state");
+    EXPECT_EQ(sent[0].getPayloadAsString(), "{\"on\":true}");
+    EXPECT_EQ(compressor->getCompressionStats().uncompressed, 1u);
+}
+
+TEST_F(MqttCompressorTest, LargePayloadsGoCompressedToSuffixedTopic)
+{
+    std::string json = telemetryJson(40);
+    std::string half = json.substr(0, json.size() / 2);
+    std::string rest = json.substr(json.size() / 2);
+    MqttPayloadSegment segments[] = {{half.data(), half.size()}, {rest.data(), rest.size()}};
+    ASSERT_EQ(compressor->publish(std::string_view("dt/dev1/telemetry"), segments, 2, MqttQos::AT_LEAST_ONCE),
+              ESP_OK);
+
+    std::vector<MqttMessage> sent = mock->takePublished();
+    ASSERT_EQ(sent.size(), 1u);
+    EXPECT_EQ(sent[0].topic, "dt/dev1/telemetry/lz");
+    EXPECT_EQ(sent[0].qos, MqttQos::AT_LEAST_ONCE);
+
+    std::vector<uint8_t> inflated;
+    const std::vector<uint8_t> &packed = sent[0].payload;
+    ASSERT_TRUE(MqttPayloadCodec::decompress(packed.data(), packed.size(), 16384, inflated));
+    EXPECT_EQ(inflated, bytesOf(json));
+
+    MqttCompressionStats stats = compressor->getCompressionStats();
+    EXPECT_EQ(stats.compressed, 1u);
+    EXPECT_EQ(stats.bytesIn, json.size());
+    EXPECT_EQ(stats.bytesOut, sent[0].payload.size());
+}
+
+TEST_F(MqttCompressorTest, InboundCompressedMessagesAreInflatedBeforeCallback)
+{
+    std::vector<MqttMessage> received;
+    ASSERT_EQ(compressor->subscribe("cmd/dev1", [&](const MqttMessage &msg) { received.push_back(msg); }),
+              ESP_OK);
+    EXPECT_TRUE(mock->isSubscribed("cmd/dev1"));
+    EXPECT_TRUE(mock->isSubscribed("cmd/dev1/lz"));
+
+    std::vector<uint8_t> json = bytesOf(telemetryJson(20));
+    MqttPayloadCodec codec;
+    std::vector<uint8_t> packed;
+    ASSERT_TRUE(codec.compress(json.data(), json.size(), packed));
+
+    EXPECT_EQ(mock->inject("cmd/dev1/lz", packed), 1u);
+    EXPECT_EQ(mock->inject("cmd/dev1", bytesOf("plain")), 1u);
+
+    ASSERT_EQ(received.size(), 2u);
+    EXPECT_EQ(received[0].topic, "cmd/dev1");
+    EXPECT_EQ(received[0].payload, json);
+    EXPECT_EQ(received[1].getPayloadAsString(), "plain");
+    EXPECT_EQ(compressor->getCompressionStats().inflated, 1u);
+
+    ASSERT_EQ(compressor->unsubscribe("cmd/dev1"), ESP_OK);
+    EXPECT_FALSE(mock->isSubscribed("cmd/dev1/lz"));
+}
+
+TEST_F(MqttCompressorTest, ViewSubscriptionsSeeInflatedPayloads)
+{
+    std::vector<uint8_t> received;
+    ASSERT_EQ(compressor->subscribeView("cmd/dev1",
+                                        [&](const MqttMessageView &view) {
+                                            received.assign(view.payload, view.payload + view.payloadLength);
+                                        }),
+              ESP_OK);
+    EXPECT_TRUE(mock->isSubscribed("cmd/dev1/lz"));
+
+    std::vector<uint8_t> json = bytesOf(telemetryJson(20));
+    MqttPayloadCodec codec;
+    std::vector<uint8_t> packed;
+    ASSERT_TRUE(codec.compress(json.data(), json.size(), packed));
+
+    EXPECT_EQ(mock->inject("cmd/dev1/lz", packed), 1u);
+    EXPECT_EQ(received, json);
+}
+
+TEST_F(MqttCompressorTest, MultiLevelWildcardNeedsNoSuffixSubscription)
+{
+    int calls = 0;
+    ASSERT_EQ(compressor->subscribe("cmd/#", [&](const MqttMessage &) { calls++; }), ESP_OK);
+    EXPECT_FALSE(mock->isSubscribed("cmd/#/lz"));
+
+    // Corrupt compressed payloads are dropped, not delivered raw
+    EXPECT_EQ(mock->inject("cmd/dev1/lz", bytesOf("garbage")), 1u);
+    EXPECT_EQ(calls, 0);
+    EXPECT_EQ(compressor->getCompressionStats().inflateErrors, 1u);
+}
+
+/**
+ * @brief Client whose publishes to one topic wait until released, like a full outbox
+ */
+class BlockingClient : public MockMqttClient
+{
+public:
+    esp_err_t publish(const std::string &topic, const std::vector<uint8_t> &payload, MqttQos qos, bool retain) override
+    {
+        if (topic == "dt/slow/telemetry/lz")
+        {
+            blocked = true;
+            released.get_future().wait();
+        }
+        return MockMqttClient::publish(topic, payload, qos, retain);
+    }
+
+    std::atomic<bool> blocked{false};
+    std::promise<void> released;
+};
+
+TEST(MqttCompressorLockTest, BlockedPublishDoesNotHoldOtherPublishes)
+{
+    auto client = std::make_shared<BlockingClient>();
+    MqttCompressor compressor(client, CompressionConfig{});
+    std::string json = telemetryJson(40);
+
+    std::thread slow([&] { compressor.publishString("dt/slow/telemetry", json); });
+    while (!client->blocked)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Compresses and sends while the other publish is still inside the client
+    auto fast = std::async(std::launch::async, [&] { return compressor.publishString("dt/fast/telemetry", json); });
+    std::future_status finished = fast.wait_for(std::chrono::seconds(5));
+    client->released.set_value();
+    slow.join();
+    ASSERT_EQ(finished, std::future_status::ready);
+    EXPECT_EQ(fast.get(), ESP_OK);
+
+    std::vector<MqttMessage> sent = client->takePublished();
+    ASSERT_EQ(sent.size(), 2u);
+    EXPECT_EQ(sent[0].topic, "dt/fast/telemetry/lz");
+    EXPECT_EQ(sent[1].topic, "dt/slow/telemetry/lz");
+    EXPECT_EQ(compressor.getCompressionStats().compressed, 2u);
+}
+
+TEST(CompressionConfigTest, Validation)
+{
+    CompressionConfig config;
+    EXPECT_EQ(config.validate(), ESP_OK);
+
+    config.topicSuffix = "lz";
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+
+    config.topicSuffix = "/#";
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+
+    config.topicSuffix = "/lz";
+    config.maxInflatedSize = 0;
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+}
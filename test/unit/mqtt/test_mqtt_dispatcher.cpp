@@ -0,0 +1,271 @@
+/**
+ * @file test_mqtt_dispatcher.cpp
+ * @brief Unit tests for the MQTT callback worker pool
+ */
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/mqtt/mqtt_dispatcher.hpp"
+
+using namespace lopcore::mqtt;
+
+namespace
+{
+
+DispatchConfig makeConfig(uint32_t workers, uint32_t queueDepth, uint32_t enqueueTimeoutMs = 10)
+{
+    DispatchConfig config;
+    config.workers = workers;
+    config.queueDepth = queueDepth;
+    config.enqueueTimeoutMs = enqueueTimeoutMs;
+    return config;
+}
+
+MqttMessageView makeView(const std::string &topic, const std::string &payload)
+{
+    MqttMessageView view{};
+    view.topic = topic;
+    view.payload = reinterpret_cast<const uint8_t *>(payload.data());
+    view.payloadLength = payload.size();
+    view.qos = MqttQos::AT_LEAST_ONCE;
+    return view;
+}
+
+bool waitFor(const std::function<bool()> &condition)
+{
+    for (int i = 0; i < 2000 && !condition(); i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return condition();
+}
+
+// Two topics that land on different workers of a pool of two
+std::pair<std::string, std::string> topicsOnDifferentWorkers()
+{
+    std::string first = "sensors/0";
+    for (int i = 1;; i++)
+    {
+        std::string second = "sensors/" + std::to_string(i);
+        if (MqttDispatcher::workerFor(second, 2) != MqttDispatcher::workerFor(first, 2))
+        {
+            return {first, second};
+        }
+    }
+}
+
+} // namespace
+
+TEST(MqttDispatcherTest, DispatchBeforeStartFails)
+{
+    MqttDispatcher dispatcher(makeConfig(1, 4));
+    auto handler = std::make_shared<MqttHandler>();
+
+    std::string topic = "a/b";
+    EXPECT_EQ(dispatcher.dispatch(makeView(topic, "x"), {handler}), ESP_ERR_INVALID_STATE);
+    EXPECT_FALSE(dispatcher.isRunning());
+}
+
+TEST(MqttDispatcherTest, DeliversCopyAfterSourceBufferChanges)
+{
+    MqttDispatcher dispatcher(makeConfig(1, 4));
+    ASSERT_EQ(dispatcher.start(), ESP_OK);
+
+    std::mutex mutex;
+    std::vector<std::string> received;
+    auto handler = std::make_shared<MqttHandler>();
+    handler->callback = [&](const MqttMessage &msg) {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(msg.topic + "=" + std::string(msg.payload.begin(), msg.payload.end()));
+    };
+
+    std::string topic = "a/b";
+    std::string payload = "hello";
+    ASSERT_EQ(dispatcher.dispatch(makeView(topic, payload), {handler}), ESP_OK);
+    payload = "XXXXX"; // The network buffer is reused once dispatch() returns
+
+    ASSERT_TRUE(waitFor([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        return received.size() == 1;
+    }));
+    EXPECT_EQ(received[0], "a/b=hello");
+    EXPECT_EQ(dispatcher.getStats().messagesDispatched, 1u);
+}
+
+TEST(MqttDispatcherTest, PreservesOrderPerTopic)
+{
+    MqttDispatcher dispatcher(makeConfig(2, 8, 1000));
+    ASSERT_EQ(dispatcher.start(), ESP_OK);
+
+    std::mutex mutex;
+    std::vector<int> received;
+    auto handler = std::make_shared<MqttHandler>();
+    handler->viewCallback = [&](const MqttMessageView &view) {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(std::stoi(std::string(reinterpret_cast<const char *>(view.payload),
+                                                 view.payloadLength)));
+    };
+
+    std::string topic = "ordered/topic";
+    for (int i = 0; i < 100; i++)
+    {
+        ASSERT_EQ(dispatcher.dispatch(makeView(topic, std::to_string(i)), {handler}), ESP_OK);
+    }
+
+    ASSERT_TRUE(waitFor([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        return received.size() == 100;
+    }));
+    for (int i = 0; i < 100; i++)
+    {
+        EXPECT_EQ(received[i], i);
+    }
+}
+
+TEST(MqttDispatcherTest, SlowCallbackDoesNotBlockOtherWorker)
+{
+    MqttDispatcher dispatcher(makeConfig(2, 4));
+    ASSERT_EQ(dispatcher.start(), ESP_OK);
+    auto topics = topicsOnDifferentWorkers();
+
+    std::atomic<bool> release{false};
+    std::atomic<int> fastCount{0};
+    auto slow = std::make_shared<MqttHandler>();
+    slow->viewCallback = [&](const MqttMessageView &) {
+        while (!release.load())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+    auto fast = std::make_shared<MqttHandler>();
+    fast->viewCallback = [&](const MqttMessageView &) { fastCount++; };
+
+    ASSERT_EQ(dispatcher.dispatch(makeView(topics.first, "slow"), {slow}), ESP_OK);
+    for (int i = 0; i < 10; i++)
+    {
+        ASSERT_EQ(dispatcher.dispatch(makeView(topics.second, "fast"), {fast}), ESP_OK);
+    }
+
+    EXPECT_TRUE(waitFor([&] { return fastCount.load() == 10; }));
+    release = true;
+}
+
+TEST(MqttDispatcherTest, DropsWhenQueueStaysFull)
+{
+    MqttDispatcher dispatcher(makeConfig(1, 2, 5));
+    ASSERT_EQ(dispatcher.start(), ESP_OK);
+
+    std::atomic<bool> release{false};
+    std::atomic<int> started{0};
+    auto handler = std::make_shared<MqttHandler>();
+    handler->viewCallback = [&](const MqttMessageView &) {
+        started++;
+        while (!release.load())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+
+    std::string topic = "busy";
+    ASSERT_EQ(dispatcher.dispatch(makeView(topic, "1"), {handler}), ESP_OK);
+    ASSERT_TRUE(waitFor([&] { return started.load() == 1; }));
+    ASSERT_EQ(dispatcher.dispatch(makeView(topic, "2"), {handler}), ESP_OK);
+
+    // Running job plus one queued fill both slots
+    EXPECT_EQ(dispatcher.dispatch(makeView(topic, "3"), {handler}), ESP_ERR_TIMEOUT);
+    EXPECT_EQ(dispatcher.getStats().messagesDropped, 1u);
+    EXPECT_EQ(dispatcher.getStats().messagesDispatched, 2u);
+
+    release = true;
+    EXPECT_TRUE(waitFor([&] { return started.load() == 2; }));
+}
+
+TEST(MqttDispatcherTest, QueuedMessageKeepsHandlerAlive)
+{
+    MqttDispatcher dispatcher(makeConfig(1, 4));
+    ASSERT_EQ(dispatcher.start(), ESP_OK);
+
+    std::atomic<bool> release{false};
+    std::atomic<int> delivered{0};
+    auto blocker = std::make_shared<MqttHandler>();
+    blocker->viewCallback = [&](const MqttMessageView &) {
+        while (!release.load())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+    auto handler = std::make_shared<MqttHandler>();
+    handler->viewCallback = [&](const MqttMessageView &) { delivered++; };
+    std::weak_ptr<const MqttHandler> weak = handler;
+
+    std::string topic = "a";
+    ASSERT_EQ(dispatcher.dispatch(makeView(topic, "block"), {blocker}), ESP_OK);
+    ASSERT_EQ(dispatcher.dispatch(makeView(topic, "msg"), {handler}), ESP_OK);
+
+    handler.reset(); // Unsubscribed while the message is queued
+    EXPECT_FALSE(weak.expired());
+
+    release = true;
+    ASSERT_TRUE(waitFor([&] { return delivered.load() == 1; }));
+    EXPECT_TRUE(waitFor([&] { return weak.expired(); }));
+}
+
+TEST(MqttDispatcherTest, StopDiscardsQueuedMessages)
+{
+    MqttDispatcher dispatcher(makeConfig(1, 4));
+    ASSERT_EQ(dispatcher.start(), ESP_OK);
+
+    std::atomic<bool> release{false};
+    std::atomic<int> calls{0};
+    auto handler = std::make_shared<MqttHandler>();
+    handler->viewCallback = [&](const MqttMessageView &) {
+        calls++;
+        while (!release.load())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+
+    std::string topic = "a";
+    for (int i = 0; i < 3; i++)
+    {
+        ASSERT_EQ(dispatcher.dispatch(makeView(topic, "x"), {handler}), ESP_OK);
+    }
+    ASSERT_TRUE(waitFor([&] { return calls.load() == 1; }));
+
+    std::thread releaser([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        release = true;
+    });
+    dispatcher.stop();
+    releaser.join();
+
+    EXPECT_FALSE(dispatcher.isRunning());
+    EXPECT_EQ(calls.load(), 1);
+    EXPECT_EQ(handler.use_count(), 1);
+    EXPECT_EQ(dispatcher.dispatch(makeView(topic, "x"), {handler}), ESP_ERR_INVALID_STATE);
+}
+
+TEST(MqttDispatcherTest, ConfigValidation)
+{
+    DispatchConfig config;
+    EXPECT_EQ(config.validate(), ESP_OK); // Disabled by default
+
+    config.workers = 2;
+    EXPECT_EQ(config.validate(), ESP_OK);
+
+    config.queueDepth = 0;
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+
+    config.queueDepth = 16;
+    config.workers = 9;
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+}
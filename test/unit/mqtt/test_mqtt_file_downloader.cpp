@@ -0,0 +1,419 @@
+/**
+ * @file test_mqtt_file_downloader.cpp
+ * @brief Unit tests for the pipelined MQTT file stream downloader
+ */
+
+#include <unistd.h>
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/mqtt/mqtt_file_downloader.hpp"
+#include "mqtt/mock_mqtt_client.hpp"
+
+using namespace lopcore::mqtt;
+using lopcore::test::MockMqttClient;
+
+namespace
+{
+
+int64_t fakeNowUs = 0;
+
+int64_t fakeClock()
+{
+    return fakeNowUs;
+}
+
+const std::string PREFIX = "$aws/things/dev/streams/fw/";
+
+/**
+ * @brief Sink keeping the file in memory
+ */
+struct MemorySink : IFileStreamSink
+{
+    std::vector<uint8_t> data;
+    esp_err_t writeResult{ESP_OK};
+    bool begun{false};
+    bool finished{false};
+    bool aborted{false};
+
+    esp_err_t begin(size_t) override
+    {
+        begun = true;
+        return ESP_OK;
+    }
+
+    esp_err_t write(const uint8_t *bytes, size_t length) override
+    {
+        if (writeResult == ESP_OK)
+        {
+            data.insert(data.end(), bytes, bytes + length);
+        }
+        return writeResult;
+    }
+
+    esp_err_t finish() override
+    {
+        finished = true;
+        return ESP_OK;
+    }
+
+    void abort() override
+    {
+        aborted = true;
+    }
+};
+
+std::vector<uint8_t> makeFile(size_t size)
+{
+    std::vector<uint8_t> file(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        file[i] = static_cast<uint8_t>(i * 7 + i / 256);
+    }
+    return file;
+}
+
+std::array<uint8_t, 32> sha256Of(const std::vector<uint8_t> &data)
+{
+    Sha256 hash;
+    hash.update(data.data(), data.size());
+    return hash.finish();
+}
+
+void cborHead(std::vector<uint8_t> &out, uint8_t major, uint32_t value)
+{
+    if (value < 24)
+    {
+        out.push_back(static_cast<uint8_t>(major << 5 | value));
+    }
+    else if (value <= 0xFFFF)
+    {
+        out.push_back(static_cast<uint8_t>(major << 5 | 25));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+    else
+    {
+        out.push_back(static_cast<uint8_t>(major << 5 | 26));
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            out.push_back(static_cast<uint8_t>(value >> shift));
+        }
+    }
+}
+
+void cborKey(std::vector<uint8_t> &out, char key)
+{
+    cborHead(out, 3, 1);
+    out.push_back(static_cast<uint8_t>(key));
+}
+
+/**
+ * @brief A data block response as the service sends it
+ */
+std::vector<uint8_t> dataBlock(uint32_t fileId, uint32_t blockId, const uint8_t *payload, size_t length)
+{
+    std::vector<uint8_t> out;
+    cborHead(out, 5, 4);
+    cborKey(out, 'f');
+    cborHead(out, 0, fileId);
+    cborKey(out, 'i');
+    cborHead(out, 0, blockId);
+    cborKey(out, 'l');
+    cborHead(out, 0, static_cast<uint32_t>(length));
+    cborKey(out, 'p');
+    cborHead(out, 2, static_cast<uint32_t>(length));
+    out.insert(out.end(), payload, payload + length);
+    return out;
+}
+
+FileStreamConfig streamConfig(uint32_t fileSize)
+{
+    FileStreamConfig config;
+    config.thingName = "dev";
+    config.streamId = "fw";
+    config.fileId = 1;
+    config.fileSize = fileSize;
+    config.blockSize = 256;
+    config.window = 3;
+    config.requestTimeoutMs = 1000;
+    config.maxRetries = 2;
+    return config;
+}
+
+void sendBlock(MockMqttClient &client, const std::vector<uint8_t> &file, uint32_t block)
+{
+    size_t offset = block * 256;
+    size_t length = std::min<size_t>(256, file.size() - offset);
+    client.inject(PREFIX + "data/cbor", dataBlock(1, block, file.data() + offset, length));
+}
+
+/**
+ * @brief First block asked for by each request published since the last call
+ */
+std::vector<uint32_t> requestedBlocks(MockMqttClient &client)
+{
+    std::vector<uint32_t> blocks;
+    for (const MqttMessage &message : client.takePublished())
+    {
+        EXPECT_EQ(message.topic, PREFIX + "get/cbor");
+        // "o" is followed by the first block as an unsigned integer
+        for (size_t i = 0; i + 2 < message.payload.size(); i++)
+        {
+            if (message.payload[i] == 0x61 && message.payload[i + 1] == 'o')
+            {
+                uint8_t head = message.payload[i + 2];
+                blocks.push_back(head < 24 ? head : message.payload[i + 3]);
+                break;
+            }
+        }
+    }
+    return blocks;
+}
+
+} // namespace
+
+// =============================================================================
+// SHA-256 and CBOR
+// =============================================================================
+
+TEST(Sha256Test, MatchesKnownDigests)
+{
+    Sha256 hash;
+    std::array<uint8_t, 32> empty = hash.finish();
+    EXPECT_EQ(empty[0], 0xe3);
+    EXPECT_EQ(empty[31], 0x55);
+
+    hash.update(reinterpret_cast<const uint8_t *>("abc"), 3);
+    std::array<uint8_t, 32> abc = hash.finish();
+    EXPECT_EQ(abc[0], 0xba);
+    EXPECT_EQ(abc[1], 0x78);
+    EXPECT_EQ(abc[31], 0xad);
+
+    // Padding spills into a second block
+    const char *twoBlocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    hash.update(reinterpret_cast<const uint8_t *>(twoBlocks), 56);
+    std::array<uint8_t, 32> spilled = hash.finish();
+    EXPECT_EQ(spilled[0], 0x24);
+    EXPECT_EQ(spilled[1], 0x8d);
+    EXPECT_EQ(spilled[31], 0xc1);
+}
+
+TEST(Sha256Test, SplitUpdatesMatchOneUpdate)
+{
+    std::vector<uint8_t> data = makeFile(1000);
+    Sha256 split;
+    size_t sizes[] = {1, 63, 64, 65, 200, 607};
+    size_t offset = 0;
+    for (size_t size : sizes)
+    {
+        split.update(data.data() + offset, size);
+        offset += size;
+    }
+    EXPECT_EQ(split.finish(), sha256Of(data));
+}
+
+TEST(FileStreamCodecTest, EncodesGetRequest)
+{
+    uint8_t buffer[64];
+    size_t length = file_stream::encodeGetRequest(buffer, sizeof(buffer), "tok", 1, 1024, 300, 4);
+    // {"c": "tok", "f": 1, "l": 1024, "o": 300, "n": 4}
+    const uint8_t expected[] = {0xA5, 0x61, 'c', 0x63, 't', 'o', 'k', 0x61, 'f', 0x01, 0x61, 'l', 0x19,
+                                0x04, 0x00, 0x61, 'o', 0x19, 0x01, 0x2C, 0x61, 'n', 0x04};
+    ASSERT_EQ(length, sizeof(expected));
+    EXPECT_EQ(std::vector<uint8_t>(buffer, buffer + length), std::vector<uint8_t>(expected, expected + length));
+
+    EXPECT_EQ(file_stream::encodeGetRequest(buffer, 10, "tok", 1, 1024, 300, 4), 0u);
+}
+
+TEST(FileStreamCodecTest, DecodesDataBlockInPlace)
+{
+    const uint8_t payload[] = {1, 2, 3};
+    std::vector<uint8_t> message = dataBlock(7, 300, payload, sizeof(payload));
+
+    file_stream::DataBlock block;
+    ASSERT_TRUE(file_stream::decodeDataBlock(message.data(), message.size(), block));
+    EXPECT_EQ(block.fileId, 7u);
+    EXPECT_EQ(block.blockId, 300u);
+    EXPECT_EQ(block.blockSize, 3u);
+    EXPECT_EQ(block.payload, message.data() + message.size() - 3);
+    EXPECT_EQ(block.payloadLength, 3u);
+
+    EXPECT_FALSE(file_stream::decodeDataBlock(message.data(), message.size() - 1, block));
+}
+
+// =============================================================================
+// MqttFileDownloader
+// =============================================================================
+
+TEST(MqttFileDownloaderTest, KeepsWindowInFlightAndWritesInOrder)
+{
+    auto client = std::make_shared<MockMqttClient>();
+    std::vector<uint8_t> file = makeFile(256 * 4 + 100);
+    FileStreamConfig config = streamConfig(static_cast<uint32_t>(file.size()));
+    config.sha256 = sha256Of(file);
+    MemorySink sink;
+    MqttFileDownloader download(client, config, sink, fakeClock);
+
+    esp_err_t completed = ESP_FAIL;
+    ASSERT_EQ(download.start([&completed](esp_err_t result) { completed = result; }), ESP_OK);
+    EXPECT_TRUE(sink.begun);
+    EXPECT_TRUE(client->isSubscribed(PREFIX + "data/cbor"));
+    EXPECT_EQ(requestedBlocks(*client), std::vector<uint32_t>{0}); // Blocks 0-2 in one request
+
+    // Block 1 arrives first and waits for block 0
+    sendBlock(*client, file, 1);
+    EXPECT_EQ(download.getBytesWritten(), 0u);
+    EXPECT_TRUE(requestedBlocks(*client).empty());
+
+    sendBlock(*client, file, 0);
+    EXPECT_EQ(download.getBytesWritten(), 512u);
+    EXPECT_EQ(requestedBlocks(*client), std::vector<uint32_t>{3});
+
+    sendBlock(*client, file, 0); // Duplicate
+    sendBlock(*client, file, 2);
+    sendBlock(*client, file, 3);
+    sendBlock(*client, file, 4);
+
+    EXPECT_EQ(download.getState(), FileDownloadState::COMPLETE);
+    EXPECT_EQ(completed, ESP_OK);
+    EXPECT_EQ(sink.data, file);
+    EXPECT_TRUE(sink.finished);
+    EXPECT_EQ(download.getSha256(), *config.sha256);
+    FileDownloadStats stats = download.getStats();
+    EXPECT_EQ(stats.reordered, 1u);
+    EXPECT_EQ(stats.duplicates, 1u);
+    EXPECT_EQ(download.poll(), UINT32_MAX);
+}
+
+TEST(MqttFileDownloaderTest, RerequestsOverdueBlocksThenFails)
+{
+    auto client = std::make_shared<MockMqttClient>();
+    std::vector<uint8_t> file = makeFile(256 * 2);
+    MemorySink sink;
+    fakeNowUs = 0;
+    MqttFileDownloader download(client, streamConfig(static_cast<uint32_t>(file.size())), sink, fakeClock);
+    ASSERT_EQ(download.start(), ESP_OK);
+    requestedBlocks(*client);
+
+    sendBlock(*client, file, 1);
+    EXPECT_EQ(download.poll(), 1000u);
+    EXPECT_TRUE(requestedBlocks(*client).empty());
+
+    fakeNowUs = 1000 * 1000;
+    EXPECT_EQ(download.poll(), 1000u);
+    EXPECT_EQ(requestedBlocks(*client), std::vector<uint32_t>{0}); // Only the missing block
+
+    fakeNowUs += 1000 * 1000;
+    download.poll();
+    fakeNowUs += 1000 * 1000;
+    EXPECT_EQ(download.poll(), UINT32_MAX);
+    EXPECT_EQ(download.getState(), FileDownloadState::FAILED);
+    EXPECT_EQ(download.getResult(), ESP_ERR_TIMEOUT);
+    EXPECT_EQ(download.getStats().retries, 2u);
+    EXPECT_TRUE(sink.aborted);
+}
+
+TEST(MqttFileDownloaderTest, HashMismatchFails)
+{
+    auto client = std::make_shared<MockMqttClient>();
+    std::vector<uint8_t> file = makeFile(300);
+    FileStreamConfig config = streamConfig(static_cast<uint32_t>(file.size()));
+    config.sha256 = std::array<uint8_t, 32>{};
+    MemorySink sink;
+    MqttFileDownloader download(client, config, sink, fakeClock);
+    ASSERT_EQ(download.start(), ESP_OK);
+
+    sendBlock(*client, file, 0);
+    sendBlock(*client, file, 1);
+    EXPECT_EQ(download.getResult(), ESP_ERR_INVALID_CRC);
+    EXPECT_FALSE(sink.finished);
+    EXPECT_TRUE(sink.aborted);
+}
+
+TEST(MqttFileDownloaderTest, RejectionAndSinkErrorsFail)
+{
+    auto client = std::make_shared<MockMqttClient>();
+    std::vector<uint8_t> file = makeFile(600);
+    MemorySink rejectedSink;
+    {
+        MqttFileDownloader download(client, streamConfig(600), rejectedSink, fakeClock);
+        ASSERT_EQ(download.start(), ESP_OK);
+        client->inject(PREFIX + "rejected/cbor", {0xA0});
+        EXPECT_EQ(download.getResult(), ESP_ERR_NOT_FOUND);
+    }
+    EXPECT_FALSE(client->isSubscribed(PREFIX + "data/cbor"));
+
+    MemorySink failingSink;
+    failingSink.writeResult = ESP_ERR_NO_MEM;
+    MqttFileDownloader download(client, streamConfig(600), failingSink, fakeClock);
+    ASSERT_EQ(download.start(), ESP_OK);
+    sendBlock(*client, file, 0);
+    EXPECT_EQ(download.getResult(), ESP_ERR_NO_MEM);
+    EXPECT_TRUE(failingSink.aborted);
+}
+
+TEST(MqttFileDownloaderTest, IgnoresOtherFilesAndMalformedBlocks)
+{
+    auto client = std::make_shared<MockMqttClient>();
+    std::vector<uint8_t> file = makeFile(256);
+    MemorySink sink;
+    MqttFileDownloader download(client, streamConfig(256), sink, fakeClock);
+    ASSERT_EQ(download.start(), ESP_OK);
+
+    client->inject(PREFIX + "data/cbor", dataBlock(2, 0, file.data(), file.size()));
+    client->inject(PREFIX + "data/cbor", {0xA1, 0x61});
+    client->inject(PREFIX + "data/cbor", dataBlock(1, 0, file.data(), 100)); // Wrong length
+    EXPECT_EQ(download.getState(), FileDownloadState::DOWNLOADING);
+    EXPECT_EQ(download.getStats().malformed, 2u);
+
+    sendBlock(*client, file, 0);
+    EXPECT_EQ(download.getState(), FileDownloadState::COMPLETE);
+}
+
+TEST(MqttFileDownloaderTest, RejectsInvalidConfigAndSecondStart)
+{
+    auto client = std::make_shared<MockMqttClient>();
+    MemorySink sink;
+    FileStreamConfig config = streamConfig(1000);
+    config.blockSize = 100;
+    MqttFileDownloader invalid(client, config, sink, fakeClock);
+    EXPECT_EQ(invalid.start(), ESP_ERR_INVALID_ARG);
+
+    MqttFileDownloader download(client, streamConfig(1000), sink, fakeClock);
+    ASSERT_EQ(download.start(), ESP_OK);
+    EXPECT_EQ(download.start(), ESP_ERR_INVALID_STATE);
+    download.cancel();
+    EXPECT_EQ(download.getResult(), ESP_ERR_INVALID_STATE);
+}
+
+TEST(MqttFileDownloaderTest, StreamsIntoStorageFile)
+{
+    char pattern[] = "/tmp/lopcore_download_XXXXXX";
+    int fd = mkstemp(pattern);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    std::string path = pattern;
+    auto client = std::make_shared<MockMqttClient>();
+    std::vector<uint8_t> file = makeFile(256 * 3);
+    StorageFileSink sink(lopcore::StorageWriter(path, false, 512));
+    MqttFileDownloader download(client, streamConfig(static_cast<uint32_t>(file.size())), sink, fakeClock);
+    ASSERT_EQ(download.start(), ESP_OK);
+    sendBlock(*client, file, 2);
+    sendBlock(*client, file, 0);
+    sendBlock(*client, file, 1);
+    ASSERT_EQ(download.getResult(), ESP_OK);
+
+    lopcore::StorageReader reader(path, 0);
+    std::vector<uint8_t> written(reader.size());
+    EXPECT_EQ(reader.read(written.data(), written.size()), file.size());
+    EXPECT_EQ(written, file);
+    std::remove(path.c_str());
+}
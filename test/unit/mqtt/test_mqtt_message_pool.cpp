@@ -0,0 +1,108 @@
+/**
+ * @file test_mqtt_message_pool.cpp
+ * @brief Unit tests for the inbound reassembly pool and fragment delivery
+ */
+
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/mqtt/mqtt_config.hpp"
+#include "lopcore/mqtt/mqtt_dispatcher.hpp"
+#include "lopcore/mqtt/mqtt_message_pool.hpp"
+
+using namespace lopcore::mqtt;
+
+TEST(MqttMessagePoolTest, HandsOutDistinctBlocksUntilEmpty)
+{
+    MqttMessagePool pool(2, 1024);
+    EXPECT_EQ(pool.available(), 2u);
+
+    uint8_t *first = pool.acquire();
+    uint8_t *second = pool.acquire();
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(pool.acquire(), nullptr);
+    EXPECT_EQ(pool.available(), 0u);
+
+    // Blocks do not overlap
+    std::memset(first, 0xAA, pool.blockSize());
+    std::memset(second, 0x55, pool.blockSize());
+    EXPECT_EQ(first[pool.blockSize() - 1], 0xAA);
+}
+
+TEST(MqttMessagePoolTest, ReleasedBlockIsReused)
+{
+    MqttMessagePool pool(1, 1024);
+    uint8_t *block = pool.acquire();
+    ASSERT_NE(block, nullptr);
+    pool.release(block);
+    EXPECT_EQ(pool.available(), 1u);
+    EXPECT_EQ(pool.acquire(), block);
+
+    pool.release(nullptr); // Ignored
+    EXPECT_EQ(pool.available(), 0u);
+}
+
+TEST(MqttMessagePoolTest, ConfigValidation)
+{
+    InboundPoolConfig config;
+    EXPECT_EQ(config.validate(), ESP_OK); // Disabled by default
+
+    config.blocks = 2;
+    EXPECT_EQ(config.validate(), ESP_OK);
+
+    config.blockSize = 512;
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+
+    config.blockSize = 8192;
+    config.blocks = 9;
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+}
+
+TEST(MqttMessageFragmentTest, WholeMessageIsOneFragment)
+{
+    std::vector<MqttMessageFragment> seen;
+    std::string payload = "{\"jobId\":\"ota-1\"}";
+
+    MqttHandler handler;
+    handler.fragmentCallback = [&seen](const MqttMessageFragment &fragment) { seen.push_back(fragment); };
+
+    MqttMessageView view;
+    view.topic = "$aws/things/dev1/jobs/notify-next";
+    view.payload = reinterpret_cast<const uint8_t *>(payload.data());
+    view.payloadLength = payload.size();
+    view.qos = MqttQos::AT_LEAST_ONCE;
+    view.retained = false;
+    view.messageId = 7;
+
+    std::optional<MqttMessage> copy;
+    handler.invoke(view, copy);
+
+    ASSERT_EQ(seen.size(), 1u);
+    EXPECT_TRUE(seen[0].isFirst());
+    EXPECT_TRUE(seen[0].isLast());
+    EXPECT_EQ(seen[0].length, payload.size());
+    EXPECT_EQ(seen[0].totalLength, payload.size());
+    EXPECT_EQ(seen[0].topic, view.topic);
+    EXPECT_EQ(seen[0].messageId, 7u);
+    EXPECT_FALSE(copy.has_value()); // Streaming never makes an owning copy
+}
+
+TEST(MqttMessageFragmentTest, FirstAndLastFlags)
+{
+    MqttMessageFragment fragment{};
+    fragment.totalLength = 300;
+    fragment.offset = 0;
+    fragment.length = 100;
+    EXPECT_TRUE(fragment.isFirst());
+    EXPECT_FALSE(fragment.isLast());
+
+    fragment.offset = 200;
+    EXPECT_FALSE(fragment.isFirst());
+    EXPECT_TRUE(fragment.isLast());
+}
@@ -0,0 +1,87 @@
+/**
+ * @file test_mqtt_message_view.cpp
+ * @brief Unit tests for the non-owning MqttMessageView
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/mqtt/coremqtt_agent_client.hpp"
+#include "lopcore/mqtt/coremqtt_client.hpp"
+#include "lopcore/mqtt/imqtt_client.hpp"
+#include "lopcore/mqtt/mqtt_traits.hpp"
+#include "lopcore/mqtt/mqtt_types.hpp"
+
+using namespace lopcore::mqtt;
+
+// Clients that deliver views (EspMqttClient does too, but its header needs the real ESP-MQTT)
+static_assert(traits::has_message_views_v<CoreMqttClient>, "CoreMqttClient must support message views");
+static_assert(traits::has_message_views_v<CoreMqttAgentClient>, "CoreMqttAgentClient must support message views");
+static_assert(traits::has_message_views_v<IMqttClient>, "IMqttClient must support message views");
+
+namespace
+{
+
+MqttMessageView makeView(const std::string &topic, const std::vector<uint8_t> &payload)
+{
+    MqttMessageView view;
+    view.topic = topic;
+    view.payload = payload.data();
+    view.payloadLength = payload.size();
+    view.qos = MqttQos::AT_LEAST_ONCE;
+    view.retained = true;
+    view.messageId = 42;
+    return view;
+}
+
+} // namespace
+
+TEST(MqttMessageViewTest, PointsIntoSourceBuffer)
+{
+    std::string topic = "ota/chunk";
+    std::vector<uint8_t> payload(8192, 0x5A);
+
+    MqttMessageView view = makeView(topic, payload);
+    EXPECT_EQ(view.topic.data(), topic.data());
+    EXPECT_EQ(view.payload, payload.data());
+    EXPECT_EQ(view.payloadLength, payload.size());
+}
+
+TEST(MqttMessageViewTest, PayloadAsStringView)
+{
+    std::string topic = "cmd";
+    const char text[] = "reboot";
+    std::vector<uint8_t> payload(text, text + strlen(text));
+
+    MqttMessageView view = makeView(topic, payload);
+    EXPECT_EQ(view.getPayloadAsStringView(), "reboot");
+}
+
+TEST(MqttMessageViewTest, ToMessageCopies)
+{
+    std::string topic = "sensors/temp";
+    std::vector<uint8_t> payload = {1, 2, 3, 4};
+
+    MqttMessage message = makeView(topic, payload).toMessage();
+    topic.assign("changed");
+    payload.assign(4, 0);
+
+    EXPECT_EQ(message.topic, "sensors/temp");
+    EXPECT_EQ(message.payload, (std::vector<uint8_t>{1, 2, 3, 4}));
+    EXPECT_EQ(message.qos, MqttQos::AT_LEAST_ONCE);
+    EXPECT_TRUE(message.retained);
+    EXPECT_EQ(message.messageId, 42u);
+}
+
+TEST(MqttMessageViewTest, EmptyPayload)
+{
+    std::string topic = "ping";
+    std::vector<uint8_t> payload;
+
+    MqttMessageView view = makeView(topic, payload);
+    EXPECT_TRUE(view.getPayloadAsStringView().empty());
+    EXPECT_TRUE(view.toMessage().payload.empty());
+}
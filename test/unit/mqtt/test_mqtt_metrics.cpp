@@ -0,0 +1,151 @@
+/**
+ * @file test_mqtt_metrics.cpp
+ * @brief Unit tests for lock-free MQTT counters and latency histograms
+ */
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/mqtt/mqtt_metrics.hpp"
+
+using namespace lopcore::mqtt;
+
+TEST(MqttLatencyHistogramTest, BucketsByPowerOfTwo)
+{
+    MqttLatencyHistogram histogram;
+    histogram.record(0);
+    histogram.record(1);
+    histogram.record(3);
+    histogram.record(1000);
+
+    MqttHistogramSnapshot snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 4u);
+    EXPECT_EQ(snapshot.sumUs, 1004u);
+    EXPECT_EQ(snapshot.maxUs, 1000u);
+    EXPECT_EQ(snapshot.meanUs(), 251u);
+    EXPECT_EQ(snapshot.buckets[0], 1u);  // 0
+    EXPECT_EQ(snapshot.buckets[1], 1u);  // 1
+    EXPECT_EQ(snapshot.buckets[2], 1u);  // 2-3
+    EXPECT_EQ(snapshot.buckets[10], 1u); // 512-1023
+}
+
+TEST(MqttLatencyHistogramTest, PercentilesAreBucketUpperBounds)
+{
+    MqttLatencyHistogram histogram;
+    for (int i = 0; i < 90; i++)
+    {
+        histogram.record(100); // Bucket 64-127
+    }
+    for (int i = 0; i < 10; i++)
+    {
+        histogram.record(5000); // Bucket 4096-8191
+    }
+
+    MqttHistogramSnapshot snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.percentileUs(50), 127u);
+    EXPECT_EQ(snapshot.percentileUs(90), 127u);
+    EXPECT_EQ(snapshot.percentileUs(99), 5000u); // Capped at the largest sample
+    EXPECT_EQ(MqttHistogramSnapshot{}.percentileUs(50), 0u);
+}
+
+TEST(MqttLatencyHistogramTest, HugeSamplesLandInLastBucket)
+{
+    MqttLatencyHistogram histogram;
+    histogram.record(UINT32_MAX);
+    MqttHistogramSnapshot snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.buckets[MQTT_HISTOGRAM_BUCKETS - 1], 1u);
+    EXPECT_EQ(snapshot.percentileUs(100), UINT32_MAX);
+}
+
+TEST(MqttMetricsTest, CountersAddUpAcrossThreads)
+{
+    MqttMetrics metrics;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&metrics]() {
+            for (int i = 0; i < 10000; i++)
+            {
+                metrics.increment(MqttCounter::MESSAGES_RECEIVED);
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    metrics.increment(MqttCounter::PUBLISH_ERRORS, 3);
+    EXPECT_EQ(metrics.total(MqttCounter::MESSAGES_RECEIVED), 40000u);
+    EXPECT_EQ(metrics.snapshot().publishErrors, 3u);
+}
+
+TEST(MqttMetricsTest, AckLatencyIsMeasuredPerPacket)
+{
+    MqttMetrics metrics;
+    metrics.publishSent(1, 1000);
+    metrics.publishSent(2, 2000);
+    metrics.publishAcked(2, 2500);
+    metrics.publishAcked(1, 4000);
+    metrics.publishAcked(1, 9000); // Duplicate ack is not counted twice
+    metrics.publishAcked(7, 9000); // Never sent
+
+    MqttHistogramSnapshot ack = metrics.snapshot().publishAckLatency;
+    EXPECT_EQ(ack.count, 2u);
+    EXPECT_EQ(ack.sumUs, 3500u);
+    EXPECT_EQ(ack.maxUs, 3000u);
+}
+
+TEST(MqttMetricsTest, AckLatencySurvivesClockWrap)
+{
+    MqttMetrics metrics;
+    metrics.publishSent(5, 0xFFFFFF00LL);
+    metrics.publishAcked(5, 0x100000100LL);
+    EXPECT_EQ(metrics.snapshot().publishAckLatency.maxUs, 0x200u);
+}
+
+TEST(MqttMetricsTest, ResetClearsEverything)
+{
+    MqttMetrics metrics;
+    metrics.increment(MqttCounter::MESSAGES_PUBLISHED);
+    metrics.callbackDuration().record(10);
+    metrics.publishSent(1, 0);
+    metrics.reset();
+    metrics.publishAcked(1, 100);
+
+    MqttMetricsSnapshot snapshot = metrics.snapshot();
+    EXPECT_EQ(snapshot.messagesPublished, 0u);
+    EXPECT_EQ(snapshot.callbackDuration.count, 0u);
+    EXPECT_EQ(snapshot.publishAckLatency.count, 0u);
+}
+
+TEST(MqttMetricsSnapshotTest, FormatsJson)
+{
+    MqttMetrics metrics;
+    metrics.increment(MqttCounter::MESSAGES_PUBLISHED, 12);
+    metrics.increment(MqttCounter::MESSAGES_RECEIVED, 3);
+    metrics.processLoopDuration().record(100);
+
+    char json[256];
+    size_t length = metrics.snapshot().formatJson(json, sizeof(json));
+    ASSERT_GT(length, 0u);
+    EXPECT_EQ(length, std::strlen(json));
+    EXPECT_EQ(std::string(json),
+              "{\"pub\":12,\"rx\":3,\"err\":0,\"drop\":0,\"reconn\":0,"
+              "\"ack\":{\"n\":0,\"p50\":0,\"p90\":0,\"p99\":0,\"max\":0},"
+              "\"cb\":{\"n\":0,\"p50\":0,\"p90\":0,\"p99\":0,\"max\":0},"
+              "\"loop\":{\"n\":1,\"p50\":100,\"p90\":100,\"p99\":100,\"max\":100}}");
+}
+
+TEST(MqttMetricsSnapshotTest, FormatJsonReportsTruncation)
+{
+    MqttMetricsSnapshot snapshot;
+    char json[64];
+    EXPECT_EQ(snapshot.formatJson(json, sizeof(json)), 0u);
+    EXPECT_EQ(json[0], '\0');
+    EXPECT_EQ(snapshot.formatJson(nullptr, 0), 0u);
+}
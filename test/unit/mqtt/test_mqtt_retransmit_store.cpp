@@ -0,0 +1,128 @@
+/**
+ * @file test_mqtt_retransmit_store.cpp
+ * @brief Unit tests for the QoS 1/2 retransmit store
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/mqtt/mqtt_retransmit_store.hpp"
+
+using namespace lopcore::mqtt;
+
+namespace
+{
+
+esp_err_t storeString(MqttRetransmitStore &store,
+                      uint16_t packetId,
+                      const std::string &topic,
+                      const std::string &payload,
+                      MqttQos qos = MqttQos::AT_LEAST_ONCE)
+{
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(payload.data());
+    return store.store(packetId, topic, data, payload.size(), qos, false);
+}
+
+std::vector<uint16_t> packetIds(MqttRetransmitStore &store)
+{
+    std::vector<uint16_t> ids;
+    store.forEach([&ids](const MqttRetransmitStore::Entry &entry) { ids.push_back(entry.packetId); });
+    return ids;
+}
+
+} // namespace
+
+TEST(MqttRetransmitStoreTest, StoresAndFindsByPacketId)
+{
+    MqttRetransmitStore store(4, 128);
+    EXPECT_EQ(store.capacity(), 4u);
+    EXPECT_TRUE(store.empty());
+
+    const uint8_t payload[] = {'{', '}'};
+    ASSERT_EQ(store.store(7, "shadow/update", payload, 2, MqttQos::EXACTLY_ONCE, true), ESP_OK);
+    EXPECT_EQ(store.size(), 1u);
+
+    MqttRetransmitStore::Entry entry;
+    ASSERT_TRUE(store.find(7, &entry));
+    EXPECT_EQ(entry.packetId, 7u);
+    EXPECT_EQ(entry.topic, "shadow/update");
+    EXPECT_EQ(std::string(reinterpret_cast<const char *>(entry.payload), entry.payloadLength), "{}");
+    EXPECT_EQ(entry.qos, MqttQos::EXACTLY_ONCE);
+    EXPECT_TRUE(entry.retain);
+
+    EXPECT_FALSE(store.find(8, &entry));
+}
+
+TEST(MqttRetransmitStoreTest, ReleaseFreesSlot)
+{
+    MqttRetransmitStore store(1, 128);
+    ASSERT_EQ(storeString(store, 1, "a", "x"), ESP_OK);
+    EXPECT_EQ(storeString(store, 2, "b", "y"), ESP_ERR_NO_MEM);
+
+    EXPECT_TRUE(store.release(1));
+    EXPECT_FALSE(store.release(1));
+    EXPECT_TRUE(store.empty());
+
+    EXPECT_EQ(storeString(store, 2, "b", "y"), ESP_OK);
+}
+
+TEST(MqttRetransmitStoreTest, SamePacketIdReplacesEntry)
+{
+    MqttRetransmitStore store(2, 128);
+    ASSERT_EQ(storeString(store, 5, "old", "1"), ESP_OK);
+    ASSERT_EQ(storeString(store, 5, "new", "2"), ESP_OK);
+    EXPECT_EQ(store.size(), 1u);
+
+    MqttRetransmitStore::Entry entry;
+    ASSERT_TRUE(store.find(5, &entry));
+    EXPECT_EQ(entry.topic, "new");
+}
+
+TEST(MqttRetransmitStoreTest, RejectsInvalidPublishes)
+{
+    MqttRetransmitStore store(2, 64);
+    EXPECT_EQ(storeString(store, 0, "a", "x"), ESP_ERR_INVALID_ARG);
+    EXPECT_EQ(storeString(store, 1, "a", "x", MqttQos::AT_MOST_ONCE), ESP_ERR_INVALID_ARG);
+
+    // Topic plus payload must fit one slot
+    EXPECT_EQ(storeString(store, 1, "t", std::string(63, 'x')), ESP_OK);
+    EXPECT_EQ(storeString(store, 2, "tt", std::string(63, 'x')), ESP_ERR_INVALID_SIZE);
+    EXPECT_EQ(store.size(), 1u);
+}
+
+TEST(MqttRetransmitStoreTest, IteratesOldestFirst)
+{
+    MqttRetransmitStore store(4, 128);
+    ASSERT_EQ(storeString(store, 10, "a", "1"), ESP_OK);
+    ASSERT_EQ(storeString(store, 11, "b", "2"), ESP_OK);
+    ASSERT_EQ(storeString(store, 12, "c", "3"), ESP_OK);
+
+    // 13 reuses 10's slot but is newer than 11 and 12
+    ASSERT_TRUE(store.release(10));
+    ASSERT_EQ(storeString(store, 13, "d", "4"), ESP_OK);
+
+    EXPECT_EQ(packetIds(store), (std::vector<uint16_t>{11, 12, 13}));
+}
+
+TEST(MqttRetransmitStoreTest, ReleaseDuringIteration)
+{
+    MqttRetransmitStore store(4, 128);
+    for (uint16_t id = 1; id <= 4; id++)
+    {
+        ASSERT_EQ(storeString(store, id, "t", "p"), ESP_OK);
+    }
+
+    store.forEach([&store](const MqttRetransmitStore::Entry &entry) {
+        if (entry.packetId % 2 == 0)
+        {
+            store.release(entry.packetId);
+        }
+    });
+    EXPECT_EQ(packetIds(store), (std::vector<uint16_t>{1, 3}));
+
+    store.clear();
+    EXPECT_TRUE(store.empty());
+    EXPECT_TRUE(packetIds(store).empty());
+}
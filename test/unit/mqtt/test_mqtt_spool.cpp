@@ -0,0 +1,258 @@
+/**
+ * @file test_mqtt_spool.cpp
+ * @brief Unit tests for the offline publish spool
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/mqtt/mqtt_spool.hpp"
+
+using namespace lopcore::mqtt;
+
+namespace
+{
+
+struct Drained
+{
+    std::string topic;
+    std::string payload;
+    MqttQos qos;
+    bool retained;
+};
+
+} // namespace
+
+class MqttSpoolTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char pattern[] = "/tmp/lopcore_spool_XXXXXX";
+        ASSERT_NE(mkdtemp(pattern), nullptr);
+        root_ = pattern;
+
+        config_.enabled = true;
+        config_.directory = root_ + "/spool";
+        config_.segmentSize = 1024;
+        config_.maxSegments = 4;
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(root_);
+    }
+
+    static esp_err_t append(MqttSpool &spool,
+                            const std::string &topic,
+                            const std::string &payload,
+                            MqttQos qos = MqttQos::AT_LEAST_ONCE,
+                            bool retain = false)
+    {
+        MqttPayloadSegment segment{payload.data(), payload.size()};
+        return spool.append(topic, &segment, 1, qos, retain);
+    }
+
+    size_t drainAll(MqttSpool &spool, size_t maxRecords = 1000)
+    {
+        return spool.drain(maxRecords, [this](const MqttMessageView &msg) {
+            std::string payload(msg.getPayloadAsStringView());
+            drained_.push_back(Drained{std::string(msg.topic), payload, msg.qos, msg.retained});
+            return ESP_OK;
+        });
+    }
+
+    size_t segmentFiles() const
+    {
+        size_t count = 0;
+        for (const auto &entry : std::filesystem::directory_iterator(config_.directory))
+        {
+            count += entry.path().extension() == ".seg" ? 1 : 0;
+        }
+        return count;
+    }
+
+    std::string root_;
+    SpoolConfig config_;
+    std::vector<Drained> drained_;
+};
+
+TEST_F(MqttSpoolTest, DrainsInAppendOrder)
+{
+    MqttSpool spool(config_);
+    ASSERT_EQ(spool.open(), ESP_OK);
+
+    EXPECT_EQ(append(spool, "sensors/temp", "21.5"), ESP_OK);
+    EXPECT_EQ(append(spool, "sensors/hum", "40", MqttQos::AT_MOST_ONCE, true), ESP_OK);
+
+    // Segments are written back to back into one payload
+    MqttPayloadSegment parts[] = {{"hdr:", 4}, {"data", 4}, {":crc", 4}};
+    EXPECT_EQ(spool.append("frames", parts, 3, MqttQos::EXACTLY_ONCE, false), ESP_OK);
+    EXPECT_EQ(spool.pendingCount(), 3u);
+
+    EXPECT_EQ(drainAll(spool), 3u);
+    ASSERT_EQ(drained_.size(), 3u);
+    EXPECT_EQ(drained_[0].topic, "sensors/temp");
+    EXPECT_EQ(drained_[0].payload, "21.5");
+    EXPECT_EQ(drained_[0].qos, MqttQos::AT_LEAST_ONCE);
+    EXPECT_FALSE(drained_[0].retained);
+    EXPECT_EQ(drained_[1].qos, MqttQos::AT_MOST_ONCE);
+    EXPECT_TRUE(drained_[1].retained);
+    EXPECT_EQ(drained_[2].payload, "hdr:data:crc");
+    EXPECT_EQ(drained_[2].qos, MqttQos::EXACTLY_ONCE);
+    EXPECT_TRUE(spool.empty());
+}
+
+TEST_F(MqttSpoolTest, RecordsSurviveReopen)
+{
+    {
+        MqttSpool spool(config_);
+        ASSERT_EQ(spool.open(), ESP_OK);
+        for (int i = 0; i < 5; i++)
+        {
+            ASSERT_EQ(append(spool, "log", "entry " + std::to_string(i)), ESP_OK);
+        }
+    }
+
+    MqttSpool spool(config_);
+    ASSERT_EQ(spool.open(), ESP_OK);
+    EXPECT_EQ(spool.pendingCount(), 5u);
+    EXPECT_EQ(drainAll(spool), 5u);
+    EXPECT_EQ(drained_.back().payload, "entry 4");
+}
+
+TEST_F(MqttSpoolTest, CursorSkipsReplayedRecords)
+{
+    {
+        MqttSpool spool(config_);
+        ASSERT_EQ(spool.open(), ESP_OK);
+        for (int i = 0; i < 4; i++)
+        {
+            ASSERT_EQ(append(spool, "log", std::to_string(i)), ESP_OK);
+        }
+        EXPECT_EQ(drainAll(spool, 3), 3u);
+    }
+
+    drained_.clear();
+    MqttSpool spool(config_);
+    ASSERT_EQ(spool.open(), ESP_OK);
+    EXPECT_EQ(spool.pendingCount(), 1u);
+    EXPECT_EQ(drainAll(spool), 1u);
+    EXPECT_EQ(drained_[0].payload, "3");
+}
+
+TEST_F(MqttSpoolTest, FailedSendKeepsRecord)
+{
+    MqttSpool spool(config_);
+    ASSERT_EQ(spool.open(), ESP_OK);
+    ASSERT_EQ(append(spool, "a", "1"), ESP_OK);
+    ASSERT_EQ(append(spool, "b", "2"), ESP_OK);
+
+    size_t calls = 0;
+    EXPECT_EQ(spool.drain(10,
+                          [&calls](const MqttMessageView &) {
+                              calls++;
+                              return ESP_ERR_NO_MEM; // e.g. budget exhausted
+                          }),
+              0u);
+    EXPECT_EQ(calls, 1u);
+    EXPECT_EQ(spool.pendingCount(), 2u);
+
+    EXPECT_EQ(drainAll(spool), 2u);
+    EXPECT_EQ(drained_[0].topic, "a");
+}
+
+TEST_F(MqttSpoolTest, RollsSegmentsAndDropsOldest)
+{
+    MqttSpool spool(config_);
+    ASSERT_EQ(spool.open(), ESP_OK);
+
+    // 14-byte header + 6-byte topic + 200-byte payload: four records per 1 KB segment
+    std::string payload(200, 'x');
+    for (int i = 0; i < 40; i++)
+    {
+        ASSERT_EQ(append(spool, "bulk/" + std::to_string(i % 10), payload), ESP_OK);
+    }
+
+    EXPECT_LE(segmentFiles(), config_.maxSegments);
+    EXPECT_GT(spool.getStats().recordsDropped, 0u);
+    EXPECT_EQ(spool.pendingCount() + spool.getStats().recordsDropped, 40u);
+
+    size_t pending = spool.pendingCount();
+    EXPECT_EQ(drainAll(spool), pending);
+    EXPECT_EQ(segmentFiles(), 1u); // Only a fresh write segment is left
+}
+
+TEST_F(MqttSpoolTest, TornTailIsSkipped)
+{
+    {
+        MqttSpool spool(config_);
+        ASSERT_EQ(spool.open(), ESP_OK);
+        ASSERT_EQ(append(spool, "a", "first"), ESP_OK);
+        ASSERT_EQ(append(spool, "b", "second"), ESP_OK);
+    }
+
+    // Cut the last record short, as a reset in the middle of a write would
+    for (const auto &entry : std::filesystem::directory_iterator(config_.directory))
+    {
+        if (entry.path().extension() == ".seg" && entry.file_size() > 0)
+        {
+            std::filesystem::resize_file(entry.path(), entry.file_size() - 3);
+        }
+    }
+
+    MqttSpool spool(config_);
+    ASSERT_EQ(spool.open(), ESP_OK);
+    EXPECT_EQ(spool.pendingCount(), 1u);
+    EXPECT_EQ(spool.getStats().recordsCorrupt, 1u);
+
+    EXPECT_EQ(drainAll(spool), 1u);
+    EXPECT_EQ(drained_[0].payload, "first");
+
+    // New appends go to a fresh segment and are not hidden by the torn one
+    ASSERT_EQ(append(spool, "c", "third"), ESP_OK);
+    EXPECT_EQ(drainAll(spool), 1u);
+    EXPECT_EQ(drained_[1].payload, "third");
+}
+
+TEST_F(MqttSpoolTest, CorruptPayloadFailsCrc)
+{
+    {
+        MqttSpool spool(config_);
+        ASSERT_EQ(spool.open(), ESP_OK);
+        ASSERT_EQ(append(spool, "a", "payload"), ESP_OK);
+    }
+
+    for (const auto &entry : std::filesystem::directory_iterator(config_.directory))
+    {
+        if (entry.path().extension() == ".seg" && entry.file_size() > 0)
+        {
+            FILE *file = fopen(entry.path().c_str(), "r+b");
+            ASSERT_NE(file, nullptr);
+            fseek(file, -1, SEEK_END);
+            fputc('!', file);
+            fclose(file);
+        }
+    }
+
+    MqttSpool spool(config_);
+    ASSERT_EQ(spool.open(), ESP_OK);
+    EXPECT_EQ(spool.pendingCount(), 0u);
+    EXPECT_EQ(drainAll(spool), 0u);
+}
+
+TEST_F(MqttSpoolTest, RejectsInvalidRecords)
+{
+    MqttSpool spool(config_);
+    EXPECT_EQ(append(spool, "a", "x"), ESP_ERR_INVALID_STATE);
+
+    ASSERT_EQ(spool.open(), ESP_OK);
+    EXPECT_EQ(append(spool, "", "x"), ESP_ERR_INVALID_ARG);
+    EXPECT_EQ(append(spool, "a", std::string(config_.segmentSize, 'x')), ESP_ERR_INVALID_SIZE);
+    EXPECT_TRUE(spool.empty());
+}
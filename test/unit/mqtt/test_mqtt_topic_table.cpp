@@ -0,0 +1,147 @@
+/**
+ * @file test_mqtt_topic_table.cpp
+ * @brief Unit tests for interned topics and publishing by TopicHandle
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/mqtt/mqtt_compressor.hpp"
+#include "lopcore/mqtt/mqtt_topic_table.hpp"
+#include "mqtt/mock_mqtt_client.hpp"
+
+using namespace lopcore::mqtt;
+using lopcore::test::MockMqttClient;
+
+namespace
+{
+
+const char *SHADOW_UPDATE = "$aws/things/sensor-01/shadow/name/telemetry/update";
+
+} // namespace
+
+TEST(MqttTopicTableTest, InternReturnsStableHandles)
+{
+    MqttTopicTable table(4);
+    TopicHandle first = table.intern(SHADOW_UPDATE);
+    TopicHandle second = table.intern("dt/sensor-01/status");
+    ASSERT_TRUE(first.isValid());
+    ASSERT_TRUE(second.isValid());
+    EXPECT_NE(first.id, second.id);
+
+    const std::string *topic = table.lookup(first);
+    ASSERT_NE(topic, nullptr);
+    EXPECT_EQ(*topic, SHADOW_UPDATE);
+
+    // Growing the table must not move earlier entries
+    table.intern("dt/sensor-01/events");
+    EXPECT_EQ(table.lookup(first), topic);
+}
+
+TEST(MqttTopicTableTest, InternDeduplicates)
+{
+    MqttTopicTable table(4);
+    TopicHandle first = table.intern(SHADOW_UPDATE);
+    TopicHandle again = table.intern(std::string(SHADOW_UPDATE));
+    EXPECT_EQ(first.id, again.id);
+    EXPECT_EQ(table.size(), 1u);
+}
+
+TEST(MqttTopicTableTest, RejectsInvalidTopics)
+{
+    MqttTopicTable table(4);
+    EXPECT_FALSE(table.intern("").isValid());
+    EXPECT_FALSE(table.intern("sensors/+/value").isValid());
+    EXPECT_FALSE(table.intern("sensors/#").isValid());
+    EXPECT_EQ(table.size(), 0u);
+}
+
+TEST(MqttTopicTableTest, FullTableReturnsInvalidHandle)
+{
+    MqttTopicTable table(2);
+    EXPECT_TRUE(table.intern("a").isValid());
+    EXPECT_TRUE(table.intern("b").isValid());
+    EXPECT_FALSE(table.intern("c").isValid());
+
+    // Already registered topics are still found
+    EXPECT_TRUE(table.intern("a").isValid());
+}
+
+TEST(MqttTopicTableTest, LookupRejectsUnknownHandles)
+{
+    MqttTopicTable table(4);
+    TopicHandle handle = table.intern("a");
+    EXPECT_EQ(table.lookup(TopicHandle{}), nullptr);
+    EXPECT_EQ(table.lookup(TopicHandle{static_cast<uint16_t>(handle.id + 1)}), nullptr);
+}
+
+TEST(MqttTopicTableTest, AliasesAreClearedTogether)
+{
+    MqttTopicTable table(4);
+    TopicHandle a = table.intern("a");
+    TopicHandle b = table.intern("b");
+    EXPECT_EQ(table.aliasOf(a), 0u);
+
+    table.setAlias(a, 1);
+    table.setAlias(b, 2);
+    table.setAlias(TopicHandle{}, 3); // Ignored
+    EXPECT_EQ(table.aliasOf(a), 1u);
+    EXPECT_EQ(table.aliasOf(b), 2u);
+
+    table.clearAliases();
+    EXPECT_EQ(table.aliasOf(a), 0u);
+    EXPECT_EQ(table.aliasOf(b), 0u);
+}
+
+TEST(TopicHandlePublishTest, DefaultPublishResolvesHandle)
+{
+    MockMqttClient client;
+    TopicHandle handle = client.registerTopic(SHADOW_UPDATE);
+    ASSERT_TRUE(handle.isValid());
+    EXPECT_EQ(client.topicName(handle), SHADOW_UPDATE);
+
+    const char header[] = "{\"state\":";
+    const char body[] = "{}}";
+    MqttPayloadSegment segments[] = {{header, sizeof(header) - 1}, {body, sizeof(body) - 1}};
+    IMqttClient &base = client;
+    ASSERT_EQ(base.publish(handle, segments, 2), ESP_OK);
+
+    std::vector<MqttMessage> sent = client.takePublished();
+    ASSERT_EQ(sent.size(), 1u);
+    EXPECT_EQ(sent[0].topic, SHADOW_UPDATE);
+    EXPECT_EQ(std::string(sent[0].payload.begin(), sent[0].payload.end()), "{\"state\":{}}");
+}
+
+TEST(TopicHandlePublishTest, UnknownHandleIsRejected)
+{
+    MockMqttClient client;
+    MqttPayloadSegment segment{"x", 1};
+    IMqttClient &base = client;
+    EXPECT_EQ(base.publish(TopicHandle{}, &segment, 1), ESP_ERR_INVALID_ARG);
+    EXPECT_EQ(base.publish(TopicHandle{5}, &segment, 1), ESP_ERR_INVALID_ARG);
+    EXPECT_TRUE(client.takePublished().empty());
+}
+
+TEST(TopicHandlePublishTest, DecoratorsSeeHandlePublishes)
+{
+    auto mock = std::make_shared<MockMqttClient>();
+    CompressionConfig config;
+    config.minPayloadSize = 16;
+    MqttCompressor compressor(mock, config);
+
+    // The handle comes from the wrapped client, the publish goes through the compressor
+    TopicHandle handle = compressor.registerTopic("dt/sensor-01/telemetry");
+    ASSERT_TRUE(handle.isValid());
+
+    std::string payload(256, 'a');
+    MqttPayloadSegment segment{payload.data(), payload.size()};
+    ASSERT_EQ(compressor.publish(handle, &segment, 1), ESP_OK);
+
+    std::vector<MqttMessage> sent = mock->takePublished();
+    ASSERT_EQ(sent.size(), 1u);
+    EXPECT_EQ(sent[0].topic, "dt/sensor-01/telemetry/lz");
+    EXPECT_LT(sent[0].payload.size(), payload.size());
+}
@@ -56,6 +56,9 @@ static_assert(has_statistics_v<EspMqttClient>, "EspMqttClient must support stati
 // QoS 2 Support
 static_assert(supports_qos2_v<EspMqttClient>, "EspMqttClient must support QoS 2");
 
+// Zero-copy message delivery
+static_assert(has_message_views_v<EspMqttClient>, "EspMqttClient must support message views");
+
 // Composite Traits
 static_assert(!is_synchronous_capable_v<EspMqttClient>,
               "EspMqttClient must NOT support synchronous patterns (no manual processing)");
@@ -4,7 +4,8 @@
  */
 
 #include <gtest/gtest.h>
-#include <mqtt/mqtt_types.hpp>
+
+#include "lopcore/mqtt/mqtt_types.hpp"
 
 using namespace lopcore::mqtt;
 
@@ -67,9 +68,23 @@ TEST(MqttTypesTest, ClientTypeToString)
 {
     EXPECT_STREQ(clientTypeToString(MqttClientType::ESP_MQTT), "ESP-MQTT");
     EXPECT_STREQ(clientTypeToString(MqttClientType::AWS_IOT), "AWS-IOT");
+    EXPECT_STREQ(clientTypeToString(MqttClientType::AWS_IOT_AGENT), "AWS-IOT-AGENT");
     EXPECT_STREQ(clientTypeToString(MqttClientType::MOCK), "MOCK");
 }
 
+TEST(MqttTypesTest, DefaultClientTypeWithoutKconfigIsAuto)
+{
+    EXPECT_EQ(defaultClientType(), MqttClientType::AUTO);
+}
+
+TEST(MqttTypesTest, ResolveClientType)
+{
+    EXPECT_EQ(resolveClientType(MqttClientType::AUTO, "abc123-ats.iot.eu-west-1.amazonaws.com"),
+              MqttClientType::AWS_IOT);
+    EXPECT_EQ(resolveClientType(MqttClientType::AUTO, "mqtt.example.com"), MqttClientType::ESP_MQTT);
+    EXPECT_EQ(resolveClientType(MqttClientType::AWS_IOT_AGENT, "mqtt.example.com"), MqttClientType::AWS_IOT_AGENT);
+}
+
 // =============================================================================
 // MqttMessage Tests
 // =============================================================================
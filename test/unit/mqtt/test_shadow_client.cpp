@@ -0,0 +1,319 @@
+/**
+ * @file test_shadow_client.cpp
+ * @brief Unit tests for the delta-only Device Shadow client
+ */
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/mqtt/shadow_client.hpp"
+#include "mqtt/mock_mqtt_client.hpp"
+
+using namespace lopcore::mqtt;
+using lopcore::NvsStorage;
+using lopcore::test::MockMqttClient;
+
+namespace
+{
+
+int64_t fakeNowUs = 0;
+
+int64_t fakeClock()
+{
+    return fakeNowUs;
+}
+
+const std::string PREFIX = "$aws/things/dev/shadow/";
+
+std::vector<uint8_t> bytes(const std::string &text)
+{
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+std::string text(const MqttMessage &message)
+{
+    return std::string(message.payload.begin(), message.payload.end());
+}
+
+} // namespace
+
+class ShadowClientTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        fakeNowUs = 0;
+        mock = std::make_shared<MockMqttClient>();
+        config.thingName = "dev";
+        config.coalesceMs = 100;
+        config.retryMs = 1000;
+    }
+
+    std::unique_ptr<ShadowClient> makeShadow(NvsStorage *cache = nullptr)
+    {
+        auto shadow = std::make_unique<ShadowClient>(mock, config, cache, fakeClock);
+        EXPECT_EQ(shadow->start(), ESP_OK);
+        return shadow;
+    }
+
+    std::vector<std::string> sentUpdates()
+    {
+        std::vector<std::string> updates;
+        for (const auto &message : mock->takePublished())
+        {
+            EXPECT_EQ(message.topic, PREFIX + "update");
+            updates.push_back(text(message));
+        }
+        return updates;
+    }
+
+    std::shared_ptr<MockMqttClient> mock;
+    ShadowConfig config;
+};
+
+TEST(ShadowJsonTest, FlattensObjectsIntoDottedLeaves)
+{
+    std::vector<std::pair<std::string, std::string>> leaves;
+    ASSERT_TRUE(lopcore::mqtt::shadow_json::forEachLeaf(
+        R"({"a":1, "b":{"c":"x,}","d":[1,{"e":2}]}, "f":null})",
+        [&](std::string_view path, std::string_view value) { leaves.emplace_back(path, value); }));
+
+    std::vector<std::pair<std::string, std::string>> expected = {
+        {"a", "1"}, {"b.c", "\"x,}\""}, {"b.d", "[1,{\"e\":2}]"}, {"f", "null"}};
+    EXPECT_EQ(leaves, expected);
+}
+
+TEST(ShadowJsonTest, RejectsMalformedDocuments)
+{
+    auto ignore = [](std::string_view, std::string_view) {};
+    EXPECT_FALSE(lopcore::mqtt::shadow_json::forEachLeaf(R"({"a":1)", ignore));
+    EXPECT_FALSE(lopcore::mqtt::shadow_json::forEachLeaf(R"({"a" 1})", ignore));
+    EXPECT_FALSE(lopcore::mqtt::shadow_json::forEachLeaf("bogus", ignore));
+    EXPECT_FALSE(lopcore::mqtt::shadow_json::forEachLeaf("1 2", ignore));
+    EXPECT_FALSE(lopcore::mqtt::shadow_json::forEachLeaf(R"({"a":{"b":{"c":{"d":{"e":{"f":{"g":{"h":{"i":1}}}}}}}}})",
+                                                         ignore));
+    EXPECT_TRUE(lopcore::mqtt::shadow_json::forEachLeaf("-1.5e3", ignore));
+}
+
+TEST(ShadowJsonTest, QuoteEscapes)
+{
+    EXPECT_EQ(lopcore::mqtt::shadow_json::quote("a\"b\\c\n"), "\"a\\\"b\\\\c\\u000a\"");
+}
+
+TEST_F(ShadowClientTest, StartSubscribesToDeltaAndRejected)
+{
+    auto shadow = makeShadow();
+    EXPECT_TRUE(mock->isSubscribed(PREFIX + "update/delta"));
+    EXPECT_TRUE(mock->isSubscribed(PREFIX + "update/rejected"));
+    EXPECT_EQ(shadow->start(), ESP_ERR_INVALID_STATE);
+
+    config.shadowName = "settings";
+    ShadowClient named(mock, config, nullptr, fakeClock);
+    ASSERT_EQ(named.start(), ESP_OK);
+    EXPECT_TRUE(mock->isSubscribed("$aws/things/dev/shadow/name/settings/update/delta"));
+}
+
+TEST_F(ShadowClientTest, CoalescesReportsWithinWindow)
+{
+    auto shadow = makeShadow();
+    EXPECT_EQ(shadow->report("temperature", 21.5), ESP_OK);
+    EXPECT_EQ(shadow->report("led", true), ESP_OK);
+    EXPECT_EQ(shadow->report("temperature", 22), ESP_OK);
+    EXPECT_EQ(shadow->report("wifi.rssi", -60), ESP_OK);
+
+    EXPECT_EQ(shadow->poll(), 100u);
+    EXPECT_TRUE(sentUpdates().empty());
+
+    fakeNowUs = 100000;
+    EXPECT_EQ(shadow->poll(), UINT32_MAX);
+    auto updates = sentUpdates();
+    ASSERT_EQ(updates.size(), 1u);
+    EXPECT_EQ(updates[0], R"({"state":{"reported":{"led":true,"temperature":22,"wifi":{"rssi":-60}}}})");
+
+    ShadowStats stats = shadow->getStats();
+    EXPECT_EQ(stats.updatesPublished, 1u);
+    EXPECT_EQ(stats.fieldsReported, 3u);
+    EXPECT_EQ(stats.fieldsCoalesced, 1u);
+}
+
+TEST_F(ShadowClientTest, SuppressesValuesTheShadowHolds)
+{
+    auto shadow = makeShadow();
+    shadow->reportString("fw", "1.0");
+    shadow->report("count", 1);
+    ASSERT_EQ(shadow->flush(), ESP_OK);
+    sentUpdates();
+
+    shadow->reportString("fw", "1.0");
+    shadow->report("count", 2);
+    ASSERT_EQ(shadow->flush(), ESP_OK);
+    auto updates = sentUpdates();
+    ASSERT_EQ(updates.size(), 1u);
+    EXPECT_EQ(updates[0], R"({"state":{"reported":{"count":2}}})");
+    EXPECT_EQ(shadow->getStats().fieldsUnchanged, 1u);
+
+    // Changed and changed back before the window ends: nothing to send
+    shadow->report("count", 3);
+    shadow->report("count", 2);
+    EXPECT_EQ(shadow->getPendingCount(), 0u);
+    EXPECT_EQ(shadow->poll(), UINT32_MAX);
+    EXPECT_TRUE(sentUpdates().empty());
+}
+
+TEST_F(ShadowClientTest, ObjectValuesAreDiffedPerLeaf)
+{
+    auto shadow = makeShadow();
+    shadow->report("wifi", R"({"ssid":"home","rssi":-60})");
+    shadow->flush();
+    sentUpdates();
+
+    shadow->report("wifi", R"({"ssid":"home","rssi":-55})");
+    shadow->flush();
+    auto updates = sentUpdates();
+    ASSERT_EQ(updates.size(), 1u);
+    EXPECT_EQ(updates[0], R"({"state":{"reported":{"wifi":{"rssi":-55}}}})");
+    EXPECT_EQ(shadow->getReportedDocument(), R"({"wifi":{"rssi":-55,"ssid":"home"}})");
+
+    EXPECT_EQ(shadow->report("bad", "{\"a\":"), ESP_ERR_INVALID_ARG);
+    EXPECT_EQ(shadow->report("a..b", 1), ESP_ERR_INVALID_ARG);
+    EXPECT_EQ(shadow->report("", 1), ESP_ERR_INVALID_ARG);
+}
+
+TEST_F(ShadowClientTest, NullDeletesFieldAndItsChildren)
+{
+    auto shadow = makeShadow();
+    shadow->report("wifi", R"({"ssid":"home","rssi":-60})");
+    shadow->report("led", false);
+    shadow->flush();
+    sentUpdates();
+
+    shadow->remove("wifi");
+    shadow->flush();
+    auto updates = sentUpdates();
+    ASSERT_EQ(updates.size(), 1u);
+    EXPECT_EQ(updates[0], R"({"state":{"reported":{"wifi":null}}})");
+    EXPECT_EQ(shadow->getReportedDocument(), R"({"led":false})");
+    EXPECT_FALSE(shadow->getReported("wifi.ssid").has_value());
+
+    // Deleting what is already gone sends nothing
+    shadow->remove("wifi");
+    EXPECT_EQ(shadow->getPendingCount(), 0u);
+}
+
+TEST_F(ShadowClientTest, ScalarReplacesObject)
+{
+    auto shadow = makeShadow();
+    shadow->report("mode.auto", true);
+    shadow->flush();
+    sentUpdates();
+
+    shadow->reportString("mode", "manual");
+    shadow->flush();
+    EXPECT_EQ(shadow->getReportedDocument(), R"({"mode":"manual"})");
+    EXPECT_EQ(*shadow->getReported("mode"), "\"manual\"");
+}
+
+TEST_F(ShadowClientTest, RetriesAfterPublishFailure)
+{
+    auto shadow = makeShadow();
+    shadow->report("led", true);
+    mock->publishResult = ESP_ERR_NO_MEM;
+
+    fakeNowUs = 100000;
+    EXPECT_EQ(shadow->poll(), 1000u);
+    EXPECT_EQ(shadow->getPendingCount(), 1u);
+
+    mock->publishResult = ESP_OK;
+    fakeNowUs = 600000;
+    EXPECT_EQ(shadow->poll(), 500u);
+    EXPECT_TRUE(sentUpdates().empty());
+
+    fakeNowUs = 1100000;
+    EXPECT_EQ(shadow->poll(), UINT32_MAX);
+    EXPECT_EQ(sentUpdates().size(), 1u);
+}
+
+TEST_F(ShadowClientTest, DeltaFieldsReachCallback)
+{
+    auto shadow = makeShadow();
+    std::vector<std::pair<std::string, std::string>> deltas;
+    shadow->setDeltaCallback(
+        [&](std::string_view path, std::string_view value) { deltas.emplace_back(path, value); });
+
+    mock->inject(PREFIX + "update/delta",
+                 bytes(R"({"version":17,"timestamp":1700000000,"state":{"led":true,"cfg":{"rate":5}},)"
+                       R"("metadata":{"led":{"timestamp":1700000000}}})"));
+
+    std::vector<std::pair<std::string, std::string>> expected = {{"led", "true"}, {"cfg.rate", "5"}};
+    EXPECT_EQ(deltas, expected);
+    EXPECT_EQ(shadow->getVersion(), 17u);
+    EXPECT_EQ(shadow->getStats().deltasReceived, 1u);
+}
+
+TEST_F(ShadowClientTest, RejectedUpdateResendsDocument)
+{
+    auto shadow = makeShadow();
+    shadow->report("led", true);
+    shadow->report("count", 4);
+    shadow->flush();
+    sentUpdates();
+
+    mock->inject(PREFIX + "update/rejected", bytes(R"({"code":400,"message":"Bad"})"));
+    EXPECT_EQ(shadow->getStats().rejected, 1u);
+    EXPECT_EQ(shadow->getPendingCount(), 2u);
+    shadow->flush();
+    auto updates = sentUpdates();
+    ASSERT_EQ(updates.size(), 1u);
+    EXPECT_EQ(updates[0], R"({"state":{"reported":{"count":4,"led":true}}})");
+}
+
+TEST_F(ShadowClientTest, CachedDocumentSurvivesRestart)
+{
+    lopcore::storage::NvsConfig nvsConfig;
+    nvsConfig.namespaceName = "shadow_test";
+    NvsStorage nvs(nvsConfig);
+    ASSERT_TRUE(nvs.initialize());
+
+    {
+        auto shadow = makeShadow(&nvs);
+        shadow->report("led", true);
+        shadow->reportString("fw", "1.0");
+        shadow->flush();
+        sentUpdates();
+    }
+    EXPECT_EQ(*nvs.read(config.cacheKey), R"({"fw":"1.0","led":true})");
+
+    auto restarted = makeShadow(&nvs);
+    restarted->report("led", true);
+    restarted->reportString("fw", "1.1");
+    restarted->flush();
+    auto updates = sentUpdates();
+    ASSERT_EQ(updates.size(), 1u);
+    EXPECT_EQ(updates[0], R"({"state":{"reported":{"fw":"1.1"}}})");
+
+    nvs.eraseNamespace();
+}
+
+TEST_F(ShadowClientTest, OversizedUpdateIsDropped)
+{
+    config.maxDocumentSize = 64;
+    auto shadow = makeShadow();
+    shadow->reportString("note", std::string(100, 'x'));
+    EXPECT_EQ(shadow->flush(), ESP_ERR_INVALID_SIZE);
+    EXPECT_EQ(shadow->getPendingCount(), 0u);
+    EXPECT_TRUE(sentUpdates().empty());
+}
+
+TEST(ShadowConfigTest, Validation)
+{
+    ShadowConfig config;
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+    config.thingName = "dev";
+    EXPECT_EQ(config.validate(), ESP_OK);
+    config.cacheKey = "a_key_longer_than_15";
+    EXPECT_EQ(config.validate(), ESP_ERR_INVALID_ARG);
+}
@@ -0,0 +1,82 @@
+/**
+ * @file test_subscribe_batching.cpp
+ * @brief Unit tests for packing topic filters into SUBSCRIBE packets
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/mqtt/mqtt_types.hpp"
+
+using namespace lopcore::mqtt;
+
+namespace
+{
+
+/**
+ * @brief Split filters into packet sizes the way the clients do
+ */
+std::vector<size_t> packets(const std::vector<std::string> &filters,
+                            size_t bufferSize,
+                            size_t maxFilters,
+                            bool subscribe = true)
+{
+    std::vector<size_t> sizes;
+    size_t first = 0;
+    while (first < filters.size())
+    {
+        size_t count = topicFiltersPerPacket(filters.size() - first, bufferSize, maxFilters, subscribe,
+                                             [&](size_t i) { return filters[first + i].size(); });
+        sizes.push_back(count);
+        first += count;
+    }
+    return sizes;
+}
+
+} // namespace
+
+TEST(SubscribeBatchingTest, CapsFiltersPerPacket)
+{
+    std::vector<std::string> filters(120, "devices/gw-01/cmd");
+    std::vector<size_t> sizes = packets(filters, 4096, 8);
+
+    ASSERT_EQ(sizes.size(), 15u);
+    for (size_t size : sizes)
+    {
+        EXPECT_EQ(size, 8u);
+    }
+}
+
+TEST(SubscribeBatchingTest, StaysWithinBufferSize)
+{
+    // 7 header bytes + 3 * (2 + 10 + 1) = 46; a fourth filter would need 59
+    std::vector<std::string> filters(10, std::string(10, 't'));
+    std::vector<size_t> sizes = packets(filters, 50, 64);
+
+    ASSERT_EQ(sizes.size(), 4u);
+    EXPECT_EQ(sizes[0], 3u);
+    EXPECT_EQ(sizes[3], 1u);
+}
+
+TEST(SubscribeBatchingTest, UnsubscribeHasNoOptionsByte)
+{
+    // 7 + 4 * (2 + 10) = 55
+    std::vector<std::string> filters(4, std::string(10, 't'));
+
+    EXPECT_EQ(packets(filters, 55, 64, false), std::vector<size_t>({4}));
+    EXPECT_EQ(packets(filters, 55, 64, true), std::vector<size_t>({3, 1}));
+}
+
+TEST(SubscribeBatchingTest, OversizedFilterIsSentAlone)
+{
+    std::vector<std::string> filters = {"a", std::string(200, 'x'), "b"};
+
+    EXPECT_EQ(packets(filters, 64, 8), std::vector<size_t>({1, 1, 1}));
+}
+
+TEST(SubscribeBatchingTest, NothingToSend)
+{
+    EXPECT_EQ(topicFiltersPerPacket(0, 4096, 8, true, [](size_t) { return size_t{0}; }), 0u);
+}
@@ -0,0 +1,173 @@
+/**
+ * @file test_topic_trie.cpp
+ * @brief Unit tests for the MQTT topic-filter trie
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/mqtt/topic_trie.hpp"
+
+using namespace lopcore::mqtt;
+
+namespace
+{
+
+std::vector<std::string> matches(TopicTrie<std::string> &trie, const std::string &topic)
+{
+    std::vector<std::string> found;
+    trie.match(topic, [&found](std::string &value) { found.push_back(value); });
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+void add(TopicTrie<std::string> &trie, const std::string &filter)
+{
+    ASSERT_EQ(trie.insert(filter, filter), ESP_OK) << filter;
+}
+
+using Names = std::vector<std::string>;
+
+} // namespace
+
+TEST(TopicTrieTest, ValidatesFilters)
+{
+    EXPECT_TRUE(TopicTrie<int>::isValidFilter("a/b/c"));
+    EXPECT_TRUE(TopicTrie<int>::isValidFilter("a/+/c"));
+    EXPECT_TRUE(TopicTrie<int>::isValidFilter("+"));
+    EXPECT_TRUE(TopicTrie<int>::isValidFilter("#"));
+    EXPECT_TRUE(TopicTrie<int>::isValidFilter("a/#"));
+    EXPECT_TRUE(TopicTrie<int>::isValidFilter("/a//b/"));
+
+    EXPECT_FALSE(TopicTrie<int>::isValidFilter(""));
+    EXPECT_FALSE(TopicTrie<int>::isValidFilter("a/#/b"));
+    EXPECT_FALSE(TopicTrie<int>::isValidFilter("a/b#"));
+    EXPECT_FALSE(TopicTrie<int>::isValidFilter("a+/b"));
+
+    TopicTrie<int> trie;
+    EXPECT_EQ(trie.insert("a/#/b", 1), ESP_ERR_INVALID_ARG);
+    EXPECT_TRUE(trie.empty());
+}
+
+TEST(TopicTrieTest, ExactMatch)
+{
+    TopicTrie<std::string> trie;
+    add(trie, "sensors/temp");
+    add(trie, "sensors/humidity");
+
+    EXPECT_EQ(matches(trie, "sensors/temp"), Names{"sensors/temp"});
+    EXPECT_TRUE(matches(trie, "sensors").empty());
+    EXPECT_TRUE(matches(trie, "sensors/temp/raw").empty());
+}
+
+TEST(TopicTrieTest, SingleLevelWildcard)
+{
+    TopicTrie<std::string> trie;
+    add(trie, "devices/+/status");
+
+    EXPECT_EQ(matches(trie, "devices/d1/status"), Names{"devices/+/status"});
+    EXPECT_EQ(matches(trie, "devices//status"), Names{"devices/+/status"});
+    EXPECT_TRUE(matches(trie, "devices/d1/d2/status").empty());
+    EXPECT_TRUE(matches(trie, "devices/status").empty());
+}
+
+TEST(TopicTrieTest, MultiLevelWildcard)
+{
+    TopicTrie<std::string> trie;
+    add(trie, "jobs/#");
+
+    EXPECT_EQ(matches(trie, "jobs"), Names{"jobs/#"});
+    EXPECT_EQ(matches(trie, "jobs/123"), Names{"jobs/#"});
+    EXPECT_EQ(matches(trie, "jobs/123/accepted"), Names{"jobs/#"});
+    EXPECT_TRUE(matches(trie, "jobsx").empty());
+}
+
+TEST(TopicTrieTest, OverlappingFiltersAllMatch)
+{
+    TopicTrie<std::string> trie;
+    add(trie, "#");
+    add(trie, "a/#");
+    add(trie, "a/+");
+    add(trie, "+/b");
+    add(trie, "a/b");
+
+    EXPECT_EQ(matches(trie, "a/b"), (Names{"#", "+/b", "a/#", "a/+", "a/b"}));
+    EXPECT_EQ(matches(trie, "a"), (Names{"#", "a/#"}));
+}
+
+TEST(TopicTrieTest, DollarTopicsSkipLeadingWildcards)
+{
+    TopicTrie<std::string> trie;
+    add(trie, "#");
+    add(trie, "+/shadow");
+    add(trie, "$aws/#");
+
+    EXPECT_EQ(matches(trie, "$aws/shadow"), Names{"$aws/#"});
+    EXPECT_EQ(matches(trie, "dev/shadow"), (Names{"#", "+/shadow"}));
+}
+
+TEST(TopicTrieTest, InsertReplacesAndFind)
+{
+    TopicTrie<int> trie;
+    EXPECT_EQ(trie.insert("a/+", 1), ESP_OK);
+    EXPECT_EQ(trie.insert("a/+", 2), ESP_OK);
+    EXPECT_EQ(trie.size(), 1u);
+
+    ASSERT_NE(trie.find("a/+"), nullptr);
+    EXPECT_EQ(*trie.find("a/+"), 2);
+    EXPECT_EQ(trie.find("a/b"), nullptr); // find() is exact, not a match
+    EXPECT_EQ(trie.find("a"), nullptr);
+}
+
+TEST(TopicTrieTest, EraseKeepsOtherFilters)
+{
+    TopicTrie<std::string> trie;
+    add(trie, "a/b/c");
+    add(trie, "a/b");
+    add(trie, "a/#");
+
+    EXPECT_TRUE(trie.erase("a/b/c"));
+    EXPECT_FALSE(trie.erase("a/b/c"));
+    EXPECT_FALSE(trie.erase("x/y"));
+    EXPECT_EQ(trie.size(), 2u);
+    EXPECT_EQ(matches(trie, "a/b"), (Names{"a/#", "a/b"}));
+
+    EXPECT_TRUE(trie.erase("a/#"));
+    EXPECT_TRUE(trie.erase("a/b"));
+    EXPECT_TRUE(trie.empty());
+    EXPECT_TRUE(matches(trie, "a/b").empty());
+}
+
+TEST(TopicTrieTest, ForEachVisitsEveryFilter)
+{
+    TopicTrie<int> trie;
+    trie.insert("a/b", 1);
+    trie.insert("a/+", 2);
+    trie.insert("#", 3);
+
+    std::vector<std::string> filters;
+    trie.forEach([&filters](const std::string &filter, const int &) { filters.push_back(filter); });
+    std::sort(filters.begin(), filters.end());
+    EXPECT_EQ(filters, (Names{"#", "a/+", "a/b"}));
+
+    trie.clear();
+    EXPECT_TRUE(trie.empty());
+}
+
+TEST(TopicTrieTest, ManySubscriptions)
+{
+    TopicTrie<int> trie;
+    for (int i = 0; i < 500; ++i)
+    {
+        trie.insert("gateway/node" + std::to_string(i) + "/cmd", i);
+    }
+    trie.insert("gateway/+/cmd", -1);
+
+    std::vector<int> found;
+    EXPECT_EQ(trie.match("gateway/node123/cmd", [&found](int &value) { found.push_back(value); }), 2u);
+    std::sort(found.begin(), found.end());
+    EXPECT_EQ(found, (std::vector<int>{-1, 123}));
+}
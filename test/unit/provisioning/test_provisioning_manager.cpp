@@ -0,0 +1,303 @@
+/**
+ * @file test_provisioning_manager.cpp
+ * @brief Unit tests for fleet provisioning by claim
+ */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/commands/command_router.hpp"
+#include "lopcore/provisioning/provisioning_manager.hpp"
+#include "mqtt/mock_mqtt_client.hpp"
+
+using namespace lopcore::provisioning;
+using lopcore::NvsStorage;
+using lopcore::mqtt::MqttMessage;
+using lopcore::test::MockMqttClient;
+
+namespace
+{
+
+const std::string CREATE = "$aws/certificates/create-from-csr/cbor";
+const std::string REGISTER = "$aws/provisioning-templates/factory/provision/cbor";
+
+/**
+ * @brief Minimal CBOR map builder for canned responses
+ */
+class Cbor
+{
+public:
+    Cbor &map(uint8_t pairs)
+    {
+        bytes_.push_back(static_cast<uint8_t>(0xA0 | pairs));
+        return *this;
+    }
+
+    Cbor &text(const std::string &text)
+    {
+        if (text.size() < 24)
+        {
+            bytes_.push_back(static_cast<uint8_t>(0x60 | text.size()));
+        }
+        else
+        {
+            bytes_.push_back(0x79);
+            bytes_.push_back(static_cast<uint8_t>(text.size() >> 8));
+            bytes_.push_back(static_cast<uint8_t>(text.size()));
+        }
+        bytes_.insert(bytes_.end(), text.begin(), text.end());
+        return *this;
+    }
+
+    Cbor &integer(uint16_t value)
+    {
+        bytes_.push_back(0x19);
+        bytes_.push_back(static_cast<uint8_t>(value >> 8));
+        bytes_.push_back(static_cast<uint8_t>(value));
+        return *this;
+    }
+
+    std::vector<uint8_t> bytes() const
+    {
+        return bytes_;
+    }
+
+private:
+    std::vector<uint8_t> bytes_;
+};
+
+const std::string CERTIFICATE_PEM = "-----BEGIN CERTIFICATE-----\nMIIB...\n-----END CERTIFICATE-----\n";
+
+std::vector<uint8_t> certificateAccepted()
+{
+    return Cbor()
+        .map(3)
+        .text("certificateId")
+        .text("c0ffee")
+        .text("certificatePem")
+        .text(CERTIFICATE_PEM)
+        .text("certificateOwnershipToken")
+        .text("token-123")
+        .bytes();
+}
+
+std::vector<uint8_t> registerAccepted()
+{
+    return Cbor()
+        .map(2)
+        .text("deviceConfiguration")
+        .map(1)
+        .text("Fallback")
+        .text("enabled")
+        .text("thingName")
+        .text("sensor-42")
+        .bytes();
+}
+
+/**
+ * @brief Plays the service: answers each request the mock publishes
+ */
+class FakeService
+{
+public:
+    FakeService(std::shared_ptr<MockMqttClient> mock,
+                std::vector<uint8_t> createReply,
+                std::vector<uint8_t> registerReply,
+                const std::string &registerOutcome = "accepted")
+        : mock_(std::move(mock)), thread_([=] {
+              while (!stop_.load())
+              {
+                  for (const MqttMessage &request : mock_->takePublished())
+                  {
+                      requests.push_back(request);
+                      if (request.topic == CREATE)
+                      {
+                          mock_->inject(CREATE + "/accepted", createReply);
+                      }
+                      else if (request.topic == REGISTER)
+                      {
+                          mock_->inject(REGISTER + "/" + registerOutcome, registerReply);
+                      }
+                  }
+                  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+              }
+          })
+    {
+    }
+
+    ~FakeService()
+    {
+        stop_.store(true);
+        thread_.join();
+    }
+
+    std::vector<MqttMessage> requests; ///< Read after the provision() call returns
+
+private:
+    std::shared_ptr<MockMqttClient> mock_;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+ProvisioningCrypto fakeCrypto(int *csrCalls, std::string *installed = nullptr)
+{
+    ProvisioningCrypto crypto;
+    crypto.createCsr = [csrCalls](std::string &csr) {
+        (*csrCalls)++;
+        csr = "-----BEGIN CERTIFICATE REQUEST-----\nMIIB\n-----END CERTIFICATE REQUEST-----\n";
+        return ESP_OK;
+    };
+    if (installed != nullptr)
+    {
+        crypto.storeCertificate = [installed](const std::string &pem) {
+            *installed = pem;
+            return ESP_OK;
+        };
+    }
+    return crypto;
+}
+
+ProvisioningConfig factoryConfig()
+{
+    ProvisioningConfig config;
+    config.templateName = "factory";
+    config.parameters = {{"SerialNumber", "SN-0042"}};
+    config.responseTimeoutMs = 2000;
+    return config;
+}
+
+} // namespace
+
+TEST(ProvisioningManagerTest, RunsBothExchangesAndStoresResultInOneBatch)
+{
+    auto mock = std::make_shared<MockMqttClient>();
+    lopcore::storage::NvsConfig nvsConfig;
+    nvsConfig.namespaceName = "fp_test";
+    NvsStorage nvs(nvsConfig);
+    ASSERT_TRUE(nvs.initialize());
+
+    int csrCalls = 0;
+    std::string installed;
+    ProvisioningManager manager(mock, factoryConfig(), &nvs, fakeCrypto(&csrCalls, &installed));
+    EXPECT_FALSE(manager.isProvisioned());
+    ASSERT_EQ(manager.prepareKeys(), ESP_OK);
+
+    std::vector<MqttMessage> requests;
+    {
+        FakeService service(mock, certificateAccepted(), registerAccepted());
+        ASSERT_EQ(manager.provision(), ESP_OK);
+        requests = service.requests;
+    }
+
+    EXPECT_EQ(csrCalls, 1);
+    EXPECT_EQ(installed, CERTIFICATE_PEM);
+    EXPECT_FALSE(mock->isSubscribed(CREATE + "/+"));
+    EXPECT_FALSE(mock->isSubscribed(REGISTER + "/+"));
+
+    // CBOR requests carrying the CSR, then the ownership token and parameters
+    ASSERT_EQ(requests.size(), 2u);
+    lopcore::commands::CommandArgs create;
+    ASSERT_TRUE(create.parse(requests[0].payload.data(), requests[0].payload.size()));
+    EXPECT_TRUE(create.isCbor());
+    EXPECT_NE(create.getString("certificateSigningRequest")->find("CERTIFICATE REQUEST"), std::string::npos);
+    lopcore::commands::CommandArgs registration;
+    ASSERT_TRUE(registration.parse(requests[1].payload.data(), requests[1].payload.size()));
+    EXPECT_EQ(registration.getString("certificateOwnershipToken"), std::string_view("token-123"));
+    lopcore::commands::CommandArgs parameters;
+    const auto *raw = registration.find("parameters");
+    ASSERT_NE(raw, nullptr);
+    ASSERT_TRUE(parameters.parse(reinterpret_cast<const uint8_t *>(raw->text.data()), raw->text.size()));
+    EXPECT_EQ(parameters.getString("SerialNumber"), std::string_view("SN-0042"));
+
+    ProvisioningResult result = manager.result();
+    EXPECT_EQ(result.thingName, "sensor-42");
+    EXPECT_EQ(result.certificateId, "c0ffee");
+    ASSERT_EQ(result.deviceConfiguration.size(), 1u);
+    EXPECT_EQ(result.deviceConfiguration[0].first, "Fallback");
+    EXPECT_EQ(result.deviceConfiguration[0].second, "enabled");
+
+    EXPECT_TRUE(manager.isProvisioned());
+    EXPECT_EQ(*nvs.read("fp_thing"), "sensor-42");
+    EXPECT_EQ(*nvs.read("fp_cert"), CERTIFICATE_PEM);
+    EXPECT_EQ(*nvs.read("fp_cert_id"), "c0ffee");
+    EXPECT_TRUE(nvs.exists("fp_config"));
+    nvs.eraseNamespace();
+}
+
+TEST(ProvisioningManagerTest, ProvisionMakesKeysIfNobodyDid)
+{
+    auto mock = std::make_shared<MockMqttClient>();
+    int csrCalls = 0;
+    ProvisioningManager manager(mock, factoryConfig(), nullptr, fakeCrypto(&csrCalls));
+
+    FakeService service(mock, certificateAccepted(), registerAccepted());
+    ASSERT_EQ(manager.provision(), ESP_OK);
+    EXPECT_EQ(csrCalls, 1);
+    EXPECT_EQ(manager.prepareKeys(), ESP_OK);
+    EXPECT_EQ(csrCalls, 1);
+}
+
+TEST(ProvisioningManagerTest, RejectionIsReported)
+{
+    auto mock = std::make_shared<MockMqttClient>();
+    int csrCalls = 0;
+    ProvisioningManager manager(mock, factoryConfig(), nullptr, fakeCrypto(&csrCalls));
+
+    auto rejection = Cbor()
+                         .map(3)
+                         .text("statusCode")
+                         .integer(400)
+                         .text("errorCode")
+                         .text("InvalidParameters")
+                         .text("errorMessage")
+                         .text("SerialNumber is taken")
+                         .bytes();
+    FakeService service(mock, certificateAccepted(), rejection, "rejected");
+    EXPECT_EQ(manager.provision(), ESP_FAIL);
+
+    ProvisioningError error = manager.lastError();
+    EXPECT_EQ(error.statusCode, 400u);
+    EXPECT_EQ(error.errorCode, "InvalidParameters");
+    EXPECT_EQ(error.errorMessage, "SerialNumber is taken");
+    EXPECT_TRUE(manager.result().thingName.empty());
+}
+
+TEST(ProvisioningManagerTest, MissingResponseTimesOut)
+{
+    auto mock = std::make_shared<MockMqttClient>();
+    int csrCalls = 0;
+    ProvisioningConfig config = factoryConfig();
+    config.responseTimeoutMs = 50;
+    ProvisioningManager manager(mock, config, nullptr, fakeCrypto(&csrCalls));
+
+    EXPECT_EQ(manager.provision(), ESP_ERR_TIMEOUT);
+    EXPECT_FALSE(mock->isSubscribed(CREATE + "/+"));
+}
+
+TEST(ProvisioningManagerTest, MalformedResponseAndConfig)
+{
+    auto mock = std::make_shared<MockMqttClient>();
+    int csrCalls = 0;
+    ProvisioningManager manager(mock, factoryConfig(), nullptr, fakeCrypto(&csrCalls));
+    {
+        FakeService service(mock, Cbor().map(1).text("certificateId").text("x").bytes(), registerAccepted());
+        EXPECT_EQ(manager.provision(), ESP_ERR_INVALID_RESPONSE);
+    }
+
+    ProvisioningConfig bad = factoryConfig();
+    bad.templateName = "a/b";
+    ProvisioningManager invalid(mock, bad, nullptr, fakeCrypto(&csrCalls));
+    EXPECT_EQ(invalid.provision(), ESP_ERR_INVALID_ARG);
+    bad = factoryConfig();
+    bad.certificateKey = "a_key_longer_than_15";
+    EXPECT_EQ(bad.validate(), ESP_ERR_INVALID_ARG);
+
+    ProvisioningManager noCrypto(mock, factoryConfig(), nullptr, ProvisioningCrypto());
+    EXPECT_EQ(noCrypto.prepareKeys(), ESP_ERR_INVALID_ARG);
+}
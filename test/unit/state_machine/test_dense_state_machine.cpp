@@ -0,0 +1,303 @@
+/**
+ * @file test_dense_state_machine.cpp
+ * @brief Unit tests for DenseStateMachine and TransitionTable
+ */
+
+#include <array>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/state_machine/dense_state_machine.hpp"
+
+using namespace lopcore;
+
+// Counts heap allocations, to check the tick path makes none
+static size_t g_allocations = 0;
+
+void *operator new(size_t size)
+{
+    g_allocations++;
+    if (void *memory = std::malloc(size))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+enum class Motor
+{
+    IDLE,
+    RAMP,
+    RUN,
+    FAULT
+};
+
+constexpr auto motorRules = TransitionTable<Motor, 4>()
+                                .allow(Motor::IDLE, Motor::RAMP)
+                                .allow(Motor::RAMP, Motor::RUN)
+                                .allow(Motor::RUN, Motor::IDLE)
+                                .allowFromAll(Motor::FAULT)
+                                .allow(Motor::FAULT, Motor::IDLE);
+
+static_assert(motorRules.allows(Motor::IDLE, Motor::RAMP), "Rules are checked at compile time");
+static_assert(!motorRules.allows(Motor::IDLE, Motor::RUN), "Unlisted transitions are refused");
+static_assert(motorRules.allows(Motor::RAMP, Motor::FAULT), "allowFromAll covers every source");
+static_assert(TransitionTable<Motor, 4>().allows(Motor::RUN, Motor::IDLE), "An empty table allows all");
+static_assert(!TransitionTable<Motor, 4>().allows(Motor::RUN, static_cast<Motor>(7)), "Out of range refused");
+
+class RecordingState : public IState<Motor>
+{
+public:
+    RecordingState(Motor id, std::vector<std::string> &log) : id_(id), log_(log)
+    {
+    }
+
+    void onEnter() override
+    {
+        log_.push_back("enter " + std::to_string(static_cast<int>(id_)));
+    }
+
+    void update() override
+    {
+        updates++;
+    }
+
+    void onExit() override
+    {
+        log_.push_back("exit " + std::to_string(static_cast<int>(id_)));
+    }
+
+    Motor getStateId() const override
+    {
+        return id_;
+    }
+
+    int updates = 0;
+
+private:
+    Motor id_;
+    std::vector<std::string> &log_;
+};
+
+class DenseStateMachineTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        log.reserve(64);
+    }
+
+    std::vector<std::string> log;
+    RecordingState idle{Motor::IDLE, log};
+    RecordingState ramp{Motor::RAMP, log};
+    RecordingState run{Motor::RUN, log};
+};
+
+TEST_F(DenseStateMachineTest, Transition_CallsHooksInOrder)
+{
+    DenseStateMachine<Motor, 4> machine(Motor::IDLE, motorRules);
+    machine.registerState(Motor::IDLE, idle);
+    machine.registerState(Motor::RAMP, ramp);
+
+    std::vector<std::pair<Motor, Motor>> seen;
+    ASSERT_NE(machine.addObserver([&](Motor from, Motor to) { seen.emplace_back(from, to); }), 0u);
+
+    ASSERT_TRUE(machine.transition(Motor::RAMP));
+    EXPECT_EQ(log, (std::vector<std::string>{"exit 0", "enter 1"}));
+    EXPECT_EQ(machine.getCurrentState(), Motor::RAMP);
+    EXPECT_EQ(machine.getPreviousState(), Motor::IDLE);
+    ASSERT_EQ(seen.size(), 1u);
+    EXPECT_EQ(seen[0], std::make_pair(Motor::IDLE, Motor::RAMP));
+
+    ASSERT_TRUE(machine.transition(Motor::RAMP)); // Already there: nothing happens
+    EXPECT_EQ(seen.size(), 1u);
+
+    machine.update();
+    machine.update();
+    EXPECT_EQ(ramp.updates, 2);
+    EXPECT_EQ(idle.updates, 0);
+}
+
+TEST_F(DenseStateMachineTest, Rules_RefuseUnlistedTransitions)
+{
+    DenseStateMachine<Motor, 4> machine(Motor::IDLE, motorRules);
+
+    EXPECT_FALSE(machine.transition(Motor::RUN));
+    EXPECT_EQ(machine.getCurrentState(), Motor::IDLE);
+    EXPECT_TRUE(machine.transition(Motor::FAULT));
+    EXPECT_FALSE(machine.transition(static_cast<Motor>(9)));
+
+    machine.clearTransitionRules();
+    EXPECT_TRUE(machine.isTransitionAllowed(Motor::IDLE, Motor::RUN));
+    machine.addTransitionRule(Motor::FAULT, Motor::RUN);
+    EXPECT_TRUE(machine.transition(Motor::RUN));
+    EXPECT_FALSE(machine.isTransitionAllowed(Motor::RUN, Motor::RAMP));
+}
+
+TEST_F(DenseStateMachineTest, History_KeepsTheLastStates)
+{
+    DenseStateMachine<Motor, 4, 1, 3> machine(Motor::IDLE);
+    machine.transition(Motor::RAMP);
+    EXPECT_EQ(machine.getHistory(), (std::vector<Motor>{Motor::IDLE, Motor::RAMP}));
+
+    machine.transition(Motor::RUN);
+    machine.transition(Motor::IDLE);
+    EXPECT_EQ(machine.getHistory(), (std::vector<Motor>{Motor::RAMP, Motor::RUN, Motor::IDLE}));
+
+    machine.clearHistory();
+    EXPECT_EQ(machine.getHistory(), (std::vector<Motor>{Motor::IDLE}));
+
+    ObserverToken token = machine.addObserver([](Motor, Motor) {});
+    EXPECT_NE(token, 0u);
+    EXPECT_EQ(machine.addObserver([](Motor, Motor) {}), 0u); // One slot
+    EXPECT_TRUE(machine.removeObserver(token));
+    EXPECT_NE(machine.addObserver([](Motor, Motor) {}), 0u);
+}
+
+TEST_F(DenseStateMachineTest, Tick_DoesNotAllocate)
+{
+    DenseStateMachine<Motor, 4> machine(Motor::IDLE, motorRules);
+    machine.registerState(Motor::IDLE, idle);
+    machine.registerState(Motor::RAMP, ramp);
+    machine.registerState(Motor::RUN, run);
+    log.clear();
+    log.reserve(4096); // The states' own log is not the machine's doing
+
+    size_t before = g_allocations;
+    int changes = 0;
+    machine.addObserver([&changes](Motor, Motor) { changes++; }); // Stored inline
+    for (int tick = 0; tick < 1000; tick++)
+    {
+        machine.update();
+        if (tick % 100 == 99)
+        {
+            machine.transition(Motor::RAMP);
+            machine.transition(Motor::RUN);
+            machine.transition(Motor::IDLE);
+        }
+    }
+    EXPECT_EQ(g_allocations - before, 0u); // "enter N" fits the small string buffer too
+    EXPECT_EQ(changes, 30);
+    EXPECT_EQ(idle.updates + ramp.updates + run.updates, 1000);
+}
+
+enum class Link
+{
+    OFFLINE,
+    CONNECTED,
+    ONLINE,
+    DEGRADED,
+    SYNCING
+};
+
+class LinkState : public IState<Link>
+{
+public:
+    LinkState(Link id, std::vector<std::string> &log) : id_(id), log_(log)
+    {
+    }
+
+    void onEnter() override
+    {
+        log_.push_back("enter " + std::to_string(static_cast<int>(id_)));
+    }
+
+    void update() override
+    {
+        log_.push_back("update " + std::to_string(static_cast<int>(id_)));
+    }
+
+    void onExit() override
+    {
+        log_.push_back("exit " + std::to_string(static_cast<int>(id_)));
+    }
+
+    Link getStateId() const override
+    {
+        return id_;
+    }
+
+private:
+    Link id_;
+    std::vector<std::string> &log_;
+};
+
+class HierarchyTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        // OFFLINE, CONNECTED { ONLINE { SYNCING }, DEGRADED }
+        ASSERT_TRUE(machine.setParent(Link::ONLINE, Link::CONNECTED));
+        ASSERT_TRUE(machine.setParent(Link::DEGRADED, Link::CONNECTED));
+        ASSERT_TRUE(machine.setParent(Link::SYNCING, Link::ONLINE));
+        for (LinkState &state : states)
+        {
+            machine.registerState(state.getStateId(), state);
+        }
+    }
+
+    std::vector<std::string> log;
+    std::array<LinkState, 5> states{LinkState{Link::OFFLINE, log}, LinkState{Link::CONNECTED, log},
+                                    LinkState{Link::ONLINE, log}, LinkState{Link::DEGRADED, log},
+                                    LinkState{Link::SYNCING, log}};
+    DenseStateMachine<Link, 5, 4, 8, 3> machine{Link::OFFLINE};
+};
+
+TEST_F(HierarchyTest, Transition_RunsOnlyTheChainsBelowTheCommonAncestor)
+{
+    machine.transition(Link::SYNCING); // Enters every level from the top
+    EXPECT_EQ(log, (std::vector<std::string>{"exit 0", "enter 1", "enter 2", "enter 4"}));
+    EXPECT_TRUE(machine.isInState(Link::CONNECTED));
+    EXPECT_TRUE(machine.isInState(Link::ONLINE));
+    EXPECT_FALSE(machine.isInState(Link::DEGRADED));
+
+    log.clear();
+    machine.transition(Link::DEGRADED); // CONNECTED is common: not exited
+    EXPECT_EQ(log, (std::vector<std::string>{"exit 4", "exit 2", "enter 3"}));
+
+    log.clear();
+    machine.transition(Link::CONNECTED); // To an ancestor: only the substate exits
+    EXPECT_EQ(log, (std::vector<std::string>{"exit 3"}));
+
+    log.clear();
+    machine.transition(Link::ONLINE); // To a substate: only it enters
+    machine.transition(Link::OFFLINE);
+    EXPECT_EQ(log, (std::vector<std::string>{"enter 2", "exit 2", "exit 1", "enter 0"}));
+    EXPECT_FALSE(machine.isInState(Link::CONNECTED));
+}
+
+TEST_F(HierarchyTest, Update_RunsAncestorsFirst)
+{
+    machine.transition(Link::SYNCING);
+    log.clear();
+    machine.update();
+    EXPECT_EQ(log, (std::vector<std::string>{"update 1", "update 2", "update 4"}));
+}
+
+TEST_F(HierarchyTest, SetParent_RefusesCyclesAndDeepNesting)
+{
+    EXPECT_FALSE(machine.setParent(Link::CONNECTED, Link::SYNCING)); // Cycle
+    EXPECT_FALSE(machine.setParent(Link::OFFLINE, Link::SYNCING));   // Fourth level, MaxDepth is 3
+    EXPECT_FALSE(machine.setParent(Link::OFFLINE, Link::OFFLINE));
+    EXPECT_FALSE(machine.getParent(Link::OFFLINE).has_value());
+    EXPECT_EQ(machine.getParent(Link::SYNCING), Link::ONLINE);
+
+    // The refused changes left the tables as they were
+    machine.transition(Link::SYNCING);
+    EXPECT_EQ(log, (std::vector<std::string>{"exit 0", "enter 1", "enter 2", "enter 4"}));
+}
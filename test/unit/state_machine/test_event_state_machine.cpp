@@ -0,0 +1,222 @@
+/**
+ * @file test_event_state_machine.cpp
+ * @brief Unit tests for EventStateMachine
+ */
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/state_machine/event_state_machine.hpp"
+
+using namespace lopcore;
+
+enum class Door
+{
+    CLOSED,
+    OPEN,
+    LOCKED
+};
+
+enum class DoorEvent
+{
+    OPEN,
+    CLOSE,
+    LOCK,
+    UNLOCK
+};
+
+using DoorMachine = EventStateMachine<Door, 3, DoorEvent, 4>;
+
+class LoggingState : public IState<Door>
+{
+public:
+    LoggingState(Door id, std::vector<std::string> &log) : id_(id), log_(log)
+    {
+    }
+
+    void onEnter() override
+    {
+        log_.push_back("enter " + std::to_string(static_cast<int>(id_)));
+    }
+
+    void update() override
+    {
+    }
+
+    void onExit() override
+    {
+        log_.push_back("exit " + std::to_string(static_cast<int>(id_)));
+    }
+
+    Door getStateId() const override
+    {
+        return id_;
+    }
+
+private:
+    Door id_;
+    std::vector<std::string> &log_;
+};
+
+TEST(EventStateMachineTest, Dispatch_RunsGuardedRowsInOrder)
+{
+    std::vector<std::string> log;
+    LoggingState closed{Door::CLOSED, log};
+    LoggingState locked{Door::LOCKED, log};
+
+    DoorMachine door(Door::CLOSED, 8);
+    door.machine().registerState(Door::CLOSED, closed);
+    door.machine().registerState(Door::LOCKED, locked);
+    door.machine().addObserver([&log](Door, Door) { log.push_back("observer"); });
+
+    // Two rows for (CLOSED, LOCK): the wrong code is refused, the right one locks
+    ASSERT_TRUE(door.on(Door::CLOSED, DoorEvent::LOCK, Door::LOCKED,
+                        [](const DoorMachine::Event &e) { return e.data == 1234; },
+                        [&log](const DoorMachine::Event &) { log.push_back("action"); }));
+    ASSERT_TRUE(door.on(Door::CLOSED, DoorEvent::LOCK, Door::CLOSED, nullptr,
+                        [&log](const DoorMachine::Event &) { log.push_back("wrong code"); }));
+
+    EXPECT_TRUE(door.post(DoorEvent::LOCK, 1111));
+    EXPECT_TRUE(door.post(DoorEvent::LOCK, 1234));
+    EXPECT_EQ(door.pending(), 2u);
+    EXPECT_EQ(door.dispatch(), 2u);
+
+    // The internal row runs no hooks; the external one runs exit, action, enter, observers
+    EXPECT_EQ(log, (std::vector<std::string>{"wrong code", "exit 0", "action", "enter 2", "observer"}));
+    EXPECT_EQ(door.getCurrentState(), Door::LOCKED);
+
+    EventStateMachineStats stats = door.getStats();
+    EXPECT_EQ(stats.posted, 2u);
+    EXPECT_EQ(stats.dispatched, 2u);
+    EXPECT_EQ(stats.transitions, 2u);
+    EXPECT_EQ(stats.unhandled, 0u);
+}
+
+TEST(EventStateMachineTest, Dispatch_CountsUnhandledEvents)
+{
+    DoorMachine door(Door::CLOSED, 8);
+    door.on(Door::CLOSED, DoorEvent::OPEN, Door::OPEN, [](const DoorMachine::Event &) { return false; });
+
+    door.post(DoorEvent::OPEN);  // Guard refuses
+    door.post(DoorEvent::CLOSE); // No row at all
+    door.post(static_cast<DoorEvent>(9));
+    EXPECT_EQ(door.dispatch(), 3u);
+    EXPECT_EQ(door.getCurrentState(), Door::CLOSED);
+    EXPECT_EQ(door.getStats().unhandled, 3u);
+
+    EXPECT_FALSE(door.on(Door::CLOSED, static_cast<DoorEvent>(4), Door::OPEN));
+    EXPECT_FALSE(door.on(Door::CLOSED, DoorEvent::OPEN, static_cast<Door>(3)));
+}
+
+TEST(EventStateMachineTest, Action_PostsRunAfterTheCurrentEvent)
+{
+    std::vector<Door> seen;
+    DoorMachine door(Door::CLOSED, 8);
+    door.machine().addObserver([&seen](Door, Door to) { seen.push_back(to); });
+    door.on(Door::CLOSED, DoorEvent::OPEN, Door::OPEN, nullptr, [&](const DoorMachine::Event &) {
+        door.post(DoorEvent::CLOSE); // Queued, not run inside this transition
+        EXPECT_TRUE(seen.empty());
+    });
+    door.on(Door::OPEN, DoorEvent::CLOSE, Door::CLOSED);
+
+    door.post(DoorEvent::OPEN);
+    EXPECT_EQ(door.dispatch(1), 1u);
+    EXPECT_EQ(door.getCurrentState(), Door::OPEN);
+    EXPECT_EQ(door.dispatch(), 1u);
+    EXPECT_EQ(seen, (std::vector<Door>{Door::OPEN, Door::CLOSED}));
+}
+
+TEST(EventStateMachineTest, Post_DropsWhenQueueIsFull)
+{
+    DoorMachine door(Door::CLOSED, 4);
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_TRUE(door.post(DoorEvent::OPEN));
+    }
+    bool woken = true;
+    EXPECT_FALSE(door.postFromIsr(DoorEvent::OPEN, 0, &woken));
+    EXPECT_FALSE(woken);
+
+    EventStateMachineStats stats = door.getStats();
+    EXPECT_EQ(stats.posted, 4u);
+    EXPECT_EQ(stats.dropped, 1u);
+    EXPECT_EQ(door.dispatch(), 4u);
+    EXPECT_TRUE(door.post(DoorEvent::OPEN));
+}
+
+TEST(EventStateMachineTest, Owner_DispatchesEventsFromManyProducers)
+{
+    constexpr int PRODUCERS = 4;
+    constexpr int EVENTS_EACH = 2000;
+
+    std::atomic<uint32_t> sum{0};
+    DoorMachine door(Door::CLOSED, 64);
+    door.on(Door::CLOSED, DoorEvent::OPEN, Door::OPEN);
+    door.on(Door::OPEN, DoorEvent::OPEN, Door::OPEN, nullptr, [&sum](const DoorMachine::Event &e) { sum += e.data; });
+
+    std::atomic<bool> producing{true};
+    std::thread owner([&] {
+        while (producing.load() || door.pending() > 0)
+        {
+            door.waitForEvent(5);
+            door.dispatch();
+        }
+    });
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++)
+    {
+        producers.emplace_back([&door] {
+            for (int i = 0; i < EVENTS_EACH; i++)
+            {
+                while (!door.post(DoorEvent::OPEN, 1))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread &producer : producers)
+    {
+        producer.join();
+    }
+    producing.store(false);
+    owner.join();
+
+    EventStateMachineStats stats = door.getStats();
+    EXPECT_EQ(stats.posted, static_cast<uint32_t>(PRODUCERS * EVENTS_EACH));
+    EXPECT_EQ(stats.dispatched, stats.posted);
+    EXPECT_EQ(stats.transitions, stats.posted);
+    EXPECT_EQ(sum.load(), stats.posted - 1); // The first event opened the door
+    EXPECT_EQ(door.getCurrentState(), Door::OPEN);
+}
+
+TEST(EventStateMachineTest, Dispatch_BubblesToParentStates)
+{
+    // LOCKED nested in CLOSED, inheriting its rows
+    std::vector<std::string> log;
+    DoorMachine door(Door::CLOSED, 8);
+    ASSERT_TRUE(door.machine().setParent(Door::LOCKED, Door::CLOSED));
+    door.on(Door::CLOSED, DoorEvent::LOCK, Door::LOCKED);
+    door.on(Door::LOCKED, DoorEvent::UNLOCK, Door::CLOSED, [](const DoorMachine::Event &e) { return e.data == 1; });
+    door.on(Door::CLOSED, DoorEvent::UNLOCK, Door::CLOSED, nullptr,
+            [&log](const DoorMachine::Event &) { log.push_back("refused"); });
+    door.on(Door::CLOSED, DoorEvent::OPEN, Door::OPEN);
+
+    door.post(DoorEvent::LOCK);
+    door.post(DoorEvent::UNLOCK, 2); // LOCKED's guard refuses: the parent's internal row runs
+    door.post(DoorEvent::OPEN);      // LOCKED has no row: the parent's row leaves it
+    door.dispatch(2);
+    EXPECT_EQ(door.getCurrentState(), Door::LOCKED);
+    EXPECT_EQ(log, (std::vector<std::string>{"refused"}));
+
+    door.dispatch();
+    EXPECT_EQ(door.getCurrentState(), Door::OPEN);
+    door.post(DoorEvent::LOCK); // OPEN is top-level: nothing to bubble to
+    door.dispatch();
+    EXPECT_EQ(door.getStats().unhandled, 1u);
+}
@@ -3,9 +3,15 @@
  * @brief Unit tests for the StateMachine template
  */
 
+#include <chrono>
+#include <thread>
+#include <utility>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "lopcore/state_machine/state_machine.hpp"
+#include "lopcore/state_machine/tick_scheduler.hpp"
 
 using namespace lopcore;
 
@@ -215,6 +221,62 @@ TEST_F(StateMachineTest, MultipleObserversWork)
     EXPECT_EQ(observer2Count, 1);
 }
 
+TEST_F(StateMachineTest, ObserversCanBeRemovedByToken)
+{
+    StateMachine<TestState, 2> sm(TestState::STATE_A);
+    int first = 0;
+    int second = 0;
+
+    ObserverToken firstToken = sm.addObserver([&first](TestState, TestState) { first++; });
+    ObserverToken secondToken = 0;
+    secondToken = sm.addObserver([&](TestState, TestState) {
+        second++;
+        sm.removeObserver(secondToken); // One-shot: removes itself while being called
+    });
+    ASSERT_NE(firstToken, 0u);
+    ASSERT_NE(secondToken, 0u);
+    EXPECT_EQ(sm.addObserver([](TestState, TestState) {}), 0u); // Both slots taken
+
+    sm.transition(TestState::STATE_B);
+    sm.transition(TestState::STATE_C);
+    EXPECT_EQ(first, 2);
+    EXPECT_EQ(second, 1);
+
+    EXPECT_TRUE(sm.removeObserver(firstToken));
+    EXPECT_FALSE(sm.removeObserver(firstToken));
+    ObserverToken reused = sm.addObserver([](TestState, TestState) {});
+    EXPECT_NE(reused, firstToken); // Same slot, new token
+    EXPECT_FALSE(sm.removeObserver(firstToken));
+
+    sm.transition(TestState::STATE_A);
+    EXPECT_EQ(first, 2);
+}
+
+TEST_F(StateMachineTest, DeferredObserversRunWhenDelivered)
+{
+    StateMachine<TestState> sm(TestState::STATE_A);
+    sm.setNotificationQueueSize(2);
+    std::vector<std::pair<TestState, TestState>> immediate;
+    std::vector<std::pair<TestState, TestState>> deferred;
+    sm.addObserver([&immediate](TestState from, TestState to) { immediate.emplace_back(from, to); });
+    ASSERT_NE(sm.addDeferredObserver([&deferred](TestState from, TestState to) { deferred.emplace_back(from, to); }),
+              0u);
+
+    sm.transition(TestState::STATE_B);
+    sm.transition(TestState::STATE_C);
+    EXPECT_EQ(immediate.size(), 2u);
+    EXPECT_TRUE(deferred.empty()); // Not on the transition path
+
+    sm.transition(TestState::STATE_A); // Queue holds two changes
+    EXPECT_EQ(sm.getDroppedNotifications(), 1u);
+
+    EXPECT_EQ(sm.deliverNotifications(), 2u);
+    ASSERT_EQ(deferred.size(), 2u);
+    EXPECT_EQ(deferred[0], std::make_pair(TestState::STATE_A, TestState::STATE_B));
+    EXPECT_EQ(deferred[1], std::make_pair(TestState::STATE_B, TestState::STATE_C));
+    EXPECT_EQ(sm.deliverNotifications(), 0u);
+}
+
 TEST_F(StateMachineTest, HistoryIsTracked)
 {
     StateMachine<TestState> sm(TestState::STATE_A);
@@ -268,6 +330,42 @@ TEST_F(StateMachineTest, ClearHistoryWorks)
     EXPECT_EQ(history[0], TestState::STATE_B); // Current state
 }
 
+TEST_F(StateMachineTest, HistoryRingKeepsNewestInOrder)
+{
+    StateMachine<TestState> sm(TestState::STATE_A);
+    sm.setMaxHistorySize(256);
+
+    const TestState cycle[] = {TestState::STATE_B, TestState::STATE_C, TestState::STATE_A};
+    for (int i = 0; i < 300; i++)
+    {
+        sm.transition(cycle[i % 3]);
+    }
+
+    // 301 states were entered; the ring holds the last 256, oldest first, in place
+    const auto &history = sm.history();
+    ASSERT_EQ(history.size(), 256u);
+    EXPECT_EQ(history.capacity(), 256u);
+    EXPECT_EQ(history[0].state, cycle[(300 - 256) % 3]);
+    EXPECT_EQ(history.newest().state, TestState::STATE_A);
+
+    size_t index = 0;
+    int64_t previousUs = 0;
+    for (const auto &entry : history)
+    {
+        EXPECT_EQ(entry.state, cycle[(300 - 256 + index) % 3]);
+        EXPECT_GE(entry.enteredUs, previousUs);
+        EXPECT_GE(history.timeInStateUs(index, sm.history().newest().enteredUs), 0);
+        previousUs = entry.enteredUs;
+        index++;
+    }
+    EXPECT_EQ(index, 256u);
+    EXPECT_GE(sm.getTimeInStateUs(), 0);
+
+    // Shrinking keeps the newest entries
+    sm.setMaxHistorySize(2);
+    EXPECT_EQ(sm.getHistory(), (std::vector<TestState>{TestState::STATE_C, TestState::STATE_A}));
+}
+
 TEST_F(StateMachineTest, ClearTransitionRulesWorks)
 {
     StateMachine<TestState> sm(TestState::STATE_A);
@@ -350,3 +448,208 @@ TEST_F(StateMachineTest, ComplexTransitionFlow)
     EXPECT_EQ(stateCPtr->exitCount_, 1);
     EXPECT_EQ(stateCPtr->updateCount_, 1);
 }
+
+// State that asks to be updated every periodMs
+class PeriodicState : public MockState
+{
+public:
+    PeriodicState(TestState id, uint32_t periodMs) : MockState(id), periodMs_(periodMs)
+    {
+    }
+
+    uint32_t nextUpdateDelayMs() override
+    {
+        return periodMs_;
+    }
+
+private:
+    uint32_t periodMs_;
+};
+
+TEST_F(StateMachineTest, TickUpdatesOnlyWhenDue)
+{
+    StateMachine<TestState> sm(TestState::STATE_A);
+    auto periodic = std::make_unique<PeriodicState>(TestState::STATE_A, 50);
+    auto waiting = std::make_unique<PeriodicState>(TestState::STATE_B, IState<TestState>::NO_UPDATE);
+    PeriodicState *a = periodic.get();
+    PeriodicState *b = waiting.get();
+    sm.registerState(TestState::STATE_A, std::move(periodic));
+    sm.registerState(TestState::STATE_B, std::move(waiting));
+
+    uint32_t delay = sm.tick(); // First tick updates at once
+    EXPECT_EQ(a->updateCount_, 1);
+    EXPECT_GT(delay, 40u);
+    EXPECT_LE(delay, 50u);
+
+    sm.tick(); // Not due yet
+    EXPECT_EQ(a->updateCount_, 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+    sm.tick();
+    EXPECT_EQ(a->updateCount_, 2);
+
+    sm.transition(TestState::STATE_B);
+    EXPECT_EQ(sm.tick(), IState<TestState>::NO_UPDATE); // Entered: updated once, then waits
+    EXPECT_EQ(sm.tick(), IState<TestState>::NO_UPDATE);
+    EXPECT_EQ(b->updateCount_, 1);
+
+    sm.registerState(TestState::STATE_C, std::make_unique<MockState>(TestState::STATE_C));
+    sm.transition(TestState::STATE_C);
+    EXPECT_EQ(sm.tick(), 0u); // Default: every tick
+}
+
+TEST_F(StateMachineTest, TickSchedulerSleepsUntilDeadlineOrWake)
+{
+    StateMachine<TestState> sm(TestState::STATE_A);
+    sm.registerState(TestState::STATE_A, std::make_unique<PeriodicState>(TestState::STATE_A, 30));
+    sm.registerState(TestState::STATE_B,
+                     std::make_unique<PeriodicState>(TestState::STATE_B, IState<TestState>::NO_UPDATE));
+    TickScheduler scheduler(5000);
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(scheduler.runOnce(sm)); // Sleeps out the 30 ms period
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(25));
+
+    sm.transition(TestState::STATE_B);
+    std::thread waker([&scheduler] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        scheduler.wake();
+    });
+    start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(scheduler.runOnce(sm)); // B updates, then waits for events: only wake() ends it
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(2000));
+    waker.join();
+
+    scheduler.wake(); // Kept until the next sleep
+    EXPECT_TRUE(scheduler.sleep(1000));
+}
+
+// State recording the timers it receives
+class TimerState : public MockState
+{
+public:
+    using MockState::MockState;
+
+    void onTimer(uint32_t timerId) override
+    {
+        fired.push_back(timerId);
+    }
+
+    uint32_t nextUpdateDelayMs() override
+    {
+        return IState<TestState>::NO_UPDATE;
+    }
+
+    std::vector<uint32_t> fired;
+};
+
+TEST_F(StateMachineTest, StateTimeoutLeavesTheState)
+{
+    StateMachine<TestState> sm(TestState::STATE_A);
+    sm.registerState(TestState::STATE_A, std::make_unique<TimerState>(TestState::STATE_A));
+    sm.registerState(TestState::STATE_B, std::make_unique<TimerState>(TestState::STATE_B));
+    sm.setTimeout(TestState::STATE_A, std::chrono::milliseconds(30), TestState::STATE_B);
+    ASSERT_TRUE(sm.isTimerActive(StateMachine<TestState>::STATE_TIMEOUT_TIMER));
+
+    sm.tick();                  // First update of A
+    uint32_t delay = sm.tick(); // Nothing to do but wait for the timeout
+    EXPECT_GT(delay, 0u);
+    EXPECT_LE(delay, 30u);
+    EXPECT_EQ(sm.getCurrentState(), TestState::STATE_A);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay + 1));
+    sm.tick();
+    EXPECT_EQ(sm.getCurrentState(), TestState::STATE_B);
+    EXPECT_FALSE(sm.isTimerActive(StateMachine<TestState>::STATE_TIMEOUT_TIMER)); // B has none
+
+    // Leaving early drops the timeout; re-entering re-arms it
+    sm.transition(TestState::STATE_A);
+    sm.transition(TestState::STATE_C);
+    EXPECT_FALSE(sm.isTimerActive(StateMachine<TestState>::STATE_TIMEOUT_TIMER));
+    sm.transition(TestState::STATE_A);
+    EXPECT_TRUE(sm.isTimerActive(StateMachine<TestState>::STATE_TIMEOUT_TIMER));
+}
+
+TEST_F(StateMachineTest, TimersFireInDeadlineOrderAndDieWithTheirState)
+{
+    StateMachine<TestState> sm(TestState::STATE_A);
+    auto owned = std::make_unique<TimerState>(TestState::STATE_A);
+    TimerState *a = owned.get();
+    sm.registerState(TestState::STATE_A, std::move(owned));
+
+    EXPECT_TRUE(sm.startTimer(2, std::chrono::milliseconds(20)));
+    EXPECT_TRUE(sm.startTimer(1, std::chrono::milliseconds(10)));
+    EXPECT_TRUE(sm.startTimer(3, std::chrono::milliseconds(10), true));
+    EXPECT_TRUE(sm.startTimer(4, std::chrono::milliseconds(5)));
+    EXPECT_TRUE(sm.cancelTimer(4));
+    EXPECT_FALSE(sm.cancelTimer(4));
+    EXPECT_FALSE(sm.startTimer(StateMachine<TestState>::STATE_TIMEOUT_TIMER, std::chrono::milliseconds(1)));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(25));
+    sm.update(); // Fixed-rate driving fires timers too
+    ASSERT_GE(a->fired.size(), 3u);
+    EXPECT_EQ(a->fired[2], 2u); // The 20 ms timer after both 10 ms ones
+    EXPECT_TRUE(sm.isTimerActive(3)); // Periodic: re-armed
+
+    sm.transition(TestState::STATE_B);
+    EXPECT_FALSE(sm.isTimerActive(3));
+}
+
+class SlowEnterState : public MockState
+{
+public:
+    using MockState::MockState;
+
+    void onEnter() override
+    {
+        MockState::onEnter();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+};
+
+TEST_F(StateMachineTest, ProfilingCountsTimeHandlersAndTrace)
+{
+    StateMachine<TestState> sm(TestState::STATE_A);
+    sm.registerState(TestState::STATE_A, std::make_unique<MockState>(TestState::STATE_A));
+    sm.registerState(TestState::STATE_B, std::make_unique<SlowEnterState>(TestState::STATE_B));
+
+    EXPECT_FALSE(sm.isProfiling());
+    EXPECT_EQ(sm.getStateProfile(TestState::STATE_A).entries, 0u);
+    uint8_t buffer[64];
+    EXPECT_EQ(sm.exportTrace(buffer, sizeof(buffer)), 0u);
+
+    sm.enableProfiling(2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    sm.transition(TestState::STATE_B);
+    sm.transition(TestState::STATE_A);
+    sm.transition(TestState::STATE_B);
+
+    StateProfile a = sm.getStateProfile(TestState::STATE_A);
+    StateProfile b = sm.getStateProfile(TestState::STATE_B);
+    EXPECT_EQ(a.entries, 1u);
+    EXPECT_EQ(b.entries, 2u);
+    EXPECT_GE(a.timeInStateUs, 5000u);
+    EXPECT_GE(b.maxEnterUs, 2000u);
+    EXPECT_GE(b.timeInStateUs, 2000u); // Finished visit plus the current one
+    EXPECT_EQ(sm.getProfiler()->getTransitionCount(), 3u);
+
+    // Header plus the two newest records the ring kept
+    ASSERT_EQ(sm.exportTrace(buffer, sizeof(buffer)), 8u + 2 * 12u);
+    EXPECT_EQ(buffer[0], 'S');
+    EXPECT_EQ(buffer[3], 'R');
+    EXPECT_EQ(buffer[4], 1u);
+    EXPECT_EQ(buffer[5], 12u);
+    EXPECT_EQ(buffer[6] | (buffer[7] << 8), 2);
+    EXPECT_EQ(buffer[8 + 4], static_cast<uint8_t>(TestState::STATE_B)); // from of the older record
+    EXPECT_EQ(buffer[8 + 12 + 6], static_cast<uint8_t>(TestState::STATE_B)); // to of the newest
+    EXPECT_GE(buffer[8 + 12 + 10] | (buffer[8 + 12 + 11] << 8), 2000);
+
+    // Too small for both records: the newest only
+    EXPECT_EQ(sm.exportTrace(buffer, 8 + 12 + 5), 20u);
+    EXPECT_EQ(buffer[6], 1u);
+
+    sm.logProfile();
+    sm.resetProfile();
+    EXPECT_EQ(sm.getProfiler()->getTransitionCount(), 0u);
+    EXPECT_EQ(sm.getStateProfile(TestState::STATE_A).entries, 0u);
+}
@@ -0,0 +1,283 @@
+/**
+ * @file test_state_machine_fuzz.cpp
+ * @brief Randomized equivalence of StateMachine, DenseStateMachine and EventStateMachine
+ *
+ * Drives the map-based StateMachine and the table-based variants with the
+ * same seeded random operations and checks that every call returns the
+ * same, and that handlers and observers see the same calls in the same
+ * order. A failure names the seed and step; rerun that seed to reproduce.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/state_machine/dense_state_machine.hpp"
+#include "lopcore/state_machine/event_state_machine.hpp"
+#include "lopcore/state_machine/state_machine.hpp"
+
+using namespace lopcore;
+
+namespace
+{
+
+constexpr size_t STATE_COUNT = 16;
+
+enum class FuzzState : uint8_t
+{
+    // 0 to STATE_COUNT - 1, by cast
+};
+
+/**
+ * @brief A step of 1 to 3 states forward: (s + d) % STATE_COUNT
+ */
+enum class Step : uint8_t
+{
+    ONE,
+    TWO,
+    THREE
+};
+
+constexpr size_t STEP_COUNT = 3;
+
+FuzzState stateAt(size_t index)
+{
+    return static_cast<FuzzState>(index % STATE_COUNT);
+}
+
+FuzzState stepFrom(FuzzState state, Step step)
+{
+    return stateAt(static_cast<size_t>(state) + static_cast<size_t>(step) + 1);
+}
+
+/**
+ * @brief xorshift32: the same sequence on every host and standard library
+ */
+class Random
+{
+public:
+    explicit Random(uint32_t seed) : state_(seed == 0 ? 1 : seed)
+    {
+    }
+
+    uint32_t next(uint32_t bound)
+    {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 17;
+        state_ ^= state_ << 5;
+        return state_ % bound;
+    }
+
+private:
+    uint32_t state_;
+};
+
+/**
+ * @brief One handler or observer call: 'n'ter, 'x'it, 'u'pdate, 'o'bserver
+ */
+struct Call
+{
+    char kind;
+    uint8_t state;
+    uint8_t other; ///< The to state of an observer call
+
+    bool operator==(const Call &rhs) const
+    {
+        return kind == rhs.kind && state == rhs.state && other == rhs.other;
+    }
+};
+
+class RecordingState : public IState<FuzzState>
+{
+public:
+    RecordingState(FuzzState id, std::vector<Call> &calls) : id_(id), calls_(calls)
+    {
+    }
+
+    void onEnter() override
+    {
+        calls_.push_back(Call{'n', static_cast<uint8_t>(id_), 0});
+    }
+
+    void update() override
+    {
+        calls_.push_back(Call{'u', static_cast<uint8_t>(id_), 0});
+    }
+
+    void onExit() override
+    {
+        calls_.push_back(Call{'x', static_cast<uint8_t>(id_), 0});
+    }
+
+    FuzzState getStateId() const override
+    {
+        return id_;
+    }
+
+private:
+    FuzzState id_;
+    std::vector<Call> &calls_;
+};
+
+/**
+ * @brief Handlers for every state, all recording into one call list
+ */
+struct Recorder
+{
+    std::vector<Call> calls;
+    std::vector<std::unique_ptr<RecordingState>> states;
+
+    Recorder()
+    {
+        for (size_t i = 0; i < STATE_COUNT; i++)
+        {
+            states.push_back(std::make_unique<RecordingState>(stateAt(i), calls));
+        }
+    }
+
+    void observe(FuzzState from, FuzzState to)
+    {
+        calls.push_back(Call{'o', static_cast<uint8_t>(from), static_cast<uint8_t>(to)});
+    }
+};
+
+using Dense = DenseStateMachine<FuzzState, STATE_COUNT>;
+using Events = EventStateMachine<FuzzState, STATE_COUNT, Step, STEP_COUNT, uint32_t, STATE_COUNT * STEP_COUNT>;
+
+const uint32_t SEEDS[] = {1, 7, 42, 1234, 0xC0FFEE, 0xDEADBEEF};
+constexpr int STEPS = 2000;
+
+} // namespace
+
+// Random transition() targets (self, allowed, forbidden) and update()s, under random rules
+TEST(StateMachineFuzz, DenseMatchesMapBased)
+{
+    for (uint32_t seed : SEEDS)
+    {
+        SCOPED_TRACE(testing::Message() << "seed " << seed);
+        Random random(seed);
+        FuzzState initial = stateAt(random.next(STATE_COUNT));
+
+        Recorder mapCalls;
+        StateMachine<FuzzState> map(initial);
+        map.setMaxHistorySize(8);
+        Recorder denseCalls;
+        Dense dense(initial);
+
+        for (size_t i = 0; i < STATE_COUNT; i++)
+        {
+            map.registerState(stateAt(i), std::make_unique<RecordingState>(stateAt(i), mapCalls.calls));
+            dense.registerState(stateAt(i), *denseCalls.states[i]);
+        }
+        map.addObserver([&mapCalls](FuzzState from, FuzzState to) { mapCalls.observe(from, to); });
+        dense.addObserver([&denseCalls](FuzzState from, FuzzState to) { denseCalls.observe(from, to); });
+
+        // Half the seeds restrict transitions to a random quarter of the pairs
+        if (seed % 2 == 0)
+        {
+            for (size_t from = 0; from < STATE_COUNT; from++)
+            {
+                for (size_t to = 0; to < STATE_COUNT; to++)
+                {
+                    if (random.next(4) == 0)
+                    {
+                        map.addTransitionRule(stateAt(from), stateAt(to));
+                        dense.addTransitionRule(stateAt(from), stateAt(to));
+                    }
+                }
+            }
+        }
+
+        for (int step = 0; step < STEPS; step++)
+        {
+            SCOPED_TRACE(testing::Message() << "step " << step);
+            if (random.next(4) == 0)
+            {
+                map.update();
+                dense.update();
+            }
+            else
+            {
+                FuzzState target = stateAt(random.next(STATE_COUNT));
+                ASSERT_EQ(map.transition(target), dense.transition(target));
+            }
+            ASSERT_EQ(map.getCurrentState(), dense.getCurrentState());
+            ASSERT_EQ(map.getPreviousState(), dense.getPreviousState());
+        }
+
+        EXPECT_TRUE(mapCalls.calls == denseCalls.calls);
+        EXPECT_EQ(map.getHistory(), dense.getHistory());
+    }
+}
+
+// Random step events through a random partial table match the same steps as direct transitions
+TEST(StateMachineFuzz, EventTableMatchesMapBased)
+{
+    for (uint32_t seed : SEEDS)
+    {
+        SCOPED_TRACE(testing::Message() << "seed " << seed);
+        Random random(seed);
+        FuzzState initial = stateAt(random.next(STATE_COUNT));
+
+        Recorder mapCalls;
+        StateMachine<FuzzState> map(initial);
+        Recorder eventCalls;
+        Events events(initial, 64);
+
+        for (size_t i = 0; i < STATE_COUNT; i++)
+        {
+            map.registerState(stateAt(i), std::make_unique<RecordingState>(stateAt(i), mapCalls.calls));
+            events.machine().registerState(stateAt(i), *eventCalls.states[i]);
+        }
+        map.addObserver([&mapCalls](FuzzState from, FuzzState to) { mapCalls.observe(from, to); });
+        events.machine().addObserver([&eventCalls](FuzzState from, FuzzState to) { eventCalls.observe(from, to); });
+
+        // A row per (state, step) present with probability 3/4; the map-based machine gets the same rules
+        for (size_t from = 0; from < STATE_COUNT; from++)
+        {
+            for (size_t step = 0; step < STEP_COUNT; step++)
+            {
+                if (random.next(4) != 0)
+                {
+                    FuzzState to = stepFrom(stateAt(from), static_cast<Step>(step));
+                    ASSERT_TRUE(events.on(stateAt(from), static_cast<Step>(step), to));
+                    map.addTransitionRule(stateAt(from), to);
+                }
+            }
+        }
+
+        uint32_t handled = 0;
+        uint32_t unhandled = 0;
+        for (int step = 0; step < STEPS;)
+        {
+            // Post a burst, then dispatch it, as a producer task and the owner would
+            uint32_t burst = 1 + random.next(16);
+            std::vector<Step> posted;
+            for (uint32_t i = 0; i < burst && step < STEPS; i++, step++)
+            {
+                Step event = static_cast<Step>(random.next(STEP_COUNT));
+                ASSERT_TRUE(events.post(event));
+                posted.push_back(event);
+            }
+            ASSERT_EQ(events.dispatch(), posted.size());
+
+            for (Step event : posted)
+            {
+                // Bubbling aside, an unmatched event is a forbidden transition
+                bool moved = map.transition(stepFrom(map.getCurrentState(), event));
+                moved ? handled++ : unhandled++;
+            }
+            SCOPED_TRACE(testing::Message() << "step " << step);
+            ASSERT_EQ(map.getCurrentState(), events.getCurrentState());
+            ASSERT_EQ(map.getPreviousState(), events.machine().getPreviousState());
+        }
+
+        EXPECT_TRUE(mapCalls.calls == eventCalls.calls);
+        EventStateMachineStats stats = events.getStats();
+        EXPECT_EQ(stats.transitions, handled);
+        EXPECT_EQ(stats.unhandled, unhandled);
+        EXPECT_EQ(stats.dropped, 0u);
+    }
+}
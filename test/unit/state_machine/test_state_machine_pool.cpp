@@ -0,0 +1,143 @@
+/**
+ * @file test_state_machine_pool.cpp
+ * @brief Unit tests for StateGraph and StateMachinePool
+ */
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/state_machine/state_machine_pool.hpp"
+
+using namespace lopcore;
+
+enum class Peer
+{
+    DISCOVERED,
+    CONNECTING,
+    READY,
+    LOST
+};
+
+enum class PeerEvent
+{
+    CONNECT,
+    CONNECTED,
+    DISCONNECTED,
+    NOTIFY
+};
+
+struct PeerData
+{
+    uint16_t handle;
+    uint16_t notifications;
+    uint8_t readyCount;
+};
+
+using PeerGraph = StateGraph<Peer, 4, PeerEvent, 4, PeerData>;
+
+static std::vector<uint16_t> g_exits;
+
+static PeerGraph makeGraph(uint32_t connectTimeoutMs)
+{
+    return PeerGraph()
+        .on(Peer::DISCOVERED, PeerEvent::CONNECT, Peer::CONNECTING,
+            [](uint16_t, const PeerData &peer, uint32_t) { return peer.handle != 0; })
+        .on(Peer::CONNECTING, PeerEvent::CONNECTED, Peer::READY)
+        .on(Peer::READY, PeerEvent::NOTIFY, Peer::READY, nullptr,
+            [](uint16_t, PeerData &peer, uint32_t count) { peer.notifications += count; })
+        .on(Peer::READY, PeerEvent::DISCONNECTED, Peer::LOST)
+        .timeout(Peer::CONNECTING, connectTimeoutMs, Peer::LOST)
+        .onEnter(Peer::READY, [](uint16_t, PeerData &peer) { peer.readyCount++; })
+        .onExit(Peer::READY, [](uint16_t id, PeerData &) { g_exits.push_back(id); });
+}
+
+TEST(StateMachinePoolTest, InstancesShareOneGraph)
+{
+    static const PeerGraph graph = makeGraph(60000);
+    static StateMachinePool<PeerGraph, 200> peers(graph, 512);
+    g_exits.clear();
+
+    for (uint16_t i = 0; i < 200; i++)
+    {
+        ASSERT_EQ(peers.create(Peer::DISCOVERED, PeerData{static_cast<uint16_t>(i + 1), 0, 0}), i);
+    }
+    EXPECT_EQ(peers.create(Peer::DISCOVERED), decltype(peers)::NO_INSTANCE);
+
+    // Even instances connect; odd ones also become ready and receive notifications
+    for (uint16_t i = 0; i < 200; i += 2)
+    {
+        peers.post(i, PeerEvent::CONNECT);
+    }
+    for (uint16_t i = 1; i < 200; i += 2)
+    {
+        peers.post(i, PeerEvent::CONNECT);
+        peers.post(i, PeerEvent::CONNECTED);
+        peers.post(i, PeerEvent::NOTIFY, 3);
+        peers.post(i, PeerEvent::NOTIFY, 4);
+    }
+    EXPECT_EQ(peers.dispatch(), 500u);
+
+    EXPECT_EQ(peers.countIn(Peer::CONNECTING), 100u);
+    EXPECT_EQ(peers.countIn(Peer::READY), 100u);
+    EXPECT_EQ(peers.data(7).notifications, 7u); // Internal row: no exit or entry
+    EXPECT_EQ(peers.data(7).readyCount, 1u);
+
+    peers.post(7, PeerEvent::DISCONNECTED);
+    peers.post(8, PeerEvent::DISCONNECTED); // No row in CONNECTING
+    peers.dispatch();
+    EXPECT_EQ(peers.getState(7), Peer::LOST);
+    EXPECT_EQ(g_exits, std::vector<uint16_t>{7});
+
+    EventStateMachineStats stats = peers.getStats();
+    EXPECT_EQ(stats.posted, 502u);
+    EXPECT_EQ(stats.transitions, 501u);
+    EXPECT_EQ(stats.unhandled, 1u);
+
+    // The per-instance cost is the state byte, a deadline and the user data
+    EXPECT_LT(sizeof(peers), 200 * (sizeof(PeerData) + sizeof(uint32_t) + 2) + 256);
+}
+
+TEST(StateMachinePoolTest, GuardsAndDestroyedInstances)
+{
+    static const PeerGraph graph = makeGraph(60000);
+    StateMachinePool<PeerGraph, 4> peers(graph, 8);
+    auto noHandle = peers.create(Peer::DISCOVERED, PeerData{0, 0, 0});
+    auto gone = peers.create(Peer::READY, PeerData{1, 0, 0});
+    EXPECT_EQ(peers.data(gone).readyCount, 1u); // create() enters the initial state
+
+    peers.post(noHandle, PeerEvent::CONNECT); // Guard refuses
+    peers.post(gone, PeerEvent::DISCONNECTED);
+    g_exits.clear();
+    peers.destroy(gone);
+    EXPECT_EQ(g_exits, std::vector<uint16_t>{gone}); // Exit hook of its last state
+    EXPECT_EQ(peers.dispatch(), 2u);
+
+    EXPECT_EQ(peers.getState(noHandle), Peer::DISCOVERED);
+    EXPECT_EQ(peers.getStats().unhandled, 2u);
+    EXPECT_EQ(peers.size(), 1u);
+    EXPECT_NE(peers.create(Peer::DISCOVERED), decltype(peers)::NO_INSTANCE); // Slot reused
+}
+
+TEST(StateMachinePoolTest, TickFiresTimeouts)
+{
+    static const PeerGraph graph = makeGraph(30);
+    StateMachinePool<PeerGraph, 8> peers(graph, 8);
+    EXPECT_EQ(peers.tick(), UINT32_MAX); // Nothing armed
+
+    auto slow = peers.create(Peer::CONNECTING, PeerData{1, 0, 0});
+    auto fast = peers.create(Peer::CONNECTING, PeerData{2, 0, 0});
+    peers.post(fast, PeerEvent::CONNECTED);
+    peers.dispatch();
+
+    uint32_t wait = peers.tick();
+    EXPECT_GT(wait, 0u);
+    EXPECT_LE(wait, 30u);
+    std::this_thread::sleep_for(std::chrono::milliseconds(wait + 2));
+
+    EXPECT_EQ(peers.tick(), UINT32_MAX);
+    EXPECT_EQ(peers.getState(slow), Peer::LOST);
+    EXPECT_EQ(peers.getState(fast), Peer::READY); // Left CONNECTING in time
+}
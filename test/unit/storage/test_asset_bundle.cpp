@@ -0,0 +1,167 @@
+/**
+ * @file test_asset_bundle.cpp
+ * @brief Unit tests for AssetBundle
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/storage/asset_bundle.hpp"
+
+using namespace lopcore;
+
+static void putLe16(std::vector<uint8_t> &out, size_t at, uint16_t value)
+{
+    out[at] = static_cast<uint8_t>(value);
+    out[at + 1] = static_cast<uint8_t>(value >> 8);
+}
+
+static void putLe32(std::vector<uint8_t> &out, size_t at, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out[at + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+static uint32_t crc32(const uint8_t *data, size_t length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Same layout as tools/lopcore_asset_pack.py
+ */
+static std::vector<uint8_t> pack(std::vector<std::pair<std::string, std::string>> assets, uint16_t align)
+{
+    std::sort(assets.begin(), assets.end());
+
+    size_t namesOffset = AssetBundle::HEADER_SIZE + AssetBundle::ENTRY_SIZE * assets.size();
+    size_t offset = namesOffset;
+    for (const auto &asset : assets)
+    {
+        offset += asset.first.size();
+    }
+
+    std::vector<uint8_t> image(offset, 0);
+    size_t nameOffset = namesOffset;
+    for (size_t i = 0; i < assets.size(); i++)
+    {
+        const std::string &name = assets[i].first;
+        const std::string &data = assets[i].second;
+        std::copy(name.begin(), name.end(), image.begin() + nameOffset);
+
+        image.resize((image.size() + align - 1) / align * align, 0xFF);
+        size_t entry = AssetBundle::HEADER_SIZE + i * AssetBundle::ENTRY_SIZE;
+        putLe32(image, entry, static_cast<uint32_t>(nameOffset));
+        putLe32(image, entry + 4, static_cast<uint32_t>(image.size()));
+        putLe32(image, entry + 8, static_cast<uint32_t>(data.size()));
+        putLe16(image, entry + 12, static_cast<uint16_t>(name.size()));
+        image.insert(image.end(), data.begin(), data.end());
+        nameOffset += name.size();
+    }
+
+    std::copy_n("LCAB", 4, image.begin());
+    putLe16(image, 4, AssetBundle::VERSION);
+    putLe16(image, 6, align);
+    putLe32(image, 8, static_cast<uint32_t>(assets.size()));
+    putLe32(image, 12, static_cast<uint32_t>(image.size()));
+    putLe32(image, 16, crc32(image.data() + AssetBundle::HEADER_SIZE, image.size() - AssetBundle::HEADER_SIZE));
+    return image;
+}
+
+TEST(AssetBundleTest, Find_ReturnsViewIntoImage)
+{
+    std::vector<uint8_t> image =
+        pack({{"model.tflite", std::string(1000, 'm')}, {"ca.pem", "-----BEGIN"}, {"font/12.bin", "f"}}, 64);
+
+    AssetBundle bundle;
+    ASSERT_TRUE(bundle.attach(image.data(), image.size()));
+    EXPECT_EQ(bundle.count(), 3u);
+    EXPECT_TRUE(bundle.verify());
+
+    AssetView model = bundle.find("model.tflite");
+    ASSERT_TRUE(model);
+    EXPECT_EQ(model.size, 1000u);
+    EXPECT_EQ((model.data - image.data()) % 64, 0);
+    EXPECT_GE(model.data, image.data());
+    EXPECT_LT(model.data, image.data() + image.size());
+
+    AssetView ca = bundle.find("ca.pem");
+    ASSERT_TRUE(ca);
+    EXPECT_EQ(std::string(reinterpret_cast<const char *>(ca.data), ca.size), "-----BEGIN");
+
+    EXPECT_FALSE(bundle.find("font"));
+    EXPECT_FALSE(bundle.find("model.tflite2"));
+    EXPECT_FALSE(bundle.find(""));
+}
+
+TEST(AssetBundleTest, Entries_InNameOrder)
+{
+    std::vector<uint8_t> image = pack({{"b", "2"}, {"a", "1"}, {"ab", "12"}, {"c", ""}}, 4);
+
+    AssetBundle bundle;
+    ASSERT_TRUE(bundle.attach(image.data(), image.size()));
+    ASSERT_EQ(bundle.count(), 4u);
+    EXPECT_EQ(bundle.nameAt(0), "a");
+    EXPECT_EQ(bundle.nameAt(1), "ab");
+    EXPECT_EQ(bundle.nameAt(3), "c");
+    EXPECT_EQ(bundle.at(3).size, 0u);
+    EXPECT_TRUE(bundle.find("c"));
+    EXPECT_FALSE(bundle.at(4));
+    EXPECT_EQ(bundle.nameAt(4), "");
+}
+
+TEST(AssetBundleTest, Attach_RejectsMalformedImages)
+{
+    std::vector<uint8_t> image = pack({{"asset", "data"}}, 16);
+    AssetBundle bundle;
+
+    EXPECT_FALSE(bundle.attach(image.data(), image.size() - 1));
+    EXPECT_FALSE(bundle.isOpen());
+
+    std::vector<uint8_t> badMagic = image;
+    badMagic[0] = 'X';
+    EXPECT_FALSE(bundle.attach(badMagic.data(), badMagic.size()));
+
+    std::vector<uint8_t> badOffset = image;
+    putLe32(badOffset, AssetBundle::HEADER_SIZE + 4, static_cast<uint32_t>(image.size()));
+    EXPECT_FALSE(bundle.attach(badOffset.data(), badOffset.size()));
+
+    std::vector<uint8_t> badCount = image;
+    putLe32(badCount, 8, 1000000);
+    EXPECT_FALSE(bundle.attach(badCount.data(), badCount.size()));
+}
+
+TEST(AssetBundleTest, Verify_DetectsCorruption)
+{
+    std::vector<uint8_t> image = pack({{"asset", std::string(100, 'a')}}, 16);
+    image[image.size() - 1] ^= 0x01;
+
+    AssetBundle bundle;
+    ASSERT_TRUE(bundle.attach(image.data(), image.size()));
+    EXPECT_FALSE(bundle.verify());
+}
+
+TEST(AssetBundleTest, MapPartition_FailsOnHost)
+{
+    AssetBundle bundle;
+    EXPECT_FALSE(bundle.mapPartition("assets"));
+    EXPECT_FALSE(bundle.isOpen());
+}
@@ -0,0 +1,248 @@
+/**
+ * @file test_async_storage.cpp
+ * @brief Unit tests for AsyncStorage
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include <sys/stat.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/storage/async_storage.hpp"
+#include "lopcore/storage/spiffs_storage.hpp"
+
+using namespace lopcore;
+
+/**
+ * @brief In-memory backend whose writes can be held back to fill the queue
+ */
+class GatedBackend
+{
+public:
+    bool write(const std::string &key, const std::vector<uint8_t> &data)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            entered_++;
+            entered.notify_all();
+            opened.wait(lock, [this] { return open_; });
+            writes_.push_back(key);
+            data_[key] = data;
+        }
+        return key != "bad";
+    }
+
+    std::optional<std::vector<uint8_t>> readBinary(const std::string &key)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = data_.find(key);
+        if (it == data_.end())
+        {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    void hold()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = false;
+    }
+
+    void release()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = true;
+        opened.notify_all();
+    }
+
+    /**
+     * @brief Wait until the worker is inside write() number n
+     */
+    void waitForWrite(int n)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        entered.wait(lock, [this, n] { return entered_ >= n; });
+    }
+
+    std::vector<std::string> writes()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return writes_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable opened;
+    std::condition_variable entered;
+    bool open_ = true;
+    int entered_ = 0;
+    std::vector<std::string> writes_;
+    std::map<std::string, std::vector<uint8_t>> data_;
+};
+
+static std::vector<uint8_t> bytes(const std::string &text)
+{
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+TEST(AsyncStorageTest, WriteThenRead_RoundTrips)
+{
+    GatedBackend backend;
+    AsyncStorage async(backend, storage::AsyncStorageConfig());
+    ASSERT_TRUE(async.start());
+
+    std::future<bool> written = async.writeAsync("key", std::string("value"));
+    std::future<std::optional<std::vector<uint8_t>>> read = async.readAsync("key");
+
+    EXPECT_TRUE(written.get());
+    std::optional<std::vector<uint8_t>> data = read.get();
+    ASSERT_TRUE(data.has_value());
+    EXPECT_EQ(*data, bytes("value"));
+
+    AsyncStorageStats stats = async.getStats();
+    EXPECT_EQ(stats.writes, 1u);
+    EXPECT_EQ(stats.reads, 1u);
+}
+
+TEST(AsyncStorageTest, QueuedWritesToSameKey_Coalesce)
+{
+    GatedBackend backend;
+    AsyncStorage async(backend, storage::AsyncStorageConfig());
+    ASSERT_TRUE(async.start());
+
+    // Keep the worker busy so the next writes wait in the queue
+    backend.hold();
+    std::future<bool> busy = async.writeAsync("busy", std::string("x"));
+    backend.waitForWrite(1);
+
+    std::future<bool> first = async.writeAsync("state", std::string("1"));
+    std::future<bool> second = async.writeAsync("state", std::string("2"));
+    std::future<bool> third = async.writeAsync("state", std::string("3"));
+    EXPECT_EQ(async.pending(), 1u);
+
+    backend.release();
+    EXPECT_TRUE(busy.get());
+    EXPECT_TRUE(first.get());
+    EXPECT_TRUE(second.get());
+    EXPECT_TRUE(third.get());
+
+    EXPECT_EQ(backend.writes(), (std::vector<std::string>{"busy", "state"}));
+    EXPECT_EQ(*backend.readBinary("state"), bytes("3"));
+    EXPECT_EQ(async.getStats().coalesced, 2u);
+}
+
+TEST(AsyncStorageTest, ReadBetweenWrites_StopsCoalescing)
+{
+    GatedBackend backend;
+    AsyncStorage async(backend, storage::AsyncStorageConfig());
+    ASSERT_TRUE(async.start());
+
+    backend.hold();
+    async.writeAsync("busy", std::string("x"));
+    backend.waitForWrite(1);
+
+    async.writeAsync("state", std::string("old"));
+    std::future<std::optional<std::vector<uint8_t>>> read = async.readAsync("state");
+    async.writeAsync("state", std::string("new"));
+    EXPECT_EQ(async.pending(), 3u);
+
+    backend.release();
+    EXPECT_EQ(*read.get(), bytes("old"));
+    async.flush();
+    EXPECT_EQ(*backend.readBinary("state"), bytes("new"));
+    EXPECT_EQ(async.getStats().coalesced, 0u);
+}
+
+TEST(AsyncStorageTest, FullQueue_RejectsWithoutBlocking)
+{
+    GatedBackend backend;
+    AsyncStorage async(backend, storage::AsyncStorageConfig().setQueueDepth(2));
+    ASSERT_TRUE(async.start());
+
+    backend.hold();
+    async.writeAsync("busy", std::string("x"));
+    backend.waitForWrite(1);
+
+    EXPECT_TRUE(async.writeAsync("a", bytes("1"), nullptr));
+    EXPECT_TRUE(async.writeAsync("b", bytes("2"), nullptr));
+
+    auto start = std::chrono::steady_clock::now();
+    std::future<bool> rejected = async.writeAsync("c", std::string("3"));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+    EXPECT_FALSE(rejected.get());
+
+    // Coalescing into a queued write needs no slot
+    EXPECT_TRUE(async.writeAsync("a", bytes("4"), nullptr));
+
+    backend.release();
+    async.flush();
+    EXPECT_EQ(async.getStats().rejected, 1u);
+}
+
+TEST(AsyncStorageTest, CallbacksReportResults)
+{
+    GatedBackend backend;
+    AsyncStorage async(backend, storage::AsyncStorageConfig());
+    ASSERT_TRUE(async.start());
+
+    std::promise<bool> result;
+    ASSERT_TRUE(async.writeAsync("bad", bytes("x"), [&result](bool ok) { result.set_value(ok); }));
+    EXPECT_FALSE(result.get_future().get());
+    EXPECT_EQ(async.getStats().failed, 1u);
+
+    std::promise<bool> found;
+    ASSERT_TRUE(async.readAsync("missing", [&found](std::optional<std::vector<uint8_t>> data) {
+        found.set_value(data.has_value());
+    }));
+    EXPECT_FALSE(found.get_future().get());
+}
+
+TEST(AsyncStorageTest, Stop_FinishesQueuedWritesThenRejects)
+{
+    GatedBackend backend;
+    AsyncStorage async(backend, storage::AsyncStorageConfig());
+
+    EXPECT_FALSE(async.writeAsync("early", std::string("x")).get());
+
+    ASSERT_TRUE(async.start());
+    EXPECT_FALSE(async.start());
+    for (int i = 0; i < 8; i++)
+    {
+        async.writeAsync("key" + std::to_string(i), std::string("x"));
+    }
+    async.stop();
+
+    EXPECT_FALSE(async.isRunning());
+    EXPECT_EQ(backend.writes().size(), 8u);
+    EXPECT_FALSE(async.writeAsync("late", std::string("x")).get());
+    EXPECT_EQ(async.getStats().rejected, 2u);
+}
+
+TEST(AsyncStorageTest, SpiffsBackend)
+{
+    char pattern[] = "/tmp/lopcore_async_XXXXXX";
+    ASSERT_NE(mkdtemp(pattern), nullptr);
+    std::string basePath = pattern;
+    {
+        SpiffsStorage spiffs(storage::SpiffsConfig().setBasePath(basePath));
+        ASSERT_TRUE(spiffs.initialize());
+
+        AsyncStorage async(spiffs, storage::AsyncStorageConfig());
+        ASSERT_TRUE(async.start());
+        EXPECT_TRUE(async.writeAsync("log.bin", std::string("abc")).get());
+        EXPECT_EQ(*async.readAsync("log.bin").get(), bytes("abc"));
+    }
+    std::filesystem::remove_all(basePath);
+}
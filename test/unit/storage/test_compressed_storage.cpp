@@ -0,0 +1,196 @@
+/**
+ * @file test_compressed_storage.cpp
+ * @brief Unit tests for CompressedStorage
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include <sys/stat.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/storage/compressed_storage.hpp"
+#include "lopcore/storage/spiffs_storage.hpp"
+
+using namespace lopcore;
+
+class CompressedStorageTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_FALSE(basePath.empty());
+        ASSERT_TRUE(spiffs.initialize());
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(basePath);
+    }
+
+    static std::string telemetry(size_t records)
+    {
+        std::string json;
+        for (size_t i = 0; i < records; i++)
+        {
+            json += "{\"ts\":" + std::to_string(1700000000 + i * 10) + ",\"temp\":" + std::to_string(20 + i % 7) +
+                    ",\"status\":\"ok\"}\n";
+        }
+        return json;
+    }
+
+    static std::vector<uint8_t> noise(size_t length)
+    {
+        std::mt19937 random(42);
+        std::vector<uint8_t> data(length);
+        for (uint8_t &byte : data)
+        {
+            byte = static_cast<uint8_t>(random());
+        }
+        return data;
+    }
+
+    static std::string makeTempDir()
+    {
+        char pattern[] = "/tmp/lopcore_compressed_XXXXXX";
+        return mkdtemp(pattern) ? pattern : "";
+    }
+
+    // Created before spiffs, which takes it as its base path
+    std::string basePath = makeTempDir();
+    SpiffsStorage spiffs{storage::SpiffsConfig().setBasePath(basePath)};
+};
+
+TEST_F(CompressedStorageTest, Write_CompressesAndReadsBack)
+{
+    CompressedStorage<SpiffsStorage> store(spiffs, storage::CompressedStorageConfig());
+    std::string json = telemetry(500);
+
+    ASSERT_TRUE(store.write("backlog.json", json));
+    EXPECT_LT(*spiffs.getFileSize("backlog.json"), json.size() / 3);
+    EXPECT_EQ(store.getFileSize("backlog.json"), json.size());
+    EXPECT_EQ(store.read("backlog.json"), json);
+}
+
+TEST_F(CompressedStorageTest, Write_KeepsSmallAndIncompressibleValuesAsTheyAre)
+{
+    CompressedStorage<SpiffsStorage> store(spiffs, storage::CompressedStorageConfig());
+    std::vector<uint8_t> random = noise(1000);
+
+    ASSERT_TRUE(store.write("tiny", "abc"));
+    ASSERT_TRUE(store.write("random.bin", random));
+    EXPECT_EQ(spiffs.read("tiny"), "abc");
+    EXPECT_EQ(spiffs.getFileSize("random.bin"), 1000u);
+    EXPECT_EQ(store.readBinary("random.bin"), random);
+
+    // Looks like a header, so it must be wrapped to read back unchanged
+    ASSERT_TRUE(store.write("tricky", "LCZS????"));
+    EXPECT_EQ(store.read("tricky"), "LCZS????");
+}
+
+TEST_F(CompressedStorageTest, Suffixes_SelectCompressedKeys)
+{
+    CompressedStorage<SpiffsStorage> store(spiffs, storage::CompressedStorageConfig().addSuffix(".json"));
+    std::string json = telemetry(50);
+
+    ASSERT_TRUE(store.write("a.json", json));
+    ASSERT_TRUE(store.write("a.txt", json));
+    EXPECT_TRUE(store.compresses("a.json"));
+    EXPECT_FALSE(store.compresses("a.txt"));
+    EXPECT_LT(*spiffs.getFileSize("a.json"), json.size());
+    EXPECT_EQ(spiffs.read("a.txt"), json);
+    EXPECT_EQ(store.read("a.txt"), json);
+}
+
+TEST_F(CompressedStorageTest, Uncompressed_FilesFromBeforeStayReadable)
+{
+    std::string json = telemetry(20);
+    ASSERT_TRUE(spiffs.write("old.json", json));
+
+    CompressedStorage<SpiffsStorage> store(spiffs, storage::CompressedStorageConfig());
+    EXPECT_EQ(store.getFileSize("old.json"), json.size());
+    EXPECT_EQ(store.read("old.json"), json);
+    EXPECT_FALSE(store.openReader("old.json").isCompressed());
+}
+
+TEST_F(CompressedStorageTest, Streams_RoundTripInChunks)
+{
+    CompressedStorage<SpiffsStorage> store(spiffs, storage::CompressedStorageConfig());
+    std::string json = telemetry(3000); // Several times the window
+
+    {
+        CompressedWriter writer = store.openWriter("stream.json");
+        ASSERT_TRUE(writer);
+        for (size_t offset = 0; offset < json.size(); offset += 700)
+        {
+            ASSERT_TRUE(writer.write(json.substr(offset, 700)));
+        }
+        EXPECT_EQ(writer.tell(), json.size());
+        ASSERT_TRUE(writer.close());
+    }
+    EXPECT_EQ(store.getFileSize("stream.json"), json.size());
+    EXPECT_LT(*spiffs.getFileSize("stream.json"), json.size() / 3);
+
+    CompressedReader reader = store.openReader("stream.json");
+    ASSERT_TRUE(reader);
+    EXPECT_TRUE(reader.isCompressed());
+    EXPECT_EQ(reader.size(), json.size());
+
+    std::string out;
+    uint8_t chunk[333];
+    size_t n;
+    while ((n = reader.read(chunk, sizeof(chunk))) > 0)
+    {
+        out.append(reinterpret_cast<char *>(chunk), n);
+    }
+    EXPECT_TRUE(reader.eof());
+    EXPECT_FALSE(reader.failed());
+    EXPECT_EQ(out, json);
+
+    // Same bytes as the in-memory path
+    std::vector<uint8_t> whole;
+    CompressedWriter::compress(reinterpret_cast<const uint8_t *>(json.data()), json.size(), whole);
+    EXPECT_EQ(spiffs.readBinary("stream.json"), whole);
+}
+
+TEST_F(CompressedStorageTest, UnclosedWriter_LeavesUnreadableValue)
+{
+    CompressedStorage<SpiffsStorage> store(spiffs, storage::CompressedStorageConfig());
+    std::string json = telemetry(100);
+    {
+        StorageWriter raw = spiffs.openWriter("partial.json");
+        std::vector<uint8_t> whole;
+        CompressedWriter::compress(reinterpret_cast<const uint8_t *>(json.data()), json.size(), whole);
+        whole[4] = whole[5] = whole[6] = whole[7] = 0xFF; // Size as left by a writer that never closed
+        raw.write(whole.data(), whole.size());
+    }
+
+    EXPECT_FALSE(store.openReader("partial.json"));
+    EXPECT_FALSE(store.getFileSize("partial.json"));
+    EXPECT_FALSE(store.read("partial.json"));
+}
+
+TEST_F(CompressedStorageTest, Corruption_IsReported)
+{
+    CompressedStorage<SpiffsStorage> store(spiffs, storage::CompressedStorageConfig());
+    std::string json = telemetry(100);
+    ASSERT_TRUE(store.write("data.json", json));
+
+    std::vector<uint8_t> stored = *spiffs.readBinary("data.json");
+    stored.resize(stored.size() / 2);
+    ASSERT_TRUE(spiffs.write("data.json", stored));
+
+    CompressedReader reader = store.openReader("data.json");
+    ASSERT_TRUE(reader);
+    std::vector<uint8_t> out(reader.size());
+    EXPECT_LT(reader.read(out.data(), out.size()), json.size());
+    EXPECT_TRUE(reader.failed());
+    EXPECT_FALSE(store.read("data.json"));
+}
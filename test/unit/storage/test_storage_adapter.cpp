@@ -0,0 +1,245 @@
+/**
+ * @file test_storage_adapter.cpp
+ * @brief Unit tests for StorageAdapter and StorageSelector
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include <sys/stat.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/storage/nvs_storage.hpp"
+#include "lopcore/storage/spiffs_storage.hpp"
+#include "lopcore/storage/storage_adapter.hpp"
+
+using namespace lopcore;
+
+/**
+ * @brief Key-value backend shaped like NvsStorage: no append, no streams, commits
+ */
+class KeyValueBackend
+{
+public:
+    bool write(const std::string &key, const std::string &data)
+    {
+        return write(key, std::vector<uint8_t>(data.begin(), data.end()));
+    }
+
+    bool write(const std::string &key, const std::vector<uint8_t> &data)
+    {
+        data_[key] = data;
+        pending++;
+        return true;
+    }
+
+    std::optional<std::string> read(const std::string &key)
+    {
+        auto value = readBinary(key);
+        if (!value)
+        {
+            return std::nullopt;
+        }
+        return std::string(value->begin(), value->end());
+    }
+
+    std::optional<std::vector<uint8_t>> readBinary(const std::string &key)
+    {
+        auto it = data_.find(key);
+        if (it == data_.end())
+        {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    bool exists(const std::string &key)
+    {
+        return data_.count(key) != 0;
+    }
+
+    bool remove(const std::string &key)
+    {
+        return data_.erase(key) != 0;
+    }
+
+    std::vector<std::string> listKeys()
+    {
+        std::vector<std::string> keys;
+        for (const auto &entry : data_)
+        {
+            keys.push_back(entry.first);
+        }
+        return keys;
+    }
+
+    size_t getTotalSize() const
+    {
+        return 1000;
+    }
+
+    size_t getUsedSize() const
+    {
+        return data_.size();
+    }
+
+    size_t getFreeSize() const
+    {
+        return getTotalSize() - getUsedSize();
+    }
+
+    StorageType getType() const
+    {
+        return StorageType::NVS;
+    }
+
+    bool commit()
+    {
+        pending = 0;
+        return true;
+    }
+
+    size_t pending = 0;
+
+private:
+    std::map<std::string, std::vector<uint8_t>> data_;
+};
+
+static_assert(storage::traits::is_storage_backend_v<SpiffsStorage>, "SpiffsStorage is a backend");
+static_assert(storage::traits::supports_append_v<SpiffsStorage>, "SpiffsStorage appends in place");
+static_assert(storage::traits::supports_streaming_v<SpiffsStorage>, "SpiffsStorage streams");
+static_assert(!StorageAdapter<KeyValueBackend>::supportsAppend(), "Key-value backends rewrite to append");
+static_assert(!StorageAdapter<KeyValueBackend>::supportsStreaming(), "Key-value backends do not stream");
+
+// Capability traits of the concrete backends
+static_assert(!storage::traits::has_typed_accessors_v<SpiffsStorage>, "SpiffsStorage has no typed accessors");
+static_assert(storage::traits::has_typed_accessors_v<NvsStorage>, "NvsStorage has typed accessors");
+static_assert(storage::traits::is_nvs_scalar_v<uint32_t> && storage::traits::is_nvs_scalar_v<int64_t>,
+              "Integers map to NVS scalars");
+static_assert(!storage::traits::is_nvs_scalar_v<float>, "Floats are not NVS scalars");
+static_assert(storage::traits::is_nvs_storable_v<float>, "Trivially copyable types are stored as blobs");
+static_assert(!storage::traits::is_nvs_storable_v<std::string>, "std::string is not trivially copyable");
+static_assert(!storage::traits::is_nvs_storable_v<const char *>, "Pointers are not storable");
+static_assert(!storage::traits::requires_commit_v<SpiffsStorage>, "SpiffsStorage does not commit");
+static_assert(storage::traits::requires_commit_v<NvsStorage>, "NvsStorage commits");
+static_assert(!storage::traits::supports_batch_v<SpiffsStorage>, "SpiffsStorage has no batches");
+static_assert(storage::traits::supports_batch_v<NvsStorage>, "NvsStorage batches writes");
+static_assert(storage::traits::reports_mounted_v<SpiffsStorage>, "SpiffsStorage reports its mount state");
+static_assert(!storage::traits::reports_mounted_v<NvsStorage>, "NvsStorage has no mount state");
+
+class StorageAdapterTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_FALSE(basePath.empty());
+        ASSERT_TRUE(spiffs.initialize());
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(basePath);
+    }
+
+    static std::string makeTempDir()
+    {
+        char pattern[] = "/tmp/lopcore_adapter_XXXXXX";
+        return mkdtemp(pattern) ? pattern : "";
+    }
+
+    // Created before spiffs, which takes it as its base path
+    std::string basePath = makeTempDir();
+    SpiffsStorage spiffs{storage::SpiffsConfig().setBasePath(basePath)};
+    KeyValueBackend keyValue;
+};
+
+/**
+ * @brief Generic code written once for any backend
+ */
+template <typename Backend>
+static std::optional<std::string> logTwice(Backend &backend)
+{
+    StorageAdapter<Backend> storage(backend);
+    storage.remove("log");
+    if (!storage.append("log", std::string("a;")) || !storage.append("log", std::string("b;")) ||
+        !storage.syncAppends())
+    {
+        return std::nullopt;
+    }
+    return storage.read("log");
+}
+
+TEST_F(StorageAdapterTest, Append_NativeOrRewritten)
+{
+    EXPECT_EQ(logTwice(spiffs), "a;b;");
+    EXPECT_EQ(logTwice(keyValue), "a;b;");
+    EXPECT_EQ(keyValue.pending, 0u); // syncAppends() committed
+}
+
+TEST_F(StorageAdapterTest, OptionalFeatures_FallBack)
+{
+    StorageAdapter<KeyValueBackend> storage(keyValue);
+    ASSERT_TRUE(storage.write("k", "v"));
+
+    EXPECT_FALSE(storage.openReader("k"));
+    EXPECT_FALSE(storage.openWriter("k"));
+    EXPECT_FALSE(storage.format());
+    EXPECT_TRUE(storage.isMounted());
+    EXPECT_EQ(keyValue.pending, 1u);
+    EXPECT_TRUE(storage.commit());
+    EXPECT_EQ(keyValue.pending, 0u);
+    EXPECT_EQ(&storage.backend(), &keyValue);
+}
+
+TEST_F(StorageAdapterTest, Streams_ForwardedToFileBackend)
+{
+    StorageAdapter<SpiffsStorage> storage(spiffs);
+    {
+        StorageWriter writer = storage.openWriter("stream.bin");
+        ASSERT_TRUE(writer);
+        ASSERT_TRUE(writer.write("chunked"));
+        ASSERT_TRUE(writer.close());
+    }
+
+    StorageReader reader = storage.openReader("stream.bin");
+    ASSERT_TRUE(reader);
+    EXPECT_EQ(reader.size(), 7u);
+    EXPECT_TRUE(storage.commit());
+}
+
+TEST_F(StorageAdapterTest, Selector_DispatchesToChosenBackend)
+{
+    using BootStorage = StorageSelector<SpiffsStorage, KeyValueBackend>;
+
+    BootStorage files(spiffs);
+    BootStorage keys(keyValue);
+
+    ASSERT_TRUE(files.write("config", "file"));
+    ASSERT_TRUE(keys.write("config", "nvs"));
+    EXPECT_EQ(files.read("config"), "file");
+    EXPECT_EQ(keys.read("config"), "nvs");
+    EXPECT_EQ(keys.getType(), StorageType::NVS);
+    EXPECT_EQ(files.getType(), StorageType::SPIFFS);
+
+    EXPECT_TRUE(files.supportsStreaming());
+    EXPECT_FALSE(keys.supportsStreaming());
+    EXPECT_TRUE(files.openReader("config"));
+    EXPECT_FALSE(keys.openReader("config"));
+
+    ASSERT_TRUE(keys.append("config", std::string("+")));
+    EXPECT_EQ(keyValue.read("config"), "nvs+");
+
+    EXPECT_EQ(files.get<SpiffsStorage>(), &spiffs);
+    EXPECT_EQ(files.get<KeyValueBackend>(), nullptr);
+    EXPECT_EQ(keys.visit([](const auto &storage) { return storage.listKeys().size(); }), 1u);
+
+    EXPECT_TRUE(keys.remove("config"));
+    EXPECT_FALSE(keys.exists("config"));
+}
@@ -0,0 +1,216 @@
+/**
+ * @file test_storage_index.cpp
+ * @brief Unit tests for StorageIndex and the indexed SPIFFS listing
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/storage/spiffs_storage.hpp"
+#include "lopcore/storage/storage_index.hpp"
+
+using namespace lopcore;
+
+class StorageIndexTest : public ::testing::Test
+{
+protected:
+    std::string basePath;
+    std::unique_ptr<SpiffsStorage> storage;
+
+    void SetUp() override
+    {
+        char pattern[] = "/tmp/lopcore_index_XXXXXX";
+        ASSERT_NE(mkdtemp(pattern), nullptr);
+        basePath = pattern;
+        storage::SpiffsConfig config;
+        config.setBasePath(basePath).setIndexFiles(true);
+        storage = std::make_unique<SpiffsStorage>(config);
+        ASSERT_TRUE(storage->initialize());
+    }
+
+    void TearDown() override
+    {
+        storage.reset();
+        std::filesystem::remove_all(basePath);
+    }
+
+    void writeRaw(const std::string &name, const std::string &data)
+    {
+        FILE *file = fopen((basePath + "/" + name).c_str(), "wb");
+        ASSERT_NE(file, nullptr);
+        fwrite(data.data(), 1, data.size(), file);
+        fclose(file);
+    }
+
+    static std::vector<std::string> sorted(std::vector<std::string> names)
+    {
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+};
+
+TEST_F(StorageIndexTest, Build_FindsExistingFilesAndDirectories)
+{
+    writeRaw("a.txt", "hello");
+    mkdir((basePath + "/logs").c_str(), 0755);
+    writeRaw("logs/1.log", "123");
+
+    StorageIndex index;
+    ASSERT_TRUE(index.build(basePath));
+    EXPECT_TRUE(index.isBuilt());
+
+    std::vector<StorageIndex::Entry> root = index.list("");
+    ASSERT_EQ(root.size(), 2u);
+    EXPECT_EQ(root[0].name, "a.txt");
+    EXPECT_EQ(root[0].size, 5u);
+    EXPECT_FALSE(root[0].isDirectory);
+    EXPECT_EQ(root[1].name, "logs");
+    EXPECT_TRUE(root[1].isDirectory);
+
+    std::vector<StorageIndex::Entry> logs = index.list("logs");
+    ASSERT_EQ(logs.size(), 1u);
+    EXPECT_EQ(logs[0].name, "1.log");
+    EXPECT_EQ(index.totalSize(), 8u);
+}
+
+TEST_F(StorageIndexTest, Build_MissingRoot_NotBuilt)
+{
+    StorageIndex index;
+    EXPECT_FALSE(index.build(basePath + "/missing"));
+    EXPECT_FALSE(index.isBuilt());
+}
+
+TEST_F(StorageIndexTest, EraseAndRename_TrackDirectories)
+{
+    StorageIndex index;
+    ASSERT_TRUE(index.build(basePath));
+
+    index.update(basePath + "/logs/1.log", 10);
+    index.update(basePath + "/logs/2.log", 20);
+    ASSERT_EQ(index.list("").size(), 1u);
+    EXPECT_EQ(index.list("logs").size(), 2u);
+
+    index.rename(basePath + "/logs/2.log", basePath + "/old.log");
+    EXPECT_EQ(index.list("logs").size(), 1u);
+    EXPECT_EQ(index.list("").size(), 2u);
+
+    index.erase(basePath + "/logs");
+    ASSERT_EQ(index.list("").size(), 1u);
+    EXPECT_EQ(index.list("")[0].name, "old.log");
+    EXPECT_EQ(index.totalSize(), 20u);
+}
+
+TEST_F(StorageIndexTest, Spiffs_ListingFollowsWritesAndRemovals)
+{
+    ASSERT_TRUE(storage->write("a.bin", std::string(10, 'a')));
+    ASSERT_TRUE(storage->write("b.bin", std::string(20, 'b')));
+    ASSERT_TRUE(storage->append("c.log", std::string(5, 'c')));
+    ASSERT_TRUE(storage->append("c.log", std::string(5, 'c')));
+
+    EXPECT_EQ(sorted(storage->listKeys()), (std::vector<std::string>{"a.bin", "b.bin", "c.log"}));
+    EXPECT_EQ(sorted(storage->listKeysByPattern("*.bin")), (std::vector<std::string>{"a.bin", "b.bin"}));
+
+    std::vector<SpiffsStorage::FileInfo> files = storage->listDetailed();
+    ASSERT_EQ(files.size(), 3u);
+    EXPECT_EQ(files[2].name, "c.log");
+    EXPECT_EQ(files[2].size, 10u);
+
+    EXPECT_EQ(storage->removeByPattern("*.bin"), 2u);
+    EXPECT_TRUE(storage->remove("c.log"));
+    EXPECT_TRUE(storage->listKeys().empty());
+}
+
+TEST_F(StorageIndexTest, Spiffs_UsesIndexNotDirectory)
+{
+    // Written behind the storage's back: not seen until the next initialize()
+    writeRaw("external.bin", "x");
+    EXPECT_TRUE(storage->listKeys().empty());
+
+    storage::SpiffsConfig config;
+    config.setBasePath(basePath).setIndexFiles(true);
+    SpiffsStorage reopened(config);
+    ASSERT_TRUE(reopened.initialize());
+    EXPECT_EQ(reopened.listKeys(), std::vector<std::string>{"external.bin"});
+}
+
+TEST_F(StorageIndexTest, Spiffs_StreamedFileSizeLearnedWhenListed)
+{
+    StorageWriter writer = storage->openWriter("stream.bin");
+    ASSERT_TRUE(writer.write(std::string(1234, 's')));
+    ASSERT_TRUE(writer.close());
+
+    std::vector<SpiffsStorage::FileInfo> files = storage->listDetailed();
+    ASSERT_EQ(files.size(), 1u);
+    EXPECT_EQ(files[0].size, 1234u);
+}
+
+TEST(GlobMatchTest, Wildcards)
+{
+    EXPECT_TRUE(globMatch("acc_raw_*.bin", "acc_raw_12.bin"));
+    EXPECT_TRUE(globMatch("*", ""));
+    EXPECT_TRUE(globMatch("a*b*c", "aXXbYYc"));
+    EXPECT_TRUE(globMatch("a*b*c", "abc"));
+    EXPECT_FALSE(globMatch("a*b*c", "aXXbYY"));
+    EXPECT_TRUE(globMatch("log_??.txt", "log_07.txt"));
+    EXPECT_FALSE(globMatch("log_??.txt", "log_7.txt"));
+    EXPECT_FALSE(globMatch("ab*", "a"));
+    EXPECT_TRUE(globMatch("exact.bin", "exact.bin"));
+    EXPECT_FALSE(globMatch("exact.bin", "exact.bin2"));
+}
+
+TEST(GlobMatchTest, CharacterClasses)
+{
+    EXPECT_TRUE(globMatch("log_0[1-3].txt", "log_02.txt"));
+    EXPECT_FALSE(globMatch("log_0[1-3].txt", "log_04.txt"));
+    EXPECT_TRUE(globMatch("[abc]*", "b.bin"));
+    EXPECT_TRUE(globMatch("[!.]*", "visible"));
+    EXPECT_FALSE(globMatch("[!.]*", ".hidden"));
+    EXPECT_TRUE(globMatch("[]]", "]"));
+    // Unterminated class: '[' is a literal
+    EXPECT_TRUE(globMatch("a[b", "a[b"));
+    EXPECT_FALSE(globMatch("a[b", "ab"));
+}
+
+TEST(GlobMatchTest, ManyStars_NoBacktrackingBlowUp)
+{
+    std::string name(10000, 'a');
+    EXPECT_FALSE(globMatch("*a*a*a*a*a*a*a*a*a*a*b", name.c_str()));
+    EXPECT_TRUE(globMatch("*a*a*a*a*a*a*a*a*a*a*", name.c_str()));
+}
+
+TEST(GlobMatchTest, Prefix)
+{
+    EXPECT_EQ(globPrefix("log_2026*"), "log_2026");
+    EXPECT_EQ(globPrefix("log_?.txt"), "log_");
+    EXPECT_EQ(globPrefix("[ab]*"), "");
+    EXPECT_EQ(globPrefix("exact"), "exact");
+}
+
+TEST_F(StorageIndexTest, Match_ScansPrefixRangeOnly)
+{
+    StorageIndex index;
+    ASSERT_TRUE(index.build(basePath));
+    index.update(basePath + "/log_2025-12.txt", 1);
+    index.update(basePath + "/log_2026-01.txt", 1);
+    index.update(basePath + "/log_2026-02.txt", 1);
+    index.update(basePath + "/log_2026-02.bin", 1);
+    index.update(basePath + "/log_2026/nested.txt", 1);
+
+    std::vector<StorageIndex::Entry> found = index.match("", "log_2026*.txt");
+    ASSERT_EQ(found.size(), 2u);
+    EXPECT_EQ(found[0].name, "log_2026-01.txt");
+    EXPECT_EQ(found[1].name, "log_2026-02.txt");
+
+    EXPECT_EQ(index.match("log_2026", "*.txt").size(), 1u);
+    EXPECT_EQ(index.match("", "log_202[5]-*").size(), 1u);
+}
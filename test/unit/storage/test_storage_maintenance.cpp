@@ -0,0 +1,178 @@
+/**
+ * @file test_storage_maintenance.cpp
+ * @brief Unit tests for StorageMaintenance
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/state_machine/state_machine.hpp"
+#include "lopcore/storage/nvs_storage.hpp"
+#include "lopcore/storage/spiffs_storage.hpp"
+#include "lopcore/storage/storage_maintenance.hpp"
+
+using namespace lopcore;
+using namespace std::chrono_literals;
+
+static_assert(storage::traits::supports_gc_v<SpiffsStorage>, "SpiffsStorage collects garbage on request");
+static_assert(storage::traits::supports_check_v<SpiffsStorage>, "SpiffsStorage checks on request");
+static_assert(!storage::traits::supports_gc_v<NvsStorage>, "NVS has no garbage collection to schedule");
+
+/**
+ * @brief Backend with every kind of maintenance, counting calls
+ */
+struct MaintainedBackend
+{
+    bool collectGarbage(size_t bytes)
+    {
+        gcBytes = bytes;
+        gcCalls++;
+        return true;
+    }
+
+    bool check()
+    {
+        checkCalls++;
+        return healthy;
+    }
+
+    bool commit()
+    {
+        commitCalls++;
+        return true;
+    }
+
+    size_t gcBytes = 0;
+    int gcCalls = 0;
+    int checkCalls = 0;
+    int commitCalls = 0;
+    bool healthy = true;
+};
+
+enum class AppState
+{
+    ACTIVE,
+    RADIO_OFF,
+    SLEEP
+};
+
+/**
+ * @brief Wait up to a second for condition
+ */
+template <typename Condition>
+static bool eventually(Condition condition)
+{
+    for (int i = 0; i < 200 && !condition(); i++)
+    {
+        std::this_thread::sleep_for(5ms);
+    }
+    return condition();
+}
+
+TEST(StorageMaintenanceTest, RunDue_RunsEachDueTaskOncePerInterval)
+{
+    StorageMaintenance maintenance(storage::StorageMaintenanceConfig{});
+    std::vector<std::string> order;
+    maintenance.addTask("first", MaintenanceTask::GC, [&] { return order.push_back("first"), true; }, 1h);
+    maintenance.addTask("second", MaintenanceTask::CHECK, [&] { return order.push_back("second"), true; }, 1h);
+    maintenance.addTask("never", MaintenanceTask::SYNC, [&] { return order.push_back("never"), true; }, 0ms);
+
+    EXPECT_EQ(maintenance.due(), 2u);
+    EXPECT_EQ(maintenance.runDue(1s), 2u);
+    EXPECT_EQ(order, (std::vector<std::string>{"first", "second"}));
+
+    EXPECT_EQ(maintenance.due(), 0u);
+    EXPECT_EQ(maintenance.runDue(1s), 0u);
+
+    StorageMaintenanceStats stats = maintenance.getStats();
+    EXPECT_EQ(stats.gcRuns, 1u);
+    EXPECT_EQ(stats.checks, 1u);
+    EXPECT_EQ(stats.syncs, 0u);
+}
+
+TEST(StorageMaintenanceTest, RunDue_StopsAtBudget)
+{
+    StorageMaintenance maintenance(storage::StorageMaintenanceConfig{});
+    for (int i = 0; i < 5; i++)
+    {
+        maintenance.addTask("slow", MaintenanceTask::GC, [] { return std::this_thread::sleep_for(30ms), true; }, 1h);
+    }
+
+    EXPECT_EQ(maintenance.runDue(50ms), 2u); // The second task started before the budget ran out
+    EXPECT_EQ(maintenance.due(), 3u);
+    EXPECT_GE(maintenance.getStats().longestTaskMs, 30u);
+}
+
+TEST(StorageMaintenanceTest, Watch_SchedulesWhatTheBackendSupports)
+{
+    MaintainedBackend backend;
+    backend.healthy = false;
+    StorageMaintenance maintenance(storage::StorageMaintenanceConfig().setGcReserveBytes(8192));
+    maintenance.watch(backend, "flash");
+
+    EXPECT_EQ(maintenance.runDue(1s), 3u);
+    EXPECT_EQ(backend.gcCalls, 1);
+    EXPECT_EQ(backend.gcBytes, 8192u);
+    EXPECT_EQ(backend.checkCalls, 1);
+    EXPECT_EQ(backend.commitCalls, 1);
+    EXPECT_EQ(maintenance.getStats().failed, 1u); // The check found damage
+
+    MaintainedBackend checksOff;
+    StorageMaintenance noChecks(storage::StorageMaintenanceConfig().setCheckInterval(0ms));
+    noChecks.watch(checksOff, "flash");
+    EXPECT_EQ(noChecks.runDue(1s), 2u);
+    EXPECT_EQ(checksOff.checkCalls, 0);
+}
+
+TEST(StorageMaintenanceTest, Worker_RunsOnlyWhileIdle)
+{
+    std::atomic<int> runs{0};
+    StorageMaintenance maintenance(storage::StorageMaintenanceConfig{});
+    maintenance.addTask("gc", MaintenanceTask::GC, [&] { return runs++, true; }, 10ms);
+    ASSERT_TRUE(maintenance.start());
+
+    std::this_thread::sleep_for(50ms);
+    EXPECT_EQ(runs.load(), 0);
+
+    maintenance.setIdle(true);
+    EXPECT_TRUE(eventually([&] { return runs.load() >= 3; })); // Repeats at its interval
+
+    maintenance.setIdle(false);
+    std::this_thread::sleep_for(20ms);
+    int settled = runs.load();
+    std::this_thread::sleep_for(50ms);
+    EXPECT_EQ(runs.load(), settled);
+
+    maintenance.stop();
+    EXPECT_FALSE(maintenance.isRunning());
+}
+
+TEST(StorageMaintenanceTest, IdleWhile_FollowsStateMachine)
+{
+    StateMachine<AppState> machine(AppState::ACTIVE);
+    MaintainedBackend backend;
+    StorageMaintenance maintenance(storage::StorageMaintenanceConfig{});
+    maintenance.watch(backend, "flash");
+    maintenance.idleWhile(machine, {AppState::RADIO_OFF, AppState::SLEEP});
+    ASSERT_TRUE(maintenance.start());
+
+    EXPECT_FALSE(maintenance.isIdle());
+    std::this_thread::sleep_for(30ms);
+    EXPECT_EQ(maintenance.getStats().gcRuns, 0u);
+
+    machine.transition(AppState::RADIO_OFF);
+    EXPECT_TRUE(maintenance.isIdle());
+    EXPECT_TRUE(eventually([&] { return maintenance.getStats().gcRuns == 1; }));
+    machine.transition(AppState::SLEEP);
+    EXPECT_TRUE(maintenance.isIdle());
+    machine.transition(AppState::ACTIVE);
+    EXPECT_FALSE(maintenance.isIdle());
+}
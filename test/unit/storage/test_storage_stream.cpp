@@ -0,0 +1,375 @@
+/**
+ * @file test_storage_stream.cpp
+ * @brief Unit tests for StorageReader/StorageWriter and the SPIFFS stream accessors
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include <sys/stat.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/storage/spiffs_storage.hpp"
+#include "lopcore/storage/storage_stream.hpp"
+
+using namespace lopcore;
+
+class StorageStreamTest : public ::testing::Test
+{
+protected:
+    std::string basePath;
+    std::unique_ptr<SpiffsStorage> storage;
+
+    void SetUp() override
+    {
+        char pattern[] = "/tmp/lopcore_stream_XXXXXX";
+        ASSERT_NE(mkdtemp(pattern), nullptr);
+        basePath = pattern;
+        storage::SpiffsConfig config;
+        config.setBasePath(basePath);
+        storage = std::make_unique<SpiffsStorage>(config);
+        ASSERT_TRUE(storage->initialize());
+    }
+
+    void TearDown() override
+    {
+        storage.reset();
+        std::filesystem::remove_all(basePath);
+    }
+
+    static std::vector<uint8_t> pattern(size_t size)
+    {
+        std::vector<uint8_t> data(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            data[i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+        }
+        return data;
+    }
+};
+
+TEST_F(StorageStreamTest, ChunkedWriteThenRead_RoundTrips)
+{
+    std::vector<uint8_t> data = pattern(100 * 1024 + 13);
+
+    StorageWriter writer = storage->openWriter("record.bin", false, 1024);
+    ASSERT_TRUE(writer.isOpen());
+    for (size_t offset = 0; offset < data.size(); offset += 700)
+    {
+        size_t n = std::min<size_t>(700, data.size() - offset);
+        ASSERT_TRUE(writer.write(data.data() + offset, n));
+    }
+    EXPECT_EQ(writer.tell(), data.size());
+    ASSERT_TRUE(writer.close());
+    EXPECT_FALSE(writer.isOpen());
+
+    StorageReader reader = storage->openReader("record.bin", 512);
+    ASSERT_TRUE(reader);
+    EXPECT_EQ(reader.size(), data.size());
+
+    std::vector<uint8_t> readBack;
+    uint8_t chunk[333];
+    while (size_t n = reader.read(chunk, sizeof(chunk)))
+    {
+        readBack.insert(readBack.end(), chunk, chunk + n);
+    }
+    EXPECT_TRUE(reader.eof());
+    EXPECT_EQ(readBack, data);
+}
+
+TEST_F(StorageStreamTest, Reader_Seek)
+{
+    std::vector<uint8_t> data = pattern(4096);
+    ASSERT_TRUE(storage->write("seek.bin", data));
+
+    StorageReader reader = storage->openReader("seek.bin");
+    ASSERT_TRUE(reader.seek(1000));
+    EXPECT_EQ(reader.tell(), 1000u);
+
+    uint8_t chunk[16];
+    ASSERT_EQ(reader.read(chunk, sizeof(chunk)), sizeof(chunk));
+    EXPECT_TRUE(std::equal(chunk, chunk + sizeof(chunk), data.begin() + 1000));
+
+    EXPECT_FALSE(reader.seek(data.size() + 1));
+}
+
+TEST_F(StorageStreamTest, Writer_AppendAndSeek)
+{
+    ASSERT_TRUE(storage->write("log.txt", std::string("abc")));
+
+    {
+        StorageWriter writer = storage->openWriter("log.txt", true);
+        ASSERT_TRUE(writer.write(std::string("def")));
+    } // Closed and flushed here
+
+    EXPECT_EQ(storage->read("log.txt").value(), "abcdef");
+
+    StorageWriter writer = storage->openWriter("patch.txt", false, 0);
+    ASSERT_TRUE(writer.write(std::string("xxxxxx")));
+    ASSERT_TRUE(writer.seek(2));
+    ASSERT_TRUE(writer.write(std::string("YY")));
+    ASSERT_TRUE(writer.close());
+    EXPECT_EQ(storage->read("patch.txt").value(), "xxYYxx");
+}
+
+TEST_F(StorageStreamTest, MissingFile_ReaderIsClosed)
+{
+    StorageReader reader = storage->openReader("missing.bin");
+    EXPECT_FALSE(reader.isOpen());
+
+    uint8_t chunk[8];
+    EXPECT_EQ(reader.read(chunk, sizeof(chunk)), 0u);
+    EXPECT_FALSE(reader.seek(0));
+}
+
+TEST_F(StorageStreamTest, Move_TransfersOwnership)
+{
+    StorageWriter first = storage->openWriter("moved.txt");
+    ASSERT_TRUE(first.isOpen());
+
+    StorageWriter second = std::move(first);
+    EXPECT_FALSE(first.isOpen());
+    ASSERT_TRUE(second.write(std::string("moved")));
+    EXPECT_FALSE(first.write(std::string("lost")));
+    ASSERT_TRUE(second.close());
+
+    EXPECT_EQ(storage->read("moved.txt").value(), "moved");
+}
+
+TEST_F(StorageStreamTest, Append_OpenPerCall)
+{
+    for (int i = 0; i < 10; ++i)
+    {
+        ASSERT_TRUE(storage->append("samples.csv", std::to_string(i) + "\n"));
+    }
+    EXPECT_EQ(storage->read("samples.csv").value(), "0\n1\n2\n3\n4\n5\n6\n7\n8\n9\n");
+}
+
+TEST_F(StorageStreamTest, Append_KeptOpenFlushedBeforeOtherOperations)
+{
+    storage::SpiffsConfig config;
+    config.setBasePath(basePath).setAppendPolicy(storage::AppendPolicy().setOpenFiles(2));
+    SpiffsStorage kept(config);
+    ASSERT_TRUE(kept.initialize());
+
+    std::vector<uint8_t> sample = {1, 2, 3, 4};
+    for (int i = 0; i < 100; ++i)
+    {
+        ASSERT_TRUE(kept.append("a.bin", sample));
+    }
+    ASSERT_TRUE(kept.append("b.bin", std::string("b")));
+    ASSERT_TRUE(kept.append("c.bin", std::string("c"))); // Closes a.bin, the least recent
+
+    // Reading closes the kept-open file first, so nothing is missing
+    auto b = kept.readBinary("b.bin");
+    ASSERT_TRUE(b.has_value());
+    EXPECT_EQ(b->size(), 1u);
+    EXPECT_EQ(kept.readBinary("a.bin")->size(), 400u);
+
+    // Rewriting a kept-open file is not undone by its buffered appends
+    ASSERT_TRUE(kept.append("c.bin", std::string("cc")));
+    ASSERT_TRUE(kept.write("c.bin", std::string("new")));
+    EXPECT_EQ(kept.read("c.bin").value(), "new");
+}
+
+TEST_F(StorageStreamTest, Append_SyncPolicyWritesThrough)
+{
+    storage::SpiffsConfig config;
+    config.setBasePath(basePath).setAppendPolicy(storage::AppendPolicy().setOpenFiles(1).setSyncBytes(8));
+    SpiffsStorage kept(config);
+    ASSERT_TRUE(kept.initialize());
+
+    ASSERT_TRUE(kept.append("log.txt", std::string("1234")));
+    ASSERT_TRUE(kept.append("log.txt", std::string("5678"))); // Reaches syncBytes
+
+    // Visible to an independent reader without closing the appender
+    struct stat st;
+    ASSERT_EQ(stat((basePath + "/log.txt").c_str(), &st), 0);
+    EXPECT_EQ(st.st_size, 8);
+
+    ASSERT_TRUE(kept.append("log.txt", std::string("9")));
+    ASSERT_TRUE(kept.syncAppends());
+    ASSERT_EQ(stat((basePath + "/log.txt").c_str(), &st), 0);
+    EXPECT_EQ(st.st_size, 9);
+}
+
+TEST_F(StorageStreamTest, Append_WriteBackOnlyWritesAlignedChunks)
+{
+    std::string path = basePath + "/log.bin";
+    ASSERT_TRUE(storage->write("log.bin", std::string(100, 'h'))); // Unaligned start
+
+    StorageAppender appender(storage::AppendPolicy().setOpenFiles(1).setWriteBack(512, std::chrono::milliseconds(0)));
+    std::vector<uint8_t> sample(60, 's');
+    struct stat st;
+    std::vector<off_t> sizes;
+    for (int i = 0; i < 30; ++i)
+    {
+        ASSERT_TRUE(appender.append(path, sample.data(), sample.size()));
+        ASSERT_EQ(stat(path.c_str(), &st), 0);
+        if (sizes.empty() || sizes.back() != st.st_size)
+        {
+            sizes.push_back(st.st_size);
+        }
+    }
+
+    // First chunk fills up to the boundary, then whole chunks
+    EXPECT_EQ(sizes, (std::vector<off_t>{100, 512, 1024, 1536}));
+
+    ASSERT_TRUE(appender.syncAll());
+    ASSERT_EQ(stat(path.c_str(), &st), 0);
+    EXPECT_EQ(st.st_size, 100 + 30 * 60);
+
+    // Realigned after the partial chunk
+    ASSERT_TRUE(appender.append(path, sample.data(), sample.size()));
+    ASSERT_TRUE(appender.append(path, std::vector<uint8_t>(200, 'x').data(), 200));
+    ASSERT_EQ(stat(path.c_str(), &st), 0);
+    EXPECT_EQ(st.st_size, 2048);
+
+    ASSERT_TRUE(appender.close(path));
+    ASSERT_EQ(stat(path.c_str(), &st), 0);
+    EXPECT_EQ(st.st_size, 100 + 31 * 60 + 200);
+}
+
+TEST_F(StorageStreamTest, Append_WriteBackDelayWritesStaleChunks)
+{
+    std::string path = basePath + "/slow.bin";
+    StorageAppender appender(
+        storage::AppendPolicy().setOpenFiles(2).setWriteBack(4096, std::chrono::milliseconds(20)));
+
+    ASSERT_TRUE(appender.append(path, reinterpret_cast<const uint8_t *>("abc"), 3));
+    struct stat st;
+    EXPECT_NE(stat(path.c_str(), &st) == 0 ? st.st_size : -1, 3);
+
+    // Any later append checks every kept-open file's oldest buffered byte
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    ASSERT_TRUE(appender.append(basePath + "/other.bin", reinterpret_cast<const uint8_t *>("x"), 1));
+    ASSERT_EQ(stat(path.c_str(), &st), 0);
+    EXPECT_EQ(st.st_size, 3);
+}
+
+TEST_F(StorageStreamTest, Append_ConcurrentFilesWithEvictionAndCloses_LoseNothing)
+{
+    StorageAppender appender(
+        storage::AppendPolicy().setOpenFiles(2).setWriteBack(256, std::chrono::milliseconds(1)));
+
+    // More files than kept open, so appends keep closing each other's files
+    std::vector<std::thread> threads;
+    std::atomic<bool> done{false};
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([this, &appender, t] {
+            std::string path = basePath + "/file" + std::to_string(t) + ".bin";
+            std::vector<uint8_t> sample(37, static_cast<uint8_t>('a' + t));
+            for (int i = 0; i < 200; ++i)
+            {
+                ASSERT_TRUE(appender.append(path, sample.data(), sample.size()));
+            }
+        });
+    }
+    std::thread closer([this, &appender, &done] {
+        for (int i = 0; !done; ++i)
+        {
+            appender.close(basePath + "/file" + std::to_string(i % 4) + ".bin");
+        }
+    });
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    done = true;
+    closer.join();
+
+    ASSERT_TRUE(appender.closeAll());
+    EXPECT_EQ(appender.openFiles(), 0u);
+    for (int t = 0; t < 4; ++t)
+    {
+        struct stat st;
+        ASSERT_EQ(stat((basePath + "/file" + std::to_string(t) + ".bin").c_str(), &st), 0);
+        EXPECT_EQ(st.st_size, 200 * 37);
+    }
+}
+
+TEST_F(StorageStreamTest, ConcurrentReadsAndWrites_StayConsistent)
+{
+    storage::SpiffsConfig config;
+    config.setBasePath(basePath).setIndexFiles(true).setAppendPolicy(storage::AppendPolicy().setOpenFiles(2));
+    SpiffsStorage shared(config);
+    ASSERT_TRUE(shared.initialize());
+    ASSERT_TRUE(shared.write("cert.pem", std::string(2048, 'c')));
+
+    std::vector<std::thread> threads;
+    std::atomic<int> badReads{0};
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&shared, &badReads, t] {
+            std::string own = "own" + std::to_string(t) + ".bin";
+            for (int i = 0; i < 50; ++i)
+            {
+                // Whole-file writes of one size: a reader sees either version, never a mix
+                ASSERT_TRUE(shared.write(own, std::string(256, static_cast<char>('a' + i % 26))));
+                ASSERT_TRUE(shared.append("log.txt", std::string("x")));
+                std::optional<std::string> cert = shared.read("cert.pem");
+                std::optional<std::string> mine = shared.read(own);
+                if (!cert || cert->size() != 2048 || !mine || mine->size() != 256 ||
+                    mine->find_first_not_of((*mine)[0]) != std::string::npos)
+                {
+                    badReads++;
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(badReads.load(), 0);
+    EXPECT_EQ(shared.read("log.txt")->size(), 200u);
+    EXPECT_EQ(shared.listKeys().size(), 6u);
+}
+
+TEST_F(StorageStreamTest, WriteFileAtomic_ReplacesWithoutLeftovers)
+{
+    std::string path = basePath + "/config.json";
+    ASSERT_TRUE(storage->write("config.json", std::string("{\"v\":1}")));
+
+    std::string next = "{\"v\":2}";
+    ASSERT_TRUE(writeFileAtomic(path, reinterpret_cast<const uint8_t *>(next.data()), next.size(), false));
+    EXPECT_EQ(storage->read("config.json").value(), next);
+
+    struct stat st;
+    EXPECT_NE(stat((path + ".tmp").c_str(), &st), 0);
+    EXPECT_NE(stat((path + ".bak").c_str(), &st), 0);
+}
+
+TEST_F(StorageStreamTest, WriteFileAtomic_KeepsBackupGeneration)
+{
+    std::string path = basePath + "/config.json";
+
+    std::string first = "first";
+    ASSERT_TRUE(writeFileAtomic(path, reinterpret_cast<const uint8_t *>(first.data()), first.size(), true));
+    EXPECT_EQ(storage->read("config.json").value(), first);
+
+    std::string second = "second";
+    ASSERT_TRUE(writeFileAtomic(path, reinterpret_cast<const uint8_t *>(second.data()), second.size(), true));
+    EXPECT_EQ(storage->read("config.json").value(), second);
+    EXPECT_EQ(storage->read("config.json.bak").value(), first);
+}
+
+TEST_F(StorageStreamTest, WriteFileAtomic_FailureLeavesTargetIntact)
+{
+    ASSERT_TRUE(storage->write("config.json", std::string("intact")));
+
+    // The temporary file cannot be created in a missing directory
+    std::string data = "lost";
+    EXPECT_FALSE(writeFileAtomic(basePath + "/missing/config.json",
+                                 reinterpret_cast<const uint8_t *>(data.data()), data.size(), false));
+    EXPECT_EQ(storage->read("config.json").value(), "intact");
+}
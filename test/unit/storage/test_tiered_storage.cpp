@@ -0,0 +1,286 @@
+/**
+ * @file test_tiered_storage.cpp
+ * @brief Unit tests for TieredStorage
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/storage/tiered_storage.hpp"
+
+using namespace lopcore;
+
+/**
+ * @brief In-memory backend with an optional key length limit, like NVS
+ */
+class MemoryBackend
+{
+public:
+    explicit MemoryBackend(size_t maxKeyLength = 0) : maxKeyLength_(maxKeyLength)
+    {
+    }
+
+    bool write(const std::string &key, const std::vector<uint8_t> &data)
+    {
+        if (maxKeyLength_ > 0 && key.size() > maxKeyLength_)
+        {
+            return false;
+        }
+        data_[key] = data;
+        return true;
+    }
+
+    std::optional<std::vector<uint8_t>> readBinary(const std::string &key)
+    {
+        auto it = data_.find(key);
+        if (it == data_.end())
+        {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    bool remove(const std::string &key)
+    {
+        return data_.erase(key) != 0;
+    }
+
+    bool has(const std::string &key) const
+    {
+        return data_.count(key) != 0;
+    }
+
+private:
+    size_t maxKeyLength_;
+    std::map<std::string, std::vector<uint8_t>> data_;
+};
+
+/**
+ * @brief MemoryBackend that can be unmounted, like an SD card
+ */
+class RemovableBackend : public MemoryBackend
+{
+public:
+    bool isMounted() const
+    {
+        return mounted;
+    }
+
+    bool mounted = true;
+};
+
+class TieredStorageTest : public ::testing::Test
+{
+protected:
+    storage::TieredStorageConfig config()
+    {
+        return storage::TieredStorageConfig()
+            .setHotMaxSize(16)
+            .setWarmMaxSize(100)
+            .setHotCapacity(40)
+            .setPromoteHeat(3)
+            .setDemoteAfter(2);
+    }
+
+    void readTimes(TieredStorage &store, const std::string &key, int times)
+    {
+        for (int i = 0; i < times; i++)
+        {
+            ASSERT_TRUE(store.readBinary(key));
+        }
+    }
+
+    MemoryBackend nvs{15};
+    MemoryBackend flash;
+    RemovableBackend card;
+};
+
+TEST_F(TieredStorageTest, Write_PlacesBySize)
+{
+    TieredStorage store(nvs, flash, card, config());
+
+    ASSERT_TRUE(store.write("small", "abc"));
+    ASSERT_TRUE(store.write("large", std::string(500, 'x')));
+
+    EXPECT_EQ(store.tierOf("small"), StorageTier::WARM);
+    EXPECT_EQ(store.tierOf("large"), StorageTier::COLD);
+    EXPECT_TRUE(flash.has("small"));
+    EXPECT_TRUE(card.has("large"));
+    EXPECT_EQ(store.read("large"), std::string(500, 'x'));
+    EXPECT_FALSE(store.readBinary("missing"));
+    EXPECT_EQ(store.getStats().misses, 1u);
+}
+
+TEST_F(TieredStorageTest, Write_LargeStaysWarmWithoutCard)
+{
+    card.mounted = false;
+    TieredStorage store(nvs, flash, card, config());
+
+    ASSERT_TRUE(store.write("large", std::string(500, 'x')));
+    EXPECT_EQ(store.tierOf("large"), StorageTier::WARM);
+
+    TieredStorage twoTier(nvs, flash, config());
+    ASSERT_TRUE(twoTier.write("other", std::string(500, 'y')));
+    EXPECT_EQ(twoTier.tierOf("other"), StorageTier::WARM);
+}
+
+TEST_F(TieredStorageTest, Rebalance_PromotesFrequentlyReadKeys)
+{
+    TieredStorage store(nvs, flash, card, config());
+    ASSERT_TRUE(store.write("gains", "kp=1.2"));
+    ASSERT_TRUE(store.write("blob", std::string(500, 'b')));
+    readTimes(store, "gains", 3);
+    readTimes(store, "blob", 3);
+
+    EXPECT_EQ(store.rebalance(), 1u);
+    EXPECT_EQ(store.tierOf("gains"), StorageTier::HOT);
+    EXPECT_TRUE(nvs.has("gains"));
+    EXPECT_FALSE(flash.has("gains"));
+
+    // Too large for warm, so stays on the card however hot
+    EXPECT_EQ(store.tierOf("blob"), StorageTier::COLD);
+    EXPECT_EQ(store.read("gains"), "kp=1.2");
+
+    TieredStorageStats stats = store.getStats();
+    EXPECT_EQ(stats.promotions, 1u);
+    EXPECT_EQ(stats.hotBytes, 6u);
+    EXPECT_EQ(stats.hotReads, 1u);
+}
+
+TEST_F(TieredStorageTest, Rebalance_DemotesIdleKeysOneTierAtATime)
+{
+    TieredStorage store(nvs, flash, card, config());
+    ASSERT_TRUE(store.write("mode", "auto"));
+    readTimes(store, "mode", 3);
+    store.rebalance();
+    ASSERT_EQ(store.tierOf("mode"), StorageTier::HOT);
+
+    store.rebalance(); // Heat decays below promoteHeat, idle 1
+    EXPECT_EQ(store.tierOf("mode"), StorageTier::HOT);
+    store.rebalance(); // Idle 2
+    EXPECT_EQ(store.tierOf("mode"), StorageTier::WARM);
+    store.rebalance();
+    EXPECT_EQ(store.tierOf("mode"), StorageTier::WARM);
+    store.rebalance();
+    EXPECT_EQ(store.tierOf("mode"), StorageTier::COLD);
+
+    EXPECT_EQ(store.read("mode"), "auto");
+    EXPECT_EQ(store.getStats().demotions, 2u);
+    EXPECT_EQ(store.getStats().hotBytes, 0u);
+}
+
+TEST_F(TieredStorageTest, Rebalance_HotCapacityGoesToHottest)
+{
+    TieredStorage store(nvs, flash, card, config());
+    ASSERT_TRUE(store.write("a", std::string(16, 'a')));
+    ASSERT_TRUE(store.write("b", std::string(16, 'b')));
+    ASSERT_TRUE(store.write("c", std::string(16, 'c')));
+    readTimes(store, "a", 3);
+    readTimes(store, "b", 3);
+    store.rebalance();
+    ASSERT_EQ(store.tierOf("a"), StorageTier::HOT);
+    ASSERT_EQ(store.tierOf("b"), StorageTier::HOT);
+
+    // 40 bytes hold two of them; the hotter newcomer displaces the colder one
+    readTimes(store, "c", 6);
+    readTimes(store, "a", 1);
+    store.rebalance();
+    EXPECT_EQ(store.tierOf("c"), StorageTier::HOT);
+    EXPECT_EQ(store.tierOf("a"), StorageTier::HOT);
+    EXPECT_EQ(store.tierOf("b"), StorageTier::WARM);
+    EXPECT_LE(store.getStats().hotBytes, 40u);
+}
+
+TEST_F(TieredStorageTest, Write_MovesKeyThatOutgrowsItsTier)
+{
+    TieredStorage store(nvs, flash, card, config());
+    ASSERT_TRUE(store.write("state", "s1"));
+    readTimes(store, "state", 3);
+    store.rebalance();
+    ASSERT_EQ(store.tierOf("state"), StorageTier::HOT);
+
+    ASSERT_TRUE(store.write("state", "s2"));
+    EXPECT_EQ(store.tierOf("state"), StorageTier::HOT);
+
+    ASSERT_TRUE(store.write("state", std::string(50, 's')));
+    EXPECT_EQ(store.tierOf("state"), StorageTier::WARM);
+    EXPECT_FALSE(nvs.has("state"));
+    EXPECT_EQ(store.getStats().hotBytes, 0u);
+}
+
+TEST_F(TieredStorageTest, LongKeys_StayOutOfNvs)
+{
+    TieredStorage store(nvs, flash, card, config());
+    std::string key = "a_key_longer_than_fifteen";
+    ASSERT_TRUE(store.write(key, "v"));
+    readTimes(store, key, 3);
+    store.rebalance();
+
+    EXPECT_EQ(store.tierOf(key), StorageTier::WARM);
+    EXPECT_EQ(store.read(key), "v");
+}
+
+TEST_F(TieredStorageTest, Untracked_FoundByProbingAndStaleCopiesRemoved)
+{
+    nvs.write("boot", {1});
+    card.write("log", {2, 2});
+
+    TieredStorage store(nvs, flash, card, config());
+    EXPECT_EQ(store.tierOf("boot"), StorageTier::HOT);
+    EXPECT_TRUE(store.exists("log"));
+    EXPECT_EQ(store.readBinary("log"), std::vector<uint8_t>({2, 2}));
+    EXPECT_EQ(store.getStats().hotBytes, 1u);
+
+    // Written by a previous boot in two tiers; a new write keeps one copy
+    nvs.write("dup", {1});
+    flash.write("dup", {1});
+    TieredStorage fresh(nvs, flash, card, config());
+    ASSERT_TRUE(fresh.write("dup", "new"));
+    EXPECT_FALSE(nvs.has("dup"));
+    EXPECT_EQ(fresh.read("dup"), "new");
+}
+
+TEST_F(TieredStorageTest, Remove_ClearsEveryTier)
+{
+    TieredStorage store(nvs, flash, card, config());
+    ASSERT_TRUE(store.write("k", "v"));
+    card.write("k", {1});
+
+    EXPECT_TRUE(store.remove("k"));
+    EXPECT_FALSE(flash.has("k"));
+    EXPECT_FALSE(card.has("k"));
+    EXPECT_FALSE(store.exists("k"));
+    EXPECT_FALSE(store.remove("k"));
+}
+
+TEST_F(TieredStorageTest, MaxKeys_ForgetsColdestButKeepsData)
+{
+    TieredStorage store(nvs, flash, card, config().setMaxKeys(2));
+    ASSERT_TRUE(store.write("a", "1"));
+    readTimes(store, "a", 2);
+    ASSERT_TRUE(store.write("b", "2"));
+    ASSERT_TRUE(store.write("c", "3"));
+
+    EXPECT_EQ(store.getStats().trackedKeys, 2u);
+    EXPECT_EQ(store.read("b"), "2");
+    EXPECT_EQ(store.getStats().trackedKeys, 2u);
+}
+
+TEST_F(TieredStorageTest, RemovedCard_ReadsMissAndReturnAfterRemount)
+{
+    TieredStorage store(nvs, flash, card, config());
+    ASSERT_TRUE(store.write("video", std::string(500, 'v')));
+
+    card.mounted = false;
+    EXPECT_FALSE(store.readBinary("video"));
+
+    card.mounted = true;
+    EXPECT_EQ(store.tierOf("video"), StorageTier::COLD);
+}
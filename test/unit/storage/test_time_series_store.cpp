@@ -0,0 +1,206 @@
+/**
+ * @file test_time_series_store.cpp
+ * @brief Unit tests for TimeSeriesStore
+ *
+ * @copyright Copyright (c) 2025 LopCore Contributors
+ * @license MIT License
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/storage/time_series_store.hpp"
+
+using namespace lopcore;
+
+class TimeSeriesStoreTest : public ::testing::Test
+{
+protected:
+    std::string root;
+    std::string directory;
+    storage::TimeSeriesConfig config;
+
+    void SetUp() override
+    {
+        char pattern[] = "/tmp/lopcore_timeseries_XXXXXX";
+        ASSERT_NE(mkdtemp(pattern), nullptr);
+        root = pattern;
+        directory = root + "/series";
+        config.setDirectory(directory).setRecordSize(sizeof(uint32_t)).setIndexInterval(4);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(root);
+    }
+
+    static void appendRange(TimeSeriesStore &store, int64_t from, int64_t to, int64_t step = 1)
+    {
+        for (int64_t t = from; t <= to; t += step)
+        {
+            uint32_t value = static_cast<uint32_t>(t * 10);
+            ASSERT_TRUE(store.append(t, &value));
+        }
+    }
+
+    static std::vector<int64_t> timestamps(TimeSeriesStore &store, int64_t from, int64_t to)
+    {
+        std::vector<int64_t> found;
+        store.query(from, to, [&found](int64_t timestamp, const uint8_t *record) {
+            uint32_t value;
+            memcpy(&value, record, sizeof(value));
+            EXPECT_EQ(value, static_cast<uint32_t>(timestamp * 10));
+            found.push_back(timestamp);
+            return true;
+        });
+        return found;
+    }
+};
+
+TEST_F(TimeSeriesStoreTest, Query_ReturnsRangeAcrossSegments)
+{
+    config.setSegmentBytes(64);
+    TimeSeriesStore store(config);
+    ASSERT_TRUE(store.open());
+    appendRange(store, 1000, 1099);
+
+    EXPECT_GT(store.getStats().segments, 5u);
+    EXPECT_EQ(store.getStats().records, 100u);
+    EXPECT_EQ(timestamps(store, 1037, 1041), (std::vector<int64_t>{1037, 1038, 1039, 1040, 1041}));
+    EXPECT_EQ(timestamps(store, 0, 1001), (std::vector<int64_t>{1000, 1001}));
+    EXPECT_EQ(timestamps(store, 1098, 5000), (std::vector<int64_t>{1098, 1099}));
+    EXPECT_TRUE(timestamps(store, 2000, 3000).empty());
+}
+
+TEST_F(TimeSeriesStoreTest, DeltaEncoding_CostsOneByteForSmallSteps)
+{
+    TimeSeriesStore store(config);
+    ASSERT_TRUE(store.open());
+    appendRange(store, 1700000000000, 1700000000099);
+
+    // First record has delta 0, the rest delta 1: one varint byte each
+    EXPECT_EQ(store.getStats().bytes, 100u * (1 + sizeof(uint32_t)));
+}
+
+TEST_F(TimeSeriesStoreTest, FixedEncoding_RoundTrips)
+{
+    config.setEncoding(storage::TimeSeriesEncoding::FIXED).setSegmentBytes(100);
+    TimeSeriesStore store(config);
+    ASSERT_TRUE(store.open());
+    appendRange(store, 0, 90, 3);
+
+    EXPECT_EQ(store.getStats().bytes, 31u * (8 + sizeof(uint32_t)));
+    EXPECT_EQ(timestamps(store, 10, 20), (std::vector<int64_t>{12, 15, 18}));
+}
+
+TEST_F(TimeSeriesStoreTest, EqualTimestamps_AllFound)
+{
+    TimeSeriesStore store(config);
+    ASSERT_TRUE(store.open());
+    uint32_t value = 50;
+    for (int i = 0; i < 10; i++)
+    {
+        ASSERT_TRUE(store.append(5, &value));
+    }
+    value = 60;
+    ASSERT_TRUE(store.append(6, &value));
+
+    EXPECT_EQ(timestamps(store, 5, 5).size(), 10u);
+}
+
+TEST_F(TimeSeriesStoreTest, Append_RejectsTimeGoingBackwards)
+{
+    TimeSeriesStore store(config);
+    ASSERT_TRUE(store.open());
+    appendRange(store, 100, 105);
+
+    uint32_t value = 0;
+    EXPECT_FALSE(store.append(99, &value));
+    EXPECT_EQ(store.lastTimestamp(), 105);
+}
+
+TEST_F(TimeSeriesStoreTest, QueryLast_StopsWhenVisitorReturnsFalse)
+{
+    TimeSeriesStore store(config);
+    ASSERT_TRUE(store.open());
+    appendRange(store, 0, 1000, 10);
+
+    EXPECT_EQ(store.queryLast(100, [](int64_t, const uint8_t *) { return true; }), 11u);
+
+    int64_t firstSeen = -1;
+    EXPECT_EQ(store.queryLast(100,
+                              [&firstSeen](int64_t timestamp, const uint8_t *) {
+                                  firstSeen = timestamp;
+                                  return false;
+                              }),
+              1u);
+    EXPECT_EQ(firstSeen, 900);
+}
+
+TEST_F(TimeSeriesStoreTest, Retention_DeletesWholeOldSegments)
+{
+    config.setSegmentBytes(50).setRetention(30);
+    TimeSeriesStore store(config);
+    ASSERT_TRUE(store.open());
+    appendRange(store, 0, 99);
+
+    TimeSeriesStats stats = store.getStats();
+    EXPECT_GE(stats.firstTimestamp, 99 - 30 - 10);
+    EXPECT_LE(stats.firstTimestamp, 99 - 30);
+    EXPECT_EQ(stats.lastTimestamp, 99);
+    std::vector<int64_t> found = timestamps(store, 0, 99);
+    ASSERT_FALSE(found.empty());
+    EXPECT_EQ(found.front(), stats.firstTimestamp);
+}
+
+TEST_F(TimeSeriesStoreTest, MaxSegmentsAndRemoveBefore)
+{
+    config.setSegmentBytes(50).setMaxSegments(3);
+    TimeSeriesStore store(config);
+    ASSERT_TRUE(store.open());
+    appendRange(store, 0, 99);
+    EXPECT_EQ(store.getStats().segments, 3u);
+
+    EXPECT_EQ(store.removeBefore(1000), 2u);
+    EXPECT_EQ(store.getStats().segments, 1u);
+}
+
+TEST_F(TimeSeriesStoreTest, Reopen_RebuildsIndexAndDropsPartialRecord)
+{
+    config.setSegmentBytes(64);
+    std::string newest;
+    {
+        TimeSeriesStore store(config);
+        ASSERT_TRUE(store.open());
+        appendRange(store, 0, 49);
+
+        // The newest segment starts at the first record it holds
+        std::vector<int64_t> all = timestamps(store, 0, 49);
+        size_t perSegment = 64 / (1 + sizeof(uint32_t));
+        char name[32];
+        snprintf(name, sizeof(name), "/%016llx.seg",
+                 static_cast<unsigned long long>(all[(all.size() - 1) / perSegment * perSegment]));
+        newest = directory + name;
+    }
+
+    // Power loss halfway through a record: a delta byte and part of the payload
+    FILE *file = fopen(newest.c_str(), "ab");
+    ASSERT_NE(file, nullptr);
+    fwrite("\x01\xAA\xBB", 1, 3, file);
+    fclose(file);
+
+    TimeSeriesStore store(config);
+    ASSERT_TRUE(store.open());
+    EXPECT_EQ(store.getStats().records, 50u);
+    EXPECT_EQ(store.lastTimestamp(), 49);
+    EXPECT_EQ(timestamps(store, 20, 23), (std::vector<int64_t>{20, 21, 22, 23}));
+
+    appendRange(store, 50, 51);
+    EXPECT_EQ(timestamps(store, 48, 51), (std::vector<int64_t>{48, 49, 50, 51}));
+}
@@ -0,0 +1,141 @@
+/**
+ * @file test_task_profile.cpp
+ * @brief Unit tests for the task scheduling profile
+ */
+
+#include <gtest/gtest.h>
+
+#include "lopcore/metrics/metrics_exporter.hpp"
+#include "lopcore/mqtt/mqtt_config.hpp"
+#include "lopcore/storage/storage_config.hpp"
+#include "lopcore/task/task_profile.hpp"
+
+using namespace lopcore;
+using namespace lopcore::task;
+
+namespace
+{
+
+void noopTask(void *)
+{
+}
+
+class TaskProfileTest : public ::testing::Test
+{
+protected:
+    void TearDown() override
+    {
+        ASSERT_EQ(setProfile(TaskProfile::defaults()), ESP_OK);
+    }
+};
+
+} // namespace
+
+TEST_F(TaskProfileTest, DefaultsKeepPreviousTaskSettings)
+{
+    TaskProfile profile = getProfile();
+
+    EXPECT_EQ(profile[TaskRole::MQTT_LOOP].priority, 5u);
+    EXPECT_EQ(profile[TaskRole::MQTT_LOOP].stackSize, 4096u);
+    EXPECT_EQ(profile[TaskRole::MQTT_AGENT].stackSize, 6144u);
+    EXPECT_EQ(profile[TaskRole::TLS_CONNECT].stackSize, 8192u);
+    EXPECT_EQ(profile[TaskRole::LOG_DRAIN].priority, 2u);
+    EXPECT_EQ(profile[TaskRole::METRICS_EXPORT].stackSize, 3072u);
+    EXPECT_EQ(profile[TaskRole::METRICS_EXPORT].priority, 1u);
+    for (size_t i = 0; i < TASK_ROLE_COUNT; i++)
+    {
+        EXPECT_EQ(profile[static_cast<TaskRole>(i)].coreId, ANY_CORE);
+    }
+    EXPECT_EQ(profile.validate(), ESP_OK);
+}
+
+TEST_F(TaskProfileTest, PinGroupOnlyMovesThatGroup)
+{
+    TaskProfile profile = TaskProfile::defaults();
+    profile.pinGroup(TaskGroup::NETWORK, 0);
+
+    EXPECT_EQ(profile[TaskRole::MQTT_LOOP].coreId, 0);
+    EXPECT_EQ(profile[TaskRole::MQTT_DISPATCH].coreId, 0);
+    EXPECT_EQ(profile[TaskRole::TLS_CONNECT].coreId, 0);
+    EXPECT_EQ(profile[TaskRole::LOG_DRAIN].coreId, ANY_CORE);
+    EXPECT_EQ(profile[TaskRole::STORAGE_IO].coreId, ANY_CORE);
+    EXPECT_EQ(groupOf(TaskRole::METRICS_EXPORT), TaskGroup::BACKGROUND);
+}
+
+TEST_F(TaskProfileTest, InvalidProfileIsRejectedWhole)
+{
+    TaskProfile profile = TaskProfile::defaults();
+    profile[TaskRole::MQTT_LOOP].stackSize = 8192;
+    profile[TaskRole::STORAGE_IO].coreId = MAX_CORE + 1;
+
+    EXPECT_EQ(setProfile(profile), ESP_ERR_INVALID_ARG);
+    EXPECT_EQ(getSettings(TaskRole::MQTT_LOOP).stackSize, 4096u);
+
+    profile[TaskRole::STORAGE_IO].coreId = 0;
+    profile[TaskRole::LOG_MQTT].priority = 0;
+    EXPECT_EQ(setProfile(profile), ESP_ERR_INVALID_ARG);
+
+    profile[TaskRole::LOG_MQTT].priority = 1;
+    profile[TaskRole::LOG_MQTT].stackSize = 1024;
+    EXPECT_EQ(setProfile(profile), ESP_ERR_INVALID_ARG);
+}
+
+TEST_F(TaskProfileTest, ConfigsTakeDefaultsFromProfile)
+{
+    TaskProfile profile = TaskProfile::defaults();
+    profile[TaskRole::MQTT_DISPATCH] = {1, 7, 5120};
+    profile[TaskRole::STORAGE_IO] = {0, 3, 6144};
+    profile[TaskRole::METRICS_EXPORT].stackSize = 2048;
+    ASSERT_EQ(setProfile(profile), ESP_OK);
+
+    mqtt::DispatchConfig dispatch;
+    EXPECT_EQ(dispatch.stackSize, 5120u);
+    EXPECT_EQ(dispatch.priority, 7u);
+
+    storage::AsyncStorageConfig storage;
+    EXPECT_EQ(storage.coreId, 0);
+    EXPECT_EQ(storage.priority, 3u);
+    EXPECT_EQ(storage.stackSize, 6144u);
+
+    metrics::MetricsExporterConfig exporter;
+    EXPECT_EQ(exporter.stackSize, 2048u);
+
+    // Per-instance overrides still win
+    storage.setCoreId(1);
+    EXPECT_EQ(storage.coreId, 1);
+}
+
+TEST_F(TaskProfileTest, RoleNames)
+{
+    EXPECT_STREQ(roleName(TaskRole::MQTT_LOOP), "mqtt_loop");
+    EXPECT_STREQ(roleName(TaskRole::STORAGE_MAINT), "storage_maint");
+    EXPECT_STREQ(roleName(TaskRole::METRICS_EXPORT), "metrics_export");
+    EXPECT_STREQ(roleName(TaskRole::COUNT), "unknown");
+}
+
+TEST_F(TaskProfileTest, SpawnedTasksAreCounted)
+{
+    auto before = getStackReport()[static_cast<size_t>(TaskRole::MQTT_COALESCE)];
+
+    TaskHandle_t first = nullptr;
+    TaskHandle_t second = nullptr;
+    ASSERT_EQ(spawn(TaskRole::MQTT_COALESCE, "test_a", noopTask, nullptr, &first), ESP_OK);
+    ASSERT_EQ(spawn(TaskRole::MQTT_COALESCE, "test_b", noopTask, nullptr, 3072, 2, &second), ESP_OK);
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+
+    auto report = getStackReport()[static_cast<size_t>(TaskRole::MQTT_COALESCE)];
+    EXPECT_EQ(report.role, TaskRole::MQTT_COALESCE);
+    EXPECT_EQ(report.started, before.started + 2);
+    EXPECT_EQ(report.running, before.running + 2);
+    EXPECT_EQ(report.stackSize, 3072u);
+
+    forgetTask(first);
+    forgetTask(second);
+    vTaskDelete(first);
+    vTaskDelete(second);
+    report = getStackReport()[static_cast<size_t>(TaskRole::MQTT_COALESCE)];
+    EXPECT_EQ(report.started, before.started + 2);
+    EXPECT_EQ(report.running, before.running);
+    logStackReport();
+}
@@ -7,16 +7,44 @@
 
 #include <sys/stat.h>
 
+#include <atomic>
 #include <cstdio>
+#include <cstdlib>
 #include <fstream>
+#include <new>
 
 #include <gtest/gtest.h>
 
-#include "logging/file_sink.hpp"
-#include "logging/logger.hpp"
+#include "lopcore/logging/file_sink.hpp"
+#include "lopcore/logging/log_compress.hpp"
+#include "lopcore/logging/logger.hpp"
 
 using namespace lopcore;
 
+// Count heap allocations so the steady-state write path can be checked
+static std::atomic<size_t> g_allocations{0};
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
 /**
  * @brief Test fixture for FileSink tests
  */
@@ -358,3 +386,175 @@ TEST_F(FileSinkTest, DestructorFlush)
     ASSERT_TRUE(std::getline(file, line));
     EXPECT_NE(line.find("Message without explicit flush"), std::string::npos);
 }
+
+/**
+ * @brief Test steady-state writes and flushes do not allocate
+ */
+TEST_F(FileSinkTest, WritePathDoesNotAllocate)
+{
+    FileSinkConfig config;
+    config.base_path = test_dir_;
+    config.filename = "test.log";
+    config.buffer_size = 128;
+    config.auto_rotate = false;
+
+    FileSink sink(config);
+    LogMessage msg;
+    msg.level = LogLevel::INFO;
+    msg.timestamp_ms = 1000;
+    msg.tag = "TEST";
+    msg.message = "Allocation-free message";
+
+    // Prime stdio's own file buffer
+    sink.write(msg);
+    sink.flush();
+
+    size_t before = g_allocations.load();
+    for (int i = 0; i < 100; i++)
+    {
+        sink.write(msg);
+    }
+    sink.flush();
+    EXPECT_EQ(g_allocations.load(), before);
+
+    std::ifstream file(test_file_);
+    std::string line;
+    int lines = 0;
+    while (std::getline(file, line))
+    {
+        EXPECT_NE(line.find("Allocation-free message"), std::string::npos);
+        lines++;
+    }
+    EXPECT_EQ(lines, 101);
+}
+
+/**
+ * @brief Test oversized records are truncated but keep their newline
+ */
+TEST_F(FileSinkTest, OversizedRecordIsTruncated)
+{
+    FileSinkConfig config;
+    config.base_path = test_dir_;
+    config.filename = "test.log";
+
+    std::string longMessage(2 * FileSink::MAX_RECORD_SIZE, 'x');
+    {
+        FileSink sink(config);
+        LogMessage msg;
+        msg.level = LogLevel::INFO;
+        msg.timestamp_ms = 1000;
+        msg.tag = "TEST";
+        msg.message = longMessage.c_str();
+        sink.write(msg);
+        msg.message = "next";
+        sink.write(msg);
+    }
+
+    std::ifstream file(test_file_);
+    std::string line;
+    ASSERT_TRUE(std::getline(file, line));
+    EXPECT_EQ(line.size(), FileSink::MAX_RECORD_SIZE - 2);
+    ASSERT_TRUE(std::getline(file, line));
+    EXPECT_NE(line.find("next"), std::string::npos);
+}
+
+/**
+ * @brief Test numbered generations are shifted by rename on rotation
+ */
+TEST_F(FileSinkTest, NumberedGenerations)
+{
+    FileSinkConfig config;
+    config.base_path = test_dir_;
+    config.filename = "test.log";
+    config.auto_rotate = false;
+    config.max_generations = 2;
+
+    {
+        FileSink sink(config);
+        LogMessage msg;
+        msg.level = LogLevel::INFO;
+        msg.timestamp_ms = 1000;
+        msg.tag = "TEST";
+
+        const char *messages[] = {"first", "second", "third", "live"};
+        for (size_t i = 0; i < 4; i++)
+        {
+            msg.message = messages[i];
+            sink.write(msg);
+            if (i < 3)
+            {
+                EXPECT_TRUE(sink.rotate());
+            }
+        }
+        sink.flush();
+
+        std::string line;
+        std::ifstream gen1(sink.getGenerationPath(1));
+        ASSERT_TRUE(std::getline(gen1, line));
+        EXPECT_NE(line.find("third"), std::string::npos);
+
+        std::ifstream gen2(sink.getGenerationPath(2));
+        ASSERT_TRUE(std::getline(gen2, line));
+        EXPECT_NE(line.find("second"), std::string::npos);
+
+        // Generation 3 exceeds max_generations and was deleted
+        struct stat st;
+        EXPECT_NE(stat(sink.getGenerationPath(3).c_str(), &st), 0);
+
+        std::ifstream live(test_file_);
+        ASSERT_TRUE(std::getline(live, line));
+        EXPECT_NE(line.find("live"), std::string::npos);
+
+        remove(sink.getGenerationPath(1).c_str());
+        remove(sink.getGenerationPath(2).c_str());
+    }
+}
+
+/**
+ * @brief Test rotated generations are compressed in the background
+ */
+TEST_F(FileSinkTest, CompressedGenerations)
+{
+    FileSinkConfig config;
+    config.base_path = test_dir_;
+    config.filename = "test.log";
+    config.auto_rotate = false;
+    config.max_generations = 2;
+    config.compress_rotated = true;
+
+    FileSink sink(config);
+    LogMessage msg;
+    msg.level = LogLevel::INFO;
+    msg.timestamp_ms = 1000;
+    msg.tag = "TEST";
+    msg.message = "Repeated message that compresses well";
+    for (int i = 0; i < 50; i++)
+    {
+        sink.write(msg);
+    }
+    ASSERT_TRUE(sink.rotate());
+    ASSERT_TRUE(sink.rotate());
+    sink.waitForCompression();
+
+    struct stat st;
+    EXPECT_NE(stat(sink.getGenerationPath(1).c_str(), &st), 0);
+    EXPECT_NE(stat(sink.getGenerationPath(2).c_str(), &st), 0);
+    ASSERT_EQ(stat(sink.getGenerationPath(2, true).c_str(), &st), 0);
+    ASSERT_EQ(stat(sink.getGenerationPath(1, true).c_str(), &st), 0);
+
+    // The older generation holds the 50 messages
+    std::string unpacked = test_dir_ + "/unpacked.log";
+    ASSERT_TRUE(decompressLogFile(sink.getGenerationPath(2, true).c_str(), unpacked.c_str()));
+    std::ifstream file(unpacked);
+    std::string line;
+    int lines = 0;
+    while (std::getline(file, line))
+    {
+        lines++;
+    }
+    EXPECT_EQ(lines, 50);
+
+    remove(unpacked.c_str());
+    remove(sink.getGenerationPath(1, true).c_str());
+    remove(sink.getGenerationPath(2, true).c_str());
+}
@@ -3,9 +3,13 @@
  * @brief Unit tests for NvsStorage
  */
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 #include <gtest/gtest.h>
 
-#include "storage/nvs_storage.hpp"
+#include "lopcore/storage/nvs_storage.hpp"
 
 using namespace lopcore;
 
@@ -273,6 +277,347 @@ TEST_F(NvsStorageTest, Write_MaxLengthKey_Success)
     EXPECT_EQ(*readData, data);
 }
 
+// Test 21: Default policy commits every write
+TEST_F(NvsStorageTest, Write_DefaultPolicy_CommitsEachWrite)
+{
+    EXPECT_TRUE(storage->write("key_a", std::string("a")));
+    EXPECT_EQ(storage->pendingWrites(), 0u);
+}
+
+// Test 22: Batch defers the commit to its end
+TEST_F(NvsStorageTest, Batch_DefersCommitUntilEnd)
+{
+    {
+        NvsStorage::Batch batch(*storage);
+        for (int i = 0; i < 30; i++)
+        {
+            EXPECT_TRUE(storage->write("field_" + std::to_string(i), std::to_string(i)));
+        }
+        EXPECT_EQ(storage->pendingWrites(), 30u);
+
+        // Batched writes are readable before the commit
+        auto value = storage->read("field_7");
+        ASSERT_TRUE(value.has_value());
+        EXPECT_EQ(*value, "7");
+    }
+
+    EXPECT_EQ(storage->pendingWrites(), 0u);
+}
+
+// Test 23: Nested batches commit with the outermost one
+TEST_F(NvsStorageTest, Batch_NestedCommitsOnce)
+{
+    ASSERT_TRUE(storage->beginBatch());
+    ASSERT_TRUE(storage->beginBatch());
+    storage->write("inner", std::string("1"));
+    EXPECT_TRUE(storage->commitBatch());
+    EXPECT_EQ(storage->pendingWrites(), 1u);
+
+    storage->write("outer", std::string("2"));
+    EXPECT_TRUE(storage->commitBatch());
+    EXPECT_EQ(storage->pendingWrites(), 0u);
+
+    // Unbalanced end
+    EXPECT_FALSE(storage->commitBatch());
+}
+
+// Test 24: Auto-commit by write count
+TEST_F(NvsStorageTest, AutoCommit_ByWriteCount)
+{
+    storage::NvsConfig config;
+    config.setNamespace("test_batch").setAutoCommitWrites(3);
+    NvsStorage counted(config);
+    ASSERT_TRUE(counted.initialize());
+
+    counted.write("k1", std::string("1"));
+    counted.write("k2", std::string("2"));
+    EXPECT_EQ(counted.pendingWrites(), 2u);
+
+    counted.write("k3", std::string("3"));
+    EXPECT_EQ(counted.pendingWrites(), 0u);
+
+    counted.write("k4", std::string("4"));
+    EXPECT_TRUE(counted.commit());
+    EXPECT_EQ(counted.pendingWrites(), 0u);
+
+    counted.eraseNamespace();
+    counted.commit();
+}
+
+// Test 25: Auto-commit by age of the oldest pending write
+TEST_F(NvsStorageTest, AutoCommit_ByInterval)
+{
+    storage::NvsConfig config;
+    config.setNamespace("test_batch").setAutoCommitWrites(0).setAutoCommitInterval(
+        std::chrono::milliseconds(20));
+    NvsStorage timed(config);
+    ASSERT_TRUE(timed.initialize());
+
+    timed.write("k1", std::string("1"));
+    EXPECT_EQ(timed.pendingWrites(), 1u);
+
+    // Committed by the timer, without a further write
+    for (int i = 0; i < 100 && timed.pendingWrites() > 0; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(timed.pendingWrites(), 0u);
+
+    timed.eraseNamespace();
+    timed.commit();
+}
+
+// Test 26: Values past the small-value stack buffer round-trip intact
+TEST_F(NvsStorageTest, Read_LargeValues_ReturnsData)
+{
+    std::string text(200, 'x');
+    std::vector<uint8_t> blob(300);
+    for (size_t i = 0; i < blob.size(); ++i)
+    {
+        blob[i] = static_cast<uint8_t>(i);
+    }
+    ASSERT_TRUE(storage->write("big_str", text));
+    ASSERT_TRUE(storage->write("big_blob", blob));
+
+    auto readText = storage->read("big_str");
+    ASSERT_TRUE(readText.has_value());
+    EXPECT_EQ(readText.value(), text);
+
+    auto readBlob = storage->readBinary("big_blob");
+    ASSERT_TRUE(readBlob.has_value());
+    EXPECT_EQ(readBlob.value(), blob);
+}
+
+// Test 27: Reading a string into a caller buffer
+TEST_F(NvsStorageTest, ReadIntoBuffer_String)
+{
+    ASSERT_TRUE(storage->write("ssid", std::string("MyNetwork")));
+
+    char buffer[32];
+    size_t length = 0;
+    ASSERT_TRUE(storage->read("ssid", buffer, sizeof(buffer), &length));
+    EXPECT_EQ(length, 9u);
+    EXPECT_STREQ(buffer, "MyNetwork");
+
+    // Too small: reports the capacity needed, terminator included
+    char tiny[4];
+    EXPECT_FALSE(storage->read("ssid", tiny, sizeof(tiny), &length));
+    EXPECT_EQ(length, 10u);
+
+    EXPECT_FALSE(storage->read("missing", buffer, sizeof(buffer), &length));
+}
+
+// Test 28: Reading a blob into a caller buffer
+TEST_F(NvsStorageTest, ReadIntoBuffer_Binary)
+{
+    std::vector<uint8_t> data = {0x01, 0x02, 0x03, 0x04};
+    ASSERT_TRUE(storage->write("blob", data));
+
+    uint8_t buffer[16];
+    size_t length = 0;
+    ASSERT_TRUE(storage->readBinary("blob", buffer, sizeof(buffer), &length));
+    ASSERT_EQ(length, data.size());
+    EXPECT_TRUE(std::equal(data.begin(), data.end(), buffer));
+
+    // A null buffer queries the size
+    EXPECT_FALSE(storage->readBinary("blob", nullptr, 0, &length));
+    EXPECT_EQ(length, data.size());
+}
+
+// Test 29: One instance serves many operations without reinitializing
+TEST_F(NvsStorageTest, Handle_StaysUsableAcrossOperations)
+{
+    for (int i = 0; i < 50; ++i)
+    {
+        std::string value = std::to_string(i);
+        ASSERT_TRUE(storage->write("counter", value));
+        auto result = storage->read("counter");
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result.value(), value);
+        EXPECT_TRUE(storage->exists("counter"));
+    }
+    EXPECT_TRUE(storage->remove("counter"));
+    EXPECT_FALSE(storage->exists("counter"));
+}
+
+// Test 30: Cache serves repeat reads and counts hits and misses
+TEST_F(NvsStorageTest, Cache_RepeatReadsHit)
+{
+    storage::NvsConfig config;
+    config.setNamespace("test_cache").setCacheEntries(4);
+    NvsStorage cached(config);
+    ASSERT_TRUE(cached.initialize());
+
+    ASSERT_TRUE(cached.write("threshold", std::string("42")));
+    for (int i = 0; i < 3; ++i)
+    {
+        auto result = cached.read("threshold");
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result.value(), "42");
+    }
+
+    // Written values are cached, so no read went to NVS
+    NvsCacheStats stats = cached.getCacheStats();
+    EXPECT_EQ(stats.hits, 3u);
+    EXPECT_EQ(stats.misses, 0u);
+    EXPECT_EQ(stats.entries, 1u);
+
+    // A value written by another instance is cached on its first read
+    std::vector<uint8_t> id = {0xDE, 0xAD};
+    NvsStorage writer(config);
+    ASSERT_TRUE(writer.initialize());
+    ASSERT_TRUE(writer.write("device_id", id));
+    EXPECT_EQ(cached.readBinary("device_id").value(), id);
+    EXPECT_EQ(cached.readBinary("device_id").value(), id);
+    stats = cached.getCacheStats();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.hits, 4u);
+
+    cached.eraseNamespace();
+}
+
+// Test 31: Writes update, removal and erase invalidate the cache
+TEST_F(NvsStorageTest, Cache_WriteThroughAndInvalidation)
+{
+    storage::NvsConfig config;
+    config.setNamespace("test_cache").setCacheEntries(4);
+    NvsStorage cached(config);
+    ASSERT_TRUE(cached.initialize());
+
+    ASSERT_TRUE(cached.write("mode", std::string("auto")));
+    ASSERT_TRUE(cached.write("mode", std::string("manual")));
+    EXPECT_EQ(cached.read("mode").value(), "manual");
+
+    ASSERT_TRUE(cached.remove("mode"));
+    EXPECT_FALSE(cached.read("mode").has_value());
+
+    ASSERT_TRUE(cached.write("a", std::string("1")));
+    ASSERT_TRUE(cached.write("b", std::string("2")));
+    ASSERT_TRUE(cached.eraseNamespace());
+    EXPECT_EQ(cached.getCacheStats().entries, 0u);
+    EXPECT_FALSE(cached.read("a").has_value());
+    EXPECT_FALSE(cached.read("b").has_value());
+}
+
+// Test 32: A full cache drops the least recently used value
+TEST_F(NvsStorageTest, Cache_EvictsLeastRecentlyUsed)
+{
+    storage::NvsConfig config;
+    config.setNamespace("test_cache").setCacheEntries(2);
+    NvsStorage cached(config);
+    ASSERT_TRUE(cached.initialize());
+
+    ASSERT_TRUE(cached.write("k1", std::string("1")));
+    ASSERT_TRUE(cached.write("k2", std::string("2")));
+    cached.read("k1"); // k2 is now least recently used
+    ASSERT_TRUE(cached.write("k3", std::string("3")));
+
+    NvsCacheStats before = cached.getCacheStats();
+    EXPECT_EQ(before.evictions, 1u);
+    EXPECT_EQ(before.entries, 2u);
+
+    // Evicted values are still read from NVS
+    char buffer[8];
+    size_t length = 0;
+    ASSERT_TRUE(cached.read("k2", buffer, sizeof(buffer), &length));
+    EXPECT_STREQ(buffer, "2");
+    EXPECT_EQ(cached.getCacheStats().misses, before.misses + 1);
+
+    cached.eraseNamespace();
+}
+
+// Test 33: Without cacheEntries nothing is cached or counted
+TEST_F(NvsStorageTest, Cache_OffByDefault)
+{
+    ASSERT_TRUE(storage->write("key", std::string("value")));
+    storage->read("key");
+
+    NvsCacheStats stats = storage->getCacheStats();
+    EXPECT_EQ(stats.entries, 0u);
+    EXPECT_EQ(stats.hits, 0u);
+    EXPECT_EQ(stats.misses, 0u);
+}
+
+// Test 34: Integers round-trip through the native NVS entry types
+TEST_F(NvsStorageTest, TypedAccessors_Integers)
+{
+    ASSERT_TRUE(storage->set<uint32_t>("boot_count", 4000000000u));
+    ASSERT_TRUE(storage->set<int64_t>("offset", -1234567890123LL));
+    ASSERT_TRUE(storage->set<int8_t>("trim", -5));
+    ASSERT_TRUE(storage->set("enabled", true));
+
+    EXPECT_EQ(storage->get<uint32_t>("boot_count"), 4000000000u);
+    EXPECT_EQ(storage->get<int64_t>("offset"), -1234567890123LL);
+    EXPECT_EQ(storage->get<int8_t>("trim"), -5);
+    EXPECT_EQ(storage->get<bool>("enabled"), true);
+
+    EXPECT_FALSE(storage->get<uint32_t>("missing").has_value());
+    // Another width is another NVS type
+    EXPECT_FALSE(storage->get<uint16_t>("boot_count").has_value());
+}
+
+// Test 35: Trivially copyable structs are stored as blobs of their bytes
+TEST_F(NvsStorageTest, TypedAccessors_Struct)
+{
+    struct Calibration
+    {
+        float gain;
+        float offset;
+        uint16_t samples;
+    };
+
+    Calibration calib{1.02f, -0.4f, 16};
+    ASSERT_TRUE(storage->set("calib", calib));
+
+    auto result = storage->get<Calibration>("calib");
+    ASSERT_TRUE(result.has_value());
+    EXPECT_FLOAT_EQ(result->gain, 1.02f);
+    EXPECT_FLOAT_EQ(result->offset, -0.4f);
+    EXPECT_EQ(result->samples, 16);
+
+    // A blob of another size is not this type
+    ASSERT_TRUE(storage->write("short", std::vector<uint8_t>{1, 2}));
+    EXPECT_FALSE(storage->get<Calibration>("short").has_value());
+}
+
+// Test 36: set<T> replaces a cached value of another type
+TEST_F(NvsStorageTest, TypedAccessors_InvalidateCache)
+{
+    storage::NvsConfig config;
+    config.setNamespace("test_cache").setCacheEntries(4);
+    NvsStorage cached(config);
+    ASSERT_TRUE(cached.initialize());
+
+    ASSERT_TRUE(cached.write("level", std::string("3")));
+    ASSERT_TRUE(cached.set<uint8_t>("level", 7));
+    EXPECT_EQ(cached.getCacheStats().entries, 0u);
+    EXPECT_EQ(cached.get<uint8_t>("level"), 7);
+
+    cached.eraseNamespace();
+}
+
+// Test 37: The interval timer leaves batched writes to commitBatch()
+TEST_F(NvsStorageTest, AutoCommit_IntervalTimerWaitsForBatch)
+{
+    storage::NvsConfig config;
+    config.setNamespace("test_batch").setAutoCommitWrites(0).setAutoCommitInterval(
+        std::chrono::milliseconds(20));
+    NvsStorage timed(config);
+    ASSERT_TRUE(timed.initialize());
+
+    ASSERT_TRUE(timed.beginBatch());
+    timed.write("k1", std::string("1"));
+    timed.write("k2", std::string("2"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    EXPECT_EQ(timed.pendingWrites(), 2u);
+
+    ASSERT_TRUE(timed.commitBatch());
+    EXPECT_EQ(timed.pendingWrites(), 0u);
+
+    timed.eraseNamespace();
+    timed.commit();
+}
+
 // Main
 int main(int argc, char **argv)
 {
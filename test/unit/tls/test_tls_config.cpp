@@ -8,6 +8,8 @@
  * @copyright Copyright (c) 2025
  */
 
+#include <algorithm>
+
 #include <gtest/gtest.h>
 
 #include "lopcore/tls/tls_config.hpp"
@@ -378,3 +380,152 @@ TEST_F(TlsConfigValidationTest, AWSIoT_MissingCACert_Fails)
 
     EXPECT_EQ(ESP_ERR_INVALID_ARG, result);
 }
+
+TEST_F(TlsConfigValidationTest, SessionResumption_EnabledInRamByDefault)
+{
+    TlsConfig config = createValidConfig();
+
+    EXPECT_TRUE(config.sessionResumption);
+    EXPECT_TRUE(config.sessionNvsNamespace.empty());
+}
+
+TEST_F(TlsConfigValidationTest, SessionResumption_BuilderSetsOptions)
+{
+    TlsConfig config = TlsConfigBuilder()
+                           .hostname("mqtt.example.com")
+                           .port(8883)
+                           .caCertificate("/spiffs/certs/ca.crt")
+                           .clientCertificate("device-cert")
+                           .privateKey("device-key")
+                           .sessionResumption(false)
+                           .persistSession("tls_sessions")
+                           .build();
+
+    EXPECT_FALSE(config.sessionResumption);
+    EXPECT_EQ(config.sessionNvsNamespace, "tls_sessions");
+    EXPECT_EQ(ESP_OK, config.validate());
+}
+
+TEST_F(TlsConfigValidationTest, SessionResumption_NamespaceTooLong_Fails)
+{
+    TlsConfig config = createValidConfig();
+    config.sessionNvsNamespace = "sixteen_chars_ns";
+
+    EXPECT_EQ(ESP_ERR_INVALID_ARG, config.validate());
+}
+
+TEST_F(TlsConfigValidationTest, RecvBuffer_DefaultAndBuilder)
+{
+    EXPECT_EQ(createValidConfig().recvBufferSize, 1024u);
+
+    TlsConfig config = TlsConfigBuilder()
+                           .hostname("mqtt.example.com")
+                           .port(8883)
+                           .caCertificate("/spiffs/certs/ca.crt")
+                           .clientCertificate("device-cert")
+                           .privateKey("device-key")
+                           .recvBufferSize(0)
+                           .build();
+
+    EXPECT_EQ(config.recvBufferSize, 0u);
+    EXPECT_EQ(ESP_OK, config.validate());
+}
+
+TEST_F(TlsConfigValidationTest, BufferProfile_Presets)
+{
+    EXPECT_EQ(createValidConfig().maxFragmentLength, defaultMaxFragmentLength());
+
+    TlsConfig lowMemory = TlsConfigBuilder()
+                              .hostname("mqtt.example.com")
+                              .port(8883)
+                              .caCertificate("/spiffs/certs/ca.crt")
+                              .clientCertificate("device-cert")
+                              .privateKey("device-key")
+                              .bufferProfile(TlsBufferProfile::LOW_MEMORY)
+                              .build();
+    EXPECT_EQ(lowMemory.maxFragmentLength, 1024u);
+    EXPECT_EQ(lowMemory.recvBufferSize, 256u);
+    EXPECT_EQ(ESP_OK, lowMemory.validate());
+
+    TlsConfig throughput = TlsConfigBuilder()
+                               .hostname("mqtt.example.com")
+                               .port(8883)
+                               .caCertificate("/spiffs/certs/ca.crt")
+                               .clientCertificate("device-cert")
+                               .privateKey("device-key")
+                               .bufferProfile(TlsBufferProfile::THROUGHPUT)
+                               .maxFragmentLength(2048)
+                               .build();
+    EXPECT_EQ(throughput.maxFragmentLength, 2048u);
+    EXPECT_EQ(throughput.recvBufferSize, 4096u);
+    EXPECT_EQ(ESP_OK, throughput.validate());
+}
+
+TEST_F(TlsConfigValidationTest, MaxFragmentLength_Invalid)
+{
+    TlsConfig config = createValidConfig();
+    config.maxFragmentLength = 8192;
+    EXPECT_EQ(ESP_ERR_INVALID_ARG, config.validate());
+
+    config.maxFragmentLength = 0;
+    EXPECT_EQ(ESP_OK, config.validate());
+}
+
+TEST_F(TlsConfigValidationTest, JitterFirstAttempt_DefaultAndBuilder)
+{
+    EXPECT_FALSE(createValidConfig().jitterFirstAttempt);
+
+    TlsConfig config = TlsConfigBuilder()
+                           .hostname("mqtt.example.com")
+                           .port(8883)
+                           .caCertificate("/spiffs/certs/ca.crt")
+                           .clientCertificate("device-cert")
+                           .privateKey("device-key")
+                           .maxRetries(0)
+                           .jitterFirstAttempt()
+                           .build();
+
+    EXPECT_TRUE(config.jitterFirstAttempt);
+    EXPECT_EQ(config.maxRetries, 0u);
+    EXPECT_EQ(ESP_OK, config.validate());
+}
+
+TEST_F(TlsConfigValidationTest, PreferHardwareCrypto_SetsAesGcmAndNistCurves)
+{
+    EXPECT_TRUE(createValidConfig().cipherSuites.empty());
+    EXPECT_TRUE(createValidConfig().keyExchangeGroups.empty());
+
+    TlsConfig config = TlsConfigBuilder()
+                           .hostname("mqtt.example.com")
+                           .port(8883)
+                           .caCertificate("/spiffs/certs/ca.crt")
+                           .clientCertificate("device-cert")
+                           .privateKey("device-key")
+                           .preferHardwareCrypto()
+                           .build();
+
+    ASSERT_FALSE(config.cipherSuites.empty());
+    EXPECT_EQ(config.cipherSuites.front(), cipher_suite::TLS13_AES_128_GCM_SHA256);
+    EXPECT_EQ(std::count(config.cipherSuites.begin(), config.cipherSuites.end(),
+                         cipher_suite::ECDHE_RSA_AES_128_GCM_SHA256),
+              1);
+    EXPECT_EQ(std::count(config.cipherSuites.begin(), config.cipherSuites.end(),
+                         cipher_suite::ECDHE_RSA_CHACHA20_POLY1305_SHA256),
+              0);
+    EXPECT_EQ(config.keyExchangeGroups, (std::vector<uint16_t>{tls_group::SECP256R1, tls_group::SECP384R1}));
+    EXPECT_EQ(ESP_OK, config.validate());
+}
+
+TEST_F(TlsConfigValidationTest, CipherSuites_TooMany_Fails)
+{
+    TlsConfig config = createValidConfig();
+    config.cipherSuites.assign(MAX_CIPHER_SUITES, cipher_suite::ECDHE_RSA_AES_128_GCM_SHA256);
+    EXPECT_EQ(ESP_OK, config.validate());
+
+    config.cipherSuites.push_back(cipher_suite::ECDHE_RSA_AES_256_GCM_SHA384);
+    EXPECT_EQ(ESP_ERR_INVALID_ARG, config.validate());
+
+    config.cipherSuites.clear();
+    config.keyExchangeGroups.assign(MAX_KEY_EXCHANGE_GROUPS + 1, tls_group::X25519);
+    EXPECT_EQ(ESP_ERR_INVALID_ARG, config.validate());
+}
@@ -0,0 +1,113 @@
+/**
+ * @file test_tls_sendv.cpp
+ * @brief Unit tests for the default ITlsTransport::sendv()
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/tls/tls_transport.hpp"
+
+using namespace lopcore::tls;
+
+namespace
+{
+
+/**
+ * @brief Transport that records sends and can cap how much each send writes
+ */
+class RecordingTransport : public ITlsTransport
+{
+public:
+    esp_err_t connect(const TlsConfig &) override
+    {
+        return ESP_OK;
+    }
+
+    void disconnect() noexcept override
+    {
+    }
+
+    esp_err_t send(const void *data, size_t size, size_t *bytesSent) override
+    {
+        sendCalls++;
+        if (failSends)
+        {
+            return ESP_FAIL;
+        }
+        size_t n = std::min(size, maxPerSend);
+        stream.append(static_cast<const char *>(data), n);
+        *bytesSent = n;
+        return ESP_OK;
+    }
+
+    esp_err_t recv(void *, size_t, size_t *) override
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    bool isConnected() const noexcept override
+    {
+        return true;
+    }
+
+    void *getNetworkContext() noexcept override
+    {
+        return nullptr;
+    }
+
+    std::string stream;
+    size_t maxPerSend = SIZE_MAX;
+    bool failSends = false;
+    int sendCalls = 0;
+};
+
+} // namespace
+
+TEST(TlsSendvTest, SendsSegmentsInOrder)
+{
+    RecordingTransport transport;
+    TlsSegment segments[] = {{"hdr", 3}, {"", 0}, {"payload", 7}, {"!", 1}};
+
+    size_t sent = 0;
+    EXPECT_EQ(transport.sendv(segments, 4, &sent), ESP_OK);
+    EXPECT_EQ(sent, 11u);
+    EXPECT_EQ(transport.stream, "hdrpayload!");
+    EXPECT_EQ(transport.sendCalls, 3); // Empty segment skipped
+}
+
+TEST(TlsSendvTest, StopsAtShortWrite)
+{
+    RecordingTransport transport;
+    transport.maxPerSend = 4;
+    TlsSegment segments[] = {{"abc", 3}, {"defghij", 7}, {"k", 1}};
+
+    size_t sent = 0;
+    EXPECT_EQ(transport.sendv(segments, 3, &sent), ESP_OK);
+    EXPECT_EQ(sent, 7u);
+    EXPECT_EQ(transport.stream, "abcdefg");
+}
+
+TEST(TlsSendvTest, ReportsSendError)
+{
+    RecordingTransport transport;
+    transport.failSends = true;
+    TlsSegment segment{"abc", 3};
+
+    size_t sent = 99;
+    EXPECT_EQ(transport.sendv(&segment, 1, &sent), ESP_FAIL);
+    EXPECT_EQ(sent, 0u);
+}
+
+TEST(TlsSendvTest, RejectsNullArguments)
+{
+    RecordingTransport transport;
+    size_t sent = 0;
+    EXPECT_EQ(transport.sendv(nullptr, 1, &sent), ESP_ERR_INVALID_ARG);
+
+    TlsSegment segment{"abc", 3};
+    EXPECT_EQ(transport.sendv(&segment, 1, nullptr), ESP_ERR_INVALID_ARG);
+}
@@ -0,0 +1,294 @@
+/**
+ * @file test_tls_transport_pool.cpp
+ * @brief Unit tests for TlsTransportPool
+ */
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "lopcore/tls/tls_transport_pool.hpp"
+
+using namespace lopcore::tls;
+
+namespace
+{
+
+struct Counters
+{
+    int created = 0;
+    int destroyed = 0;
+    esp_err_t connectResult = ESP_OK;
+    esp_err_t waitResult = ESP_ERR_TIMEOUT;
+};
+
+/**
+ * @brief Transport that only tracks its connection state
+ */
+class FakeTransport : public ITlsTransport
+{
+public:
+    explicit FakeTransport(Counters &counters) : counters_(counters)
+    {
+        counters_.created++;
+    }
+
+    ~FakeTransport() override
+    {
+        counters_.destroyed++;
+    }
+
+    esp_err_t connect(const TlsConfig &config) override
+    {
+        host = config.hostname;
+        connected = counters_.connectResult == ESP_OK;
+        return counters_.connectResult;
+    }
+
+    void disconnect() noexcept override
+    {
+        connected = false;
+    }
+
+    esp_err_t send(const void *, size_t size, size_t *bytesSent) override
+    {
+        *bytesSent = size;
+        return ESP_OK;
+    }
+
+    esp_err_t recv(void *, size_t, size_t *) override
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_err_t waitForData(uint32_t) override
+    {
+        return counters_.waitResult;
+    }
+
+    bool isConnected() const noexcept override
+    {
+        return connected;
+    }
+
+    void *getNetworkContext() noexcept override
+    {
+        return nullptr;
+    }
+
+    std::string host;
+    bool connected = false;
+
+private:
+    Counters &counters_;
+};
+
+TlsConfig serverConfig(const std::string &host)
+{
+    TlsConfig config;
+    config.hostname = host;
+    config.port = 8883;
+    config.clientCertLabel = "device-cert";
+    return config;
+}
+
+class TlsTransportPoolTest : public ::testing::Test
+{
+protected:
+    std::unique_ptr<TlsTransportPool> makePool(size_t maxTransports = 2,
+                                               std::chrono::milliseconds idle = std::chrono::minutes(1))
+    {
+        TlsPoolConfig config;
+        config.maxTransports = maxTransports;
+        config.idleTimeout = idle;
+        auto factory = [this] { return std::make_unique<FakeTransport>(counters); };
+        return std::make_unique<TlsTransportPool>(factory, config);
+    }
+
+    Counters counters;
+};
+
+} // namespace
+
+TEST_F(TlsTransportPoolTest, ReleasedConnectionIsReused)
+{
+    auto pool = makePool();
+
+    std::shared_ptr<ITlsTransport> first;
+    ASSERT_EQ(pool->acquire(serverConfig("a.example.com"), first), ESP_OK);
+    ITlsTransport *raw = first.get();
+    first.reset();
+    EXPECT_EQ(pool->getStats().parked, 1u);
+
+    std::shared_ptr<ITlsTransport> second;
+    ASSERT_EQ(pool->acquire(serverConfig("a.example.com"), second), ESP_OK);
+    EXPECT_EQ(second.get(), raw);
+    EXPECT_EQ(counters.created, 1);
+
+    TlsPoolStats stats = pool->getStats();
+    EXPECT_EQ(stats.live, 1u);
+    EXPECT_EQ(stats.parked, 0u);
+    EXPECT_EQ(stats.opened, 1u);
+    EXPECT_EQ(stats.reused, 1u);
+}
+
+TEST_F(TlsTransportPoolTest, DifferentServerOrAlpnOpensNewConnection)
+{
+    auto pool = makePool(4);
+
+    std::shared_ptr<ITlsTransport> transport;
+    ASSERT_EQ(pool->acquire(serverConfig("a.example.com"), transport), ESP_OK);
+    transport.reset();
+
+    ASSERT_EQ(pool->acquire(serverConfig("b.example.com"), transport), ESP_OK);
+    transport.reset();
+
+    TlsConfig alpn = serverConfig("a.example.com");
+    alpn.alpnProtocols = {"x-amzn-mqtt-ca"};
+    ASSERT_EQ(pool->acquire(alpn, transport), ESP_OK);
+
+    EXPECT_EQ(counters.created, 3);
+    EXPECT_EQ(pool->getStats().reused, 0u);
+}
+
+TEST_F(TlsTransportPoolTest, DifferentServerAuthenticationOpensNewConnection)
+{
+    auto pool = makePool(8);
+
+    TlsConfig verified = serverConfig("a.example.com");
+    verified.caCertPath = "/spiffs/certs/root-ca.crt";
+    std::shared_ptr<ITlsTransport> transport;
+    ASSERT_EQ(pool->acquire(verified, transport), ESP_OK);
+    transport.reset();
+
+    TlsConfig unverified = verified;
+    unverified.verifyPeer = false;
+    TlsConfig otherCa = verified;
+    otherCa.caCertPath = "/spiffs/certs/private-ca.crt";
+    TlsConfig noNameCheck = verified;
+    noNameCheck.skipCommonNameCheck = true;
+    TlsConfig otherKey = verified;
+    otherKey.clientKeyLabel = "other-key";
+    TlsConfig suites = verified;
+    suites.cipherSuites = {cipher_suite::TLS13_AES_128_GCM_SHA256};
+
+    for (const TlsConfig *config : {&unverified, &otherCa, &noNameCheck, &otherKey, &suites})
+    {
+        ASSERT_EQ(pool->acquire(*config, transport), ESP_OK);
+        transport.reset();
+    }
+    EXPECT_EQ(counters.created, 6);
+    EXPECT_EQ(pool->getStats().reused, 0u);
+
+    // A verifying caller gets the verified connection back, not one of the others
+    ASSERT_EQ(pool->acquire(verified, transport), ESP_OK);
+    EXPECT_EQ(pool->getStats().reused, 1u);
+    EXPECT_EQ(counters.created, 6);
+}
+
+TEST_F(TlsTransportPoolTest, DisconnectedTransportIsNotParked)
+{
+    auto pool = makePool();
+
+    std::shared_ptr<ITlsTransport> transport;
+    ASSERT_EQ(pool->acquire(serverConfig("a.example.com"), transport), ESP_OK);
+    transport->disconnect();
+    transport.reset();
+
+    EXPECT_EQ(counters.destroyed, 1);
+    EXPECT_EQ(pool->getStats().live, 0u);
+    EXPECT_EQ(pool->getStats().parked, 0u);
+}
+
+TEST_F(TlsTransportPoolTest, ConnectionWithPendingDataIsNotReused)
+{
+    auto pool = makePool();
+
+    std::shared_ptr<ITlsTransport> transport;
+    ASSERT_EQ(pool->acquire(serverConfig("a.example.com"), transport), ESP_OK);
+    transport.reset();
+
+    counters.waitResult = ESP_OK; // e.g. the server sent close_notify while parked
+    ASSERT_EQ(pool->acquire(serverConfig("a.example.com"), transport), ESP_OK);
+
+    EXPECT_EQ(counters.created, 2);
+    EXPECT_EQ(counters.destroyed, 1);
+    EXPECT_EQ(pool->getStats().live, 1u);
+}
+
+TEST_F(TlsTransportPoolTest, FullPoolEvictsLeastRecentlyParked)
+{
+    auto pool = makePool(2);
+
+    std::shared_ptr<ITlsTransport> a;
+    std::shared_ptr<ITlsTransport> b;
+    ASSERT_EQ(pool->acquire(serverConfig("a.example.com"), a), ESP_OK);
+    ASSERT_EQ(pool->acquire(serverConfig("b.example.com"), b), ESP_OK);
+    a.reset();
+    b.reset();
+
+    std::shared_ptr<ITlsTransport> c;
+    ASSERT_EQ(pool->acquire(serverConfig("c.example.com"), c), ESP_OK);
+    EXPECT_EQ(pool->getStats().evicted, 1u);
+    EXPECT_EQ(pool->getStats().live, 2u);
+
+    // b is still parked, a was closed
+    std::shared_ptr<ITlsTransport> again;
+    ASSERT_EQ(pool->acquire(serverConfig("b.example.com"), again), ESP_OK);
+    EXPECT_EQ(pool->getStats().reused, 1u);
+    EXPECT_EQ(static_cast<FakeTransport *>(again.get())->host, "b.example.com");
+}
+
+TEST_F(TlsTransportPoolTest, AllConnectionsInUseFails)
+{
+    auto pool = makePool(1);
+
+    std::shared_ptr<ITlsTransport> a;
+    ASSERT_EQ(pool->acquire(serverConfig("a.example.com"), a), ESP_OK);
+
+    std::shared_ptr<ITlsTransport> b;
+    EXPECT_EQ(pool->acquire(serverConfig("b.example.com"), b), ESP_ERR_NO_MEM);
+    EXPECT_EQ(b, nullptr);
+    EXPECT_EQ(counters.created, 1);
+}
+
+TEST_F(TlsTransportPoolTest, ConnectFailureFreesTheSlot)
+{
+    auto pool = makePool(1);
+
+    counters.connectResult = ESP_FAIL;
+    std::shared_ptr<ITlsTransport> transport;
+    EXPECT_EQ(pool->acquire(serverConfig("a.example.com"), transport), ESP_FAIL);
+    EXPECT_EQ(pool->getStats().live, 0u);
+
+    counters.connectResult = ESP_OK;
+    EXPECT_EQ(pool->acquire(serverConfig("a.example.com"), transport), ESP_OK);
+}
+
+TEST_F(TlsTransportPoolTest, IdleConnectionsAreReclaimed)
+{
+    auto pool = makePool(2, std::chrono::milliseconds(0));
+
+    std::shared_ptr<ITlsTransport> transport;
+    ASSERT_EQ(pool->acquire(serverConfig("a.example.com"), transport), ESP_OK);
+    transport.reset();
+
+    EXPECT_EQ(pool->reclaimIdle(), 1u);
+    EXPECT_EQ(counters.destroyed, 1);
+    EXPECT_EQ(pool->getStats().live, 0u);
+    EXPECT_EQ(pool->getStats().evicted, 1u);
+}
+
+TEST_F(TlsTransportPoolTest, TransportMayOutliveThePool)
+{
+    auto pool = makePool();
+
+    std::shared_ptr<ITlsTransport> transport;
+    ASSERT_EQ(pool->acquire(serverConfig("a.example.com"), transport), ESP_OK);
+    pool.reset();
+
+    EXPECT_TRUE(transport->isConnected());
+    transport.reset();
+    EXPECT_EQ(counters.destroyed, 1);
+}
@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""
+Pack files into a LopCore asset bundle for AssetBundle (asset_bundle.hpp).
+
+The bundle is flashed to a raw data partition and memory-mapped on the
+device, so every asset is read in place from flash. Assets are stored in
+name order, each starting at a multiple of --align bytes.
+
+Usage:
+    lopcore_asset_pack.py bundle.bin model.tflite certs/ca.pem
+    lopcore_asset_pack.py bundle.bin --dir assets/ --align 64
+    lopcore_asset_pack.py bundle.bin --list
+
+Asset names are the paths as given (or relative to --dir), with '/'
+separators. Flash the result with:
+    parttool.py write_partition --partition-name assets --input bundle.bin
+
+Copyright (c) 2025 LopCore Contributors
+MIT License
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = b"LCAB"
+VERSION = 1
+HEADER = struct.Struct("<4sHHIIII")
+ENTRY = struct.Struct("<IIIHH")
+
+
+def collect(paths, directory):
+    """Return (name, path) pairs sorted by the UTF-8 bytes of the name."""
+    assets = []
+    for path in paths:
+        assets.append((path.replace(os.sep, "/"), path))
+    if directory:
+        for root, _, files in os.walk(directory):
+            for filename in files:
+                path = os.path.join(root, filename)
+                assets.append((os.path.relpath(path, directory).replace(os.sep, "/"), path))
+
+    # Must match the memcmp() order AssetBundle::find() searches in
+    assets.sort(key=lambda asset: asset[0].encode("utf-8"))
+    names = [name for name, _ in assets]
+    duplicates = sorted({name for name in names if names.count(name) > 1})
+    if duplicates:
+        sys.exit("duplicate asset names: " + ", ".join(duplicates))
+    return assets
+
+
+def pack(assets, align):
+    names = [name.encode("utf-8") for name, _ in assets]
+    for name in names:
+        if len(name) > 0xFFFF:
+            sys.exit("asset name too long: %s" % name[:40])
+
+    names_offset = HEADER.size + ENTRY.size * len(assets)
+    offset = names_offset + sum(len(name) for name in names)
+
+    entries = []
+    blobs = []
+    name_offset = names_offset
+    for name, (_, path) in zip(names, assets):
+        with open(path, "rb") as f:
+            data = f.read()
+        padding = -offset % align
+        blobs.append(b"\xff" * padding + data)  # 0xFF: erased flash, nothing to program
+        offset += padding
+        entries.append(ENTRY.pack(name_offset, offset, len(data), len(name), 0))
+        name_offset += len(name)
+        offset += len(data)
+
+    body = b"".join(entries) + b"".join(names) + b"".join(blobs)
+    total = HEADER.size + len(body)
+    if total > 0xFFFFFFFF:
+        sys.exit("bundle exceeds 4 GB")
+    crc = zlib.crc32(body) & 0xFFFFFFFF
+    return HEADER.pack(MAGIC, VERSION, align, len(assets), total, crc, 0) + body
+
+
+def list_bundle(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, version, align, count, total, crc, _ = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION:
+        sys.exit("not a version %d asset bundle" % VERSION)
+    ok = zlib.crc32(data[HEADER.size:total]) & 0xFFFFFFFF == crc
+    print("%d assets, %d bytes, align %d, crc %s" % (count, total, align, "ok" if ok else "BAD"))
+    for i in range(count):
+        name_offset, data_offset, size, name_length, _ = ENTRY.unpack_from(data, HEADER.size + i * ENTRY.size)
+        name = data[name_offset:name_offset + name_length].decode("utf-8", "replace")
+        print("  0x%08x %10d  %s" % (data_offset, size, name))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pack files into a LopCore asset bundle")
+    parser.add_argument("bundle", help="Output bundle (or input with --list)")
+    parser.add_argument("files", nargs="*", help="Files to pack, named by their path")
+    parser.add_argument("--dir", help="Pack every file under this directory, named relative to it")
+    parser.add_argument("--align", type=int, default=16, help="Alignment of each asset in bytes (default 16)")
+    parser.add_argument("--list", action="store_true", help="List the assets of an existing bundle")
+    args = parser.parse_args()
+
+    if args.list:
+        list_bundle(args.bundle)
+        return
+
+    if args.align < 1 or args.align > 0xFFFF or args.align & (args.align - 1):
+        sys.exit("--align must be a power of two below 65536")
+
+    assets = collect(args.files, args.dir)
+    if not assets:
+        sys.exit("no files to pack")
+
+    image = pack(assets, args.align)
+    with open(args.bundle, "wb") as f:
+        f.write(image)
+    print("Packed %d assets into %s (%d bytes)" % (len(assets), args.bundle, len(image)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+"""
+Decode binary LopCore log files written by FileSink in binary mode.
+
+Deferred frames only carry the addresses of the tag and format strings plus
+the raw argument bytes. This tool resolves those addresses against the
+firmware ELF and re-applies the printf formatting on the host.
+
+Compressed rotated generations (lopcore.log.N.lz, see log_compress.hpp)
+are unpacked transparently, whether they hold binary frames or text lines.
+
+Usage:
+    lopcore_log_decode.py lopcore.log --elf build/app.elf
+    lopcore_log_decode.py lopcore.log            # text frames only
+    lopcore_log_decode.py lopcore.log.1.lz --elf build/app.elf
+
+Requires pyelftools (pip install pyelftools) for deferred frames.
+
+Copyright (c) 2025 LopCore Contributors
+MIT License
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+FRAME_DEFERRED = 0xA5
+FRAME_TEXT = 0xA6
+HEADER = struct.Struct("<BBHIII")
+LZ_MAGIC = b"LCZ1"
+
+LEVEL_CHARS = {0: "N", 1: "E", 2: "W", 3: "I", 4: "D", 5: "V"}
+
+# Mirrors parseSpec() in src/logging/log_args.cpp
+SPEC_RE = re.compile(r"%([-+ #0']*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t|L|q)?([%diuxXocfFeEgGaAsp])")
+WIDE = ("l", "ll", "j", "z", "t", "q")
+
+
+class ElfStrings:
+    """Reads NUL-terminated strings from loadable ELF sections by address."""
+
+    def __init__(self, path):
+        try:
+            from elftools.elf.elffile import ELFFile
+        except ImportError:
+            sys.exit("pyelftools is required to decode deferred frames: pip install pyelftools")
+
+        self._sections = []
+        with open(path, "rb") as f:
+            elf = ELFFile(f)
+            for section in elf.iter_sections():
+                addr = section["sh_addr"]
+                if addr and section["sh_type"] == "SHT_PROGBITS":
+                    self._sections.append((addr, section.data()))
+
+    def read(self, addr):
+        for base, data in self._sections:
+            if base <= addr < base + len(data):
+                start = addr - base
+                end = data.find(b"\0", start)
+                return data[start:end if end >= 0 else len(data)].decode("utf-8", "replace")
+        return None
+
+
+def format_args(fmt, payload):
+    """Re-apply printf formatting to encoded arguments."""
+    out = []
+    pos = 0
+    last = 0
+
+    def take(fmt_char, size):
+        nonlocal pos
+        if pos + size > len(payload):
+            raise ValueError("truncated arguments")
+        (value,) = struct.unpack_from("<" + fmt_char, payload, pos)
+        pos += size
+        return value
+
+    try:
+        for m in SPEC_RE.finditer(fmt):
+            out.append(fmt[last:m.start()])
+            last = m.end()
+            flags, width, precision, length, conv = m.groups()
+            length = length or ""
+
+            if conv == "%":
+                out.append("%")
+                continue
+
+            if width == "*":
+                width = str(take("i", 4))
+            if precision == "*":
+                precision = str(take("i", 4))
+
+            spec = "%" + flags.replace("'", "") + (width or "")
+            if precision is not None:
+                spec += "." + (precision or "0")
+
+            if conv in "di":
+                value = take("q", 8) if length in WIDE else take("i", 4)
+                out.append((spec + "d") % value)
+            elif conv in "uxXo":
+                value = take("Q", 8) if length in WIDE else take("I", 4)
+                out.append((spec + conv.replace("u", "d")) % value)
+            elif conv == "c":
+                out.append((spec + "c") % chr(take("i", 4) & 0xFF))
+            elif conv in "fFeEgGaA":
+                value = take("d", 8)
+                out.append((spec + conv.lower().replace("a", "e")) % value)
+            elif conv == "p":
+                out.append("0x%x" % take("Q", 8))
+            elif conv == "s":
+                n = take("B", 1)
+                if pos + n > len(payload):
+                    raise ValueError("truncated string")
+                text = payload[pos:pos + n].decode("utf-8", "replace")
+                pos += n
+                out.append((spec.split(".")[0] + "s") % text)
+        out.append(fmt[last:])
+    except ValueError:
+        out.append("?")
+    return "".join(out)
+
+
+def decompress(data):
+    """Unpack a stream written by compressLogFile() (src/logging/log_compress.cpp)."""
+    out = bytearray()
+    pos = len(LZ_MAGIC)
+    while pos < len(data):
+        flags = data[pos]
+        pos += 1
+        for bit in range(8):
+            if pos >= len(data):
+                break
+            if not flags & (1 << bit):
+                out.append(data[pos])
+                pos += 1
+                continue
+            if pos + 2 > len(data):
+                raise ValueError("truncated match token")
+            low, high = data[pos], data[pos + 1]
+            pos += 2
+            offset = (low | ((high & 0x0F) << 8)) + 1
+            if offset > len(out):
+                raise ValueError("match offset before start of stream")
+            for _ in range((high >> 4) + 3):
+                out.append(out[-offset])
+    return bytes(out)
+
+
+def decode(data, elf):
+    offset = 0
+    while offset + HEADER.size <= len(data):
+        marker, level, length, timestamp, tag_addr, fmt_addr = HEADER.unpack_from(data, offset)
+        if marker not in (FRAME_DEFERRED, FRAME_TEXT):
+            offset += 1  # resync after a torn write
+            continue
+
+        start = offset + HEADER.size
+        payload = data[start:start + length]
+        offset = start + length
+
+        if marker == FRAME_TEXT:
+            tag, _, message = payload.partition(b"\0")
+            tag = tag.decode("utf-8", "replace")
+            message = message.decode("utf-8", "replace")
+        elif elf is None:
+            tag = "0x%08x" % tag_addr
+            message = "<deferred fmt 0x%08x, %d arg bytes; pass --elf>" % (fmt_addr, len(payload))
+        else:
+            tag = elf.read(tag_addr) or ("0x%08x" % tag_addr)
+            fmt = elf.read(fmt_addr)
+            message = format_args(fmt, payload) if fmt is not None else "<unknown fmt 0x%08x>" % fmt_addr
+
+        yield "[%10u] %s (%s): %s" % (timestamp, LEVEL_CHARS.get(level, "?"), tag, message)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode LopCore binary log files")
+    parser.add_argument("log", help="Binary log file written by FileSink (binary = true)")
+    parser.add_argument("--elf", help="Firmware ELF used to resolve tag/format addresses")
+    args = parser.parse_args()
+
+    elf = ElfStrings(args.elf) if args.elf else None
+    with open(args.log, "rb") as f:
+        data = f.read()
+
+    if data.startswith(LZ_MAGIC):
+        data = decompress(data)
+
+    if data and data[0] not in (FRAME_DEFERRED, FRAME_TEXT):
+        # Text-mode log file
+        sys.stdout.write(data.decode("utf-8", "replace"))
+        return
+
+    for line in decode(data, elf):
+        print(line)
+
+
+if __name__ == "__main__":
+    main()